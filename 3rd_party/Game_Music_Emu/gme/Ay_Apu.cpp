@@ -393,3 +393,18 @@ void Ay_Apu::run_until( blip_time_t final_end_time )
 	
 	last_time = final_end_time;
 }
+
+void Ay_Apu::osc_state( int index, double clock_rate, gme_voice_state_t* out ) const
+{
+	require( (unsigned) index < osc_count );
+	int const osc_mode = regs [7] >> index;
+	int const vol_mode = regs [0x08 + index];
+	gme_voice_silent( out );
+	out->clock  = clock_rate;
+	out->volume = (vol_mode & 0x10) ? 15 : (vol_mode & 0x0F); // envelope counts as full
+	out->active = out->volume && (~osc_mode & (tone_off | noise_off));
+	
+	// the tone flips every period; noise alone has no pitch
+	if ( out->active && !(osc_mode & tone_off) )
+		out->period = oscs [index].period * 2.0;
+}
@@ -402,3 +402,10 @@ blargg_err_t Ay_Emu::run_clocks( blip_time_t& duration, int )
 	
 	return 0;
 }
+
+int Ay_Emu::voice_states_( voice_state_t* out, int count ) const
+{
+	for ( int i = 0; i < count && i < Ay_Apu::osc_count; i++ )
+		apu.osc_state( i, clock_rate(), &out [i] );
+	return Ay_Apu::osc_count;
+}
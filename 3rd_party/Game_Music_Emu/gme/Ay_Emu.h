@@ -43,6 +43,7 @@ protected:
 	void set_tempo_( double );
 	void set_voice( int, Blip_Buffer*, Blip_Buffer*, Blip_Buffer* );
 	void update_eq( blip_eq_t const& );
+	int voice_states_( voice_state_t*, int ) const;
 private:
 	file_t file;
 	
@@ -1,6 +1,7 @@
 // Blip_Buffer 0.4.1. http://www.slack.net/~ant/
 
 #include "Blip_Buffer.h"
+#include "blargg_common.h"
 
 #include <assert.h>
 #include <limits.h>
@@ -23,6 +24,17 @@ Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA */
 	#include BLARGG_ENABLE_OPTIMIZER
 #endif
 
+// SIMD clamp/interleave for blip_pack_*(); define BLIP_NO_SIMD to use plain C++
+#if !defined (BLIP_NO_SIMD) && INT_MAX == 0x7FFFFFFF
+	#if defined (__SSE2__) || defined (_M_X64) || (defined (_M_IX86_FP) && _M_IX86_FP >= 2)
+		#include <emmintrin.h>
+		#define BLIP_SSE2 1
+	#elif defined (__ARM_NEON) || defined (__ARM_NEON__)
+		#include <arm_neon.h>
+		#define BLIP_NEON 1
+	#endif
+#endif
+
 int const silent_buf_size = 1; // size used for Silent_Blip_Buffer
 
 Blip_Buffer::Blip_Buffer()
@@ -37,6 +49,7 @@ Blip_Buffer::Blip_Buffer()
 	clock_rate_   = 0;
 	bass_freq_    = 16;
 	length_       = 0;
+	fast_synth_   = false;
 	
 	// assumptions code makes about implementation-defined features
 	#ifndef NDEBUG
@@ -53,7 +66,11 @@ Blip_Buffer::Blip_Buffer()
 Blip_Buffer::~Blip_Buffer()
 {
 	if ( buffer_size_ != silent_buf_size )
+	{
+		if ( buffer_ )
+			blargg_track_alloc( -(long) ((buffer_size_ + blip_buffer_extra_) * sizeof *buffer_), 0 );
 		free( buffer_ );
+	}
 }
 
 Silent_Blip_Buffer::Silent_Blip_Buffer()
@@ -100,6 +117,8 @@ Blip_Buffer::blargg_err_t Blip_Buffer::set_sample_rate( long new_rate, int msec
 		void* p = realloc( buffer_, (new_size + blip_buffer_extra_) * sizeof *buffer_ );
 		if ( !p )
 			return "Out of memory";
+		long old_bytes = buffer_ ? (buffer_size_ + blip_buffer_extra_) * (long) sizeof *buffer_ : 0;
+		blargg_track_alloc( (new_size + blip_buffer_extra_) * (long) sizeof *buffer_ - old_bytes, !buffer_ );
 		buffer_ = (buf_t_*) p;
 	}
 	
@@ -212,6 +231,7 @@ Blip_Synth_::Blip_Synth_( short* p, int w ) :
 	buf = 0;
 	last_amp = 0;
 	delta_factor = 0;
+	step_factor = 0;
 }
 
 #undef PI
@@ -376,11 +396,96 @@ void Blip_Synth_::volume_unit( double new_unit )
 			}
 		}
 		delta_factor = (int) floor( factor + 0.5 );
+		step_factor = (int) ((long) delta_factor * kernel_unit);
 		//printf( "delta_factor: %d, kernel_unit: %d\n", delta_factor, kernel_unit );
 	}
 }
 #endif
 
+// Reader output stays well within 24 bits, where this equals saturation
+static inline blip_sample_t blip_clamp( blip_long s )
+{
+	if ( (blip_sample_t) s != s )
+		s = 0x7FFF - (s >> 24);
+	return (blip_sample_t) s;
+}
+
+void blip_pack_samples( blip_sample_t* out, blip_long const* in, long count )
+{
+	long i = 0;
+	#if BLIP_SSE2
+		for ( ; i + 8 <= count; i += 8 )
+		{
+			__m128i a = _mm_loadu_si128( (__m128i const*) (in + i) );
+			__m128i b = _mm_loadu_si128( (__m128i const*) (in + i + 4) );
+			_mm_storeu_si128( (__m128i*) (out + i), _mm_packs_epi32( a, b ) );
+		}
+	#elif BLIP_NEON
+		for ( ; i + 8 <= count; i += 8 )
+		{
+			int16x4_t a = vqmovn_s32( vld1q_s32( in + i ) );
+			int16x4_t b = vqmovn_s32( vld1q_s32( in + i + 4 ) );
+			vst1q_s16( out + i, vcombine_s16( a, b ) );
+		}
+	#endif
+	for ( ; i < count; i++ )
+		out [i] = blip_clamp( in [i] );
+}
+
+void blip_pack_stereo( blip_sample_t* out, blip_long const* left, blip_long const* right, long count )
+{
+	long i = 0;
+	#if BLIP_SSE2
+		for ( ; i + 4 <= count; i += 4 )
+		{
+			__m128i l = _mm_loadu_si128( (__m128i const*) (left  + i) );
+			__m128i r = _mm_loadu_si128( (__m128i const*) (right + i) );
+			__m128i lo = _mm_unpacklo_epi32( l, r );
+			__m128i hi = _mm_unpackhi_epi32( l, r );
+			_mm_storeu_si128( (__m128i*) (out + i * 2), _mm_packs_epi32( lo, hi ) );
+		}
+	#elif BLIP_NEON
+		for ( ; i + 4 <= count; i += 4 )
+		{
+			int16x4x2_t lr;
+			lr.val [0] = vqmovn_s32( vld1q_s32( left  + i ) );
+			lr.val [1] = vqmovn_s32( vld1q_s32( right + i ) );
+			vst2_s16( out + i * 2, lr );
+		}
+	#endif
+	for ( ; i < count; i++ )
+	{
+		out [i * 2    ] = blip_clamp( left  [i] );
+		out [i * 2 + 1] = blip_clamp( right [i] );
+	}
+}
+
+void blip_samples_to_float( float* out, blip_sample_t const* in, long count, float gain )
+{
+	float const scale = gain * (1.0f / 32768);
+	long i = 0;
+	#if BLIP_SSE2
+		__m128 const s = _mm_set1_ps( scale );
+		for ( ; i + 8 <= count; i += 8 )
+		{
+			__m128i x  = _mm_loadu_si128( (__m128i const*) (in + i) );
+			__m128i lo = _mm_srai_epi32( _mm_unpacklo_epi16( x, x ), 16 );
+			__m128i hi = _mm_srai_epi32( _mm_unpackhi_epi16( x, x ), 16 );
+			_mm_storeu_ps( out + i,     _mm_mul_ps( _mm_cvtepi32_ps( lo ), s ) );
+			_mm_storeu_ps( out + i + 4, _mm_mul_ps( _mm_cvtepi32_ps( hi ), s ) );
+		}
+	#elif BLIP_NEON
+		for ( ; i + 8 <= count; i += 8 )
+		{
+			int16x8_t x = vld1q_s16( in + i );
+			vst1q_f32( out + i,     vmulq_n_f32( vcvtq_f32_s32( vmovl_s16( vget_low_s16 ( x ) ) ), scale ) );
+			vst1q_f32( out + i + 4, vmulq_n_f32( vcvtq_f32_s32( vmovl_s16( vget_high_s16( x ) ) ), scale ) );
+		}
+	#endif
+	for ( ; i < count; i++ )
+		out [i] = in [i] * scale;
+}
+
 long Blip_Buffer::read_samples( blip_sample_t* BLIP_RESTRICT out, long max_samples, int stereo )
 {
 	long count = samples_avail();
@@ -394,13 +499,18 @@ long Blip_Buffer::read_samples( blip_sample_t* BLIP_RESTRICT out, long max_sampl
 		
 		if ( !stereo )
 		{
-			for ( blip_long n = count; n; --n )
+			blip_long temp [blip_pack_block];
+			for ( blip_long n = count; n; )
 			{
-				blip_long s = BLIP_READER_READ( reader );
-				if ( (blip_sample_t) s != s )
-					s = 0x7FFF - (s >> 24);
-				*out++ = (blip_sample_t) s;
-				BLIP_READER_NEXT( reader, bass );
+				int block = (n < blip_pack_block ? (int) n : blip_pack_block);
+				for ( int i = 0; i < block; i++ )
+				{
+					temp [i] = BLIP_READER_READ( reader );
+					BLIP_READER_NEXT( reader, bass );
+				}
+				blip_pack_samples( out, temp, block );
+				out += block;
+				n -= block;
 			}
 		}
 		else
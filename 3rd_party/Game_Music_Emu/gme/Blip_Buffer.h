@@ -84,6 +84,13 @@ public:
 	// Mix 'count' samples from 'buf' into buffer.
 	void mix_samples( blip_sample_t const* buf, long count );
 	
+	// Trade band-limiting for speed: Blip_Synth adds each transition to this
+	// buffer as a linearly interpolated step (two samples) instead of its full
+	// impulse, aliasing like BLIP_BUFFER_FAST. For output nobody listens to
+	// closely, such as analysis renders and fast-forward.
+	void set_fast_synth( bool fast = true ) { fast_synth_ = fast; }
+	bool fast_synth() const { return fast_synth_; }
+	
 	// not documented yet
 	void set_modified() { modified_ = 1; }
 	int clear_modified() { int b = modified_; modified_ = 0; return b; }
@@ -112,6 +119,7 @@ public:
 	blip_long buffer_size_;
 	blip_long reader_accum_;
 	int bass_shift_;
+	bool fast_synth_;
 private:
 	long sample_rate_;
 	long clock_rate_;
@@ -165,6 +173,7 @@ private:
 		Blip_Buffer* buf;
 		int last_amp;
 		int delta_factor;
+		int step_factor; // delta_factor times the impulse sum, for fast_synth()
 		
 		void volume_unit( double );
 		Blip_Synth_( short* impulses, int width );
@@ -303,6 +312,20 @@ int const blip_reader_default_bass = 9;
 #define BLIP_READER_END( name, blip_buffer ) \
 	(void) ((blip_buffer).reader_accum_ = name##_reader_accum)
 
+// Clamping is vectorized separately from the (inherently serial) integration:
+// read up to blip_pack_block samples into a blip_long array with BLIP_READER_READ,
+// then saturate them to 16 bits with one of these.
+int const blip_pack_block = 256;
+
+// Saturate count samples to out
+void blip_pack_samples( blip_sample_t* out, blip_long const* in, long count );
+
+// Saturate left and right and interleave them into count stereo frames at out
+void blip_pack_stereo( blip_sample_t* out, blip_long const* left, blip_long const* right, long count );
+
+// Convert count samples to float, with full scale (32768) mapping to gain
+void blip_samples_to_float( float* out, blip_sample_t const* in, long count, float gain );
+
 
 // Compatibility with older version
 const long blip_unscaled = 65535;
@@ -341,6 +364,21 @@ inline void Blip_Synth<quality,range>::offset_resampled( blip_resampled_time_t t
 	// Fails if time is beyond end of Blip_Buffer, due to a bug in caller code or the
 	// need for a longer buffer as set by set_sample_rate().
 	assert( (blip_long) (time >> BLIP_BUFFER_ACCURACY) < blip_buf->buffer_size_ );
+	
+#if !BLIP_BUFFER_FAST
+	if ( blip_buf->fast_synth_ )
+	{
+		// split between the two samples at the middle of the full impulse,
+		// so timing matches the band-limited output
+		blip_long* BLIP_RESTRICT out = blip_buf->buffer_ + (time >> BLIP_BUFFER_ACCURACY);
+		int frac = (int) (time >> (BLIP_BUFFER_ACCURACY - BLIP_PHASE_BITS) & (blip_res - 1));
+		blip_long step  = delta * impl.step_factor;
+		blip_long right = (step >> BLIP_PHASE_BITS) * frac;
+		out [blip_widest_impulse_ / 2 - 1] += step - right;
+		out [blip_widest_impulse_ / 2    ] += right;
+		return;
+	}
+#endif
 	delta *= impl.delta_factor;
 	blip_long* BLIP_RESTRICT buf = blip_buf->buffer_ + (time >> BLIP_BUFFER_ACCURACY);
 	int phase = (int) (time >> (BLIP_BUFFER_ACCURACY - BLIP_PHASE_BITS) & (blip_res - 1));
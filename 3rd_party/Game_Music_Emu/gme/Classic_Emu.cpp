@@ -73,6 +73,35 @@ void Classic_Emu::mute_voices_( int mask )
 	}
 }
 
+void Classic_Emu::set_fast_synth( bool fast )
+{
+	if ( !buf )
+		return;
+	for ( int i = voice_count(); i--; )
+	{
+		Multi_Buffer::channel_t ch = buf->channel( i, (voice_types ? voice_types [i] : 0) );
+		if ( ch.center ) ch.center->set_fast_synth( fast );
+		if ( ch.left   ) ch.left  ->set_fast_synth( fast );
+		if ( ch.right  ) ch.right ->set_fast_synth( fast );
+	}
+}
+
+long Classic_Emu::buffered_samples() const
+{
+	return samples_ahead() + (buf ? buf->samples_avail() : 0);
+}
+
+void Classic_Emu::clear_buffer()
+{
+	if ( buf )
+		buf->clear();
+}
+
+long Classic_Emu::snapshot_lead_() const
+{
+	return buf ? buf->samples_avail() : 0;
+}
+
 void Classic_Emu::change_clock_rate( long rate )
 {
 	clock_rate_ = rate;
@@ -13,6 +13,7 @@ public:
 	Classic_Emu();
 	~Classic_Emu();
 	void set_buffer( Multi_Buffer* );
+	void set_fast_synth( bool fast = true );
 protected:
 	// Services
 	enum { wave_type = 0x100, noise_type = 0x200, mixed_type = wave_type | noise_type };
@@ -21,6 +22,12 @@ protected:
 	long clock_rate() const { return clock_rate_; }
 	void change_clock_rate( long ); // experimental
 	
+	// Number of output samples emulated ahead of what play() has returned
+	long buffered_samples() const;
+	
+	// Discard output not yet returned by play_(), e.g. after loading a snapshot
+	void clear_buffer();
+	
 	// Overridable
 	virtual void set_voice( int index, Blip_Buffer* center,
 			Blip_Buffer* left, Blip_Buffer* right ) = 0;
@@ -32,6 +39,7 @@ protected:
 	void mute_voices_( int );
 	void set_equalizer_( equalizer_t const& );
 	blargg_err_t play_( long, sample_t* );
+	long snapshot_lead_() const;
 private:
 	Multi_Buffer* buf;
 	Multi_Buffer* stereo_buffer; // NULL if using custom buffer
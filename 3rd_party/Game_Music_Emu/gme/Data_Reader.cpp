@@ -6,6 +6,17 @@
 #include <assert.h>
 #include <string.h>
 #include <stdio.h>
+#include <limits.h>
+
+#ifdef _WIN32
+	#define WIN32_LEAN_AND_MEAN
+	#include <windows.h>
+#else
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <fcntl.h>
+	#include <unistd.h>
+#endif
 
 /* Copyright (C) 2005-2006 Shay Green. This module is free software; you
 can redistribute it and/or modify it under the terms of the GNU Lesser
@@ -242,6 +253,95 @@ void Std_File_Reader::close()
 	}
 }
 
+// Mapped_File_Reader
+
+Mapped_File_Reader::Mapped_File_Reader() : begin( 0 ), size_( 0 ), pos( 0 ) { }
+
+Mapped_File_Reader::~Mapped_File_Reader() { close(); }
+
+blargg_err_t Mapped_File_Reader::open( const char* path )
+{
+	close();
+	
+	// the view keeps the file open, so its handles can go right away
+	void* view = 0;
+	long size = 0;
+#ifdef _WIN32
+	HANDLE file = CreateFileA( path, GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING,
+			FILE_ATTRIBUTE_NORMAL, 0 );
+	if ( file == INVALID_HANDLE_VALUE )
+		return "Couldn't open file";
+	LARGE_INTEGER file_size;
+	HANDLE mapping = 0;
+	if ( GetFileSizeEx( file, &file_size ) && file_size.QuadPart > 0 && file_size.QuadPart <= LONG_MAX )
+		mapping = CreateFileMappingA( file, 0, PAGE_READONLY, 0, 0, 0 );
+	CloseHandle( file );
+	if ( mapping )
+	{
+		view = MapViewOfFile( mapping, FILE_MAP_READ, 0, 0, 0 );
+		size = (long) file_size.QuadPart;
+		CloseHandle( mapping );
+	}
+#else
+	int fd = ::open( path, O_RDONLY );
+	if ( fd < 0 )
+		return "Couldn't open file";
+	struct stat st;
+	if ( !fstat( fd, &st ) && st.st_size > 0 && st.st_size <= LONG_MAX )
+	{
+		view = mmap( 0, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0 );
+		if ( view == MAP_FAILED )
+			view = 0;
+		size = (long) st.st_size;
+	}
+	::close( fd );
+#endif
+	if ( !view )
+		return "Couldn't map file";
+	
+	begin = (const char*) view;
+	size_ = size;
+	pos   = 0;
+	return 0;
+}
+
+long Mapped_File_Reader::size() const { return size_; }
+
+long Mapped_File_Reader::read_avail( void* p, long s )
+{
+	long r = remain();
+	if ( s > r )
+		s = r;
+	memcpy( p, begin + pos, s );
+	pos += s;
+	return s;
+}
+
+long Mapped_File_Reader::tell() const { return pos; }
+
+blargg_err_t Mapped_File_Reader::seek( long n )
+{
+	if ( n > size_ )
+		return eof_error;
+	pos = n;
+	return 0;
+}
+
+void Mapped_File_Reader::close()
+{
+	if ( begin )
+	{
+	#ifdef _WIN32
+		UnmapViewOfFile( begin );
+	#else
+		munmap( (void*) begin, size_ );
+	#endif
+		begin = 0;
+		size_ = 0;
+		pos   = 0;
+	}
+}
+
 // Gzip_File_Reader
 
 #ifdef HAVE_ZLIB_H
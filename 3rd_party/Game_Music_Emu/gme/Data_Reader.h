@@ -68,6 +68,29 @@ private:
 	void* file_;
 };
 
+// Disk file mapped read-only into memory, so its pages are only read as
+// data() is used. Fails on empty files and where mapping isn't supported.
+class Mapped_File_Reader : public File_Reader {
+public:
+	blargg_err_t open( const char* path );
+	void close();
+	
+	// Contents of file, or NULL if not open
+	void const* data() const { return begin; }
+	
+public:
+	Mapped_File_Reader();
+	~Mapped_File_Reader();
+	long size() const;
+	long read_avail( void*, long );
+	long tell() const;
+	blargg_err_t seek( long );
+private:
+	const char* begin;
+	long size_;
+	long pos;
+};
+
 // Treats range of memory as a file
 class Mem_File_Reader : public File_Reader {
 public:
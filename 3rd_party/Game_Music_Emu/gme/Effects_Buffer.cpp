@@ -309,75 +309,52 @@ long Effects_Buffer::read_samples( blip_sample_t* out, long total_samples )
 	return total_samples * 2;
 }
 
-void Effects_Buffer::mix_mono( blip_sample_t* out_, blargg_long count )
+void Effects_Buffer::mix_mono( blip_sample_t* out, blargg_long count )
 {
-	blip_sample_t* BLIP_RESTRICT out = out_;
 	int const bass = BLIP_READER_BASS( bufs [0] );
 	BLIP_READER_BEGIN( c, bufs [0] );
 	
-	// unrolled loop
-	for ( blargg_long n = count >> 1; n; --n )
+	blip_long cs [blip_pack_block];
+	while ( count )
 	{
-		blargg_long cs0 = BLIP_READER_READ( c );
-		BLIP_READER_NEXT( c, bass );
-		
-		blargg_long cs1 = BLIP_READER_READ( c );
-		BLIP_READER_NEXT( c, bass );
-		
-		if ( (BOOST::int16_t) cs0 != cs0 )
-			cs0 = 0x7FFF - (cs0 >> 24);
-		((BOOST::uint32_t*) out) [0] = ((BOOST::uint16_t) cs0) | (cs0 << 16);
-		
-		if ( (BOOST::int16_t) cs1 != cs1 )
-			cs1 = 0x7FFF - (cs1 >> 24);
-		((BOOST::uint32_t*) out) [1] = ((BOOST::uint16_t) cs1) | (cs1 << 16);
-		out += 4;
-	}
-	
-	if ( count & 1 )
-	{
-		int s = BLIP_READER_READ( c );
-		BLIP_READER_NEXT( c, bass );
-		out [0] = s;
-		out [1] = s;
-		if ( (BOOST::int16_t) s != s )
+		int block = (count < blip_pack_block ? (int) count : blip_pack_block);
+		for ( int i = 0; i < block; i++ )
 		{
-			s = 0x7FFF - (s >> 24);
-			out [0] = s;
-			out [1] = s;
+			cs [i] = BLIP_READER_READ( c );
+			BLIP_READER_NEXT( c, bass );
 		}
+		blip_pack_stereo( out, cs, cs, block );
+		out += block * 2;
+		count -= block;
 	}
 	
 	BLIP_READER_END( c, bufs [0] );
 }
 
-void Effects_Buffer::mix_stereo( blip_sample_t* out_, blargg_long count )
+void Effects_Buffer::mix_stereo( blip_sample_t* out, blargg_long count )
 {
-	blip_sample_t* BLIP_RESTRICT out = out_;
 	int const bass = BLIP_READER_BASS( bufs [0] );
 	BLIP_READER_BEGIN( c, bufs [0] );
 	BLIP_READER_BEGIN( l, bufs [1] );
 	BLIP_READER_BEGIN( r, bufs [2] );
 	
-	while ( count-- )
+	blip_long left  [blip_pack_block];
+	blip_long right [blip_pack_block];
+	while ( count )
 	{
-		int cs = BLIP_READER_READ( c );
-		BLIP_READER_NEXT( c, bass );
-		int left = cs + BLIP_READER_READ( l );
-		int right = cs + BLIP_READER_READ( r );
-		BLIP_READER_NEXT( l, bass );
-		BLIP_READER_NEXT( r, bass );
-		
-		if ( (BOOST::int16_t) left != left )
-			left = 0x7FFF - (left >> 24);
-		
-		out [0] = left;
-		out [1] = right;
-		
-		out += 2;
-		
-		if ( (BOOST::int16_t) right != right )
-			out [-1] = 0x7FFF - (right >> 24);
+		int block = (count < blip_pack_block ? (int) count : blip_pack_block);
+		for ( int i = 0; i < block; i++ )
+		{
+			int cs = BLIP_READER_READ( c );
+			BLIP_READER_NEXT( c, bass );
+			left  [i] = cs + BLIP_READER_READ( l );
+			right [i] = cs + BLIP_READER_READ( r );
+			BLIP_READER_NEXT( l, bass );
+			BLIP_READER_NEXT( r, bass );
+		}
+		blip_pack_stereo( out, left, right, block );
+		out += block * 2;
+		count -= block;
 	}
 	
 	BLIP_READER_END( r, bufs [2] );
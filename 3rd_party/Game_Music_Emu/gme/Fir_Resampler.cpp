@@ -18,6 +18,21 @@ details. You should have received a copy of the GNU Lesser General Public
 License along with this module; if not, write to the Free Software Foundation,
 Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA */
 
+// SIMD dot products for read(); define FIR_NO_SIMD to use plain C++
+#if !defined (FIR_NO_SIMD) && INT_MAX == 0x7FFFFFFF
+	#if defined (__SSE2__) || defined (_M_X64) || (defined (_M_IX86_FP) && _M_IX86_FP >= 2)
+		#include <emmintrin.h>
+		#define FIR_SSE2 1
+		#if defined (__AVX2__)
+			#include <immintrin.h>
+			#define FIR_AVX2 1
+		#endif
+	#elif defined (__ARM_NEON) || defined (__ARM_NEON__)
+		#include <arm_neon.h>
+		#define FIR_NEON 1
+	#endif
+#endif
+
 #include "blargg_source.h"
 
 #undef PI
@@ -197,3 +212,161 @@ int Fir_Resampler_::skip_input( long count )
 	
 	return count;
 }
+
+// Left and right sums of 'width' taps over interleaved stereo input. The
+// products fit in 32 bits and impulses sum to about 0x7FFF, so 32-bit
+// accumulation gives the same result as the original blargg_long loop.
+static inline void fir_dot( Fir_Resampler_::sample_t const* in,
+		Fir_Resampler_::sample_t const* imp, int width, blargg_long* l_out, blargg_long* r_out )
+{
+	blargg_long l = 0;
+	blargg_long r = 0;
+	int n = width;
+	
+	#if FIR_SSE2
+		// Taps are multiplied in pairs: input l0 r0 l1 r1 is shuffled to
+		// l0 l1 r0 r1 and impulse c0 c1 repeated, so madd sums l0*c0 + l1*c1
+		// in one lane and r0*c0 + r1*c1 in the next
+		__m128i sum = _mm_setzero_si128();
+		#if FIR_AVX2
+		{
+			__m256i const dup = _mm256_setr_epi32( 0, 0, 1, 1, 2, 2, 3, 3 );
+			__m256i sum8 = _mm256_setzero_si256();
+			for ( ; n >= 8; n -= 8 )
+			{
+				__m256i x = _mm256_loadu_si256( (__m256i const*) in );
+				x = _mm256_shufflelo_epi16( x, _MM_SHUFFLE( 3, 1, 2, 0 ) );
+				x = _mm256_shufflehi_epi16( x, _MM_SHUFFLE( 3, 1, 2, 0 ) );
+				__m256i c = _mm256_castsi128_si256( _mm_loadu_si128( (__m128i const*) imp ) );
+				c = _mm256_permutevar8x32_epi32( c, dup );
+				sum8 = _mm256_add_epi32( sum8, _mm256_madd_epi16( x, c ) );
+				in  += 16;
+				imp += 8;
+			}
+			sum = _mm_add_epi32( _mm256_castsi256_si128( sum8 ), _mm256_extracti128_si256( sum8, 1 ) );
+		}
+		#endif
+		for ( ; n >= 8; n -= 8 )
+		{
+			__m128i x0 = _mm_loadu_si128( (__m128i const*) in );
+			__m128i x1 = _mm_loadu_si128( (__m128i const*) (in + 8) );
+			x0 = _mm_shufflelo_epi16( x0, _MM_SHUFFLE( 3, 1, 2, 0 ) );
+			x1 = _mm_shufflelo_epi16( x1, _MM_SHUFFLE( 3, 1, 2, 0 ) );
+			x0 = _mm_shufflehi_epi16( x0, _MM_SHUFFLE( 3, 1, 2, 0 ) );
+			x1 = _mm_shufflehi_epi16( x1, _MM_SHUFFLE( 3, 1, 2, 0 ) );
+			__m128i c = _mm_loadu_si128( (__m128i const*) imp );
+			sum = _mm_add_epi32( sum, _mm_madd_epi16( x0, _mm_unpacklo_epi32( c, c ) ) );
+			sum = _mm_add_epi32( sum, _mm_madd_epi16( x1, _mm_unpackhi_epi32( c, c ) ) );
+			in  += 16;
+			imp += 8;
+		}
+		if ( n >= 4 )
+		{
+			n -= 4;
+			__m128i x = _mm_loadu_si128( (__m128i const*) in );
+			x = _mm_shufflelo_epi16( x, _MM_SHUFFLE( 3, 1, 2, 0 ) );
+			x = _mm_shufflehi_epi16( x, _MM_SHUFFLE( 3, 1, 2, 0 ) );
+			__m128i c = _mm_loadl_epi64( (__m128i const*) imp );
+			c = _mm_unpacklo_epi32( c, c );
+			sum = _mm_add_epi32( sum, _mm_madd_epi16( x, c ) );
+			in  += 8;
+			imp += 4;
+		}
+		// lanes 0 and 2 are left, 1 and 3 right
+		sum = _mm_add_epi32( sum, _mm_shuffle_epi32( sum, _MM_SHUFFLE( 1, 0, 3, 2 ) ) );
+		l = _mm_cvtsi128_si32( sum );
+		r = _mm_cvtsi128_si32( _mm_shuffle_epi32( sum, _MM_SHUFFLE( 1, 1, 1, 1 ) ) );
+	#elif FIR_NEON
+		int32x4_t sum_l = vdupq_n_s32( 0 );
+		int32x4_t sum_r = vdupq_n_s32( 0 );
+		for ( ; n >= 4; n -= 4 )
+		{
+			int16x4x2_t x = vld2_s16( in );
+			int16x4_t c = vld1_s16( imp );
+			sum_l = vmlal_s16( sum_l, x.val [0], c );
+			sum_r = vmlal_s16( sum_r, x.val [1], c );
+			in  += 8;
+			imp += 4;
+		}
+		int32x2_t pair = vpadd_s32(
+				vadd_s32( vget_low_s32( sum_l ), vget_high_s32( sum_l ) ),
+				vadd_s32( vget_low_s32( sum_r ), vget_high_s32( sum_r ) ) );
+		l = vget_lane_s32( pair, 0 );
+		r = vget_lane_s32( pair, 1 );
+	#endif
+	
+	for ( ; n; n -= 2 )
+	{
+		int pt0 = imp [0];
+		l += pt0 * in [0];
+		r += pt0 * in [1];
+		int pt1 = imp [1];
+		imp += 2;
+		l += pt1 * in [2];
+		r += pt1 * in [3];
+		in += 4;
+	}
+	
+	*l_out = l;
+	*r_out = r;
+}
+
+int Fir_Resampler_::read_( sample_t* out_begin, blargg_long count )
+{
+	sample_t* out = out_begin;
+	const sample_t* in = buf.begin();
+	sample_t* end_pos = write_pos;
+	blargg_ulong skip = skip_bits >> imp_phase;
+	sample_t const* imp = impulses + imp_phase * width_;
+	int remain = res - imp_phase;
+	int const width = width_;
+	int const step = this->step;
+	
+	count >>= 1;
+	
+	if ( end_pos - in >= width * stereo )
+	{
+		end_pos -= width * stereo;
+		do
+		{
+			count--;
+			if ( count < 0 )
+				break;
+			
+			// accumulate in extended precision
+			blargg_long l;
+			blargg_long r;
+			fir_dot( in, imp, width, &l, &r );
+			imp += width;
+			
+			remain--;
+			
+			l >>= 15;
+			r >>= 15;
+			
+			in += (skip * stereo) & stereo;
+			skip >>= 1;
+			in += step;
+			
+			if ( !remain )
+			{
+				imp = impulses;
+				skip = skip_bits;
+				remain = res;
+			}
+			
+			out [0] = (sample_t) l;
+			out [1] = (sample_t) r;
+			out += 2;
+		}
+		while ( in <= end_pos );
+	}
+	
+	imp_phase = res - remain;
+	
+	int left = write_pos - in;
+	write_pos = &buf [left];
+	memmove( buf.begin(), in, left * sizeof *in );
+	
+	return out - out_begin;
+}
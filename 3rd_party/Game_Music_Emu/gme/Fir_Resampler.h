@@ -72,6 +72,7 @@ protected:
 	
 	Fir_Resampler_( int width, sample_t* );
 	int avail_( blargg_long input_count ) const;
+	int read_( sample_t* out, blargg_long count );
 };
 
 // Width is number of points in FIR. Must be even and 4 or more. More points give
@@ -97,75 +98,9 @@ inline void Fir_Resampler_::write( long count )
 }
 
 template<int width>
-int Fir_Resampler<width>::read( sample_t* out_begin, blargg_long count )
+inline int Fir_Resampler<width>::read( sample_t* out, blargg_long count )
 {
-	sample_t* out = out_begin;
-	const sample_t* in = buf.begin();
-	sample_t* end_pos = write_pos;
-	blargg_ulong skip = skip_bits >> imp_phase;
-	sample_t const* imp = impulses [imp_phase];
-	int remain = res - imp_phase;
-	int const step = this->step;
-	
-	count >>= 1;
-	
-	if ( end_pos - in >= width * stereo )
-	{
-		end_pos -= width * stereo;
-		do
-		{
-			count--;
-			
-			// accumulate in extended precision
-			blargg_long l = 0;
-			blargg_long r = 0;
-			
-			const sample_t* i = in;
-			if ( count < 0 )
-				break;
-			
-			for ( int n = width / 2; n; --n )
-			{
-				int pt0 = imp [0];
-				l += pt0 * i [0];
-				r += pt0 * i [1];
-				int pt1 = imp [1];
-				imp += 2;
-				l += pt1 * i [2];
-				r += pt1 * i [3];
-				i += 4;
-			}
-			
-			remain--;
-			
-			l >>= 15;
-			r >>= 15;
-			
-			in += (skip * stereo) & stereo;
-			skip >>= 1;
-			in += step;
-			
-			if ( !remain )
-			{
-				imp = impulses [0];
-				skip = skip_bits;
-				remain = res;
-			}
-			
-			out [0] = (sample_t) l;
-			out [1] = (sample_t) r;
-			out += 2;
-		}
-		while ( in <= end_pos );
-	}
-	
-	imp_phase = res - remain;
-	
-	int left = write_pos - in;
-	write_pos = &buf [left];
-	memmove( buf.begin(), in, left * sizeof *in );
-	
-	return out - out_begin;
+	return read_( out, count );
 }
 
 #endif
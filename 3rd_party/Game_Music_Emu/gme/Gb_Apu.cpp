@@ -283,6 +283,24 @@ void Gb_Apu::write_register( blip_time_t time, unsigned addr, int data )
 	}
 }
 
+void Gb_Apu::osc_state( int index, double clock_rate, gme_voice_state_t* out ) const
+{
+	require( (unsigned) index < osc_count );
+	Gb_Osc const& osc = *oscs [index];
+	gme_voice_silent( out );
+	out->clock  = clock_rate;
+	out->active = osc.enabled && osc.volume &&
+			(!(osc.regs [4] & osc.len_enabled_mask) || osc.length);
+	if ( index == 2 )
+		out->volume = osc.volume ? 15 >> (osc.volume - 1) : 0; // wave: output shift
+	else
+		out->volume = osc.volume;
+	
+	// squares step every 4 clocks through 8 duty steps, the wave every 2 through 32 samples
+	if ( out->active && index < 3 )
+		out->period = (2048 - osc.frequency()) * (index < 2 ? 32.0 : 64.0);
+}
+
 int Gb_Apu::read_register( blip_time_t time, unsigned addr )
 {
 	run_until( time );
@@ -5,6 +5,7 @@
 #define GB_APU_H
 
 #include "Gb_Oscs.h"
+#include "Voice_State.h"
 
 class Gb_Apu {
 public:
@@ -50,6 +51,9 @@ public:
 	
 	void set_tempo( double );
 	
+	// State of oscillator 'index' for visualizers, with time in clocks of 'clock_rate'
+	void osc_state( int index, double clock_rate, gme_voice_state_t* out ) const;
+	
 public:
 	Gb_Apu();
 private:
@@ -286,3 +286,10 @@ blargg_err_t Gbs_Emu::run_clocks( blip_time_t& duration, int )
 	
 	return 0;
 }
+
+int Gbs_Emu::voice_states_( voice_state_t* out, int count ) const
+{
+	for ( int i = 0; i < count && i < Gb_Apu::osc_count; i++ )
+		apu.osc_state( i, clock_rate(), &out [i] );
+	return Gb_Apu::osc_count;
+}
@@ -33,6 +33,7 @@ void Gme_File::unload()
 	track_count_     = 0;
 	raw_track_count_ = 0;
 	file_data.clear();
+	file_map.close();
 }
 
 Gme_File::Gme_File()
@@ -40,6 +41,7 @@ Gme_File::Gme_File()
 	type_         = 0;
 	user_data_    = 0;
 	user_cleanup_ = 0;
+	map_files_    = false;
 	unload(); // clears fields
 	blargg_verify_byte_order(); // used by most emulator types, so save them the trouble
 }
@@ -99,6 +101,15 @@ blargg_err_t Gme_File::load( Data_Reader& in )
 blargg_err_t Gme_File::load_file( const char* path )
 {
 	pre_load();
+	if ( map_files_ && !file_map.open( path ) )
+	{
+		// gzipped files still go through GME_FILE_READER
+		byte const* data = (byte const*) file_map.data();
+		if ( file_map.size() < 2 || data [0] != 0x1F || data [1] != 0x8B )
+			return post_load( load_mem_( data, file_map.size() ) );
+		file_map.close();
+	}
+	
 	GME_FILE_READER in;
 	RETURN_ERR( in.open( path ) );
 	return post_load( load_( in ) );
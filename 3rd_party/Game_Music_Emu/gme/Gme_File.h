@@ -20,7 +20,8 @@ public:
 	// file is wrong type or is seriously corrupt. They also set warning
 	// string for minor problems.
 	
-	// Load from file on disk
+	// Load from file on disk. Formats that play from the file's data in place
+	// map the file instead of reading it all in.
 	blargg_err_t load_file( const char* path );
 	
 	// Load from custom data source (see Data_Reader.h)
@@ -79,6 +80,7 @@ protected:
 	void set_track_count( int n )       { track_count_ = raw_track_count_ = n; }
 	void set_warning( const char* s )   { warning_ = s; }
 	void set_type( gme_type_t t )       { type_ = t; }
+	void set_map_files( bool b )        { map_files_ = b; } // if load_mem_() keeps pointers into data
 	blargg_err_t load_remaining_( void const* header, long header_size, Data_Reader& remaining );
 	
 	// Overridable
@@ -92,6 +94,7 @@ protected:
 	
 public:
 	blargg_err_t remap_track_( int* track_io ) const; // need by Music_Emu
+	bool maps_files_() const { return map_files_; } // need by gme_open_file()
 private:
 	// noncopyable
 	Gme_File( const Gme_File& );
@@ -106,6 +109,8 @@ private:
 	M3u_Playlist playlist;
 	char playlist_warning [64];
 	blargg_vector<byte> file_data; // only if loaded into memory using default load
+	Mapped_File_Reader file_map;   // only if loaded from disk with map_files_ set
+	bool map_files_;
 	
 	blargg_err_t load_m3u_( blargg_err_t );
 	blargg_err_t post_load( blargg_err_t err );
@@ -377,3 +377,31 @@ blargg_err_t Gym_Emu::play_( long count, sample_t* out )
 	Dual_Resampler::dual_play( count, out, blip_buf );
 	return 0;
 }
+
+int Gym_Emu::voice_states_( voice_state_t* out, int count ) const
+{
+	// FM 1-6, PCM, PSG (loudest square)
+	int const total = 8;
+	for ( int i = 0; i < count && i < total; i++ )
+	{
+		gme_voice_silent( &out [i] );
+		if ( i < 6 )
+			fm.channel_state( i, base_clock / 7.0, &out [i] );
+	}
+	if ( count > 6 && fm.dac_enabled() )
+	{
+		out [6].volume = 15;
+		out [6].active = true;
+	}
+	if ( count > 7 )
+	{
+		for ( int i = 0; i < apu.osc_count - 1; i++ )
+		{
+			voice_state_t s;
+			apu.osc_state( i, clock_rate, &s );
+			if ( s.active && s.volume > out [7].volume )
+				out [7] = s;
+		}
+	}
+	return total;
+}
@@ -51,6 +51,7 @@ protected:
 	blargg_err_t play_( long count, sample_t* );
 	void mute_voices_( int );
 	void set_tempo_( double );
+	int voice_states_( voice_state_t*, int ) const;
 	int play_frame( blip_time_t blip_time, int sample_count, sample_t* buf );
 private:
 	// sequence data begin, loop begin, current position, end
@@ -300,6 +300,20 @@ void Hes_Apu::write_data( blip_time_t time, int addr, int data )
 	}
 }
 
+void Hes_Apu::osc_state( int index, double clock_rate, gme_voice_state_t* out ) const
+{
+	require( (unsigned) index < osc_count );
+	Hes_Osc const& osc = oscs [index];
+	gme_voice_silent( out );
+	out->clock  = clock_rate;
+	out->volume = (osc.control & 0x1F) >> 1;
+	out->active = (osc.control & 0x80) && out->volume;
+	
+	// 32 wave samples of twice the period each; noise and DAC mode have no pitch
+	if ( out->active && !(osc.noise & 0x80) && !(osc.control & 0x40) && osc.period )
+		out->period = osc.period * 64.0;
+}
+
 void Hes_Apu::end_frame( blip_time_t end_time )
 {
 	Hes_Osc* osc = &oscs [osc_count];
@@ -527,3 +527,10 @@ blargg_err_t Hes_Emu::run_clocks( blip_time_t& duration_, int )
 	
 	return 0;
 }
+
+int Hes_Emu::voice_states_( voice_state_t* out, int count ) const
+{
+	for ( int i = 0; i < count && i < Hes_Apu::osc_count; i++ )
+		apu.osc_state( i, clock_rate(), &out [i] );
+	return Hes_Apu::osc_count;
+}
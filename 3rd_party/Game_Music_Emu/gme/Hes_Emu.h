@@ -42,6 +42,7 @@ protected:
 	void set_tempo_( double );
 	void set_voice( int, Blip_Buffer*, Blip_Buffer*, Blip_Buffer* );
 	void update_eq( blip_eq_t const& );
+	int voice_states_( voice_state_t*, int ) const;
 	void unload();
 public: private: friend class Hes_Cpu;
 	byte* write_pages [page_count + 1]; // 0 if unmapped or I/O space
@@ -412,3 +412,22 @@ blargg_err_t Kss_Emu::run_clocks( blip_time_t& duration, int )
 	
 	return 0;
 }
+
+int Kss_Emu::voice_states_( voice_state_t* out, int count ) const
+{
+	// The first three voices are shared by the AY and the optional SN76489;
+	// report whichever of the two is sounding
+	for ( int i = 0; i < count && i < osc_count; i++ )
+	{
+		int i2 = i - ay.osc_count;
+		if ( i2 >= 0 )
+		{
+			scc.osc_state( i2, clock_rate(), &out [i] );
+			continue;
+		}
+		ay.osc_state( i, clock_rate(), &out [i] );
+		if ( sn && !out [i].active )
+			sn->osc_state( i, clock_rate(), &out [i] );
+	}
+	return osc_count;
+}
@@ -95,3 +95,16 @@ void Scc_Apu::run_until( blip_time_t end_time )
 	}
 	last_time = end_time;
 }
+
+void Scc_Apu::osc_state( int index, double clock_rate, gme_voice_state_t* out ) const
+{
+	require( (unsigned) index < osc_count );
+	gme_voice_silent( out );
+	out->clock  = clock_rate;
+	out->volume = regs [0x8A + index] & 0x0F;
+	out->active = (regs [0x8F] & (1 << index)) && out->volume;
+	
+	// one period per step of the 32-sample wave
+	if ( out->active )
+		out->period = ((regs [0x80 + index * 2 + 1] & 0x0F) * 0x100 + regs [0x80 + index * 2] + 1) * 32.0;
+}
@@ -6,6 +6,7 @@
 
 #include "blargg_common.h"
 #include "Blip_Buffer.h"
+#include "Voice_State.h"
 #include <string.h>
 
 class Scc_Apu {
@@ -38,6 +39,9 @@ public:
 	// Set treble equalization (see documentation)
 	void treble_eq( blip_eq_t const& );
 	
+	// State of oscillator 'index' for visualizers, with time in clocks of 'clock_rate'
+	void osc_state( int index, double clock_rate, gme_voice_state_t* out ) const;
+	
 public:
 	Scc_Apu();
 private:
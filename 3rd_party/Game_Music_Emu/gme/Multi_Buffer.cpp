@@ -148,32 +148,30 @@ long Stereo_Buffer::read_samples( blip_sample_t* out, long count )
 	return count * 2;
 }
 
-void Stereo_Buffer::mix_stereo( blip_sample_t* out_, blargg_long count )
+void Stereo_Buffer::mix_stereo( blip_sample_t* out, blargg_long count )
 {
-	blip_sample_t* BLIP_RESTRICT out = out_;
 	int const bass = BLIP_READER_BASS( bufs [1] );
 	BLIP_READER_BEGIN( left, bufs [1] );
 	BLIP_READER_BEGIN( right, bufs [2] );
 	BLIP_READER_BEGIN( center, bufs [0] );
 	
-	for ( ; count; --count )
+	blip_long l [blip_pack_block];
+	blip_long r [blip_pack_block];
+	while ( count )
 	{
-		int c = BLIP_READER_READ( center );
-		blargg_long l = c + BLIP_READER_READ( left );
-		blargg_long r = c + BLIP_READER_READ( right );
-		if ( (BOOST::int16_t) l != l )
-			l = 0x7FFF - (l >> 24);
-		
-		BLIP_READER_NEXT( center, bass );
-		if ( (BOOST::int16_t) r != r )
-			r = 0x7FFF - (r >> 24);
-		
-		BLIP_READER_NEXT( left, bass );
-		BLIP_READER_NEXT( right, bass );
-		
-		out [0] = l;
-		out [1] = r;
-		out += 2;
+		int block = (count < blip_pack_block ? (int) count : blip_pack_block);
+		for ( int i = 0; i < block; i++ )
+		{
+			int c = BLIP_READER_READ( center );
+			l [i] = c + BLIP_READER_READ( left );
+			r [i] = c + BLIP_READER_READ( right );
+			BLIP_READER_NEXT( center, bass );
+			BLIP_READER_NEXT( left, bass );
+			BLIP_READER_NEXT( right, bass );
+		}
+		blip_pack_stereo( out, l, r, block );
+		out += block * 2;
+		count -= block;
 	}
 	
 	BLIP_READER_END( center, bufs [0] );
@@ -181,51 +179,50 @@ void Stereo_Buffer::mix_stereo( blip_sample_t* out_, blargg_long count )
 	BLIP_READER_END( left, bufs [1] );
 }
 
-void Stereo_Buffer::mix_stereo_no_center( blip_sample_t* out_, blargg_long count )
+void Stereo_Buffer::mix_stereo_no_center( blip_sample_t* out, blargg_long count )
 {
-	blip_sample_t* BLIP_RESTRICT out = out_;
 	int const bass = BLIP_READER_BASS( bufs [1] );
 	BLIP_READER_BEGIN( left, bufs [1] );
 	BLIP_READER_BEGIN( right, bufs [2] );
 	
-	for ( ; count; --count )
+	blip_long l [blip_pack_block];
+	blip_long r [blip_pack_block];
+	while ( count )
 	{
-		blargg_long l = BLIP_READER_READ( left );
-		if ( (BOOST::int16_t) l != l )
-			l = 0x7FFF - (l >> 24);
-		
-		blargg_long r = BLIP_READER_READ( right );
-		if ( (BOOST::int16_t) r != r )
-			r = 0x7FFF - (r >> 24);
-		
-		BLIP_READER_NEXT( left, bass );
-		BLIP_READER_NEXT( right, bass );
-		
-		out [0] = l;
-		out [1] = r;
-		out += 2;
+		int block = (count < blip_pack_block ? (int) count : blip_pack_block);
+		for ( int i = 0; i < block; i++ )
+		{
+			l [i] = BLIP_READER_READ( left );
+			r [i] = BLIP_READER_READ( right );
+			BLIP_READER_NEXT( left, bass );
+			BLIP_READER_NEXT( right, bass );
+		}
+		blip_pack_stereo( out, l, r, block );
+		out += block * 2;
+		count -= block;
 	}
 	
 	BLIP_READER_END( right, bufs [2] );
 	BLIP_READER_END( left, bufs [1] );
 }
 
-void Stereo_Buffer::mix_mono( blip_sample_t* out_, blargg_long count )
+void Stereo_Buffer::mix_mono( blip_sample_t* out, blargg_long count )
 {
-	blip_sample_t* BLIP_RESTRICT out = out_;
 	int const bass = BLIP_READER_BASS( bufs [0] );
 	BLIP_READER_BEGIN( center, bufs [0] );
 	
-	for ( ; count; --count )
+	blip_long c [blip_pack_block];
+	while ( count )
 	{
-		blargg_long s = BLIP_READER_READ( center );
-		if ( (BOOST::int16_t) s != s )
-			s = 0x7FFF - (s >> 24);
-		
-		BLIP_READER_NEXT( center, bass );
-		out [0] = s;
-		out [1] = s;
-		out += 2;
+		int block = (count < blip_pack_block ? (int) count : blip_pack_block);
+		for ( int i = 0; i < block; i++ )
+		{
+			c [i] = BLIP_READER_READ( center );
+			BLIP_READER_NEXT( center, bass );
+		}
+		blip_pack_stereo( out, c, c, block );
+		out += block * 2;
+		count -= block;
 	}
 	
 	BLIP_READER_END( center, bufs [0] );
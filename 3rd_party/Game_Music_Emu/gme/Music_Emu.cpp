@@ -45,6 +45,12 @@ void Music_Emu::unload()
 {
 	voice_count_ = 0;
 	clear_track_vars();
+	clear_snapshots();
+	snapshot_capacity = 0;
+	snapshot_times.clear();
+	snapshot_data.clear();
+	loop_state.clear();
+	loop_head.clear();
 	Gme_File::unload();
 }
 
@@ -61,6 +67,10 @@ Music_Emu::Music_Emu()
 	max_initial_silence = 2;
 	silence_lookahead   = 3;
 	ignore_silence_     = false;
+	snapshot_track      = -1;
+	snapshot_count      = 0;
+	snapshot_capacity   = 0;
+	loop_end            = 0;
 	equalizer_.treble   = -1.0;
 	equalizer_.bass     = 60;
 	
@@ -131,6 +141,8 @@ void Music_Emu::post_load_()
 
 blargg_err_t Music_Emu::start_track( int track )
 {
+	if ( track != current_track_ )
+		clear_loop();
 	clear_track_vars();
 	
 	int remapped = track;
@@ -186,7 +198,23 @@ long Music_Emu::tell() const
 
 blargg_err_t Music_Emu::seek( long msec )
 {
+	// drop what is left of a loop's saved start; the emulator is already past it
+	if ( looping() && loop_head_pos < loop_head.size() )
+	{
+		out_time      = emu_time;
+		loop_head_pos = loop_head.size();
+	}
+	
 	blargg_long time = msec_to_samples( msec );
+	if ( restore_snapshot( time ) )
+	{
+		// play the rest of the way (at most snapshot_interval) in pieces short
+		// enough that skip_() doesn't mute voices, since muted oscillators only
+		// approximate triangle phase and the noise shift register
+		while ( out_time < time )
+			RETURN_ERR( skip( min( (blargg_long) buf_size, time - out_time ) ) );
+		return 0;
+	}
 	if ( time < out_time )
 		RETURN_ERR( start_track( current_track_ ) );
 	return skip( time - out_time );
@@ -245,10 +273,162 @@ blargg_err_t Music_Emu::skip_( long count )
 			n = count;
 		count -= n;
 		RETURN_ERR( play_( n, buf.begin() ) );
+		
+		// emu_time already includes the whole skip
+		record_snapshot( emu_time - count );
 	}
 	return 0;
 }
 
+// Seek snapshots
+
+void Music_Emu::clear_snapshots()
+{
+	snapshot_track = -1;
+	snapshot_count = 0;
+	clear_loop(); // its saved state is from the same timeline
+}
+
+void Music_Emu::record_snapshot( blargg_long time )
+{
+	long const size = snapshot_size_();
+	if ( !size || current_track_ < 0 || emu_track_ended_ )
+		return;
+	
+	if ( snapshot_track != current_track_ )
+	{
+		snapshot_track = current_track_;
+		snapshot_count = 0;
+	}
+	
+	// only extend the index past the furthest point recorded so far
+	time += snapshot_lead_();
+	blargg_long const interval = snapshot_interval * stereo * sample_rate();
+	if ( snapshot_count && time < snapshot_times [snapshot_count - 1] + interval )
+		return;
+	
+	if ( snapshot_count >= snapshot_capacity )
+	{
+		int capacity = snapshot_capacity ? snapshot_capacity * 2 : 64;
+		if ( snapshot_times.resize( capacity ) || snapshot_data.resize( capacity * size ) )
+			return; // keep playing without further snapshots
+		snapshot_capacity = capacity;
+	}
+	
+	snapshot_times [snapshot_count] = time;
+	save_snapshot_( snapshot_data.begin() + snapshot_count * size );
+	snapshot_count++;
+}
+
+bool Music_Emu::restore_snapshot( blargg_long time )
+{
+	if ( snapshot_track != current_track_ || !snapshot_count )
+		return false;
+	
+	// latest snapshot at or before time
+	int lo = 0;
+	int hi = snapshot_count;
+	while ( lo < hi )
+	{
+		int mid = (lo + hi) / 2;
+		if ( snapshot_times [mid] <= time )
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	if ( !lo )
+		return false;
+	
+	blargg_long snapshot_time = snapshot_times [lo - 1];
+	if ( time >= out_time && snapshot_time <= emu_time )
+		return false; // seeking forward from here is no slower
+	
+	load_snapshot_( snapshot_data.begin() + (lo - 1) * snapshot_size_() );
+	out_time         = snapshot_time;
+	emu_time         = snapshot_time;
+	silence_time     = snapshot_time;
+	silence_count    = 0;
+	buf_remain       = 0;
+	emu_track_ended_ = false;
+	track_ended_     = false;
+	return true;
+}
+
+// A-B loop
+
+blargg_err_t Music_Emu::set_loop( long start_msec, long end_msec )
+{
+	require( current_track() >= 0 );
+	clear_loop();
+	long const size = snapshot_size_();
+	if ( !size )
+		return "Looping not supported";
+	if ( end_msec <= start_msec )
+		return "Loop ends before it starts";
+	
+	// The emulator is only ever stopped between frames, ahead of the output
+	// by what it has buffered: save its state there, and play up to it for
+	// the samples in between.
+	RETURN_ERR( seek( start_msec ) );
+	blargg_long const state_time = emu_time + snapshot_lead_();
+	RETURN_ERR( loop_state.resize( size ) );
+	RETURN_ERR( loop_head.resize( state_time - out_time ) );
+	save_snapshot_( loop_state.begin() );
+	loop_start      = out_time;
+	loop_state_time = state_time;
+	RETURN_ERR( play_samples( loop_head.size(), loop_head.begin() ) );
+	
+	loop_end = msec_to_samples( end_msec );
+	if ( loop_end <= loop_state_time )
+		loop_end = loop_state_time + stereo; // shorter than the saved head
+	restart_loop();
+	return 0;
+}
+
+void Music_Emu::clear_loop()
+{
+	loop_end = 0;
+}
+
+void Music_Emu::restart_loop()
+{
+	load_snapshot_( loop_state.begin() );
+	out_time         = loop_start;
+	emu_time         = loop_state_time;
+	silence_time     = loop_state_time;
+	silence_count    = 0;
+	buf_remain       = 0;
+	emu_track_ended_ = false;
+	track_ended_     = false;
+	loop_head_pos    = 0;
+}
+
+blargg_err_t Music_Emu::play( long out_count, sample_t* out )
+{
+	while ( looping() && out_time < loop_end && out_count )
+	{
+		long n = min( out_count, (long) (loop_end - out_time) );
+		if ( loop_head_pos < loop_head.size() )
+		{
+			// the saved head first; the restored emulator carries on after it
+			n = min( n, (long) (loop_head.size() - loop_head_pos) );
+			memcpy( out, &loop_head [loop_head_pos], n * sizeof *out );
+			loop_head_pos += n;
+			out_time += n;
+		}
+		else
+		{
+			RETURN_ERR( play_samples( n, out ) );
+		}
+		out       += n;
+		out_count -= n;
+		
+		if ( out_time >= loop_end )
+			restart_loop();
+	}
+	return out_count ? play_samples( out_count, out ) : 0;
+}
+
 // Fading
 
 void Music_Emu::set_fade( long start_msec, long length_msec )
@@ -326,7 +506,7 @@ void Music_Emu::fill_buf()
 	silence_count += buf_size;
 }
 
-blargg_err_t Music_Emu::play( long out_count, sample_t* out )
+blargg_err_t Music_Emu::play_samples( long out_count, sample_t* out )
 {
 	if ( track_ended_ )
 	{
@@ -393,11 +573,29 @@ blargg_err_t Music_Emu::play( long out_count, sample_t* out )
 		
 		if ( out_time > fade_start )
 			handle_fade( out_count, out );
+		
+		record_snapshot( emu_time );
 	}
 	out_time += out_count;
 	return 0;
 }
 
+blargg_err_t Music_Emu::play_float( long out_count, float* out, float gain )
+{
+	// fade and silence detection work on 16-bit samples, so convert per block
+	// on the way out rather than keeping a whole second output buffer
+	sample_t temp [float_block_size];
+	while ( out_count )
+	{
+		long n = min( out_count, (long) float_block_size );
+		RETURN_ERR( play( n, temp ) );
+		blip_samples_to_float( out, temp, n, gain );
+		out += n;
+		out_count -= n;
+	}
+	return 0;
+}
+
 // Gme_Info_
 
 blargg_err_t Gme_Info_::set_sample_rate_( long )            { return 0; }
@@ -5,6 +5,7 @@
 #define MUSIC_EMU_H
 
 #include "Gme_File.h"
+#include "Voice_State.h"
 class Multi_Buffer;
 
 struct Music_Emu : public Gme_File {
@@ -22,6 +23,9 @@ public:
 	typedef short sample_t;
 	blargg_err_t play( long count, sample_t* buf );
 	
+	// Same as play(), but converted to float with full 16-bit scale at +/- gain
+	blargg_err_t play_float( long count, float* buf, float gain = 1.0f );
+	
 // Informational
 	
 	// Sample rate sound is generated at
@@ -36,17 +40,34 @@ public:
 	// Names of voices
 	const char** voice_names() const;
 	
+	// Current state of each voice (see Voice_State.h), for visualizers. Fills
+	// up to 'count' voices in voice order and returns how many the emulator
+	// reports, 0 if it has no such tap; count = 0 just asks.
+	typedef gme_voice_state_t voice_state_t;
+	int voice_states( voice_state_t* out, int count ) const { return voice_states_( out, count ); }
+	
 // Track status/control
 
 	// Number of milliseconds (1000 msec = 1 second) played since beginning of track
 	long tell() const;
 	
-	// Seek to new time in track. Seeking backwards or far forward can take a while.
+	// Seek to new time in track. Seeking backwards or far forward can take a while,
+	// except on emulators that support seek snapshots (see below).
 	blargg_err_t seek( long msec );
 	
 	// Skip n samples
 	blargg_err_t skip( long n );
 	
+	// Repeat start_msec to end_msec until clear_loop(), jumping back to start_msec
+	// now and each time play() reaches end_msec, within the same call, so nothing
+	// is skipped or heard twice. The state there is saved once, along with the
+	// samples up to where the emulator had run, so each jump restores it rather
+	// than seeking. Only on emulators with seek snapshots; seeking past the end
+	// plays on, and another track or a tempo change clears the loop.
+	blargg_err_t set_loop( long start_msec, long end_msec );
+	void clear_loop();
+	bool looping() const { return loop_end > 0; }
+	
 	// True if a track has reached its end
 	bool track_ended() const;
 	
@@ -82,6 +103,11 @@ public:
 	// on others this has no effect. Should be called only once *before* set_sample_rate().
 	virtual void set_buffer( Multi_Buffer* ) { }
 	
+	// Synthesize with Blip_Buffer::set_fast_synth() on every output buffer, for
+	// renders nobody listens to closely. Only supported by "classic" emulators;
+	// call after loading.
+	virtual void set_fast_synth( bool fast = true ) { }
+	
 // Sound equalization (treble/bass)
 
 	// Frequency equalizer parameters (see gme.txt)
@@ -108,6 +134,7 @@ protected:
 	void set_track_ended()                      { emu_track_ended_ = true; }
 	double gain() const                         { return gain_; }
 	double tempo() const                        { return tempo_; }
+	long samples_ahead() const                  { return emu_time - out_time; } // generated but not yet played
 	void remute_voices();
 	
 	virtual blargg_err_t set_sample_rate_( long sample_rate ) = 0;
@@ -117,6 +144,23 @@ protected:
 	virtual blargg_err_t start_track_( int ) = 0; // tempo is set before this
 	virtual blargg_err_t play_( long count, sample_t* out ) = 0;
 	virtual blargg_err_t skip_( long count );
+	virtual int voice_states_( voice_state_t*, int ) const { return 0; }
+	
+	// Seek snapshots. An emulator that can save and restore its complete state
+	// between play_() calls returns its size from snapshot_size_(); the state is
+	// then recorded every snapshot_interval seconds of the current track as it is
+	// played (muted fast-forwarding is skipped, being inexact), and seek()
+	// restores the closest one at or before the target instead of re-emulating
+	// from the start. snapshot_lead_() is the number of samples generated beyond
+	// what play_() has returned so far; they are discarded by load_snapshot_().
+	// Call clear_snapshots() when recorded state no longer applies (e.g. tempo
+	// change).
+	enum { snapshot_interval = 2 };
+	virtual long snapshot_size_() const             { return 0; }
+	virtual long snapshot_lead_() const             { return 0; }
+	virtual void save_snapshot_( void* out ) const  { }
+	virtual void load_snapshot_( void const* in )   { }
+	void clear_snapshots();
 protected:
 	virtual void unload();
 	virtual void pre_load();
@@ -155,10 +199,30 @@ private:
 	long silence_count;    // number of samples of silence to play before using buf
 	long buf_remain;       // number of samples left in silence buffer
 	enum { buf_size = 2048 };
+	enum { float_block_size = 512 }; // play_float() conversion block, keeps stereo pairs
 	blargg_vector<sample_t> buf;
 	void fill_buf();
 	void emu_play( long count, sample_t* out );
 	
+	// seek snapshots
+	int snapshot_track;               // track the snapshots belong to, -1 if none
+	int snapshot_count;
+	int snapshot_capacity;
+	blargg_vector<blargg_long> snapshot_times; // emu_time of each snapshot, ascending
+	blargg_vector<byte> snapshot_data;          // snapshot_capacity * snapshot_size_() bytes
+	void record_snapshot( blargg_long time );
+	bool restore_snapshot( blargg_long time );
+	
+	// A-B loop
+	blargg_long loop_start;           // out_time of the start
+	blargg_long loop_end;             // 0 if not looping
+	blargg_long loop_state_time;      // emu_time of loop_state, at or after loop_start
+	blargg_vector<byte> loop_state;   // snapshot_size_() bytes
+	blargg_vector<sample_t> loop_head; // output from loop_start to loop_state_time
+	size_t loop_head_pos;             // samples of loop_head played since the jump
+	void restart_loop();
+	blargg_err_t play_samples( long count, sample_t* out ); // play() short of a loop point
+	
 	Multi_Buffer* effects_buffer;
 	friend Music_Emu* gme_new_emu( gme_type_t, long );
 	friend void gme_set_stereo_depth( Music_Emu*, double );
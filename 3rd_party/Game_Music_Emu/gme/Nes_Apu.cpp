@@ -2,6 +2,8 @@
 
 #include "Nes_Apu.h"
 
+#include <string.h>
+
 /* Copyright (C) 2003-2006 Shay Green. This module is free software; you
 can redistribute it and/or modify it under the terms of the GNU Lesser
 General Public License as published by the Free Software Foundation; either
@@ -115,6 +117,129 @@ void Nes_Apu::reset( bool pal_mode, int initial_dmc_dac )
 		dmc.last_amp = initial_dmc_dac; // prevent output transition
 }
 
+// Save/load state
+
+static void save_osc( Nes_Osc const& osc, apu_state_t::osc_t* out )
+{
+	memset( out, 0, sizeof *out );
+	for ( int i = 0; i < 4; i++ )
+	{
+		out->regs [i] = osc.regs [i];
+		out->reg_written [i] = osc.reg_written [i];
+	}
+	out->length_counter = osc.length_counter;
+	out->delay          = osc.delay;
+	out->last_amp       = osc.last_amp;
+}
+
+static void load_osc( apu_state_t::osc_t const& in, Nes_Osc& osc )
+{
+	for ( int i = 0; i < 4; i++ )
+	{
+		osc.regs [i] = in.regs [i];
+		osc.reg_written [i] = in.reg_written [i];
+	}
+	osc.length_counter = in.length_counter;
+	osc.delay          = in.delay;
+	osc.last_amp       = in.last_amp;
+}
+
+void Nes_Apu::save_state( apu_state_t* out ) const
+{
+	save_osc( square1, &out->square1 );
+	out->square1.envelope    = square1.envelope;
+	out->square1.env_delay   = square1.env_delay;
+	out->square1.phase       = square1.phase;
+	out->square1.sweep_delay = square1.sweep_delay;
+	
+	save_osc( square2, &out->square2 );
+	out->square2.envelope    = square2.envelope;
+	out->square2.env_delay   = square2.env_delay;
+	out->square2.phase       = square2.phase;
+	out->square2.sweep_delay = square2.sweep_delay;
+	
+	save_osc( triangle, &out->triangle );
+	out->triangle.phase          = triangle.phase;
+	out->triangle.linear_counter = triangle.linear_counter;
+	
+	save_osc( noise, &out->noise );
+	out->noise.envelope  = noise.envelope;
+	out->noise.env_delay = noise.env_delay;
+	out->noise.noise     = noise.noise;
+	
+	save_osc( dmc, &out->dmc.osc );
+	out->dmc.address     = dmc.address;
+	out->dmc.period      = dmc.period;
+	out->dmc.buf         = dmc.buf;
+	out->dmc.bits_remain = dmc.bits_remain;
+	out->dmc.bits        = dmc.bits;
+	out->dmc.dac         = dmc.dac;
+	out->dmc.next_irq    = dmc.next_irq;
+	out->dmc.buf_full    = dmc.buf_full;
+	out->dmc.silence     = dmc.silence;
+	out->dmc.irq_enabled = dmc.irq_enabled;
+	out->dmc.irq_flag    = dmc.irq_flag;
+	
+	out->last_time     = last_time;
+	out->last_dmc_time = last_dmc_time;
+	out->earliest_irq  = earliest_irq_;
+	out->next_irq      = next_irq;
+	out->frame_period  = frame_period;
+	out->frame_delay   = frame_delay;
+	out->frame         = frame;
+	out->osc_enables   = osc_enables;
+	out->frame_mode    = frame_mode;
+	out->irq_flag      = irq_flag;
+}
+
+void Nes_Apu::load_state( apu_state_t const& in )
+{
+	load_osc( in.square1, square1 );
+	square1.envelope    = in.square1.envelope;
+	square1.env_delay   = in.square1.env_delay;
+	square1.phase       = in.square1.phase;
+	square1.sweep_delay = in.square1.sweep_delay;
+	
+	load_osc( in.square2, square2 );
+	square2.envelope    = in.square2.envelope;
+	square2.env_delay   = in.square2.env_delay;
+	square2.phase       = in.square2.phase;
+	square2.sweep_delay = in.square2.sweep_delay;
+	
+	load_osc( in.triangle, triangle );
+	triangle.phase          = in.triangle.phase;
+	triangle.linear_counter = in.triangle.linear_counter;
+	
+	load_osc( in.noise, noise );
+	noise.envelope  = in.noise.envelope;
+	noise.env_delay = in.noise.env_delay;
+	noise.noise     = in.noise.noise;
+	
+	load_osc( in.dmc.osc, dmc );
+	dmc.address     = in.dmc.address;
+	dmc.period      = in.dmc.period;
+	dmc.buf         = in.dmc.buf;
+	dmc.bits_remain = in.dmc.bits_remain;
+	dmc.bits        = in.dmc.bits;
+	dmc.dac         = in.dmc.dac;
+	dmc.next_irq    = in.dmc.next_irq;
+	dmc.buf_full    = in.dmc.buf_full;
+	dmc.silence     = in.dmc.silence;
+	dmc.irq_enabled = in.dmc.irq_enabled;
+	dmc.irq_flag    = in.dmc.irq_flag;
+	
+	last_time     = in.last_time;
+	last_dmc_time = in.last_dmc_time;
+	earliest_irq_ = in.earliest_irq;
+	next_irq      = in.next_irq;
+	frame_period  = in.frame_period;
+	frame_delay   = in.frame_delay;
+	frame         = in.frame;
+	osc_enables   = in.osc_enables;
+	frame_mode    = in.frame_mode;
+	irq_flag      = in.irq_flag;
+}
+
 void Nes_Apu::irq_changed()
 {
 	nes_time_t new_irq = dmc.next_irq;
@@ -134,6 +259,19 @@ void Nes_Apu::irq_changed()
 
 // frames
 
+int Nes_Apu::osc_volume( int osc ) const
+{
+	switch ( osc )
+	{
+	case 0: return square1.volume();
+	case 1: return square2.volume();
+	case 2: return (triangle.length_counter && triangle.linear_counter) ? 15 : 0;
+	case 3: return noise.volume();
+	case 4: return dmc.dac;
+	}
+	return 0;
+}
+
 void Nes_Apu::run_until( nes_time_t end_time )
 {
 	require( end_time >= last_dmc_time );
@@ -110,6 +110,13 @@ public:
 		if ((unsigned)osc < osc_count) return oscs[osc]->last_amp;
 		return 0;
 	}
+	// Returns current volume from register state, valid even when the
+	// oscillator has no output buffer (last_amp is only updated when synthesizing)
+	int osc_volume( int osc ) const;
+	
+	// Run oscillators and frame counter up to time without ending the frame,
+	// so length counters and envelopes are current at that point
+	void run_to( nes_time_t t ) { if ( t > last_time ) run_until_( t ); }
 	
 public:
 	Nes_Apu();
@@ -155,6 +162,58 @@ private:
 	friend class Nes_Core;
 };
 
+// Exact emulation state, excluding outputs and configuration (tempo, PAL mode,
+// volume, DMC reader). Only meaningful to the same build; not a file format.
+struct apu_state_t
+{
+	struct osc_t
+	{
+		unsigned char regs [4];
+		bool reg_written [4];
+		int length_counter;
+		int delay;
+		int last_amp;
+		int envelope;       // square, noise
+		int env_delay;      // square, noise
+		int phase;          // square, triangle
+		int sweep_delay;    // square
+		int linear_counter; // triangle
+		int noise;          // noise
+	};
+	osc_t square1;
+	osc_t square2;
+	osc_t triangle;
+	osc_t noise;
+	
+	struct dmc_t
+	{
+		osc_t osc;
+		int address;
+		int period;
+		int buf;
+		int bits_remain;
+		int bits;
+		int dac;
+		nes_time_t next_irq;
+		bool buf_full;
+		bool silence;
+		bool irq_enabled;
+		bool irq_flag;
+	};
+	dmc_t dmc;
+	
+	nes_time_t last_time;
+	nes_time_t last_dmc_time;
+	nes_time_t earliest_irq;
+	nes_time_t next_irq;
+	int frame_period;
+	int frame_delay;
+	int frame;
+	int osc_enables;
+	int frame_mode;
+	bool irq_flag;
+};
+
 inline void Nes_Apu::osc_output( int osc, Blip_Buffer* buf )
 {
 	assert( (unsigned) osc < osc_count );
@@ -4,6 +4,7 @@
 
 #include "blargg_endian.h"
 #include <limits.h>
+#include <string.h>
 
 #define BLARGG_CPU_X86 1
 
@@ -62,6 +63,38 @@ int const st_i = 0x04;
 int const st_z = 0x02;
 int const st_c = 0x01;
 
+#if GME_CPU_PROFILE
+void Nes_Cpu::profile_call( nes_addr_t addr, int sp, bool frame )
+{
+	profile_t& p = *profile_;
+	if ( p.depth == profile_t::max_depth )
+	{
+		memmove( p.calls, p.calls + 1, sizeof p.calls [0] * (profile_t::max_depth - 1) );
+		p.depth--;
+	}
+	profile_t::call_t& call = p.calls [p.depth++];
+	call.start = p.clock;
+	call.addr  = (BOOST::uint16_t) addr;
+	call.sp    = (BOOST::uint8_t) sp;
+	call.frame = frame;
+}
+
+void Nes_Cpu::profile_return( int sp, unsigned long long end )
+{
+	// also closes deeper calls a stack trick left behind
+	profile_t& p = *profile_;
+	while ( p.depth && p.calls [p.depth - 1].sp <= sp )
+	{
+		profile_t::call_t const& call = p.calls [--p.depth];
+		unsigned long long length = end - call.start;
+		p.routine_cycles [call.addr] += length;
+		p.routine_calls [call.addr]++;
+		if ( call.frame && p.frame_capacity )
+			p.frame_cycles [p.frames++ % p.frame_capacity] = (unsigned) length;
+	}
+}
+#endif
+
 void Nes_Cpu::reset( void const* unmapped_page )
 {
 	check( state == &state_ );
@@ -77,6 +110,10 @@ void Nes_Cpu::reset( void const* unmapped_page )
 	irq_time_ = future_nes_time;
 	end_time_ = future_nes_time;
 	error_count_ = 0;
+	#if GME_CPU_PROFILE
+		if ( profile_ )
+			profile_->depth = 0;
+	#endif
 	
 	assert( page_size == 0x800 ); // assumes this
 	set_code_page( page_count, unmapped_page );
@@ -160,6 +197,12 @@ bool Nes_Cpu::run( nes_time_t end_time )
 		SET_STATUS( temp );
 	}
 	
+	#if GME_CPU_PROFILE
+		// instruction being counted and the time it started
+		fuint16 prof_pc = pc;
+		nes_time_t prof_time = TIME;
+	#endif
+	
 	goto loop;
 dec_clock_loop:
 	s_time--;
@@ -172,6 +215,17 @@ loop:
 	check( (unsigned) y < 0x100 );
 	check( -32768 <= s_time && s_time < 32767 );
 	
+	#if GME_CPU_PROFILE
+		if ( profile_ )
+		{
+			nes_time_t now = TIME;
+			profile_->pc_cycles [prof_pc] += now - prof_time;
+			profile_->clock += now - prof_time;
+			prof_pc = pc;
+			prof_time = now;
+		}
+	#endif
+	
 	uint8_t const* instr = s.code_map [pc >> page_bits];
 	fuint8 opcode;
 	
@@ -317,6 +371,10 @@ imm##op:
 		WRITE_LOW( 0x100 | (sp - 1), temp >> 8 );
 		sp = (sp - 2) | 0x100;
 		WRITE_LOW( sp, temp );
+		#if GME_CPU_PROFILE
+			if ( profile_ )
+				profile_call( pc, GET_SP(), false );
+		#endif
 		goto loop;
 	}
 	
@@ -372,6 +430,10 @@ imm##op:
 	}
 	
 	case 0x60: // RTS
+		#if GME_CPU_PROFILE
+			if ( profile_ )
+				profile_return( GET_SP(), profile_->clock + 6 );
+		#endif
 		pc = 1 + READ_LOW( sp );
 		pc += 0x100 * READ_LOW( 0x100 | (sp - 0xFF) );
 		sp = (sp - 0xFE) | 0x100;
@@ -846,6 +908,10 @@ imm##op:
 		goto loop;
 		
 	case 0x40:{// RTI
+		#if GME_CPU_PROFILE
+			if ( profile_ )
+				profile_return( GET_SP(), profile_->clock + 6 );
+		#endif
 		fuint8 temp = READ_LOW( sp );
 		pc  = READ_LOW( 0x100 | (sp - 0xFF) );
 		pc |= READ_LOW( 0x100 | (sp - 0xFE) ) * 0x100;
@@ -1041,6 +1107,10 @@ interrupt:
 		if ( result_ )
 			temp |= st_b; // TODO: incorrectly sets B flag for IRQ
 		WRITE_LOW( sp, temp );
+		#if GME_CPU_PROFILE
+			if ( profile_ )
+				profile_call( pc, GET_SP(), false );
+		#endif
 		
 		this->r.status = status |= st_i;
 		blargg_long delta = s.base - end_time_;
@@ -1062,6 +1132,14 @@ out_of_time:
 	
 stop:
 	
+	#if GME_CPU_PROFILE
+		if ( profile_ )
+		{
+			profile_->pc_cycles [prof_pc] += TIME - prof_time;
+			profile_->clock += TIME - prof_time;
+		}
+	#endif
+	
 	s.time = s_time;
 	
 	r.pc = pc;
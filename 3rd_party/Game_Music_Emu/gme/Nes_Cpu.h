@@ -10,6 +10,11 @@ typedef blargg_long nes_time_t; // clock cycle count
 typedef unsigned nes_addr_t; // 16-bit address
 enum { future_nes_time = LONG_MAX / 2 + 1 };
 
+// Hot-address profiler, compiled in with GME_CPU_PROFILE=1 (see set_profile())
+#ifndef GME_CPU_PROFILE
+	#define GME_CPU_PROFILE 0
+#endif
+
 class Nes_Cpu {
 public:
 	typedef BOOST::uint8_t uint8_t;
@@ -63,8 +68,48 @@ public:
 	// CPU invokes bad opcode handler if it encounters this
 	enum { bad_opcode = 0xF2 };
 	
+#if GME_CPU_PROFILE
+	// Cycle counters, in arrays of 0x10000 entries owned by the caller. A call
+	// is a JSR, an interrupt or a profile_call() up to the RTS or RTI that
+	// returns with the stack pointer it entered with; a return to an address
+	// pushed by hand matches none.
+	struct profile_t {
+		unsigned long long* pc_cycles;      // by instruction address
+		unsigned long long* routine_cycles; // inside calls, callees included, by entry address
+		unsigned* routine_calls;
+		unsigned* frame_cycles;             // ring of frame_capacity: cycles of each frame call
+		unsigned frame_capacity;
+		unsigned long long frames;          // frame calls returned
+		unsigned long long clock;           // cycles counted
+		
+		// calls in progress; the outermost is dropped past max_depth
+		enum { max_depth = 64 };
+		struct call_t {
+			unsigned long long start;
+			BOOST::uint16_t addr;
+			BOOST::uint8_t sp;
+			bool frame;
+		};
+		call_t calls [max_depth];
+		int depth;
+	};
+	
+	// Count into 'p' from the next instruction on; NULL (the default) stops
+	void set_profile( profile_t* p )    { profile_ = p; if ( p ) p->depth = 0; }
+	profile_t* profile() const          { return profile_; }
+	
+	// Enter a call made by the caller rather than a JSR (the NSF play
+	// routine), with the stack pointer after its return address was pushed.
+	// A frame call's length is also logged in frame_cycles.
+	void profile_call( nes_addr_t addr, int sp, bool frame );
+#endif
+	
 public:
-	Nes_Cpu() { state = &state_; }
+	Nes_Cpu() { state = &state_;
+	#if GME_CPU_PROFILE
+		profile_ = 0;
+	#endif
+	}
 	enum { page_bits = 11 };
 	enum { page_count = 0x10000 >> page_bits };
 	enum { irq_inhibit = 0x04 };
@@ -81,6 +126,10 @@ private:
 	unsigned long error_count_;
 	
 	void set_code_page( int, void const* );
+#if GME_CPU_PROFILE
+	profile_t* profile_;
+	void profile_return( int sp, unsigned long long end );
+#endif
 	inline int update_end_time( nes_time_t end, nes_time_t irq );
 };
 
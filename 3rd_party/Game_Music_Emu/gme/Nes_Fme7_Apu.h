@@ -40,6 +40,27 @@ public:
 	// (addr & addr_mask) == data_addr
 	void write_data( blip_time_t, int data );
 	
+	// Visualization accessors
+	// 12-bit tone period; the square runs at clock / (32 * period)
+	int osc_period( int osc ) const {
+		if ((unsigned)osc < osc_count) return (regs[osc * 2 + 1] & 0x0F) << 8 | regs[osc * 2];
+		return 0;
+	}
+	int osc_amplitude( int osc ) const {
+		if ((unsigned)osc < osc_count) return oscs[osc].last_amp;
+		return 0;
+	}
+	// Fixed volume (0-15) from reg[8 + osc]
+	int osc_volume( int osc ) const {
+		if ((unsigned)osc < osc_count) return regs[010 + osc] & 0x0F;
+		return 0;
+	}
+	// Tone enabled in the mixer and not in envelope mode, which isn't emulated
+	bool osc_enabled( int osc ) const {
+		if ((unsigned)osc < osc_count) return !(regs[7] >> osc & 1) && !(regs[010 + osc] & 0x10);
+		return false;
+	}
+	
 public:
 	Nes_Fme7_Apu();
 	BLARGG_DISABLE_NOTHROW
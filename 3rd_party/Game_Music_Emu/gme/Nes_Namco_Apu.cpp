@@ -2,6 +2,8 @@
 
 #include "Nes_Namco_Apu.h"
 
+#include <string.h>
+
 /* Copyright (C) 2003-2006 Shay Green. This module is free software; you
 can redistribute it and/or modify it under the terms of the GNU Lesser
 General Public License as published by the Free Software Foundation; either
@@ -30,6 +32,7 @@ void Nes_Namco_Apu::reset()
 	int i;
 	for ( i = 0; i < reg_count; i++ )
 		reg [i] = 0;
+	memset( wave, 0, sizeof wave );
 	
 	for ( i = 0; i < osc_count; i++ )
 	{
@@ -46,6 +49,37 @@ void Nes_Namco_Apu::output( Blip_Buffer* buf )
 		osc_output( i, buf );
 }
 
+void Nes_Namco_Apu::save_state( namco_state_t* out ) const
+{
+	out->addr = addr_reg;
+	out->unused = 0;
+	for ( int r = 0; r < reg_count; r++ )
+		out->regs [r] = reg [r];
+	
+	for ( int i = 0; i < osc_count; i++ )
+	{
+		out->positions [i] = oscs [i].wave_pos;
+		out->delays [i] = oscs [i].delay;
+	}
+}
+
+void Nes_Namco_Apu::load_state( namco_state_t const& in )
+{
+	reset();
+	addr_reg = in.addr;
+	for ( int r = 0; r < reg_count; r++ )
+	{
+		reg [r] = in.regs [r];
+		unpack_wave( r );
+	}
+	
+	for ( int i = 0; i < osc_count; i++ )
+	{
+		oscs [i].wave_pos = in.positions [i];
+		oscs [i].delay = in.delays [i];
+	}
+}
+
 /*
 void Nes_Namco_Apu::reflect_state( Tagged_Data& data )
 {
@@ -110,29 +144,40 @@ void Nes_Namco_Apu::run_until( blip_time_t nes_end_time )
 			
 			int last_amp = osc.last_amp;
 			int wave_pos = osc.wave_pos;
+			const BOOST::uint8_t* wave_data = &wave [osc_reg [6]];
+			blargg_long count = (end_time - time + period - 1) / period;
 			
 			do
 			{
-				// read wave sample
-				int addr = wave_pos + osc_reg [6];
-				int sample = reg [addr >> 1] >> (addr << 2 & 4);
-				wave_pos++;
-				sample = (sample & 15) * volume;
+				// steps until the wave wraps; one if a smaller size left
+				// the position past the end
+				blargg_long n = wave_size - wave_pos;
+				if ( n <= 0 )
+					n = 1;
+				if ( n > count )
+					n = count;
+				count -= n;
 				
-				// output impulse if amplitude changed
-				int delta = sample - last_amp;
-				if ( delta )
+				const BOOST::uint8_t* in = wave_data + wave_pos;
+				wave_pos += n;
+				do
 				{
-					last_amp = sample;
-					synth.offset_resampled( time, delta, output );
+					// output impulse if amplitude changed
+					int sample = *in++ * volume;
+					int delta = sample - last_amp;
+					if ( delta )
+					{
+						last_amp = sample;
+						synth.offset_resampled( time, delta, output );
+					}
+					time += period;
 				}
+				while ( --n );
 				
-				// next sample
-				time += period;
 				if ( wave_pos >= wave_size )
 					wave_pos = 0;
 			}
-			while ( time < end_time );
+			while ( count );
 			
 			osc.wave_pos = wave_pos;
 			osc.last_amp = last_amp;
@@ -29,10 +29,29 @@ public:
 	enum { addr_reg_addr = 0xF800 };
 	void write_addr( int );
 	
-	// to do: implement save/restore
 	void save_state( namco_state_t* out ) const;
 	void load_state( namco_state_t const& );
 	
+	// Visualization accessors
+	// Only the last active_osc_count() oscillators are clocked
+	int active_osc_count() const { return (reg[0x7F] >> 4 & 7) + 1; }
+	// Clocks per waveform cycle, 0 when the oscillator is stopped or too slow to run
+	int osc_period( int osc ) const;
+	int osc_amplitude( int osc ) const {
+		if ((unsigned)osc < osc_count) return oscs[osc].last_amp;
+		return 0;
+	}
+	int osc_volume( int osc ) const {
+		if ((unsigned)osc < osc_count) return reg[osc * 8 + 0x47] & 15;
+		return 0;
+	}
+	// In the active range and keyed on
+	bool osc_enabled( int osc ) const {
+		if ((unsigned)osc < osc_count)
+			return osc >= osc_count - active_osc_count() && (reg[osc * 8 + 0x44] & 0xE0) != 0;
+		return false;
+	}
+	
 public:
 	Nes_Namco_Apu();
 	BLARGG_DISABLE_NOTHROW
@@ -55,12 +74,15 @@ private:
 	
 	enum { reg_count = 0x80 };
 	BOOST::uint8_t reg [reg_count];
+	// reg [] unpacked to one nybble per byte, twice over so that
+	// offset + position never needs wrapping at 256
+	BOOST::uint8_t wave [reg_count * 4];
 	Blip_Synth<blip_good_quality,15> synth;
 	
 	BOOST::uint8_t& access();
+	void unpack_wave( int addr );
 	void run_until( blip_time_t );
 };
-/*
 struct namco_state_t
 {
 	BOOST::uint8_t regs [0x80];
@@ -69,7 +91,6 @@ struct namco_state_t
 	BOOST::uint8_t positions [8];
 	BOOST::uint32_t delays [8];
 };
-*/
 
 inline BOOST::uint8_t& Nes_Namco_Apu::access()
 {
@@ -93,10 +114,34 @@ inline void Nes_Namco_Apu::osc_output( int i, Blip_Buffer* buf )
 	oscs [i].output = buf;
 }
 
+inline int Nes_Namco_Apu::osc_period( int osc ) const
+{
+	// Same terms as run_until(): 983040 / freq * active clocks per wave step
+	if ( !osc_enabled( osc ) )
+		return 0;
+	const BOOST::uint8_t* osc_reg = &reg [osc * 8 + 0x40];
+	blargg_long freq = (osc_reg [4] & 3) * 0x10000 + osc_reg [2] * 0x100L + osc_reg [0];
+	int active_oscs = active_osc_count();
+	if ( freq < 64 * active_oscs )
+		return 0;
+	int wave_size = 32 - (osc_reg [4] >> 2 & 7) * 4;
+	return (int) (983040L * active_oscs / freq * wave_size);
+}
+
+inline void Nes_Namco_Apu::unpack_wave( int addr )
+{
+	int data = reg [addr];
+	BOOST::uint8_t* out = &wave [addr * 2];
+	out [0] = out [reg_count * 2    ] = data & 15;
+	out [1] = out [reg_count * 2 + 1] = data >> 4;
+}
+
 inline void Nes_Namco_Apu::write_data( blip_time_t time, int data )
 {
 	run_until( time );
-	access() = data;
+	BOOST::uint8_t& r = access();
+	r = data;
+	unpack_wave( &r - reg );
 }
 
 #endif
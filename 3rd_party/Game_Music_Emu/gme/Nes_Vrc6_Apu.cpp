@@ -106,7 +106,23 @@ void Nes_Vrc6_Apu::run_square( Vrc6_Osc& osc, blip_time_t end_time )
 {
 	Blip_Buffer* output = osc.output;
 	if ( !output )
+	{
+		// muted: keep the phase going without synthesizing
+		blip_time_t time = last_time + osc.delay;
+		int period = osc.period();
+		osc.delay = 0;
+		if ( (osc.regs [0] & 15) && (osc.regs [2] & 0x80) && !(osc.regs [0] & 0x80) && period > 4 )
+		{
+			if ( time < end_time )
+			{
+				int count = (end_time - time + period - 1) / period;
+				osc.phase = (osc.phase + count) & 15;
+				time += count * period;
+			}
+			osc.delay = time - end_time;
+		}
 		return;
+	}
 	output->set_modified();
 	
 	int volume = osc.regs [0] & 15;
@@ -159,10 +175,10 @@ void Nes_Vrc6_Apu::run_square( Vrc6_Osc& osc, blip_time_t end_time )
 void Nes_Vrc6_Apu::run_saw( blip_time_t end_time )
 {
 	Vrc6_Osc& osc = oscs [2];
+	// muted (no output): the accumulator still runs, only synthesis is skipped
 	Blip_Buffer* output = osc.output;
-	if ( !output )
-		return;
-	output->set_modified();
+	if ( output )
+		output->set_modified();
 	
 	int amp = osc.amp;
 	int amp_step = osc.regs [0] & 0x3F;
@@ -173,7 +189,8 @@ void Nes_Vrc6_Apu::run_saw( blip_time_t end_time )
 		osc.delay = 0;
 		int delta = (amp >> 3) - last_amp;
 		last_amp = amp >> 3;
-		saw_synth.offset( time, delta, output );
+		if ( output )
+			saw_synth.offset( time, delta, output );
 	}
 	else
 	{
@@ -195,7 +212,8 @@ void Nes_Vrc6_Apu::run_saw( blip_time_t end_time )
 				if ( delta )
 				{
 					last_amp = amp >> 3;
-					saw_synth.offset( time, delta, output );
+					if ( output )
+						saw_synth.offset( time, delta, output );
 				}
 				
 				time += period;
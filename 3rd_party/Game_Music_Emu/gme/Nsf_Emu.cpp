@@ -44,6 +44,15 @@ Nsf_Emu::Nsf_Emu()
 	vrc6  = 0;
 	namco = 0;
 	fme7  = 0;
+	write_misc = &Nsf_Emu::write_misc_<0>;
+	trace_func  = 0;
+	trace_data  = 0;
+	trace_clock = 0;
+	write_hook      = 0;
+	write_hook_data = 0;
+	write_clock     = 0;
+	play_hook       = 0;
+	play_hook_data  = 0;
 	
 	set_type( gme_nsf_type );
 	set_silence_lookahead( 6 );
@@ -69,6 +78,7 @@ void Nsf_Emu::unload()
 		fme7  = 0;
 	}
 	#endif
+	write_misc = &Nsf_Emu::write_misc_<0>;
 	
 	rom.clear();
 	Music_Emu::unload();
@@ -153,6 +163,9 @@ void Nsf_Emu::set_tempo_( double t )
 		play_period = long (playback_rate * clock_rate_ / (1000000.0 / clock_divisor * t));
 
 	apu.set_tempo( t );
+	
+	// Recorded positions were on the old tempo's timeline
+	clear_snapshots();
 }
 
 blargg_err_t Nsf_Emu::init_sound()
@@ -256,6 +269,9 @@ blargg_err_t Nsf_Emu::init_sound()
 		if ( namco ) namco->volume( adjusted_gain );
 		if ( vrc6  ) vrc6 ->volume( adjusted_gain );
 		if ( fme7  ) fme7 ->volume( adjusted_gain );
+		
+		write_misc = write_misc_funcs [(namco ? namco_chip : 0) |
+				(vrc6 ? vrc6_chip : 0) | (fme7 ? fme7_chip : 0)];
 	}
 	#endif
 	
@@ -382,44 +398,50 @@ void Nsf_Emu::set_voice( int i, Blip_Buffer* buf, Blip_Buffer*, Blip_Buffer* )
 
 // see nes_cpu_io.h for read/write functions
 
-void Nsf_Emu::cpu_write_misc( nes_addr_t addr, int data )
+template<int chips>
+void Nsf_Emu::write_misc_( nes_addr_t addr, int data )
 {
 	#if !NSF_EMU_APU_ONLY
 	{
-		if ( namco )
+		if ( chips & namco_chip )
 		{
 			switch ( addr )
 			{
 			case Nes_Namco_Apu::data_reg_addr:
+				hook_write( addr, data );
 				namco->write_data( time(), data );
 				return;
 			
 			case Nes_Namco_Apu::addr_reg_addr:
+				hook_write( addr, data );
 				namco->write_addr( data );
 				return;
 			}
 		}
 		
-		if ( addr >= Nes_Fme7_Apu::latch_addr && fme7 )
+		if ( (chips & fme7_chip) && addr >= Nes_Fme7_Apu::latch_addr )
 		{
 			switch ( addr & Nes_Fme7_Apu::addr_mask )
 			{
 			case Nes_Fme7_Apu::latch_addr:
+				hook_write( addr, data );
 				fme7->write_latch( data );
 				return;
 			
 			case Nes_Fme7_Apu::data_addr:
+				hook_write( addr, data );
 				fme7->write_data( time(), data );
 				return;
 			}
 		}
 		
-		if ( vrc6 )
+		if ( chips & vrc6_chip )
 		{
 			unsigned reg = addr & (Nes_Vrc6_Apu::addr_step - 1);
 			unsigned osc = unsigned (addr - Nes_Vrc6_Apu::base_addr) / Nes_Vrc6_Apu::addr_step;
 			if ( osc < Nes_Vrc6_Apu::osc_count && reg < Nes_Vrc6_Apu::reg_count )
 			{
+				hook_write( addr, data );
 				vrc6->write_osc( time(), osc, reg, data );
 				return;
 			}
@@ -445,6 +467,11 @@ void Nsf_Emu::cpu_write_misc( nes_addr_t addr, int data )
 	#endif
 }
 
+Nsf_Emu::write_misc_t const Nsf_Emu::write_misc_funcs [chip_sets] = {
+	&Nsf_Emu::write_misc_<0>, &Nsf_Emu::write_misc_<1>, &Nsf_Emu::write_misc_<2>, &Nsf_Emu::write_misc_<3>,
+	&Nsf_Emu::write_misc_<4>, &Nsf_Emu::write_misc_<5>, &Nsf_Emu::write_misc_<6>, &Nsf_Emu::write_misc_<7>
+};
+
 blargg_err_t Nsf_Emu::start_track_( int track )
 {
 	RETURN_ERR( Classic_Emu::start_track_( track ) );
@@ -471,6 +498,7 @@ blargg_err_t Nsf_Emu::start_track_( int track )
 	play_ready = 4;
 	play_extra = 0;
 	next_play = play_period / clock_divisor;
+	write_clock = 0;
 	
 	saved_state.pc = badop_addr;
 	low_mem [0x1FF] = (badop_addr - 1) >> 8;
@@ -526,7 +554,21 @@ blargg_err_t Nsf_Emu::run_clocks( blip_time_t& duration, int )
 				r.pc = play_addr;
 				low_mem [0x100 + r.sp--] = (badop_addr - 1) >> 8;
 				low_mem [0x100 + r.sp--] = (badop_addr - 1) & 0xFF;
+				#if GME_CPU_PROFILE
+					if ( cpu::profile() )
+						cpu::profile_call( play_addr, r.sp, true );
+				#endif
 				GME_FRAME_HOOK( this );
+				if ( trace_func )
+				{
+					apu.run_to( time() );
+					trace_func( trace_data, (trace_clock + time()) / clock_rate(), *this );
+				}
+				else if ( play_hook )
+				{
+					apu.run_to( time() );
+					play_hook( play_hook_data, write_clock + time(), *this );
+				}
 			}
 		}
 	}
@@ -538,6 +580,7 @@ blargg_err_t Nsf_Emu::run_clocks( blip_time_t& duration, int )
 	}
 	
 	duration = time();
+	write_clock += duration;
 	next_play -= duration;
 	check( next_play >= 0 );
 	if ( next_play < 0 )
@@ -555,3 +598,159 @@ blargg_err_t Nsf_Emu::run_clocks( blip_time_t& duration, int )
 	
 	return 0;
 }
+
+// Seek snapshots
+
+struct nsf_snapshot_t
+{
+	Nes_Cpu::registers_t r;
+	Nes_Cpu::registers_t saved_state;
+	nes_time_t next_play;
+	int play_extra;
+	int play_ready;
+	unsigned long long write_clock;
+	BOOST::uint8_t low_mem [0x800];
+	BOOST::uint8_t sram [0x2000];
+	BOOST::uint8_t banks [8];
+	apu_state_t apu;
+	#if !NSF_EMU_APU_ONLY
+		vrc6_apu_state_t vrc6;
+		fme7_apu_state_t fme7;
+		namco_state_t namco;
+	#endif
+};
+
+long Nsf_Emu::snapshot_size_() const
+{
+	return sizeof (nsf_snapshot_t);
+}
+
+void Nsf_Emu::save_snapshot_( void* out ) const
+{
+	// Taken between play_() calls, so the CPU and sound chips are all at the
+	// start of a time frame
+	nsf_snapshot_t* s = (nsf_snapshot_t*) out;
+	s->r           = cpu::r;
+	s->saved_state = saved_state;
+	s->next_play   = next_play;
+	s->play_extra  = play_extra;
+	s->play_ready  = play_ready;
+	s->write_clock = write_clock;
+	memcpy( s->low_mem, low_mem, sizeof s->low_mem );
+	memcpy( s->sram, sram, sizeof s->sram );
+	memcpy( s->banks, banks, sizeof s->banks );
+	apu.save_state( &s->apu );
+	#if !NSF_EMU_APU_ONLY
+	{
+		if ( vrc6  ) vrc6 ->save_state( &s->vrc6 );
+		if ( fme7  ) fme7 ->save_state( &s->fme7 );
+		if ( namco ) namco->save_state( &s->namco );
+	}
+	#endif
+}
+
+void Nsf_Emu::load_snapshot_( void const* in )
+{
+	nsf_snapshot_t const* s = (nsf_snapshot_t const*) in;
+	cpu::r      = s->r;
+	saved_state = s->saved_state;
+	next_play   = s->next_play;
+	play_extra  = s->play_extra;
+	play_ready  = s->play_ready;
+	write_clock = s->write_clock;
+	memcpy( low_mem, s->low_mem, sizeof low_mem );
+	memcpy( sram, s->sram, sizeof sram );
+	for ( int i = 0; i < bank_count; ++i )
+		cpu_write( bank_select_addr + i, s->banks [i] );
+	apu.load_state( s->apu );
+	#if !NSF_EMU_APU_ONLY
+	{
+		if ( vrc6  ) vrc6 ->load_state( s->vrc6 );
+		if ( fme7  ) fme7 ->load_state( s->fme7 );
+		if ( namco ) namco->load_state( s->namco );
+	}
+	#endif
+	clear_buffer();
+}
+
+// Register trace
+
+blargg_err_t Nsf_Emu::start_trace( int track )
+{
+	RETURN_ERR( start_track( track ) );
+	
+	// Emulator is ahead of tell() by whatever start_track() buffered
+	trace_clock = -(double) buffered_samples() / 2 * clock_rate() / sample_rate();
+	
+	for ( int i = voice_count(); i--; )
+		set_voice( i, 0, 0, 0 );
+	
+	return 0;
+}
+
+blargg_err_t Nsf_Emu::run_trace( long msec, trace_func_t func, void* user_data )
+{
+	trace_func = func;
+	trace_data = user_data;
+	
+	blargg_long const chunk = clock_rate() / 20;
+	double remain = (double) msec * clock_rate() / 1000;
+	blargg_err_t err = 0;
+	while ( remain > 0 && !err )
+	{
+		blip_time_t clocks = (remain < chunk) ? (blip_time_t) remain + 1 : chunk;
+		err = run_clocks( clocks, 0 );
+		trace_clock += clocks;
+		remain -= clocks;
+	}
+	
+	trace_func = 0;
+	trace_data = 0;
+	return err;
+}
+
+double Nsf_Emu::clock_lead( unsigned long long clock ) const
+{
+	// Everything emulated up to write_clock is buffered behind what play() returned
+	return (double) buffered_samples() / 2 -
+			(double) (long long) (write_clock - clock) * sample_rate() / clock_rate();
+}
+
+double Nsf_Emu::play_period_sec() const
+{
+	return (double) play_period / clock_divisor / clock_rate();
+}
+
+double Nsf_Emu::play_period_clocks() const
+{
+	return (double) play_period / clock_divisor;
+}
+
+static unsigned long long hash_bytes( unsigned long long h, void const* p, long n )
+{
+	byte const* in = (byte const*) p;
+	while ( n-- )
+	{
+		h ^= *in++;
+		h *= 0x100000001B3ull;
+	}
+	return h;
+}
+
+unsigned long long Nsf_Emu::trace_state_hash() const
+{
+	unsigned long long h = 0xCBF29CE484222325ull; // FNV-1a
+	h = hash_bytes( h, low_mem, sizeof low_mem );
+	h = hash_bytes( h, sram, sizeof sram );
+	h = hash_bytes( h, banks, sizeof banks );
+	byte regs [8] = {
+		(byte) saved_state.pc, (byte) (saved_state.pc >> 8), saved_state.a, saved_state.x,
+		saved_state.y, saved_state.status, saved_state.sp, (byte) play_extra
+	};
+	return hash_bytes( h, regs, sizeof regs );
+}
+
+void Nsf_Emu::end_trace()
+{
+	remute_voices();
+}
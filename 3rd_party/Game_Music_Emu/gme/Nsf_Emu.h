@@ -53,7 +53,54 @@ public:
 	~Nsf_Emu();
 	Nes_Apu* apu_() { return &apu; }
 	class Nes_Vrc6_Apu* vrc6_() { return vrc6; }
+	class Nes_Fme7_Apu* fme7_() { return fme7; }
+	class Nes_Namco_Apu* namco_() { return namco; }
 	bool has_vrc6() const { return vrc6 != 0; }
+	
+	// Register trace: runs the 6502 and sound chip register state without
+	// synthesizing any audio. start_trace() starts the track as start_track()
+	// does (including initial silence skipping) and then detaches all sound
+	// outputs. run_trace() emulates 'msec' more and invokes 'func', if not
+	// NULL, just before each play routine call. Times are in seconds on the
+	// same timeline as tell(). Call end_trace() before using play() again.
+	typedef void (*trace_func_t)( void* user_data, double time, Nsf_Emu& );
+	blargg_err_t start_trace( int track );
+	blargg_err_t run_trace( long msec, trace_func_t func = 0, void* user_data = 0 );
+	void end_trace();
+	double trace_time() const { return trace_clock / clock_rate(); }
+	// Current play routine period in seconds (tempo applied)
+	double play_period_sec() const;
+	// Same in CPU clocks
+	double play_period_clocks() const;
+	// 64-bit hash of the state the play routine runs from: RAM, SRAM, bank
+	// mapping and the interrupted CPU registers. Inside a trace callback, two
+	// play calls with the same hash (and sound registers) continue identically,
+	// which is how a looping track's period is found.
+	unsigned long long trace_state_hash() const;
+	
+	// Sound register write hook: 'func', if not NULL, is called for every
+	// write the 6502 makes to the APU or an expansion sound chip, with the
+	// CPU clock counted from the start of the track. Runs on whichever thread
+	// calls play() or run_trace(), so it must be cheap and must not block.
+	typedef void (*write_hook_t)( void* user_data, unsigned long long clock, nes_addr_t, int data );
+	void set_write_hook( write_hook_t func, void* user_data ) { write_hook = func; write_hook_data = user_data; }
+	
+	// Play hook: 'func', if not NULL, is called just before each play routine
+	// call made by play(), with the sound chips run up to that point and the
+	// CPU clock counted as the write hook counts it. Same threading rules.
+	typedef void (*play_hook_t)( void* user_data, unsigned long long clock, Nsf_Emu& );
+	void set_play_hook( play_hook_t func, void* user_data ) { play_hook = func; play_hook_data = user_data; }
+	
+#if GME_CPU_PROFILE
+	// 6502 profiler (see Nes_Cpu::profile_t); each play routine call is a
+	// frame call. Same threading rules.
+	void set_cpu_profile( Nes_Cpu::profile_t* p ) { cpu::set_profile( p ); }
+	Nes_Cpu::profile_t* cpu_profile() const { return cpu::profile(); }
+#endif
+	
+	// Between play() calls: how many output frames after the last one play()
+	// returned the sound emulated at 'clock' is heard (negative if already)
+	double clock_lead( unsigned long long clock ) const;
 protected:
 	blargg_err_t track_info_( track_info_t*, int track ) const;
 	blargg_err_t load_( Data_Reader& );
@@ -63,9 +110,13 @@ protected:
 	void set_voice( int, Blip_Buffer*, Blip_Buffer*, Blip_Buffer* );
 	void update_eq( blip_eq_t const& );
 	void unload();
+	long snapshot_size_() const;
+	void save_snapshot_( void* ) const;
+	void load_snapshot_( void const* );
 protected:
 	enum { bank_count = 8 };
 	byte initial_banks [bank_count];
+	byte banks [bank_count]; // currently selected, for snapshots
 	nes_addr_t init_addr;
 	nes_addr_t play_addr;
 	double clock_rate_;
@@ -78,6 +129,23 @@ protected:
 	int play_extra;
 	int play_ready;
 	
+	// register trace
+	trace_func_t trace_func;
+	void* trace_data;
+	double trace_clock; // CPU clocks at start of current run_clocks() call
+	
+	// register write hook
+	write_hook_t write_hook;
+	void* write_hook_data;
+	unsigned long long write_clock; // CPU clocks since track start, at start of current run_clocks() call
+	play_hook_t play_hook;
+	void* play_hook_data;
+	void hook_write( nes_addr_t addr, int data )
+	{
+		if ( write_hook )
+			write_hook( write_hook_data, write_clock + cpu::time(), addr, data );
+	}
+	
 	enum { rom_begin = 0x8000 };
 	enum { bank_select_addr = 0x5FF8 };
 	enum { bank_size = 0x1000 };
@@ -87,9 +155,17 @@ public: private: friend class Nes_Cpu;
 	void cpu_jsr( nes_addr_t );
 	int cpu_read( nes_addr_t );
 	void cpu_write( nes_addr_t, int );
-	void cpu_write_misc( nes_addr_t, int );
+	void cpu_write_misc( nes_addr_t addr, int data ) { (this->*write_misc)( addr, data ); }
 	enum { badop_addr = bank_select_addr };
 	
+	// Expansion register writes, specialised on the file's chip set when
+	// it's loaded so plain 2A03 files skip the chip checks entirely
+	enum { namco_chip = 1, vrc6_chip = 2, fme7_chip = 4, chip_sets = 8 };
+	typedef void (Nsf_Emu::*write_misc_t)( nes_addr_t, int );
+	template<int chips> void write_misc_( nes_addr_t, int );
+	static write_misc_t const write_misc_funcs [chip_sets];
+	write_misc_t write_misc;
+	
 private:
 	class Nes_Namco_Apu* namco;
 	class Nes_Vrc6_Apu*  vrc6;
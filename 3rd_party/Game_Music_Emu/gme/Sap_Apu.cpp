@@ -332,3 +332,19 @@ void Sap_Apu::end_frame( blip_time_t end_time )
 	
 	last_time -= end_time;
 }
+
+void Sap_Apu::osc_state( int index, double clock_rate, gme_voice_state_t* out ) const
+{
+	require( (unsigned) index < osc_count );
+	osc_t const& osc = oscs [index];
+	int const osc_control = osc.regs [1];
+	gme_voice_silent( out );
+	out->clock  = clock_rate;
+	out->volume = osc_control & 0x0F;
+	out->active = out->volume != 0;
+	
+	// only pure tones flip every period; the polynomial distortions and
+	// volume-only (DAC) mode have no steady pitch
+	if ( out->active && !(osc_control & 0x10) && (osc_control & 0xA0) == 0xA0 )
+		out->period = osc.period * 2.0;
+}
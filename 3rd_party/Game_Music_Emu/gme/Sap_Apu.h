@@ -6,6 +6,7 @@
 
 #include "blargg_common.h"
 #include "Blip_Buffer.h"
+#include "Voice_State.h"
 
 class Sap_Apu_Impl;
 
@@ -22,6 +23,9 @@ public:
 	
 	void end_frame( blip_time_t );
 	
+	// State of oscillator 'index' for visualizers, with time in clocks of 'clock_rate'
+	void osc_state( int index, double clock_rate, gme_voice_state_t* out ) const;
+	
 public:
 	Sap_Apu();
 private:
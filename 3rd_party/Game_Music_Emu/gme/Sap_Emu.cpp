@@ -440,3 +440,16 @@ blargg_err_t Sap_Emu::run_clocks( blip_time_t& duration, int )
 	
 	return 0;
 }
+
+int Sap_Emu::voice_states_( voice_state_t* out, int count ) const
+{
+	int const total = Sap_Apu::osc_count << info.stereo;
+	for ( int i = 0; i < count && i < total; i++ )
+	{
+		if ( i < Sap_Apu::osc_count )
+			apu.osc_state( i, clock_rate(), &out [i] );
+		else
+			apu2.osc_state( i - Sap_Apu::osc_count, clock_rate(), &out [i] );
+	}
+	return total;
+}
@@ -37,6 +37,7 @@ protected:
 	void set_tempo_( double );
 	void set_voice( int, Blip_Buffer*, Blip_Buffer*, Blip_Buffer* );
 	void update_eq( blip_eq_t const& );
+	int voice_states_( voice_state_t*, int ) const;
 public: private: friend class Sap_Cpu;
 	int cpu_read( sap_addr_t );
 	void cpu_write( sap_addr_t, int );
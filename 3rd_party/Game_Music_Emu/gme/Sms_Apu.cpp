@@ -294,6 +294,24 @@ static unsigned char const volumes [16] = {
 	64, 50, 39, 31, 24, 19, 15, 12, 9, 7, 5, 4, 3, 2, 1, 0
 };
 
+void Sms_Apu::osc_state( int index, double clock_rate, gme_voice_state_t* out ) const
+{
+	require( (unsigned) index < osc_count );
+	Sms_Osc const& osc = *oscs [index];
+	gme_voice_silent( out );
+	out->clock  = clock_rate;
+	out->volume = (osc.volume * 15 + 63) / 64;
+	out->active = osc.volume != 0;
+	if ( index < 3 )
+	{
+		// half a cycle per period; below 128 it is output as DC
+		int period = squares [index].period;
+		out->active = out->active && period > 128;
+		if ( out->active )
+			out->period = period * 2.0;
+	}
+}
+
 void Sms_Apu::write_data( blip_time_t time, int data )
 {
 	require( (unsigned) data <= 0xFF );
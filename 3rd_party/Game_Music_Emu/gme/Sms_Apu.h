@@ -5,6 +5,7 @@
 #define SMS_APU_H
 
 #include "Sms_Oscs.h"
+#include "Voice_State.h"
 
 class Sms_Apu {
 public:
@@ -41,6 +42,9 @@ public:
 	// Run all oscillators up to specified time, end current frame, then
 	// start a new frame at time 0.
 	void end_frame( blip_time_t );
+	
+	// State of oscillator 'index' for visualizers, with time in clocks of 'clock_rate'
+	void osc_state( int index, double clock_rate, gme_voice_state_t* out ) const;
 
 public:
 	Sms_Apu();
@@ -50,6 +50,9 @@ public:
 	
 	void set_tempo( double );
 	
+	// State of voice 'index' for visualizers (see Spc_Dsp.h)
+	void voice_state( int index, gme_voice_state_t* out ) const { dsp.osc_state( index, out ); }
+	
 public:
 	Snes_Spc();
 	typedef BOOST::uint8_t uint8_t;
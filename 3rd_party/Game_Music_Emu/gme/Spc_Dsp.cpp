@@ -5,6 +5,7 @@
 #include "Spc_Dsp.h"
 
 #include "blargg_endian.h"
+#include <stdlib.h>
 #include <string.h>
 
 /* Copyright (C) 2002 Brad Martin */
@@ -30,6 +31,7 @@ Spc_Dsp::Spc_Dsp( uint8_t* ram_ ) : ram( ram_ )
 	set_gain( 1.0 );
 	mute_voices( 0 );
 	disable_surround( false );
+	memset( brr_cache, 0, sizeof brr_cache );
 	
 	assert( offsetof (globals_t,unused9 [2]) == register_count );
 	assert( sizeof (voice) == register_count );
@@ -60,6 +62,7 @@ void Spc_Dsp::reset()
 		v.volume [0] = 0;
 		v.volume [1] = 0;
 		v.envstate = state_release;
+		v.brr_cached = false;
 	}
 	
 	memset( fir_buf, 0, sizeof fir_buf );
@@ -301,6 +304,92 @@ inline int clamp_16( int n )
 	return n;
 }
 
+// Decode BRR nybble in upper four bits of delta, given block header and the
+// previous two samples
+static inline int decode_brr( int delta, int header, int smp1, int smp2 )
+{
+	// Use sign-extended upper nybble
+	delta = BOOST::int8_t (delta) >> 4;
+	
+	// For invalid ranges (D,E,F): if the nybble is negative,
+	// the result is F000.  If positive, 0000. Nothing else
+	// like previous range, etc seems to have any effect.  If
+	// range is valid, do the shift normally.  Note these are
+	// both shifted right once to do the filters properly, but 
+	// the output will be shifted back again at the end.
+	int shift = header >> 4;
+	delta = (delta << shift) >> 1;
+	if ( shift > 0x0C )
+		delta = (delta >> 14) & ~0x7FF;
+	
+	// One, two and three point IIR filters
+	if ( header & 8 )
+	{
+		delta += smp1;
+		delta -= smp2 >> 1;
+		if ( !(header & 4) )
+		{
+			delta += (-smp1 - (smp1 >> 1)) >> 5;
+			delta += smp2 >> 5;
+		}
+		else
+		{
+			delta += (-smp1 * 13) >> 7;
+			delta += (smp2 + (smp2 >> 1)) >> 4;
+		}
+	}
+	else if ( header & 4 )
+	{
+		delta += smp1 >> 1;
+		delta += (-smp1) >> 5;
+	}
+	
+	return BOOST::int16_t (clamp_16( delta ) * 2); // sign-extend
+}
+
+// True if echo writes can reach the 9-byte block at addr
+static inline bool echo_overlaps( unsigned addr, unsigned echo_start, unsigned echo_size )
+{
+	return ((addr - echo_start) & 0xFFFF) < echo_size ||
+			(echo_size && ((echo_start - addr) & 0xFFFF) < 9);
+}
+
+// Fill brr_voice [vidx] with the block whose header the voice just read, decoding
+// it only if the cache doesn't have it. False if the block must be decoded
+// from ram as it plays instead.
+bool Spc_Dsp::cache_brr( int vidx, unsigned echo_start, unsigned echo_size )
+{
+	voice_t const& voice = voice_state [vidx];
+	unsigned addr = (voice.addr - 1) & 0xFFFF;
+	if ( addr > 0x10000 - 9 || echo_overlaps( addr, echo_start, echo_size ) )
+		return false;
+	
+	uint8_t const* raw = &ram [addr];
+	brr_block_t& block = brr_cache [(addr ^ addr >> 8) & (brr_cache_size - 1)];
+	if ( block.addr != addr || memcmp( block.raw, raw, sizeof block.raw ) ||
+			((raw [0] & 0x0C) && (block.smp [0] != voice.interp0 || block.smp [1] != voice.interp1)) )
+	{
+		block.addr = addr;
+		memcpy( block.raw, raw, sizeof block.raw );
+		block.smp [0] = voice.interp0;
+		block.smp [1] = voice.interp1;
+		int smp1 = voice.interp0;
+		int smp2 = voice.interp1;
+		for ( int i = 0; i < 16; i++ )
+		{
+			int delta = raw [1 + i / 2];
+			if ( i & 1 )
+				delta <<= 4; // use lower nybble
+			int smp = decode_brr( delta, raw [0], smp1, smp2 );
+			block.out [i] = smp;
+			smp2 = smp1;
+			smp1 = smp;
+		}
+	}
+	brr_voice [vidx] = block;
+	return true;
+}
+
 void Spc_Dsp::run( long count, short* out_buf )
 {
 	// to do: make clock_envelope() inline so that this becomes a leaf function?
@@ -324,6 +413,21 @@ void Spc_Dsp::run( long count, short* out_buf )
 	left_volume  *= emu_gain;
 	right_volume *= emu_gain;
 	
+	// Blocks are only read from ram as they play, so cached ones are checked
+	// against what the CPU has written since the last run. Echo writes land
+	// in the middle of a run, so blocks they can reach are never cached.
+	unsigned echo_start = g.echo_page * 0x100;
+	unsigned echo_size = 0;
+	if ( !(g.flags & 0x20) )
+		echo_size = max( (g.echo_delay & 15) * 0x800, echo_ptr + 4 );
+	for ( int i = 0; i < voice_count; i++ )
+	{
+		brr_block_t const& block = brr_voice [i];
+		if ( voice_state [i].brr_cached && (memcmp( block.raw, &ram [block.addr], sizeof block.raw ) ||
+				echo_overlaps( block.addr, echo_start, echo_size )) )
+			voice_state [i].brr_cached = false; // finish it from ram
+	}
+	
 	while ( --count >= 0 )
 	{
 		// Here we check for keys on/off.  Docs say that successive writes
@@ -432,6 +536,7 @@ void Spc_Dsp::run( long count, short* out_buf )
 					
 					voice.block_header = ram [voice.addr++];
 					voice.block_remain = 16; // nybbles
+					voice.brr_cached = cache_brr( vidx, echo_start, echo_size );
 				}
 				
 				// if next block has end flag set, *this* block ends *early* (verified)
@@ -455,55 +560,27 @@ void Spc_Dsp::run( long count, short* out_buf )
 					break;
 				}
 				
-				int delta = ram [voice.addr];
-				if ( voice.block_remain & 1 )
+				int smp;
+				if ( voice.brr_cached )
 				{
-					delta <<= 4; // use lower nybble
-					voice.addr++;
+					voice.addr += voice.block_remain & 1;
+					smp = brr_voice [vidx].out [16 - voice.block_remain];
 				}
-				
-				// Use sign-extended upper nybble
-				delta = int8_t (delta) >> 4;
-				
-				// For invalid ranges (D,E,F): if the nybble is negative,
-				// the result is F000.  If positive, 0000. Nothing else
-				// like previous range, etc seems to have any effect.  If
-				// range is valid, do the shift normally.  Note these are
-				// both shifted right once to do the filters properly, but 
-				// the output will be shifted back again at the end.
-				int shift = voice.block_header >> 4;
-				delta = (delta << shift) >> 1;
-				if ( shift > 0x0C )
-					delta = (delta >> 14) & ~0x7FF;
-				
-				// One, two and three point IIR filters
-				int smp1 = voice.interp0;
-				int smp2 = voice.interp1;
-				if ( voice.block_header & 8 )
+				else
 				{
-					delta += smp1;
-					delta -= smp2 >> 1;
-					if ( !(voice.block_header & 4) )
+					int delta = ram [voice.addr];
+					if ( voice.block_remain & 1 )
 					{
-						delta += (-smp1 - (smp1 >> 1)) >> 5;
-						delta += smp2 >> 5;
+						delta <<= 4; // use lower nybble
+						voice.addr++;
 					}
-					else
-					{
-						delta += (-smp1 * 13) >> 7;
-						delta += (smp2 + (smp2 >> 1)) >> 4;
-					}
-				}
-				else if ( voice.block_header & 4 )
-				{
-					delta += smp1 >> 1;
-					delta += (-smp1) >> 5;
+					smp = decode_brr( delta, voice.block_header, voice.interp0, voice.interp1 );
 				}
 				
 				voice.interp3 = voice.interp2;
-				voice.interp2 = smp2;
-				voice.interp1 = smp1;
-				voice.interp0 = BOOST::int16_t (clamp_16( delta ) * 2); // sign-extend
+				voice.interp2 = voice.interp1;
+				voice.interp1 = voice.interp0;
+				voice.interp0 = smp;
 			}
 			
 			// rate (with possible modulation)
@@ -664,3 +741,19 @@ const BOOST::int16_t Spc_Dsp::gauss [512] =
    0, 434,   0, 430,   0, 426,   0, 422,   0, 418,   0, 414,   0, 410,   0, 405,
    0, 401,   0, 397,   0, 393,   0, 389,   0, 385,   0, 381,   0, 378,   0, 374,
 };
+
+void Spc_Dsp::osc_state( int index, gme_voice_state_t* out ) const
+{
+	assert( (unsigned) index < voice_count );
+	raw_voice_t const& raw_voice = voice [index];
+	voice_t const& v = voice_state [index];
+	int level = max( abs( raw_voice.left_vol ), abs( raw_voice.right_vol ) );
+	gme_voice_silent( out );
+	out->clock  = 440.0;
+	out->volume = (v.envx * level) >> 14; // 11-bit envelope, 7-bit volume
+	out->active = (keys >> index & 1) && v.envstate != state_release && out->volume;
+	
+	int pitch = (raw_voice.rate [1] & 0x3F) * 0x100 + raw_voice.rate [0];
+	if ( out->active && !(g.noise_enables >> index & 1) && pitch )
+		out->period = 4096.0 / pitch;
+}
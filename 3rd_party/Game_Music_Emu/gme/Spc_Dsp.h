@@ -5,6 +5,7 @@
 #define SPC_DSP_H
 
 #include "blargg_common.h"
+#include "Voice_State.h"
 
 class Spc_Dsp {
 	typedef BOOST::int8_t int8_t;
@@ -36,6 +37,11 @@ public:
 	// Run DSP for 'count' samples. Write resulting samples to 'buf' if not NULL.
 	void run( long count, short* buf = NULL );
 	
+	// State of voice 'index' for visualizers. BRR samples have no fixed cycle
+	// length, so the pitch is reported as A-4 at pitch register 0x1000: melodies
+	// keep their shape, but each instrument sits wherever its sample was tuned.
+	void osc_state( int index, gme_voice_state_t* out ) const;
+	
 	
 // End of public interface
 private:
@@ -131,12 +137,28 @@ private:
 		short on_cnt;
 		short enabled; // 7 if enabled, 31 if disabled
 		short envstate;
-		short unused; // pad to power of 2
+		short brr_cached; // current block is played from brr_voice [] rather than ram
 	};
 	
 	voice_t voice_state [voice_count];
 	
+	// Decoded BRR blocks, keyed by address. Since the filters feed back, a
+	// block that uses one also keeps the two samples it was decoded after.
+	// Entries are checked against ram when used, so writes to ram only cost
+	// a miss; an all-zero entry is a valid decoding too.
+	enum { brr_cache_size = 256 }; // power of 2
+	struct brr_block_t {
+		uint8_t raw [9];    // header and data bytes
+		uint8_t unused;
+		unsigned short addr;
+		short smp [2];      // interp0 and interp1 entering the block
+		short out [16];
+	};
+	brr_block_t brr_cache [brr_cache_size];
+	brr_block_t brr_voice [voice_count]; // block each voice is playing, if brr_cached
+	
 	int clock_envelope( int );
+	bool cache_brr( int vidx, unsigned echo_start, unsigned echo_size );
 };
 
 inline void Spc_Dsp::disable_surround( bool disable ) { surround_threshold = disable ? 0 : -0x7FFF; }
@@ -324,3 +324,10 @@ blargg_err_t Spc_Emu::play_( long count, sample_t* out )
 	check( remain == 0 );
 	return 0;
 }
+
+int Spc_Emu::voice_states_( voice_state_t* out, int count ) const
+{
+	for ( int i = 0; i < count && i < Snes_Spc::voice_count; i++ )
+		apu.voice_state( i, &out [i] );
+	return Snes_Spc::voice_count;
+}
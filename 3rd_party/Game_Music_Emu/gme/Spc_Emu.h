@@ -65,6 +65,7 @@ protected:
 	blargg_err_t skip_( long );
 	void mute_voices_( int );
 	void set_tempo_( double );
+	int voice_states_( voice_state_t*, int ) const;
 private:
 	byte const* file_data;
 	long        file_size;
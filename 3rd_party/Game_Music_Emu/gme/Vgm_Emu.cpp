@@ -28,6 +28,7 @@ Vgm_Emu::Vgm_Emu()
 	disable_oversampling_ = false;
 	psg_rate   = 0;
 	set_type( gme_vgm_type );
+	set_map_files( true ); // commands and PCM data are read in place
 	
 	static int const types [8] = {
 		wave_type | 1, wave_type | 0, wave_type | 2, noise_type | 0
@@ -410,3 +411,38 @@ blargg_err_t Vgm_Emu::play_( long count, sample_t* out )
 	Dual_Resampler::dual_play( count, out, blip_buf );
 	return 0;
 }
+
+int Vgm_Emu::voice_states_( voice_state_t* out, int count ) const
+{
+	if ( !uses_fm )
+	{
+		for ( int i = 0; i < count && i < psg.osc_count; i++ )
+			psg.osc_state( i, psg_rate, &out [i] );
+		return psg.osc_count;
+	}
+	
+	// FM 1-6, PCM, PSG (loudest square); YM2413 channels aren't tapped
+	int const total = 8;
+	for ( int i = 0; i < count && i < total; i++ )
+	{
+		gme_voice_silent( &out [i] );
+		if ( i < 6 && ym2612.enabled() )
+			ym2612.channel_state( i, get_le32( header().ym2612_rate ), &out [i] );
+	}
+	if ( count > 6 && ym2612.enabled() && ym2612.dac_enabled() )
+	{
+		out [6].volume = 15;
+		out [6].active = true;
+	}
+	if ( count > 7 )
+	{
+		for ( int i = 0; i < psg.osc_count - 1; i++ )
+		{
+			voice_state_t s;
+			psg.osc_state( i, psg_rate, &s );
+			if ( s.active && s.volume > out [7].volume )
+				out [7] = s;
+		}
+	}
+	return total;
+}
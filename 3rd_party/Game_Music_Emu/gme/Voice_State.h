@@ -0,0 +1,26 @@
+// Oscillator state of one voice, for visualizers
+
+// Game_Music_Emu 0.5.2
+#ifndef VOICE_STATE_H
+#define VOICE_STATE_H
+
+// State of a voice at the end of the last emulated frame. Its pitch is
+// clock / period Hz; period is 0 for voices without one (noise, samples).
+struct gme_voice_state_t
+{
+	double period;  // clocks per waveform cycle
+	double clock;   // rate of those clocks, in Hz
+	int volume;     // 0 (silent) to 15
+	bool active;    // keyed on or enabled, and audible
+};
+
+// Voice with nothing to report
+inline void gme_voice_silent( gme_voice_state_t* out )
+{
+	out->period = 0;
+	out->clock  = 0;
+	out->volume = 0;
+	out->active = false;
+}
+
+#endif
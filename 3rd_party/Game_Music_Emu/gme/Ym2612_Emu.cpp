@@ -36,6 +36,19 @@ Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA */
 	#include BLARGG_ENABLE_OPTIMIZER
 #endif
 
+// SIMD operator counters for the channel update; define YM2612_NO_SIMD to
+// use plain C++
+#if !defined (YM2612_NO_SIMD) && INT_MAX == 0x7FFFFFFF
+	#if defined (__SSE2__) || defined (_M_X64) || (defined (_M_IX86_FP) && _M_IX86_FP >= 2)
+		#include <emmintrin.h>
+		#define YM2612_SSE2 1
+	#elif defined (__ARM_NEON) || defined (__ARM_NEON__)
+		#include <arm_neon.h>
+		#define YM2612_NEON 1
+	#endif
+#endif
+#define YM2612_SIMD (YM2612_SSE2 || YM2612_NEON)
+
 const int output_bits = 14;
 
 struct slot_t
@@ -961,6 +974,42 @@ void Ym2612_Emu::write1( int addr, int data )
 
 void Ym2612_Emu::mute_voices( int mask ) { impl->mute_mask = mask; }
 
+void Ym2612_Emu::channel_state( int index, double clock_rate, gme_voice_state_t* out ) const
+{
+	// Carrier slots of each algorithm, by slot index
+	static unsigned char const carriers [8] = {
+		1 << S3, 1 << S3, 1 << S3, 1 << S3,
+		1 << S1 | 1 << S3,
+		1 << S1 | 1 << S2 | 1 << S3, 1 << S1 | 1 << S2 | 1 << S3,
+		1 << S0 | 1 << S1 | 1 << S2 | 1 << S3
+	};
+	
+	gme_voice_silent( out );
+	if ( !impl || (unsigned) index >= channel_count || (index == 5 && dac_enabled()) )
+		return;
+	
+	channel_t const& ch = impl->YM2612.CHANNEL [index];
+	int level = -1; // lowest total level of a keyed carrier
+	for ( int i = 0; i < 4; i++ )
+	{
+		slot_t const& sl = ch.SLOT [i];
+		if ( (carriers [ch.ALGO & 7] >> i & 1) && sl.Ecurp != RELEASE && (level < 0 || sl.TL < level) )
+			level = sl.TL;
+	}
+	
+	// TL drops 0.75 dB a step; about 3 steps per PSG-like volume step
+	out->clock  = clock_rate / 144;
+	out->volume = level < 0 ? 0 : 15 - (level / 3 < 15 ? level / 3 : 15);
+	out->active = out->volume > 0;
+	
+	// Hz = (fnum << block) * (clock / 144) / 2^21
+	int step = ch.FNUM [0] << ch.FOCT [0];
+	if ( out->active && step )
+		out->period = double (1L << 21) / step;
+}
+
+bool Ym2612_Emu::dac_enabled() const { return impl && impl->YM2612.DAC; }
+
 static void update_envelope_( slot_t* sl )
 {
 	switch ( sl->Ecurp )
@@ -1024,12 +1073,104 @@ static void update_envelope_( slot_t* sl )
 	}
 }
 
+// The four operators of a channel side by side, one 32-bit lane each in SLOT
+// order, so their envelope and phase counters advance together. The sine and
+// TL lookups of the operator graph depend on each other and stay scalar.
+#if YM2612_SSE2
+	typedef __m128i op4_t;
+	
+	static inline op4_t op4_add( op4_t a, op4_t b ) { return _mm_add_epi32( a, b ); }
+	static inline op4_t op4_sub( op4_t a, op4_t b ) { return _mm_sub_epi32( a, b ); }
+	static inline op4_t op4_xor( op4_t a, op4_t b ) { return _mm_xor_si128( a, b ); }
+	static inline op4_t op4_and( op4_t a, op4_t b ) { return _mm_and_si128( a, b ); }
+	static inline op4_t op4_sign( op4_t a ) { return _mm_srai_epi32( a, 31 ); }
+	static inline op4_t op4_env_index( op4_t a ) { return _mm_srai_epi32( a, ENV_LBITS ); }
+	static inline void op4_store( int* out, op4_t a ) { _mm_storeu_si128( (__m128i*) out, a ); }
+	static inline op4_t op4_set( int const* in ) { return _mm_loadu_si128( (__m128i const*) in ); }
+	
+	// Phase step: (lane * freq_LFO) >> (LFO_FMS_LBITS - 1), unsigned like the scalar code
+	static inline op4_t op4_step( op4_t finc, unsigned freq_LFO )
+	{
+		__m128i f = _mm_set1_epi32( (int) freq_LFO );
+		__m128i even = _mm_mul_epu32( finc, f );
+		__m128i odd  = _mm_mul_epu32( _mm_srli_epi64( finc, 32 ), f );
+		__m128i prod = _mm_unpacklo_epi32( _mm_shuffle_epi32( even, _MM_SHUFFLE( 3, 3, 2, 0 ) ),
+				_mm_shuffle_epi32( odd, _MM_SHUFFLE( 3, 3, 2, 0 ) ) );
+		return _mm_srli_epi32( prod, LFO_FMS_LBITS - 1 );
+	}
+	
+	// env_LFO >> AMS per lane. LFO_ENV_TAB stays below 512, so the shift is a
+	// 16-bit high multiply by 1 << (9 - AMS), or 0 for AMS > 9
+	static inline op4_t op4_ams( int const* ams )
+	{
+		int mul [4];
+		for ( int i = 0; i < 4; i++ )
+			mul [i] = ams [i] > 9 ? 0 : 1 << (9 - ams [i]);
+		return op4_set( mul );
+	}
+	static inline op4_t op4_lfo( int env_LFO, op4_t ams )
+	{
+		return _mm_mulhi_epu16( _mm_set1_epi32( env_LFO << 7 ), ams );
+	}
+	
+	// True if a lane of a is at or past b's
+	static inline bool op4_reached( op4_t a, op4_t b )
+	{
+		return _mm_movemask_epi8( _mm_cmplt_epi32( a, b ) ) != 0xFFFF;
+	}
+#elif YM2612_NEON
+	typedef int32x4_t op4_t;
+	
+	static inline op4_t op4_add( op4_t a, op4_t b ) { return vaddq_s32( a, b ); }
+	static inline op4_t op4_sub( op4_t a, op4_t b ) { return vsubq_s32( a, b ); }
+	static inline op4_t op4_xor( op4_t a, op4_t b ) { return veorq_s32( a, b ); }
+	static inline op4_t op4_and( op4_t a, op4_t b ) { return vandq_s32( a, b ); }
+	static inline op4_t op4_sign( op4_t a ) { return vshrq_n_s32( a, 31 ); }
+	static inline op4_t op4_env_index( op4_t a ) { return vshrq_n_s32( a, ENV_LBITS ); }
+	static inline void op4_store( int* out, op4_t a ) { vst1q_s32( out, a ); }
+	static inline op4_t op4_set( int const* in ) { return vld1q_s32( in ); }
+	
+	static inline op4_t op4_step( op4_t finc, unsigned freq_LFO )
+	{
+		uint32x4_t prod = vmulq_n_u32( vreinterpretq_u32_s32( finc ), freq_LFO );
+		return vreinterpretq_s32_u32( vshrq_n_u32( prod, LFO_FMS_LBITS - 1 ) );
+	}
+	
+	// Negated, for a variable right shift
+	static inline op4_t op4_ams( int const* ams ) { return vnegq_s32( vld1q_s32( ams ) ); }
+	static inline op4_t op4_lfo( int env_LFO, op4_t ams ) { return vshlq_s32( vdupq_n_s32( env_LFO ), ams ); }
+	
+	static inline bool op4_reached( op4_t a, op4_t b )
+	{
+		uint32x4_t ge = vcgeq_s32( a, b );
+		uint32x2_t any = vorr_u32( vget_low_u32( ge ), vget_high_u32( ge ) );
+		return (vget_lane_u32( any, 0 ) | vget_lane_u32( any, 1 )) != 0;
+	}
+#endif
+
+#if YM2612_SIMD
+// One field of each slot
+static inline op4_t op4_get( channel_t const& ch, int slot_t::* field )
+{
+	int v [4] = { ch.SLOT [0].*field, ch.SLOT [1].*field, ch.SLOT [2].*field, ch.SLOT [3].*field };
+	return op4_set( v );
+}
+
+static inline void op4_put( op4_t a, channel_t& ch, int slot_t::* field )
+{
+	int v [4];
+	op4_store( v, a );
+	for ( int i = 0; i < 4; i++ )
+		ch.SLOT [i].*field = v [i];
+}
+#else
 inline void update_envelope( slot_t& sl )
 {
 	int ecmp = sl.Ecmp;
 	if ( (sl.Ecnt += sl.Einc) >= ecmp )
 		update_envelope_( &sl );
 }
+#endif
 
 template<int algo>
 struct ym2612_update_chan {
@@ -1059,17 +1200,40 @@ void ym2612_update_chan<algo>::func( tables_t& g, channel_t& ch,
 	
 	int CH_S0_OUT_1 = ch.S0_OUT [1];
 	
+	int YM2612_LFOinc = g.LFOinc;
+	int YM2612_LFOcnt = g.LFOcnt + YM2612_LFOinc;
+	
+#if !YM2612_SIMD
 	int in0 = ch.SLOT [S0].Fcnt;
 	int in1 = ch.SLOT [S1].Fcnt;
 	int in2 = ch.SLOT [S2].Fcnt;
 	int in3 = ch.SLOT [S3].Fcnt;
-	
-	int YM2612_LFOinc = g.LFOinc;
-	int YM2612_LFOcnt = g.LFOcnt + YM2612_LFOinc;
+#endif
 	
 	if ( !not_end )
 		return;
 	
+#if YM2612_SIMD
+	// operator counters, in SLOT order; env_xor and env_max change with the
+	// envelope segment, so they're reloaded along with it
+	op4_t fcnt    = op4_get( ch, &slot_t::Fcnt );
+	op4_t ecnt    = op4_get( ch, &slot_t::Ecnt );
+	op4_t einc    = op4_get( ch, &slot_t::Einc );
+	op4_t ecmp    = op4_get( ch, &slot_t::Ecmp );
+	op4_t env_xor = op4_get( ch, &slot_t::env_xor );
+	op4_t env_max = op4_get( ch, &slot_t::env_max );
+	op4_t const tll  = op4_get( ch, &slot_t::TLL );
+	op4_t const finc = op4_get( ch, &slot_t::Finc );
+	op4_t ams;
+	{
+		int const v [4] = { ch.SLOT [0].AMS, ch.SLOT [1].AMS, ch.SLOT [2].AMS, ch.SLOT [3].AMS };
+		ams = op4_ams( v );
+	}
+	// phase steps for step_freq; without FMS, freq_LFO is always 1 << (LFO_FMS_LBITS - 1)
+	unsigned step_freq = 1L << (LFO_FMS_LBITS - 1);
+	op4_t fstep = op4_step( finc, step_freq );
+#endif
+	
 	do
 	{
 		// envelope
@@ -1077,6 +1241,28 @@ void ym2612_update_chan<algo>::func( tables_t& g, channel_t& ch,
 		
 		short const* const ENV_TAB = g.ENV_TAB;
 		
+	#if YM2612_SIMD
+		int index [4];
+		op4_store( index, op4_env_index( ecnt ) );
+		int const level [4] = {
+			ENV_TAB [index [0]], ENV_TAB [index [1]], ENV_TAB [index [2]], ENV_TAB [index [3]]
+		};
+		op4_t const temp = op4_add( op4_set( level ), tll );
+		int en [4];
+		op4_store( en, op4_and( op4_add( op4_xor( temp, env_xor ), op4_lfo( env_LFO, ams ) ),
+				op4_sign( op4_sub( temp, env_max ) ) ) );
+		int const en0 = en [S0];
+		int const en1 = en [S1];
+		int const en2 = en [S2];
+		int const en3 = en [S3];
+		
+		int in [4];
+		op4_store( in, fcnt );
+		int const in0 = in [S0];
+		int const in1 = in [S1];
+		int const in2 = in [S2];
+		int const in3 = in [S3];
+	#else
 	#define CALC_EN( x ) \
 		int temp##x = ENV_TAB [ch.SLOT [S##x].Ecnt >> ENV_LBITS] + ch.SLOT [S##x].TLL;  \
 		int en##x = ((temp##x ^ ch.SLOT [S##x].env_xor) + (env_LFO >> ch.SLOT [S##x].AMS)) &    \
@@ -1086,6 +1272,7 @@ void ym2612_update_chan<algo>::func( tables_t& g, channel_t& ch,
 		CALC_EN( 1 )
 		CALC_EN( 2 )
 		CALC_EN( 3 )
+	#endif
 		
 		int const* const TL_TAB = g.TL_TAB;
 		
@@ -1159,6 +1346,41 @@ void ym2612_update_chan<algo>::func( tables_t& g, channel_t& ch,
 		CH_OUTd >>= MAX_OUT_BITS - output_bits + 2;
 		
 		// update phase
+	#if YM2612_SIMD
+		if ( ch.FMS )
+		{
+			// the LFO moves on every few samples at most
+			unsigned freq_LFO = ((g.LFO_FREQ_TAB [YM2612_LFOcnt >> LFO_LBITS & LFO_MASK] *
+					ch.FMS) >> (LFO_HBITS - 1 + 1)) + (1L << (LFO_FMS_LBITS - 1));
+			if ( freq_LFO != step_freq )
+			{
+				step_freq = freq_LFO;
+				fstep = op4_step( finc, freq_LFO );
+			}
+		}
+		fcnt = op4_add( fcnt, fstep );
+		YM2612_LFOcnt += YM2612_LFOinc;
+		
+		int t0 = buf [0] + (CH_OUTd & ch.LEFT);
+		int t1 = buf [1] + (CH_OUTd & ch.RIGHT);
+		
+		// envelope segments end rarely; finish those one slot at a time
+		ecnt = op4_add( ecnt, einc );
+		if ( op4_reached( ecnt, ecmp ) )
+		{
+			op4_put( ecnt, ch, &slot_t::Ecnt );
+			for ( int i = 0; i < 4; i++ )
+			{
+				if ( ch.SLOT [i].Ecnt >= ch.SLOT [i].Ecmp )
+					update_envelope_( &ch.SLOT [i] );
+			}
+			ecnt    = op4_get( ch, &slot_t::Ecnt );
+			einc    = op4_get( ch, &slot_t::Einc );
+			ecmp    = op4_get( ch, &slot_t::Ecmp );
+			env_xor = op4_get( ch, &slot_t::env_xor );
+			env_max = op4_get( ch, &slot_t::env_max );
+		}
+	#else
 		unsigned freq_LFO = ((g.LFO_FREQ_TAB [YM2612_LFOcnt >> LFO_LBITS & LFO_MASK] *
 				ch.FMS) >> (LFO_HBITS - 1 + 1)) + (1L << (LFO_FMS_LBITS - 1));
 		YM2612_LFOcnt += YM2612_LFOinc;
@@ -1174,6 +1396,7 @@ void ym2612_update_chan<algo>::func( tables_t& g, channel_t& ch,
 		update_envelope( ch.SLOT [1] );
 		update_envelope( ch.SLOT [2] );
 		update_envelope( ch.SLOT [3] );
+	#endif
 		
 		ch.S0_OUT [0] = CH_S0_OUT_0;
 		buf [0] = t0;
@@ -1184,10 +1407,15 @@ void ym2612_update_chan<algo>::func( tables_t& g, channel_t& ch,
 	
 	ch.S0_OUT [1] = CH_S0_OUT_1;
 	
+#if YM2612_SIMD
+	op4_put( fcnt, ch, &slot_t::Fcnt );
+	op4_put( ecnt, ch, &slot_t::Ecnt );
+#else
 	ch.SLOT [S0].Fcnt = in0;
 	ch.SLOT [S1].Fcnt = in1;
 	ch.SLOT [S2].Fcnt = in2;
 	ch.SLOT [S3].Fcnt = in3;
+#endif
 }
 
 static const ym2612_update_chan_t UPDATE_CHAN [8] = {
@@ -4,6 +4,8 @@
 #ifndef YM2612_EMU_H
 #define YM2612_EMU_H
 
+#include "Voice_State.h"
+
 struct Ym2612_Impl;
 
 class Ym2612_Emu  {
@@ -33,6 +35,14 @@ public:
 	typedef short sample_t;
 	enum { out_chan_count = 2 }; // stereo
 	void run( int pair_count, sample_t* out );
+	
+	// State of channel 'index' for visualizers, given the chip clock passed
+	// to set_rate(). A channel is keyed on while a carrier is; its volume
+	// follows the loudest keyed carrier's total level.
+	void channel_state( int index, double clock_rate, gme_voice_state_t* out ) const;
+	
+	// True while channel 6 plays DAC samples instead of FM
+	bool dac_enabled() const;
 };
 
 #endif
@@ -25,6 +25,11 @@
 	typedef const char* blargg_err_t;
 #endif
 
+// Heap accounting: bytes held in the library's blocks (emulator objects,
+// sample buffers, vectors) and how many blocks were ever allocated. Reported
+// by gme_memory_usage().
+void blargg_track_alloc( long bytes, int blocks );
+
 // blargg_vector - very lightweight vector of POD types (no constructor/destructor)
 template<class T>
 class blargg_vector {
@@ -32,7 +37,7 @@ class blargg_vector {
 	size_t size_;
 public:
 	blargg_vector() : begin_( 0 ), size_( 0 ) { }
-	~blargg_vector() { free( begin_ ); }
+	~blargg_vector() { clear(); }
 	size_t size() const { return size_; }
 	T* begin() const { return begin_; }
 	T* end() const { return begin_ + size_; }
@@ -41,11 +46,19 @@ public:
 		void* p = realloc( begin_, n * sizeof (T) );
 		if ( !p && n )
 			return "Out of memory";
+		blargg_track_alloc( ((long) n - (long) size_) * (long) sizeof (T), !begin_ && n );
 		begin_ = (T*) p;
 		size_ = n;
 		return 0;
 	}
-	void clear() { void* p = begin_; begin_ = 0; size_ = 0; free( p ); }
+	void clear()
+	{
+		void* p = begin_;
+		blargg_track_alloc( -(long) (size_ * sizeof (T)), 0 );
+		begin_ = 0;
+		size_ = 0;
+		free( p );
+	}
 	T& operator [] ( size_t n ) const
 	{
 		assert( n <= size_ ); // <= to allow past-the-end value
@@ -60,8 +73,8 @@ public:
 		#define BLARGG_THROWS( spec ) throw spec
 	#endif
 	#define BLARGG_DISABLE_NOTHROW \
-		void* operator new ( size_t s ) BLARGG_THROWS(()) { return malloc( s ); }\
-		void operator delete ( void* p ) { free( p ); }
+		void* operator new ( size_t s ) BLARGG_THROWS(()) { blargg_track_alloc( (long) s, 1 ); return malloc( s ); }\
+		void operator delete ( void* p, size_t s ) { if ( p ) blargg_track_alloc( -(long) s, 0 ); free( p ); }
 	#define BLARGG_NEW new
 #else
 	#include <new>
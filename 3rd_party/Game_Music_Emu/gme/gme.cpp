@@ -8,6 +8,7 @@
 #include "blargg_endian.h"
 #include <string.h>
 #include <ctype.h>
+#include <atomic>
 
 /* Copyright (C) 2003-2006 Shay Green. This module is free software; you
 can redistribute it and/or modify it under the terms of the GNU Lesser
@@ -155,9 +156,17 @@ gme_err_t gme_open_file( const char* path, Music_Emu** out, long sample_rate )
 	Music_Emu* emu = gme_new_emu( file_type, sample_rate );
 	CHECK_ALLOC( emu );
 	
-	// optimization: avoids seeking/re-reading header
-	Remaining_Reader rem( header, header_size, &in );
-	gme_err_t err = emu->load( rem );
+	gme_err_t err;
+	if ( emu->maps_files_() )
+	{
+		err = emu->load_file( path ); // plays from the mapped file, not a copy
+	}
+	else
+	{
+		// optimization: avoids seeking/re-reading header
+		Remaining_Reader rem( header, header_size, &in );
+		err = emu->load( rem );
+	}
 	in.close();
 	
 	if ( err )
@@ -217,6 +226,25 @@ gme_err_t gme_load_custom( Music_Emu* me, gme_reader_t func, long size, void* da
 
 void gme_delete( Music_Emu* me ) { delete me; }
 
+// Emulators run on several threads at once
+static std::atomic<long> allocated_bytes( 0 );
+static std::atomic<long> allocated_blocks( 0 );
+
+void blargg_track_alloc( long bytes, int blocks )
+{
+	allocated_bytes.fetch_add( bytes, std::memory_order_relaxed );
+	if ( blocks )
+		allocated_blocks.fetch_add( blocks, std::memory_order_relaxed );
+}
+
+void gme_memory_usage( long* bytes, long* blocks )
+{
+	if ( bytes )
+		*bytes = allocated_bytes.load( std::memory_order_relaxed );
+	if ( blocks )
+		*blocks = allocated_blocks.load( std::memory_order_relaxed );
+}
+
 gme_type_t gme_type( Music_Emu const* me ) { return me->type(); }
 
 const char* gme_warning( Music_Emu* me ) { return me->warning(); }
@@ -242,13 +270,17 @@ void      gme_set_user_cleanup(Music_Emu* me, gme_user_cleanup_t func ) { me->se
 
 gme_err_t gme_start_track    ( Music_Emu* me, int index )           { return me->start_track( index ); }
 gme_err_t gme_play           ( Music_Emu* me, long n, short* p )    { return me->play( n, p ); }
+gme_err_t gme_play_float     ( Music_Emu* me, long n, float* p, float gain ) { return me->play_float( n, p, gain ); }
 void      gme_set_fade       ( Music_Emu* me, long start_msec )     { me->set_fade( start_msec ); }
 int       gme_track_ended    ( Music_Emu const* me )                { return me->track_ended(); }
 long      gme_tell           ( Music_Emu const* me )                { return me->tell(); }
 gme_err_t gme_seek           ( Music_Emu* me, long msec )           { return me->seek( msec ); }
+gme_err_t gme_set_loop       ( Music_Emu* me, long start, long end ) { return me->set_loop( start, end ); }
+void      gme_clear_loop     ( Music_Emu* me )                      { me->clear_loop(); }
 int       gme_voice_count    ( Music_Emu const* me )                { return me->voice_count(); }
 void      gme_ignore_silence ( Music_Emu* me, int disable )         { me->ignore_silence( disable != 0 ); }
 void      gme_set_tempo      ( Music_Emu* me, double t )            { me->set_tempo( t ); }
+void      gme_set_fast_synth ( Music_Emu* me, int fast )            { me->set_fast_synth( fast != 0 ); }
 void      gme_mute_voice     ( Music_Emu* me, int index, int mute ) { me->mute_voice( index, mute != 0 ); }
 void      gme_mute_voices    ( Music_Emu* me, int mask )            { me->mute_voices( mask ); }
 void      gme_set_equalizer  ( Music_Emu* me, gme_equalizer_t const* eq ) { me->set_equalizer( *eq ); }
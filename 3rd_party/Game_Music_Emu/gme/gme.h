@@ -29,6 +29,9 @@ gme_err_t gme_start_track( Music_Emu*, int index );
 /* Generate 'count' 16-bit signed samples info 'out'. Output is in stereo. */
 gme_err_t gme_play( Music_Emu*, long count, short* out );
 
+/* Same as gme_play(), but as 32-bit float samples where full 16-bit scale is +/- gain */
+gme_err_t gme_play_float( Music_Emu*, long count, float* out, float gain );
+
 /* Finish using emulator and free memory */
 void gme_delete( Music_Emu* );
 
@@ -48,6 +51,11 @@ long gme_tell( Music_Emu const* );
 /* Seek to new time in track. Seeking backwards or far forward can take a while. */
 gme_err_t gme_seek( Music_Emu*, long msec );
 
+/* Repeat start_msec to end_msec gaplessly until gme_clear_loop(), starting at
+start_msec now. Only on emulators with seek snapshots (NSF). */
+gme_err_t gme_set_loop( Music_Emu*, long start_msec, long end_msec );
+void gme_clear_loop( Music_Emu* );
+
 
 /******** Informational ********/
 
@@ -105,6 +113,10 @@ void gme_ignore_silence( Music_Emu*, int ignore );
 Track length as returned by track_info() assumes a tempo of 1.0. */
 void gme_set_tempo( Music_Emu*, double tempo );
 
+/* Synthesize with cheap linearly interpolated steps instead of band-limited ones,
+for output that is analyzed rather than listened to. Call after loading. */
+void gme_set_fast_synth( Music_Emu*, int fast );
+
 /* Number of voices used by currently loaded file */
 int gme_voice_count( Music_Emu const* );
 
@@ -202,6 +214,13 @@ gme_err_t gme_load_custom( Music_Emu*, gme_reader_t, long file_size, void* your_
 gme_err_t gme_load_m3u_data( Music_Emu*, void const* data, long size );
 
 
+/******** Memory ********/
+
+/* Bytes all emulators currently hold on the heap, and how many blocks the
+library has allocated in all; either pointer may be NULL. Any thread. */
+void gme_memory_usage( long* bytes, long* blocks );
+
+
 /******** User data ********/
 
 /* Set/get pointer to data you want to associate with this emulator.
@@ -62,6 +62,7 @@ void Nsf_Emu::cpu_write( nes_addr_t addr, int data )
 	if ( unsigned (addr - Nes_Apu::start_addr) <= Nes_Apu::end_addr - Nes_Apu::start_addr )
 	{
 		GME_APU_HOOK( this, addr - Nes_Apu::start_addr, data );
+		hook_write( addr, data );
 		apu.write_register( cpu::time(), addr, data );
 		return;
 	}
@@ -69,6 +70,7 @@ void Nsf_Emu::cpu_write( nes_addr_t addr, int data )
 	unsigned bank = addr - bank_select_addr;
 	if ( bank < bank_count )
 	{
+		banks [bank] = data;
 		blargg_long offset = rom.mask_addr( data * (blargg_long) bank_size );
 		if ( offset >= rom.size() )
 			set_warning( "Invalid bank" );
@@ -54,6 +54,15 @@ THE SOFTWARE.
 
 #define AGNES_GET_BIT(byte, bit_ix) (((byte) >> (bit_ix)) & 1)
 
+// Hot helpers the opcode handlers are expanded from
+#if defined(__GNUC__) || defined(__clang__)
+#define AGNES_FORCE_INLINE inline __attribute__((always_inline))
+#elif defined(_MSC_VER)
+#define AGNES_FORCE_INLINE __forceinline
+#else
+#define AGNES_FORCE_INLINE inline
+#endif
+
 #endif /* common_h */
 //FILE_END
 //FILE_START:agnes_types.h
@@ -88,6 +97,7 @@ typedef struct cpu {
     uint8_t flag_negative;
     uint32_t stall;
     uint64_t cycles;
+    uint64_t instructions;
     cpu_interrupt_t interrupt;
 } cpu_t;
 
@@ -242,6 +252,10 @@ typedef struct mapper24 {
     bool irq_enabled_after_ack;
     uint8_t irq_mode;
     uint8_t irq_prescaler;
+    // CPU cycles not yet applied to the counter, and how many may accumulate
+    // before the counter reloads and raises the IRQ
+    int irq_pending_cycles;
+    int irq_event_cycles;
     
     // PRG RAM
     uint8_t prg_ram[8 * 1024];
@@ -291,11 +305,68 @@ typedef struct agnes {
     } mapper;
 
     mirroring_mode_t mirroring_mode;
+
+    // CPU address space in 256-byte pages: direct pointers for RAM, PRG RAM
+    // and PRG ROM, NULL where the access has to go through a handler
+    const uint8_t *read_pages[256];
+    uint8_t *write_pages[256];
+
+    // Catch-up PPU: dots the CPU has run ahead of the PPU, and how many may
+    // accumulate before the next one that has to happen on time
+    int ppu_pending_dots;
+    int ppu_event_dots;
+    bool eager_ppu; // tick the PPU after every instruction (reference path)
+    bool dot_renderer; // never batch visible lines in render_scanline
     
     // APU handler (external implementation)
     agnes_apu_write_func apu_write;
     agnes_apu_read_func apu_read;
     void *apu_user_data;
+
+    // Input poll handler (external implementation)
+    agnes_input_poll_func input_poll;
+    void *input_poll_user_data;
+
+#if AGNES_CPU_PROFILE
+    agnes_cpu_profile_t *cpu_profile;
+#endif
+
+    // Debugger, not part of the emulated state. Pages with read or write
+    // breakpoints (debug_watch bits) are left out of read_pages/write_pages,
+    // debug_*_pages keep what all pages map. debug_hit: a watched access
+    // already set the reason during this instruction; debug_resume: the
+    // last stop was an execution breakpoint, not to be taken again.
+    agnes_debugger_t *debugger;
+    uint8_t debug_watch[256];
+    const uint8_t *debug_read_pages[256];
+    uint8_t *debug_write_pages[256];
+    uint64_t debug_instructions;
+    int debug_scanline;
+    bool debug_hit;
+    bool debug_resume;
+
+    // Debug viewer bookkeeping, not part of the emulated state: PPU memory
+    // changed since agnes_take_ppu_dirty, nametables by physical 1 KB page
+    uint64_t dirty_tiles[8];
+    uint8_t dirty_nametables;
+    bool dirty_palette;
+    mirroring_mode_t dirty_mirroring; // as of the last take
+
+    // Decoded pattern rows for $0000-$1FFF as g_bitplane_spread lays them out
+    // (pixel x in lane x), filled on first use by ppu_tile_row. Tile t is
+    // current while bit t % 64 of tile_valid[t / 64] is set; CHR-RAM writes
+    // clear its bit, a CHR bank switch the whole 1 KB word.
+    uint64_t tile_valid[8];
+    uint64_t tile_rows[512][8];
+
+    // eval_sprites as a lookup: for each visible line the OAM indices of its
+    // first 8 sprites, the count, and 0x80 in the count if a ninth was found.
+    // Rebuilt from the whole OAM on the first evaluation after OAM ($2004,
+    // $4014 DMA), the sprite size or the state changed.
+    uint8_t line_sprites[240][8];
+    uint8_t line_sprite_count[240];
+    bool line_sprites_valid;
+    bool line_sprites_8x16; // size they were built for
 } agnes_t;
 
 #endif /* agnes_types_h */
@@ -345,6 +416,13 @@ AGNES_INTERNAL void ppu_tick(ppu_t *ppu, bool *out_new_frame);
 AGNES_INTERNAL uint8_t ppu_read_register(ppu_t *ppu, uint16_t reg);
 AGNES_INTERNAL void ppu_write_register(ppu_t *ppu, uint16_t addr, uint8_t val);
 
+// Catch-up scheduling: advance the PPU by 'dots' ticks, skipping idle scanlines
+AGNES_INTERNAL void ppu_run(ppu_t *ppu, int dots, bool *out_new_frame);
+// Ticks until the next dot that can raise NMI, an MMC3 IRQ or a new frame (never late)
+AGNES_INTERNAL int ppu_dots_until_event(const ppu_t *ppu);
+// Run the dots the CPU is ahead by; call before anything the PPU can observe
+AGNES_INTERNAL void ppu_catch_up(agnes_t *agnes);
+
 #endif /* ppu_h */
 //FILE_END
 //FILE_START:instructions.h
@@ -375,19 +453,11 @@ typedef enum {
 
 typedef struct cpu cpu_t;
 
-typedef int (*instruction_op_fn)(cpu_t *cpu, uint16_t addr, addr_mode_t mode);
-
-typedef struct {
-    const char *name;
-    uint8_t opcode;
-    uint8_t cycles;
-    bool page_cross_cycle;
-    addr_mode_t mode;
-    instruction_op_fn operation;
-} instruction_t;
-
-AGNES_INTERNAL instruction_t* instruction_get(uint8_t opcode);
 AGNES_INTERNAL uint8_t instruction_get_size(addr_mode_t mode);
+// Decode and run one instruction, pc pointing at its opcode; returns cycles (0 = illegal)
+AGNES_INTERNAL int instruction_execute(cpu_t *cpu, uint8_t opcode);
+// Effective address for 'mode'; inlined into each opcode handler so the switch folds away
+AGNES_INTERNAL AGNES_FORCE_INLINE uint16_t cpu_get_instruction_operand(cpu_t *cpu, addr_mode_t mode, bool *out_pages_differ);
 
 #endif /* opcodes_h */
 //FILE_END
@@ -405,6 +475,13 @@ AGNES_INTERNAL bool mapper_init(agnes_t *agnes);
 AGNES_INTERNAL uint8_t mapper_read(agnes_t *agnes, uint16_t addr);
 AGNES_INTERNAL void mapper_write(agnes_t *agnes, uint16_t addr, uint8_t val);
 AGNES_INTERNAL void mapper_pa12_rising_edge(agnes_t *agnes);
+AGNES_INTERNAL void mapper_map_pages(agnes_t *agnes);
+AGNES_INTERNAL void mapper_map_prg_pages(agnes_t *agnes);
+// Hide the pages the debugger watches in [first, last] after a remap
+AGNES_INTERNAL void debug_unmap_pages(agnes_t *agnes, int first, int last);
+AGNES_INTERNAL void mapper_chr_banks(const agnes_t *agnes, unsigned out[8]);
+AGNES_INTERNAL bool mapper_uses_chr_ram(const agnes_t *agnes);
+AGNES_INTERNAL void ppu_mark_all_dirty(agnes_t *agnes);
 
 #endif /* mapper_h */
 //FILE_END
@@ -554,6 +631,8 @@ agnes_t* agnes_make(void) {
     agnes->apu_write = NULL;
     agnes->apu_read = NULL;
     agnes->apu_user_data = NULL;
+    agnes->input_poll = NULL;
+    agnes->input_poll_user_data = NULL;
     return agnes;
 }
 
@@ -567,13 +646,53 @@ void agnes_set_apu_handler(agnes_t *agnes,
     agnes->apu_user_data = user_data;
 }
 
+void agnes_set_input_poll_handler(agnes_t *agnes, agnes_input_poll_func func, void *user_data) {
+    if (!agnes) return;
+    agnes->input_poll = func;
+    agnes->input_poll_user_data = user_data;
+}
+
 uint64_t agnes_get_cpu_cycles(const agnes_t *agnes) {
     if (!agnes) return 0;
     return agnes->cpu.cycles;
 }
 
+#if AGNES_CPU_PROFILE
+void agnes_set_cpu_profile(agnes_t *agnes, agnes_cpu_profile_t *profile) {
+    agnes->cpu_profile = profile;
+    if (profile) {
+        profile->depth = 0;
+        profile->last_pc = agnes->cpu.pc;
+    }
+}
+
+agnes_cpu_profile_t *agnes_get_cpu_profile(const agnes_t *agnes) {
+    return agnes->cpu_profile;
+}
+#endif
+
+uint64_t agnes_get_cpu_instructions(const agnes_t *agnes) {
+    if (!agnes) return 0;
+    return agnes->cpu.instructions;
+}
+
+const uint8_t *const *agnes_get_cpu_read_pages(const agnes_t *agnes) {
+    return agnes->read_pages;
+}
+
+void agnes_set_ppu_catch_up(agnes_t *agnes, bool enabled) {
+    if (!agnes) return;
+    ppu_catch_up(agnes);
+    agnes->eager_ppu = !enabled;
+}
+
+void agnes_set_scanline_renderer(agnes_t *agnes, bool enabled) {
+    if (!agnes) return;
+    agnes->dot_renderer = !enabled;
+}
+
 // Forward declaration for mapper24 CPU cycle (needed for IRQ)
-static void mapper24_cpu_cycle(mapper24_t *mapper);
+static void mapper24_cpu_cycles(mapper24_t *mapper, int cycles);
 
 bool agnes_load_ines_data(agnes_t *agnes, void *data, size_t data_size) {
     if (data_size < sizeof(ines_header_t)) {
@@ -617,6 +736,12 @@ bool agnes_load_ines_data(agnes_t *agnes, void *data, size_t data_size) {
 
     cpu_init(&agnes->cpu, agnes);
     ppu_init(&agnes->ppu, agnes);
+    agnes->ppu_pending_dots = 0;
+    agnes->ppu_event_dots = 0;
+    agnes->debug_resume = false;
+    ppu_mark_all_dirty(agnes);
+    memset(agnes->tile_valid, 0, sizeof(agnes->tile_valid));
+    agnes->line_sprites_valid = false;
     
     return true;
 }
@@ -639,6 +764,9 @@ void agnes_dump_state(const agnes_t *agnes, agnes_state_t *out_res) {
     out_res->agnes.gamepack.data = NULL;
     out_res->agnes.cpu.agnes = NULL;
     out_res->agnes.ppu.agnes = NULL;
+    memset(out_res->agnes.read_pages, 0, sizeof(out_res->agnes.read_pages));
+    memset(out_res->agnes.write_pages, 0, sizeof(out_res->agnes.write_pages));
+    out_res->agnes.debugger = NULL;
     switch (out_res->agnes.gamepack.mapper) {
         case 0: out_res->agnes.mapper.m0.agnes = NULL; break;
         case 1: out_res->agnes.mapper.m1.agnes = NULL; break;
@@ -650,8 +778,25 @@ void agnes_dump_state(const agnes_t *agnes, agnes_state_t *out_res) {
 
 bool agnes_restore_state(agnes_t *agnes, const agnes_state_t *state) {
     const uint8_t *gamepack_data = agnes->gamepack.data;
+    bool eager_ppu = agnes->eager_ppu;
+    bool dot_renderer = agnes->dot_renderer;
+#if AGNES_CPU_PROFILE
+    agnes_cpu_profile_t *cpu_profile = agnes->cpu_profile;
+#endif
+    agnes_debugger_t *debugger = agnes->debugger;
+    uint8_t debug_watch[256];
+    memcpy(debug_watch, agnes->debug_watch, sizeof(debug_watch));
     memmove(agnes, state, sizeof(agnes_t));
     agnes->gamepack.data = gamepack_data;
+    agnes->eager_ppu = eager_ppu;
+    agnes->dot_renderer = dot_renderer;
+    agnes->debugger = debugger;
+    memcpy(agnes->debug_watch, debug_watch, sizeof(debug_watch));
+    agnes->debug_resume = false;
+#if AGNES_CPU_PROFILE
+    agnes->cpu_profile = cpu_profile;
+    if (cpu_profile) cpu_profile->depth = 0;
+#endif
     agnes->cpu.agnes = agnes;
     agnes->ppu.agnes = agnes;
     switch (agnes->gamepack.mapper) {
@@ -661,9 +806,130 @@ bool agnes_restore_state(agnes_t *agnes, const agnes_state_t *state) {
         case 4: agnes->mapper.m4.agnes = agnes; break;
         case 24: case 26: agnes->mapper.m24.agnes = agnes; break;
     }
+    mapper_map_pages(agnes);
+    ppu_mark_all_dirty(agnes);
+    memset(agnes->tile_valid, 0, sizeof(agnes->tile_valid));
+    agnes->line_sprites_valid = false;
     return true;
 }
 
+// A compact state is these pieces of agnes_t back to back: everything that
+// changes while running except the framebuffer, the pointers and the page tables
+typedef struct {
+    uint8_t *data;
+    size_t size;
+} state_span_t;
+
+enum { STATE_SPANS_MAX = 12 };
+
+static void add_state_span(state_span_t *spans, int *count, void *data, size_t size) {
+    spans[*count].data = (uint8_t*)data;
+    spans[*count].size = size;
+    (*count)++;
+}
+
+// Mapper registers after its back pointer; CHR RAM only for carts that use it
+static void add_mapper_spans(state_span_t *spans, int *count, void *mapper, size_t size,
+                             size_t chr_ram_offset, bool has_chr_ram) {
+    uint8_t *base = (uint8_t*)mapper;
+    size_t start = sizeof(struct agnes *);
+    size_t chr_ram_end = chr_ram_offset + 8 * 1024;
+    add_state_span(spans, count, base + start, chr_ram_offset - start);
+    if (has_chr_ram) {
+        add_state_span(spans, count, base + chr_ram_offset, 8 * 1024);
+    }
+    add_state_span(spans, count, base + chr_ram_end, size - chr_ram_end);
+}
+
+static int compact_state_spans(agnes_t *agnes, state_span_t *spans) {
+    int count = 0;
+    uint8_t *cpu = (uint8_t*)&agnes->cpu;
+    uint8_t *ppu = (uint8_t*)&agnes->ppu;
+    add_state_span(spans, &count, cpu + offsetof(cpu_t, pc), sizeof(cpu_t) - offsetof(cpu_t, pc));
+    add_state_span(spans, &count, ppu + offsetof(ppu_t, nametables),
+                   offsetof(ppu_t, screen_buffer) - offsetof(ppu_t, nametables));
+    add_state_span(spans, &count, ppu + offsetof(ppu_t, scanline), sizeof(ppu_t) - offsetof(ppu_t, scanline));
+    add_state_span(spans, &count, agnes->ram, sizeof(agnes->ram));
+    add_state_span(spans, &count, agnes->controllers, sizeof(agnes->controllers));
+    add_state_span(spans, &count, &agnes->controllers_latch, sizeof(agnes->controllers_latch));
+    add_state_span(spans, &count, &agnes->mirroring_mode, sizeof(agnes->mirroring_mode));
+    add_state_span(spans, &count, &agnes->ppu_pending_dots, sizeof(agnes->ppu_pending_dots));
+    add_state_span(spans, &count, &agnes->ppu_event_dots, sizeof(agnes->ppu_event_dots));
+    switch (agnes->gamepack.mapper) {
+        case 0:
+            add_mapper_spans(spans, &count, &agnes->mapper.m0, sizeof(mapper0_t),
+                             offsetof(mapper0_t, chr_ram), agnes->mapper.m0.use_chr_ram);
+            break;
+        case 1:
+            add_mapper_spans(spans, &count, &agnes->mapper.m1, sizeof(mapper1_t),
+                             offsetof(mapper1_t, chr_ram), agnes->mapper.m1.use_chr_ram);
+            break;
+        case 2:
+            add_mapper_spans(spans, &count, &agnes->mapper.m2, sizeof(mapper2_t),
+                             offsetof(mapper2_t, chr_ram), true);
+            break;
+        case 4:
+            add_mapper_spans(spans, &count, &agnes->mapper.m4, sizeof(mapper4_t),
+                             offsetof(mapper4_t, chr_ram), agnes->mapper.m4.use_chr_ram);
+            break;
+        case 24: case 26:
+            add_mapper_spans(spans, &count, &agnes->mapper.m24, sizeof(mapper24_t),
+                             offsetof(mapper24_t, chr_ram), agnes->mapper.m24.use_chr_ram);
+            break;
+    }
+    return count;
+}
+
+size_t agnes_compact_state_size(const agnes_t *agnes) {
+    state_span_t spans[STATE_SPANS_MAX];
+    int count = compact_state_spans((agnes_t*)agnes, spans);
+    size_t size = 0;
+    for (int i = 0; i < count; i++) {
+        size += spans[i].size;
+    }
+    return size;
+}
+
+void agnes_dump_compact_state(const agnes_t *agnes, void *out_res) {
+    state_span_t spans[STATE_SPANS_MAX];
+    int count = compact_state_spans((agnes_t*)agnes, spans);
+    uint8_t *out = (uint8_t*)out_res;
+    for (int i = 0; i < count; i++) {
+        memcpy(out, spans[i].data, spans[i].size);
+        out += spans[i].size;
+    }
+}
+
+void agnes_restore_compact_state(agnes_t *agnes, const void *state) {
+    // The layout only depends on the cart, which is the same one
+    state_span_t spans[STATE_SPANS_MAX];
+    int count = compact_state_spans(agnes, spans);
+    const uint8_t *in = (const uint8_t*)state;
+    unsigned chr_before[8], chr_after[8];
+    mapper_chr_banks(agnes, chr_before);
+    for (int i = 0; i < count; i++) {
+        memcpy(spans[i].data, in, spans[i].size);
+        in += spans[i].size;
+    }
+    mapper_map_pages(agnes);
+    agnes->debug_resume = false;
+    ppu_mark_all_dirty(agnes);
+    agnes->line_sprites_valid = false;
+#if AGNES_CPU_PROFILE
+    if (agnes->cpu_profile) agnes->cpu_profile->depth = 0;
+#endif
+
+    // Run-ahead and rollback restore every frame: decoded CHR-ROM tiles
+    // survive unless their bank moved, CHR RAM may hold anything
+    mapper_chr_banks(agnes, chr_after);
+    bool chr_ram = mapper_uses_chr_ram(agnes);
+    for (int i = 0; i < 8; i++) {
+        if (chr_ram || chr_before[i] != chr_after[i]) {
+            agnes->tile_valid[i] = 0;
+        }
+    }
+}
+
 bool agnes_tick(agnes_t *agnes, bool *out_new_frame) {
     int cpu_cycles = cpu_tick(&agnes->cpu);
     if (cpu_cycles == 0) {
@@ -671,40 +937,191 @@ bool agnes_tick(agnes_t *agnes, bool *out_new_frame) {
     }
 
     int ppu_cycles = cpu_cycles * 3;
-    for (int i = 0; i < ppu_cycles; i++) {
-        ppu_tick(&agnes->ppu, out_new_frame);
+    if (agnes->eager_ppu) {
+        for (int i = 0; i < ppu_cycles; i++) {
+            ppu_tick(&agnes->ppu, out_new_frame);
+        }
+    } else {
+        // Only run the PPU once a dot that affects the CPU (NMI, IRQ, frame end)
+        // falls inside the owed dots; register and mapper accesses catch up on their own
+        agnes->ppu_pending_dots += ppu_cycles;
+        if (agnes->ppu_pending_dots >= agnes->ppu_event_dots) {
+            ppu_run(&agnes->ppu, agnes->ppu_pending_dots, out_new_frame);
+            agnes->ppu_pending_dots = 0;
+            agnes->ppu_event_dots = ppu_dots_until_event(&agnes->ppu);
+        }
     }
     
     // Run mapper-specific CPU cycle logic (for IRQ counters, etc.)
     if (agnes->gamepack.mapper == 24 || agnes->gamepack.mapper == 26) {
-        for (int i = 0; i < cpu_cycles; i++) {
-            mapper24_cpu_cycle(&agnes->mapper.m24);
-        }
+        mapper24_cpu_cycles(&agnes->mapper.m24, cpu_cycles);
     }
     
     return true;
 }
 
-bool agnes_next_frame(agnes_t *agnes) {
+static bool debug_before_tick(agnes_t *agnes);
+static bool debug_after_tick(agnes_t *agnes);
+
+// The frame loop. Both entry points expand it with 'debug' a constant, so
+// agnes_next_frame's copy has no debugger checks at all.
+static AGNES_FORCE_INLINE int run_frame(agnes_t *agnes, const bool debug) {
     while (true) {
+        if (debug && debug_before_tick(agnes)) {
+            return AGNES_DEBUG_BREAK;
+        }
         bool new_frame = false;
         bool ok = agnes_tick(agnes, &new_frame);
         if (!ok) {
-            return false;
+            return 0;
         }
-        if (new_frame) {
-            break;
+        int done = new_frame ? AGNES_DEBUG_FRAME : 0;
+        if (debug && debug_after_tick(agnes)) {
+            return done | AGNES_DEBUG_BREAK;
+        }
+        if (done) {
+            return done;
+        }
+    }
+}
+
+bool agnes_next_frame(agnes_t *agnes) {
+    return run_frame(agnes, false) != 0;
+}
+
+void agnes_set_debugger(agnes_t *agnes, agnes_debugger_t *debugger) {
+    agnes->debugger = debugger;
+    agnes->debug_hit = false;
+    agnes->debug_resume = false;
+    memset(agnes->debug_watch, 0, sizeof(agnes->debug_watch));
+    if (debugger) {
+        for (int addr = 0; addr < 0x10000; addr++) {
+            agnes->debug_watch[addr >> 8] |= debugger->breakpoints[addr] & (AGNES_BREAK_READ | AGNES_BREAK_WRITE);
         }
     }
+    if (agnes->gamepack.data) {
+        mapper_map_pages(agnes);
+    }
+}
+
+agnes_debugger_t *agnes_get_debugger(const agnes_t *agnes) {
+    return agnes->debugger;
+}
+
+int agnes_debug_run(agnes_t *agnes) {
+    if (!agnes->debugger) {
+        return agnes_next_frame(agnes) ? AGNES_DEBUG_FRAME : 0;
+    }
+    agnes->debug_hit = false;
+    agnes->debug_instructions = agnes->cpu.instructions;
+    agnes_cpu_regs_t regs;
+    agnes_get_cpu_regs(agnes, &regs);
+    agnes->debug_scanline = regs.scanline;
+    return run_frame(agnes, true);
+}
+
+void agnes_get_cpu_regs(const agnes_t *agnes, agnes_cpu_regs_t *out) {
+    const cpu_t *cpu = &agnes->cpu;
+    out->pc = cpu->pc;
+    out->a = cpu->acc;
+    out->x = cpu->x;
+    out->y = cpu->y;
+    out->sp = cpu->sp;
+    out->p = cpu_get_flags(cpu);
+    out->interrupt = cpu->interrupt != INTERRPUT_NONE;
+    int pos = agnes->ppu.scanline * 341 + agnes->ppu.dot + agnes->ppu_pending_dots;
+    out->scanline = (pos / 341) % 262;
+    out->dot = pos % 341;
+    out->cycles = cpu->cycles;
+}
+
+uint8_t agnes_cpu_peek(const agnes_t *agnes, uint16_t addr) {
+    const uint8_t *page = agnes->debugger ? agnes->debug_read_pages[addr >> 8] : agnes->read_pages[addr >> 8];
+    return page ? page[addr & 0xff] : 0;
+}
+
+// Stop at an execution breakpoint on the next instruction, the handler's
+// first one if an interrupt comes before it
+static bool debug_before_tick(agnes_t *agnes) {
+    const cpu_t *cpu = &agnes->cpu;
+    if (cpu->stall > 0) {
+        return false;
+    }
+    if (agnes->debug_resume) {
+        agnes->debug_resume = false;
+        return false;
+    }
+    uint16_t pc = cpu->pc;
+    if (cpu->interrupt != INTERRPUT_NONE) {
+        uint16_t vector = cpu->interrupt == INTERRUPT_NMI ? 0xfffa : 0xfffe;
+        pc = agnes_cpu_peek(agnes, vector) | (agnes_cpu_peek(agnes, vector + 1) << 8);
+    }
+    agnes_debugger_t *debugger = agnes->debugger;
+    if (!(debugger->breakpoints[pc] & AGNES_BREAK_EXEC)) {
+        return false;
+    }
+    debugger->reason = AGNES_DEBUG_EXEC;
+    debugger->addr = pc;
+    debugger->value = agnes_cpu_peek(agnes, pc);
+    agnes->debug_resume = true;
     return true;
 }
 
+// A watched access during the instruction, the end of a step or a new scanline
+static bool debug_after_tick(agnes_t *agnes) {
+    agnes_debugger_t *debugger = agnes->debugger;
+    bool stop = agnes->debug_hit;
+    agnes->debug_hit = false;
+
+    bool ran = agnes->cpu.instructions != agnes->debug_instructions;
+    agnes->debug_instructions = agnes->cpu.instructions;
+    if (ran && debugger->steps > 0 && --debugger->steps == 0 && !stop) {
+        debugger->reason = AGNES_DEBUG_STEP;
+        debugger->addr = agnes->cpu.pc;
+        debugger->value = agnes_cpu_peek(agnes, agnes->cpu.pc);
+        stop = true;
+    }
+
+    if (debugger->scanline >= 0) {
+        agnes_cpu_regs_t regs;
+        agnes_get_cpu_regs(agnes, &regs);
+        if (regs.scanline != agnes->debug_scanline && regs.scanline == debugger->scanline && !stop) {
+            debugger->reason = AGNES_DEBUG_SCANLINE;
+            debugger->addr = agnes->cpu.pc;
+            debugger->value = (uint8_t)regs.scanline;
+            stop = true;
+        }
+        agnes->debug_scanline = regs.scanline;
+    }
+    return stop;
+}
+
+void debug_unmap_pages(agnes_t *agnes, int first, int last) {
+    if (!agnes->debugger) {
+        return;
+    }
+    for (int page = first; page <= last; page++) {
+        agnes->debug_read_pages[page] = agnes->read_pages[page];
+        agnes->debug_write_pages[page] = agnes->write_pages[page];
+        if (agnes->debug_watch[page] & AGNES_BREAK_READ) {
+            agnes->read_pages[page] = NULL;
+        }
+        if (agnes->debug_watch[page] & AGNES_BREAK_WRITE) {
+            agnes->write_pages[page] = NULL;
+        }
+    }
+}
+
 agnes_color_t agnes_get_screen_pixel(const agnes_t *agnes, int x, int y) {
     int ix = (y * AGNES_SCREEN_WIDTH) + x;
     uint8_t color_ix = agnes->ppu.screen_buffer[ix];
     return g_colors[color_ix & 0x3f];
 }
 
+const uint8_t* agnes_get_screen_buffer(const agnes_t *agnes) {
+    return agnes->ppu.screen_buffer;
+}
+
 void agnes_destroy(agnes_t *agnes) {
     free(agnes);
 }
@@ -736,9 +1153,18 @@ static uint8_t get_input_byte(const agnes_input_t* input) {
 #endif
 
 static uint16_t cpu_read16_indirect_bug(cpu_t *cpu, uint16_t addr);
-static uint16_t get_instruction_operand(cpu_t *cpu, addr_mode_t mode, bool *out_pages_differ);
+static void write8_unmapped(cpu_t *cpu, uint16_t addr, uint8_t val);
+static uint8_t read8_unmapped(cpu_t *cpu, uint16_t addr);
+static void debug_write8(cpu_t *cpu, uint16_t addr, uint8_t val);
+static uint8_t debug_read8(cpu_t *cpu, uint16_t addr);
 static int handle_interrupt(cpu_t *cpu);
 static bool check_pages_differ(uint16_t a, uint16_t b);
+#if AGNES_CPU_PROFILE
+static void profile_call(agnes_cpu_profile_t *profile, uint16_t addr, uint8_t sp, bool frame, uint64_t start);
+static void profile_return(agnes_cpu_profile_t *profile, uint8_t sp, uint64_t end);
+static void profile_instruction(agnes_cpu_profile_t *profile, uint16_t pc, uint8_t opcode, uint8_t sp, uint16_t next_pc,
+                                uint8_t next_sp, int cycles);
+#endif
 
 void cpu_init(cpu_t *cpu, agnes_t *agnes) {
     memset(cpu, 0, sizeof(cpu_t));
@@ -749,37 +1175,48 @@ void cpu_init(cpu_t *cpu, agnes_t *agnes) {
 }
 
 int cpu_tick(cpu_t *cpu) {
+#if AGNES_CPU_PROFILE
+    agnes_cpu_profile_t *profile = cpu->agnes->cpu_profile;
+#endif
     if (cpu->stall > 0) {
         cpu->stall--;
+#if AGNES_CPU_PROFILE
+        if (profile) {
+            profile->pc_cycles[profile->last_pc]++;
+            profile->clock++;
+        }
+#endif
         return 1;
     }
 
     int cycles = 0;
 
     if (cpu->interrupt != INTERRPUT_NONE) {
+#if AGNES_CPU_PROFILE
+        bool nmi = cpu->interrupt == INTERRUPT_NMI;
+#endif
         cycles += handle_interrupt(cpu);
+#if AGNES_CPU_PROFILE
+        if (profile && cycles) profile_call(profile, cpu->pc, cpu->sp, nmi, profile->clock);
+#endif
     }
 
+#if AGNES_CPU_PROFILE
+    uint16_t pc = cpu->pc;
+    uint8_t sp = cpu->sp;
+#endif
     uint8_t opcode = cpu_read8(cpu, cpu->pc);
-    instruction_t *ins = instruction_get(opcode);
-    if (ins->operation == NULL) {
+    int ins_cycles = instruction_execute(cpu, opcode);
+    if (ins_cycles == 0) {
         return 0;
     }
-    
-    uint8_t ins_size = instruction_get_size(ins->mode);
-    bool page_crossed = false;
-    uint16_t addr = get_instruction_operand(cpu, ins->mode, &page_crossed);
-
-    cpu->pc += ins_size;
-
-    cycles += ins->cycles;
-    cycles += ins->operation(cpu, addr, ins->mode);
-
-    if (page_crossed && ins->page_cross_cycle) {
-        cycles += 1;
-    }
+    cycles += ins_cycles;
 
     cpu->cycles += cycles;
+    cpu->instructions++;
+#if AGNES_CPU_PROFILE
+    if (profile) profile_instruction(profile, pc, opcode, sp, cpu->pc, cpu->sp, cycles);
+#endif
 
     return cycles;
 }
@@ -851,15 +1288,33 @@ void cpu_set_dma_stall(cpu_t *cpu) {
 void cpu_write8(cpu_t *cpu, uint16_t addr, uint8_t val) {
     agnes_t *agnes = cpu->agnes;
 
-    if (addr < 0x2000) {
-        agnes->ram[addr & 0x7ff] = val;
-    } else if (addr < 0x4000) {
+    uint8_t *page = agnes->write_pages[addr >> 8];
+    if (page) { // RAM and PRG RAM
+        page[addr & 0xff] = val;
+        return;
+    }
+    if (agnes->debugger) { // may have unmapped the page
+        debug_write8(cpu, addr, val);
+        return;
+    }
+    write8_unmapped(cpu, addr, val);
+}
+
+static void write8_unmapped(cpu_t *cpu, uint16_t addr, uint8_t val) {
+    agnes_t *agnes = cpu->agnes;
+    if (addr < 0x4000) {
+        ppu_catch_up(agnes);
         ppu_write_register(&agnes->ppu, 0x2000 | (addr & 0x7), val);
+        agnes->ppu_event_dots = ppu_dots_until_event(&agnes->ppu);
     } else if (addr == 0x4014) {
+        ppu_catch_up(agnes);
         ppu_write_register(&agnes->ppu, 0x4014, val);
     } else if (addr == 0x4016) {
         agnes->controllers_latch = val & 0x1;
         if (agnes->controllers_latch) {
+            if (agnes->input_poll) {
+                agnes->input_poll(agnes->input_poll_user_data);
+            }
             agnes->controllers[0].shift = agnes->controllers[0].state;
             agnes->controllers[1].shift = agnes->controllers[1].state;
         }
@@ -870,6 +1325,20 @@ void cpu_write8(cpu_t *cpu, uint16_t addr, uint8_t val) {
     } else if (addr < 0x4020) { // disabled
 
     } else {
+        if (addr >= 0x8000) { // bank switching and mirroring change what the PPU fetches
+            ppu_catch_up(agnes);
+            unsigned chr_before[8], chr_after[8];
+            mapper_chr_banks(agnes, chr_before);
+            mapper_write(agnes, addr, val);
+            mapper_chr_banks(agnes, chr_after);
+            for (int i = 0; i < 8; i++) {
+                if (chr_before[i] != chr_after[i]) {
+                    agnes->dirty_tiles[i] = ~(uint64_t)0;
+                    agnes->tile_valid[i] = 0;
+                }
+            }
+            return;
+        }
         mapper_write(agnes, addr, val);
     }
 }
@@ -877,12 +1346,23 @@ void cpu_write8(cpu_t *cpu, uint16_t addr, uint8_t val) {
 uint8_t cpu_read8(cpu_t *cpu, uint16_t addr) {
     agnes_t *agnes = cpu->agnes;
 
+    const uint8_t *page = agnes->read_pages[addr >> 8];
+    if (page) { // RAM, PRG RAM and PRG ROM
+        return page[addr & 0xff];
+    }
+    if (agnes->debugger) { // may have unmapped the page
+        return debug_read8(cpu, addr);
+    }
+    return read8_unmapped(cpu, addr);
+}
+
+static uint8_t read8_unmapped(cpu_t *cpu, uint16_t addr) {
+    agnes_t *agnes = cpu->agnes;
     uint8_t res = 0;
-    if (addr >= 0x4020) { // moved to top because it's the most common case
+    if (addr >= 0x4020) {
         res = mapper_read(agnes, addr);
-    } else if (addr < 0x2000) {
-        res = agnes->ram[addr & 0x7ff];
     } else if (addr < 0x4000) {
+        ppu_catch_up(agnes);
         res = ppu_read_register(&agnes->ppu, 0x2000 | (addr & 0x7));
     } else if (addr < 0x4016) {
         // APU read (mainly 0x4015 status)
@@ -900,6 +1380,38 @@ uint8_t cpu_read8(cpu_t *cpu, uint16_t addr) {
     return res;
 }
 
+// Accesses off the page table while a debugger is set: watched pages come
+// here too, and go on to what they map
+static void debug_access(agnes_t *agnes, uint8_t flag, uint16_t addr, uint8_t val) {
+    agnes_debugger_t *debugger = agnes->debugger;
+    if (!(debugger->breakpoints[addr] & flag) || agnes->debug_hit) {
+        return;
+    }
+    debugger->reason = flag == AGNES_BREAK_READ ? AGNES_DEBUG_READ : AGNES_DEBUG_WRITE;
+    debugger->addr = addr;
+    debugger->value = val;
+    agnes->debug_hit = true;
+}
+
+static void debug_write8(cpu_t *cpu, uint16_t addr, uint8_t val) {
+    agnes_t *agnes = cpu->agnes;
+    debug_access(agnes, AGNES_BREAK_WRITE, addr, val);
+    uint8_t *page = agnes->debug_write_pages[addr >> 8];
+    if (page) {
+        page[addr & 0xff] = val;
+    } else {
+        write8_unmapped(cpu, addr, val);
+    }
+}
+
+static uint8_t debug_read8(cpu_t *cpu, uint16_t addr) {
+    agnes_t *agnes = cpu->agnes;
+    const uint8_t *page = agnes->debug_read_pages[addr >> 8];
+    uint8_t val = page ? page[addr & 0xff] : read8_unmapped(cpu, addr);
+    debug_access(agnes, AGNES_BREAK_READ, addr, val);
+    return val;
+}
+
 uint16_t cpu_read16(cpu_t *cpu, uint16_t addr) {
     uint8_t lo = cpu_read8(cpu, addr);
     uint8_t hi = cpu_read8(cpu, addr + 1);
@@ -912,7 +1424,7 @@ static uint16_t cpu_read16_indirect_bug(cpu_t *cpu, uint16_t addr) {
     return (hi << 8) | lo;
 }
 
-static uint16_t get_instruction_operand(cpu_t *cpu, addr_mode_t mode, bool *out_pages_differ) {
+uint16_t cpu_get_instruction_operand(cpu_t *cpu, addr_mode_t mode, bool *out_pages_differ) {
     *out_pages_differ = false;
     switch (mode) {
         case ADDR_MODE_ABSOLUTE: {
@@ -989,6 +1501,47 @@ static int handle_interrupt(cpu_t *cpu) {
     return 7;
 }
 
+#if AGNES_CPU_PROFILE
+static void profile_call(agnes_cpu_profile_t *profile, uint16_t addr, uint8_t sp, bool frame, uint64_t start) {
+    if (profile->depth == AGNES_PROFILE_MAX_DEPTH) {
+        memmove(&profile->calls[0], &profile->calls[1], sizeof(profile->calls[0]) * (AGNES_PROFILE_MAX_DEPTH - 1));
+        profile->depth--;
+    }
+    int ix = profile->depth++;
+    profile->calls[ix].start = start;
+    profile->calls[ix].addr = addr;
+    profile->calls[ix].sp = sp;
+    profile->calls[ix].frame = frame;
+}
+
+static void profile_return(agnes_cpu_profile_t *profile, uint8_t sp, uint64_t end) {
+    // Also closes deeper calls a stack trick left behind
+    while (profile->depth > 0 && profile->calls[profile->depth - 1].sp <= sp) {
+        profile->depth--;
+        uint64_t length = end - profile->calls[profile->depth].start;
+        uint16_t addr = profile->calls[profile->depth].addr;
+        profile->routine_cycles[addr] += length;
+        profile->routine_calls[addr]++;
+        if (profile->calls[profile->depth].frame && profile->frame_capacity > 0) {
+            profile->frame_cycles[profile->frames++ % profile->frame_capacity] = (uint32_t)length;
+        }
+    }
+}
+
+// 'cycles' includes an interrupt taken just before, which the interrupt's call covers too
+static void profile_instruction(agnes_cpu_profile_t *profile, uint16_t pc, uint8_t opcode, uint8_t sp, uint16_t next_pc,
+                                uint8_t next_sp, int cycles) {
+    uint64_t start = profile->clock;
+    profile->pc_cycles[pc] += cycles;
+    profile->clock += cycles;
+    profile->last_pc = pc;
+    switch (opcode) {
+        case 0x20: profile_call(profile, next_pc, next_sp, false, start); break; // JSR
+        case 0x40: case 0x60: profile_return(profile, sp, profile->clock); break; // RTI, RTS
+    }
+}
+#endif
+
 static bool check_pages_differ(uint16_t a, uint16_t b) {
     return (0xff00 & a) != (0xff00 & b);
 }
@@ -1013,6 +1566,7 @@ static void emit_pixel(ppu_t *ppu);
 static uint16_t get_bg_color_addr(ppu_t *ppu);
 static uint16_t get_sprite_color_addr(ppu_t *ppu, int *out_sprite_ix, bool *out_behind_bg);
 static void eval_sprites(ppu_t *ppu);
+static void render_scanline(ppu_t *ppu);
 static void set_pixel_color_ix(ppu_t *ppu, int x, int y, uint8_t color_ix);
 static uint8_t ppu_read8(ppu_t *ppu, uint16_t addr);
 static void ppu_write8(ppu_t *ppu, uint16_t addr, uint8_t val);
@@ -1023,6 +1577,111 @@ static unsigned g_palette_addr_map[32] = {
     0x00, 0x11, 0x12, 0x13, 0x04, 0x15, 0x16, 0x17, 0x08, 0x19, 0x1a, 0x1b, 0x0c, 0x1d, 0x1e, 0x1f,
 };
 
+// Bit-plane interleave: pattern byte -> 8 one-byte lanes, leftmost pixel in the
+// lowest lane, so (lo | hi << 1) gives a tile row's 2-bit pixels at once
+static const uint64_t g_bitplane_spread[256] = {
+    0x0000000000000000ull, 0x0100000000000000ull, 0x0001000000000000ull, 0x0101000000000000ull,
+    0x0000010000000000ull, 0x0100010000000000ull, 0x0001010000000000ull, 0x0101010000000000ull,
+    0x0000000100000000ull, 0x0100000100000000ull, 0x0001000100000000ull, 0x0101000100000000ull,
+    0x0000010100000000ull, 0x0100010100000000ull, 0x0001010100000000ull, 0x0101010100000000ull,
+    0x0000000001000000ull, 0x0100000001000000ull, 0x0001000001000000ull, 0x0101000001000000ull,
+    0x0000010001000000ull, 0x0100010001000000ull, 0x0001010001000000ull, 0x0101010001000000ull,
+    0x0000000101000000ull, 0x0100000101000000ull, 0x0001000101000000ull, 0x0101000101000000ull,
+    0x0000010101000000ull, 0x0100010101000000ull, 0x0001010101000000ull, 0x0101010101000000ull,
+    0x0000000000010000ull, 0x0100000000010000ull, 0x0001000000010000ull, 0x0101000000010000ull,
+    0x0000010000010000ull, 0x0100010000010000ull, 0x0001010000010000ull, 0x0101010000010000ull,
+    0x0000000100010000ull, 0x0100000100010000ull, 0x0001000100010000ull, 0x0101000100010000ull,
+    0x0000010100010000ull, 0x0100010100010000ull, 0x0001010100010000ull, 0x0101010100010000ull,
+    0x0000000001010000ull, 0x0100000001010000ull, 0x0001000001010000ull, 0x0101000001010000ull,
+    0x0000010001010000ull, 0x0100010001010000ull, 0x0001010001010000ull, 0x0101010001010000ull,
+    0x0000000101010000ull, 0x0100000101010000ull, 0x0001000101010000ull, 0x0101000101010000ull,
+    0x0000010101010000ull, 0x0100010101010000ull, 0x0001010101010000ull, 0x0101010101010000ull,
+    0x0000000000000100ull, 0x0100000000000100ull, 0x0001000000000100ull, 0x0101000000000100ull,
+    0x0000010000000100ull, 0x0100010000000100ull, 0x0001010000000100ull, 0x0101010000000100ull,
+    0x0000000100000100ull, 0x0100000100000100ull, 0x0001000100000100ull, 0x0101000100000100ull,
+    0x0000010100000100ull, 0x0100010100000100ull, 0x0001010100000100ull, 0x0101010100000100ull,
+    0x0000000001000100ull, 0x0100000001000100ull, 0x0001000001000100ull, 0x0101000001000100ull,
+    0x0000010001000100ull, 0x0100010001000100ull, 0x0001010001000100ull, 0x0101010001000100ull,
+    0x0000000101000100ull, 0x0100000101000100ull, 0x0001000101000100ull, 0x0101000101000100ull,
+    0x0000010101000100ull, 0x0100010101000100ull, 0x0001010101000100ull, 0x0101010101000100ull,
+    0x0000000000010100ull, 0x0100000000010100ull, 0x0001000000010100ull, 0x0101000000010100ull,
+    0x0000010000010100ull, 0x0100010000010100ull, 0x0001010000010100ull, 0x0101010000010100ull,
+    0x0000000100010100ull, 0x0100000100010100ull, 0x0001000100010100ull, 0x0101000100010100ull,
+    0x0000010100010100ull, 0x0100010100010100ull, 0x0001010100010100ull, 0x0101010100010100ull,
+    0x0000000001010100ull, 0x0100000001010100ull, 0x0001000001010100ull, 0x0101000001010100ull,
+    0x0000010001010100ull, 0x0100010001010100ull, 0x0001010001010100ull, 0x0101010001010100ull,
+    0x0000000101010100ull, 0x0100000101010100ull, 0x0001000101010100ull, 0x0101000101010100ull,
+    0x0000010101010100ull, 0x0100010101010100ull, 0x0001010101010100ull, 0x0101010101010100ull,
+    0x0000000000000001ull, 0x0100000000000001ull, 0x0001000000000001ull, 0x0101000000000001ull,
+    0x0000010000000001ull, 0x0100010000000001ull, 0x0001010000000001ull, 0x0101010000000001ull,
+    0x0000000100000001ull, 0x0100000100000001ull, 0x0001000100000001ull, 0x0101000100000001ull,
+    0x0000010100000001ull, 0x0100010100000001ull, 0x0001010100000001ull, 0x0101010100000001ull,
+    0x0000000001000001ull, 0x0100000001000001ull, 0x0001000001000001ull, 0x0101000001000001ull,
+    0x0000010001000001ull, 0x0100010001000001ull, 0x0001010001000001ull, 0x0101010001000001ull,
+    0x0000000101000001ull, 0x0100000101000001ull, 0x0001000101000001ull, 0x0101000101000001ull,
+    0x0000010101000001ull, 0x0100010101000001ull, 0x0001010101000001ull, 0x0101010101000001ull,
+    0x0000000000010001ull, 0x0100000000010001ull, 0x0001000000010001ull, 0x0101000000010001ull,
+    0x0000010000010001ull, 0x0100010000010001ull, 0x0001010000010001ull, 0x0101010000010001ull,
+    0x0000000100010001ull, 0x0100000100010001ull, 0x0001000100010001ull, 0x0101000100010001ull,
+    0x0000010100010001ull, 0x0100010100010001ull, 0x0001010100010001ull, 0x0101010100010001ull,
+    0x0000000001010001ull, 0x0100000001010001ull, 0x0001000001010001ull, 0x0101000001010001ull,
+    0x0000010001010001ull, 0x0100010001010001ull, 0x0001010001010001ull, 0x0101010001010001ull,
+    0x0000000101010001ull, 0x0100000101010001ull, 0x0001000101010001ull, 0x0101000101010001ull,
+    0x0000010101010001ull, 0x0100010101010001ull, 0x0001010101010001ull, 0x0101010101010001ull,
+    0x0000000000000101ull, 0x0100000000000101ull, 0x0001000000000101ull, 0x0101000000000101ull,
+    0x0000010000000101ull, 0x0100010000000101ull, 0x0001010000000101ull, 0x0101010000000101ull,
+    0x0000000100000101ull, 0x0100000100000101ull, 0x0001000100000101ull, 0x0101000100000101ull,
+    0x0000010100000101ull, 0x0100010100000101ull, 0x0001010100000101ull, 0x0101010100000101ull,
+    0x0000000001000101ull, 0x0100000001000101ull, 0x0001000001000101ull, 0x0101000001000101ull,
+    0x0000010001000101ull, 0x0100010001000101ull, 0x0001010001000101ull, 0x0101010001000101ull,
+    0x0000000101000101ull, 0x0100000101000101ull, 0x0001000101000101ull, 0x0101000101000101ull,
+    0x0000010101000101ull, 0x0100010101000101ull, 0x0001010101000101ull, 0x0101010101000101ull,
+    0x0000000000010101ull, 0x0100000000010101ull, 0x0001000000010101ull, 0x0101000000010101ull,
+    0x0000010000010101ull, 0x0100010000010101ull, 0x0001010000010101ull, 0x0101010000010101ull,
+    0x0000000100010101ull, 0x0100000100010101ull, 0x0001000100010101ull, 0x0101000100010101ull,
+    0x0000010100010101ull, 0x0100010100010101ull, 0x0001010100010101ull, 0x0101010100010101ull,
+    0x0000000001010101ull, 0x0100000001010101ull, 0x0001000001010101ull, 0x0101000001010101ull,
+    0x0000010001010101ull, 0x0100010001010101ull, 0x0001010001010101ull, 0x0101010001010101ull,
+    0x0000000101010101ull, 0x0100000101010101ull, 0x0001000101010101ull, 0x0101000101010101ull,
+    0x0000010101010101ull, 0x0100010101010101ull, 0x0001010101010101ull, 0x0101010101010101ull,
+};
+
+// Pattern row at addr (table + tile * 16 + fine y, $0000-$1FFF) as 8 lanes of
+// 2-bit pixels, leftmost in the lowest lane; from the decoded tile cache
+static AGNES_FORCE_INLINE uint64_t ppu_tile_row(ppu_t *ppu, uint16_t addr) {
+    agnes_t *agnes = ppu->agnes;
+    unsigned tile = (addr >> 4) & 511;
+    uint64_t bit = (uint64_t)1 << (tile & 63);
+    if (!(agnes->tile_valid[tile >> 6] & bit)) {
+        uint16_t base = (uint16_t)(tile << 4);
+        for (int y = 0; y < 8; y++) {
+            uint8_t lo = mapper_read(agnes, base + y);
+            uint8_t hi = mapper_read(agnes, base + y + 8);
+            agnes->tile_rows[tile][y] = g_bitplane_spread[lo] | (g_bitplane_spread[hi] << 1);
+        }
+        agnes->tile_valid[tile >> 6] |= bit;
+    }
+    return agnes->tile_rows[tile][addr & 7];
+}
+
+// Sprite rows: the planes at addr and addr + 8, through the cache when that's
+// one tile's row. Stale sprite data (size or rendering toggled mid-frame) can
+// point anywhere, and then the bytes are decoded as they are.
+static AGNES_FORCE_INLINE uint64_t ppu_pattern_row(ppu_t *ppu, uint16_t addr) {
+    addr &= 0x3fff;
+    if (addr < 0x2000 && !(addr & 8)) {
+        return ppu_tile_row(ppu, addr);
+    }
+    return g_bitplane_spread[ppu_read8(ppu, addr)] | (g_bitplane_spread[ppu_read8(ppu, addr + 8)] << 1);
+}
+
+// Horizontal flip of a decoded row
+static inline uint64_t reverse_lanes(uint64_t row) {
+    row = (row >> 32) | (row << 32);
+    row = ((row & 0xffff0000ffff0000ull) >> 16) | ((row & 0x0000ffff0000ffffull) << 16);
+    return ((row & 0xff00ff00ff00ff00ull) >> 8) | ((row & 0x00ff00ff00ff00ffull) << 8);
+}
+
 void ppu_init(ppu_t *ppu, agnes_t *agnes) {
     memset(ppu, 0, sizeof(ppu_t));
     ppu->agnes = agnes;
@@ -1080,6 +1739,77 @@ void ppu_tick(ppu_t *ppu, bool *out_new_frame) {
     }
 }
 
+// Ticks left on the current scanline that do nothing but advance 'dot'
+static int ppu_idle_dots(const ppu_t *ppu) {
+    if (ppu->dot >= 340) {
+        return 0; // next tick starts a new line
+    }
+    bool rendering_enabled = ppu->masks.show_background || ppu->masks.show_sprites;
+    int s = ppu->scanline;
+    bool idle;
+    if (s == 241) {
+        idle = ppu->dot >= 1; // vblank starts at dot 1
+    } else if (s >= 240 && s <= 260) {
+        idle = true;
+    } else if (!rendering_enabled) {
+        idle = s < 240 || ppu->dot >= 1; // pre-render line clears the flags at dot 1
+    } else {
+        idle = false;
+    }
+    return idle ? 340 - ppu->dot : 0;
+}
+
+void ppu_run(ppu_t *ppu, int dots, bool *out_new_frame) {
+    while (dots > 0) {
+        // A whole visible line with no register write in between can be drawn in one go
+        if (ppu->dot == 0 && dots >= 256 && ppu->scanline < 240 && !ppu->agnes->dot_renderer
+            && (ppu->masks.show_background || ppu->masks.show_sprites)) {
+            render_scanline(ppu);
+            ppu->dot = 256;
+            dots -= 256;
+            continue;
+        }
+
+        int idle = ppu_idle_dots(ppu);
+        if (idle > 0) {
+            int n = idle < dots ? idle : dots;
+            ppu->dot += n;
+            dots -= n;
+            continue;
+        }
+        ppu_tick(ppu, out_new_frame);
+        dots--;
+    }
+}
+
+int ppu_dots_until_event(const ppu_t *ppu) {
+    // Vblank at 241:1 sets the new-frame flag and may raise NMI
+    int pos = ppu->scanline * 341 + ppu->dot;
+    int dist = (241 * 341 + 1) - pos;
+    if (dist <= 0) {
+        dist += 262 * 341 - 1; // odd frames may be a dot shorter
+    }
+
+    // MMC3 counts PA12 edges once per line while rendering
+    if (ppu->agnes->gamepack.mapper == 4 && ppu->masks.show_background && ppu->masks.show_sprites) {
+        int edge = ppu->ctrl.bg_table_addr == 0x0000 ? 270 : 324;
+        int to_edge = ppu->dot < edge ? edge - ppu->dot : 340 - ppu->dot + edge;
+        if (to_edge < dist) {
+            dist = to_edge;
+        }
+    }
+    return dist;
+}
+
+void ppu_catch_up(agnes_t *agnes) {
+    if (agnes->ppu_pending_dots > 0) {
+        bool new_frame = false; // never inside the owed dots, see ppu_event_dots
+        ppu_run(&agnes->ppu, agnes->ppu_pending_dots, &new_frame);
+        agnes->ppu_pending_dots = 0;
+    }
+    agnes->ppu_event_dots = ppu_dots_until_event(&agnes->ppu);
+}
+
 static void scanline_visible_pre(ppu_t *ppu, bool *out_new_frame) {
     bool scanline_visible = ppu->scanline >= 0 && ppu->scanline < 240;
     bool scanline_pre = ppu->scanline == 261;
@@ -1214,30 +1944,183 @@ static void inc_vert_v(ppu_t *ppu) {
 #undef GET_FINE_Y
 #undef SET_FINE_Y
 
-static void eval_sprites(ppu_t *ppu) {
-    ppu->sprite_ixs_count = 0;
+// All 240 lines in one pass over OAM, in the order a per-line scan would
+// pick sprites: lower indices first, 8 per line, the ninth sets overflow
+static void build_line_sprites(ppu_t *ppu) {
+    agnes_t *agnes = ppu->agnes;
     const sprite_t* sprites = (const sprite_t*)ppu->oam_data;
     int sprite_height = ppu->ctrl.use_8x16_sprites ? 16 : 8;
+    memset(agnes->line_sprite_count, 0, sizeof(agnes->line_sprite_count));
     for (int i = 0; i < 64; i++) {
         const sprite_t* sprite = &sprites[i];
-
-        if (sprite->y_pos > 0xef || sprite->x_pos > 0xff) {
+        if (sprite->y_pos > 0xef) {
             continue;
         }
+        int end = sprite->y_pos + sprite_height;
+        for (int y = sprite->y_pos; y < end && y < 240; y++) {
+            uint8_t count = agnes->line_sprite_count[y];
+            if (count < 8) {
+                agnes->line_sprites[y][count] = (uint8_t)i;
+                agnes->line_sprite_count[y] = count + 1;
+            } else {
+                agnes->line_sprite_count[y] = 0x88;
+            }
+        }
+    }
+    agnes->line_sprites_8x16 = ppu->ctrl.use_8x16_sprites;
+    agnes->line_sprites_valid = true;
+}
+
+static void eval_sprites(ppu_t *ppu) {
+    agnes_t *agnes = ppu->agnes;
+    if (!agnes->line_sprites_valid || agnes->line_sprites_8x16 != ppu->ctrl.use_8x16_sprites) {
+        build_line_sprites(ppu);
+    }
+    const sprite_t* sprites = (const sprite_t*)ppu->oam_data;
+    int y = ppu->scanline;
+    int count = agnes->line_sprite_count[y] & 0xf;
+    for (int i = 0; i < count; i++) {
+        int ix = agnes->line_sprites[y][i];
+        ppu->sprites[i] = sprites[ix];
+        ppu->sprite_ixs[i] = ix;
+    }
+    ppu->sprite_ixs_count = count;
+    if (agnes->line_sprite_count[y] & 0x80) {
+        ppu->status.sprite_overflow = true;
+    }
+}
+
+// Dots 1-256 of a visible line, leaving the PPU exactly as 256 ppu_tick calls
+// would. Background tiles are decoded 8 pixels at a time and the sprites picked
+// by eval_sprites are merged in per line; a register write mid-line splits the
+// catch-up run, so the rest of that line goes through the dot path.
+static void render_scanline(ppu_t *ppu) {
+    const int y = ppu->scanline;
+    const int fine_x = ppu->regs.x;
+    const uint64_t lane_ones = 0x0101010101010101ull;
+
+    // Background stream: the two tiles already in the shifters, then the 32
+    // fetched on this line; pixel x is entry x + fine_x, as (palette << 2) | pixel
+    uint8_t bg[34 * 8];
+    uint64_t row = g_bitplane_spread[ppu->bg_lo_shift >> 8] | (g_bitplane_spread[ppu->bg_hi_shift >> 8] << 1);
+    for (int i = 0; i < 8; i++) {
+        uint8_t palette = (ppu->at_shift >> (14 - (i << 1))) & 0x3;
+        bg[i] = (uint8_t)((row >> (i * 8)) & 0x3) | (palette << 2);
+    }
+    row = g_bitplane_spread[ppu->bg_lo_shift & 0xff] | (g_bitplane_spread[ppu->bg_hi_shift & 0xff] << 1);
+    row |= lane_ones * (uint64_t)((ppu->at_latch & 0x3) << 2);
+    for (int i = 0; i < 8; i++) {
+        bg[8 + i] = (uint8_t)(row >> (i * 8));
+    }
+
+    uint8_t prev_lo = 0, prev_hi = 0, prev_at = 0;
+    for (int tile = 0; tile < 32; tile++) {
+        uint16_t v = ppu->regs.v;
+        ppu->nt = ppu_read8(ppu, 0x2000 | (v & 0x0fff));
+        ppu->at = ppu_read8(ppu, 0x23C0 | (v & 0x0C00) | ((v >> 4) & 0x38) | ((v >> 2) & 0x07));
+        if (v & 0x40) {
+            ppu->at = ppu->at >> 4;
+        }
+        if (v & 0x02) {
+            ppu->at = ppu->at >> 2;
+        }
+        uint16_t addr = ppu->ctrl.bg_table_addr + (ppu->nt << 4) + ((v >> 12) & 0x7);
+        if (tile < 30) {
+            row = ppu_tile_row(ppu, addr);
+        } else {
+            // The last two fetches stay in the shifters past dot 256
+            prev_lo = ppu->bg_lo;
+            prev_hi = ppu->bg_hi;
+            ppu->bg_lo = ppu_read8(ppu, addr);
+            ppu->bg_hi = ppu_read8(ppu, addr + 8);
+            row = g_bitplane_spread[ppu->bg_lo] | (g_bitplane_spread[ppu->bg_hi] << 1);
+        }
+
+        if (tile < 31) {
+            row |= lane_ones * (uint64_t)((ppu->at & 0x3) << 2);
+            for (int i = 0; i < 8; i++) {
+                bg[(tile + 2) * 8 + i] = (uint8_t)(row >> (i * 8));
+            }
+            inc_hori_v(ppu);
+        } else {
+            inc_vert_v(ppu); // dot 256
+        }
+        prev_at = ppu->at_latch;
+        ppu->at_latch = ppu->at & 0x3;
+    }
+
+    // Shifters as of dot 256: previous tile on top, last fetch below it,
+    // and the previous tile's palette shifted in for all 8 entries
+    ppu->bg_lo_shift = (uint16_t)((prev_lo << 8) | ppu->bg_lo);
+    ppu->bg_hi_shift = (uint16_t)((prev_hi << 8) | ppu->bg_hi);
+    ppu->at_shift = (uint16_t)(0x5555 * (prev_at & 0x3));
+
+    // Sprite line: lower slots win, as in get_sprite_color_addr
+    uint8_t sp[256];
+    uint8_t sp_ix[256];
+    memset(sp, 0, sizeof(sp));
+    if (ppu->masks.show_sprites) {
+        int sprite_height = ppu->ctrl.use_8x16_sprites ? 16 : 8;
+        for (int i = ppu->sprite_ixs_count - 1; i >= 0; i--) {
+            const sprite_t *sprite = &ppu->sprites[i];
+            int s_y = y - sprite->y_pos - 1;
+            s_y = AGNES_GET_BIT(sprite->attrs, 7) ? (sprite_height - 1 - s_y) : s_y; // flip vert
+
+            uint16_t table = ppu->ctrl.sprite_table_addr;
+            uint8_t tile_num = sprite->tile_num;
+            if (ppu->ctrl.use_8x16_sprites) {
+                table = tile_num & 0x1 ? 0x1000 : 0x0000;
+                tile_num &= 0xfe;
+                if (s_y >= 8) {
+                    tile_num += 1;
+                    s_y -= 8;
+                }
+            }
+            uint16_t offset = table + (tile_num << 4) + s_y;
+            row = ppu_pattern_row(ppu, offset);
+            if (!row) {
+                continue;
+            }
+            if (AGNES_GET_BIT(sprite->attrs, 6)) { // flip hor
+                row = reverse_lanes(row);
+            }
+
+            uint8_t attrs = 0x10 | ((sprite->attrs & 0x3) << 2) | (AGNES_GET_BIT(sprite->attrs, 5) << 5);
+            for (int s_x = 0; s_x < 8 && sprite->x_pos + s_x < 256; s_x++) {
+                uint8_t pixel = (row >> (s_x * 8)) & 0x3;
+                if (pixel) {
+                    sp[sprite->x_pos + s_x] = attrs | pixel;
+                    sp_ix[sprite->x_pos + s_x] = (uint8_t)ppu->sprite_ixs[i];
+                }
+            }
+        }
+    }
 
-        int s_y = ppu->scanline - sprite->y_pos;
-        if (s_y < 0 || s_y >= sprite_height) {
+    uint8_t *out = &ppu->screen_buffer[y * AGNES_SCREEN_WIDTH];
+    for (int x = 0; x < 256; x++) {
+        bool left = x < 8;
+        if (left && !ppu->masks.show_leftmost_bg && !ppu->masks.show_leftmost_sprites) {
+            out[x] = 63; // 63 is black in my default colour palette
             continue;
         }
 
-        if (ppu->sprite_ixs_count < 8) {
-            ppu->sprites[ppu->sprite_ixs_count] = *sprite;
-            ppu->sprite_ixs[ppu->sprite_ixs_count] = i;
-            ppu->sprite_ixs_count++;
-        } else {
-            ppu->status.sprite_overflow = true;
-            break;
+        uint8_t b = bg[x + fine_x];
+        bool bg_on = ppu->masks.show_background && (!left || ppu->masks.show_leftmost_bg) && (b & 0x3);
+        uint8_t s = sp[x];
+        bool sp_on = s && (!left || ppu->masks.show_leftmost_sprites);
+
+        uint8_t color = 0x00;
+        if (bg_on && sp_on) {
+            if (sp_ix[x] == 0 && x != 255) {
+                ppu->status.sprite_zero_hit = true;
+            }
+            color = (s & 0x20) ? (b & 0x0f) : (s & 0x1f);
+        } else if (bg_on) {
+            color = b & 0x0f;
+        } else if (sp_on) {
+            color = s & 0x1f;
         }
+        out[x] = ppu->palette[g_palette_addr_map[color]];
     }
 }
 
@@ -1327,23 +2210,13 @@ static uint16_t get_sprite_color_addr(ppu_t *ppu, int *out_sprite_ix, bool *out_
         }
 
         uint16_t offset = table + (tile_num << 4) + s_y;
+        uint8_t palette_ix = (uint8_t)(ppu_pattern_row(ppu, offset) >> (s_x * 8)) & 0x3;
 
-        uint8_t lo_byte = ppu_read8(ppu, offset);
-        uint8_t hi_byte = ppu_read8(ppu, offset + 8);
-
-        if (!lo_byte && !hi_byte) {
-            continue;
-        }
-
-        bool lo_bit = AGNES_GET_BIT(lo_byte, 7 - s_x);
-        bool hi_bit = AGNES_GET_BIT(hi_byte, 7 - s_x);
-
-        if (lo_bit || hi_bit) {
+        if (palette_ix) {
             *out_sprite_ix = ppu->sprite_ixs[i];
             if (AGNES_GET_BIT(sprite->attrs, 5)) {
                 *out_behind_bg = true;
             }
-            uint8_t palette_ix = ((uint8_t)hi_bit << 1) | (uint8_t)lo_bit;
             uint16_t color_address = 0x3f10 | ((sprite->attrs & 0x3) << 2) | palette_ix;
             return color_address;
         }
@@ -1412,6 +2285,7 @@ void ppu_write_register(ppu_t *ppu, uint16_t addr, uint8_t val) {
         case 0x2004: { // OAMDATA
             ppu->oam_data[ppu->oam_address] = val;
             ppu->oam_address++;
+            ppu->agnes->line_sprites_valid = false;
             break;
         }
         case 0x2005: { // SCROLL
@@ -1455,12 +2329,23 @@ void ppu_write_register(ppu_t *ppu, uint16_t addr, uint8_t val) {
             break;
         }
         case 0x4014: { // OAMDMA
-            uint16_t dma_addr = ((uint16_t)val) << 8;
-            for (int i = 0; i < 256; i++) {
-                ppu->oam_data[ppu->oam_address] = cpu_read8(&ppu->agnes->cpu, dma_addr);
-                ppu->oam_address++;
-                dma_addr++;
+            const uint8_t *page = ppu->agnes->read_pages[val];
+            if (page) {
+                // RAM or PRG through the page table: no side effects to
+                // replay, so copy the page in two runs wrapping at
+                // oam_address (which ends where it started)
+                unsigned split = 256 - ppu->oam_address;
+                memcpy(&ppu->oam_data[ppu->oam_address], page, split);
+                memcpy(ppu->oam_data, page + split, 256 - split);
+            } else {
+                uint16_t dma_addr = ((uint16_t)val) << 8;
+                for (int i = 0; i < 256; i++) {
+                    ppu->oam_data[ppu->oam_address] = cpu_read8(&ppu->agnes->cpu, dma_addr);
+                    ppu->oam_address++;
+                    dma_addr++;
+                }
             }
+            ppu->agnes->line_sprites_valid = false;
             cpu_set_dma_stall(&ppu->agnes->cpu);
             break;
         }
@@ -1489,14 +2374,87 @@ static uint8_t ppu_read8(ppu_t *ppu, uint16_t addr) {
 
 static void ppu_write8(ppu_t *ppu, uint16_t addr, uint8_t val) {
     addr = addr & 0x3fff;
+    agnes_t *agnes = ppu->agnes;
     if (addr >= 0x3f00) { // $3F00 - $3FFF
         int palette_ix = g_palette_addr_map[addr & 0x1f];
         ppu->palette[palette_ix] = val;
+        agnes->dirty_palette = true;
     } else if (addr < 0x2000) { // $0000 - $1FFF
-        mapper_write(ppu->agnes, addr, val);
+        mapper_write(agnes, addr, val);
+        agnes->dirty_tiles[addr >> 10] |= (uint64_t)1 << ((addr >> 4) & 63);
+        agnes->tile_valid[addr >> 10] &= ~((uint64_t)1 << ((addr >> 4) & 63));
     } else { // $2000 - $3EFF
         uint16_t mirrored_addr = mirror_address(ppu, addr);
         ppu->nametables[mirrored_addr] = val;
+        agnes->dirty_nametables |= (uint8_t)(1 << (mirrored_addr >> 10));
+    }
+}
+
+void ppu_mark_all_dirty(agnes_t *agnes) {
+    memset(agnes->dirty_tiles, 0xff, sizeof(agnes->dirty_tiles));
+    agnes->dirty_nametables = 0xf;
+    agnes->dirty_palette = true;
+}
+
+void agnes_take_ppu_dirty(agnes_t *agnes, agnes_ppu_dirty_t *out) {
+    memcpy(out->tiles, agnes->dirty_tiles, sizeof(out->tiles));
+    // Physical pages to the $2000-$2FFF windows that show them
+    out->nametables = 0;
+    for (int n = 0; n < 4; n++) {
+        uint16_t page = mirror_address(&agnes->ppu, (uint16_t)(0x2000 + n * 0x400)) >> 10;
+        if (agnes->dirty_nametables & (1 << page)) {
+            out->nametables |= (uint8_t)(1 << n);
+        }
+    }
+    if (agnes->mirroring_mode != agnes->dirty_mirroring) {
+        out->nametables = 0xf;
+        agnes->dirty_mirroring = agnes->mirroring_mode;
+    }
+    out->palette = agnes->dirty_palette;
+    memset(agnes->dirty_tiles, 0, sizeof(agnes->dirty_tiles));
+    agnes->dirty_nametables = 0;
+    agnes->dirty_palette = false;
+}
+
+void agnes_ppu_tile_pixels(agnes_t *agnes, int tile, uint8_t out[64]) {
+    for (int y = 0; y < 8; y++) {
+        uint64_t row = ppu_tile_row(&agnes->ppu, (uint16_t)(((tile & 511) << 4) | y));
+        for (int x = 0; x < 8; x++) {
+            out[y * 8 + x] = (uint8_t)(row >> (x * 8)) & 0x3;
+        }
+    }
+}
+
+uint8_t agnes_ppu_peek(const agnes_t *agnes, uint16_t addr) {
+    // Pattern, nametable and palette reads have no side effects
+    return ppu_read8(&((agnes_t*)agnes)->ppu, addr);
+}
+
+const uint8_t *agnes_get_oam(const agnes_t *agnes) {
+    return agnes->ppu.oam_data;
+}
+
+void agnes_get_ppu_info(const agnes_t *agnes, agnes_ppu_info_t *out) {
+    const ppu_t *ppu = &agnes->ppu;
+    out->bg_table = ppu->ctrl.bg_table_addr;
+    out->sprite_table = ppu->ctrl.sprite_table_addr;
+    out->sprites_8x16 = ppu->ctrl.use_8x16_sprites;
+    // t holds the scroll the next frame starts from: yyy NN YYYYY XXXXX
+    uint16_t t = ppu->regs.t;
+    out->scroll_x = (uint16_t)(((t & 0x1f) << 3) | ppu->regs.x | ((t & 0x400) ? 256 : 0));
+    out->scroll_y = (uint16_t)((((t >> 5) & 0x1f) << 3) | ((t >> 12) & 0x7) | ((t & 0x800) ? 240 : 0));
+}
+
+uint8_t *agnes_get_ram(agnes_t *agnes) {
+    return agnes->ram;
+}
+
+uint8_t *agnes_get_work_ram(agnes_t *agnes) {
+    switch (agnes->gamepack.mapper) {
+        case 1: return agnes->mapper.m1.prg_ram;
+        case 4: return agnes->mapper.m4.prg_ram;
+        case 24: case 26: return agnes->mapper.m24.prg_ram;
+        default: return NULL;
     }
 }
 
@@ -1513,6 +2471,8 @@ static uint16_t mirror_address(ppu_t *ppu, uint16_t addr) {
 }
 //FILE_END
 //FILE_START:instructions.c
+#include <stdio.h>
+
 #ifndef AGNES_AMALGAMATED
 #include "instructions.h"
 
@@ -1520,335 +2480,369 @@ static uint16_t mirror_address(ppu_t *ppu, uint16_t addr) {
 #include "cpu.h"
 #endif
 
-static int op_adc(cpu_t *cpu, uint16_t addr, addr_mode_t mode);
-static int op_and(cpu_t *cpu, uint16_t addr, addr_mode_t mode);
-static int op_asl(cpu_t *cpu, uint16_t addr, addr_mode_t mode);
-static int op_bcc(cpu_t *cpu, uint16_t addr, addr_mode_t mode);
-static int op_bcs(cpu_t *cpu, uint16_t addr, addr_mode_t mode);
-static int op_beq(cpu_t *cpu, uint16_t addr, addr_mode_t mode);
-static int op_bit(cpu_t *cpu, uint16_t addr, addr_mode_t mode);
-static int op_bmi(cpu_t *cpu, uint16_t addr, addr_mode_t mode);
-static int op_bne(cpu_t *cpu, uint16_t addr, addr_mode_t mode);
-static int op_bpl(cpu_t *cpu, uint16_t addr, addr_mode_t mode);
-static int op_brk(cpu_t *cpu, uint16_t addr, addr_mode_t mode);
-static int op_bvc(cpu_t *cpu, uint16_t addr, addr_mode_t mode);
-static int op_bvs(cpu_t *cpu, uint16_t addr, addr_mode_t mode);
-static int op_clc(cpu_t *cpu, uint16_t addr, addr_mode_t mode);
-static int op_cld(cpu_t *cpu, uint16_t addr, addr_mode_t mode);
-static int op_cli(cpu_t *cpu, uint16_t addr, addr_mode_t mode);
-static int op_clv(cpu_t *cpu, uint16_t addr, addr_mode_t mode);
-static int op_cmp(cpu_t *cpu, uint16_t addr, addr_mode_t mode);
-static int op_cpx(cpu_t *cpu, uint16_t addr, addr_mode_t mode);
-static int op_cpy(cpu_t *cpu, uint16_t addr, addr_mode_t mode);
-static int op_dec(cpu_t *cpu, uint16_t addr, addr_mode_t mode);
-static int op_dex(cpu_t *cpu, uint16_t addr, addr_mode_t mode);
-static int op_dey(cpu_t *cpu, uint16_t addr, addr_mode_t mode);
-static int op_eor(cpu_t *cpu, uint16_t addr, addr_mode_t mode);
-static int op_inc(cpu_t *cpu, uint16_t addr, addr_mode_t mode);
-static int op_inx(cpu_t *cpu, uint16_t addr, addr_mode_t mode);
-static int op_iny(cpu_t *cpu, uint16_t addr, addr_mode_t mode);
-static int op_jmp(cpu_t *cpu, uint16_t addr, addr_mode_t mode);
-static int op_jsr(cpu_t *cpu, uint16_t addr, addr_mode_t mode);
-static int op_lda(cpu_t *cpu, uint16_t addr, addr_mode_t mode);
-static int op_ldx(cpu_t *cpu, uint16_t addr, addr_mode_t mode);
-static int op_ldy(cpu_t *cpu, uint16_t addr, addr_mode_t mode);
-static int op_lsr(cpu_t *cpu, uint16_t addr, addr_mode_t mode);
-static int op_nop(cpu_t *cpu, uint16_t addr, addr_mode_t mode);
-static int op_ora(cpu_t *cpu, uint16_t addr, addr_mode_t mode);
-static int op_pha(cpu_t *cpu, uint16_t addr, addr_mode_t mode);
-static int op_php(cpu_t *cpu, uint16_t addr, addr_mode_t mode);
-static int op_pla(cpu_t *cpu, uint16_t addr, addr_mode_t mode);
-static int op_plp(cpu_t *cpu, uint16_t addr, addr_mode_t mode);
-static int op_rol(cpu_t *cpu, uint16_t addr, addr_mode_t mode);
-static int op_ror(cpu_t *cpu, uint16_t addr, addr_mode_t mode);
-static int op_rti(cpu_t *cpu, uint16_t addr, addr_mode_t mode);
-static int op_rts(cpu_t *cpu, uint16_t addr, addr_mode_t mode);
-static int op_sbc(cpu_t *cpu, uint16_t addr, addr_mode_t mode);
-static int op_sec(cpu_t *cpu, uint16_t addr, addr_mode_t mode);
-static int op_sed(cpu_t *cpu, uint16_t addr, addr_mode_t mode);
-static int op_sei(cpu_t *cpu, uint16_t addr, addr_mode_t mode);
-static int op_sta(cpu_t *cpu, uint16_t addr, addr_mode_t mode);
-static int op_stx(cpu_t *cpu, uint16_t addr, addr_mode_t mode);
-static int op_sty(cpu_t *cpu, uint16_t addr, addr_mode_t mode);
-static int op_tax(cpu_t *cpu, uint16_t addr, addr_mode_t mode);
-static int op_tay(cpu_t *cpu, uint16_t addr, addr_mode_t mode);
-static int op_tsx(cpu_t *cpu, uint16_t addr, addr_mode_t mode);
-static int op_txa(cpu_t *cpu, uint16_t addr, addr_mode_t mode);
-static int op_txs(cpu_t *cpu, uint16_t addr, addr_mode_t mode);
-static int op_tya(cpu_t *cpu, uint16_t addr, addr_mode_t mode);
-
-static int take_branch(cpu_t *cpu, uint16_t addr);
-
-#define INS(OPC, NAME, CYCLES, PCC, OP, MODE) { NAME, OPC, CYCLES, PCC, MODE, OP }
-#define INE(OPC) { "ILL", OPC, 1, false, ADDR_MODE_IMPLIED, NULL }
-
-static instruction_t instructions[256] = {
-    INS(0x00, "BRK", 7, false, op_brk, ADDR_MODE_IMPLIED_BRK),
-    INS(0x01, "ORA", 6, false, op_ora, ADDR_MODE_INDIRECT_X),
-    INE(0x02),
-    INE(0x03),
-    INE(0x04),
-    INS(0x05, "ORA", 3, false, op_ora, ADDR_MODE_ZERO_PAGE),
-    INS(0x06, "ASL", 5, false, op_asl, ADDR_MODE_ZERO_PAGE),
-    INE(0x07),
-    INS(0x08, "PHP", 3, false, op_php, ADDR_MODE_IMPLIED),
-    INS(0x09, "ORA", 2, false, op_ora, ADDR_MODE_IMMEDIATE),
-    INS(0x0a, "ASL", 2, false, op_asl, ADDR_MODE_ACCUMULATOR),
-    INE(0x0b),
-    INE(0x0c),
-    INS(0x0d, "ORA", 4, false, op_ora, ADDR_MODE_ABSOLUTE),
-    INS(0x0e, "ASL", 6, false, op_asl, ADDR_MODE_ABSOLUTE),
-    INE(0x0f),
-    INS(0x10, "BPL", 2, true,  op_bpl, ADDR_MODE_RELATIVE),
-    INS(0x11, "ORA", 5, true,  op_ora, ADDR_MODE_INDIRECT_Y),
-    INE(0x12),
-    INE(0x13),
-    INE(0x14),
-    INS(0x15, "ORA", 4, false, op_ora, ADDR_MODE_ZERO_PAGE_X),
-    INS(0x16, "ASL", 6, false, op_asl, ADDR_MODE_ZERO_PAGE_X),
-    INE(0x17),
-    INS(0x18, "CLC", 2, false, op_clc, ADDR_MODE_IMPLIED),
-    INS(0x19, "ORA", 4, true,  op_ora, ADDR_MODE_ABSOLUTE_Y),
-    INE(0x1a),
-    INE(0x1b),
-    INE(0x1c),
-    INS(0x1d, "ORA", 4, true,  op_ora, ADDR_MODE_ABSOLUTE_X),
-    INS(0x1e, "ASL", 7, false, op_asl, ADDR_MODE_ABSOLUTE_X),
-    INE(0x1f),
-    INS(0x20, "JSR", 6, false, op_jsr, ADDR_MODE_ABSOLUTE),
-    INS(0x21, "AND", 6, false, op_and, ADDR_MODE_INDIRECT_X),
-    INE(0x22),
-    INE(0x23),
-    INS(0x24, "BIT", 3, false, op_bit, ADDR_MODE_ZERO_PAGE),
-    INS(0x25, "AND", 3, false, op_and, ADDR_MODE_ZERO_PAGE),
-    INS(0x26, "ROL", 5, false, op_rol, ADDR_MODE_ZERO_PAGE),
-    INE(0x27),
-    INS(0x28, "PLP", 4, false, op_plp, ADDR_MODE_IMPLIED),
-    INS(0x29, "AND", 2, false, op_and, ADDR_MODE_IMMEDIATE),
-    INS(0x2a, "ROL", 2, false, op_rol, ADDR_MODE_ACCUMULATOR),
-    INE(0x2b),
-    INS(0x2c, "BIT", 4, false, op_bit, ADDR_MODE_ABSOLUTE),
-    INS(0x2d, "AND", 4, false, op_and, ADDR_MODE_ABSOLUTE),
-    INS(0x2e, "ROL", 6, false, op_rol, ADDR_MODE_ABSOLUTE),
-    INE(0x2f),
-    INS(0x30, "BMI", 2, true,  op_bmi, ADDR_MODE_RELATIVE),
-    INS(0x31, "AND", 5, true,  op_and, ADDR_MODE_INDIRECT_Y),
-    INE(0x32),
-    INE(0x33),
-    INE(0x34),
-    INS(0x35, "AND", 4, false, op_and, ADDR_MODE_ZERO_PAGE_X),
-    INS(0x36, "ROL", 6, false, op_rol, ADDR_MODE_ZERO_PAGE_X),
-    INE(0x37),
-    INS(0x38, "SEC", 2, false, op_sec, ADDR_MODE_IMPLIED),
-    INS(0x39, "AND", 4, true,  op_and, ADDR_MODE_ABSOLUTE_Y),
-    INE(0x3a),
-    INE(0x3b),
-    INE(0x3c),
-    INS(0x3d, "AND", 4, true,  op_and, ADDR_MODE_ABSOLUTE_X),
-    INS(0x3e, "ROL", 7, false, op_rol, ADDR_MODE_ABSOLUTE_X),
-    INE(0x3f),
-    INS(0x40, "RTI", 6, false, op_rti, ADDR_MODE_IMPLIED),
-    INS(0x41, "EOR", 6, false, op_eor, ADDR_MODE_INDIRECT_X),
-    INE(0x42),
-    INE(0x43),
-    INE(0x44),
-    INS(0x45, "EOR", 3, false, op_eor, ADDR_MODE_ZERO_PAGE),
-    INS(0x46, "LSR", 5, false, op_lsr, ADDR_MODE_ZERO_PAGE),
-    INE(0x47),
-    INS(0x48, "PHA", 3, false, op_pha, ADDR_MODE_IMPLIED),
-    INS(0x49, "EOR", 2, false, op_eor, ADDR_MODE_IMMEDIATE),
-    INS(0x4a, "LSR", 2, false, op_lsr, ADDR_MODE_ACCUMULATOR),
-    INE(0x4b),
-    INS(0x4c, "JMP", 3, false, op_jmp, ADDR_MODE_ABSOLUTE),
-    INS(0x4d, "EOR", 4, false, op_eor, ADDR_MODE_ABSOLUTE),
-    INS(0x4e, "LSR", 6, false, op_lsr, ADDR_MODE_ABSOLUTE),
-    INE(0x4f),
-    INS(0x50, "BVC", 2, true,  op_bvc, ADDR_MODE_RELATIVE),
-    INS(0x51, "EOR", 5, true,  op_eor, ADDR_MODE_INDIRECT_Y),
-    INE(0x52),
-    INE(0x53),
-    INE(0x54),
-    INS(0x55, "EOR", 4, false, op_eor, ADDR_MODE_ZERO_PAGE_X),
-    INS(0x56, "LSR", 6, false, op_lsr, ADDR_MODE_ZERO_PAGE_X),
-    INE(0x57),
-    INS(0x58, "CLI", 2, false, op_cli, ADDR_MODE_IMPLIED),
-    INS(0x59, "EOR", 4, true,  op_eor, ADDR_MODE_ABSOLUTE_Y),
-    INE(0x5a),
-    INE(0x5b),
-    INE(0x5c),
-    INS(0x5d, "EOR", 4, true,  op_eor, ADDR_MODE_ABSOLUTE_X),
-    INS(0x5e, "LSR", 7, false, op_lsr, ADDR_MODE_ABSOLUTE_X),
-    INE(0x5f),
-    INS(0x60, "RTS", 6, false, op_rts, ADDR_MODE_IMPLIED),
-    INS(0x61, "ADC", 6, false, op_adc, ADDR_MODE_INDIRECT_X),
-    INE(0x62),
-    INE(0x63),
-    INE(0x64),
-    INS(0x65, "ADC", 3, false, op_adc, ADDR_MODE_ZERO_PAGE),
-    INS(0x66, "ROR", 5, false, op_ror, ADDR_MODE_ZERO_PAGE),
-    INE(0x67),
-    INS(0x68, "PLA", 4, false, op_pla, ADDR_MODE_IMPLIED),
-    INS(0x69, "ADC", 2, false, op_adc, ADDR_MODE_IMMEDIATE),
-    INS(0x6a, "ROR", 2, false, op_ror, ADDR_MODE_ACCUMULATOR),
-    INE(0x6b),
-    INS(0x6c, "JMP", 5, false, op_jmp, ADDR_MODE_INDIRECT),
-    INS(0x6d, "ADC", 4, false,  op_adc, ADDR_MODE_ABSOLUTE),
-    INS(0x6e, "ROR", 6, false, op_ror, ADDR_MODE_ABSOLUTE),
-    INE(0x6f),
-    INS(0x70, "BVS", 2, true,  op_bvs, ADDR_MODE_RELATIVE),
-    INS(0x71, "ADC", 5, true,  op_adc, ADDR_MODE_INDIRECT_Y),
-    INE(0x72),
-    INE(0x73),
-    INE(0x74),
-    INS(0x75, "ADC", 4, false, op_adc, ADDR_MODE_ZERO_PAGE_X),
-    INS(0x76, "ROR", 6, false, op_ror, ADDR_MODE_ZERO_PAGE_X),
-    INE(0x77),
-    INS(0x78, "SEI", 2, false, op_sei, ADDR_MODE_IMPLIED),
-    INS(0x79, "ADC", 4, true,  op_adc, ADDR_MODE_ABSOLUTE_Y),
-    INE(0x7a),
-    INE(0x7b),
-    INE(0x7c),
-    INS(0x7d, "ADC", 4, true,  op_adc, ADDR_MODE_ABSOLUTE_X),
-    INS(0x7e, "ROR", 7, false, op_ror, ADDR_MODE_ABSOLUTE_X),
-    INE(0x7f),
-    INE(0x80),
-    INS(0x81, "STA", 6, false, op_sta, ADDR_MODE_INDIRECT_X),
-    INE(0x82),
-    INE(0x83),
-    INS(0x84, "STY", 3, false, op_sty, ADDR_MODE_ZERO_PAGE),
-    INS(0x85, "STA", 3, false, op_sta, ADDR_MODE_ZERO_PAGE),
-    INS(0x86, "STX", 3, false, op_stx, ADDR_MODE_ZERO_PAGE),
-    INE(0x87),
-    INS(0x88, "DEY", 2, false, op_dey, ADDR_MODE_IMPLIED),
-    INE(0x89),
-    INS(0x8a, "TXA", 2, false, op_txa, ADDR_MODE_IMPLIED),
-    INE(0x8b),
-    INS(0x8c, "STY", 4, false, op_sty, ADDR_MODE_ABSOLUTE),
-    INS(0x8d, "STA", 4, false, op_sta, ADDR_MODE_ABSOLUTE),
-    INS(0x8e, "STX", 4, false, op_stx, ADDR_MODE_ABSOLUTE),
-    INE(0x8f),
-    INS(0x90, "BCC", 2, true,  op_bcc, ADDR_MODE_RELATIVE),
-    INS(0x91, "STA", 6, false, op_sta, ADDR_MODE_INDIRECT_Y),
-    INE(0x92),
-    INE(0x93),
-    INS(0x94, "STY", 4, false, op_sty, ADDR_MODE_ZERO_PAGE_X),
-    INS(0x95, "STA", 4, false, op_sta, ADDR_MODE_ZERO_PAGE_X),
-    INS(0x96, "STX", 4, false, op_stx, ADDR_MODE_ZERO_PAGE_Y),
-    INE(0x97),
-    INS(0x98, "TYA", 2, false, op_tya, ADDR_MODE_IMPLIED),
-    INS(0x99, "STA", 5, false, op_sta, ADDR_MODE_ABSOLUTE_Y),
-    INS(0x9a, "TXS", 2, false, op_txs, ADDR_MODE_IMPLIED),
-    INE(0x9b),
-    INE(0x9c),
-    INS(0x9d, "STA", 5, false, op_sta, ADDR_MODE_ABSOLUTE_X),
-    INE(0x9e),
-    INE(0x9f),
-    INS(0xa0, "LDY", 2, false, op_ldy, ADDR_MODE_IMMEDIATE),
-    INS(0xa1, "LDA", 6, false, op_lda, ADDR_MODE_INDIRECT_X),
-    INS(0xa2, "LDX", 2, false, op_ldx, ADDR_MODE_IMMEDIATE),
-    INE(0xa3),
-    INS(0xa4, "LDY", 3, false, op_ldy, ADDR_MODE_ZERO_PAGE),
-    INS(0xa5, "LDA", 3, false, op_lda, ADDR_MODE_ZERO_PAGE),
-    INS(0xa6, "LDX", 3, false, op_ldx, ADDR_MODE_ZERO_PAGE),
-    INE(0xa7),
-    INS(0xa8, "TAY", 2, false, op_tay, ADDR_MODE_IMPLIED),
-    INS(0xa9, "LDA", 2, false, op_lda, ADDR_MODE_IMMEDIATE),
-    INS(0xaa, "TAX", 2, false, op_tax, ADDR_MODE_IMPLIED),
-    INE(0xab),
-    INS(0xac, "LDY", 4, false, op_ldy, ADDR_MODE_ABSOLUTE),
-    INS(0xad, "LDA", 4, false, op_lda, ADDR_MODE_ABSOLUTE),
-    INS(0xae, "LDX", 4, false, op_ldx, ADDR_MODE_ABSOLUTE),
-    INE(0xaf),
-    INS(0xb0, "BCS", 2, true,  op_bcs, ADDR_MODE_RELATIVE),
-    INS(0xb1, "LDA", 5, true,  op_lda, ADDR_MODE_INDIRECT_Y),
-    INE(0xb2),
-    INE(0xb3),
-    INS(0xb4, "LDY", 4, false, op_ldy, ADDR_MODE_ZERO_PAGE_X),
-    INS(0xb5, "LDA", 4, false, op_lda, ADDR_MODE_ZERO_PAGE_X),
-    INS(0xb6, "LDX", 4, false, op_ldx, ADDR_MODE_ZERO_PAGE_Y),
-    INE(0xb7),
-    INS(0xb8, "CLV", 2, false, op_clv, ADDR_MODE_IMPLIED),
-    INS(0xb9, "LDA", 4, true,  op_lda, ADDR_MODE_ABSOLUTE_Y),
-    INS(0xba, "TSX", 2, false, op_tsx, ADDR_MODE_IMPLIED),
-    INE(0xbb),
-    INS(0xbc, "LDY", 4, true,  op_ldy, ADDR_MODE_ABSOLUTE_X),
-    INS(0xbd, "LDA", 4, true,  op_lda, ADDR_MODE_ABSOLUTE_X),
-    INS(0xbe, "LDX", 4, true,  op_ldx, ADDR_MODE_ABSOLUTE_Y),
-    INE(0xbf),
-    INS(0xc0, "CPY", 2, false, op_cpy, ADDR_MODE_IMMEDIATE),
-    INS(0xc1, "CMP", 6, false, op_cmp, ADDR_MODE_INDIRECT_X),
-    INE(0xc2),
-    INE(0xc3),
-    INS(0xc4, "CPY", 3, false, op_cpy, ADDR_MODE_ZERO_PAGE),
-    INS(0xc5, "CMP", 3, false, op_cmp, ADDR_MODE_ZERO_PAGE),
-    INS(0xc6, "DEC", 5, false, op_dec, ADDR_MODE_ZERO_PAGE),
-    INE(0xc7),
-    INS(0xc8, "INY", 2, false, op_iny, ADDR_MODE_IMPLIED),
-    INS(0xc9, "CMP", 2, false, op_cmp, ADDR_MODE_IMMEDIATE),
-    INS(0xca, "DEX", 2, false, op_dex, ADDR_MODE_IMPLIED),
-    INE(0xcb),
-    INS(0xcc, "CPY", 4, false, op_cpy, ADDR_MODE_ABSOLUTE),
-    INS(0xcd, "CMP", 4, false, op_cmp, ADDR_MODE_ABSOLUTE),
-    INS(0xce, "DEC", 6, false, op_dec, ADDR_MODE_ABSOLUTE),
-    INE(0xcf),
-    INS(0xd0, "BNE", 2, true,  op_bne, ADDR_MODE_RELATIVE),
-    INS(0xd1, "CMP", 5, true,  op_cmp, ADDR_MODE_INDIRECT_Y),
-    INE(0xd2),
-    INE(0xd3),
-    INE(0xd4),
-    INS(0xd5, "CMP", 4, false, op_cmp, ADDR_MODE_ZERO_PAGE_X),
-    INS(0xd6, "DEC", 6, false, op_dec, ADDR_MODE_ZERO_PAGE_X),
-    INE(0xd7),
-    INS(0xd8, "CLD", 2, false, op_cld, ADDR_MODE_IMPLIED),
-    INS(0xd9, "CMP", 4, true,  op_cmp, ADDR_MODE_ABSOLUTE_Y),
-    INE(0xda),
-    INE(0xdb),
-    INE(0xdc),
-    INS(0xdd, "CMP", 4, true,  op_cmp, ADDR_MODE_ABSOLUTE_X),
-    INS(0xde, "DEC", 7, false, op_dec, ADDR_MODE_ABSOLUTE_X),
-    INE(0xdf),
-    INS(0xe0, "CPX", 2, false, op_cpx, ADDR_MODE_IMMEDIATE),
-    INS(0xe1, "SBC", 6, false, op_sbc, ADDR_MODE_INDIRECT_X),
-    INE(0xe2),
-    INE(0xe3),
-    INS(0xe4, "CPX", 3, false, op_cpx, ADDR_MODE_ZERO_PAGE),
-    INS(0xe5, "SBC", 3, false, op_sbc, ADDR_MODE_ZERO_PAGE),
-    INS(0xe6, "INC", 5, false, op_inc, ADDR_MODE_ZERO_PAGE),
-    INE(0xe7),
-    INS(0xe8, "INX", 2, false, op_inx, ADDR_MODE_IMPLIED),
-    INS(0xe9, "SBC", 2, false, op_sbc, ADDR_MODE_IMMEDIATE),
-    INS(0xea, "NOP", 2, false, op_nop, ADDR_MODE_IMPLIED),
-    INE(0xeb),
-    INS(0xec, "CPX", 4, false, op_cpx, ADDR_MODE_ABSOLUTE),
-    INS(0xed, "SBC", 4, false, op_sbc, ADDR_MODE_ABSOLUTE),
-    INS(0xee, "INC", 6, false, op_inc, ADDR_MODE_ABSOLUTE),
-    INE(0xef),
-    INS(0xf0, "BEQ", 2, true,  op_beq, ADDR_MODE_RELATIVE),
-    INS(0xf1, "SBC", 5, true,  op_sbc, ADDR_MODE_INDIRECT_Y),
-    INE(0xf2),
-    INE(0xf3),
-    INE(0xf4),
-    INS(0xf5, "SBC", 4, false, op_sbc, ADDR_MODE_ZERO_PAGE_X),
-    INS(0xf6, "INC", 6, false, op_inc, ADDR_MODE_ZERO_PAGE_X),
-    INE(0xf7),
-    INS(0xf8, "SED", 2, false, op_sed, ADDR_MODE_IMPLIED),
-    INS(0xf9, "SBC", 4, true,  op_sbc, ADDR_MODE_ABSOLUTE_Y),
-    INE(0xfa),
-    INE(0xfb),
-    INE(0xfc),
-    INS(0xfd, "SBC", 4, true,  op_sbc, ADDR_MODE_ABSOLUTE_X),
-    INS(0xfe, "INC", 7, false, op_inc, ADDR_MODE_ABSOLUTE_X),
-    INE(0xff),
-};
+static AGNES_FORCE_INLINE int op_adc(cpu_t *cpu, uint16_t addr, addr_mode_t mode);
+static AGNES_FORCE_INLINE int op_and(cpu_t *cpu, uint16_t addr, addr_mode_t mode);
+static AGNES_FORCE_INLINE int op_asl(cpu_t *cpu, uint16_t addr, addr_mode_t mode);
+static AGNES_FORCE_INLINE int op_bcc(cpu_t *cpu, uint16_t addr, addr_mode_t mode);
+static AGNES_FORCE_INLINE int op_bcs(cpu_t *cpu, uint16_t addr, addr_mode_t mode);
+static AGNES_FORCE_INLINE int op_beq(cpu_t *cpu, uint16_t addr, addr_mode_t mode);
+static AGNES_FORCE_INLINE int op_bit(cpu_t *cpu, uint16_t addr, addr_mode_t mode);
+static AGNES_FORCE_INLINE int op_bmi(cpu_t *cpu, uint16_t addr, addr_mode_t mode);
+static AGNES_FORCE_INLINE int op_bne(cpu_t *cpu, uint16_t addr, addr_mode_t mode);
+static AGNES_FORCE_INLINE int op_bpl(cpu_t *cpu, uint16_t addr, addr_mode_t mode);
+static AGNES_FORCE_INLINE int op_brk(cpu_t *cpu, uint16_t addr, addr_mode_t mode);
+static AGNES_FORCE_INLINE int op_bvc(cpu_t *cpu, uint16_t addr, addr_mode_t mode);
+static AGNES_FORCE_INLINE int op_bvs(cpu_t *cpu, uint16_t addr, addr_mode_t mode);
+static AGNES_FORCE_INLINE int op_clc(cpu_t *cpu, uint16_t addr, addr_mode_t mode);
+static AGNES_FORCE_INLINE int op_cld(cpu_t *cpu, uint16_t addr, addr_mode_t mode);
+static AGNES_FORCE_INLINE int op_cli(cpu_t *cpu, uint16_t addr, addr_mode_t mode);
+static AGNES_FORCE_INLINE int op_clv(cpu_t *cpu, uint16_t addr, addr_mode_t mode);
+static AGNES_FORCE_INLINE int op_cmp(cpu_t *cpu, uint16_t addr, addr_mode_t mode);
+static AGNES_FORCE_INLINE int op_cpx(cpu_t *cpu, uint16_t addr, addr_mode_t mode);
+static AGNES_FORCE_INLINE int op_cpy(cpu_t *cpu, uint16_t addr, addr_mode_t mode);
+static AGNES_FORCE_INLINE int op_dec(cpu_t *cpu, uint16_t addr, addr_mode_t mode);
+static AGNES_FORCE_INLINE int op_dex(cpu_t *cpu, uint16_t addr, addr_mode_t mode);
+static AGNES_FORCE_INLINE int op_dey(cpu_t *cpu, uint16_t addr, addr_mode_t mode);
+static AGNES_FORCE_INLINE int op_eor(cpu_t *cpu, uint16_t addr, addr_mode_t mode);
+static AGNES_FORCE_INLINE int op_inc(cpu_t *cpu, uint16_t addr, addr_mode_t mode);
+static AGNES_FORCE_INLINE int op_inx(cpu_t *cpu, uint16_t addr, addr_mode_t mode);
+static AGNES_FORCE_INLINE int op_iny(cpu_t *cpu, uint16_t addr, addr_mode_t mode);
+static AGNES_FORCE_INLINE int op_jmp(cpu_t *cpu, uint16_t addr, addr_mode_t mode);
+static AGNES_FORCE_INLINE int op_jsr(cpu_t *cpu, uint16_t addr, addr_mode_t mode);
+static AGNES_FORCE_INLINE int op_lda(cpu_t *cpu, uint16_t addr, addr_mode_t mode);
+static AGNES_FORCE_INLINE int op_ldx(cpu_t *cpu, uint16_t addr, addr_mode_t mode);
+static AGNES_FORCE_INLINE int op_ldy(cpu_t *cpu, uint16_t addr, addr_mode_t mode);
+static AGNES_FORCE_INLINE int op_lsr(cpu_t *cpu, uint16_t addr, addr_mode_t mode);
+static AGNES_FORCE_INLINE int op_nop(cpu_t *cpu, uint16_t addr, addr_mode_t mode);
+static AGNES_FORCE_INLINE int op_ora(cpu_t *cpu, uint16_t addr, addr_mode_t mode);
+static AGNES_FORCE_INLINE int op_pha(cpu_t *cpu, uint16_t addr, addr_mode_t mode);
+static AGNES_FORCE_INLINE int op_php(cpu_t *cpu, uint16_t addr, addr_mode_t mode);
+static AGNES_FORCE_INLINE int op_pla(cpu_t *cpu, uint16_t addr, addr_mode_t mode);
+static AGNES_FORCE_INLINE int op_plp(cpu_t *cpu, uint16_t addr, addr_mode_t mode);
+static AGNES_FORCE_INLINE int op_rol(cpu_t *cpu, uint16_t addr, addr_mode_t mode);
+static AGNES_FORCE_INLINE int op_ror(cpu_t *cpu, uint16_t addr, addr_mode_t mode);
+static AGNES_FORCE_INLINE int op_rti(cpu_t *cpu, uint16_t addr, addr_mode_t mode);
+static AGNES_FORCE_INLINE int op_rts(cpu_t *cpu, uint16_t addr, addr_mode_t mode);
+static AGNES_FORCE_INLINE int op_sbc(cpu_t *cpu, uint16_t addr, addr_mode_t mode);
+static AGNES_FORCE_INLINE int op_sec(cpu_t *cpu, uint16_t addr, addr_mode_t mode);
+static AGNES_FORCE_INLINE int op_sed(cpu_t *cpu, uint16_t addr, addr_mode_t mode);
+static AGNES_FORCE_INLINE int op_sei(cpu_t *cpu, uint16_t addr, addr_mode_t mode);
+static AGNES_FORCE_INLINE int op_sta(cpu_t *cpu, uint16_t addr, addr_mode_t mode);
+static AGNES_FORCE_INLINE int op_stx(cpu_t *cpu, uint16_t addr, addr_mode_t mode);
+static AGNES_FORCE_INLINE int op_sty(cpu_t *cpu, uint16_t addr, addr_mode_t mode);
+static AGNES_FORCE_INLINE int op_tax(cpu_t *cpu, uint16_t addr, addr_mode_t mode);
+static AGNES_FORCE_INLINE int op_tay(cpu_t *cpu, uint16_t addr, addr_mode_t mode);
+static AGNES_FORCE_INLINE int op_tsx(cpu_t *cpu, uint16_t addr, addr_mode_t mode);
+static AGNES_FORCE_INLINE int op_txa(cpu_t *cpu, uint16_t addr, addr_mode_t mode);
+static AGNES_FORCE_INLINE int op_txs(cpu_t *cpu, uint16_t addr, addr_mode_t mode);
+static AGNES_FORCE_INLINE int op_tya(cpu_t *cpu, uint16_t addr, addr_mode_t mode);
+
+static AGNES_FORCE_INLINE int take_branch(cpu_t *cpu, uint16_t addr);
+
+// One row per opcode (opcode, name, cycles, page-cross cycle, op, mode); INE is illegal
+#define AGNES_INSTRUCTIONS(INS, INE) \
+    INS(0x00, "BRK", 7, false, op_brk, ADDR_MODE_IMPLIED_BRK) \
+    INS(0x01, "ORA", 6, false, op_ora, ADDR_MODE_INDIRECT_X)  \
+    INE(0x02)                                                 \
+    INE(0x03)                                                 \
+    INE(0x04)                                                 \
+    INS(0x05, "ORA", 3, false, op_ora, ADDR_MODE_ZERO_PAGE)   \
+    INS(0x06, "ASL", 5, false, op_asl, ADDR_MODE_ZERO_PAGE)   \
+    INE(0x07)                                                 \
+    INS(0x08, "PHP", 3, false, op_php, ADDR_MODE_IMPLIED)     \
+    INS(0x09, "ORA", 2, false, op_ora, ADDR_MODE_IMMEDIATE)   \
+    INS(0x0a, "ASL", 2, false, op_asl, ADDR_MODE_ACCUMULATOR) \
+    INE(0x0b)                                                 \
+    INE(0x0c)                                                 \
+    INS(0x0d, "ORA", 4, false, op_ora, ADDR_MODE_ABSOLUTE)    \
+    INS(0x0e, "ASL", 6, false, op_asl, ADDR_MODE_ABSOLUTE)    \
+    INE(0x0f)                                                 \
+    INS(0x10, "BPL", 2, true,  op_bpl, ADDR_MODE_RELATIVE)    \
+    INS(0x11, "ORA", 5, true,  op_ora, ADDR_MODE_INDIRECT_Y)  \
+    INE(0x12)                                                 \
+    INE(0x13)                                                 \
+    INE(0x14)                                                 \
+    INS(0x15, "ORA", 4, false, op_ora, ADDR_MODE_ZERO_PAGE_X) \
+    INS(0x16, "ASL", 6, false, op_asl, ADDR_MODE_ZERO_PAGE_X) \
+    INE(0x17)                                                 \
+    INS(0x18, "CLC", 2, false, op_clc, ADDR_MODE_IMPLIED)     \
+    INS(0x19, "ORA", 4, true,  op_ora, ADDR_MODE_ABSOLUTE_Y)  \
+    INE(0x1a)                                                 \
+    INE(0x1b)                                                 \
+    INE(0x1c)                                                 \
+    INS(0x1d, "ORA", 4, true,  op_ora, ADDR_MODE_ABSOLUTE_X)  \
+    INS(0x1e, "ASL", 7, false, op_asl, ADDR_MODE_ABSOLUTE_X)  \
+    INE(0x1f)                                                 \
+    INS(0x20, "JSR", 6, false, op_jsr, ADDR_MODE_ABSOLUTE)    \
+    INS(0x21, "AND", 6, false, op_and, ADDR_MODE_INDIRECT_X)  \
+    INE(0x22)                                                 \
+    INE(0x23)                                                 \
+    INS(0x24, "BIT", 3, false, op_bit, ADDR_MODE_ZERO_PAGE)   \
+    INS(0x25, "AND", 3, false, op_and, ADDR_MODE_ZERO_PAGE)   \
+    INS(0x26, "ROL", 5, false, op_rol, ADDR_MODE_ZERO_PAGE)   \
+    INE(0x27)                                                 \
+    INS(0x28, "PLP", 4, false, op_plp, ADDR_MODE_IMPLIED)     \
+    INS(0x29, "AND", 2, false, op_and, ADDR_MODE_IMMEDIATE)   \
+    INS(0x2a, "ROL", 2, false, op_rol, ADDR_MODE_ACCUMULATOR) \
+    INE(0x2b)                                                 \
+    INS(0x2c, "BIT", 4, false, op_bit, ADDR_MODE_ABSOLUTE)    \
+    INS(0x2d, "AND", 4, false, op_and, ADDR_MODE_ABSOLUTE)    \
+    INS(0x2e, "ROL", 6, false, op_rol, ADDR_MODE_ABSOLUTE)    \
+    INE(0x2f)                                                 \
+    INS(0x30, "BMI", 2, true,  op_bmi, ADDR_MODE_RELATIVE)    \
+    INS(0x31, "AND", 5, true,  op_and, ADDR_MODE_INDIRECT_Y)  \
+    INE(0x32)                                                 \
+    INE(0x33)                                                 \
+    INE(0x34)                                                 \
+    INS(0x35, "AND", 4, false, op_and, ADDR_MODE_ZERO_PAGE_X) \
+    INS(0x36, "ROL", 6, false, op_rol, ADDR_MODE_ZERO_PAGE_X) \
+    INE(0x37)                                                 \
+    INS(0x38, "SEC", 2, false, op_sec, ADDR_MODE_IMPLIED)     \
+    INS(0x39, "AND", 4, true,  op_and, ADDR_MODE_ABSOLUTE_Y)  \
+    INE(0x3a)                                                 \
+    INE(0x3b)                                                 \
+    INE(0x3c)                                                 \
+    INS(0x3d, "AND", 4, true,  op_and, ADDR_MODE_ABSOLUTE_X)  \
+    INS(0x3e, "ROL", 7, false, op_rol, ADDR_MODE_ABSOLUTE_X)  \
+    INE(0x3f)                                                 \
+    INS(0x40, "RTI", 6, false, op_rti, ADDR_MODE_IMPLIED)     \
+    INS(0x41, "EOR", 6, false, op_eor, ADDR_MODE_INDIRECT_X)  \
+    INE(0x42)                                                 \
+    INE(0x43)                                                 \
+    INE(0x44)                                                 \
+    INS(0x45, "EOR", 3, false, op_eor, ADDR_MODE_ZERO_PAGE)   \
+    INS(0x46, "LSR", 5, false, op_lsr, ADDR_MODE_ZERO_PAGE)   \
+    INE(0x47)                                                 \
+    INS(0x48, "PHA", 3, false, op_pha, ADDR_MODE_IMPLIED)     \
+    INS(0x49, "EOR", 2, false, op_eor, ADDR_MODE_IMMEDIATE)   \
+    INS(0x4a, "LSR", 2, false, op_lsr, ADDR_MODE_ACCUMULATOR) \
+    INE(0x4b)                                                 \
+    INS(0x4c, "JMP", 3, false, op_jmp, ADDR_MODE_ABSOLUTE)    \
+    INS(0x4d, "EOR", 4, false, op_eor, ADDR_MODE_ABSOLUTE)    \
+    INS(0x4e, "LSR", 6, false, op_lsr, ADDR_MODE_ABSOLUTE)    \
+    INE(0x4f)                                                 \
+    INS(0x50, "BVC", 2, true,  op_bvc, ADDR_MODE_RELATIVE)    \
+    INS(0x51, "EOR", 5, true,  op_eor, ADDR_MODE_INDIRECT_Y)  \
+    INE(0x52)                                                 \
+    INE(0x53)                                                 \
+    INE(0x54)                                                 \
+    INS(0x55, "EOR", 4, false, op_eor, ADDR_MODE_ZERO_PAGE_X) \
+    INS(0x56, "LSR", 6, false, op_lsr, ADDR_MODE_ZERO_PAGE_X) \
+    INE(0x57)                                                 \
+    INS(0x58, "CLI", 2, false, op_cli, ADDR_MODE_IMPLIED)     \
+    INS(0x59, "EOR", 4, true,  op_eor, ADDR_MODE_ABSOLUTE_Y)  \
+    INE(0x5a)                                                 \
+    INE(0x5b)                                                 \
+    INE(0x5c)                                                 \
+    INS(0x5d, "EOR", 4, true,  op_eor, ADDR_MODE_ABSOLUTE_X)  \
+    INS(0x5e, "LSR", 7, false, op_lsr, ADDR_MODE_ABSOLUTE_X)  \
+    INE(0x5f)                                                 \
+    INS(0x60, "RTS", 6, false, op_rts, ADDR_MODE_IMPLIED)     \
+    INS(0x61, "ADC", 6, false, op_adc, ADDR_MODE_INDIRECT_X)  \
+    INE(0x62)                                                 \
+    INE(0x63)                                                 \
+    INE(0x64)                                                 \
+    INS(0x65, "ADC", 3, false, op_adc, ADDR_MODE_ZERO_PAGE)   \
+    INS(0x66, "ROR", 5, false, op_ror, ADDR_MODE_ZERO_PAGE)   \
+    INE(0x67)                                                 \
+    INS(0x68, "PLA", 4, false, op_pla, ADDR_MODE_IMPLIED)     \
+    INS(0x69, "ADC", 2, false, op_adc, ADDR_MODE_IMMEDIATE)   \
+    INS(0x6a, "ROR", 2, false, op_ror, ADDR_MODE_ACCUMULATOR) \
+    INE(0x6b)                                                 \
+    INS(0x6c, "JMP", 5, false, op_jmp, ADDR_MODE_INDIRECT)    \
+    INS(0x6d, "ADC", 4, false,  op_adc, ADDR_MODE_ABSOLUTE)   \
+    INS(0x6e, "ROR", 6, false, op_ror, ADDR_MODE_ABSOLUTE)    \
+    INE(0x6f)                                                 \
+    INS(0x70, "BVS", 2, true,  op_bvs, ADDR_MODE_RELATIVE)    \
+    INS(0x71, "ADC", 5, true,  op_adc, ADDR_MODE_INDIRECT_Y)  \
+    INE(0x72)                                                 \
+    INE(0x73)                                                 \
+    INE(0x74)                                                 \
+    INS(0x75, "ADC", 4, false, op_adc, ADDR_MODE_ZERO_PAGE_X) \
+    INS(0x76, "ROR", 6, false, op_ror, ADDR_MODE_ZERO_PAGE_X) \
+    INE(0x77)                                                 \
+    INS(0x78, "SEI", 2, false, op_sei, ADDR_MODE_IMPLIED)     \
+    INS(0x79, "ADC", 4, true,  op_adc, ADDR_MODE_ABSOLUTE_Y)  \
+    INE(0x7a)                                                 \
+    INE(0x7b)                                                 \
+    INE(0x7c)                                                 \
+    INS(0x7d, "ADC", 4, true,  op_adc, ADDR_MODE_ABSOLUTE_X)  \
+    INS(0x7e, "ROR", 7, false, op_ror, ADDR_MODE_ABSOLUTE_X)  \
+    INE(0x7f)                                                 \
+    INE(0x80)                                                 \
+    INS(0x81, "STA", 6, false, op_sta, ADDR_MODE_INDIRECT_X)  \
+    INE(0x82)                                                 \
+    INE(0x83)                                                 \
+    INS(0x84, "STY", 3, false, op_sty, ADDR_MODE_ZERO_PAGE)   \
+    INS(0x85, "STA", 3, false, op_sta, ADDR_MODE_ZERO_PAGE)   \
+    INS(0x86, "STX", 3, false, op_stx, ADDR_MODE_ZERO_PAGE)   \
+    INE(0x87)                                                 \
+    INS(0x88, "DEY", 2, false, op_dey, ADDR_MODE_IMPLIED)     \
+    INE(0x89)                                                 \
+    INS(0x8a, "TXA", 2, false, op_txa, ADDR_MODE_IMPLIED)     \
+    INE(0x8b)                                                 \
+    INS(0x8c, "STY", 4, false, op_sty, ADDR_MODE_ABSOLUTE)    \
+    INS(0x8d, "STA", 4, false, op_sta, ADDR_MODE_ABSOLUTE)    \
+    INS(0x8e, "STX", 4, false, op_stx, ADDR_MODE_ABSOLUTE)    \
+    INE(0x8f)                                                 \
+    INS(0x90, "BCC", 2, true,  op_bcc, ADDR_MODE_RELATIVE)    \
+    INS(0x91, "STA", 6, false, op_sta, ADDR_MODE_INDIRECT_Y)  \
+    INE(0x92)                                                 \
+    INE(0x93)                                                 \
+    INS(0x94, "STY", 4, false, op_sty, ADDR_MODE_ZERO_PAGE_X) \
+    INS(0x95, "STA", 4, false, op_sta, ADDR_MODE_ZERO_PAGE_X) \
+    INS(0x96, "STX", 4, false, op_stx, ADDR_MODE_ZERO_PAGE_Y) \
+    INE(0x97)                                                 \
+    INS(0x98, "TYA", 2, false, op_tya, ADDR_MODE_IMPLIED)     \
+    INS(0x99, "STA", 5, false, op_sta, ADDR_MODE_ABSOLUTE_Y)  \
+    INS(0x9a, "TXS", 2, false, op_txs, ADDR_MODE_IMPLIED)     \
+    INE(0x9b)                                                 \
+    INE(0x9c)                                                 \
+    INS(0x9d, "STA", 5, false, op_sta, ADDR_MODE_ABSOLUTE_X)  \
+    INE(0x9e)                                                 \
+    INE(0x9f)                                                 \
+    INS(0xa0, "LDY", 2, false, op_ldy, ADDR_MODE_IMMEDIATE)   \
+    INS(0xa1, "LDA", 6, false, op_lda, ADDR_MODE_INDIRECT_X)  \
+    INS(0xa2, "LDX", 2, false, op_ldx, ADDR_MODE_IMMEDIATE)   \
+    INE(0xa3)                                                 \
+    INS(0xa4, "LDY", 3, false, op_ldy, ADDR_MODE_ZERO_PAGE)   \
+    INS(0xa5, "LDA", 3, false, op_lda, ADDR_MODE_ZERO_PAGE)   \
+    INS(0xa6, "LDX", 3, false, op_ldx, ADDR_MODE_ZERO_PAGE)   \
+    INE(0xa7)                                                 \
+    INS(0xa8, "TAY", 2, false, op_tay, ADDR_MODE_IMPLIED)     \
+    INS(0xa9, "LDA", 2, false, op_lda, ADDR_MODE_IMMEDIATE)   \
+    INS(0xaa, "TAX", 2, false, op_tax, ADDR_MODE_IMPLIED)     \
+    INE(0xab)                                                 \
+    INS(0xac, "LDY", 4, false, op_ldy, ADDR_MODE_ABSOLUTE)    \
+    INS(0xad, "LDA", 4, false, op_lda, ADDR_MODE_ABSOLUTE)    \
+    INS(0xae, "LDX", 4, false, op_ldx, ADDR_MODE_ABSOLUTE)    \
+    INE(0xaf)                                                 \
+    INS(0xb0, "BCS", 2, true,  op_bcs, ADDR_MODE_RELATIVE)    \
+    INS(0xb1, "LDA", 5, true,  op_lda, ADDR_MODE_INDIRECT_Y)  \
+    INE(0xb2)                                                 \
+    INE(0xb3)                                                 \
+    INS(0xb4, "LDY", 4, false, op_ldy, ADDR_MODE_ZERO_PAGE_X) \
+    INS(0xb5, "LDA", 4, false, op_lda, ADDR_MODE_ZERO_PAGE_X) \
+    INS(0xb6, "LDX", 4, false, op_ldx, ADDR_MODE_ZERO_PAGE_Y) \
+    INE(0xb7)                                                 \
+    INS(0xb8, "CLV", 2, false, op_clv, ADDR_MODE_IMPLIED)     \
+    INS(0xb9, "LDA", 4, true,  op_lda, ADDR_MODE_ABSOLUTE_Y)  \
+    INS(0xba, "TSX", 2, false, op_tsx, ADDR_MODE_IMPLIED)     \
+    INE(0xbb)                                                 \
+    INS(0xbc, "LDY", 4, true,  op_ldy, ADDR_MODE_ABSOLUTE_X)  \
+    INS(0xbd, "LDA", 4, true,  op_lda, ADDR_MODE_ABSOLUTE_X)  \
+    INS(0xbe, "LDX", 4, true,  op_ldx, ADDR_MODE_ABSOLUTE_Y)  \
+    INE(0xbf)                                                 \
+    INS(0xc0, "CPY", 2, false, op_cpy, ADDR_MODE_IMMEDIATE)   \
+    INS(0xc1, "CMP", 6, false, op_cmp, ADDR_MODE_INDIRECT_X)  \
+    INE(0xc2)                                                 \
+    INE(0xc3)                                                 \
+    INS(0xc4, "CPY", 3, false, op_cpy, ADDR_MODE_ZERO_PAGE)   \
+    INS(0xc5, "CMP", 3, false, op_cmp, ADDR_MODE_ZERO_PAGE)   \
+    INS(0xc6, "DEC", 5, false, op_dec, ADDR_MODE_ZERO_PAGE)   \
+    INE(0xc7)                                                 \
+    INS(0xc8, "INY", 2, false, op_iny, ADDR_MODE_IMPLIED)     \
+    INS(0xc9, "CMP", 2, false, op_cmp, ADDR_MODE_IMMEDIATE)   \
+    INS(0xca, "DEX", 2, false, op_dex, ADDR_MODE_IMPLIED)     \
+    INE(0xcb)                                                 \
+    INS(0xcc, "CPY", 4, false, op_cpy, ADDR_MODE_ABSOLUTE)    \
+    INS(0xcd, "CMP", 4, false, op_cmp, ADDR_MODE_ABSOLUTE)    \
+    INS(0xce, "DEC", 6, false, op_dec, ADDR_MODE_ABSOLUTE)    \
+    INE(0xcf)                                                 \
+    INS(0xd0, "BNE", 2, true,  op_bne, ADDR_MODE_RELATIVE)    \
+    INS(0xd1, "CMP", 5, true,  op_cmp, ADDR_MODE_INDIRECT_Y)  \
+    INE(0xd2)                                                 \
+    INE(0xd3)                                                 \
+    INE(0xd4)                                                 \
+    INS(0xd5, "CMP", 4, false, op_cmp, ADDR_MODE_ZERO_PAGE_X) \
+    INS(0xd6, "DEC", 6, false, op_dec, ADDR_MODE_ZERO_PAGE_X) \
+    INE(0xd7)                                                 \
+    INS(0xd8, "CLD", 2, false, op_cld, ADDR_MODE_IMPLIED)     \
+    INS(0xd9, "CMP", 4, true,  op_cmp, ADDR_MODE_ABSOLUTE_Y)  \
+    INE(0xda)                                                 \
+    INE(0xdb)                                                 \
+    INE(0xdc)                                                 \
+    INS(0xdd, "CMP", 4, true,  op_cmp, ADDR_MODE_ABSOLUTE_X)  \
+    INS(0xde, "DEC", 7, false, op_dec, ADDR_MODE_ABSOLUTE_X)  \
+    INE(0xdf)                                                 \
+    INS(0xe0, "CPX", 2, false, op_cpx, ADDR_MODE_IMMEDIATE)   \
+    INS(0xe1, "SBC", 6, false, op_sbc, ADDR_MODE_INDIRECT_X)  \
+    INE(0xe2)                                                 \
+    INE(0xe3)                                                 \
+    INS(0xe4, "CPX", 3, false, op_cpx, ADDR_MODE_ZERO_PAGE)   \
+    INS(0xe5, "SBC", 3, false, op_sbc, ADDR_MODE_ZERO_PAGE)   \
+    INS(0xe6, "INC", 5, false, op_inc, ADDR_MODE_ZERO_PAGE)   \
+    INE(0xe7)                                                 \
+    INS(0xe8, "INX", 2, false, op_inx, ADDR_MODE_IMPLIED)     \
+    INS(0xe9, "SBC", 2, false, op_sbc, ADDR_MODE_IMMEDIATE)   \
+    INS(0xea, "NOP", 2, false, op_nop, ADDR_MODE_IMPLIED)     \
+    INE(0xeb)                                                 \
+    INS(0xec, "CPX", 4, false, op_cpx, ADDR_MODE_ABSOLUTE)    \
+    INS(0xed, "SBC", 4, false, op_sbc, ADDR_MODE_ABSOLUTE)    \
+    INS(0xee, "INC", 6, false, op_inc, ADDR_MODE_ABSOLUTE)    \
+    INE(0xef)                                                 \
+    INS(0xf0, "BEQ", 2, true,  op_beq, ADDR_MODE_RELATIVE)    \
+    INS(0xf1, "SBC", 5, true,  op_sbc, ADDR_MODE_INDIRECT_Y)  \
+    INE(0xf2)                                                 \
+    INE(0xf3)                                                 \
+    INE(0xf4)                                                 \
+    INS(0xf5, "SBC", 4, false, op_sbc, ADDR_MODE_ZERO_PAGE_X) \
+    INS(0xf6, "INC", 6, false, op_inc, ADDR_MODE_ZERO_PAGE_X) \
+    INE(0xf7)                                                 \
+    INS(0xf8, "SED", 2, false, op_sed, ADDR_MODE_IMPLIED)     \
+    INS(0xf9, "SBC", 4, true,  op_sbc, ADDR_MODE_ABSOLUTE_Y)  \
+    INE(0xfa)                                                 \
+    INE(0xfb)                                                 \
+    INE(0xfc)                                                 \
+    INS(0xfd, "SBC", 4, true,  op_sbc, ADDR_MODE_ABSOLUTE_X)  \
+    INS(0xfe, "INC", 7, false, op_inc, ADDR_MODE_ABSOLUTE_X)  \
+    INE(0xff)
+
+// Specialised dispatch: every opcode gets its own handler with the addressing
+// mode fixed at compile time, so operand decoding and the op body inline into
+// straight-line code. Computed goto where the compiler has it, a switch otherwise.
+#if defined(__GNUC__) || defined(__clang__)
+#define AGNES_COMPUTED_GOTO
+#endif
 
-#undef INE
-#undef INS
+#ifdef AGNES_COMPUTED_GOTO
+#define INS_LABEL(OPC) ins_##OPC
+#else
+#define INS_LABEL(OPC) case OPC
+#endif
 
-instruction_t* instruction_get(uint8_t opc) {
-    return &instructions[opc];
+#define INS(OPC, NAME, CYCLES, PCC, OP, MODE) \
+    INS_LABEL(OPC): { \
+        bool page_crossed = false; \
+        uint16_t addr = cpu_get_instruction_operand(cpu, MODE, &page_crossed); \
+        cpu->pc += instruction_get_size(MODE); \
+        int cycles = CYCLES + OP(cpu, addr, MODE); \
+        return (PCC && page_crossed) ? cycles + 1 : cycles; \
+    }
+#define INE(OPC) INS_LABEL(OPC): return 0;
+
+int instruction_execute(cpu_t *cpu, uint8_t opcode) {
+#ifdef AGNES_COMPUTED_GOTO
+#define INS_ADDR(OPC, NAME, CYCLES, PCC, OP, MODE) &&ins_##OPC,
+#define INE_ADDR(OPC) &&ins_##OPC,
+    static const void *handlers[256] = { AGNES_INSTRUCTIONS(INS_ADDR, INE_ADDR) };
+#undef INS_ADDR
+#undef INE_ADDR
+    goto *handlers[opcode];
+    AGNES_INSTRUCTIONS(INS, INE)
+#else
+    switch (opcode) {
+        AGNES_INSTRUCTIONS(INS, INE)
+    }
+    return 0;
+#endif
 }
 
-uint8_t instruction_get_size(addr_mode_t mode) {
+#undef INE
+#undef INS
+#undef INS_LABEL
+
+AGNES_FORCE_INLINE uint8_t instruction_get_size(addr_mode_t mode) {
     switch (mode) {
         case ADDR_MODE_NONE:        return 0;
         case ADDR_MODE_ABSOLUTE:    return 3;
@@ -1869,7 +2863,44 @@ uint8_t instruction_get_size(addr_mode_t mode) {
     }
 }
 
-static int op_adc(cpu_t *cpu, uint16_t addr, addr_mode_t mode) {
+int agnes_disassemble(const agnes_t *agnes, uint16_t addr, char *out, size_t size) {
+#define INS_NAME(OPC, NAME, CYCLES, PCC, OP, MODE) NAME,
+#define INE_NAME(OPC) NULL,
+#define INS_MODE(OPC, NAME, CYCLES, PCC, OP, MODE) MODE,
+#define INE_MODE(OPC) ADDR_MODE_NONE,
+    static const char *const names[256] = { AGNES_INSTRUCTIONS(INS_NAME, INE_NAME) };
+    static const addr_mode_t modes[256] = { AGNES_INSTRUCTIONS(INS_MODE, INE_MODE) };
+#undef INS_NAME
+#undef INE_NAME
+#undef INS_MODE
+#undef INE_MODE
+    uint8_t opcode = agnes_cpu_peek(agnes, addr);
+    if (!names[opcode]) {
+        snprintf(out, size, ".DB $%02X", opcode);
+        return 1;
+    }
+    uint8_t lo = agnes_cpu_peek(agnes, addr + 1);
+    uint16_t word = lo | (agnes_cpu_peek(agnes, addr + 2) << 8);
+    const char *name = names[opcode];
+    switch (modes[opcode]) {
+        case ADDR_MODE_ABSOLUTE:    snprintf(out, size, "%s $%04X", name, word); break;
+        case ADDR_MODE_ABSOLUTE_X:  snprintf(out, size, "%s $%04X,X", name, word); break;
+        case ADDR_MODE_ABSOLUTE_Y:  snprintf(out, size, "%s $%04X,Y", name, word); break;
+        case ADDR_MODE_ACCUMULATOR: snprintf(out, size, "%s A", name); break;
+        case ADDR_MODE_IMMEDIATE:   snprintf(out, size, "%s #$%02X", name, lo); break;
+        case ADDR_MODE_INDIRECT:    snprintf(out, size, "%s ($%04X)", name, word); break;
+        case ADDR_MODE_INDIRECT_X:  snprintf(out, size, "%s ($%02X,X)", name, lo); break;
+        case ADDR_MODE_INDIRECT_Y:  snprintf(out, size, "%s ($%02X),Y", name, lo); break;
+        case ADDR_MODE_RELATIVE:    snprintf(out, size, "%s $%04X", name, (uint16_t)(addr + 2 + (int8_t)lo)); break;
+        case ADDR_MODE_ZERO_PAGE:   snprintf(out, size, "%s $%02X", name, lo); break;
+        case ADDR_MODE_ZERO_PAGE_X: snprintf(out, size, "%s $%02X,X", name, lo); break;
+        case ADDR_MODE_ZERO_PAGE_Y: snprintf(out, size, "%s $%02X,Y", name, lo); break;
+        default:                    snprintf(out, size, "%s", name); break;
+    }
+    return instruction_get_size(modes[opcode]);
+}
+
+static AGNES_FORCE_INLINE int op_adc(cpu_t *cpu, uint16_t addr, addr_mode_t mode) {
     uint8_t old_acc = cpu->acc;
     uint8_t val = cpu_read8(cpu, addr);
     int res = cpu->acc + val + (uint8_t)cpu->flag_carry;
@@ -1880,14 +2911,14 @@ static int op_adc(cpu_t *cpu, uint16_t addr, addr_mode_t mode) {
     return 0;
 }
 
-static int op_and(cpu_t *cpu, uint16_t addr, addr_mode_t mode) {
+static AGNES_FORCE_INLINE int op_and(cpu_t *cpu, uint16_t addr, addr_mode_t mode) {
     uint8_t val = cpu_read8(cpu, addr);
     cpu->acc = cpu->acc & val;
     cpu_update_zn_flags(cpu, cpu->acc);
     return 0;
 }
 
-static int op_asl(cpu_t *cpu, uint16_t addr, addr_mode_t mode) {
+static AGNES_FORCE_INLINE int op_asl(cpu_t *cpu, uint16_t addr, addr_mode_t mode) {
     if (mode == ADDR_MODE_ACCUMULATOR) {
         cpu->flag_carry = AGNES_GET_BIT(cpu->acc, 7);
         cpu->acc = cpu->acc << 1;
@@ -1902,19 +2933,19 @@ static int op_asl(cpu_t *cpu, uint16_t addr, addr_mode_t mode) {
     return 0;
 }
 
-static int op_bcc(cpu_t *cpu, uint16_t addr, addr_mode_t mode) {
+static AGNES_FORCE_INLINE int op_bcc(cpu_t *cpu, uint16_t addr, addr_mode_t mode) {
     return !cpu->flag_carry ? take_branch(cpu, addr) : 0;
 }
 
-static int op_bcs(cpu_t *cpu, uint16_t addr, addr_mode_t mode) {
+static AGNES_FORCE_INLINE int op_bcs(cpu_t *cpu, uint16_t addr, addr_mode_t mode) {
     return cpu->flag_carry ? take_branch(cpu, addr) : 0;
 }
 
-static int op_beq(cpu_t *cpu, uint16_t addr, addr_mode_t mode) {
+static AGNES_FORCE_INLINE int op_beq(cpu_t *cpu, uint16_t addr, addr_mode_t mode) {
     return cpu->flag_zero ? take_branch(cpu, addr) : 0;
 }
 
-static int op_bit(cpu_t *cpu, uint16_t addr, addr_mode_t mode) {
+static AGNES_FORCE_INLINE int op_bit(cpu_t *cpu, uint16_t addr, addr_mode_t mode) {
     uint8_t val = cpu_read8(cpu, addr);
     uint8_t res = cpu->acc & val;
     cpu->flag_zero = res == 0;
@@ -1923,19 +2954,19 @@ static int op_bit(cpu_t *cpu, uint16_t addr, addr_mode_t mode) {
     return 0;
 }
 
-static int op_bmi(cpu_t *cpu, uint16_t addr, addr_mode_t mode) {
+static AGNES_FORCE_INLINE int op_bmi(cpu_t *cpu, uint16_t addr, addr_mode_t mode) {
     return cpu->flag_negative ? take_branch(cpu, addr) : 0;
 }
 
-static int op_bne(cpu_t *cpu, uint16_t addr, addr_mode_t mode) {
+static AGNES_FORCE_INLINE int op_bne(cpu_t *cpu, uint16_t addr, addr_mode_t mode) {
     return !cpu->flag_zero ? take_branch(cpu, addr) : 0;
 }
 
-static int op_bpl(cpu_t *cpu, uint16_t addr, addr_mode_t mode) {
+static AGNES_FORCE_INLINE int op_bpl(cpu_t *cpu, uint16_t addr, addr_mode_t mode) {
     return !cpu->flag_negative ? take_branch(cpu, addr) : 0;
 }
 
-static int op_brk(cpu_t *cpu, uint16_t addr, addr_mode_t mode) {
+static AGNES_FORCE_INLINE int op_brk(cpu_t *cpu, uint16_t addr, addr_mode_t mode) {
     cpu_stack_push16(cpu, cpu->pc);
     uint8_t flags = cpu_get_flags(cpu);
     cpu_stack_push8(cpu, flags | 0x30);
@@ -1944,133 +2975,133 @@ static int op_brk(cpu_t *cpu, uint16_t addr, addr_mode_t mode) {
     return 0;
 }
 
-static int op_bvc(cpu_t *cpu, uint16_t addr, addr_mode_t mode) {
+static AGNES_FORCE_INLINE int op_bvc(cpu_t *cpu, uint16_t addr, addr_mode_t mode) {
     return !cpu->flag_overflow ? take_branch(cpu, addr) : 0;
 }
 
-static int op_bvs(cpu_t *cpu, uint16_t addr, addr_mode_t mode) {
+static AGNES_FORCE_INLINE int op_bvs(cpu_t *cpu, uint16_t addr, addr_mode_t mode) {
     return cpu->flag_overflow ? take_branch(cpu, addr) : 0;
 }
 
-static int op_clc(cpu_t *cpu, uint16_t addr, addr_mode_t mode) {
+static AGNES_FORCE_INLINE int op_clc(cpu_t *cpu, uint16_t addr, addr_mode_t mode) {
     cpu->flag_carry = false;
     return 0;
 }
 
-static int op_cld(cpu_t *cpu, uint16_t addr, addr_mode_t mode) {
+static AGNES_FORCE_INLINE int op_cld(cpu_t *cpu, uint16_t addr, addr_mode_t mode) {
     cpu->flag_decimal = false;
     return 0;
 }
 
-static int op_cli(cpu_t *cpu, uint16_t addr, addr_mode_t mode) {
+static AGNES_FORCE_INLINE int op_cli(cpu_t *cpu, uint16_t addr, addr_mode_t mode) {
     cpu->flag_dis_interrupt = false;
     return 0;
 }
 
-static int op_clv(cpu_t *cpu, uint16_t addr, addr_mode_t mode) {
+static AGNES_FORCE_INLINE int op_clv(cpu_t *cpu, uint16_t addr, addr_mode_t mode) {
     cpu->flag_overflow = false;
     return 0;
 }
 
-static int op_cmp(cpu_t *cpu, uint16_t addr, addr_mode_t mode) {
+static AGNES_FORCE_INLINE int op_cmp(cpu_t *cpu, uint16_t addr, addr_mode_t mode) {
     uint8_t val = cpu_read8(cpu, addr);
     cpu_update_zn_flags(cpu, cpu->acc - val);
     cpu->flag_carry = cpu->acc >= val;
     return 0;
 }
 
-static int op_cpx(cpu_t *cpu, uint16_t addr, addr_mode_t mode) {
+static AGNES_FORCE_INLINE int op_cpx(cpu_t *cpu, uint16_t addr, addr_mode_t mode) {
     uint8_t val = cpu_read8(cpu, addr);
     cpu_update_zn_flags(cpu, cpu->x - val);
     cpu->flag_carry = cpu->x >= val;
     return 0;
 }
 
-static int op_cpy(cpu_t *cpu, uint16_t addr, addr_mode_t mode) {
+static AGNES_FORCE_INLINE int op_cpy(cpu_t *cpu, uint16_t addr, addr_mode_t mode) {
     uint8_t val = cpu_read8(cpu, addr);
     cpu_update_zn_flags(cpu, cpu->y - val);
     cpu->flag_carry = cpu->y >= val;
     return 0;
 }
 
-static int op_dec(cpu_t *cpu, uint16_t addr, addr_mode_t mode) {
+static AGNES_FORCE_INLINE int op_dec(cpu_t *cpu, uint16_t addr, addr_mode_t mode) {
     uint8_t val = cpu_read8(cpu, addr);
     cpu_write8(cpu, addr, val - 1);
     cpu_update_zn_flags(cpu, val - 1);
     return 0;
 }
 
-static int op_dex(cpu_t *cpu, uint16_t addr, addr_mode_t mode) {
+static AGNES_FORCE_INLINE int op_dex(cpu_t *cpu, uint16_t addr, addr_mode_t mode) {
     cpu->x--;
     cpu_update_zn_flags(cpu, cpu->x);
     return 0;
 }
 
-static int op_dey(cpu_t *cpu, uint16_t addr, addr_mode_t mode) {
+static AGNES_FORCE_INLINE int op_dey(cpu_t *cpu, uint16_t addr, addr_mode_t mode) {
     cpu->y--;
     cpu_update_zn_flags(cpu, cpu->y);
     return 0;
 }
 
-static int op_eor(cpu_t *cpu, uint16_t addr, addr_mode_t mode) {
+static AGNES_FORCE_INLINE int op_eor(cpu_t *cpu, uint16_t addr, addr_mode_t mode) {
     uint8_t val = cpu_read8(cpu, addr);
     cpu->acc = cpu->acc ^ val;
     cpu_update_zn_flags(cpu, cpu->acc);
     return 0;
 }
 
-static int op_inc(cpu_t *cpu, uint16_t addr, addr_mode_t mode) {
+static AGNES_FORCE_INLINE int op_inc(cpu_t *cpu, uint16_t addr, addr_mode_t mode) {
     uint8_t val = cpu_read8(cpu, addr);
     cpu_write8(cpu, addr, val + 1);
     cpu_update_zn_flags(cpu, val + 1);
     return 0;
 }
 
-static int op_inx(cpu_t *cpu, uint16_t addr, addr_mode_t mode) {
+static AGNES_FORCE_INLINE int op_inx(cpu_t *cpu, uint16_t addr, addr_mode_t mode) {
     cpu->x++;
     cpu_update_zn_flags(cpu, cpu->x);
     return 0;
 }
 
-static int op_iny(cpu_t *cpu, uint16_t addr, addr_mode_t mode) {
+static AGNES_FORCE_INLINE int op_iny(cpu_t *cpu, uint16_t addr, addr_mode_t mode) {
     cpu->y++;
     cpu_update_zn_flags(cpu, cpu->y);
     return 0;
 }
 
-static int op_jmp(cpu_t *cpu, uint16_t addr, addr_mode_t mode) {
+static AGNES_FORCE_INLINE int op_jmp(cpu_t *cpu, uint16_t addr, addr_mode_t mode) {
     cpu->pc = addr;
     return 0;
 }
 
-static int op_jsr(cpu_t *cpu, uint16_t addr, addr_mode_t mode) {
+static AGNES_FORCE_INLINE int op_jsr(cpu_t *cpu, uint16_t addr, addr_mode_t mode) {
     cpu_stack_push16(cpu, cpu->pc - 1);
     cpu->pc = addr;
     return 0;
 }
 
-static int op_lda(cpu_t *cpu, uint16_t addr, addr_mode_t mode) {
+static AGNES_FORCE_INLINE int op_lda(cpu_t *cpu, uint16_t addr, addr_mode_t mode) {
     uint8_t val = cpu_read8(cpu, addr);
     cpu->acc = val;
     cpu_update_zn_flags(cpu, cpu->acc);
     return 0;
 }
 
-static int op_ldx(cpu_t *cpu, uint16_t addr, addr_mode_t mode) {
+static AGNES_FORCE_INLINE int op_ldx(cpu_t *cpu, uint16_t addr, addr_mode_t mode) {
     uint8_t val = cpu_read8(cpu, addr);
     cpu->x = val;
     cpu_update_zn_flags(cpu, cpu->x);
     return 0;
 }
 
-static int op_ldy(cpu_t *cpu, uint16_t addr, addr_mode_t mode) {
+static AGNES_FORCE_INLINE int op_ldy(cpu_t *cpu, uint16_t addr, addr_mode_t mode) {
     uint8_t val = cpu_read8(cpu, addr);
     cpu->y = val;
     cpu_update_zn_flags(cpu, cpu->y);
     return 0;
 }
 
-static int op_lsr(cpu_t *cpu, uint16_t addr, addr_mode_t mode) {
+static AGNES_FORCE_INLINE int op_lsr(cpu_t *cpu, uint16_t addr, addr_mode_t mode) {
     if (mode == ADDR_MODE_ACCUMULATOR) {
         cpu->flag_carry = AGNES_GET_BIT(cpu->acc, 0);
         cpu->acc = cpu->acc >> 1;
@@ -2085,41 +3116,41 @@ static int op_lsr(cpu_t *cpu, uint16_t addr, addr_mode_t mode) {
     return 0;
 }
 
-static int op_nop(cpu_t *cpu, uint16_t addr, addr_mode_t mode) {
+static AGNES_FORCE_INLINE int op_nop(cpu_t *cpu, uint16_t addr, addr_mode_t mode) {
     return 0;
 }
 
-static int op_ora(cpu_t *cpu, uint16_t addr, addr_mode_t mode) {
+static AGNES_FORCE_INLINE int op_ora(cpu_t *cpu, uint16_t addr, addr_mode_t mode) {
     uint8_t val = cpu_read8(cpu, addr);
     cpu->acc = cpu->acc | val;
     cpu_update_zn_flags(cpu, cpu->acc);
     return 0;
 }
 
-static int op_pha(cpu_t *cpu, uint16_t addr, addr_mode_t mode) {
+static AGNES_FORCE_INLINE int op_pha(cpu_t *cpu, uint16_t addr, addr_mode_t mode) {
     cpu_stack_push8(cpu, cpu->acc);
     return 0;
 }
 
-static int op_php(cpu_t *cpu, uint16_t addr, addr_mode_t mode) {
+static AGNES_FORCE_INLINE int op_php(cpu_t *cpu, uint16_t addr, addr_mode_t mode) {
     uint8_t flags = cpu_get_flags(cpu);
     cpu_stack_push8(cpu, flags | 0x30);
     return 0;
 }
 
-static int op_pla(cpu_t *cpu, uint16_t addr, addr_mode_t mode) {
+static AGNES_FORCE_INLINE int op_pla(cpu_t *cpu, uint16_t addr, addr_mode_t mode) {
     cpu->acc = cpu_stack_pop8(cpu);
     cpu_update_zn_flags(cpu, cpu->acc);
     return 0;
 }
 
-static int op_plp(cpu_t *cpu, uint16_t addr, addr_mode_t mode) {
+static AGNES_FORCE_INLINE int op_plp(cpu_t *cpu, uint16_t addr, addr_mode_t mode) {
     uint8_t flags = cpu_stack_pop8(cpu);
     cpu_restore_flags(cpu, flags);
     return 0;
 }
 
-static int op_rol(cpu_t *cpu, uint16_t addr, addr_mode_t mode) {
+static AGNES_FORCE_INLINE int op_rol(cpu_t *cpu, uint16_t addr, addr_mode_t mode) {
     uint8_t old_carry = cpu->flag_carry;
     if (mode == ADDR_MODE_ACCUMULATOR) {
         cpu->flag_carry = AGNES_GET_BIT(cpu->acc, 7);
@@ -2135,7 +3166,7 @@ static int op_rol(cpu_t *cpu, uint16_t addr, addr_mode_t mode) {
     return 0;
 }
 
-static int op_ror(cpu_t *cpu, uint16_t addr, addr_mode_t mode) {
+static AGNES_FORCE_INLINE int op_ror(cpu_t *cpu, uint16_t addr, addr_mode_t mode) {
     uint8_t old_carry = cpu->flag_carry;
     if (mode == ADDR_MODE_ACCUMULATOR) {
         cpu->flag_carry = AGNES_GET_BIT(cpu->acc, 0);
@@ -2151,19 +3182,19 @@ static int op_ror(cpu_t *cpu, uint16_t addr, addr_mode_t mode) {
     return 0;
 }
 
-static int op_rti(cpu_t *cpu, uint16_t addr, addr_mode_t mode) {
+static AGNES_FORCE_INLINE int op_rti(cpu_t *cpu, uint16_t addr, addr_mode_t mode) {
     uint8_t flags = cpu_stack_pop8(cpu);
     cpu_restore_flags(cpu, flags);
     cpu->pc = cpu_stack_pop16(cpu);
     return 0;
 }
 
-static int op_rts(cpu_t *cpu, uint16_t addr, addr_mode_t mode) {
+static AGNES_FORCE_INLINE int op_rts(cpu_t *cpu, uint16_t addr, addr_mode_t mode) {
     cpu->pc = cpu_stack_pop16(cpu) + 1;
     return 0;
 }
 
-static int op_sbc(cpu_t *cpu, uint16_t addr, addr_mode_t mode) {
+static AGNES_FORCE_INLINE int op_sbc(cpu_t *cpu, uint16_t addr, addr_mode_t mode) {
     uint8_t val = cpu_read8(cpu, addr);
     uint8_t old_acc = cpu->acc;
     int res = cpu->acc - val - (cpu->flag_carry ? 0 : 1);
@@ -2174,72 +3205,72 @@ static int op_sbc(cpu_t *cpu, uint16_t addr, addr_mode_t mode) {
     return 0;
 }
 
-static int op_sec(cpu_t *cpu, uint16_t addr, addr_mode_t mode) {
+static AGNES_FORCE_INLINE int op_sec(cpu_t *cpu, uint16_t addr, addr_mode_t mode) {
     cpu->flag_carry = true;
     return 0;
 }
 
-static int op_sed(cpu_t *cpu, uint16_t addr, addr_mode_t mode) {
+static AGNES_FORCE_INLINE int op_sed(cpu_t *cpu, uint16_t addr, addr_mode_t mode) {
     cpu->flag_decimal = true;
     return 0;
 }
 
-static int op_sei(cpu_t *cpu, uint16_t addr, addr_mode_t mode) {
+static AGNES_FORCE_INLINE int op_sei(cpu_t *cpu, uint16_t addr, addr_mode_t mode) {
     cpu->flag_dis_interrupt = true;
     return 0;
 }
 
-static int op_sta(cpu_t *cpu, uint16_t addr, addr_mode_t mode) {
+static AGNES_FORCE_INLINE int op_sta(cpu_t *cpu, uint16_t addr, addr_mode_t mode) {
     cpu_write8(cpu, addr, cpu->acc);
     return 0;
 }
 
-static int op_stx(cpu_t *cpu, uint16_t addr, addr_mode_t mode) {
+static AGNES_FORCE_INLINE int op_stx(cpu_t *cpu, uint16_t addr, addr_mode_t mode) {
     cpu_write8(cpu, addr, cpu->x);
     return 0;
 }
 
-static int op_sty(cpu_t *cpu, uint16_t addr, addr_mode_t mode) {
+static AGNES_FORCE_INLINE int op_sty(cpu_t *cpu, uint16_t addr, addr_mode_t mode) {
     cpu_write8(cpu, addr, cpu->y);
     return 0;
 }
 
-static int op_tax(cpu_t *cpu, uint16_t addr, addr_mode_t mode) {
+static AGNES_FORCE_INLINE int op_tax(cpu_t *cpu, uint16_t addr, addr_mode_t mode) {
     cpu->x = cpu->acc;
     cpu_update_zn_flags(cpu, cpu->x);
     return 0;
 }
 
-static int op_tay(cpu_t *cpu, uint16_t addr, addr_mode_t mode) {
+static AGNES_FORCE_INLINE int op_tay(cpu_t *cpu, uint16_t addr, addr_mode_t mode) {
     cpu->y = cpu->acc;
     cpu_update_zn_flags(cpu, cpu->y);
     return 0;
 }
 
-static int op_tsx(cpu_t *cpu, uint16_t addr, addr_mode_t mode) {
+static AGNES_FORCE_INLINE int op_tsx(cpu_t *cpu, uint16_t addr, addr_mode_t mode) {
     cpu->x = cpu->sp;
     cpu_update_zn_flags(cpu, cpu->x);
     return 0;
 }
 
-static int op_txa(cpu_t *cpu, uint16_t addr, addr_mode_t mode) {
+static AGNES_FORCE_INLINE int op_txa(cpu_t *cpu, uint16_t addr, addr_mode_t mode) {
     cpu->acc = cpu->x;
     cpu_update_zn_flags(cpu, cpu->acc);
     return 0;
 }
 
-static int op_txs(cpu_t *cpu, uint16_t addr, addr_mode_t mode) {
+static AGNES_FORCE_INLINE int op_txs(cpu_t *cpu, uint16_t addr, addr_mode_t mode) {
     cpu->sp = cpu->x;
     return 0;
 }
 
-static int op_tya(cpu_t *cpu, uint16_t addr, addr_mode_t mode) {
+static AGNES_FORCE_INLINE int op_tya(cpu_t *cpu, uint16_t addr, addr_mode_t mode) {
     cpu->acc = cpu->y;
     cpu_update_zn_flags(cpu, cpu->acc);
     return 0;
 }
 
-static int take_branch(cpu_t *cpu, uint16_t addr) {
+static AGNES_FORCE_INLINE int take_branch(cpu_t *cpu, uint16_t addr) {
     bool page_crossed = (cpu->pc & 0xff00) != (addr & 0xff00);
     cpu->pc = addr;
     return page_crossed ? 2 : 1;
@@ -2261,18 +3292,72 @@ static int take_branch(cpu_t *cpu, uint16_t addr) {
 static void mapper24_init(mapper24_t *mapper, agnes_t *agnes);
 static uint8_t mapper24_read(mapper24_t *mapper, uint16_t addr);
 static void mapper24_write(mapper24_t *mapper, uint16_t addr, uint8_t val);
-static void mapper24_cpu_cycle(mapper24_t *mapper);
+static void mapper24_cpu_cycles(mapper24_t *mapper, int cycles);
 
 bool mapper_init(agnes_t *agnes) {
     switch (agnes->gamepack.mapper) {
-        case 0: mapper0_init(&agnes->mapper.m0, agnes); return true;
-        case 1: mapper1_init(&agnes->mapper.m1, agnes); return true;
-        case 2: mapper2_init(&agnes->mapper.m2, agnes); return true;
-        case 4: mapper4_init(&agnes->mapper.m4, agnes); return true;
-        case 24: mapper24_init(&agnes->mapper.m24, agnes); agnes->mapper.m24.is_vrc6b = false; return true;
-        case 26: mapper24_init(&agnes->mapper.m24, agnes); agnes->mapper.m24.is_vrc6b = true; return true;
+        case 0: mapper0_init(&agnes->mapper.m0, agnes); break;
+        case 1: mapper1_init(&agnes->mapper.m1, agnes); break;
+        case 2: mapper2_init(&agnes->mapper.m2, agnes); break;
+        case 4: mapper4_init(&agnes->mapper.m4, agnes); break;
+        case 24: mapper24_init(&agnes->mapper.m24, agnes); agnes->mapper.m24.is_vrc6b = false; break;
+        case 26: mapper24_init(&agnes->mapper.m24, agnes); agnes->mapper.m24.is_vrc6b = true; break;
         default: return false;
     }
+    mapper_map_pages(agnes);
+    return true;
+}
+
+void mapper_map_pages(agnes_t *agnes) {
+    memset(agnes->read_pages, 0, sizeof(agnes->read_pages));
+    memset(agnes->write_pages, 0, sizeof(agnes->write_pages));
+
+    // $0000-$1FFF: 2KB internal RAM, mirrored four times
+    for (int page = 0x00; page < 0x20; page++) {
+        uint8_t *ram = &agnes->ram[(page & 0x7) << 8];
+        agnes->read_pages[page] = ram;
+        agnes->write_pages[page] = ram;
+    }
+
+    // $6000-$7FFF: PRG RAM on the mappers that have it
+    uint8_t *prg_ram = NULL;
+    switch (agnes->gamepack.mapper) {
+        case 1: prg_ram = agnes->mapper.m1.prg_ram; break;
+        case 4: prg_ram = agnes->mapper.m4.prg_ram; break;
+        case 24: case 26: prg_ram = agnes->mapper.m24.prg_ram; break;
+    }
+    if (prg_ram) {
+        for (int page = 0x60; page < 0x80; page++) {
+            agnes->read_pages[page] = &prg_ram[(page - 0x60) << 8];
+            agnes->write_pages[page] = &prg_ram[(page - 0x60) << 8];
+        }
+    }
+
+    mapper_map_prg_pages(agnes);
+    debug_unmap_pages(agnes, 0x00, 0x7f);
+}
+
+// Called after every PRG bank switch; writes to $8000-$FFFF always go to the mapper
+void mapper_map_prg_pages(agnes_t *agnes) {
+    const unsigned *bank_offsets;
+    unsigned bank_shift; // 14 for 16KB banks, 13 for 8KB banks
+    switch (agnes->gamepack.mapper) {
+        case 0: bank_offsets = agnes->mapper.m0.prg_bank_offsets; bank_shift = 14; break;
+        case 1: bank_offsets = agnes->mapper.m1.prg_bank_offsets; bank_shift = 14; break;
+        case 2: bank_offsets = agnes->mapper.m2.prg_bank_offsets; bank_shift = 14; break;
+        case 4: bank_offsets = agnes->mapper.m4.prg_bank_offsets; bank_shift = 13; break;
+        case 24: case 26: bank_offsets = agnes->mapper.m24.prg_bank_offsets; bank_shift = 13; break;
+        default: return;
+    }
+    const uint8_t *prg_rom = agnes->gamepack.data + agnes->gamepack.prg_rom_offset;
+    unsigned bank_mask = (0x8000 >> bank_shift) - 1;
+    unsigned offset_mask = (1u << bank_shift) - 1;
+    for (unsigned page = 0x80; page < 0x100; page++) {
+        unsigned addr = page << 8;
+        unsigned bank = (addr >> bank_shift) & bank_mask;
+        agnes->read_pages[page] = prg_rom + bank_offsets[bank] + (addr & offset_mask);
+    }
+    debug_unmap_pages(agnes, 0x80, 0xff);
 }
 
 uint8_t mapper_read(agnes_t *agnes, uint16_t addr) {
@@ -2296,6 +3381,30 @@ void mapper_write(agnes_t *agnes, uint16_t addr, uint8_t val) {
     }
 }
 
+// Where each 1 KB of $0000-$1FFF comes from (offsets into CHR ROM or RAM),
+// to tell which pattern tiles a bank switch replaced
+void mapper_chr_banks(const agnes_t *agnes, unsigned out[8]) {
+    for (int i = 0; i < 8; i++) {
+        switch (agnes->gamepack.mapper) {
+            case 1: out[i] = agnes->mapper.m1.chr_bank_offsets[i >> 2] + (i & 3) * 1024; break;
+            case 4: out[i] = agnes->mapper.m4.chr_bank_offsets[i]; break;
+            case 24: case 26: out[i] = agnes->mapper.m24.chr_bank_offsets[i]; break;
+            default: out[i] = i * 1024; break;
+        }
+    }
+}
+
+bool mapper_uses_chr_ram(const agnes_t *agnes) {
+    switch (agnes->gamepack.mapper) {
+        case 0: return agnes->mapper.m0.use_chr_ram;
+        case 1: return agnes->mapper.m1.use_chr_ram;
+        case 2: return true;
+        case 4: return agnes->mapper.m4.use_chr_ram;
+        case 24: case 26: return agnes->mapper.m24.use_chr_ram;
+        default: return false;
+    }
+}
+
 void mapper_pa12_rising_edge(agnes_t *agnes) {
     switch (agnes->gamepack.mapper) {
         case 4: mapper4_pa12_rising_edge(&agnes->mapper.m4); break;
@@ -2470,6 +3579,7 @@ static void mapper1_set_offsets(mapper1_t *mapper) {
             break;
         }
     }
+    mapper_map_prg_pages(mapper->agnes);
 }
 //FILE_END
 //FILE_START:mapper2.c
@@ -2504,6 +3614,7 @@ void mapper2_write(mapper2_t *mapper, uint16_t addr, uint8_t val) {
     } else if (addr >= 0x8000) {
         int bank = val % (mapper->agnes->gamepack.prg_rom_banks_count);
         mapper->prg_bank_offsets[0] = bank * (16 * 1024);
+        mapper_map_prg_pages(mapper->agnes);
     }
 }
 //FILE_END
@@ -2664,6 +3775,7 @@ static void mapper4_set_offsets(mapper4_t *mapper) {
             break;
         }
     }
+    mapper_map_prg_pages(mapper->agnes);
 }
 //FILE_END
 
@@ -2671,6 +3783,7 @@ static void mapper4_set_offsets(mapper4_t *mapper) {
 // VRC6 mapper (mapper 24/26) implementation
 
 static void mapper24_set_offsets(mapper24_t *mapper);
+static void mapper24_irq_catch_up(mapper24_t *mapper);
 
 static void mapper24_init(mapper24_t *mapper, agnes_t *agnes) {
     mapper->agnes = agnes;
@@ -2688,6 +3801,8 @@ static void mapper24_init(mapper24_t *mapper, agnes_t *agnes) {
     mapper->irq_enabled_after_ack = false;
     mapper->irq_mode = 0;
     mapper->irq_prescaler = 0;
+    mapper->irq_pending_cycles = 0;
+    mapper->irq_event_cycles = 0;
     
     // Initialize is_vrc6b (will be set by caller for mapper 26)
     mapper->is_vrc6b = false;
@@ -2824,6 +3939,7 @@ static void mapper24_write(mapper24_t *mapper, uint16_t addr, uint8_t val) {
             // sub_reg 0: IRQ latch
             // sub_reg 1: IRQ control
             // sub_reg 2: IRQ acknowledge
+            mapper24_irq_catch_up(mapper);
             if (sub_reg == 0) {
                 mapper->irq_latch = val;
             } else if (sub_reg == 1) {
@@ -2838,6 +3954,7 @@ static void mapper24_write(mapper24_t *mapper, uint16_t addr, uint8_t val) {
                 // IRQ acknowledge
                 mapper->irq_enabled = mapper->irq_enabled_after_ack;
             }
+            mapper24_irq_catch_up(mapper);
         }
     }
 }
@@ -2858,32 +3975,54 @@ static void mapper24_set_offsets(mapper24_t *mapper) {
     
     // $E000-$FFFF: Fixed to last 8K
     mapper->prg_bank_offsets[3] = prg_rom_size - 8 * 1024;
+
+    mapper_map_prg_pages(mapper->agnes);
 }
 
-static void mapper24_cpu_cycle(mapper24_t *mapper) {
-    if (!mapper->irq_enabled) return;
-    
+static void mapper24_cpu_cycles(mapper24_t *mapper, int cycles) {
+    // The counter is only brought up to date when it is about to fire or
+    // when $F000-$F002 are written
+    mapper->irq_pending_cycles += cycles;
+    if (mapper->irq_pending_cycles >= mapper->irq_event_cycles) {
+        mapper24_irq_catch_up(mapper);
+    }
+}
+
+// Applies the pending CPU cycles to the prescaler/counter in one step and
+// recomputes how many cycles remain until the next reload
+static void mapper24_irq_catch_up(mapper24_t *mapper) {
+    int cycles = mapper->irq_pending_cycles;
+    mapper->irq_pending_cycles = 0;
+    if (!mapper->irq_enabled) {
+        mapper->irq_event_cycles = 1 << 30; // nothing to do until $F001/$F002 enable it
+        return;
+    }
+
     // VRC6 IRQ can run in scanline mode (bit 2 = 0) or cycle mode (bit 2 = 1)
-    if (mapper->irq_mode & 0x04) {
-        // Cycle mode: clock every CPU cycle
-        if (mapper->irq_counter == 0xFF) {
-            mapper->irq_counter = mapper->irq_latch;
-            cpu_trigger_irq(&mapper->agnes->cpu);
-        } else {
-            mapper->irq_counter++;
-        }
-    } else {
+    bool cycle_mode = mapper->irq_mode & 0x04;
+    int clocks = cycles;
+    if (!cycle_mode) {
         // Scanline mode: prescaler divides by 114
-        mapper->irq_prescaler++;
-        if (mapper->irq_prescaler >= 114) {
-            mapper->irq_prescaler = 0;
-            if (mapper->irq_counter == 0xFF) {
-                mapper->irq_counter = mapper->irq_latch;
-                cpu_trigger_irq(&mapper->agnes->cpu);
-            } else {
-                mapper->irq_counter++;
-            }
-        }
+        int prescaled = mapper->irq_prescaler + cycles;
+        clocks = prescaled / 114;
+        mapper->irq_prescaler = prescaled % 114;
+    }
+
+    // Each clock increments the counter; the clock after 0xFF reloads the latch
+    int clocks_to_reload = 0x100 - mapper->irq_counter;
+    if (clocks >= clocks_to_reload) {
+        clocks -= clocks_to_reload;
+        clocks %= 0x100 - mapper->irq_latch; // reloads within one batch raise the same IRQ
+        mapper->irq_counter = mapper->irq_latch;
+        cpu_trigger_irq(&mapper->agnes->cpu);
+    }
+    mapper->irq_counter += clocks;
+
+    clocks_to_reload = 0x100 - mapper->irq_counter;
+    if (cycle_mode) {
+        mapper->irq_event_cycles = clocks_to_reload;
+    } else {
+        mapper->irq_event_cycles = (clocks_to_reload - 1) * 114 + (114 - mapper->irq_prescaler);
     }
 }
 //FILE_END
@@ -70,6 +70,9 @@ typedef struct agnes_state agnes_state_t;
 // APU callback function types for external APU implementation
 typedef void (*agnes_apu_write_func)(void* user_data, uint16_t addr, uint8_t val, uint64_t cpu_cycle);
 typedef uint8_t (*agnes_apu_read_func)(void* user_data, uint16_t addr, uint64_t cpu_cycle);
+// Called when the game strobes the controllers (writes 1 to $4016), just
+// before the pads are latched: agnes_set_input() from here is what it reads
+typedef void (*agnes_input_poll_func)(void* user_data);
 
 agnes_t* agnes_make(void);
 void agnes_destroy(agnes_t *agn);
@@ -78,20 +81,192 @@ void agnes_set_input(agnes_t *agnes, const agnes_input_t *input_1, const agnes_i
 size_t agnes_state_size(void);
 void agnes_dump_state(const agnes_t *agnes, agnes_state_t *out_res);
 bool agnes_restore_state(agnes_t *agnes, const agnes_state_t *state);
+
+// Compact state: CPU, PPU registers, VRAM, OAM, RAM, controllers and the
+// mapper (CHR RAM only if the cart has it), without the framebuffer, pointers
+// or settings. The size depends on the loaded cart. A restore must be into an
+// instance with the same ROM loaded; it keeps the APU handler and leaves the
+// picture as it was until the PPU draws the next frame.
+size_t agnes_compact_state_size(const agnes_t *agnes);
+void agnes_dump_compact_state(const agnes_t *agnes, void *out_res);
+void agnes_restore_compact_state(agnes_t *agnes, const void *state);
 bool agnes_tick(agnes_t *agnes, bool *out_new_frame);
 bool agnes_next_frame(agnes_t *agnes);
 
 agnes_color_t agnes_get_screen_pixel(const agnes_t *agnes, int x, int y);
 
+// Raw PPU output: AGNES_SCREEN_WIDTH * AGNES_SCREEN_HEIGHT palette indices (0-63), row-major
+const uint8_t* agnes_get_screen_buffer(const agnes_t *agnes);
+
 // APU handler functions
 void agnes_set_apu_handler(agnes_t *agnes, 
                            agnes_apu_write_func write_func,
                            agnes_apu_read_func read_func,
                            void *user_data);
 
+// Input poll handler, for latching the pads as late as the game allows;
+// NULL (the default) leaves whatever agnes_set_input() set last
+void agnes_set_input_poll_handler(agnes_t *agnes, agnes_input_poll_func func, void *user_data);
+
 // Get current CPU cycle count (for APU synchronization)
 uint64_t agnes_get_cpu_cycles(const agnes_t *agnes);
 
+// Instructions executed since power-on (for profiling)
+uint64_t agnes_get_cpu_instructions(const agnes_t *agnes);
+
+// 6502 profiler, compiled in with AGNES_CPU_PROFILE=1: cycles counted into
+// caller-owned arrays of 0x10000 entries. A call is a JSR or an interrupt up
+// to the RTS or RTI that returns with the stack pointer it entered with (a
+// return to an address pushed by hand matches none); NMI handlers are frame
+// calls, their lengths logged in frame_cycles. DMA stalls count towards the
+// instruction that started them.
+#ifndef AGNES_CPU_PROFILE
+#define AGNES_CPU_PROFILE 0
+#endif
+#if AGNES_CPU_PROFILE
+enum { AGNES_PROFILE_MAX_DEPTH = 64 };
+
+typedef struct {
+    uint64_t *pc_cycles;        // by instruction address
+    uint64_t *routine_cycles;   // inside calls, callees included, by entry address
+    uint32_t *routine_calls;
+    uint32_t *frame_cycles;     // ring of frame_capacity
+    uint32_t frame_capacity;
+    uint64_t frames;            // frame calls returned
+    uint64_t clock;             // cycles counted
+
+    // Calls in progress; the outermost is dropped past AGNES_PROFILE_MAX_DEPTH
+    struct {
+        uint64_t start;
+        uint16_t addr;
+        uint8_t sp;
+        bool frame;
+    } calls[AGNES_PROFILE_MAX_DEPTH];
+    int depth;
+    uint16_t last_pc;
+} agnes_cpu_profile_t;
+
+// Count into 'profile' from the next instruction on; NULL (the default) stops.
+// It stays with the instance across state restores, which end the calls in
+// progress.
+void agnes_set_cpu_profile(agnes_t *agnes, agnes_cpu_profile_t *profile);
+agnes_cpu_profile_t *agnes_get_cpu_profile(const agnes_t *agnes);
+#endif
+
+// CPU read page table: 256 pointers, one per 256-byte page of the CPU address
+// space, NULL where a read has side effects or nothing is mapped, and where
+// the debugger watches reads (agnes_cpu_peek sees through those). It lives in
+// the agnes instance and follows bank switches and state restores, so the
+// pointer may be cached and indexed directly (e.g. for DMC sample fetches).
+const uint8_t *const *agnes_get_cpu_read_pages(const agnes_t *agnes);
+
+// Catch-up PPU scheduling (default on): the PPU runs only when the CPU touches
+// it or an NMI/IRQ deadline comes due. Off ticks it after every instruction.
+void agnes_set_ppu_catch_up(agnes_t *agnes, bool enabled);
+
+// Draw visible lines a tile at a time when no register write lands mid-line
+// (default on; only used with catch-up scheduling). Off keeps the per-dot renderer.
+void agnes_set_scanline_renderer(agnes_t *agnes, bool enabled);
+
+// Debug viewers. What changed in PPU memory since the previous call, then
+// cleared: pattern tiles as the PPU sees $0000-$1FFF (CHR RAM writes and
+// CHR bank switches), the four nametables at $2000-$2FFF (writes, and all of
+// them when the mirroring changes) and the palette. A state restore marks
+// everything.
+typedef struct {
+    uint64_t tiles[8];      // bit t % 64 of tiles[t / 64]: 16-byte tile t; one word per 1 KB
+    uint8_t nametables;     // bit n: the nametable at $2000 + n * $400
+    bool palette;
+} agnes_ppu_dirty_t;
+
+typedef struct {
+    uint16_t bg_table;      // pattern table of the background, $0000 or $1000
+    uint16_t sprite_table;  // of 8x8 sprites
+    bool sprites_8x16;
+    uint16_t scroll_x;      // 0-511 across the four nametables
+    uint16_t scroll_y;      // 0-479
+} agnes_ppu_info_t;
+
+void agnes_take_ppu_dirty(agnes_t *agnes, agnes_ppu_dirty_t *out);
+// 2-bit pixels (row-major 8x8) of pattern tile 0-511 as mapped at
+// $0000-$1FFF, from the renderer's decoded tile cache
+void agnes_ppu_tile_pixels(agnes_t *agnes, int tile, uint8_t out[64]);
+// PPU bus read ($0000-$3FFF) without side effects on the PPU
+uint8_t agnes_ppu_peek(const agnes_t *agnes, uint16_t addr);
+// 256 bytes: 64 sprites of y, tile, attributes, x
+const uint8_t *agnes_get_oam(const agnes_t *agnes);
+void agnes_get_ppu_info(const agnes_t *agnes, agnes_ppu_info_t *out);
+
+// RAM search and cheats: the 2 KB of CPU RAM at $0000-$07FF and the cart's
+// 8 KB of work RAM at $6000-$7FFF (NULL when its mapper has none). Writes
+// through the pointers land like the game's own stores would, without any
+// bus side effects.
+enum {
+    AGNES_RAM_SIZE = 0x800,
+    AGNES_WORK_RAM_SIZE = 0x2000
+};
+uint8_t *agnes_get_ram(agnes_t *agnes);
+uint8_t *agnes_get_work_ram(agnes_t *agnes);
+
+// Debugger: execution, read and write breakpoints by CPU address, a scanline
+// breakpoint and instruction stepping, set up in a caller-owned
+// agnes_debugger_t. agnes_debug_run is agnes_next_frame with the checks;
+// agnes_next_frame itself has none. While a debugger is set, pages holding
+// read or write breakpoints are taken out of the CPU page table, so only
+// accesses to them pay for the check. Call agnes_set_debugger again after
+// changing read or write breakpoints. It stays with the instance across
+// state restores.
+enum {
+    AGNES_BREAK_EXEC = 1,
+    AGNES_BREAK_READ = 2,
+    AGNES_BREAK_WRITE = 4
+};
+
+typedef enum {
+    AGNES_DEBUG_NONE,
+    AGNES_DEBUG_EXEC,       // before the instruction at 'addr' (an interrupt's handler when one is taken)
+    AGNES_DEBUG_READ,       // after the instruction that read 'value' from 'addr'
+    AGNES_DEBUG_WRITE,      // after the instruction that wrote 'value' to 'addr'
+    AGNES_DEBUG_SCANLINE,   // the PPU entered 'scanline'
+    AGNES_DEBUG_STEP        // 'steps' ran out
+} agnes_debug_reason_t;
+
+typedef struct {
+    uint8_t breakpoints[0x10000];   // AGNES_BREAK_* bits by address as accessed (mirrors apart)
+    int scanline;                   // 0-239 visible, 241 vblank, 261 pre-render; -1 off
+    uint32_t steps;                 // instructions to run before stopping; 0 off
+
+    // Why agnes_debug_run last stopped
+    agnes_debug_reason_t reason;
+    uint16_t addr;
+    uint8_t value;
+} agnes_debugger_t;
+
+enum {
+    AGNES_DEBUG_FRAME = 1,  // the frame ended
+    AGNES_DEBUG_BREAK = 2   // stopped early; the next call carries on from there
+};
+
+typedef struct {
+    uint16_t pc;
+    uint8_t a, x, y, sp, p;
+    bool interrupt;         // NMI or IRQ taken before the next instruction
+    int scanline;           // where the PPU is, counting the dots it owes
+    int dot;
+    uint64_t cycles;
+} agnes_cpu_regs_t;
+
+void agnes_set_debugger(agnes_t *agnes, agnes_debugger_t *debugger);
+agnes_debugger_t *agnes_get_debugger(const agnes_t *agnes);
+// AGNES_DEBUG_* bits, 0 on an illegal opcode. Without a debugger set it is
+// agnes_next_frame.
+int agnes_debug_run(agnes_t *agnes);
+void agnes_get_cpu_regs(const agnes_t *agnes, agnes_cpu_regs_t *out);
+// CPU bus read without side effects: RAM, work RAM and PRG ROM, 0 elsewhere
+uint8_t agnes_cpu_peek(const agnes_t *agnes, uint16_t addr);
+// The instruction at 'addr' as text ("LDA $0300,X"); returns its length in bytes
+int agnes_disassemble(const agnes_t *agnes, uint16_t addr, char *out, size_t size);
+
 #ifdef __cplusplus
 }
 #endif
@@ -145,3 +145,9 @@ namespace ImGui
     void MyFunction(const char* name, MyMatrix44* mtx);
 }
 */
+
+//---- fc visualizer: the current context is per thread, so offline video jobs can run UI frames of their
+// own contexts on worker threads while the main thread runs the application's.
+struct ImGuiContext;
+inline thread_local ImGuiContext* GImGuiThreadContext = nullptr;
+#define GImGui GImGuiThreadContext
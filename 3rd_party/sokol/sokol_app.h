@@ -2786,6 +2786,7 @@ typedef struct {
     VkSwapchainKHR swapchain;
     uint32_t num_swapchain_images;
     uint32_t cur_swapchain_image_index;
+    bool swapchain_image_acquired;  // sapp_get_swapchain() was called this frame
     VkImage swapchain_images[_SAPP_VK_MAX_SWAPCHAIN_IMAGES];
     VkImageView swapchain_views[_SAPP_VK_MAX_SWAPCHAIN_IMAGES];
     _sapp_vk_swapchain_surface_t msaa;
@@ -4435,6 +4436,18 @@ _SOKOL_PRIVATE void _sapp_vk_create_device(void) {
 
     _SAPP_VK_ZERO_COUNT_AND_ARRAY(32, const char*, ext_count, ext_names);
     ext_count = _sapp_vk_required_device_extensions(ext_names, 32);
+    #if defined(_SAPP_LINUX)
+    // optional: lets the application export images as DMA-BUF file descriptors
+    // (check with vkGetDeviceProcAddr(device, "vkGetMemoryFdKHR"))
+    const char* opt_ext_names[] = {
+        VK_KHR_EXTERNAL_MEMORY_FD_EXTENSION_NAME,
+        VK_EXT_EXTERNAL_MEMORY_DMA_BUF_EXTENSION_NAME,
+    };
+    if (_sapp_vk_check_device_extensions(_sapp.vk.physical_device, opt_ext_names, 2)) {
+        ext_names[ext_count++] = opt_ext_names[0];
+        ext_names[ext_count++] = opt_ext_names[1];
+    }
+    #endif
 
     _SAPP_STRUCT(VkPhysicalDeviceFeatures2, supports);
     supports.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
@@ -4891,6 +4904,7 @@ _SOKOL_PRIVATE void _sapp_vk_swapchain_next(void) {
         _sapp.vk.sync[_sapp.vk.sync_slot].present_complete_sem, // semaphore to signal
         0,  // fence to signal
         &_sapp.vk.cur_swapchain_image_index);
+    _sapp.vk.swapchain_image_acquired = true;
     if ((res != VK_NOT_READY) && (res != VK_SUBOPTIMAL_KHR) && (res != VK_SUCCESS) && (res != VK_TIMEOUT)) {
         _SAPP_WARN(VULKAN_ACQUIRE_NEXT_IMAGE_FAILED);
     }
@@ -4915,6 +4929,11 @@ _SOKOL_PRIVATE void _sapp_vk_present(void) {
 
 _SOKOL_PRIVATE void _sapp_vk_frame(void) {
     _sapp_frame();
+    // a frame callback that never asked for the swapchain skips presenting
+    if (!_sapp.vk.swapchain_image_acquired) {
+        return;
+    }
+    _sapp.vk.swapchain_image_acquired = false;
     _sapp_vk_present();
     _sapp.vk.sync_slot = (_sapp.vk.sync_slot + 1) % _sapp.vk.num_swapchain_images;
 }
@@ -177,6 +177,18 @@
     General parameters (both for stream-callback and push-model):
 
         int sample_rate     -- the sample rate in Hz, default: 44100
+        bool device_sample_rate -- open the device at its own mix rate instead
+                               of sample_rate (WASAPI and the WebAudio
+                               worklet), default: false
+        bool exclusive      -- bypass the system mixer with an exclusive-mode,
+                               event-driven stream (WASAPI only); falls back
+                               to shared mode if the device refuses, see
+                               saudio_exclusive(), default: false
+        capture_userdata_cb -- also open the default input device at the
+                               output's rate and channel count and hand it
+                               the recorded blocks, on a thread of the
+                               backend's own (ALSA and WASAPI); see
+                               saudio_capturing(), default: none
         int num_channels    -- number of channels, default: 1 (mono)
         int buffer_frames   -- number of frames in streaming buffer, default: 2048
 
@@ -327,6 +339,15 @@
     The WebAudio backend is automatically selected when compiling for
     emscripten (__EMSCRIPTEN__ define exists).
 
+    Define SOKOL_AUDIO_WORKLET (and link with -pthread -sAUDIO_WORKLET
+    -sWASM_WORKERS) to call the stream callback from a Wasm Audio Worklet
+    instead: it then runs on the browser's audio rendering thread, so a
+    stalled main thread no longer starves the output. The callback gets one
+    render quantum (128 frames) per call and must not block or allocate;
+    whatever it reads has to be in the shared wasm memory, e.g. a lock-free
+    ring filled by a pthread. Only the stream callback model is supported,
+    and the context starts (or resumes) on the first click, touch or key.
+
     https://developers.google.com/web/updates/2017/12/audio-worklet
     https://developers.google.com/web/updates/2018/06/audio-worklet-design-pattern
 
@@ -578,6 +599,8 @@ extern "C" {
     _SAUDIO_LOGITEM_XMACRO(WASAPI_AUDIO_CLIENT_GET_SERVICE_FAILED, "IAudioClient.GetService() failed") \
     _SAUDIO_LOGITEM_XMACRO(WASAPI_AUDIO_CLIENT_SET_EVENT_HANDLE_FAILED, "IAudioClient.SetEventHandle() failed") \
     _SAUDIO_LOGITEM_XMACRO(WASAPI_CREATE_THREAD_FAILED, "CreateThread() failed") \
+    _SAUDIO_LOGITEM_XMACRO(WASAPI_EXCLUSIVE_MODE_UNAVAILABLE, "exclusive mode refused by the device, using shared mode") \
+    _SAUDIO_LOGITEM_XMACRO(CAPTURE_UNAVAILABLE, "no input device could be opened for capture, playing without it") \
     _SAUDIO_LOGITEM_XMACRO(AAUDIO_STREAMBUILDER_OPEN_STREAM_FAILED, "AAudioStreamBuilder_openStream() failed") \
     _SAUDIO_LOGITEM_XMACRO(AAUDIO_PTHREAD_CREATE_FAILED, "pthread_create() failed after AAUDIO_ERROR_DISCONNECTED") \
     _SAUDIO_LOGITEM_XMACRO(AAUDIO_RESTARTING_STREAM_AFTER_ERROR, "restarting AAudio stream after error") \
@@ -586,6 +609,9 @@ extern "C" {
     _SAUDIO_LOGITEM_XMACRO(COREAUDIO_NEW_OUTPUT_FAILED, "AudioQueueNewOutput() failed") \
     _SAUDIO_LOGITEM_XMACRO(COREAUDIO_ALLOCATE_BUFFER_FAILED, "AudioQueueAllocateBuffer() failed") \
     _SAUDIO_LOGITEM_XMACRO(COREAUDIO_START_FAILED, "AudioQueueStart() failed") \
+    _SAUDIO_LOGITEM_XMACRO(WEBAUDIO_WORKLET_NEEDS_STREAM_CALLBACK, "the audio worklet backend needs a stream callback") \
+    _SAUDIO_LOGITEM_XMACRO(WEBAUDIO_CREATE_CONTEXT_FAILED, "creating the AudioContext failed") \
+    _SAUDIO_LOGITEM_XMACRO(WEBAUDIO_WORKLET_START_FAILED, "starting the audio worklet failed") \
     _SAUDIO_LOGITEM_XMACRO(BACKEND_BUFFER_SIZE_ISNT_MULTIPLE_OF_PACKET_SIZE, "backend buffer size isn't multiple of packet size") \
     _SAUDIO_LOGITEM_XMACRO(VITA_SCEAUDIO_OPEN_FAILED, "sceAudioOutOpenPort() failed") \
     _SAUDIO_LOGITEM_XMACRO(VITA_PTHREAD_CREATE_FAILED, "pthread_create() failed") \
@@ -656,6 +682,8 @@ typedef struct saudio_n3ds_desc {
 
 typedef struct saudio_desc {
     int sample_rate;        // requested sample rate
+    bool device_sample_rate;    // ignore sample_rate and use the device's mix rate where the backend can query it (WASAPI, WebAudio worklet)
+    bool exclusive;         // WASAPI: exclusive-mode stream with a period of about buffer_frames, shared mode if refused
     int num_channels;       // number of channels, default: 1 (mono)
     int buffer_frames;      // number of frames in streaming buffer
     int packet_frames;      // number of frames in a packet
@@ -663,6 +691,7 @@ typedef struct saudio_desc {
     void (*stream_cb)(float* buffer, int num_frames, int num_channels);  // optional streaming callback (no user data)
     void (*stream_userdata_cb)(float* buffer, int num_frames, int num_channels, void* user_data); //... and with user data
     void* user_data;        // optional user data argument for stream_userdata_cb
+    void (*capture_userdata_cb)(const float* buffer, int num_frames, int num_channels, void* user_data); // optional: record the default input device too (ALSA, WASAPI)
     saudio_n3ds_desc n3ds;       // optional data for use on n3ds
     saudio_allocator allocator;     // optional allocation override functions
     saudio_logger logger;           // optional logging function (default: NO LOGGING!)
@@ -672,6 +701,10 @@ typedef struct saudio_desc {
 SOKOL_AUDIO_API_DECL void saudio_setup(const saudio_desc* desc);
 /* shutdown sokol-audio */
 SOKOL_AUDIO_API_DECL void saudio_shutdown(void);
+/* true if the backend got the exclusive-mode stream saudio_desc.exclusive asked for */
+SOKOL_AUDIO_API_DECL bool saudio_exclusive(void);
+/* true if the input device saudio_desc.capture_userdata_cb asked for is recording */
+SOKOL_AUDIO_API_DECL bool saudio_capturing(void);
 /* true after setup if audio backend was successfully initialized */
 SOKOL_AUDIO_API_DECL bool saudio_isvalid(void);
 /* return the saudio_desc.user_data pointer */
@@ -756,6 +789,9 @@ inline void saudio_setup(const saudio_desc& desc) { return saudio_setup(&desc);
     #endif
 #elif defined(__EMSCRIPTEN__)
     #define _SAUDIO_EMSCRIPTEN (1)
+    #if defined(SOKOL_AUDIO_WORKLET)
+        #define _SAUDIO_WORKLET (1)
+    #endif
 #elif defined(_WIN32)
     #define _SAUDIO_WINDOWS (1)
     #include <winapifamily.h>
@@ -810,9 +846,11 @@ inline void saudio_setup(const saudio_desc& desc) { return saudio_setup(&desc);
     static const IID _saudio_IID_IMMDeviceEnumerator                        = { 0xa95664d2, 0x9614, 0x4f35, {0xa7, 0x46, 0xde, 0x8d, 0xb6, 0x36, 0x17, 0xe6} };
     static const CLSID _saudio_CLSID_IMMDeviceEnumerator                    = { 0xbcde0395, 0xe52f, 0x467c, {0x8e, 0x3d, 0xc4, 0x57, 0x92, 0x91, 0x69, 0x2e} };
     static const IID _saudio_IID_IAudioRenderClient                         = { 0xf294acfc, 0x3146, 0x4483, {0xa7, 0xbf, 0xad, 0xdc, 0xa7, 0xc2, 0x60, 0xe2} };
+    static const IID _saudio_IID_IAudioCaptureClient                        = { 0xc8adbd64, 0xe71e, 0x48a0, {0xa4, 0xde, 0x18, 0x5c, 0x39, 0x5c, 0xd3, 0x17} };
     static const IID _saudio_IID_Devinterface_Audio_Render                  = { 0xe6327cad, 0xdcec, 0x4949, {0xae, 0x8a, 0x99, 0x1e, 0x97, 0x6a, 0x79, 0xd2} };
     static const IID _saudio_IID_IActivateAudioInterface_Completion_Handler = { 0x94ea2b94, 0xe9cc, 0x49e0, {0xc0, 0xff, 0xee, 0x64, 0xca, 0x8f, 0x5b, 0x90} };
     static const GUID _saudio_KSDATAFORMAT_SUBTYPE_IEEE_FLOAT               = { 0x00000003, 0x0000, 0x0010, {0x80, 0x00, 0x00, 0xaa, 0x00, 0x38, 0x9b, 0x71} };
+    static const GUID _saudio_KSDATAFORMAT_SUBTYPE_PCM                      = { 0x00000001, 0x0000, 0x0010, {0x80, 0x00, 0x00, 0xaa, 0x00, 0x38, 0x9b, 0x71} };
     #if defined(__cplusplus)
     #define _SOKOL_AUDIO_WIN32COM_ID(x) (x)
     #else
@@ -867,6 +905,9 @@ inline void saudio_setup(const saudio_desc& desc) { return saudio_setup(&desc);
 #elif defined(__EMSCRIPTEN__)
     #define _SAUDIO_NOTHREADS (1)
     #include <emscripten/emscripten.h>
+    #if defined(_SAUDIO_WORKLET)
+        #include <emscripten/webaudio.h>
+    #endif
 #elif defined(_SAUDIO_VITA)
     #define _SAUDIO_PTHREADS (1)
     #include <pthread.h>
@@ -881,6 +922,7 @@ inline void saudio_setup(const saudio_desc& desc) { return saudio_setup(&desc);
 #define _SAUDIO_DEFAULT_BUFFER_FRAMES (2048)
 #define _SAUDIO_DEFAULT_PACKET_FRAMES (128)
 #define _SAUDIO_DEFAULT_NUM_PACKETS ((_SAUDIO_DEFAULT_BUFFER_FRAMES/_SAUDIO_DEFAULT_PACKET_FRAMES)*4)
+#define _SAUDIO_CAPTURE_PERIOD_FRAMES (256)     /* recorded blocks, small so they arrive soon after the sound */
 
 #ifndef SAUDIO_RING_MAX_SLOTS
 #define SAUDIO_RING_MAX_SLOTS (1024)
@@ -1027,6 +1069,14 @@ typedef struct {
 
 #elif defined(_SAUDIO_LINUX)
 
+typedef struct {
+    snd_pcm_t* device;
+    float* buffer;
+    int buffer_frames;
+    pthread_t thread;
+    bool thread_stop;
+} _saudio_alsa_capture_t;
+
 typedef struct {
     snd_pcm_t* device;
     float* buffer;
@@ -1034,6 +1084,7 @@ typedef struct {
     int buffer_frames;
     pthread_t thread;
     bool thread_stop;
+    _saudio_alsa_capture_t capture;
 } _saudio_alsa_backend_t;
 
 #elif defined(_SAUDIO_ANDROID)
@@ -1056,20 +1107,38 @@ typedef struct {
     int src_buffer_byte_size;
     int src_buffer_pos;
     float* src_buffer;
+    bool exclusive;     /* exclusive mode: every event wants the whole device buffer */
+    bool dst_int16;     /* the exclusive stream fell back to 16-bit PCM */
 } _saudio_wasapi_thread_data_t;
 
+typedef struct {
+    IMMDevice* device;
+    IAudioClient* audio_client;
+    IAudioCaptureClient* capture_client;
+    HANDLE thread_handle;
+    HANDLE event;
+    bool stop;
+    UINT32 buffer_frames;
+    float* silence;     /* handed over for packets the device flags silent */
+} _saudio_wasapi_capture_t;
+
 typedef struct {
     IMMDeviceEnumerator* device_enumerator;
     IMMDevice* device;
     IAudioClient* audio_client;
     IAudioRenderClient* render_client;
     _saudio_wasapi_thread_data_t thread;
+    _saudio_wasapi_capture_t capture;
 } _saudio_wasapi_backend_t;
 
 #elif defined(_SAUDIO_EMSCRIPTEN)
 
 typedef struct {
     uint8_t* buffer;
+    #if defined(_SAUDIO_WORKLET)
+    EMSCRIPTEN_WEBAUDIO_T context;
+    EMSCRIPTEN_AUDIO_WORKLET_NODE_T node;
+    #endif
 } _saudio_web_backend_t;
 
 #elif defined(_SAUDIO_VITA)
@@ -1152,6 +1221,7 @@ typedef struct {
     int packet_frames;          /* number of frames in a packet */
     int num_packets;            /* number of packets in packet queue */
     int num_channels;           /* actual number of channels */
+    bool capturing;             /* the capture stream is open */
     saudio_desc desc;
     _saudio_fifo_t fifo;
     _saudio_backend_t backend;
@@ -1563,6 +1633,70 @@ _SOKOL_PRIVATE void* _saudio_alsa_cb(void* param) {
     return 0;
 }
 
+/* the capture callback runs in a thread of its own, a period at a time */
+_SOKOL_PRIVATE void* _saudio_alsa_capture_cb(void* param) {
+    _SOKOL_UNUSED(param);
+    _saudio_alsa_capture_t* capture = &_saudio.backend.capture;
+    while (!capture->thread_stop) {
+        /* snd_pcm_readi() will be blocking until a period has been recorded */
+        snd_pcm_sframes_t read_res = snd_pcm_readi(capture->device, capture->buffer, (snd_pcm_uframes_t)capture->buffer_frames);
+        if (read_res < 0) {
+            /* overrun occurred */
+            snd_pcm_prepare(capture->device);
+        }
+        else if (read_res > 0) {
+            _saudio.desc.capture_userdata_cb(capture->buffer, (int)read_res, _saudio.num_channels, _saudio.desc.user_data);
+        }
+    }
+    return 0;
+}
+
+_SOKOL_PRIVATE void _saudio_alsa_capture_release(void) {
+    _saudio_alsa_capture_t* capture = &_saudio.backend.capture;
+    if (capture->device) {
+        snd_pcm_close(capture->device);
+        capture->device = 0;
+    }
+    if (capture->buffer) {
+        _saudio_free(capture->buffer);
+        capture->buffer = 0;
+    }
+}
+
+/* the default input device in the output's format and rate, exactly */
+_SOKOL_PRIVATE bool _saudio_alsa_capture_init(void) {
+    _saudio_alsa_capture_t* capture = &_saudio.backend.capture;
+    if (snd_pcm_open(&capture->device, "default", SND_PCM_STREAM_CAPTURE, 0) < 0) {
+        capture->device = 0;
+        return false;
+    }
+    snd_pcm_hw_params_t* params = 0;
+    snd_pcm_hw_params_alloca(&params);
+    snd_pcm_hw_params_any(capture->device, params);
+    snd_pcm_hw_params_set_access(capture->device, params, SND_PCM_ACCESS_RW_INTERLEAVED);
+    snd_pcm_uframes_t period = _SAUDIO_CAPTURE_PERIOD_FRAMES;
+    snd_pcm_uframes_t buffer_size = period * 4;
+    int dir = 0;
+    if ((0 > snd_pcm_hw_params_set_format(capture->device, params, SND_PCM_FORMAT_FLOAT_LE)) ||
+        (0 > snd_pcm_hw_params_set_channels(capture->device, params, (uint32_t)_saudio.num_channels)) ||
+        (0 > snd_pcm_hw_params_set_rate(capture->device, params, (uint32_t)_saudio.sample_rate, 0)) ||
+        (0 > snd_pcm_hw_params_set_period_size_near(capture->device, params, &period, &dir)) ||
+        (0 > snd_pcm_hw_params_set_buffer_size_near(capture->device, params, &buffer_size)) ||
+        (0 > snd_pcm_hw_params(capture->device, params)))
+    {
+        _saudio_alsa_capture_release();
+        return false;
+    }
+    snd_pcm_hw_params_get_period_size(params, &period, &dir);
+    capture->buffer_frames = (int)period;
+    capture->buffer = (float*) _saudio_malloc_clear((size_t)(capture->buffer_frames * _saudio.bytes_per_frame));
+    if (0 != pthread_create(&capture->thread, 0, _saudio_alsa_capture_cb, 0)) {
+        _saudio_alsa_capture_release();
+        return false;
+    }
+    return true;
+}
+
 _SOKOL_PRIVATE bool _saudio_alsa_backend_init(void) {
     int dir; uint32_t rate;
     int rc = snd_pcm_open(&_saudio.backend.device, "default", SND_PCM_STREAM_PLAYBACK, 0);
@@ -1618,6 +1752,13 @@ _SOKOL_PRIVATE bool _saudio_alsa_backend_init(void) {
         goto error;
     }
 
+    /* an input device is a bonus, playback goes on without one */
+    if (_saudio.desc.capture_userdata_cb) {
+        _saudio.capturing = _saudio_alsa_capture_init();
+        if (!_saudio.capturing) {
+            _SAUDIO_WARN(CAPTURE_UNAVAILABLE);
+        }
+    }
     return true;
 error:
     if (_saudio.backend.device) {
@@ -1629,6 +1770,12 @@ error:
 
 _SOKOL_PRIVATE void _saudio_alsa_backend_shutdown(void) {
     SOKOL_ASSERT(_saudio.backend.device);
+    if (_saudio.capturing) {
+        _saudio.backend.capture.thread_stop = true;
+        pthread_join(_saudio.backend.capture.thread, 0);
+        _saudio_alsa_capture_release();
+        _saudio.capturing = false;
+    }
     _saudio.backend.thread_stop = true;
     pthread_join(_saudio.backend.thread, 0);
     snd_pcm_drain(_saudio.backend.device);
@@ -1676,6 +1823,7 @@ _SOKOL_PRIVATE void _saudio_wasapi_submit_buffer(int num_frames) {
     float* dst = (float*)wasapi_buffer;
     const float* dst_end = dst + num_remaining_samples;
     _SOKOL_UNUSED(dst_end); // suppress unused warning in release mode
+    int16_t* dst_int16 = (int16_t*)wasapi_buffer;
     const float* src = _saudio.backend.thread.src_buffer;
 
     while (num_remaining_samples > 0) {
@@ -1684,12 +1832,22 @@ _SOKOL_PRIVATE void _saudio_wasapi_submit_buffer(int num_frames) {
         }
         const int samples_to_copy = _saudio_wasapi_min(num_remaining_samples, buffer_size_in_samples - buffer_pos);
         SOKOL_ASSERT((buffer_pos + samples_to_copy) <= buffer_size_in_samples);
-        SOKOL_ASSERT((dst + samples_to_copy) <= dst_end);
-        memcpy(dst, &src[buffer_pos], (size_t)samples_to_copy * sizeof(float));
+        if (_saudio.backend.thread.dst_int16) {
+            for (int i = 0; i < samples_to_copy; i++) {
+                float sample = src[buffer_pos + i] * 32767.0f;
+                sample = (sample > 32767.0f) ? 32767.0f : ((sample < -32768.0f) ? -32768.0f : sample);
+                dst_int16[i] = (int16_t)sample;
+            }
+            dst_int16 += samples_to_copy;
+        }
+        else {
+            SOKOL_ASSERT((dst + samples_to_copy) <= dst_end);
+            memcpy(dst, &src[buffer_pos], (size_t)samples_to_copy * sizeof(float));
+            dst += samples_to_copy;
+        }
         num_remaining_samples -= samples_to_copy;
         SOKOL_ASSERT(num_remaining_samples >= 0);
         buffer_pos += samples_to_copy;
-        dst += samples_to_copy;
 
         SOKOL_ASSERT(buffer_pos <= buffer_size_in_samples);
         if (buffer_pos == buffer_size_in_samples) {
@@ -1712,6 +1870,10 @@ _SOKOL_PRIVATE DWORD WINAPI _saudio_wasapi_thread_fn(LPVOID param) {
         }
         SOKOL_ASSERT(_saudio.backend.thread.dst_buffer_frames >= padding);
         int num_frames = (int)_saudio.backend.thread.dst_buffer_frames - (int)padding;
+        if (_saudio.backend.thread.exclusive) {
+            /* each event hands over one whole period */
+            num_frames = (int)_saudio.backend.thread.dst_buffer_frames;
+        }
         if (num_frames > 0) {
             _saudio_wasapi_submit_buffer(num_frames);
         }
@@ -1746,8 +1908,195 @@ _SOKOL_PRIVATE void _saudio_wasapi_release(void) {
     }
 }
 
+_SOKOL_PRIVATE bool _saudio_wasapi_activate(void) {
+    return SUCCEEDED(IMMDevice_Activate(_saudio.backend.device,
+        _SOKOL_AUDIO_WIN32COM_ID(_saudio_IID_IAudioClient),
+        CLSCTX_ALL, 0,
+        (void**)&_saudio.backend.audio_client));
+}
+
+/* 32-bit float, or 16-bit PCM for exclusive-mode devices without float support */
+_SOKOL_PRIVATE void _saudio_wasapi_init_format(WAVEFORMATEXTENSIBLE* fmtex, bool int16) {
+    _saudio_clear(fmtex, sizeof(*fmtex));
+    fmtex->Format.nChannels = (WORD)_saudio.num_channels;
+    fmtex->Format.nSamplesPerSec = (DWORD)_saudio.sample_rate;
+    fmtex->Format.wFormatTag = WAVE_FORMAT_EXTENSIBLE;
+    fmtex->Format.wBitsPerSample = int16 ? 16 : 32;
+    fmtex->Format.nBlockAlign = (fmtex->Format.nChannels * fmtex->Format.wBitsPerSample) / 8;
+    fmtex->Format.nAvgBytesPerSec = fmtex->Format.nSamplesPerSec * fmtex->Format.nBlockAlign;
+    fmtex->Format.cbSize = 22;   /* WORD + DWORD + GUID */
+    fmtex->Samples.wValidBitsPerSample = fmtex->Format.wBitsPerSample;
+    if (_saudio.num_channels == 1) {
+        fmtex->dwChannelMask = SPEAKER_FRONT_CENTER;
+    }
+    else {
+        fmtex->dwChannelMask = SPEAKER_FRONT_LEFT|SPEAKER_FRONT_RIGHT;
+    }
+    fmtex->SubFormat = int16 ? _saudio_KSDATAFORMAT_SUBTYPE_PCM : _saudio_KSDATAFORMAT_SUBTYPE_IEEE_FLOAT;
+}
+
+_SOKOL_PRIVATE REFERENCE_TIME _saudio_wasapi_frames_to_duration(UINT32 frames) {
+    return (REFERENCE_TIME)(10000000.0 * (double)frames / (double)_saudio.sample_rate + 0.5);
+}
+
+/* exclusive-mode, event-driven stream with a period of about buffer_frames
+   (at least the device minimum); on failure the client is left unusable */
+_SOKOL_PRIVATE bool _saudio_wasapi_init_exclusive(void) {
+    REFERENCE_TIME default_period = 0;
+    REFERENCE_TIME min_period = 0;
+    if (FAILED(IAudioClient_GetDevicePeriod(_saudio.backend.audio_client, &default_period, &min_period))) {
+        return false;
+    }
+    WAVEFORMATEXTENSIBLE fmtex;
+    bool int16 = false;
+    _saudio_wasapi_init_format(&fmtex, false);
+    if (S_OK != IAudioClient_IsFormatSupported(_saudio.backend.audio_client, AUDCLNT_SHAREMODE_EXCLUSIVE, (WAVEFORMATEX*)&fmtex, 0)) {
+        int16 = true;
+        _saudio_wasapi_init_format(&fmtex, true);
+        if (S_OK != IAudioClient_IsFormatSupported(_saudio.backend.audio_client, AUDCLNT_SHAREMODE_EXCLUSIVE, (WAVEFORMATEX*)&fmtex, 0)) {
+            return false;
+        }
+    }
+    REFERENCE_TIME dur = _saudio_wasapi_frames_to_duration((UINT32)_saudio.buffer_frames);
+    if (dur < min_period) {
+        dur = min_period;
+    }
+    HRESULT hr = IAudioClient_Initialize(_saudio.backend.audio_client,
+        AUDCLNT_SHAREMODE_EXCLUSIVE, AUDCLNT_STREAMFLAGS_EVENTCALLBACK,
+        dur, dur, (WAVEFORMATEX*)&fmtex, 0);
+    if (hr == AUDCLNT_E_BUFFER_SIZE_NOT_ALIGNED) {
+        /* retry with the aligned size the device reports, on a fresh client */
+        UINT32 aligned_frames = 0;
+        if (FAILED(IAudioClient_GetBufferSize(_saudio.backend.audio_client, &aligned_frames))) {
+            return false;
+        }
+        IAudioClient_Release(_saudio.backend.audio_client);
+        _saudio.backend.audio_client = 0;
+        if (!_saudio_wasapi_activate()) {
+            return false;
+        }
+        dur = _saudio_wasapi_frames_to_duration(aligned_frames);
+        hr = IAudioClient_Initialize(_saudio.backend.audio_client,
+            AUDCLNT_SHAREMODE_EXCLUSIVE, AUDCLNT_STREAMFLAGS_EVENTCALLBACK,
+            dur, dur, (WAVEFORMATEX*)&fmtex, 0);
+    }
+    if (FAILED(hr)) {
+        return false;
+    }
+    _saudio.backend.thread.exclusive = true;
+    _saudio.backend.thread.dst_int16 = int16;
+    return true;
+}
+
+_SOKOL_PRIVATE DWORD WINAPI _saudio_wasapi_capture_thread_fn(LPVOID param) {
+    (void)param;
+    _saudio_wasapi_capture_t* capture = &_saudio.backend.capture;
+    IAudioClient_Start(capture->audio_client);
+    while (!capture->stop) {
+        WaitForSingleObject(capture->event, INFINITE);
+        UINT32 packet_frames = 0;
+        while (!capture->stop &&
+               SUCCEEDED(IAudioCaptureClient_GetNextPacketSize(capture->capture_client, &packet_frames)) &&
+               (packet_frames > 0))
+        {
+            BYTE* data = 0;
+            UINT32 num_frames = 0;
+            DWORD flags = 0;
+            if (FAILED(IAudioCaptureClient_GetBuffer(capture->capture_client, &data, &num_frames, &flags, 0, 0))) {
+                break;
+            }
+            const float* samples = (const float*)data;
+            if (flags & AUDCLNT_BUFFERFLAGS_SILENT) {
+                samples = capture->silence;
+                if (num_frames > capture->buffer_frames) {
+                    num_frames = capture->buffer_frames;
+                }
+            }
+            if (num_frames > 0) {
+                _saudio.desc.capture_userdata_cb(samples, (int)num_frames, _saudio.num_channels, _saudio.desc.user_data);
+            }
+            IAudioCaptureClient_ReleaseBuffer(capture->capture_client, num_frames);
+        }
+    }
+    IAudioClient_Stop(capture->audio_client);
+    return 0;
+}
+
+_SOKOL_PRIVATE void _saudio_wasapi_capture_release(void) {
+    _saudio_wasapi_capture_t* capture = &_saudio.backend.capture;
+    if (capture->thread_handle) {
+        capture->stop = true;
+        SetEvent(capture->event);
+        WaitForSingleObject(capture->thread_handle, INFINITE);
+        CloseHandle(capture->thread_handle);
+        capture->thread_handle = 0;
+    }
+    if (capture->silence) {
+        _saudio_free(capture->silence);
+        capture->silence = 0;
+    }
+    if (capture->capture_client) {
+        IAudioCaptureClient_Release(capture->capture_client);
+        capture->capture_client = 0;
+    }
+    if (capture->audio_client) {
+        IAudioClient_Release(capture->audio_client);
+        capture->audio_client = 0;
+    }
+    if (capture->device) {
+        IMMDevice_Release(capture->device);
+        capture->device = 0;
+    }
+    if (capture->event) {
+        CloseHandle(capture->event);
+        capture->event = 0;
+    }
+}
+
+/* shared-mode, event-driven stream from the default input device in the
+   output's format; the mixer converts whatever the device records */
+_SOKOL_PRIVATE bool _saudio_wasapi_capture_init(void) {
+    _saudio_wasapi_capture_t* capture = &_saudio.backend.capture;
+    capture->event = CreateEvent(0, FALSE, FALSE, 0);
+    if (0 == capture->event) {
+        return false;
+    }
+    if (FAILED(IMMDeviceEnumerator_GetDefaultAudioEndpoint(_saudio.backend.device_enumerator, eCapture, eConsole, &capture->device))) {
+        return false;
+    }
+    if (FAILED(IMMDevice_Activate(capture->device, _SOKOL_AUDIO_WIN32COM_ID(_saudio_IID_IAudioClient), CLSCTX_ALL, 0, (void**)&capture->audio_client))) {
+        return false;
+    }
+    WAVEFORMATEXTENSIBLE fmtex;
+    _saudio_wasapi_init_format(&fmtex, false);
+    REFERENCE_TIME dur = _saudio_wasapi_frames_to_duration(_SAUDIO_CAPTURE_PERIOD_FRAMES * 4);
+    if (FAILED(IAudioClient_Initialize(capture->audio_client,
+        AUDCLNT_SHAREMODE_SHARED,
+        AUDCLNT_STREAMFLAGS_EVENTCALLBACK|AUDCLNT_STREAMFLAGS_AUTOCONVERTPCM|AUDCLNT_STREAMFLAGS_SRC_DEFAULT_QUALITY,
+        dur, 0, (WAVEFORMATEX*)&fmtex, 0)))
+    {
+        return false;
+    }
+    if (FAILED(IAudioClient_GetBufferSize(capture->audio_client, &capture->buffer_frames))) {
+        return false;
+    }
+    if (FAILED(IAudioClient_GetService(capture->audio_client,
+        _SOKOL_AUDIO_WIN32COM_ID(_saudio_IID_IAudioCaptureClient),
+        (void**)&capture->capture_client)))
+    {
+        return false;
+    }
+    if (FAILED(IAudioClient_SetEventHandle(capture->audio_client, capture->event))) {
+        return false;
+    }
+    capture->silence = (float*) _saudio_malloc_clear((size_t)capture->buffer_frames * (size_t)_saudio.bytes_per_frame);
+    capture->thread_handle = CreateThread(NULL, 0, _saudio_wasapi_capture_thread_fn, 0, 0, 0);
+    return 0 != capture->thread_handle;
+}
+
 _SOKOL_PRIVATE bool _saudio_wasapi_backend_init(void) {
     REFERENCE_TIME dur;
+    bool exclusive;
     /* CoInitializeEx could have been called elsewhere already, in which
         case the function returns with S_FALSE (thus it does not make much
         sense to check the result)
@@ -1774,41 +2123,49 @@ _SOKOL_PRIVATE bool _saudio_wasapi_backend_init(void) {
         _SAUDIO_ERROR(WASAPI_GET_DEFAULT_AUDIO_ENDPOINT_FAILED);
         goto error;
     }
-    if (FAILED(IMMDevice_Activate(_saudio.backend.device,
-        _SOKOL_AUDIO_WIN32COM_ID(_saudio_IID_IAudioClient),
-        CLSCTX_ALL, 0,
-        (void**)&_saudio.backend.audio_client)))
-    {
+    if (!_saudio_wasapi_activate()) {
         _SAUDIO_ERROR(WASAPI_DEVICE_ACTIVATE_FAILED);
         goto error;
     }
 
-    WAVEFORMATEXTENSIBLE fmtex;
-    _saudio_clear(&fmtex, sizeof(fmtex));
-    fmtex.Format.nChannels = (WORD)_saudio.num_channels;
-    fmtex.Format.nSamplesPerSec = (DWORD)_saudio.sample_rate;
-    fmtex.Format.wFormatTag = WAVE_FORMAT_EXTENSIBLE;
-    fmtex.Format.wBitsPerSample = 32;
-    fmtex.Format.nBlockAlign = (fmtex.Format.nChannels * fmtex.Format.wBitsPerSample) / 8;
-    fmtex.Format.nAvgBytesPerSec = fmtex.Format.nSamplesPerSec * fmtex.Format.nBlockAlign;
-    fmtex.Format.cbSize = 22;   /* WORD + DWORD + GUID */
-    fmtex.Samples.wValidBitsPerSample = 32;
-    if (_saudio.num_channels == 1) {
-        fmtex.dwChannelMask = SPEAKER_FRONT_CENTER;
+    /* the shared-mode mixer resamples anything else to this rate */
+    if (_saudio.desc.device_sample_rate) {
+        WAVEFORMATEX* mix_format = 0;
+        if (SUCCEEDED(IAudioClient_GetMixFormat(_saudio.backend.audio_client, &mix_format))) {
+            _saudio.sample_rate = (int)mix_format->nSamplesPerSec;
+            CoTaskMemFree(mix_format);
+        }
     }
-    else {
-        fmtex.dwChannelMask = SPEAKER_FRONT_LEFT|SPEAKER_FRONT_RIGHT;
+
+    exclusive = false;
+    if (_saudio.desc.exclusive) {
+        exclusive = _saudio_wasapi_init_exclusive();
+        if (!exclusive) {
+            _SAUDIO_WARN(WASAPI_EXCLUSIVE_MODE_UNAVAILABLE);
+            /* a failed Initialize() leaves the client unusable */
+            if (_saudio.backend.audio_client) {
+                IAudioClient_Release(_saudio.backend.audio_client);
+                _saudio.backend.audio_client = 0;
+            }
+            if (!_saudio_wasapi_activate()) {
+                _SAUDIO_ERROR(WASAPI_DEVICE_ACTIVATE_FAILED);
+                goto error;
+            }
+        }
     }
-    fmtex.SubFormat = _saudio_KSDATAFORMAT_SUBTYPE_IEEE_FLOAT;
-    dur = (REFERENCE_TIME)
-        (((double)_saudio.buffer_frames) / (((double)_saudio.sample_rate) * (1.0/10000000.0)));
-    if (FAILED(IAudioClient_Initialize(_saudio.backend.audio_client,
-        AUDCLNT_SHAREMODE_SHARED,
-        AUDCLNT_STREAMFLAGS_EVENTCALLBACK|AUDCLNT_STREAMFLAGS_AUTOCONVERTPCM|AUDCLNT_STREAMFLAGS_SRC_DEFAULT_QUALITY,
-        dur, 0, (WAVEFORMATEX*)&fmtex, 0)))
-    {
-        _SAUDIO_ERROR(WASAPI_AUDIO_CLIENT_INITIALIZE_FAILED);
-        goto error;
+    if (!exclusive) {
+        WAVEFORMATEXTENSIBLE fmtex;
+        _saudio_wasapi_init_format(&fmtex, false);
+        dur = (REFERENCE_TIME)
+            (((double)_saudio.buffer_frames) / (((double)_saudio.sample_rate) * (1.0/10000000.0)));
+        if (FAILED(IAudioClient_Initialize(_saudio.backend.audio_client,
+            AUDCLNT_SHAREMODE_SHARED,
+            AUDCLNT_STREAMFLAGS_EVENTCALLBACK|AUDCLNT_STREAMFLAGS_AUTOCONVERTPCM|AUDCLNT_STREAMFLAGS_SRC_DEFAULT_QUALITY,
+            dur, 0, (WAVEFORMATEX*)&fmtex, 0)))
+        {
+            _SAUDIO_ERROR(WASAPI_AUDIO_CLIENT_INITIALIZE_FAILED);
+            goto error;
+        }
     }
     if (FAILED(IAudioClient_GetBufferSize(_saudio.backend.audio_client, &_saudio.backend.thread.dst_buffer_frames))) {
         _SAUDIO_ERROR(WASAPI_AUDIO_CLIENT_GET_BUFFER_SIZE_FAILED);
@@ -1827,6 +2184,10 @@ _SOKOL_PRIVATE bool _saudio_wasapi_backend_init(void) {
     }
     _saudio.bytes_per_frame = _saudio.num_channels * (int)sizeof(float);
     _saudio.backend.thread.src_buffer_frames = _saudio.buffer_frames;
+    if (exclusive) {
+        /* one stream callback per period, nothing held back in between */
+        _saudio.backend.thread.src_buffer_frames = (int)_saudio.backend.thread.dst_buffer_frames;
+    }
     _saudio.backend.thread.src_buffer_byte_size = _saudio.backend.thread.src_buffer_frames * _saudio.bytes_per_frame;
 
     /* allocate an intermediate buffer for sample format conversion */
@@ -1838,6 +2199,15 @@ _SOKOL_PRIVATE bool _saudio_wasapi_backend_init(void) {
         _SAUDIO_ERROR(WASAPI_CREATE_THREAD_FAILED);
         goto error;
     }
+
+    /* an input device is a bonus, playback goes on without one */
+    if (_saudio.desc.capture_userdata_cb) {
+        _saudio.capturing = _saudio_wasapi_capture_init();
+        if (!_saudio.capturing) {
+            _saudio_wasapi_capture_release();
+            _SAUDIO_WARN(CAPTURE_UNAVAILABLE);
+        }
+    }
     return true;
 error:
     _saudio_wasapi_release();
@@ -1845,6 +2215,8 @@ error:
 }
 
 _SOKOL_PRIVATE void _saudio_wasapi_backend_shutdown(void) {
+    _saudio_wasapi_capture_release();
+    _saudio.capturing = false;
     if (_saudio.backend.thread.thread_handle) {
         _saudio.backend.thread.stop = true;
         SetEvent(_saudio.backend.thread.buffer_end_event);
@@ -1866,6 +2238,139 @@ _SOKOL_PRIVATE void _saudio_wasapi_backend_shutdown(void) {
 //  ███ ███  ███████ ██████  ██   ██  ██████  ██████  ██  ██████
 //
 // >>webaudio
+#elif defined(_SAUDIO_EMSCRIPTEN) && defined(_SAUDIO_WORKLET)
+
+#define _SAUDIO_WORKLET_QUANTUM (128)           /* WebAudio's render quantum */
+#define _SAUDIO_WORKLET_MAX_CHANNELS (8)
+#define _SAUDIO_WORKLET_STACK_SIZE (64 * 1024)
+
+/* static so a worklet still finishing a quantum after shutdown never
+   touches freed memory */
+static uint8_t _saudio_worklet_stack[_SAUDIO_WORKLET_STACK_SIZE] __attribute__((aligned(16)));
+static float _saudio_worklet_buffer[_SAUDIO_WORKLET_QUANTUM * _SAUDIO_WORKLET_MAX_CHANNELS];
+
+/* connect the worklet node and resume the context on the first user action */
+EM_JS(void, saudio_js_worklet_connect, (int node, int context), {
+    const ctx = emscriptenGetAudioObject(context);
+    emscriptenGetAudioObject(node).connect(ctx.destination);
+    const resume_webaudio = () => {
+        if (ctx.state === 'suspended') {
+            ctx.resume();
+        }
+    };
+    document.addEventListener('click', resume_webaudio, {once:true});
+    document.addEventListener('touchend', resume_webaudio, {once:true});
+    document.addEventListener('keydown', resume_webaudio, {once:true});
+})
+
+EM_JS(int, saudio_js_worklet_sample_rate, (int context), {
+    return emscriptenGetAudioObject(context).sampleRate;
+})
+
+/* called on the audio worklet thread for every render quantum */
+_SOKOL_PRIVATE bool _saudio_worklet_process(int num_inputs, const AudioSampleFrame* inputs, int num_outputs, AudioSampleFrame* outputs, int num_params, const AudioParamFrame* params, void* user_data) {
+    _SOKOL_UNUSED(num_inputs);
+    _SOKOL_UNUSED(inputs);
+    _SOKOL_UNUSED(num_params);
+    _SOKOL_UNUSED(params);
+    /* a node left over from an earlier setup goes quiet and ends */
+    const bool current = _saudio.valid && ((EMSCRIPTEN_WEBAUDIO_T)(intptr_t)user_data == _saudio.backend.context);
+    if (num_outputs < 1) {
+        return current;
+    }
+    const int num_channels = _saudio.num_channels;
+    float* interleaved = _saudio_worklet_buffer;
+    if (current) {
+        _saudio_stream_callback(interleaved, _SAUDIO_WORKLET_QUANTUM, num_channels);
+    }
+    /* WebAudio wants one plane per channel */
+    const int out_channels = outputs[0].numberOfChannels;
+    for (int chn = 0; chn < out_channels; chn++) {
+        float* plane = outputs[0].data + chn * _SAUDIO_WORKLET_QUANTUM;
+        if (current && (chn < num_channels)) {
+            for (int i = 0; i < _SAUDIO_WORKLET_QUANTUM; i++) {
+                plane[i] = interleaved[i * num_channels + chn];
+            }
+        }
+        else {
+            _saudio_clear(plane, _SAUDIO_WORKLET_QUANTUM * sizeof(float));
+        }
+    }
+    return current;
+}
+
+_SOKOL_PRIVATE void _saudio_worklet_processor_created(EMSCRIPTEN_WEBAUDIO_T context, bool success, void* user_data) {
+    _SOKOL_UNUSED(user_data);
+    if (!success || (context != _saudio.backend.context)) {
+        if (!success) {
+            _SAUDIO_ERROR(WEBAUDIO_WORKLET_START_FAILED);
+        }
+        return;
+    }
+    int output_channels[1] = { _saudio.num_channels };
+    EmscriptenAudioWorkletNodeCreateOptions options;
+    _saudio_clear(&options, sizeof(options));
+    options.numberOfInputs = 0;
+    options.numberOfOutputs = 1;
+    options.outputChannelCounts = output_channels;
+    _saudio.backend.node = emscripten_create_wasm_audio_worklet_node(context, "sokol-audio", &options,
+        _saudio_worklet_process, (void*)(intptr_t)context);
+    saudio_js_worklet_connect(_saudio.backend.node, context);
+}
+
+_SOKOL_PRIVATE void _saudio_worklet_thread_started(EMSCRIPTEN_WEBAUDIO_T context, bool success, void* user_data) {
+    _SOKOL_UNUSED(user_data);
+    if (!success) {
+        _SAUDIO_ERROR(WEBAUDIO_WORKLET_START_FAILED);
+        return;
+    }
+    WebAudioWorkletProcessorCreateOptions options;
+    _saudio_clear(&options, sizeof(options));
+    options.name = "sokol-audio";
+    emscripten_create_wasm_audio_worklet_processor_async(context, &options, _saudio_worklet_processor_created, 0);
+}
+
+/* return 1 if the WebAudio context is currently suspended, else 0 */
+_SOKOL_PRIVATE int saudio_js_suspended(void) {
+    return (_saudio.backend.context &&
+            emscripten_audio_context_state(_saudio.backend.context) == AUDIO_CONTEXT_STATE_SUSPENDED) ? 1 : 0;
+}
+
+/* the worklet thread and its node come up asynchronously; until then the
+   context plays silence */
+_SOKOL_PRIVATE bool _saudio_webaudio_backend_init(void) {
+    if (!_saudio_has_callback()) {
+        _SAUDIO_ERROR(WEBAUDIO_WORKLET_NEEDS_STREAM_CALLBACK);
+        return false;
+    }
+    SOKOL_ASSERT(_saudio.num_channels <= _SAUDIO_WORKLET_MAX_CHANNELS);
+    EmscriptenWebAudioCreateAttributes attrs;
+    _saudio_clear(&attrs, sizeof(attrs));
+    attrs.latencyHint = "interactive";
+    attrs.sampleRate = _saudio.desc.device_sample_rate ? 0 : (uint32_t)_saudio.sample_rate;
+    _saudio.backend.context = emscripten_create_audio_context(&attrs);
+    if (!_saudio.backend.context) {
+        _SAUDIO_ERROR(WEBAUDIO_CREATE_CONTEXT_FAILED);
+        return false;
+    }
+    _saudio.bytes_per_frame = (int)sizeof(float) * _saudio.num_channels;
+    _saudio.sample_rate = saudio_js_worklet_sample_rate(_saudio.backend.context);
+    _saudio.buffer_frames = _SAUDIO_WORKLET_QUANTUM;
+    _saudio.backend.buffer = (uint8_t*)_saudio_worklet_buffer;
+    emscripten_start_wasm_audio_worklet_thread_async(_saudio.backend.context, _saudio_worklet_stack,
+        sizeof(_saudio_worklet_stack), _saudio_worklet_thread_started, 0);
+    return true;
+}
+
+_SOKOL_PRIVATE void _saudio_webaudio_backend_shutdown(void) {
+    if (_saudio.backend.context) {
+        emscripten_destroy_audio_context(_saudio.backend.context);
+    }
+    _saudio.backend.context = 0;
+    _saudio.backend.node = 0;
+    _saudio.backend.buffer = 0;
+}
+
 #elif defined(_SAUDIO_EMSCRIPTEN)
 
 #ifdef __cplusplus
@@ -2608,6 +3113,20 @@ SOKOL_API_IMPL int saudio_buffer_frames(void) {
     return _saudio.buffer_frames;
 }
 
+SOKOL_API_IMPL bool saudio_exclusive(void) {
+    SOKOL_ASSERT(_saudio.setup_called);
+    #if defined(_SAUDIO_WINDOWS) && !defined(SOKOL_DUMMY_BACKEND)
+        return _saudio.valid && _saudio.backend.thread.exclusive;
+    #else
+        return false;
+    #endif
+}
+
+SOKOL_API_IMPL bool saudio_capturing(void) {
+    SOKOL_ASSERT(_saudio.setup_called);
+    return _saudio.valid && _saudio.capturing;
+}
+
 SOKOL_API_IMPL int saudio_channels(void) {
     SOKOL_ASSERT(_saudio.setup_called);
     return _saudio.num_channels;
@@ -3377,6 +3377,13 @@ typedef struct sg_image_data {
     .mtl_textures[SG_NUM_INFLIGHT_FRAMES]
     .d3d11_texture
     .wgpu_texture
+    .vk_image
+
+    For Vulkan, .vk_image is a VkImage that must match the image desc (type,
+    size, format, sample count, and usage flags covering the sg_image_usage),
+    and whose memory is already bound; sokol_gfx neither frees the image nor
+    its memory, so keep both alive until the sg_image is destroyed and the
+    frames using it have completed.
 
     For GL, you can also specify the texture target or leave it empty to use
     the default texture target for the image type (GL_TEXTURE_2D for
@@ -3403,6 +3410,7 @@ typedef struct sg_image_desc {
     const void* mtl_textures[SG_NUM_INFLIGHT_FRAMES];
     const void* d3d11_texture;
     const void* wgpu_texture;
+    const void* vk_image;
     uint32_t _end_canary;
 } sg_image_desc;
 
@@ -6984,6 +6992,7 @@ typedef struct _sg_image_s {
         VkImage img;
         VkDeviceMemory mem;
         _sg_vk_access_t cur_access;
+        bool injected;  // if true, the VkImage was injected with sg_image_desc.vk_image
     } vk;
 } _sg_vk_image_t;
 typedef _sg_vk_image_t _sg_image_t;
@@ -20703,9 +20712,14 @@ _SOKOL_PRIVATE void _sg_vk_discard_buffer(_sg_buffer_t* buf) {
 _SOKOL_PRIVATE sg_resource_state _sg_vk_create_image(_sg_image_t* img, const sg_image_desc* desc) {
     SOKOL_ASSERT(img && desc);
     VkResult res;
-    // FIXME: injected images
-
     img->vk.cur_access = _SG_VK_ACCESS_NONE;
+    img->vk.injected = (0 != desc->vk_image);
+    if (img->vk.injected) {
+        // the caller owns the image and its memory
+        img->vk.img = (VkImage) desc->vk_image;
+        _sg_vk_set_object_label(VK_OBJECT_TYPE_IMAGE, (uint64_t)img->vk.img, desc->label);
+        return SG_RESOURCESTATE_VALID;
+    }
 
     _SG_STRUCT(VkImageCreateInfo, create_info);
     create_info.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
@@ -20753,6 +20767,9 @@ _SOKOL_PRIVATE sg_resource_state _sg_vk_create_image(_sg_image_t* img, const sg_
 _SOKOL_PRIVATE void _sg_vk_discard_image(_sg_image_t* img) {
     SOKOL_ASSERT(img);
     _sg_track_remove(&_sg.vk.track.images, img->slot.id);
+    if (img->vk.injected) {
+        img->vk.img = 0;
+    }
     if (img->vk.img) {
         _sg_vk_delete_queue_add(_sg_vk_image_destructor, (void*)img->vk.img);
         img->vk.img = 0;
@@ -22354,7 +22371,8 @@ _SOKOL_PRIVATE bool _sg_validate_image_desc(const sg_image_desc* desc) {
         const bool injected = (0 != desc->gl_textures[0]) ||
                               (0 != desc->mtl_textures[0]) ||
                               (0 != desc->d3d11_texture) ||
-                              (0 != desc->wgpu_texture);
+                              (0 != desc->wgpu_texture) ||
+                              (0 != desc->vk_image);
         if (_sg_is_depth_or_depth_stencil_format(fmt)) {
             _SG_VALIDATE(desc->type != SG_IMAGETYPE_3D, VALIDATE_IMAGEDESC_DEPTH_3D_IMAGE);
         }
@@ -0,0 +1,353 @@
+#include "AgentEnv.h"
+#include "InputMovie.h"
+#include "JobSystem.h"
+#include "NesBatch.h"
+#include <algorithm>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <thread>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+#if defined(__linux__)
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <ctime>
+#endif
+
+namespace {
+
+constexpr int WAIT_MS = 100;    // between looks at the stop flag while the agent is idle
+
+std::atomic_ref<uint32_t> word(uint32_t& value) {
+    return std::atomic_ref<uint32_t>(value);
+}
+
+#if defined(__linux__)
+// Shared futexes, so the agent's process can wait on and wake the same words
+void futexWait(uint32_t& value, uint32_t expected, int timeout_ms) {
+    timespec timeout = {timeout_ms / 1000, (timeout_ms % 1000) * 1000000L};
+    syscall(SYS_futex, &value, FUTEX_WAIT, expected, &timeout, nullptr, 0);
+}
+
+void futexWake(uint32_t& value) {
+    syscall(SYS_futex, &value, FUTEX_WAKE, INT32_MAX, nullptr, nullptr, 0);
+}
+#endif
+
+std::atomic<bool> interrupted{false};
+
+void onInterrupt(int) {
+    interrupted.store(true);
+}
+
+void usage() {
+    fprintf(stderr,
+            "usage: imgui_fc_visualizer --agent-env ROM [options]\n"
+            "  --envs N             sessions stepped together (default: 1)\n"
+            "  --name NAME          shared-memory segment (default: %s)\n"
+            "  --frame-skip K       frames per step until the agent sets its own (default: 4)\n"
+            "  --threads N          worker threads (default: cores - 1)\n"
+            "AgentEnv.h has the segment layout and the stepping protocol.\n",
+            AgentEnv::DEFAULT_NAME);
+}
+
+}  // namespace
+
+bool AgentEnv::open(const std::string& name, NesBatch& batch, uint32_t frame_skip) {
+    close();
+    if (batch.size() <= 0) return false;
+    const size_t control_offset = sizeof(AgentEnvHeader);
+    const size_t slot_offset = control_offset + sizeof(AgentEnvControl);
+    const size_t size = slot_offset + sizeof(AgentEnvSlot) * static_cast<size_t>(batch.size());
+    if (size > UINT32_MAX) return false;
+
+    void* view = nullptr;
+#ifdef _WIN32
+    HANDLE mapping = CreateFileMappingA(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE, 0,
+                                        static_cast<DWORD>(size), name.c_str());
+    if (!mapping) return false;
+    view = MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, size);
+    if (!view) {
+        CloseHandle(mapping);
+        return false;
+    }
+    mapping_ = mapping;
+    request_event_ = CreateEventA(nullptr, FALSE, FALSE, (name + "_request").c_str());
+    response_event_ = CreateEventA(nullptr, FALSE, FALSE, (name + "_response").c_str());
+#else
+    // Only this user's agents step it
+    int fd = shm_open(name.c_str(), O_CREAT | O_RDWR, 0600);
+    if (fd < 0) return false;
+    if (ftruncate(fd, static_cast<off_t>(size)) != 0) {
+        ::close(fd);
+        shm_unlink(name.c_str());
+        return false;
+    }
+    view = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);    // the mapping keeps the segment
+    if (view == MAP_FAILED) {
+        shm_unlink(name.c_str());
+        return false;
+    }
+#endif
+    view_ = view;
+    size_ = size;
+    name_ = name;
+    batch_ = &batch;
+
+    // Agents that map it before the header is complete see open == 0
+    std::memset(view, 0, size);
+    uint8_t* bytes = static_cast<uint8_t*>(view);
+    header_ = new (bytes) AgentEnvHeader();
+    control_ = new (bytes + control_offset) AgentEnvControl();
+    slots_ = reinterpret_cast<AgentEnvSlot*>(bytes + slot_offset);
+    control_->frame_skip = std::max<uint32_t>(frame_skip, 1);
+    for (int env = 0; env < batch.size(); ++env) {
+        batch.reset(env);
+        publish(env, true);
+        slots_[env].episodes = 0;
+    }
+
+    AgentEnvHeader& header = *header_;
+    header.magic = MAGIC;
+    header.version = VERSION;
+    header.segment_size = static_cast<uint32_t>(size);
+    header.control_offset = static_cast<uint32_t>(control_offset);
+    header.slot_offset = static_cast<uint32_t>(slot_offset);
+    header.slot_size = sizeof(AgentEnvSlot);
+    header.env_count = static_cast<uint32_t>(batch.size());
+    header.screen_width = AGNES_SCREEN_WIDTH;
+    header.screen_height = AGNES_SCREEN_HEIGHT;
+    header.ram_size = AGNES_RAM_SIZE;
+#ifdef _WIN32
+    header.writer_pid = GetCurrentProcessId();
+#else
+    header.writer_pid = static_cast<uint32_t>(getpid());
+#endif
+    word(header.open).store(1, std::memory_order_release);
+    return true;
+}
+
+void AgentEnv::close() {
+    if (!view_) return;
+    word(header_->open).store(0, std::memory_order_release);
+    raiseResponse(word(control_->request).load(std::memory_order_acquire));   // an agent still waiting sees it
+#ifdef _WIN32
+    UnmapViewOfFile(view_);
+    CloseHandle(mapping_);
+    if (request_event_) CloseHandle(request_event_);
+    if (response_event_) CloseHandle(response_event_);
+    mapping_ = request_event_ = response_event_ = nullptr;
+#else
+    munmap(view_, size_);
+    // Agents keep what they mapped; the next open starts a fresh segment
+    shm_unlink(name_.c_str());
+#endif
+    view_ = nullptr;
+    header_ = nullptr;
+    control_ = nullptr;
+    slots_ = nullptr;
+    batch_ = nullptr;
+}
+
+bool AgentEnv::waitRequest(uint32_t seen, const std::atomic<bool>& stop) {
+    std::atomic_ref<uint32_t> request = word(control_->request);
+    // A short spin first: an agent stepping in a loop answers within microseconds
+    for (int spin = 0; spin < 4096; ++spin) {
+        if (request.load(std::memory_order_acquire) != seen) return true;
+    }
+    while (!stop.load(std::memory_order_relaxed)) {
+        if (request.load(std::memory_order_acquire) != seen) return true;
+#if defined(__linux__)
+        futexWait(control_->request, seen, WAIT_MS);
+#elif defined(_WIN32)
+        WaitForSingleObject(request_event_, WAIT_MS);
+#else
+        std::this_thread::sleep_for(std::chrono::microseconds(50));
+#endif
+    }
+    return false;
+}
+
+void AgentEnv::raiseResponse(uint32_t value) {
+    word(control_->response).store(value, std::memory_order_release);
+#if defined(__linux__)
+    futexWake(control_->response);
+#elif defined(_WIN32)
+    SetEvent(response_event_);
+#endif
+}
+
+void AgentEnv::run(JobSystem& jobs, const std::atomic<bool>& stop) {
+    if (!view_) return;
+    uint32_t seen = word(control_->response).load(std::memory_order_relaxed);
+    while (waitRequest(seen, stop)) {
+        seen = word(control_->request).load(std::memory_order_acquire);
+        if (control_->command == AgentEnvControl::CLOSE) {
+            raiseResponse(seen);
+            return;
+        }
+        step(jobs);
+        raiseResponse(seen);
+    }
+}
+
+int64_t AgentEnv::readTerm(const uint8_t* ram, const AgentEnvRewardTerm& term) {
+    int bytes = std::min<int>(term.bytes, 4);
+    int64_t value = 0;
+    for (int i = 0; i < bytes; ++i) {
+        int index = term.flags & AgentEnvRewardTerm::MSB_FIRST ? i : bytes - 1 - i;
+        uint8_t byte = ram[(term.address + index) & (AGNES_RAM_SIZE - 1)];
+        value = term.flags & AgentEnvRewardTerm::BCD ? value * 100 + (byte >> 4) * 10 + (byte & 0x0F)
+                                                     : value << 8 | byte;
+    }
+    return value;
+}
+
+void AgentEnv::step(JobSystem& jobs) {
+    NesBatch& batch = *batch_;
+    const int envs = batch.size();
+    const AgentEnvControl& control = *control_;
+    int terms = 0;
+    while (terms < AgentEnvControl::REWARD_TERMS && control.rewards[terms].bytes != 0) ++terms;
+
+    // Resets are answered with the power-on state instead of a step; the
+    // others' buttons hold for the whole step
+    before_.resize(static_cast<size_t>(envs) * AgentEnvControl::REWARD_TERMS);
+    for (int env = 0; env < envs; ++env) {
+        const AgentEnvSlot& slot = slots_[env];
+        agnes_input_t* p1 = batch.input(0);
+        agnes_input_t* p2 = batch.input(1);
+        if (slot.reset) {
+            p1[env] = p2[env] = agnes_input_t{};
+            continue;
+        }
+        p1[env] = InputMovie::unpack(slot.buttons, 0);
+        p2[env] = InputMovie::unpack(slot.buttons, 1);
+        int64_t* before = &before_[static_cast<size_t>(env) * AgentEnvControl::REWARD_TERMS];
+        for (int t = 0; t < terms; ++t) before[t] = readTerm(batch.ram(env), control.rewards[t]);
+    }
+    const int frames = static_cast<int>(std::max<uint32_t>(control.frame_skip, 1));
+    batch.step(jobs, frames);
+
+    for (int env = 0; env < envs; ++env) {
+        AgentEnvSlot& slot = slots_[env];
+        if (slot.reset) {
+            batch.reset(env);
+            publish(env, true);
+            continue;
+        }
+        const uint8_t* ram = batch.ram(env);
+        const int64_t* before = &before_[static_cast<size_t>(env) * AgentEnvControl::REWARD_TERMS];
+        float reward = 0.0f;
+        for (int t = 0; t < terms; ++t) {
+            reward += control.rewards[t].weight * static_cast<float>(readTerm(ram, control.rewards[t]) - before[t]);
+        }
+        for (int t = 0; t < AgentEnvControl::DONE_TERMS && control.dones[t].mask != 0; ++t) {
+            const AgentEnvDoneTerm& done = control.dones[t];
+            if ((ram[done.address & (AGNES_RAM_SIZE - 1)] & done.mask) == done.value) slot.done = 1;
+        }
+        slot.reward = reward;
+        slot.episode_frames += frames;
+        slot.frames += frames;
+        if (control.max_episode_frames > 0 && slot.episode_frames >= control.max_episode_frames) slot.truncated = 1;
+        publish(env, false);
+    }
+}
+
+// The session's picture and RAM into its slot; a reset also starts the
+// episode's counters over
+void AgentEnv::publish(int env, bool reset) {
+    AgentEnvSlot& slot = slots_[env];
+    if (reset) {
+        slot.reset = 0;
+        slot.done = 0;
+        slot.truncated = 0;
+        slot.reward = 0.0f;
+        slot.episode_frames = 0;
+        ++slot.episodes;
+    }
+    std::memcpy(slot.ram, batch_->ram(env), sizeof(slot.ram));
+    std::memcpy(slot.screen, batch_->screen(env), sizeof(slot.screen));
+}
+
+bool AgentEnv::isCommandLine(int argc, char* argv[]) {
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--agent-env") == 0) return true;
+    }
+    return false;
+}
+
+int AgentEnv::runCommandLine(int argc, char* argv[]) {
+    const char* rom = nullptr;
+    const char* name = DEFAULT_NAME;
+    int envs = 1;
+    int frame_skip = 4;
+    int threads = 0;
+    bool ok = true;
+
+    for (int i = 1; i < argc && ok; ++i) {
+        const char* arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if (std::strcmp(arg, "--agent-env") == 0) {
+            continue;
+        } else if (std::strncmp(arg, "--", 2) != 0 && !rom) {
+            rom = arg;
+        } else if (std::strcmp(arg, "--envs") == 0 && has_value) {
+            envs = std::atoi(argv[++i]);
+            ok = envs > 0;
+        } else if (std::strcmp(arg, "--name") == 0 && has_value) {
+            name = argv[++i];
+        } else if (std::strcmp(arg, "--frame-skip") == 0 && has_value) {
+            frame_skip = std::atoi(argv[++i]);
+            ok = frame_skip > 0;
+        } else if (std::strcmp(arg, "--threads") == 0 && has_value) {
+            threads = std::atoi(argv[++i]);
+        } else {
+            ok = false;
+        }
+    }
+    if (!ok || !rom) {
+        usage();
+        return 2;
+    }
+
+    NesBatch batch;
+    if (!batch.loadROM(rom) || !batch.create(envs)) {
+        fprintf(stderr, "agent-env: cannot load %s\n", rom);
+        return 1;
+    }
+    AgentEnv env;
+    if (!env.open(name, batch, static_cast<uint32_t>(frame_skip))) {
+        fprintf(stderr, "agent-env: cannot create the shared-memory segment %s\n", name);
+        return 1;
+    }
+    JobSystem jobs;
+    jobs.init(threads);
+    std::signal(SIGINT, onInterrupt);
+    std::signal(SIGTERM, onInterrupt);
+    fprintf(stderr, "agent-env: %d session(s) of %s on %s (%zu bytes), %d worker(s)\n", envs, rom, name,
+            env.size_, jobs.workerCount());
+
+    auto started = std::chrono::steady_clock::now();
+    env.run(jobs, interrupted);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+    uint64_t frames = 0;
+    for (int i = 0; i < envs; ++i) frames += env.slots_[i].frames;
+    fprintf(stderr, "agent-env: %llu frames in %.1f s (%.0f frames/s)\n", static_cast<unsigned long long>(frames),
+            seconds, seconds > 0.0 ? frames / seconds : 0.0);
+    env.close();
+    jobs.shutdown();
+    return 0;
+}
@@ -0,0 +1,166 @@
+#pragma once
+
+#include "agnes/agnes.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+class JobSystem;
+class NesBatch;
+
+// The mapped layout. Plain fixed-width fields, like OverlayFeed's, so an
+// agent in another process (and language) can declare the same structs.
+
+// A RAM counter the reward follows: each step adds weight times how much
+// it changed over the step
+struct AgentEnvRewardTerm {
+    static constexpr uint8_t BCD = 1 << 0;         // a decimal digit per nibble, as most scores are kept
+    static constexpr uint8_t MSB_FIRST = 1 << 1;   // first byte most significant
+
+    uint16_t address;               // CPU RAM, $0000-$07FF
+    uint8_t bytes;                  // 1-4; 0 ends the list
+    uint8_t flags;
+    float weight;
+};
+
+// An episode is done once (RAM[address] & mask) == value after a step
+struct AgentEnvDoneTerm {
+    uint16_t address;
+    uint8_t mask;                   // 0 ends the list
+    uint8_t value;
+};
+
+// Written once when the segment opens
+struct AgentEnvHeader {
+    uint32_t magic;                 // AgentEnv::MAGIC
+    uint32_t version;               // AgentEnv::VERSION of the layout
+    uint32_t segment_size;
+    uint32_t control_offset;        // of the AgentEnvControl
+    uint32_t slot_offset;           // of the first AgentEnvSlot
+    uint32_t slot_size;
+    uint32_t env_count;
+    uint32_t screen_width;
+    uint32_t screen_height;
+    uint32_t ram_size;
+    uint32_t writer_pid;
+    uint32_t open;                  // 0 once the environment exits
+    uint32_t reserved[4];
+};
+
+struct AgentEnvControl {
+    static constexpr int REWARD_TERMS = 16;
+    static constexpr int DONE_TERMS = 16;
+    static constexpr uint32_t STEP = 0;
+    static constexpr uint32_t CLOSE = 1;
+
+    // The lockstep: the agent writes its actions (and any of the settings
+    // below), then adds 1 to request; the environment steps and sets
+    // response to request. Both are futex words on Linux (shared, not
+    // FUTEX_PRIVATE); on Windows the auto-reset events named the segment's
+    // name plus "_request" and "_response" are set after each, and other
+    // systems poll.
+    uint32_t request;
+    uint32_t response;
+    uint32_t command;               // STEP or CLOSE
+    uint32_t frame_skip;            // frames a step runs with the same buttons, at least 1
+    uint32_t max_episode_frames;    // an episode is truncated after this many; 0 for never
+    uint32_t reserved[11];
+    AgentEnvRewardTerm rewards[REWARD_TERMS];
+    AgentEnvDoneTerm dones[DONE_TERMS];
+};
+
+// One environment, a NesBatch session
+struct AgentEnvSlot {
+    // Agent, before raising request
+    uint16_t buttons;               // InputMovie::pack(): player 1 in the low byte, A B Select Start
+                                    // Up Down Left Right from bit 0, player 2 in the high byte
+    uint8_t reset;                  // back to power-on instead of stepping; cleared when done
+    uint8_t reserved0;
+
+    // Environment, by the time response is raised
+    uint8_t done;                   // a done term matched; stays set until a reset
+    uint8_t truncated;              // max_episode_frames reached; likewise
+    uint16_t reserved1;
+    float reward;                   // over the last step, 0 after a reset
+    uint32_t episode_frames;
+    uint64_t frames;                // emulated since the environment started
+    uint32_t episodes;              // resets so far
+    uint8_t reserved2[36];
+    uint8_t ram[AGNES_RAM_SIZE];
+    uint8_t screen[AGNES_SCREEN_WIDTH * AGNES_SCREEN_HEIGHT];   // palette indices, rows top down
+};
+
+static_assert(sizeof(AgentEnvHeader) == 64, "the control block starts at offset 64");
+static_assert(sizeof(AgentEnvControl) == 256, "no padding between the fields agents declare");
+static_assert(sizeof(AgentEnvSlot) % 64 == 0 && offsetof(AgentEnvSlot, ram) == 64, "slots stay 64-byte aligned");
+static_assert(std::is_trivially_copyable<AgentEnvSlot>::value, "slots are plain memory");
+
+// A shared-memory environment for reinforcement learning agents: headless
+// sessions of one ROM (NesBatch, stepped across the job workers) whose
+// actions, observations, RAM and rewards live in a named segment the agent
+// maps, so a step costs the agent two stores and a wait, with nothing
+// serialized or sent over a socket. Each step runs frame_skip frames of
+// every session with its buttons, then copies the screens' palette indices
+// and RAM into the slots and scores the step with the agent's reward and
+// done terms.
+//
+// Segment: AgentEnvHeader at 0, AgentEnvControl at control_offset, then
+// env_count slots of slot_size. Once header.open is 1 the slots hold the
+// power-on state and response == request == 0. To step, fill in buttons
+// (and reset where wanted), add 1 to request (release) and wake it, then
+// wait until response equals it (acquire). Setting command to CLOSE and
+// raising request ends the environment. Python can map it with mmap and
+// numpy views; the futex calls go through ctypes' syscall, or the agent can
+// spin on response.
+class AgentEnv {
+public:
+    static constexpr uint32_t MAGIC = 0x564E4541;   // "AENV"
+    static constexpr uint32_t VERSION = 1;
+#ifdef _WIN32
+    static constexpr const char* DEFAULT_NAME = "Local\\fc_visualizer_env";
+#else
+    static constexpr const char* DEFAULT_NAME = "/fc_visualizer_env";
+#endif
+
+    AgentEnv() = default;
+    ~AgentEnv() { close(); }
+    AgentEnv(const AgentEnv&) = delete;
+    AgentEnv& operator=(const AgentEnv&) = delete;
+
+    // Create the segment for every session of 'batch'; false if the OS
+    // refuses it
+    bool open(const std::string& name, NesBatch& batch, uint32_t frame_skip);
+    void close();
+
+    // Serve steps until the agent closes the environment or 'stop' is set
+    void run(JobSystem& jobs, const std::atomic<bool>& stop);
+
+    // "--agent-env ROM [options]": serve until closed. Returns the process
+    // exit code.
+    static bool isCommandLine(int argc, char* argv[]);
+    static int runCommandLine(int argc, char* argv[]);
+
+private:
+    void step(JobSystem& jobs);
+    void publish(int env, bool reset);
+    static int64_t readTerm(const uint8_t* ram, const AgentEnvRewardTerm& term);
+    bool waitRequest(uint32_t seen, const std::atomic<bool>& stop);
+    void raiseResponse(uint32_t value);
+
+    void* view_ = nullptr;
+    size_t size_ = 0;
+    std::string name_;
+#ifdef _WIN32
+    void* mapping_ = nullptr;
+    void* request_event_ = nullptr;
+    void* response_event_ = nullptr;
+#endif
+    NesBatch* batch_ = nullptr;
+    AgentEnvHeader* header_ = nullptr;
+    AgentEnvControl* control_ = nullptr;
+    AgentEnvSlot* slots_ = nullptr;
+    std::vector<int64_t> before_;   // reward term values at the start of the step, per environment
+};
@@ -0,0 +1,1085 @@
+#include "AnalysisGraph.h"
+#include "Profiler.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+AnalysisGraph::AnalysisGraph() {
+    MemoryScope memory(MemoryTag::Analysis);
+    cqt_input_.init(CQT_FFT_SIZE);
+    mr_low_input_.init(MR_FFT_SIZE);
+    zoom_input_.init(ZOOM_HISTORY);
+    zoom_re_.init(ZOOM_FFT_SIZE);
+    zoom_im_.init(ZOOM_FFT_SIZE);
+    hop_buffer_.resize(MAX_HOP * 3, 0.0f);
+    pitch_input_.resize(PITCH_WINDOW / 2, 0.0f);
+    sample_ring_.init(SAMPLE_RING_FRAMES, 2);
+    
+    // FFT tables are built here and by setResolution(), never on the audio thread
+    applyResolution();
+    frame_ = blankFrame();
+}
+
+AnalysisGraph::~AnalysisGraph() {
+    stop();
+}
+
+void AnalysisGraph::start() {
+    if (running_.exchange(true)) return;
+    thread_ = std::thread(&AnalysisGraph::threadFunc, this);
+}
+
+void AnalysisGraph::stop() {
+    running_.store(false);
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+}
+
+std::shared_ptr<AnalysisGraph::Subscription> AnalysisGraph::subscribe(uint32_t nodes, bool detachable) {
+    auto subscription = std::make_shared<Subscription>();
+    subscription->setNodes(nodes);
+    subscription->detachable_ = detachable;
+    subscription->frames_.assign(blankFrame());
+    
+    std::lock_guard<std::mutex> lock(subscribers_mutex_);
+    subscribers_.push_back(subscription);
+    return subscription;
+}
+
+void AnalysisGraph::unsubscribe(const std::shared_ptr<Subscription>& subscription) {
+    std::lock_guard<std::mutex> lock(subscribers_mutex_);
+    subscribers_.erase(std::remove(subscribers_.begin(), subscribers_.end(), subscription), subscribers_.end());
+}
+
+void AnalysisGraph::resizeSubscribers(const Frame& blank) {
+    std::lock_guard<std::mutex> lock(subscribers_mutex_);
+    for (const auto& subscription : subscribers_) {
+        if (subscription->detachable_) subscription->detached_.store(true, std::memory_order_release);
+        else subscription->frames_.assign(blank);
+    }
+    subscribers_.erase(std::remove_if(subscribers_.begin(), subscribers_.end(),
+                                      [](const auto& subscription) { return subscription->detachable_; }),
+                       subscribers_.end());
+}
+
+void AnalysisGraph::reset() {
+    // Worker-owned buffers are cleared by the worker when it sees the new generation
+    reset_generation_.fetch_add(1);
+    voice_count_.store(0);
+}
+
+int AnalysisGraph::hop() const {
+    int frames = static_cast<int>(std::lround(sample_rate_.load() / update_rate_.load()));
+    return std::clamp(frames, MIN_HOP, MAX_HOP);
+}
+
+void AnalysisGraph::write(const float* samples, int sample_count) {
+    if (!samples || sample_count <= 0) return;
+    
+    // If the worker falls behind the ring fills and the excess is dropped
+    // rather than blocking audio
+    sample_ring_.write(samples, sample_count / 2);
+}
+
+void AnalysisGraph::setOutputDelay(int frames) {
+    output_delay_.store(std::clamp(frames, 0, MAX_OUTPUT_DELAY), std::memory_order_relaxed);
+}
+
+void AnalysisGraph::setVoiceCount(int voices) {
+    voices = std::clamp(voices, 0, MAX_SCOPE_VOICES);
+    if (voices == voice_capacity_) return;
+    
+    bool was_running = running_.load();
+    stop();
+    
+    voice_capacity_ = voices;
+    voice_count_.store(0);
+    voice_rings_ = voices > 0 ? std::make_unique<AudioRing[]>(voices) : nullptr;
+    voice_windows_.assign(voices, SampleWindow());
+    for (int v = 0; v < voices; ++v) {
+        voice_rings_[v].init(SAMPLE_RING_FRAMES, 1);
+        voice_windows_[v].init(VOICE_SCOPE_SIZE);
+    }
+    voice_power_.assign(static_cast<size_t>(voices) * (VOICE_SCOPE_SIZE / 2 + 1), 0.0f);
+    voice_pitch_.assign(voices, PitchTracker());
+    Frame blank = blankFrame();
+    frame_.voice_waveforms = blank.voice_waveforms;
+    frame_.voice_spectra = blank.voice_spectra;
+    frame_.voice_pitches = blank.voice_pitches;
+    resizeSubscribers(blank);
+    
+    if (was_running) start();
+}
+
+void AnalysisGraph::writeVoice(int voice, const short* samples, long count) {
+    if (voice < 0 || voice >= voice_capacity_ || !samples || count <= 0) return;
+    
+    if (voice_count_.load(std::memory_order_relaxed) <= voice) {
+        voice_count_.store(voice + 1);
+    }
+    
+    constexpr int CHUNK = 256;
+    float chunk[CHUNK];
+    for (long done = 0; done < count; ) {
+        int n = static_cast<int>(std::min<long>(CHUNK, count - done));
+        for (int i = 0; i < n; ++i) {
+            chunk[i] = samples[done + i] / 32768.0f;
+        }
+        if (voice_rings_[voice].write(chunk, n) < n) break;
+        done += n;
+    }
+}
+
+void AnalysisGraph::setResolution(Resolution resolution) {
+    MemoryScope memory(MemoryTag::Analysis);
+    auto snap = [](int value, const auto& sizes) {
+        int best = sizes[0];
+        for (int size : sizes) {
+            if (std::abs(size - value) < std::abs(best - value)) best = size;
+        }
+        return best;
+    };
+    resolution.fft_size = snap(resolution.fft_size, FFT_SIZES);
+    resolution.spectrum_bins = snap(resolution.spectrum_bins, SPECTRUM_BIN_COUNTS);
+    resolution.waveform_size = snap(resolution.waveform_size, WAVEFORM_SIZES);
+    resolution.history_size = snap(resolution.history_size, HISTORY_SIZES);
+    if (resolution == resolution_) return;
+    
+    bool was_running = running_.load();
+    stop();
+    
+    resolution_ = resolution;
+    applyResolution();
+    Frame blank = blankFrame();
+    frame_.waveform_left = blank.waveform_left;
+    frame_.waveform_right = blank.waveform_right;
+    frame_.spectrum = blank.spectrum;
+    frame_.history = blank.history;
+    frame_.history_size = blank.history_size;
+    frame_.history_rows = 0;
+    resizeSubscribers(blank);
+    
+    if (was_running) start();
+}
+
+void AnalysisGraph::applyResolution() {
+    fft_size_ = resolution_.fft_size;
+    bins_ = resolution_.spectrum_bins;
+    waveform_size_ = resolution_.waveform_size;
+    history_size_ = resolution_.history_size;
+    
+    // The trigger searches up to a scope's width back from the newest
+    // window, in the same mono samples the FFT reads
+    scope_history_ = std::max(fft_size_, 2 * waveform_size_);
+    waveform_left_.init(scope_history_);
+    waveform_right_.init(scope_history_);
+    fft_input_.init(scope_history_);
+    power_spectrum_.assign(fft_size_, 0.0f);
+    trigger_template_.assign(waveform_size_, 0.0f);
+    scope_start_ = scope_history_ - waveform_size_;
+    spectrum_data_.assign(bins_, 0.0f);
+    spectrum_scratch_.assign(bins_, 0.0f);
+    spectrum_history_.assign(static_cast<size_t>(history_size_) * bins_, 0);
+    spectrum_history_rows_ = 0;
+    onset_previous_.fill(0.0f);
+    
+    // Every mapping depends on the bar count or FFT size; rebuilt when next used
+    fft_plan_.init(fft_size_);
+    buildBinMapping(static_cast<SpectrumScale>(spectrum_scale_.load()), sample_rate_.load());
+    cqt_sample_rate_ = 0;
+    mr_sample_rate_ = 0;
+    zoom_decimation_ = 0;
+    voice_mapped_rate_ = 0;
+}
+
+AnalysisGraph::Frame AnalysisGraph::blankFrame() const {
+    Frame blank;
+    blank.waveform_left.assign(waveform_size_, 0.0f);
+    blank.waveform_right.assign(waveform_size_, 0.0f);
+    blank.spectrum.assign(bins_, 0.0f);
+    blank.history.assign(static_cast<size_t>(history_size_) * bins_, 0);
+    blank.history_size = history_size_;
+    blank.voice_waveforms.assign(static_cast<size_t>(voice_capacity_) * VOICE_SCOPE_SIZE, 0.0f);
+    blank.voice_spectra.assign(static_cast<size_t>(voice_capacity_) * VOICE_SPECTRUM_BINS, 0.0f);
+    blank.voice_pitches.assign(voice_capacity_, PitchTracker::Estimate());
+    return blank;
+}
+
+uint32_t AnalysisGraph::wantedNodes() {
+    uint32_t nodes = 0;
+    std::lock_guard<std::mutex> lock(subscribers_mutex_);
+    for (const auto& subscription : subscribers_) nodes |= subscription->nodes();
+    return nodes;
+}
+
+void AnalysisGraph::threadFunc() {
+    FC_TRACE_THREAD("analysis");
+    MemoryScope memory(MemoryTag::Analysis);
+    while (running_.load()) {
+        if (!tick()) std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    }
+}
+
+bool AnalysisGraph::tick() {
+    uint32_t generation = reset_generation_.load();
+    if (generation != reset_seen_) {
+        reset_seen_ = generation;
+        resetAnalysis();
+    }
+    
+    int hop_frames = hop();
+    int delay = output_delay_.load(std::memory_order_relaxed);
+    int ready = sample_ring_.available() - delay;
+    if (ready < hop_frames) return false;
+    
+    // Further behind than writes in bursts explain (a stall, or a
+    // backlog after a pause): fold the excess into the windows
+    // unanalysed, since nobody would see the ticks it would have made
+    int backlog = static_cast<int>(sample_rate_.load() * MAX_BACKLOG_SECONDS);
+    while (ready - hop_frames > std::max(backlog, hop_frames)) {
+        readHop(hop_frames);
+        ready -= hop_frames;
+    }
+    
+    // Windows are always fed so a node switched on later starts from
+    // current audio; the work is only done for nodes someone reads
+    int count = readHop(hop_frames);
+    uint32_t nodes = wantedNodes();
+    if (nodes & NODE_LEVELS) computeLevels(hop_buffer_.data(), count);
+    
+    // The spectrum is shared by its own view, onsets and the pitch-sync trigger
+    bool pitch_sync = (nodes & NODE_SCOPE) &&
+                      scope_trigger_.load(std::memory_order_relaxed) == static_cast<int>(ScopeTrigger::PitchSync);
+    if (nodes & (NODE_SPECTRUM | NODE_ONSET | NODE_TEMPO) || pitch_sync) processFFT(pitch_sync);
+    if (nodes & (NODE_ONSET | NODE_TEMPO)) computeOnset();
+    if (nodes & NODE_TEMPO) computeTempo();
+    if (nodes & NODE_SCOPE) scope_start_ = findScopeTrigger();
+    if (nodes & NODE_VOICE_SPECTRA) computeVoiceSpectra();
+    if (nodes & NODE_PITCH) computePitch();
+    
+    frame_.tick++;
+    publish(nodes);
+    return true;
+}
+
+void AnalysisGraph::resetAnalysis() {
+    sample_ring_.discardUntil(sample_ring_.writePosition());
+    for (int v = 0; v < voice_capacity_; ++v) {
+        voice_rings_[v].discardUntil(voice_rings_[v].writePosition());
+        voice_windows_[v].clear();
+        voice_pitch_[v].reset();
+    }
+    mix_pitch_.reset();
+    
+    waveform_left_.clear();
+    waveform_right_.clear();
+    std::fill(trigger_template_.begin(), trigger_template_.end(), 0.0f);
+    scope_start_ = scope_history_ - waveform_size_;
+    fft_input_.clear();
+    cqt_input_.clear();
+    mr_low_input_.clear();
+    mr_decimation_sum_ = 0.0f;
+    mr_decimation_phase_ = 0;
+    zoom_input_.clear();
+    zoom_re_.clear();
+    zoom_im_.clear();
+    zoom_clock_ = 0;
+    zoom_phase_ = 0;
+    loudness_.reset();
+    std::fill(spectrum_data_.begin(), spectrum_data_.end(), 0.0f);
+    
+    std::fill(spectrum_history_.begin(), spectrum_history_.end(), 0);
+    spectrum_history_rows_ = 0;
+    onset_previous_.fill(0.0f);
+    onset_flux_.fill(0.0f);
+    onset_above_ = false;
+    onset_novelty_ = 0.0f;
+    resetTempo(0.0f);
+    
+    frame_ = blankFrame();
+    publish(NODE_SCOPE | NODE_SPECTRUM | NODE_LEVELS | NODE_ONSET | NODE_VOICES | NODE_VOICE_SPECTRA | NODE_LOUDNESS |
+            NODE_TEMPO | NODE_PITCH);
+}
+
+int AnalysisGraph::readHop(int hop) {
+    int count = sample_ring_.read(hop_buffer_.data(), hop);
+    pushSamples(hop_buffer_.data(), count);
+    
+    // Integrated loudness covers every frame, so the meter is fed here and
+    // not only on analysed ticks
+    long rate = sample_rate_.load(std::memory_order_relaxed);
+    if (loudness_.sampleRate() != rate) loudness_.setSampleRate(rate);
+    loudness_.process(hop_buffer_.data(), count);
+    
+    // Voice taps are written alongside the mix, so take the same amount
+    // (into the mono tail of the buffer, keeping the mix for the levels)
+    float* voice_buffer = hop_buffer_.data() + MAX_HOP * 2;
+    int voices = voice_count_.load();
+    for (int v = 0; v < voices; ++v) {
+        int got = voice_rings_[v].read(voice_buffer, count);
+        for (int i = 0; i < got; ++i) {
+            voice_windows_[v].push(voice_buffer[i]);
+        }
+    }
+    return count;
+}
+
+void AnalysisGraph::pushSamples(const float* frames, int count) {
+    for (int i = 0; i < count; ++i) {
+        float left = frames[i * 2];
+        float right = frames[i * 2 + 1];
+        waveform_left_.push(left);
+        waveform_right_.push(right);
+        float mono = (left + right) * 0.5f;
+        fft_input_.push(mono);
+        cqt_input_.push(mono);
+        
+        // A box filter is enough ahead of the decimation: its nulls sit on
+        // the frequencies that would fold onto the low band's bass
+        mr_decimation_sum_ += mono;
+        if (++mr_decimation_phase_ == MR_DECIMATION) {
+            mr_low_input_.push(mr_decimation_sum_ / MR_DECIMATION);
+            mr_decimation_sum_ = 0.0f;
+            mr_decimation_phase_ = 0;
+        }
+        
+        zoom_input_.push(mono);
+        zoom_clock_++;
+        if (zoom_decimation_ && ++zoom_phase_ == zoom_decimation_) {
+            pushZoomSample(0);
+            zoom_phase_ = 0;
+        }
+    }
+}
+
+void AnalysisGraph::publish(uint32_t nodes) {
+    // Gather this tick's outputs once...
+    frame_.nodes = nodes;
+    if (nodes & NODE_SCOPE) {
+        // Only the trigger-aligned part of the scope history is handed out
+        std::copy_n(waveform_left_.window() + scope_start_, waveform_size_, frame_.waveform_left.begin());
+        std::copy_n(waveform_right_.window() + scope_start_, waveform_size_, frame_.waveform_right.begin());
+    }
+    if (nodes & NODE_SPECTRUM) {
+        std::copy(spectrum_data_.begin(), spectrum_data_.end(), frame_.spectrum.begin());
+        std::copy(spectrum_history_.begin(), spectrum_history_.end(), frame_.history.begin());
+        frame_.history_rows = spectrum_history_rows_;
+    }
+    if (nodes & (NODE_VOICES | NODE_VOICE_SPECTRA | NODE_PITCH)) {
+        frame_.voice_count = std::min(voice_count_.load(), voice_capacity_);
+    }
+    if (nodes & NODE_LOUDNESS) {
+        frame_.lufs_momentary = loudness_.momentary();
+        frame_.lufs_short_term = loudness_.shortTerm();
+        frame_.lufs_integrated = loudness_.integrated();
+        frame_.true_peak = loudness_.takeRecentPeak();
+        frame_.true_peak_max = loudness_.truePeak();
+    }
+    if (nodes & NODE_VOICES) {
+        for (int v = 0; v < frame_.voice_count; ++v) {
+            std::copy_n(voice_windows_[v].window(), VOICE_SCOPE_SIZE,
+                        frame_.voice_waveforms.begin() + v * VOICE_SCOPE_SIZE);
+        }
+    }
+    
+    // ...then hand each subscriber the parts it reads
+    std::lock_guard<std::mutex> lock(subscribers_mutex_);
+    for (const auto& subscription : subscribers_) {
+        uint32_t wanted = subscription->nodes() & nodes;
+        Frame& out = subscription->frames_.back();
+        out.tick = frame_.tick;
+        out.nodes = wanted;
+        if (wanted & NODE_SCOPE) {
+            out.waveform_left = frame_.waveform_left;
+            out.waveform_right = frame_.waveform_right;
+            out.pitch_hz = frame_.pitch_hz;
+        }
+        if (wanted & NODE_SPECTRUM) {
+            out.spectrum = frame_.spectrum;
+            out.history = frame_.history;
+            out.history_size = frame_.history_size;
+            out.history_rows = frame_.history_rows;
+        }
+        if (wanted & NODE_LEVELS) {
+            out.rms_left = frame_.rms_left;
+            out.rms_right = frame_.rms_right;
+            out.peak = frame_.peak;
+        }
+        if (wanted & NODE_ONSET) {
+            out.onset_strength = frame_.onset_strength;
+            out.onset = frame_.onset;
+            out.onset_count = frame_.onset_count;
+        }
+        if (wanted & NODE_TEMPO) {
+            out.tempo_bpm = frame_.tempo_bpm;
+            out.tempo_confidence = frame_.tempo_confidence;
+            out.beat_phase = frame_.beat_phase;
+            out.beat = frame_.beat;
+            out.beat_count = frame_.beat_count;
+        }
+        if (wanted & (NODE_VOICES | NODE_VOICE_SPECTRA | NODE_PITCH)) {
+            out.voice_count = frame_.voice_count;
+        }
+        if (wanted & NODE_LOUDNESS) {
+            out.lufs_momentary = frame_.lufs_momentary;
+            out.lufs_short_term = frame_.lufs_short_term;
+            out.lufs_integrated = frame_.lufs_integrated;
+            out.true_peak = frame_.true_peak;
+            out.true_peak_max = frame_.true_peak_max;
+        }
+        if (wanted & NODE_VOICES) {
+            std::copy_n(frame_.voice_waveforms.begin(), static_cast<size_t>(frame_.voice_count) * VOICE_SCOPE_SIZE,
+                        out.voice_waveforms.begin());
+        }
+        if (wanted & NODE_VOICE_SPECTRA) {
+            std::copy_n(frame_.voice_spectra.begin(), static_cast<size_t>(frame_.voice_count) * VOICE_SPECTRUM_BINS,
+                        out.voice_spectra.begin());
+        }
+        if (wanted & NODE_PITCH) {
+            out.mix_pitches = frame_.mix_pitches;
+            std::copy_n(frame_.voice_pitches.begin(), frame_.voice_count, out.voice_pitches.begin());
+        }
+        subscription->frames_.publish();
+    }
+}
+
+void AnalysisGraph::computeLevels(const float* frames, int count) {
+    float sum_left = 0.0f;
+    float sum_right = 0.0f;
+    float peak = 0.0f;
+    for (int i = 0; i < count; ++i) {
+        float left = frames[i * 2];
+        float right = frames[i * 2 + 1];
+        sum_left += left * left;
+        sum_right += right * right;
+        peak = std::max(peak, std::max(std::abs(left), std::abs(right)));
+    }
+    frame_.rms_left = std::sqrt(sum_left / std::max(1, count));
+    frame_.rms_right = std::sqrt(sum_right / std::max(1, count));
+    frame_.peak = peak;
+}
+
+void AnalysisGraph::computeOnset() {
+    // Spectral flux: how much the (dB-scaled) bars rose since the last tick.
+    // An onset is where it climbs well above its recent mean; it has to fall
+    // back below before the next one, so one attack spread over a few
+    // smoothed ticks counts once.
+    float flux = 0.0f;
+    for (int i = 0; i < bins_; ++i) {
+        flux += std::max(0.0f, spectrum_data_[i] - onset_previous_[i]);
+        onset_previous_[i] = spectrum_data_[i];
+    }
+    flux /= bins_;
+    
+    float mean = 0.0f;
+    for (float f : onset_flux_) mean += f;
+    mean /= ONSET_HISTORY;
+    onset_flux_[frame_.tick % ONSET_HISTORY] = flux;
+    
+    bool above = flux > 1.5f * mean + 0.01f;
+    frame_.onset_strength = flux / (mean + 1e-3f);
+    frame_.onset = above && !onset_above_;
+    if (frame_.onset) frame_.onset_count++;
+    onset_above_ = above;
+    onset_novelty_ = std::max(0.0f, flux - mean);
+}
+
+void AnalysisGraph::resetTempo(float rate) {
+    tempo_novelty_.fill(0.0f);
+    tempo_acf_.fill(0.0f);
+    tempo_energy_ = 0.0f;
+    tempo_ticks_ = 0;
+    tempo_rate_ = rate;
+    beat_phase_ = 0.0f;
+    beat_misses_ = BEAT_RESYNC;
+    frame_.tempo_bpm = 0.0f;
+    frame_.tempo_confidence = 0.0f;
+    
+    // Log-Gaussian over tempo, an octave wide: halves and doubles of the
+    // beat correlate too, this picks the one nearest a moderate pace
+    tempo_weight_.fill(0.0f);
+    for (int lag = 1; lag < TEMPO_HISTORY && rate > 0.0f; ++lag) {
+        float octaves = std::log2(60.0f * rate / lag / 120.0f);
+        tempo_weight_[lag] = std::exp(-0.5f * octaves * octaves);
+    }
+}
+
+void AnalysisGraph::computeTempo() {
+    // Everything below counts in ticks, so a new tick rate starts over
+    float rate = static_cast<float>(sample_rate_.load(std::memory_order_relaxed)) / hop();
+    if (rate != tempo_rate_) resetTempo(rate);
+    
+    // Autocorrelation of the novelty, one multiply-add per lag and tick;
+    // lags one past either end of the range are kept for the interpolation
+    const int mask = TEMPO_HISTORY - 1;
+    int now = static_cast<int>(tempo_ticks_ & mask);
+    tempo_novelty_[now] = onset_novelty_;
+    int lag_min = std::max(2, static_cast<int>(rate * 60.0f / TEMPO_MAX_BPM));
+    int lag_max = std::min(TEMPO_HISTORY - 2, static_cast<int>(std::ceil(rate * 60.0f / TEMPO_MIN_BPM)));
+    float decay = std::exp(-1.0f / (rate * TEMPO_MEMORY));
+    tempo_energy_ = decay * tempo_energy_ + onset_novelty_ * onset_novelty_;
+    for (int lag = lag_min - 1; lag <= lag_max + 1; ++lag) {
+        tempo_acf_[lag] = decay * tempo_acf_[lag] + onset_novelty_ * tempo_novelty_[(now - lag) & mask];
+    }
+    tempo_ticks_++;
+    
+    int best = 0;
+    float best_score = 0.0f;
+    for (int lag = lag_min; lag <= lag_max; ++lag) {
+        float score = tempo_acf_[lag] * tempo_weight_[lag];
+        if (score > best_score) {
+            best_score = score;
+            best = lag;
+        }
+    }
+    float confidence = tempo_energy_ > 0.0f ? std::clamp(tempo_acf_[best] / tempo_energy_, 0.0f, 1.0f) : 0.0f;
+    if (best > 0 && confidence >= TEMPO_MIN_CONFIDENCE && tempo_ticks_ > rate * TEMPO_WARMUP) {
+        // Parabola through the peak and its neighbours for a fractional lag
+        float a = tempo_acf_[best - 1], b = tempo_acf_[best], c = tempo_acf_[best + 1];
+        float curve = a - 2.0f * b + c;
+        float period = best + (curve < 0.0f ? std::clamp(0.5f * (a - c) / curve, -0.5f, 0.5f) : 0.0f);
+        frame_.tempo_bpm = 60.0f * rate / period;
+        frame_.tempo_confidence = confidence;
+    } else {
+        frame_.tempo_bpm = 0.0f;
+        frame_.tempo_confidence = confidence;
+        beat_misses_ = BEAT_RESYNC;
+    }
+    
+    // Beat clock: a period per beat, pulled toward onsets near a beat
+    frame_.beat = false;
+    if (frame_.tempo_bpm > 0.0f) {
+        beat_phase_ += frame_.tempo_bpm / (60.0f * rate);
+        if (frame_.onset) {
+            float error = beat_phase_ < 0.5f ? -beat_phase_ : 1.0f - beat_phase_;
+            if (std::abs(error) < BEAT_CAPTURE) {
+                beat_phase_ += BEAT_PULL * error;
+                beat_misses_ = 0;
+            } else if (++beat_misses_ >= BEAT_RESYNC) {
+                beat_phase_ = 1.0f;
+                beat_misses_ = 0;
+            }
+        }
+        if (beat_phase_ >= 1.0f) {
+            beat_phase_ -= std::floor(beat_phase_);
+            frame_.beat = true;
+            frame_.beat_count++;
+        }
+    }
+    frame_.beat_phase = beat_phase_;
+}
+
+// Frequency <-> perceptual scale conversions used for the bin edges
+static float hzToMel(float hz) { return 2595.0f * std::log10(1.0f + hz / 700.0f); }
+static float melToHz(float mel) { return 700.0f * (std::pow(10.0f, mel / 2595.0f) - 1.0f); }
+static float hzToBark(float hz) { return 26.81f * hz / (1960.0f + hz) - 0.53f; }   // Traunmueller
+static float barkToHz(float bark) { return 1960.0f * (bark + 0.53f) / (26.28f - bark); }
+
+void AnalysisGraph::buildBinMapping(SpectrumScale scale, long sample_rate) {
+    const int useful_bins = fft_size_ / 2;
+    const float nyquist = sample_rate * 0.5f;
+    const float hz_per_bin = static_cast<float>(sample_rate) / fft_size_;
+    const float f_min = 20.0f;
+    const float f_max = std::min(nyquist, 20000.0f);
+    
+    // Display bin i covers [edge(i), edge(i + 1)), in FFT bins
+    auto edge = [&](int i) -> float {
+        float t = static_cast<float>(i) / bins_;
+        switch (scale) {
+            case SpectrumScale::Mel: {
+                float lo = hzToMel(f_min), hi = hzToMel(f_max);
+                return melToHz(lo + t * (hi - lo)) / hz_per_bin;
+            }
+            case SpectrumScale::Bark: {
+                float lo = hzToBark(f_min), hi = hzToBark(f_max);
+                return barkToHz(lo + t * (hi - lo)) / hz_per_bin;
+            }
+            case SpectrumScale::Semitone:
+            case SpectrumScale::ConstantQ: {
+                // Centred on the note: edges half a semitone either side
+                float note = SEMITONE_BASE_NOTE + i - 0.5f;
+                return 440.0f * std::pow(2.0f, (note - 69.0f) / 12.0f) / hz_per_bin;
+            }
+            default:
+                // Quadratic scale for more bass detail
+                return t * t * useful_bins;
+        }
+    };
+    
+    // Power grows with the square of the window length; bars are scaled to
+    // what a REFERENCE_FFT_SIZE transform reads so their level stays put
+    const float length_gain = static_cast<float>(REFERENCE_FFT_SIZE) / fft_size_;
+    for (int i = 0; i < bins_; ++i) {
+        int start_bin = static_cast<int>(edge(i));
+        int end_bin = static_cast<int>(edge(i + 1));
+        
+        start_bin = std::clamp(start_bin, 0, useful_bins - 1);
+        if (end_bin > useful_bins) end_bin = useful_bins;
+        if (end_bin <= start_bin) end_bin = start_bin + 1;
+        
+        bin_start_[i] = start_bin;
+        bin_end_[i] = end_bin;
+        bin_norm_[i] = length_gain * length_gain / static_cast<float>(end_bin - start_bin);
+    }
+    
+    mapped_scale_ = static_cast<int>(scale);
+    mapped_sample_rate_ = sample_rate;
+}
+
+void AnalysisGraph::processFFT(bool keep_power) {
+    PROFILE_STAGE(ProcessFFT);
+    
+    // Rebuild the bin mapping only when the scale or sample rate changes
+    const int scale = spectrum_scale_.load(std::memory_order_relaxed);
+    const long sample_rate = sample_rate_.load(std::memory_order_relaxed);
+    if (scale != mapped_scale_ || sample_rate != mapped_sample_rate_) {
+        buildBinMapping(static_cast<SpectrumScale>(scale), sample_rate);
+    }
+    
+    // The modes with transforms of their own only need the mix FFT for
+    // the pitch-sync trigger
+    bool own_transform = scale == static_cast<int>(SpectrumScale::ConstantQ) ||
+                         scale == static_cast<int>(SpectrumScale::MultiResolution) ||
+                         scale == static_cast<int>(SpectrumScale::BandZoom);
+    if (scale != static_cast<int>(SpectrumScale::BandZoom)) zoom_decimation_ = 0;  // no filtering while unused
+    
+    // Windowed FFT using the plan's preallocated buffer
+    static const std::vector<std::complex<float>> no_data;
+    const std::vector<std::complex<float>>& fftData =
+        (!own_transform || keep_power) ? fft_plan_.forward(fft_input_.window() + scope_history_ - fft_size_) : no_data;
+    
+    // Keep the power spectrum for the pitch-sync trigger (real and even, so
+    // its forward transform is the autocorrelation)
+    if (keep_power) {
+        const int half = fft_size_ / 2;
+        for (int k = 0; k <= half; ++k) {
+            power_spectrum_[k] = std::norm(fftData[k]);
+        }
+        for (int k = 1; k < half; ++k) {
+            power_spectrum_[fft_size_ - k] = power_spectrum_[k];
+        }
+    }
+    
+    // Mean power over each display bin's FFT range (no sqrt per FFT bin),
+    // or semitone bins from the constant-Q kernels
+    std::vector<float>& newSpectrum = spectrum_scratch_;
+    if (scale == static_cast<int>(SpectrumScale::ConstantQ)) {
+        computeConstantQ(newSpectrum);
+    } else if (scale == static_cast<int>(SpectrumScale::MultiResolution)) {
+        computeMultiResolution(newSpectrum);
+    } else if (scale == static_cast<int>(SpectrumScale::BandZoom)) {
+        computeZoom(newSpectrum);
+    } else {
+        for (int i = 0; i < bins_; ++i) {
+            float sum = 0.0f;
+            for (int j = bin_start_[i]; j < bin_end_[i]; ++j) {
+                sum += std::norm(fftData[j]);
+            }
+            newSpectrum[i] = sum * bin_norm_[i];
+        }
+    }
+    
+    // Convert to dB and normalize
+    const float smoothing = spectrum_smoothing_.load(std::memory_order_relaxed);
+    for (int i = 0; i < bins_; ++i) {
+        // Add small value to avoid log(0); one log per bar, on power
+        float db = 10.0f * std::log10(newSpectrum[i] + 1e-20f);
+        // Normalize to 0-1 range (assuming -60dB to 0dB range)
+        float normalized = (db + 60.0f) / 60.0f;
+        normalized = std::clamp(normalized, 0.0f, 1.0f);
+        
+        // Smooth with previous values
+        spectrum_data_[i] = smoothing * spectrum_data_[i] + 
+                           (1.0f - smoothing) * normalized;
+    }
+    
+    // Update history for waterfall display
+    uint8_t* row = spectrum_history_.data() + (spectrum_history_rows_ % history_size_) * bins_;
+    for (int i = 0; i < bins_; ++i) {
+        row[i] = static_cast<uint8_t>(spectrum_data_[i] * 255.0f + 0.5f);
+    }
+    spectrum_history_rows_++;
+}
+
+
+void AnalysisGraph::buildCqtKernels(long sample_rate) {
+    // Brown & Puckette: each semitone's Hann-windowed complex exponential,
+    // Q samples per cycle long and ending at the newest sample, is transformed
+    // once; only its significant spectral bins are kept
+    if (cqt_plan_.size() != CQT_FFT_SIZE) cqt_plan_.init(CQT_FFT_SIZE);
+    
+    const int n = CQT_FFT_SIZE;
+    const int half = n / 2;
+    const double q = 1.0 / (std::pow(2.0, 1.0 / 12.0) - 1.0);
+    const double nyquist = sample_rate * 0.5;
+    // Scale so a sine gives bars comparable to the FFT spectrum modes
+    const float gain = static_cast<float>(REFERENCE_FFT_SIZE) / n;
+    
+    std::vector<float> kernel_re(n), kernel_im(n);
+    std::vector<std::complex<float>> spec_re, spec_im;
+    cqt_bins_.clear();
+    cqt_weights_.clear();
+    
+    for (int k = 0; k < bins_; ++k) {
+        cqt_offsets_[k] = static_cast<int>(cqt_bins_.size());
+        double freq = 440.0 * std::pow(2.0, (SEMITONE_BASE_NOTE + k - 69) / 12.0);
+        if (freq >= nyquist) continue;
+        
+        // Bass notes get clamped to the FFT length (slightly lower Q there)
+        int len = std::min(n, static_cast<int>(std::ceil(q * sample_rate / freq)));
+        std::fill(kernel_re.begin(), kernel_re.end(), 0.0f);
+        std::fill(kernel_im.begin(), kernel_im.end(), 0.0f);
+        for (int i = 0; i < len; ++i) {
+            double w = 0.5 * (1.0 - std::cos(2.0 * M_PI * i / std::max(1, len - 1))) / len;
+            double phase = 2.0 * M_PI * freq * i / sample_rate;
+            kernel_re[n - len + i] = static_cast<float>(w * std::cos(phase));
+            kernel_im[n - len + i] = static_cast<float>(w * std::sin(phase));
+        }
+        
+        // FFT(re + i*im) = FFT(re) + i*FFT(im), via two real transforms
+        spec_re = cqt_plan_.forwardRaw(kernel_re.data());
+        spec_im = cqt_plan_.forwardRaw(kernel_im.data());
+        
+        float peak = 0.0f;
+        for (int j = 0; j <= half; ++j) {
+            std::complex<float> kj = spec_re[j] + std::complex<float>(0.0f, 1.0f) * spec_im[j];
+            spec_re[j] = kj;
+            peak = std::max(peak, std::abs(kj));
+        }
+        for (int j = 0; j <= half; ++j) {
+            if (std::abs(spec_re[j]) > 0.01f * peak) {
+                cqt_bins_.push_back(j);
+                cqt_weights_.push_back(std::conj(spec_re[j]) * gain);
+            }
+        }
+    }
+    cqt_offsets_[bins_] = static_cast<int>(cqt_bins_.size());
+    cqt_sample_rate_ = sample_rate;
+}
+
+void AnalysisGraph::computeConstantQ(std::vector<float>& power) {
+    long sample_rate = mapped_sample_rate_;
+    if (cqt_sample_rate_ != sample_rate) buildCqtKernels(sample_rate);
+    
+    // Fixed cost per frame: one FFT plus the sparse kernel products
+    const std::vector<std::complex<float>>& spectrum = cqt_plan_.forwardRaw(cqt_input_.window());
+    for (int k = 0; k < bins_; ++k) {
+        std::complex<float> sum(0.0f, 0.0f);
+        for (int e = cqt_offsets_[k]; e < cqt_offsets_[k + 1]; ++e) {
+            sum += spectrum[cqt_bins_[e]] * cqt_weights_[e];
+        }
+        power[k] = std::norm(sum);
+    }
+}
+
+int AnalysisGraph::estimatePeriod() {
+    const std::vector<std::complex<float>>& acf = fft_plan_.forwardRaw(power_spectrum_.data());
+    const int max_lag = std::min(waveform_size_, fft_size_) / 2;  // Need a couple of cycles on screen
+    
+    float r0 = acf[0].real();
+    if (r0 <= 1e-9f) return 0;
+    
+    // Skip the main lobe around lag 0, then take the strongest peak
+    int lag = 1;
+    while (lag < max_lag && acf[lag].real() > 0.0f) lag++;
+    
+    int best_lag = 0;
+    float best = 0.0f;
+    for (; lag < max_lag; ++lag) {
+        float r = acf[lag].real();
+        if (r > best) {
+            best = r;
+            best_lag = lag;
+        }
+    }
+    
+    // Weak peaks mean noise or a chord without a clear period
+    return (best > 0.3f * r0) ? best_lag : 0;
+}
+
+int AnalysisGraph::findScopeTrigger() {
+    const int latest = scope_history_ - waveform_size_;
+    const int mode = scope_trigger_.load(std::memory_order_relaxed);
+    frame_.pitch_hz = 0.0f;
+    if (mode == static_cast<int>(ScopeTrigger::Off)) return latest;
+    
+    // The trigger sits at the centre of the displayed window
+    const float* mono = fft_input_.window();
+    const int half = waveform_size_ / 2;
+    auto rising = [mono](int t) { return mono[t - 1] < 0.0f && mono[t] >= 0.0f; };
+    
+    // Edge: newest rising zero crossing
+    int edge_start = latest;
+    for (int t = latest + half; t > half; --t) {
+        if (rising(t)) {
+            edge_start = t - half;
+            break;
+        }
+    }
+    
+    int start = edge_start;
+    int period = (mode == static_cast<int>(ScopeTrigger::PitchSync)) ? estimatePeriod() : 0;
+    if (period > 0) {
+        // Among the crossings in the newest period, pick the one that best
+        // lines up with what was drawn last frame
+        frame_.pitch_hz = static_cast<float>(sample_rate_.load()) / period;
+        float best_score = -1e30f;
+        for (int t = latest + half; t > std::max(half, latest + half - period); --t) {
+            if (!rising(t)) continue;
+            const float* candidate = mono + (t - half);
+            float score = 0.0f;
+            for (int i = 0; i < waveform_size_; ++i) {
+                score += candidate[i] * trigger_template_[i];
+            }
+            if (score > best_score) {
+                best_score = score;
+                start = t - half;
+            }
+        }
+    }
+    
+    std::copy_n(mono + start, waveform_size_, trigger_template_.begin());
+    return start;
+}
+
+void AnalysisGraph::computeVoiceSpectra() {
+    int voices = std::min(voice_count_.load(), voice_capacity_);
+    if (voices <= 0) return;
+    
+    const int bins = VOICE_SCOPE_SIZE / 2 + 1;
+    long sample_rate = sample_rate_.load(std::memory_order_relaxed);
+    if (voice_plan_.size() != VOICE_SCOPE_SIZE) voice_plan_.init(VOICE_SCOPE_SIZE);
+    if (voice_mapped_rate_ != sample_rate) {
+        // Log-spaced bars over the range the chips' voices reach
+        const float f_min = 40.0f;
+        const float f_max = std::min(sample_rate * 0.5f, 12000.0f);
+        const float hz_per_bin = static_cast<float>(sample_rate) / VOICE_SCOPE_SIZE;
+        for (int i = 0; i <= VOICE_SPECTRUM_BINS; ++i) {
+            float hz = f_min * std::pow(f_max / f_min, static_cast<float>(i) / VOICE_SPECTRUM_BINS);
+            voice_edges_[i] = std::clamp(static_cast<int>(hz / hz_per_bin), 1, bins - 1);
+        }
+        voice_mapped_rate_ = sample_rate;
+    }
+    
+    // One batched transform: the voices ride side by side in the SIMD lanes
+    voice_inputs_.resize(voices);
+    for (int v = 0; v < voices; ++v) voice_inputs_[v] = voice_windows_[v].window();
+    voice_plan_.powerBatch(voice_inputs_.data(), voices, voice_power_.data());
+    
+    // Same -60..0 dB bars as the mix spectrum (scaled from VOICE_SCOPE_SIZE
+    // to REFERENCE_FFT_SIZE power) and the same smoothing
+    const float length_gain = static_cast<float>(REFERENCE_FFT_SIZE) / VOICE_SCOPE_SIZE;
+    const float smoothing = spectrum_smoothing_.load(std::memory_order_relaxed);
+    for (int v = 0; v < voices; ++v) {
+        const float* power = voice_power_.data() + static_cast<size_t>(v) * bins;
+        float* bars = frame_.voice_spectra.data() + static_cast<size_t>(v) * VOICE_SPECTRUM_BINS;
+        for (int i = 0; i < VOICE_SPECTRUM_BINS; ++i) {
+            int start = voice_edges_[i];
+            int end = std::max(voice_edges_[i + 1], start + 1);
+            float sum = 0.0f;
+            for (int j = start; j < end; ++j) sum += power[j];
+            float db = 10.0f * std::log10(sum * length_gain * length_gain / (end - start) + 1e-20f);
+            float normalized = std::clamp((db + 60.0f) / 60.0f, 0.0f, 1.0f);
+            bars[i] = smoothing * bars[i] + (1.0f - smoothing) * normalized;
+        }
+    }
+}
+
+void AnalysisGraph::computePitch() {
+    long sample_rate = sample_rate_.load(std::memory_order_relaxed);
+    int voices = std::min(voice_count_.load(), voice_capacity_);
+    for (int v = 0; v < voices; ++v) {
+        voice_pitch_[v].update(voice_windows_[v].window(), VOICE_SCOPE_SIZE, sample_rate, 1, &frame_.voice_pitches[v]);
+    }
+    frame_.mix_pitches.fill(PitchTracker::Estimate());
+    if (voices > 0) return;     // the voices already say it better
+    
+    // Pairs averaged, as ahead of the multi-resolution lows
+    int size = std::min(PITCH_WINDOW, fft_input_.size()) & ~1;
+    const float* mono = fft_input_.window() + fft_input_.size() - size;
+    for (int i = 0; i < size / 2; ++i) pitch_input_[i] = 0.5f * (mono[i * 2] + mono[i * 2 + 1]);
+    mix_pitch_.update(pitch_input_.data(), size / 2, sample_rate / 2, MIX_PITCHES, frame_.mix_pitches.data());
+}
+
+void AnalysisGraph::buildMultiResolutionMapping(long sample_rate) {
+    if (mr_plan_.size() != MR_FFT_SIZE) mr_plan_.init(MR_FFT_SIZE);
+    if (mr_high_plan_.size() != MR_HIGH_FFT_SIZE) mr_high_plan_.init(MR_HIGH_FFT_SIZE);
+    
+    const float f_min = 30.0f;
+    const float f_max = std::min(sample_rate * 0.5f, 16000.0f);
+    const float band_rate[MR_BANDS] = {static_cast<float>(sample_rate) / MR_DECIMATION,
+                                       static_cast<float>(sample_rate), static_cast<float>(sample_rate)};
+    const int band_size[MR_BANDS] = {MR_FFT_SIZE, MR_FFT_SIZE, MR_HIGH_FFT_SIZE};
+    
+    for (int i = 0; i < bins_; ++i) {
+        // Log-spaced edges; the bar's centre picks its band
+        float lo = f_min * std::pow(f_max / f_min, static_cast<float>(i) / bins_);
+        float hi = f_min * std::pow(f_max / f_min, static_cast<float>(i + 1) / bins_);
+        float centre = std::sqrt(lo * hi);
+        int band = centre < MR_LOW_SPLIT_HZ ? MR_LOW : centre < MR_HIGH_SPLIT_HZ ? MR_MID : MR_HIGH;
+        
+        int n = band_size[band];
+        float hz_per_bin = band_rate[band] / n;
+        int start = std::clamp(static_cast<int>(lo / hz_per_bin), 0, n / 2 - 1);
+        int end = std::min(static_cast<int>(hi / hz_per_bin), n / 2);
+        if (end <= start) end = start + 1;
+        
+        // Hann-windowed power grows with the square of the length; scale
+        // every band to what the REFERENCE_FFT_SIZE transform reads so the bars line up
+        float length_gain = static_cast<float>(REFERENCE_FFT_SIZE) / n;
+        mr_band_[i] = static_cast<uint8_t>(band);
+        mr_start_[i] = start;
+        mr_end_[i] = end;
+        mr_norm_[i] = length_gain * length_gain / (end - start);
+    }
+    mr_sample_rate_ = sample_rate;
+}
+
+void AnalysisGraph::computeMultiResolution(std::vector<float>& power) {
+    if (mr_sample_rate_ != mapped_sample_rate_) buildMultiResolutionMapping(mapped_sample_rate_);
+    
+    // Three short transforms in place of one long one: the low band's 1024
+    // points span 4096 samples, the mid and high bands are the newest part
+    // of the mono window. Bars are taken from each result before the shared
+    // plan runs again.
+    const float* newest = fft_input_.window() + scope_history_;
+    for (int band = 0; band < MR_BANDS; ++band) {
+        const std::vector<std::complex<float>>& spectrum =
+            band == MR_LOW ? mr_plan_.forward(mr_low_input_.window()) :
+            band == MR_MID ? mr_plan_.forward(newest - MR_FFT_SIZE) :
+                             mr_high_plan_.forward(newest - MR_HIGH_FFT_SIZE);
+        for (int i = 0; i < bins_; ++i) {
+            if (mr_band_[i] != band) continue;
+            float sum = 0.0f;
+            for (int j = mr_start_[i]; j < mr_end_[i]; ++j) {
+                sum += std::norm(spectrum[j]);
+            }
+            power[i] = sum * mr_norm_[i];
+        }
+    }
+}
+
+void AnalysisGraph::buildZoom(float low_hz, float high_hz, long sample_rate) {
+    if (zoom_plan_.size() != ZOOM_FFT_SIZE) {
+        zoom_plan_.init(ZOOM_FFT_SIZE);
+        zoom_spectrum_.resize(ZOOM_FFT_SIZE);
+    }
+    zoom_mapped_low_ = low_hz;
+    zoom_mapped_high_ = high_hz;
+    zoom_sample_rate_ = sample_rate;
+    
+    const float nyquist = sample_rate * 0.5f;
+    float low = std::clamp(std::min(low_hz, high_hz), 0.0f, nyquist - ZOOM_MIN_WIDTH);
+    float high = std::clamp(std::max(low_hz, high_hz), low + ZOOM_MIN_WIDTH, nyquist);
+    float width = high - low;
+    float centre = 0.5f * (low + high);
+    
+    // The band, centred on 0 Hz, spans +/- width / 2 of the decimated rate;
+    // anything within width / 2 of that rate would fold back onto it. A
+    // Blackman low-pass cut at half the rate is flat across the band and
+    // ~74 dB down by then. Shifted to the band centre it is the complex
+    // band-pass, so only its outputs at the decimated rate are computed.
+    int decimation = std::max(1, static_cast<int>(sample_rate / (ZOOM_OVERSAMPLE * width)));
+    double rate = static_cast<double>(sample_rate) / decimation;
+    int taps = std::min(ZOOM_HISTORY, static_cast<int>(std::ceil(5.5 * sample_rate / (rate - width))));
+    double cutoff = 0.5 * rate / sample_rate;
+    zoom_omega_ = 2.0 * M_PI * centre / sample_rate;
+    
+    std::vector<double> h(taps);
+    double sum = 0.0;
+    for (int n = 0; n < taps; ++n) {
+        double x = n - 0.5 * (taps - 1);
+        double sinc = x == 0.0 ? 2.0 * cutoff : std::sin(2.0 * M_PI * cutoff * x) / (M_PI * x);
+        double t = 2.0 * M_PI * n / (taps - 1);
+        h[n] = sinc * (0.42 - 0.5 * std::cos(t) + 0.08 * std::cos(2.0 * t));
+        sum += h[n];
+    }
+    zoom_kernel_re_.resize(taps);
+    zoom_kernel_im_.resize(taps);
+    for (int i = 0; i < taps; ++i) {
+        int n = taps - 1 - i;  // oldest-first, like the history window
+        zoom_kernel_re_[i] = static_cast<float>(h[n] / sum * std::cos(zoom_omega_ * n));
+        zoom_kernel_im_[i] = static_cast<float>(h[n] / sum * std::sin(zoom_omega_ * n));
+    }
+    
+    // Linear bars across the band; a sine reads as it would in the FFT
+    // modes (half its power is in the positive-frequency image kept here,
+    // as in a real FFT's one-sided bins)
+    const float hz_per_bin = static_cast<float>(rate) / ZOOM_FFT_SIZE;
+    const float length_gain = static_cast<float>(REFERENCE_FFT_SIZE) / ZOOM_FFT_SIZE;
+    for (int i = 0; i < bins_; ++i) {
+        float lo = low + width * i / bins_;
+        float hi = low + width * (i + 1) / bins_;
+        int start = static_cast<int>(std::floor((lo - centre) / hz_per_bin));
+        int end = std::max(static_cast<int>(std::floor((hi - centre) / hz_per_bin)), start + 1);
+        zoom_start_[i] = start;
+        zoom_end_[i] = end;
+        zoom_norm_[i] = length_gain * length_gain / (end - start);
+    }
+    
+    // Start from whatever history the kernel reaches, rather than waiting
+    // seconds for a narrow band's baseband to fill
+    zoom_decimation_ = decimation;
+    zoom_phase_ = 0;
+    zoom_re_.clear();
+    zoom_im_.clear();
+    int available = static_cast<int>(std::min<uint64_t>(zoom_clock_, ZOOM_HISTORY));
+    int count = available >= taps ? std::min(ZOOM_FFT_SIZE, (available - taps) / decimation + 1) : 0;
+    for (int k = count - 1; k >= 0; --k) {
+        pushZoomSample(k * decimation);
+    }
+}
+
+void AnalysisGraph::pushZoomSample(int age) {
+    // Band-pass the history ending 'age' samples ago, then shift the band
+    // centre to 0 Hz with e^(-i w0 t) at that sample
+    const int taps = static_cast<int>(zoom_kernel_re_.size());
+    const float* x = zoom_input_.window() + ZOOM_HISTORY - age - taps;
+    float re = 0.0f, im = 0.0f;
+    for (int i = 0; i < taps; ++i) {
+        re += x[i] * zoom_kernel_re_[i];
+        im += x[i] * zoom_kernel_im_[i];
+    }
+    double phase = std::fmod(zoom_omega_ * static_cast<double>(zoom_clock_ - 1 - age), 2.0 * M_PI);
+    float c = static_cast<float>(std::cos(phase));
+    float s = static_cast<float>(std::sin(phase));
+    zoom_re_.push(re * c + im * s);
+    zoom_im_.push(im * c - re * s);
+}
+
+void AnalysisGraph::computeZoom(std::vector<float>& power) {
+    float low = zoom_low_.load(std::memory_order_relaxed);
+    float high = zoom_high_.load(std::memory_order_relaxed);
+    if (zoom_decimation_ == 0 || low != zoom_mapped_low_ || high != zoom_mapped_high_ ||
+        zoom_sample_rate_ != mapped_sample_rate_) {
+        buildZoom(low, high, mapped_sample_rate_);
+    }
+    
+    // The baseband is complex: FFT(re + i*im) = FFT(re) + i*FFT(im), and
+    // each real transform's negative bins are the conjugates of its positive ones
+    const int n = ZOOM_FFT_SIZE;
+    const int half = n / 2;
+    const std::vector<std::complex<float>>& spectrum_re = zoom_plan_.forward(zoom_re_.window());
+    std::copy_n(spectrum_re.begin(), half + 1, zoom_spectrum_.begin());
+    const std::vector<std::complex<float>>& spectrum_im = zoom_plan_.forward(zoom_im_.window());
+    const std::complex<float> i_unit(0.0f, 1.0f);
+    for (int k = half; k >= 0; --k) {
+        std::complex<float> r = zoom_spectrum_[k];
+        std::complex<float> q = spectrum_im[k];
+        zoom_spectrum_[k] = r + i_unit * q;
+        if (k > 0 && k < half) zoom_spectrum_[n - k] = std::conj(r) + i_unit * std::conj(q);
+    }
+    
+    for (int i = 0; i < bins_; ++i) {
+        float sum = 0.0f;
+        for (int j = zoom_start_[i]; j < zoom_end_[i]; ++j) {
+            sum += std::norm(zoom_spectrum_[j & (n - 1)]);
+        }
+        power[i] = sum * zoom_norm_[i];
+    }
+}
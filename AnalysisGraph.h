@@ -0,0 +1,411 @@
+#pragma once
+
+#include "FftPlan.h"
+#include "AudioRing.h"
+#include "TripleBuffer.h"
+#include "SampleWindow.h"
+#include "LoudnessMeter.h"
+#include "PitchTracker.h"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <complex>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Oscilloscope trigger modes
+enum class ScopeTrigger {
+    Off = 0,        // Free-running: always the newest samples
+    Edge,           // Latest rising zero crossing
+    PitchSync,      // Autocorrelation period + best match with the previous frame
+    Count
+};
+
+// Frequency scales for mapping FFT bins to display bins
+enum class SpectrumScale {
+    Quadratic = 0,  // Original mapping: bin edges at (i / bins)^2 of Nyquist
+    Mel,
+    Bark,
+    Semitone,       // One bar per equal-tempered note from SEMITONE_BASE_NOTE
+    ConstantQ,      // Semitone bars from a constant-Q transform (matches the piano keys)
+    MultiResolution,// Log-spaced bars, each from the FFT length that suits its band
+    BandZoom,       // Linear bars across the zoom band, from its shifted and decimated signal
+    Count
+};
+
+// Analysis of the audio being played, shared by every view of it. The audio
+// producer queues the mix (and gme's per-voice taps) here; one worker thread
+// takes a hop of it per tick and runs the nodes some subscriber asked for -
+// scope, spectrum, levels, onsets, tempo, voice scopes, pitches - each at most once
+// however many subscribe. The tick's outputs are then copied to every
+// subscriber's own triple buffer, so a second spectrum view or an exporter
+// costs a copy, not another FFT, and no reader ever waits on another.
+class AnalysisGraph {
+public:
+    // Buffer sizes, chosen at runtime from these sets (see Resolution); each
+    // FFT size runs butterflies specialised for it (FftPlan)
+    static constexpr int FFT_SIZES[] = {1024, 2048, 4096, 8192};
+    static constexpr int SPECTRUM_BIN_COUNTS[] = {32, 64, 128};
+    static constexpr int WAVEFORM_SIZES[] = {512, 1024, 2048};
+    static constexpr int HISTORY_SIZES[] = {64, 128, 256};
+    static constexpr int MAX_SPECTRUM_BINS = 128;
+    static constexpr int MIN_HOP = 64;
+    static constexpr int MAX_HOP = 2048;
+    static constexpr float MIN_UPDATE_RATE = 20.0f;
+    static constexpr float MAX_UPDATE_RATE = 240.0f;
+    static constexpr float MAX_BACKLOG_SECONDS = 0.1f;  // Older backlog is skipped unanalysed
+    static constexpr int SEMITONE_BASE_NOTE = 36; // C2, lowest note of the semitone scale
+    static constexpr int VOICE_SCOPE_SIZE = 1024;
+    static constexpr int MAX_SCOPE_VOICES = 16;   // Nsf_Emu's most voices: APU + VRC6 + Namco
+    static constexpr int VOICE_SPECTRUM_BINS = 32;
+    static constexpr float ZOOM_MIN_WIDTH = 50.0f;    // Narrowest zoom band, Hz
+
+    // Nodes, as a mask of what a subscriber reads
+    static constexpr uint32_t NODE_SCOPE = 1 << 0;      // triggered stereo waveform
+    static constexpr uint32_t NODE_SPECTRUM = 1 << 1;   // display bins and waterfall history
+    static constexpr uint32_t NODE_LEVELS = 1 << 2;     // RMS and peak of the hop
+    static constexpr uint32_t NODE_ONSET = 1 << 3;      // spectral flux onsets (runs the spectrum)
+    static constexpr uint32_t NODE_VOICES = 1 << 4;     // per-voice scopes
+    static constexpr uint32_t NODE_VOICE_SPECTRA = 1 << 5;  // per-voice spectra, one batched FFT
+    static constexpr uint32_t NODE_LOUDNESS = 1 << 6;   // EBU R128 loudness and true peak (always measured)
+    static constexpr uint32_t NODE_TEMPO = 1 << 7;      // BPM and beat clock (runs onsets)
+    static constexpr uint32_t NODE_PITCH = 1 << 8;      // YIN pitches of each voice, or of the mix without voice taps
+    
+    static constexpr float TEMPO_MIN_BPM = 60.0f;
+    static constexpr float TEMPO_MAX_BPM = 200.0f;
+    static constexpr int MIX_PITCHES = 2;         // a lead and what accompanies it
+
+    struct Resolution {
+        int fft_size = 2048;        // Mix FFT, also the scope's trigger search range
+        int spectrum_bins = 64;     // Display bars
+        int waveform_size = 1024;   // Scope samples
+        int history_size = 128;     // Waterfall rows
+        bool operator==(const Resolution& other) const = default;
+    };
+
+    // One tick's outputs; only the nodes in 'nodes' are current
+    struct Frame {
+        uint64_t tick = 0;                                            // Ticks since reset
+        uint32_t nodes = 0;
+        std::vector<float> waveform_left;                             // Resolution::waveform_size
+        std::vector<float> waveform_right;
+        float pitch_hz = 0.0f;                                        // Pitch-sync estimate, 0 if none
+        std::vector<float> spectrum;                                  // Resolution::spectrum_bins
+        std::vector<uint8_t> history;                                 // Row-major ring, history_size x bins
+        int history_size = 0;
+        uint64_t history_rows = 0;                                    // Rows written since reset
+        float rms_left = 0.0f;
+        float rms_right = 0.0f;
+        float peak = 0.0f;                                            // Largest |sample| of either side
+        float onset_strength = 0.0f;                                  // Spectral flux over its recent mean
+        bool onset = false;                                           // A new sound started this tick
+        uint64_t onset_count = 0;                                     // Onsets since reset, for readers that skip ticks
+        float tempo_bpm = 0.0f;                                       // 0 until a tempo stands out
+        float tempo_confidence = 0.0f;                                // 0-1, how periodic the onsets are
+        float beat_phase = 0.0f;                                      // 0 on a beat, rising to 1 at the next
+        bool beat = false;                                            // A beat fell in this tick
+        uint64_t beat_count = 0;
+        float lufs_momentary = LoudnessMeter::NO_SIGNAL;              // Last 400 ms
+        float lufs_short_term = LoudnessMeter::NO_SIGNAL;             // Last 3 s
+        float lufs_integrated = LoudnessMeter::NO_SIGNAL;             // Gated, since reset
+        float true_peak = LoudnessMeter::NO_SIGNAL;                   // dBTP since the last tick published it
+        float true_peak_max = LoudnessMeter::NO_SIGNAL;               // dBTP since reset
+        std::vector<float> voice_waveforms;                           // voice capacity x VOICE_SCOPE_SIZE
+        std::vector<float> voice_spectra;                             // voice capacity x VOICE_SPECTRUM_BINS, 0-1
+        int voice_count = 0;
+        std::array<PitchTracker::Estimate, MIX_PITCHES> mix_pitches{};  // highest first; only without voice taps
+        std::vector<PitchTracker::Estimate> voice_pitches;           // voice capacity
+    };
+
+    // A reader's view; frames arrive in its own triple buffer
+    class Subscription {
+    public:
+        // Reader: true if a newer tick was picked up
+        bool acquire() { return frames_.acquire(); }
+        const Frame& frame() const { return frames_.front(); }
+
+        void setNodes(uint32_t nodes) { nodes_.store(nodes, std::memory_order_relaxed); }
+        uint32_t nodes() const { return nodes_.load(std::memory_order_relaxed); }
+
+        // Detachable subscriptions only: a resize dropped it rather than
+        // resize frames another thread may be reading; it gets no more ticks
+        bool detached() const { return detached_.load(std::memory_order_acquire); }
+
+    private:
+        friend class AnalysisGraph;
+        TripleBuffer<Frame> frames_;
+        std::atomic<uint32_t> nodes_{0};
+        bool detachable_ = false;
+        std::atomic<bool> detached_{false};
+    };
+
+    AnalysisGraph();
+    ~AnalysisGraph();
+    AnalysisGraph(const AnalysisGraph&) = delete;
+    AnalysisGraph& operator=(const AnalysisGraph&) = delete;
+
+    // Worker thread
+    void start();
+    void stop();
+
+    // Offline rendering, on a graph that was never start()ed: analyse one
+    // hop of the queued audio on the caller. False if less than a hop is queued.
+    bool tick();
+
+    // Any thread. Subscribers are added and dropped between ticks. A
+    // detachable one is for a reader other than the thread that calls
+    // setResolution() and setVoiceCount(): those drop it instead of resizing
+    // its frames, and the reader subscribes again.
+    std::shared_ptr<Subscription> subscribe(uint32_t nodes, bool detachable = false);
+    void unsubscribe(const std::shared_ptr<Subscription>& subscription);
+
+    // Clear all analysis state, e.g. when loading a new file
+    void reset();
+    void setSampleRate(long sample_rate) { sample_rate_.store(sample_rate); }
+    long sampleRate() const { return sample_rate_.load(); }
+
+    // Ticks per second of audio, whatever size the producer writes in: the
+    // hop is this many frames of the sample rate (120/s is ~368 frames at
+    // 44.1 kHz, over 80% overlap of the FFT window)
+    void setUpdateRate(float hz) { update_rate_.store(std::clamp(hz, MIN_UPDATE_RATE, MAX_UPDATE_RATE)); }
+    float updateRate() const { return update_rate_.load(); }
+    int hop() const;                // frames consumed per tick
+
+    // Producer: queue interleaved stereo audio (full scale +/-1); never blocks
+    void write(const float* samples, int sample_count);
+
+    // Frames queued through write() that the listener has not heard yet.
+    // Analysis stays that far behind the newest audio so every view shows
+    // what is coming out of the speakers. UI thread.
+    void setOutputDelay(int frames);
+
+    // Voice scope storage for the loaded file's gme voices, 0 when it has no
+    // voice taps. Call while the audio producer is stopped (under the audio
+    // lock); the worker is paused around the resize.
+    void setVoiceCount(int voices);
+    int voiceCapacity() const { return voice_capacity_; }
+    int voiceCount() const { return voice_count_.load(); }   // voices seen since reset
+
+    // Producer: per-voice output (from VoiceScopeBuffer's tap)
+    void writeVoice(int voice, const short* samples, long count);
+
+    // Analysis sizes, each snapped to the nearest size its set holds. Like
+    // setVoiceCount it pauses the worker and resizes every subscriber's
+    // frames, so call it from the thread that reads them; the analysis
+    // starts over.
+    void setResolution(Resolution resolution);
+    const Resolution& resolution() const { return resolution_; }
+
+    // Settings, read by the worker each tick
+    void setSpectrumScale(SpectrumScale scale) { spectrum_scale_.store(static_cast<int>(scale)); }
+    SpectrumScale spectrumScale() const { return static_cast<SpectrumScale>(spectrum_scale_.load()); }
+    void setScopeTrigger(ScopeTrigger mode) { scope_trigger_.store(static_cast<int>(mode)); }
+    ScopeTrigger scopeTrigger() const { return static_cast<ScopeTrigger>(scope_trigger_.load()); }
+    void setSpectrumSmoothing(float smooth) { spectrum_smoothing_.store(smooth); }
+    float spectrumSmoothing() const { return spectrum_smoothing_.load(); }
+    // Band shown by SpectrumScale::BandZoom; widened to ZOOM_MIN_WIDTH and
+    // kept below Nyquist by the worker
+    void setZoomBand(float low_hz, float high_hz) {
+        zoom_low_.store(low_hz);
+        zoom_high_.store(high_hz);
+    }
+    float zoomLow() const { return zoom_low_.load(); }
+    float zoomHigh() const { return zoom_high_.load(); }
+
+private:
+    static constexpr int SAMPLE_RING_FRAMES = 16384; // Producer -> analysis queue
+    static constexpr int REFERENCE_FFT_SIZE = 2048;      // Bars read the same level at any FFT size as at this one
+    static constexpr int CQT_FFT_SIZE = 8192;            // Longest constant-Q kernel (~186ms at 44.1kHz)
+    static constexpr int MAX_OUTPUT_DELAY = SAMPLE_RING_FRAMES / 2;  // leaves the producer room to write
+    static constexpr int ONSET_HISTORY = 16;             // Ticks of flux the onset threshold averages
+    // Tempo: autocorrelation of the onset novelty over lags of up to a
+    // TEMPO_MIN_BPM beat at MAX_UPDATE_RATE, forgetting with a time constant
+    // of TEMPO_MEMORY seconds; the beat clock moves BEAT_PULL of the way to
+    // an onset within BEAT_CAPTURE of a beat, and jumps to the next onset
+    // after BEAT_RESYNC in a row fall outside it (or when it starts)
+    static constexpr int TEMPO_HISTORY = 256;
+    static constexpr float TEMPO_MEMORY = 6.0f;
+    static constexpr float TEMPO_WARMUP = 2.0f;          // Seconds before a tempo is reported
+    static constexpr float TEMPO_MIN_CONFIDENCE = 0.1f;
+    static constexpr float BEAT_CAPTURE = 0.25f;
+    static constexpr float BEAT_PULL = 0.5f;
+    static constexpr int BEAT_RESYNC = 4;
+    static_assert(TEMPO_HISTORY > MAX_UPDATE_RATE * 60.0f / TEMPO_MIN_BPM + 2, "lags up to the slowest beat");
+    
+    // Multi-resolution bands: lows from a 4096-sample span (a 1024-point FFT
+    // of the mix decimated by 4), mids from the newest 1024 samples, highs
+    // from the newest 256
+    static constexpr int MR_FFT_SIZE = 1024;
+    static constexpr int MR_HIGH_FFT_SIZE = 256;
+    static constexpr int MR_DECIMATION = 4;
+    static constexpr float MR_LOW_SPLIT_HZ = 400.0f;
+    static constexpr float MR_HIGH_SPLIT_HZ = 3000.0f;
+    enum MrBand { MR_LOW = 0, MR_MID, MR_HIGH, MR_BANDS };
+    
+    // Band zoom: a complex band-pass FIR shifts the band to 0 Hz and is only
+    // evaluated every decimation's worth of samples, at ZOOM_OVERSAMPLE times
+    // the band width; ZOOM_FFT_SIZE of those resolve it as finely as an FFT
+    // of ZOOM_FFT_SIZE x decimation samples would
+    static constexpr int ZOOM_FFT_SIZE = 512;
+    static constexpr int ZOOM_HISTORY = 32768;           // Longest band-pass kernel
+    static constexpr float ZOOM_OVERSAMPLE = 1.5f;
+
+    // Pitch: the mix's newest PITCH_WINDOW samples, decimated by 2 for
+    // lags down to 43 Hz at 44.1 kHz in a quarter of the work; voices are
+    // searched at full rate in their scope windows (down to 86 Hz)
+    static constexpr int PITCH_WINDOW = 2048;
+
+    // Producer -> analysis thread sample queue (stereo float)
+    AudioRing sample_ring_;
+    std::thread thread_;
+    std::atomic<bool> running_{false};
+    std::atomic<float> update_rate_{120.0f};
+    std::atomic<int> output_delay_{0};            // frames held back in sample_ring_
+    std::atomic<uint32_t> reset_generation_{0};   // bumped by reset()
+    std::atomic<long> sample_rate_{44100};
+    int voice_capacity_ = 0;                      // Voices with storage, set by setVoiceCount()
+    std::unique_ptr<AudioRing[]> voice_rings_;    // Producer -> analysis, mono per voice
+    std::atomic<int> voice_count_{0};             // Voices seen since reset (0 = no voice taps)
+    std::atomic<int> spectrum_scale_{static_cast<int>(SpectrumScale::Quadratic)};
+    std::atomic<int> scope_trigger_{static_cast<int>(ScopeTrigger::PitchSync)};
+    std::atomic<float> spectrum_smoothing_{0.7f};
+    std::atomic<float> zoom_low_{50.0f};
+    std::atomic<float> zoom_high_{500.0f};
+    Resolution resolution_;
+
+    std::mutex subscribers_mutex_;
+    std::vector<std::shared_ptr<Subscription>> subscribers_;
+
+    // --- Worker state ---
+    uint32_t reset_seen_ = 0;
+    int fft_size_ = 0;                            // resolution_, copied for the worker
+    int bins_ = 0;
+    int waveform_size_ = 0;
+    int history_size_ = 0;
+    int scope_history_ = 0;                       // Scope and mono windows: the FFT and the trigger search
+    std::vector<float> hop_buffer_;               // One hop of interleaved frames, then one voice's
+    Frame frame_;                                 // This tick's outputs, copied to subscribers
+
+    // FFT plan and precomputed display bin mapping
+    FftPlan fft_plan_;
+    std::vector<float> spectrum_scratch_;         // Per-block magnitudes
+    std::array<int, MAX_SPECTRUM_BINS> bin_start_;    // FFT bin range [start, end) per display bin
+    std::array<int, MAX_SPECTRUM_BINS> bin_end_;
+    std::array<float, MAX_SPECTRUM_BINS> bin_norm_;   // 1 / bin count, so bars are mean power
+    int mapped_scale_ = -1;                       // Scale/rate the mapping was built for
+    long mapped_sample_rate_ = 0;
+
+    // Constant-Q: sparse spectral kernels applied to an unwindowed CQT_FFT_SIZE FFT.
+    // Built lazily the first time the mode is used.
+    FftPlan cqt_plan_;
+    SampleWindow cqt_input_;
+    std::array<int, MAX_SPECTRUM_BINS + 1> cqt_offsets_{};  // Kernel k is [offsets[k], offsets[k+1])
+    std::vector<int> cqt_bins_;
+    std::vector<std::complex<float>> cqt_weights_;
+    long cqt_sample_rate_ = 0;
+    
+    // Multi-resolution: bar b sums bins [mr_start_, mr_end_) of band mr_band_
+    FftPlan mr_plan_;                             // Low and mid bands, one after the other
+    FftPlan mr_high_plan_;
+    SampleWindow mr_low_input_;                   // Mix decimated by MR_DECIMATION
+    float mr_decimation_sum_ = 0.0f;
+    int mr_decimation_phase_ = 0;
+    std::array<uint8_t, MAX_SPECTRUM_BINS> mr_band_{};
+    std::array<int, MAX_SPECTRUM_BINS> mr_start_{};
+    std::array<int, MAX_SPECTRUM_BINS> mr_end_{};
+    std::array<float, MAX_SPECTRUM_BINS> mr_norm_{};  // Mean power, scaled to the REFERENCE_FFT_SIZE bars
+    long mr_sample_rate_ = 0;
+    
+    // Band zoom: bar b sums baseband bins [zoom_start_, zoom_end_), negative
+    // below the band centre
+    FftPlan zoom_plan_;
+    SampleWindow zoom_input_;                     // Mono history for the band-pass kernel
+    SampleWindow zoom_re_;                        // Baseband at the decimated rate
+    SampleWindow zoom_im_;
+    std::vector<float> zoom_kernel_re_;           // Oldest-first, e^(i w0 n) h[n]
+    std::vector<float> zoom_kernel_im_;
+    std::vector<std::complex<float>> zoom_spectrum_;  // All ZOOM_FFT_SIZE bins of the baseband
+    double zoom_omega_ = 0.0;                     // Band centre, radians per sample
+    uint64_t zoom_clock_ = 0;                     // Samples pushed, for the mixing phase
+    int zoom_decimation_ = 0;                     // 0 while the mode is not in use
+    int zoom_phase_ = 0;
+    std::array<int, MAX_SPECTRUM_BINS> zoom_start_{};
+    std::array<int, MAX_SPECTRUM_BINS> zoom_end_{};
+    std::array<float, MAX_SPECTRUM_BINS> zoom_norm_{};
+    float zoom_mapped_low_ = 0.0f;
+    float zoom_mapped_high_ = 0.0f;
+    long zoom_sample_rate_ = 0;
+
+    // Audio buffers
+    SampleWindow waveform_left_;                  // Left channel
+    SampleWindow waveform_right_;                 // Right channel
+    SampleWindow fft_input_;                      // Mono, scope_history_ long; the FFT reads the newest fft_size_
+    std::vector<SampleWindow> voice_windows_;
+    LoudnessMeter loudness_;                      // Fed every frame read, skipped backlog included
+
+    // Scope trigger state
+    std::vector<float> power_spectrum_;           // |X|^2 mirrored to fft_size_, for autocorrelation
+    std::vector<float> trigger_template_;         // Mono samples shown last frame
+    int scope_start_ = 0;                         // Start of the displayed window in the scope history
+    std::vector<float> spectrum_data_;            // Current spectrum
+    std::vector<uint8_t> spectrum_history_;       // history_size_ x bins_ ring for waterfall
+    uint64_t spectrum_history_rows_ = 0;          // Total rows written; row index = rows % history_size_
+
+    // Per-voice spectra: every voice window through one batched transform
+    FftPlan voice_plan_;
+    std::vector<float> voice_power_;              // voice capacity x (VOICE_SCOPE_SIZE / 2 + 1)
+    std::vector<const float*> voice_inputs_;
+    std::array<int, VOICE_SPECTRUM_BINS + 1> voice_edges_{};  // FFT bin edges of the bars
+    long voice_mapped_rate_ = 0;
+
+    // Pitch trackers: the mix's, and one per voice
+    PitchTracker mix_pitch_;
+    std::vector<PitchTracker> voice_pitch_;
+    std::vector<float> pitch_input_;              // Decimated mix
+    
+    // Onset state: previous spectrum and recent flux
+    std::array<float, MAX_SPECTRUM_BINS> onset_previous_{};
+    std::array<float, ONSET_HISTORY> onset_flux_{};
+    bool onset_above_ = false;                    // Flux was over the threshold last tick
+    float onset_novelty_ = 0.0f;                  // This tick's flux above its recent mean
+    
+    // Tempo state, in ticks of the rate it was built for
+    std::array<float, TEMPO_HISTORY> tempo_novelty_{}; // Ring of onset novelty
+    std::array<float, TEMPO_HISTORY> tempo_acf_{};     // Leaky autocorrelation by lag
+    std::array<float, TEMPO_HISTORY> tempo_weight_{};  // Preference for lags near 120 BPM
+    float tempo_energy_ = 0.0f;                   // Lag 0
+    float tempo_rate_ = 0.0f;
+    uint64_t tempo_ticks_ = 0;
+    float beat_phase_ = 0.0f;
+    int beat_misses_ = BEAT_RESYNC;               // Onsets off the beat clock in a row
+
+    void threadFunc();
+    void resizeSubscribers(const Frame& blank);   // setResolution, setVoiceCount
+    void resetAnalysis();              // Worker: clear buffers after reset()
+    int readHop(int hop);              // Next hop from the rings into the windows; frames read
+    void pushSamples(const float* frames, int count);
+    void publish(uint32_t nodes);
+    uint32_t wantedNodes();
+    void computeLevels(const float* frames, int count);
+    void computeOnset();
+    void computeTempo();
+    void resetTempo(float rate);
+    void computeVoiceSpectra();
+    void computePitch();
+    Frame blankFrame() const;          // Sized for resolution_ and voice_capacity_
+    void applyResolution();            // Size the worker's buffers for resolution_
+    void processFFT(bool keep_power);
+    int estimatePeriod();              // Samples per cycle from the autocorrelation, 0 if unpitched
+    int findScopeTrigger();
+    void buildBinMapping(SpectrumScale scale, long sample_rate);
+    void buildCqtKernels(long sample_rate);
+    void computeConstantQ(std::vector<float>& power);
+    void buildMultiResolutionMapping(long sample_rate);
+    void computeMultiResolution(std::vector<float>& power);
+    void buildZoom(float low_hz, float high_hz, long sample_rate);
+    void pushZoomSample(int age);      // Baseband sample ending 'age' samples before the newest
+    void computeZoom(std::vector<float>& power);
+};
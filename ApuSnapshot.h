@@ -0,0 +1,121 @@
+#pragma once
+
+#include "SeqLock.h"
+#include "ChannelLayout.h"
+#include "PitchTracker.h"
+#include "gme/Nes_Apu.h"
+#include "gme/Nes_Vrc6_Apu.h"
+#include "gme/Nes_Fme7_Apu.h"
+#include "gme/Nes_Namco_Apu.h"
+#include "gme/Music_Emu.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+// Channel state of the NES APU and expansion chips as of the end of one APU
+// frame, written once per frame by whoever runs the sound chips (the NES
+// emulation thread or the NSF synthesis thread) and read lock-free by the
+// visualizers at draw time. Channels are in ChannelLayout order for the chips
+// passed to capture(); only the first channel_count entries are meaningful.
+struct ApuFrameSnapshot {
+    static constexpr int CHANNELS = ChannelLayout::MAX_CHANNELS;
+    static constexpr int BASE_CHANNELS = ChannelLayout::BASE_CHANNELS;
+
+    double time = 0.0;              // Seconds of emulated/playback time
+    int periods[CHANNELS] = {};     // Namco: clocks per waveform cycle
+    int lengths[CHANNELS] = {};     // Length counters; expansion channels report 1 while enabled
+    int amplitudes[CHANNELS] = {};  // Current output level (VRC6: volume while enabled)
+    int volumes[CHANNELS] = {};     // Expansion channel volume (VRC6 saw: rate), 0 for the base channels
+    float frequencies[CHANNELS] = {};  // Voice channels: pitch in Hz, 0 when unpitched
+    int channel_count = 0;
+    uint8_t chips = 0;              // ChannelLayout::Chip bits
+    bool active = false;            // False when no APU is running (non-NSF file, no ROM)
+
+    // Read the chips' current oscillator state; expansion chips may be null
+    static ApuFrameSnapshot capture(const Nes_Apu& apu, const Nes_Vrc6_Apu* vrc6,
+                                    const Nes_Fme7_Apu* fme7, const Nes_Namco_Apu* namco, double time) {
+        ApuFrameSnapshot snapshot;
+        snapshot.time = time;
+        snapshot.active = true;
+        int ch = 0;
+        for (int i = 0; i < BASE_CHANNELS; ++i, ++ch) {
+            snapshot.periods[ch] = apu.osc_period(i);
+            snapshot.lengths[ch] = apu.osc_length(i);
+            snapshot.amplitudes[ch] = apu.osc_amplitude(i);
+        }
+        if (vrc6) {
+            snapshot.chips |= ChannelLayout::VRC6;
+            for (int i = 0; i < Nes_Vrc6_Apu::osc_count; ++i, ++ch) {
+                snapshot.periods[ch] = vrc6->osc_period(i);
+                snapshot.lengths[ch] = vrc6->osc_enabled(i) ? 1 : 0;
+                snapshot.amplitudes[ch] = vrc6->osc_amplitude(i);
+                snapshot.volumes[ch] = vrc6->osc_volume(i);
+            }
+        }
+        if (fme7) {
+            snapshot.chips |= ChannelLayout::FME7;
+            for (int i = 0; i < Nes_Fme7_Apu::osc_count; ++i, ++ch) {
+                snapshot.periods[ch] = fme7->osc_period(i);
+                snapshot.lengths[ch] = fme7->osc_enabled(i) ? 1 : 0;
+                snapshot.amplitudes[ch] = fme7->osc_amplitude(i);
+                snapshot.volumes[ch] = fme7->osc_volume(i);
+            }
+        }
+        if (namco) {
+            snapshot.chips |= ChannelLayout::NAMCO;
+            for (int i = 0; i < Nes_Namco_Apu::osc_count; ++i, ++ch) {
+                snapshot.periods[ch] = namco->osc_period(i);
+                snapshot.lengths[ch] = namco->osc_enabled(i) ? 1 : 0;
+                snapshot.amplitudes[ch] = namco->osc_amplitude(i);
+                snapshot.volumes[ch] = namco->osc_volume(i);
+            }
+        }
+        snapshot.channel_count = ch;
+        return snapshot;
+    }
+
+    // Read the voices of any other format, in ChannelLayout::buildVoices
+    // order: lengths are 1 while a voice sounds, amplitudes and volumes 0-15
+    static ApuFrameSnapshot captureVoices(const Music_Emu& emu, double time) {
+        Music_Emu::voice_state_t states[CHANNELS];
+        ApuFrameSnapshot snapshot;
+        snapshot.time = time;
+        snapshot.active = true;
+        int count = emu.voice_states(states, CHANNELS);
+        snapshot.channel_count = count < CHANNELS ? count : CHANNELS;
+        for (int ch = 0; ch < snapshot.channel_count; ++ch) {
+            const Music_Emu::voice_state_t& voice = states[ch];
+            int volume = voice.active ? voice.volume : 0;
+            snapshot.periods[ch] = static_cast<int>(voice.period);
+            snapshot.lengths[ch] = voice.active ? 1 : 0;
+            snapshot.amplitudes[ch] = volume;
+            snapshot.volumes[ch] = volume;
+            snapshot.frequencies[ch] = voice.period > 0 ? static_cast<float>(voice.clock / voice.period) : 0.0f;
+        }
+        return snapshot;
+    }
+
+    // Voice channels from pitches tracked in the audio, one per estimate:
+    // sounding while pitched, volumes 1-15 over -48 to 0 dBFS of the level
+    static ApuFrameSnapshot capturePitches(const PitchTracker::Estimate* pitches, int count, double time) {
+        ApuFrameSnapshot snapshot;
+        snapshot.time = time;
+        snapshot.active = true;
+        snapshot.channel_count = count < CHANNELS ? count : CHANNELS;
+        for (int ch = 0; ch < snapshot.channel_count; ++ch) {
+            const PitchTracker::Estimate& pitch = pitches[ch];
+            int volume = 0;
+            if (pitch.hz > 0.0f) {
+                float db = 20.0f * std::log10(std::max(pitch.level, 1e-6f));
+                volume = std::clamp(static_cast<int>(std::lround(15.0f * (1.0f + db / 48.0f))), 1, 15);
+            }
+            snapshot.lengths[ch] = volume > 0 ? 1 : 0;
+            snapshot.amplitudes[ch] = volume;
+            snapshot.volumes[ch] = volume;
+            snapshot.frequencies[ch] = pitch.hz;
+        }
+        return snapshot;
+    }
+};
+
+using ApuSnapshotLock = SeqLock<ApuFrameSnapshot>;
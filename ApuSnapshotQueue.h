@@ -0,0 +1,92 @@
+#pragma once
+
+#include "ApuSnapshot.h"
+#include <atomic>
+#include <cstdint>
+
+// Channel states stamped with the output frame at which they are heard,
+// pushed once per play routine call (or emulated frame) by the thread that
+// produces the audio
+// and read lock-free by the UI. The synthesis side runs ahead of the speakers
+// by whatever is queued, so the UI does not take the newest state but the
+// newest one its audio clock has reached: key highlights then follow what is
+// heard, not what was last rendered, and no note shorter than a chunk is
+// lost. One producer, any number of readers; the oldest entries are
+// overwritten, which only matters to a reader more than CAPACITY play calls
+// behind.
+class ApuSnapshotQueue {
+public:
+    static constexpr int CAPACITY = 1024;   // seconds of play calls, more than gme ever runs ahead
+
+    ApuSnapshotQueue() = default;
+    ApuSnapshotQueue(const ApuSnapshotQueue&) = delete;
+    ApuSnapshotQueue& operator=(const ApuSnapshotQueue&) = delete;
+
+    // Producer. 'frame' is the output frame the state is heard from; it may
+    // jump back after a seek or track change.
+    void push(const ApuFrameSnapshot& snapshot, uint64_t frame) {
+        uint64_t seq = head_.load(std::memory_order_relaxed);
+        Slot& slot = slots_[seq & MASK];
+        slot.seq.store(0, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        slot.frame.store(frame, std::memory_order_relaxed);
+        slot.snapshot.store(snapshot);
+        slot.seq.store(seq + 1, std::memory_order_release);
+        head_.store(seq + 1, std::memory_order_release);
+    }
+
+    // Reader: the most recently pushed state heard by output frame 'frame'.
+    // Returns its sequence number + 1, or 0 if there is none; 'out' (and
+    // 'out_frame', the frame it was pushed with) is only copied when that
+    // differs from 'seen', the value returned last time.
+    uint64_t heardBy(uint64_t frame, ApuFrameSnapshot& out, uint64_t seen, uint64_t* out_frame = nullptr) const {
+        uint64_t head = head_.load(std::memory_order_acquire);
+        uint64_t oldest = head > static_cast<uint64_t>(CAPACITY) ? head - CAPACITY : 0;
+        for (uint64_t seq = head; seq > oldest; --seq) {
+            const Slot& slot = slots_[(seq - 1) & MASK];
+            if (slot.seq.load(std::memory_order_acquire) != seq) continue;  // being overwritten
+            uint64_t slot_frame = slot.frame.load(std::memory_order_relaxed);
+            if (slot_frame > frame) continue;
+            if (seq == seen) return seen;
+            ApuFrameSnapshot snapshot;
+            slot.snapshot.load(snapshot);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (slot.seq.load(std::memory_order_relaxed) != seq) continue;  // lapped mid-copy
+            out = snapshot;
+            if (out_frame) *out_frame = slot_frame;
+            return seq;
+        }
+        return 0;
+    }
+
+    // Sequence number the next push gets. A reader that takes every state
+    // (SnapshotLog recording) walks from its last head() up to this one.
+    uint64_t head() const { return head_.load(std::memory_order_acquire); }
+
+    // The state pushed as sequence number 'seq'; false once it has been
+    // overwritten or while it is being written
+    bool read(uint64_t seq, ApuFrameSnapshot& out, uint64_t* out_frame = nullptr) const {
+        const Slot& slot = slots_[seq & MASK];
+        if (slot.seq.load(std::memory_order_acquire) != seq + 1) return false;
+        uint64_t frame = slot.frame.load(std::memory_order_relaxed);
+        ApuFrameSnapshot snapshot;
+        slot.snapshot.load(snapshot);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (slot.seq.load(std::memory_order_relaxed) != seq + 1) return false;
+        out = snapshot;
+        if (out_frame) *out_frame = frame;
+        return true;
+    }
+
+private:
+    static constexpr uint64_t MASK = CAPACITY - 1;
+
+    struct Slot {
+        std::atomic<uint64_t> seq{0};     // sequence number + 1 of the state held, 0 while written
+        std::atomic<uint64_t> frame{0};
+        SeqLock<ApuFrameSnapshot> snapshot;
+    };
+
+    Slot slots_[CAPACITY];
+    alignas(64) std::atomic<uint64_t> head_{0};
+};
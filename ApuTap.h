@@ -0,0 +1,61 @@
+#pragma once
+
+#include "gme/Nsf_Emu.h"
+#include "gme/Nes_Apu.h"
+#include "gme/Nes_Vrc6_Apu.h"
+#include "gme/Nes_Fme7_Apu.h"
+#include "gme/Nes_Namco_Apu.h"
+#include "ApuSnapshot.h"
+#include "ChannelLayout.h"
+
+// Typed handles to the sound chips of a loaded NSF, resolved once when the
+// file is loaded. The per-chunk readers (synthesis thread, piano preprocessing)
+// use these directly instead of a dynamic_cast or std::function per chunk.
+// Expansion chip pointers are null when the NSF doesn't use that chip. Other
+// formats are read through their emulator's voice states instead.
+struct ApuTap {
+    Nsf_Emu* nsf = nullptr;
+    Nes_Apu* apu = nullptr;
+    Nes_Vrc6_Apu* vrc6 = nullptr;
+    Nes_Fme7_Apu* fme7 = nullptr;
+    Nes_Namco_Apu* namco = nullptr;
+    Music_Emu* voices = nullptr;    // Not an NSF, but reports Music_Emu::voice_states
+
+    // Empty tap for an emulator with neither
+    static ApuTap resolve(Music_Emu* emu) {
+        ApuTap tap;
+        tap.nsf = dynamic_cast<Nsf_Emu*>(emu);
+        if (tap.nsf) {
+            tap.apu = tap.nsf->apu_();
+            tap.vrc6 = tap.nsf->vrc6_();
+            tap.fme7 = tap.nsf->fme7_();
+            tap.namco = tap.nsf->namco_();
+        } else if (emu && emu->voice_states(nullptr, 0) > 0) {
+            tap.voices = emu;
+        }
+        return tap;
+    }
+
+    bool valid() const { return apu != nullptr || voices != nullptr; }
+
+    // The channels capture() fills
+    ChannelLayout layout() const {
+        if (voices) return ChannelLayout::buildVoices(voices->voice_names(), voices->voice_count());
+        return ChannelLayout::build(chips(), declaredChips());
+    }
+
+    // Current state of every channel; valid() taps only
+    ApuFrameSnapshot capture(double time) const {
+        if (voices) return ApuFrameSnapshot::captureVoices(*voices, time);
+        return ApuFrameSnapshot::capture(*apu, vrc6, fme7, namco, time);
+    }
+    
+    // ChannelLayout::Chip bits of the expansion chips present
+    uint8_t chips() const {
+        return (vrc6 ? ChannelLayout::VRC6 : 0) | (fme7 ? ChannelLayout::FME7 : 0) |
+               (namco ? ChannelLayout::NAMCO : 0);
+    }
+    
+    // Chip flags from the NSF header, including chips gme doesn't emulate
+    uint8_t declaredChips() const { return nsf ? nsf->header().chip_flags : 0; }
+};
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+// One sound register write as the CPU made it
+struct ApuWrite {
+    uint64_t cycle;     // CPU cycle (NES: since power-on; NSF: since the track started)
+    uint16_t addr;      // $4000-$4017 or an expansion chip register
+    uint8_t value;
+};
+
+// Fixed-size trace of sound register writes: one producer (the thread that
+// runs the CPU), any number of readers, none of them blocking or allocating.
+// Each reader keeps its own cursor; a reader that falls more than CAPACITY
+// writes behind skips what was overwritten and is told how many it lost.
+// Every slot carries the sequence number of the write it holds, published
+// last, so a copy racing an overwrite is detected and dropped.
+class ApuWriteLog {
+public:
+    static constexpr int CAPACITY = 1 << 15;    // several seconds of even a busy sound driver
+
+    ApuWriteLog() = default;
+    ApuWriteLog(const ApuWriteLog&) = delete;
+    ApuWriteLog& operator=(const ApuWriteLog&) = delete;
+
+    // Producer
+    void push(uint64_t cycle, uint16_t addr, uint8_t value) {
+        uint64_t seq = head_.load(std::memory_order_relaxed);
+        Slot& slot = slots_[seq & MASK];
+        slot.seq.store(0, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        slot.cycle.store(cycle, std::memory_order_relaxed);
+        slot.data.store(static_cast<uint32_t>(addr) | static_cast<uint32_t>(value) << 16,
+                        std::memory_order_relaxed);
+        slot.seq.store(seq + 1, std::memory_order_release);
+        head_.store(seq + 1, std::memory_order_release);
+    }
+
+    // Sequence number of the next write; a new reader starts its cursor here
+    // to see only what comes after
+    uint64_t head() const { return head_.load(std::memory_order_acquire); }
+
+    // Reader: copy up to 'max' writes from 'cursor' on and advance it past
+    // them. Writes overwritten before they were read are skipped and added
+    // to *lost.
+    int read(uint64_t& cursor, ApuWrite* out, int max, uint64_t* lost = nullptr) const {
+        uint64_t end = head_.load(std::memory_order_acquire);
+        uint64_t skipped = 0;
+        if (end - cursor > static_cast<uint64_t>(CAPACITY)) {
+            skipped += end - CAPACITY - cursor;
+            cursor = end - CAPACITY;
+        }
+        int count = 0;
+        while (cursor < end && count < max) {
+            const Slot& slot = slots_[cursor & MASK];
+            uint64_t cycle = slot.cycle.load(std::memory_order_relaxed);
+            uint32_t data = slot.data.load(std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (slot.seq.load(std::memory_order_relaxed) == cursor + 1) {
+                out[count++] = ApuWrite{cycle, static_cast<uint16_t>(data), static_cast<uint8_t>(data >> 16)};
+            } else {
+                skipped++;  // the producer lapped us mid-copy
+            }
+            cursor++;
+        }
+        if (lost) *lost += skipped;
+        return count;
+    }
+
+private:
+    static constexpr uint64_t MASK = CAPACITY - 1;
+
+    struct Slot {
+        std::atomic<uint64_t> seq{0};     // sequence number + 1 of the write held, 0 while written
+        std::atomic<uint64_t> cycle{0};
+        std::atomic<uint32_t> data{0};    // addr | value << 16
+    };
+
+    Slot slots_[CAPACITY];
+    alignas(64) std::atomic<uint64_t> head_{0};
+};
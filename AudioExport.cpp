@@ -0,0 +1,880 @@
+#include "AudioExport.h"
+#include "gme/gme.h"
+#include "VoiceScopeBuffer.h"
+#include "MidiExport.h"
+#include "PianoVisualizer.h"
+#include "ApuTap.h"
+#include "gme/Classic_Emu.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <system_error>
+
+namespace {
+
+constexpr size_t WRITE_BUFFER_BYTES = 256 * 1024;
+constexpr long RENDER_CHUNK_FRAMES = 4096;
+
+void putLE16(uint8_t* p, uint32_t v) {
+    p[0] = static_cast<uint8_t>(v);
+    p[1] = static_cast<uint8_t>(v >> 8);
+}
+
+void putLE32(uint8_t* p, uint32_t v) {
+    putLE16(p, v);
+    putLE16(p + 2, v >> 16);
+}
+
+// Unbuffered FILE plus our own large write buffer, shared by both formats
+class BufferedFile {
+public:
+    ~BufferedFile() { close(); }
+
+    bool open(const std::string& path) {
+        file_ = fopen(path.c_str(), "wb");
+        if (!file_) return false;
+        setvbuf(file_, nullptr, _IONBF, 0);
+        buffer_.clear();
+        buffer_.reserve(WRITE_BUFFER_BYTES);
+        ok_ = true;
+        return true;
+    }
+
+    void write(const uint8_t* data, size_t size) {
+        if (buffer_.size() + size > WRITE_BUFFER_BYTES) flush();
+        if (size >= WRITE_BUFFER_BYTES) {
+            ok_ = ok_ && fwrite(data, 1, size, file_) == size;
+            return;
+        }
+        buffer_.insert(buffer_.end(), data, data + size);
+    }
+
+    void flush() {
+        if (!buffer_.empty()) {
+            ok_ = ok_ && fwrite(buffer_.data(), 1, buffer_.size(), file_) == buffer_.size();
+            buffer_.clear();
+        }
+    }
+
+    // Overwrite already written bytes (header fields known only at the end)
+    void patch(long offset, const uint8_t* data, size_t size) {
+        flush();
+        ok_ = ok_ && fseek(file_, offset, SEEK_SET) == 0 && fwrite(data, 1, size, file_) == size;
+        fseek(file_, 0, SEEK_END);
+    }
+
+    bool close() {
+        if (!file_) return false;
+        flush();
+        bool ok = ok_ && fclose(file_) == 0;
+        file_ = nullptr;
+        return ok;
+    }
+
+    bool isOpen() const { return file_ != nullptr; }
+    bool ok() const { return ok_; }
+
+private:
+    FILE* file_ = nullptr;
+    std::vector<uint8_t> buffer_;
+    bool ok_ = false;
+};
+
+// RIFF WAVE, 16-bit PCM
+class WavWriter : public AudioFileWriter {
+public:
+    bool open(const std::string& path, long sample_rate, int channels) override {
+        if (!file_.open(path)) return false;
+        channels_ = channels;
+        sample_rate_ = sample_rate;
+        data_bytes_ = 0;
+        uint8_t header[HEADER_SIZE];
+        fillHeader(header);
+        file_.write(header, sizeof(header));
+        samples_.reserve(RENDER_CHUNK_FRAMES * 2 * channels);
+        return file_.ok();
+    }
+
+    bool write(const short* samples, long frames) override {
+        size_t count = static_cast<size_t>(frames) * channels_;
+        samples_.resize(count * 2);
+        for (size_t i = 0; i < count; ++i) {
+            putLE16(&samples_[i * 2], static_cast<uint16_t>(samples[i]));
+        }
+        file_.write(samples_.data(), samples_.size());
+        data_bytes_ += static_cast<uint32_t>(samples_.size());
+        return file_.ok();
+    }
+
+    bool close() override {
+        if (!file_.isOpen()) return false;
+        uint8_t header[HEADER_SIZE];
+        fillHeader(header);
+        file_.patch(0, header, sizeof(header));
+        return file_.close();
+    }
+
+private:
+    static constexpr int HEADER_SIZE = 44;
+
+    void fillHeader(uint8_t* h) const {
+        uint32_t block_align = static_cast<uint32_t>(channels_) * 2;
+        memcpy(h, "RIFF", 4);
+        putLE32(h + 4, 36 + data_bytes_);
+        memcpy(h + 8, "WAVEfmt ", 8);
+        putLE32(h + 16, 16);
+        putLE16(h + 20, 1);  // PCM
+        putLE16(h + 22, static_cast<uint32_t>(channels_));
+        putLE32(h + 24, static_cast<uint32_t>(sample_rate_));
+        putLE32(h + 28, static_cast<uint32_t>(sample_rate_) * block_align);
+        putLE16(h + 32, block_align);
+        putLE16(h + 34, 16);
+        memcpy(h + 36, "data", 4);
+        putLE32(h + 40, data_bytes_);
+    }
+
+    BufferedFile file_;
+    std::vector<uint8_t> samples_;
+    int channels_ = 2;
+    long sample_rate_ = 44100;
+    uint32_t data_bytes_ = 0;
+};
+
+// MSB-first bit packer for FLAC frames
+class BitWriter {
+public:
+    explicit BitWriter(std::vector<uint8_t>& out) : out_(out) {}
+
+    void put(uint32_t value, int bits) {
+        if (bits == 0) return;
+        uint64_t mask = (uint64_t(1) << bits) - 1;
+        acc_ = (acc_ << bits) | (value & mask);
+        count_ += bits;
+        while (count_ >= 8) {
+            count_ -= 8;
+            out_.push_back(static_cast<uint8_t>(acc_ >> count_));
+        }
+    }
+
+    void putSigned(int32_t value, int bits) { put(static_cast<uint32_t>(value), bits); }
+
+    // q zero bits followed by a one
+    void putUnary(uint32_t q) {
+        while (q >= 31) {
+            put(0, 31);
+            q -= 31;
+        }
+        put(1, static_cast<int>(q) + 1);
+    }
+
+    void align() {
+        if (count_ > 0) put(0, 8 - count_);
+    }
+
+private:
+    std::vector<uint8_t>& out_;
+    uint64_t acc_ = 0;
+    int count_ = 0;
+};
+
+uint8_t crc8(const uint8_t* data, size_t size) {
+    uint8_t crc = 0;
+    for (size_t i = 0; i < size; ++i) {
+        crc ^= data[i];
+        for (int b = 0; b < 8; ++b) {
+            crc = static_cast<uint8_t>((crc & 0x80) ? (crc << 1) ^ 0x07 : crc << 1);
+        }
+    }
+    return crc;
+}
+
+uint16_t crc16(const uint8_t* data, size_t size) {
+    uint16_t crc = 0;
+    for (size_t i = 0; i < size; ++i) {
+        crc ^= static_cast<uint16_t>(data[i] << 8);
+        for (int b = 0; b < 8; ++b) {
+            crc = static_cast<uint16_t>((crc & 0x8000) ? (crc << 1) ^ 0x8005 : crc << 1);
+        }
+    }
+    return crc;
+}
+
+// FLAC with fixed-blocksize frames, fixed polynomial predictors (order 0-4),
+// partitioned Rice residuals and stereo decorrelation. No LPC, so files come
+// out somewhat larger than the reference encoder's; NES audio is simple
+// enough that the fixed predictors get most of the way. MD5 is left unset.
+class FlacWriter : public AudioFileWriter {
+public:
+    bool open(const std::string& path, long sample_rate, int channels) override {
+        if (channels < 1 || channels > 2 || !file_.open(path)) return false;
+        channels_ = channels;
+        sample_rate_ = sample_rate;
+        total_frames_ = 0;
+        frame_number_ = 0;
+        min_frame_bytes_ = 0xFFFFFF;
+        max_frame_bytes_ = 0;
+        pending_.clear();
+        pending_.reserve(BLOCK_SIZE * channels);
+
+        uint8_t header[4 + 4 + STREAMINFO_SIZE];
+        memcpy(header, "fLaC", 4);
+        header[4] = 0x80;  // last metadata block, STREAMINFO
+        header[5] = 0;
+        header[6] = 0;
+        header[7] = STREAMINFO_SIZE;
+        fillStreamInfo(header + 8);
+        file_.write(header, sizeof(header));
+        return file_.ok();
+    }
+
+    bool write(const short* samples, long frames) override {
+        size_t count = static_cast<size_t>(frames) * channels_;
+        size_t block = static_cast<size_t>(BLOCK_SIZE) * channels_;
+        for (size_t i = 0; i < count;) {
+            size_t take = std::min(block - pending_.size(), count - i);
+            pending_.insert(pending_.end(), samples + i, samples + i + take);
+            i += take;
+            if (pending_.size() == block) encodePending();
+        }
+        return file_.ok();
+    }
+
+    bool close() override {
+        if (!file_.isOpen()) return false;
+        if (!pending_.empty()) encodePending();
+        if (max_frame_bytes_ == 0) min_frame_bytes_ = 0;
+        uint8_t info[STREAMINFO_SIZE];
+        fillStreamInfo(info);
+        file_.patch(8, info, sizeof(info));
+        return file_.close();
+    }
+
+private:
+    static constexpr int BLOCK_SIZE = 4096;
+    static constexpr int STREAMINFO_SIZE = 34;
+    static constexpr int MAX_ORDER = 4;
+    static constexpr int MAX_PARTITION_ORDER = 8;
+    static constexpr int MAX_RICE_PARAM = 14;  // 15 is the escape code
+
+    enum : uint32_t { LEFT_RIGHT = 1, LEFT_SIDE = 8, RIGHT_SIDE = 9, MID_SIDE = 10 };
+
+    struct Subframe {
+        enum Type { CONSTANT, VERBATIM, FIXED } type = VERBATIM;
+        int order = 0;
+        int partition_order = 0;
+        uint8_t params[1 << MAX_PARTITION_ORDER] = {};
+        uint64_t bits = 0;
+    };
+
+    void fillStreamInfo(uint8_t* p) const {
+        std::vector<uint8_t> bytes;
+        BitWriter bits(bytes);
+        bits.put(BLOCK_SIZE, 16);
+        bits.put(BLOCK_SIZE, 16);
+        bits.put(min_frame_bytes_, 24);
+        bits.put(max_frame_bytes_, 24);
+        bits.put(static_cast<uint32_t>(sample_rate_), 20);
+        bits.put(static_cast<uint32_t>(channels_ - 1), 3);
+        bits.put(16 - 1, 5);
+        bits.put(static_cast<uint32_t>(total_frames_ >> 32), 4);
+        bits.put(static_cast<uint32_t>(total_frames_), 32);
+        for (int i = 0; i < 4; ++i) bits.put(0, 32);  // MD5 unset
+        memcpy(p, bytes.data(), STREAMINFO_SIZE);
+    }
+
+    // Residual of the order-n fixed predictor for samples[order..n)
+    static void fixedResidual(const int32_t* x, int n, int order, int32_t* out) {
+        for (int i = order; i < n; ++i) {
+            switch (order) {
+                case 0: out[i] = x[i]; break;
+                case 1: out[i] = x[i] - x[i - 1]; break;
+                case 2: out[i] = x[i] - 2 * x[i - 1] + x[i - 2]; break;
+                case 3: out[i] = x[i] - 3 * x[i - 1] + 3 * x[i - 2] - x[i - 3]; break;
+                default: out[i] = x[i] - 4 * x[i - 1] + 6 * x[i - 2] - 4 * x[i - 3] + x[i - 4]; break;
+            }
+        }
+    }
+
+    static uint32_t zigzag(int32_t v) {
+        return (static_cast<uint32_t>(v) << 1) ^ static_cast<uint32_t>(v >> 31);
+    }
+
+    // Cheapest Rice parameter for a partition from the sum of its folded residuals
+    static int riceParam(uint64_t sum, int count, uint64_t& bits) {
+        int best = 0;
+        bits = UINT64_MAX;
+        for (int k = 0; k <= MAX_RICE_PARAM; ++k) {
+            uint64_t cost = static_cast<uint64_t>(count) * (k + 1) + (sum >> k);
+            if (cost < bits) {
+                bits = cost;
+                best = k;
+            }
+        }
+        return best;
+    }
+
+    // Choose the smallest subframe encoding for one channel
+    Subframe plan(const int32_t* x, int n, int bps) {
+        Subframe best;
+        best.type = Subframe::VERBATIM;
+        best.bits = static_cast<uint64_t>(n) * bps;
+
+        if (std::all_of(x, x + n, [x](int32_t v) { return v == x[0]; })) {
+            best.type = Subframe::CONSTANT;
+            best.bits = bps;
+            return best;
+        }
+
+        residual_.resize(n);
+        sums_.resize(1 << MAX_PARTITION_ORDER);
+        for (int order = 0; order <= MAX_ORDER && order < n; ++order) {
+            fixedResidual(x, n, order, residual_.data());
+
+            int max_p = 0;
+            while (max_p < MAX_PARTITION_ORDER && (n % (2 << max_p)) == 0 && (n >> (max_p + 1)) > order) {
+                ++max_p;
+            }
+
+            // Sums at the finest partitioning, merged pairwise for coarser ones
+            int parts = 1 << max_p;
+            int part_size = n >> max_p;
+            for (int p = 0; p < parts; ++p) {
+                uint64_t sum = 0;
+                for (int i = std::max(p * part_size, order); i < (p + 1) * part_size; ++i) {
+                    sum += zigzag(residual_[i]);
+                }
+                sums_[p] = sum;
+            }
+
+            for (int p = max_p; p >= 0; --p) {
+                int count = 1 << p;
+                int size = n >> p;
+                Subframe candidate;
+                candidate.type = Subframe::FIXED;
+                candidate.order = order;
+                candidate.partition_order = p;
+                candidate.bits = static_cast<uint64_t>(order) * bps + 2 + 4;
+                for (int i = 0; i < count; ++i) {
+                    uint64_t bits = 0;
+                    int samples = size - (i == 0 ? order : 0);
+                    candidate.params[i] = static_cast<uint8_t>(riceParam(sums_[i], samples, bits));
+                    candidate.bits += 4 + bits;
+                }
+                if (candidate.bits < best.bits) best = candidate;
+                for (int i = 0; i < count / 2; ++i) sums_[i] = sums_[2 * i] + sums_[2 * i + 1];
+            }
+        }
+        return best;
+    }
+
+    void writeSubframe(BitWriter& bits, const Subframe& sub, const int32_t* x, int n, int bps) {
+        bits.put(0, 1);  // padding
+        switch (sub.type) {
+            case Subframe::CONSTANT:
+                bits.put(0x00, 6);
+                bits.put(0, 1);
+                bits.putSigned(x[0], bps);
+                return;
+            case Subframe::VERBATIM:
+                bits.put(0x01, 6);
+                bits.put(0, 1);
+                for (int i = 0; i < n; ++i) bits.putSigned(x[i], bps);
+                return;
+            case Subframe::FIXED:
+                break;
+        }
+
+        bits.put(0x08 | sub.order, 6);
+        bits.put(0, 1);
+        for (int i = 0; i < sub.order; ++i) bits.putSigned(x[i], bps);
+
+        residual_.resize(n);
+        fixedResidual(x, n, sub.order, residual_.data());
+        bits.put(0, 2);  // Rice, 4-bit parameters
+        bits.put(static_cast<uint32_t>(sub.partition_order), 4);
+        int count = 1 << sub.partition_order;
+        int size = n >> sub.partition_order;
+        for (int p = 0; p < count; ++p) {
+            int k = sub.params[p];
+            bits.put(static_cast<uint32_t>(k), 4);
+            for (int i = std::max(p * size, sub.order); i < (p + 1) * size; ++i) {
+                uint32_t u = zigzag(residual_[i]);
+                bits.putUnary(u >> k);
+                bits.put(u, k);
+            }
+        }
+    }
+
+    // Frame number as FLAC's extended UTF-8 style code
+    static void putCodedNumber(BitWriter& bits, uint64_t v) {
+        if (v < 0x80) {
+            bits.put(static_cast<uint32_t>(v), 8);
+            return;
+        }
+        int extra = 1;
+        while (extra < 6 && v >= (uint64_t(1) << (6 + 5 * extra))) ++extra;
+        int lead_bits = 6 - extra;  // payload bits in the first byte
+        uint32_t lead_mask = (0xFF00u >> (extra + 1)) & 0xFF;
+        bits.put(lead_mask | (static_cast<uint32_t>(v >> (6 * extra)) & ((1u << lead_bits) - 1)), 8);
+        for (int i = extra - 1; i >= 0; --i) {
+            bits.put(0x80 | (static_cast<uint32_t>(v >> (6 * i)) & 0x3F), 8);
+        }
+    }
+
+    void encodePending() {
+        int n = static_cast<int>(pending_.size() / channels_);
+        for (int c = 0; c < 4; ++c) channel_[c].resize(n);
+        for (int i = 0; i < n; ++i) {
+            channel_[0][i] = pending_[i * channels_];
+            channel_[1][i] = pending_[i * channels_ + channels_ - 1];
+        }
+
+        // Pick the cheapest of left/right, left/side, side/right and mid/side
+        uint32_t assignment = static_cast<uint32_t>(channels_ - 1);  // independent
+        Subframe subs[2];
+        const int32_t* signals[2] = {channel_[0].data(), channel_[1].data()};
+        int bps[2] = {16, 16};
+        subs[0] = plan(signals[0], n, 16);
+        if (channels_ == 2) {
+            for (int i = 0; i < n; ++i) {
+                int32_t l = channel_[0][i];
+                int32_t r = channel_[1][i];
+                channel_[2][i] = (l + r) >> 1;
+                channel_[3][i] = l - r;
+            }
+            Subframe left = subs[0];
+            Subframe right = plan(channel_[1].data(), n, 16);
+            Subframe mid = plan(channel_[2].data(), n, 16);
+            Subframe side = plan(channel_[3].data(), n, 17);
+            uint64_t costs[4] = {
+                left.bits + right.bits, left.bits + side.bits, side.bits + right.bits, mid.bits + side.bits
+            };
+            int choice = static_cast<int>(std::min_element(costs, costs + 4) - costs);
+            switch (choice) {
+                case 0:
+                    assignment = LEFT_RIGHT;
+                    subs[1] = right;
+                    signals[1] = channel_[1].data();
+                    break;
+                case 1:
+                    assignment = LEFT_SIDE;
+                    subs[1] = side;
+                    signals[1] = channel_[3].data();
+                    bps[1] = 17;
+                    break;
+                case 2:
+                    assignment = RIGHT_SIDE;
+                    subs[0] = side;
+                    signals[0] = channel_[3].data();
+                    bps[0] = 17;
+                    subs[1] = right;
+                    signals[1] = channel_[1].data();
+                    break;
+                default:
+                    assignment = MID_SIDE;
+                    subs[0] = mid;
+                    signals[0] = channel_[2].data();
+                    subs[1] = side;
+                    signals[1] = channel_[3].data();
+                    bps[1] = 17;
+                    break;
+            }
+        }
+
+        frame_.clear();
+        BitWriter bits(frame_);
+        bits.put(0x3FFE, 14);
+        bits.put(0, 1);  // reserved
+        bits.put(0, 1);  // fixed blocksize
+        bool full = n == BLOCK_SIZE;
+        bits.put(full ? 12 : 7, 4);  // 12: 4096, 7: 16-bit size follows
+        bits.put(0, 4);              // sample rate from STREAMINFO
+        bits.put(assignment, 4);
+        bits.put(4, 3);              // 16 bits per sample
+        bits.put(0, 1);
+        putCodedNumber(bits, frame_number_);
+        if (!full) bits.put(static_cast<uint32_t>(n - 1), 16);
+        frame_.push_back(crc8(frame_.data(), frame_.size()));
+
+        for (int c = 0; c < channels_; ++c) {
+            writeSubframe(bits, subs[c], signals[c], n, bps[c]);
+        }
+        bits.align();
+        uint16_t crc = crc16(frame_.data(), frame_.size());
+        frame_.push_back(static_cast<uint8_t>(crc >> 8));
+        frame_.push_back(static_cast<uint8_t>(crc));
+
+        file_.write(frame_.data(), frame_.size());
+        uint32_t size = static_cast<uint32_t>(frame_.size());
+        min_frame_bytes_ = std::min(min_frame_bytes_, size);
+        max_frame_bytes_ = std::max(max_frame_bytes_, size);
+        total_frames_ += static_cast<uint64_t>(n);
+        ++frame_number_;
+        pending_.clear();
+    }
+
+    BufferedFile file_;
+    int channels_ = 2;
+    long sample_rate_ = 44100;
+    uint64_t total_frames_ = 0;
+    uint64_t frame_number_ = 0;
+    uint32_t min_frame_bytes_ = 0;
+    uint32_t max_frame_bytes_ = 0;
+    std::vector<short> pending_;
+    std::vector<int32_t> channel_[4];  // left, right, mid, side
+    std::vector<int32_t> residual_;
+    std::vector<uint64_t> sums_;
+    std::vector<uint8_t> frame_;
+};
+
+// Text usable in a file name on every platform
+std::string sanitize(const char* text) {
+    std::string out;
+    for (const char* c = text; *c; ++c) {
+        unsigned char ch = static_cast<unsigned char>(*c);
+        out += (ch < 0x20 || strchr("<>:\"/\\|?*", ch)) ? '_' : *c;
+    }
+    while (!out.empty() && (out.back() == ' ' || out.back() == '.')) out.pop_back();
+    return out;
+}
+
+// gme's fade curve: halves every fade_msec / 8, ending near -48 dB
+float fadeGain(long frame, long fade_start, long fade_frames) {
+    if (frame < fade_start) return 1.0f;
+    return std::exp2(-8.0f * static_cast<float>(frame - fade_start) / static_cast<float>(fade_frames));
+}
+
+} // namespace
+
+std::unique_ptr<AudioFileWriter> AudioFileWriter::create(ExportFormat format) {
+    if (format == ExportFormat::FLAC) return std::make_unique<FlacWriter>();
+    return std::make_unique<WavWriter>();
+}
+
+const char* AudioFileWriter::extension(ExportFormat format) {
+    return format == ExportFormat::FLAC ? "flac" : "wav";
+}
+
+std::string AlbumExporter::trackFileBase(int track, const char* song) {
+    char prefix[16];
+    snprintf(prefix, sizeof(prefix), "%02d", track + 1);
+    std::string name = prefix;
+    std::string title = sanitize(song);
+    if (!title.empty()) name += " - " + title;
+    return name;
+}
+
+bool AlbumExporter::parseTrackList(const char* text, int track_count, std::vector<int>& tracks) {
+    tracks.clear();
+    const char* p = text;
+    while (*p) {
+        char* end = nullptr;
+        long first = std::strtol(p, &end, 10);
+        if (end == p) return false;
+        long last = first;
+        p = end;
+        if (*p == '-') {
+            last = std::strtol(p + 1, &end, 10);
+            if (end == p + 1) return false;
+            p = end;
+        }
+        if (first < 1 || last < first || last > track_count) return false;
+        for (long track = first; track <= last; ++track) tracks.push_back(static_cast<int>(track - 1));
+        if (*p == ',') ++p;
+        else if (*p) return false;
+    }
+    return !tracks.empty();
+}
+
+long AlbumExporter::playLength(long length, long intro_length, long loop_length) {
+    if (length > 0) return length;
+    if (loop_length > 0) return std::max(intro_length, 0L) + loop_length * 2;
+    return 150000;
+}
+
+bool AlbumExporter::start(JobSystem& jobs, std::shared_ptr<const MappedFile> file_data, std::vector<int> tracks,
+                          const std::string& out_dir, ExportFormat format, ExportContent content, long sample_rate) {
+    cancel();
+    if (!file_data || !file_data->isOpen() || tracks.empty()) return false;
+
+    track_count_ = static_cast<int>(tracks.size());
+    track_progress_ = std::make_unique<std::atomic<float>[]>(track_count_);
+    for (int i = 0; i < track_count_; ++i) track_progress_[i].store(0.0f);
+    done_count_.store(0);
+    failed_count_.store(0);
+    out_dir_ = out_dir;
+    format_ = format;
+    content_ = content;
+    sample_rate_ = sample_rate;
+    {
+        std::lock_guard<std::mutex> lock(error_mutex_);
+        first_error_.clear();
+    }
+
+    for (int slot = 0; slot < track_count_; ++slot) {
+        int track = tracks[slot];
+        jobs_.push_back(jobs.submit([this, file_data, slot, track](const Job& job) {
+            renderTrack(*file_data, slot, track, job);
+        }, JobPriority::BATCH, "Export"));
+    }
+    return true;
+}
+
+void AlbumExporter::cancel() {
+    for (auto& job : jobs_) {
+        job->cancel();
+    }
+    for (auto& job : jobs_) {
+        job->wait();
+    }
+    jobs_.clear();
+}
+
+bool AlbumExporter::isRunning() const {
+    for (const auto& job : jobs_) {
+        if (!job->isDone()) return true;
+    }
+    return false;
+}
+
+float AlbumExporter::progress() const {
+    if (track_count_ <= 0) return 0.0f;
+    float sum = 0.0f;
+    for (int i = 0; i < track_count_; ++i) sum += track_progress_[i].load();
+    return sum / track_count_;
+}
+
+std::string AlbumExporter::firstError() const {
+    std::lock_guard<std::mutex> lock(error_mutex_);
+    return first_error_;
+}
+
+// The status line sums the tracks, the jobs window shows each one
+void AlbumExporter::setProgress(const Job& job, int slot, float progress) {
+    track_progress_[slot].store(progress);
+    job.setProgress(progress);
+}
+
+void AlbumExporter::fail(const std::string& message) {
+    failed_count_.fetch_add(1);
+    std::lock_guard<std::mutex> lock(error_mutex_);
+    if (first_error_.empty()) first_error_ = message;
+}
+
+// Export worker: one emulator per job, sharing the same mapped file
+void AlbumExporter::renderTrack(const MappedFile& file, int slot, int track, const Job& job) {
+    if (content_ != ExportContent::MIX) {
+        bool ok = content_ == ExportContent::STEMS ? renderStems(file, slot, track, job)
+                                                   : renderMidi(file, slot, track, job);
+        if (ok) done_count_.fetch_add(1);
+        return;
+    }
+
+    Music_Emu* emu = nullptr;
+    if (gme_open_data(file.data(), static_cast<long>(file.size()), &emu, sample_rate_) || !emu) {
+        fail("Failed to open file for export");
+        return;
+    }
+
+    track_info_t info;
+    long length = 150000;
+    const char* song = "";
+    if (gme_track_info(emu, &info, track) == nullptr) {
+        length = playLength(info.length, info.intro_length, info.loop_length);
+        song = info.song;
+    }
+
+    std::string name = trackFileBase(track, song) + "." + AudioFileWriter::extension(format_);
+    std::string path = (std::filesystem::path(out_dir_) / name).string();
+    std::unique_ptr<AudioFileWriter> writer = AudioFileWriter::create(format_);
+    if (gme_start_track(emu, track) || !writer->open(path, sample_rate_, 2)) {
+        gme_delete(emu);
+        fail("Failed to write " + path);
+        return;
+    }
+    gme_set_fade(emu, length);
+
+    // Silence detection can still end the track early; progress is against the full length
+    const long total_frames = (length + FADE_MSEC) * sample_rate_ / 1000;
+    std::vector<short> buffer(RENDER_CHUNK_FRAMES * 2);
+    long rendered = 0;
+    bool ok = true;
+    while (ok && rendered < total_frames && !gme_track_ended(emu)) {
+        if (job.isCancelled()) {
+            ok = false;
+            break;
+        }
+        long frames = std::min(RENDER_CHUNK_FRAMES, total_frames - rendered);
+        ok = gme_play(emu, frames * 2, buffer.data()) == nullptr && writer->write(buffer.data(), frames);
+        rendered += frames;
+        setProgress(job, slot, static_cast<float>(rendered) / total_frames);
+    }
+    gme_delete(emu);
+
+    ok = writer->close() && ok;
+    if (!ok) {
+        std::error_code ec;
+        std::filesystem::remove(path, ec);
+        if (!job.isCancelled()) fail("Failed to write " + path);
+        return;
+    }
+    setProgress(job, slot, 1.0f);
+    done_count_.fetch_add(1);
+}
+
+// One pass over the track with every voice on its own Blip_Buffer; the voice
+// tap hands each buffer's samples to that voice's writer. Silence detection is
+// off and the fade is applied per stem, so the stems stay sample-aligned and
+// sum to the mix.
+bool AlbumExporter::renderStems(const MappedFile& file, int slot, int track, const Job& job) {
+    gme_type_t type = file.size() >= 4 ? gme_identify_extension(gme_identify_header(file.data())) : nullptr;
+    Music_Emu* emu = type ? type->new_emu() : nullptr;
+    Classic_Emu* classic = dynamic_cast<Classic_Emu*>(emu);
+    if (!classic) {
+        if (emu) gme_delete(emu);
+        fail("Stems are not supported for this file type");
+        return false;
+    }
+
+    // The buffer has to be in place before the sample rate is set, and outlives emu
+    VoiceScopeBuffer voice_buffer;
+    classic->set_buffer(&voice_buffer);
+    if (emu->set_sample_rate(sample_rate_) ||
+        gme_load_data(emu, file.data(), static_cast<long>(file.size()))) {
+        gme_delete(emu);
+        fail("Failed to open file for export");
+        return false;
+    }
+
+    track_info_t info;
+    long length = 150000;
+    const char* song = "";
+    if (gme_track_info(emu, &info, track) == nullptr) {
+        length = playLength(info.length, info.intro_length, info.loop_length);
+        song = info.song;
+    }
+    const long fade_start = length * sample_rate_ / 1000;
+    const long fade_frames = FADE_MSEC * sample_rate_ / 1000;
+    const long total_frames = fade_start + fade_frames;
+
+    // gme's own fade and silence detection (which renders ahead) work on the
+    // mix, which is discarded
+    gme_ignore_silence(emu, 1);
+    if (gme_start_track(emu, track)) {
+        gme_delete(emu);
+        fail("Failed to start track " + std::to_string(track + 1));
+        return false;
+    }
+    gme_set_fade(emu, length + FADE_MSEC + 1000);
+
+    std::string base = trackFileBase(track, song);
+    int voice_count = std::min(gme_voice_count(emu), VoiceScopeBuffer::MAX_VOICES);
+    const char* const* voice_names = gme_voice_names(emu);
+    std::vector<std::unique_ptr<AudioFileWriter>> writers;
+    std::vector<std::string> paths;
+    bool ok = true;
+    for (int v = 0; v < voice_count && ok; ++v) {
+        char prefix[16];
+        snprintf(prefix, sizeof(prefix), " - %d ", v + 1);
+        std::string name = base + prefix + sanitize(voice_names[v]) + "." + AudioFileWriter::extension(format_);
+        paths.push_back((std::filesystem::path(out_dir_) / name).string());
+        writers.push_back(AudioFileWriter::create(format_));
+        ok = writers.back()->open(paths.back(), sample_rate_, 1);
+        if (!ok) fail("Failed to write " + paths.back());
+    }
+
+    std::vector<long> voice_pos(voice_count, 0);
+    std::vector<blip_sample_t> faded;
+    voice_buffer.setVoiceTap([&](int voice, const blip_sample_t* samples, long count) {
+        if (voice >= voice_count || !ok) return;
+        long pos = voice_pos[voice];
+        voice_pos[voice] += count;
+        if (pos + count > fade_start) {
+            faded.assign(samples, samples + count);
+            for (long i = 0; i < count; ++i) {
+                faded[i] = static_cast<blip_sample_t>(faded[i] * fadeGain(pos + i, fade_start, fade_frames));
+            }
+            samples = faded.data();
+        }
+        ok = writers[voice]->write(samples, count);
+    });
+
+    std::vector<short> buffer(RENDER_CHUNK_FRAMES * 2);
+    long rendered = 0;
+    bool failed = !ok;
+    while (ok && rendered < total_frames && !gme_track_ended(emu)) {
+        if (job.isCancelled()) {
+            ok = false;
+            break;
+        }
+        long frames = std::min(RENDER_CHUNK_FRAMES, total_frames - rendered);
+        ok = gme_play(emu, frames * 2, buffer.data()) == nullptr && ok;
+        rendered += frames;
+        setProgress(job, slot, static_cast<float>(rendered) / total_frames);
+    }
+    gme_delete(emu);
+
+    for (auto& writer : writers) {
+        ok = writer->close() && ok;
+    }
+    if (!ok) {
+        for (const std::string& path : paths) {
+            std::error_code ec;
+            std::filesystem::remove(path, ec);
+        }
+        if (!failed && !job.isCancelled()) fail("Failed to write stems for track " + std::to_string(track + 1));
+        return false;
+    }
+    setProgress(job, slot, 1.0f);
+    return true;
+}
+
+// Same note extraction as the piano roll's preprocessing (the NSF register
+// trace), with every finished note going straight to the MIDI writer
+bool AlbumExporter::renderMidi(const MappedFile& file, int slot, int track, const Job& job) {
+    Music_Emu* emu = nullptr;
+    if (gme_open_data(file.data(), static_cast<long>(file.size()), &emu, sample_rate_) || !emu) {
+        fail("Failed to open file for export");
+        return false;
+    }
+    Nsf_Emu* nsf = dynamic_cast<Nsf_Emu*>(emu);
+    if (!nsf) {
+        gme_delete(emu);
+        fail("MIDI export needs an NSF file");
+        return false;
+    }
+
+    track_info_t info;
+    const char* song = "";
+    if (gme_track_info(emu, &info, track) == nullptr) song = info.song;
+
+    std::string path = (std::filesystem::path(out_dir_) / (trackFileBase(track, song) + ".mid")).string();
+    MidiFileWriter midi;
+    if (!midi.open(path, ChannelLayout::build(ApuTap::resolve(nsf).chips()), song)) {
+        gme_delete(emu);
+        fail("Failed to write " + path);
+        return false;
+    }
+
+    PianoVisualizer extractor;
+    extractor.setIncrementalPreprocessing(false);
+    extractor.setNoteSink([&midi](const PianoRollNote& note) { midi.addNote(note); });
+    bool ok = extractor.preprocessNsfTrace(
+        nsf, track,
+        [this, slot, &job](float progress) { setProgress(job, slot, progress); },
+        [&job]() { return job.isCancelled(); });
+    gme_delete(emu);
+
+    ok = midi.close() && ok;
+    if (!ok) {
+        std::error_code ec;
+        std::filesystem::remove(path, ec);
+        if (!job.isCancelled()) fail("Failed to write " + path);
+        return false;
+    }
+    setProgress(job, slot, 1.0f);
+    return true;
+}
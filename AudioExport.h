@@ -0,0 +1,95 @@
+#pragma once
+
+#include "JobSystem.h"
+#include "MappedFile.h"
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+enum class ExportFormat {
+    WAV,
+    FLAC
+};
+
+// What a track job writes: the mixed track, one mono stem per voice, or the
+// piano-roll notes as a MIDI file
+enum class ExportContent {
+    MIX,
+    STEMS,
+    MIDI
+};
+
+// Streaming writer for interleaved 16-bit PCM. Samples go through a large
+// write buffer; close() flushes it and patches the sizes into the header.
+class AudioFileWriter {
+public:
+    virtual ~AudioFileWriter() = default;
+
+    virtual bool open(const std::string& path, long sample_rate, int channels) = 0;
+    virtual bool write(const short* samples, long frames) = 0;
+    virtual bool close() = 0;
+
+    static std::unique_ptr<AudioFileWriter> create(ExportFormat format);
+    static const char* extension(ExportFormat format);  // without the dot
+};
+
+// Renders tracks of a music file to audio files, one job (and one emulator
+// opened from the shared file bytes) per track, so an album renders on all
+// workers at once. Stems come out of the same single pass per track: the
+// emulator mixes through a VoiceScopeBuffer and every voice's Blip_Buffer is
+// written to its own file. MIDI runs the note preprocessing pass and streams
+// its notes into a MidiFileWriter. Lengths and fades follow gme_track_info. Owned and
+// polled by the UI thread; the jobs only touch their own progress slot.
+class AlbumExporter {
+public:
+    ~AlbumExporter() { cancel(); }
+
+    // Queue the given tracks into out_dir; false if nothing could be queued
+    bool start(JobSystem& jobs, std::shared_ptr<const MappedFile> file_data, std::vector<int> tracks,
+               const std::string& out_dir, ExportFormat format, ExportContent content, long sample_rate);
+
+    // Stop all jobs and wait for them; partly written files are removed
+    void cancel();
+
+    bool isRunning() const;
+    float progress() const;  // 0-1 over the whole album
+    int trackCount() const { return track_count_; }
+    int tracksDone() const { return done_count_.load(); }
+    int tracksFailed() const { return failed_count_.load(); }
+    const std::string& outputDirectory() const { return out_dir_; }
+    std::string firstError() const;
+
+    // Milliseconds rendered for a track: the known length, intro plus two
+    // loops, or 2:30, followed by the fade
+    static long playLength(long length, long intro_length, long loop_length);
+    static constexpr long FADE_MSEC = 8000;
+
+    // "NN - Title", the track part of every exported file name
+    static std::string trackFileBase(int track, const char* song);
+
+    // Zero-based tracks of a 1-based list like "1-3,7"; false if it doesn't
+    // parse or names a track past track_count
+    static bool parseTrackList(const char* text, int track_count, std::vector<int>& tracks);
+
+private:
+    void renderTrack(const MappedFile& file, int slot, int track, const Job& job);
+    bool renderStems(const MappedFile& file, int slot, int track, const Job& job);
+    bool renderMidi(const MappedFile& file, int slot, int track, const Job& job);
+    void setProgress(const Job& job, int slot, float progress);
+    void fail(const std::string& message);
+
+    std::vector<JobHandle> jobs_;
+    std::unique_ptr<std::atomic<float>[]> track_progress_;
+    int track_count_ = 0;
+    std::atomic<int> done_count_{0};
+    std::atomic<int> failed_count_{0};
+    std::string out_dir_;
+    ExportFormat format_ = ExportFormat::WAV;
+    ExportContent content_ = ExportContent::MIX;
+    long sample_rate_ = 44100;
+
+    mutable std::mutex error_mutex_;
+    std::string first_error_;
+};
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <atomic>
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+
+// Lock-free single-producer / single-consumer ring of interleaved sample frames.
+// The synthesis (or emulation) thread is the only writer and the audio callback
+// the only reader, so neither side ever blocks the other.
+template <typename Sample>
+class BasicAudioRing {
+public:
+    // capacity_frames is rounded up to a power of two
+    void init(int capacity_frames, int num_channels) {
+        size_t cap = 1;
+        while (cap < static_cast<size_t>(capacity_frames)) cap <<= 1;
+        channels_ = num_channels;
+        capacity_ = cap;
+        mask_ = cap - 1;
+        data_.assign(cap * num_channels, Sample());
+        write_pos_.store(0, std::memory_order_relaxed);
+        read_pos_.store(0, std::memory_order_relaxed);
+    }
+
+    int capacity() const { return static_cast<int>(capacity_); }
+    int channels() const { return channels_; }
+
+    // Frames ready to be read (safe from either side)
+    int available() const {
+        uint64_t w = write_pos_.load(std::memory_order_acquire);
+        uint64_t r = read_pos_.load(std::memory_order_acquire);
+        return static_cast<int>(w - r);
+    }
+
+    // Frames that can be written without overwriting unread data
+    int space() const { return capacity() - available(); }
+
+    // Producer: write up to num_frames, returns frames actually written
+    int write(const Sample* frames, int num_frames) {
+        uint64_t w = write_pos_.load(std::memory_order_relaxed);
+        uint64_t r = read_pos_.load(std::memory_order_acquire);
+        int count = std::min(num_frames, static_cast<int>(capacity_ - (w - r)));
+        copyIn(w, frames, count);
+        write_pos_.store(w + count, std::memory_order_release);
+        return count;
+    }
+
+    // Consumer: read up to num_frames, returns frames actually read
+    int read(Sample* frames, int num_frames) {
+        uint64_t r = read_pos_.load(std::memory_order_relaxed);
+        uint64_t w = write_pos_.load(std::memory_order_acquire);
+        int count = std::min(num_frames, static_cast<int>(w - r));
+        copyOut(r, frames, count);
+        read_pos_.store(r + count, std::memory_order_release);
+        return count;
+    }
+
+    // Monotonic write position; used to mark a flush point after a seek or track change
+    uint64_t writePosition() const { return write_pos_.load(std::memory_order_acquire); }
+
+    // Monotonic read position, for the consumer to tell stale frames from a flush point
+    uint64_t readPosition() const { return read_pos_.load(std::memory_order_acquire); }
+
+    // The sample storage, for pinning it in memory
+    const Sample* storage() const { return data_.data(); }
+    size_t storageBytes() const { return data_.size() * sizeof(Sample); }
+
+    // Consumer: drop everything written before 'position'
+    void discardUntil(uint64_t position) {
+        uint64_t r = read_pos_.load(std::memory_order_relaxed);
+        if (position > r) {
+            read_pos_.store(position, std::memory_order_release);
+        }
+    }
+
+private:
+    void copyIn(uint64_t pos, const Sample* src, int count) {
+        size_t start = static_cast<size_t>(pos & mask_);
+        size_t first = std::min(static_cast<size_t>(count), capacity_ - start);
+        memcpy(&data_[start * channels_], src, first * channels_ * sizeof(Sample));
+        memcpy(&data_[0], src + first * channels_, (count - first) * channels_ * sizeof(Sample));
+    }
+
+    void copyOut(uint64_t pos, Sample* dst, int count) {
+        size_t start = static_cast<size_t>(pos & mask_);
+        size_t first = std::min(static_cast<size_t>(count), capacity_ - start);
+        memcpy(dst, &data_[start * channels_], first * channels_ * sizeof(Sample));
+        memcpy(dst + first * channels_, &data_[0], (count - first) * channels_ * sizeof(Sample));
+    }
+
+    std::vector<Sample> data_;
+    size_t capacity_ = 0;
+    size_t mask_ = 0;
+    int channels_ = 2;
+
+    // Separate cache lines so producer and consumer don't false-share
+    alignas(64) std::atomic<uint64_t> write_pos_{0};
+    alignas(64) std::atomic<uint64_t> read_pos_{0};
+};
+
+// Interleaved float frames: NSF synthesis thread -> audio callback
+using AudioRing = BasicAudioRing<float>;
@@ -0,0 +1,160 @@
+#include "AudioTelemetry.h"
+#include "imgui.h"
+#include <algorithm>
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+#include <ctime>
+
+AudioTelemetry::AudioTelemetry() {
+    ring_.init(RING_CAPACITY, 1);
+}
+
+AudioTelemetry::~AudioTelemetry() {
+    stopCsv();
+}
+
+void AudioTelemetry::record(int requested, int delivered, int queued, long sample_rate) {
+    int64_t now = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+    float ms_per_frame = sample_rate > 0 ? 1000.0f / sample_rate : 0.0f;
+
+    AudioCallbackSample sample;
+    sample.time_ns = now;
+    sample.interval_ms = last_time_ns_ ? (now - last_time_ns_) / 1e6f : 0.0f;
+    sample.expected_ms = requested * ms_per_frame;
+    sample.requested = requested;
+    sample.delivered = delivered;
+    sample.queued = queued;
+    sample.queued_ms = queued * ms_per_frame;
+    last_time_ns_ = now;
+
+    if (ring_.write(&sample, 1) == 0) {
+        ring_dropped_.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void AudioTelemetry::update() {
+    AudioCallbackSample samples[256];
+    int n;
+    while ((n = ring_.read(samples, 256)) > 0) {
+        for (int i = 0; i < n; ++i) add(samples[i]);
+    }
+    if (csv_) std::fflush(csv_);
+}
+
+void AudioTelemetry::add(const AudioCallbackSample& sample) {
+    if (first_time_ns_ == 0) first_time_ns_ = sample.time_ns;
+
+    ++callbacks_;
+    if (sample.delivered == 0) {
+        ++underruns_;
+    } else if (sample.delivered < sample.requested) {
+        ++partial_fills_;
+    }
+    silence_frames_ += sample.requested - sample.delivered;
+    if (sample.interval_ms > 0.0f) {
+        jitter_max_ms_ = std::max(jitter_max_ms_, std::fabs(sample.interval_ms - sample.expected_ms));
+    }
+    queued_min_ms_ = queued_min_ms_ < 0.0f ? sample.queued_ms : std::min(queued_min_ms_, sample.queued_ms);
+
+    history_[history_pos_] = sample;
+    history_pos_ = (history_pos_ + 1) % HISTORY;
+    history_count_ = std::min(history_count_ + 1, HISTORY);
+
+    if (csv_) {
+        float jitter = sample.interval_ms > 0.0f ? sample.interval_ms - sample.expected_ms : 0.0f;
+        std::fprintf(csv_, "%.6f,%.3f,%.3f,%.3f,%d,%d,%d,%.3f\n",
+                     (sample.time_ns - first_time_ns_) / 1e9, sample.interval_ms, sample.expected_ms, jitter,
+                     sample.requested, sample.delivered, sample.queued, sample.queued_ms);
+    }
+}
+
+void AudioTelemetry::resetTotals() {
+    callbacks_ = underruns_ = partial_fills_ = silence_frames_ = 0;
+    jitter_max_ms_ = 0.0f;
+    queued_min_ms_ = -1.0f;
+    history_pos_ = history_count_ = 0;
+    ring_dropped_.store(0, std::memory_order_relaxed);
+}
+
+bool AudioTelemetry::startCsv(const std::string& path) {
+    stopCsv();
+    csv_ = std::fopen(path.c_str(), "w");
+    if (!csv_) return false;
+    csv_path_ = path;
+    std::fputs("time_s,interval_ms,expected_ms,jitter_ms,requested,delivered,queued_frames,queued_ms\n", csv_);
+    return true;
+}
+
+void AudioTelemetry::stopCsv() {
+    if (csv_) {
+        std::fclose(csv_);
+        csv_ = nullptr;
+    }
+}
+
+void AudioTelemetry::drawWindow(bool* p_open) {
+    ImGui::SetNextWindowSize(ImVec2(520, 330), ImGuiCond_FirstUseEver);
+    if (!ImGui::Begin("Audio Telemetry", p_open)) {
+        ImGui::End();
+        return;
+    }
+
+    ImGui::Text("Callbacks: %llu", static_cast<unsigned long long>(callbacks_));
+    ImGui::SameLine(180);
+    ImGui::TextColored(underruns_ ? ImVec4(1.0f, 0.35f, 0.35f, 1.0f) : ImVec4(0.4f, 0.9f, 0.4f, 1.0f),
+                       "Underruns: %llu", static_cast<unsigned long long>(underruns_));
+    ImGui::SameLine(340);
+    ImGui::TextColored(partial_fills_ ? ImVec4(1.0f, 0.8f, 0.3f, 1.0f) : ImVec4(0.4f, 0.9f, 0.4f, 1.0f),
+                       "Partial fills: %llu", static_cast<unsigned long long>(partial_fills_));
+    ImGui::Text("Silence filled: %llu frames", static_cast<unsigned long long>(silence_frames_));
+    ImGui::SameLine(340);
+    ImGui::Text("Jitter max: %.2f ms", jitter_max_ms_);
+    ImGui::Text("Queue min: %.1f ms", std::max(queued_min_ms_, 0.0f));
+    uint64_t dropped = ring_dropped_.load(std::memory_order_relaxed);
+    if (dropped) {
+        ImGui::SameLine(180);
+        ImGui::TextDisabled("(%llu samples dropped while the UI was stalled)", static_cast<unsigned long long>(dropped));
+    }
+
+    // Plots over the recent history, oldest first
+    struct Series {
+        const AudioTelemetry* self;
+        float (*field)(const AudioCallbackSample&);
+    };
+    auto getter = [](void* data, int idx) -> float {
+        const Series* series = static_cast<const Series*>(data);
+        const AudioTelemetry* t = series->self;
+        int start = t->history_count_ < HISTORY ? 0 : t->history_pos_;
+        return series->field(t->history_[(start + idx) % HISTORY]);
+    };
+    Series queue{this, [](const AudioCallbackSample& s) { return s.queued_ms; }};
+    Series jitter{this, [](const AudioCallbackSample& s) {
+        return s.interval_ms > 0.0f ? s.interval_ms - s.expected_ms : 0.0f;
+    }};
+    Series fill{this, [](const AudioCallbackSample& s) {
+        return s.requested > 0 ? 100.0f * s.delivered / s.requested : 100.0f;
+    }};
+    ImVec2 plot_size(-1, 50);
+    ImGui::PlotLines("##queue", getter, &queue, history_count_, 0, "queue ms", 0.0f, FLT_MAX, plot_size);
+    ImGui::PlotLines("##jitter", getter, &jitter, history_count_, 0, "jitter ms", FLT_MAX, FLT_MAX, plot_size);
+    ImGui::PlotLines("##fill", getter, &fill, history_count_, 0, "delivered %", 0.0f, 100.0f, plot_size);
+
+    if (ImGui::Button("Reset")) resetTotals();
+    ImGui::SameLine();
+    if (!recordingCsv()) {
+        if (ImGui::Button("Record CSV")) {
+            char name[64];
+            std::time_t now = std::time(nullptr);
+            std::strftime(name, sizeof(name), "audio_telemetry_%Y%m%d_%H%M%S.csv", std::localtime(&now));
+            startCsv(name);
+        }
+    } else {
+        if (ImGui::Button("Stop CSV")) stopCsv();
+        ImGui::SameLine();
+        ImGui::TextDisabled("Writing %s", csv_path_.c_str());
+    }
+
+    ImGui::End();
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include "AudioRing.h"
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+// One audio callback as the output side saw it
+struct AudioCallbackSample {
+    int64_t time_ns;        // steady_clock at entry
+    float interval_ms;      // since the previous live callback, 0 after a gap
+    float expected_ms;      // requested frames at the sample rate
+    int32_t requested;      // frames
+    int32_t delivered;      // frames the source had ready; the rest was silence
+    int32_t queued;         // frames waiting at entry
+    float queued_ms;
+};
+
+// Records every live audio callback (underruns, partial fills, callback
+// jitter and queue fill level) so buffer settings can be picked from data.
+// The audio thread pushes one sample per callback into a lock-free ring; the
+// main thread drains it each frame into totals, a rolling history for the
+// overlay and, while recording, a CSV file.
+class AudioTelemetry {
+public:
+    AudioTelemetry();
+    ~AudioTelemetry();
+
+    // Audio thread: a callback that played the source
+    void record(int requested, int delivered, int queued, long sample_rate);
+    // Audio thread: a callback with nothing to play (paused, track ended);
+    // the next live callback's interval is not measured across the gap
+    void markIdle() { last_time_ns_ = 0; }
+
+    // Main thread, once per frame
+    void update();
+    void resetTotals();
+
+    // CSV of every drained callback until stopCsv(); false if the file can't be opened
+    bool startCsv(const std::string& path);
+    void stopCsv();
+    bool recordingCsv() const { return csv_ != nullptr; }
+    const std::string& csvPath() const { return csv_path_; }
+
+    void drawWindow(bool* p_open);
+
+private:
+    static constexpr int RING_CAPACITY = 4096;  // ~40 s of 512-frame callbacks at 48 kHz
+    static constexpr int HISTORY = 2048;
+
+    void add(const AudioCallbackSample& sample);
+
+    BasicAudioRing<AudioCallbackSample> ring_;
+    int64_t last_time_ns_ = 0;              // audio thread only
+    std::atomic<uint64_t> ring_dropped_{0};
+
+    // Main thread
+    uint64_t callbacks_ = 0;
+    uint64_t underruns_ = 0;                // nothing delivered
+    uint64_t partial_fills_ = 0;            // some frames delivered, not all
+    uint64_t silence_frames_ = 0;
+    float jitter_max_ms_ = 0.0f;
+    float queued_min_ms_ = -1.0f;           // -1 until the first callback
+    int64_t first_time_ns_ = 0;
+
+    AudioCallbackSample history_[HISTORY] = {};
+    int history_pos_ = 0;
+    int history_count_ = 0;
+
+    FILE* csv_ = nullptr;
+    std::string csv_path_;
+};
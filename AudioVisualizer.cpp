@@ -1,266 +1,136 @@
 #include "AudioVisualizer.h"
+#include "GpuMemory.h"
+#include "Profiler.h"
+#include "sokol_app.h"
+#include "util/sokol_imgui.h"
 #include <algorithm>
 #include <cstring>
 
-#ifndef M_PI
-#define M_PI 3.14159265358979323846
-#endif
-
-// ============================================================================
-// SimpleFFT Implementation
-// ============================================================================
-
-void SimpleFFT::fft(std::vector<std::complex<float>>& data) {
-    const size_t n = data.size();
-    if (n <= 1) return;
-    
-    // Bit-reversal permutation
-    for (size_t i = 1, j = 0; i < n; ++i) {
-        size_t bit = n >> 1;
-        for (; j & bit; bit >>= 1) {
-            j ^= bit;
-        }
-        j ^= bit;
-        if (i < j) std::swap(data[i], data[j]);
-    }
-    
-    // Cooley-Tukey iterative FFT
-    for (size_t len = 2; len <= n; len <<= 1) {
-        float angle = -2.0f * static_cast<float>(M_PI) / static_cast<float>(len);
-        std::complex<float> wlen(std::cos(angle), std::sin(angle));
-        for (size_t i = 0; i < n; i += len) {
-            std::complex<float> w(1.0f, 0.0f);
-            for (size_t j = 0; j < len / 2; ++j) {
-                std::complex<float> u = data[i + j];
-                std::complex<float> v = data[i + j + len / 2] * w;
-                data[i + j] = u + v;
-                data[i + j + len / 2] = u - v;
-                w *= wlen;
-            }
-        }
-    }
-}
-
-void SimpleFFT::computeMagnitude(const std::vector<std::complex<float>>& fftData,
-                                  std::vector<float>& magnitudes, int numBins) {
-    magnitudes.resize(numBins);
-    const size_t fftSize = fftData.size();
-    const size_t usefulBins = fftSize / 2;
-    
-    // Map FFT bins to display bins (logarithmic scale for better visualization)
-    for (int i = 0; i < numBins; ++i) {
-        // Logarithmic frequency mapping
-        float t = static_cast<float>(i) / static_cast<float>(numBins);
-        float logScale = std::pow(t, 2.0f); // Quadratic for more bass detail
-        
-        size_t startBin = static_cast<size_t>(logScale * usefulBins);
-        size_t endBin = static_cast<size_t>(std::pow(static_cast<float>(i + 1) / numBins, 2.0f) * usefulBins);
-        
-        if (startBin >= usefulBins) startBin = usefulBins - 1;
-        if (endBin >= usefulBins) endBin = usefulBins;
-        if (endBin <= startBin) endBin = startBin + 1;
-        
-        float sum = 0.0f;
-        for (size_t j = startBin; j < endBin; ++j) {
-            float mag = std::abs(fftData[j]);
-            sum += mag;
-        }
-        
-        magnitudes[i] = sum / static_cast<float>(endBin - startBin);
-    }
-}
-
 // ============================================================================
 // AudioVisualizer Implementation
 // ============================================================================
 
-AudioVisualizer::AudioVisualizer()
-    : emu_(nullptr)
-    , sample_rate_(44100)
+AudioVisualizer::AudioVisualizer(AnalysisGraph& analysis)
+    : analysis_(analysis)
+    , emu_(nullptr)
     , mute_mask_(0)
     , is_initialized_(false)
     , waveform_zoom_(1.0f)
-    , spectrum_smoothing_(0.7f)
-    , spectrum_history_pos_(0)
     , peak_decay_rate_(0.95f)
-    , has_vrc6_(false)
 {
-    // Initialize buffers
-    waveform_buffer_.resize(WAVEFORM_SIZE, 0.0f);
-    waveform_buffer_left_.resize(WAVEFORM_SIZE, 0.0f);
-    waveform_buffer_right_.resize(WAVEFORM_SIZE, 0.0f);
-    fft_input_.resize(FFT_SIZE, 0.0f);
-    spectrum_data_.resize(SPECTRUM_BINS, 0.0f);
-    spectrum_peaks_.resize(SPECTRUM_BINS, 0.0f);
-    
-    // Initialize spectrum history for waterfall
-    spectrum_history_.resize(HISTORY_SIZE);
-    for (auto& row : spectrum_history_) {
-        row.resize(SPECTRUM_BINS, 0.0f);
-    }
+    subscription_ = analysis_.subscribe(AnalysisGraph::NODE_SCOPE | AnalysisGraph::NODE_SPECTRUM |
+                                        AnalysisGraph::NODE_LEVELS | AnalysisGraph::NODE_VOICES |
+                                        AnalysisGraph::NODE_LOUDNESS | AnalysisGraph::NODE_TEMPO);
     
     // Initialize channel data
     channel_amplitudes_.fill(0.0f);
-    channel_peaks_.fill(0.0f);
+    setChannelLayout(ChannelLayout::build(0));
 }
 
 AudioVisualizer::~AudioVisualizer() {
-    // Nothing special to clean up
+    analysis_.unsubscribe(subscription_);
 }
 
-bool AudioVisualizer::init(Music_Emu* emu, long sample_rate) {
-    std::lock_guard<std::mutex> lock(audio_mutex_);
-    
+bool AudioVisualizer::init(Music_Emu* emu) {
     emu_ = emu;
-    sample_rate_ = sample_rate;
     is_initialized_ = (emu != nullptr);
     
-    // Call internal reset without locking (we already hold the lock)
-    resetInternal();
+    reset();
     
     return is_initialized_;
 }
 
 void AudioVisualizer::reset() {
-    std::lock_guard<std::mutex> lock(audio_mutex_);
-    resetInternal();
+    channel_amplitudes_.fill(0.0f);
+    std::fill(spectrum_peaks_.begin(), spectrum_peaks_.end(), 0.0f);
+    std::fill(channel_peaks_.begin(), channel_peaks_.end(), 0.0f);
+    std::fill(apu_levels_.begin(), apu_levels_.end(), 0.0f);
+    true_peak_display_ = LoudnessMeter::NO_SIGNAL;
+    spectrogram_.clear();
 }
 
-void AudioVisualizer::resetInternal() {
-    // Note: This function assumes the caller already holds audio_mutex_
-    
-    // Clear all buffers
-    std::fill(waveform_buffer_.begin(), waveform_buffer_.end(), 0.0f);
-    std::fill(waveform_buffer_left_.begin(), waveform_buffer_left_.end(), 0.0f);
-    std::fill(waveform_buffer_right_.begin(), waveform_buffer_right_.end(), 0.0f);
-    std::fill(fft_input_.begin(), fft_input_.end(), 0.0f);
-    std::fill(spectrum_data_.begin(), spectrum_data_.end(), 0.0f);
-    std::fill(spectrum_peaks_.begin(), spectrum_peaks_.end(), 0.0f);
-    
-    for (auto& row : spectrum_history_) {
-        std::fill(row.begin(), row.end(), 0.0f);
-    }
-    
-    channel_amplitudes_.fill(0.0f);
-    channel_peaks_.fill(0.0f);
-    spectrum_history_pos_ = 0;
+void AudioVisualizer::setChannelLayout(const ChannelLayout& layout) {
+    if (layout == layout_) return;
+    layout_ = layout;
+    channel_peaks_.assign(layout_.size(), 0.0f);
+    apu_levels_.assign(layout_.size(), 0.0f);
 }
 
-void AudioVisualizer::updateAudioData(const short* samples, int sample_count) {
-    if (!samples || sample_count <= 0) return;
-    
-    std::lock_guard<std::mutex> lock(audio_mutex_);
-    
-    // Convert stereo samples to mono and update waveform buffer
-    int mono_count = sample_count / 2;
-    
-    // Rolling window update for waveform
-    int shift = std::min(mono_count, WAVEFORM_SIZE);
-    
-    if (shift < WAVEFORM_SIZE) {
-        // Shift existing samples
-        std::memmove(waveform_buffer_.data(), 
-                     waveform_buffer_.data() + shift,
-                     (WAVEFORM_SIZE - shift) * sizeof(float));
-        std::memmove(waveform_buffer_left_.data(),
-                     waveform_buffer_left_.data() + shift,
-                     (WAVEFORM_SIZE - shift) * sizeof(float));
-        std::memmove(waveform_buffer_right_.data(),
-                     waveform_buffer_right_.data() + shift,
-                     (WAVEFORM_SIZE - shift) * sizeof(float));
-    }
-    
-    // Add new samples
-    int start_idx = std::max(0, mono_count - shift);
-    for (int i = 0; i < shift; ++i) {
-        int src_idx = (start_idx + i) * 2;
-        float left = samples[src_idx] / 32768.0f;
-        float right = samples[src_idx + 1] / 32768.0f;
-        float mono = (left + right) * 0.5f;
-        
-        int dst_idx = WAVEFORM_SIZE - shift + i;
-        waveform_buffer_[dst_idx] = mono;
-        waveform_buffer_left_[dst_idx] = left;
-        waveform_buffer_right_[dst_idx] = right;
-    }
-    
-    // Update FFT input buffer
-    int fft_shift = std::min(mono_count, FFT_SIZE);
-    if (fft_shift < FFT_SIZE) {
-        std::memmove(fft_input_.data(),
-                     fft_input_.data() + fft_shift,
-                     (FFT_SIZE - fft_shift) * sizeof(float));
+void AudioVisualizer::pollAnalysis() {
+    MemoryScope memory(MemoryTag::Analysis);   // peaks, waterfall pixels, spectrogram rows
+    bool estimated = subscription_->acquire();
+    if (estimated) {
+        const AnalysisFrame& frame = subscription_->frame();
+        if (spectrum_peaks_.size() != frame.spectrum.size()) spectrum_peaks_.assign(frame.spectrum.size(), 0.0f);
+        for (size_t i = 0; i < frame.spectrum.size(); ++i) {
+            spectrum_peaks_[i] = std::max(spectrum_peaks_[i], frame.spectrum[i]);
+        }
+        updateWaterfallPixels(frame);
+        spectrogram_.append(frame.history.data(), frame.history_size,
+                            static_cast<int>(frame.spectrum.size()), frame.history_rows);
+        updateChannelAmplitudes(frame);
+        true_peak_display_ = std::max(true_peak_display_, frame.true_peak);
     }
-    
-    start_idx = std::max(0, mono_count - fft_shift);
-    for (int i = 0; i < fft_shift; ++i) {
-        int src_idx = (start_idx + i) * 2;
-        float left = samples[src_idx] / 32768.0f;
-        float right = samples[src_idx + 1] / 32768.0f;
-        fft_input_[FFT_SIZE - fft_shift + i] = (left + right) * 0.5f;
+    bool from_apu = pollApuSource();
+    if (apu_live_ ? from_apu : estimated) {
+        for (size_t i = 0; i < channel_peaks_.size(); ++i) {
+            channel_peaks_[i] = std::max(channel_peaks_[i], channelLevel(static_cast<int>(i)));
+        }
     }
-    
-    // Process FFT and update spectrum
-    processFFT();
-    
-    // Update channel amplitudes (rough estimation from overall signal)
-    updateChannelAmplitudes(samples, sample_count);
 }
 
-void AudioVisualizer::processFFT() {
-    // Apply Hann window and prepare complex data
-    std::vector<std::complex<float>> fftData(FFT_SIZE);
-    for (int i = 0; i < FFT_SIZE; ++i) {
-        float window = 0.5f * (1.0f - std::cos(2.0f * static_cast<float>(M_PI) * i / (FFT_SIZE - 1)));
-        fftData[i] = std::complex<float>(fft_input_[i] * window, 0.0f);
+void AudioVisualizer::updateWaterfallPixels(const AnalysisFrame& frame) {
+    // A new resolution starts a new texture
+    const int bins = static_cast<int>(frame.spectrum.size());
+    const int history = frame.history_size;
+    if (bins != waterfall_bins_ || history != waterfall_history_) {
+        waterfall_bins_ = bins;
+        waterfall_history_ = history;
+        waterfall_pixels_.assign(static_cast<size_t>(history) * bins, IM_COL32(0, 0, 0, 255));
+        waterfall_colors_.clear();
+        waterfall_rows_ = 0;
+        waterfall_resized_ = true;
+    }
+    if (bins == 0 || history == 0) return;
+    
+    // Only convert rows added since the last update (all of them after a reset)
+    uint64_t first = waterfall_rows_;
+    if (frame.history_rows < first || frame.history_rows - first > static_cast<uint64_t>(history)) {
+        first = frame.history_rows > static_cast<uint64_t>(history) ? frame.history_rows - history : 0;
+        if (frame.history_rows < waterfall_rows_) {
+            std::fill(waterfall_pixels_.begin(), waterfall_pixels_.end(), IM_COL32(0, 0, 0, 255));
+        }
     }
     
-    // Perform FFT
-    SimpleFFT::fft(fftData);
-    
-    // Compute magnitudes
-    std::vector<float> newSpectrum;
-    SimpleFFT::computeMagnitude(fftData, newSpectrum, SPECTRUM_BINS);
+    // History levels are bytes, so every color a bin can take fits a table:
+    // one lookup per pixel instead of an HSV conversion
+    if (waterfall_colors_.empty() && first < frame.history_rows) {
+        waterfall_colors_.resize(bins * 256);
+        for (int i = 0; i < bins; ++i) {
+            float normalized_freq = static_cast<float>(i) / bins;
+            waterfall_colors_[i * 256] = IM_COL32(0, 0, 0, 255);
+            for (int level = 1; level < 256; ++level) {
+                waterfall_colors_[i * 256 + level] = getSpectrumColor(level / 255.0f, normalized_freq);
+            }
+        }
+    }
     
-    // Convert to dB and normalize
-    for (int i = 0; i < SPECTRUM_BINS; ++i) {
-        // Add small value to avoid log(0)
-        float db = 20.0f * std::log10(newSpectrum[i] + 1e-10f);
-        // Normalize to 0-1 range (assuming -60dB to 0dB range)
-        float normalized = (db + 60.0f) / 60.0f;
-        normalized = std::clamp(normalized, 0.0f, 1.0f);
-        
-        // Smooth with previous values
-        spectrum_data_[i] = spectrum_smoothing_ * spectrum_data_[i] + 
-                           (1.0f - spectrum_smoothing_) * normalized;
-        
-        // Update peaks
-        if (spectrum_data_[i] > spectrum_peaks_[i]) {
-            spectrum_peaks_[i] = spectrum_data_[i];
+    for (uint64_t r = first; r < frame.history_rows; ++r) {
+        size_t offset = (r % history) * bins;
+        for (int i = 0; i < bins; ++i) {
+            waterfall_pixels_[offset + i] = waterfall_colors_[i * 256 + frame.history[offset + i]];
         }
     }
     
-    // Update history for waterfall display
-    spectrum_history_[spectrum_history_pos_] = spectrum_data_;
-    spectrum_history_pos_ = (spectrum_history_pos_ + 1) % HISTORY_SIZE;
+    if (frame.history_rows != waterfall_rows_) waterfall_dirty_ = true;
+    waterfall_rows_ = frame.history_rows;
 }
 
-void AudioVisualizer::updateChannelAmplitudes(const short* samples, int sample_count) {
-    // Calculate overall RMS
-    float rms = 0.0f;
-    int mono_count = sample_count / 2;
-    for (int i = 0; i < mono_count; ++i) {
-        float left = samples[i * 2] / 32768.0f;
-        float right = samples[i * 2 + 1] / 32768.0f;
-        float mono = (left + right) * 0.5f;
-        rms += mono * mono;
-    }
-    rms = std::sqrt(rms / std::max(1, mono_count));
-    
-    // Distribute amplitude across channels (estimation)
+void AudioVisualizer::updateChannelAmplitudes(const AnalysisFrame& frame) {
+    // Distribute the mix's level across channels (estimation)
     // In reality, we'd need separate channel buffers from the APU
-    // For now, we simulate based on frequency content
-    for (int i = 0; i < static_cast<int>(NesChannel::BaseCount); ++i) {
+    float rms = (frame.rms_left + frame.rms_right) * 0.5f;
+    for (int i = 0; i < ChannelLayout::BASE_CHANNELS; ++i) {
         // Decay existing amplitude
         channel_amplitudes_[i] *= 0.9f;
         
@@ -268,132 +138,110 @@ void AudioVisualizer::updateChannelAmplitudes(const short* samples, int sample_c
         // This is a rough approximation
         float contribution = rms * (1.0f - (mute_mask_ & (1 << i) ? 1.0f : 0.0f));
         channel_amplitudes_[i] = std::max(channel_amplitudes_[i], contribution);
-        
-        // Update peaks
-        if (channel_amplitudes_[i] > channel_peaks_[i]) {
-            channel_peaks_[i] = channel_amplitudes_[i];
-        }
     }
 }
 
-void AudioVisualizer::updateChannelAmplitudesFromAPU(const int* amplitudes) {
-    // Deprecated: use the version with lengths parameter for accurate display
-    // This version doesn't know if channels are actually active
-    std::lock_guard<std::mutex> lock(audio_mutex_);
-    
-    for (int i = 0; i < static_cast<int>(NesChannel::BaseCount); ++i) {
-        int amp = std::abs(amplitudes[i]);
-        float normalized = 0.0f;
-        
-        if (i == static_cast<int>(NesChannel::Square1) || 
-            i == static_cast<int>(NesChannel::Square2) ||
-            i == static_cast<int>(NesChannel::Noise)) {
-            // These channels: last_amp reflects actual volume (0-15)
-            normalized = amp / 15.0f;
-        } else if (i == static_cast<int>(NesChannel::Triangle)) {
-            // Triangle: use amp > 0 as activity indicator, fixed level
-            normalized = (amp > 0) ? 0.8f : 0.0f;
-            normalized = amp / 15.0f;
-        } else if (i == static_cast<int>(NesChannel::DMC)) {
-            // DMC: use amp > 0 as activity indicator, fixed level
-            normalized = (amp > 0) ? 0.7f : 0.0f;
-        }
-        
-        channel_amplitudes_[i] = std::max(channel_amplitudes_[i] * 0.85f, normalized);
-        
-        if (channel_amplitudes_[i] > channel_peaks_[i]) {
-            channel_peaks_[i] = channel_amplitudes_[i];
-        }
+void AudioVisualizer::setApuSource(const ApuSnapshotLock* source) {
+    if (source == apu_source_) return;
+    apu_source_ = source;
+    apu_version_seen_ = 0;
+    apu_live_ = false;
+    std::fill(apu_levels_.begin(), apu_levels_.end(), 0.0f);
+}
+
+bool AudioVisualizer::pollApuSource() {
+    if (!apu_source_ || apu_source_->version() == apu_version_seen_) return false;
+    
+    ApuFrameSnapshot snapshot;
+    apu_version_seen_ = apu_source_->load(snapshot);
+    apu_live_ = snapshot.active;
+    if (!apu_live_) {
+        std::fill(apu_levels_.begin(), apu_levels_.end(), 0.0f);
+        return false;
     }
+    applyApuSnapshot(snapshot);
+    return true;
 }
 
-void AudioVisualizer::updateChannelAmplitudesFromAPU(const int* amplitudes, const int* lengths) {
-    std::lock_guard<std::mutex> lock(audio_mutex_);
-    
-    // NES APU channel characteristics:
+void AudioVisualizer::applyApuSnapshot(const ApuFrameSnapshot& snapshot) {
+    // Channel characteristics:
     // Square 1/2: last_amp is actual output amplitude (-15 to +15), reflects volume
     // Triangle: last_amp is waveform position (0-15 oscillating), NO volume control!
     // Noise: last_amp is actual output amplitude, reflects volume  
     // DMC: last_amp is DAC value (0-127), doesn't reset when stopped
+    // VRC6 Pulse1/Pulse2 and 5B squares: 4-bit volume (0-15)
+    // VRC6 Saw: accumulator output (0-31 typical)
+    // Namco: 4-bit sample times 4-bit volume (0-225)
+    // Other formats' voices: volume (0-15) from Music_Emu::voice_states
     
-    for (int i = 0; i < static_cast<int>(NesChannel::BaseCount); ++i) {
+    int count = std::min(layout_.size(), snapshot.channel_count);
+    for (int i = 0; i < count; ++i) {
         float normalized = 0.0f;
         bool use_averaging = false;  // Use averaging instead of max for some channels
         
-        // Check if channel is active (length counter > 0)
-        bool is_active = (lengths[i] > 0);
+        // Check if channel is active (length counter > 0, or enabled for expansion chips)
+        bool is_active = (snapshot.lengths[i] > 0);
         
         if (is_active) {
-            int amp = std::abs(amplitudes[i]);
+            int amp = std::abs(snapshot.amplitudes[i]);
             
-            if (i == static_cast<int>(NesChannel::Square1) || 
-                i == static_cast<int>(NesChannel::Square2)) {
-                // Square waves: last_amp reflects actual volume (0-15)
-                normalized = amp / 15.0f;
-            } else if (i == static_cast<int>(NesChannel::Triangle)) {
-                // Triangle: NO volume control, waveform oscillates 0-15
-                // Use averaging to get stable ~0.5 level when active
-                normalized = amp / 15.0f;
-                use_averaging = true;
-            } else if (i == static_cast<int>(NesChannel::Noise)) {
-                // Noise: last_amp reflects actual volume (0-15)
-                normalized = amp / 15.0f;
-            } else if (i == static_cast<int>(NesChannel::DMC)) {
-                // DMC: DAC value (0-127), use it as activity level
-                normalized = amp / 127.0f;
-                use_averaging = true;
+            switch (layout_[i].kind) {
+                case ChannelKind::Square:
+                case ChannelKind::Noise:
+                case ChannelKind::Vrc6Pulse:
+                    // last_amp reflects actual volume (0-15)
+                    normalized = amp / 15.0f;
+                    break;
+                case ChannelKind::Triangle:
+                    // NO volume control, waveform oscillates 0-15.
+                    // Use averaging to get stable ~0.5 level when active
+                    normalized = amp / 15.0f;
+                    use_averaging = true;
+                    break;
+                case ChannelKind::DMC:
+                    // DAC value (0-127), use it as activity level
+                    normalized = amp / 127.0f;
+                    use_averaging = true;
+                    break;
+                case ChannelKind::Vrc6Saw:
+                    normalized = std::min(1.0f, amp / 31.0f);
+                    break;
+                case ChannelKind::Fme7Square:
+                    // Output flips between 0 and a logarithmic level; the volume register is steadier
+                    normalized = snapshot.volumes[i] / 15.0f;
+                    break;
+                case ChannelKind::NamcoWave:
+                    // The wave sample changes every step, so follow the volume register
+                    normalized = snapshot.periods[i] > 0 ? snapshot.volumes[i] / 15.0f : 0.0f;
+                    break;
+                case ChannelKind::Voice:
+                    normalized = snapshot.volumes[i] / 15.0f;
+                    break;
             }
         }
         
         // Apply smoothing
         if (use_averaging) {
             // For Triangle/DMC: use exponential moving average (smoother)
-            channel_amplitudes_[i] = channel_amplitudes_[i] * 0.95f + normalized * 0.05f;
+            apu_levels_[i] = apu_levels_[i] * 0.95f + normalized * 0.05f;
         } else {
-            // For Square/Noise: use max with decay (responsive to peaks)
-            channel_amplitudes_[i] = std::max(channel_amplitudes_[i] * 0.85f, normalized);
-        }
-        
-        // Update peaks
-        if (channel_amplitudes_[i] > channel_peaks_[i]) {
-            channel_peaks_[i] = channel_amplitudes_[i];
+            // For the others: use max with decay (responsive to peaks)
+            apu_levels_[i] = std::max(apu_levels_[i] * 0.85f, normalized);
         }
     }
 }
 
-void AudioVisualizer::updateVRC6ChannelAmplitudes(const int* amplitudes) {
-    if (!has_vrc6_) return;
-    
-    std::lock_guard<std::mutex> lock(audio_mutex_);
-    
-    // VRC6 channels: Pulse1, Pulse2, Saw
-    // Pulse1/Pulse2: 4-bit volume (0-15)
-    // Saw: accumulator output (0-31 typical)
-    
-    for (int i = 0; i < static_cast<int>(NesChannel::VRC6Count); ++i) {
-        int channel_idx = static_cast<int>(NesChannel::VRC6_Pulse1) + i;
-        int amp = std::abs(amplitudes[i]);
-        float normalized;
-        
-        if (i == 2) {
-            // Saw wave - uses accumulator, typical range 0-31
-            normalized = std::min(1.0f, amp / 31.0f);
-        } else {
-            // Pulse waves - 4-bit volume (0-15)
-            normalized = amp / 15.0f;
-        }
-        
-        // Apply smoothing
-        channel_amplitudes_[channel_idx] = std::max(channel_amplitudes_[channel_idx] * 0.85f, normalized);
-        
-        // Update peaks
-        if (channel_amplitudes_[channel_idx] > channel_peaks_[channel_idx]) {
-            channel_peaks_[channel_idx] = channel_amplitudes_[channel_idx];
-        }
+float AudioVisualizer::channelLevel(int channel) const {
+    if (apu_live_) {
+        return channel < static_cast<int>(apu_levels_.size()) ? apu_levels_[channel] : 0.0f;
     }
+    return channel < ChannelLayout::BASE_CHANNELS ? channel_amplitudes_[channel] : 0.0f;
 }
 
 void AudioVisualizer::decayPeaks(float delta_time) {
+    // The true peak readout falls back at 20 dB/s once the signal drops
+    true_peak_display_ -= 20.0f * delta_time;
+    if (true_peak_display_ < -96.0f) true_peak_display_ = LoudnessMeter::NO_SIGNAL;
     float decay = std::pow(peak_decay_rate_, delta_time * 60.0f);
     
     for (auto& peak : spectrum_peaks_) {
@@ -405,8 +253,9 @@ void AudioVisualizer::decayPeaks(float delta_time) {
     }
 }
 
-void AudioVisualizer::setChannelMute(NesChannel channel, bool mute) {
-    int bit = 1 << static_cast<int>(channel);
+void AudioVisualizer::setChannelMute(int channel, bool mute) {
+    if (channel < 0 || channel >= layout_.size() || layout_[channel].voice < 0) return;
+    int bit = 1 << layout_[channel].voice;
     if (mute) {
         mute_mask_ |= bit;
     } else {
@@ -419,8 +268,9 @@ void AudioVisualizer::setChannelMute(NesChannel channel, bool mute) {
     }
 }
 
-bool AudioVisualizer::isChannelMuted(NesChannel channel) const {
-    return (mute_mask_ & (1 << static_cast<int>(channel))) != 0;
+bool AudioVisualizer::isChannelMuted(int channel) const {
+    if (channel < 0 || channel >= layout_.size() || layout_[channel].voice < 0) return false;
+    return (mute_mask_ & (1 << layout_[channel].voice)) != 0;
 }
 
 ImU32 AudioVisualizer::vec4ToU32(const ImVec4& col) {
@@ -463,14 +313,15 @@ ImU32 AudioVisualizer::getSpectrumColor(float normalized_value, float normalized
 }
 
 void AudioVisualizer::drawVisualizerWindow(bool* p_open) {
-    ImGui::SetNextWindowSize(ImVec2(600, 500), ImGuiCond_FirstUseEver);
+    ImGui::SetNextWindowSize(ImVec2(600, 650), ImGuiCond_FirstUseEver);
     
     if (!ImGui::Begin("Audio Visualizer", p_open)) {
         ImGui::End();
         return;
     }
     
-    // Decay peaks
+    // Pick up the latest analysis results, then decay peaks
+    pollAnalysis();
     decayPeaks(ImGui::GetIO().DeltaTime);
     
     // Top section: Waveform and Spectrum side by side
@@ -491,13 +342,90 @@ void AudioVisualizer::drawVisualizerWindow(bool* p_open) {
     drawSpectrumAnalyzer("##spectrum", section_width - 16, 140);
     ImGui::EndChild();
     
+    // Spectrogram waterfall
+    ImGui::BeginChild("Waterfall Section", ImVec2(available_width, 150), true);
+    ImGui::Text("Spectrogram");
+    ImGui::Separator();
+    drawWaterfall("##waterfall", available_width - 16, 110);
+    ImGui::EndChild();
+    
+    // The same rows over minutes
+    if (!spectrogram_tried_) {
+        spectrogram_tried_ = true;
+        spectrogram_.init(getSpectrumColor);
+    }
+    if (spectrogram_.isValid()) {
+        ImGui::BeginChild("Spectrogram History Section", ImVec2(available_width, 170), true);
+        ImGui::Text("Spectrogram History");
+        ImGui::SameLine();
+        float max_span = SpectrogramRenderer::CAPACITY / analysis_.updateRate();
+        spectrogram_span_ = std::min(spectrogram_span_, max_span);
+        ImGui::SetNextItemWidth(160);
+        ImGui::SliderFloat("##spectrogram_span", &spectrogram_span_, 5.0f, max_span, "%.0f s shown");
+        ImGui::Separator();
+        drawSpectrogramHistory("##spectrogram_history", available_width - 16, 110);
+        ImGui::EndChild();
+    }
+    
+    // Stereo vectorscope with its settings beside it
+    ImGui::BeginChild("Vectorscope Section", ImVec2(available_width, 200), true);
+    ImGui::Text("Vectorscope");
+    ImGui::Separator();
+    drawVectorscope("##vectorscope", 160);
+    ImGui::SameLine();
+    ImGui::BeginGroup();
+    ImGui::PushItemWidth(std::max(80.0f, ImGui::GetContentRegionAvail().x * 0.5f));
+    static const char* mode_names[] = {Vectorscope::modeName(Vectorscope::Mode::GONIOMETER),
+                                       Vectorscope::modeName(Vectorscope::Mode::LISSAJOUS)};
+    int mode = static_cast<int>(vectorscope_mode_);
+    if (ImGui::Combo("Mode", &mode, mode_names, static_cast<int>(Vectorscope::Mode::COUNT))) {
+        vectorscope_mode_ = static_cast<Vectorscope::Mode>(mode);
+        vectorscope_.clear();
+    }
+    ImGui::SliderFloat("Gain", &vectorscope_gain_, 0.25f, 8.0f, "%.2fx", ImGuiSliderFlags_Logarithmic);
+    ImGui::SliderFloat("Persistence", &vectorscope_persistence_, 0.0f, 0.98f, "%.2f");
+    if (ImGui::IsItemHovered(ImGuiHoveredFlags_DelayNormal)) {
+        ImGui::SetTooltip("Brightness a trace keeps per 1/60 s");
+    }
+    ImGui::PopItemWidth();
+    ImGui::EndGroup();
+    ImGui::EndChild();
+    
+    // Per-voice scopes (only when the emulator feeds voice taps)
+    if (hasVoiceScopes()) {
+        int rows = (std::min(analysis_.voiceCount(), analysis_.voiceCapacity()) + 3) / 4;
+        float scopes_height = rows * 70.0f;
+        ImGui::BeginChild("Voice Scopes Section", ImVec2(available_width, scopes_height + 40), true);
+        ImGui::Text("Voice Scopes");
+        ImGui::SameLine();
+        if (ImGui::Checkbox("Spectra", &voice_spectra_)) {
+            uint32_t nodes = subscription_->nodes() & ~(AnalysisGraph::NODE_VOICES | AnalysisGraph::NODE_VOICE_SPECTRA);
+            subscription_->setNodes(nodes | (voice_spectra_ ? AnalysisGraph::NODE_VOICE_SPECTRA : AnalysisGraph::NODE_VOICES));
+        }
+        if (ImGui::IsItemHovered(ImGuiHoveredFlags_DelayNormal)) {
+            ImGui::SetTooltip("Each voice's spectrum, all voices in one batched FFT");
+        }
+        ImGui::Separator();
+        drawVoiceScopes(available_width - 16, scopes_height);
+        ImGui::EndChild();
+    }
+    
     // Middle section: Volume meters
     ImGui::BeginChild("Meters Section", ImVec2(available_width, 100), true);
     ImGui::Text("Channel Levels");
+    ImGui::SameLine();
+    drawBeat();
     ImGui::Separator();
     drawVolumeMeters(available_width - 16, 60);
     ImGui::EndChild();
     
+    // EBU R128 loudness of the mix
+    ImGui::BeginChild("Loudness Section", ImVec2(available_width, 74), true);
+    ImGui::Text("Loudness");
+    ImGui::Separator();
+    drawLoudness(available_width - 16);
+    ImGui::EndChild();
+    
     // Bottom section: Channel controls
     ImGui::BeginChild("Controls Section", ImVec2(available_width, 0), true);
     ImGui::Text("Channel Controls");
@@ -509,66 +437,55 @@ void AudioVisualizer::drawVisualizerWindow(bool* p_open) {
 }
 
 void AudioVisualizer::drawWaveformScope(const char* label, float width, float height) {
-    std::lock_guard<std::mutex> lock(audio_mutex_);
+    pollAnalysis();
+    const AnalysisFrame& frame = subscription_->frame();
     
     ImDrawList* draw_list = ImGui::GetWindowDrawList();
     ImVec2 canvas_pos = ImGui::GetCursorScreenPos();
     ImVec2 canvas_size(width, height);
     
-    // Background
-    draw_list->AddRectFilled(canvas_pos,
-                            ImVec2(canvas_pos.x + canvas_size.x, canvas_pos.y + canvas_size.y),
-                            IM_COL32(15, 15, 25, 255));
-    
-    // Grid lines
-    float center_y = canvas_pos.y + canvas_size.y * 0.5f;
-    draw_list->AddLine(ImVec2(canvas_pos.x, center_y),
-                      ImVec2(canvas_pos.x + canvas_size.x, center_y),
-                      IM_COL32(60, 60, 80, 255), 1.0f);
-    
-    // Draw 25% and 75% lines
-    float quarter_y = canvas_size.y * 0.25f;
-    draw_list->AddLine(ImVec2(canvas_pos.x, canvas_pos.y + quarter_y),
-                      ImVec2(canvas_pos.x + canvas_size.x, canvas_pos.y + quarter_y),
-                      IM_COL32(40, 40, 60, 255), 1.0f);
-    draw_list->AddLine(ImVec2(canvas_pos.x, canvas_pos.y + canvas_size.y - quarter_y),
-                      ImVec2(canvas_pos.x + canvas_size.x, canvas_pos.y + canvas_size.y - quarter_y),
-                      IM_COL32(40, 40, 60, 255), 1.0f);
-    
-    // Draw left channel (cyan)
-    if (waveform_buffer_left_.size() > 1) {
-        int sample_count = static_cast<int>(waveform_buffer_left_.size());
-        float step_x = canvas_size.x / static_cast<float>(sample_count - 1);
+    // Everything but the text is built from copies, off this thread if there are jobs
+    BuildCanvas(canvas_jobs_, [canvas_pos, canvas_size, left = frame.waveform_left, right = frame.waveform_right,
+                               zoom = waveform_zoom_, trigger = getScopeTrigger() != ScopeTrigger::Off](ImDrawList& draw_list) {
+        // Background
+        draw_list.AddRectFilled(canvas_pos,
+                                ImVec2(canvas_pos.x + canvas_size.x, canvas_pos.y + canvas_size.y),
+                                IM_COL32(15, 15, 25, 255));
         
-        for (int i = 1; i < sample_count; ++i) {
-            float x1 = canvas_pos.x + (i - 1) * step_x;
-            float x2 = canvas_pos.x + i * step_x;
-            float y1 = center_y - waveform_buffer_left_[i - 1] * canvas_size.y * 0.45f * waveform_zoom_;
-            float y2 = center_y - waveform_buffer_left_[i] * canvas_size.y * 0.45f * waveform_zoom_;
-            
-            y1 = std::clamp(y1, canvas_pos.y, canvas_pos.y + canvas_size.y);
-            y2 = std::clamp(y2, canvas_pos.y, canvas_pos.y + canvas_size.y);
-            
-            draw_list->AddLine(ImVec2(x1, y1), ImVec2(x2, y2), IM_COL32(100, 200, 255, 180), 1.0f);
-        }
-    }
-    
-    // Draw right channel (orange)
-    if (waveform_buffer_right_.size() > 1) {
-        int sample_count = static_cast<int>(waveform_buffer_right_.size());
-        float step_x = canvas_size.x / static_cast<float>(sample_count - 1);
+        // Grid lines
+        float center_y = canvas_pos.y + canvas_size.y * 0.5f;
+        draw_list.AddLine(ImVec2(canvas_pos.x, center_y),
+                          ImVec2(canvas_pos.x + canvas_size.x, center_y),
+                          IM_COL32(60, 60, 80, 255), 1.0f);
         
-        for (int i = 1; i < sample_count; ++i) {
-            float x1 = canvas_pos.x + (i - 1) * step_x;
-            float x2 = canvas_pos.x + i * step_x;
-            float y1 = center_y - waveform_buffer_right_[i - 1] * canvas_size.y * 0.45f * waveform_zoom_;
-            float y2 = center_y - waveform_buffer_right_[i] * canvas_size.y * 0.45f * waveform_zoom_;
-            
-            y1 = std::clamp(y1, canvas_pos.y, canvas_pos.y + canvas_size.y);
-            y2 = std::clamp(y2, canvas_pos.y, canvas_pos.y + canvas_size.y);
-            
-            draw_list->AddLine(ImVec2(x1, y1), ImVec2(x2, y2), IM_COL32(255, 180, 100, 180), 1.0f);
+        // Draw 25% and 75% lines
+        float quarter_y = canvas_size.y * 0.25f;
+        draw_list.AddLine(ImVec2(canvas_pos.x, canvas_pos.y + quarter_y),
+                          ImVec2(canvas_pos.x + canvas_size.x, canvas_pos.y + quarter_y),
+                          IM_COL32(40, 40, 60, 255), 1.0f);
+        draw_list.AddLine(ImVec2(canvas_pos.x, canvas_pos.y + canvas_size.y - quarter_y),
+                          ImVec2(canvas_pos.x + canvas_size.x, canvas_pos.y + canvas_size.y - quarter_y),
+                          IM_COL32(40, 40, 60, 255), 1.0f);
+        
+        // Trigger point sits at the centre of the window
+        if (trigger) {
+            float trigger_x = canvas_pos.x + canvas_size.x * 0.5f;
+            draw_list.AddLine(ImVec2(trigger_x, canvas_pos.y), ImVec2(trigger_x, canvas_pos.y + canvas_size.y),
+                              IM_COL32(40, 40, 60, 255), 1.0f);
         }
+        
+        // Left channel (cyan), then right channel (orange)
+        std::vector<ImVec2> points;
+        drawWaveformGraph(draw_list, points, left.data(), static_cast<int>(left.size()),
+                          canvas_pos, canvas_size, zoom, IM_COL32(100, 200, 255, 180));
+        drawWaveformGraph(draw_list, points, right.data(), static_cast<int>(right.size()),
+                          canvas_pos, canvas_size, zoom, IM_COL32(255, 180, 100, 180));
+    });
+    
+    if (frame.pitch_hz > 0.0f) {
+        char pitch_text[32];
+        snprintf(pitch_text, sizeof(pitch_text), "%.1f Hz", frame.pitch_hz);
+        draw_list->AddText(ImVec2(canvas_pos.x + 4, canvas_pos.y + 2), IM_COL32(150, 150, 170, 255), pitch_text);
     }
     
     // Border
@@ -579,8 +496,127 @@ void AudioVisualizer::drawWaveformScope(const char* label, float width, float he
     ImGui::Dummy(canvas_size);
 }
 
+void AudioVisualizer::drawWaveformGraph(ImDrawList& draw_list, std::vector<ImVec2>& points, const float* samples,
+                                        int sample_count, ImVec2 pos, ImVec2 size, float zoom, ImU32 color) {
+    if (sample_count < 2) return;
+    
+    float center_y = pos.y + size.y * 0.5f;
+    float scale = size.y * 0.45f * zoom;
+    auto toY = [&](float sample) {
+        return std::clamp(center_y - sample * scale, pos.y, pos.y + size.y);
+    };
+    
+    points.clear();
+    int columns = std::max(2, static_cast<int>(size.x));
+    if (sample_count <= columns) {
+        // Fewer samples than pixels: plot them directly
+        float step_x = size.x / static_cast<float>(sample_count - 1);
+        for (int i = 0; i < sample_count; ++i) {
+            points.push_back(ImVec2(pos.x + i * step_x, toY(samples[i])));
+        }
+    } else {
+        // Min/max per pixel column; zig-zagging between them draws the envelope
+        // so the cost follows the canvas width, not the sample count
+        float step_x = size.x / static_cast<float>(columns - 1);
+        for (int c = 0; c < columns; ++c) {
+            int begin = static_cast<int>(static_cast<int64_t>(c) * sample_count / columns);
+            int end = static_cast<int>(static_cast<int64_t>(c + 1) * sample_count / columns);
+            float lo = samples[begin];
+            float hi = samples[begin];
+            for (int i = begin + 1; i < end; ++i) {
+                lo = std::min(lo, samples[i]);
+                hi = std::max(hi, samples[i]);
+            }
+            float x = pos.x + c * step_x;
+            if (c & 1) {
+                points.push_back(ImVec2(x, toY(lo)));
+                points.push_back(ImVec2(x, toY(hi)));
+            } else {
+                points.push_back(ImVec2(x, toY(hi)));
+                points.push_back(ImVec2(x, toY(lo)));
+            }
+        }
+    }
+    
+    draw_list.AddPolyline(points.data(), static_cast<int>(points.size()), color, ImDrawFlags_None, 1.0f);
+}
+
+void AudioVisualizer::drawVoiceScopes(float width, float height) {
+    pollAnalysis();
+    const AnalysisFrame& frame = subscription_->frame();
+    
+    int voices = std::min(frame.voice_count, analysis_.voiceCapacity());
+    if (voices <= 0) return;
+    
+    const int columns = std::min(voices, 4);
+    const int rows = (voices + columns - 1) / columns;
+    const float gap = 4.0f;
+    ImVec2 cell((width - gap * (columns - 1)) / columns, (height - gap * (rows - 1)) / rows);
+    
+    ImDrawList* draw_list = ImGui::GetWindowDrawList();
+    ImVec2 origin = ImGui::GetCursorScreenPos();
+    auto cellPos = [&](int v) {
+        return ImVec2(origin.x + (v % columns) * (cell.x + gap), origin.y + (v / columns) * (cell.y + gap));
+    };
+    
+    // Voices follow gme's order, which isn't always the layout's
+    std::vector<ImU32> colors(voices);
+    for (int v = 0; v < voices; ++v) {
+        int channel = layout_.channelForVoice(v);
+        ImVec4 color = channel >= 0 ? ChannelColor(layout_[channel]) : ImVec4(0.7f, 0.7f, 0.7f, 1.0f);
+        if (mute_mask_ & (1 << v)) color.w = 0.3f;
+        colors[v] = vec4ToU32(color);
+    }
+    
+    // Only what the cells show gets copied
+    std::vector<float> data;
+    if (voice_spectra_) {
+        data.assign(frame.voice_spectra.begin(), frame.voice_spectra.begin() + voices * VOICE_SPECTRUM_BINS);
+    } else {
+        data.assign(frame.voice_waveforms.begin(), frame.voice_waveforms.begin() + voices * VOICE_SCOPE_SIZE);
+    }
+    BuildCanvas(canvas_jobs_, [voices, columns, gap, cell, origin, zoom = waveform_zoom_, spectra = voice_spectra_,
+                               colors = std::move(colors), data = std::move(data)](ImDrawList& draw_list) {
+        std::vector<ImVec2> points;
+        for (int v = 0; v < voices; ++v) {
+            ImVec2 pos(origin.x + (v % columns) * (cell.x + gap), origin.y + (v / columns) * (cell.y + gap));
+            ImVec2 max(pos.x + cell.x, pos.y + cell.y);
+            
+            draw_list.AddRectFilled(pos, max, IM_COL32(15, 15, 25, 255));
+            float center_y = pos.y + cell.y * 0.5f;
+            draw_list.AddLine(ImVec2(pos.x, center_y), ImVec2(max.x, center_y), IM_COL32(40, 40, 60, 255), 1.0f);
+            
+            if (spectra) {
+                const float* bars = data.data() + v * VOICE_SPECTRUM_BINS;
+                float bar_width = cell.x / VOICE_SPECTRUM_BINS;
+                for (int i = 0; i < VOICE_SPECTRUM_BINS; ++i) {
+                    float x = pos.x + i * bar_width;
+                    draw_list.AddRectFilled(ImVec2(x, max.y - bars[i] * cell.y), ImVec2(x + bar_width - 1.0f, max.y),
+                                            colors[v]);
+                }
+            } else {
+                drawWaveformGraph(draw_list, points, data.data() + v * VOICE_SCOPE_SIZE, VOICE_SCOPE_SIZE,
+                                  pos, cell, zoom, colors[v]);
+            }
+        }
+    });
+    
+    // Names and borders over the cells
+    for (int v = 0; v < voices; ++v) {
+        ImVec2 pos = cellPos(v);
+        int channel = layout_.channelForVoice(v);
+        ImVec4 label_color = channel >= 0 ? ChannelColor(layout_[channel]) : ImVec4(0.7f, 0.7f, 0.7f, 1.0f);
+        const char* name = channel >= 0 ? layout_[channel].name : (emu_ && v < gme_voice_count(emu_) ? gme_voice_names(emu_)[v] : "");
+        draw_list->AddText(ImVec2(pos.x + 4, pos.y + 2), vec4ToU32(label_color), name);
+        draw_list->AddRect(pos, ImVec2(pos.x + cell.x, pos.y + cell.y), IM_COL32(80, 80, 100, 255));
+    }
+    
+    ImGui::Dummy(ImVec2(width, height));
+}
+
 void AudioVisualizer::drawSpectrumAnalyzer(const char* label, float width, float height) {
-    std::lock_guard<std::mutex> lock(audio_mutex_);
+    pollAnalysis();
+    const std::vector<float>& spectrum = subscription_->frame().spectrum;
     
     ImDrawList* draw_list = ImGui::GetWindowDrawList();
     ImVec2 canvas_pos = ImGui::GetCursorScreenPos();
@@ -596,22 +632,50 @@ void AudioVisualizer::drawSpectrumAnalyzer(const char* label, float width, float
         IM_COL32(20, 15, 30, 255)
     );
     
-    // Draw spectrum bars
-    float bar_width = canvas_size.x / static_cast<float>(SPECTRUM_BINS);
+    // Draw spectrum bars: one instanced draw where the backend has the
+    // shader, else a gradient rect and peak marker per bar
+    if (!bars_tried_) {
+        bars_tried_ = true;
+        bars_.init(getSpectrumColor);
+    }
+    if (bars_.isValid()) {
+        bars_.update(spectrum.data(), spectrum_peaks_.data(),
+                     static_cast<int>(std::min(spectrum.size(), spectrum_peaks_.size())));
+        bars_.draw(draw_list, canvas_pos, canvas_size, 1.0f);
+    } else {
+        BuildCanvas(canvas_jobs_, [canvas_pos, canvas_size, spectrum, peaks = spectrum_peaks_](ImDrawList& draw_list) {
+            drawSpectrumBars(draw_list, spectrum, peaks, canvas_pos, canvas_size);
+        });
+    }
+    
+    // Border
+    draw_list->AddRect(canvas_pos,
+                      ImVec2(canvas_pos.x + canvas_size.x, canvas_pos.y + canvas_size.y),
+                      IM_COL32(80, 80, 100, 255));
+    
+    ImGui::Dummy(canvas_size);
+}
+
+void AudioVisualizer::drawSpectrumBars(ImDrawList& draw_list, const std::vector<float>& spectrum,
+                                       const std::vector<float>& peaks, ImVec2 canvas_pos, ImVec2 canvas_size) {
+    const int bins = static_cast<int>(std::min(spectrum.size(), peaks.size()));
+    if (bins == 0) return;
+    
+    float bar_width = canvas_size.x / static_cast<float>(bins);
     float bar_gap = 1.0f;
     
-    for (int i = 0; i < SPECTRUM_BINS; ++i) {
+    for (int i = 0; i < bins; ++i) {
         float x = canvas_pos.x + i * bar_width;
-        float bar_height = spectrum_data_[i] * canvas_size.y;
-        float peak_height = spectrum_peaks_[i] * canvas_size.y;
+        float bar_height = spectrum[i] * canvas_size.y;
+        float peak_height = peaks[i] * canvas_size.y;
         
         // Bar gradient
-        float normalized_freq = static_cast<float>(i) / SPECTRUM_BINS;
-        ImU32 bar_color_top = getSpectrumColor(spectrum_data_[i], normalized_freq);
-        ImU32 bar_color_bottom = getSpectrumColor(spectrum_data_[i] * 0.3f, normalized_freq);
+        float normalized_freq = static_cast<float>(i) / bins;
+        ImU32 bar_color_top = getSpectrumColor(spectrum[i], normalized_freq);
+        ImU32 bar_color_bottom = getSpectrumColor(spectrum[i] * 0.3f, normalized_freq);
         
         // Draw bar with gradient
-        draw_list->AddRectFilledMultiColor(
+        draw_list.AddRectFilledMultiColor(
             ImVec2(x + bar_gap, canvas_pos.y + canvas_size.y - bar_height),
             ImVec2(x + bar_width - bar_gap, canvas_pos.y + canvas_size.y),
             bar_color_top, bar_color_top,
@@ -620,23 +684,161 @@ void AudioVisualizer::drawSpectrumAnalyzer(const char* label, float width, float
         
         // Draw peak indicator
         if (peak_height > 2) {
-            draw_list->AddRectFilled(
+            draw_list.AddRectFilled(
                 ImVec2(x + bar_gap, canvas_pos.y + canvas_size.y - peak_height),
                 ImVec2(x + bar_width - bar_gap, canvas_pos.y + canvas_size.y - peak_height + 2),
                 IM_COL32(255, 255, 255, 200)
             );
         }
     }
+}
+
+void AudioVisualizer::createWaterfallTexture() {
+    if (waterfall_created_ && waterfall_resized_) destroyWaterfallTexture();
+    if (waterfall_created_ || waterfall_bins_ == 0 || waterfall_history_ == 0) return;
+    waterfall_resized_ = false;
+    
+    // Columns are display bins, rows are history slots
+    sg_image_desc img_desc = {};
+    img_desc.width = waterfall_bins_;
+    img_desc.height = waterfall_history_;
+    img_desc.pixel_format = SG_PIXELFORMAT_RGBA8;
+    img_desc.usage.stream_update = true;
+    waterfall_image_ = MakeGpuImage(&img_desc);
+    
+    // Repeat vertically so the ring can be scrolled with a UV offset
+    sg_sampler_desc smp_desc = {};
+    smp_desc.min_filter = SG_FILTER_NEAREST;
+    smp_desc.mag_filter = SG_FILTER_NEAREST;
+    smp_desc.wrap_u = SG_WRAP_CLAMP_TO_EDGE;
+    smp_desc.wrap_v = SG_WRAP_REPEAT;
+    waterfall_sampler_ = sg_make_sampler(&smp_desc);
+    
+    sg_view_desc view_desc = {};
+    view_desc.texture.image = waterfall_image_;
+    waterfall_view_ = sg_make_view(&view_desc);
+    
+    waterfall_created_ = true;
+    waterfall_dirty_ = true;
+}
+
+void AudioVisualizer::destroyWaterfallTexture() {
+    if (!waterfall_created_) return;
+    sg_destroy_view(waterfall_view_);
+    sg_destroy_sampler(waterfall_sampler_);
+    DestroyGpuImage(waterfall_image_);
+    waterfall_created_ = false;
+}
+
+void AudioVisualizer::destroyTextures() {
+    destroyWaterfallTexture();
+    if (bars_.isValid()) bars_.shutdown();
+    bars_tried_ = false;
+    if (spectrogram_.isValid()) spectrogram_.shutdown();
+    spectrogram_tried_ = false;
+    if (vectorscope_.isValid()) vectorscope_.shutdown();
+    vectorscope_tried_ = false;
+}
+
+void AudioVisualizer::drawWaterfall(const char* label, float width, float height) {
+    pollAnalysis();
+    createWaterfallTexture();
+    
+    // Stream updates are limited to one per frame, and this is the only caller
+    if (waterfall_created_ && waterfall_dirty_) {
+        sg_image_data data = {};
+        data.mip_levels[0].ptr = waterfall_pixels_.data();
+        data.mip_levels[0].size = waterfall_pixels_.size() * sizeof(uint32_t);
+        sg_update_image(waterfall_image_, &data);
+        waterfall_dirty_ = false;
+    }
+    
+    ImDrawList* draw_list = ImGui::GetWindowDrawList();
+    ImVec2 canvas_pos = ImGui::GetCursorScreenPos();
+    ImVec2 canvas_max(canvas_pos.x + width, canvas_pos.y + height);
+    
+    // Newest row at the top: V runs from just past the newest row down to the oldest
+    if (waterfall_created_) {
+        float v_oldest = static_cast<float>(waterfall_rows_ % waterfall_history_) / waterfall_history_;
+        uint64_t imtex_id = simgui_imtextureid_with_sampler(waterfall_view_, waterfall_sampler_);
+        draw_list->AddImage(imtex_id, canvas_pos, canvas_max,
+                            ImVec2(0.0f, v_oldest + 1.0f), ImVec2(1.0f, v_oldest));
+    }
     
     // Border
-    draw_list->AddRect(canvas_pos,
-                      ImVec2(canvas_pos.x + canvas_size.x, canvas_pos.y + canvas_size.y),
-                      IM_COL32(80, 80, 100, 255));
+    draw_list->AddRect(canvas_pos, canvas_max, IM_COL32(80, 80, 100, 255));
     
-    ImGui::Dummy(canvas_size);
+    ImGui::Dummy(ImVec2(width, height));
+}
+
+void AudioVisualizer::drawSpectrogramHistory(const char* label, float width, float height) {
+    pollAnalysis();
+    ImDrawList* draw_list = ImGui::GetWindowDrawList();
+    ImVec2 canvas_pos = ImGui::GetCursorScreenPos();
+    ImVec2 canvas_max(canvas_pos.x + width, canvas_pos.y + height);
+    
+    // Background, then the newest span of rows, right-aligned
+    draw_list->AddRectFilled(canvas_pos, canvas_max, IM_COL32(0, 0, 0, 255));
+    int span = std::max(1, static_cast<int>(spectrogram_span_ * analysis_.updateRate()));
+    spectrogram_.draw(draw_list, canvas_pos, ImVec2(width, height), span);
+    
+    // Border
+    draw_list->AddRect(canvas_pos, canvas_max, IM_COL32(80, 80, 100, 255));
+    
+    ImGui::Dummy(ImVec2(width, height));
+}
+
+void AudioVisualizer::drawVectorscope(const char* label, float size) {
+    pollAnalysis();
+    if (!vectorscope_tried_) {
+        vectorscope_tried_ = true;
+        vectorscope_.init();
+    }
+    
+    ImDrawList* draw_list = ImGui::GetWindowDrawList();
+    ImVec2 canvas_pos = ImGui::GetCursorScreenPos();
+    ImVec2 canvas_max(canvas_pos.x + size, canvas_pos.y + size);
+    ImVec2 center(canvas_pos.x + size * 0.5f, canvas_pos.y + size * 0.5f);
+    
+    if (vectorscope_.isValid()) {
+        // Each new window of samples goes in once; the picture fades every
+        // frame, by the same amount per second whatever the frame rate
+        const AnalysisFrame& frame = subscription_->frame();
+        bool fresh = frame.tick != vectorscope_tick_;
+        vectorscope_tick_ = frame.tick;
+        float decay = std::pow(vectorscope_persistence_, ImGui::GetIO().DeltaTime * 60.0f);
+        vectorscope_.render(frame.waveform_left.data(), frame.waveform_right.data(),
+                            fresh ? static_cast<int>(frame.waveform_left.size()) : 0,
+                            vectorscope_mode_, vectorscope_gain_, decay, 0x64C8FF, 0.12f);
+        uint64_t imtex_id = simgui_imtextureid_with_sampler(vectorscope_.view(), vectorscope_.sampler());
+        draw_list->AddImage(imtex_id, canvas_pos, canvas_max);
+    } else {
+        draw_list->AddRectFilled(canvas_pos, canvas_max, IM_COL32(15, 15, 25, 255));
+        draw_list->AddText(ImVec2(canvas_pos.x + 4, canvas_pos.y + 2), IM_COL32(150, 150, 170, 255), "No GPU scope");
+    }
+    
+    // Axes: L and R on the diagonals for the goniometer, on the edges for Lissajous
+    ImU32 axis_color = IM_COL32(60, 60, 80, 160);
+    if (vectorscope_mode_ == Vectorscope::Mode::GONIOMETER) {
+        draw_list->AddLine(canvas_pos, canvas_max, axis_color);
+        draw_list->AddLine(ImVec2(canvas_max.x, canvas_pos.y), ImVec2(canvas_pos.x, canvas_max.y), axis_color);
+        draw_list->AddText(ImVec2(canvas_pos.x + 4, canvas_pos.y + 2), IM_COL32(150, 150, 170, 255), "L");
+        draw_list->AddText(ImVec2(canvas_max.x - 12, canvas_pos.y + 2), IM_COL32(150, 150, 170, 255), "R");
+    } else {
+        draw_list->AddLine(ImVec2(canvas_pos.x, center.y), ImVec2(canvas_max.x, center.y), axis_color);
+        draw_list->AddLine(ImVec2(center.x, canvas_pos.y), ImVec2(center.x, canvas_max.y), axis_color);
+        draw_list->AddText(ImVec2(canvas_max.x - 12, center.y - 16), IM_COL32(150, 150, 170, 255), "L");
+        draw_list->AddText(ImVec2(center.x + 4, canvas_pos.y + 2), IM_COL32(150, 150, 170, 255), "R");
+    }
+    
+    // Border
+    draw_list->AddRect(canvas_pos, canvas_max, IM_COL32(80, 80, 100, 255));
+    
+    ImGui::Dummy(ImVec2(size, size));
 }
 
 void AudioVisualizer::drawVolumeMeters(float width, float height) {
+    pollAnalysis();
     ImDrawList* draw_list = ImGui::GetWindowDrawList();
     ImVec2 start_pos = ImGui::GetCursorScreenPos();
     
@@ -656,12 +858,12 @@ void AudioVisualizer::drawVolumeMeters(float width, float height) {
         );
         
         // Level bar
-        float level = channel_amplitudes_[i];
+        float level = channelLevel(i);
         float bar_height = level * meter_height * 5.0f; // Scale up for visibility
         bar_height = std::min(bar_height, meter_height);
         
-        ImVec4 color = ChannelColors[i];
-        if (mute_mask_ & (1 << i)) {
+        ImVec4 color = ChannelColor(layout_[i]);
+        if (isChannelMuted(i)) {
             color.w = 0.3f; // Dim if muted
         }
         
@@ -699,33 +901,112 @@ void AudioVisualizer::drawVolumeMeters(float width, float height) {
         if (i > 0) ImGui::SameLine();
         float label_width = meter_width - 4;
         ImGui::PushItemWidth(label_width);
-        // Use shorter names for VRC6 channels to fit
-        const char* short_names[] = {"Sq1", "Sq2", "Tri", "Noi", "DMC", "V-P1", "V-P2", "V-Saw"};
-        ImGui::TextColored(ChannelColors[i], "%s", channel_count > 5 ? short_names[i] : ChannelNames[i]);
+        // Use shorter names to fit once expansion channels are shown
+        const ChannelLayout::Channel& channel = layout_[i];
+        ImGui::TextColored(ChannelColor(channel), "%s", channel_count > 5 ? channel.short_name : channel.name);
         ImGui::PopItemWidth();
     }
 }
 
+// A lamp that flashes on each beat and fades over the beat, and the tempo
+void AudioVisualizer::drawBeat() {
+    pollAnalysis();
+    const AnalysisFrame& frame = subscription_->frame();
+    ImDrawList* draw_list = ImGui::GetWindowDrawList();
+    float size = ImGui::GetTextLineHeight();
+    ImVec2 pos = ImGui::GetCursorScreenPos();
+    ImVec2 center(pos.x + size * 0.5f, pos.y + size * 0.5f);
+    float glow = 0.0f;
+    if (frame.tempo_bpm > 0.0f) {
+        float fade = 1.0f - frame.beat_phase;
+        glow = fade * fade * fade;
+    }
+    int level = static_cast<int>(40 + 215 * glow);
+    draw_list->AddCircleFilled(center, size * (0.3f + 0.15f * glow), IM_COL32(level, level * 3 / 4, 60, 255));
+    ImGui::Dummy(ImVec2(size, size));
+    ImGui::SameLine();
+    if (frame.tempo_bpm > 0.0f) {
+        ImGui::TextDisabled("%.0f BPM", frame.tempo_bpm);
+    } else {
+        ImGui::TextDisabled("-- BPM");
+    }
+    if (ImGui::IsItemHovered(ImGuiHoveredFlags_DelayNormal)) {
+        ImGui::SetTooltip("Tempo from the periodicity of onsets (confidence %.0f%%)", frame.tempo_confidence * 100.0f);
+    }
+}
+
+void AudioVisualizer::drawLoudness(float width) {
+    pollAnalysis();
+    const AnalysisFrame& frame = subscription_->frame();
+    ImDrawList* draw_list = ImGui::GetWindowDrawList();
+    ImVec2 pos = ImGui::GetCursorScreenPos();
+    
+    // Momentary loudness on a -60..0 LUFS bar, the short-term level as a
+    // tick and the -23 LUFS broadcast target as a faint line
+    const float min_lufs = -60.0f;
+    float bar_height = 12.0f;
+    auto lufs_x = [&](float lufs) {
+        return pos.x + width * std::clamp((lufs - min_lufs) / -min_lufs, 0.0f, 1.0f);
+    };
+    draw_list->AddRectFilled(pos, ImVec2(pos.x + width, pos.y + bar_height), IM_COL32(30, 30, 40, 255));
+    if (LoudnessMeter::hasSignal(frame.lufs_momentary)) {
+        ImU32 color = frame.lufs_momentary > -9.0f ? IM_COL32(255, 120, 80, 255) : IM_COL32(100, 200, 140, 255);
+        draw_list->AddRectFilled(pos, ImVec2(lufs_x(frame.lufs_momentary), pos.y + bar_height), color);
+    }
+    float target_x = lufs_x(-23.0f);
+    draw_list->AddLine(ImVec2(target_x, pos.y), ImVec2(target_x, pos.y + bar_height), IM_COL32(200, 200, 220, 90));
+    if (LoudnessMeter::hasSignal(frame.lufs_short_term)) {
+        float x = lufs_x(frame.lufs_short_term);
+        draw_list->AddLine(ImVec2(x, pos.y), ImVec2(x, pos.y + bar_height), IM_COL32(255, 255, 255, 220), 2.0f);
+    }
+    draw_list->AddRect(pos, ImVec2(pos.x + width, pos.y + bar_height), IM_COL32(80, 80, 100, 255));
+    ImGui::Dummy(ImVec2(width, bar_height));
+    
+    auto format = [](char* text, size_t size, float value) {
+        if (LoudnessMeter::hasSignal(value)) snprintf(text, size, "%.1f", value);
+        else snprintf(text, size, "-inf");
+    };
+    char momentary[16], short_term[16], integrated[16], peak[16], peak_max[16];
+    format(momentary, sizeof(momentary), frame.lufs_momentary);
+    format(short_term, sizeof(short_term), frame.lufs_short_term);
+    format(integrated, sizeof(integrated), frame.lufs_integrated);
+    format(peak, sizeof(peak), true_peak_display_);
+    format(peak_max, sizeof(peak_max), frame.true_peak_max);
+    ImGui::Text("M %s  S %s  I %s LUFS", momentary, short_term, integrated);
+    if (ImGui::IsItemHovered(ImGuiHoveredFlags_DelayNormal)) {
+        ImGui::SetTooltip("Momentary (400 ms), short-term (3 s) and integrated (gated, since the track started)");
+    }
+    ImGui::SameLine();
+    // EBU R128 allows at most -1 dBTP
+    bool over = LoudnessMeter::hasSignal(frame.true_peak_max) && frame.true_peak_max > -1.0f;
+    ImGui::TextColored(over ? ImVec4(1.0f, 0.45f, 0.3f, 1.0f) : ImGui::GetStyleColorVec4(ImGuiCol_Text),
+                       "   TP %s (max %s) dBTP", peak, peak_max);
+    if (ImGui::IsItemHovered(ImGuiHoveredFlags_DelayNormal)) {
+        ImGui::SetTooltip("True peak of the 4x oversampled signal");
+    }
+}
+
 void AudioVisualizer::drawChannelInfo() {
-    // Display channel mute toggles
+    pollAnalysis();
+    
+    // Display channel mute toggles, wrapping to more rows with many expansion channels
     int channel_count = getActiveChannelCount();
-    ImGui::Columns(channel_count, "channel_controls", false);
+    ImGui::Columns(std::min(channel_count, 8), "channel_controls", false);
     
     for (int i = 0; i < channel_count; ++i) {
-        NesChannel channel = static_cast<NesChannel>(i);
-        bool muted = isChannelMuted(channel);
+        bool muted = isChannelMuted(i);
         
-        ImGui::PushStyleColor(ImGuiCol_CheckMark, ChannelColors[i]);
+        ImGui::PushStyleColor(ImGuiCol_CheckMark, ChannelColor(layout_[i]));
         
         char label[32];
-        snprintf(label, sizeof(label), "%s##mute%d", ChannelNames[i], i);
+        snprintf(label, sizeof(label), "%s##mute%d", layout_[i].name, i);
         
         if (ImGui::Checkbox(label, &muted)) {
-            setChannelMute(channel, muted);
+            setChannelMute(i, muted);
         }
         
         // Show amplitude bar
-        float amp = channel_amplitudes_[i];
+        float amp = channelLevel(i);
         ImGui::ProgressBar(amp * 5.0f, ImVec2(-1, 8), "");
         
         ImGui::PopStyleColor();
@@ -734,17 +1015,93 @@ void AudioVisualizer::drawChannelInfo() {
     
     ImGui::Columns(1);
     
+    if (layout_.unemulated) {
+        char names[64] = "";
+        for (int bit = 0; bit < 8; ++bit) {
+            auto chip = static_cast<ChannelLayout::Chip>(1 << bit);
+            if (!(layout_.unemulated & chip)) continue;
+            if (names[0]) strncat(names, ", ", sizeof(names) - strlen(names) - 1);
+            strncat(names, ChannelLayout::chipName(chip), sizeof(names) - strlen(names) - 1);
+        }
+        ImGui::TextDisabled("Not emulated: %s", names);
+    }
+    
     ImGui::Separator();
     
     // Settings
     ImGui::Text("Settings");
     ImGui::SliderFloat("Waveform Zoom", &waveform_zoom_, 0.5f, 4.0f);
-    ImGui::SliderFloat("Spectrum Smoothing", &spectrum_smoothing_, 0.0f, 0.95f);
+    float smoothing = getSpectrumSmoothing();
+    if (ImGui::SliderFloat("Spectrum Smoothing", &smoothing, 0.0f, 0.95f)) {
+        setSpectrumSmoothing(smoothing);
+    }
+    float rate = getUpdateRate();
+    if (ImGui::SliderFloat("Update Rate", &rate, AnalysisGraph::MIN_UPDATE_RATE, AnalysisGraph::MAX_UPDATE_RATE, "%.0f /s")) {
+        setUpdateRate(rate);
+    }
+    if (ImGui::IsItemHovered(ImGuiHoveredFlags_DelayNormal)) {
+        int hop = analysis_.hop();
+        ImGui::SetTooltip("%d frames per update, %.0f%% FFT overlap", hop,
+                          std::max(0.0f, 100.0f * (1.0f - static_cast<float>(hop) / analysis_.resolution().fft_size)));
+    }
+    
+    // Resolution: each set's sizes, the current one selected
+    AnalysisGraph::Resolution resolution = analysis_.resolution();
+    auto size_combo = [](const char* label, int& value, const auto& sizes, const char* format) {
+        char preview[16];
+        snprintf(preview, sizeof(preview), format, value);
+        bool changed = false;
+        if (ImGui::BeginCombo(label, preview)) {
+            for (int size : sizes) {
+                char item[16];
+                snprintf(item, sizeof(item), format, size);
+                if (ImGui::Selectable(item, size == value)) {
+                    changed = size != value;
+                    value = size;
+                }
+            }
+            ImGui::EndCombo();
+        }
+        return changed;
+    };
+    bool resized = size_combo("FFT Size", resolution.fft_size, AnalysisGraph::FFT_SIZES, "%d");
+    if (ImGui::IsItemHovered(ImGuiHoveredFlags_DelayNormal)) {
+        ImGui::SetTooltip("Longer transforms resolve lower notes but react more slowly\nand cost more per update");
+    }
+    resized |= size_combo("Spectrum Bars", resolution.spectrum_bins, AnalysisGraph::SPECTRUM_BIN_COUNTS, "%d");
+    resized |= size_combo("Scope Samples", resolution.waveform_size, AnalysisGraph::WAVEFORM_SIZES, "%d");
+    resized |= size_combo("Waterfall Rows", resolution.history_size, AnalysisGraph::HISTORY_SIZES, "%d");
+    if (resized) analysis_.setResolution(resolution);
+    static const char* scale_names[] = {"Quadratic", "Mel", "Bark", "Semitone", "Constant-Q", "Multi-Res", "Band Zoom"};
+    int scale = static_cast<int>(getSpectrumScale());
+    if (ImGui::Combo("Spectrum Scale", &scale, scale_names, static_cast<int>(SpectrumScale::Count))) {
+        setSpectrumScale(static_cast<SpectrumScale>(scale));
+    }
+    if (getSpectrumScale() == SpectrumScale::BandZoom) {
+        float low = analysis_.zoomLow();
+        float high = analysis_.zoomHigh();
+        if (ImGui::DragFloatRange2("Zoom Band", &low, &high, 1.0f, 0.0f, 20000.0f, "%.0f Hz", "%.0f Hz",
+                                   ImGuiSliderFlags_AlwaysClamp)) {
+            analysis_.setZoomBand(low, std::max(high, low + AnalysisGraph::ZOOM_MIN_WIDTH));
+        }
+        if (ImGui::IsItemHovered(ImGuiHoveredFlags_DelayNormal)) {
+            ImGui::SetTooltip("Narrower bands resolve finer detail but take longer to respond");
+        }
+    }
+    static const char* trigger_names[] = {"Off", "Edge", "Pitch Sync"};
+    int trigger = static_cast<int>(getScopeTrigger());
+    if (ImGui::Combo("Scope Trigger", &trigger, trigger_names, static_cast<int>(ScopeTrigger::Count))) {
+        setScopeTrigger(static_cast<ScopeTrigger>(trigger));
+    }
     
     // Quick mute buttons
     ImGui::Separator();
+    int all_voices = 0;
+    for (int i = 0; i < channel_count; ++i) {
+        if (layout_[i].voice >= 0) all_voices |= 1 << layout_[i].voice;
+    }
     if (ImGui::Button("Mute All")) {
-        mute_mask_ = 0x1F; // All 5 channels
+        mute_mask_ = all_voices;
         if (emu_) gme_mute_voices(emu_, mute_mask_);
     }
     ImGui::SameLine();
@@ -754,12 +1111,12 @@ void AudioVisualizer::drawChannelInfo() {
     }
     ImGui::SameLine();
     if (ImGui::Button("Solo Square")) {
-        mute_mask_ = 0x1C; // Mute Triangle, Noise, DMC
+        mute_mask_ = all_voices & ~0x03; // Mute everything but Square 1/2
         if (emu_) gme_mute_voices(emu_, mute_mask_);
     }
     ImGui::SameLine();
     if (ImGui::Button("Solo Triangle")) {
-        mute_mask_ = 0x1B; // Mute others
+        mute_mask_ = all_voices & ~0x04; // Mute everything but Triangle
         if (emu_) gme_mute_voices(emu_, mute_mask_);
     }
 }
@@ -3,86 +3,57 @@
 #include "gme/gme.h"
 #include "gme/Music_Emu.h"
 #include "imgui.h"
+#include "sokol_gfx.h"
+#include "AnalysisGraph.h"
+#include "ApuSnapshot.h"
+#include "ChannelLayout.h"
+#include "SpectrumBarRenderer.h"
+#include "SpectrogramRenderer.h"
+#include "Vectorscope.h"
+#include "CanvasJobs.h"
 #include <vector>
 #include <array>
-#include <mutex>
+#include <atomic>
 #include <cmath>
-#include <complex>
+#include <cstdint>
+#include <memory>
 
-// NES APU channel types (base + expansion chips)
-enum class NesChannel {
-    // Base APU (5 channels)
-    Square1 = 0,
-    Square2 = 1,
-    Triangle = 2,
-    Noise = 3,
-    DMC = 4,
-    // VRC6 expansion (3 channels)
-    VRC6_Pulse1 = 5,
-    VRC6_Pulse2 = 6,
-    VRC6_Saw = 7,
-    // Counts
-    BaseCount = 5,
-    VRC6Count = 3,
-    MaxCount = 8
-};
-
-// Channel names
-inline const char* const ChannelNames[] = {
-    "Square 1",
-    "Square 2",
-    "Triangle",
-    "Noise",
-    "DMC",
-    "VRC6 Pulse1",
-    "VRC6 Pulse2",
-    "VRC6 Saw"
-};
+// Display color of a channel
+inline ImVec4 ChannelColor(const ChannelLayout::Channel& channel, float alpha = 1.0f) {
+    return ImVec4(((channel.rgb >> 16) & 0xFF) / 255.0f, ((channel.rgb >> 8) & 0xFF) / 255.0f,
+                  (channel.rgb & 0xFF) / 255.0f, alpha);
+}
 
-// Channel colors (RGBA)
-inline const ImVec4 ChannelColors[] = {
-    ImVec4(1.0f, 0.3f, 0.3f, 1.0f),  // Square 1 - Red
-    ImVec4(1.0f, 0.6f, 0.2f, 1.0f),  // Square 2 - Orange
-    ImVec4(0.3f, 0.7f, 1.0f, 1.0f),  // Triangle - Blue
-    ImVec4(0.9f, 0.3f, 0.9f, 1.0f),  // Noise - Magenta
-    ImVec4(0.9f, 0.9f, 0.3f, 1.0f),  // DMC - Yellow
-    ImVec4(0.2f, 0.9f, 0.5f, 1.0f),  // VRC6 Pulse1 - Green
-    ImVec4(0.4f, 0.9f, 0.7f, 1.0f),  // VRC6 Pulse2 - Light Green
-    ImVec4(0.6f, 0.4f, 0.9f, 1.0f)   // VRC6 Saw - Purple
-};
-
-// Simple FFT implementation for spectrum analysis
-class SimpleFFT {
-public:
-    static void fft(std::vector<std::complex<float>>& data);
-    static void computeMagnitude(const std::vector<std::complex<float>>& fftData, 
-                                  std::vector<float>& magnitudes, int numBins);
-};
-
-// Audio visualizer class
+// Audio visualizer window: scopes, spectrum, waterfall and channel meters,
+// drawn from its subscription to the shared analysis graph
 class AudioVisualizer {
 public:
-    AudioVisualizer();
+    explicit AudioVisualizer(AnalysisGraph& analysis);
     ~AudioVisualizer();
 
     // Initialize visualizer
-    bool init(Music_Emu* emu, long sample_rate);
+    bool init(Music_Emu* emu);
     
-    // Reset when loading new file
+    // Reset when loading new file (the graph is reset by its owner)
     void reset();
 
-    // Update audio data (called in audio callback)
-    void updateAudioData(const short* samples, int sample_count);
-    
-    // Update channel amplitudes from APU (for accurate per-channel levels)
-    void updateChannelAmplitudesFromAPU(const int* amplitudes);
-    void updateChannelAmplitudesFromAPU(const int* amplitudes, const int* lengths);
-    
-    // VRC6 expansion support
-    void setVRC6Enabled(bool enabled) { has_vrc6_ = enabled; }
-    bool hasVRC6() const { return has_vrc6_; }
-    void updateVRC6ChannelAmplitudes(const int* amplitudes);  // 3 VRC6 channels
-    int getActiveChannelCount() const { return has_vrc6_ ? static_cast<int>(NesChannel::MaxCount) : static_cast<int>(NesChannel::BaseCount); }
+    // Analysis updates per second of audio
+    void setUpdateRate(float hz) { analysis_.setUpdateRate(hz); }
+    float getUpdateRate() const { return analysis_.updateRate(); }
+    
+    // Per-channel levels follow the APU snapshot of the active player, read at
+    // draw time; null (or an inactive snapshot) estimates them from the mix. UI thread.
+    void setApuSource(const ApuSnapshotLock* source);
+    
+    // Build the scopes and the fallback spectrum bars on job workers; null
+    // builds them in place. The pointee outlives the visualizer.
+    void setCanvasJobs(CanvasJobs* jobs) { canvas_jobs_ = jobs; }
+    
+    // Channels of the loaded file's sound chips; per-channel state is sized
+    // from it. Call on the UI thread when a file is loaded.
+    void setChannelLayout(const ChannelLayout& layout);
+    const ChannelLayout& channelLayout() const { return layout_; }
+    int getActiveChannelCount() const { return layout_.size(); }
 
     // Draw the complete visualizer window
     void drawVisualizerWindow(bool* p_open = nullptr);
@@ -90,70 +61,128 @@ public:
     // Individual drawing functions
     void drawWaveformScope(const char* label, float width, float height);
     void drawSpectrumAnalyzer(const char* label, float width, float height);
+    void drawWaterfall(const char* label, float width, float height);
+    void drawSpectrogramHistory(const char* label, float width, float height);
+    void drawVectorscope(const char* label, float size);
+    void drawVoiceScopes(float width, float height);
+    bool hasVoiceScopes() const { return analysis_.voiceCount() > 0; }
     void drawVolumeMeters(float width, float height);
+    void drawLoudness(float width);
+    void drawBeat();
     void drawChannelInfo();
     
-    // Channel muting control
-    void setChannelMute(NesChannel channel, bool mute);
-    bool isChannelMuted(NesChannel channel) const;
-    int getMuteMask() const { return mute_mask_; }
+    // One waveform as a polyline across pos/size, min/max per pixel column
+    // when there are more samples than pixels. No ImGui:: calls, so it also
+    // builds canvases on job workers and the video renderer's channel scopes.
+    static void drawWaveformGraph(ImDrawList& draw_list, std::vector<ImVec2>& points, const float* samples,
+                                  int sample_count, ImVec2 pos, ImVec2 size, float zoom, ImU32 color);
+    
+    // Release GPU resources (call before sg_shutdown)
+    void destroyTextures();
+    
+    // Channel muting control (layout channel index; channels without a gme voice can't be muted)
+    void setChannelMute(int channel, bool mute);
+    bool isChannelMuted(int channel) const;
+    int getMuteMask() const { return mute_mask_.load(); }
     
     // Settings
     void setWaveformZoom(float zoom) { waveform_zoom_ = zoom; }
     float getWaveformZoom() const { return waveform_zoom_; }
     
-    void setSpectrumSmoothing(float smooth) { spectrum_smoothing_ = smooth; }
-    float getSpectrumSmoothing() const { return spectrum_smoothing_; }
+    void setSpectrumScale(SpectrumScale scale) { analysis_.setSpectrumScale(scale); }
+    SpectrumScale getSpectrumScale() const { return analysis_.spectrumScale(); }
+    
+    void setScopeTrigger(ScopeTrigger mode) { analysis_.setScopeTrigger(mode); }
+    ScopeTrigger getScopeTrigger() const { return analysis_.scopeTrigger(); }
+    
+    void setSpectrumSmoothing(float smooth) { analysis_.setSpectrumSmoothing(smooth); }
+    float getSpectrumSmoothing() const { return analysis_.spectrumSmoothing(); }
 
 private:
-    // Buffer sizes
-    static constexpr int WAVEFORM_SIZE = 1024;    // Samples for waveform display
-    static constexpr int FFT_SIZE = 2048;         // FFT size (must be power of 2)
-    static constexpr int SPECTRUM_BINS = 64;      // Number of frequency bins to display
-    static constexpr int HISTORY_SIZE = 128;      // History for waterfall display
-    
-    // Audio buffers
-    std::vector<float> waveform_buffer_;          // Current waveform
-    std::vector<float> waveform_buffer_left_;     // Left channel
-    std::vector<float> waveform_buffer_right_;    // Right channel
-    std::vector<float> fft_input_;                // FFT input buffer
-    std::vector<float> spectrum_data_;            // Current spectrum
+    static constexpr int VOICE_SCOPE_SIZE = AnalysisGraph::VOICE_SCOPE_SIZE;
+    static constexpr int VOICE_SPECTRUM_BINS = AnalysisGraph::VOICE_SPECTRUM_BINS;
+    using AnalysisFrame = AnalysisGraph::Frame;
+    
+    AnalysisGraph& analysis_;
+    std::shared_ptr<AnalysisGraph::Subscription> subscription_;
+    
+    // Per-channel amplitude estimated from the mix's level; the mix estimate
+    // only ever covers the base APU channels
+    std::array<float, ChannelLayout::BASE_CHANNELS> channel_amplitudes_;
+    
+    // --- UI state ---
+    ChannelLayout layout_;
     std::vector<float> spectrum_peaks_;           // Peak hold for spectrum
-    std::vector<std::vector<float>> spectrum_history_; // History for waterfall
+    std::vector<float> channel_peaks_;            // Per layout channel
+    
+    // APU-driven levels, smoothed per snapshot on the UI thread
+    const ApuSnapshotLock* apu_source_ = nullptr;
+    uint32_t apu_version_seen_ = 0;
+    bool apu_live_ = false;                       // Last snapshot came from a running APU
+    std::vector<float> apu_levels_;               // Per layout channel
+    
+    float true_peak_display_ = LoudnessMeter::NO_SIGNAL;  // Recent true peak, falling back slowly
     
-    // Per-channel amplitude (estimated from mixed output)
-    std::array<float, static_cast<size_t>(NesChannel::MaxCount)> channel_amplitudes_;
-    std::array<float, static_cast<size_t>(NesChannel::MaxCount)> channel_peaks_;
+    CanvasJobs* canvas_jobs_ = nullptr;
+    bool voice_spectra_ = false;                  // Voice cells show spectra instead of scopes
     
-    // Expansion chip flags
-    bool has_vrc6_;
+    // Waterfall texture: RGBA rows laid out like the frame's history, drawn as one
+    // quad with a wrapping V offset so the ring never has to be rotated. Made
+    // again when the analysis resolution changes its size.
+    std::vector<uint32_t> waterfall_pixels_;
+    int waterfall_bins_ = 0;                      // Columns and rows of waterfall_pixels_
+    int waterfall_history_ = 0;
+    bool waterfall_resized_ = false;              // The texture no longer matches them
+    std::vector<uint32_t> waterfall_colors_;      // Per bin, per 8-bit history level; built with the first row
+    uint64_t waterfall_rows_ = 0;                 // History rows converted so far
+    bool waterfall_dirty_ = false;
+    bool waterfall_created_ = false;
+    sg_image waterfall_image_ = {};
+    sg_view waterfall_view_ = {};
+    sg_sampler waterfall_sampler_ = {};
     
-    // Thread safety
-    std::mutex audio_mutex_;
+    // Stereo vectorscope, accumulated in its own GPU target
+    SpectrumBarRenderer bars_;
+    bool bars_tried_ = false;
+
+    // Minutes of history rows; hidden where it has no shader
+    SpectrogramRenderer spectrogram_;
+    bool spectrogram_tried_ = false;
+    float spectrogram_span_ = 60.0f;             // Seconds shown
+
+    Vectorscope vectorscope_;
+    bool vectorscope_tried_ = false;
+    uint64_t vectorscope_tick_ = 0;              // Frame tick last drawn into it
+    Vectorscope::Mode vectorscope_mode_ = Vectorscope::Mode::GONIOMETER;
+    float vectorscope_gain_ = 1.0f;
+    float vectorscope_persistence_ = 0.85f;      // Brightness kept per 1/60 s
     
     // State
     Music_Emu* emu_;
-    long sample_rate_;
-    int mute_mask_;
+    std::atomic<int> mute_mask_;
     bool is_initialized_;
     
     // Visual settings
     float waveform_zoom_;
-    float spectrum_smoothing_;
-    int spectrum_history_pos_;
     
     // Timing for peak decay
     float peak_decay_rate_;
     
     // Helper functions
-    void resetInternal();  // Internal reset without locking (caller must hold mutex)
-    void processFFT();
-    void updateChannelAmplitudes(const short* samples, int sample_count);
-    void drawWaveformGraph(const std::vector<float>& samples, ImVec2 pos, ImVec2 size, ImVec4 color);
-    void drawSpectrumBars(ImVec2 pos, ImVec2 size);
+    void pollAnalysis();               // UI: pick up new results, update peaks
+    bool pollApuSource();              // UI: apply a new APU snapshot, true if one arrived
+    void applyApuSnapshot(const ApuFrameSnapshot& snapshot);
+    float channelLevel(int channel) const;
+    void updateWaterfallPixels(const AnalysisFrame& frame);
+    void createWaterfallTexture();
+    void destroyWaterfallTexture();
+    void updateChannelAmplitudes(const AnalysisFrame& frame);
+    // Canvas builds, also run on job workers: no ImGui:: calls or members
+    static void drawSpectrumBars(ImDrawList& draw_list, const std::vector<float>& spectrum,
+                                 const std::vector<float>& peaks, ImVec2 pos, ImVec2 size);
     void decayPeaks(float delta_time);
     
     // Color helpers
-    ImU32 getSpectrumColor(float normalized_value, float normalized_freq);
+    static ImU32 getSpectrumColor(float normalized_value, float normalized_freq);
     ImU32 vec4ToU32(const ImVec4& col);
 };
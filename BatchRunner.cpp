@@ -0,0 +1,589 @@
+#include "BatchRunner.h"
+#include "AudioExport.h"
+#include "JobSystem.h"
+#include "LoudnessMeter.h"
+#include "MusicEmuPool.h"
+#include "NsfLibrary.h"
+#include "TrackLengthDetector.h"
+#include "VideoRenderer.h"
+#include "gme/gme.h"
+#include "gme/Nsf_Emu.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+constexpr long ANALYSIS_CHUNK_FRAMES = 4096;
+
+// Length, loudness and playback gain of every track of a file, analysed the
+// way the library measures them but over the whole export length: one job
+// per track (and one emulator per job) like AlbumExporter, written as one
+// JSON file by write() once they are done. A track without length info ends
+// where TrackLengthDetector finds its loop or silence.
+class AnalysisExporter {
+public:
+    ~AnalysisExporter() { cancel(); }
+
+    bool start(JobSystem& jobs, std::shared_ptr<const MappedFile> file_data, std::vector<int> tracks,
+               long sample_rate) {
+        cancel();
+        if (!file_data || !file_data->isOpen() || tracks.empty()) return false;
+
+        track_count_ = static_cast<int>(tracks.size());
+        track_progress_ = std::make_unique<std::atomic<float>[]>(track_count_);
+        for (int i = 0; i < track_count_; ++i) track_progress_[i].store(0.0f);
+        results_.assign(track_count_, Result());
+        done_count_.store(0);
+        failed_count_.store(0);
+        sample_rate_ = sample_rate;
+
+        for (int slot = 0; slot < track_count_; ++slot) {
+            int track = tracks[slot];
+            results_[slot].track = track;
+            jobs_.push_back(jobs.submit([this, file_data, slot, track](const Job& job) {
+                analyzeTrack(*file_data, slot, track, job);
+            }, JobPriority::BATCH, "Analysis"));
+        }
+        return true;
+    }
+
+    void cancel() {
+        for (auto& job : jobs_) job->cancel();
+        for (auto& job : jobs_) job->wait();
+        jobs_.clear();
+    }
+
+    bool isRunning() const {
+        for (const auto& job : jobs_) {
+            if (!job->isDone()) return true;
+        }
+        return false;
+    }
+
+    float progress() const {
+        if (track_count_ <= 0) return 0.0f;
+        float sum = 0.0f;
+        for (int i = 0; i < track_count_; ++i) sum += track_progress_[i].load();
+        return sum / track_count_;
+    }
+
+    int tracksFailed() const { return failed_count_.load(); }
+
+    std::string firstError() const {
+        std::lock_guard<std::mutex> lock(error_mutex_);
+        return first_error_;
+    }
+
+    // After the jobs finished; failed tracks are listed with their error
+    bool write(const std::string& path, const std::string& source) const;
+
+private:
+    struct Result {
+        int track = 0;
+        std::string error;              // empty once analysed
+        std::string system, game, author, copyright, title;
+        long length_ms = 0;             // fade start
+        long fade_ms = 0;
+        const char* length_source = "default";
+        float loop_start = 0.0f;        // seconds, when the trace found a loop
+        float loop_length = 0.0f;
+        float lufs = LoudnessMeter::NO_SIGNAL;
+        float peak_db = LoudnessMeter::NO_SIGNAL;
+        float gain_db = 0.0f;
+    };
+
+    void analyzeTrack(const MappedFile& file, int slot, int track, const Job& job);
+
+    void setProgress(const Job& job, int slot, float progress) {
+        track_progress_[slot].store(progress);
+        job.setProgress(progress);
+    }
+
+    void fail(Result& result, const std::string& message) {
+        result.error = message;
+        failed_count_.fetch_add(1);
+        std::lock_guard<std::mutex> lock(error_mutex_);
+        if (first_error_.empty()) first_error_ = message;
+    }
+
+    std::vector<JobHandle> jobs_;
+    std::unique_ptr<std::atomic<float>[]> track_progress_;
+    std::vector<Result> results_;       // a slot per job, read once they are done
+    int track_count_ = 0;
+    std::atomic<int> done_count_{0};
+    std::atomic<int> failed_count_{0};
+    long sample_rate_ = 44100;
+
+    mutable std::mutex error_mutex_;
+    std::string first_error_;
+};
+
+void AnalysisExporter::analyzeTrack(const MappedFile& file, int slot, int track, const Job& job) {
+    Result& result = results_[slot];
+    Music_Emu* emu = nullptr;
+    if (gme_open_data(file.data(), static_cast<long>(file.size()), &emu, sample_rate_) || !emu) {
+        fail(result, "Failed to open file for analysis");
+        return;
+    }
+    gme_set_fast_synth(emu, 1);  // aliasing barely moves the loudness
+
+    track_info_t info;
+    if (gme_track_info(emu, &info, track) == nullptr) {
+        result.system = info.system;
+        result.game = info.game;
+        result.author = info.author;
+        result.copyright = info.copyright;
+        result.title = info.song;
+        result.length_ms = AlbumExporter::playLength(info.length, info.intro_length, info.loop_length);
+        result.fade_ms = AlbumExporter::FADE_MSEC;
+        if (info.length > 0 || info.loop_length > 0) result.length_source = "file";
+    } else {
+        result.length_ms = AlbumExporter::playLength(-1, -1, -1);
+        result.fade_ms = AlbumExporter::FADE_MSEC;
+    }
+
+    // The export renders 2:30 without length info; the trace knows better
+    Nsf_Emu* nsf = dynamic_cast<Nsf_Emu*>(emu);
+    if (nsf && std::strcmp(result.length_source, "default") == 0) {
+        TrackLengthDetector detector;
+        TrackLengthDetector::Result end;
+        if (detector.detect(*nsf, track, end, [&job]() { return job.isCancelled(); }) && end.length_ms > 0) {
+            result.length_ms = end.length_ms;
+            result.fade_ms = end.fade_ms;
+            result.length_source = end.looped ? "loop" : "silence";
+            result.loop_start = end.loop_start;
+            result.loop_length = end.loop_length;
+        }
+    }
+    if (job.isCancelled()) {
+        gme_delete(emu);
+        return;
+    }
+
+    if (gme_start_track(emu, track)) {
+        gme_delete(emu);
+        fail(result, "Failed to start track " + std::to_string(track + 1));
+        return;
+    }
+    gme_set_fade(emu, result.length_ms);
+
+    LoudnessMeter meter;
+    meter.setSampleRate(sample_rate_);
+    const long total_frames = (result.length_ms + result.fade_ms) * sample_rate_ / 1000;
+    std::vector<float> frames(ANALYSIS_CHUNK_FRAMES * 2);
+    long rendered = 0;
+    bool ok = true;
+    while (ok && rendered < total_frames && !gme_track_ended(emu)) {
+        if (job.isCancelled()) {
+            gme_delete(emu);
+            return;
+        }
+        long count = std::min(ANALYSIS_CHUNK_FRAMES, total_frames - rendered);
+        ok = gme_play_float(emu, count * 2, frames.data(), 1.0f) == nullptr;
+        if (ok) meter.process(frames.data(), static_cast<int>(count));
+        rendered += count;
+        setProgress(job, slot, static_cast<float>(rendered) / total_frames);
+    }
+    gme_delete(emu);
+    if (!ok) {
+        fail(result, "Failed to play track " + std::to_string(track + 1));
+        return;
+    }
+
+    result.lufs = meter.integrated();
+    result.peak_db = meter.truePeak();
+    NsfLibraryTrack measured;
+    measured.lufs = result.lufs;
+    measured.peak_db = result.peak_db;
+    result.gain_db = NsfLibrary::trackGainDb(measured);
+    setProgress(job, slot, 1.0f);
+    done_count_.fetch_add(1);
+}
+
+void putJsonString(std::string& out, const std::string& text) {
+    out += '"';
+    for (unsigned char c : text) {
+        if (c == '"' || c == '\\') {
+            out += '\\';
+            out += static_cast<char>(c);
+        } else if (c < 0x20) {
+            char escape[8];
+            snprintf(escape, sizeof(escape), "\\u%04x", c);
+            out += escape;
+        } else {
+            out += static_cast<char>(c);
+        }
+    }
+    out += '"';
+}
+
+// Loudness of silence has no number; JSON gets null
+void putJsonLoudness(std::string& out, float db) {
+    if (!LoudnessMeter::hasSignal(db)) {
+        out += "null";
+        return;
+    }
+    char number[32];
+    snprintf(number, sizeof(number), "%.2f", db);
+    out += number;
+}
+
+bool AnalysisExporter::write(const std::string& path, const std::string& source) const {
+    const Result* first = nullptr;
+    for (const Result& result : results_) {
+        if (result.error.empty()) {
+            first = &result;
+            break;
+        }
+    }
+
+    std::string out = "{\n  \"file\": ";
+    putJsonString(out, source);
+    if (first) {
+        out += ",\n  \"system\": ";
+        putJsonString(out, first->system);
+        out += ",\n  \"game\": ";
+        putJsonString(out, first->game);
+        out += ",\n  \"author\": ";
+        putJsonString(out, first->author);
+        out += ",\n  \"copyright\": ";
+        putJsonString(out, first->copyright);
+    }
+    out += ",\n  \"sample_rate\": " + std::to_string(sample_rate_) + ",\n  \"tracks\": [";
+
+    for (size_t i = 0; i < results_.size(); ++i) {
+        const Result& result = results_[i];
+        out += i ? ",\n    {" : "\n    {";
+        out += "\"track\": " + std::to_string(result.track + 1);
+        if (!result.error.empty()) {
+            out += ", \"error\": ";
+            putJsonString(out, result.error);
+            out += "}";
+            continue;
+        }
+        out += ", \"title\": ";
+        putJsonString(out, result.title);
+        out += ", \"length_ms\": " + std::to_string(result.length_ms);
+        out += ", \"fade_ms\": " + std::to_string(result.fade_ms);
+        out += ", \"length_source\": \"";
+        out += result.length_source;
+        out += "\"";
+        if (result.loop_length > 0.0f) {
+            out += ", \"loop_start_ms\": " + std::to_string(static_cast<long>(result.loop_start * 1000.0f));
+            out += ", \"loop_ms\": " + std::to_string(static_cast<long>(result.loop_length * 1000.0f));
+        }
+        out += ", \"lufs\": ";
+        putJsonLoudness(out, result.lufs);
+        out += ", \"true_peak_db\": ";
+        putJsonLoudness(out, result.peak_db);
+        char gain[32];
+        snprintf(gain, sizeof(gain), ", \"gain_db\": %.2f}", result.gain_db);
+        out += gain;
+    }
+    out += results_.empty() ? "]\n}\n" : "\n  ]\n}\n";
+
+    FILE* file = std::fopen(path.c_str(), "wb");
+    if (!file) return false;
+    bool ok = std::fwrite(out.data(), 1, out.size(), file) == out.size();
+    return std::fclose(file) == 0 && ok;
+}
+
+// One file's output of one kind, as the command line loop polls it. The
+// exporters share their polling interface, so each is wrapped the same way.
+struct Batch {
+    std::string file;               // for the log
+    std::string kind;
+    int tracks = 0;
+    double audio_seconds = 0.0;     // the tracks' export lengths
+    std::shared_ptr<void> owner;
+    std::function<bool()> running;
+    std::function<float()> progress;
+    std::function<int()> failed;
+    std::function<std::string()> error;
+    std::function<bool()> finish;   // once it stopped running; false if that failed
+
+    bool started = false;
+    bool finished = false;
+    std::chrono::steady_clock::time_point began;
+};
+
+template <class Exporter>
+Batch makeBatch(std::shared_ptr<Exporter> exporter) {
+    Batch batch;
+    Exporter* e = exporter.get();
+    batch.owner = std::move(exporter);
+    batch.running = [e] { return e->isRunning(); };
+    batch.progress = [e] { return e->progress(); };
+    batch.failed = [e] { return e->tracksFailed(); };
+    batch.error = [e] { return e->firstError(); };
+    return batch;
+}
+
+bool readList(const char* path, std::vector<std::string>& files) {
+    std::ifstream in(path);
+    if (!in) return false;
+    std::string line;
+    while (std::getline(in, line)) {
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        if (!line.empty() && line[0] != '#') files.push_back(line);
+    }
+    return true;
+}
+
+void usage() {
+    fprintf(stderr,
+            "usage: imgui_fc_visualizer --batch FILE... [options]\n"
+            "  --list PATH          also the files named in PATH, one per line\n"
+            "  --mix                the mixed tracks (default when no output is chosen)\n"
+            "  --stems              one file per voice, into a stems folder\n"
+            "  --midi               the piano-roll notes as MIDI files\n"
+            "  --video              videos of the piano roll and scope\n"
+            "  --analysis           length, loudness and gain of every track as JSON\n"
+            "                       (default when no output is chosen)\n"
+            "  --format F           wav or flac, for --mix and --stems (default: wav)\n"
+            "  --tracks LIST        tracks of every file, e.g. 1-3,7 (default: all)\n"
+            "  --out DIR            output directory, a folder per file (default: .)\n"
+            "  --rate HZ            sample rate (default: 44100)\n"
+            "  --threads N          worker threads (default: cores - 1)\n"
+            "  --size, --fps, --layout, --roll-seconds, --encoder, --ext\n"
+            "                       video settings, as for --render-video\n");
+}
+
+double secondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+void report(const Batch& batch) {
+    double seconds = secondsSince(batch.began);
+    char speed[32] = "";
+    if (seconds > 0.0) snprintf(speed, sizeof(speed), " (%.0fx realtime)", batch.audio_seconds / seconds);
+    fprintf(stderr, "\rbatch: %s: %s, %d tracks, %.0f s of audio in %.1f s%s\n", batch.file.c_str(),
+            batch.kind.c_str(), batch.tracks, batch.audio_seconds, seconds, speed);
+    if (batch.failed() > 0) {
+        fprintf(stderr, "batch: %s: %s: %d failed: %s\n", batch.file.c_str(), batch.kind.c_str(), batch.failed(),
+                batch.error().c_str());
+    }
+}
+
+}  // namespace
+
+bool BatchRunner::isCommandLine(int argc, char* argv[]) {
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--batch") == 0) return true;
+    }
+    return false;
+}
+
+int BatchRunner::runCommandLine(int argc, char* argv[]) {
+    std::vector<std::string> files;
+    bool mix = false, stems = false, midi = false, video = false, analysis = false;
+    ExportFormat format = ExportFormat::WAV;
+    const char* track_list = nullptr;
+    std::string out_dir = ".";
+    long sample_rate = 44100;
+    int threads = 0;
+    VideoRenderer::Settings video_settings;
+    bool ok = true;
+
+    for (int i = 1; i < argc && ok; ++i) {
+        const char* arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if (std::strcmp(arg, "--batch") == 0) {
+            continue;
+        } else if (std::strncmp(arg, "--", 2) != 0) {
+            files.push_back(arg);
+        } else if (std::strcmp(arg, "--list") == 0 && has_value) {
+            if (!readList(argv[++i], files)) {
+                fprintf(stderr, "batch: cannot read %s\n", argv[i]);
+                return 1;
+            }
+        } else if (std::strcmp(arg, "--mix") == 0) {
+            mix = true;
+        } else if (std::strcmp(arg, "--stems") == 0) {
+            stems = true;
+        } else if (std::strcmp(arg, "--midi") == 0) {
+            midi = true;
+        } else if (std::strcmp(arg, "--video") == 0) {
+            video = true;
+        } else if (std::strcmp(arg, "--analysis") == 0) {
+            analysis = true;
+        } else if (std::strcmp(arg, "--format") == 0 && has_value) {
+            const char* name = argv[++i];
+            if (std::strcmp(name, "wav") == 0) format = ExportFormat::WAV;
+            else if (std::strcmp(name, "flac") == 0) format = ExportFormat::FLAC;
+            else ok = false;
+        } else if (std::strcmp(arg, "--tracks") == 0 && has_value) {
+            track_list = argv[++i];
+        } else if (std::strcmp(arg, "--out") == 0 && has_value) {
+            out_dir = argv[++i];
+        } else if (std::strcmp(arg, "--rate") == 0 && has_value) {
+            sample_rate = std::atol(argv[++i]);
+        } else if (std::strcmp(arg, "--threads") == 0 && has_value) {
+            threads = std::atoi(argv[++i]);
+        } else if (!VideoRenderer::parseOption(argc, argv, i, video_settings, ok)) {
+            ok = false;
+        }
+    }
+    if (!ok || files.empty() || sample_rate <= 0 || video_settings.width <= 0 || video_settings.height <= 0 ||
+        video_settings.fps <= 0) {
+        usage();
+        return 1;
+    }
+    if (!mix && !stems && !midi && !video && !analysis) mix = analysis = true;
+#ifndef _WIN32
+    // An encoder that exits early fails the track, not the whole process
+    if (video) std::signal(SIGPIPE, SIG_IGN);
+#endif
+
+    JobSystem jobs;
+    jobs.init(threads);
+    auto started = std::chrono::steady_clock::now();
+
+    // Everything is queued up front; the analysis files are written as their batches finish
+    std::vector<Batch> batches;
+    int failed_files = 0;
+    int total_tracks = 0;
+    double total_audio = 0.0;
+    for (const std::string& path : files) {
+        std::string name = fs::path(path).filename().string();
+        std::shared_ptr<MusicEmuPool> pool = MusicEmuPool::open(path.c_str(), sample_rate);
+        int track_count = 0;
+        double audio_seconds = 0.0;
+        std::vector<int> tracks;
+        if (pool) {
+            MusicEmuPool::Lease emu = pool->acquire();
+            if (emu) track_count = gme_track_count(emu.get());
+            if (track_list) {
+                if (!AlbumExporter::parseTrackList(track_list, track_count, tracks)) {
+                    fprintf(stderr, "batch: %s: bad track list '%s' (the file has %d tracks)\n", name.c_str(),
+                            track_list, track_count);
+                    ++failed_files;
+                    continue;
+                }
+            } else {
+                for (int track = 0; track < track_count; ++track) tracks.push_back(track);
+            }
+            for (int track : tracks) {
+                track_info_t info;
+                long length = AlbumExporter::playLength(-1, -1, -1);
+                if (gme_track_info(emu.get(), &info, track) == nullptr) {
+                    length = AlbumExporter::playLength(info.length, info.intro_length, info.loop_length);
+                }
+                audio_seconds += (length + AlbumExporter::FADE_MSEC) / 1000.0;
+            }
+        }
+        if (tracks.empty()) {
+            fprintf(stderr, "batch: cannot open %s\n", path.c_str());
+            ++failed_files;
+            continue;
+        }
+
+        fs::path dir = fs::path(out_dir) / fs::path(path).stem();
+        std::error_code ec;
+        fs::create_directories(dir, ec);
+        if (ec) {
+            fprintf(stderr, "batch: cannot create %s\n", dir.string().c_str());
+            ++failed_files;
+            continue;
+        }
+        total_tracks += static_cast<int>(tracks.size());
+
+        auto add = [&](Batch batch, const char* kind) {
+            batch.file = name;
+            batch.kind = kind;
+            batch.tracks = static_cast<int>(tracks.size());
+            batch.audio_seconds = audio_seconds;
+            total_audio += audio_seconds;
+            batches.push_back(std::move(batch));
+        };
+        auto album = [&](ExportContent content, const fs::path& to, const char* kind) {
+            auto exporter = std::make_shared<AlbumExporter>();
+            if (content == ExportContent::STEMS) fs::create_directories(to, ec);
+            if (exporter->start(jobs, pool->data(), tracks, to.string(), format, content, sample_rate)) {
+                add(makeBatch(exporter), kind);
+            }
+        };
+        if (mix) album(ExportContent::MIX, dir, AudioFileWriter::extension(format));
+        if (stems) album(ExportContent::STEMS, dir / "stems", "stems");
+        if (midi) album(ExportContent::MIDI, dir, "midi");
+        if (video) {
+            auto renderer = std::make_shared<VideoRenderer>();
+            if (renderer->start(jobs, pool, tracks, dir.string(), video_settings)) add(makeBatch(renderer), "video");
+        }
+        if (analysis) {
+            auto exporter = std::make_shared<AnalysisExporter>();
+            if (exporter->start(jobs, pool->data(), tracks, sample_rate)) {
+                Batch batch = makeBatch(exporter);
+                std::string json = (dir / (fs::path(path).stem().string() + ".analysis.json")).string();
+                AnalysisExporter* e = exporter.get();
+                batch.finish = [e, json, path] { return e->write(json, path); };
+                add(std::move(batch), "analysis");
+            }
+        }
+    }
+
+    // Each batch's clock starts at the last poll before its first track made
+    // progress, so one queued behind the others isn't charged for the wait
+    int finished = 0;
+    int failed_tracks = 0;
+    auto last_poll = started;
+    while (finished < static_cast<int>(batches.size())) {
+        auto poll = std::chrono::steady_clock::now();
+        float progress = 0.0f;
+        for (Batch& batch : batches) {
+            if (batch.finished) {
+                progress += batch.tracks;
+                continue;
+            }
+            bool running = batch.running();
+            float done = batch.progress();
+            if (!batch.started && (done > 0.0f || !running)) {
+                batch.started = true;
+                batch.began = last_poll;
+            }
+            progress += done * batch.tracks;
+            if (running) continue;
+
+            batch.finished = true;
+            ++finished;
+            failed_tracks += batch.failed();
+            if (batch.finish && !batch.finish()) {
+                fprintf(stderr, "\rbatch: %s: failed to write the %s\n", batch.file.c_str(), batch.kind.c_str());
+                ++failed_tracks;
+            }
+            report(batch);
+        }
+        if (finished == static_cast<int>(batches.size())) break;
+        last_poll = poll;
+
+        int weight = 0;
+        for (const Batch& batch : batches) weight += batch.tracks;
+        fprintf(stderr, "\rbatch: %d/%d done, %3.0f%%", finished, static_cast<int>(batches.size()),
+                weight > 0 ? progress * 100.0f / weight : 0.0f);
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
+
+    double seconds = secondsSince(started);
+    fprintf(stderr, "batch: %d files, %d tracks, %.0f s of audio in %.1f s (%.0fx realtime)\n",
+            static_cast<int>(files.size()) - failed_files, total_tracks, total_audio, seconds,
+            seconds > 0.0 ? total_audio / seconds : 0.0);
+    batches.clear();
+    jobs.shutdown();
+    return failed_files > 0 || failed_tracks > 0 ? 1 : 0;
+}
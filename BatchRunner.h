@@ -0,0 +1,16 @@
+#pragma once
+
+// "--batch FILE... [options]": the File menu's exports, the video renderer
+// and a per-track analysis (length, loudness, playback gain as JSON) for a
+// list of music files, run on one JobSystem without opening a window or an
+// audio device, for export farms. Every file and output kind is its own
+// batch of track jobs, all queued at once so the workers stay busy across
+// files; each batch reports its throughput (seconds of audio per second) as
+// it finishes.
+class BatchRunner {
+public:
+    static bool isCommandLine(int argc, char* argv[]);
+
+    // Returns the process exit code: 1 if any track failed
+    static int runCommandLine(int argc, char* argv[]);
+};
@@ -0,0 +1,116 @@
+#include "CanvasJobs.h"
+#include <algorithm>
+#include <cstring>
+
+CanvasJobs::~CanvasJobs() {
+    for (int i = 0; i < active_; ++i) {
+        if (canvases_[i]->job) jobs_.wait(canvases_[i]->job);
+    }
+}
+
+void CanvasJobs::submit(Build build) {
+    if (active_ == static_cast<int>(canvases_.size())) canvases_.push_back(std::make_unique<Canvas>());
+    Canvas& canvas = *canvases_[active_++];
+    canvas.target = ImGui::GetWindowDrawList();
+    canvas.build = std::move(build);
+
+    copySharedData(*ImGui::GetDrawListSharedData(), canvas.shared, canvas.tex_uv_lines);
+
+    ImDrawList& list = canvas.list;
+    list._ResetForNewFrame();
+    list.PushClipRect(canvas.target->GetClipRectMin(), canvas.target->GetClipRectMax());
+    list.PushTexture(canvas.target->_CmdHeader.TexRef);
+
+    addMarker(*canvas.target, &canvas);
+    Canvas* job_canvas = &canvas;
+    canvas.job = jobs_.submit([job_canvas](const Job&) { job_canvas->build(job_canvas->list); });
+}
+
+void CanvasJobs::splice() {
+    for (int i = 0; i < active_; ++i) {
+        Canvas& canvas = *canvases_[i];
+        jobs_.wait(canvas.job);
+        canvas.job.reset();
+        canvas.build = nullptr;
+        spliceAt(*canvas.target, canvas.list, &canvas);
+    }
+    active_ = 0;
+}
+
+void CanvasJobs::copySharedData(const ImDrawListSharedData& source, ImDrawListSharedData& shared,
+                                ImVec4* tex_uv_lines) {
+    shared.TexUvWhitePixel = source.TexUvWhitePixel;
+    if (source.TexUvLines) {
+        memcpy(tex_uv_lines, source.TexUvLines, sizeof(ImVec4) * (IM_DRAWLIST_TEX_LINES_WIDTH_MAX + 1));
+        shared.TexUvLines = tex_uv_lines;
+    }
+    shared.FontAtlas = source.FontAtlas;
+    shared.Font = source.Font;
+    shared.FontSize = source.FontSize;
+    shared.FontScale = source.FontScale;
+    shared.CurveTessellationTol = source.CurveTessellationTol;
+    if (shared.CircleSegmentMaxError != source.CircleSegmentMaxError) {
+        shared.SetCircleTessellationMaxError(source.CircleSegmentMaxError);
+    }
+    shared.InitialFringeScale = source.InitialFringeScale;
+    shared.InitialFlags = source.InitialFlags;
+    shared.ClipRectFullscreen = source.ClipRectFullscreen;
+}
+
+void CanvasJobs::spliceAt(ImDrawList& target, ImDrawList& canvas, const void* key, ImVec2 offset) {
+    int at = -1;
+    for (int i = 0; i < target.CmdBuffer.Size; ++i) {
+        const ImDrawCmd& cmd = target.CmdBuffer[i];
+        if (cmd.UserCallback == marker && cmd.UserCallbackData == key) {
+            at = i;
+            break;
+        }
+    }
+    if (at < 0) return;
+    const ImVec4 clip = target.CmdBuffer[at].ClipRect;
+
+    // The canvas's vertices and indices go after the window's; each command
+    // names its own offsets, so only its own need moving
+    canvas._PopUnusedDrawCmd();
+    unsigned int vtx_base = static_cast<unsigned int>(target.VtxBuffer.Size);
+    unsigned int idx_base = static_cast<unsigned int>(target.IdxBuffer.Size);
+    int data_base = target._CallbacksDataBuf.Size;
+    target.VtxBuffer.resize(target.VtxBuffer.Size + canvas.VtxBuffer.Size);
+    if (canvas.VtxBuffer.Size) {
+        memcpy(target.VtxBuffer.Data + vtx_base, canvas.VtxBuffer.Data, canvas.VtxBuffer.size_in_bytes());
+    }
+    if (offset.x != 0.0f || offset.y != 0.0f) {
+        for (int i = vtx_base; i < target.VtxBuffer.Size; ++i) {
+            target.VtxBuffer[i].pos.x += offset.x;
+            target.VtxBuffer[i].pos.y += offset.y;
+        }
+    }
+    target.IdxBuffer.resize(target.IdxBuffer.Size + canvas.IdxBuffer.Size);
+    if (canvas.IdxBuffer.Size) {
+        memcpy(target.IdxBuffer.Data + idx_base, canvas.IdxBuffer.Data, canvas.IdxBuffer.size_in_bytes());
+    }
+    target._CallbacksDataBuf.resize(data_base + canvas._CallbacksDataBuf.Size);
+    if (canvas._CallbacksDataBuf.Size) {
+        memcpy(target._CallbacksDataBuf.Data + data_base, canvas._CallbacksDataBuf.Data, canvas._CallbacksDataBuf.Size);
+    }
+    // ImGui::Render() checks that the write pointers reached the ends
+    target._VtxWritePtr = target.VtxBuffer.Data + target.VtxBuffer.Size;
+    target._IdxWritePtr = target.IdxBuffer.Data + target.IdxBuffer.Size;
+
+    ImVector<ImDrawCmd> merged;
+    merged.reserve(target.CmdBuffer.Size - 1 + canvas.CmdBuffer.Size);
+    for (int i = 0; i < at; ++i) merged.push_back(target.CmdBuffer[i]);
+    for (ImDrawCmd cmd : canvas.CmdBuffer) {
+        if (cmd.ElemCount == 0 && cmd.UserCallback == nullptr) continue;
+        cmd.VtxOffset += vtx_base;
+        cmd.IdxOffset += idx_base;
+        if (cmd.UserCallbackDataOffset >= 0) cmd.UserCallbackDataOffset += data_base;
+        cmd.ClipRect.x = std::clamp(cmd.ClipRect.x + offset.x, clip.x, clip.z);
+        cmd.ClipRect.y = std::clamp(cmd.ClipRect.y + offset.y, clip.y, clip.w);
+        cmd.ClipRect.z = std::clamp(cmd.ClipRect.z + offset.x, cmd.ClipRect.x, clip.z);
+        cmd.ClipRect.w = std::clamp(cmd.ClipRect.w + offset.y, cmd.ClipRect.y, clip.w);
+        merged.push_back(cmd);
+    }
+    for (int i = at + 1; i < target.CmdBuffer.Size; ++i) merged.push_back(target.CmdBuffer[i]);
+    target.CmdBuffer.swap(merged);
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include "JobSystem.h"
+#include "imgui.h"
+#include "imgui_internal.h"
+#include <functional>
+#include <memory>
+#include <vector>
+
+// Builds the heavy canvases of the visualizer windows (scopes, the CPU
+// piano roll and spectrum bars) on the job system's workers while the UI
+// thread lays out the rest of the frame. Each canvas gets a draw list of its
+// own and leaves a marker in its window's list where it was submitted;
+// splice() waits for the builds and puts each list's commands in place of
+// its marker, so a canvas draws in order with whatever its window draws
+// before and after it.
+//
+// A build function gets an empty list with the window's clip rect and font
+// texture pushed. It runs on another thread, so it must not call ImGui::
+// functions or draw text (glyphs are baked into the atlas on first use);
+// whatever it draws it captures by value. UI thread only, apart from the
+// builds themselves.
+class CanvasJobs {
+public:
+    using Build = std::function<void(ImDrawList& draw_list)>;
+
+    explicit CanvasJobs(JobSystem& jobs) : jobs_(jobs) {}
+    ~CanvasJobs();
+    CanvasJobs(const CanvasJobs&) = delete;
+    CanvasJobs& operator=(const CanvasJobs&) = delete;
+
+    // Inside a window, between ImGui::NewFrame() and splice()
+    void submit(Build build);
+
+    // After the last window and before simgui_render()
+    void splice();
+
+    int canvasCount() const { return active_; }   // submitted this frame
+
+    // For lists built apart from a frame's windows (PluginHost): this
+    // frame's drawing state, copied so nothing the UI thread does to the
+    // font atlas reaches the builder; tex_uv_lines holds
+    // IM_DRAWLIST_TEX_LINES_WIDTH_MAX + 1 entries
+    static void copySharedData(const ImDrawListSharedData& source, ImDrawListSharedData& shared, ImVec4* tex_uv_lines);
+    // Leave a marker at the current spot of 'target'; spliceAt() later puts
+    // 'canvas''s commands in its place, moved by 'offset' and clipped to the
+    // clip rect the marker was added under
+    static void addMarker(ImDrawList& target, const void* key) { target.AddCallback(marker, const_cast<void*>(key)); }
+    static void spliceAt(ImDrawList& target, ImDrawList& canvas, const void* key, ImVec2 offset = ImVec2(0.0f, 0.0f));
+
+private:
+    struct Canvas {
+        ImDrawListSharedData shared;    // before 'list', which registers with it
+        ImVec4 tex_uv_lines[IM_DRAWLIST_TEX_LINES_WIDTH_MAX + 1];
+        ImDrawList list{&shared};
+        ImDrawList* target = nullptr;
+        Build build;
+        JobHandle job;
+    };
+
+    static void marker(const ImDrawList*, const ImDrawCmd*) {}
+
+    JobSystem& jobs_;
+    std::vector<std::unique_ptr<Canvas>> canvases_;   // reused from frame to frame
+    int active_ = 0;
+};
+
+// Build a canvas through 'jobs', or straight into the current window's list
+// when there are none
+inline void BuildCanvas(CanvasJobs* jobs, CanvasJobs::Build build) {
+    if (jobs) {
+        jobs->submit(std::move(build));
+    } else {
+        build(*ImGui::GetWindowDrawList());
+    }
+}
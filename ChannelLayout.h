@@ -0,0 +1,170 @@
+#pragma once
+
+#include <cstdint>
+
+// Kind of oscillator behind a visualized channel
+enum class ChannelKind : uint8_t {
+    Square,         // APU pulse
+    Triangle,
+    Noise,
+    DMC,
+    Vrc6Pulse,
+    Vrc6Saw,
+    Fme7Square,     // Sunsoft 5B tone channel
+    NamcoWave,      // Namco 163 wavetable channel
+    Voice           // Voice of any other gme format, read through Music_Emu::voice_states
+};
+
+// The channels of the sound chips a track uses, in display order: the five
+// APU channels, then VRC6, Sunsoft 5B (FME7) and Namco 163 when present.
+// ApuFrameSnapshot::capture fills its channels in the same order. Other
+// formats get one Voice channel per gme voice (buildVoices). Built once
+// when a file is loaded; the visualizers size their per-channel state from it.
+struct ChannelLayout {
+    // Expansion chips, numbered like the NSF header's chip flags
+    enum Chip : uint8_t { VRC6 = 0x01, VRC7 = 0x02, FDS = 0x04, MMC5 = 0x08, NAMCO = 0x10, FME7 = 0x20 };
+
+    static constexpr int BASE_CHANNELS = 5;
+    static constexpr int MAX_CHANNELS = BASE_CHANNELS + 3 + 3 + 8;
+
+    struct Channel {
+        ChannelKind kind = ChannelKind::Square;
+        int osc = 0;                // Oscillator index within its chip
+        int voice = -1;             // gme voice (mute bit, voice scope), -1 if none
+        const char* name = "";
+        const char* short_name = "";
+        uint32_t rgb = 0;           // 0xRRGGBB
+    };
+
+    Channel channels[MAX_CHANNELS];
+    int count = 0;
+    uint8_t chips = 0;              // Chips with channels in the layout
+    uint8_t unemulated = 0;         // Chips the file declares that gme doesn't emulate
+    const char* const* voice_names = nullptr;  // buildVoices: the emulator's name table
+
+    int size() const { return count; }
+    const Channel& operator[](int i) const { return channels[i]; }
+    bool operator==(const ChannelLayout& other) const {
+        return count == other.count && chips == other.chips && unemulated == other.unemulated &&
+               voice_names == other.voice_names;
+    }
+    bool operator!=(const ChannelLayout& other) const { return !(*this == other); }
+
+    // Layout index of a gme voice, -1 if no channel uses it
+    int channelForVoice(int voice) const {
+        for (int i = 0; i < count; ++i) {
+            if (channels[i].voice == voice) return i;
+        }
+        return -1;
+    }
+
+    static const char* chipName(Chip chip) {
+        switch (chip) {
+            case VRC6: return "VRC6";
+            case VRC7: return "VRC7";
+            case FDS: return "FDS";
+            case MMC5: return "MMC5";
+            case NAMCO: return "N163";
+            case FME7: return "5B";
+        }
+        return "?";
+    }
+
+    // chips: the expansion chips being emulated; declared: the file's chip
+    // flags, so chips it uses that have no channels here can be reported.
+    // Voice numbers follow Nsf_Emu::set_voice: the APU first, then either the
+    // 5B or VRC6 (saw first) followed by Namco. gme can't address VRC6 or Namco
+    // alongside the 5B, so those channels get no voice.
+    static ChannelLayout build(uint8_t chips, uint8_t declared = 0) {
+        ChannelLayout layout;
+        layout.chips = chips & (VRC6 | NAMCO | FME7);
+        layout.unemulated = (declared | chips) & ~layout.chips;
+
+        static const char* const apu_names[] = {"Square 1", "Square 2", "Triangle", "Noise", "DMC"};
+        static const char* const apu_short[] = {"Sq1", "Sq2", "Tri", "Noi", "DMC"};
+        static const ChannelKind apu_kinds[] = {
+            ChannelKind::Square, ChannelKind::Square, ChannelKind::Triangle, ChannelKind::Noise, ChannelKind::DMC
+        };
+        static const uint32_t apu_colors[] = {0xFF4D4D, 0xFF9933, 0x4DB3FF, 0xE64DE6, 0xE6E64D};
+        for (int i = 0; i < BASE_CHANNELS; ++i) {
+            layout.add(apu_kinds[i], i, i, apu_names[i], apu_short[i], apu_colors[i]);
+        }
+
+        bool fme7 = (chips & FME7) != 0;
+        int next_voice = BASE_CHANNELS;
+        if (chips & VRC6) {
+            static const char* const names[] = {"VRC6 Pulse1", "VRC6 Pulse2", "VRC6 Saw"};
+            static const char* const short_names[] = {"V-P1", "V-P2", "V-Saw"};
+            static const uint32_t colors[] = {0x33E680, 0x66E6B3, 0x9966E6};
+            static const int voices[] = {1, 2, 0};
+            for (int i = 0; i < 3; ++i) {
+                layout.add(i < 2 ? ChannelKind::Vrc6Pulse : ChannelKind::Vrc6Saw, i,
+                           fme7 ? -1 : next_voice + voices[i], names[i], short_names[i], colors[i]);
+            }
+            next_voice += 3;
+        }
+        if (fme7) {
+            static const char* const names[] = {"5B Square A", "5B Square B", "5B Square C"};
+            static const char* const short_names[] = {"5B-A", "5B-B", "5B-C"};
+            static const uint32_t colors[] = {0xFF6699, 0xFF8CB3, 0xFFB3CC};
+            for (int i = 0; i < 3; ++i) {
+                layout.add(ChannelKind::Fme7Square, i, BASE_CHANNELS + i, names[i], short_names[i], colors[i]);
+            }
+        }
+        if (chips & NAMCO) {
+            static const char* const names[] = {
+                "N163 Wave 1", "N163 Wave 2", "N163 Wave 3", "N163 Wave 4",
+                "N163 Wave 5", "N163 Wave 6", "N163 Wave 7", "N163 Wave 8"
+            };
+            static const char* const short_names[] = {"N1", "N2", "N3", "N4", "N5", "N6", "N7", "N8"};
+            static const uint32_t colors[] = {
+                0xE6B34D, 0xCCCC4D, 0xB3E64D, 0x80E666, 0x4DE699, 0x4DCCCC, 0x6699E6, 0x9980E6
+            };
+            for (int i = 0; i < 8; ++i) {
+                layout.add(ChannelKind::NamcoWave, i, fme7 ? -1 : next_voice + i, names[i], short_names[i], colors[i]);
+            }
+        }
+        return layout;
+    }
+
+    // One channel per gme voice, named as the emulator names them; count is
+    // its voice_count(). ApuFrameSnapshot::captureVoices fills them.
+    static ChannelLayout buildVoices(const char* const* names, int count) {
+        static const uint32_t colors[] = {
+            0xFF4D4D, 0xFF9933, 0x4DB3FF, 0xE64DE6, 0xE6E64D, 0x33E680, 0x9966E6, 0xE6B34D
+        };
+        ChannelLayout layout;
+        layout.voice_names = names;
+        int voices = count < MAX_CHANNELS ? count : MAX_CHANNELS;
+        for (int i = 0; i < voices; ++i) {
+            const char* name = names && names[i] ? names[i] : "Voice";
+            layout.add(ChannelKind::Voice, i, i, name, name, colors[i % 8]);
+        }
+        return layout;
+    }
+
+    // One channel per pitch tracked in a mix (PitchTracker), highest first;
+    // no gme voice plays them alone
+    static ChannelLayout buildPitches(int count) {
+        static const char* const names[] = {"Pitch 1", "Pitch 2", "Pitch 3", "Pitch 4"};
+        static const char* const short_names[] = {"P1", "P2", "P3", "P4"};
+        static const uint32_t colors[] = {0xFF4D4D, 0x4DB3FF, 0x33E680, 0xE6B34D};
+        ChannelLayout layout;
+        int pitches = count < 4 ? count : 4;
+        for (int i = 0; i < pitches; ++i) {
+            layout.add(ChannelKind::Voice, i, -1, names[i], short_names[i], colors[i]);
+        }
+        return layout;
+    }
+
+private:
+    void add(ChannelKind kind, int osc, int voice, const char* name, const char* short_name, uint32_t rgb) {
+        Channel& channel = channels[count++];
+        channel.kind = kind;
+        channel.osc = osc;
+        channel.voice = voice;
+        channel.name = name;
+        channel.short_name = short_name;
+        channel.rgb = rgb;
+    }
+};
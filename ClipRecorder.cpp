@@ -0,0 +1,226 @@
+#include "ClipRecorder.h"
+#include "AudioExport.h"
+#include "MidiExport.h"
+#include "PianoVisualizer.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <system_error>
+
+const std::string& ClipRecorder::directory() {
+    static const std::string dir = []() -> std::string {
+        namespace fs = std::filesystem;
+        fs::path base;
+#if defined(_WIN32)
+        if (const char* app_data = std::getenv("APPDATA")) base = app_data;
+#elif defined(__APPLE__)
+        if (const char* home = std::getenv("HOME")) base = fs::path(home) / "Library" / "Application Support";
+#else
+        if (const char* xdg = std::getenv("XDG_DATA_HOME")) base = xdg;
+        else if (const char* home = std::getenv("HOME")) base = fs::path(home) / ".local" / "share";
+#endif
+        if (base.empty()) return std::string();
+
+        fs::path path = base / "imgui_fc_visualizer" / "clips";
+        std::error_code ec;
+        fs::create_directories(path, ec);
+        if (ec) return std::string();
+        return path.string();
+    }();
+    return dir;
+}
+
+void ClipRecorder::setSampleRate(long sample_rate) {
+    std::lock_guard<std::mutex> lock(ring_mutex_);
+    if (sample_rate <= 0 || sample_rate == sample_rate_) return;
+    sample_rate_ = sample_rate;
+    capacity_ = static_cast<uint64_t>(SECONDS + MARGIN_SECONDS) * sample_rate;
+    audio_.assign(capacity_ * 2, 0.0f);
+    audio_begin_.store(NONE, std::memory_order_relaxed);
+    audio_end_.store(0, std::memory_order_relaxed);
+}
+
+void ClipRecorder::writeAudio(const float* samples, int frames, uint64_t position) {
+    if (capacity_ == 0 || frames <= 0) return;
+    if (audio_begin_.load(std::memory_order_relaxed) == NONE) audio_begin_.store(position, std::memory_order_relaxed);
+    size_t at = static_cast<size_t>(position % capacity_);
+    size_t first = std::min<size_t>(frames, capacity_ - at);
+    std::memcpy(&audio_[at * 2], samples, first * 2 * sizeof(float));
+    if (first < static_cast<size_t>(frames)) {
+        std::memcpy(audio_.data(), samples + first * 2, (frames - first) * 2 * sizeof(float));
+    }
+    audio_end_.store(position + frames, std::memory_order_release);
+}
+
+void ClipRecorder::writeSnapshot(const ApuFrameSnapshot& snapshot, uint64_t frame) {
+    uint64_t count = snapshot_count_.load(std::memory_order_relaxed);
+    Entry& entry = snapshots_[count % SNAPSHOTS];
+    entry.frame = frame;
+    entry.snapshot = snapshot;
+    snapshot_count_.store(count + 1, std::memory_order_release);
+}
+
+bool ClipRecorder::copyOut(uint64_t heard, Clip& clip) {
+    std::lock_guard<std::mutex> lock(ring_mutex_);
+    uint64_t valid = audio_begin_.load(std::memory_order_acquire);
+    uint64_t end = std::min(heard, audio_end_.load(std::memory_order_acquire));
+    if (valid == NONE || end <= valid) return false;
+    uint64_t window = static_cast<uint64_t>(SECONDS) * sample_rate_;
+    uint64_t begin = std::max(valid, end > window ? end - window : 0);
+
+    clip.sample_rate = sample_rate_;
+    clip.audio.resize(static_cast<size_t>(end - begin) * 2);
+    for (uint64_t frame = begin; frame < end; ++frame) {
+        const float* in = &audio_[static_cast<size_t>(frame % capacity_) * 2];
+        short* out = &clip.audio[static_cast<size_t>(frame - begin) * 2];
+        out[0] = static_cast<short>(std::clamp(std::lround(in[0] * 32767.0f), -32768L, 32767L));
+        out[1] = static_cast<short>(std::clamp(std::lround(in[1] * 32767.0f), -32768L, 32767L));
+    }
+
+    uint64_t count = snapshot_count_.load(std::memory_order_acquire);
+    uint64_t oldest = count > SNAPSHOTS - SNAPSHOT_MARGIN ? count - (SNAPSHOTS - SNAPSHOT_MARGIN) : 0;
+    std::vector<Entry> entries;
+    entries.reserve(static_cast<size_t>(count - oldest));
+    for (uint64_t seq = oldest; seq < count; ++seq) entries.push_back(snapshots_[seq % SNAPSHOTS]);
+
+    // The writer kept going while this copied: whatever it may have reached
+    // since is dropped (a second of audio, the margin of entries)
+    std::atomic_thread_fence(std::memory_order_acquire);
+    uint64_t audio_lapped = audio_end_.load(std::memory_order_relaxed) + sample_rate_;
+    if (audio_lapped > begin + capacity_) {
+        size_t skip = static_cast<size_t>(std::min(audio_lapped - capacity_ - begin, end - begin));
+        clip.audio.erase(clip.audio.begin(), clip.audio.begin() + skip * 2);
+        begin += skip;
+    }
+    uint64_t entries_lapped = snapshot_count_.load(std::memory_order_relaxed) + SNAPSHOT_MARGIN;
+    if (entries_lapped > oldest + SNAPSHOTS) {
+        size_t skip = static_cast<size_t>(std::min<uint64_t>(entries_lapped - SNAPSHOTS - oldest, entries.size()));
+        entries.erase(entries.begin(), entries.begin() + skip);
+    }
+    clip.begin = begin;
+    if (clip.audio.empty()) return false;
+
+    // The state at the clip's start, then the ones heard during it
+    clip.snapshots.clear();
+    for (const Entry& entry : entries) {
+        if (entry.frame >= end) continue;
+        if (entry.frame <= begin && !clip.snapshots.empty() && clip.snapshots.back().frame <= begin) {
+            clip.snapshots.back() = entry;
+        } else {
+            clip.snapshots.push_back(entry);
+        }
+    }
+    return true;
+}
+
+std::vector<PianoRollNote> ClipRecorder::notesOf(const Clip& clip) {
+    std::vector<PianoRollNote> notes;
+    const float duration = static_cast<float>(clip.audio.size() / 2) / clip.sample_rate;
+    int channels = std::min(clip.layout.size(), ChannelLayout::MAX_CHANNELS);
+    for (int ch = 0; ch < channels; ++ch) {
+        PianoRollNote open{ch, -1, 0.0f, 0.0f, 0.0f};
+        for (const Entry& entry : clip.snapshots) {
+            float time = entry.frame > clip.begin
+                       ? static_cast<float>(entry.frame - clip.begin) / clip.sample_rate : 0.0f;
+            int note = -1;
+            float velocity = 0.0f;
+            if (!entry.snapshot.active || ch >= entry.snapshot.channel_count ||
+                !PianoVisualizer::channelNote(clip.layout, entry.snapshot, ch, &note, &velocity)) {
+                note = -1;
+            }
+            if (note == open.midi_note) continue;
+            if (open.midi_note >= 0 && time > open.start_time) {
+                open.end_time = time;
+                notes.push_back(open);
+            }
+            open = PianoRollNote{ch, note, velocity, time, time};
+        }
+        if (open.midi_note >= 0 && duration > open.start_time) {
+            open.end_time = duration;
+            notes.push_back(open);
+        }
+    }
+    return notes;
+}
+
+bool ClipRecorder::save(uint64_t heard, const ChannelLayout& layout, const std::string& name_base, bool video,
+                        const VideoRenderer::Settings& settings) {
+    if (isSaving()) return false;
+    const std::string& dir = directory();
+    if (dir.empty()) {
+        finish("No directory to save clips in");
+        return false;
+    }
+    if (audio_begin_.load(std::memory_order_acquire) == NONE) {
+        finish("Nothing recorded yet");
+        return false;
+    }
+
+    auto clip = std::make_shared<Clip>();
+    clip->layout = layout;
+    std::string base = (std::filesystem::path(dir) / name_base).string();
+    finish(std::string());
+    job_ = jobs_.submit([this, clip, heard, base, video, settings](const Job& job) {
+        if (!copyOut(heard, *clip)) {
+            finish("Nothing recorded to save");
+            return;
+        }
+
+        std::string wav_path = base + ".wav";
+        std::unique_ptr<AudioFileWriter> writer = AudioFileWriter::create(ExportFormat::WAV);
+        bool ok = writer->open(wav_path, clip->sample_rate, 2) &&
+                  writer->write(clip->audio.data(), static_cast<long>(clip->audio.size() / 2));
+        ok = writer->close() && ok;
+        if (!ok) {
+            std::error_code ec;
+            std::filesystem::remove(wav_path, ec);
+            finish("Failed to write " + wav_path);
+            return;
+        }
+
+        std::vector<PianoRollNote> notes = notesOf(*clip);
+        std::string midi_path = base + ".mid";
+        MidiFileWriter midi;
+        ok = midi.open(midi_path, clip->layout, std::filesystem::path(base).filename().string().c_str());
+        if (ok) {
+            for (const PianoRollNote& note : notes) midi.addNote(note);
+        }
+        if (!midi.close() || !ok) {
+            finish("Failed to write " + midi_path);
+            return;
+        }
+
+        if (video) {
+            std::string error;
+            std::string video_path = base + "." + settings.extension;
+            if (!VideoRenderer::renderClip(clip->audio, clip->sample_rate, clip->layout, std::move(notes), settings,
+                                           video_path, job, error)) {
+                finish("Saved " + wav_path + " and the MIDI file; video: " + error);
+                return;
+            }
+        }
+        char seconds[32];
+        snprintf(seconds, sizeof(seconds), "%.1f s", static_cast<double>(clip->audio.size() / 2) / clip->sample_rate);
+        finish(std::string("Saved ") + seconds + " to " + base + (video ? " (.wav, .mid, video)" : " (.wav, .mid)"));
+    }, JobPriority::BATCH, "Clip save");
+    return true;
+}
+
+void ClipRecorder::cancel() {
+    if (!job_) return;
+    job_->cancel();
+    job_->wait();
+    job_.reset();
+}
+
+void ClipRecorder::finish(std::string status) {
+    std::lock_guard<std::mutex> lock(status_mutex_);
+    status_ = std::move(status);
+}
+
+std::string ClipRecorder::status() const {
+    std::lock_guard<std::mutex> lock(status_mutex_);
+    return status_;
+}
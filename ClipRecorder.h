@@ -0,0 +1,96 @@
+#pragma once
+
+#include "ApuSnapshot.h"
+#include "ChannelLayout.h"
+#include "JobSystem.h"
+#include "VideoRenderer.h"
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// The last SECONDS of the NSF player's mix and channel states, always
+// recorded, so what just played can be saved as a clip (File > Save Clip,
+// F9) without playing it again: a WAV, a MIDI file of the notes and,
+// optionally, a video of the roll and scope. Both rings are allocated up
+// front; the synthesis thread copies each chunk in with one memcpy (two
+// where it wraps) and each play call's state with another, and publishes
+// how far it got. A save takes the window ending where the speakers are and
+// copies it out on a job, which then drops whatever the writer lapped
+// meanwhile; the rings hold MARGIN_SECONDS more than the window, so it
+// never has unless the job stalled for that long.
+//
+// Positions are the audio ring's frames, which the snapshots are stamped
+// with. A seek's stale audio is kept as it was synthesized.
+class ClipRecorder {
+public:
+    static constexpr int SECONDS = 30;
+    static constexpr int MARGIN_SECONDS = 2;
+    static constexpr int SNAPSHOTS = 8192;      // play calls: 32 s at 240 Hz with room
+
+    explicit ClipRecorder(JobSystem& jobs) : jobs_(jobs) {}
+    ~ClipRecorder() { cancel(); }
+
+    ClipRecorder(const ClipRecorder&) = delete;
+    ClipRecorder& operator=(const ClipRecorder&) = delete;
+
+    // Size the audio ring for 'sample_rate', forgetting what it held. Only
+    // while the writer is kept out (audio_mutex); waits for a save's copy.
+    void setSampleRate(long sample_rate);
+
+    // Writer (synthesis thread). 'position' is the audio ring frame the
+    // chunk starts at; 'frame' the one the state is heard from.
+    void writeAudio(const float* samples, int frames, uint64_t position);
+    void writeSnapshot(const ApuFrameSnapshot& snapshot, uint64_t frame);
+
+    // UI thread: save the SECONDS before ring frame 'heard' into directory()
+    // as name_base plus the extensions, on a job. False while one is saving
+    // or nothing was recorded.
+    bool save(uint64_t heard, const ChannelLayout& layout, const std::string& name_base, bool video,
+              const VideoRenderer::Settings& settings);
+    void cancel();
+    bool isSaving() const { return job_ && !job_->isDone(); }
+    // The last save's outcome, empty before the first
+    std::string status() const;
+
+    // Per-user directory (created on demand), empty if unavailable
+    static const std::string& directory();
+
+private:
+    static constexpr uint64_t NONE = ~0ull;
+    static constexpr int SNAPSHOT_MARGIN = 64;  // entries a save leaves to the writer
+
+    struct Entry {
+        uint64_t frame = 0;
+        ApuFrameSnapshot snapshot;
+    };
+
+    // A window copied out of the rings
+    struct Clip {
+        long sample_rate = 0;
+        uint64_t begin = 0;             // ring frame of the first sample
+        std::vector<short> audio;       // interleaved stereo
+        std::vector<Entry> snapshots;   // in push order
+        ChannelLayout layout = ChannelLayout::build(0);
+    };
+
+    bool copyOut(uint64_t heard, Clip& clip);
+    static std::vector<PianoRollNote> notesOf(const Clip& clip);
+    void finish(std::string status);
+
+    JobSystem& jobs_;
+    std::mutex ring_mutex_;             // setSampleRate against a save's copy, never the writer
+    std::vector<float> audio_;          // capacity_ stereo frames
+    uint64_t capacity_ = 0;
+    long sample_rate_ = 0;
+    std::atomic<uint64_t> audio_begin_{NONE};   // ring frame of the first one written since setSampleRate
+    std::atomic<uint64_t> audio_end_{0};        // after the last one written
+    std::unique_ptr<Entry[]> snapshots_{new Entry[SNAPSHOTS]};
+    std::atomic<uint64_t> snapshot_count_{0};
+
+    JobHandle job_;
+    mutable std::mutex status_mutex_;
+    std::string status_;
+};
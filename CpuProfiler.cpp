@@ -0,0 +1,268 @@
+#include "CpuProfiler.h"
+#include "gme/Nsf_Emu.h"
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+
+#ifndef NES_HEADLESS
+#include "imgui.h"
+#endif
+
+// Storage the cores count into, allocated on first use (about 1.3 MB)
+struct CpuProfiler::Counters {
+    std::vector<uint64_t> pc_cycles = std::vector<uint64_t>(ADDRESSES);
+    std::vector<uint64_t> routine_cycles = std::vector<uint64_t>(ADDRESSES);
+    std::vector<uint32_t> routine_calls = std::vector<uint32_t>(ADDRESSES);
+    std::vector<uint32_t> frame_cycles = std::vector<uint32_t>(FRAME_HISTORY);
+
+#if GME_CPU_PROFILE
+    Nes_Cpu::profile_t nsf = {};
+#endif
+#if AGNES_CPU_PROFILE
+    agnes_cpu_profile_t nes = {};
+#endif
+
+    void clear() {
+        std::fill(pc_cycles.begin(), pc_cycles.end(), 0);
+        std::fill(routine_cycles.begin(), routine_cycles.end(), 0);
+        std::fill(routine_calls.begin(), routine_calls.end(), 0);
+#if GME_CPU_PROFILE
+        nsf = {};
+        nsf.pc_cycles = reinterpret_cast<unsigned long long*>(pc_cycles.data());
+        nsf.routine_cycles = reinterpret_cast<unsigned long long*>(routine_cycles.data());
+        nsf.routine_calls = routine_calls.data();
+        nsf.frame_cycles = frame_cycles.data();
+        nsf.frame_capacity = FRAME_HISTORY;
+#endif
+#if AGNES_CPU_PROFILE
+        nes = {};
+        nes.pc_cycles = pc_cycles.data();
+        nes.routine_cycles = routine_cycles.data();
+        nes.routine_calls = routine_calls.data();
+        nes.frame_cycles = frame_cycles.data();
+        nes.frame_capacity = FRAME_HISTORY;
+#endif
+    }
+};
+
+#if GME_CPU_PROFILE
+static_assert(sizeof(unsigned long long) == sizeof(uint64_t) && sizeof(unsigned) == sizeof(uint32_t),
+              "gme's profile counters share the arrays");
+#endif
+
+CpuProfiler::CpuProfiler() = default;
+CpuProfiler::~CpuProfiler() = default;
+
+bool CpuProfiler::isCompiledIn() {
+    return GME_CPU_PROFILE && AGNES_CPU_PROFILE;
+}
+
+CpuProfiler::Snapshot CpuProfiler::snapshot() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return report_;
+}
+
+// Clear the counters when counting starts, moves to another instance or a
+// reset was asked for; true if the caller has to (re)attach them
+bool CpuProfiler::restart(const void* instance, bool attached) {
+    bool reset = reset_.exchange(false, std::memory_order_relaxed);
+    if (attached && instance == attached_ && !reset) return false;
+    if (!counters_) counters_ = std::make_unique<Counters>();
+    counters_->clear();
+    attached_ = instance;
+    frames_since_publish_ = 0;
+    return true;
+}
+
+void CpuProfiler::frame(Nsf_Emu* nsf, double budget) {
+#if GME_CPU_PROFILE
+    bool attached = counters_ && nsf->cpu_profile() == &counters_->nsf;
+    if (!enabled()) {
+        if (attached) nsf->set_cpu_profile(nullptr);
+        return;
+    }
+    if (restart(nsf, attached)) nsf->set_cpu_profile(&counters_->nsf);
+    const Nes_Cpu::profile_t& profile = counters_->nsf;
+    publish(profile.clock, profile.frames, budget);
+#else
+    (void)nsf;
+    (void)budget;
+#endif
+}
+
+void CpuProfiler::frame(agnes_t* agnes, double budget) {
+#if AGNES_CPU_PROFILE
+    bool attached = counters_ && agnes_get_cpu_profile(agnes) == &counters_->nes;
+    if (!enabled()) {
+        if (attached) agnes_set_cpu_profile(agnes, nullptr);
+        return;
+    }
+    if (restart(agnes, attached)) agnes_set_cpu_profile(agnes, &counters_->nes);
+    const agnes_cpu_profile_t& profile = counters_->nes;
+    publish(profile.clock, profile.frames, budget);
+#else
+    (void)agnes;
+    (void)budget;
+#endif
+}
+
+void CpuProfiler::publish(uint64_t cycles, uint64_t frames, double budget) {
+    if (++frames_since_publish_ < PUBLISH_FRAMES) return;
+    frames_since_publish_ = 0;
+
+    const Counters& counters = *counters_;
+    auto report = std::make_shared<Report>();
+    report->cycles = cycles;
+    report->frames = frames;
+    report->budget = budget;
+    for (int address = 0; address < ADDRESSES; ++address) {
+        if (counters.pc_cycles[address]) {
+            report->addresses.push_back({static_cast<uint16_t>(address), counters.pc_cycles[address], 0});
+        }
+        if (counters.routine_calls[address]) {
+            report->routines.push_back({static_cast<uint16_t>(address), counters.routine_cycles[address],
+                                        counters.routine_calls[address]});
+        }
+    }
+    auto most_cycles = [](const Hotspot& a, const Hotspot& b) { return a.cycles > b.cycles; };
+    std::sort(report->addresses.begin(), report->addresses.end(), most_cycles);
+    std::sort(report->routines.begin(), report->routines.end(), most_cycles);
+
+    uint64_t kept = std::min<uint64_t>(frames, FRAME_HISTORY);
+    report->frame_cycles.reserve(kept);
+    for (uint64_t i = frames - kept; i < frames; ++i) {
+        report->frame_cycles.push_back(static_cast<float>(counters.frame_cycles[i % FRAME_HISTORY]));
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    report_ = std::move(report);
+}
+
+bool CpuProfiler::exportJson(const Report& report, const char* path) {
+    FILE* file = std::fopen(path, "w");
+    if (!file) return false;
+    std::fprintf(file, "{\"cycles\":%" PRIu64 ",\"frames\":%" PRIu64 ",\"budget\":%.1f,\n\"addresses\":[",
+                 report.cycles, report.frames, report.budget);
+    for (size_t i = 0; i < report.addresses.size(); ++i) {
+        const Hotspot& spot = report.addresses[i];
+        std::fprintf(file, "%s\n{\"address\":%u,\"cycles\":%" PRIu64 "}", i ? "," : "", spot.address, spot.cycles);
+    }
+    std::fprintf(file, "],\n\"routines\":[");
+    for (size_t i = 0; i < report.routines.size(); ++i) {
+        const Hotspot& spot = report.routines[i];
+        std::fprintf(file, "%s\n{\"address\":%u,\"cycles\":%" PRIu64 ",\"calls\":%u}", i ? "," : "",
+                     spot.address, spot.cycles, spot.calls);
+    }
+    std::fprintf(file, "],\n\"frame_cycles\":[");
+    for (size_t i = 0; i < report.frame_cycles.size(); ++i) {
+        std::fprintf(file, "%s%.0f", i ? "," : "", report.frame_cycles[i]);
+    }
+    std::fprintf(file, "]}\n");
+    return std::fclose(file) == 0;
+}
+
+#ifndef NES_HEADLESS
+
+namespace {
+
+void drawHotspots(const char* id, const std::vector<CpuProfiler::Hotspot>& spots, uint64_t total, bool routines) {
+    ImGuiTableFlags flags = ImGuiTableFlags_RowBg | ImGuiTableFlags_BordersInnerV | ImGuiTableFlags_ScrollY |
+                            ImGuiTableFlags_SizingFixedFit;
+    if (!ImGui::BeginTable(id, routines ? 5 : 3, flags)) return;
+    ImGui::TableSetupScrollFreeze(0, 1);
+    ImGui::TableSetupColumn(routines ? "Entry" : "Address");
+    ImGui::TableSetupColumn("Cycles");
+    ImGui::TableSetupColumn("Share", ImGuiTableColumnFlags_WidthStretch);
+    if (routines) {
+        ImGui::TableSetupColumn("Calls");
+        ImGui::TableSetupColumn("Cycles/call");
+    }
+    ImGui::TableHeadersRow();
+
+    ImGuiListClipper clipper;
+    clipper.Begin(static_cast<int>(spots.size()));
+    while (clipper.Step()) {
+        for (int i = clipper.DisplayStart; i < clipper.DisplayEnd; ++i) {
+            const CpuProfiler::Hotspot& spot = spots[i];
+            float share = total ? static_cast<float>(static_cast<double>(spot.cycles) / total) : 0.0f;
+            ImGui::TableNextRow();
+            ImGui::TableNextColumn();
+            ImGui::Text("$%04X", spot.address);
+            ImGui::TableNextColumn();
+            ImGui::Text("%" PRIu64, spot.cycles);
+            ImGui::TableNextColumn();
+            char overlay[16];
+            std::snprintf(overlay, sizeof(overlay), "%.1f%%", share * 100.0f);
+            ImGui::ProgressBar(share, ImVec2(-1, 0), overlay);
+            if (routines) {
+                ImGui::TableNextColumn();
+                ImGui::Text("%u", spot.calls);
+                ImGui::TableNextColumn();
+                ImGui::Text("%.0f", static_cast<double>(spot.cycles) / spot.calls);
+            }
+        }
+    }
+    ImGui::EndTable();
+}
+
+} // namespace
+
+bool CpuProfiler::drawWindow(const char* title, bool* p_open) {
+    ImGui::SetNextWindowSize(ImVec2(560, 520), ImGuiCond_FirstUseEver);
+    if (!ImGui::Begin(title, p_open)) {
+        ImGui::End();
+        return false;
+    }
+    if (!isCompiledIn()) {
+        ImGui::TextWrapped("Built without the 6502 profiler; configure with -DFC_CPU_PROFILE=ON to count "
+                           "cycles by address and subroutine.");
+        ImGui::End();
+        return false;
+    }
+
+    Snapshot report = snapshot();
+    if (ImGui::Button("Reset")) reset();
+    ImGui::SameLine();
+    bool export_clicked = ImGui::Button("Export...") && report;
+    if (!report) {
+        ImGui::TextDisabled("Waiting for the CPU to run...");
+        ImGui::End();
+        return false;
+    }
+    ImGui::SameLine();
+    ImGui::TextDisabled("%" PRIu64 " cycles over %" PRIu64 " frames", report->cycles, report->frames);
+
+    // Frame call length against the time until the next frame
+    const std::vector<float>& frames = report->frame_cycles;
+    if (!frames.empty()) {
+        float peak = *std::max_element(frames.begin(), frames.end());
+        double sum = 0.0;
+        for (float cycles : frames) sum += cycles;
+        float budget = static_cast<float>(report->budget);
+        char overlay[96];
+        std::snprintf(overlay, sizeof(overlay), "avg %.0f, peak %.0f of %.0f cycles (%.0f%%)",
+                      sum / frames.size(), peak, budget, budget > 0.0f ? peak / budget * 100.0f : 0.0f);
+        ImGui::PlotHistogram("##frames", frames.data(), static_cast<int>(frames.size()), 0, overlay, 0.0f,
+                             std::max(budget, peak), ImVec2(-1, 60));
+        if (ImGui::IsItemHovered(ImGuiHoveredFlags_DelayNormal)) {
+            ImGui::SetTooltip("Cycles per frame call (play routine or NMI handler), the last %d;\n"
+                              "the top of the graph is the frame budget", FRAME_HISTORY);
+        }
+    }
+
+    if (ImGui::BeginTabBar("cpu_profile_tabs")) {
+        if (ImGui::BeginTabItem("Routines")) {
+            drawHotspots("routines", report->routines, report->cycles, true);
+            ImGui::EndTabItem();
+        }
+        if (ImGui::BeginTabItem("Addresses")) {
+            drawHotspots("addresses", report->addresses, report->cycles, false);
+            ImGui::EndTabItem();
+        }
+        ImGui::EndTabBar();
+    }
+    ImGui::End();
+    return export_clicked;
+}
+
+#endif
@@ -0,0 +1,91 @@
+#pragma once
+
+#include "agnes/agnes.h"
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+class Nsf_Emu;
+
+// Hot-address profiler for 6502 code: an NSF's sound driver on gme's
+// Nes_Cpu, or a game on the agnes CPU. Configure with -DFC_CPU_PROFILE=ON
+// and both cores count the cycles of every instruction address, and of
+// every subroutine (callees included), straight into flat arrays indexed by
+// address. Otherwise the counting is compiled out and costs nothing.
+//
+// The thread running the CPU calls frame() once per frame (NSF play call or
+// NES frame): it attaches the counters while the profiler is enabled and,
+// every PUBLISH_FRAMES frames, ranks them into a Report that the UI thread
+// takes under a mutex. A frame's budget is the time before the next one;
+// what the frame call used of it is the play routine's length, or the NMI
+// handler's for a game.
+class CpuProfiler {
+public:
+    static constexpr int ADDRESSES = 0x10000;
+    static constexpr int FRAME_HISTORY = 240;
+    static constexpr int PUBLISH_FRAMES = 15;
+
+    struct Hotspot {
+        uint16_t address;
+        uint64_t cycles;
+        uint32_t calls;     // routines only
+    };
+
+    struct Report {
+        uint64_t cycles = 0;                // counted since the counters were reset
+        uint64_t frames = 0;
+        double budget = 0.0;                // cycles per frame
+        std::vector<Hotspot> addresses;     // every address with cycles, most first
+        std::vector<Hotspot> routines;      // every routine called, most cycles first
+        std::vector<float> frame_cycles;    // the last FRAME_HISTORY frame calls, oldest first
+    };
+    using Snapshot = std::shared_ptr<const Report>;
+
+    CpuProfiler();
+    ~CpuProfiler();
+    CpuProfiler(const CpuProfiler&) = delete;
+    CpuProfiler& operator=(const CpuProfiler&) = delete;
+
+    // Built with FC_CPU_PROFILE
+    static bool isCompiledIn();
+
+    // Any thread; takes effect at the next frame()
+    void setEnabled(bool enabled) { enabled_.store(enabled, std::memory_order_relaxed); }
+    bool enabled() const { return enabled_.load(std::memory_order_relaxed); }
+    void reset() { reset_.store(true, std::memory_order_relaxed); }
+
+    // CPU thread, at each frame boundary. Moving to another instance (a new
+    // track's emulator) restarts the counts; the previous one is not touched
+    // again, so it may already be gone. 'budget' is in CPU cycles.
+    void frame(Nsf_Emu* nsf, double budget);
+    void frame(agnes_t* agnes, double budget);
+
+    // Latest published report; null before the first
+    Snapshot snapshot() const;
+
+#ifndef NES_HEADLESS
+    // Hotspot tables and the per-frame cycle graph of the latest report;
+    // true when Export was clicked
+    bool drawWindow(const char* title, bool* p_open);
+#endif
+
+    // The whole report as JSON, for offline analysis
+    static bool exportJson(const Report& report, const char* path);
+
+private:
+    struct Counters;
+
+    bool restart(const void* instance, bool attached);
+    void publish(uint64_t cycles, uint64_t frames, double budget);
+
+    std::unique_ptr<Counters> counters_;
+    const void* attached_ = nullptr;
+    int frames_since_publish_ = 0;
+    std::atomic<bool> enabled_{false};
+    std::atomic<bool> reset_{false};
+
+    mutable std::mutex mutex_;
+    Snapshot report_;
+};
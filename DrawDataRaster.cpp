@@ -0,0 +1,298 @@
+#include "DrawDataRaster.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+struct Color {
+    float r, g, b, a;   // 0-1
+};
+
+Color unpack(ImU32 c) {
+    return {((c >> IM_COL32_R_SHIFT) & 0xFF) / 255.0f, ((c >> IM_COL32_G_SHIFT) & 0xFF) / 255.0f,
+            ((c >> IM_COL32_B_SHIFT) & 0xFF) / 255.0f, ((c >> IM_COL32_A_SHIFT) & 0xFF) / 255.0f};
+}
+
+Color modulate(const Color& x, const Color& y) {
+    return {x.r * y.r, x.g * y.g, x.b * y.b, x.a * y.a};
+}
+
+// Nearest texel; ImGui's own geometry maps texels 1:1 (glyphs, the white pixel)
+Color sample(const ImTextureData* texture, float u, float v) {
+    int x = std::clamp(static_cast<int>(u * texture->Width), 0, texture->Width - 1);
+    int y = std::clamp(static_cast<int>(v * texture->Height), 0, texture->Height - 1);
+    const unsigned char* p = texture->Pixels + (static_cast<size_t>(y) * texture->Width + x) * texture->BytesPerPixel;
+    if (texture->Format == ImTextureFormat_Alpha8) return {1.0f, 1.0f, 1.0f, p[0] / 255.0f};
+    return {p[0] / 255.0f, p[1] / 255.0f, p[2] / 255.0f, p[3] / 255.0f};
+}
+
+uint8_t channel(float value) {
+    return static_cast<uint8_t>(std::clamp(value, 0.0f, 255.0f) + 0.5f);
+}
+
+// The blend state every ImGui backend uses: colour is src * src_a + dst * (1 - src_a),
+// alpha is src_a + dst_a * (1 - src_a)
+void blend(uint32_t& dst, const Color& src) {
+    if (src.a <= 0.0f) return;
+    float keep = 1.0f - src.a;
+    float r = static_cast<float>((dst >> IM_COL32_R_SHIFT) & 0xFF);
+    float g = static_cast<float>((dst >> IM_COL32_G_SHIFT) & 0xFF);
+    float b = static_cast<float>((dst >> IM_COL32_B_SHIFT) & 0xFF);
+    float a = static_cast<float>((dst >> IM_COL32_A_SHIFT) & 0xFF);
+    dst = IM_COL32(channel(src.r * src.a * 255.0f + r * keep), channel(src.g * src.a * 255.0f + g * keep),
+                   channel(src.b * src.a * 255.0f + b * keep), channel(src.a * 255.0f + a * keep));
+}
+
+// The same blend for one colour over many pixels (most of a frame), in integers
+struct Fill {
+    uint32_t packed;        // stored as is when opaque
+    uint32_t r, g, b, a;    // premultiplied, 0 - 255 * 255
+    uint32_t keep;          // 255 - alpha
+    bool opaque;
+    bool empty;
+};
+
+Fill makeFill(const Color& color) {
+    Fill fill;
+    uint32_t a = channel(color.a * 255.0f);
+    fill.packed = IM_COL32(channel(color.r * 255.0f), channel(color.g * 255.0f), channel(color.b * 255.0f), 255);
+    fill.r = channel(color.r * 255.0f) * a;
+    fill.g = channel(color.g * 255.0f) * a;
+    fill.b = channel(color.b * 255.0f) * a;
+    fill.a = a * 255;
+    fill.keep = 255 - a;
+    fill.opaque = a == 255;
+    fill.empty = a == 0;
+    return fill;
+}
+
+inline void blend(uint32_t& dst, const Fill& fill) {
+    if (fill.opaque) {
+        dst = fill.packed;
+        return;
+    }
+    uint32_t r = (((dst >> IM_COL32_R_SHIFT) & 0xFF) * fill.keep + fill.r + 127) / 255;
+    uint32_t g = (((dst >> IM_COL32_G_SHIFT) & 0xFF) * fill.keep + fill.g + 127) / 255;
+    uint32_t b = (((dst >> IM_COL32_B_SHIFT) & 0xFF) * fill.keep + fill.b + 127) / 255;
+    uint32_t a = (((dst >> IM_COL32_A_SHIFT) & 0xFF) * fill.keep + fill.a + 127) / 255;
+    dst = (r << IM_COL32_R_SHIFT) | (g << IM_COL32_G_SHIFT) | (b << IM_COL32_B_SHIFT) | (a << IM_COL32_A_SHIFT);
+}
+
+// An ImGui rectangle (PrimRect: a b c, a c d) of one colour and texel, with
+// its edges on the axes; it is filled row by row instead of as two triangles
+bool isFlatRect(const ImDrawVert& a, const ImDrawVert& b, const ImDrawVert& c, const ImDrawVert& d) {
+    return a.col == b.col && a.col == c.col && a.col == d.col &&
+           a.uv.x == b.uv.x && a.uv.x == c.uv.x && a.uv.x == d.uv.x &&
+           a.uv.y == b.uv.y && a.uv.y == c.uv.y && a.uv.y == d.uv.y &&
+           a.pos.y == b.pos.y && c.pos.y == d.pos.y && a.pos.x == d.pos.x && b.pos.x == c.pos.x;
+}
+
+struct Target {
+    uint32_t* pixels;
+    int width;
+    int height;
+};
+
+struct Clip {
+    int x0, y0, x1, y1;   // pixels, x1/y1 exclusive
+};
+
+// Twice the signed area of a, b, p; positive on the same side for every
+// edge of a triangle wound like a, b, c with edge(a, b, c) > 0
+float edge(const ImVec2& a, const ImVec2& b, float px, float py) {
+    return (b.x - a.x) * (py - a.y) - (b.y - a.y) * (px - a.x);
+}
+
+// A pixel centre exactly on an edge two triangles share is drawn by only one
+// of them (they walk it in opposite directions), so AA fringes and the two
+// halves of a rectangle never blend a pixel twice
+bool ownsEdge(const ImVec2& a, const ImVec2& b) {
+    float dx = b.x - a.x;
+    float dy = b.y - a.y;
+    return dy < 0.0f || (dy == 0.0f && dx > 0.0f);
+}
+
+bool inside(float w, bool owned) {
+    return w > 0.0f || (w == 0.0f && owned);
+}
+
+void fillRect(const Target& target, const Clip& clip, const ImVec2& p0, const ImVec2& p1, const Fill& fill) {
+    if (fill.empty) return;
+    // Pixels whose centres are inside, as for the triangles
+    int x0 = std::max(clip.x0, static_cast<int>(std::ceil(std::min(p0.x, p1.x) - 0.5f)));
+    int y0 = std::max(clip.y0, static_cast<int>(std::ceil(std::min(p0.y, p1.y) - 0.5f)));
+    int x1 = std::min(clip.x1, static_cast<int>(std::ceil(std::max(p0.x, p1.x) - 0.5f)));
+    int y1 = std::min(clip.y1, static_cast<int>(std::ceil(std::max(p0.y, p1.y) - 0.5f)));
+    for (int y = y0; y < y1; ++y) {
+        uint32_t* row = target.pixels + static_cast<size_t>(y) * target.width;
+        if (fill.opaque) {
+            std::fill(row + x0, row + std::max(x0, x1), fill.packed);
+            continue;
+        }
+        for (int x = x0; x < x1; ++x) blend(row[x], fill);
+    }
+}
+
+void drawTriangle(const Target& target, const Clip& clip, const ImTextureData* texture,
+                  const ImDrawVert& va, const ImDrawVert& vb, const ImDrawVert& vc) {
+    const ImDrawVert* a = &va;
+    const ImDrawVert* b = &vb;
+    const ImDrawVert* c = &vc;
+    float area = edge(a->pos, b->pos, c->pos.x, c->pos.y);
+    if (area == 0.0f) return;
+    if (area < 0.0f) {
+        std::swap(b, c);
+        area = -area;
+    }
+
+    int x0 = std::max(clip.x0, static_cast<int>(std::floor(std::min({a->pos.x, b->pos.x, c->pos.x}))));
+    int y0 = std::max(clip.y0, static_cast<int>(std::floor(std::min({a->pos.y, b->pos.y, c->pos.y}))));
+    int x1 = std::min(clip.x1, static_cast<int>(std::ceil(std::max({a->pos.x, b->pos.x, c->pos.x}))));
+    int y1 = std::min(clip.y1, static_cast<int>(std::ceil(std::max({a->pos.y, b->pos.y, c->pos.y}))));
+    if (x1 <= x0 || y1 <= y0) return;
+
+    // Barycentric weights of a, b and c, stepped along each row
+    const float step_x0 = b->pos.y - c->pos.y;
+    const float step_x1 = c->pos.y - a->pos.y;
+    const float step_x2 = a->pos.y - b->pos.y;
+    const bool own0 = ownsEdge(b->pos, c->pos);
+    const bool own1 = ownsEdge(c->pos, a->pos);
+    const bool own2 = ownsEdge(a->pos, b->pos);
+
+    // Most fills are one colour on the white texel, and AA fringes only vary
+    // the alpha over it; glyphs are the ones that sample per pixel
+    const bool same_uv = a->uv.x == b->uv.x && b->uv.x == c->uv.x && a->uv.y == b->uv.y && b->uv.y == c->uv.y;
+    const bool flat = same_uv && a->col == b->col && b->col == c->col;
+    const Color texel = sample(texture, a->uv.x, a->uv.y);
+    const Fill flat_fill = makeFill(modulate(unpack(a->col), texel));
+    if (flat && flat_fill.empty) return;
+    const Color ca = unpack(a->col);
+    const Color cb = unpack(b->col);
+    const Color cc = unpack(c->col);
+    const float inv_area = 1.0f / area;
+
+    for (int y = y0; y < y1; ++y) {
+        float py = y + 0.5f;
+        float px = x0 + 0.5f;
+        float w0 = edge(b->pos, c->pos, px, py);
+        float w1 = edge(c->pos, a->pos, px, py);
+        float w2 = edge(a->pos, b->pos, px, py);
+        uint32_t* row = target.pixels + static_cast<size_t>(y) * target.width;
+        for (int x = x0; x < x1; ++x, w0 += step_x0, w1 += step_x1, w2 += step_x2) {
+            if (!inside(w0, own0) || !inside(w1, own1) || !inside(w2, own2)) continue;
+            if (flat) {
+                blend(row[x], flat_fill);
+                continue;
+            }
+            float l0 = w0 * inv_area;
+            float l1 = w1 * inv_area;
+            float l2 = w2 * inv_area;
+            Color vertex{ca.r * l0 + cb.r * l1 + cc.r * l2, ca.g * l0 + cb.g * l1 + cc.g * l2,
+                         ca.b * l0 + cb.b * l1 + cc.b * l2, ca.a * l0 + cb.a * l1 + cc.a * l2};
+            if (same_uv) {
+                blend(row[x], modulate(vertex, texel));
+                continue;
+            }
+            float u = a->uv.x * l0 + b->uv.x * l1 + c->uv.x * l2;
+            float v = a->uv.y * l0 + b->uv.y * l1 + c->uv.y * l2;
+            blend(row[x], modulate(vertex, sample(texture, u, v)));
+        }
+    }
+}
+
+}  // namespace
+
+void DrawDataRaster::render(ImDrawData* data, uint32_t* pixels, int width, int height, ImU32 clear_color) {
+    std::fill(pixels, pixels + static_cast<size_t>(width) * height, clear_color);
+    if (!data) return;
+    updateTextures(data);
+
+    Target target{pixels, width, height};
+    ImVec2 origin = data->DisplayPos;
+    ImVec2 scale = data->FramebufferScale;
+    for (const ImDrawList* list : data->CmdLists) {
+        const ImDrawVert* vertices = list->VtxBuffer.Data;
+        const ImDrawIdx* indices = list->IdxBuffer.Data;
+        for (const ImDrawCmd& cmd : list->CmdBuffer) {
+            if (cmd.UserCallback) continue;   // backend work (the GPU note roll), nothing to draw here
+
+            // Images this backend never made (sokol views) are left out
+            const ImTextureData* texture = findTexture(cmd.GetTexID());
+            if (!texture) continue;
+
+            Clip clip;
+            clip.x0 = std::max(0, static_cast<int>(std::floor((cmd.ClipRect.x - origin.x) * scale.x)));
+            clip.y0 = std::max(0, static_cast<int>(std::floor((cmd.ClipRect.y - origin.y) * scale.y)));
+            clip.x1 = std::min(width, static_cast<int>(std::ceil((cmd.ClipRect.z - origin.x) * scale.x)));
+            clip.y1 = std::min(height, static_cast<int>(std::ceil((cmd.ClipRect.w - origin.y) * scale.y)));
+            if (clip.x1 <= clip.x0 || clip.y1 <= clip.y0) continue;
+
+            const ImDrawIdx* idx = indices + cmd.IdxOffset;
+            auto vertex = [&](ImDrawIdx index) {
+                ImDrawVert v = vertices[cmd.VtxOffset + index];
+                v.pos = ImVec2((v.pos.x - origin.x) * scale.x, (v.pos.y - origin.y) * scale.y);
+                return v;
+            };
+            for (unsigned int i = 0; i + 2 < cmd.ElemCount; ) {
+                ImDrawVert a = vertex(idx[i]);
+                ImDrawVert b = vertex(idx[i + 1]);
+                ImDrawVert c = vertex(idx[i + 2]);
+                if (i + 5 < cmd.ElemCount && idx[i + 3] == idx[i] && idx[i + 4] == idx[i + 2]) {
+                    ImDrawVert d = vertex(idx[i + 5]);
+                    if (isFlatRect(a, b, c, d)) {
+                        fillRect(target, clip, a.pos, c.pos, makeFill(modulate(unpack(a.col), sample(texture, a.uv.x, a.uv.y))));
+                        i += 6;
+                        continue;
+                    }
+                }
+                drawTriangle(target, clip, texture, a, b, c);
+                i += 3;
+            }
+        }
+    }
+}
+
+void DrawDataRaster::shutdown() {
+    if (ImGui::GetCurrentContext()) {
+        for (ImTextureData* texture : ImGui::GetPlatformIO().Textures) {
+            if (texture->Status == ImTextureStatus_Destroyed) continue;
+            texture->SetTexID(ImTextureID_Invalid);
+            texture->SetStatus(ImTextureStatus_Destroyed);
+        }
+    }
+    textures_.clear();
+}
+
+void DrawDataRaster::updateTextures(ImDrawData* data) {
+    if (!data->Textures) return;
+    for (ImTextureData* texture : *data->Textures) {
+        switch (texture->Status) {
+        case ImTextureStatus_WantCreate:
+            // Sampled where ImGui keeps it: the id is the texture itself
+            texture->SetTexID(static_cast<ImTextureID>(reinterpret_cast<intptr_t>(texture)));
+            textures_.push_back(texture);
+            texture->SetStatus(ImTextureStatus_OK);
+            break;
+        case ImTextureStatus_WantUpdates:
+            texture->SetStatus(ImTextureStatus_OK);   // the new pixels are already in place
+            break;
+        case ImTextureStatus_WantDestroy:
+            if (texture->UnusedFrames > 0) {
+                textures_.erase(std::remove(textures_.begin(), textures_.end(), texture), textures_.end());
+                texture->SetTexID(ImTextureID_Invalid);
+                texture->SetStatus(ImTextureStatus_Destroyed);
+            }
+            break;
+        default:
+            break;
+        }
+    }
+}
+
+const ImTextureData* DrawDataRaster::findTexture(ImTextureID id) const {
+    if (id == ImTextureID_Invalid) return nullptr;
+    for (const ImTextureData* texture : textures_) {
+        if (texture->TexID == id) return texture;
+    }
+    return nullptr;
+}
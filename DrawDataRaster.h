@@ -0,0 +1,31 @@
+#pragma once
+
+#include "imgui.h"
+#include <cstdint>
+#include <vector>
+
+// Draws ImGui draw data into an RGBA8 image on the CPU, for frames that never
+// reach a swapchain (offline video). It is the renderer backend of one ImGui
+// context: set ImGuiBackendFlags_RendererHasTextures on that context and the
+// font atlas textures are sampled straight from their CPU pixels. Texture ids
+// it didn't create (sokol images) and draw callbacks are skipped.
+class DrawDataRaster {
+public:
+    DrawDataRaster() = default;
+    DrawDataRaster(const DrawDataRaster&) = delete;
+    DrawDataRaster& operator=(const DrawDataRaster&) = delete;
+
+    // Clear the image to clear_color and draw data into it. pixels holds
+    // width x height IM_COL32 values, rows top down, which is R, G, B, A
+    // bytes in memory on little-endian machines.
+    void render(ImDrawData* data, uint32_t* pixels, int width, int height, ImU32 clear_color);
+
+    // Release the context's textures; before ImGui::DestroyContext
+    void shutdown();
+
+private:
+    void updateTextures(ImDrawData* data);
+    const ImTextureData* findTexture(ImTextureID id) const;
+
+    std::vector<const ImTextureData*> textures_;
+};
@@ -0,0 +1,346 @@
+#include "FftPlan.h"
+#include <algorithm>
+#include <cmath>
+#include <type_traits>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define FFT_USE_SSE2 1
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define FFT_USE_NEON 1
+#endif
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+// One radix-2 stage over split arrays: for each group of 2*half values,
+// (u, v) -> (u + w*v, u - w*v) with w taken from the stage's twiddle row.
+// half and n are ints, or std::integral_constants for fixed-size kernels.
+template <typename Half, typename Size>
+static void butterflyStage(float* re, float* im, const float* twr, const float* twi,
+                           Half half, Size n) {
+    for (int i = 0; i < n; i += 2 * half) {
+        float* ar = re + i;
+        float* ai = im + i;
+        float* br = re + i + half;
+        float* bi = im + i + half;
+        int j = 0;
+#if defined(__AVX__)
+        for (; j + 8 <= half; j += 8) {
+            __m256 wr = _mm256_loadu_ps(twr + j), wi = _mm256_loadu_ps(twi + j);
+            __m256 xr = _mm256_loadu_ps(br + j), xi = _mm256_loadu_ps(bi + j);
+            __m256 vr = _mm256_sub_ps(_mm256_mul_ps(xr, wr), _mm256_mul_ps(xi, wi));
+            __m256 vi = _mm256_add_ps(_mm256_mul_ps(xr, wi), _mm256_mul_ps(xi, wr));
+            __m256 ur = _mm256_loadu_ps(ar + j), ui = _mm256_loadu_ps(ai + j);
+            _mm256_storeu_ps(ar + j, _mm256_add_ps(ur, vr));
+            _mm256_storeu_ps(ai + j, _mm256_add_ps(ui, vi));
+            _mm256_storeu_ps(br + j, _mm256_sub_ps(ur, vr));
+            _mm256_storeu_ps(bi + j, _mm256_sub_ps(ui, vi));
+        }
+#elif defined(FFT_USE_SSE2)
+        for (; j + 4 <= half; j += 4) {
+            __m128 wr = _mm_loadu_ps(twr + j), wi = _mm_loadu_ps(twi + j);
+            __m128 xr = _mm_loadu_ps(br + j), xi = _mm_loadu_ps(bi + j);
+            __m128 vr = _mm_sub_ps(_mm_mul_ps(xr, wr), _mm_mul_ps(xi, wi));
+            __m128 vi = _mm_add_ps(_mm_mul_ps(xr, wi), _mm_mul_ps(xi, wr));
+            __m128 ur = _mm_loadu_ps(ar + j), ui = _mm_loadu_ps(ai + j);
+            _mm_storeu_ps(ar + j, _mm_add_ps(ur, vr));
+            _mm_storeu_ps(ai + j, _mm_add_ps(ui, vi));
+            _mm_storeu_ps(br + j, _mm_sub_ps(ur, vr));
+            _mm_storeu_ps(bi + j, _mm_sub_ps(ui, vi));
+        }
+#elif defined(FFT_USE_NEON)
+        for (; j + 4 <= half; j += 4) {
+            float32x4_t wr = vld1q_f32(twr + j), wi = vld1q_f32(twi + j);
+            float32x4_t xr = vld1q_f32(br + j), xi = vld1q_f32(bi + j);
+            float32x4_t vr = vmlsq_f32(vmulq_f32(xr, wr), xi, wi);
+            float32x4_t vi = vmlaq_f32(vmulq_f32(xr, wi), xi, wr);
+            float32x4_t ur = vld1q_f32(ar + j), ui = vld1q_f32(ai + j);
+            vst1q_f32(ar + j, vaddq_f32(ur, vr));
+            vst1q_f32(ai + j, vaddq_f32(ui, vi));
+            vst1q_f32(br + j, vsubq_f32(ur, vr));
+            vst1q_f32(bi + j, vsubq_f32(ui, vi));
+        }
+#endif
+        for (; j < half; ++j) {
+            float vr = br[j] * twr[j] - bi[j] * twi[j];
+            float vi = br[j] * twi[j] + bi[j] * twr[j];
+            float ur = ar[j], ui = ai[j];
+            ar[j] = ur + vr;
+            ai[j] = ui + vi;
+            br[j] = ur - vr;
+            bi[j] = ui - vi;
+        }
+    }
+}
+
+// The stages of a complex FFT whose length N is known at compile time. The
+// first two spans, whose twiddles are 1 and -i, run as one multiply-free
+// radix-4 pass; every later one passes its span and N as constants, so the
+// short spans the SIMD loop can't fill unroll completely.
+template <int N, int HALF>
+static void butterflyStagesFrom(float* re, float* im, const float* twr, const float* twi) {
+    if constexpr (HALF < N) {
+        butterflyStage(re, im, twr, twi, std::integral_constant<int, HALF>(), std::integral_constant<int, N>());
+        butterflyStagesFrom<N, HALF * 2>(re, im, twr + HALF, twi + HALF);
+    }
+}
+
+template <int N>
+static void butterflyStagesFixed(float* re, float* im, const float* twr, const float* twi) {
+    if constexpr (N < 4) {
+        butterflyStagesFrom<N, 1>(re, im, twr, twi);
+    } else {
+        for (int i = 0; i < N; i += 4) {
+            float* r = re + i;
+            float* m = im + i;
+            float ar = r[0] + r[1], ai = m[0] + m[1];
+            float br = r[0] - r[1], bi = m[0] - m[1];
+            float cr = r[2] + r[3], ci = m[2] + m[3];
+            float dr = r[2] - r[3], di = m[2] - m[3];
+            r[0] = ar + cr;
+            m[0] = ai + ci;
+            r[2] = ar - cr;
+            m[2] = ai - ci;
+            r[1] = br + di;     // + (-i) * d
+            m[1] = bi - dr;
+            r[3] = br - di;
+            m[3] = bi + dr;
+        }
+        butterflyStagesFrom<N, 4>(re, im, twr + 3, twi + 3);
+    }
+}
+
+// Stages of any length, for sizes without a specialisation
+static void butterflyStages(float* re, float* im, const float* twr, const float* twi, int n) {
+    for (int half = 1; half < n; half <<= 1) {
+        butterflyStage(re, im, twr, twi, half, n);
+        twr += half;
+        twi += half;
+    }
+}
+
+// The same stage over BATCH_LANES interleaved transforms: element j of lane
+// l is at [j * BATCH_LANES + l], and one twiddle serves a whole vector
+static void butterflyStageBatch(float* re, float* im, const float* twr, const float* twi,
+                                int half, int n) {
+    constexpr int L = FftPlan::BATCH_LANES;
+    for (int i = 0; i < n; i += 2 * half) {
+        for (int j = 0; j < half; ++j) {
+            float* ar = re + (i + j) * L;
+            float* ai = im + (i + j) * L;
+            float* br = re + (i + j + half) * L;
+            float* bi = im + (i + j + half) * L;
+#if defined(__AVX__)
+            __m256 wr = _mm256_set1_ps(twr[j]), wi = _mm256_set1_ps(twi[j]);
+            __m256 xr = _mm256_loadu_ps(br), xi = _mm256_loadu_ps(bi);
+            __m256 vr = _mm256_sub_ps(_mm256_mul_ps(xr, wr), _mm256_mul_ps(xi, wi));
+            __m256 vi = _mm256_add_ps(_mm256_mul_ps(xr, wi), _mm256_mul_ps(xi, wr));
+            __m256 ur = _mm256_loadu_ps(ar), ui = _mm256_loadu_ps(ai);
+            _mm256_storeu_ps(ar, _mm256_add_ps(ur, vr));
+            _mm256_storeu_ps(ai, _mm256_add_ps(ui, vi));
+            _mm256_storeu_ps(br, _mm256_sub_ps(ur, vr));
+            _mm256_storeu_ps(bi, _mm256_sub_ps(ui, vi));
+#elif defined(FFT_USE_SSE2)
+            __m128 wr = _mm_set1_ps(twr[j]), wi = _mm_set1_ps(twi[j]);
+            for (int l = 0; l < L; l += 4) {
+                __m128 xr = _mm_loadu_ps(br + l), xi = _mm_loadu_ps(bi + l);
+                __m128 vr = _mm_sub_ps(_mm_mul_ps(xr, wr), _mm_mul_ps(xi, wi));
+                __m128 vi = _mm_add_ps(_mm_mul_ps(xr, wi), _mm_mul_ps(xi, wr));
+                __m128 ur = _mm_loadu_ps(ar + l), ui = _mm_loadu_ps(ai + l);
+                _mm_storeu_ps(ar + l, _mm_add_ps(ur, vr));
+                _mm_storeu_ps(ai + l, _mm_add_ps(ui, vi));
+                _mm_storeu_ps(br + l, _mm_sub_ps(ur, vr));
+                _mm_storeu_ps(bi + l, _mm_sub_ps(ui, vi));
+            }
+#elif defined(FFT_USE_NEON)
+            float32x4_t wr = vdupq_n_f32(twr[j]), wi = vdupq_n_f32(twi[j]);
+            for (int l = 0; l < L; l += 4) {
+                float32x4_t xr = vld1q_f32(br + l), xi = vld1q_f32(bi + l);
+                float32x4_t vr = vmlsq_f32(vmulq_f32(xr, wr), xi, wi);
+                float32x4_t vi = vmlaq_f32(vmulq_f32(xr, wi), xi, wr);
+                float32x4_t ur = vld1q_f32(ar + l), ui = vld1q_f32(ai + l);
+                vst1q_f32(ar + l, vaddq_f32(ur, vr));
+                vst1q_f32(ai + l, vaddq_f32(ui, vi));
+                vst1q_f32(br + l, vsubq_f32(ur, vr));
+                vst1q_f32(bi + l, vsubq_f32(ui, vi));
+            }
+#else
+            for (int l = 0; l < L; ++l) {
+                float vr = br[l] * twr[j] - bi[l] * twi[j];
+                float vi = br[l] * twi[j] + bi[l] * twr[j];
+                float ur = ar[l], ui = ai[l];
+                ar[l] = ur + vr;
+                ai[l] = ui + vi;
+                br[l] = ur - vr;
+                bi[l] = ui - vi;
+            }
+#endif
+        }
+    }
+}
+
+void FftPlan::init(int size) {
+    size_ = size;
+    half_ = size / 2;
+    
+    switch (half_) {
+        case 2:     stages_ = butterflyStagesFixed<2>; break;
+        case 4:     stages_ = butterflyStagesFixed<4>; break;
+        case 8:     stages_ = butterflyStagesFixed<8>; break;
+        case 16:    stages_ = butterflyStagesFixed<16>; break;
+        case 32:    stages_ = butterflyStagesFixed<32>; break;
+        case 64:    stages_ = butterflyStagesFixed<64>; break;
+        case 128:   stages_ = butterflyStagesFixed<128>; break;
+        case 256:   stages_ = butterflyStagesFixed<256>; break;
+        case 512:   stages_ = butterflyStagesFixed<512>; break;
+        case 1024:  stages_ = butterflyStagesFixed<1024>; break;
+        case 2048:  stages_ = butterflyStagesFixed<2048>; break;
+        case 4096:  stages_ = butterflyStagesFixed<4096>; break;
+        case 8192:  stages_ = butterflyStagesFixed<8192>; break;
+        default:    stages_ = nullptr; break;
+    }
+    
+    bit_reverse_.resize(half_);
+    int bits = 0;
+    while ((1 << bits) < half_) bits++;
+    for (int i = 0; i < half_; ++i) {
+        uint32_t r = 0;
+        for (int b = 0; b < bits; ++b) {
+            if (i & (1 << b)) r |= 1u << (bits - 1 - b);
+        }
+        bit_reverse_[i] = r;
+    }
+    
+    // Stage with butterfly span 'half' uses exp(-2*pi*i*j/(2*half)), j < half.
+    // Rows are concatenated (1 + 2 + 4 + ... entries) so SIMD loads are contiguous.
+    stage_tw_re_.clear();
+    stage_tw_im_.clear();
+    for (int half = 1; half < half_; half <<= 1) {
+        for (int j = 0; j < half; ++j) {
+            double angle = -M_PI * j / half;
+            stage_tw_re_.push_back(static_cast<float>(std::cos(angle)));
+            stage_tw_im_.push_back(static_cast<float>(std::sin(angle)));
+        }
+    }
+    
+    split_tw_re_.resize(half_ + 1);
+    split_tw_im_.resize(half_ + 1);
+    for (int k = 0; k <= half_; ++k) {
+        double angle = -2.0 * M_PI * k / size;
+        split_tw_re_[k] = static_cast<float>(std::cos(angle));
+        split_tw_im_[k] = static_cast<float>(std::sin(angle));
+    }
+    
+    // Hann window
+    window_.resize(size);
+    for (int i = 0; i < size; ++i) {
+        window_[i] = 0.5f * (1.0f - static_cast<float>(std::cos(2.0 * M_PI * i / (size - 1))));
+    }
+    
+    re_.assign(half_, 0.0f);
+    im_.assign(half_, 0.0f);
+    output_.assign(half_ + 1, std::complex<float>(0.0f, 0.0f));
+}
+
+const std::vector<std::complex<float>>& FftPlan::forward(const float* input) {
+    return transform(input, window_.data());
+}
+
+const std::vector<std::complex<float>>& FftPlan::forwardRaw(const float* input) {
+    return transform(input, nullptr);
+}
+
+const std::vector<std::complex<float>>& FftPlan::transform(const float* input, const float* window) {
+    // Window, pack even/odd samples as real/imag, and bit-reverse in one pass
+    if (window) {
+        for (int i = 0; i < half_; ++i) {
+            uint32_t dst = bit_reverse_[i];
+            re_[dst] = input[2 * i] * window[2 * i];
+            im_[dst] = input[2 * i + 1] * window[2 * i + 1];
+        }
+    } else {
+        for (int i = 0; i < half_; ++i) {
+            uint32_t dst = bit_reverse_[i];
+            re_[dst] = input[2 * i];
+            im_[dst] = input[2 * i + 1];
+        }
+    }
+    
+    if (stages_) {
+        stages_(re_.data(), im_.data(), stage_tw_re_.data(), stage_tw_im_.data());
+    } else {
+        butterflyStages(re_.data(), im_.data(), stage_tw_re_.data(), stage_tw_im_.data(), half_);
+    }
+    
+    // Unpack: with Z = FFT(even + i*odd),
+    //   E[k] = (Z[k] + conj(Z[M-k])) / 2,  O[k] = -i * (Z[k] - conj(Z[M-k])) / 2
+    //   X[k] = E[k] + W^k * O[k]
+    for (int k = 0; k <= half_; ++k) {
+        int a = (k == half_) ? 0 : k;
+        int b = (k == 0) ? 0 : half_ - k;
+        float zr = re_[a], zi = im_[a];
+        float cr = re_[b], ci = -im_[b];
+        float er = 0.5f * (zr + cr), ei = 0.5f * (zi + ci);
+        float or_ = 0.5f * (zi - ci), oi = -0.5f * (zr - cr);
+        float wr = split_tw_re_[k], wi = split_tw_im_[k];
+        output_[k] = std::complex<float>(er + wr * or_ - wi * oi, ei + wr * oi + wi * or_);
+    }
+    return output_;
+}
+
+void FftPlan::powerBatch(const float* const* inputs, int count, float* out) {
+    if (batch_re_.size() != static_cast<size_t>(half_) * BATCH_LANES) {
+        batch_re_.assign(static_cast<size_t>(half_) * BATCH_LANES, 0.0f);
+        batch_im_.assign(static_cast<size_t>(half_) * BATCH_LANES, 0.0f);
+    }
+    for (int first = 0; first < count; first += BATCH_LANES) {
+        int lanes = std::min(BATCH_LANES, count - first);
+        transformBatch(inputs + first, lanes, out + static_cast<size_t>(first) * (half_ + 1));
+    }
+}
+
+void FftPlan::transformBatch(const float* const* inputs, int count, float* out) {
+    constexpr int L = BATCH_LANES;
+    float* re = batch_re_.data();
+    float* im = batch_im_.data();
+    
+    // Window, pack and bit-reverse each signal into its lane; spare lanes
+    // run on zeros
+    for (int l = 0; l < L; ++l) {
+        const float* input = l < count ? inputs[l] : nullptr;
+        for (int i = 0; i < half_; ++i) {
+            size_t dst = static_cast<size_t>(bit_reverse_[i]) * L + l;
+            re[dst] = input ? input[2 * i] * window_[2 * i] : 0.0f;
+            im[dst] = input ? input[2 * i + 1] * window_[2 * i + 1] : 0.0f;
+        }
+    }
+    
+    const float* twr = stage_tw_re_.data();
+    const float* twi = stage_tw_im_.data();
+    for (int half = 1; half < half_; half <<= 1) {
+        butterflyStageBatch(re, im, twr, twi, half, half_);
+        twr += half;
+        twi += half;
+    }
+    
+    // Unpack as in transform(), straight to power
+    for (int k = 0; k <= half_; ++k) {
+        int a = (k == half_) ? 0 : k;
+        int b = (k == 0) ? 0 : half_ - k;
+        float wr = split_tw_re_[k], wi = split_tw_im_[k];
+        for (int l = 0; l < count; ++l) {
+            float zr = re[a * L + l], zi = im[a * L + l];
+            float cr = re[b * L + l], ci = -im[b * L + l];
+            float er = 0.5f * (zr + cr), ei = 0.5f * (zi + ci);
+            float or_ = 0.5f * (zi - ci), oi = -0.5f * (zr - cr);
+            float xr = er + wr * or_ - wi * oi;
+            float xi = ei + wr * oi + wi * or_;
+            out[static_cast<size_t>(l) * (half_ + 1) + k] = xr * xr + xi * xi;
+        }
+    }
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <vector>
+#include <complex>
+#include <cstdint>
+
+// Real-input FFT plan for one transform size.
+// Owns the twiddle, bit-reversal and Hann window tables plus the work buffers,
+// so a transform does no allocation or trig. N real samples are packed into
+// an N/2-point complex FFT (split real/imag arrays, SIMD butterflies) and then
+// unpacked into the N/2+1 non-redundant bins. Power-of-two sizes up to 16384
+// get butterflies specialised for their length at compile time.
+//
+// powerBatch() runs the same transform on several signals at once: they are
+// interleaved BATCH_LANES wide (structure of arrays, one lane per signal), so
+// every butterfly's SIMD vector holds the same bin of different signals and
+// the twiddles are loaded once for all of them.
+class FftPlan {
+public:
+    static constexpr int BATCH_LANES = 8;
+    
+    FftPlan() = default;
+    explicit FftPlan(int size) { init(size); }
+    
+    // Build tables for 'size' (power of 2, >= 4); allocates
+    void init(int size);
+    int size() const { return size_; }
+    
+    // Window 'input' (size() samples) and transform; result has size()/2+1 bins
+    const std::vector<std::complex<float>>& forward(const float* input);
+    
+    // Same without the window (e.g. power spectrum -> autocorrelation)
+    const std::vector<std::complex<float>>& forwardRaw(const float* input);
+    
+    // Windowed power spectra of 'count' signals of size() samples:
+    // out[s * (size() / 2 + 1) + k] = |X_s[k]|^2
+    void powerBatch(const float* const* inputs, int count, float* out);
+    
+    const std::vector<float>& window() const { return window_; }
+    
+private:
+    const std::vector<std::complex<float>>& transform(const float* input, const float* window);
+    void transformBatch(const float* const* inputs, int count, float* out);
+    
+    using Stages = void (*)(float* re, float* im, const float* twr, const float* twi);
+    
+    int size_ = 0;
+    int half_ = 0;                          // Complex FFT length (size_/2)
+    Stages stages_ = nullptr;               // Specialised for half_, if it has one
+    std::vector<uint32_t> bit_reverse_;     // For the half_-point FFT
+    std::vector<float> stage_tw_re_;        // Per-stage contiguous twiddles
+    std::vector<float> stage_tw_im_;
+    std::vector<float> split_tw_re_;        // exp(-2*pi*i*k/size), k <= half_
+    std::vector<float> split_tw_im_;
+    std::vector<float> window_;
+    std::vector<float> re_;
+    std::vector<float> im_;
+    std::vector<std::complex<float>> output_;
+    std::vector<float> batch_re_;           // half_ x BATCH_LANES, allocated on first batch
+    std::vector<float> batch_im_;
+};
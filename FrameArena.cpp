@@ -0,0 +1,64 @@
+#include "FrameArena.h"
+
+FrameArena& FrameArena::local() {
+    static thread_local FrameArena arena;
+    return arena;
+}
+
+void* FrameArena::allocate(size_t bytes, size_t align) {
+    for (;;) {
+        if (block_ < blocks_.size()) {
+            Block& block = blocks_[block_];
+            uintptr_t base = reinterpret_cast<uintptr_t>(block.data.get());
+            size_t start = ((base + offset_ + align - 1) & ~(uintptr_t(align) - 1)) - base;
+            if (start + bytes <= block.size) {
+                offset_ = start + bytes;
+                return block.data.get() + start;
+            }
+            // Full: move on and leave the rest of this one for the next frame
+            if (block_ + 1 < blocks_.size()) {
+                used_before_ += offset_;
+                ++block_;
+                offset_ = 0;
+                continue;
+            }
+        }
+
+        // Out of blocks (or none yet): a new one big enough for the request
+        size_t size = DEFAULT_BLOCK;
+        while (size < bytes + align) size *= 2;
+        if (!blocks_.empty()) used_before_ += offset_;
+        block_ = blocks_.size();
+        offset_ = 0;
+        Block block;
+        block.data.reset(new uint8_t[size]);  // left uninitialized
+        block.size = size;
+        blocks_.push_back(std::move(block));
+    }
+}
+
+void FrameArena::reset() {
+    // A frame that spilled into a second block gets one block the size of
+    // all of them, so the same frame fits next time without spilling
+    if (blocks_.size() > 1) {
+        size_t total = capacity();
+        blocks_.clear();
+        Block block;
+        block.data.reset(new uint8_t[total]);
+        block.size = total;
+        blocks_.push_back(std::move(block));
+    }
+    block_ = 0;
+    offset_ = 0;
+    used_before_ = 0;
+}
+
+size_t FrameArena::used() const {
+    return used_before_ + offset_;
+}
+
+size_t FrameArena::capacity() const {
+    size_t total = 0;
+    for (const Block& block : blocks_) total += block.size;
+    return total;
+}
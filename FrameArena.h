@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+// Bump allocator for scratch memory that only lives until the end of the
+// current frame. Each thread has its own (local()) and resets it at its frame
+// boundary, which frees everything allocated since at once. Blocks are kept
+// across resets and merged into one once a frame has needed several, so
+// after the first few frames a frame's scratch never touches the heap.
+// Only for trivially destructible types: nothing is destroyed on reset().
+class FrameArena {
+public:
+    static constexpr size_t DEFAULT_BLOCK = 64 * 1024;
+
+    FrameArena() = default;
+    FrameArena(const FrameArena&) = delete;
+    FrameArena& operator=(const FrameArena&) = delete;
+
+    // The calling thread's arena
+    static FrameArena& local();
+
+    void* allocate(size_t bytes, size_t align = alignof(std::max_align_t));
+
+    // Uninitialized room for count Ts, valid until the next reset()
+    template <typename T>
+    T* allocate(size_t count) {
+        static_assert(std::is_trivially_destructible_v<T>, "reset() runs no destructors");
+        return static_cast<T*>(allocate(count * sizeof(T), alignof(T)));
+    }
+
+    // Start the next frame; pointers handed out before are invalid after this
+    void reset();
+
+    size_t used() const;    // bytes handed out this frame
+    size_t capacity() const;
+
+private:
+    struct Block {
+        std::unique_ptr<uint8_t[]> data;
+        size_t size = 0;
+    };
+
+    std::vector<Block> blocks_;
+    size_t block_ = 0;    // the one being bumped
+    size_t offset_ = 0;   // in blocks_[block_]
+    size_t used_before_ = 0;   // bytes in the blocks before block_
+};
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <thread>
+
+// Decides at the top of each sokol frame whether the UI is rebuilt and
+// rendered. Input and running state (playback, emulation, background jobs)
+// keep it live for a short grace period so ImGui can settle hover states and
+// double-clicks; once nothing has changed for that long, frames are skipped
+// without presenting and the frame loop sleeps between polls. Live frames can
+// also be capped below the display rate, or held until a given time (the next
+// emulated frame on a variable refresh display). Main thread only.
+class FramePacer {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    // Skip frames while nothing changes
+    void setIdleEnabled(bool enabled) { idle_enabled_ = enabled; }
+    bool idleEnabled() const { return idle_enabled_; }
+
+    // Redraw at most this often; 0 follows the display
+    void setMaxFps(int fps) { max_fps_ = std::max(fps, 0); }
+    int maxFps() const { return max_fps_; }
+
+    // An input event: the next frame renders regardless of the cap
+    void notifyInput() {
+        input_pending_ = true;
+        notifyActivity();
+    }
+
+    // Something on screen changed or is about to
+    void notifyActivity() { live_until_ = Clock::now() + GRACE; }
+
+    // One frame at the next poll without the grace period, for a display
+    // that only has to tick (the play time in power-saver mode)
+    void requestFrame() { frame_pending_ = true; }
+
+    // Don't render before 'time' (cleared by rendering); input waits too, so
+    // the display keeps refreshing on the emulator's beat
+    void holdUntil(Clock::time_point time) { hold_until_ = time; }
+
+    // Poll less often while idle; input then waits up to SAVER_POLL
+    void setPowerSaving(bool saving) { idle_poll_ = saving ? SAVER_POLL : IDLE_POLL; }
+
+    // True to render this frame. False means the frame was skipped: the
+    // caller must not touch the swapchain, and the call has already slept.
+    bool beginFrame() {
+        Clock::time_point now = Clock::now();
+        Clock::duration wait = Clock::duration::zero();
+        if (idle_enabled_ && !input_pending_ && !frame_pending_ && now >= live_until_) {
+            wait = idle_poll_;
+        } else if (max_fps_ > 0 && !input_pending_) {
+            Clock::duration interval = std::chrono::duration_cast<Clock::duration>(std::chrono::seconds(1)) / max_fps_;
+            Clock::duration since = now - last_render_;
+            if (since < interval) wait = std::min<Clock::duration>(interval - since, IDLE_POLL);
+        }
+        if (now < hold_until_) wait = std::max<Clock::duration>(wait, std::min<Clock::duration>(hold_until_ - now, IDLE_POLL));
+        if (wait > Clock::duration::zero()) {
+#ifndef __EMSCRIPTEN__
+            // In the browser the page's animation frames pace the loop, and
+            // its main thread must never block
+            std::this_thread::sleep_for(wait);
+#endif
+            ++skipped_frames_;
+            return false;
+        }
+
+        frame_seconds_ = last_render_ == Clock::time_point() ? 0.0 :
+            std::chrono::duration<double>(now - last_render_).count();
+        last_render_ = now;
+        hold_until_ = Clock::time_point();
+        input_pending_ = false;
+        frame_pending_ = false;
+        return true;
+    }
+
+    // Time since the previous rendered frame, for ImGui's delta time
+    double frameSeconds() const { return frame_seconds_; }
+    uint64_t skippedFrames() const { return skipped_frames_; }
+
+private:
+    static constexpr std::chrono::milliseconds GRACE{500};
+    static constexpr std::chrono::milliseconds IDLE_POLL{15};
+    static constexpr std::chrono::milliseconds SAVER_POLL{50};
+
+    bool idle_enabled_ = true;
+    int max_fps_ = 0;
+    bool input_pending_ = true;
+    bool frame_pending_ = false;
+    std::chrono::milliseconds idle_poll_ = IDLE_POLL;
+    Clock::time_point live_until_;
+    Clock::time_point last_render_;
+    Clock::time_point hold_until_;
+    double frame_seconds_ = 0.0;
+    uint64_t skipped_frames_ = 0;
+};
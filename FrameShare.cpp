@@ -0,0 +1,378 @@
+#include "FrameShare.h"
+#include "GpuMemory.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#if defined(__linux__)
+#define FRAME_SHARE_DMABUF 1
+#include <vulkan/vulkan.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+#ifdef FRAME_SHARE_DMABUF
+struct VulkanDevice {
+    VkPhysicalDevice physical = VK_NULL_HANDLE;
+    VkDevice device = VK_NULL_HANDLE;
+    PFN_vkGetMemoryFdKHR getMemoryFd = nullptr;     // null without the DMA-BUF extensions
+};
+
+// An image whose memory is a DMA-BUF, and where its pixels are in it
+struct ExportableImage {
+    VkImage image = VK_NULL_HANDLE;
+    VkDeviceMemory memory = VK_NULL_HANDLE;
+    int fd = -1;
+    uint32_t offset = 0;
+    uint32_t stride = 0;
+    uint64_t size = 0;
+};
+
+VulkanDevice vulkanDevice() {
+    VulkanDevice vk;
+    if (sg_query_backend() != SG_BACKEND_VULKAN) return vk;
+    const sg_vulkan_environment& env = sg_query_desc().environment.vulkan;
+    vk.physical = (VkPhysicalDevice)env.physical_device;
+    vk.device = (VkDevice)env.device;
+    if (vk.device) {
+        vk.getMemoryFd = (PFN_vkGetMemoryFdKHR)vkGetDeviceProcAddr(vk.device, "vkGetMemoryFdKHR");
+    }
+    return vk;
+}
+
+int findMemoryType(VkPhysicalDevice physical, uint32_t type_bits) {
+    VkPhysicalDeviceMemoryProperties props;
+    vkGetPhysicalDeviceMemoryProperties(physical, &props);
+    for (uint32_t i = 0; i < props.memoryTypeCount; ++i) {
+        if ((type_bits & (1u << i)) && (props.memoryTypes[i].propertyFlags & VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT)) {
+            return static_cast<int>(i);
+        }
+    }
+    // Some integrated parts only offer host-visible types for it
+    for (uint32_t i = 0; i < props.memoryTypeCount; ++i) {
+        if (type_bits & (1u << i)) return static_cast<int>(i);
+    }
+    return -1;
+}
+
+void destroyExportableImage(const VulkanDevice& vk, ExportableImage& out) {
+    if (out.fd >= 0) ::close(out.fd);
+    if (out.image) vkDestroyImage(vk.device, out.image, nullptr);
+    if (out.memory) vkFreeMemory(vk.device, out.memory, nullptr);
+    out = ExportableImage();
+}
+
+// Linear, so importers need no modifier support; every device renders
+// RGBA8 to linear images
+bool createExportableImage(const VulkanDevice& vk, int width, int height, ExportableImage& out) {
+    VkFormatProperties format_props;
+    vkGetPhysicalDeviceFormatProperties(vk.physical, VK_FORMAT_R8G8B8A8_UNORM, &format_props);
+    if (!(format_props.linearTilingFeatures & VK_FORMAT_FEATURE_COLOR_ATTACHMENT_BIT)) return false;
+
+    VkExternalMemoryImageCreateInfo external_info = {};
+    external_info.sType = VK_STRUCTURE_TYPE_EXTERNAL_MEMORY_IMAGE_CREATE_INFO;
+    external_info.handleTypes = VK_EXTERNAL_MEMORY_HANDLE_TYPE_DMA_BUF_BIT_EXT;
+
+    // Usage covers what sokol_gfx asks of a color attachment it also samples
+    VkImageCreateInfo image_info = {};
+    image_info.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+    image_info.pNext = &external_info;
+    image_info.imageType = VK_IMAGE_TYPE_2D;
+    image_info.format = VK_FORMAT_R8G8B8A8_UNORM;
+    image_info.extent = { static_cast<uint32_t>(width), static_cast<uint32_t>(height), 1 };
+    image_info.mipLevels = 1;
+    image_info.arrayLayers = 1;
+    image_info.samples = VK_SAMPLE_COUNT_1_BIT;
+    image_info.tiling = VK_IMAGE_TILING_LINEAR;
+    image_info.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT |
+                       VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+    image_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    image_info.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    if (vkCreateImage(vk.device, &image_info, nullptr, &out.image) != VK_SUCCESS) {
+        out.image = VK_NULL_HANDLE;
+        return false;
+    }
+
+    VkMemoryRequirements reqs;
+    vkGetImageMemoryRequirements(vk.device, out.image, &reqs);
+    int memory_type = findMemoryType(vk.physical, reqs.memoryTypeBits);
+
+    // Dedicated, so the buffer a client imports holds this image alone
+    VkMemoryDedicatedAllocateInfo dedicated_info = {};
+    dedicated_info.sType = VK_STRUCTURE_TYPE_MEMORY_DEDICATED_ALLOCATE_INFO;
+    dedicated_info.image = out.image;
+    VkExportMemoryAllocateInfo export_info = {};
+    export_info.sType = VK_STRUCTURE_TYPE_EXPORT_MEMORY_ALLOCATE_INFO;
+    export_info.pNext = &dedicated_info;
+    export_info.handleTypes = VK_EXTERNAL_MEMORY_HANDLE_TYPE_DMA_BUF_BIT_EXT;
+    VkMemoryAllocateInfo alloc_info = {};
+    alloc_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    alloc_info.pNext = &export_info;
+    alloc_info.allocationSize = reqs.size;
+    alloc_info.memoryTypeIndex = static_cast<uint32_t>(memory_type);
+    if (memory_type < 0 || vkAllocateMemory(vk.device, &alloc_info, nullptr, &out.memory) != VK_SUCCESS) {
+        out.memory = VK_NULL_HANDLE;
+        destroyExportableImage(vk, out);
+        return false;
+    }
+    if (vkBindImageMemory(vk.device, out.image, out.memory, 0) != VK_SUCCESS) {
+        destroyExportableImage(vk, out);
+        return false;
+    }
+
+    VkMemoryGetFdInfoKHR fd_info = {};
+    fd_info.sType = VK_STRUCTURE_TYPE_MEMORY_GET_FD_INFO_KHR;
+    fd_info.memory = out.memory;
+    fd_info.handleType = VK_EXTERNAL_MEMORY_HANDLE_TYPE_DMA_BUF_BIT_EXT;
+    if (vk.getMemoryFd(vk.device, &fd_info, &out.fd) != VK_SUCCESS) {
+        out.fd = -1;
+        destroyExportableImage(vk, out);
+        return false;
+    }
+
+    VkImageSubresource subresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0 };
+    VkSubresourceLayout layout;
+    vkGetImageSubresourceLayout(vk.device, out.image, &subresource, &layout);
+    out.offset = static_cast<uint32_t>(layout.offset);
+    out.stride = static_cast<uint32_t>(layout.rowPitch);
+    out.size = reqs.size;
+    return true;
+}
+#endif
+
+}  // namespace
+
+struct FrameShare::Export {
+    int width = 0;
+    int height = 0;
+    sg_image image = {};
+    sg_view attachment = {};
+#ifdef FRAME_SHARE_DMABUF
+    ExportableImage vk;
+#endif
+};
+
+const char* FrameShare::sourceName(Source source) {
+    switch (source) {
+        case Source::NES_SCREEN: return "nes-screen";
+        case Source::COUNT:      break;
+    }
+    return "?";
+}
+
+bool FrameShare::isSupported() {
+#ifdef FRAME_SHARE_DMABUF
+    return sg_query_backend() == SG_BACKEND_VULKAN;
+#else
+    return false;
+#endif
+}
+
+bool FrameShare::open() {
+    if (isOpen()) return true;
+#ifdef FRAME_SHARE_DMABUF
+    if (!vulkanDevice().getMemoryFd) return false;
+    if (!blitter_.init()) return false;
+
+    // Per user and private to them, where the Wayland and PipeWire sockets live
+    const char* dir = getenv("XDG_RUNTIME_DIR");
+    snprintf(socket_path_, sizeof(socket_path_), "%s/fc_visualizer_frames.sock", dir && *dir ? dir : "/tmp");
+
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) return false;
+    sockaddr_un addr = {};
+    addr.sun_family = AF_UNIX;
+    snprintf(addr.sun_path, sizeof(addr.sun_path), "%s", socket_path_);
+    // A stale socket from a crashed run would keep bind() failing
+    unlink(socket_path_);
+    if (bind(fd, reinterpret_cast<const sockaddr*>(&addr), sizeof(addr)) != 0 ||
+        listen(fd, MAX_CLIENTS) != 0) {
+        ::close(fd);
+        return false;
+    }
+    listener_ = fd;
+    return true;
+#else
+    return false;
+#endif
+}
+
+void FrameShare::close() {
+    if (!isOpen()) return;
+#ifdef FRAME_SHARE_DMABUF
+    while (client_count_ > 0) dropClient(client_count_ - 1);
+    ::close(listener_);
+    unlink(socket_path_);
+#endif
+    listener_ = -1;
+    for (Export*& image : exports_) retire(image);
+}
+
+void FrameShare::shutdown() {
+    close();
+    freeRetired(true);
+    blitter_.shutdown();
+}
+
+void FrameShare::newFrame() {
+    ++frame_;
+    if (retired_count_ > 0) freeRetired(false);
+    if (!isOpen()) return;
+#ifdef FRAME_SHARE_DMABUF
+    for (;;) {
+        int client = accept4(listener_, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (client < 0) break;
+        if (client_count_ == MAX_CLIENTS) {
+            ::close(client);
+            continue;
+        }
+        clients_[client_count_++] = client;
+        // What is already being shared; later images follow as they change
+        for (int i = 0; i < COUNT; ++i) {
+            if (exports_[i] && !sendImage(client, static_cast<Source>(i))) {
+                dropClient(client_count_ - 1);
+                break;
+            }
+        }
+    }
+#endif
+}
+
+void FrameShare::publish(Source source, sg_view view, int width, int height, bool changed) {
+    if (!isOpen() || view.id == SG_INVALID_ID || width <= 0 || height <= 0) return;
+    Export*& image = exports_[static_cast<int>(source)];
+    bool fresh = !image || image->width != width || image->height != height;
+    if (!fresh && !changed) return;
+    if (fresh && !ensureExport(source, width, height)) return;
+    blitter_.copy(view, width, height, image->attachment);
+}
+
+bool FrameShare::ensureExport(Source source, int width, int height) {
+    Export*& image = exports_[static_cast<int>(source)];
+    if (image && image->width == width && image->height == height) return true;
+    retire(image);
+#ifdef FRAME_SHARE_DMABUF
+    VulkanDevice vk = vulkanDevice();
+    Export* created = new Export();
+    if (!createExportableImage(vk, width, height, created->vk)) {
+        delete created;
+        return false;
+    }
+    created->width = width;
+    created->height = height;
+
+    sg_image_desc desc = {};
+    desc.width = width;
+    desc.height = height;
+    desc.pixel_format = SG_PIXELFORMAT_RGBA8;
+    desc.sample_count = 1;
+    desc.usage.color_attachment = true;
+    desc.vk_image = created->vk.image;
+    desc.label = "frame-share-image";
+    created->image = MakeGpuImage(&desc);
+    sg_view_desc view_desc = {};
+    view_desc.color_attachment.image = created->image;
+    created->attachment = sg_make_view(&view_desc);
+    if (sg_query_view_state(created->attachment) != SG_RESOURCESTATE_VALID) {
+        sg_destroy_view(created->attachment);
+        DestroyGpuImage(created->image);
+        destroyExportableImage(vk, created->vk);
+        delete created;
+        return false;
+    }
+    image = created;
+
+    // Clients swap to the new buffer when this arrives
+    for (int i = client_count_ - 1; i >= 0; --i) {
+        if (!sendImage(clients_[i], source)) dropClient(i);
+    }
+    return true;
+#else
+    (void)width;
+    (void)height;
+    return false;
+#endif
+}
+
+bool FrameShare::sendImage(int client, Source source) const {
+#ifdef FRAME_SHARE_DMABUF
+    const Export& image = *exports_[static_cast<int>(source)];
+    FrameShareMessage message = {};
+    message.magic = MAGIC;
+    message.version = VERSION;
+    message.source = static_cast<uint32_t>(source);
+    message.width = static_cast<uint32_t>(image.width);
+    message.height = static_cast<uint32_t>(image.height);
+    message.drm_format = FrameShareMessage::DRM_FORMAT_ABGR8888;
+    message.drm_modifier = FrameShareMessage::DRM_FORMAT_MOD_LINEAR;
+    message.offset = image.vk.offset;
+    message.stride = image.vk.stride;
+    message.size = image.vk.size;
+    snprintf(message.name, sizeof(message.name), "%s", sourceName(source));
+
+    iovec iov = { &message, sizeof(message) };
+    alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int))] = {};
+    msghdr msg = {};
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+    cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+    memcpy(CMSG_DATA(cmsg), &image.vk.fd, sizeof(int));
+
+    // A client too slow to take 64 bytes is dropped rather than waited on
+    return sendmsg(client, &msg, MSG_NOSIGNAL | MSG_DONTWAIT) == static_cast<ssize_t>(sizeof(message));
+#else
+    (void)client;
+    (void)source;
+    return false;
+#endif
+}
+
+void FrameShare::dropClient(int index) {
+#ifdef FRAME_SHARE_DMABUF
+    ::close(clients_[index]);
+#endif
+    clients_[index] = clients_[--client_count_];
+}
+
+void FrameShare::retire(Export*& image) {
+    if (!image) return;
+    // The image may still be in a frame the GPU hasn't finished; the sokol
+    // handles go now, the Vulkan image once those frames are done
+    sg_destroy_view(image->attachment);
+    DestroyGpuImage(image->image);
+    if (retired_count_ == MAX_RETIRED) freeRetired(true);
+    retired_[retired_count_] = image;
+    retired_frame_[retired_count_] = frame_;
+    ++retired_count_;
+    image = nullptr;
+}
+
+void FrameShare::freeRetired(bool all) {
+#ifdef FRAME_SHARE_DMABUF
+    VulkanDevice vk = vulkanDevice();
+    if (all && retired_count_ > 0 && vk.device) vkDeviceWaitIdle(vk.device);
+#endif
+    int kept = 0;
+    for (int i = 0; i < retired_count_; ++i) {
+        // Same margin sokol_gfx gives its own deferred releases
+        if (!all && frame_ < retired_frame_[i] + SG_NUM_INFLIGHT_FRAMES + 1) {
+            retired_[kept] = retired_[i];
+            retired_frame_[kept] = retired_frame_[i];
+            ++kept;
+            continue;
+        }
+#ifdef FRAME_SHARE_DMABUF
+        destroyExportableImage(vk, retired_[i]->vk);
+#endif
+        delete retired_[i];
+    }
+    retired_count_ = kept;
+}
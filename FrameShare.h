@@ -0,0 +1,113 @@
+#pragma once
+
+#include "PostProcessor.h"
+#include "sokol_gfx.h"
+#include <cstdint>
+
+// Sent to every client when it connects and when a source gets a new image
+// (first frame, resize); the image's DMA-BUF file descriptor rides along as
+// SCM_RIGHTS ancillary data. Plain fixed-width fields, like OverlayFeed's.
+struct FrameShareMessage {
+    static constexpr uint32_t DRM_FORMAT_ABGR8888 = 0x34324241;  // R, G, B, A bytes
+    static constexpr uint64_t DRM_FORMAT_MOD_LINEAR = 0;
+    static constexpr int NAME_SIZE = 16;
+
+    uint32_t magic;                 // FrameShare::MAGIC
+    uint32_t version;               // FrameShare::VERSION
+    uint32_t source;                // FrameShare::Source
+    uint32_t width;
+    uint32_t height;
+    uint32_t drm_format;
+    uint64_t drm_modifier;
+    uint32_t offset;                // of the first row in the buffer
+    uint32_t stride;                // bytes per row
+    uint64_t size;                  // of the whole buffer
+    char name[NAME_SIZE];
+};
+
+static_assert(sizeof(FrameShareMessage) == 64, "no padding between the fields clients declare");
+
+// Hands GPU images of the app's pictures to other processes (OBS, capture
+// tools) without a CPU readback or window capture. Each source is copied on
+// the GPU into an exportable image once it changes, and clients import that
+// image once and sample it on their own - the Spout/Syphon model: there is
+// no cross-process fence, so a client may read a frame while the next one
+// is being drawn.
+//
+// On Linux the images are linear RGBA8 Vulkan images exported as DMA-BUF
+// file descriptors (VK_EXT_external_memory_dma_buf, enabled by sokol_app
+// when the device has it), handed out over the Unix socket socketPath().
+// Other platforms and devices without the extension return false from
+// open(); a Syphon (Metal) and a Spout (D3D11 shared handle) publisher
+// would slot in behind the same interface.
+//
+// Only pictures with an offscreen target can be sources. The piano roll
+// and spectrum are drawn by ImGui straight into the swapchain, so they
+// reach overlays through OverlayFeed's data instead.
+class FrameShare {
+public:
+    static constexpr uint32_t MAGIC = 0x45524853;   // "SHRE"
+    static constexpr uint32_t VERSION = 1;
+    static constexpr int MAX_CLIENTS = 8;
+
+    enum class Source : uint8_t {
+        NES_SCREEN,     // the emulator picture after the screen filters
+        COUNT
+    };
+
+    static const char* sourceName(Source source);
+    // False where this build has no exporter for the graphics backend
+    static bool isSupported();
+
+    FrameShare() = default;
+    ~FrameShare() = default;
+    FrameShare(const FrameShare&) = delete;
+    FrameShare& operator=(const FrameShare&) = delete;
+
+    // Start listening for clients; false if the device can't export images
+    // or the socket can't be created
+    bool open();
+    // Drop the clients and the images; safe mid-frame, the images are
+    // freed a few frames later
+    void close();
+    bool isOpen() const { return listener_ >= 0; }
+    const char* socketPath() const { return socket_path_; }
+    int clientCount() const { return client_count_; }
+
+    // Once a frame, before any publish(): accept clients and free images
+    // the GPU is done with
+    void newFrame();
+
+    // Copy 'view' (width x height RGBA8 texels) into the source's shared
+    // image; unless 'changed', only if the image is new. Runs its own
+    // offscreen pass, so call outside the swapchain pass, and at most once
+    // a frame per source.
+    void publish(Source source, sg_view view, int width, int height, bool changed);
+
+    // App shutdown, before sg_shutdown(): close and free everything now
+    void shutdown();
+
+private:
+    struct Export;
+
+    bool ensureExport(Source source, int width, int height);
+    void retire(Export*& image);
+    void freeRetired(bool all);
+    bool sendImage(int client, Source source) const;
+    void dropClient(int index);
+
+    static constexpr int COUNT = static_cast<int>(Source::COUNT);
+    static constexpr int MAX_RETIRED = 2 * COUNT;
+
+    int listener_ = -1;
+    int clients_[MAX_CLIENTS] = {};
+    int client_count_ = 0;
+    char socket_path_[108] = {};    // sockaddr_un::sun_path
+
+    PostProcessor blitter_;         // its unfiltered copy draws the shared images
+    Export* exports_[COUNT] = {};
+    Export* retired_[MAX_RETIRED] = {};
+    uint64_t retired_frame_[MAX_RETIRED] = {};
+    int retired_count_ = 0;
+    uint64_t frame_ = 0;
+};
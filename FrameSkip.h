@@ -0,0 +1,73 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+
+// Adaptive frame skip for the NES emulation thread. Every frame is still
+// emulated with its audio, but when emulating and showing frames costs more
+// than the frame period, only as many frames as the budget allows are
+// handed to the renderer. A skipped frame costs no screen conversion or
+// upload on the UI thread, no filter passes and no run-ahead. The thread
+// also skips a frame it starts more than a period late. At most MAX_SKIP
+// frames in a row are skipped, so the picture keeps moving.
+class FrameSkip {
+public:
+    static constexpr int MAX_SKIP = 3;
+
+    void setEnabled(bool enabled) { enabled_.store(enabled, std::memory_order_relaxed); }
+    bool enabled() const { return enabled_.load(std::memory_order_relaxed); }
+
+    // UI thread: what its last frame cost in seconds (UI build, screen
+    // upload and render, without waiting for the display)
+    void reportRenderCost(double seconds) { render_cost_.store(static_cast<float>(seconds), std::memory_order_relaxed); }
+
+    // Emulation thread: whether to present the frame about to run. 'period'
+    // is the frame period in seconds, 'behind' how many periods late it starts.
+    bool present(double period, double behind) {
+        bool show = true;
+        if (enabled() && skipped_ < MAX_SKIP) {
+            // Fraction of frames the budget covers: shown frames cost their
+            // emulation plus a UI frame, skipped ones only their emulation
+            double shown = present_cost_ + render_cost_.load(std::memory_order_relaxed);
+            double share = shown > period ? std::max(0.0, (period - skip_cost_) / (shown - skip_cost_)) : 1.0;
+            credit_ += share;
+            show = behind < 1.0 && credit_ >= 1.0;
+        }
+        if (show) {
+            credit_ = std::clamp(credit_ - 1.0, 0.0, 1.0);
+            skipped_ = 0;
+        } else {
+            ++skipped_;
+        }
+        presenting_ = show;
+        ratio_ += RATIO_SMOOTHING * ((show ? 0.0f : 1.0f) - ratio_);
+        skip_ratio_.store(ratio_, std::memory_order_relaxed);
+        return show;
+    }
+
+    // Emulation thread: what the frame present() was asked about cost
+    void reportEmulationCost(double seconds) {
+        double& cost = presenting_ ? present_cost_ : skip_cost_;
+        cost += COST_SMOOTHING * (seconds - cost);
+        if (presenting_ && skip_cost_ == 0.0) skip_cost_ = present_cost_;
+    }
+
+    // Recent fraction of frames skipped; any thread
+    float skipRatio() const { return skip_ratio_.load(std::memory_order_relaxed); }
+
+private:
+    static constexpr double COST_SMOOTHING = 0.1;
+    static constexpr float RATIO_SMOOTHING = 0.02f;  // about a second at 60 fps
+
+    std::atomic<bool> enabled_{true};
+    std::atomic<float> render_cost_{0.0f};
+    std::atomic<float> skip_ratio_{0.0f};
+
+    // Emulation thread only
+    double present_cost_ = 0.0;
+    double skip_cost_ = 0.0;
+    double credit_ = 0.0;
+    float ratio_ = 0.0f;
+    int skipped_ = 0;
+    bool presenting_ = true;
+};
@@ -0,0 +1,35 @@
+#pragma once
+
+#include "Profiler.h"
+#include "sokol_gfx.h"
+#include <algorithm>
+
+// sokol images charged to MemoryTag::GpuTextures for the profiler window:
+// make and destroy them through these rather than sg_make_image and
+// sg_destroy_image. The size is what the image's pixels take at its
+// format, mip chain and sample count, not what the driver actually keeps.
+inline int64_t GpuImageBytes(sg_image image) {
+    sg_pixel_format format = sg_query_image_pixelformat(image);
+    int width = sg_query_image_width(image);
+    int height = sg_query_image_height(image);
+    int64_t bytes = 0;
+    for (int mip = 0; mip < sg_query_image_num_mipmaps(image); ++mip) {
+        bytes += sg_query_surface_pitch(format, std::max(width >> mip, 1), std::max(height >> mip, 1), 1);
+    }
+    return bytes * sg_query_image_num_slices(image) * std::max(sg_query_image_sample_count(image), 1);
+}
+
+inline sg_image MakeGpuImage(const sg_image_desc* desc) {
+    sg_image image = sg_make_image(desc);
+    if (sg_query_image_state(image) == SG_RESOURCESTATE_VALID) {
+        Profiler::trackMemory(MemoryTag::GpuTextures, GpuImageBytes(image));
+    }
+    return image;
+}
+
+inline void DestroyGpuImage(sg_image image) {
+    if (sg_query_image_state(image) == SG_RESOURCESTATE_VALID) {
+        Profiler::trackMemory(MemoryTag::GpuTextures, -GpuImageBytes(image), 0);
+    }
+    sg_destroy_image(image);
+}
@@ -0,0 +1,261 @@
+#include "InputLatencyTest.h"
+#include "NesEmulator.h"
+#include "InputMovie.h"
+#include "imgui.h"
+#include <algorithm>
+
+namespace {
+
+// The test ROM's program at $C000. Reset waits two vblanks, turns on NMI and
+// the background (blank tiles, so the screen is the backdrop color); the NMI
+// reads pad 1 and writes white ($30) or black ($0F) to $3F00, then resets
+// the scroll.
+constexpr uint16_t PRG_BASE = 0xC000;
+constexpr uint16_t NMI_ADDRESS = 0xC024;
+constexpr uint16_t RESET_ADDRESS = 0xC000;
+constexpr uint16_t IRQ_ADDRESS = 0xC065;
+constexpr uint8_t PROGRAM[] = {
+    // reset
+    0x78,                   // sei
+    0xD8,                   // cld
+    0xA2, 0xFF,             // ldx #$FF
+    0x9A,                   // txs
+    0xA9, 0x00,             // lda #$00
+    0x8D, 0x00, 0x20,       // sta $2000
+    0x8D, 0x01, 0x20,       // sta $2001
+    0x2C, 0x02, 0x20,       // bit $2002
+    0x10, 0xFB,             // bpl -5
+    0x2C, 0x02, 0x20,       // bit $2002
+    0x10, 0xFB,             // bpl -5
+    0xA9, 0x80,             // lda #$80     NMI on
+    0x8D, 0x00, 0x20,       // sta $2000
+    0xA9, 0x0A,             // lda #$0A     background, left column too
+    0x8D, 0x01, 0x20,       // sta $2001
+    0x4C, 0x21, 0xC0,       // jmp $C021
+    // nmi ($C024)
+    0x48,                   // pha
+    0xA9, 0x01,             // lda #$01
+    0x8D, 0x16, 0x40,       // sta $4016
+    0xA9, 0x00,             // lda #$00
+    0x8D, 0x16, 0x40,       // sta $4016
+    0xAD, 0x16, 0x40,       // lda $4016    A
+    0x29, 0x01,             // and #$01
+    0xF0, 0x04,             // beq +4
+    0xA9, 0x30,             // lda #$30
+    0xD0, 0x02,             // bne +2
+    0xA9, 0x0F,             // lda #$0F
+    0x85, 0x00,             // sta $00
+    0xAD, 0x02, 0x20,       // lda $2002
+    0xA9, 0x3F,             // lda #$3F
+    0x8D, 0x06, 0x20,       // sta $2006
+    0xA9, 0x00,             // lda #$00
+    0x8D, 0x06, 0x20,       // sta $2006
+    0xA5, 0x00,             // lda $00
+    0x8D, 0x07, 0x20,       // sta $2007
+    0xA9, 0x00,             // lda #$00
+    0x8D, 0x06, 0x20,       // sta $2006
+    0x8D, 0x06, 0x20,       // sta $2006
+    0x8D, 0x05, 0x20,       // sta $2005
+    0x8D, 0x05, 0x20,       // sta $2005
+    0xA9, 0x80,             // lda #$80
+    0x8D, 0x00, 0x20,       // sta $2000
+    0x68,                   // pla
+    0x40,                   // rti
+    // irq ($C065)
+    0x40,                   // rti
+};
+static_assert(PRG_BASE + sizeof(PROGRAM) == IRQ_ADDRESS + 1, "the vectors name the program's labels");
+
+constexpr int PRG_SIZE = 16384;
+constexpr int CHR_SIZE = 8192;
+
+double percentile(std::vector<float> values, double fraction) {
+    if (values.empty()) return 0.0;
+    size_t index = std::min(values.size() - 1, static_cast<size_t>(fraction * values.size()));
+    std::nth_element(values.begin(), values.begin() + index, values.end());
+    return values[index];
+}
+
+double mean(const std::vector<float>& values) {
+    double sum = 0.0;
+    for (float value : values) sum += value;
+    return values.empty() ? 0.0 : sum / values.size();
+}
+
+}  // namespace
+
+const std::vector<uint8_t>& InputLatencyTest::testRom() {
+    static const std::vector<uint8_t> rom = [] {
+        std::vector<uint8_t> image(16 + PRG_SIZE + CHR_SIZE, 0);
+        const uint8_t header[16] = {'N', 'E', 'S', 0x1A, 1, 1};   // one PRG bank, one CHR bank, mapper 0
+        std::copy(header, header + 16, image.begin());
+        uint8_t* prg = image.data() + 16;
+        std::copy(PROGRAM, PROGRAM + sizeof(PROGRAM), prg + (PRG_BASE & 0x3FFF));
+        const uint16_t vectors[3] = {NMI_ADDRESS, RESET_ADDRESS, IRQ_ADDRESS};
+        for (int i = 0; i < 3; ++i) {
+            prg[0x3FFA + i * 2] = static_cast<uint8_t>(vectors[i] & 0xFF);
+            prg[0x3FFB + i * 2] = static_cast<uint8_t>(vectors[i] >> 8);
+        }
+        return image;
+    }();
+    return rom;
+}
+
+void InputLatencyTest::setRunning(NesEmulator& emu, bool running) {
+    if (running == running_) return;
+    running_ = running;
+    releaseAuto(emu);
+    emu.inputLatencyTrace().setEnabled(running);
+    next_press_ns_ = InputLatencyTrace::nowNs();
+}
+
+void InputLatencyTest::padsChanged(NesEmulator& emu, uint16_t before, uint16_t after) {
+    if (!running_ || auto_press_) return;
+    begin(emu, static_cast<uint16_t>(after & ~before));
+}
+
+void InputLatencyTest::begin(NesEmulator& emu, uint16_t pressed) {
+    Setup setup = currentSetup(emu);
+    if (emu.inputLatencyTrace().begin(pressed)) pending_ = setup;
+}
+
+InputLatencyTest::Setup InputLatencyTest::currentSetup(NesEmulator& emu) {
+    return {emu.getRunAhead(), emu.getLateLatching(), emu.getFrameSkip(), emu.variableRefresh()};
+}
+
+void InputLatencyTest::releaseAuto(NesEmulator& emu) {
+    if (!holding_) return;
+    holding_ = false;
+    emu.setInput(0, agnes_input_t{});
+}
+
+void InputLatencyTest::update(NesEmulator& emu) {
+    if (!running_) return;
+    InputLatencyTrace& trace = emu.inputLatencyTrace();
+    InputLatencyTrace::Trial trial;
+    if (trace.presented(trial)) record(trial);
+
+    int64_t now = InputLatencyTrace::nowNs();
+    if (trace.inFlight() && now - trace.startNs() > static_cast<int64_t>(TRIAL_TIMEOUT * 1e9)) {
+        trace.abort();
+        ++unseen_;
+    }
+    if (!auto_press_) return;
+
+    // Hold A briefly, then let the screen settle back before the next press
+    if (holding_) {
+        if (now < release_ns_) return;
+        releaseAuto(emu);
+        std::uniform_real_distribution<double> gap(AUTO_MIN_GAP, AUTO_MAX_GAP);
+        next_press_ns_ = now + static_cast<int64_t>(gap(random_) * 1e9);
+    } else if (now >= next_press_ns_ && !trace.inFlight()) {
+        agnes_input_t pad{};
+        pad.a = true;
+        begin(emu, InputMovie::pack(pad, agnes_input_t{}));
+        emu.setInput(0, pad);
+        holding_ = true;
+        release_ns_ = now + static_cast<int64_t>(AUTO_HOLD * 1e9);
+    }
+}
+
+void InputLatencyTest::record(const InputLatencyTrace::Trial& trial) {
+    auto found = std::find_if(results_.begin(), results_.end(),
+                              [&](const Result& result) { return result.setup == pending_; });
+    if (found == results_.end()) {
+        results_.push_back({pending_, {}});
+        found = results_.end() - 1;
+    }
+    for (int i = 0; i < InputLatencyTrace::STAGE_COUNT; ++i) {
+        int64_t from = i == 0 ? trial.ns[InputLatencyTrace::EVENT] : trial.ns[i - 1];
+        int64_t to = i == 0 ? trial.ns[InputLatencyTrace::PRESENT] : trial.ns[i];
+        std::vector<float>& times = found->stages[i];
+        if (times.size() >= MAX_TRIALS) times.erase(times.begin());
+        times.push_back((to - from) / 1e6f);
+    }
+}
+
+bool InputLatencyTest::drawWindow(bool* p_open, NesEmulator& emu) {
+    ImGui::SetNextWindowSize(ImVec2(640, 300), ImGuiCond_FirstUseEver);
+    if (!ImGui::Begin("Input Latency Test", p_open)) {
+        ImGui::End();
+        return false;
+    }
+
+    ImGui::TextWrapped("Times each press from the key event to the presented frame that shows it. "
+                       "Only the picture tells, so use the test ROM, which turns the screen white "
+                       "while A is held.");
+    bool load = ImGui::Button("Load Test ROM");
+    ImGui::SameLine();
+    bool running = running_;
+    if (ImGui::Checkbox("Running", &running)) setRunning(emu, running);
+    ImGui::SameLine();
+    if (ImGui::Checkbox("Press A Automatically", &auto_press_)) {
+        releaseAuto(emu);
+        emu.inputLatencyTrace().abort();
+    }
+    ImGui::SameLine();
+    if (ImGui::Button("Clear")) {
+        results_.clear();
+        unseen_ = 0;
+    }
+
+    // The settings being compared, at hand
+    int run_ahead = emu.getRunAhead();
+    ImGui::SetNextItemWidth(120.0f);
+    if (ImGui::SliderInt("Run-Ahead", &run_ahead, 0, 3, run_ahead ? "%d frames" : "Off")) {
+        emu.setRunAhead(run_ahead);
+    }
+    ImGui::SameLine();
+    bool late = emu.getLateLatching();
+    if (ImGui::Checkbox("Late Latching", &late)) emu.setLateLatching(late);
+    ImGui::SameLine();
+    bool skip = emu.getFrameSkip();
+    if (ImGui::Checkbox("Frame Skip", &skip)) emu.setFrameSkip(skip);
+    if (unseen_ > 0) {
+        ImGui::TextDisabled("%d press(es) not seen on screen within %.0f s", unseen_, TRIAL_TIMEOUT);
+    }
+    ImGui::Separator();
+
+    static const char* const stage_names[InputLatencyTrace::STAGE_COUNT] = {
+        "Total", "Latch", "Emulate", "Upload", "Present"};
+    if (results_.empty()) {
+        ImGui::TextDisabled(running_ ? "Waiting for a press..." : "Not running");
+    } else if (ImGui::BeginTable("##input_latency", 9, ImGuiTableFlags_RowBg | ImGuiTableFlags_Borders)) {
+        ImGui::TableSetupColumn("Setup", ImGuiTableColumnFlags_WidthStretch);
+        ImGui::TableSetupColumn("Presses", ImGuiTableColumnFlags_WidthFixed, 55.0f);
+        for (int i = 1; i < InputLatencyTrace::STAGE_COUNT; ++i) {
+            ImGui::TableSetupColumn(stage_names[i], ImGuiTableColumnFlags_WidthFixed, 55.0f);
+        }
+        ImGui::TableSetupColumn("Median", ImGuiTableColumnFlags_WidthFixed, 55.0f);
+        ImGui::TableSetupColumn("95%", ImGuiTableColumnFlags_WidthFixed, 55.0f);
+        ImGui::TableSetupColumn("Max", ImGuiTableColumnFlags_WidthFixed, 55.0f);
+        ImGui::TableHeadersRow();
+        Setup current = currentSetup(emu);
+        for (const Result& result : results_) {
+            const Setup& setup = result.setup;
+            const std::vector<float>& total = result.stages[0];
+            ImGui::TableNextRow();
+            ImGui::TableNextColumn();
+            ImGui::Text("%s%sahead %d, %s latch%s", setup == current ? "> " : "",
+                        setup.variable_refresh ? "VRR, " : "", setup.run_ahead,
+                        setup.late_latching ? "late" : "early", setup.frame_skip ? ", skip" : "");
+            ImGui::TableNextColumn();
+            ImGui::Text("%d", static_cast<int>(total.size()));
+            for (int i = 1; i < InputLatencyTrace::STAGE_COUNT; ++i) {
+                ImGui::TableNextColumn();
+                ImGui::Text("%.1f", mean(result.stages[i]));
+            }
+            ImGui::TableNextColumn();
+            ImGui::Text("%.1f", percentile(total, 0.5));
+            ImGui::TableNextColumn();
+            ImGui::Text("%.1f", percentile(total, 0.95));
+            ImGui::TableNextColumn();
+            ImGui::Text("%.1f", total.empty() ? 0.0f : *std::max_element(total.begin(), total.end()));
+        }
+        ImGui::EndTable();
+        ImGui::TextDisabled("Stage columns are mean ms since the stage before; the totals are ms from the key event.");
+    }
+
+    ImGui::End();
+    return load;
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include "InputLatencyTrace.h"
+#include <cstdint>
+#include <random>
+#include <vector>
+
+class NesEmulator;
+
+// The emulator's input-to-photon test (Emulation > Input Latency Test).
+// While running it times presses through InputLatencyTrace, from the
+// keyboard or pressed by itself at random moments, and keeps the stage
+// times of each emulator setup (run-ahead, late latching, frame skip,
+// variable refresh) apart, so what each of them buys can be compared on the
+// machine at hand. The built-in test ROM shows a white screen while A is
+// held and a black one otherwise, set in the vblank that reads the pad, so
+// the first frame that reflects a press is unambiguous.
+//
+// Main thread only.
+class InputLatencyTest {
+public:
+    static constexpr int MAX_TRIALS = 200;          // kept per setup
+    static constexpr double TRIAL_TIMEOUT = 1.0;    // seconds before a press counts as unseen
+    static constexpr double AUTO_HOLD = 0.1;
+    static constexpr double AUTO_MIN_GAP = 0.25;    // between a release and the next press
+    static constexpr double AUTO_MAX_GAP = 0.6;
+
+    // iNES image of the test ROM (NROM, 16 KB PRG and blank CHR)
+    static const std::vector<uint8_t>& testRom();
+
+    void setRunning(NesEmulator& emu, bool running);
+    bool isRunning() const { return running_; }
+
+    // Event handler: the keyboard's pads went from 'before' to 'after'
+    void padsChanged(NesEmulator& emu, uint16_t before, uint16_t after);
+
+    // Top of every frame, before the emulator's frame is presented: takes
+    // the trial the previous frame completed and drives the automatic presses
+    void update(NesEmulator& emu);
+
+    // True when "Load Test ROM" was clicked
+    bool drawWindow(bool* p_open, NesEmulator& emu);
+
+private:
+    struct Setup {
+        int run_ahead;
+        bool late_latching;
+        bool frame_skip;
+        bool variable_refresh;
+        bool operator==(const Setup&) const = default;
+    };
+    // Stage times of one setup's trials, in ms
+    struct Result {
+        Setup setup;
+        std::vector<float> stages[InputLatencyTrace::STAGE_COUNT];   // [0] is the total
+    };
+
+    static Setup currentSetup(NesEmulator& emu);
+    void begin(NesEmulator& emu, uint16_t pressed);
+    void record(const InputLatencyTrace::Trial& trial);
+    void releaseAuto(NesEmulator& emu);
+
+    bool running_ = false;
+    bool auto_press_ = true;
+    bool holding_ = false;
+    int64_t release_ns_ = 0;
+    int64_t next_press_ns_ = 0;
+    std::mt19937 random_{0x1a7e};
+    Setup pending_{};                   // the setup the trial in flight began with
+    std::vector<Result> results_;
+    int unseen_ = 0;                    // presses no frame reflected in time
+};
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+// Input-to-photon timing for the emulator's latency test (InputLatencyTest).
+// One trial at a time follows a press through the pipeline, each stage
+// stamping the steady clock as it passes:
+//
+//   EVENT    the pads changed in the event handler
+//   LATCH    the emulation thread handed pads with the press to the game
+//   EMULATE  the first frame published after that whose picture differs
+//            from the one before the latch (the game reacted)
+//   UPLOAD   presentFrame() put that frame in the screen texture
+//   PRESENT  the next frame began, so the swap that showed it has returned
+//
+// "Reflects the input" is judged by the picture alone, which only means
+// something when nothing else moves on screen: the test ROM flashes the
+// screen while A is held. A run-ahead frame counts as soon as it shows the
+// press. Stages advance by compare-and-swap, so abort() from the main
+// thread never races a stamp into the next trial.
+class InputLatencyTrace {
+public:
+    enum Stage { EVENT, LATCH, EMULATE, UPLOAD, PRESENT, STAGE_COUNT };
+    struct Trial {
+        int64_t ns[STAGE_COUNT];
+    };
+
+    static int64_t nowNs() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    // Main thread
+    void setEnabled(bool enabled) {
+        enabled_.store(enabled, std::memory_order_relaxed);
+        abort();
+    }
+    bool enabled() const { return enabled_.load(std::memory_order_relaxed); }
+
+    // Start a trial for the pad bits just pressed; false while one is in
+    // flight (the press is then not timed)
+    bool begin(uint16_t pressed) {
+        if (!enabled() || pressed == 0 || stage_.load(std::memory_order_acquire) != 0) return false;
+        pressed_.store(pressed, std::memory_order_relaxed);
+        ns_[EVENT].store(nowNs(), std::memory_order_relaxed);
+        stage_.store(LATCH, std::memory_order_release);
+        return true;
+    }
+    void abort() { stage_.store(0, std::memory_order_release); }
+    bool inFlight() const { return stage_.load(std::memory_order_relaxed) != 0; }
+    int64_t startNs() const { return ns_[EVENT].load(std::memory_order_relaxed); }
+
+    // Emulation thread: the pads the game was given
+    void latched(uint16_t pads) {
+        if (stage_.load(std::memory_order_acquire) != LATCH) return;
+        uint16_t pressed = pressed_.load(std::memory_order_relaxed);
+        if ((pads & pressed) == pressed) advance(LATCH);
+    }
+
+    // Emulation thread, for every frame published: true if it is the one
+    // that shows the press (or a later one, in case the renderer drops it)
+    bool published(const uint8_t* indices, int count) {
+        if (!enabled()) return false;
+        int stage = stage_.load(std::memory_order_acquire);
+        if (stage == UPLOAD) return true;
+        uint64_t signature = 14695981039346656037ull;
+        for (int i = 0; i < count; i += SIGNATURE_STRIDE) {
+            signature = (signature ^ indices[i]) * 1099511628211ull;
+        }
+        if (stage != EMULATE) {
+            reference_ = signature;     // until the press is latched
+            return false;
+        }
+        return signature != reference_ && advance(EMULATE);
+    }
+
+    // Main thread: the frame published() picked went into the texture
+    void uploaded() { advance(UPLOAD); }
+
+    // Main thread, at the top of each frame: true with the stamps when a
+    // trial has completed, which frees the trace for the next
+    bool presented(Trial& out) {
+        if (stage_.load(std::memory_order_acquire) != PRESENT || !advance(PRESENT)) return false;
+        for (int i = 0; i < STAGE_COUNT; ++i) out.ns[i] = ns_[i].load(std::memory_order_relaxed);
+        stage_.store(0, std::memory_order_release);
+        return true;
+    }
+
+private:
+    static constexpr int SIGNATURE_STRIDE = 7;      // pixels hashed, ~8700 of a frame
+
+    // Stamp 'stage' and expect the next one, if it was the one expected.
+    // The stamp goes first, so whoever sees the stage move sees it too.
+    bool advance(int stage) {
+        if (stage_.load(std::memory_order_relaxed) != stage) return false;
+        ns_[stage].store(nowNs(), std::memory_order_relaxed);
+        int expected = stage;
+        return stage_.compare_exchange_strong(expected, stage + 1, std::memory_order_acq_rel);
+    }
+
+    std::atomic<bool> enabled_{false};
+    std::atomic<int> stage_{0};             // the next stage to stamp; 0 when idle
+    std::atomic<uint16_t> pressed_{0};
+    std::atomic<int64_t> ns_[STAGE_COUNT] = {};
+    uint64_t reference_ = 0;                // emulation thread: picture before the latch
+};
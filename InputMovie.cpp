@@ -0,0 +1,144 @@
+#include "InputMovie.h"
+#include "MappedFile.h"
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <string>
+#include <system_error>
+
+uint16_t InputMovie::pack(const agnes_input_t& p1, const agnes_input_t& p2) {
+    auto bits = [](const agnes_input_t& in) {
+        return static_cast<uint16_t>(in.a | in.b << 1 | in.select << 2 | in.start << 3 |
+                                     in.up << 4 | in.down << 5 | in.left << 6 | in.right << 7);
+    };
+    return static_cast<uint16_t>(bits(p1) | bits(p2) << 8);
+}
+
+agnes_input_t InputMovie::unpack(uint16_t buttons, int player) {
+    uint8_t bits = static_cast<uint8_t>(buttons >> (player ? 8 : 0));
+    agnes_input_t in;
+    in.a = bits & 0x01;
+    in.b = bits & 0x02;
+    in.select = bits & 0x04;
+    in.start = bits & 0x08;
+    in.up = bits & 0x10;
+    in.down = bits & 0x20;
+    in.left = bits & 0x40;
+    in.right = bits & 0x80;
+    return in;
+}
+
+uint64_t InputMovie::hashRom(const void* data, size_t size) {
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    uint64_t hash = 0xcbf29ce484222325ull;
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= bytes[i];
+        hash *= 0x100000001b3ull;
+    }
+    return hash;
+}
+
+void InputMovie::clear() {
+    rom_hash_ = 0;
+    start_ = StartState();
+    runs_.clear();
+    frame_count_ = 0;
+}
+
+void InputMovie::begin(uint64_t rom_hash, StartState start) {
+    clear();
+    rom_hash_ = rom_hash;
+    start_ = std::move(start);
+}
+
+void InputMovie::append(uint16_t buttons) {
+    if (!runs_.empty() && runs_.back().buttons == buttons) {
+        runs_.back().frames++;
+    } else {
+        runs_.push_back({buttons, 1});
+    }
+    frame_count_++;
+}
+
+uint16_t InputMovie::buttonsAt(uint32_t frame, Cursor& cursor) const {
+    while (cursor.run < runs_.size() && frame >= cursor.run_start + runs_[cursor.run].frames) {
+        cursor.run_start += runs_[cursor.run].frames;
+        cursor.run++;
+    }
+    return cursor.run < runs_.size() ? runs_[cursor.run].buttons : 0;
+}
+
+bool InputMovie::save(const char* path) const {
+    Header header;
+    memcpy(header.magic, "FCMV", 4);
+    header.version = VERSION;
+    header.rom_hash = rom_hash_;
+    header.frame_count = frame_count_;
+    header.run_count = static_cast<uint32_t>(runs_.size());
+    header.agnes_size = static_cast<uint32_t>(start_.agnes.size());
+    header.apu_size = static_cast<uint32_t>(start_.apu.size());
+    header.vrc6_size = static_cast<uint32_t>(start_.vrc6.size());
+    header.reserved = 0;
+
+    // Write to a temp file and rename so a half-written movie never replaces a good one
+    std::string temp_path = std::string(path) + ".tmp";
+    FILE* f = fopen(temp_path.c_str(), "wb");
+    if (!f) return false;
+
+    auto write = [f](const void* data, size_t size) { return size == 0 || fwrite(data, size, 1, f) == 1; };
+    bool ok = write(&header, sizeof(header)) && write(start_.agnes.data(), start_.agnes.size()) &&
+              write(start_.apu.data(), start_.apu.size()) && write(start_.vrc6.data(), start_.vrc6.size());
+    for (size_t i = 0; ok && i < runs_.size(); ++i) {
+        ok = write(&runs_[i].buttons, sizeof(uint16_t)) && write(&runs_[i].frames, sizeof(uint32_t));
+    }
+    ok = (fclose(f) == 0) && ok;
+
+    std::error_code ec;
+    if (ok) {
+        std::filesystem::rename(temp_path, path, ec);
+        ok = !ec;
+    }
+    if (!ok) {
+        std::filesystem::remove(temp_path, ec);
+    }
+    return ok;
+}
+
+bool InputMovie::load(const char* path) {
+    clear();
+    MappedFile file;
+    if (!file.open(path) || file.size() < sizeof(Header)) return false;
+
+    Header header;
+    memcpy(&header, file.data(), sizeof(header));
+    if (memcmp(header.magic, "FCMV", 4) != 0 || header.version != VERSION) return false;
+
+    const size_t run_size = sizeof(uint16_t) + sizeof(uint32_t);
+    size_t expected = sizeof(Header) + static_cast<size_t>(header.agnes_size) + header.apu_size +
+                      header.vrc6_size + static_cast<size_t>(header.run_count) * run_size;
+    if (file.size() != expected) return false;
+
+    const uint8_t* p = file.data() + sizeof(Header);
+    start_.agnes.assign(p, p + header.agnes_size);
+    p += header.agnes_size;
+    start_.apu.assign(p, p + header.apu_size);
+    p += header.apu_size;
+    start_.vrc6.assign(p, p + header.vrc6_size);
+    p += header.vrc6_size;
+
+    runs_.resize(header.run_count);
+    uint64_t frames = 0;
+    for (Run& run : runs_) {
+        memcpy(&run.buttons, p, sizeof(uint16_t));
+        memcpy(&run.frames, p + sizeof(uint16_t), sizeof(uint32_t));
+        p += run_size;
+        frames += run.frames;
+    }
+    if (frames != header.frame_count) {
+        clear();
+        return false;
+    }
+    rom_hash_ = header.rom_hash;
+    frame_count_ = header.frame_count;
+    return true;
+}
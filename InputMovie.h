@@ -0,0 +1,74 @@
+#pragma once
+
+#include "agnes/agnes.h"
+#include <cstdint>
+#include <vector>
+
+// Recorded controller input for deterministic replay: the exact emulator
+// state the recording started from, then both pads for every frame,
+// run-length encoded (a held button costs one run, not one entry per frame).
+//
+// File layout: Header, the agnes / Nes_Apu / Nes_Vrc6_Apu state blobs, then
+// run_count {uint16 buttons, uint32 frames} runs. The blobs are raw struct
+// memory, so a movie only replays on the build it was recorded with; sizes
+// and the ROM hash are checked on load and replay.
+class InputMovie {
+public:
+    static constexpr uint32_t VERSION = 2;
+
+    struct StartState {
+        std::vector<uint8_t> agnes;  // agnes_dump_compact_state()
+        std::vector<uint8_t> apu;    // apu_state_t
+        std::vector<uint8_t> vrc6;   // vrc6_apu_state_t, empty without VRC6
+    };
+
+    // Player 1 in the low byte, player 2 in the high byte
+    static uint16_t pack(const agnes_input_t& p1, const agnes_input_t& p2);
+    static agnes_input_t unpack(uint16_t buttons, int player);
+    // 64-bit FNV-1a, as NoteCache uses for file contents
+    static uint64_t hashRom(const void* data, size_t size);
+
+    void clear();
+    void begin(uint64_t rom_hash, StartState start);
+    void append(uint16_t buttons);
+
+    bool empty() const { return frame_count_ == 0; }
+    uint32_t frameCount() const { return frame_count_; }
+    size_t runCount() const { return runs_.size(); }
+    uint64_t romHash() const { return rom_hash_; }
+    const StartState& startState() const { return start_; }
+
+    // Position of a sequential reader, so each lookup is O(1)
+    struct Cursor {
+        size_t run = 0;
+        uint32_t run_start = 0;  // first frame of runs_[run]
+    };
+    // Buttons of 'frame', which must not be before the cursor's; 0 past the end
+    uint16_t buttonsAt(uint32_t frame, Cursor& cursor) const;
+
+    bool save(const char* path) const;
+    bool load(const char* path);
+
+private:
+    struct Header {
+        char magic[4];            // "FCMV"
+        uint32_t version;
+        uint64_t rom_hash;
+        uint32_t frame_count;
+        uint32_t run_count;
+        uint32_t agnes_size;
+        uint32_t apu_size;
+        uint32_t vrc6_size;
+        uint32_t reserved;
+    };
+
+    struct Run {
+        uint16_t buttons;
+        uint32_t frames;
+    };
+
+    uint64_t rom_hash_ = 0;
+    StartState start_;
+    std::vector<Run> runs_;
+    uint32_t frame_count_ = 0;
+};
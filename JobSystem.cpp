@@ -0,0 +1,239 @@
+#include "JobSystem.h"
+#include "ThreadPlacement.h"
+#include <algorithm>
+
+namespace {
+
+// Which system and worker the calling thread is, so jobs submitted from a
+// job go onto that worker's own deques
+thread_local const JobSystem* tls_system = nullptr;
+thread_local int tls_worker = -1;
+
+}  // namespace
+
+void Job::wait() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    done_cv_.wait(lock, [this] { return state_.load() == DONE; });
+}
+
+bool Job::claim() {
+    int expected = QUEUED;
+    return state_.compare_exchange_strong(expected, RUNNING);
+}
+
+void JobSystem::init(int num_workers) {
+    if (!workers_.empty()) return;
+
+    if (num_workers <= 0) {
+        num_workers = std::max(1, static_cast<int>(std::thread::hardware_concurrency()) - 1);
+    }
+
+    stopping_.store(false);
+    for (int i = 0; i < num_workers; ++i) {
+        workers_.push_back(std::make_unique<Worker>());
+    }
+    // Started once every deque exists; a worker steals from all of them
+    for (int i = 0; i < num_workers; ++i) {
+        workers_[i]->thread = std::thread(&JobSystem::workerLoop, this, i);
+    }
+}
+
+void JobSystem::shutdown() {
+    stopping_.store(true);
+    dropQueued();
+    {
+        std::lock_guard<std::mutex> lock(sleep_mutex_);
+    }
+    sleep_cv_.notify_all();
+
+    for (auto& worker : workers_) {
+        if (worker->thread.joinable()) worker->thread.join();
+    }
+    dropQueued();  // split off by jobs that were still running
+    workers_.clear();
+}
+
+// Jobs that never started still need to release their waiters
+void JobSystem::dropQueued() {
+    auto drop = [this](std::deque<JobHandle>& queue) {
+        for (auto& job : queue) {
+            job->cancel();
+            if (job->claim()) finish(*job);
+        }
+        pending_.fetch_sub(static_cast<int>(queue.size()));
+        queue.clear();
+    };
+    {
+        std::lock_guard<std::mutex> lock(shared_mutex_);
+        for (auto& queue : shared_) drop(queue);
+    }
+    for (auto& worker : workers_) {
+        std::lock_guard<std::mutex> lock(worker->mutex);
+        for (auto& queue : worker->queues) drop(queue);
+    }
+}
+
+JobHandle JobSystem::submit(std::function<void(const Job&)> fn, JobPriority priority,
+                            const char* name, const CancelToken* token) {
+    auto job = std::make_shared<Job>();
+    job->fn_ = std::move(fn);
+    job->priority_ = priority;
+    job->name_ = name;
+    if (token) job->token_ = std::make_unique<CancelToken>(*token);
+
+    if (stopping_.load() || workers_.empty()) {
+        // No workers - run on the caller so waiters never block forever
+        run(job, nullptr);
+        return job;
+    }
+
+    // Counted before it is visible, so a worker that finds it never sees the count at zero
+    int p = static_cast<int>(priority);
+    pending_.fetch_add(1);
+    if (tls_system == this) {
+        Worker& worker = *workers_[tls_worker];
+        std::lock_guard<std::mutex> lock(worker.mutex);
+        worker.queues[p].push_back(job);
+    } else {
+        std::lock_guard<std::mutex> lock(shared_mutex_);
+        shared_[p].push_back(job);
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(sleep_mutex_);
+    }
+    sleep_cv_.notify_one();
+    return job;
+}
+
+void JobSystem::wait(const JobHandle& job) {
+    // Still queued: take it, leaving a claimed entry the workers skip
+    if (job->claim()) {
+        if (!job->isCancelled()) job->fn_(*job);
+        job->fn_ = nullptr;
+        finish(*job);
+        return;
+    }
+    job->wait();
+}
+
+void JobSystem::status(std::vector<Status>& out) {
+    out.clear();
+    auto add = [&out](const JobHandle& job, bool running) {
+        if (!job || !job->name_) return;
+        if (!running && job->state_.load() != Job::QUEUED) return;
+        Status status;
+        status.name = job->name_;
+        status.progress = job->progress();
+        status.running = running;
+        status.priority = job->priority_;
+        out.push_back(std::move(status));
+    };
+
+    for (auto& worker : workers_) {
+        std::lock_guard<std::mutex> lock(worker->mutex);
+        add(worker->current, true);
+    }
+    for (auto& worker : workers_) {
+        std::lock_guard<std::mutex> lock(worker->mutex);
+        for (auto& queue : worker->queues) {
+            for (auto& job : queue) add(job, false);
+        }
+    }
+    std::lock_guard<std::mutex> lock(shared_mutex_);
+    for (auto& queue : shared_) {
+        for (auto& job : queue) add(job, false);
+    }
+}
+
+void JobSystem::finish(Job& job) {
+    {
+        std::lock_guard<std::mutex> lock(job.mutex_);
+        job.state_.store(Job::DONE);
+    }
+    job.done_cv_.notify_all();
+}
+
+void JobSystem::run(const JobHandle& job, Worker* worker) {
+    if (!job->claim()) return;  // a waiter got to it first
+
+    if (worker) {
+        ThreadPlacement::update(job->priority_ == JobPriority::BATCH ? ThreadRole::BATCH : ThreadRole::WORKER);
+        std::lock_guard<std::mutex> lock(worker->mutex);
+        worker->current = job;
+        running_.fetch_add(1);
+    }
+    if (!job->isCancelled()) {
+        job->fn_(*job);
+    }
+    job->fn_ = nullptr;
+    if (worker) {
+        std::lock_guard<std::mutex> lock(worker->mutex);
+        worker->current.reset();
+        running_.fetch_sub(1);
+    }
+    finish(*job);
+}
+
+JobHandle JobSystem::popShared(int priority) {
+    std::lock_guard<std::mutex> lock(shared_mutex_);
+    std::deque<JobHandle>& queue = shared_[priority];
+    if (queue.empty()) return nullptr;
+    JobHandle job = std::move(queue.front());
+    queue.pop_front();
+    pending_.fetch_sub(1);
+    return job;
+}
+
+JobHandle JobSystem::popOwn(Worker& worker, int priority) {
+    std::lock_guard<std::mutex> lock(worker.mutex);
+    std::deque<JobHandle>& queue = worker.queues[priority];
+    if (queue.empty()) return nullptr;
+    JobHandle job = std::move(queue.back());
+    queue.pop_back();
+    pending_.fetch_sub(1);
+    return job;
+}
+
+JobHandle JobSystem::steal(int thief, int priority) {
+    int count = static_cast<int>(workers_.size());
+    for (int i = 1; i < count; ++i) {
+        Worker& victim = *workers_[(thief + i) % count];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        std::deque<JobHandle>& queue = victim.queues[priority];
+        if (queue.empty()) continue;
+        JobHandle job = std::move(queue.front());
+        queue.pop_front();
+        pending_.fetch_sub(1);
+        return job;
+    }
+    return nullptr;
+}
+
+// Newest of our own first (its data is still in cache), then the oldest
+// submitted from outside, then the oldest someone else split off
+JobHandle JobSystem::take(int index) {
+    for (int p = 0; p < PRIORITIES; ++p) {
+        if (JobHandle job = popOwn(*workers_[index], p)) return job;
+        if (JobHandle job = popShared(p)) return job;
+        if (JobHandle job = steal(index, p)) return job;
+    }
+    return nullptr;
+}
+
+void JobSystem::workerLoop(int index) {
+    tls_system = this;
+    tls_worker = index;
+    Worker& worker = *workers_[index];
+
+    for (;;) {
+        if (JobHandle job = take(index)) {
+            run(job, &worker);
+            continue;
+        }
+        if (stopping_.load()) return;
+
+        std::unique_lock<std::mutex> lock(sleep_mutex_);
+        sleep_cv_.wait(lock, [this] { return stopping_.load() || pending_.load() > 0; });
+    }
+}
@@ -0,0 +1,140 @@
+#pragma once
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <memory>
+#include <functional>
+
+// Interactive jobs (the current track, look-ahead, batch stepping) always
+// run before batch ones (album preprocessing, library scans, exports)
+enum class JobPriority {
+    INTERACTIVE,
+    BATCH,
+    COUNT
+};
+
+// Cancels every job submitted with it at once, e.g. all the reads of one scan
+class CancelToken {
+public:
+    CancelToken() : flag_(std::make_shared<std::atomic<bool>>(false)) {}
+
+    void cancel() const { flag_->store(true); }
+    bool isCancelled() const { return flag_->load(); }
+
+private:
+    std::shared_ptr<std::atomic<bool>> flag_;
+};
+
+// Handle to a submitted job. The job function polls isCancelled() and returns
+// early when asked to; wait() blocks until the function has returned.
+class Job {
+public:
+    void cancel() { cancelled_.store(true); }
+    bool isCancelled() const { return cancelled_.load() || (token_ && token_->isCancelled()); }
+    bool isDone() const { return state_.load() == DONE; }
+    void wait();
+
+    // Fraction done, set by the job function for the jobs window; < 0 until then
+    void setProgress(float progress) const { progress_.store(progress); }
+    float progress() const { return progress_.load(); }
+
+    const char* name() const { return name_; }
+    JobPriority priority() const { return priority_; }
+
+private:
+    friend class JobSystem;
+    enum State { QUEUED, RUNNING, DONE };
+
+    // Whoever moves the job out of QUEUED runs it: a worker, or a waiter helping out
+    bool claim();
+
+    std::function<void(const Job&)> fn_;
+    std::atomic<bool> cancelled_{false};
+    std::unique_ptr<CancelToken> token_;
+    std::atomic<int> state_{QUEUED};
+    mutable std::atomic<float> progress_{-1.0f};
+    const char* name_ = nullptr;   // static string, or nullptr for unlisted jobs
+    JobPriority priority_ = JobPriority::INTERACTIVE;
+    std::mutex mutex_;
+    std::condition_variable done_cv_;
+};
+
+using JobHandle = std::shared_ptr<Job>;
+
+// Worker threads for all long-running background work (track preprocessing,
+// exports, scans, look-ahead) that must stay off the UI and audio threads.
+// Each worker owns a deque per priority: jobs submitted by a job go onto its
+// worker's deque and run newest first, idle workers steal the oldest from
+// the others. Jobs from other threads share one FIFO queue per priority.
+class JobSystem {
+public:
+    // A named job the jobs window lists, running or queued
+    struct Status {
+        const char* name = nullptr;
+        float progress = -1.0f;
+        bool running = false;
+        JobPriority priority = JobPriority::INTERACTIVE;
+    };
+
+    JobSystem() = default;
+    ~JobSystem() { shutdown(); }
+
+    JobSystem(const JobSystem&) = delete;
+    JobSystem& operator=(const JobSystem&) = delete;
+
+    // Start worker threads (0 = hardware concurrency - 1, at least 1)
+    void init(int num_workers = 0);
+
+    // Cancel pending jobs and join all workers
+    void shutdown();
+
+    // Queue a job; the returned handle can cancel or wait for it. A token
+    // cancels it along with every other job that shares the token.
+    JobHandle submit(std::function<void(const Job&)> fn,
+                     JobPriority priority = JobPriority::INTERACTIVE,
+                     const char* name = nullptr, const CancelToken* token = nullptr);
+
+    // Job::wait() that runs the job on the caller if no worker has started it
+    // yet, so a job waiting on the jobs it split off never waits behind the queue
+    void wait(const JobHandle& job);
+
+    int workerCount() const { return static_cast<int>(workers_.size()); }
+    int pendingCount() const { return pending_.load(); }
+    bool isBusy() const { return pending_.load() > 0 || running_.load() > 0; }
+
+    // Named jobs, running ones first, for the jobs window
+    void status(std::vector<Status>& out);
+
+private:
+    static constexpr int PRIORITIES = static_cast<int>(JobPriority::COUNT);
+
+    struct Worker {
+        std::thread thread;
+        std::mutex mutex;
+        std::deque<JobHandle> queues[PRIORITIES];
+        JobHandle current;   // under mutex; for status()
+    };
+
+    void workerLoop(int index);
+    JobHandle take(int index);
+    JobHandle popShared(int priority);
+    JobHandle popOwn(Worker& worker, int priority);
+    JobHandle steal(int thief, int priority);
+    void run(const JobHandle& job, Worker* worker);
+    void dropQueued();
+    static void finish(Job& job);
+
+    std::vector<std::unique_ptr<Worker>> workers_;
+    std::mutex shared_mutex_;
+    std::deque<JobHandle> shared_[PRIORITIES];
+    std::atomic<int> pending_{0};   // entries in all queues, including ones a waiter already ran
+    std::atomic<int> running_{0};   // on a worker right now
+
+    std::mutex sleep_mutex_;
+    std::condition_variable sleep_cv_;
+    std::atomic<bool> stopping_{false};
+};
@@ -0,0 +1,193 @@
+#include "LatencyProbe.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+int64_t LatencyProbe::nowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void LatencyProbe::begin(long sample_rate) {
+    active_.store(false, std::memory_order_relaxed);
+    sample_rate_ = std::max(sample_rate, 8000l);
+
+    // A linear sweep under a Hann window: one sharp correlation peak, and
+    // nothing below the speakers' range or near Nyquist
+    int chirp_frames = static_cast<int>(CHIRP_SECONDS * sample_rate_);
+    double low = CHIRP_LOW_HZ;
+    double high = std::min<double>(CHIRP_HIGH_HZ, sample_rate_ * 0.45);
+    double duration = chirp_frames / static_cast<double>(sample_rate_);
+    chirp_.resize(chirp_frames);
+    for (int i = 0; i < chirp_frames; ++i) {
+        double t = i / static_cast<double>(sample_rate_);
+        double phase = 2.0 * M_PI * (low * t + (high - low) * t * t / (2.0 * duration));
+        double window = 0.5 - 0.5 * std::cos(2.0 * M_PI * i / (chirp_frames - 1));
+        chirp_[i] = static_cast<float>(CHIRP_LEVEL * window * std::sin(phase));
+    }
+    int lags = static_cast<int>(MAX_LATENCY * sample_rate_);
+    ring_.assign(RING_FRAMES, 0.0f);
+    window_.resize(lags + chirp_frames);
+    correlation_.resize(lags);
+
+    armed_.store(emitted_.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    recorded_.store(0, std::memory_order_relaxed);
+    origin_ns_.store(INT64_MAX, std::memory_order_relaxed);
+    latencies_.clear();
+    probes_ = 0;
+    awaiting_ = false;
+    status_ = Status::RUNNING;
+    started_ns_ = nowNs();
+    next_probe_ns_ = started_ns_ + static_cast<int64_t>(PROBE_INTERVAL * 1e9);   // let the device settle
+    active_.store(true, std::memory_order_release);
+}
+
+void LatencyProbe::cancel() {
+    active_.store(false, std::memory_order_relaxed);
+    if (status_ == Status::RUNNING) status_ = Status::IDLE;
+}
+
+void LatencyProbe::emit(float* buffer, int frames, int channels) {
+    if (!active_.load(std::memory_order_acquire)) {
+        chirp_pos_ = -1;
+        return;
+    }
+    int armed = armed_.load(std::memory_order_acquire);
+    if (chirp_pos_ < 0 && armed != emitted_.load(std::memory_order_relaxed)) {
+        emit_ns_.store(nowNs(), std::memory_order_relaxed);
+        emitted_.store(armed, std::memory_order_release);
+        chirp_pos_ = 0;
+    }
+    if (chirp_pos_ < 0) return;
+
+    int count = std::min(frames, static_cast<int>(chirp_.size()) - chirp_pos_);
+    for (int i = 0; i < count; ++i) {
+        float sample = chirp_[chirp_pos_ + i];
+        for (int c = 0; c < channels; ++c) buffer[i * channels + c] += sample;
+    }
+    chirp_pos_ += count;
+    if (chirp_pos_ >= static_cast<int>(chirp_.size())) chirp_pos_ = -1;
+}
+
+void LatencyProbe::capture(const float* buffer, int frames, int channels) {
+    if (!active_.load(std::memory_order_acquire) || channels <= 0) return;
+    uint64_t pos = recorded_.load(std::memory_order_relaxed);
+    float scale = 1.0f / channels;
+    for (int i = 0; i < frames; ++i) {
+        float sum = 0.0f;
+        for (int c = 0; c < channels; ++c) sum += buffer[i * channels + c];
+        ring_[(pos + i) & (RING_FRAMES - 1)] = sum * scale;
+    }
+    pos += frames;
+
+    // The block just finished recording; the earliest any has arrived
+    // relative to its frame count is the best clock for the recording
+    int64_t origin = nowNs() - static_cast<int64_t>(pos * 1000000000ull / static_cast<uint64_t>(sample_rate_));
+    if (origin < origin_ns_.load(std::memory_order_relaxed)) {
+        origin_ns_.store(origin, std::memory_order_relaxed);
+    }
+    recorded_.store(pos, std::memory_order_release);
+}
+
+int64_t LatencyProbe::recordedUntilNs() const {
+    uint64_t recorded = recorded_.load(std::memory_order_acquire);
+    if (recorded == 0) return INT64_MIN;
+    return origin_ns_.load(std::memory_order_relaxed) +
+           static_cast<int64_t>(recorded * 1000000000ull / static_cast<uint64_t>(sample_rate_));
+}
+
+void LatencyProbe::update() {
+    if (status_ != Status::RUNNING) return;
+    int64_t now = nowNs();
+    const int64_t timeout = static_cast<int64_t>(CAPTURE_TIMEOUT * 1e9);
+    if (recorded_.load(std::memory_order_acquire) == 0) {
+        if (now - started_ns_ > timeout) {
+            active_.store(false, std::memory_order_relaxed);
+            status_ = Status::NO_INPUT;
+        }
+        return;
+    }
+
+    if (!awaiting_) {
+        if (now < next_probe_ns_) return;
+        armed_.store(armed_.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+        armed_ns_ = now;
+        awaiting_ = true;
+        return;
+    }
+
+    // Wait for the output callback to send it (a stalled device gives up)
+    if (emitted_.load(std::memory_order_acquire) != armed_.load(std::memory_order_relaxed)) {
+        if (now - armed_ns_ > timeout) finish();
+        return;
+    }
+    // and for the recording to reach past the latest it could be heard
+    int64_t emit_ns = emit_ns_.load(std::memory_order_relaxed);
+    int64_t needed = emit_ns + static_cast<int64_t>((MAX_LATENCY + CHIRP_SECONDS) * 1e9);
+    if (recordedUntilNs() < needed) {
+        if (now - needed > timeout) {
+            active_.store(false, std::memory_order_relaxed);
+            status_ = Status::NO_INPUT;
+        }
+        return;
+    }
+
+    double latency = 0.0;
+    if (analyze(emit_ns, latency)) latencies_.push_back(latency);
+    awaiting_ = false;
+    next_probe_ns_ = now + static_cast<int64_t>(PROBE_INTERVAL * 1e9);
+    if (++probes_ == PROBES) finish();
+}
+
+bool LatencyProbe::analyze(int64_t emit_ns, double& latency) {
+    // The recorded frame at the emitting callback's time is lag 0
+    int64_t origin = origin_ns_.load(std::memory_order_relaxed);
+    int64_t start = static_cast<int64_t>(std::llround((emit_ns - origin) * 1e-9 * sample_rate_));
+    uint64_t recorded = recorded_.load(std::memory_order_acquire);
+    int span = static_cast<int>(window_.size());
+    if (start < 0 || static_cast<uint64_t>(start) + span > recorded ||
+        recorded - static_cast<uint64_t>(start) > RING_FRAMES) {
+        return false;   // recorded before the capture started, or already overwritten
+    }
+    for (int i = 0; i < span; ++i) window_[i] = ring_[(start + i) & (RING_FRAMES - 1)];
+
+    // Direct cross-correlation: a probe's half second is some 10^7
+    // multiply-adds, once per probe
+    const int chirp_frames = static_cast<int>(chirp_.size());
+    const int lags = static_cast<int>(correlation_.size());
+    int best = 0;
+    double power = 0.0;
+    for (int k = 0; k < lags; ++k) {
+        const float* x = window_.data() + k;
+        float sum = 0.0f;
+        for (int i = 0; i < chirp_frames; ++i) sum += chirp_[i] * x[i];
+        correlation_[k] = std::fabs(sum);
+        power += static_cast<double>(sum) * sum;
+        if (correlation_[k] > correlation_[best]) best = k;
+    }
+    double rms = std::sqrt(power / lags);
+    if (rms <= 0.0 || correlation_[best] < MIN_CLARITY * rms) return false;
+
+    // Parabolic fit through the peak for a fraction of a frame
+    double offset = 0.0;
+    if (best > 0 && best < lags - 1) {
+        double a = correlation_[best - 1], b = correlation_[best], c = correlation_[best + 1];
+        double denominator = a - 2.0 * b + c;
+        if (denominator < 0.0) offset = std::clamp(0.5 * (a - c) / denominator, -0.5, 0.5);
+    }
+    latency = (best + offset) / sample_rate_;
+    return true;
+}
+
+void LatencyProbe::finish() {
+    active_.store(false, std::memory_order_relaxed);
+    if (latencies_.empty()) {
+        status_ = Status::NO_ECHO;
+        return;
+    }
+    std::vector<double> sorted = latencies_;
+    std::sort(sorted.begin(), sorted.end());
+    latency_ = sorted[sorted.size() / 2];
+    spread_ = sorted.back() - sorted.front();
+    status_ = Status::DONE;
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+// End-to-end output latency, measured instead of guessed: a short chirp is
+// mixed into the output callback's block and recorded back through an input
+// device (a loopback/monitor source, or a microphone near the speakers), and
+// cross-correlating the recording with the chirp finds when it was heard.
+// The latency is from the callback that emitted the chirp to the moment it
+// was recorded, the span heard_output_frame() models as one device buffer
+// plus the output offset.
+//
+// The capture side keeps the recording on the steady clock by the earliest
+// its blocks have arrived (a block is never delivered before it was
+// recorded), so input buffering adds at most one capture period. Several
+// probes are sent and their median is the result; one whose correlation
+// peak doesn't stand clear of the rest is not counted.
+//
+// begin(), update() and the results are main thread only; emit() runs on the
+// output callback and capture() on the capture thread, neither allocating.
+class LatencyProbe {
+public:
+    static constexpr int PROBES = 5;
+    static constexpr double PROBE_INTERVAL = 0.35;    // seconds between chirps
+    static constexpr double MAX_LATENCY = 0.5;        // seconds searched after each
+    static constexpr double CHIRP_SECONDS = 0.02;
+    static constexpr float CHIRP_LOW_HZ = 500.0f;
+    static constexpr float CHIRP_HIGH_HZ = 8000.0f;
+    static constexpr float CHIRP_LEVEL = 0.5f;
+    static constexpr float MIN_CLARITY = 6.0f;        // correlation peak over its RMS
+    static constexpr double CAPTURE_TIMEOUT = 2.0;    // seconds without a recorded sample
+
+    enum class Status { IDLE, RUNNING, DONE, NO_INPUT, NO_ECHO };
+
+    // Start a measurement at the device's rate. The device must have been
+    // reopened since the last one ended (the callbacks leave the buffers
+    // alone while no measurement runs); the new one's callbacks may already
+    // be running.
+    void begin(long sample_rate);
+    void cancel();
+
+    // Output callback: mix the chirp in when one is due
+    void emit(float* buffer, int frames, int channels);
+
+    // Capture callback
+    void capture(const float* buffer, int frames, int channels);
+
+    // Main thread, every frame while RUNNING: sends the probes and
+    // correlates the recordings once they are in
+    void update();
+
+    Status status() const { return status_; }
+    bool running() const { return status_ == Status::RUNNING; }
+    int heard() const { return static_cast<int>(latencies_.size()); }
+    int sent() const { return probes_; }
+    double latencySeconds() const { return latency_; }   // median, valid when DONE
+    double spreadSeconds() const { return spread_; }     // max - min of the probes heard
+
+private:
+    static constexpr int RING_FRAMES = 1 << 17;       // ~3 s of mono at 44.1-48 kHz
+
+    static int64_t nowNs();
+    int64_t recordedUntilNs() const;
+    bool analyze(int64_t emit_ns, double& latency);
+    void finish();
+
+    long sample_rate_ = 44100;
+    std::vector<float> chirp_;
+    std::vector<float> ring_;                         // mono recording, frame p at p % RING_FRAMES
+    std::vector<float> window_;                       // the span searched after a probe
+    std::vector<float> correlation_;
+    std::atomic<bool> active_{false};
+
+    // Output side: the main thread arms a probe, the callback emits it
+    std::atomic<int> armed_{0};
+    std::atomic<int> emitted_{0};
+    std::atomic<int64_t> emit_ns_{0};                 // steady time of the emitting callback
+    int chirp_pos_ = -1;                              // output thread; -1 when idle
+
+    // Capture side
+    std::atomic<uint64_t> recorded_{0};               // frames written to ring_
+    std::atomic<int64_t> origin_ns_{INT64_MAX};       // steady time of recorded frame 0
+
+    Status status_ = Status::IDLE;
+    int probes_ = 0;                                  // emitted and analyzed
+    bool awaiting_ = false;                           // one is armed or being recorded
+    int64_t started_ns_ = 0;
+    int64_t armed_ns_ = 0;
+    int64_t next_probe_ns_ = 0;
+    std::vector<double> latencies_;
+    double latency_ = 0.0;
+    double spread_ = 0.0;
+};
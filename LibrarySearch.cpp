@@ -0,0 +1,207 @@
+#include "LibrarySearch.h"
+#include "NsfLibrary.h"
+#include "ChannelLayout.h"
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <iterator>
+
+namespace {
+
+char lower(char c) {
+    return static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+}
+
+uint32_t trigram(const char* s) {
+    return static_cast<uint8_t>(lower(s[0])) | static_cast<uint8_t>(lower(s[1])) << 8 |
+           static_cast<uint32_t>(static_cast<uint8_t>(lower(s[2]))) << 16;
+}
+
+// Case-insensitive substring test; needle is already lowercase
+bool contains(const std::string& text, const std::string& needle) {
+    auto it = std::search(text.begin(), text.end(), needle.begin(), needle.end(),
+                          [](char a, char b) { return lower(a) == b; });
+    return it != text.end();
+}
+
+// Every searchable string of an entry, in no particular order
+template <typename Fn>
+void forEachText(const NsfLibraryEntry& entry, Fn&& fn) {
+    fn(entry.game);
+    fn(entry.author);
+    fn(entry.path);
+    fn(LibrarySearch::chipNames(entry.chips));
+    for (const NsfLibraryTrack& track : entry.tracks) fn(track.name);
+}
+
+} // namespace
+
+// Every combination built once: the library window asks for each visible row every frame
+const std::string& LibrarySearch::chipNames(uint8_t chips) {
+    static const struct { uint8_t bit; const char* name; } CHIPS[] = {
+        {ChannelLayout::VRC6, "VRC6"}, {ChannelLayout::VRC7, "VRC7"}, {ChannelLayout::FDS, "FDS"},
+        {ChannelLayout::MMC5, "MMC5"}, {ChannelLayout::NAMCO, "N163"}, {ChannelLayout::FME7, "5B"},
+    };
+    static const std::vector<std::string> table = [] {
+        std::vector<std::string> names(256);
+        for (int mask = 0; mask < 256; ++mask) {
+            for (const auto& chip : CHIPS) {
+                if (!(mask & chip.bit)) continue;
+                if (!names[mask].empty()) names[mask] += ' ';
+                names[mask] += chip.name;
+            }
+            if (names[mask].empty()) names[mask] = "2A03";
+        }
+        return names;
+    }();
+    return table[chips];
+}
+
+void LibrarySearch::clear() {
+    keys_.clear();
+    offsets_.assign(1, 0);
+    ids_.clear();
+}
+
+void LibrarySearch::build(const std::vector<NsfLibraryEntry>& entries) {
+    // (trigram, entry) pairs, deduplicated per entry, then one sort into CSR form
+    std::vector<uint64_t> pairs;
+    std::vector<uint32_t> grams;
+    for (size_t id = 0; id < entries.size(); ++id) {
+        grams.clear();
+        forEachText(entries[id], [&grams](const std::string& text) {
+            for (size_t i = 0; i + 3 <= text.size(); ++i) grams.push_back(trigram(&text[i]));
+        });
+        std::sort(grams.begin(), grams.end());
+        grams.erase(std::unique(grams.begin(), grams.end()), grams.end());
+        for (uint32_t gram : grams) pairs.push_back(static_cast<uint64_t>(gram) << 32 | id);
+    }
+    std::sort(pairs.begin(), pairs.end());
+
+    clear();
+    ids_.reserve(pairs.size());
+    for (uint64_t pair : pairs) {
+        uint32_t key = static_cast<uint32_t>(pair >> 32);
+        if (keys_.empty() || keys_.back() != key) {
+            // offsets_ holds each list's start; this one closes the previous list
+            if (!keys_.empty()) offsets_.push_back(static_cast<uint32_t>(ids_.size()));
+            keys_.push_back(key);
+        }
+        ids_.push_back(static_cast<uint32_t>(pair));
+    }
+    if (!keys_.empty()) offsets_.push_back(static_cast<uint32_t>(ids_.size()));
+}
+
+bool LibrarySearch::assign(std::vector<uint32_t> keys, std::vector<uint32_t> offsets, std::vector<uint32_t> ids,
+                           size_t entry_count) {
+    bool ok = offsets.size() == keys.size() + 1 && offsets.front() == 0 && offsets.back() == ids.size() &&
+              std::is_sorted(keys.begin(), keys.end()) && std::is_sorted(offsets.begin(), offsets.end()) &&
+              std::all_of(ids.begin(), ids.end(), [entry_count](uint32_t id) { return id < entry_count; });
+    if (!ok) {
+        clear();
+        return false;
+    }
+    keys_ = std::move(keys);
+    offsets_ = std::move(offsets);
+    ids_ = std::move(ids);
+    return true;
+}
+
+const uint32_t* LibrarySearch::postings(uint32_t key, size_t& count) const {
+    auto it = std::lower_bound(keys_.begin(), keys_.end(), key);
+    if (it == keys_.end() || *it != key) {
+        count = 0;
+        return nullptr;
+    }
+    size_t k = it - keys_.begin();
+    count = offsets_[k + 1] - offsets_[k];
+    return ids_.data() + offsets_[k];
+}
+
+std::vector<LibrarySearch::Term> LibrarySearch::parse(const std::string& text) {
+    static const struct { const char* prefix; Field field; } PREFIXES[] = {
+        {"game:", GAME}, {"author:", AUTHOR}, {"composer:", AUTHOR}, {"track:", TRACK},
+        {"title:", TRACK}, {"chip:", CHIP}, {"file:", PATH},
+    };
+    std::vector<Term> terms;
+    size_t pos = 0;
+    while (pos < text.size()) {
+        while (pos < text.size() && std::isspace(static_cast<unsigned char>(text[pos]))) ++pos;
+        size_t end = pos;
+        while (end < text.size() && !std::isspace(static_cast<unsigned char>(text[end]))) ++end;
+        if (end == pos) break;
+
+        Term term = {ANY, text.substr(pos, end - pos)};
+        std::transform(term.text.begin(), term.text.end(), term.text.begin(), lower);
+        for (const auto& p : PREFIXES) {
+            size_t length = strlen(p.prefix);
+            if (term.text.compare(0, length, p.prefix) == 0) {
+                term.field = p.field;
+                term.text.erase(0, length);
+                break;
+            }
+        }
+        if (!term.text.empty()) terms.push_back(std::move(term));
+        pos = end;
+    }
+    return terms;
+}
+
+bool LibrarySearch::matches(const NsfLibraryEntry& entry, const Term& term) {
+    switch (term.field) {
+        case GAME:   return contains(entry.game, term.text);
+        case AUTHOR: return contains(entry.author, term.text);
+        case CHIP:   return contains(chipNames(entry.chips), term.text);
+        case PATH:   return contains(entry.path, term.text);
+        case TRACK:
+            return std::any_of(entry.tracks.begin(), entry.tracks.end(),
+                               [&term](const NsfLibraryTrack& track) { return contains(track.name, term.text); });
+        case ANY: {
+            bool found = false;
+            forEachText(entry, [&](const std::string& text) { found = found || contains(text, term.text); });
+            return found;
+        }
+    }
+    return false;
+}
+
+void LibrarySearch::query(const std::vector<NsfLibraryEntry>& entries, const std::string& text,
+                          std::vector<int>& out) const {
+    out.clear();
+    std::vector<Term> terms = parse(text);
+
+    // Candidates: the intersection of every trigram of every long term,
+    // shortest posting list first; all entries if no term is long enough
+    std::vector<std::pair<const uint32_t*, size_t>> lists;
+    for (const Term& term : terms) {
+        for (size_t i = 0; i + 3 <= term.text.size(); ++i) {
+            size_t count = 0;
+            const uint32_t* list = postings(trigram(&term.text[i]), count);
+            if (!list) return;
+            lists.push_back({list, count});
+        }
+    }
+
+    std::vector<uint32_t> candidates;
+    if (lists.empty()) {
+        candidates.resize(entries.size());
+        for (size_t i = 0; i < entries.size(); ++i) candidates[i] = static_cast<uint32_t>(i);
+    } else {
+        std::sort(lists.begin(), lists.end(), [](const auto& a, const auto& b) { return a.second < b.second; });
+        candidates.assign(lists[0].first, lists[0].first + lists[0].second);
+        std::vector<uint32_t> narrowed;
+        for (size_t l = 1; l < lists.size() && !candidates.empty(); ++l) {
+            narrowed.clear();
+            std::set_intersection(candidates.begin(), candidates.end(), lists[l].first,
+                                  lists[l].first + lists[l].second, std::back_inserter(narrowed));
+            candidates.swap(narrowed);
+        }
+    }
+
+    for (uint32_t id : candidates) {
+        if (id >= entries.size()) continue;
+        const NsfLibraryEntry& entry = entries[id];
+        bool all = std::all_of(terms.begin(), terms.end(), [&entry](const Term& term) { return matches(entry, term); });
+        if (all) out.push_back(static_cast<int>(id));
+    }
+}
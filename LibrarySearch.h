@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+struct NsfLibraryEntry;
+
+// Trigram index over the library's searchable text: game, author, track
+// titles, expansion chip names and path. Every lowercased 3-byte window of
+// every field maps to the ascending list of entries containing it, stored
+// flat (sorted keys, offsets, ids) so the whole index is three arrays that
+// the library file stores as is. A query is whitespace-separated terms that
+// must all match, optionally restricted with game:, author: (composer:),
+// track: (title:), chip: or file:. Terms of three or more bytes intersect
+// posting lists; every candidate is then checked with a substring match, so
+// results are exact.
+class LibrarySearch {
+public:
+    // "VRC6 FDS" etc. for NSF expansion chip flags, "2A03" for none
+    static const std::string& chipNames(uint8_t chips);
+
+    void build(const std::vector<NsfLibraryEntry>& entries);
+    void clear();
+
+    // Matching entry indices, ascending; an empty query matches everything
+    void query(const std::vector<NsfLibraryEntry>& entries, const std::string& text, std::vector<int>& out) const;
+
+    // Flat storage, for the library file
+    const std::vector<uint32_t>& keys() const { return keys_; }
+    const std::vector<uint32_t>& offsets() const { return offsets_; }
+    const std::vector<uint32_t>& ids() const { return ids_; }
+    // False (and the index left empty) if the arrays are inconsistent
+    bool assign(std::vector<uint32_t> keys, std::vector<uint32_t> offsets, std::vector<uint32_t> ids,
+                size_t entry_count);
+
+private:
+    enum Field : uint8_t { ANY, GAME, AUTHOR, TRACK, CHIP, PATH };
+
+    struct Term {
+        Field field;
+        std::string text;   // lowercased
+    };
+
+    static std::vector<Term> parse(const std::string& text);
+    static bool matches(const NsfLibraryEntry& entry, const Term& term);
+    // Posting list of one trigram, or nullptr/0 if absent
+    const uint32_t* postings(uint32_t key, size_t& count) const;
+
+    std::vector<uint32_t> keys_;      // trigrams, ascending
+    std::vector<uint32_t> offsets_{0};   // keys_.size() + 1 offsets into ids_
+    std::vector<uint32_t> ids_;
+};
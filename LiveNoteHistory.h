@@ -0,0 +1,100 @@
+#pragma once
+
+#include "NoteTimeline.h"
+#include "ChannelLayout.h"
+#include <algorithm>
+#include <array>
+#include <cstdint>
+
+// The notes heard in the last SECONDS, recorded as they are played, for a
+// roll of a source there is nothing to preprocess from (the emulator).
+// Finished notes go into a fixed ring in the order they end, so their end
+// times ascend and the ones still on screen are one binary search from the
+// newest; the memory never grows however long the game runs. Notes still
+// sounding are kept per channel until they end. Played time running
+// backwards (rewind, state load, reset) starts the history over.
+class LiveNoteHistory {
+public:
+    static constexpr int CAPACITY = 4096;       // far more notes than a minute of any driver ends
+    static constexpr float SECONDS = 60.0f;
+
+    LiveNoteHistory() { clear(); }
+
+    void clear() {
+        head_ = tail_ = 0;
+        time_ = 0.0f;
+        for (Open& open : open_) open.midi_note = -1;
+    }
+
+    size_t size() const { return static_cast<size_t>(head_ - tail_); }
+
+    // One channel's note at 'time', -1 if silent; called for every channel
+    // each time the played state is sampled, in time order
+    void update(int channel, int midi_note, float velocity, float time) {
+        if (channel < 0 || channel >= ChannelLayout::MAX_CHANNELS) return;
+        if (time < time_) clear();
+        time_ = time;
+
+        Open& open = open_[channel];
+        if (open.midi_note == midi_note) return;
+        if (open.midi_note >= 0 && time > open.start) {
+            push({channel, open.midi_note, open.velocity, open.start, time});
+        }
+        open = {midi_note, velocity, time};
+
+        // Age out what is older than the history
+        while (tail_ < head_ && at(tail_).end_time < time - SECONDS) ++tail_;
+    }
+
+    // Call fn(const PianoRollNote&) for notes sounding at some point of
+    // [time_begin, time_end], at most 'max_notes' of them: the sounding
+    // notes, then finished ones newest first, so a dense passage loses its
+    // oldest notes rather than the ones just played
+    template <typename Fn>
+    int forEachInRange(float time_begin, float time_end, int max_notes, Fn&& fn) const {
+        int drawn = 0;
+        for (int c = 0; c < ChannelLayout::MAX_CHANNELS && drawn < max_notes; ++c) {
+            const Open& open = open_[c];
+            if (open.midi_note < 0 || open.start > time_end || time_ < time_begin) continue;
+            fn(PianoRollNote{c, open.midi_note, open.velocity, open.start, time_});
+            ++drawn;
+        }
+
+        // First finished note ending inside the range
+        uint64_t lo = tail_;
+        uint64_t hi = head_;
+        while (lo < hi) {
+            uint64_t mid = lo + (hi - lo) / 2;
+            if (at(mid).end_time < time_begin) lo = mid + 1;
+            else hi = mid;
+        }
+        for (uint64_t i = head_; i > lo && drawn < max_notes; --i) {
+            const PianoRollNote& note = at(i - 1);
+            if (note.start_time > time_end) continue;
+            fn(note);
+            ++drawn;
+        }
+        return drawn;
+    }
+
+private:
+    struct Open {
+        int midi_note = -1;
+        float velocity = 0.0f;
+        float start = 0.0f;
+    };
+
+    const PianoRollNote& at(uint64_t index) const { return ring_[index % CAPACITY]; }
+
+    void push(const PianoRollNote& note) {
+        ring_[head_ % CAPACITY] = note;
+        ++head_;
+        if (head_ - tail_ > static_cast<uint64_t>(CAPACITY)) tail_ = head_ - CAPACITY;
+    }
+
+    std::array<PianoRollNote, CAPACITY> ring_;
+    uint64_t head_ = 0;     // notes pushed ever; the ring holds [tail_, head_)
+    uint64_t tail_ = 0;
+    float time_ = 0.0f;     // newest sample time
+    std::array<Open, ChannelLayout::MAX_CHANNELS> open_;
+};
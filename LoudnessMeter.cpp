@@ -0,0 +1,287 @@
+#include "LoudnessMeter.h"
+#include <algorithm>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define LOUDNESS_USE_SSE2 1
+#elif defined(__aarch64__) && (defined(__ARM_NEON) || defined(__ARM_NEON__))
+#include <arm_neon.h>
+#define LOUDNESS_USE_NEON 1
+#endif
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+// ITU-R BS.1770-4 Annex 2: 4x oversampling interpolator, 12 taps per phase
+static const float TRUE_PEAK_FIR[4][12] = {
+    {  0.0017089843750f,  0.0109863281250f, -0.0196533203125f,  0.0332031250000f,
+      -0.0594482421875f,  0.1373291015625f,  0.9721679687500f, -0.1022949218750f,
+       0.0476074218750f, -0.0266113281250f,  0.0148925781250f, -0.0083007812500f },
+    { -0.0291748046875f,  0.0292968750000f, -0.0517578125000f,  0.0891113281250f,
+      -0.1665039062500f,  0.4650878906250f,  0.7797851562500f, -0.2003173828125f,
+       0.1015625000000f, -0.0582275390625f,  0.0330810546875f, -0.0189208984375f },
+    { -0.0189208984375f,  0.0330810546875f, -0.0582275390625f,  0.1015625000000f,
+      -0.2003173828125f,  0.7797851562500f,  0.4650878906250f, -0.1665039062500f,
+       0.0891113281250f, -0.0517578125000f,  0.0292968750000f, -0.0291748046875f },
+    { -0.0083007812500f,  0.0148925781250f, -0.0266113281250f,  0.0476074218750f,
+      -0.1022949218750f,  0.9721679687500f,  0.1373291015625f, -0.0594482421875f,
+       0.0332031250000f, -0.0196533203125f,  0.0109863281250f,  0.0017089843750f },
+};
+
+void LoudnessMeter::setSampleRate(long sample_rate) {
+    sample_rate_ = std::max(8000L, sample_rate);
+    double rate = static_cast<double>(sample_rate_);
+
+    // K-weighting for any rate (the standard only tabulates 48 kHz):
+    // a +4 dB high shelf around 1.7 kHz for the head...
+    {
+        const double f0 = 1681.974450955533;
+        const double gain_db = 3.999843853973347;
+        const double q = 0.7071752369554196;
+        double k = std::tan(M_PI * f0 / rate);
+        double vh = std::pow(10.0, gain_db / 20.0);
+        double vb = std::pow(vh, 0.4996667741545416);
+        double a0 = 1.0 + k / q + k * k;
+        stage_[0] = { (vh + vb * k / q + k * k) / a0, 2.0 * (k * k - vh) / a0, (vh - vb * k / q + k * k) / a0,
+                      2.0 * (k * k - 1.0) / a0, (1.0 - k / q + k * k) / a0 };
+    }
+    // ...then the RLB high-pass at 38 Hz
+    {
+        const double f0 = 38.13547087602444;
+        const double q = 0.5003270373238773;
+        double k = std::tan(M_PI * f0 / rate);
+        double a0 = 1.0 + k / q + k * k;
+        stage_[1] = { 1.0, -2.0, 1.0, 2.0 * (k * k - 1.0) / a0, (1.0 - k / q + k * k) / a0 };
+    }
+
+    for (int t = 0; t < TAPS; ++t) {
+        for (int p = 0; p < PHASES; ++p) {
+            phase_coefs_[t][p] = TRUE_PEAK_FIR[p][TAPS - 1 - t];
+        }
+    }
+    block_frames_ = static_cast<int>(std::lround(rate * 0.1));
+    reset();
+}
+
+void LoudnessMeter::reset() {
+    block_filled_ = 0;
+    for (auto& stage : state_) for (auto& z : stage) z[0] = z[1] = 0.0;
+    energy_[0] = energy_[1] = 0.0;
+    block_energy_.fill(0.0);
+    blocks_ = 0;
+    gated_count_.fill(0);
+    gated_energy_.fill(0.0);
+    for (auto& history : history_) std::fill(std::begin(history), std::end(history), 0.0f);
+    history_pos_ = 0;
+    peak_ = 0.0f;
+    recent_peak_ = 0.0f;
+}
+
+void LoudnessMeter::process(const float* frames, int count) {
+    if (!frames || count <= 0) return;
+    measurePeaks(frames, count);
+    while (count > 0) {
+        int n = std::min(count, block_frames_ - block_filled_);
+        kWeight(frames, n);
+        block_filled_ += n;
+        frames += n * 2;
+        count -= n;
+        if (block_filled_ == block_frames_) finishBlock();
+    }
+}
+
+void LoudnessMeter::kWeight(const float* frames, int count) {
+    const Biquad& s0 = stage_[0];
+    const Biquad& s1 = stage_[1];
+#if defined(LOUDNESS_USE_SSE2)
+    // Left and right in the two double lanes
+    const __m128d b00 = _mm_set1_pd(s0.b0), b01 = _mm_set1_pd(s0.b1), b02 = _mm_set1_pd(s0.b2);
+    const __m128d a01 = _mm_set1_pd(s0.a1), a02 = _mm_set1_pd(s0.a2);
+    const __m128d b10 = _mm_set1_pd(s1.b0), b11 = _mm_set1_pd(s1.b1), b12 = _mm_set1_pd(s1.b2);
+    const __m128d a11 = _mm_set1_pd(s1.a1), a12 = _mm_set1_pd(s1.a2);
+    __m128d z01 = _mm_loadu_pd(state_[0][0]), z02 = _mm_loadu_pd(state_[0][1]);
+    __m128d z11 = _mm_loadu_pd(state_[1][0]), z12 = _mm_loadu_pd(state_[1][1]);
+    __m128d energy = _mm_loadu_pd(energy_);
+    for (int i = 0; i < count; ++i) {
+        __m128d x = _mm_cvtps_pd(_mm_castsi128_ps(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(frames + i * 2))));
+        __m128d y = _mm_add_pd(_mm_mul_pd(b00, x), z01);
+        z01 = _mm_add_pd(_mm_sub_pd(_mm_mul_pd(b01, x), _mm_mul_pd(a01, y)), z02);
+        z02 = _mm_sub_pd(_mm_mul_pd(b02, x), _mm_mul_pd(a02, y));
+        __m128d w = _mm_add_pd(_mm_mul_pd(b10, y), z11);
+        z11 = _mm_add_pd(_mm_sub_pd(_mm_mul_pd(b11, y), _mm_mul_pd(a11, w)), z12);
+        z12 = _mm_sub_pd(_mm_mul_pd(b12, y), _mm_mul_pd(a12, w));
+        energy = _mm_add_pd(energy, _mm_mul_pd(w, w));
+    }
+    _mm_storeu_pd(state_[0][0], z01);
+    _mm_storeu_pd(state_[0][1], z02);
+    _mm_storeu_pd(state_[1][0], z11);
+    _mm_storeu_pd(state_[1][1], z12);
+    _mm_storeu_pd(energy_, energy);
+#elif defined(LOUDNESS_USE_NEON)
+    float64x2_t z01 = vld1q_f64(state_[0][0]), z02 = vld1q_f64(state_[0][1]);
+    float64x2_t z11 = vld1q_f64(state_[1][0]), z12 = vld1q_f64(state_[1][1]);
+    float64x2_t energy = vld1q_f64(energy_);
+    for (int i = 0; i < count; ++i) {
+        float64x2_t x = vcvt_f64_f32(vld1_f32(frames + i * 2));
+        float64x2_t y = vfmaq_n_f64(z01, x, s0.b0);
+        z01 = vfmsq_n_f64(vfmaq_n_f64(z02, x, s0.b1), y, s0.a1);
+        z02 = vfmsq_n_f64(vmulq_n_f64(x, s0.b2), y, s0.a2);
+        float64x2_t w = vfmaq_n_f64(z11, y, s1.b0);
+        z11 = vfmsq_n_f64(vfmaq_n_f64(z12, y, s1.b1), w, s1.a1);
+        z12 = vfmsq_n_f64(vmulq_n_f64(y, s1.b2), w, s1.a2);
+        energy = vfmaq_f64(energy, w, w);
+    }
+    vst1q_f64(state_[0][0], z01);
+    vst1q_f64(state_[0][1], z02);
+    vst1q_f64(state_[1][0], z11);
+    vst1q_f64(state_[1][1], z12);
+    vst1q_f64(energy_, energy);
+#else
+    for (int c = 0; c < 2; ++c) {
+        double z01 = state_[0][0][c], z02 = state_[0][1][c];
+        double z11 = state_[1][0][c], z12 = state_[1][1][c];
+        double energy = energy_[c];
+        for (int i = 0; i < count; ++i) {
+            double x = frames[i * 2 + c];
+            double y = s0.b0 * x + z01;
+            z01 = s0.b1 * x - s0.a1 * y + z02;
+            z02 = s0.b2 * x - s0.a2 * y;
+            double w = s1.b0 * y + z11;
+            z11 = s1.b1 * y - s1.a1 * w + z12;
+            z12 = s1.b2 * y - s1.a2 * w;
+            energy += w * w;
+        }
+        state_[0][0][c] = z01;
+        state_[0][1][c] = z02;
+        state_[1][0][c] = z11;
+        state_[1][1][c] = z12;
+        energy_[c] = energy;
+    }
+#endif
+}
+
+void LoudnessMeter::measurePeaks(const float* frames, int count) {
+    float peak = 0.0f;
+#if defined(LOUDNESS_USE_SSE2)
+    const __m128 sign = _mm_set1_ps(-0.0f);
+    __m128 peaks = _mm_setzero_ps();
+#elif defined(LOUDNESS_USE_NEON)
+    float32x4_t peaks = vdupq_n_f32(0.0f);
+#endif
+    int pos = history_pos_;
+    for (int i = 0; i < count; ++i) {
+        for (int c = 0; c < 2; ++c) {
+            float* history = history_[c];
+            history[pos] = history[pos + TAPS] = frames[i * 2 + c];
+            const float* window = history + pos + 1;    // the last TAPS samples, oldest first
+#if defined(LOUDNESS_USE_SSE2)
+            // All four phases of the oversampled point at once
+            __m128 acc = _mm_setzero_ps();
+            for (int t = 0; t < TAPS; ++t) {
+                acc = _mm_add_ps(acc, _mm_mul_ps(_mm_load_ps(phase_coefs_[t]), _mm_set1_ps(window[t])));
+            }
+            peaks = _mm_max_ps(peaks, _mm_andnot_ps(sign, acc));
+#elif defined(LOUDNESS_USE_NEON)
+            float32x4_t acc = vdupq_n_f32(0.0f);
+            for (int t = 0; t < TAPS; ++t) {
+                acc = vmlaq_n_f32(acc, vld1q_f32(phase_coefs_[t]), window[t]);
+            }
+            peaks = vmaxq_f32(peaks, vabsq_f32(acc));
+#else
+            for (int p = 0; p < PHASES; ++p) {
+                float acc = 0.0f;
+                for (int t = 0; t < TAPS; ++t) acc += phase_coefs_[t][p] * window[t];
+                peak = std::max(peak, std::abs(acc));
+            }
+#endif
+        }
+        pos = pos + 1 == TAPS ? 0 : pos + 1;
+    }
+    history_pos_ = pos;
+#if defined(LOUDNESS_USE_SSE2)
+    alignas(16) float lanes[4];
+    _mm_store_ps(lanes, peaks);
+    peak = std::max(std::max(lanes[0], lanes[1]), std::max(lanes[2], lanes[3]));
+#elif defined(LOUDNESS_USE_NEON)
+    peak = vmaxvq_f32(peaks);
+#endif
+    peak_ = std::max(peak_, peak);
+    recent_peak_ = std::max(recent_peak_, peak);
+}
+
+void LoudnessMeter::finishBlock() {
+    block_energy_[blocks_ % SHORT_TERM_BLOCKS] = (energy_[0] + energy_[1]) / block_frames_;
+    ++blocks_;
+    energy_[0] = energy_[1] = 0.0;
+    block_filled_ = 0;
+
+    // Once the input stops, the filter state decays into denormals, where it
+    // can stick and slow every sample down; it is inaudible long before that
+    double* state = &state_[0][0][0];
+    for (int i = 0; i < 8; ++i) {
+        if (std::abs(state[i]) < 1.0e-30) state[i] = 0.0;
+    }
+
+    // Gating blocks are 400 ms long and start every 100 ms
+    if (blocks_ < MOMENTARY_BLOCKS) return;
+    double energy = 0.0;
+    for (int b = 1; b <= MOMENTARY_BLOCKS; ++b) energy += block_energy_[(blocks_ - b) % SHORT_TERM_BLOCKS];
+    energy /= MOMENTARY_BLOCKS;
+    float lufs = loudness(energy);
+    if (lufs < HISTOGRAM_MIN) return;
+    int bin = std::min(HISTOGRAM_BINS - 1, static_cast<int>((lufs - HISTOGRAM_MIN) / HISTOGRAM_STEP));
+    gated_count_[bin]++;
+    gated_energy_[bin] += energy;
+}
+
+float LoudnessMeter::loudness(double energy) {
+    return energy > 0.0 ? static_cast<float>(-0.691 + 10.0 * std::log10(energy)) : NO_SIGNAL;
+}
+
+float LoudnessMeter::meanLoudness(int blocks) const {
+    int n = static_cast<int>(std::min<uint64_t>(blocks, blocks_));
+    if (n == 0) return NO_SIGNAL;
+    double energy = 0.0;
+    for (int b = 1; b <= n; ++b) energy += block_energy_[(blocks_ - b) % SHORT_TERM_BLOCKS];
+    return loudness(energy / n);
+}
+
+float LoudnessMeter::momentary() const {
+    return meanLoudness(MOMENTARY_BLOCKS);
+}
+
+float LoudnessMeter::shortTerm() const {
+    return meanLoudness(SHORT_TERM_BLOCKS);
+}
+
+float LoudnessMeter::integrated() const {
+    // Relative gate: 10 LU under the mean of everything above the absolute gate
+    uint64_t count = 0;
+    double energy = 0.0;
+    for (int b = 0; b < HISTOGRAM_BINS; ++b) {
+        count += gated_count_[b];
+        energy += gated_energy_[b];
+    }
+    if (count == 0) return NO_SIGNAL;
+    float relative = loudness(energy / count) - 10.0f;
+    int first = std::max(0, static_cast<int>(std::floor((relative - HISTOGRAM_MIN) / HISTOGRAM_STEP)));
+    count = 0;
+    energy = 0.0;
+    for (int b = first; b < HISTOGRAM_BINS; ++b) {
+        count += gated_count_[b];
+        energy += gated_energy_[b];
+    }
+    return count > 0 ? loudness(energy / count) : NO_SIGNAL;
+}
+
+float LoudnessMeter::truePeak() const {
+    return peak_ > 0.0f ? 20.0f * std::log10(peak_) : NO_SIGNAL;
+}
+
+float LoudnessMeter::takeRecentPeak() {
+    float peak = recent_peak_;
+    recent_peak_ = 0.0f;
+    return peak > 0.0f ? 20.0f * std::log10(peak) : NO_SIGNAL;
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+// EBU R128 loudness of a stereo stream (ITU-R BS.1770-4): each channel
+// goes through the K-weighting pre-filter and RLB high-pass, and its mean
+// square is summed per 100 ms block. Momentary loudness is the last 400 ms,
+// short-term the last 3 s, and integrated the whole stream since reset()
+// through the absolute (-70 LUFS) and relative (-10 LU) gates; the gated
+// 400 ms blocks go into a 0.1 LU histogram, so the integration never grows
+// with the length of the stream. True peak is the largest sample of the
+// 4x oversampled signal (the standard's 48-tap interpolator).
+//
+// The filters run in vector lanes, both channels' biquads side by side and
+// the four interpolation phases of a sample at once, so metering every
+// sample stays cheap enough to leave on. One thread.
+class LoudnessMeter {
+public:
+    static constexpr float NO_SIGNAL = -1.0e9f;      // loudness of silence (below any gate)
+
+    LoudnessMeter() { setSampleRate(44100); }
+
+    // Designs the filters for the rate and starts over
+    void setSampleRate(long sample_rate);
+    long sampleRate() const { return sample_rate_; }
+    void reset();
+
+    // Interleaved stereo frames, full scale +/-1
+    void process(const float* frames, int count);
+
+    // LUFS, NO_SIGNAL before any gated audio
+    float momentary() const;
+    float shortTerm() const;
+    float integrated() const;
+
+    // dBTP: the largest since reset(), and since the last takeRecentPeak()
+    float truePeak() const;
+    float takeRecentPeak();
+
+    static bool hasSignal(float lufs) { return lufs > -200.0f; }
+
+private:
+    static constexpr int TAPS = 12;                  // per interpolation phase
+    static constexpr int PHASES = 4;
+    static constexpr int SHORT_TERM_BLOCKS = 30;     // 100 ms blocks
+    static constexpr int MOMENTARY_BLOCKS = 4;
+    static constexpr float HISTOGRAM_MIN = -70.0f;   // absolute gate
+    static constexpr float HISTOGRAM_STEP = 0.1f;
+    static constexpr int HISTOGRAM_BINS = 750;       // up to +5 LUFS
+
+    struct Biquad {
+        double b0, b1, b2, a1, a2;
+    };
+
+    void kWeight(const float* frames, int count);
+    void measurePeaks(const float* frames, int count);
+    void finishBlock();
+    float meanLoudness(int blocks) const;
+    static float loudness(double energy);
+
+    long sample_rate_ = 0;
+    int block_frames_ = 0;
+    int block_filled_ = 0;
+
+    // K-weighting: two stages, transposed direct form II, state per channel
+    Biquad stage_[2] = {};
+    double state_[2][2][2] = {};                     // [stage][z1, z2][channel]
+    double energy_[2] = {};                          // sum of squares in this block
+
+    // Per-block channel energy sums (mean squares), newest at blocks_ - 1
+    std::array<double, SHORT_TERM_BLOCKS> block_energy_{};
+    uint64_t blocks_ = 0;
+
+    // Gated 400 ms blocks at or above the absolute gate
+    std::array<uint32_t, HISTOGRAM_BINS> gated_count_{};
+    std::array<double, HISTOGRAM_BINS> gated_energy_{};
+
+    // Interpolator phases per tap, oldest sample first, for the vector dot
+    // products; history is doubled so the last TAPS samples are contiguous
+    alignas(16) float phase_coefs_[TAPS][PHASES] = {};
+    alignas(16) float history_[2][TAPS * 2] = {};
+    int history_pos_ = 0;
+    float peak_ = 0.0f;
+    float recent_peak_ = 0.0f;
+};
@@ -0,0 +1,102 @@
+#include "Lz4.h"
+#include <cstring>
+
+namespace {
+
+uint32_t read32(const uint8_t* p) {
+    uint32_t value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+// A length past the token's 15: 255s, then the remainder
+uint8_t* putLength(uint8_t* out, size_t length) {
+    for (; length >= 255; length -= 255) *out++ = 255;
+    *out++ = static_cast<uint8_t>(length);
+    return out;
+}
+
+bool getLength(const uint8_t*& in, const uint8_t* end, size_t& length) {
+    uint8_t byte;
+    do {
+        if (in == end) return false;
+        byte = *in++;
+        length += byte;
+    } while (byte == 255);
+    return true;
+}
+
+}  // namespace
+
+size_t Lz4::compress(const uint8_t* in, size_t size, uint8_t* out) {
+    uint32_t table[1 << HASH_BITS] = {};   // position + 1 of the last sequence per hash; 0 empty
+    uint8_t* op = out;
+    size_t anchor = 0;
+
+    // One sequence: the literals since the anchor, then a match
+    auto emit = [&](size_t literals_end, size_t offset, size_t match) {
+        size_t literals = literals_end - anchor;
+        uint8_t* token = op++;
+        *token = static_cast<uint8_t>(literals >= 15 ? 15 << 4 : literals << 4);
+        if (literals >= 15) op = putLength(op, literals - 15);
+        memcpy(op, in + anchor, literals);
+        op += literals;
+        if (match == 0) return;
+        *op++ = static_cast<uint8_t>(offset);
+        *op++ = static_cast<uint8_t>(offset >> 8);
+        size_t extra = match - MIN_MATCH;
+        *token |= static_cast<uint8_t>(extra >= 15 ? 15 : extra);
+        if (extra >= 15) op = putLength(op, extra - 15);
+    };
+
+    size_t pos = 0;
+    while (size >= MATCH_LIMIT && pos + MATCH_LIMIT <= size) {
+        uint32_t sequence = read32(in + pos);
+        uint32_t hash = (sequence * 2654435761u) >> (32 - HASH_BITS);
+        size_t candidate = table[hash];
+        table[hash] = static_cast<uint32_t>(pos + 1);
+        if (candidate == 0 || pos - (candidate - 1) > MAX_OFFSET || read32(in + candidate - 1) != sequence) {
+            ++pos;
+            continue;
+        }
+        size_t ref = candidate - 1;
+        size_t match = MIN_MATCH;
+        while (pos + match < size - LAST_LITERALS && in[ref + match] == in[pos + match]) ++match;
+        emit(pos, pos - ref, match);
+        pos += match;
+        anchor = pos;
+    }
+    emit(size, 0, 0);
+    return static_cast<size_t>(op - out);
+}
+
+bool Lz4::decompress(const uint8_t* in, size_t in_size, uint8_t* out, size_t out_size) {
+    const uint8_t* ip = in;
+    const uint8_t* in_end = in + in_size;
+    uint8_t* op = out;
+    uint8_t* out_end = out + out_size;
+    while (ip < in_end) {
+        uint8_t token = *ip++;
+        size_t literals = token >> 4;
+        if (literals == 15 && !getLength(ip, in_end, literals)) return false;
+        if (literals > static_cast<size_t>(in_end - ip) || literals > static_cast<size_t>(out_end - op)) return false;
+        memcpy(op, ip, literals);
+        ip += literals;
+        op += literals;
+        if (ip == in_end) break;    // the last sequence has no match
+
+        if (in_end - ip < 2) return false;
+        size_t offset = ip[0] | ip[1] << 8;
+        ip += 2;
+        if (offset == 0 || offset > static_cast<size_t>(op - out)) return false;
+        size_t match = token & 15;
+        if (match == 15 && !getLength(ip, in_end, match)) return false;
+        match += MIN_MATCH;
+        if (match > static_cast<size_t>(out_end - op)) return false;
+        // Byte by byte: a match may overlap what it is copying
+        const uint8_t* from = op - offset;
+        for (size_t i = 0; i < match; ++i) op[i] = from[i];
+        op += match;
+    }
+    return op == out_end;
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// LZ4 block format (no frame header), for savestates on disk: a greedy
+// single-probe compressor, fast enough to run on a job without a thought,
+// and a decompressor that checks every length against both buffers, since
+// its input comes from files.
+class Lz4 {
+public:
+    // Largest compress() output for 'size' input bytes
+    static size_t bound(size_t size) { return size + size / 255 + 16; }
+
+    // Compress 'size' bytes into 'out' (bound(size) bytes); returns the
+    // compressed size
+    static size_t compress(const uint8_t* in, size_t size, uint8_t* out);
+
+    // False unless 'in' decodes to exactly 'out_size' bytes
+    static bool decompress(const uint8_t* in, size_t in_size, uint8_t* out, size_t out_size);
+
+private:
+    static constexpr int HASH_BITS = 12;
+    static constexpr size_t MIN_MATCH = 4;
+    static constexpr size_t LAST_LITERALS = 5;     // the block ends in literals
+    static constexpr size_t MATCH_LIMIT = 12;      // no match starts closer to the end
+    static constexpr size_t MAX_OFFSET = 65535;
+};
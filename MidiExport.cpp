@@ -0,0 +1,138 @@
+#include "MidiExport.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+// General MIDI program closest to each oscillator
+uint8_t programFor(ChannelKind kind) {
+    switch (kind) {
+        case ChannelKind::Square:
+        case ChannelKind::Vrc6Pulse:
+        case ChannelKind::Fme7Square:
+        case ChannelKind::Voice:
+            return 80;   // Lead 1 (square)
+        case ChannelKind::Vrc6Saw:
+            return 81;   // Lead 2 (sawtooth)
+        case ChannelKind::Triangle:
+            return 38;   // Synth Bass 1
+        case ChannelKind::NamcoWave:
+            return 82;   // Lead 3 (calliope)
+        case ChannelKind::Noise:
+        case ChannelKind::DMC:
+            return 118;  // Synth Drum
+    }
+    return 0;
+}
+
+} // namespace
+
+MidiFileWriter::~MidiFileWriter() {
+    if (file_) fclose(file_);
+}
+
+bool MidiFileWriter::open(const std::string& path, const ChannelLayout& layout, const char* title) {
+    file_ = fopen(path.c_str(), "wb");
+    if (!file_) return false;
+    title_ = title ? title : "";
+
+    // MIDI channel 10 is percussion in General MIDI, so it is skipped
+    tracks_.assign(layout.size(), Track());
+    int midi_channel = 0;
+    for (int ch = 0; ch < layout.size(); ++ch) {
+        if (midi_channel == 9) ++midi_channel;
+        Track& track = tracks_[ch];
+        track.midi_channel = static_cast<uint8_t>(midi_channel);
+        midi_channel = (midi_channel + 1) % 16;
+
+        putVarLen(track.events, 0);
+        putMeta(track.events, 0x03, layout[ch].name);
+        putVarLen(track.events, 0);
+        track.events.push_back(0xC0 | track.midi_channel);
+        track.events.push_back(programFor(layout[ch].kind));
+    }
+    return true;
+}
+
+void MidiFileWriter::addNote(const PianoRollNote& note) {
+    if (note.channel < 0 || note.channel >= static_cast<int>(tracks_.size())) return;
+    if (note.midi_note < 0 || note.midi_note > 127) return;
+    Track& track = tracks_[note.channel];
+
+    uint32_t on = static_cast<uint32_t>(std::lround(std::max(0.0f, note.start_time) * TICKS_PER_SECOND));
+    uint32_t off = static_cast<uint32_t>(std::lround(std::max(0.0f, note.end_time) * TICKS_PER_SECOND));
+    on = std::max(on, track.last_tick);
+    off = std::max(off, on + 1);
+    uint8_t velocity = static_cast<uint8_t>(std::clamp(static_cast<int>(std::lround(note.velocity * 127.0f)), 1, 127));
+
+    putVarLen(track.events, on - track.last_tick);
+    track.events.push_back(0x90 | track.midi_channel);
+    track.events.push_back(static_cast<uint8_t>(note.midi_note));
+    track.events.push_back(velocity);
+    putVarLen(track.events, off - on);
+    track.events.push_back(0x80 | track.midi_channel);
+    track.events.push_back(static_cast<uint8_t>(note.midi_note));
+    track.events.push_back(0x40);
+    track.last_tick = off;
+}
+
+bool MidiFileWriter::close() {
+    if (!file_) return false;
+
+    std::vector<uint8_t> header = {
+        0x00, 0x01,  // format 1
+        static_cast<uint8_t>((tracks_.size() + 1) >> 8), static_cast<uint8_t>(tracks_.size() + 1),
+        static_cast<uint8_t>(TICKS_PER_QUARTER >> 8), static_cast<uint8_t>(TICKS_PER_QUARTER & 0xFF)
+    };
+    bool ok = writeChunk(file_, "MThd", header);
+
+    std::vector<uint8_t> tempo;
+    if (!title_.empty()) {
+        putVarLen(tempo, 0);
+        putMeta(tempo, 0x03, title_);
+    }
+    putVarLen(tempo, 0);
+    tempo.insert(tempo.end(), {0xFF, 0x51, 0x03, static_cast<uint8_t>(TEMPO_USEC >> 16),
+                               static_cast<uint8_t>(TEMPO_USEC >> 8), static_cast<uint8_t>(TEMPO_USEC)});
+    tempo.insert(tempo.end(), {0x00, 0xFF, 0x2F, 0x00});
+    ok = ok && writeChunk(file_, "MTrk", tempo);
+
+    for (Track& track : tracks_) {
+        track.events.insert(track.events.end(), {0x00, 0xFF, 0x2F, 0x00});
+        ok = ok && writeChunk(file_, "MTrk", track.events);
+    }
+
+    ok = fclose(file_) == 0 && ok;
+    file_ = nullptr;
+    tracks_.clear();
+    return ok;
+}
+
+void MidiFileWriter::putVarLen(std::vector<uint8_t>& out, uint32_t value) {
+    uint8_t bytes[5];
+    int count = 0;
+    do {
+        bytes[count++] = value & 0x7F;
+        value >>= 7;
+    } while (value && count < 5);
+    while (count > 1) out.push_back(bytes[--count] | 0x80);
+    out.push_back(bytes[0]);
+}
+
+void MidiFileWriter::putMeta(std::vector<uint8_t>& out, uint8_t type, const std::string& text) {
+    out.push_back(0xFF);
+    out.push_back(type);
+    putVarLen(out, static_cast<uint32_t>(text.size()));
+    out.insert(out.end(), text.begin(), text.end());
+}
+
+bool MidiFileWriter::writeChunk(FILE* file, const char* id, const std::vector<uint8_t>& data) {
+    uint32_t size = static_cast<uint32_t>(data.size());
+    uint8_t header[8] = {
+        static_cast<uint8_t>(id[0]), static_cast<uint8_t>(id[1]), static_cast<uint8_t>(id[2]), static_cast<uint8_t>(id[3]),
+        static_cast<uint8_t>(size >> 24), static_cast<uint8_t>(size >> 16), static_cast<uint8_t>(size >> 8),
+        static_cast<uint8_t>(size)
+    };
+    return fwrite(header, 1, sizeof(header), file) == sizeof(header) &&
+           (data.empty() || fwrite(data.data(), 1, data.size(), file) == data.size());
+}
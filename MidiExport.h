@@ -0,0 +1,42 @@
+#pragma once
+
+#include "PianoVisualizer.h"
+#include "ChannelLayout.h"
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// Standard MIDI File (format 1) written from the preprocessing note stream:
+// a tempo track, then one track per layout channel. Notes are encoded as they
+// arrive, which works because each channel reports its notes in time order
+// without overlaps (see PianoVisualizer::setNoteSink). Only the encoded event
+// bytes are held until close() concatenates the track chunks.
+class MidiFileWriter {
+public:
+    ~MidiFileWriter();
+
+    bool open(const std::string& path, const ChannelLayout& layout, const char* title);
+    void addNote(const PianoRollNote& note);
+    bool close();
+
+    // 120 BPM at 480 ticks per quarter note
+    static constexpr int TICKS_PER_QUARTER = 480;
+    static constexpr uint32_t TEMPO_USEC = 500000;
+    static constexpr double TICKS_PER_SECOND = TICKS_PER_QUARTER * 1000000.0 / TEMPO_USEC;
+
+private:
+    struct Track {
+        std::vector<uint8_t> events;
+        uint32_t last_tick = 0;
+        uint8_t midi_channel = 0;
+    };
+
+    static void putVarLen(std::vector<uint8_t>& out, uint32_t value);
+    static void putMeta(std::vector<uint8_t>& out, uint8_t type, const std::string& text);
+    static bool writeChunk(FILE* file, const char* id, const std::vector<uint8_t>& data);
+
+    FILE* file_ = nullptr;
+    std::string title_;
+    std::vector<Track> tracks_;
+};
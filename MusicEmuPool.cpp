@@ -0,0 +1,57 @@
+#include "MusicEmuPool.h"
+#include "NoteCache.h"
+#include "gme/gme.h"
+
+std::shared_ptr<MusicEmuPool> MusicEmuPool::open(const char* path, long sample_rate) {
+    auto file = std::make_shared<MappedFile>();
+    if (!file->open(path)) return nullptr;
+    return std::make_shared<MusicEmuPool>(std::move(file), sample_rate);
+}
+
+MusicEmuPool::MusicEmuPool(std::shared_ptr<const MappedFile> data, long sample_rate)
+    : data_(std::move(data)), sample_rate_(sample_rate) {}
+
+MusicEmuPool::~MusicEmuPool() {
+    for (Music_Emu* emu : idle_) {
+        gme_delete(emu);
+    }
+}
+
+uint64_t MusicEmuPool::contentHash() const {
+    std::call_once(hash_once_, [this] { content_hash_ = NoteCache::hashData(data_->data(), data_->size()); });
+    return content_hash_;
+}
+
+MusicEmuPool::Lease MusicEmuPool::acquire() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!idle_.empty()) {
+            Music_Emu* emu = idle_.back();
+            idle_.pop_back();
+            return Lease(emu, Release{this});
+        }
+    }
+
+    // Opened outside the lock; parsing a large file shouldn't hold up the other jobs
+    Music_Emu* emu = nullptr;
+    if (gme_open_data(data_->data(), static_cast<long>(data_->size()), &emu, sample_rate_) || !emu) {
+        return Lease(nullptr, Release{this});
+    }
+    gme_set_fast_synth(emu, 1);  // jobs read chip state and peaks, not the audio itself
+    return Lease(emu, Release{this});
+}
+
+void MusicEmuPool::release(Music_Emu* emu) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (idle_.size() < MAX_IDLE) {
+            idle_.push_back(emu);
+            return;
+        }
+    }
+    gme_delete(emu);
+}
+
+void MusicEmuPool::Release::operator()(Music_Emu* emu) const {
+    if (emu) pool->release(emu);
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "MappedFile.h"
+
+struct Music_Emu;
+
+// One loaded music file kept in memory for the background jobs that replay
+// it: the mapped bytes, their NoteCache content hash and the emulators
+// already opened from them. A track change hands a job an idle emulator to
+// gme_start_track instead of mapping, hashing and parsing the file again.
+// acquire() may be called from any thread; the pool must outlive its leases.
+class MusicEmuPool {
+public:
+    struct Release {
+        MusicEmuPool* pool = nullptr;
+        void operator()(Music_Emu* emu) const;
+    };
+    using Lease = std::unique_ptr<Music_Emu, Release>;
+
+    // Map path; nullptr if it can't be opened
+    static std::shared_ptr<MusicEmuPool> open(const char* path, long sample_rate);
+
+    MusicEmuPool(std::shared_ptr<const MappedFile> data, long sample_rate);
+    ~MusicEmuPool();
+
+    MusicEmuPool(const MusicEmuPool&) = delete;
+    MusicEmuPool& operator=(const MusicEmuPool&) = delete;
+
+    const std::shared_ptr<const MappedFile>& data() const { return data_; }
+    // Hashed on first use, by the jobs: reading every page of a large VGM
+    // up front would hold up the track's start
+    uint64_t contentHash() const;
+    long sampleRate() const { return sample_rate_; }
+
+    // An idle emulator with fast synthesis on, or a new one opened from
+    // data(); empty if the file doesn't load. Start a track before playing it.
+    Lease acquire();
+
+private:
+    static constexpr size_t MAX_IDLE = 4;   // the piano, waveform and a couple of album jobs
+
+    void release(Music_Emu* emu);
+
+    std::shared_ptr<const MappedFile> data_;
+    mutable std::once_flag hash_once_;
+    mutable uint64_t content_hash_ = 0;
+    long sample_rate_ = 0;
+
+    std::mutex mutex_;
+    std::vector<Music_Emu*> idle_;
+};
@@ -0,0 +1,229 @@
+#include "NesBatch.h"
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+
+NesBatch::~NesBatch() {
+    destroy();
+}
+
+void NesBatch::destroy() {
+    for (auto& session : sessions_) {
+        agnes_destroy(session->agnes);
+    }
+    sessions_.clear();
+    inputs_[0].clear();
+    inputs_[1].clear();
+}
+
+bool NesBatch::loadROM(const char* path) {
+    auto file = std::make_unique<MappedFile>();
+    if (!file->open(path) || !loadROMData(file->data(), file->size())) {
+        return false;
+    }
+    rom_file_ = std::move(file);
+    return true;
+}
+
+bool NesBatch::loadROMData(const void* data, size_t size) {
+    destroy();
+    rom_data_ = nullptr;
+    rom_size_ = 0;
+
+    // Load once into a scratch instance: validates the image and gives the
+    // power-on state every session is reset to
+    agnes_t* probe = agnes_make();
+    if (!probe) return false;
+    bool ok = agnes_load_ines_data(probe, const_cast<void*>(data), size);
+    if (ok) {
+        power_on_state_.resize(agnes_state_size());
+        agnes_dump_state(probe, reinterpret_cast<agnes_state_t*>(power_on_state_.data()));
+    }
+    agnes_destroy(probe);
+    if (!ok) return false;
+
+    const uint8_t* header = static_cast<const uint8_t*>(data);
+    uint8_t mapper = ((header[6] & 0xF0) >> 4) | (header[7] & 0xF0);
+    has_vrc6_ = mapper == 24 || mapper == 26;
+    rom_data_ = data;
+    rom_size_ = size;
+    return true;
+}
+
+bool NesBatch::create(int count, uint8_t capture, long sample_rate) {
+    destroy();
+    if (!rom_data_ || count <= 0) return false;
+    capture_ = capture;
+    sample_rate_ = sample_rate;
+
+    sessions_.reserve(count);
+    for (int i = 0; i < count; ++i) {
+        auto session = std::make_unique<Session>();
+        session->agnes = agnes_make();
+        if (!session->agnes || !agnes_load_ines_data(session->agnes, const_cast<void*>(rom_data_), rom_size_)) {
+            agnes_destroy(session->agnes);
+            destroy();
+            return false;
+        }
+        agnes_set_apu_handler(session->agnes, apuWrite, apuRead, session.get());
+        session->read_pages = agnes_get_cpu_read_pages(session->agnes);
+
+        // The APU always runs, so $4015 reads match NesEmulator; without an
+        // output it only advances its timers
+        session->apu.dmc_reader(apuDmcRead, session.get());
+        if (capture_ & CAPTURE_AUDIO) {
+            if (session->buffer.set_sample_rate(sample_rate_, 100) != nullptr) {
+                agnes_destroy(session->agnes);
+                destroy();
+                return false;
+            }
+            session->buffer.clock_rate(static_cast<long>(CPU_CLOCK_NTSC));
+            session->apu.output(&session->buffer);
+            session->vrc6.output(&session->buffer);
+        }
+        resetApu(*session);
+        sessions_.push_back(std::move(session));
+    }
+    inputs_[0].assign(count, agnes_input_t{});
+    inputs_[1].assign(count, agnes_input_t{});
+    return true;
+}
+
+void NesBatch::resetApu(Session& session) {
+    session.apu.reset(false);  // NTSC
+    session.vrc6.reset();
+    session.buffer.clear();
+    session.last_apu_cycle = agnes_get_cpu_cycles(session.agnes);
+}
+
+void NesBatch::reset(int session) {
+    Session& s = *sessions_[session];
+    agnes_restore_state(s.agnes, reinterpret_cast<const agnes_state_t*>(power_on_state_.data()));
+    // The saved state carries the scratch instance's handler
+    agnes_set_apu_handler(s.agnes, apuWrite, apuRead, &s);
+    resetApu(s);
+}
+
+void NesBatch::resetAll() {
+    for (int i = 0; i < size(); ++i) reset(i);
+}
+
+bool NesBatch::restore(int session, const InputMovie::StartState& start) {
+    Session& s = *sessions_[session];
+    if (start.agnes.size() != agnes_compact_state_size(s.agnes) || start.apu.size() != sizeof(apu_state_t) ||
+        (!start.vrc6.empty() && start.vrc6.size() != sizeof(vrc6_apu_state_t))) {
+        return false;
+    }
+    agnes_restore_compact_state(s.agnes, start.agnes.data());
+    resetApu(s);
+
+    apu_state_t apu;
+    memcpy(&apu, start.apu.data(), sizeof(apu));
+    s.apu.load_state(apu);
+    if (!start.vrc6.empty()) {
+        vrc6_apu_state_t vrc6;
+        memcpy(&vrc6, start.vrc6.data(), sizeof(vrc6));
+        s.vrc6.load_state(vrc6);
+    }
+    return true;
+}
+
+void NesBatch::step(JobSystem& jobs, int frames) {
+    int count = size();
+    if (count == 0 || frames <= 0) return;
+
+    // One claimer per worker (the caller is one too); sessions are handed out
+    // one at a time, so a slow one never holds up a whole block of others
+    std::atomic<int> next{0};
+    auto claim = [this, &next, count, frames]() {
+        for (int i = next.fetch_add(1); i < count; i = next.fetch_add(1)) {
+            runSession(*sessions_[i], i, frames);
+        }
+    };
+    int helpers = std::min(jobs.workerCount(), count - 1);
+    std::vector<JobHandle> handles;
+    handles.reserve(helpers);
+    for (int h = 0; h < helpers; ++h) {
+        handles.push_back(jobs.submit([&claim](const Job&) { claim(); }));
+    }
+    claim();
+    for (auto& handle : handles) {
+        jobs.wait(handle);  // one that never started is run here, finding nothing left
+    }
+}
+
+void NesBatch::runSession(Session& session, int index, int frames) {
+    if (capture_ & CAPTURE_VIDEO) session.frames.resize(static_cast<size_t>(frames) * SCREEN_SIZE);
+    session.audio.clear();
+    session.apu_frames.clear();
+    if (capture_ & CAPTURE_APU) session.apu_frames.reserve(frames);
+
+    for (int f = 0; f < frames; ++f) {
+        agnes_set_input(session.agnes, &inputs_[0][index], &inputs_[1][index]);
+        agnes_next_frame(session.agnes);
+        endApuFrame(session);
+        if (capture_ & CAPTURE_VIDEO) {
+            memcpy(session.frames.data() + f * SCREEN_SIZE, agnes_get_screen_buffer(session.agnes), SCREEN_SIZE);
+        }
+    }
+}
+
+void NesBatch::endApuFrame(Session& session) {
+    uint64_t cycle = agnes_get_cpu_cycles(session.agnes);
+    nes_time_t length = static_cast<nes_time_t>(cycle - session.last_apu_cycle);
+    session.apu.end_frame(length);
+    if (has_vrc6_) session.vrc6.end_frame(length);
+    session.last_apu_cycle = cycle;
+
+    if (capture_ & CAPTURE_APU) {
+        session.apu_frames.push_back(ApuFrameSnapshot::capture(session.apu, has_vrc6_ ? &session.vrc6 : nullptr,
+                                                               nullptr, nullptr, cycle / CPU_CLOCK_NTSC));
+    }
+    if (!(capture_ & CAPTURE_AUDIO)) return;
+    session.buffer.end_frame(length);
+    size_t offset = session.audio.size();
+    session.audio.resize(offset + session.buffer.samples_avail());
+    long count = session.buffer.read_samples(session.audio.data() + offset, session.buffer.samples_avail());
+    session.audio.resize(offset + count);
+}
+
+const uint8_t* NesBatch::screen(int session) const {
+    return agnes_get_screen_buffer(sessions_[session]->agnes);
+}
+
+const uint8_t* NesBatch::ram(int session) const {
+    return agnes_get_ram(sessions_[session]->agnes);
+}
+
+uint64_t NesBatch::cpuCycles(int session) const {
+    return agnes_get_cpu_cycles(sessions_[session]->agnes);
+}
+
+// Same register routing as NesEmulator::apuWriteCallback
+void NesBatch::apuWrite(void* user_data, uint16_t addr, uint8_t val, uint64_t cpu_cycle) {
+    NesBatch::Session* session = static_cast<NesBatch::Session*>(user_data);
+    nes_time_t time = static_cast<nes_time_t>(cpu_cycle - session->last_apu_cycle);
+
+    // VRC6 pulse 1/2 and saw: $9000-$9002, $A000-$A002, $B000-$B002. Only
+    // mapper 24/26 carts forward these addresses.
+    if (addr >= 0x9000 && addr <= 0xB002 && (addr & 0x0FFF) <= 2) {
+        session->vrc6.write_osc(time, (addr >> 12) - 9, addr & 0x3, val);
+        return;
+    }
+    session->apu.write_register(time, addr, val);
+}
+
+uint8_t NesBatch::apuRead(void* user_data, uint16_t addr, uint64_t cpu_cycle) {
+    NesBatch::Session* session = static_cast<NesBatch::Session*>(user_data);
+    if (addr == 0x4015) {
+        return session->apu.read_status(static_cast<nes_time_t>(cpu_cycle - session->last_apu_cycle));
+    }
+    return 0;
+}
+
+int NesBatch::apuDmcRead(void* user_data, unsigned addr) {
+    NesBatch::Session* session = static_cast<NesBatch::Session*>(user_data);
+    // DMC samples live in $8000-$FFFF, which is always in the page table
+    const uint8_t* page = session->read_pages[(addr >> 8) & 0xff];
+    return page ? page[addr & 0xff] : 0;
+}
@@ -0,0 +1,112 @@
+#pragma once
+
+#include "agnes/agnes.h"
+#include "gme/Nes_Apu.h"
+#include "gme/Nes_Vrc6_Apu.h"
+#include "gme/Blip_Buffer.h"
+#include "ApuSnapshot.h"
+#include "JobSystem.h"
+#include "MappedFile.h"
+#include "InputMovie.h"
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// Many independent headless sessions of one ROM, stepped together for
+// automated testing and training runs. Unlike NesEmulator there is no
+// mutex, thread, texture or audio queue per session: a session is an agnes
+// instance plus its APU, and the ROM image is loaded once and only read by
+// all of them (agnes keeps a pointer to it). step() emulates every session
+// for the same number of frames with its own input, spread across the job
+// workers and the calling thread; each takes the next unstarted session
+// from a shared counter, so sessions that cost more balance out.
+class NesBatch {
+public:
+    // Capture flags: every frame's palette indices, mono audio and/or
+    // channel state of the last step(), per session
+    enum Capture : uint8_t {
+        CAPTURE_NONE  = 0,
+        CAPTURE_VIDEO = 1 << 0,
+        CAPTURE_AUDIO = 1 << 1,
+        CAPTURE_APU   = 1 << 2,
+    };
+
+    static constexpr size_t SCREEN_SIZE = AGNES_SCREEN_WIDTH * AGNES_SCREEN_HEIGHT;
+
+    NesBatch() = default;
+    ~NesBatch();
+    NesBatch(const NesBatch&) = delete;
+    NesBatch& operator=(const NesBatch&) = delete;
+
+    // The ROM every session runs. loadROMData doesn't copy: the data must
+    // outlive the batch. Drops any existing sessions.
+    bool loadROM(const char* path);
+    bool loadROMData(const void* data, size_t size);
+
+    // Replace the sessions with 'count' at power-on
+    bool create(int count, uint8_t capture = CAPTURE_NONE, long sample_rate = 44100);
+    int size() const { return static_cast<int>(sessions_.size()); }
+
+    // Controller state per session, read at the start of every frame:
+    // input(player)[session]
+    agnes_input_t* input(int player) { return inputs_[player & 1].data(); }
+
+    // Emulate 'frames' frames of every session; returns when all are done
+    void step(JobSystem& jobs, int frames = 1);
+
+    // Back to power-on
+    void reset(int session);
+    void resetAll();
+    // Start from a movie's recorded state (agnes and APU); false if it was
+    // recorded by another build
+    bool restore(int session, const InputMovie::StartState& start);
+
+    // Palette indices of the session's current picture
+    const uint8_t* screen(int session) const;
+    // The session's 2 KB of CPU RAM ($0000-$07FF), AGNES_RAM_SIZE bytes
+    const uint8_t* ram(int session) const;
+    // CAPTURE_VIDEO: SCREEN_SIZE bytes per frame of the last step()
+    const std::vector<uint8_t>& frames(int session) const { return sessions_[session]->frames; }
+    // CAPTURE_AUDIO: mono samples of the last step()
+    const std::vector<short>& audio(int session) const { return sessions_[session]->audio; }
+    // CAPTURE_APU: the APU (and VRC6) state at the end of each frame of the
+    // last step(), timed by the session's CPU clock like NesEmulator's
+    const std::vector<ApuFrameSnapshot>& apuFrames(int session) const { return sessions_[session]->apu_frames; }
+    uint64_t cpuCycles(int session) const;
+
+private:
+    struct Session {
+        agnes_t* agnes = nullptr;
+        const uint8_t* const* read_pages = nullptr;  // agnes' page table (DMC fetches)
+        Nes_Apu apu;
+        Nes_Vrc6_Apu vrc6;
+        Blip_Buffer buffer;        // only attached with CAPTURE_AUDIO
+        uint64_t last_apu_cycle = 0;
+        std::vector<uint8_t> frames;
+        std::vector<short> audio;
+        std::vector<ApuFrameSnapshot> apu_frames;
+    };
+
+    void destroy();
+    void resetApu(Session& session);
+    void runSession(Session& session, int index, int frames);
+    void endApuFrame(Session& session);
+
+    static void apuWrite(void* user_data, uint16_t addr, uint8_t val, uint64_t cpu_cycle);
+    static uint8_t apuRead(void* user_data, uint16_t addr, uint64_t cpu_cycle);
+    static int apuDmcRead(void* user_data, unsigned addr);
+
+    std::unique_ptr<MappedFile> rom_file_;  // backing store of a ROM opened by loadROM
+    const void* rom_data_ = nullptr;
+    size_t rom_size_ = 0;
+    bool has_vrc6_ = false;
+    uint8_t capture_ = CAPTURE_NONE;
+    long sample_rate_ = 44100;
+
+    std::vector<std::unique_ptr<Session>> sessions_;  // stable addresses for the APU callbacks
+    std::vector<agnes_input_t> inputs_[2];
+    std::vector<uint8_t> power_on_state_;  // agnes state right after load, shared by reset()
+
+    static constexpr double CPU_CLOCK_NTSC = 1789773.0;
+};
@@ -0,0 +1,184 @@
+#include "NesDebugger.h"
+#include <algorithm>
+#include <cstdio>
+
+#ifndef NES_HEADLESS
+#include "imgui.h"
+
+namespace {
+
+const char* describeStop(const NesEmulator::DebugState& state, char* buf, size_t size) {
+    switch (state.reason) {
+        case AGNES_DEBUG_EXEC:
+            snprintf(buf, size, "Breakpoint at $%04X", state.address);
+            break;
+        case AGNES_DEBUG_READ:
+            snprintf(buf, size, "Read $%02X from $%04X", state.value, state.address);
+            break;
+        case AGNES_DEBUG_WRITE:
+            snprintf(buf, size, "Wrote $%02X to $%04X", state.value, state.address);
+            break;
+        case AGNES_DEBUG_SCANLINE:
+            snprintf(buf, size, "Scanline %d", state.value);
+            break;
+        case AGNES_DEBUG_STEP:
+            snprintf(buf, size, "Stepped to $%04X", state.address);
+            break;
+        default:
+            snprintf(buf, size, "End of frame");
+            break;
+    }
+    return buf;
+}
+
+} // namespace
+
+void NesDebugger::apply(NesEmulator& emu) {
+    emu.setBreakpoints(breakpoints_);
+}
+
+void NesDebugger::toggleExec(NesEmulator& emu, uint16_t address) {
+    auto it = std::find_if(breakpoints_.begin(), breakpoints_.end(),
+                           [address](const NesEmulator::Breakpoint& bp) { return bp.address == address; });
+    if (it == breakpoints_.end()) {
+        breakpoints_.push_back({address, AGNES_BREAK_EXEC});
+    } else if ((it->flags ^= AGNES_BREAK_EXEC) == 0) {
+        breakpoints_.erase(it);
+    }
+    apply(emu);
+}
+
+void NesDebugger::drawWindow(NesEmulator& emu, bool* p_open) {
+    ImGui::SetNextWindowSize(ImVec2(460, 600), ImGuiCond_FirstUseEver);
+    if (!ImGui::Begin("6502 Debugger", p_open)) {
+        ImGui::End();
+        return;
+    }
+    NesEmulator::DebugState state;
+    if (!emu.readDebugState(state)) {
+        ImGui::TextDisabled("No ROM loaded");
+        ImGui::End();
+        return;
+    }
+
+    // Run control
+    if (state.broken) {
+        if (ImGui::Button("Continue")) emu.debugContinue();
+        ImGui::SameLine();
+        if (ImGui::Button("Step")) emu.debugStep(1);
+        ImGui::SameLine();
+        if (ImGui::Button("Step Scanline")) {
+            scanline_ = (state.regs.scanline + 1) % 262;
+            emu.setScanlineBreak(scanline_);
+            emu.debugContinue();
+        }
+        ImGui::SameLine();
+        if (ImGui::Button("Step Frame")) emu.debugStepFrame();
+        char stop[64];
+        ImGui::TextColored(ImVec4(1.0f, 0.8f, 0.3f, 1.0f), "Stopped: %s",
+                           describeStop(state, stop, sizeof(stop)));
+    } else {
+        if (ImGui::Button("Break")) emu.debugBreak();
+        ImGui::SameLine();
+        ImGui::TextDisabled("Running");
+    }
+
+    // Registers
+    const agnes_cpu_regs_t& r = state.regs;
+    char flags[9];
+    const char* names = "NV-BDIZC";
+    for (int i = 0; i < 8; ++i) {
+        flags[i] = (r.p & (0x80 >> i)) ? names[i] : '.';
+    }
+    flags[8] = 0;
+    ImGui::SeparatorText("Registers");
+    ImGui::Text("PC $%04X  A $%02X  X $%02X  Y $%02X  SP $%02X  P %s", r.pc, r.a, r.x, r.y, r.sp, flags);
+    ImGui::Text("Scanline %3d  Dot %3d  Cycle %llu%s", r.scanline, r.dot, static_cast<unsigned long long>(r.cycles),
+                r.interrupt ? "  (interrupt pending)" : "");
+
+    // Disassembly from the PC, only refreshed while stopped
+    ImGui::SeparatorText("Disassembly");
+    if (state.broken || disasm_.empty()) {
+        emu.disassemble(r.pc, DISASM_LINES, disasm_);
+    }
+    float list_height = ImGui::GetTextLineHeightWithSpacing() * 12;
+    if (ImGui::BeginChild("disasm", ImVec2(0, list_height), ImGuiChildFlags_Borders)) {
+        for (const NesEmulator::DisasmLine& line : disasm_) {
+            bool exec = std::any_of(breakpoints_.begin(), breakpoints_.end(), [&line](const NesEmulator::Breakpoint& bp) {
+                return bp.address == line.address && (bp.flags & AGNES_BREAK_EXEC);
+            });
+            bool current = state.broken && line.address == r.pc;
+            char label[48];
+            snprintf(label, sizeof(label), "%c $%04X  %s##%04X", exec ? '*' : ' ', line.address, line.text, line.address);
+            if (current) ImGui::PushStyleColor(ImGuiCol_Text, ImVec4(1.0f, 0.8f, 0.3f, 1.0f));
+            if (ImGui::Selectable(label, current)) toggleExec(emu, line.address);
+            if (current) ImGui::PopStyleColor();
+        }
+    }
+    ImGui::EndChild();
+    if (ImGui::IsItemHovered(ImGuiHoveredFlags_DelayNormal)) {
+        ImGui::SetTooltip("Click a line to set or clear an execution breakpoint (*)");
+    }
+
+    // Breakpoints
+    ImGui::SeparatorText("Breakpoints");
+    ImGui::SetNextItemWidth(70);
+    ImGui::InputScalar("##address", ImGuiDataType_U16, &new_address_, nullptr, nullptr, "%04X",
+                       ImGuiInputTextFlags_CharsHexadecimal);
+    ImGui::SameLine();
+    ImGui::Checkbox("Exec", &new_exec_);
+    ImGui::SameLine();
+    ImGui::Checkbox("Read", &new_read_);
+    ImGui::SameLine();
+    ImGui::Checkbox("Write", &new_write_);
+    ImGui::SameLine();
+    uint8_t new_flags = (new_exec_ ? AGNES_BREAK_EXEC : 0) | (new_read_ ? AGNES_BREAK_READ : 0) |
+                        (new_write_ ? AGNES_BREAK_WRITE : 0);
+    ImGui::BeginDisabled(new_flags == 0);
+    if (ImGui::Button("Add")) {
+        auto it = std::find_if(breakpoints_.begin(), breakpoints_.end(),
+                               [this](const NesEmulator::Breakpoint& bp) { return bp.address == new_address_; });
+        if (it == breakpoints_.end()) {
+            breakpoints_.push_back({new_address_, new_flags});
+        } else {
+            it->flags |= new_flags;
+        }
+        apply(emu);
+    }
+    ImGui::EndDisabled();
+
+    int remove = -1;
+    for (int i = 0; i < static_cast<int>(breakpoints_.size()); ++i) {
+        const NesEmulator::Breakpoint& bp = breakpoints_[i];
+        ImGui::PushID(i);
+        ImGui::Text("$%04X  %s%s%s", bp.address, (bp.flags & AGNES_BREAK_EXEC) ? "exec " : "",
+                    (bp.flags & AGNES_BREAK_READ) ? "read " : "", (bp.flags & AGNES_BREAK_WRITE) ? "write" : "");
+        ImGui::SameLine();
+        if (ImGui::SmallButton("Remove")) remove = i;
+        ImGui::PopID();
+    }
+    if (remove >= 0) {
+        breakpoints_.erase(breakpoints_.begin() + remove);
+        apply(emu);
+    }
+
+    bool on_scanline = scanline_ >= 0;
+    if (ImGui::Checkbox("Break on scanline", &on_scanline)) {
+        scanline_ = on_scanline ? std::max(r.scanline, 0) : -1;
+        emu.setScanlineBreak(scanline_);
+    }
+    if (on_scanline) {
+        ImGui::SameLine();
+        ImGui::SetNextItemWidth(90);
+        if (ImGui::InputInt("##scanline", &scanline_)) {
+            scanline_ = std::clamp(scanline_, 0, 261);
+            emu.setScanlineBreak(scanline_);
+        }
+    }
+    if (ImGui::IsItemHovered(ImGuiHoveredFlags_DelayNormal)) {
+        ImGui::SetTooltip("0-239 visible, 241 vblank, 261 pre-render");
+    }
+    ImGui::End();
+}
+
+#endif
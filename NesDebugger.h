@@ -0,0 +1,34 @@
+#pragma once
+
+#include "NesEmulator.h"
+#include <cstdint>
+#include <vector>
+
+// 6502 debugger window for the NES emulator: execution, read and write
+// breakpoints, a scanline breakpoint, instruction and frame stepping, the
+// registers and a disassembly from the PC. The emulator only runs its
+// instrumented frame loop while the window is open (main.cpp attaches it);
+// closed, frames go through the plain loop with no debugger checks at all.
+class NesDebugger {
+public:
+#ifndef NES_HEADLESS
+    // Main thread, once per frame while the window is open
+    void drawWindow(NesEmulator& emu, bool* p_open);
+#endif
+
+private:
+    static constexpr int DISASM_LINES = 24;
+
+    void toggleExec(NesEmulator& emu, uint16_t address);
+    void apply(NesEmulator& emu);
+
+    std::vector<NesEmulator::Breakpoint> breakpoints_;
+    std::vector<NesEmulator::DisasmLine> disasm_;
+    int scanline_ = -1;
+
+    // New breakpoint being entered
+    uint16_t new_address_ = 0x8000;
+    bool new_exec_ = true;
+    bool new_read_ = false;
+    bool new_write_ = false;
+};
@@ -1,9 +1,25 @@
 #include "NesEmulator.h"
+#include "Profiler.h"
+#include "ThreadPlacement.h"
+#ifndef NES_HEADLESS
+#include "GpuMemory.h"
 #include "sokol_app.h"
 #include "util/sokol_imgui.h"
+#endif
 #include <cstring>
 #include <fstream>
 #include <cmath>
+#include <chrono>
+#include <algorithm>
+#include <bit>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define NES_USE_AVX2 1
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#include <arm_neon.h>
+#define NES_USE_NEON 1
+#endif
 
 // NES color palette (NTSC - from Nestopia)
 const uint32_t NesEmulator::nes_palette_[64] = {
@@ -19,13 +35,20 @@ const uint32_t NesEmulator::nes_palette_[64] = {
 
 NesEmulator::NesEmulator() {
     memset(screen_pixels_, 0, sizeof(screen_pixels_));
-    memset(input_, 0, sizeof(input_));
+    buildPaletteLut(nes_palette_);
 }
 
 NesEmulator::~NesEmulator() {
+    stopThread();
+    if (ahead_) {
+        agnes_destroy(ahead_);
+        ahead_ = nullptr;
+        Profiler::trackMemory(MemoryTag::Emulation, -static_cast<int64_t>(agnes_state_size()), 0);
+    }
     if (agnes_) {
         agnes_destroy(agnes_);
         agnes_ = nullptr;
+        Profiler::trackMemory(MemoryTag::Emulation, -static_cast<int64_t>(agnes_state_size()), 0);
     }
     // destroyScreenTexture();
 }
@@ -33,32 +56,37 @@ NesEmulator::~NesEmulator() {
 bool NesEmulator::init(long audio_sample_rate) {
     sample_rate_ = audio_sample_rate;
     
-    // Create agnes instance
+    // Create agnes instance; its C allocation is charged by hand, at about
+    // the size of its state
+    MemoryScope memory(MemoryTag::Emulation);
     agnes_ = agnes_make();
     if (!agnes_) {
         return false;
     }
+    Profiler::trackMemory(MemoryTag::Emulation, agnes_state_size());
     
     // Set up APU handlers
     agnes_set_apu_handler(agnes_, apuWriteCallback, apuReadCallback, this);
+    agnes_set_input_poll_handler(agnes_, inputPollCallback, this);
+    cpu_read_pages_ = agnes_get_cpu_read_pages(agnes_);
     
     // Initialize APU
     initApu();
     
-    // Create screen texture
-    createScreenTexture();
-    
+    // The screen texture and its shaders wait for the first frame (see presentFrame)
     return true;
 }
 
 void NesEmulator::initApu() {
     // Set up Blip_Buffer
-    // At 44100Hz, each frame generates ~735 samples
+    // At 44100Hz, each frame generates ~735 samples (800 at 48000Hz)
     // Use 200ms buffer (~12 frames worth) for smooth audio with low latency
     apu_buffer_.set_sample_rate(sample_rate_, 200);
     apu_buffer_.clock_rate(static_cast<long>(CPU_CLOCK_NTSC));
     
     // Set up APU
+    audio_ring_.init(AUDIO_RING_SAMPLES, 1);
+    
     apu_.output(&apu_buffer_);
     apu_.dmc_reader(apuDmcReadCallback, this);
     apu_.reset(false);  // NTSC mode
@@ -67,26 +95,83 @@ void NesEmulator::initApu() {
     vrc6_apu_.output(&apu_buffer_);
     vrc6_apu_.reset();
     has_vrc6_ = false;
+    applied_mute_ = 0;
     
     last_apu_cycle_ = 0;
 }
 
+void NesEmulator::setAudioFormat(long sample_rate, int latency_msec) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (apu_buffer_.set_sample_rate(sample_rate, latency_msec) != nullptr) {
+        return;  // out of memory: the old buffer is left as it was
+    }
+    sample_rate_ = sample_rate;
+    apu_buffer_.clock_rate(static_cast<long>(CPU_CLOCK_NTSC));
+    flushAudio();
+    queue_fill_avg_ = 0.0;
+}
+
 bool NesEmulator::loadROM(const char* path) {
-    std::ifstream file(path, std::ios::binary | std::ios::ate);
-    if (!file.is_open()) {
-        return false;
+    MemoryScope memory(MemoryTag::Emulation);
+    RomCache::Entry next;
+    bool resuming = suspended_.take(path, next);
+    if (!resuming) {
+        next.rom = std::make_unique<MappedFile>();
+        if (!next.rom->open(path)) {
+            return false;
+        }
     }
+    RomCache::Entry left = suspendCurrent();
     
-    size_t size = file.tellg();
-    file.seekg(0, std::ios::beg);
-    
-    rom_data_.resize(size);
-    if (!file.read(reinterpret_cast<char*>(rom_data_.data()), size)) {
+    // agnes reads PRG/CHR straight from the mapped pages, so the new mapping
+    // replaces the old one only once agnes no longer refers to it
+    if (!loadROMData(next.rom->data(), next.rom->size())) {
+        if (resuming) suspended_.put(std::move(next));
         return false;
     }
-    
+    if (!left.path.empty()) {
+        left.rom = std::move(rom_file_);
+        suspended_.put(std::move(left));
+    }
+    rom_file_ = std::move(next.rom);
     rom_path_ = path;
-    return loadROMData(rom_data_.data(), rom_data_.size());
+    if (resuming) resumeSuspended(next);
+    return true;
+}
+
+// The running ROM's state and picture, to resume it from later; empty (no
+// path) when it wasn't opened from a file or netplay owns its state. The
+// caller moves the ROM image in once agnes has let go of it.
+RomCache::Entry NesEmulator::suspendCurrent() {
+    RomCache::Entry entry;
+    if (!agnes_ || !rom_loaded_ || !rom_file_ || loaded_data_ != rom_file_->data()) return entry;
+    MemoryScope memory(MemoryTag::Savestates);
+    
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (netplay_) return entry;
+    writeState(entry.state);
+    const uint8_t* screen = agnes_get_screen_buffer(agnes_);
+    entry.screen.assign(screen, screen + sizeof(ScreenFrame::indices));
+    entry.path = rom_path_;
+    entry.running = running_;
+    return entry;
+}
+
+// Pick up a suspended ROM just loaded: its state, and its last picture on
+// screen until the next frame replaces it
+void NesEmulator::resumeSuspended(const RomCache::Entry& entry) {
+    if (!loadState(entry.state)) return;   // another build's state: stays powered on
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (entry.screen.size() == sizeof(ScreenFrame::indices)) {
+            memcpy(frames_.back().indices, entry.screen.data(), sizeof(ScreenFrame::indices));
+            frames_.back().seconds = agnes_get_cpu_cycles(agnes_) / CPU_CLOCK_NTSC;
+            frames_.back().traced = false;
+            frames_.publish();
+        }
+        cpu_cycles_.store(agnes_get_cpu_cycles(agnes_), std::memory_order_relaxed);
+    }
+    running_ = entry.running;
 }
 
 bool NesEmulator::loadROMData(const void* data, size_t size) {
@@ -97,15 +182,35 @@ bool NesEmulator::loadROMData(const void* data, size_t size) {
     // Reset APU
     apu_.reset(false);
     vrc6_apu_.reset();
-    apu_buffer_.clear();
+    flushAudio();
     last_apu_cycle_ = 0;
+    cpu_cycles_.store(0);
+    rewind_.clear();
+    rewind_seconds_.store(0.0f);
+    apu_snapshots_.push(ApuFrameSnapshot(), audio_ring_.writePosition());
+    endMovie();
+    netplay_.reset();
+    netplay_active_.store(false);
+    ram_freezes_.clear();
+    debug_frame_open_ = false;
+    debug_broken_.store(false);
     
     // Load ROM into agnes
     if (!agnes_load_ines_data(agnes_, const_cast<void*>(data), size)) {
         rom_loaded_ = false;
         has_vrc6_ = false;
+        loaded_data_ = nullptr;
+        loaded_size_ = 0;
         return false;
     }
+    loaded_data_ = data;
+    loaded_size_ = size;
+    rom_hash_ = InputMovie::hashRom(data, size);
+    power_on_state_.resize(agnes_state_size());
+    agnes_dump_state(agnes_, reinterpret_cast<agnes_state_t*>(power_on_state_.data()));
+    if (ahead_) {
+        agnes_load_ines_data(ahead_, const_cast<void*>(data), size);
+    }
     
     // Check if this ROM uses VRC6 mapper (24 or 26)
     // Parse iNES header to get mapper number
@@ -117,6 +222,14 @@ bool NesEmulator::loadROMData(const void* data, size_t size) {
         has_vrc6_ = false;
     }
     
+    snapshot_size_ = agnes_compact_state_size(agnes_) + sizeof(apu_state_t) +
+                     (has_vrc6_ ? sizeof(vrc6_apu_state_t) : 0);
+    if (rewind_.budget() != 0 && rewind_scratch_.size() != snapshot_size_) {
+        MemoryScope memory(MemoryTag::Savestates);
+        rewind_.init(snapshot_size_, REWIND_BUDGET);
+        rewind_scratch_.resize(snapshot_size_);
+    }
+    
     rom_loaded_ = true;
     running_ = false;
     
@@ -127,53 +240,545 @@ void NesEmulator::reset() {
     if (!agnes_ || !rom_loaded_) return;
     
     std::lock_guard<std::mutex> lock(mutex_);
+    if (netplay_) return;  // would desync the peer
     
-    // Reload the ROM to reset
-    if (!rom_path_.empty()) {
-        std::ifstream file(rom_path_, std::ios::binary | std::ios::ate);
-        if (file.is_open()) {
-            size_t size = file.tellg();
-            file.seekg(0, std::ios::beg);
-            rom_data_.clear();
-            rom_data_.resize(size);
-            file.read(reinterpret_cast<char*>(rom_data_.data()), size);
-            agnes_load_ines_data(agnes_, rom_data_.data(), rom_data_.size());
-        }
-    }
+    // Back to the state captured right after loading; the ROM image is unchanged
+    endMovie();
+    agnes_restore_state(agnes_, reinterpret_cast<const agnes_state_t*>(power_on_state_.data()));
+    cpu_cycles_.store(agnes_get_cpu_cycles(agnes_), std::memory_order_relaxed);
+    debug_frame_open_ = false;
     
     // Reset APU
     apu_.reset(false);
-    apu_buffer_.clear();
+    vrc6_apu_.reset();
+    flushAudio();
     last_apu_cycle_ = 0;
 }
 
-void NesEmulator::runFrame() {
-    if (!agnes_ || !rom_loaded_ || !running_) return;
+bool NesEmulator::runFrame() {
+    return emulateFrame(true);
+}
+
+bool NesEmulator::emulateFrame(bool present) {
+    if (!agnes_ || !rom_loaded_ || !running_ || debug_broken_) return false;
     
     std::lock_guard<std::mutex> lock(mutex_);
+    cpu_profiler_.frame(agnes_, CPU_CLOCK_NTSC / NTSC_FRAME_RATE);
+    applyMuteMask();
+    if (netplay_) {
+        return netplayFrame(present);
+    }
     
-    // Set input
-    agnes_set_input(agnes_, &input_[0], &input_[1]);
+    // Set input (a replaying movie overrides it). Live pads are sampled
+    // again when the game first strobes them, up to a frame later.
+    if (!debug_frame_open_) {
+        uint16_t live = input_.load(std::memory_order_acquire);
+        agnes_input_t pads[2] = { InputMovie::unpack(live, 0), InputMovie::unpack(live, 1) };
+        movieInput(pads);
+        agnes_set_input(agnes_, &pads[0], &pads[1]);
+        frame_input_ = InputMovie::pack(pads[0], pads[1]);
+        late_input_ = late_latching_.load(std::memory_order_relaxed) && movie_mode_.load() != MovieMode::REPLAYING;
+        input_trace_.latched(frame_input_);
+        applyRamFreezes();
+    }
     
     // Run one frame of emulation
-    agnes_next_frame(agnes_);
+    {
+        PROFILE_STAGE(NesFrame);
+        if (!nextFrame()) {
+            // Stopped inside it: show the picture drawn so far
+            late_input_ = false;
+            publishScreen();
+            return true;
+        }
+    }
+    late_input_ = false;
+    recordMovieFrame();
     
     // End APU frame to generate audio samples
     endApuFrame();
     
-    // Update screen texture
-    updateScreenTexture();
+    int ahead = run_ahead_.load();
+    if (!present) {
+        cpu_cycles_.store(agnes_get_cpu_cycles(agnes_), std::memory_order_relaxed);
+    } else if (ahead > 0 && ahead_) {
+        runAheadFrames(ahead);
+    } else {
+        publishScreen();
+    }
+    
+    // Rewind history
+    if (rewind_enabled_.load() && ++rewind_counter_ >= REWIND_INTERVAL) {
+        rewind_counter_ = 0;
+        MemoryScope memory(MemoryTag::Savestates);
+        dumpSnapshot(rewind_scratch_.data());
+        rewind_.push(rewind_scratch_.data());
+        rewind_seconds_.store(rewind_.count() * REWIND_INTERVAL / static_cast<float>(NTSC_FRAME_RATE),
+                              std::memory_order_relaxed);
+    }
+    return true;
+}
+
+// The frame through the debugger's loop while it is attached; false if it
+// stopped before the end. Must hold mutex_.
+bool NesEmulator::nextFrame() {
+    if (!debugger_attached_.load(std::memory_order_relaxed)) {
+        agnes_next_frame(agnes_);
+        return true;
+    }
+    int result = agnes_debug_run(agnes_);
+    bool frame_done = !(result & AGNES_DEBUG_BREAK) || (result & AGNES_DEBUG_FRAME);
+    if (frame_done && debug_frame_step_ && !(result & AGNES_DEBUG_BREAK)) {
+        debugger_->reason = AGNES_DEBUG_NONE;
+    }
+    if ((result & AGNES_DEBUG_BREAK) || (frame_done && debug_frame_step_)) {
+        debug_frame_step_ = false;
+        debug_broken_.store(true);
+    }
+    debug_frame_open_ = !frame_done;
+    return frame_done;
+}
+
+// Hand the finished picture to the renderer. Must hold mutex_.
+void NesEmulator::publishScreen() {
+    publishScreen(agnes_);
+}
+
+void NesEmulator::publishScreen(const agnes_t* source) {
+    memcpy(frames_.back().indices, agnes_get_screen_buffer(source), sizeof(ScreenFrame::indices));
+    frames_.back().seconds = agnes_get_cpu_cycles(source) / CPU_CLOCK_NTSC;
+    frames_.back().traced = input_trace_.published(frames_.back().indices, AGNES_SCREEN_WIDTH * AGNES_SCREEN_HEIGHT);
+    frames_.publish();
+    cpu_cycles_.store(agnes_get_cpu_cycles(agnes_), std::memory_order_relaxed);
+}
+
+void NesEmulator::setRunAhead(int frames) {
+    frames = std::clamp(frames, 0, MAX_RUN_AHEAD);
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (frames > 0 && !ahead_) {
+        ahead_ = agnes_make();
+        if (!ahead_) return;
+        Profiler::trackMemory(MemoryTag::Emulation, agnes_state_size());
+        if (loaded_data_) {
+            agnes_load_ines_data(ahead_, const_cast<void*>(loaded_data_), loaded_size_);
+        }
+    }
+    run_ahead_.store(frames);
+}
+
+// Speculatively run the copy forward and show where the game will be
+// 'frames' frames from now. Must hold mutex_.
+void NesEmulator::runAheadFrames(int frames) {
+    // The compact state leaves the copy's (absent) APU handler alone and
+    // carries this frame's pads (live or from a replaying movie)
+    ahead_state_.resize(agnes_compact_state_size(agnes_));
+    agnes_dump_compact_state(agnes_, ahead_state_.data());
+    agnes_restore_compact_state(ahead_, ahead_state_.data());
+    for (int i = 0; i < frames; ++i) {
+        agnes_next_frame(ahead_);
+    }
+    publishScreen(ahead_);
+}
+
+void NesEmulator::setRewindEnabled(bool enabled) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    MemoryScope memory(MemoryTag::Savestates);
+    if (enabled && rewind_.budget() == 0) {
+        rewind_.init(snapshot_size_, REWIND_BUDGET);
+        rewind_scratch_.resize(snapshot_size_);
+    }
+    if (!enabled) {
+        rewind_.clear();
+        rewind_seconds_.store(0.0f);
+    }
+    rewind_counter_ = 0;
+    rewind_enabled_.store(enabled);
+}
+
+// Step back one snapshot. Called instead of runFrame while rewinding.
+void NesEmulator::rewindFrame() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!rewind_.pop(rewind_scratch_.data())) return;
+    endMovie();
+    
+    restoreSnapshot(rewind_scratch_.data());
+    
+    // Snapshots have no picture: redraw it by emulating the frame after this
+    // one, and drop its audio along with whatever the rewound frames had queued
+    agnes_next_frame(agnes_);
+    endApuFrame();
+    flushAudio();
+    rewind_counter_ = 0;
+    rewind_seconds_.store(rewind_.count() * REWIND_INTERVAL / static_cast<float>(NTSC_FRAME_RATE),
+                          std::memory_order_relaxed);
+    
+    publishScreen();
+}
+
+bool NesEmulator::hostNetplay(uint16_t port) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!rom_loaded_) return false;
+    auto netplay = std::make_unique<Netplay>();
+    bool ok = netplay->host(port, rom_hash_);
+    netplay_status_.store(netplay->status());
+    if (!ok) return false;
+    netplay_ = std::move(netplay);
+    netplay_started_ = false;
+    netplay_active_.store(true);
+    return true;
+}
+
+bool NesEmulator::joinNetplay(const char* address, uint16_t port) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!rom_loaded_) return false;
+    auto netplay = std::make_unique<Netplay>();
+    bool ok = netplay->join(address, port, rom_hash_);
+    netplay_status_.store(netplay->status());
+    if (!ok) return false;
+    netplay_ = std::move(netplay);
+    netplay_started_ = false;
+    netplay_active_.store(true);
+    return true;
+}
+
+void NesEmulator::stopNetplay() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    netplay_.reset();
+    netplay_active_.store(false);
+    netplay_status_.store(Netplay::Status::IDLE);
+}
+
+// One netplay tick: take in the peer's inputs, roll back if a prediction was
+// wrong, then run the next frame. False (nothing run) while connecting or
+// when MAX_ROLLBACK frames ahead of the peer. Must hold mutex_.
+bool NesEmulator::netplayFrame(bool present) {
+    netplay_->poll();
+    Netplay::Status status = netplay_->status();
+    netplay_status_.store(status);
+    netplay_rtt_ms_.store(netplay_->roundTripMs(), std::memory_order_relaxed);
+    if (status == Netplay::Status::WAITING) return false;
+    if (status != Netplay::Status::CONNECTED) {
+        // Peer gone or broken link: play on locally, keeping the status for the UI
+        netplay_.reset();
+        netplay_active_.store(false);
+        return false;
+    }
+    
+    if (!netplay_started_) {
+        // Both sides start from the same power-on state
+        endMovie();
+        agnes_restore_state(agnes_, reinterpret_cast<const agnes_state_t*>(power_on_state_.data()));
+        agnes_set_apu_handler(agnes_, apuWriteCallback, apuReadCallback, this);
+        apu_.reset(false);
+        vrc6_apu_.reset();
+        flushAudio();
+        last_apu_cycle_ = agnes_get_cpu_cycles(agnes_);
+        netplay_states_.resize(NETPLAY_SLOTS * snapshot_size_);
+        netplay_frame_ = 0;
+        netplay_verified_ = 0;
+        netplay_rollback_.store(0, std::memory_order_relaxed);
+        netplay_started_ = true;
+    }
+    
+    uint32_t remote_frames = netplay_->remoteFrames();
+    if (netplay_frame_ >= remote_frames + Netplay::MAX_ROLLBACK) return false;
+    
+    // Frames that now have the real remote pad: from the first one predicted
+    // wrong, restore and run again up to the present, silently
+    uint32_t confirmed = std::min(remote_frames, netplay_frame_);
+    for (uint32_t f = netplay_verified_; f < confirmed; ++f) {
+        if (netplay_->remoteInput(f) == netplay_remote_[f % NETPLAY_SLOTS]) continue;
+        restoreSnapshot(&netplay_states_[(f % NETPLAY_SLOTS) * snapshot_size_], true);
+        for (uint32_t g = f; g < netplay_frame_; ++g) {
+            netplayStep(g, false);
+        }
+        netplay_rollback_.store(static_cast<int>(netplay_frame_ - f), std::memory_order_relaxed);
+        break;
+    }
+    netplay_verified_ = confirmed;
+    
+    uint32_t frame = netplay_frame_++;
+    netplay_local_[frame % NETPLAY_SLOTS] = static_cast<uint8_t>(input_.load(std::memory_order_acquire));
+    netplay_->sendInput(frame, netplay_local_[frame % NETPLAY_SLOTS]);
+    {
+        PROFILE_STAGE(NesFrame);
+        netplayStep(frame, true);
+    }
+    if (present) {
+        publishScreen();
+    } else {
+        cpu_cycles_.store(agnes_get_cpu_cycles(agnes_), std::memory_order_relaxed);
+    }
+    return true;
+}
+
+// Snapshot the state before 'frame', then run it with the best remote pad
+// known. Must hold mutex_.
+void NesEmulator::netplayStep(uint32_t frame, bool output) {
+    int slot = frame % NETPLAY_SLOTS;
+    dumpSnapshot(&netplay_states_[slot * snapshot_size_]);
+    
+    uint32_t remote_frames = netplay_->remoteFrames();
+    uint8_t remote = 0;
+    if (frame < remote_frames) {
+        remote = netplay_->remoteInput(frame);
+    } else if (remote_frames > 0) {
+        remote = netplay_->remoteInput(remote_frames - 1);  // prediction: unchanged
+    }
+    netplay_remote_[slot] = remote;
+    
+    agnes_input_t pads[2];
+    int local = netplay_->localPlayer();
+    pads[local] = InputMovie::unpack(netplay_local_[slot], 0);
+    pads[1 - local] = InputMovie::unpack(remote, 0);
+    agnes_set_input(agnes_, &pads[0], &pads[1]);
+    log_apu_writes_ = output;
+    agnes_next_frame(agnes_);
+    log_apu_writes_ = true;
+    endApuFrame(output);
+}
+
+void NesEmulator::startThread(bool audio_master) {
+    if (thread_running_.load()) return;
+    audio_master_ = audio_master;
+    thread_running_.store(true);
+    emu_thread_ = std::thread(&NesEmulator::emulationThreadFunc, this);
+}
+
+void NesEmulator::stopThread() {
+    thread_running_.store(false);
+    if (emu_thread_.joinable()) {
+        emu_thread_.join();
+    }
+}
+
+void NesEmulator::emulationThreadFunc() {
+    FC_TRACE_THREAD("emulation");
+    MemoryScope memory(MemoryTag::Emulation);
+    using clock = std::chrono::steady_clock;
+    const auto frame_period = std::chrono::duration_cast<clock::duration>(
+        std::chrono::duration<double>(1.0 / NTSC_FRAME_RATE));
+    auto next_frame = clock::now();
+    auto next_present = next_frame;
+    auto fps_start = next_frame;
+    int fps_frames = 0;
+    
+    while (thread_running_.load()) {
+        ThreadPlacement::update(ThreadRole::EMULATION);
+        serviceStateRequests();
+        if (!rom_loaded_ || !running_ || debug_broken_) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(2));
+            next_frame = clock::now();
+            continue;
+        }
+        
+        // Frame rate readout, refreshed twice a second
+        auto fps_now = clock::now();
+        if (fps_now - fps_start >= std::chrono::milliseconds(500)) {
+            float elapsed = std::chrono::duration<float>(fps_now - fps_start).count();
+            emulation_fps_.store(fps_frames / elapsed, std::memory_order_relaxed);
+            fps_start = fps_now;
+            fps_frames = 0;
+        }
+        
+        bool drc = audio_master_ && dynamic_rate_.load();
+        bool rewinding = rewinding_.load() && rewind_enabled_.load() && !netplay_active_.load();
+        
+        // Turbo: no pacing at all; only the last frame before each display refresh is
+        // shown, and as most of its audio is dropped it is synthesized the cheap way
+        bool turbo = turbo_.load() && !rewinding;
+        apu_buffer_.set_fast_synth(turbo);
+        if (turbo) {
+            auto now = clock::now();
+            bool present = now >= next_present;
+            if (present) next_present = now + frame_period;
+            if (!emulateFrame(present)) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            dropExcessAudio(audio_queue_target_.load());
+            next_frame = now;
+            ++fps_frames;
+            continue;
+        }
+        
+        if (audio_master_ && !drc && !rewinding) {
+            // Audio-master clock: the callback draining samples is what advances time.
+            // It drains in bursts of a device buffer, so rather than following each
+            // one, frames keep an even beat (see PresentScheduler) that the smoothed
+            // queue level speeds up or slows down. A queue down to half its target
+            // means the frames come too slowly: run one now; twice the target
+            // (the callback stalled) waits for it to catch up.
+            double target = audio_queue_target_.load();
+            long available = samplesAvailable();
+            auto now = clock::now();
+            bool starving = available < target / 2;
+            if (available >= 2 * target) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                next_frame = now + frame_period;
+                continue;
+            }
+            if (!starving && now < next_frame) {
+                std::this_thread::sleep_until(std::min(next_frame, now + std::chrono::milliseconds(1)));
+                continue;
+            }
+            queue_fill_avg_ += 0.05 * (available - queue_fill_avg_);
+            double error = std::clamp((queue_fill_avg_ - target) / target, -1.0, 1.0);
+            next_frame = (starving ? now : next_frame) + std::chrono::duration_cast<clock::duration>(
+                frame_period * (1.0 + MAX_PACE_ADJUST * error));
+            if (now - next_frame > frame_period * 4) next_frame = now;
+            if (runThreadFrame(starving ? 1.0 : 0.0)) {
+                ++fps_frames;
+            } else {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));  // netplay: peer behind
+            }
+            continue;
+        }
+        
+        // Wall clock at the NTSC frame rate
+        auto now = clock::now();
+        if (now < next_frame) {
+            std::this_thread::sleep_until(std::min(next_frame, now + std::chrono::milliseconds(2)));
+            continue;
+        }
+        double behind = std::chrono::duration<double>(now - next_frame) / frame_period;
+        next_frame += frame_period;
+        if (now - next_frame > frame_period * 4) {
+            next_frame = now;  // fell far behind (e.g. debugger), don't sprint to catch up
+        }
+        
+        // Rewinding plays history backwards at the normal frame rate
+        if (rewinding) {
+            next_frame += frame_period * (REWIND_INTERVAL - 1);
+            rewindFrame();
+            continue;
+        }
+        
+        runThreadFrame(behind);
+        ++fps_frames;
+        if (drc) {
+            updateRateControl();
+        } else {
+            // No audio device: throw away what nobody plays
+            dropExcessAudio(audio_queue_target_.load());
+        }
+    }
+    
+    // Leave the nominal clock behind for whoever runs frames next
+    std::lock_guard<std::mutex> lock(mutex_);
+    apu_buffer_.clock_rate(static_cast<long>(CPU_CLOCK_NTSC));
+    rate_adjust_.store(0.0f);
+}
+
+// A paced frame of the emulation thread, shown if the frame skip allows
+bool NesEmulator::runThreadFrame(double behind) {
+    using clock = std::chrono::steady_clock;
+    bool present = frame_skip_.present(1.0 / NTSC_FRAME_RATE, behind);
+    auto start = clock::now();
+    if (!emulateFrame(present)) return false;
+    frame_skip_.reportEmulationCost(std::chrono::duration<double>(clock::now() - start).count());
+    return true;
 }
 
+// Keep at most 'keep' samples queued; the callback drops the oldest ones
+void NesEmulator::dropExcessAudio(long keep) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (samplesAvailable() > keep) {
+        audio_flush_pos_.store(audio_ring_.writePosition() - keep, std::memory_order_release);
+    }
+}
+
+void NesEmulator::updateRateControl() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    
+    // Frames arrive in ~735-sample bursts, so steer on a smoothed fill level
+    double target = audio_queue_target_.load();
+    double fill = static_cast<double>(samplesAvailable());
+    queue_fill_avg_ += 0.05 * (fill - queue_fill_avg_);
+    
+    // Queue running low -> slightly lower clock rate -> more samples per frame
+    double error = std::clamp((target - queue_fill_avg_) / target, -1.0, 1.0);
+    double ratio = 1.0 - MAX_RATE_ADJUST * error;
+    apu_buffer_.clock_rate(static_cast<long>(CPU_CLOCK_NTSC * ratio));
+    rate_adjust_.store(static_cast<float>(ratio - 1.0), std::memory_order_relaxed);
+    
+    // Way over target (e.g. after the callback stalled): drop the surplus
+    long keep = 2 * static_cast<long>(target);
+    if (samplesAvailable() > keep) {
+        audio_flush_pos_.store(audio_ring_.writePosition() - keep, std::memory_order_release);
+    }
+}
+
+bool NesEmulator::presentFrame() {
+    auto now = PresentScheduler::Clock::now();
+    present_.setFramePeriod(1.0 / NTSC_FRAME_RATE);
+    bool fresh = present_.due(now, frames_.ready()) && frames_.acquire();
+    if (fresh) {
+        double error = present_.shown(now, frames_.front().seconds);
+        if (Profiler::enabled()) {
+            Profiler::setBudget(ProfileStage::FramePacing, static_cast<int64_t>(present_.refreshSeconds() * 0.5e9));
+            Profiler::record(ProfileStage::FramePacing, static_cast<int64_t>(std::fabs(error) * 1e9));
+        }
+    }
+    if (!texture_created_) {
+        // Until a ROM has produced a frame there is nothing to show, and the
+        // pipelines are only worth compiling for a session that plays one
+        if (!fresh) return false;
+        PROFILE_STARTUP("NES screen texture");
+        createScreenTexture();
+    }
+    if (fresh) {
+        PROFILE_STAGE(ScreenUpload);
+        updateScreenTexture(frames_.front().indices);
+        if (frames_.front().traced) input_trace_.uploaded();
+    }
+#ifndef NES_HEADLESS
+    // Filters only run for a new picture or new settings
+    bool changed = fresh || post_dirty_;
+    if (post_.isActive() && changed) {
+        post_.render(screen_view_, AGNES_SCREEN_WIDTH, AGNES_SCREEN_HEIGHT);
+    }
+    post_dirty_ = false;
+    return changed;
+#else
+    return fresh;
+#endif
+}
+
+#ifndef NES_HEADLESS
+void NesEmulator::setScreenFilter(const PostProcessor::Pass* passes, int count) {
+    post_.setChain(passes, count);
+    post_dirty_ = true;
+}
+#endif
+
 void NesEmulator::setInput(int player, const agnes_input_t& input) {
-    if (player >= 0 && player < 2) {
-        input_[player] = input;
+    if (player < 0 || player > 1) return;
+    int shift = player * 8;
+    uint16_t bits = static_cast<uint16_t>((InputMovie::pack(input, agnes_input_t{}) & 0xff) << shift);
+    uint16_t keep = static_cast<uint16_t>(0xff00 >> shift);
+    uint16_t old = input_.load(std::memory_order_relaxed);
+    while (!input_.compare_exchange_weak(old, static_cast<uint16_t>((old & keep) | bits),
+                                         std::memory_order_release, std::memory_order_relaxed)) {
     }
 }
 
+// The game is strobing the pads: hand it the newest ones, once per frame.
+// Runs inside agnes_next_frame, so mutex_ is held.
+void NesEmulator::inputPollCallback(void* user_data) {
+    NesEmulator* emu = static_cast<NesEmulator*>(user_data);
+    if (!emu->late_input_) return;
+    emu->late_input_ = false;
+    uint16_t live = emu->input_.load(std::memory_order_acquire);
+    agnes_input_t pads[2] = { InputMovie::unpack(live, 0), InputMovie::unpack(live, 1) };
+    agnes_set_input(emu->agnes_, &pads[0], &pads[1]);
+    emu->frame_input_ = live;
+    emu->input_trace_.latched(live);
+}
+
 void NesEmulator::apuWriteCallback(void* user_data, uint16_t addr, uint8_t val, uint64_t cpu_cycle) {
     NesEmulator* emu = static_cast<NesEmulator*>(user_data);
     if (!emu) return;
+    if (emu->log_apu_writes_) {
+        emu->apu_writes_.push(cpu_cycle, addr, val);
+    }
     
     // Sync APU to current cycle
     emu->syncApu(cpu_cycle);
@@ -220,20 +825,33 @@ uint8_t NesEmulator::apuReadCallback(void* user_data, uint16_t addr, uint64_t cp
 
 int NesEmulator::apuDmcReadCallback(void* user_data, unsigned addr) {
     NesEmulator* emu = static_cast<NesEmulator*>(user_data);
-    if (!emu || !emu->agnes_) return 0;
+    if (!emu || !emu->cpu_read_pages_) return 0;
     
-    // Read from ROM via agnes CPU
-    // DMC reads from $8000-$FFFF
-    // We need to access agnes memory - for now return 0
-    // TODO: Implement proper DMC sample reading
-    return 0;
+    // DMC samples live in $8000-$FFFF, which is always in the page table
+    return emu->readCpuPage(addr);
 }
 
 void NesEmulator::syncApu(uint64_t cpu_cycle) {
     // APU sync is handled through write_register timing
 }
 
-void NesEmulator::endApuFrame() {
+// A muted oscillator gets no Blip_Buffer, which puts Nes_Apu and the VRC6
+// on their paths that only advance oscillator state. Must hold mutex_.
+void NesEmulator::applyMuteMask() {
+    int mask = mute_mask_.load(std::memory_order_relaxed);
+    if (mask == applied_mute_) return;
+    applied_mute_ = mask;
+    for (int i = 0; i < Nes_Apu::osc_count; ++i) {
+        apu_.osc_output(i, (mask & (1 << i)) ? nullptr : &apu_buffer_);
+    }
+    for (int i = 0; i < Nes_Vrc6_Apu::osc_count; ++i) {
+        int voice = Nes_Apu::osc_count + (i + 1) % Nes_Vrc6_Apu::osc_count;  // saw first
+        vrc6_apu_.osc_output(i, (mask & (1 << voice)) ? nullptr : &apu_buffer_);
+    }
+}
+
+// output false (netplay re-runs): the frame's samples are dropped
+void NesEmulator::endApuFrame(bool output) {
     // Now handled inline in generateAudioSamples() for better timing
     uint64_t current_cycle = agnes_get_cpu_cycles(agnes_);
     nes_time_t frame_length = static_cast<nes_time_t>(current_cycle - last_apu_cycle_);
@@ -245,47 +863,56 @@ void NesEmulator::endApuFrame() {
     apu_buffer_.end_frame(frame_length);
     
     last_apu_cycle_ = current_cycle;
-}
-
-long NesEmulator::samplesAvailable() const {
-    return apu_buffer_.samples_avail();
-}
-
-int NesEmulator::readAudioSamples(short* buffer, int max_samples) {
-    std::lock_guard<std::mutex> lock(mutex_);
     
-    // Just read from buffer - emulation is driven by main thread
-    long available = apu_buffer_.samples_avail();
-    if (available <= 0) return 0;
+    // Hand the frame's samples to the audio callback
+    long count = apu_buffer_.samples_avail();
+    if (count > static_cast<long>(audio_scratch_.size())) {
+        audio_scratch_.resize(count);
+    }
+    count = apu_buffer_.read_samples(audio_scratch_.data(), count);
+    if (!output) return;
+    audio_ring_.write(audio_scratch_.data(), static_cast<int>(count));
     
-    int to_read = std::min(static_cast<int>(available), max_samples);
-    return static_cast<int>(apu_buffer_.read_samples(buffer, to_read));
+    // ...and the channel state the visualizers follow
+    apu_snapshots_.push(ApuFrameSnapshot::capture(apu_, has_vrc6_ ? &vrc6_apu_ : nullptr, nullptr, nullptr,
+                                                  current_cycle / CPU_CLOCK_NTSC),
+                        audio_ring_.writePosition());
 }
 
-void NesEmulator::getApuState(int* periods, int* lengths, int* amplitudes) {
-    std::lock_guard<std::mutex> lock(mutex_);
-    
-    for (int i = 0; i < 5; ++i) {
-        periods[i] = apu_.osc_period(i);
-        lengths[i] = apu_.osc_length(i);
-        amplitudes[i] = apu_.osc_amplitude(i);
-    }
+// Drop everything queued so far. Must hold mutex_.
+void NesEmulator::flushAudio() {
+    apu_buffer_.clear();
+    audio_flush_pos_.store(audio_ring_.writePosition(), std::memory_order_release);
 }
 
-void NesEmulator::getVRC6State(int* periods, int* volumes, bool* enabled) {
-    if (!has_vrc6_) return;
-    
-    std::lock_guard<std::mutex> lock(mutex_);
-    
-    for (int i = 0; i < 3; ++i) {
-        periods[i] = vrc6_apu_.osc_period(i);
-        volumes[i] = vrc6_apu_.osc_volume(i);
-        enabled[i] = vrc6_apu_.osc_enabled(i);
-    }
+long NesEmulator::samplesAvailable() const {
+    // Samples behind a flush point the callback has not reached yet don't count
+    uint64_t since_flush = audio_ring_.writePosition() - audio_flush_pos_.load(std::memory_order_acquire);
+    return std::min(static_cast<long>(audio_ring_.available()), static_cast<long>(since_flush));
+}
+
+int NesEmulator::readAudioSamples(short* buffer, int max_samples, uint64_t* position) {
+    // Just read from the queue - emulation is driven by the emulation thread
+    audio_ring_.discardUntil(audio_flush_pos_.load(std::memory_order_acquire));
+    if (position) *position = audio_ring_.readPosition();
+    return audio_ring_.read(buffer, max_samples);
 }
 
 void NesEmulator::createScreenTexture() {
     if (texture_created_) return;
+#ifdef NES_HEADLESS
+    texture_created_ = true;  // CPU conversion into screen_pixels_ only
+#else
+    post_.init();
+    
+    // Preferred path: upload 8-bit indices and resolve the palette in a shader
+    if (palette_renderer_.init(AGNES_SCREEN_WIDTH, AGNES_SCREEN_HEIGHT)) {
+        palette_renderer_.setPalette(palette_rgba_);
+        screen_view_ = palette_renderer_.targetView();
+        screen_sampler_ = palette_renderer_.sampler();
+        texture_created_ = true;
+        return;
+    }
     
     // Create image with stream update usage (new sokol API)
     sg_image_desc img_desc = {};
@@ -294,7 +921,9 @@ void NesEmulator::createScreenTexture() {
     img_desc.pixel_format = SG_PIXELFORMAT_RGBA8;
     img_desc.usage.stream_update = true;  // New sokol API for stream updates
     
-    screen_texture_ = sg_make_image(&img_desc);
+    for (int i = 0; i < SCREEN_IMAGES; ++i) {
+        screen_textures_[i] = MakeGpuImage(&img_desc);
+    }
     
     // Create sampler for nearest-neighbor filtering (pixel-perfect look)
     sg_sampler_desc smp_desc = {};
@@ -305,43 +934,133 @@ void NesEmulator::createScreenTexture() {
     
     screen_sampler_ = sg_make_sampler(&smp_desc);
     
-    // Create texture view for ImGui binding
-    sg_view_desc view_desc = {};
-    view_desc.texture.image = screen_texture_;
-    
-    screen_view_ = sg_make_view(&view_desc);
+    // Create texture views for ImGui binding
+    for (int i = 0; i < SCREEN_IMAGES; ++i) {
+        sg_view_desc view_desc = {};
+        view_desc.texture.image = screen_textures_[i];
+        screen_views_[i] = sg_make_view(&view_desc);
+    }
+    screen_current_ = 0;
+    screen_view_ = screen_views_[0];
     
     texture_created_ = true;
+#endif
 }
 
 void NesEmulator::destroyScreenTexture() {
+#ifndef NES_HEADLESS
     if (texture_created_) {
-        sg_destroy_view(screen_view_);
-        sg_destroy_sampler(screen_sampler_);
-        sg_destroy_image(screen_texture_);
-        texture_created_ = false;
+        post_.shutdown();
+        if (palette_renderer_.isValid()) {
+            palette_renderer_.shutdown();
+        } else {
+            for (int i = 0; i < SCREEN_IMAGES; ++i) {
+                sg_destroy_view(screen_views_[i]);
+                DestroyGpuImage(screen_textures_[i]);
+            }
+            sg_destroy_sampler(screen_sampler_);
+        }
     }
+#endif
+    texture_created_ = false;
+}
+
+void NesEmulator::setPalette(const uint32_t* argb) {
+    buildPaletteLut(argb);
+#ifndef NES_HEADLESS
+    palette_renderer_.setPalette(palette_rgba_);
+#endif
 }
 
-void NesEmulator::updateScreenTexture() {
-    if (!agnes_ || !texture_created_) return;
+bool NesEmulator::loadPaletteFile(const char* path) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) return false;
     
-    // Convert agnes screen buffer to RGBA pixels
-    for (int y = 0; y < AGNES_SCREEN_HEIGHT; ++y) {
-        for (int x = 0; x < AGNES_SCREEN_WIDTH; ++x) {
-            agnes_color_t color = agnes_get_screen_pixel(agnes_, x, y);
-            screen_pixels_[y * AGNES_SCREEN_WIDTH + x] = 
-                (color.a << 24) | (color.b << 16) | (color.g << 8) | color.r;
-        }
+    uint8_t rgb[64 * 3];
+    if (!file.read(reinterpret_cast<char*>(rgb), sizeof(rgb))) return false;
+    
+    uint32_t argb[64];
+    for (int i = 0; i < 64; ++i) {
+        argb[i] = 0xFF000000u | (rgb[i * 3] << 16) | (rgb[i * 3 + 1] << 8) | rgb[i * 3 + 2];
     }
+    setPalette(argb);
+    return true;
+}
+
+void NesEmulator::buildPaletteLut(const uint32_t* argb) {
+    // 0xAARRGGBB -> bytes R,G,B,A in memory (little-endian)
+    for (int i = 0; i < 64; ++i) {
+        uint32_t c = argb[i];
+        palette_rgba_[i] = (c & 0xFF00FF00) | ((c >> 16) & 0xFF) | ((c & 0xFF) << 16);
+    }
+}
+
+void NesEmulator::convertScreen(const uint8_t* indices, uint32_t* out) const {
+    const int count = AGNES_SCREEN_WIDTH * AGNES_SCREEN_HEIGHT;
+    int i = 0;
+#if defined(NES_USE_AVX2)
+    // 8 pixels per gather straight out of the 64-entry LUT
+    const __m256i mask = _mm256_set1_epi32(0x3f);
+    for (; i + 8 <= count; i += 8) {
+        __m128i bytes = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(indices + i));
+        __m256i idx = _mm256_and_si256(_mm256_cvtepu8_epi32(bytes), mask);
+        __m256i rgba = _mm256_i32gather_epi32(reinterpret_cast<const int*>(palette_rgba_), idx, 4);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), rgba);
+    }
+#elif defined(NES_USE_NEON)
+    // Split the LUT into R/G/B/A planes so each is a single 64-byte tbl lookup
+    const uint8_t* lut = reinterpret_cast<const uint8_t*>(palette_rgba_);
+    uint8x16x4_t q0 = vld4q_u8(lut), q1 = vld4q_u8(lut + 64);
+    uint8x16x4_t q2 = vld4q_u8(lut + 128), q3 = vld4q_u8(lut + 192);
+    uint8x16x4_t planes[4];
+    for (int c = 0; c < 4; ++c) {
+        planes[c].val[0] = q0.val[c];
+        planes[c].val[1] = q1.val[c];
+        planes[c].val[2] = q2.val[c];
+        planes[c].val[3] = q3.val[c];
+    }
+    const uint8x16_t mask = vdupq_n_u8(0x3f);
+    for (; i + 16 <= count; i += 16) {
+        uint8x16_t idx = vandq_u8(vld1q_u8(indices + i), mask);
+        uint8x16x4_t rgba;
+        rgba.val[0] = vqtbl4q_u8(planes[0], idx);
+        rgba.val[1] = vqtbl4q_u8(planes[1], idx);
+        rgba.val[2] = vqtbl4q_u8(planes[2], idx);
+        rgba.val[3] = vqtbl4q_u8(planes[3], idx);
+        vst4q_u8(reinterpret_cast<uint8_t*>(out + i), rgba);
+    }
+#endif
+    for (; i < count; ++i) {
+        out[i] = palette_rgba_[indices[i] & 0x3f];
+    }
+}
+
+void NesEmulator::updateScreenTexture(const uint8_t* indices) {
+    if (!texture_created_) return;
+    
+#ifndef NES_HEADLESS
+    // GPU path: 60 KB of indices per frame, colors resolved in the shader
+    if (palette_renderer_.isValid()) {
+        palette_renderer_.render(indices);
+        return;
+    }
+#endif
     
-    // Upload to GPU texture
+    // Palette indices -> RGBA pixels in one pass over the LUT
+    convertScreen(indices, screen_pixels_);
+    
+#ifndef NES_HEADLESS
+    // Upload into the least recently shown image and show that one
+    screen_current_ = (screen_current_ + 1) % SCREEN_IMAGES;
     sg_image_data data = {};
     data.mip_levels[0].ptr = screen_pixels_;
     data.mip_levels[0].size = sizeof(screen_pixels_);
-    sg_update_image(screen_texture_, &data);
+    sg_update_image(screen_textures_[screen_current_], &data);
+    screen_view_ = screen_views_[screen_current_];
+#endif
 }
 
+#ifndef NES_HEADLESS
 void NesEmulator::drawScreen(float scale) {
     if (!texture_created_) return;
     
@@ -349,15 +1068,175 @@ void NesEmulator::drawScreen(float scale) {
     float height = static_cast<float>(AGNES_SCREEN_HEIGHT) * scale;
     
     // Get ImTextureID from view and sampler using sokol_imgui helper
-    uint64_t imtex_id = simgui_imtextureid_with_sampler(screen_view_, screen_sampler_);
+    uint64_t imtex_id = post_.isActive()
+        ? simgui_imtextureid_with_sampler(post_.outputView(), post_.sampler())
+        : simgui_imtextureid_with_sampler(screen_view_, screen_sampler_);
     
     // Draw the texture using ImGui
     ImGui::Image(imtex_id, ImVec2(width, height));
 }
 
+void NesEmulator::screenSize(int& width, int& height) const {
+    width = AGNES_SCREEN_WIDTH;
+    height = AGNES_SCREEN_HEIGHT;
+    if (!post_.isActive()) return;
+    for (int i = 0; i < post_.passCount(); ++i) {
+        width *= post_.pass(i).scale;
+        height *= post_.pass(i).scale;
+    }
+}
+#endif
+
 uint64_t NesEmulator::getCpuCycles() const {
-    if (!agnes_) return 0;
-    return agnes_get_cpu_cycles(agnes_);
+    return cpu_cycles_.load(std::memory_order_relaxed);
+}
+
+uint64_t NesEmulator::getCpuInstructions() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return agnes_ ? agnes_get_cpu_instructions(agnes_) : 0;
+}
+
+int NesEmulator::readRam(uint8_t* out, uint64_t& rom) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!agnes_ || !rom_loaded_) return 0;
+    rom = rom_hash_;
+    memcpy(out, agnes_get_ram(agnes_), AGNES_RAM_SIZE);
+    const uint8_t* work_ram = agnes_get_work_ram(agnes_);
+    if (!work_ram) return AGNES_RAM_SIZE;
+    memcpy(out + AGNES_RAM_SIZE, work_ram, AGNES_WORK_RAM_SIZE);
+    return RAM_SEARCH_BYTES;
+}
+
+void NesEmulator::setRamFreezes(const std::vector<RamFreeze>& freezes) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    ram_freezes_ = freezes;
+}
+
+// Must hold mutex_
+void NesEmulator::applyRamFreezes() {
+    if (ram_freezes_.empty()) return;
+    uint8_t* ram = agnes_get_ram(agnes_);
+    uint8_t* work_ram = agnes_get_work_ram(agnes_);
+    for (const RamFreeze& freeze : ram_freezes_) {
+        if (freeze.address < AGNES_RAM_SIZE) {
+            ram[freeze.address] = freeze.value;
+        } else if (work_ram && freeze.address >= 0x6000 && freeze.address < 0x8000) {
+            work_ram[freeze.address - 0x6000] = freeze.value;
+        }
+    }
+}
+
+void NesEmulator::setDebuggerAttached(bool attached) {
+    if (attached == debugger_attached_.load()) return;
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (attached && !debugger_) {
+        debugger_ = std::make_unique<agnes_debugger_t>();
+        memset(debugger_.get(), 0, sizeof(agnes_debugger_t));
+        debugger_->scanline = -1;
+    }
+    agnes_set_debugger(agnes_, attached ? debugger_.get() : nullptr);
+    debugger_attached_.store(attached);
+    if (!attached) {
+        // A frame a stop left open finishes through the plain loop
+        debug_frame_step_ = false;
+        debug_broken_.store(false);
+    }
+}
+
+void NesEmulator::setBreakpoints(const std::vector<Breakpoint>& breakpoints) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!debugger_) return;
+    memset(debugger_->breakpoints, 0, sizeof(debugger_->breakpoints));
+    for (const Breakpoint& bp : breakpoints) {
+        debugger_->breakpoints[bp.address] |= bp.flags;
+    }
+    if (debugger_attached_.load()) agnes_set_debugger(agnes_, debugger_.get());
+}
+
+void NesEmulator::setScanlineBreak(int scanline) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (debugger_) debugger_->scanline = scanline;
+}
+
+void NesEmulator::debugBreak() {
+    debugStep(1);
+}
+
+void NesEmulator::debugStep(uint32_t instructions) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!debugger_ || !debugger_attached_.load()) return;
+    debugger_->steps = instructions;
+    debug_broken_.store(false);
+}
+
+void NesEmulator::debugStepFrame() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!debugger_ || !debugger_attached_.load()) return;
+    debugger_->steps = 0;
+    debug_frame_step_ = true;
+    debug_broken_.store(false);
+}
+
+void NesEmulator::debugContinue() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!debugger_) return;
+    debugger_->steps = 0;
+    debug_frame_step_ = false;
+    debug_broken_.store(false);
+}
+
+bool NesEmulator::readDebugState(DebugState& out) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!agnes_ || !rom_loaded_ || !debugger_ || !debugger_attached_.load()) return false;
+    agnes_get_cpu_regs(agnes_, &out.regs);
+    out.reason = debugger_->reason;
+    out.address = debugger_->addr;
+    out.value = debugger_->value;
+    out.broken = debug_broken_.load();
+    return true;
+}
+
+void NesEmulator::disassemble(uint16_t address, int count, std::vector<DisasmLine>& out) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    out.clear();
+    if (!agnes_ || !rom_loaded_) return;
+    for (int i = 0; i < count; ++i) {
+        DisasmLine line;
+        line.address = address;
+        line.length = static_cast<uint8_t>(agnes_disassemble(agnes_, address, line.text, sizeof(line.text)));
+        out.push_back(line);
+        address = static_cast<uint16_t>(address + line.length);
+    }
+}
+
+bool NesEmulator::readPpuDebug(PpuDebug& out) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!agnes_ || !rom_loaded_) return false;
+    agnes_ppu_dirty_t dirty;
+    agnes_take_ppu_dirty(agnes_, &dirty);
+    for (int page = 0; page < 8; ++page) {
+        for (uint64_t bits = dirty.tiles[page]; bits; bits &= bits - 1) {
+            int tile = page * 64 + std::countr_zero(bits);
+            agnes_ppu_tile_pixels(agnes_, tile, out.tiles[tile]);
+        }
+        out.dirty.tiles[page] |= dirty.tiles[page];
+    }
+    for (int n = 0; n < 4; ++n) {
+        if (!(dirty.nametables & (1 << n))) continue;
+        for (int i = 0; i < 0x400; ++i) {
+            out.nametables[n * 0x400 + i] = agnes_ppu_peek(agnes_, static_cast<uint16_t>(0x2000 + n * 0x400 + i));
+        }
+    }
+    out.dirty.nametables |= dirty.nametables;
+    if (dirty.palette) {
+        for (int i = 0; i < 32; ++i) {
+            out.palette[i] = agnes_ppu_peek(agnes_, static_cast<uint16_t>(0x3F00 + i));
+        }
+        out.dirty.palette = true;
+    }
+    memcpy(out.oam, agnes_get_oam(agnes_), sizeof(out.oam));
+    agnes_get_ppu_info(agnes_, &out.info);
+    return true;
 }
 
 int NesEmulator::getCurrentScanline() const {
@@ -367,21 +1246,243 @@ int NesEmulator::getCurrentScanline() const {
 
 bool NesEmulator::saveState(std::vector<uint8_t>& out_state) {
     if (!agnes_ || !rom_loaded_) return false;
+    MemoryScope memory(MemoryTag::Savestates);
     
     std::lock_guard<std::mutex> lock(mutex_);
-    
-    size_t state_size = agnes_state_size();
-    out_state.resize(state_size);
-    
-    agnes_dump_state(agnes_, reinterpret_cast<agnes_state_t*>(out_state.data()));
+    writeState(out_state);
     return true;
 }
 
+// Header and snapshot of the loaded ROM. Must hold mutex_.
+void NesEmulator::writeState(std::vector<uint8_t>& out_state) {
+    StateHeader header;
+    memcpy(header.magic, "FCST", 4);
+    header.version = STATE_VERSION;
+    header.rom_hash = rom_hash_;
+    header.size = static_cast<uint32_t>(snapshot_size_);
+    header.reserved = 0;
+    out_state.resize(sizeof(header) + snapshot_size_);
+    memcpy(out_state.data(), &header, sizeof(header));
+    dumpSnapshot(out_state.data() + sizeof(header));
+}
+
 bool NesEmulator::loadState(const std::vector<uint8_t>& state) {
     if (!agnes_ || !rom_loaded_) return false;
-    if (state.size() < agnes_state_size()) return false;
     
     std::lock_guard<std::mutex> lock(mutex_);
+    StateHeader header;
+    if (netplay_ || state.size() != sizeof(header) + snapshot_size_) return false;
+    memcpy(&header, state.data(), sizeof(header));
+    if (memcmp(header.magic, "FCST", 4) != 0 || header.version != STATE_VERSION ||
+        header.rom_hash != rom_hash_ || header.size != snapshot_size_) {
+        return false;
+    }
     
-    return agnes_restore_state(agnes_, reinterpret_cast<const agnes_state_t*>(state.data()));
+    // Audio carries on: whatever is queued still plays, and the restored
+    // oscillators continue from the levels already in the Blip_Buffer
+    endMovie();
+    restoreSnapshot(state.data() + sizeof(header), true);
+    return true;
+}
+
+void NesEmulator::saveStateAsync(std::function<void(std::vector<uint8_t>)> done) {
+    if (!thread_running_.load()) {
+        std::vector<uint8_t> state;
+        if (saveState(state)) done(std::move(state));
+        return;
+    }
+    std::lock_guard<std::mutex> lock(state_request_mutex_);
+    pending_save_ = std::move(done);
+    state_requested_.store(true, std::memory_order_release);
+}
+
+void NesEmulator::loadStateAsync(std::vector<uint8_t> state) {
+    if (!thread_running_.load()) {
+        loadState(state);
+        return;
+    }
+    std::lock_guard<std::mutex> lock(state_request_mutex_);
+    pending_load_ = std::move(state);
+    state_requested_.store(true, std::memory_order_release);
+}
+
+// Emulation thread, between frames
+void NesEmulator::serviceStateRequests() {
+    if (!state_requested_.exchange(false, std::memory_order_acquire)) return;
+    std::function<void(std::vector<uint8_t>)> save;
+    std::vector<uint8_t> load;
+    {
+        std::lock_guard<std::mutex> lock(state_request_mutex_);
+        save = std::move(pending_save_);
+        pending_save_ = nullptr;
+        load.swap(pending_load_);
+    }
+    if (!load.empty()) loadState(load);
+    std::vector<uint8_t> state;
+    if (save && saveState(state)) save(std::move(state));
+}
+
+// Compact snapshot: agnes without the framebuffer, then the Nes_Apu and (VRC6
+// carts) Nes_Vrc6_Apu state, snapshot_size_ bytes. Taken between frames, so
+// the APU's time base is the current CPU cycle. Must hold mutex_.
+void NesEmulator::dumpSnapshot(uint8_t* out) {
+    agnes_dump_compact_state(agnes_, out);
+    out += agnes_compact_state_size(agnes_);
+    apu_state_t apu;
+    apu_.save_state(&apu);
+    memcpy(out, &apu, sizeof(apu));
+    if (has_vrc6_) {
+        vrc6_apu_state_t vrc6;
+        vrc6_apu_.save_state(&vrc6);
+        memcpy(out + sizeof(apu), &vrc6, sizeof(vrc6));
+    }
+}
+
+// keep_output: start the oscillators from the amplitudes the Blip_Buffer
+// holds now instead of the saved ones, so the buffer needn't be cleared
+// (no DC step; VRC6 channels restart from silence either way)
+void NesEmulator::restoreSnapshot(const uint8_t* in, bool keep_output) {
+    agnes_restore_compact_state(agnes_, in);
+    debug_frame_open_ = false;
+    in += agnes_compact_state_size(agnes_);
+    apu_state_t apu;
+    memcpy(&apu, in, sizeof(apu));
+    if (keep_output) {
+        apu_state_t now;
+        apu_.save_state(&now);
+        apu.square1.last_amp = now.square1.last_amp;
+        apu.square2.last_amp = now.square2.last_amp;
+        apu.triangle.last_amp = now.triangle.last_amp;
+        apu.noise.last_amp = now.noise.last_amp;
+        apu.dmc.osc.last_amp = now.dmc.osc.last_amp;
+    }
+    apu_.load_state(apu);
+    if (has_vrc6_) {
+        vrc6_apu_state_t vrc6;
+        memcpy(&vrc6, in + sizeof(apu), sizeof(vrc6));
+        vrc6_apu_.load_state(vrc6);
+    }
+    last_apu_cycle_ = agnes_get_cpu_cycles(agnes_);
+    cpu_cycles_.store(last_apu_cycle_, std::memory_order_relaxed);
+}
+
+void NesEmulator::startRecording() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!rom_loaded_ || netplay_) return;
+    recording_.clear();
+    movie_frame_.store(0, std::memory_order_relaxed);
+    movie_length_.store(0, std::memory_order_relaxed);
+    movie_mode_.store(MovieMode::RECORD_PENDING);
+}
+
+bool NesEmulator::stopRecording(InputMovie& out) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    MovieMode mode = movie_mode_.load();
+    if (mode == MovieMode::RECORD_PENDING || mode == MovieMode::RECORDING) {
+        movie_mode_.store(MovieMode::NONE);
+    }
+    if (recording_.empty()) return false;
+    out = recording_;
+    return true;
+}
+
+bool NesEmulator::startReplay(const InputMovie& movie) {
+    const InputMovie::StartState& start = movie.startState();
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!rom_loaded_ || netplay_ || movie.empty() || movie.romHash() != rom_hash_ ||
+        start.agnes.size() != agnes_compact_state_size(agnes_) || start.apu.size() != sizeof(apu_state_t) ||
+        (!start.vrc6.empty() && start.vrc6.size() != sizeof(vrc6_apu_state_t))) {
+        return false;
+    }
+    replay_ = movie;
+    replay_cursor_ = InputMovie::Cursor();
+    movie_frame_.store(0, std::memory_order_relaxed);
+    movie_length_.store(movie.frameCount(), std::memory_order_relaxed);
+    movie_mode_.store(MovieMode::REPLAY_PENDING);
+    return true;
+}
+
+void NesEmulator::stopReplay() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    MovieMode mode = movie_mode_.load();
+    if (mode == MovieMode::REPLAY_PENDING || mode == MovieMode::REPLAYING) {
+        movie_mode_.store(MovieMode::NONE);
+    }
+}
+
+// Anything that moves the state outside the movie ends it. Must hold mutex_.
+void NesEmulator::endMovie() {
+    movie_mode_.store(MovieMode::NONE);
+}
+
+// Exact state at a frame boundary: endApuFrame() has just run, so the APU's
+// time base starts at the current CPU cycle. Must hold mutex_.
+void NesEmulator::captureMovieStart(InputMovie::StartState& out) {
+    out.agnes.resize(agnes_compact_state_size(agnes_));
+    agnes_dump_compact_state(agnes_, out.agnes.data());
+    out.apu.resize(sizeof(apu_state_t));
+    apu_.save_state(reinterpret_cast<apu_state_t*>(out.apu.data()));
+    out.vrc6.clear();
+    if (has_vrc6_) {
+        out.vrc6.resize(sizeof(vrc6_apu_state_t));
+        vrc6_apu_.save_state(reinterpret_cast<vrc6_apu_state_t*>(out.vrc6.data()));
+    }
+}
+
+bool NesEmulator::captureFrameState(InputMovie::StartState& out) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!agnes_ || !rom_loaded_) return false;
+    captureMovieStart(out);
+    return true;
+}
+
+void NesEmulator::restoreMovieStart(const InputMovie::StartState& start) {
+    agnes_restore_compact_state(agnes_, start.agnes.data());
+    apu_state_t apu;
+    memcpy(&apu, start.apu.data(), sizeof(apu));
+    apu_.load_state(apu);
+    if (has_vrc6_ && !start.vrc6.empty()) {
+        vrc6_apu_state_t vrc6;
+        memcpy(&vrc6, start.vrc6.data(), sizeof(vrc6));
+        vrc6_apu_.load_state(vrc6);
+    }
+    last_apu_cycle_ = agnes_get_cpu_cycles(agnes_);
+    flushAudio();
+}
+
+// Pick this frame's pads and advance the movie. Must hold mutex_.
+void NesEmulator::movieInput(agnes_input_t pads[2]) {
+    MovieMode mode = movie_mode_.load();
+    if (mode == MovieMode::NONE) return;
+    
+    if (mode == MovieMode::REPLAY_PENDING) {
+        restoreMovieStart(replay_.startState());
+        mode = MovieMode::REPLAYING;
+        movie_mode_.store(mode);
+    } else if (mode == MovieMode::RECORD_PENDING) {
+        InputMovie::StartState start;
+        captureMovieStart(start);
+        recording_.begin(rom_hash_, std::move(start));
+        mode = MovieMode::RECORDING;
+        movie_mode_.store(mode);
+    }
+    
+    uint32_t frame = movie_frame_.load(std::memory_order_relaxed);
+    if (mode == MovieMode::REPLAYING) {
+        if (frame >= replay_.frameCount()) {
+            movie_mode_.store(MovieMode::NONE);  // live input from here on
+            return;
+        }
+        uint16_t buttons = replay_.buttonsAt(frame, replay_cursor_);
+        pads[0] = InputMovie::unpack(buttons, 0);
+        pads[1] = InputMovie::unpack(buttons, 1);
+    }
+    movie_frame_.store(frame + 1, std::memory_order_relaxed);
+}
+
+// Record the pads the frame just run actually latched. Must hold mutex_.
+void NesEmulator::recordMovieFrame() {
+    if (movie_mode_.load() != MovieMode::RECORDING) return;
+    recording_.append(frame_input_);
+    movie_length_.store(recording_.frameCount(), std::memory_order_relaxed);
 }
@@ -4,15 +4,38 @@
 #include "gme/Nes_Apu.h"
 #include "gme/Nes_Vrc6_Apu.h"
 #include "gme/Blip_Buffer.h"
+#include "TripleBuffer.h"
+#include "RewindBuffer.h"
+#include "AudioRing.h"
+#include "ApuSnapshot.h"
+#include "ApuSnapshotQueue.h"
+#include "ApuWriteLog.h"
+#include "CpuProfiler.h"
+#include "FrameSkip.h"
+#include "PresentScheduler.h"
+#include "InputLatencyTrace.h"
+#include "MappedFile.h"
+#include "RomCache.h"
+#include "InputMovie.h"
+#include "Netplay.h"
+#ifndef NES_HEADLESS
 #include "sokol_gfx.h"
+#include "PaletteRenderer.h"
+#include "PostProcessor.h"
 #include "imgui.h"
+#endif
 
 #include <vector>
 #include <string>
+#include <memory>
 #include <mutex>
 #include <atomic>
+#include <thread>
+#include <functional>
 
-// NES Emulator class that integrates agnes (CPU/PPU) with gme's Nes_Apu
+// NES Emulator class that integrates agnes (CPU/PPU) with gme's Nes_Apu.
+// Building with NES_HEADLESS drops everything that touches sokol_gfx/ImGui;
+// frames are then only converted into getScreenPixels().
 class NesEmulator {
 public:
     NesEmulator();
@@ -21,48 +44,283 @@ public:
     // Initialize the emulator
     bool init(long audio_sample_rate);
     
-    // Load a ROM file
+    // Load a ROM file. The one it replaces is suspended (its image, state
+    // and last picture kept within SUSPEND_BUDGET), and loading a suspended
+    // ROM again resumes it where it was left instead of powering it on.
     bool loadROM(const char* path);
     bool loadROMData(const void* data, size_t size);
+    // Paths of the suspended ROMs, most recently left first
+    std::vector<std::string> suspendedRoms() const { return suspended_.paths(); }
     
     // Emulation control
     void reset();
-    void runFrame();
+    // Emulate one frame now and publish it for presentFrame(); false if
+    // netplay is waiting for the peer
+    bool runFrame();
     void pause() { running_ = false; }
     void resume() { running_ = true; }
     bool isRunning() const { return running_; }
     bool isLoaded() const { return rom_loaded_; }
     
-    // Input
+    // Emulation thread. With audio_master the sound card's clock sets the pace:
+    // frames run on an even beat whose period the audio queue level steers (up
+    // to +-MAX_PACE_ADJUST) toward the target, and at once when it runs low.
+    // Without an audio device it runs at NTSC_FRAME_RATE by wall clock.
+    void startThread(bool audio_master);
+    void stopThread();
+    void setAudioQueueTarget(int samples) { audio_queue_target_.store(samples); }
+    // Output sample rate and Blip_Buffer length; clears any queued audio
+    void setAudioFormat(long sample_rate, int latency_msec);
+    
+    // Dynamic rate control: pace frames by wall clock at the exact NTSC rate and
+    // nudge the Blip_Buffer clock ratio (up to +-MAX_RATE_ADJUST) to hold the
+    // audio queue at its target, instead of letting the sound card set the pace
+    void setDynamicRateControl(bool enabled) { dynamic_rate_.store(enabled); }
+    bool getDynamicRateControl() const { return dynamic_rate_.load(); }
+    float getRateAdjust() const { return rate_adjust_.load(std::memory_order_relaxed); }
+    
+    // Input. Lock-free, so it can be called straight from the event handler:
+    // the emulation thread latches the newest pads when the game first
+    // strobes them in a frame (not during replay or netplay, whose pads are
+    // fixed before the frame runs)
     void setInput(int player, const agnes_input_t& input);
+    // Late latching (on by default): with it off the pads are taken once,
+    // as the frame starts
+    void setLateLatching(bool enabled) { late_latching_.store(enabled, std::memory_order_relaxed); }
+    bool getLateLatching() const { return late_latching_.load(std::memory_order_relaxed); }
+    // Stage stamps for the input latency test, fed as frames go through
+    InputLatencyTrace& inputLatencyTrace() { return input_trace_; }
     
-    // Audio - read samples from buffer (does NOT run emulation)
-    int readAudioSamples(short* buffer, int max_samples);
+    // Audio - read samples from the queue (does NOT run emulation). Lock-free;
+    // meant for a single consumer thread (the audio callback). 'position'
+    // receives the output stream position of the first sample read.
+    int readAudioSamples(short* buffer, int max_samples, uint64_t* position = nullptr);
     
-    // Get APU data for visualization
-    void getApuState(int* periods, int* lengths, int* amplitudes);
+    // APU channel state at the end of each emulated frame, stamped with the
+    // output stream position its samples end at, for the visualizers to
+    // follow what readAudioSamples has reached. Readers never block the
+    // emulation thread.
+    const ApuSnapshotQueue& apuSnapshots() const { return apu_snapshots_; }
+    // Every APU and VRC6 register write with its CPU cycle, for timeline
+    // views and exporters. Frames re-run by a netplay rollback are not
+    // logged again; cycles jump back after a rewind step or state load.
+    const ApuWriteLog& apuWriteLog() const { return apu_writes_; }
     
     // VRC6 expansion support
     bool hasVRC6() const { return has_vrc6_; }
-    void getVRC6State(int* periods, int* volumes, bool* enabled);
     
-    // Get samples available in buffer
+    // Channel mutes as a mask of voices, numbered as ChannelLayout::build
+    // does (APU 0-4, then VRC6 saw, pulse 1, pulse 2). Muted oscillators
+    // keep counting but skip synthesis; applied from the next frame.
+    void setMuteMask(int mask) { mute_mask_.store(mask, std::memory_order_relaxed); }
+    int getMuteMask() const { return mute_mask_.load(std::memory_order_relaxed); }
+    
+    // Get samples available in the queue (lock-free, safe from any thread)
     long samplesAvailable() const;
     
     // Video - get screen texture for rendering
-    sg_image getScreenTexture() const { return screen_texture_; }
-    void updateScreenTexture();
+#ifndef NES_HEADLESS
+    sg_image getScreenTexture() const { return screen_textures_[screen_current_]; }
+#endif
+    void updateScreenTexture(const uint8_t* indices);
+    // RGBA8 pixels of the last CPU-converted frame
+    const uint32_t* getScreenPixels() const { return screen_pixels_; }
+    
+    // Main thread, once per rendered frame: upload the newest frame finished
+    // by the emulation thread when its turn has come (see PresentScheduler),
+    // creating the screen texture with the first one. True if the picture
+    // changed (a new frame, or new filter settings).
+    bool presentFrame();
     
+    // Variable refresh display: the frame loop should wait for
+    // nextPresentTime() so it refreshes once per emulated frame
+    void setVariableRefresh(bool enabled) { present_.setVariableRefresh(enabled); }
+    bool variableRefresh() const { return present_.variableRefresh(); }
+    PresentScheduler::Clock::time_point nextPresentTime() const { return present_.nextDue(); }
+    
+#ifndef NES_HEADLESS
     // Draw emulator screen in ImGui window
     void drawScreen(float scale = 2.0f);
+    // What drawScreen shows - the filter chain's output, or the raw screen
+    // without one - and its size in texels
+    sg_view screenView() const { return post_.isActive() ? post_.outputView() : screen_view_; }
+    void screenSize(int& width, int& height) const;
+#endif
+    
+    // Palette (64 entries, 0xAARRGGBB); applies from the next frame
+    void setPalette(const uint32_t* argb);
+    void resetPalette() { setPalette(nes_palette_); }
+    // .pal file: 64 RGB triplets (larger emphasis-variant files use the first 64)
+    bool loadPaletteFile(const char* path);
+    // True when palette indices are resolved on the GPU instead of the CPU
+#ifndef NES_HEADLESS
+    bool usesGpuPalette() const { return palette_renderer_.isValid(); }
+#else
+    bool usesGpuPalette() const { return false; }
+#endif
+    
+#ifndef NES_HEADLESS
+    // Screen filter passes (see PostProcessor.h), none for the raw picture.
+    // Applied on the next presentFrame(), also while paused.
+    void setScreenFilter(const PostProcessor::Pass* passes, int count);
+    bool supportsScreenFilter() const { return post_.isValid(); }
+#endif
+    
+    // PPU memory for the debug viewers. readPpuDebug() copies what changed
+    // since the previous call into 'out' and ORs those bits into out.dirty
+    // (the caller clears them once it has redrawn); OAM and the PPU info are
+    // copied every time.
+    struct PpuDebug {
+        uint8_t tiles[512][64];     // 2-bit pixels of $0000-$1FFF as mapped, 8x8 row-major
+        uint8_t nametables[0x1000]; // $2000-$2FFF after mirroring
+        uint8_t palette[32];        // $3F00-$3F1F
+        uint8_t oam[256];
+        agnes_ppu_info_t info;
+        agnes_ppu_dirty_t dirty;
+    };
+    bool readPpuDebug(PpuDebug& out);
+    // RGBA8 of the 64 NES colors, as the screen uses them
+    const uint32_t* paletteRgba() const { return palette_rgba_; }
+    
+    // RAM search: CPU RAM ($0000-$07FF), then the cart's work RAM
+    // ($6000-$7FFF) if it has any, into 'out' (RAM_SEARCH_BYTES at most).
+    // Returns the bytes copied, 0 without a ROM; 'rom' identifies the game.
+    static constexpr int RAM_SEARCH_BYTES = AGNES_RAM_SIZE + AGNES_WORK_RAM_SIZE;
+    int readRam(uint8_t* out, uint64_t& rom);
+    // Cheats: bytes written back before every frame (not during netplay).
+    // Loading a ROM clears them.
+    struct RamFreeze {
+        uint16_t address;   // $0000-$07FF or $6000-$7FFF
+        uint8_t value;
+    };
+    void setRamFreezes(const std::vector<RamFreeze>& freezes);
+    
+    // Debugger (see agnes_debugger_t). While attached the emulation thread
+    // runs frames through agnes_debug_run; a breakpoint or the end of a step
+    // holds it, mid-frame if need be, until debugContinue() or another step.
+    // Detached (the default) frames go through the plain loop. Netplay,
+    // run-ahead and rewind frames never stop.
+    struct Breakpoint {
+        uint16_t address;
+        uint8_t flags;      // AGNES_BREAK_*
+    };
+    struct DebugState {
+        agnes_cpu_regs_t regs;
+        agnes_debug_reason_t reason;    // of the last stop
+        uint16_t address;
+        uint8_t value;
+        bool broken;
+    };
+    struct DisasmLine {
+        uint16_t address;
+        uint8_t length;
+        char text[24];
+    };
+    void setDebuggerAttached(bool attached);
+    bool isDebuggerAttached() const { return debugger_attached_.load(); }
+    bool isDebugBroken() const { return debug_broken_.load(); }
+    void setBreakpoints(const std::vector<Breakpoint>& breakpoints);
+    // Break as the PPU enters 'scanline'; -1 for none
+    void setScanlineBreak(int scanline);
+    void debugBreak();                          // stop after the next instruction
+    void debugStep(uint32_t instructions);
+    void debugStepFrame();                      // run to the end of the frame
+    void debugContinue();
+    // False without a ROM or while detached
+    bool readDebugState(DebugState& out);
+    // 'count' instructions from 'address' on
+    void disassemble(uint16_t address, int count, std::vector<DisasmLine>& out);
     
     // State
     uint64_t getCpuCycles() const;
+    uint64_t getCpuInstructions() const;
     int getCurrentScanline() const;
     
-    // Save/Load state
+    // Exact state between two emulated frames (agnes and APU, as a movie
+    // starts from), for a headless copy to carry on from (NesBatch::restore).
+    // False without a ROM.
+    bool captureFrameState(InputMovie::StartState& out);
+    // Pads as setInput() last left them
+    uint16_t liveInput() const { return input_.load(std::memory_order_relaxed); }
+    
+    // Save/Load state: a header (ROM hash, version) then the compact agnes
+    // state and the APU. Loading checks the header and keeps audio playing;
+    // there is no framebuffer, so the picture catches up with the next frame.
     bool saveState(std::vector<uint8_t>& out_state);
     bool loadState(const std::vector<uint8_t>& state);
+    // The same without waiting on a frame: the emulation thread saves or
+    // loads between frames and hands a saved state to 'done' there (keep it
+    // short). With no emulation thread it happens on the caller.
+    void saveStateAsync(std::function<void(std::vector<uint8_t>)> done);
+    void loadStateAsync(std::vector<uint8_t> state);
+    uint64_t romHash() const { return rom_hash_; }
+    
+    // Rewind: while enabled a snapshot is kept every REWIND_INTERVAL frames
+    // (within REWIND_BUDGET bytes); holding setRewinding(true) steps back
+    // through them at normal speed, without audio
+    void setRewindEnabled(bool enabled);
+    bool isRewindEnabled() const { return rewind_enabled_.load(); }
+    void setRewinding(bool rewinding) { rewinding_.store(rewinding); }
+    bool isRewinding() const { return rewinding_.load(); }
+    float rewindSeconds() const { return rewind_seconds_.load(std::memory_order_relaxed); }
+    
+    // Run-ahead: after each real frame, copy the state into a second agnes
+    // instance (no audio or video output), run it 1-MAX_RUN_AHEAD frames
+    // further with the current input and show that frame instead. 0 disables.
+    void setRunAhead(int frames);
+    int getRunAhead() const { return run_ahead_.load(); }
+    
+    // Input movies. Recording captures the exact state (agnes and APU) at the
+    // next frame boundary, then the pads of every emulated frame. Replay
+    // restores a movie's state at the next frame boundary and feeds its pads
+    // instead of setInput()'s until it ends. Reset, rewind, state loads and
+    // ROM changes end either.
+    void startRecording();
+    // The movie recorded so far; false if nothing was
+    bool stopRecording(InputMovie& out);
+    // False if the movie is for another ROM or build
+    bool startReplay(const InputMovie& movie);
+    void stopReplay();
+    bool isRecording() const { return movie_mode_.load() == MovieMode::RECORDING; }
+    bool isReplaying() const { return movie_mode_.load() == MovieMode::REPLAYING; }
+    // Frames recorded or replayed so far
+    uint32_t movieFrame() const { return movie_frame_.load(std::memory_order_relaxed); }
+    uint32_t movieLength() const { return movie_length_.load(std::memory_order_relaxed); }
+    
+    // Rollback netplay over UDP (see Netplay.h). The local pad (setInput
+    // player 0) is player 1 on the host and player 2 on the guest. Once
+    // connected both restart the ROM from power-on and run every frame at
+    // once, predicting that the remote pad hasn't changed; when its real
+    // input turns out different, the snapshot before that frame is restored
+    // and the frames since are re-run without video or audio. Reset, rewind,
+    // state loads and movies are off meanwhile.
+    bool hostNetplay(uint16_t port);
+    bool joinNetplay(const char* address, uint16_t port);
+    void stopNetplay();
+    bool isNetplayActive() const { return netplay_active_.load(); }
+    Netplay::Status netplayStatus() const { return netplay_status_.load(); }
+    int netplayRoundTripMs() const { return netplay_rtt_ms_.load(std::memory_order_relaxed); }
+    // Frames re-run by the latest rollback
+    int netplayRollback() const { return netplay_rollback_.load(std::memory_order_relaxed); }
+    
+    // Turbo: run frames back to back as fast as the core allows, publishing a
+    // picture only about once per display frame and dropping the audio that
+    // would overflow the queue
+    void setTurbo(bool enabled) { turbo_.store(enabled); }
+    bool isTurbo() const { return turbo_.load(); }
+    float getEmulationFps() const { return emulation_fps_.load(std::memory_order_relaxed); }
+    
+    // Adaptive frame skip (on by default): on slow machines the emulation
+    // thread keeps emulating every frame with its audio but shows only the
+    // frames emulation and the UI have time for (see FrameSkip.h). The UI
+    // thread reports its cost per frame with reportRenderCost().
+    void setFrameSkip(bool enabled) { frame_skip_.setEnabled(enabled); }
+    bool getFrameSkip() const { return frame_skip_.enabled(); }
+    float getFrameSkipRatio() const { return frame_skip_.skipRatio(); }
+    void reportRenderCost(double seconds) { frame_skip_.reportRenderCost(seconds); }
+    
+    // 6502 profiler for the game, fed by the emulation thread every frame
+    CpuProfiler& cpuProfiler() { return cpu_profiler_; }
 
 private:
     // Agnes (CPU/PPU/Mappers)
@@ -74,42 +332,214 @@ private:
     Blip_Buffer apu_buffer_;
     long sample_rate_ = 44100;
     bool has_vrc6_ = false;
+    std::atomic<int> mute_mask_{0};
+    int applied_mute_ = 0;  // the mask the oscillator outputs follow (guarded by mutex_)
     
     // APU timing
     uint64_t last_apu_cycle_ = 0;
     static constexpr double CPU_CLOCK_NTSC = 1789773.0;
     static constexpr int CYCLES_PER_FRAME = 29780;  // ~60fps NTSC
+    static constexpr double NTSC_FRAME_RATE = CPU_CLOCK_NTSC / 29780.5;  // 60.0988 Hz
+    static constexpr double MAX_RATE_ADJUST = 0.005;
+    static constexpr double MAX_PACE_ADJUST = 0.02;
+    static constexpr int REWIND_INTERVAL = 1;
+    static constexpr int MAX_RUN_AHEAD = 3;
+    static constexpr size_t REWIND_BUDGET = 64u << 20;
+    static constexpr size_t SUSPEND_BUDGET = 64u << 20;
     
     // Screen texture (new sokol API uses image + view + sampler)
-    sg_image screen_texture_;
-    sg_view screen_view_;
+#ifndef NES_HEADLESS
+    // CPU fallback uploads into the next of SCREEN_IMAGES stream images each
+    // frame, so an update never waits on the image the GPU is still drawing
+    static constexpr int SCREEN_IMAGES = 3;
+    sg_image screen_textures_[SCREEN_IMAGES];
+    sg_view screen_views_[SCREEN_IMAGES];
+    int screen_current_ = 0;
+    sg_view screen_view_ = {};              // what drawScreen shows
     sg_sampler screen_sampler_;
+    PaletteRenderer palette_renderer_;      // GPU palette path; screen_textures_ are the CPU fallback
+    PostProcessor post_;                    // filters screen_view_ when a chain is set
+    bool post_dirty_ = false;               // chain changed since it last ran
+#endif
     uint32_t screen_pixels_[AGNES_SCREEN_WIDTH * AGNES_SCREEN_HEIGHT];
+    alignas(16) uint32_t palette_rgba_[64];  // active palette swizzled to RGBA8 byte order
     bool texture_created_ = false;
     
+    // Finished frames (palette indices), emulation thread -> renderer
+    struct ScreenFrame {
+        uint8_t indices[AGNES_SCREEN_WIDTH * AGNES_SCREEN_HEIGHT];
+        double seconds;                     // emulated time at its end
+        bool traced;                        // shows the press input_trace_ follows
+    };
+    TripleBuffer<ScreenFrame> frames_;
+    PresentScheduler present_;              // main thread
+    
+    // Audio queue, emulation thread -> audio callback. Each frame apu_buffer_ is
+    // drained into audio_ring_ under mutex_; the callback reads without locking.
+    // Dropping samples moves audio_flush_pos_ and the callback discards up to it.
+    static constexpr int AUDIO_RING_SAMPLES = 16384;
+    BasicAudioRing<short> audio_ring_;
+    std::atomic<uint64_t> audio_flush_pos_{0};
+    std::vector<short> audio_scratch_;
+    
+    // Channel state at the end of each APU frame, emulation thread -> visualizers
+    ApuSnapshotQueue apu_snapshots_;
+    ApuWriteLog apu_writes_;
+    bool log_apu_writes_ = true;    // off while netplay re-runs frames (guarded by mutex_)
+    
+    // Emulation thread
+    std::thread emu_thread_;
+    std::atomic<bool> thread_running_{false};
+    bool audio_master_ = true;
+    std::atomic<int> audio_queue_target_{4096};
+    std::atomic<uint64_t> cpu_cycles_{0};  // published after each frame
+    std::atomic<bool> dynamic_rate_{true};
+    std::atomic<float> rate_adjust_{0.0f};  // current clock ratio - 1
+    double queue_fill_avg_ = 0.0;           // emulation thread only
+    FrameSkip frame_skip_;
+    
+    CpuProfiler cpu_profiler_;  // counts into agnes_ (guarded by mutex_)
+    std::vector<RamFreeze> ram_freezes_;  // guarded by mutex_
+    
+    // Debugger (guarded by mutex_), allocated the first time it is attached.
+    // A stop before the end of a frame leaves debug_frame_open_ set, and the
+    // next emulateFrame() finishes that frame instead of starting one.
+    std::unique_ptr<agnes_debugger_t> debugger_;
+    std::atomic<bool> debugger_attached_{false};
+    std::atomic<bool> debug_broken_{false};
+    bool debug_frame_open_ = false;
+    bool debug_frame_step_ = false;
+    
+    // Rewind history (guarded by mutex_)
+    RewindBuffer rewind_;
+    std::vector<uint8_t> rewind_scratch_;
+    int rewind_counter_ = 0;
+    std::atomic<bool> rewind_enabled_{false};
+    std::atomic<bool> rewinding_{false};
+    std::atomic<float> rewind_seconds_{0.0f};
+    
+    // Run-ahead instance (guarded by mutex_)
+    agnes_t* ahead_ = nullptr;
+    std::vector<uint8_t> ahead_state_;
+    std::atomic<int> run_ahead_{0};
+    std::atomic<bool> turbo_{false};
+    std::atomic<float> emulation_fps_{0.0f};
+    const void* loaded_data_ = nullptr;  // ROM image agnes refers to
+    const uint8_t* const* cpu_read_pages_ = nullptr;  // agnes_' page table (DMC fetches)
+    size_t loaded_size_ = 0;
+    
     // State
     std::atomic<bool> running_{false};
-    bool rom_loaded_ = false;
+    std::atomic<bool> rom_loaded_{false};
     std::string rom_path_;
-    std::vector<uint8_t> rom_data_;
+    std::unique_ptr<MappedFile> rom_file_;  // backing store of a ROM opened by loadROM
+    RomCache suspended_{SUSPEND_BUDGET};
+    
+    // saveStateAsync()/loadStateAsync() requests for the emulation thread
+    std::mutex state_request_mutex_;
+    std::function<void(std::vector<uint8_t>)> pending_save_;
+    std::vector<uint8_t> pending_load_;
+    std::atomic<bool> state_requested_{false};
+    std::vector<uint8_t> power_on_state_;  // agnes state right after load, for reset()
+    size_t snapshot_size_ = 0;  // dumpSnapshot() size for the loaded ROM
+    
+    // saveState() prefix; the snapshot is raw struct memory, so states only
+    // load into the same build and ROM
+    struct StateHeader {
+        char magic[4];  // "FCST"
+        uint32_t version;
+        uint64_t rom_hash;
+        uint32_t size;  // snapshot bytes that follow
+        uint32_t reserved;
+    };
+    static constexpr uint32_t STATE_VERSION = 1;
     
-    // Input
-    agnes_input_t input_[2] = {};
+    // Input: both pads packed as in InputMovie, written by setInput(). While
+    // late_input_ is set the first strobe of the frame re-reads them;
+    // frame_input_ is what the running frame got (guarded by mutex_).
+    std::atomic<uint16_t> input_{0};
+    std::atomic<bool> late_latching_{true};
+    bool late_input_ = false;
+    uint16_t frame_input_ = 0;
+    InputLatencyTrace input_trace_;
+    
+    // Input movie (guarded by mutex_); the *_PENDING modes start at the next frame
+    enum class MovieMode { NONE, RECORD_PENDING, RECORDING, REPLAY_PENDING, REPLAYING };
+    std::atomic<MovieMode> movie_mode_{MovieMode::NONE};
+    InputMovie recording_;
+    InputMovie replay_;
+    InputMovie::Cursor replay_cursor_;
+    std::atomic<uint32_t> movie_frame_{0};
+    std::atomic<uint32_t> movie_length_{0};
+    uint64_t rom_hash_ = 0;
+    
+    // Netplay (guarded by mutex_). Slot f % NETPLAY_SLOTS holds the snapshot
+    // from before frame f, the local pad it ran with and the remote pad it
+    // assumed.
+    static constexpr int NETPLAY_SLOTS = Netplay::MAX_ROLLBACK + 1;
+    std::unique_ptr<Netplay> netplay_;
+    bool netplay_started_ = false;
+    uint32_t netplay_frame_ = 0;     // next frame to run
+    uint32_t netplay_verified_ = 0;  // frames before this ran with the real remote pad
+    std::vector<uint8_t> netplay_states_;
+    uint8_t netplay_local_[NETPLAY_SLOTS] = {};
+    uint8_t netplay_remote_[NETPLAY_SLOTS] = {};
+    std::atomic<bool> netplay_active_{false};
+    std::atomic<Netplay::Status> netplay_status_{Netplay::Status::IDLE};
+    std::atomic<int> netplay_rtt_ms_{0};
+    std::atomic<int> netplay_rollback_{0};
     
     // Thread safety
-    std::mutex mutex_;
+    mutable std::mutex mutex_;
     
     // APU callback functions (static, called by agnes)
     static void apuWriteCallback(void* user_data, uint16_t addr, uint8_t val, uint64_t cpu_cycle);
     static uint8_t apuReadCallback(void* user_data, uint16_t addr, uint64_t cpu_cycle);
+    static void inputPollCallback(void* user_data);
     static int apuDmcReadCallback(void* user_data, unsigned addr);
     
+    // Direct read through agnes' page table (pages the debugger unmapped
+    // through agnes_cpu_peek), no locking: only called from apu_ on the
+    // emulation thread, which already holds mutex_
+    uint8_t readCpuPage(unsigned addr) const {
+        const uint8_t* page = cpu_read_pages_[(addr >> 8) & 0xff];
+        return page ? page[addr & 0xff] : agnes_cpu_peek(agnes_, static_cast<uint16_t>(addr));
+    }
+    
     // Internal helpers
     void initApu();
+    void applyMuteMask();
     void syncApu(uint64_t cpu_cycle);
-    void endApuFrame();
+    void endApuFrame(bool output = true);
+    void flushAudio();
+    void emulationThreadFunc();
+    bool emulateFrame(bool present);
+    bool runThreadFrame(double behind);
+    bool netplayFrame(bool present);
+    void netplayStep(uint32_t frame, bool output);
+    void dropExcessAudio(long keep);
+    void updateRateControl();
+    void rewindFrame();
+    void applyRamFreezes();
+    bool nextFrame();
+    void publishScreen();
+    void publishScreen(const agnes_t* source);
+    void runAheadFrames(int frames);
     void createScreenTexture();
     void destroyScreenTexture();
+    void buildPaletteLut(const uint32_t* argb);
+    void captureMovieStart(InputMovie::StartState& out);
+    void restoreMovieStart(const InputMovie::StartState& start);
+    void writeState(std::vector<uint8_t>& out_state);
+    void serviceStateRequests();
+    RomCache::Entry suspendCurrent();
+    void resumeSuspended(const RomCache::Entry& entry);
+    void dumpSnapshot(uint8_t* out);
+    void restoreSnapshot(const uint8_t* in, bool keep_output = false);
+    void movieInput(agnes_input_t pads[2]);
+    void recordMovieFrame();
+    void endMovie();
+    void convertScreen(const uint8_t* indices, uint32_t* out) const;
     
     // NES color palette (NTSC)
     static const uint32_t nes_palette_[64];
@@ -0,0 +1,305 @@
+#include "Netplay.h"
+#include <algorithm>
+#include <cstring>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <cerrno>
+#endif
+
+// Packet: "FCNP", type, then
+//   HELLO / WELCOME: version u8, rom hash u64
+//   INPUT: send time u32, echoed peer time u32, ack u32 (remote frames we
+//          have), first frame u32, count u8, count pads
+// Multi-byte fields are little-endian.
+namespace {
+
+constexpr uint8_t PROTOCOL_VERSION = 1;
+constexpr uint8_t PACKET_INPUT = 1;
+constexpr uint8_t PACKET_HELLO = 2;
+constexpr uint8_t PACKET_WELCOME = 3;
+constexpr uint8_t PACKET_BYE = 4;
+constexpr int HEADER_SIZE = 5;
+constexpr int INPUT_FIXED_SIZE = HEADER_SIZE + 17;
+constexpr int MAX_PACKET = 512;
+
+void put32(uint8_t* out, uint32_t v) {
+    for (int i = 0; i < 4; ++i) out[i] = static_cast<uint8_t>(v >> (8 * i));
+}
+
+uint32_t get32(const uint8_t* in) {
+    return in[0] | in[1] << 8 | in[2] << 16 | static_cast<uint32_t>(in[3]) << 24;
+}
+
+void put64(uint8_t* out, uint64_t v) {
+    put32(out, static_cast<uint32_t>(v));
+    put32(out + 4, static_cast<uint32_t>(v >> 32));
+}
+
+uint64_t get64(const uint8_t* in) {
+    return get32(in) | static_cast<uint64_t>(get32(in + 4)) << 32;
+}
+
+int writeHeader(uint8_t* out, uint8_t type) {
+    memcpy(out, "FCNP", 4);
+    out[4] = type;
+    return HEADER_SIZE;
+}
+
+#ifdef _WIN32
+using socket_t = SOCKET;
+constexpr intptr_t NO_SOCKET = static_cast<intptr_t>(INVALID_SOCKET);
+void closeSocket(socket_t s) { closesocket(s); }
+bool wouldBlock() { return WSAGetLastError() == WSAEWOULDBLOCK; }
+#else
+using socket_t = int;
+constexpr intptr_t NO_SOCKET = -1;
+void closeSocket(socket_t s) { ::close(s); }
+bool wouldBlock() { return errno == EAGAIN || errno == EWOULDBLOCK; }
+#endif
+
+}  // namespace
+
+Netplay::~Netplay() {
+    close();
+}
+
+bool Netplay::openSocket(uint16_t port) {
+    close();
+#ifdef _WIN32
+    WSADATA wsa;
+    if (WSAStartup(MAKEWORD(2, 2), &wsa) != 0) return false;
+#endif
+    socket_t s = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (static_cast<intptr_t>(s) == NO_SOCKET) {
+#ifdef _WIN32
+        WSACleanup();
+#endif
+        return false;
+    }
+    socket_ = static_cast<intptr_t>(s);
+
+#ifdef _WIN32
+    u_long non_blocking = 1;
+    bool ok = ioctlsocket(s, FIONBIO, &non_blocking) == 0;
+#else
+    bool ok = fcntl(s, F_SETFL, fcntl(s, F_GETFL, 0) | O_NONBLOCK) == 0;
+#endif
+    sockaddr_in local = {};
+    local.sin_family = AF_INET;
+    local.sin_addr.s_addr = htonl(INADDR_ANY);
+    local.sin_port = htons(port);
+    if (!ok || bind(s, reinterpret_cast<sockaddr*>(&local), sizeof(local)) != 0) {
+        close();
+        return false;
+    }
+
+    local_frames_ = local_acked_ = remote_frames_ = 0;
+    memset(remote_, 0, sizeof(remote_));
+    peer_time_ = 0;
+    rtt_ms_ = 0;
+    last_heard_ = std::chrono::steady_clock::now();
+    return true;
+}
+
+bool Netplay::host(uint16_t port, uint64_t rom_hash) {
+    if (!openSocket(port)) {
+        status_ = Status::FAILED;
+        return false;
+    }
+    is_host_ = true;
+    rom_hash_ = rom_hash;
+    peer_addr_ = 0;
+    peer_port_ = 0;
+    status_ = Status::WAITING;
+    return true;
+}
+
+bool Netplay::join(const char* address, uint16_t port, uint64_t rom_hash) {
+    addrinfo hints = {};
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_DGRAM;
+    addrinfo* found = nullptr;
+    // Resolving needs Winsock up, so the socket comes first
+    if (!openSocket(0) || getaddrinfo(address, nullptr, &hints, &found) != 0 || !found) {
+        close();
+        status_ = Status::FAILED;
+        return false;
+    }
+    peer_addr_ = ntohl(reinterpret_cast<sockaddr_in*>(found->ai_addr)->sin_addr.s_addr);
+    peer_port_ = port;
+    freeaddrinfo(found);
+
+    is_host_ = false;
+    rom_hash_ = rom_hash;
+    status_ = Status::WAITING;
+    sendHello(PACKET_HELLO, peer_addr_, peer_port_);
+    return true;
+}
+
+void Netplay::close() {
+    if (socket_ == NO_SOCKET) return;
+    if (status_ == Status::CONNECTED) {
+        uint8_t packet[HEADER_SIZE];
+        sendPacket(packet, writeHeader(packet, PACKET_BYE), peer_addr_, peer_port_);
+    }
+    closeSocket(static_cast<socket_t>(socket_));
+    socket_ = NO_SOCKET;
+#ifdef _WIN32
+    WSACleanup();
+#endif
+    if (status_ == Status::WAITING || status_ == Status::CONNECTED) status_ = Status::IDLE;
+}
+
+uint32_t Netplay::nowMs() const {
+    return static_cast<uint32_t>(
+        std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - epoch_).count());
+}
+
+void Netplay::sendPacket(const uint8_t* data, int size, uint32_t addr, uint16_t port) {
+    if (socket_ == NO_SOCKET || port == 0) return;
+    sockaddr_in to = {};
+    to.sin_family = AF_INET;
+    to.sin_addr.s_addr = htonl(addr);
+    to.sin_port = htons(port);
+    // Best effort: a dropped datagram is covered by the next one
+    sendto(static_cast<socket_t>(socket_), reinterpret_cast<const char*>(data), size, 0,
+           reinterpret_cast<const sockaddr*>(&to), sizeof(to));
+}
+
+void Netplay::sendHello(uint8_t type, uint32_t addr, uint16_t port) {
+    uint8_t packet[HEADER_SIZE + 9];
+    int size = writeHeader(packet, type);
+    packet[size++] = PROTOCOL_VERSION;
+    put64(packet + size, rom_hash_);
+    sendPacket(packet, size + 8, addr, port);
+    last_hello_ = std::chrono::steady_clock::now();
+}
+
+void Netplay::sendInputs() {
+    uint32_t count = local_frames_ - local_acked_;
+    if (count > static_cast<uint32_t>(HISTORY)) {
+        status_ = Status::FAILED;  // the peer needs inputs we no longer have
+        return;
+    }
+    uint8_t packet[MAX_PACKET];
+    int size = writeHeader(packet, PACKET_INPUT);
+    put32(packet + size, nowMs());
+    put32(packet + size + 4, peer_time_);
+    put32(packet + size + 8, remote_frames_);
+    put32(packet + size + 12, local_acked_);
+    packet[size + 16] = static_cast<uint8_t>(count);
+    size = INPUT_FIXED_SIZE;
+    for (uint32_t f = local_acked_; f < local_frames_; ++f) {
+        packet[size++] = local_[f & (HISTORY - 1)];
+    }
+    sendPacket(packet, size, peer_addr_, peer_port_);
+    last_sent_ = std::chrono::steady_clock::now();
+}
+
+void Netplay::sendInput(uint32_t frame, uint8_t buttons) {
+    if (status_ != Status::CONNECTED || frame != local_frames_) return;
+    local_[frame & (HISTORY - 1)] = buttons;
+    local_frames_ = frame + 1;
+    sendInputs();
+}
+
+void Netplay::poll() {
+    if (socket_ == NO_SOCKET) return;
+
+    uint8_t packet[MAX_PACKET];
+    while (true) {
+        sockaddr_in from = {};
+        socklen_t from_size = sizeof(from);
+        int size = static_cast<int>(recvfrom(static_cast<socket_t>(socket_), reinterpret_cast<char*>(packet),
+                                             sizeof(packet), 0, reinterpret_cast<sockaddr*>(&from), &from_size));
+        if (size < 0) {
+            if (wouldBlock()) break;
+#ifdef _WIN32
+            if (WSAGetLastError() == WSAECONNRESET) continue;  // ICMP unreachable from an earlier send
+#endif
+            status_ = Status::FAILED;
+            return;
+        }
+        receive(packet, size, ntohl(from.sin_addr.s_addr), ntohs(from.sin_port));
+    }
+
+    auto now = std::chrono::steady_clock::now();
+    if (status_ == Status::WAITING && !is_host_ && now - last_hello_ >= HELLO_INTERVAL) {
+        sendHello(PACKET_HELLO, peer_addr_, peer_port_);
+    }
+    if (status_ == Status::CONNECTED) {
+        if (now - last_heard_ >= PEER_TIMEOUT) {
+            status_ = Status::PEER_LOST;
+        } else if (now - last_sent_ >= RESEND_INTERVAL) {
+            // Keep inputs and acks flowing while stalled waiting for the peer
+            sendInputs();
+        }
+    }
+}
+
+void Netplay::receive(const uint8_t* data, int size, uint32_t addr, uint16_t port) {
+    if (size < HEADER_SIZE || memcmp(data, "FCNP", 4) != 0) return;
+    uint8_t type = data[4];
+    bool from_peer = addr == peer_addr_ && port == peer_port_;
+
+    if (type == PACKET_HELLO && is_host_) {
+        if (size < HEADER_SIZE + 9 || data[HEADER_SIZE] != PROTOCOL_VERSION) return;
+        if (status_ == Status::WAITING && get64(data + HEADER_SIZE + 1) == rom_hash_) {
+            peer_addr_ = addr;
+            peer_port_ = port;
+            status_ = Status::CONNECTED;
+            last_heard_ = std::chrono::steady_clock::now();
+        }
+        // Repeats a welcome that got lost; a guest with another ROM (or one
+        // arriving while we're taken) learns from our hash that it can't join
+        sendHello(PACKET_WELCOME, addr, port);
+        return;
+    }
+    if (!from_peer) return;
+    last_heard_ = std::chrono::steady_clock::now();
+
+    switch (type) {
+        case PACKET_WELCOME:
+            if (is_host_ || status_ != Status::WAITING || size < HEADER_SIZE + 9) return;
+            status_ = (data[HEADER_SIZE] == PROTOCOL_VERSION && get64(data + HEADER_SIZE + 1) == rom_hash_)
+                          ? Status::CONNECTED : Status::FAILED;
+            break;
+        case PACKET_BYE:
+            if (status_ == Status::CONNECTED) status_ = Status::PEER_LOST;
+            break;
+        case PACKET_INPUT: {
+            if (status_ != Status::CONNECTED || size < INPUT_FIXED_SIZE) return;
+            const uint8_t* p = data + HEADER_SIZE;
+            uint32_t sent = get32(p);
+            uint32_t echo = get32(p + 4);
+            uint32_t ack = get32(p + 8);
+            uint32_t first = get32(p + 12);
+            int count = std::min<int>(p[16], size - INPUT_FIXED_SIZE);
+
+            if (sent - peer_time_ < 0x80000000u) peer_time_ = sent;
+            if (echo != 0) {
+                int sample = static_cast<int>(nowMs() - echo);
+                rtt_ms_ = rtt_ms_ ? (rtt_ms_ * 7 + sample) / 8 : sample;
+            }
+            if (ack > local_acked_ && ack <= local_frames_) local_acked_ = ack;
+            for (int i = 0; i < count; ++i) {
+                // Only the next frame we lack is taken; anything older is a repeat
+                if (first + i == remote_frames_) {
+                    remote_[remote_frames_ & (HISTORY - 1)] = data[INPUT_FIXED_SIZE + i];
+                    remote_frames_++;
+                }
+            }
+            break;
+        }
+    }
+}
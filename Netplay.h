@@ -0,0 +1,83 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+
+// Two-player input exchange over UDP (IPv4) for rollback netplay. The host
+// binds a port and waits; the guest sends hellos with its ROM hash until the
+// host answers. From then on both send their pad for every frame, starting at
+// frame 0: each packet repeats every input the peer hasn't acknowledged yet,
+// so a lost packet costs latency but never a gap. Nothing here knows the
+// emulator; NesEmulator predicts the remote pad and rolls back when it's wrong.
+class Netplay {
+public:
+    enum class Status {
+        IDLE,
+        WAITING,    // host: for a guest; guest: for the host's answer
+        CONNECTED,
+        PEER_LOST,  // nothing heard for PEER_TIMEOUT
+        FAILED,     // socket error or ROM mismatch
+    };
+
+    static constexpr uint16_t DEFAULT_PORT = 7845;
+    // How many frames a peer may run ahead of the last input it has from the
+    // other one; also the deepest rollback
+    static constexpr int MAX_ROLLBACK = 8;
+
+    Netplay() = default;
+    ~Netplay();
+    Netplay(const Netplay&) = delete;
+    Netplay& operator=(const Netplay&) = delete;
+
+    bool host(uint16_t port, uint64_t rom_hash);
+    bool join(const char* address, uint16_t port, uint64_t rom_hash);
+    void close();
+
+    // Receive whatever arrived and resend what is due; call once per frame
+    void poll();
+
+    Status status() const { return status_; }
+    // Host plays player 1 (0), guest player 2 (1)
+    int localPlayer() const { return is_host_ ? 0 : 1; }
+    int roundTripMs() const { return rtt_ms_; }
+
+    // Local pad of 'frame'; frames go out in order from 0
+    void sendInput(uint32_t frame, uint8_t buttons);
+    // The remote pad is known for frames [0, remoteFrames()); remoteInput()
+    // serves the last HISTORY of them
+    uint32_t remoteFrames() const { return remote_frames_; }
+    uint8_t remoteInput(uint32_t frame) const { return remote_[frame & (HISTORY - 1)]; }
+
+private:
+    static constexpr int HISTORY = 64;  // power of two, well over MAX_ROLLBACK
+    static constexpr auto HELLO_INTERVAL = std::chrono::milliseconds(250);
+    static constexpr auto RESEND_INTERVAL = std::chrono::milliseconds(16);
+    static constexpr auto PEER_TIMEOUT = std::chrono::seconds(5);
+
+    bool openSocket(uint16_t port);
+    void sendHello(uint8_t type, uint32_t addr, uint16_t port);
+    void sendInputs();
+    void receive(const uint8_t* data, int size, uint32_t addr, uint16_t port);
+    void sendPacket(const uint8_t* data, int size, uint32_t addr, uint16_t port);
+    uint32_t nowMs() const;
+
+    intptr_t socket_ = -1;
+    bool is_host_ = false;
+    Status status_ = Status::IDLE;
+    uint64_t rom_hash_ = 0;
+    uint32_t peer_addr_ = 0;  // IPv4, host byte order
+    uint16_t peer_port_ = 0;
+
+    uint8_t local_[HISTORY] = {};
+    uint8_t remote_[HISTORY] = {};
+    uint32_t local_frames_ = 0;   // frames of local input sent so far
+    uint32_t local_acked_ = 0;    // of those, the peer has [0, local_acked_)
+    uint32_t remote_frames_ = 0;
+
+    std::chrono::steady_clock::time_point epoch_ = std::chrono::steady_clock::now();
+    std::chrono::steady_clock::time_point last_hello_;
+    std::chrono::steady_clock::time_point last_sent_;
+    std::chrono::steady_clock::time_point last_heard_;
+    uint32_t peer_time_ = 0;      // send time of the peer's newest packet, echoed back
+    int rtt_ms_ = 0;
+};
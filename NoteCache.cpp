@@ -0,0 +1,257 @@
+#include "NoteCache.h"
+#include "MappedFile.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <system_error>
+
+uint64_t NoteCache::hashData(const void* data, size_t size) {
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    uint64_t hash = 0xcbf29ce484222325ull;
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= bytes[i];
+        hash *= 0x100000001b3ull;
+    }
+    return hash;
+}
+
+const std::string& NoteCache::cacheDirectory() {
+    static const std::string dir = []() -> std::string {
+        namespace fs = std::filesystem;
+        fs::path base;
+#if defined(_WIN32)
+        if (const char* local = std::getenv("LOCALAPPDATA")) base = local;
+#elif defined(__APPLE__)
+        if (const char* home = std::getenv("HOME")) base = fs::path(home) / "Library" / "Caches";
+#else
+        if (const char* xdg = std::getenv("XDG_CACHE_HOME")) base = xdg;
+        else if (const char* home = std::getenv("HOME")) base = fs::path(home) / ".cache";
+#endif
+        if (base.empty()) return std::string();
+
+        fs::path path = base / "imgui_fc_visualizer" / "notes";
+        std::error_code ec;
+        fs::create_directories(path, ec);
+        if (ec) return std::string();
+        return path.string();
+    }();
+    return dir;
+}
+
+std::string NoteCache::entryPath(const Key& key, const char* extension) {
+    const std::string& dir = cacheDirectory();
+    if (dir.empty()) return std::string();
+
+    char name[64];
+    snprintf(name, sizeof(name), "%016llx_t%d_r%ld.%s",
+             static_cast<unsigned long long>(key.content_hash), key.track, key.sample_rate, extension);
+    return (std::filesystem::path(dir) / name).string();
+}
+
+bool NoteCache::openEntry(const Key& key, MappedFile& file, FileHeader& header) {
+    std::string path = entryPath(key);
+    if (path.empty() || !file.open(path.c_str())) return false;
+
+    bool stale = file.size() < sizeof(header);
+    if (!stale) {
+        memcpy(&header, file.data(), sizeof(header));
+        size_t expected = sizeof(header) + static_cast<size_t>(header.note_count) * sizeof(PianoRollNote) +
+                          header.envelope_size;
+        stale = memcmp(header.magic, "FCNC", 4) != 0 ||
+                header.version != VERSION ||
+                header.note_size != sizeof(PianoRollNote) ||
+                header.content_hash != key.content_hash ||
+                header.track != key.track ||
+                header.sample_rate != key.sample_rate ||
+                file.size() != expected ||
+                (header.envelope_size > 0 && file.data()[file.size() - 1] != 0);  // envelopes end in 0
+    }
+    if (!stale) return true;
+
+    // Written by an older build (or truncated) - drop it
+    file.close();
+    std::error_code ec;
+    std::filesystem::remove(path, ec);
+    return false;
+}
+
+bool NoteCache::load(const Key& key, NoteTimeline& timeline, float& duration) {
+    MappedFile file;
+    FileHeader header;
+    if (!openEntry(key, file, header)) return false;
+
+    // Entries are written channel by channel in start order (toNotes()), so
+    // the notes append straight from the mapping, envelopes and all
+    const uint8_t* body = file.data() + sizeof(header);
+    const uint8_t* envelopes = body + header.note_count * sizeof(PianoRollNote);
+    size_t envelope_size = header.envelope_size;
+    timeline.clear();
+    for (uint32_t i = 0; i < header.note_count; ++i) {
+        PianoRollNote note;
+        memcpy(&note, body + i * sizeof(PianoRollNote), sizeof(note));
+        timeline.append(note, note.envelope < envelope_size ? envelopes + note.envelope : nullptr);
+    }
+    timeline.setLoop(NoteLoop{header.loop_start, header.loop_length});
+    duration = header.duration;
+    return true;
+}
+
+bool NoteCache::store(const Key& key, const std::vector<PianoRollNote>& notes,
+                      const std::vector<uint8_t>& envelopes, float duration, NoteLoop loop) {
+    std::string path = entryPath(key);
+    if (path.empty()) return false;
+
+    FileHeader header;
+    memcpy(header.magic, "FCNC", 4);
+    header.version = VERSION;
+    header.note_size = sizeof(PianoRollNote);
+    header.note_count = static_cast<uint32_t>(notes.size());
+    header.content_hash = key.content_hash;
+    header.track = key.track;
+    header.sample_rate = static_cast<int32_t>(key.sample_rate);
+    header.duration = duration;
+    header.loop_start = loop.start;
+    header.loop_length = loop.length;
+    header.envelope_size = static_cast<uint32_t>(envelopes.size());
+    header.flags = 0;
+
+    return writeEntry(path, &header, sizeof(header), notes.data(), notes.size() * sizeof(PianoRollNote),
+                      envelopes.data(), envelopes.size());
+}
+
+bool NoteCache::loadPeaks(const Key& key, WaveformPeaks& peaks) {
+    std::string path = entryPath(key, "peaks");
+    if (path.empty()) return false;
+
+    bool stale = false;
+    {
+        MappedFile file;
+        if (!file.open(path.c_str())) return false;
+
+        PeakHeader header;
+        if (file.size() < sizeof(header)) {
+            stale = true;
+        } else {
+            memcpy(&header, file.data(), sizeof(header));
+            stale = memcmp(header.magic, "FCWP", 4) != 0 ||
+                    header.version != PEAK_VERSION ||
+                    header.block_seconds != WaveformPeaks::BLOCK_SECONDS ||
+                    header.content_hash != key.content_hash ||
+                    header.track != key.track ||
+                    header.sample_rate != key.sample_rate ||
+                    file.size() != sizeof(header) + header.block_count * sizeof(WaveformPeaks::Block);
+        }
+
+        if (!stale) {
+            std::vector<WaveformPeaks::Block> blocks(header.block_count);
+            if (header.block_count) {
+                memcpy(blocks.data(), file.data() + sizeof(header), header.block_count * sizeof(WaveformPeaks::Block));
+            }
+            peaks.assign(std::move(blocks));
+            return true;
+        }
+    }
+
+    std::error_code ec;
+    std::filesystem::remove(path, ec);
+    return false;
+}
+
+bool NoteCache::storePeaks(const Key& key, const WaveformPeaks& peaks) {
+    std::string path = entryPath(key, "peaks");
+    if (path.empty()) return false;
+
+    PeakHeader header;
+    memcpy(header.magic, "FCWP", 4);
+    header.version = PEAK_VERSION;
+    header.block_count = static_cast<uint32_t>(peaks.blocks().size());
+    header.block_seconds = WaveformPeaks::BLOCK_SECONDS;
+    header.content_hash = key.content_hash;
+    header.track = key.track;
+    header.sample_rate = static_cast<int32_t>(key.sample_rate);
+
+    return writeEntry(path, &header, sizeof(header), peaks.blocks().data(),
+                      peaks.blocks().size() * sizeof(WaveformPeaks::Block));
+}
+
+bool NoteCache::loadSpectrogram(const Key& key, TrackSpectrogram& spectrogram) {
+    std::string path = entryPath(key, "spectrum");
+    if (path.empty()) return false;
+
+    bool stale = false;
+    {
+        MappedFile file;
+        if (!file.open(path.c_str())) return false;
+
+        SpectrogramHeader header;
+        if (file.size() < sizeof(header)) {
+            stale = true;
+        } else {
+            memcpy(&header, file.data(), sizeof(header));
+            stale = memcmp(header.magic, "FCSG", 4) != 0 ||
+                    header.version != SPECTROGRAM_VERSION ||
+                    header.bins != TrackSpectrogram::BINS ||
+                    header.column_seconds != TrackSpectrogram::COLUMN_SECONDS ||
+                    header.fft_size != TrackSpectrogram::FFT_SIZE ||
+                    header.content_hash != key.content_hash ||
+                    header.track != key.track ||
+                    header.sample_rate != key.sample_rate ||
+                    file.size() != sizeof(header) + static_cast<size_t>(header.column_count) * header.bins;
+        }
+
+        if (!stale) {
+            spectrogram.assign(std::vector<uint8_t>(file.data() + sizeof(header), file.data() + file.size()));
+            return true;
+        }
+    }
+
+    std::error_code ec;
+    std::filesystem::remove(path, ec);
+    return false;
+}
+
+bool NoteCache::storeSpectrogram(const Key& key, const TrackSpectrogram& spectrogram) {
+    std::string path = entryPath(key, "spectrum");
+    if (path.empty()) return false;
+
+    SpectrogramHeader header;
+    memcpy(header.magic, "FCSG", 4);
+    header.version = SPECTROGRAM_VERSION;
+    header.column_count = static_cast<uint32_t>(spectrogram.columns());
+    header.bins = TrackSpectrogram::BINS;
+    header.column_seconds = TrackSpectrogram::COLUMN_SECONDS;
+    header.fft_size = TrackSpectrogram::FFT_SIZE;
+    header.content_hash = key.content_hash;
+    header.track = key.track;
+    header.sample_rate = static_cast<int32_t>(key.sample_rate);
+
+    return writeEntry(path, &header, sizeof(header), spectrogram.levels().data(), spectrogram.levels().size());
+}
+
+bool NoteCache::writeEntry(const std::string& path, const void* header, size_t header_size,
+                           const void* body, size_t body_size, const void* tail, size_t tail_size) {
+    // Write to a temp file and rename so a concurrent reader never sees a partial entry
+    std::string temp_path = path + ".tmp";
+    FILE* f = fopen(temp_path.c_str(), "wb");
+    if (!f) return false;
+
+    bool ok = fwrite(header, header_size, 1, f) == 1;
+    if (ok && body_size > 0) {
+        ok = fwrite(body, 1, body_size, f) == body_size;
+    }
+    if (ok && tail_size > 0) {
+        ok = fwrite(tail, 1, tail_size, f) == tail_size;
+    }
+    ok = (fclose(f) == 0) && ok;
+
+    std::error_code ec;
+    if (ok) {
+        std::filesystem::rename(temp_path, path, ec);
+        ok = !ec;
+    }
+    if (!ok) {
+        std::filesystem::remove(temp_path, ec);
+    }
+    return ok;
+}
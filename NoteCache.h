@@ -0,0 +1,93 @@
+#pragma once
+
+#include "PianoVisualizer.h"
+#include "WaveformPeaks.h"
+#include "TrackSpectrogram.h"
+#include <vector>
+#include <string>
+#include <cstdint>
+
+class MappedFile;
+
+// Persistent on-disk cache of preprocessed piano-roll notes, and of each
+// track's waveform peaks and spectrogram in files of their own beside them.
+// Entries are keyed by file content hash + track + sample rate and live under
+// the per-user cache directory. Files are memory-mapped on load, and a version
+// header lets stale entries be dropped when the note extraction changes.
+class NoteCache {
+public:
+    // Bump whenever note extraction or the PianoRollNote layout changes
+    static constexpr uint32_t VERSION = 5;
+
+    struct Key {
+        uint64_t content_hash = 0;
+        int track = 0;
+        long sample_rate = 0;
+    };
+
+    // 64-bit FNV-1a of the file contents
+    static uint64_t hashData(const void* data, size_t size);
+
+    // Per-user cache directory (created on demand), empty if unavailable
+    static const std::string& cacheDirectory();
+
+    // Returns true and fills the outputs on a cache hit: the notes packed
+    // straight from the mapped file into the timeline, loop and all
+    static bool load(const Key& key, NoteTimeline& timeline, float& duration);
+
+    // Write (or overwrite) an entry; failures are silently ignored
+    static bool store(const Key& key, const std::vector<PianoRollNote>& notes,
+                      const std::vector<uint8_t>& envelopes, float duration, NoteLoop loop);
+    
+    // The same for the track's waveform peaks
+    static bool loadPeaks(const Key& key, WaveformPeaks& peaks);
+    static bool storePeaks(const Key& key, const WaveformPeaks& peaks);
+    static bool loadSpectrogram(const Key& key, TrackSpectrogram& spectrogram);
+    static bool storeSpectrogram(const Key& key, const TrackSpectrogram& spectrogram);
+
+private:
+    struct FileHeader {
+        char magic[4];          // "FCNC"
+        uint32_t version;
+        uint32_t note_size;     // sizeof(PianoRollNote) when written
+        uint32_t note_count;
+        uint64_t content_hash;
+        int32_t track;
+        int32_t sample_rate;
+        float duration;
+        float loop_start;       // v3: repeating section, length 0 if none
+        float loop_length;
+        uint32_t envelope_size; // v5: bytes of note envelopes after the notes
+        uint32_t flags;         // Reserved, 0 (v1: bit 0 was has VRC6)
+    };
+
+    struct PeakHeader {
+        char magic[4];          // "FCWP"
+        uint32_t version;       // PEAK_VERSION
+        uint32_t block_count;
+        float block_seconds;
+        uint64_t content_hash;
+        int32_t track;
+        int32_t sample_rate;
+    };
+    static constexpr uint32_t PEAK_VERSION = 1;
+
+    struct SpectrogramHeader {
+        char magic[4];          // "FCSG"
+        uint32_t version;       // SPECTROGRAM_VERSION
+        uint32_t column_count;
+        uint32_t bins;
+        float column_seconds;
+        uint32_t fft_size;
+        uint64_t content_hash;
+        int32_t track;
+        int32_t sample_rate;
+    };
+    static constexpr uint32_t SPECTROGRAM_VERSION = 1;
+
+    static std::string entryPath(const Key& key, const char* extension = "notes");
+    // Map the notes entry and check its header; a stale entry is removed
+    static bool openEntry(const Key& key, MappedFile& file, FileHeader& header);
+    static bool writeEntry(const std::string& path, const void* header, size_t header_size,
+                           const void* body, size_t body_size, const void* tail = nullptr, size_t tail_size = 0);
+};
@@ -0,0 +1,79 @@
+#pragma once
+
+#include "NoteTimeline.h"
+#include "ChannelLayout.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+// How much each channel plays over a whole track, for the overview strip:
+// per channel, the milliseconds a note sounds in each time bucket, kept at
+// LEVELS resolutions where level k buckets are 2^k base buckets long. Notes
+// are added as preprocessing publishes them, touching each level's buckets
+// they overlap; a view that is 'columns' wide reads the coarsest level with
+// at least that many buckets, so drawing costs O(columns) however long the
+// track is.
+class NoteDensity {
+public:
+    static constexpr float BUCKET_SECONDS = 0.125f;    // level 0
+    static constexpr int LEVELS = 16;                  // level 15 buckets are ~68 minutes
+    static constexpr int CHANNELS = ChannelLayout::MAX_CHANNELS;
+
+    void clear() {
+        for (std::vector<uint32_t>& level : levels_) level.clear();
+        end_time_ = 0.0f;
+    }
+
+    bool empty() const { return levels_[0].empty(); }
+    float endTime() const { return end_time_; }    // latest note end added
+
+    void add(const PianoRollNote& note) {
+        if (note.channel < 0 || note.channel >= CHANNELS || note.end_time <= note.start_time) return;
+        end_time_ = std::max(end_time_, note.end_time);
+        for (int k = 0; k < LEVELS; ++k) {
+            double bucket = bucketSeconds(k);
+            int first = static_cast<int>(note.start_time / bucket);
+            int last = static_cast<int>(note.end_time / bucket);
+            std::vector<uint32_t>& level = levels_[k];
+            if (level.size() < static_cast<size_t>(last + 1) * CHANNELS) {
+                level.resize(static_cast<size_t>(last + 1) * CHANNELS, 0);
+            }
+            for (int b = first; b <= last; ++b) {
+                double begin = std::max<double>(note.start_time, b * bucket);
+                double end = std::min<double>(note.end_time, (b + 1) * bucket);
+                if (end > begin) level[static_cast<size_t>(b) * CHANNELS + note.channel] += msec(end - begin);
+            }
+        }
+    }
+
+    static double bucketSeconds(int level) { return BUCKET_SECONDS * static_cast<double>(1u << level); }
+    int bucketCount(int level) const { return static_cast<int>(levels_[level].size() / CHANNELS); }
+
+    // Coarsest level that still has a bucket per column over 'seconds'
+    static int levelFor(float seconds, int columns) {
+        int level = 0;
+        while (level + 1 < LEVELS && seconds / bucketSeconds(level + 1) >= columns) ++level;
+        return level;
+    }
+
+    // Fraction of [begin, end) the channel sounds, from the level's buckets
+    // overlapping it (whole buckets, so a range narrower than one reads the
+    // bucket's average)
+    float occupancy(int level, int channel, float begin, float end) const {
+        const std::vector<uint32_t>& counts = levels_[level];
+        double bucket = bucketSeconds(level);
+        int first = std::max(0, static_cast<int>(begin / bucket));
+        int last = std::min(bucketCount(level), static_cast<int>(std::ceil(end / bucket)));
+        if (last <= first) return 0.0f;
+        uint64_t total = 0;
+        for (int b = first; b < last; ++b) total += counts[static_cast<size_t>(b) * CHANNELS + channel];
+        return std::min(1.0f, static_cast<float>(static_cast<double>(total) / ((last - first) * msec(bucket))));
+    }
+
+private:
+    static uint32_t msec(double seconds) { return static_cast<uint32_t>(std::lround(seconds * 1000.0)); }
+
+    std::vector<uint32_t> levels_[LEVELS];     // bucket-major: [bucket * CHANNELS + channel]
+    float end_time_ = 0.0f;
+};
@@ -0,0 +1,71 @@
+#include "NoteLookahead.h"
+#include "NesEmulator.h"
+
+static constexpr double CPU_CLOCK_NTSC = 1789773.0;
+static constexpr double FRAME_RATE = CPU_CLOCK_NTSC / 29780.5;
+
+NoteLookahead::~NoteLookahead() {
+    cancel();
+}
+
+void NoteLookahead::cancel() {
+    if (!job_) return;
+    job_->cancel();
+    job_->wait();
+    job_.reset();
+}
+
+bool NoteLookahead::loadROM(const char* path) {
+    cancel();
+    clear();
+    loaded_ = batch_.loadROM(path) && batch_.create(1, NesBatch::CAPTURE_APU);
+    return loaded_;
+}
+
+bool NoteLookahead::loadROMData(const void* data, size_t size) {
+    cancel();
+    clear();
+    loaded_ = batch_.loadROMData(data, size) && batch_.create(1, NesBatch::CAPTURE_APU);
+    return loaded_;
+}
+
+void NoteLookahead::clear() {
+    frames_.clear();
+    start_time_ = -1.0;
+}
+
+bool NoteLookahead::update(NesEmulator& emu, JobSystem& jobs) {
+    bool changed = false;
+    double now = emu.getCpuCycles() / CPU_CLOCK_NTSC;
+    
+    if (job_ && job_->isDone()) {
+        job_.reset();
+        frames_.swap(job_frames_);
+        held_pads_ = job_pads_;
+        start_time_ = job_time_;
+        changed = true;
+    }
+    
+    // A prediction holds while the pads do and play is inside it
+    bool holds = start_time_ >= 0.0 && emu.liveInput() == held_pads_ &&
+                 now >= start_time_ && now < start_time_ + FRAMES / FRAME_RATE;
+    if (start_time_ >= 0.0 && !holds) {
+        changed = changed || !frames_.empty();
+        clear();
+    }
+    
+    // Next run: from the newest frame, with the pads the game gets next
+    bool due = start_time_ < 0.0 || now >= start_time_ + REFRESH_SECONDS;
+    if (!loaded_ || job_ || !due || !emu.captureFrameState(start_)) return changed;
+    job_pads_ = emu.liveInput();
+    job_time_ = now;
+    job_ = jobs.submit([this, &jobs](const Job& job) {
+        job_frames_.clear();
+        if (job.isCancelled() || !batch_.restore(0, start_)) return;
+        batch_.input(0)[0] = InputMovie::unpack(job_pads_, 0);
+        batch_.input(1)[0] = InputMovie::unpack(job_pads_, 1);
+        batch_.step(jobs, FRAMES);
+        job_frames_ = batch_.apuFrames(0);
+    }, JobPriority::INTERACTIVE, "Note look-ahead");
+    return changed;
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include "NesBatch.h"
+#include "ApuSnapshot.h"
+#include "InputMovie.h"
+#include "JobSystem.h"
+
+#include <cstdint>
+#include <vector>
+
+class NesEmulator;
+
+// Predicted sound of the running game a few seconds ahead, for the piano
+// roll to show notes before they are played. Every REFRESH_SECONDS of play
+// the emulator's exact state is copied into a headless NesBatch session,
+// which a job runs FRAMES frames on with the pads held as they were,
+// recording the APU state of every frame. A prediction is dropped, and a
+// new one started, as soon as the live pads stop matching the ones it held
+// or play time leaves its range (rewind, state load, reset). Games whose
+// music reacts to anything but the pads still diverge until the next refresh.
+class NoteLookahead {
+public:
+    static constexpr int FRAMES = 240;              // ~4 s
+    static constexpr double REFRESH_SECONDS = 1.0;
+
+    NoteLookahead() = default;
+    ~NoteLookahead();
+    NoteLookahead(const NoteLookahead&) = delete;
+    NoteLookahead& operator=(const NoteLookahead&) = delete;
+
+    // Main thread. The ROM the emulator is running; drops any prediction.
+    // loadROMData doesn't copy (see NesBatch).
+    bool loadROM(const char* path);
+    bool loadROMData(const void* data, size_t size);
+    void clear();
+
+    // Main thread, every frame while predictions are wanted: pick up a
+    // finished run, drop one that no longer holds and start the next.
+    // True when frames() changed.
+    bool update(NesEmulator& emu, JobSystem& jobs);
+
+    // Channel state per predicted frame, oldest first; empty if none holds
+    const std::vector<ApuFrameSnapshot>& frames() const { return frames_; }
+
+private:
+    void cancel();
+
+    NesBatch batch_;                    // one session, only touched by the job while it runs
+    bool loaded_ = false;
+    JobHandle job_;
+    InputMovie::StartState start_;      // the running job's start
+    uint16_t job_pads_ = 0;
+    double job_time_ = 0.0;
+    std::vector<ApuFrameSnapshot> job_frames_;  // its result, empty if the state didn't restore
+
+    // Published prediction
+    std::vector<ApuFrameSnapshot> frames_;
+    uint16_t held_pads_ = 0;
+    double start_time_ = -1.0;          // play time it starts at, -1 if none
+};
@@ -0,0 +1,662 @@
+#include "NoteRollRenderer.h"
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <vector>
+
+/*
+    Vulkan shaders (SPIR-V 1.4, set/binding layout as sokol-shdc emits it):
+
+    layout(set = 0, binding = 0) uniform vs_params {
+        vec4 rect;
+        vec4 view;
+        vec4 timing;
+        vec4 keys;
+    };
+    layout(location = 0) in vec2 corner;
+    layout(location = 1) in vec4 note;      // start, end, key left, key width
+    layout(location = 2) in vec4 color0;
+    layout(location = 3) in vec2 segment;   // start, end of the envelope stretch drawn
+    layout(location = 0) out vec2 local;    // pixels from the note's center
+    layout(location = 1) out vec2 half_size;
+    layout(location = 2) out vec4 color;
+    layout(location = 3) out float glow;
+    void main() {
+        float start = max(note.x, timing.z) + timing.y;
+        float end = note.y + timing.y;
+        float seg_start = max(segment.x, timing.z) + timing.y;
+        float seg_end = segment.y + timing.y;
+        float left = rect.x + (note.z - keys.x) * view.w;
+        float right = left + note.w * view.w - step(1.0, note.w);
+        float bottom = rect.y + rect.w - (start - timing.x) * view.z;
+        float top = min(rect.y + rect.w - (end - timing.x) * view.z, bottom);
+        float seg_bottom = min(rect.y + rect.w - (seg_start - timing.x) * view.z, bottom);
+        float seg_top = clamp(rect.y + rect.w - (seg_end - timing.x) * view.z, top, seg_bottom);
+        vec2 lo = vec2(left + 1.0, top);
+        vec2 hi = vec2(right - 1.0, bottom);
+        vec2 seg_lo = vec2(left + 1.0 - 4.0, seg_top - 4.0 * step(end, seg_end));
+        vec2 seg_hi = vec2(right - 1.0 + 4.0, seg_bottom + 4.0 * step(seg_start, start));
+        vec2 p = mix(seg_lo, seg_hi, corner);
+        float visible = step(keys.x - 0.01, note.z) * step(note.z + note.w, keys.y + 0.01) *
+                        (1.0 - step(bottom, top)) * (1.0 - step(seg_bottom, seg_top));
+        gl_Position = vec4(((p / view.xy) - 0.5) * vec2(2.0, -2.0) * visible, 0.5, 1.0);
+        local = p - (lo + hi) * 0.5;
+        half_size = (hi - lo) * 0.5;
+        color = color0;
+        glow = step(timing.x, start) * step(start, timing.x + 0.1);
+    }
+
+    layout(location = 0) in vec2 local;
+    layout(location = 1) in vec2 half_size;
+    layout(location = 2) in vec4 color;
+    layout(location = 3) in float glow;
+    layout(location = 0) out vec4 frag_color;
+    void main() {
+        float r = min(3.0, min(half_size.x, half_size.y));
+        vec2 q = abs(local) - half_size + r;
+        float d = length(max(q, vec2(0.0))) + min(max(q.x, q.y), 0.0) - r;
+        float fill = clamp(0.5 - d, 0.0, 1.0);
+        float outline = clamp(1.0 - abs(d + 0.5), 0.0, 1.0) * (80.0 / 255.0);
+        float halo = glow * clamp(4.0 - d, 0.0, 1.0) * (96.0 / 255.0);
+        frag_color = vec4(mix(color.rgb, vec3(1.0), vec3(outline)), max(fill * color.a, halo));
+    }
+
+    Notes outside the keyboard range or of zero length collapse to a point.
+    The quad is padded by 4 pixels for the glow of notes about to play; the
+    rounded fill, outline and glow match what ImDrawList drew per note.
+    Each instance covers one stretch of a note's volume envelope but shades
+    against the whole note, so the stretches meet without seams and only
+    the note's outer edges are padded.
+*/
+static const uint8_t _roll_vs_bytecode_spirv[3496] = {
+    0x03,0x02,0x23,0x07,0x00,0x04,0x01,0x00,0x0b,0x00,0x08,0x00,0x99,0x00,0x00,0x00,
+    0x00,0x00,0x00,0x00,0x11,0x00,0x02,0x00,0x01,0x00,0x00,0x00,0x0b,0x00,0x06,0x00,
+    0x01,0x00,0x00,0x00,0x47,0x4c,0x53,0x4c,0x2e,0x73,0x74,0x64,0x2e,0x34,0x35,0x30,
+    0x00,0x00,0x00,0x00,0x0e,0x00,0x03,0x00,0x00,0x00,0x00,0x00,0x01,0x00,0x00,0x00,
+    0x0f,0x00,0x0f,0x00,0x00,0x00,0x00,0x00,0x02,0x00,0x00,0x00,0x6d,0x61,0x69,0x6e,
+    0x00,0x00,0x00,0x00,0x0c,0x00,0x00,0x00,0x0e,0x00,0x00,0x00,0x10,0x00,0x00,0x00,
+    0x12,0x00,0x00,0x00,0x13,0x00,0x00,0x00,0x15,0x00,0x00,0x00,0x17,0x00,0x00,0x00,
+    0x19,0x00,0x00,0x00,0x1a,0x00,0x00,0x00,0x1c,0x00,0x00,0x00,0x47,0x00,0x03,0x00,
+    0x0b,0x00,0x00,0x00,0x02,0x00,0x00,0x00,0x48,0x00,0x05,0x00,0x0b,0x00,0x00,0x00,
+    0x00,0x00,0x00,0x00,0x0b,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x48,0x00,0x05,0x00,
+    0x0b,0x00,0x00,0x00,0x01,0x00,0x00,0x00,0x0b,0x00,0x00,0x00,0x01,0x00,0x00,0x00,
+    0x48,0x00,0x05,0x00,0x0b,0x00,0x00,0x00,0x02,0x00,0x00,0x00,0x0b,0x00,0x00,0x00,
+    0x03,0x00,0x00,0x00,0x48,0x00,0x05,0x00,0x0b,0x00,0x00,0x00,0x03,0x00,0x00,0x00,
+    0x0b,0x00,0x00,0x00,0x04,0x00,0x00,0x00,0x47,0x00,0x04,0x00,0x0e,0x00,0x00,0x00,
+    0x1e,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x47,0x00,0x04,0x00,0x10,0x00,0x00,0x00,
+    0x1e,0x00,0x00,0x00,0x01,0x00,0x00,0x00,0x47,0x00,0x04,0x00,0x12,0x00,0x00,0x00,
+    0x1e,0x00,0x00,0x00,0x02,0x00,0x00,0x00,0x47,0x00,0x04,0x00,0x13,0x00,0x00,0x00,
+    0x1e,0x00,0x00,0x00,0x03,0x00,0x00,0x00,0x47,0x00,0x03,0x00,0x14,0x00,0x00,0x00,
+    0x02,0x00,0x00,0x00,0x48,0x00,0x05,0x00,0x14,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+    0x23,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x48,0x00,0x05,0x00,0x14,0x00,0x00,0x00,
+    0x01,0x00,0x00,0x00,0x23,0x00,0x00,0x00,0x10,0x00,0x00,0x00,0x48,0x00,0x05,0x00,
+    0x14,0x00,0x00,0x00,0x02,0x00,0x00,0x00,0x23,0x00,0x00,0x00,0x20,0x00,0x00,0x00,
+    0x48,0x00,0x05,0x00,0x14,0x00,0x00,0x00,0x03,0x00,0x00,0x00,0x23,0x00,0x00,0x00,
+    0x30,0x00,0x00,0x00,0x47,0x00,0x04,0x00,0x15,0x00,0x00,0x00,0x22,0x00,0x00,0x00,
+    0x00,0x00,0x00,0x00,0x47,0x00,0x04,0x00,0x15,0x00,0x00,0x00,0x21,0x00,0x00,0x00,
+    0x00,0x00,0x00,0x00,0x47,0x00,0x04,0x00,0x17,0x00,0x00,0x00,0x1e,0x00,0x00,0x00,
+    0x00,0x00,0x00,0x00,0x47,0x00,0x04,0x00,0x19,0x00,0x00,0x00,0x1e,0x00,0x00,0x00,
+    0x01,0x00,0x00,0x00,0x47,0x00,0x04,0x00,0x1a,0x00,0x00,0x00,0x1e,0x00,0x00,0x00,
+    0x02,0x00,0x00,0x00,0x47,0x00,0x04,0x00,0x1c,0x00,0x00,0x00,0x1e,0x00,0x00,0x00,
+    0x03,0x00,0x00,0x00,0x16,0x00,0x03,0x00,0x03,0x00,0x00,0x00,0x20,0x00,0x00,0x00,
+    0x17,0x00,0x04,0x00,0x04,0x00,0x00,0x00,0x03,0x00,0x00,0x00,0x02,0x00,0x00,0x00,
+    0x17,0x00,0x04,0x00,0x05,0x00,0x00,0x00,0x03,0x00,0x00,0x00,0x04,0x00,0x00,0x00,
+    0x13,0x00,0x02,0x00,0x06,0x00,0x00,0x00,0x21,0x00,0x03,0x00,0x07,0x00,0x00,0x00,
+    0x06,0x00,0x00,0x00,0x15,0x00,0x04,0x00,0x08,0x00,0x00,0x00,0x20,0x00,0x00,0x00,
+    0x00,0x00,0x00,0x00,0x2b,0x00,0x04,0x00,0x08,0x00,0x00,0x00,0x09,0x00,0x00,0x00,
+    0x01,0x00,0x00,0x00,0x1c,0x00,0x04,0x00,0x0a,0x00,0x00,0x00,0x03,0x00,0x00,0x00,
+    0x09,0x00,0x00,0x00,0x1e,0x00,0x06,0x00,0x0b,0x00,0x00,0x00,0x05,0x00,0x00,0x00,
+    0x03,0x00,0x00,0x00,0x0a,0x00,0x00,0x00,0x0a,0x00,0x00,0x00,0x20,0x00,0x04,0x00,
+    0x0d,0x00,0x00,0x00,0x03,0x00,0x00,0x00,0x0b,0x00,0x00,0x00,0x3b,0x00,0x04,0x00,
+    0x0d,0x00,0x00,0x00,0x0c,0x00,0x00,0x00,0x03,0x00,0x00,0x00,0x20,0x00,0x04,0x00,
+    0x0f,0x00,0x00,0x00,0x01,0x00,0x00,0x00,0x04,0x00,0x00,0x00,0x3b,0x00,0x04,0x00,
+    0x0f,0x00,0x00,0x00,0x0e,0x00,0x00,0x00,0x01,0x00,0x00,0x00,0x20,0x00,0x04,0x00,
+    0x11,0x00,0x00,0x00,0x01,0x00,0x00,0x00,0x05,0x00,0x00,0x00,0x3b,0x00,0x04,0x00,
+    0x11,0x00,0x00,0x00,0x10,0x00,0x00,0x00,0x01,0x00,0x00,0x00,0x3b,0x00,0x04,0x00,
+    0x11,0x00,0x00,0x00,0x12,0x00,0x00,0x00,0x01,0x00,0x00,0x00,0x3b,0x00,0x04,0x00,
+    0x0f,0x00,0x00,0x00,0x13,0x00,0x00,0x00,0x01,0x00,0x00,0x00,0x1e,0x00,0x06,0x00,
+    0x14,0x00,0x00,0x00,0x05,0x00,0x00,0x00,0x05,0x00,0x00,0x00,0x05,0x00,0x00,0x00,
+    0x05,0x00,0x00,0x00,0x20,0x00,0x04,0x00,0x16,0x00,0x00,0x00,0x02,0x00,0x00,0x00,
+    0x14,0x00,0x00,0x00,0x3b,0x00,0x04,0x00,0x16,0x00,0x00,0x00,0x15,0x00,0x00,0x00,
+    0x02,0x00,0x00,0x00,0x20,0x00,0x04,0x00,0x18,0x00,0x00,0x00,0x03,0x00,0x00,0x00,
+    0x04,0x00,0x00,0x00,0x3b,0x00,0x04,0x00,0x18,0x00,0x00,0x00,0x17,0x00,0x00,0x00,
+    0x03,0x00,0x00,0x00,0x3b,0x00,0x04,0x00,0x18,0x00,0x00,0x00,0x19,0x00,0x00,0x00,
+    0x03,0x00,0x00,0x00,0x20,0x00,0x04,0x00,0x1b,0x00,0x00,0x00,0x03,0x00,0x00,0x00,
+    0x05,0x00,0x00,0x00,0x3b,0x00,0x04,0x00,0x1b,0x00,0x00,0x00,0x1a,0x00,0x00,0x00,
+    0x03,0x00,0x00,0x00,0x20,0x00,0x04,0x00,0x1d,0x00,0x00,0x00,0x03,0x00,0x00,0x00,
+    0x03,0x00,0x00,0x00,0x3b,0x00,0x04,0x00,0x1d,0x00,0x00,0x00,0x1c,0x00,0x00,0x00,
+    0x03,0x00,0x00,0x00,0x15,0x00,0x04,0x00,0x1e,0x00,0x00,0x00,0x20,0x00,0x00,0x00,
+    0x01,0x00,0x00,0x00,0x20,0x00,0x04,0x00,0x1f,0x00,0x00,0x00,0x02,0x00,0x00,0x00,
+    0x05,0x00,0x00,0x00,0x2b,0x00,0x04,0x00,0x1e,0x00,0x00,0x00,0x20,0x00,0x00,0x00,
+    0x00,0x00,0x00,0x00,0x2b,0x00,0x04,0x00,0x1e,0x00,0x00,0x00,0x23,0x00,0x00,0x00,
+    0x01,0x00,0x00,0x00,0x2b,0x00,0x04,0x00,0x1e,0x00,0x00,0x00,0x26,0x00,0x00,0x00,
+    0x02,0x00,0x00,0x00,0x2b,0x00,0x04,0x00,0x1e,0x00,0x00,0x00,0x29,0x00,0x00,0x00,
+    0x03,0x00,0x00,0x00,0x2b,0x00,0x04,0x00,0x03,0x00,0x00,0x00,0x46,0x00,0x00,0x00,
+    0x00,0x00,0x80,0x3f,0x2b,0x00,0x04,0x00,0x03,0x00,0x00,0x00,0x64,0x00,0x00,0x00,
+    0x00,0x00,0x80,0x40,0x2b,0x00,0x04,0x00,0x03,0x00,0x00,0x00,0x72,0x00,0x00,0x00,
+    0x0a,0xd7,0x23,0x3c,0x2b,0x00,0x04,0x00,0x03,0x00,0x00,0x00,0x81,0x00,0x00,0x00,
+    0x00,0x00,0x00,0x3f,0x2c,0x00,0x05,0x00,0x04,0x00,0x00,0x00,0x82,0x00,0x00,0x00,
+    0x81,0x00,0x00,0x00,0x81,0x00,0x00,0x00,0x2b,0x00,0x04,0x00,0x03,0x00,0x00,0x00,
+    0x84,0x00,0x00,0x00,0x00,0x00,0x00,0x40,0x2b,0x00,0x04,0x00,0x03,0x00,0x00,0x00,
+    0x85,0x00,0x00,0x00,0x00,0x00,0x00,0xc0,0x2c,0x00,0x05,0x00,0x04,0x00,0x00,0x00,
+    0x86,0x00,0x00,0x00,0x84,0x00,0x00,0x00,0x85,0x00,0x00,0x00,0x2b,0x00,0x04,0x00,
+    0x03,0x00,0x00,0x00,0x94,0x00,0x00,0x00,0xcd,0xcc,0xcc,0x3d,0x36,0x00,0x05,0x00,
+    0x06,0x00,0x00,0x00,0x02,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x07,0x00,0x00,0x00,
+    0xf8,0x00,0x02,0x00,0x98,0x00,0x00,0x00,0x41,0x00,0x05,0x00,0x1f,0x00,0x00,0x00,
+    0x21,0x00,0x00,0x00,0x15,0x00,0x00,0x00,0x20,0x00,0x00,0x00,0x3d,0x00,0x04,0x00,
+    0x05,0x00,0x00,0x00,0x22,0x00,0x00,0x00,0x21,0x00,0x00,0x00,0x41,0x00,0x05,0x00,
+    0x1f,0x00,0x00,0x00,0x24,0x00,0x00,0x00,0x15,0x00,0x00,0x00,0x23,0x00,0x00,0x00,
+    0x3d,0x00,0x04,0x00,0x05,0x00,0x00,0x00,0x25,0x00,0x00,0x00,0x24,0x00,0x00,0x00,
+    0x41,0x00,0x05,0x00,0x1f,0x00,0x00,0x00,0x27,0x00,0x00,0x00,0x15,0x00,0x00,0x00,
+    0x26,0x00,0x00,0x00,0x3d,0x00,0x04,0x00,0x05,0x00,0x00,0x00,0x28,0x00,0x00,0x00,
+    0x27,0x00,0x00,0x00,0x41,0x00,0x05,0x00,0x1f,0x00,0x00,0x00,0x2a,0x00,0x00,0x00,
+    0x15,0x00,0x00,0x00,0x29,0x00,0x00,0x00,0x3d,0x00,0x04,0x00,0x05,0x00,0x00,0x00,
+    0x2b,0x00,0x00,0x00,0x2a,0x00,0x00,0x00,0x3d,0x00,0x04,0x00,0x05,0x00,0x00,0x00,
+    0x2c,0x00,0x00,0x00,0x10,0x00,0x00,0x00,0x51,0x00,0x05,0x00,0x03,0x00,0x00,0x00,
+    0x2d,0x00,0x00,0x00,0x2c,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x51,0x00,0x05,0x00,
+    0x03,0x00,0x00,0x00,0x2e,0x00,0x00,0x00,0x2c,0x00,0x00,0x00,0x01,0x00,0x00,0x00,
+    0x51,0x00,0x05,0x00,0x03,0x00,0x00,0x00,0x2f,0x00,0x00,0x00,0x2c,0x00,0x00,0x00,
+    0x02,0x00,0x00,0x00,0x51,0x00,0x05,0x00,0x03,0x00,0x00,0x00,0x30,0x00,0x00,0x00,
+    0x2c,0x00,0x00,0x00,0x03,0x00,0x00,0x00,0x51,0x00,0x05,0x00,0x03,0x00,0x00,0x00,
+    0x31,0x00,0x00,0x00,0x22,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x51,0x00,0x05,0x00,
+    0x03,0x00,0x00,0x00,0x32,0x00,0x00,0x00,0x22,0x00,0x00,0x00,0x01,0x00,0x00,0x00,
+    0x51,0x00,0x05,0x00,0x03,0x00,0x00,0x00,0x33,0x00,0x00,0x00,0x22,0x00,0x00,0x00,
+    0x02,0x00,0x00,0x00,0x51,0x00,0x05,0x00,0x03,0x00,0x00,0x00,0x34,0x00,0x00,0x00,
+    0x22,0x00,0x00,0x00,0x03,0x00,0x00,0x00,0x51,0x00,0x05,0x00,0x03,0x00,0x00,0x00,
+    0x35,0x00,0x00,0x00,0x25,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x51,0x00,0x05,0x00,
+    0x03,0x00,0x00,0x00,0x36,0x00,0x00,0x00,0x25,0x00,0x00,0x00,0x01,0x00,0x00,0x00,
+    0x51,0x00,0x05,0x00,0x03,0x00,0x00,0x00,0x37,0x00,0x00,0x00,0x25,0x00,0x00,0x00,
+    0x02,0x00,0x00,0x00,0x51,0x00,0x05,0x00,0x03,0x00,0x00,0x00,0x38,0x00,0x00,0x00,
+    0x25,0x00,0x00,0x00,0x03,0x00,0x00,0x00,0x51,0x00,0x05,0x00,0x03,0x00,0x00,0x00,
+    0x39,0x00,0x00,0x00,0x28,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x51,0x00,0x05,0x00,
+    0x03,0x00,0x00,0x00,0x3a,0x00,0x00,0x00,0x28,0x00,0x00,0x00,0x01,0x00,0x00,0x00,
+    0x51,0x00,0x05,0x00,0x03,0x00,0x00,0x00,0x3b,0x00,0x00,0x00,0x28,0x00,0x00,0x00,
+    0x02,0x00,0x00,0x00,0x51,0x00,0x05,0x00,0x03,0x00,0x00,0x00,0x3c,0x00,0x00,0x00,
+    0x2b,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x51,0x00,0x05,0x00,0x03,0x00,0x00,0x00,
+    0x3d,0x00,0x00,0x00,0x2b,0x00,0x00,0x00,0x01,0x00,0x00,0x00,0x0c,0x00,0x07,0x00,
+    0x03,0x00,0x00,0x00,0x3e,0x00,0x00,0x00,0x01,0x00,0x00,0x00,0x28,0x00,0x00,0x00,
+    0x2d,0x00,0x00,0x00,0x3b,0x00,0x00,0x00,0x81,0x00,0x05,0x00,0x03,0x00,0x00,0x00,
+    0x3f,0x00,0x00,0x00,0x3e,0x00,0x00,0x00,0x3a,0x00,0x00,0x00,0x81,0x00,0x05,0x00,
+    0x03,0x00,0x00,0x00,0x40,0x00,0x00,0x00,0x2e,0x00,0x00,0x00,0x3a,0x00,0x00,0x00,
+    0x83,0x00,0x05,0x00,0x03,0x00,0x00,0x00,0x41,0x00,0x00,0x00,0x2f,0x00,0x00,0x00,
+    0x3c,0x00,0x00,0x00,0x85,0x00,0x05,0x00,0x03,0x00,0x00,0x00,0x42,0x00,0x00,0x00,
+    0x41,0x00,0x00,0x00,0x38,0x00,0x00,0x00,0x81,0x00,0x05,0x00,0x03,0x00,0x00,0x00,
+    0x43,0x00,0x00,0x00,0x31,0x00,0x00,0x00,0x42,0x00,0x00,0x00,0x85,0x00,0x05,0x00,
+    0x03,0x00,0x00,0x00,0x44,0x00,0x00,0x00,0x30,0x00,0x00,0x00,0x38,0x00,0x00,0x00,
+    0x81,0x00,0x05,0x00,0x03,0x00,0x00,0x00,0x45,0x00,0x00,0x00,0x43,0x00,0x00,0x00,
+    0x44,0x00,0x00,0x00,0x0c,0x00,0x07,0x00,0x03,0x00,0x00,0x00,0x47,0x00,0x00,0x00,
+    0x01,0x00,0x00,0x00,0x30,0x00,0x00,0x00,0x46,0x00,0x00,0x00,0x30,0x00,0x00,0x00,
+    0x83,0x00,0x05,0x00,0x03,0x00,0x00,0x00,0x48,0x00,0x00,0x00,0x45,0x00,0x00,0x00,
+    0x47,0x00,0x00,0x00,0x3d,0x00,0x04,0x00,0x04,0x00,0x00,0x00,0x49,0x00,0x00,0x00,
+    0x13,0x00,0x00,0x00,0x51,0x00,0x05,0x00,0x03,0x00,0x00,0x00,0x4a,0x00,0x00,0x00,
+    0x49,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x51,0x00,0x05,0x00,0x03,0x00,0x00,0x00,
+    0x4b,0x00,0x00,0x00,0x49,0x00,0x00,0x00,0x01,0x00,0x00,0x00,0x0c,0x00,0x07,0x00,
+    0x03,0x00,0x00,0x00,0x4c,0x00,0x00,0x00,0x01,0x00,0x00,0x00,0x28,0x00,0x00,0x00,
+    0x4a,0x00,0x00,0x00,0x3b,0x00,0x00,0x00,0x81,0x00,0x05,0x00,0x03,0x00,0x00,0x00,
+    0x4d,0x00,0x00,0x00,0x4c,0x00,0x00,0x00,0x3a,0x00,0x00,0x00,0x81,0x00,0x05,0x00,
+    0x03,0x00,0x00,0x00,0x4e,0x00,0x00,0x00,0x4b,0x00,0x00,0x00,0x3a,0x00,0x00,0x00,
+    0x81,0x00,0x05,0x00,0x03,0x00,0x00,0x00,0x4f,0x00,0x00,0x00,0x32,0x00,0x00,0x00,
+    0x34,0x00,0x00,0x00,0x83,0x00,0x05,0x00,0x03,0x00,0x00,0x00,0x50,0x00,0x00,0x00,
+    0x3f,0x00,0x00,0x00,0x39,0x00,0x00,0x00,0x85,0x00,0x05,0x00,0x03,0x00,0x00,0x00,
+    0x51,0x00,0x00,0x00,0x50,0x00,0x00,0x00,0x37,0x00,0x00,0x00,0x83,0x00,0x05,0x00,
+    0x03,0x00,0x00,0x00,0x52,0x00,0x00,0x00,0x4f,0x00,0x00,0x00,0x51,0x00,0x00,0x00,
+    0x83,0x00,0x05,0x00,0x03,0x00,0x00,0x00,0x53,0x00,0x00,0x00,0x40,0x00,0x00,0x00,
+    0x39,0x00,0x00,0x00,0x85,0x00,0x05,0x00,0x03,0x00,0x00,0x00,0x54,0x00,0x00,0x00,
+    0x53,0x00,0x00,0x00,0x37,0x00,0x00,0x00,0x83,0x00,0x05,0x00,0x03,0x00,0x00,0x00,
+    0x55,0x00,0x00,0x00,0x4f,0x00,0x00,0x00,0x54,0x00,0x00,0x00,0x0c,0x00,0x07,0x00,
+    0x03,0x00,0x00,0x00,0x56,0x00,0x00,0x00,0x01,0x00,0x00,0x00,0x25,0x00,0x00,0x00,
+    0x55,0x00,0x00,0x00,0x52,0x00,0x00,0x00,0x83,0x00,0x05,0x00,0x03,0x00,0x00,0x00,
+    0x57,0x00,0x00,0x00,0x4d,0x00,0x00,0x00,0x39,0x00,0x00,0x00,0x85,0x00,0x05,0x00,
+    0x03,0x00,0x00,0x00,0x58,0x00,0x00,0x00,0x57,0x00,0x00,0x00,0x37,0x00,0x00,0x00,
+    0x83,0x00,0x05,0x00,0x03,0x00,0x00,0x00,0x59,0x00,0x00,0x00,0x4f,0x00,0x00,0x00,
+    0x58,0x00,0x00,0x00,0x0c,0x00,0x07,0x00,0x03,0x00,0x00,0x00,0x5a,0x00,0x00,0x00,
+    0x01,0x00,0x00,0x00,0x25,0x00,0x00,0x00,0x59,0x00,0x00,0x00,0x52,0x00,0x00,0x00,
+    0x83,0x00,0x05,0x00,0x03,0x00,0x00,0x00,0x5b,0x00,0x00,0x00,0x4e,0x00,0x00,0x00,
+    0x39,0x00,0x00,0x00,0x85,0x00,0x05,0x00,0x03,0x00,0x00,0x00,0x5c,0x00,0x00,0x00,
+    0x5b,0x00,0x00,0x00,0x37,0x00,0x00,0x00,0x83,0x00,0x05,0x00,0x03,0x00,0x00,0x00,
+    0x5d,0x00,0x00,0x00,0x4f,0x00,0x00,0x00,0x5c,0x00,0x00,0x00,0x0c,0x00,0x08,0x00,
+    0x03,0x00,0x00,0x00,0x5e,0x00,0x00,0x00,0x01,0x00,0x00,0x00,0x2b,0x00,0x00,0x00,
+    0x5d,0x00,0x00,0x00,0x56,0x00,0x00,0x00,0x5a,0x00,0x00,0x00,0x81,0x00,0x05,0x00,
+    0x03,0x00,0x00,0x00,0x5f,0x00,0x00,0x00,0x43,0x00,0x00,0x00,0x46,0x00,0x00,0x00,
+    0x50,0x00,0x05,0x00,0x04,0x00,0x00,0x00,0x60,0x00,0x00,0x00,0x5f,0x00,0x00,0x00,
+    0x56,0x00,0x00,0x00,0x83,0x00,0x05,0x00,0x03,0x00,0x00,0x00,0x61,0x00,0x00,0x00,
+    0x48,0x00,0x00,0x00,0x46,0x00,0x00,0x00,0x50,0x00,0x05,0x00,0x04,0x00,0x00,0x00,
+    0x62,0x00,0x00,0x00,0x61,0x00,0x00,0x00,0x52,0x00,0x00,0x00,0x81,0x00,0x05,0x00,
+    0x03,0x00,0x00,0x00,0x63,0x00,0x00,0x00,0x43,0x00,0x00,0x00,0x46,0x00,0x00,0x00,
+    0x83,0x00,0x05,0x00,0x03,0x00,0x00,0x00,0x65,0x00,0x00,0x00,0x63,0x00,0x00,0x00,
+    0x64,0x00,0x00,0x00,0x0c,0x00,0x07,0x00,0x03,0x00,0x00,0x00,0x66,0x00,0x00,0x00,
+    0x01,0x00,0x00,0x00,0x30,0x00,0x00,0x00,0x40,0x00,0x00,0x00,0x4e,0x00,0x00,0x00,
+    0x85,0x00,0x05,0x00,0x03,0x00,0x00,0x00,0x67,0x00,0x00,0x00,0x64,0x00,0x00,0x00,
+    0x66,0x00,0x00,0x00,0x83,0x00,0x05,0x00,0x03,0x00,0x00,0x00,0x68,0x00,0x00,0x00,
+    0x5e,0x00,0x00,0x00,0x67,0x00,0x00,0x00,0x50,0x00,0x05,0x00,0x04,0x00,0x00,0x00,
+    0x69,0x00,0x00,0x00,0x65,0x00,0x00,0x00,0x68,0x00,0x00,0x00,0x83,0x00,0x05,0x00,
+    0x03,0x00,0x00,0x00,0x6a,0x00,0x00,0x00,0x48,0x00,0x00,0x00,0x46,0x00,0x00,0x00,
+    0x81,0x00,0x05,0x00,0x03,0x00,0x00,0x00,0x6b,0x00,0x00,0x00,0x6a,0x00,0x00,0x00,
+    0x64,0x00,0x00,0x00,0x0c,0x00,0x07,0x00,0x03,0x00,0x00,0x00,0x6c,0x00,0x00,0x00,
+    0x01,0x00,0x00,0x00,0x30,0x00,0x00,0x00,0x4d,0x00,0x00,0x00,0x3f,0x00,0x00,0x00,
+    0x85,0x00,0x05,0x00,0x03,0x00,0x00,0x00,0x6d,0x00,0x00,0x00,0x64,0x00,0x00,0x00,
+    0x6c,0x00,0x00,0x00,0x81,0x00,0x05,0x00,0x03,0x00,0x00,0x00,0x6e,0x00,0x00,0x00,
+    0x5a,0x00,0x00,0x00,0x6d,0x00,0x00,0x00,0x50,0x00,0x05,0x00,0x04,0x00,0x00,0x00,
+    0x6f,0x00,0x00,0x00,0x6b,0x00,0x00,0x00,0x6e,0x00,0x00,0x00,0x3d,0x00,0x04,0x00,
+    0x04,0x00,0x00,0x00,0x70,0x00,0x00,0x00,0x0e,0x00,0x00,0x00,0x0c,0x00,0x08,0x00,
+    0x04,0x00,0x00,0x00,0x71,0x00,0x00,0x00,0x01,0x00,0x00,0x00,0x2e,0x00,0x00,0x00,
+    0x69,0x00,0x00,0x00,0x6f,0x00,0x00,0x00,0x70,0x00,0x00,0x00,0x83,0x00,0x05,0x00,
+    0x03,0x00,0x00,0x00,0x73,0x00,0x00,0x00,0x3c,0x00,0x00,0x00,0x72,0x00,0x00,0x00,
+    0x0c,0x00,0x07,0x00,0x03,0x00,0x00,0x00,0x74,0x00,0x00,0x00,0x01,0x00,0x00,0x00,
+    0x30,0x00,0x00,0x00,0x73,0x00,0x00,0x00,0x2f,0x00,0x00,0x00,0x81,0x00,0x05,0x00,
+    0x03,0x00,0x00,0x00,0x75,0x00,0x00,0x00,0x2f,0x00,0x00,0x00,0x30,0x00,0x00,0x00,
+    0x81,0x00,0x05,0x00,0x03,0x00,0x00,0x00,0x76,0x00,0x00,0x00,0x3d,0x00,0x00,0x00,
+    0x72,0x00,0x00,0x00,0x0c,0x00,0x07,0x00,0x03,0x00,0x00,0x00,0x77,0x00,0x00,0x00,
+    0x01,0x00,0x00,0x00,0x30,0x00,0x00,0x00,0x75,0x00,0x00,0x00,0x76,0x00,0x00,0x00,
+    0x85,0x00,0x05,0x00,0x03,0x00,0x00,0x00,0x78,0x00,0x00,0x00,0x74,0x00,0x00,0x00,
+    0x77,0x00,0x00,0x00,0x0c,0x00,0x07,0x00,0x03,0x00,0x00,0x00,0x79,0x00,0x00,0x00,
+    0x01,0x00,0x00,0x00,0x30,0x00,0x00,0x00,0x52,0x00,0x00,0x00,0x56,0x00,0x00,0x00,
+    0x83,0x00,0x05,0x00,0x03,0x00,0x00,0x00,0x7a,0x00,0x00,0x00,0x46,0x00,0x00,0x00,
+    0x79,0x00,0x00,0x00,0x85,0x00,0x05,0x00,0x03,0x00,0x00,0x00,0x7b,0x00,0x00,0x00,
+    0x78,0x00,0x00,0x00,0x7a,0x00,0x00,0x00,0x0c,0x00,0x07,0x00,0x03,0x00,0x00,0x00,
+    0x7c,0x00,0x00,0x00,0x01,0x00,0x00,0x00,0x30,0x00,0x00,0x00,0x5a,0x00,0x00,0x00,
+    0x5e,0x00,0x00,0x00,0x83,0x00,0x05,0x00,0x03,0x00,0x00,0x00,0x7d,0x00,0x00,0x00,
+    0x46,0x00,0x00,0x00,0x7c,0x00,0x00,0x00,0x85,0x00,0x05,0x00,0x03,0x00,0x00,0x00,
+    0x7e,0x00,0x00,0x00,0x7b,0x00,0x00,0x00,0x7d,0x00,0x00,0x00,0x4f,0x00,0x07,0x00,
+    0x04,0x00,0x00,0x00,0x7f,0x00,0x00,0x00,0x25,0x00,0x00,0x00,0x25,0x00,0x00,0x00,
+    0x00,0x00,0x00,0x00,0x01,0x00,0x00,0x00,0x88,0x00,0x05,0x00,0x04,0x00,0x00,0x00,
+    0x80,0x00,0x00,0x00,0x71,0x00,0x00,0x00,0x7f,0x00,0x00,0x00,0x83,0x00,0x05,0x00,
+    0x04,0x00,0x00,0x00,0x83,0x00,0x00,0x00,0x80,0x00,0x00,0x00,0x82,0x00,0x00,0x00,
+    0x85,0x00,0x05,0x00,0x04,0x00,0x00,0x00,0x87,0x00,0x00,0x00,0x83,0x00,0x00,0x00,
+    0x86,0x00,0x00,0x00,0x8e,0x00,0x05,0x00,0x04,0x00,0x00,0x00,0x88,0x00,0x00,0x00,
+    0x87,0x00,0x00,0x00,0x7e,0x00,0x00,0x00,0x51,0x00,0x05,0x00,0x03,0x00,0x00,0x00,
+    0x89,0x00,0x00,0x00,0x88,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x51,0x00,0x05,0x00,
+    0x03,0x00,0x00,0x00,0x8a,0x00,0x00,0x00,0x88,0x00,0x00,0x00,0x01,0x00,0x00,0x00,
+    0x50,0x00,0x07,0x00,0x05,0x00,0x00,0x00,0x8b,0x00,0x00,0x00,0x89,0x00,0x00,0x00,
+    0x8a,0x00,0x00,0x00,0x81,0x00,0x00,0x00,0x46,0x00,0x00,0x00,0x41,0x00,0x05,0x00,
+    0x1b,0x00,0x00,0x00,0x8c,0x00,0x00,0x00,0x0c,0x00,0x00,0x00,0x20,0x00,0x00,0x00,
+    0x3e,0x00,0x03,0x00,0x8c,0x00,0x00,0x00,0x8b,0x00,0x00,0x00,0x81,0x00,0x05,0x00,
+    0x04,0x00,0x00,0x00,0x8d,0x00,0x00,0x00,0x60,0x00,0x00,0x00,0x62,0x00,0x00,0x00,
+    0x8e,0x00,0x05,0x00,0x04,0x00,0x00,0x00,0x8e,0x00,0x00,0x00,0x8d,0x00,0x00,0x00,
+    0x81,0x00,0x00,0x00,0x83,0x00,0x05,0x00,0x04,0x00,0x00,0x00,0x8f,0x00,0x00,0x00,
+    0x71,0x00,0x00,0x00,0x8e,0x00,0x00,0x00,0x3e,0x00,0x03,0x00,0x17,0x00,0x00,0x00,
+    0x8f,0x00,0x00,0x00,0x83,0x00,0x05,0x00,0x04,0x00,0x00,0x00,0x90,0x00,0x00,0x00,
+    0x62,0x00,0x00,0x00,0x60,0x00,0x00,0x00,0x8e,0x00,0x05,0x00,0x04,0x00,0x00,0x00,
+    0x91,0x00,0x00,0x00,0x90,0x00,0x00,0x00,0x81,0x00,0x00,0x00,0x3e,0x00,0x03,0x00,
+    0x19,0x00,0x00,0x00,0x91,0x00,0x00,0x00,0x3d,0x00,0x04,0x00,0x05,0x00,0x00,0x00,
+    0x92,0x00,0x00,0x00,0x12,0x00,0x00,0x00,0x3e,0x00,0x03,0x00,0x1a,0x00,0x00,0x00,
+    0x92,0x00,0x00,0x00,0x0c,0x00,0x07,0x00,0x03,0x00,0x00,0x00,0x93,0x00,0x00,0x00,
+    0x01,0x00,0x00,0x00,0x30,0x00,0x00,0x00,0x39,0x00,0x00,0x00,0x3f,0x00,0x00,0x00,
+    0x81,0x00,0x05,0x00,0x03,0x00,0x00,0x00,0x95,0x00,0x00,0x00,0x39,0x00,0x00,0x00,
+    0x94,0x00,0x00,0x00,0x0c,0x00,0x07,0x00,0x03,0x00,0x00,0x00,0x96,0x00,0x00,0x00,
+    0x01,0x00,0x00,0x00,0x30,0x00,0x00,0x00,0x3f,0x00,0x00,0x00,0x95,0x00,0x00,0x00,
+    0x85,0x00,0x05,0x00,0x03,0x00,0x00,0x00,0x97,0x00,0x00,0x00,0x93,0x00,0x00,0x00,
+    0x96,0x00,0x00,0x00,0x3e,0x00,0x03,0x00,0x1c,0x00,0x00,0x00,0x97,0x00,0x00,0x00,
+    0xfd,0x00,0x01,0x00,0x38,0x00,0x01,0x00,
+};
+
+static const uint8_t _roll_fs_bytecode_spirv[1560] = {
+    0x03,0x02,0x23,0x07,0x00,0x04,0x01,0x00,0x0b,0x00,0x08,0x00,0x45,0x00,0x00,0x00,
+    0x00,0x00,0x00,0x00,0x11,0x00,0x02,0x00,0x01,0x00,0x00,0x00,0x0b,0x00,0x06,0x00,
+    0x01,0x00,0x00,0x00,0x47,0x4c,0x53,0x4c,0x2e,0x73,0x74,0x64,0x2e,0x34,0x35,0x30,
+    0x00,0x00,0x00,0x00,0x0e,0x00,0x03,0x00,0x00,0x00,0x00,0x00,0x01,0x00,0x00,0x00,
+    0x0f,0x00,0x0a,0x00,0x04,0x00,0x00,0x00,0x02,0x00,0x00,0x00,0x6d,0x61,0x69,0x6e,
+    0x00,0x00,0x00,0x00,0x09,0x00,0x00,0x00,0x0b,0x00,0x00,0x00,0x0d,0x00,0x00,0x00,
+    0x0e,0x00,0x00,0x00,0x10,0x00,0x00,0x00,0x10,0x00,0x03,0x00,0x02,0x00,0x00,0x00,
+    0x07,0x00,0x00,0x00,0x47,0x00,0x04,0x00,0x09,0x00,0x00,0x00,0x1e,0x00,0x00,0x00,
+    0x00,0x00,0x00,0x00,0x47,0x00,0x04,0x00,0x0b,0x00,0x00,0x00,0x1e,0x00,0x00,0x00,
+    0x00,0x00,0x00,0x00,0x47,0x00,0x04,0x00,0x0d,0x00,0x00,0x00,0x1e,0x00,0x00,0x00,
+    0x01,0x00,0x00,0x00,0x47,0x00,0x04,0x00,0x0e,0x00,0x00,0x00,0x1e,0x00,0x00,0x00,
+    0x02,0x00,0x00,0x00,0x47,0x00,0x04,0x00,0x10,0x00,0x00,0x00,0x1e,0x00,0x00,0x00,
+    0x03,0x00,0x00,0x00,0x16,0x00,0x03,0x00,0x03,0x00,0x00,0x00,0x20,0x00,0x00,0x00,
+    0x17,0x00,0x04,0x00,0x04,0x00,0x00,0x00,0x03,0x00,0x00,0x00,0x02,0x00,0x00,0x00,
+    0x17,0x00,0x04,0x00,0x05,0x00,0x00,0x00,0x03,0x00,0x00,0x00,0x03,0x00,0x00,0x00,
+    0x17,0x00,0x04,0x00,0x06,0x00,0x00,0x00,0x03,0x00,0x00,0x00,0x04,0x00,0x00,0x00,
+    0x13,0x00,0x02,0x00,0x07,0x00,0x00,0x00,0x21,0x00,0x03,0x00,0x08,0x00,0x00,0x00,
+    0x07,0x00,0x00,0x00,0x20,0x00,0x04,0x00,0x0a,0x00,0x00,0x00,0x03,0x00,0x00,0x00,
+    0x06,0x00,0x00,0x00,0x3b,0x00,0x04,0x00,0x0a,0x00,0x00,0x00,0x09,0x00,0x00,0x00,
+    0x03,0x00,0x00,0x00,0x20,0x00,0x04,0x00,0x0c,0x00,0x00,0x00,0x01,0x00,0x00,0x00,
+    0x04,0x00,0x00,0x00,0x3b,0x00,0x04,0x00,0x0c,0x00,0x00,0x00,0x0b,0x00,0x00,0x00,
+    0x01,0x00,0x00,0x00,0x3b,0x00,0x04,0x00,0x0c,0x00,0x00,0x00,0x0d,0x00,0x00,0x00,
+    0x01,0x00,0x00,0x00,0x20,0x00,0x04,0x00,0x0f,0x00,0x00,0x00,0x01,0x00,0x00,0x00,
+    0x06,0x00,0x00,0x00,0x3b,0x00,0x04,0x00,0x0f,0x00,0x00,0x00,0x0e,0x00,0x00,0x00,
+    0x01,0x00,0x00,0x00,0x20,0x00,0x04,0x00,0x11,0x00,0x00,0x00,0x01,0x00,0x00,0x00,
+    0x03,0x00,0x00,0x00,0x3b,0x00,0x04,0x00,0x11,0x00,0x00,0x00,0x10,0x00,0x00,0x00,
+    0x01,0x00,0x00,0x00,0x2b,0x00,0x04,0x00,0x03,0x00,0x00,0x00,0x16,0x00,0x00,0x00,
+    0x00,0x00,0x40,0x40,0x2b,0x00,0x04,0x00,0x03,0x00,0x00,0x00,0x1f,0x00,0x00,0x00,
+    0x00,0x00,0x00,0x00,0x2c,0x00,0x05,0x00,0x04,0x00,0x00,0x00,0x20,0x00,0x00,0x00,
+    0x1f,0x00,0x00,0x00,0x1f,0x00,0x00,0x00,0x2b,0x00,0x04,0x00,0x03,0x00,0x00,0x00,
+    0x29,0x00,0x00,0x00,0x00,0x00,0x80,0x3f,0x2b,0x00,0x04,0x00,0x03,0x00,0x00,0x00,
+    0x2a,0x00,0x00,0x00,0x00,0x00,0x00,0x3f,0x2b,0x00,0x04,0x00,0x03,0x00,0x00,0x00,
+    0x31,0x00,0x00,0x00,0xa1,0xa0,0xa0,0x3e,0x2b,0x00,0x04,0x00,0x03,0x00,0x00,0x00,
+    0x33,0x00,0x00,0x00,0x00,0x00,0x80,0x40,0x2b,0x00,0x04,0x00,0x03,0x00,0x00,0x00,
+    0x37,0x00,0x00,0x00,0xc1,0xc0,0xc0,0x3e,0x2c,0x00,0x06,0x00,0x05,0x00,0x00,0x00,
+    0x3b,0x00,0x00,0x00,0x29,0x00,0x00,0x00,0x29,0x00,0x00,0x00,0x29,0x00,0x00,0x00,
+    0x36,0x00,0x05,0x00,0x07,0x00,0x00,0x00,0x02,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+    0x08,0x00,0x00,0x00,0xf8,0x00,0x02,0x00,0x44,0x00,0x00,0x00,0x3d,0x00,0x04,0x00,
+    0x04,0x00,0x00,0x00,0x12,0x00,0x00,0x00,0x0b,0x00,0x00,0x00,0x3d,0x00,0x04,0x00,
+    0x04,0x00,0x00,0x00,0x13,0x00,0x00,0x00,0x0d,0x00,0x00,0x00,0x3d,0x00,0x04,0x00,
+    0x06,0x00,0x00,0x00,0x14,0x00,0x00,0x00,0x0e,0x00,0x00,0x00,0x3d,0x00,0x04,0x00,
+    0x03,0x00,0x00,0x00,0x15,0x00,0x00,0x00,0x10,0x00,0x00,0x00,0x51,0x00,0x05,0x00,
+    0x03,0x00,0x00,0x00,0x17,0x00,0x00,0x00,0x13,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+    0x51,0x00,0x05,0x00,0x03,0x00,0x00,0x00,0x18,0x00,0x00,0x00,0x13,0x00,0x00,0x00,
+    0x01,0x00,0x00,0x00,0x0c,0x00,0x07,0x00,0x03,0x00,0x00,0x00,0x19,0x00,0x00,0x00,
+    0x01,0x00,0x00,0x00,0x25,0x00,0x00,0x00,0x17,0x00,0x00,0x00,0x18,0x00,0x00,0x00,
+    0x0c,0x00,0x07,0x00,0x03,0x00,0x00,0x00,0x1a,0x00,0x00,0x00,0x01,0x00,0x00,0x00,
+    0x25,0x00,0x00,0x00,0x16,0x00,0x00,0x00,0x19,0x00,0x00,0x00,0x50,0x00,0x05,0x00,
+    0x04,0x00,0x00,0x00,0x1b,0x00,0x00,0x00,0x1a,0x00,0x00,0x00,0x1a,0x00,0x00,0x00,
+    0x0c,0x00,0x06,0x00,0x04,0x00,0x00,0x00,0x1c,0x00,0x00,0x00,0x01,0x00,0x00,0x00,
+    0x04,0x00,0x00,0x00,0x12,0x00,0x00,0x00,0x83,0x00,0x05,0x00,0x04,0x00,0x00,0x00,
+    0x1d,0x00,0x00,0x00,0x1c,0x00,0x00,0x00,0x13,0x00,0x00,0x00,0x81,0x00,0x05,0x00,
+    0x04,0x00,0x00,0x00,0x1e,0x00,0x00,0x00,0x1d,0x00,0x00,0x00,0x1b,0x00,0x00,0x00,
+    0x0c,0x00,0x07,0x00,0x04,0x00,0x00,0x00,0x21,0x00,0x00,0x00,0x01,0x00,0x00,0x00,
+    0x28,0x00,0x00,0x00,0x1e,0x00,0x00,0x00,0x20,0x00,0x00,0x00,0x0c,0x00,0x06,0x00,
+    0x03,0x00,0x00,0x00,0x22,0x00,0x00,0x00,0x01,0x00,0x00,0x00,0x42,0x00,0x00,0x00,
+    0x21,0x00,0x00,0x00,0x51,0x00,0x05,0x00,0x03,0x00,0x00,0x00,0x23,0x00,0x00,0x00,
+    0x1e,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x51,0x00,0x05,0x00,0x03,0x00,0x00,0x00,
+    0x24,0x00,0x00,0x00,0x1e,0x00,0x00,0x00,0x01,0x00,0x00,0x00,0x0c,0x00,0x07,0x00,
+    0x03,0x00,0x00,0x00,0x25,0x00,0x00,0x00,0x01,0x00,0x00,0x00,0x28,0x00,0x00,0x00,
+    0x23,0x00,0x00,0x00,0x24,0x00,0x00,0x00,0x0c,0x00,0x07,0x00,0x03,0x00,0x00,0x00,
+    0x26,0x00,0x00,0x00,0x01,0x00,0x00,0x00,0x25,0x00,0x00,0x00,0x25,0x00,0x00,0x00,
+    0x1f,0x00,0x00,0x00,0x81,0x00,0x05,0x00,0x03,0x00,0x00,0x00,0x27,0x00,0x00,0x00,
+    0x22,0x00,0x00,0x00,0x26,0x00,0x00,0x00,0x83,0x00,0x05,0x00,0x03,0x00,0x00,0x00,
+    0x28,0x00,0x00,0x00,0x27,0x00,0x00,0x00,0x1a,0x00,0x00,0x00,0x83,0x00,0x05,0x00,
+    0x03,0x00,0x00,0x00,0x2b,0x00,0x00,0x00,0x2a,0x00,0x00,0x00,0x28,0x00,0x00,0x00,
+    0x0c,0x00,0x08,0x00,0x03,0x00,0x00,0x00,0x2c,0x00,0x00,0x00,0x01,0x00,0x00,0x00,
+    0x2b,0x00,0x00,0x00,0x2b,0x00,0x00,0x00,0x1f,0x00,0x00,0x00,0x29,0x00,0x00,0x00,
+    0x81,0x00,0x05,0x00,0x03,0x00,0x00,0x00,0x2d,0x00,0x00,0x00,0x28,0x00,0x00,0x00,
+    0x2a,0x00,0x00,0x00,0x0c,0x00,0x06,0x00,0x03,0x00,0x00,0x00,0x2e,0x00,0x00,0x00,
+    0x01,0x00,0x00,0x00,0x04,0x00,0x00,0x00,0x2d,0x00,0x00,0x00,0x83,0x00,0x05,0x00,
+    0x03,0x00,0x00,0x00,0x2f,0x00,0x00,0x00,0x29,0x00,0x00,0x00,0x2e,0x00,0x00,0x00,
+    0x0c,0x00,0x08,0x00,0x03,0x00,0x00,0x00,0x30,0x00,0x00,0x00,0x01,0x00,0x00,0x00,
+    0x2b,0x00,0x00,0x00,0x2f,0x00,0x00,0x00,0x1f,0x00,0x00,0x00,0x29,0x00,0x00,0x00,
+    0x85,0x00,0x05,0x00,0x03,0x00,0x00,0x00,0x32,0x00,0x00,0x00,0x30,0x00,0x00,0x00,
+    0x31,0x00,0x00,0x00,0x83,0x00,0x05,0x00,0x03,0x00,0x00,0x00,0x34,0x00,0x00,0x00,
+    0x33,0x00,0x00,0x00,0x28,0x00,0x00,0x00,0x0c,0x00,0x08,0x00,0x03,0x00,0x00,0x00,
+    0x35,0x00,0x00,0x00,0x01,0x00,0x00,0x00,0x2b,0x00,0x00,0x00,0x34,0x00,0x00,0x00,
+    0x1f,0x00,0x00,0x00,0x29,0x00,0x00,0x00,0x85,0x00,0x05,0x00,0x03,0x00,0x00,0x00,
+    0x36,0x00,0x00,0x00,0x15,0x00,0x00,0x00,0x35,0x00,0x00,0x00,0x85,0x00,0x05,0x00,
+    0x03,0x00,0x00,0x00,0x38,0x00,0x00,0x00,0x36,0x00,0x00,0x00,0x37,0x00,0x00,0x00,
+    0x4f,0x00,0x08,0x00,0x05,0x00,0x00,0x00,0x39,0x00,0x00,0x00,0x14,0x00,0x00,0x00,
+    0x14,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x01,0x00,0x00,0x00,0x02,0x00,0x00,0x00,
+    0x50,0x00,0x06,0x00,0x05,0x00,0x00,0x00,0x3a,0x00,0x00,0x00,0x32,0x00,0x00,0x00,
+    0x32,0x00,0x00,0x00,0x32,0x00,0x00,0x00,0x0c,0x00,0x08,0x00,0x05,0x00,0x00,0x00,
+    0x3c,0x00,0x00,0x00,0x01,0x00,0x00,0x00,0x2e,0x00,0x00,0x00,0x39,0x00,0x00,0x00,
+    0x3b,0x00,0x00,0x00,0x3a,0x00,0x00,0x00,0x51,0x00,0x05,0x00,0x03,0x00,0x00,0x00,
+    0x3d,0x00,0x00,0x00,0x14,0x00,0x00,0x00,0x03,0x00,0x00,0x00,0x85,0x00,0x05,0x00,
+    0x03,0x00,0x00,0x00,0x3e,0x00,0x00,0x00,0x2c,0x00,0x00,0x00,0x3d,0x00,0x00,0x00,
+    0x0c,0x00,0x07,0x00,0x03,0x00,0x00,0x00,0x3f,0x00,0x00,0x00,0x01,0x00,0x00,0x00,
+    0x28,0x00,0x00,0x00,0x3e,0x00,0x00,0x00,0x38,0x00,0x00,0x00,0x51,0x00,0x05,0x00,
+    0x03,0x00,0x00,0x00,0x40,0x00,0x00,0x00,0x3c,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+    0x51,0x00,0x05,0x00,0x03,0x00,0x00,0x00,0x41,0x00,0x00,0x00,0x3c,0x00,0x00,0x00,
+    0x01,0x00,0x00,0x00,0x51,0x00,0x05,0x00,0x03,0x00,0x00,0x00,0x42,0x00,0x00,0x00,
+    0x3c,0x00,0x00,0x00,0x02,0x00,0x00,0x00,0x50,0x00,0x07,0x00,0x06,0x00,0x00,0x00,
+    0x43,0x00,0x00,0x00,0x40,0x00,0x00,0x00,0x41,0x00,0x00,0x00,0x42,0x00,0x00,0x00,
+    0x3f,0x00,0x00,0x00,0x3e,0x00,0x03,0x00,0x09,0x00,0x00,0x00,0x43,0x00,0x00,0x00,
+    0xfd,0x00,0x01,0x00,0x38,0x00,0x01,0x00,
+};
+
+static const char _roll_vs_source_metal[] =
+    "#include <metal_stdlib>\n"
+    "using namespace metal;\n"
+    "struct vs_params { float4 rect; float4 view; float4 timing; float4 keys; };\n"
+    "struct vs_in {\n"
+    "    float2 corner [[attribute(0)]];\n"
+    "    float4 note [[attribute(1)]];\n"
+    "    float4 color0 [[attribute(2)]];\n"
+    "    float2 segment [[attribute(3)]];\n"
+    "};\n"
+    "struct vs_out {\n"
+    "    float4 pos [[position]];\n"
+    "    float2 local [[user(locn0)]];\n"
+    "    float2 half_size [[user(locn1)]];\n"
+    "    float4 color [[user(locn2)]];\n"
+    "    float glow [[user(locn3)]];\n"
+    "};\n"
+    "vertex vs_out main0(vs_in in [[stage_in]], constant vs_params& u [[buffer(0)]]) {\n"
+    "    vs_out out;\n"
+    "    float start = max(in.note.x, u.timing.z) + u.timing.y;\n"
+    "    float end = in.note.y + u.timing.y;\n"
+    "    float seg_start = max(in.segment.x, u.timing.z) + u.timing.y;\n"
+    "    float seg_end = in.segment.y + u.timing.y;\n"
+    "    float left = u.rect.x + (in.note.z - u.keys.x) * u.view.w;\n"
+    "    float right = left + in.note.w * u.view.w - step(1.0, in.note.w);\n"
+    "    float bottom = u.rect.y + u.rect.w - (start - u.timing.x) * u.view.z;\n"
+    "    float top = min(u.rect.y + u.rect.w - (end - u.timing.x) * u.view.z, bottom);\n"
+    "    float seg_bottom = min(u.rect.y + u.rect.w - (seg_start - u.timing.x) * u.view.z, bottom);\n"
+    "    float seg_top = clamp(u.rect.y + u.rect.w - (seg_end - u.timing.x) * u.view.z, top, seg_bottom);\n"
+    "    float2 lo = float2(left + 1.0, top);\n"
+    "    float2 hi = float2(right - 1.0, bottom);\n"
+    "    float2 seg_lo = float2(left + 1.0 - 4.0, seg_top - 4.0 * step(end, seg_end));\n"
+    "    float2 seg_hi = float2(right - 1.0 + 4.0, seg_bottom + 4.0 * step(seg_start, start));\n"
+    "    float2 p = mix(seg_lo, seg_hi, in.corner);\n"
+    "    float visible = step(u.keys.x - 0.01, in.note.z) * step(in.note.z + in.note.w, u.keys.y + 0.01) *\n"
+    "                    (1.0 - step(bottom, top)) * (1.0 - step(seg_bottom, seg_top));\n"
+    "    out.pos = float4(((p / u.view.xy) - 0.5) * float2(2.0, -2.0) * visible, 0.5, 1.0);\n"
+    "    out.local = p - (lo + hi) * 0.5;\n"
+    "    out.half_size = (hi - lo) * 0.5;\n"
+    "    out.color = in.color0;\n"
+    "    out.glow = step(u.timing.x, start) * step(start, u.timing.x + 0.1);\n"
+    "    return out;\n"
+    "}\n";
+
+static const char _roll_fs_source_metal[] =
+    "#include <metal_stdlib>\n"
+    "using namespace metal;\n"
+    "struct fs_in {\n"
+    "    float2 local [[user(locn0)]];\n"
+    "    float2 half_size [[user(locn1)]];\n"
+    "    float4 color [[user(locn2)]];\n"
+    "    float glow [[user(locn3)]];\n"
+    "};\n"
+    "fragment float4 main0(fs_in in [[stage_in]]) {\n"
+    "    float r = min(3.0, min(in.half_size.x, in.half_size.y));\n"
+    "    float2 q = abs(in.local) - in.half_size + r;\n"
+    "    float d = length(max(q, float2(0.0))) + min(max(q.x, q.y), 0.0) - r;\n"
+    "    float fill = clamp(0.5 - d, 0.0, 1.0);\n"
+    "    float outline = clamp(1.0 - abs(d + 0.5), 0.0, 1.0) * (80.0 / 255.0);\n"
+    "    float halo = in.glow * clamp(4.0 - d, 0.0, 1.0) * (96.0 / 255.0);\n"
+    "    return float4(mix(in.color.rgb, float3(1.0), float3(outline)), max(fill * in.color.a, halo));\n"
+    "}\n";
+
+static bool rollShaderDesc(sg_shader_desc& desc) {
+    desc = {};
+    switch (sg_query_backend()) {
+        case SG_BACKEND_VULKAN:
+            desc.vertex_func.bytecode = SG_RANGE(_roll_vs_bytecode_spirv);
+            desc.vertex_func.entry = "main";
+            desc.fragment_func.bytecode = SG_RANGE(_roll_fs_bytecode_spirv);
+            desc.fragment_func.entry = "main";
+            break;
+        case SG_BACKEND_METAL_MACOS:
+        case SG_BACKEND_METAL_IOS:
+        case SG_BACKEND_METAL_SIMULATOR:
+            desc.vertex_func.source = _roll_vs_source_metal;
+            desc.vertex_func.entry = "main0";
+            desc.fragment_func.source = _roll_fs_source_metal;
+            desc.fragment_func.entry = "main0";
+            break;
+        default:
+            return false;
+    }
+
+    for (int i = 0; i < 4; ++i) {
+        desc.attrs[i].base_type = SG_SHADERATTRBASETYPE_FLOAT;
+    }
+    desc.uniform_blocks[0].stage = SG_SHADERSTAGE_VERTEX;
+    desc.uniform_blocks[0].size = 64;
+    desc.uniform_blocks[0].msl_buffer_n = 0;
+    desc.uniform_blocks[0].spirv_set0_binding_n = 0;
+    desc.label = "piano-roll-shader";
+    return true;
+}
+
+bool NoteRollRenderer::init() {
+    if (valid_) return true;
+
+    sg_shader_desc shd_desc;
+    if (!rollShaderDesc(shd_desc)) return false;
+
+    shader_ = sg_make_shader(&shd_desc);
+    if (sg_query_shader_state(shader_) != SG_RESOURCESTATE_VALID) {
+        sg_destroy_shader(shader_);
+        shader_ = {};
+        return false;
+    }
+
+    // Unit quad as a strip; each instance stretches it over one note
+    const float quad[] = { 0.0f, 0.0f,  1.0f, 0.0f,  0.0f, 1.0f,  1.0f, 1.0f };
+    sg_buffer_desc buf_desc = {};
+    buf_desc.data = SG_RANGE(quad);
+    buf_desc.label = "piano-roll-quad";
+    corners_ = sg_make_buffer(&buf_desc);
+
+    // Drawn inside sokol_imgui's pass, so color and depth formats are the swapchain defaults
+    sg_pipeline_desc pip_desc = {};
+    pip_desc.shader = shader_;
+    pip_desc.primitive_type = SG_PRIMITIVETYPE_TRIANGLE_STRIP;
+    pip_desc.layout.buffers[1].step_func = SG_VERTEXSTEP_PER_INSTANCE;
+    pip_desc.layout.buffers[1].stride = sizeof(Instance);
+    pip_desc.layout.attrs[0].format = SG_VERTEXFORMAT_FLOAT2;
+    pip_desc.layout.attrs[1].buffer_index = 1;
+    pip_desc.layout.attrs[1].offset = offsetof(Instance, start);
+    pip_desc.layout.attrs[1].format = SG_VERTEXFORMAT_FLOAT4;
+    pip_desc.layout.attrs[2].buffer_index = 1;
+    pip_desc.layout.attrs[2].offset = offsetof(Instance, color);
+    pip_desc.layout.attrs[2].format = SG_VERTEXFORMAT_UBYTE4N;
+    pip_desc.layout.attrs[3].buffer_index = 1;
+    pip_desc.layout.attrs[3].offset = offsetof(Instance, segment_start);
+    pip_desc.layout.attrs[3].format = SG_VERTEXFORMAT_FLOAT2;
+    pip_desc.colors[0].blend.enabled = true;
+    pip_desc.colors[0].blend.src_factor_rgb = SG_BLENDFACTOR_SRC_ALPHA;
+    pip_desc.colors[0].blend.dst_factor_rgb = SG_BLENDFACTOR_ONE_MINUS_SRC_ALPHA;
+    pip_desc.label = "piano-roll-pipeline";
+    pipeline_ = sg_make_pipeline(&pip_desc);
+
+    valid_ = sg_query_pipeline_state(pipeline_) == SG_RESOURCESTATE_VALID &&
+             sg_query_buffer_state(corners_) == SG_RESOURCESTATE_VALID;
+    if (!valid_) {
+        shutdown();
+        return false;
+    }
+    return true;
+}
+
+void NoteRollRenderer::shutdown() {
+    sg_destroy_pipeline(pipeline_);
+    sg_destroy_shader(shader_);
+    sg_destroy_buffer(instances_);
+    sg_destroy_buffer(corners_);
+    pipeline_ = {};
+    shader_ = {};
+    instances_ = {};
+    corners_ = {};
+    instance_count_ = 0;
+    valid_ = false;
+}
+
+// White keys before each pitch class; black keys straddle the boundary
+static constexpr int WHITES_BEFORE[12] = { 0, 1, 1, 2, 2, 3, 4, 4, 5, 5, 6, 6 };
+static constexpr bool BLACK_KEY[12] = { false, true, false, true, false, false, true, false, true, false, true, false };
+
+float NoteRollRenderer::keyLeft(int midi_note) {
+    int pitch = midi_note % 12;
+    float left = static_cast<float>(midi_note / 12 * 7 + WHITES_BEFORE[pitch]);
+    return BLACK_KEY[pitch] ? left - 0.325f : left;
+}
+
+float NoteRollRenderer::keyWidth(int midi_note) {
+    return BLACK_KEY[midi_note % 12] ? 0.65f : 1.0f;
+}
+
+ImU32 NoteRollRenderer::envelopeColor(ImU32 color, int level) {
+    // A third of the channel color at the quietest level, all of it at the loudest
+    float scale = (5.0f + level) / 20.0f;
+    auto channel = [&](int shift) {
+        return static_cast<ImU32>(((color >> shift) & 0xFF) * scale + 0.5f) << shift;
+    };
+    return channel(IM_COL32_R_SHIFT) | channel(IM_COL32_G_SHIFT) | channel(IM_COL32_B_SHIFT) |
+           (color & IM_COL32_A_MASK);
+}
+
+void NoteRollRenderer::upload(const NoteTimeline& timeline, const ImU32* channel_colors, int channel_count) {
+    if (!valid_) return;
+
+    // One instance per stretch of each note's envelope
+    std::vector<Instance> instances;
+    instances.reserve(timeline.size());
+    timeline.forEach([&](const PianoRollNote& note) {
+        if (note.channel >= channel_count) return;
+        timeline.forEachEnvelopeRun(note, [&](float run_start, float run_end, int level) {
+            instances.push_back({note.start_time, note.end_time, keyLeft(note.midi_note), keyWidth(note.midi_note),
+                                 envelopeColor(channel_colors[note.channel], level), run_start, run_end});
+        });
+    });
+
+    // Immutable and rebuilt per upload: a track uploads once, or once per
+    // published chunk while it is still being analyzed
+    sg_destroy_buffer(instances_);
+    instances_ = {};
+    instance_count_ = static_cast<int>(instances.size());
+    if (instances.empty()) return;
+
+    sg_buffer_desc buf_desc = {};
+    buf_desc.data.ptr = instances.data();
+    buf_desc.data.size = instances.size() * sizeof(Instance);
+    buf_desc.label = "piano-roll-notes";
+    instances_ = sg_make_buffer(&buf_desc);
+}
+
+void NoteRollRenderer::draw(ImDrawList* draw_list, const View& view) {
+    if (!valid_ || instance_count_ == 0) return;
+    DrawData data = { this, view };
+    draw_list->PushClipRect(view.pos, ImVec2(view.pos.x + view.size.x, view.pos.y + view.size.y), true);
+    draw_list->AddCallback(drawCallback, &data, sizeof(data));
+    draw_list->PopClipRect();
+}
+
+void NoteRollRenderer::drawCallback(const ImDrawList* list, const ImDrawCmd* cmd) {
+    (void)list;
+    const DrawData* data = static_cast<const DrawData*>(cmd->UserCallbackData);
+    data->self->render(data->view, cmd->ClipRect);
+}
+
+void NoteRollRenderer::render(const View& view, const ImVec4& clip_rect) {
+    if (!valid_ || instance_count_ == 0) return;
+    if (clip_rect.z <= clip_rect.x || clip_rect.w <= clip_rect.y) return;
+
+    const ImGuiIO& io = ImGui::GetIO();
+    ImVec2 scale = io.DisplayFramebufferScale;
+    sg_apply_viewport(0, 0, static_cast<int>(io.DisplaySize.x * scale.x),
+                      static_cast<int>(io.DisplaySize.y * scale.y), true);
+    sg_apply_scissor_rect(static_cast<int>(clip_rect.x * scale.x), static_cast<int>(clip_rect.y * scale.y),
+                          static_cast<int>((clip_rect.z - clip_rect.x) * scale.x),
+                          static_cast<int>((clip_rect.w - clip_rect.y) * scale.y), true);
+    sg_apply_pipeline(pipeline_);
+    sg_bindings bind = {};
+    bind.vertex_buffers[0] = corners_;
+    bind.vertex_buffers[1] = instances_;
+    sg_apply_bindings(&bind);
+
+    Params params = {
+        { view.pos.x, view.pos.y, view.size.x, view.size.y },
+        { io.DisplaySize.x, io.DisplaySize.y, view.size.y / view.seconds_visible, view.white_key_width },
+        { view.current_time, 0.0f, 0.0f, 0.0f },
+        { keyLeft(view.start_note), keyLeft(view.end_note) + 1.0f, 0.0f, 0.0f }
+    };
+
+    // The stored notes, then one draw per visible repeat of the loop, shifted
+    // by whole loop lengths (notes carried into the loop start at its start)
+    float time_end = view.current_time + view.seconds_visible;
+    const NoteLoop& loop = view.loop;
+    float loop_end = loop.start + loop.length;
+    if (loop.length <= 0.0f || view.current_time < loop_end) {
+        sg_apply_uniforms(0, SG_RANGE(params));
+        sg_draw(0, 4, instance_count_);
+    }
+    if (loop.length <= 0.0f || time_end < loop_end) return;
+
+    int first = std::max(1, static_cast<int>(std::floor((view.current_time - loop.start) / loop.length)));
+    int last = static_cast<int>(std::floor((time_end - loop.start) / loop.length));
+    for (int k = first; k <= last; ++k) {
+        params.timing[1] = k * loop.length;
+        params.timing[2] = loop.start;
+        sg_apply_uniforms(0, SG_RANGE(params));
+        sg_draw(0, 4, instance_count_);
+    }
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+#include "sokol_gfx.h"
+#include "imgui.h"
+#include "NoteTimeline.h"
+#include <cstdint>
+
+// Draws the piano roll's notes with one instanced draw call. A track's notes
+// are uploaded once as an instance buffer (time span, key position in white
+// key units, channel color shaded by level, one instance per stretch of the
+// volume envelope); the key layout, scroll position and loop repeat are
+// uniforms, so the CPU does no per-note work per frame. The draw is
+// queued as an ImDrawList callback and runs inside sokol_imgui's pass, in
+// order with the roll's background and hit line.
+class NoteRollRenderer {
+public:
+    NoteRollRenderer() = default;
+    ~NoteRollRenderer() = default;
+
+    // Returns false if the active backend has no note shader (the caller
+    // then keeps drawing notes through ImDrawList)
+    bool init();
+    void shutdown();
+    bool isValid() const { return valid_; }
+
+    // Replace the instance buffer; notes on channels without a color are dropped
+    void upload(const NoteTimeline& timeline, const ImU32* channel_colors, int channel_count);
+
+    // Note color for an envelope level (1-15), shared with the ImDrawList path
+    static ImU32 envelopeColor(ImU32 color, int level);
+
+    struct View {
+        ImVec2 pos;                 // roll rectangle, screen pixels
+        ImVec2 size;
+        float current_time;         // seconds at the bottom edge
+        float seconds_visible;
+        float white_key_width;      // pixels
+        int start_note;             // keyboard range, inclusive
+        int end_note;
+        NoteLoop loop;
+    };
+
+    // Queue the notes into draw_list, clipped to the view rectangle
+    void draw(ImDrawList* draw_list, const View& view);
+
+private:
+    // std140 layout of the vertex shader's uniform block
+    struct Params {
+        float rect[4];      // x, y, width, height
+        float view[4];      // display width, display height, pixels per second, white key width
+        float timing[4];    // current time, repeat offset, repeat clip start, unused
+        float keys[4];      // first key left, last key right (white key units), unused
+    };
+
+    struct Instance {
+        float start;
+        float end;
+        float key_left;     // white key units from MIDI note 0
+        float key_width;
+        uint32_t color;     // ImU32, RGBA in byte order
+        float segment_start;    // envelope stretch within [start, end]
+        float segment_end;
+    };
+
+    struct DrawData {
+        NoteRollRenderer* self;
+        View view;
+    };
+
+    // Keyboard geometry in white key widths, matching PianoVisualizer::keyLayout
+    static float keyLeft(int midi_note);
+    static float keyWidth(int midi_note);
+    static void drawCallback(const ImDrawList* list, const ImDrawCmd* cmd);
+    void render(const View& view, const ImVec4& clip_rect);
+
+    bool valid_ = false;
+    int instance_count_ = 0;
+
+    sg_buffer corners_ = {};
+    sg_buffer instances_ = {};
+    sg_shader shader_ = {};
+    sg_pipeline pipeline_ = {};
+};
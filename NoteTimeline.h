@@ -0,0 +1,254 @@
+#pragma once
+
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+// Piano roll note event (preprocessed); the exchange format between the
+// preprocessing pass, the note cache and exporters
+struct PianoRollNote {
+    static constexpr uint32_t NO_ENVELOPE = 0xFFFFFFFF;
+
+    int channel;
+    int midi_note;
+    float velocity;
+    float start_time;   // In seconds
+    float end_time;     // In seconds (when note ends)
+    uint32_t envelope = NO_ENVELOPE;    // offset of its volume envelope in the envelope bytes it travels with
+};
+
+// Repeating section of a track found by the preprocessing pass; length 0 if none
+struct NoteLoop {
+    float start = 0.0f;     // In seconds
+    float length = 0.0f;
+};
+
+// Packed store for a track's notes: 12 bytes per note, kept per channel as
+// a start-tick array (all the range search reads) plus a parallel array of
+// duration/note/velocity/envelope. Each channel plays one note at a time, so
+// within a channel both starts and ends ascend and a range lookup is one
+// binary search. With a loop set, the looped section repeats forever after
+// the recorded notes end, so a looping track needs only one pass of it stored.
+//
+// Volume envelopes share one byte arena: a note's envelope is 4-bit levels
+// (1-15) sampled every ENVELOPE_TICKS from its start, run-length coded one
+// byte per run of up to 16 samples (level << 4 | samples - 1) and ended by a
+// 0 byte, so a held note costs a byte per quarter second and a decay one per
+// step.
+class NoteTimeline {
+public:
+    static constexpr float TICKS_PER_SECOND = 1000.0f;
+    static constexpr uint32_t MAX_DURATION = 0xFFFF;  // ~65 s; longer notes are split
+    static constexpr uint32_t ENVELOPE_TICKS = 16;    // envelope sample period, about a video frame
+
+    struct Body {
+        uint16_t duration;  // ticks
+        uint8_t midi_note;
+        uint8_t velocity;   // 1-15
+        uint32_t envelope;  // offset in the envelope arena, PianoRollNote::NO_ENVELOPE if none
+    };
+
+    struct Channel {
+        std::vector<uint32_t> start;  // ticks, ascending
+        std::vector<Body> body;
+    };
+
+    void clear() {
+        channels_.clear();
+        envelopes_.clear();
+        count_ = 0;
+        loop_ = NoteLoop();
+    }
+
+    void setLoop(NoteLoop loop) { loop_ = loop.length > 0.0f ? loop : NoteLoop(); }
+    const NoteLoop& loop() const { return loop_; }
+
+    size_t size() const { return count_; }
+    bool empty() const { return count_ == 0; }
+    int channelCount() const { return static_cast<int>(channels_.size()); }
+    size_t memoryBytes() const { return count_ * (sizeof(uint32_t) + sizeof(Body)) + envelopes_.size(); }
+
+    // Level 0-1 as an envelope level, 1-15
+    static int envelopeLevel(float velocity) {
+        return std::clamp(static_cast<int>(std::lround(velocity * 15.0f)), 1, 15);
+    }
+
+    // Add 'samples' samples of 'level' to an envelope being built (without
+    // its terminating 0), extending its last run if that has the same level
+    static void appendEnvelope(std::vector<uint8_t>& runs, int level, uint32_t samples) {
+        if (samples > 0 && !runs.empty() && (runs.back() >> 4) == level) {
+            uint32_t room = 15 - (runs.back() & 15);
+            uint32_t add = std::min(room, samples);
+            runs.back() = static_cast<uint8_t>(runs.back() + add);
+            samples -= add;
+        }
+        for (; samples > 0; samples -= std::min(samples, 16u)) {
+            runs.push_back(static_cast<uint8_t>(level << 4 | (std::min(samples, 16u) - 1)));
+        }
+    }
+
+    // Notes of one channel must arrive in start order, as preprocessing emits
+    // them; a note starting before the previous one ended is trimmed. The
+    // envelope, if any, is copied into the arena (note.envelope is ignored).
+    void append(const PianoRollNote& note, const uint8_t* envelope = nullptr) {
+        if (note.channel < 0 || note.midi_note < 0 || note.midi_note > 127) return;
+        if (note.channel >= channelCount()) channels_.resize(note.channel + 1);
+        Channel& ch = channels_[note.channel];
+
+        uint32_t origin = toTicks(note.start_time);
+        uint32_t start = origin;
+        uint32_t end = toTicks(note.end_time);
+        if (!ch.start.empty()) start = std::max(start, ch.start.back() + ch.body.back().duration);
+        uint8_t velocity = static_cast<uint8_t>(envelopeLevel(note.velocity));
+        while (end > start) {
+            uint32_t duration = std::min(end - start, MAX_DURATION);
+            uint32_t offset = PianoRollNote::NO_ENVELOPE;
+            if (envelope) {
+                offset = static_cast<uint32_t>(envelopes_.size());
+                copyEnvelope(envelope, (start - origin) / ENVELOPE_TICKS,
+                             (duration + ENVELOPE_TICKS - 1) / ENVELOPE_TICKS);
+            }
+            ch.start.push_back(start);
+            ch.body.push_back({static_cast<uint16_t>(duration), static_cast<uint8_t>(note.midi_note), velocity, offset});
+            start += duration;
+            ++count_;
+        }
+    }
+
+    // Notes in any order; each note's envelope is at its offset in 'envelopes'
+    void assign(std::vector<PianoRollNote> notes, const std::vector<uint8_t>& envelopes = {}) {
+        clear();
+        std::sort(notes.begin(), notes.end(), [](const PianoRollNote& a, const PianoRollNote& b) {
+            return a.channel != b.channel ? a.channel < b.channel : a.start_time < b.start_time;
+        });
+        for (const PianoRollNote& note : notes) {
+            append(note, note.envelope < envelopes.size() ? envelopes.data() + note.envelope : nullptr);
+        }
+    }
+
+    // Call fn(const PianoRollNote&) for every stored note (one pass of any
+    // loop), channel by channel
+    template <typename Fn>
+    void forEach(Fn&& fn) const {
+        for (int c = 0; c < channelCount(); ++c) {
+            const Channel& ch = channels_[c];
+            for (size_t i = 0; i < ch.start.size(); ++i) fn(unpack(c, ch, i));
+        }
+    }
+
+    // Unpacked copy of the stored notes, and of the arena their envelope
+    // offsets point into
+    std::vector<PianoRollNote> toNotes(std::vector<uint8_t>* envelopes = nullptr) const {
+        std::vector<PianoRollNote> notes;
+        notes.reserve(count_);
+        forEach([&notes](const PianoRollNote& note) { notes.push_back(note); });
+        if (envelopes) *envelopes = envelopes_;
+        return notes;
+    }
+
+    // Call fn(float start, float end, int level) for each stretch of a stored
+    // note's envelope, level 1-15, covering its start to its end; a note
+    // without an envelope is one stretch at its velocity. A note carried into
+    // a loop repeat has its envelope start again at the loop start.
+    template <typename Fn>
+    void forEachEnvelopeRun(const PianoRollNote& note, Fn&& fn) const {
+        int level = envelopeLevel(note.velocity);
+        float start = note.start_time;
+        if (note.envelope < envelopes_.size()) {
+            float period = ENVELOPE_TICKS / TICKS_PER_SECOND;
+            float time = start;
+            for (const uint8_t* run = envelopes_.data() + note.envelope; *run && time < note.end_time; ++run) {
+                int run_level = *run >> 4;
+                if (run_level != level && time > start) {
+                    fn(start, time, level);
+                    start = time;
+                }
+                level = run_level;
+                time += ((*run & 15) + 1) * period;
+            }
+        }
+        if (note.end_time > start) fn(start, note.end_time, level);
+    }
+
+    // Call fn(const PianoRollNote&) for every note sounding at some point of
+    // [time_begin, time_end], channel by channel, loop repeats included
+    template <typename Fn>
+    void forEachInRange(float time_begin, float time_end, Fn&& fn) const {
+        float loop_end = loop_.start + loop_.length;
+        if (loop_.length <= 0.0f || time_end < loop_end) {
+            forEachStored(time_begin, time_end, 0.0f, 0.0f, fn);
+            return;
+        }
+        if (time_begin < loop_end) forEachStored(time_begin, loop_end, 0.0f, 0.0f, fn);
+
+        // Pass k plays the loop again k lengths later; notes carried into the
+        // loop from before it start at its start
+        int first = std::max(1, static_cast<int>(std::floor((time_begin - loop_.start) / loop_.length)));
+        int last = static_cast<int>(std::floor((time_end - loop_.start) / loop_.length));
+        for (int k = first; k <= last; ++k) {
+            float offset = k * loop_.length;
+            float begin = std::max(time_begin - offset, loop_.start);
+            float end = std::min(time_end - offset, loop_end);
+            if (begin <= end) forEachStored(begin, end, offset, loop_.start, fn);
+        }
+    }
+
+private:
+    template <typename Fn>
+    void forEachStored(float time_begin, float time_end, float offset, float clip_start, Fn& fn) const {
+        uint32_t begin = toTicks(time_begin);
+        uint32_t end = toTicks(time_end);
+        for (int c = 0; c < channelCount(); ++c) {
+            const Channel& ch = channels_[c];
+            // The note before the first one starting after 'begin' may still be sounding
+            size_t i = std::upper_bound(ch.start.begin(), ch.start.end(), begin) - ch.start.begin();
+            if (i > 0 && ch.start[i - 1] + ch.body[i - 1].duration > begin) --i;
+            for (; i < ch.start.size() && ch.start[i] <= end; ++i) {
+                PianoRollNote note = unpack(c, ch, i);
+                note.start_time = std::max(note.start_time, clip_start) + offset;
+                note.end_time += offset;
+                fn(note);
+            }
+        }
+    }
+
+    static uint32_t toTicks(float seconds) {
+        return static_cast<uint32_t>(std::lround(std::max(0.0f, seconds) * TICKS_PER_SECOND));
+    }
+
+    static PianoRollNote unpack(int channel, const Channel& ch, size_t i) {
+        const Body& body = ch.body[i];
+        PianoRollNote note;
+        note.channel = channel;
+        note.midi_note = body.midi_note;
+        note.velocity = body.velocity / 15.0f;
+        note.start_time = ch.start[i] / TICKS_PER_SECOND;
+        note.end_time = (ch.start[i] + body.duration) / TICKS_PER_SECOND;
+        note.envelope = body.envelope;
+        return note;
+    }
+
+    // Append 'samples' samples of the envelope at 'src', from sample 'skip'
+    // on, and its end; past the end of the source its last level holds
+    void copyEnvelope(const uint8_t* src, uint32_t skip, uint32_t samples) {
+        int level = 0;
+        for (; *src && samples > 0; ++src) {
+            level = *src >> 4;
+            uint32_t run = (*src & 15) + 1;
+            uint32_t skipped = std::min(skip, run);
+            skip -= skipped;
+            run = std::min(run - skipped, samples);
+            if (run == 0) continue;
+            appendEnvelope(envelopes_, level, run);    // never merges into the 0 ending the note before
+            samples -= run;
+        }
+        if (level > 0 && samples > 0) appendEnvelope(envelopes_, level, samples);
+        envelopes_.push_back(0);
+    }
+
+    std::vector<Channel> channels_;
+    std::vector<uint8_t> envelopes_;
+    size_t count_ = 0;
+    NoteLoop loop_;
+};
@@ -0,0 +1,660 @@
+#include "NsfLibrary.h"
+#include "NoteCache.h"
+#include "MappedFile.h"
+#include "LoudnessMeter.h"
+#include "TrackLengthDetector.h"
+#include "ZipArchive.h"
+#include "gme/gme.h"
+#include "gme/Nsf_Emu.h"
+#include "Profiler.h"
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <system_error>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace fs = std::filesystem;
+
+// One scan: shared by the walk job and the read jobs it queues
+struct NsfLibrary::ScanState {
+    std::vector<std::string> roots;
+    Snapshot previous;
+    CancelToken cancel;                 // passed to every job of the scan
+    std::atomic<int> remaining{0};      // read jobs not finished yet
+    std::mutex mutex;
+    std::vector<Entry> results;         // unchanged entries plus every file read so far
+};
+
+// One measurement pass: a few chained jobs take the files in turn
+struct NsfLibrary::MeasureState {
+    Snapshot catalog;                   // measured from
+    std::vector<size_t> todo;           // entries with a track to measure
+    CancelToken cancel;                 // passed to every job of the pass
+    std::atomic<size_t> next{0};
+    std::atomic<int> chains{0};         // jobs still taking files
+    std::mutex mutex;
+    std::unordered_map<std::string, std::vector<Track>> results;  // not merged yet
+    std::mutex merge_mutex;
+};
+
+namespace {
+
+constexpr int FILES_PER_JOB = 64;
+constexpr int MEASURE_PUBLISH_FILES = 256;  // files measured between index saves
+
+bool needsMeasure(const NsfLibraryTrack& track) {
+    return track.fade_ms < 0 || std::isnan(track.lufs);
+}
+
+// Index file layout: header, root strings, then entries, all little-endian
+// as written; strings are a uint16_t length followed by the bytes
+struct IndexHeader {
+    char magic[4];          // "FCLB"
+    uint32_t version;
+    uint32_t root_count;
+    uint32_t entry_count;
+};
+
+class IndexWriter {
+public:
+    void bytes(const void* data, size_t size) {
+        const uint8_t* p = static_cast<const uint8_t*>(data);
+        out_.insert(out_.end(), p, p + size);
+    }
+    template <typename T>
+    void value(T v) { bytes(&v, sizeof(v)); }
+    void array(const std::vector<uint32_t>& values) {
+        value(static_cast<uint32_t>(values.size()));
+        bytes(values.data(), values.size() * sizeof(uint32_t));
+    }
+    void string(const std::string& s) {
+        uint16_t length = static_cast<uint16_t>(std::min<size_t>(s.size(), 0xFFFF));
+        value(length);
+        bytes(s.data(), length);
+    }
+    const std::vector<uint8_t>& data() const { return out_; }
+
+private:
+    std::vector<uint8_t> out_;
+};
+
+class IndexReader {
+public:
+    IndexReader(const uint8_t* data, size_t size) : p_(data), end_(data + size) {}
+    bool ok() const { return ok_; }
+
+    template <typename T>
+    T value() {
+        T v{};
+        if (static_cast<size_t>(end_ - p_) < sizeof(T)) {
+            ok_ = false;
+            return v;
+        }
+        memcpy(&v, p_, sizeof(T));
+        p_ += sizeof(T);
+        return v;
+    }
+    std::vector<uint32_t> array() {
+        uint32_t count = value<uint32_t>();
+        if (!ok_ || static_cast<size_t>(end_ - p_) / sizeof(uint32_t) < count) {
+            ok_ = false;
+            return {};
+        }
+        std::vector<uint32_t> values(count);
+        memcpy(values.data(), p_, count * sizeof(uint32_t));
+        p_ += count * sizeof(uint32_t);
+        return values;
+    }
+    std::string string() {
+        uint16_t length = value<uint16_t>();
+        if (!ok_ || static_cast<size_t>(end_ - p_) < length) {
+            ok_ = false;
+            return std::string();
+        }
+        std::string s(reinterpret_cast<const char*>(p_), length);
+        p_ += length;
+        return s;
+    }
+
+private:
+    const uint8_t* p_;
+    const uint8_t* end_;
+    bool ok_ = true;
+};
+
+} // namespace
+
+NsfLibrary::NsfLibrary() : entries_(std::make_shared<const Catalog>()) {}
+
+std::string NsfLibrary::indexPath() {
+    const std::string& notes_dir = NoteCache::cacheDirectory();
+    if (notes_dir.empty()) return std::string();
+    return (fs::path(notes_dir).parent_path() / "library.idx").string();
+}
+
+bool NsfLibrary::loadIndex() {
+    MemoryScope memory(MemoryTag::Caches);
+    auto start = std::chrono::steady_clock::now();
+    std::string path = indexPath();
+    if (path.empty()) return false;
+
+    MappedFile file;
+    if (!file.open(path.c_str())) return false;
+
+    IndexReader in(file.data(), file.size());
+    IndexHeader header = in.value<IndexHeader>();
+    if (!in.ok() || memcmp(header.magic, "FCLB", 4) != 0 || header.version != VERSION) return false;
+
+    std::vector<std::string> roots;
+    for (uint32_t i = 0; i < header.root_count && in.ok(); ++i) roots.push_back(in.string());
+
+    auto catalog = std::make_shared<Catalog>();
+    std::vector<Entry>& entries = catalog->entries;
+    entries.reserve(std::min<uint32_t>(header.entry_count, static_cast<uint32_t>(file.size() / 16)));
+    for (uint32_t i = 0; i < header.entry_count && in.ok(); ++i) {
+        Entry entry;
+        entry.path = in.string();
+        entry.size = in.value<uint64_t>();
+        entry.mtime = in.value<int64_t>();
+        entry.nsfe = in.value<uint8_t>() != 0;
+        entry.chips = in.value<uint8_t>();
+        entry.game = in.string();
+        entry.author = in.string();
+        entry.copyright = in.string();
+        uint16_t track_count = in.value<uint16_t>();
+        entry.tracks.resize(track_count);
+        for (Track& track : entry.tracks) {
+            track.name = in.string();
+            track.length_ms = in.value<int32_t>();
+            track.fade_ms = in.value<int32_t>();
+            track.lufs = in.value<float>();
+            track.peak_db = in.value<float>();
+        }
+        entries.push_back(std::move(entry));
+    }
+    std::vector<uint32_t> keys = in.array();
+    std::vector<uint32_t> offsets = in.array();
+    std::vector<uint32_t> ids = in.array();
+    if (!in.ok()) return false;
+    if (!catalog->search.assign(std::move(keys), std::move(offsets), std::move(ids), entries.size())) {
+        catalog->search.build(entries);
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        roots_ = std::move(roots);
+    }
+    publish(std::move(catalog));
+    load_ms_ = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    return true;
+}
+
+bool NsfLibrary::saveIndex(const Catalog& catalog, const std::vector<std::string>& roots) const {
+    std::string path = indexPath();
+    if (path.empty()) return false;
+
+    const std::vector<Entry>& entries = catalog.entries;
+    IndexWriter out;
+    IndexHeader header;
+    memcpy(header.magic, "FCLB", 4);
+    header.version = VERSION;
+    header.root_count = static_cast<uint32_t>(roots.size());
+    header.entry_count = static_cast<uint32_t>(entries.size());
+    out.value(header);
+    for (const std::string& root : roots) out.string(root);
+    for (const Entry& entry : entries) {
+        out.string(entry.path);
+        out.value(entry.size);
+        out.value(entry.mtime);
+        out.value<uint8_t>(entry.nsfe);
+        out.value(entry.chips);
+        out.string(entry.game);
+        out.string(entry.author);
+        out.string(entry.copyright);
+        uint16_t track_count = static_cast<uint16_t>(std::min<size_t>(entry.tracks.size(), 0xFFFF));
+        out.value(track_count);
+        for (uint16_t t = 0; t < track_count; ++t) {
+            out.string(entry.tracks[t].name);
+            out.value(entry.tracks[t].length_ms);
+            out.value(entry.tracks[t].fade_ms);
+            out.value(entry.tracks[t].lufs);
+            out.value(entry.tracks[t].peak_db);
+        }
+    }
+    out.array(catalog.search.keys());
+    out.array(catalog.search.offsets());
+    out.array(catalog.search.ids());
+
+    // Temp file and rename, as the note cache does, so a crash never leaves half an index
+    std::string temp_path = path + ".tmp";
+    FILE* f = fopen(temp_path.c_str(), "wb");
+    if (!f) return false;
+    bool ok = fwrite(out.data().data(), 1, out.data().size(), f) == out.data().size();
+    ok = (fclose(f) == 0) && ok;
+
+    std::error_code ec;
+    if (ok) {
+        fs::rename(temp_path, path, ec);
+        ok = !ec;
+    }
+    if (!ok) fs::remove(temp_path, ec);
+    return ok;
+}
+
+// Header and track info only: gme_info_only skips all sound setup
+bool NsfLibrary::readEntry(Entry& entry) {
+    MappedFile file;
+    if (!file.open(entry.path.c_str()) || file.size() < 4) return false;
+
+    gme_type_t type = gme_identify_extension(gme_identify_header(file.data()));
+    if (type != gme_nsf_type && type != gme_nsfe_type) return false;
+    entry.nsfe = type == gme_nsfe_type;
+
+    Music_Emu* emu = nullptr;
+    if (gme_open_data(file.data(), static_cast<long>(file.size()), &emu, gme_info_only)) return false;
+
+    fs::path m3u = fs::path(entry.path).replace_extension(".m3u");
+    std::error_code ec;
+    if (fs::exists(m3u, ec)) gme_load_m3u(emu, m3u.string().c_str());
+
+    if (const Nsf_Emu* nsf = dynamic_cast<const Nsf_Emu*>(emu)) entry.chips = nsf->header().chip_flags;
+
+    int count = gme_track_count(emu);
+    entry.tracks.resize(count);
+    for (int t = 0; t < count; ++t) {
+        track_info_t info;
+        if (gme_track_info(emu, &info, t)) {
+            entry.tracks[t] = {std::string(), -1};
+            continue;
+        }
+        if (t == 0) {
+            entry.game = info.game;
+            entry.author = info.author;
+            entry.copyright = info.copyright;
+        }
+        entry.tracks[t] = {info.song, static_cast<int32_t>(info.length)};
+    }
+    gme_delete(emu);
+    return true;
+}
+
+bool NsfLibrary::isLibraryFile(const fs::path& path, bool& nsfe) {
+    std::string ext = path.extension().string();
+    std::transform(ext.begin(), ext.end(), ext.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    nsfe = ext == ".nsfe";
+    return nsfe || ext == ".nsf";
+}
+
+NsfLibrary::Snapshot NsfLibrary::snapshot() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return entries_;
+}
+
+void NsfLibrary::publish(std::shared_ptr<const Catalog> catalog) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    entries_ = std::move(catalog);
+    version_.fetch_add(1);
+}
+
+std::vector<std::string> NsfLibrary::roots() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return roots_;
+}
+
+void NsfLibrary::roots(std::vector<std::string>& out) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    out.assign(roots_.begin(), roots_.end());
+}
+
+void NsfLibrary::addRoot(const std::string& dir) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (std::find(roots_.begin(), roots_.end(), dir) == roots_.end()) roots_.push_back(dir);
+}
+
+void NsfLibrary::removeRoot(const std::string& dir) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    roots_.erase(std::remove(roots_.begin(), roots_.end(), dir), roots_.end());
+}
+
+void NsfLibrary::scan(JobSystem& jobs) {
+    cancelMeasure();
+    cancelScan();
+
+    auto scan = std::make_shared<ScanState>();
+    scan->roots = roots();
+    scan->previous = snapshot();
+    scan_total_.store(0);
+    scan_done_.store(0);
+    scanning_.store(true);
+
+    // Finished or cancelled: the last job to let go publishes
+    auto finish = [this](ScanState& s) {
+        if (s.cancel.isCancelled()) return;
+        auto catalog = std::make_shared<Catalog>();
+        catalog->entries = std::move(s.results);
+        std::sort(catalog->entries.begin(), catalog->entries.end(),
+                  [](const Entry& a, const Entry& b) { return a.path < b.path; });
+        catalog->search.build(catalog->entries);
+        saveIndex(*catalog, s.roots);
+        publish(std::move(catalog));
+        scanning_.store(false);
+    };
+
+    JobHandle walk = jobs.submit([this, scan, finish, &jobs](const Job& job) {
+        MemoryScope memory(MemoryTag::Caches);
+        // Unchanged files keep their entry; everything else is read again
+        std::unordered_map<std::string, const Entry*> known;
+        for (const Entry& entry : scan->previous->entries) known.emplace(entry.path, &entry);
+
+        std::vector<Entry> todo;
+        std::unordered_set<std::string> seen;  // overlapping roots list a file once
+        auto consider = [&](Entry&& entry) {
+            if (!seen.insert(entry.path).second) return;
+            auto found = known.find(entry.path);
+            if (found != known.end() && found->second->size == entry.size && found->second->mtime == entry.mtime) {
+                scan->results.push_back(*found->second);
+            } else {
+                todo.push_back(std::move(entry));
+            }
+        };
+        for (const std::string& root : scan->roots) {
+            std::error_code ec;
+            fs::recursive_directory_iterator it(root, fs::directory_options::skip_permission_denied, ec);
+            for (; !ec && it != fs::recursive_directory_iterator(); it.increment(ec)) {
+                if (job.isCancelled()) return;
+                bool nsfe = false;
+                if (!it->is_regular_file(ec)) continue;
+                if (isLibraryFile(it->path(), nsfe)) {
+                    Entry entry;
+                    entry.path = it->path().string();
+                    entry.size = it->file_size(ec);
+                    entry.mtime = it->last_write_time(ec).time_since_epoch().count();
+                    entry.nsfe = nsfe;
+                    consider(std::move(entry));
+                } else if (ZipArchive::isArchive(it->path().string())) {
+                    // Members are listed from the central directory alone and
+                    // share the archive's time: rewriting it re-reads them all
+                    ZipArchive archive;
+                    if (!archive.open(it->path().string().c_str())) continue;
+                    int64_t mtime = it->last_write_time(ec).time_since_epoch().count();
+                    for (const ZipArchive::Member& member : archive.members()) {
+                        if (!isLibraryFile(fs::path(member.name), nsfe)) continue;
+                        Entry entry;
+                        entry.path = ZipArchive::memberPath(it->path().string(), member.name);
+                        entry.size = member.size;
+                        entry.mtime = mtime;
+                        entry.nsfe = nsfe;
+                        consider(std::move(entry));
+                    }
+                }
+            }
+        }
+
+        scan_total_.store(static_cast<int>(todo.size()));
+        int chunks = static_cast<int>((todo.size() + FILES_PER_JOB - 1) / FILES_PER_JOB);
+        if (chunks == 0) {
+            finish(*scan);
+            return;
+        }
+
+        scan->remaining.store(chunks);
+        auto shared_todo = std::make_shared<std::vector<Entry>>(std::move(todo));
+        for (int c = 0; c < chunks; ++c) {
+            JobHandle read = jobs.submit([this, scan, shared_todo, c, finish](const Job& read_job) {
+                MemoryScope memory(MemoryTag::Caches);
+                size_t begin = static_cast<size_t>(c) * FILES_PER_JOB;
+                size_t end = std::min(begin + FILES_PER_JOB, shared_todo->size());
+                std::vector<Entry> read_entries;
+                for (size_t i = begin; i < end && !read_job.isCancelled(); ++i) {
+                    Entry& entry = (*shared_todo)[i];
+                    if (readEntry(entry)) read_entries.push_back(std::move(entry));
+                    scan_done_.fetch_add(1);
+                    read_job.setProgress(static_cast<float>(i + 1 - begin) / (end - begin));
+                }
+                bool last;
+                {
+                    std::lock_guard<std::mutex> lock(scan->mutex);
+                    for (Entry& entry : read_entries) scan->results.push_back(std::move(entry));
+                    last = scan->remaining.fetch_sub(1) == 1;
+                }
+                if (last) finish(*scan);
+            }, JobPriority::BATCH, "Library scan", &scan->cancel);
+            std::lock_guard<std::mutex> lock(mutex_);
+            scan_jobs_.push_back(std::move(read));
+        }
+    }, JobPriority::BATCH, "Library scan", &scan->cancel);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    scan_ = scan;
+    scan_jobs_.push_back(std::move(walk));
+}
+
+void NsfLibrary::cancelScan() {
+    std::shared_ptr<ScanState> scan;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        scan = std::move(scan_);
+    }
+    if (scan) scan->cancel.cancel();
+
+    // The walk job may still be queueing read jobs while the first batch is waited on
+    for (;;) {
+        std::vector<JobHandle> jobs;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            jobs.swap(scan_jobs_);
+        }
+        if (jobs.empty()) break;
+        for (JobHandle& job : jobs) job->cancel();
+        for (JobHandle& job : jobs) job->wait();
+    }
+    scanning_.store(false);
+}
+
+const NsfLibrary::Entry* NsfLibrary::find(const Catalog& catalog, std::string_view path) {
+    auto found = std::lower_bound(catalog.entries.begin(), catalog.entries.end(), path,
+                                  [](const Entry& entry, std::string_view p) { return entry.path < p; });
+    return found != catalog.entries.end() && found->path == path ? &*found : nullptr;
+}
+
+float NsfLibrary::trackGainDb(const Track& track) {
+    if (std::isnan(track.lufs) || !LoudnessMeter::hasSignal(track.lufs)) return 0.0f;
+    float gain = REFERENCE_LUFS - track.lufs;
+    if (!std::isnan(track.peak_db) && LoudnessMeter::hasSignal(track.peak_db)) {
+        gain = std::min(gain, -track.peak_db);
+    }
+    return std::clamp(gain, -24.0f, 12.0f);
+}
+
+// Find the end of, then render, the unmeasured tracks of one file; a track
+// that cannot be played is marked silent with no end so it is not tried again
+void NsfLibrary::measureEntry(const Entry& entry, std::vector<Track>& tracks, const Job& job) {
+    auto mark_silent = [&](size_t first) {
+        for (size_t t = first; t < tracks.size(); ++t) {
+            if (std::isnan(tracks[t].lufs)) tracks[t].lufs = tracks[t].peak_db = LoudnessMeter::NO_SIGNAL;
+            if (tracks[t].fade_ms < 0) tracks[t].fade_ms = 0;
+        }
+    };
+
+    MappedFile file;
+    Music_Emu* emu = nullptr;
+    if (!file.open(entry.path.c_str()) ||
+        gme_open_data(file.data(), static_cast<long>(file.size()), &emu, MEASURE_RATE) || !emu) {
+        mark_silent(0);
+        return;
+    }
+    fs::path m3u = fs::path(entry.path).replace_extension(".m3u");
+    std::error_code ec;
+    if (fs::exists(m3u, ec)) gme_load_m3u(emu, m3u.string().c_str());
+    gme_set_fast_synth(emu, 1);  // aliasing barely moves the loudness
+
+    constexpr int CHUNK = 2048;
+    std::vector<short> samples(CHUNK * 2);
+    std::vector<float> frames(CHUNK * 2);
+    LoudnessMeter meter;
+    meter.setSampleRate(MEASURE_RATE);
+    TrackLengthDetector detector;
+    Nsf_Emu* nsf = dynamic_cast<Nsf_Emu*>(emu);
+    int count = std::min(static_cast<int>(tracks.size()), gme_track_count(emu));
+    for (int t = 0; t < count; ++t) {
+        Track& track = tracks[t];
+        if (!needsMeasure(track)) continue;
+
+        // The file's length gets the usual fade; without one the trace finds the end
+        if (track.fade_ms < 0 && track.length_ms > 0) {
+            track.fade_ms = DEFAULT_FADE_MS;
+        } else if (track.fade_ms < 0) {
+            TrackLengthDetector::Result end;
+            if (nsf && detector.detect(*nsf, t, end, [&job]() { return job.isCancelled(); })) {
+                track.length_ms = end.length_ms;
+                track.fade_ms = end.fade_ms;
+            } else if (job.isCancelled()) {
+                gme_delete(emu);
+                return;
+            } else {
+                track.fade_ms = 0;
+            }
+        }
+
+        if (!std::isnan(track.lufs)) continue;
+        if (gme_start_track(emu, t)) {
+            track.lufs = track.peak_db = LoudnessMeter::NO_SIGNAL;
+            continue;
+        }
+        meter.reset();
+        float seconds = track.length_ms > 0 ? std::min(track.length_ms / 1000.0f, MEASURE_SECONDS) : MEASURE_SECONDS;
+        long total = static_cast<long>(seconds * MEASURE_RATE);
+        for (long done = 0; done < total && !gme_track_ended(emu); done += CHUNK) {
+            if (job.isCancelled()) {
+                gme_delete(emu);
+                return;
+            }
+            int n = static_cast<int>(std::min<long>(CHUNK, total - done));
+            if (gme_play(emu, n * 2, samples.data())) break;
+            for (int i = 0; i < n * 2; ++i) frames[i] = samples[i] * (1.0f / 32768.0f);
+            meter.process(frames.data(), n);
+        }
+        track.lufs = meter.integrated();
+        track.peak_db = meter.truePeak();
+    }
+    gme_delete(emu);
+    mark_silent(count);
+}
+
+bool NsfLibrary::measureTracks(JobSystem& jobs) {
+    if (isScanning()) return false;
+    cancelMeasure();
+
+    auto measure = std::make_shared<MeasureState>();
+    measure->catalog = snapshot();
+    const std::vector<Entry>& entries = measure->catalog->entries;
+    for (size_t i = 0; i < entries.size(); ++i) {
+        for (const Track& track : entries[i].tracks) {
+            if (needsMeasure(track)) {
+                measure->todo.push_back(i);
+                break;
+            }
+        }
+    }
+    if (measure->todo.empty()) return false;
+
+    measure_total_.store(static_cast<int>(measure->todo.size()));
+    measure_done_.store(0);
+    measuring_.store(true);
+    int chains = std::min(std::max(1, jobs.workerCount() - 1), static_cast<int>(measure->todo.size()));
+    measure->chains.store(chains);
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        measure_ = measure;
+    }
+    for (int c = 0; c < chains; ++c) measureNext(measure, jobs);
+    return true;
+}
+
+// Queue the job that takes the next file; each job queues its successor, so
+// only 'chains' jobs are ever waiting and others can run between them
+void NsfLibrary::measureNext(const std::shared_ptr<MeasureState>& measure, JobSystem& jobs) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (measure->cancel.isCancelled()) return;
+    measure_jobs_.erase(std::remove_if(measure_jobs_.begin(), measure_jobs_.end(),
+                                       [](const JobHandle& job) { return job->isDone(); }),
+                        measure_jobs_.end());
+    measure_jobs_.push_back(jobs.submit([this, measure, &jobs](const Job& job) {
+        if (job.isCancelled()) return;
+        size_t index = measure->next.fetch_add(1);
+        if (index >= measure->todo.size()) {
+            // The last chain to run out publishes what is left
+            if (measure->chains.fetch_sub(1) == 1) {
+                mergeMeasured(*measure);
+                measuring_.store(false);
+            }
+            return;
+        }
+
+        const Entry& entry = measure->catalog->entries[measure->todo[index]];
+        std::vector<Track> tracks = entry.tracks;
+        measureEntry(entry, tracks, job);
+        if (job.isCancelled()) return;
+        {
+            std::lock_guard<std::mutex> results_lock(measure->mutex);
+            measure->results[entry.path] = std::move(tracks);
+        }
+        if (measure_done_.fetch_add(1) % MEASURE_PUBLISH_FILES == MEASURE_PUBLISH_FILES - 1) {
+            mergeMeasured(*measure);
+        }
+        measureNext(measure, jobs);
+    }, JobPriority::BATCH, "Track lengths", &measure->cancel));
+}
+
+// Fold measured tracks into a copy of the current catalog, then save and publish it
+void NsfLibrary::mergeMeasured(MeasureState& measure) {
+    std::lock_guard<std::mutex> merge_lock(measure.merge_mutex);
+    std::unordered_map<std::string, std::vector<Track>> results;
+    {
+        std::lock_guard<std::mutex> lock(measure.mutex);
+        results.swap(measure.results);
+    }
+    if (results.empty()) return;
+
+    auto catalog = std::make_shared<Catalog>(*snapshot());
+    for (Entry& entry : catalog->entries) {
+        auto found = results.find(entry.path);
+        if (found != results.end() && found->second.size() == entry.tracks.size()) {
+            entry.tracks = std::move(found->second);
+        }
+    }
+    saveIndex(*catalog, roots());
+    publish(std::move(catalog));
+}
+
+void NsfLibrary::cancelMeasure() {
+    std::shared_ptr<MeasureState> measure;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        measure = std::move(measure_);
+    }
+    if (measure) measure->cancel.cancel();
+
+    // A finishing job may queue its successor while the others are waited on
+    for (;;) {
+        std::vector<JobHandle> jobs;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            jobs.swap(measure_jobs_);
+        }
+        if (jobs.empty()) break;
+        for (JobHandle& job : jobs) job->cancel();
+        for (JobHandle& job : jobs) job->wait();
+    }
+    measuring_.store(false);
+}
+
+void NsfLibrary::shutdown() {
+    cancelMeasure();
+    cancelScan();
+}
@@ -0,0 +1,149 @@
+#pragma once
+
+#include "JobSystem.h"
+#include "LibrarySearch.h"
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+struct NsfLibraryTrack {
+    std::string name;       // empty if the file has none
+    int32_t length_ms;      // fade start, from the file or detected; -1 if unknown
+    int32_t fade_ms = -1;   // fade after length_ms, -1 until the end is known
+    float lufs = NAN;       // integrated loudness, NaN until measured
+    float peak_db = NAN;    // true peak, dBTP
+};
+
+struct NsfLibraryEntry {
+    std::string path;
+    uint64_t size = 0;
+    int64_t mtime = 0;      // filesystem clock ticks, only compared for equality
+    bool nsfe = false;
+    uint8_t chips = 0;      // NSF expansion chip flags (ChannelLayout::Chip)
+    std::string game;
+    std::string author;
+    std::string copyright;
+    std::vector<NsfLibraryTrack> tracks;
+};
+
+// Browsable index of the NSF/NSFe files under a set of library folders.
+// Scans walk the folders, skip files whose size and modification time match
+// the index, and read the rest on the shared job workers: only the header
+// and gme's track info (with a same-named .m3u playlist applied) are kept,
+// never any audio. The index is stored as one compact file in the per-user
+// cache directory and reloaded at startup. A zip archive in a folder counts
+// as a folder of its NSF/NSFe members (see ZipArchive.h). Readers take an
+// immutable snapshot, so the UI never waits for a scan or a search rebuild.
+//
+// A second, slower pass measures each track on a few of the job workers
+// and stores the results in the index: a track without length info has its
+// loop or silent end found by a register trace (TrackLengthDetector), then
+// it is rendered at a low sample rate through a LoudnessMeter for playback
+// gain, the first MEASURE_SECONDS of it (most NSF tracks loop well within
+// that).
+class NsfLibrary {
+public:
+    // v2: the search index is stored after the entries
+    // v3: per-track loudness and true peak
+    // v4: per-track fade, detected lengths
+    static constexpr uint32_t VERSION = 4;
+
+    static constexpr long MEASURE_RATE = 24000;
+    static constexpr float MEASURE_SECONDS = 60.0f;
+    static constexpr float REFERENCE_LUFS = -18.0f;     // ReplayGain 2.0 reference level
+    static constexpr int32_t DEFAULT_FADE_MS = 8000;    // after a length given by the file
+
+    using Track = NsfLibraryTrack;
+    using Entry = NsfLibraryEntry;
+
+    // Entries sorted by path and the search index built over them
+    struct Catalog {
+        std::vector<Entry> entries;
+        LibrarySearch search;
+    };
+    using Snapshot = std::shared_ptr<const Catalog>;
+
+    NsfLibrary();
+    ~NsfLibrary() { shutdown(); }
+
+    // Read the on-disk index; false if there is none or it is stale
+    bool loadIndex();
+    double loadMilliseconds() const { return load_ms_; }
+
+    // Replaced wholesale when a scan finishes
+    Snapshot snapshot() const;
+    // Bumped whenever the snapshot changes
+    uint32_t version() const { return version_.load(); }
+
+    std::vector<std::string> roots() const;
+    // Same, assigned over out's strings, so an unchanged list allocates nothing
+    void roots(std::vector<std::string>& out) const;
+    void addRoot(const std::string& dir);   // and rescan
+    void removeRoot(const std::string& dir);
+
+    // Rescan all roots on 'jobs'; a running scan is cancelled first
+    void scan(JobSystem& jobs);
+    bool isScanning() const { return scanning_.load(); }
+    int scanTotal() const { return scan_total_.load(); }
+    int scanDone() const { return scan_done_.load(); }
+
+    // Measure every track without an end or a loudness yet, on all but one
+    // worker so interactive jobs still get through; false if there is nothing
+    // to do. Results are published as they accumulate. A file scan cancels it.
+    bool measureTracks(JobSystem& jobs);
+    bool isMeasuring() const { return measuring_.load(); }
+    int measureTotal() const { return measure_total_.load(); }
+    int measureDone() const { return measure_done_.load(); }
+
+    // Gain that brings the track to REFERENCE_LUFS, held down so its true
+    // peak stays under 0 dBTP; 0 dB if it is unmeasured or silent
+    static float trackGainDb(const Track& track);
+
+    // Entry for a path in a catalog, null if it is not indexed
+    static const Entry* find(const Catalog& catalog, std::string_view path);
+
+    // .nsf or .nsfe, going by the extension
+    static bool isLibraryFile(const std::filesystem::path& path, bool& nsfe);
+    // Header and track info of entry.path (with a same-named .m3u playlist
+    // applied), no audio; false if it isn't an NSF/NSFe file
+    static bool readEntry(Entry& entry);
+
+    // Cancel any scan or measurement and wait for its jobs
+    void shutdown();
+
+private:
+    struct ScanState;
+    struct MeasureState;
+
+    static std::string indexPath();
+    bool saveIndex(const Catalog& catalog, const std::vector<std::string>& roots) const;
+    void publish(std::shared_ptr<const Catalog> catalog);
+    void cancelScan();
+    void cancelMeasure();
+    void measureNext(const std::shared_ptr<MeasureState>& measure, JobSystem& jobs);
+    void mergeMeasured(MeasureState& measure);
+    static void measureEntry(const Entry& entry, std::vector<Track>& tracks, const Job& job);
+
+    mutable std::mutex mutex_;
+    Snapshot entries_;
+    std::vector<std::string> roots_;
+    std::vector<JobHandle> scan_jobs_;
+    std::shared_ptr<ScanState> scan_;
+    std::vector<JobHandle> measure_jobs_;
+    std::shared_ptr<MeasureState> measure_;
+
+    std::atomic<uint32_t> version_{0};
+    std::atomic<bool> scanning_{false};
+    std::atomic<int> scan_total_{0};
+    std::atomic<int> scan_done_{0};
+    std::atomic<bool> measuring_{false};
+    std::atomic<int> measure_total_{0};
+    std::atomic<int> measure_done_{0};
+    double load_ms_ = 0.0;
+};
@@ -0,0 +1,181 @@
+#include "OverlayFeed.h"
+#include "PianoVisualizer.h"
+#include "SeqLock.h"
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdio>
+#include <new>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+struct OverlayFeed::Segment {
+    OverlayFeedHeader header;
+    SeqLock<OverlayFeedPayload> payload;    // sequence word, then the payload words
+};
+
+bool OverlayFeed::open(AnalysisGraph& analysis) {
+    static_assert(offsetof(Segment, payload) == sizeof(OverlayFeedHeader), "sequence right after the header");
+    static_assert(sizeof(SeqLock<OverlayFeedPayload>) >= sizeof(uint32_t) + sizeof(OverlayFeedPayload),
+                  "payload words follow the sequence");
+    if (segment_) return true;
+
+    void* view = nullptr;
+#ifdef _WIN32
+    HANDLE mapping = CreateFileMappingA(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE, 0,
+                                        static_cast<DWORD>(sizeof(Segment)), SEGMENT_NAME);
+    if (!mapping) return false;
+    view = MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, sizeof(Segment));
+    if (!view) {
+        CloseHandle(mapping);
+        return false;
+    }
+    mapping_ = mapping;
+#else
+    // Readable by other users' overlay tools; only we write
+    int fd = shm_open(SEGMENT_NAME, O_CREAT | O_RDWR, 0644);
+    if (fd < 0) return false;
+    if (ftruncate(fd, static_cast<off_t>(sizeof(Segment))) != 0) {
+        ::close(fd);
+        return false;
+    }
+    view = mmap(nullptr, sizeof(Segment), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (view == MAP_FAILED) {
+        ::close(fd);
+        return false;
+    }
+    fd_ = fd;
+#endif
+
+    // Readers that map it before the header is complete see open == 0
+    segment_ = new (view) Segment();
+    OverlayFeedHeader& header = segment_->header;
+    header.magic = MAGIC;
+    header.version = VERSION;
+    header.segment_size = sizeof(Segment);
+    header.sequence_offset = offsetof(Segment, payload);
+    header.payload_offset = header.sequence_offset + sizeof(uint32_t);
+    header.payload_size = sizeof(OverlayFeedPayload);
+#ifdef _WIN32
+    header.writer_pid = GetCurrentProcessId();
+#else
+    header.writer_pid = static_cast<uint32_t>(getpid());
+#endif
+    std::atomic_thread_fence(std::memory_order_release);
+    header.open = 1;
+
+    payload_ = OverlayFeedPayload{};
+    for (int8_t& note : payload_.notes) note = -1;
+    payload_.lufs_momentary = payload_.lufs_short_term = LoudnessMeter::NO_SIGNAL;
+    analysis_ = &analysis;
+    subscription_ = analysis.subscribe(AnalysisGraph::NODE_SPECTRUM | AnalysisGraph::NODE_LEVELS |
+                                       AnalysisGraph::NODE_LOUDNESS);
+    return true;
+}
+
+void OverlayFeed::close() {
+    if (!segment_) return;
+    if (analysis_ && subscription_) analysis_->unsubscribe(subscription_);
+    subscription_.reset();
+    analysis_ = nullptr;
+
+    segment_->header.open = 0;
+    std::atomic_thread_fence(std::memory_order_release);
+    unmap();
+}
+
+void OverlayFeed::unmap() {
+    segment_->~Segment();
+#ifdef _WIN32
+    UnmapViewOfFile(segment_);
+    CloseHandle(mapping_);
+    mapping_ = nullptr;
+#else
+    munmap(segment_, sizeof(Segment));
+    ::close(fd_);
+    fd_ = -1;
+    // Readers keep what they mapped; the next open starts a fresh segment
+    shm_unlink(SEGMENT_NAME);
+#endif
+    segment_ = nullptr;
+}
+
+void OverlayFeed::publish(const ApuFrameSnapshot& snapshot, const ChannelLayout& layout, double time,
+                          bool playing) {
+    if (!segment_) return;
+    OverlayFeedPayload& out = payload_;
+    ++out.frame;
+    out.time = time;
+    out.flags = (playing ? OverlayFeedPayload::PLAYING : 0) | (snapshot.active ? OverlayFeedPayload::APU_ACTIVE : 0);
+
+    // Names and colours only change with the layout
+    int count = snapshot.active ? std::min(snapshot.channel_count, layout.size()) : 0;
+    if (out.channel_count != static_cast<uint32_t>(layout.size()) || out.chips != layout.chips) {
+        out.channel_count = static_cast<uint32_t>(layout.size());
+        out.chips = layout.chips;
+        for (int ch = 0; ch < OverlayFeedPayload::CHANNELS; ++ch) {
+            bool used = ch < layout.size();
+            snprintf(out.names[ch], sizeof(out.names[ch]), "%s", used ? layout[ch].name : "");
+            out.colors[ch] = used ? layout[ch].rgb : 0;
+            out.kinds[ch] = used ? static_cast<uint8_t>(layout[ch].kind) : 0;
+        }
+    }
+
+    for (int ch = 0; ch < OverlayFeedPayload::CHANNELS; ++ch) {
+        bool valid = ch < count;
+        out.periods[ch] = valid ? snapshot.periods[ch] : 0;
+        out.lengths[ch] = valid ? snapshot.lengths[ch] : 0;
+        out.amplitudes[ch] = valid ? snapshot.amplitudes[ch] : 0;
+        out.volumes[ch] = valid ? snapshot.volumes[ch] : 0;
+
+        int note = -1;
+        float velocity = 0.0f;
+        if (valid && !PianoVisualizer::channelNote(layout, snapshot, ch, &note, &velocity)) note = -1;
+        uint8_t velocity7 = static_cast<uint8_t>(std::clamp(std::lround(velocity * 127.0f), 0L, 127L));
+
+        // A note starting, or the channel moving to another one, is a note-on
+        if (note >= 0 && note != out.notes[ch]) {
+            OverlayNoteEvent& event = out.events[out.note_on_count % OverlayFeedPayload::NOTE_EVENTS];
+            event.time = time;
+            event.channel = static_cast<uint8_t>(ch);
+            event.note = static_cast<uint8_t>(note);
+            event.velocity = std::max<uint8_t>(velocity7, 1);
+            event.kind = out.kinds[ch];
+            event.reserved = 0;
+            ++out.note_on_count;
+        }
+        out.notes[ch] = static_cast<int8_t>(note);
+        out.velocities[ch] = note >= 0 ? velocity7 : 0;
+    }
+
+    // The graph ticks faster than frames; the newest tick is enough
+    if (subscription_->acquire()) {
+        const AnalysisGraph::Frame& frame = subscription_->frame();
+        // The feed keeps its bar count whatever the resolution: each feed
+        // bar is the loudest of the display bars it covers, or repeats the
+        // one it falls in when there are fewer
+        const int bins = static_cast<int>(frame.spectrum.size());
+        for (int i = 0; i < OverlayFeedPayload::SPECTRUM_BINS && bins > 0; ++i) {
+            int begin = i * bins / OverlayFeedPayload::SPECTRUM_BINS;
+            int end = std::max(begin + 1, (i + 1) * bins / OverlayFeedPayload::SPECTRUM_BINS);
+            float level = 0.0f;
+            for (int b = begin; b < end; ++b) level = std::max(level, frame.spectrum[b]);
+            out.spectrum[i] = level;
+        }
+        out.spectrum_scale = static_cast<uint32_t>(analysis_->spectrumScale());
+        out.rms_left = frame.rms_left;
+        out.rms_right = frame.rms_right;
+        out.peak = frame.peak;
+        out.lufs_momentary = frame.lufs_momentary;
+        out.lufs_short_term = frame.lufs_short_term;
+    }
+
+    segment_->payload.store(out);
+}
@@ -0,0 +1,134 @@
+#pragma once
+
+#include "AnalysisGraph.h"
+#include "ApuSnapshot.h"
+#include "ChannelLayout.h"
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+
+// The published layout. Plain fixed-width fields, so a reader in another
+// process (and language) can declare the same structs.
+struct OverlayNoteEvent {
+    double time;                    // playback seconds the note started at
+    uint8_t channel;                // layout index
+    uint8_t note;                   // MIDI note
+    uint8_t velocity;               // 1-127
+    uint8_t kind;                   // ChannelKind
+    uint32_t reserved;
+};
+
+struct OverlayFeedPayload {
+    static constexpr int CHANNELS = 19;
+    static constexpr int SPECTRUM_BINS = 64;
+    static constexpr int NOTE_EVENTS = 64;
+    static constexpr int NAME_SIZE = 16;
+
+    static constexpr uint32_t PLAYING = 1 << 0;
+    static constexpr uint32_t APU_ACTIVE = 1 << 1;  // channel fields are valid
+
+    uint64_t frame;                 // payloads written since the feed opened
+    double time;                    // playback seconds being heard
+    uint32_t flags;
+    uint32_t channel_count;
+    uint32_t chips;                 // ChannelLayout::Chip bits
+    uint32_t spectrum_scale;        // SpectrumScale of the bins
+
+    // Per channel, in layout order: the APU snapshot, then the note it
+    // plays (-1 if silent) and the layout's name and 0xRRGGBB colour
+    int32_t periods[CHANNELS];
+    int32_t lengths[CHANNELS];
+    int32_t amplitudes[CHANNELS];
+    int32_t volumes[CHANNELS];
+    int8_t notes[CHANNELS];
+    uint8_t velocities[CHANNELS];   // 0-127
+    uint8_t kinds[CHANNELS];        // ChannelKind
+    uint8_t reserved0[3];
+    uint32_t colors[CHANNELS];
+    char names[CHANNELS][NAME_SIZE];
+
+    float spectrum[SPECTRUM_BINS];  // display bars, 0-1
+    float rms_left;
+    float rms_right;
+    float peak;
+    float lufs_momentary;           // -1e9 without signal
+    float lufs_short_term;
+    uint32_t reserved1;
+
+    // Note-ons since the feed opened; number n is events[n % NOTE_EVENTS],
+    // so a reader that last saw count m has min(count - m, NOTE_EVENTS) new
+    uint64_t note_on_count;
+    OverlayNoteEvent events[NOTE_EVENTS];
+};
+
+static_assert(OverlayFeedPayload::CHANNELS == ChannelLayout::MAX_CHANNELS, "feed layout has a slot per channel");
+static_assert(std::is_trivially_copyable<OverlayFeedPayload>::value, "the payload goes through a seqlock");
+static_assert(sizeof(OverlayFeedPayload) == 2088, "no padding between the fields readers declare");
+
+// Written once when the segment opens
+struct OverlayFeedHeader {
+    uint32_t magic;                 // MAGIC
+    uint32_t version;               // VERSION of the payload layout
+    uint32_t segment_size;
+    uint32_t sequence_offset;       // of the uint32 sequence word
+    uint32_t payload_offset;
+    uint32_t payload_size;
+    uint32_t writer_pid;
+    uint32_t open;                  // 0 once the writer closed the feed
+    uint32_t reserved[8];
+};
+
+static_assert(sizeof(OverlayFeedHeader) == 64, "readers find the sequence at offset 64");
+
+// The visualizer's spectrum, levels, channel state and note-ons, published
+// to a named shared-memory segment (SEGMENT_NAME) for stream overlays to map
+// and read instead of capturing the window. The UI thread writes it once a
+// frame from data it already has to hand - the heard APU snapshot and a
+// subscription to the analysis graph's spectrum, which costs a copy per
+// tick - behind a seqlock, so readers never hold the writer up and no
+// reader waits on another.
+//
+// Segment: OverlayFeedHeader at offset 0, then a uint32 sequence at 64 and
+// the OverlayFeedPayload right after it at 68. To read, load the sequence
+// (acquire) and retry while it is odd, copy the payload, fence (acquire),
+// and keep the copy if the sequence still matches. A header version other
+// than the one a reader was written for is a layout it doesn't know.
+class OverlayFeed {
+public:
+    static constexpr uint32_t MAGIC = 0x44454546;   // "FEED"
+    static constexpr uint32_t VERSION = 1;
+#ifdef _WIN32
+    static constexpr const char* SEGMENT_NAME = "Local\\fc_visualizer_feed";
+#else
+    static constexpr const char* SEGMENT_NAME = "/fc_visualizer_feed";
+#endif
+
+    OverlayFeed() = default;
+    ~OverlayFeed() { close(); }
+    OverlayFeed(const OverlayFeed&) = delete;
+    OverlayFeed& operator=(const OverlayFeed&) = delete;
+
+    // Create the segment and subscribe to the spectrum; false if the OS
+    // refuses the segment
+    bool open(AnalysisGraph& analysis);
+    void close();
+    bool isOpen() const { return segment_ != nullptr; }
+
+    // UI thread, once a frame: the channel state being heard
+    void publish(const ApuFrameSnapshot& snapshot, const ChannelLayout& layout, double time, bool playing);
+
+private:
+    struct Segment;
+
+    void unmap();
+
+    Segment* segment_ = nullptr;
+    AnalysisGraph* analysis_ = nullptr;
+    std::shared_ptr<AnalysisGraph::Subscription> subscription_;
+    OverlayFeedPayload payload_{};  // the last one published, updated in place
+#ifdef _WIN32
+    void* mapping_ = nullptr;
+#else
+    int fd_ = -1;
+#endif
+};
@@ -0,0 +1,361 @@
+#include "PaletteRenderer.h"
+#include "GpuMemory.h"
+#include <cstring>
+
+/*
+    Vulkan shaders (SPIR-V 1.4, set/binding layout as sokol-shdc emits it):
+
+    layout(location = 0) in vec2 position;
+    layout(location = 0) out vec2 uv;
+    void main() {
+        gl_Position = vec4(position, 0.5, 1.0);
+        uv = position * vec2(0.5, -0.5) + 0.5;
+    }
+
+    layout(set = 1, binding = 0) uniform texture2D idx_tex;
+    layout(set = 1, binding = 1) uniform texture2D pal_tex;
+    layout(set = 1, binding = 32) uniform sampler smp;
+    layout(location = 0) in vec2 uv;
+    layout(location = 0) out vec4 frag_color;
+    void main() {
+        float i = texture(sampler2D(idx_tex, smp), uv).x;
+        frag_color = texture(sampler2D(pal_tex, smp), vec2(i * (255.0 / 64.0) + (0.5 / 64.0), 0.5));
+    }
+
+    The palette sampler repeats horizontally, so indices above 63 wrap
+    exactly like agnes' "& 0x3f".
+*/
+static const uint8_t _palette_vs_bytecode_spirv[792] = {
+    0x03,0x02,0x23,0x07,0x00,0x04,0x01,0x00,0x0b,0x00,0x08,0x00,0x22,0x00,0x00,0x00,
+    0x00,0x00,0x00,0x00,0x11,0x00,0x02,0x00,0x01,0x00,0x00,0x00,0x0b,0x00,0x06,0x00,
+    0x01,0x00,0x00,0x00,0x47,0x4c,0x53,0x4c,0x2e,0x73,0x74,0x64,0x2e,0x34,0x35,0x30,
+    0x00,0x00,0x00,0x00,0x0e,0x00,0x03,0x00,0x00,0x00,0x00,0x00,0x01,0x00,0x00,0x00,
+    0x0f,0x00,0x08,0x00,0x00,0x00,0x00,0x00,0x02,0x00,0x00,0x00,0x6d,0x61,0x69,0x6e,
+    0x00,0x00,0x00,0x00,0x03,0x00,0x00,0x00,0x04,0x00,0x00,0x00,0x05,0x00,0x00,0x00,
+    0x47,0x00,0x03,0x00,0x0d,0x00,0x00,0x00,0x02,0x00,0x00,0x00,0x48,0x00,0x05,0x00,
+    0x0d,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x0b,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+    0x48,0x00,0x05,0x00,0x0d,0x00,0x00,0x00,0x01,0x00,0x00,0x00,0x0b,0x00,0x00,0x00,
+    0x01,0x00,0x00,0x00,0x48,0x00,0x05,0x00,0x0d,0x00,0x00,0x00,0x02,0x00,0x00,0x00,
+    0x0b,0x00,0x00,0x00,0x03,0x00,0x00,0x00,0x48,0x00,0x05,0x00,0x0d,0x00,0x00,0x00,
+    0x03,0x00,0x00,0x00,0x0b,0x00,0x00,0x00,0x04,0x00,0x00,0x00,0x47,0x00,0x04,0x00,
+    0x04,0x00,0x00,0x00,0x1e,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x47,0x00,0x04,0x00,
+    0x05,0x00,0x00,0x00,0x1e,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x13,0x00,0x02,0x00,
+    0x06,0x00,0x00,0x00,0x21,0x00,0x03,0x00,0x07,0x00,0x00,0x00,0x06,0x00,0x00,0x00,
+    0x16,0x00,0x03,0x00,0x08,0x00,0x00,0x00,0x20,0x00,0x00,0x00,0x17,0x00,0x04,0x00,
+    0x09,0x00,0x00,0x00,0x08,0x00,0x00,0x00,0x04,0x00,0x00,0x00,0x15,0x00,0x04,0x00,
+    0x0a,0x00,0x00,0x00,0x20,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x2b,0x00,0x04,0x00,
+    0x0a,0x00,0x00,0x00,0x0b,0x00,0x00,0x00,0x01,0x00,0x00,0x00,0x1c,0x00,0x04,0x00,
+    0x0c,0x00,0x00,0x00,0x08,0x00,0x00,0x00,0x0b,0x00,0x00,0x00,0x1e,0x00,0x06,0x00,
+    0x0d,0x00,0x00,0x00,0x09,0x00,0x00,0x00,0x08,0x00,0x00,0x00,0x0c,0x00,0x00,0x00,
+    0x0c,0x00,0x00,0x00,0x20,0x00,0x04,0x00,0x0e,0x00,0x00,0x00,0x03,0x00,0x00,0x00,
+    0x0d,0x00,0x00,0x00,0x3b,0x00,0x04,0x00,0x0e,0x00,0x00,0x00,0x03,0x00,0x00,0x00,
+    0x03,0x00,0x00,0x00,0x15,0x00,0x04,0x00,0x0f,0x00,0x00,0x00,0x20,0x00,0x00,0x00,
+    0x01,0x00,0x00,0x00,0x2b,0x00,0x04,0x00,0x0f,0x00,0x00,0x00,0x10,0x00,0x00,0x00,
+    0x00,0x00,0x00,0x00,0x17,0x00,0x04,0x00,0x11,0x00,0x00,0x00,0x08,0x00,0x00,0x00,
+    0x02,0x00,0x00,0x00,0x20,0x00,0x04,0x00,0x12,0x00,0x00,0x00,0x01,0x00,0x00,0x00,
+    0x11,0x00,0x00,0x00,0x3b,0x00,0x04,0x00,0x12,0x00,0x00,0x00,0x04,0x00,0x00,0x00,
+    0x01,0x00,0x00,0x00,0x20,0x00,0x04,0x00,0x13,0x00,0x00,0x00,0x03,0x00,0x00,0x00,
+    0x11,0x00,0x00,0x00,0x3b,0x00,0x04,0x00,0x13,0x00,0x00,0x00,0x05,0x00,0x00,0x00,
+    0x03,0x00,0x00,0x00,0x20,0x00,0x04,0x00,0x14,0x00,0x00,0x00,0x03,0x00,0x00,0x00,
+    0x09,0x00,0x00,0x00,0x2b,0x00,0x04,0x00,0x08,0x00,0x00,0x00,0x15,0x00,0x00,0x00,
+    0x00,0x00,0x00,0x3f,0x2b,0x00,0x04,0x00,0x08,0x00,0x00,0x00,0x16,0x00,0x00,0x00,
+    0x00,0x00,0x80,0x3f,0x2b,0x00,0x04,0x00,0x08,0x00,0x00,0x00,0x17,0x00,0x00,0x00,
+    0x00,0x00,0x00,0xbf,0x2c,0x00,0x05,0x00,0x11,0x00,0x00,0x00,0x18,0x00,0x00,0x00,
+    0x15,0x00,0x00,0x00,0x17,0x00,0x00,0x00,0x2c,0x00,0x05,0x00,0x11,0x00,0x00,0x00,
+    0x19,0x00,0x00,0x00,0x15,0x00,0x00,0x00,0x15,0x00,0x00,0x00,0x36,0x00,0x05,0x00,
+    0x06,0x00,0x00,0x00,0x02,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x07,0x00,0x00,0x00,
+    0xf8,0x00,0x02,0x00,0x1a,0x00,0x00,0x00,0x3d,0x00,0x04,0x00,0x11,0x00,0x00,0x00,
+    0x1b,0x00,0x00,0x00,0x04,0x00,0x00,0x00,0x51,0x00,0x05,0x00,0x08,0x00,0x00,0x00,
+    0x1c,0x00,0x00,0x00,0x1b,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x51,0x00,0x05,0x00,
+    0x08,0x00,0x00,0x00,0x1d,0x00,0x00,0x00,0x1b,0x00,0x00,0x00,0x01,0x00,0x00,0x00,
+    0x50,0x00,0x07,0x00,0x09,0x00,0x00,0x00,0x1e,0x00,0x00,0x00,0x1c,0x00,0x00,0x00,
+    0x1d,0x00,0x00,0x00,0x15,0x00,0x00,0x00,0x16,0x00,0x00,0x00,0x41,0x00,0x05,0x00,
+    0x14,0x00,0x00,0x00,0x1f,0x00,0x00,0x00,0x03,0x00,0x00,0x00,0x10,0x00,0x00,0x00,
+    0x3e,0x00,0x03,0x00,0x1f,0x00,0x00,0x00,0x1e,0x00,0x00,0x00,0x85,0x00,0x05,0x00,
+    0x11,0x00,0x00,0x00,0x20,0x00,0x00,0x00,0x1b,0x00,0x00,0x00,0x18,0x00,0x00,0x00,
+    0x81,0x00,0x05,0x00,0x11,0x00,0x00,0x00,0x21,0x00,0x00,0x00,0x20,0x00,0x00,0x00,
+    0x19,0x00,0x00,0x00,0x3e,0x00,0x03,0x00,0x05,0x00,0x00,0x00,0x21,0x00,0x00,0x00,
+    0xfd,0x00,0x01,0x00,0x38,0x00,0x01,0x00,
+};
+
+static const uint8_t _palette_fs_bytecode_spirv[828] = {
+    0x03,0x02,0x23,0x07,0x00,0x04,0x01,0x00,0x0b,0x00,0x08,0x00,0x24,0x00,0x00,0x00,
+    0x00,0x00,0x00,0x00,0x11,0x00,0x02,0x00,0x01,0x00,0x00,0x00,0x0b,0x00,0x06,0x00,
+    0x01,0x00,0x00,0x00,0x47,0x4c,0x53,0x4c,0x2e,0x73,0x74,0x64,0x2e,0x34,0x35,0x30,
+    0x00,0x00,0x00,0x00,0x0e,0x00,0x03,0x00,0x00,0x00,0x00,0x00,0x01,0x00,0x00,0x00,
+    0x0f,0x00,0x0a,0x00,0x04,0x00,0x00,0x00,0x02,0x00,0x00,0x00,0x6d,0x61,0x69,0x6e,
+    0x00,0x00,0x00,0x00,0x03,0x00,0x00,0x00,0x04,0x00,0x00,0x00,0x05,0x00,0x00,0x00,
+    0x06,0x00,0x00,0x00,0x07,0x00,0x00,0x00,0x10,0x00,0x03,0x00,0x02,0x00,0x00,0x00,
+    0x07,0x00,0x00,0x00,0x47,0x00,0x04,0x00,0x03,0x00,0x00,0x00,0x1e,0x00,0x00,0x00,
+    0x00,0x00,0x00,0x00,0x47,0x00,0x04,0x00,0x04,0x00,0x00,0x00,0x22,0x00,0x00,0x00,
+    0x01,0x00,0x00,0x00,0x47,0x00,0x04,0x00,0x04,0x00,0x00,0x00,0x21,0x00,0x00,0x00,
+    0x00,0x00,0x00,0x00,0x47,0x00,0x04,0x00,0x05,0x00,0x00,0x00,0x22,0x00,0x00,0x00,
+    0x01,0x00,0x00,0x00,0x47,0x00,0x04,0x00,0x05,0x00,0x00,0x00,0x21,0x00,0x00,0x00,
+    0x01,0x00,0x00,0x00,0x47,0x00,0x04,0x00,0x06,0x00,0x00,0x00,0x22,0x00,0x00,0x00,
+    0x01,0x00,0x00,0x00,0x47,0x00,0x04,0x00,0x06,0x00,0x00,0x00,0x21,0x00,0x00,0x00,
+    0x20,0x00,0x00,0x00,0x47,0x00,0x04,0x00,0x07,0x00,0x00,0x00,0x1e,0x00,0x00,0x00,
+    0x00,0x00,0x00,0x00,0x13,0x00,0x02,0x00,0x08,0x00,0x00,0x00,0x21,0x00,0x03,0x00,
+    0x09,0x00,0x00,0x00,0x08,0x00,0x00,0x00,0x16,0x00,0x03,0x00,0x0a,0x00,0x00,0x00,
+    0x20,0x00,0x00,0x00,0x17,0x00,0x04,0x00,0x0b,0x00,0x00,0x00,0x0a,0x00,0x00,0x00,
+    0x04,0x00,0x00,0x00,0x20,0x00,0x04,0x00,0x0c,0x00,0x00,0x00,0x03,0x00,0x00,0x00,
+    0x0b,0x00,0x00,0x00,0x3b,0x00,0x04,0x00,0x0c,0x00,0x00,0x00,0x03,0x00,0x00,0x00,
+    0x03,0x00,0x00,0x00,0x19,0x00,0x09,0x00,0x0d,0x00,0x00,0x00,0x0a,0x00,0x00,0x00,
+    0x01,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+    0x01,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x20,0x00,0x04,0x00,0x0e,0x00,0x00,0x00,
+    0x00,0x00,0x00,0x00,0x0d,0x00,0x00,0x00,0x3b,0x00,0x04,0x00,0x0e,0x00,0x00,0x00,
+    0x04,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x3b,0x00,0x04,0x00,0x0e,0x00,0x00,0x00,
+    0x05,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x1a,0x00,0x02,0x00,0x0f,0x00,0x00,0x00,
+    0x20,0x00,0x04,0x00,0x10,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x0f,0x00,0x00,0x00,
+    0x3b,0x00,0x04,0x00,0x10,0x00,0x00,0x00,0x06,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+    0x1b,0x00,0x03,0x00,0x11,0x00,0x00,0x00,0x0d,0x00,0x00,0x00,0x17,0x00,0x04,0x00,
+    0x12,0x00,0x00,0x00,0x0a,0x00,0x00,0x00,0x02,0x00,0x00,0x00,0x20,0x00,0x04,0x00,
+    0x13,0x00,0x00,0x00,0x01,0x00,0x00,0x00,0x12,0x00,0x00,0x00,0x3b,0x00,0x04,0x00,
+    0x13,0x00,0x00,0x00,0x07,0x00,0x00,0x00,0x01,0x00,0x00,0x00,0x2b,0x00,0x04,0x00,
+    0x0a,0x00,0x00,0x00,0x14,0x00,0x00,0x00,0x00,0x00,0x7f,0x40,0x2b,0x00,0x04,0x00,
+    0x0a,0x00,0x00,0x00,0x15,0x00,0x00,0x00,0x00,0x00,0x00,0x3c,0x2b,0x00,0x04,0x00,
+    0x0a,0x00,0x00,0x00,0x16,0x00,0x00,0x00,0x00,0x00,0x00,0x3f,0x36,0x00,0x05,0x00,
+    0x08,0x00,0x00,0x00,0x02,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x09,0x00,0x00,0x00,
+    0xf8,0x00,0x02,0x00,0x17,0x00,0x00,0x00,0x3d,0x00,0x04,0x00,0x0d,0x00,0x00,0x00,
+    0x18,0x00,0x00,0x00,0x04,0x00,0x00,0x00,0x3d,0x00,0x04,0x00,0x0f,0x00,0x00,0x00,
+    0x19,0x00,0x00,0x00,0x06,0x00,0x00,0x00,0x56,0x00,0x05,0x00,0x11,0x00,0x00,0x00,
+    0x1a,0x00,0x00,0x00,0x18,0x00,0x00,0x00,0x19,0x00,0x00,0x00,0x3d,0x00,0x04,0x00,
+    0x12,0x00,0x00,0x00,0x1b,0x00,0x00,0x00,0x07,0x00,0x00,0x00,0x57,0x00,0x05,0x00,
+    0x0b,0x00,0x00,0x00,0x1c,0x00,0x00,0x00,0x1a,0x00,0x00,0x00,0x1b,0x00,0x00,0x00,
+    0x51,0x00,0x05,0x00,0x0a,0x00,0x00,0x00,0x1d,0x00,0x00,0x00,0x1c,0x00,0x00,0x00,
+    0x00,0x00,0x00,0x00,0x85,0x00,0x05,0x00,0x0a,0x00,0x00,0x00,0x1e,0x00,0x00,0x00,
+    0x1d,0x00,0x00,0x00,0x14,0x00,0x00,0x00,0x81,0x00,0x05,0x00,0x0a,0x00,0x00,0x00,
+    0x1f,0x00,0x00,0x00,0x1e,0x00,0x00,0x00,0x15,0x00,0x00,0x00,0x50,0x00,0x05,0x00,
+    0x12,0x00,0x00,0x00,0x20,0x00,0x00,0x00,0x1f,0x00,0x00,0x00,0x16,0x00,0x00,0x00,
+    0x3d,0x00,0x04,0x00,0x0d,0x00,0x00,0x00,0x21,0x00,0x00,0x00,0x05,0x00,0x00,0x00,
+    0x56,0x00,0x05,0x00,0x11,0x00,0x00,0x00,0x22,0x00,0x00,0x00,0x21,0x00,0x00,0x00,
+    0x19,0x00,0x00,0x00,0x57,0x00,0x05,0x00,0x0b,0x00,0x00,0x00,0x23,0x00,0x00,0x00,
+    0x22,0x00,0x00,0x00,0x20,0x00,0x00,0x00,0x3e,0x00,0x03,0x00,0x03,0x00,0x00,0x00,
+    0x23,0x00,0x00,0x00,0xfd,0x00,0x01,0x00,0x38,0x00,0x01,0x00,
+};
+
+static const char _palette_vs_source_metal[] =
+    "#include <metal_stdlib>\n"
+    "using namespace metal;\n"
+    "struct vs_in { float2 position [[attribute(0)]]; };\n"
+    "struct vs_out { float4 pos [[position]]; float2 uv [[user(locn0)]]; };\n"
+    "vertex vs_out main0(vs_in in [[stage_in]]) {\n"
+    "    vs_out out;\n"
+    "    out.pos = float4(in.position, 0.5, 1.0);\n"
+    "    out.uv = in.position * float2(0.5, -0.5) + 0.5;\n"
+    "    return out;\n"
+    "}\n";
+
+static const char _palette_fs_source_metal[] =
+    "#include <metal_stdlib>\n"
+    "using namespace metal;\n"
+    "struct fs_in { float2 uv [[user(locn0)]]; };\n"
+    "fragment float4 main0(fs_in in [[stage_in]],\n"
+    "                      texture2d<float> idx_tex [[texture(0)]],\n"
+    "                      texture2d<float> pal_tex [[texture(1)]],\n"
+    "                      sampler smp [[sampler(0)]]) {\n"
+    "    float i = idx_tex.sample(smp, in.uv).x;\n"
+    "    return pal_tex.sample(smp, float2(i * (255.0 / 64.0) + (0.5 / 64.0), 0.5));\n"
+    "}\n";
+
+static bool paletteShaderDesc(sg_shader_desc& desc) {
+    desc = {};
+    switch (sg_query_backend()) {
+        case SG_BACKEND_VULKAN:
+            desc.vertex_func.bytecode = SG_RANGE(_palette_vs_bytecode_spirv);
+            desc.vertex_func.entry = "main";
+            desc.fragment_func.bytecode = SG_RANGE(_palette_fs_bytecode_spirv);
+            desc.fragment_func.entry = "main";
+            break;
+        case SG_BACKEND_METAL_MACOS:
+        case SG_BACKEND_METAL_IOS:
+        case SG_BACKEND_METAL_SIMULATOR:
+            desc.vertex_func.source = _palette_vs_source_metal;
+            desc.vertex_func.entry = "main0";
+            desc.fragment_func.source = _palette_fs_source_metal;
+            desc.fragment_func.entry = "main0";
+            break;
+        default:
+            return false;
+    }
+
+    desc.attrs[0].base_type = SG_SHADERATTRBASETYPE_FLOAT;
+    for (int i = 0; i < 2; ++i) {
+        desc.views[i].texture.stage = SG_SHADERSTAGE_FRAGMENT;
+        desc.views[i].texture.image_type = SG_IMAGETYPE_2D;
+        desc.views[i].texture.sample_type = SG_IMAGESAMPLETYPE_FLOAT;
+        desc.views[i].texture.msl_texture_n = static_cast<uint8_t>(i);
+        desc.views[i].texture.spirv_set1_binding_n = static_cast<uint8_t>(i);
+        desc.texture_sampler_pairs[i].stage = SG_SHADERSTAGE_FRAGMENT;
+        desc.texture_sampler_pairs[i].view_slot = static_cast<uint8_t>(i);
+        desc.texture_sampler_pairs[i].sampler_slot = 0;
+    }
+    desc.samplers[0].stage = SG_SHADERSTAGE_FRAGMENT;
+    desc.samplers[0].sampler_type = SG_SAMPLERTYPE_FILTERING;
+    desc.samplers[0].msl_sampler_n = 0;
+    desc.samplers[0].spirv_set1_binding_n = 32;
+    desc.label = "nes-palette-shader";
+    return true;
+}
+
+bool PaletteRenderer::init(int width, int height) {
+    if (valid_) return true;
+
+    sg_shader_desc shd_desc;
+    if (!paletteShaderDesc(shd_desc)) return false;
+
+    shader_ = sg_make_shader(&shd_desc);
+    if (sg_query_shader_state(shader_) != SG_RESOURCESTATE_VALID) {
+        sg_destroy_shader(shader_);
+        shader_ = {};
+        return false;
+    }
+
+    width_ = width;
+    height_ = height;
+
+    // Palette indices, replaced every frame
+    sg_image_desc idx_desc = {};
+    idx_desc.width = width;
+    idx_desc.height = height;
+    idx_desc.pixel_format = SG_PIXELFORMAT_R8;
+    idx_desc.usage.stream_update = true;
+    idx_desc.label = "nes-index-image";
+    for (int i = 0; i < INDEX_IMAGES; ++i) {
+        index_images_[i] = MakeGpuImage(&idx_desc);
+    }
+
+    sg_image_desc pal_desc = {};
+    pal_desc.width = PALETTE_SIZE;
+    pal_desc.height = 1;
+    pal_desc.pixel_format = SG_PIXELFORMAT_RGBA8;
+    pal_desc.usage.dynamic_update = true;
+    pal_desc.label = "nes-palette-image";
+    palette_image_ = MakeGpuImage(&pal_desc);
+
+    sg_image_desc target_desc = {};
+    target_desc.width = width;
+    target_desc.height = height;
+    target_desc.pixel_format = SG_PIXELFORMAT_RGBA8;
+    target_desc.sample_count = 1;
+    target_desc.usage.color_attachment = true;
+    target_desc.label = "nes-screen-target";
+    target_image_ = MakeGpuImage(&target_desc);
+
+    sg_view_desc view_desc = {};
+    for (int i = 0; i < INDEX_IMAGES; ++i) {
+        view_desc.texture.image = index_images_[i];
+        index_views_[i] = sg_make_view(&view_desc);
+    }
+    index_current_ = 0;
+    view_desc = {};
+    view_desc.texture.image = palette_image_;
+    palette_view_ = sg_make_view(&view_desc);
+    view_desc = {};
+    view_desc.texture.image = target_image_;
+    target_tex_view_ = sg_make_view(&view_desc);
+    view_desc = {};
+    view_desc.color_attachment.image = target_image_;
+    target_attachment_ = sg_make_view(&view_desc);
+
+    // Nearest everywhere; the repeat on U turns the palette fetch into "& 63"
+    sg_sampler_desc smp_desc = {};
+    smp_desc.min_filter = SG_FILTER_NEAREST;
+    smp_desc.mag_filter = SG_FILTER_NEAREST;
+    smp_desc.wrap_u = SG_WRAP_REPEAT;
+    smp_desc.wrap_v = SG_WRAP_CLAMP_TO_EDGE;
+    sampler_ = sg_make_sampler(&smp_desc);
+
+    // One oversized triangle covering the target
+    const float tri[] = { -1.0f, 1.0f,  3.0f, 1.0f,  -1.0f, -3.0f };
+    sg_buffer_desc buf_desc = {};
+    buf_desc.data = SG_RANGE(tri);
+    buf_desc.label = "nes-palette-triangle";
+    vertices_ = sg_make_buffer(&buf_desc);
+
+    sg_pipeline_desc pip_desc = {};
+    pip_desc.shader = shader_;
+    pip_desc.layout.attrs[0].format = SG_VERTEXFORMAT_FLOAT2;
+    pip_desc.depth.pixel_format = SG_PIXELFORMAT_NONE;
+    pip_desc.colors[0].pixel_format = SG_PIXELFORMAT_RGBA8;
+    pip_desc.sample_count = 1;
+    pip_desc.label = "nes-palette-pipeline";
+    pipeline_ = sg_make_pipeline(&pip_desc);
+
+    valid_ = sg_query_pipeline_state(pipeline_) == SG_RESOURCESTATE_VALID &&
+             sg_query_image_state(target_image_) == SG_RESOURCESTATE_VALID;
+    for (int i = 0; i < INDEX_IMAGES; ++i) {
+        valid_ = valid_ && sg_query_image_state(index_images_[i]) == SG_RESOURCESTATE_VALID;
+    }
+    if (!valid_) {
+        shutdown();
+        return false;
+    }
+    palette_dirty_ = true;
+    return true;
+}
+
+void PaletteRenderer::shutdown() {
+    sg_destroy_pipeline(pipeline_);
+    sg_destroy_shader(shader_);
+    sg_destroy_buffer(vertices_);
+    sg_destroy_sampler(sampler_);
+    sg_destroy_view(target_attachment_);
+    sg_destroy_view(target_tex_view_);
+    sg_destroy_view(palette_view_);
+    for (int i = 0; i < INDEX_IMAGES; ++i) {
+        sg_destroy_view(index_views_[i]);
+        DestroyGpuImage(index_images_[i]);
+        index_views_[i] = {};
+        index_images_[i] = {};
+    }
+    DestroyGpuImage(target_image_);
+    DestroyGpuImage(palette_image_);
+    pipeline_ = {};
+    shader_ = {};
+    vertices_ = {};
+    sampler_ = {};
+    target_attachment_ = {};
+    target_tex_view_ = {};
+    palette_view_ = {};
+    target_image_ = {};
+    palette_image_ = {};
+    valid_ = false;
+}
+
+void PaletteRenderer::setPalette(const uint32_t* rgba) {
+    memcpy(palette_, rgba, sizeof(palette_));
+    palette_dirty_ = true;
+}
+
+void PaletteRenderer::render(const uint8_t* indices) {
+    if (!valid_) return;
+
+    if (palette_dirty_) {
+        sg_image_data pal_data = {};
+        pal_data.mip_levels[0].ptr = palette_;
+        pal_data.mip_levels[0].size = sizeof(palette_);
+        sg_update_image(palette_image_, &pal_data);
+        palette_dirty_ = false;
+    }
+
+    sg_image_data idx_data = {};
+    idx_data.mip_levels[0].ptr = indices;
+    idx_data.mip_levels[0].size = static_cast<size_t>(width_) * height_;
+    index_current_ = (index_current_ + 1) % INDEX_IMAGES;
+    sg_update_image(index_images_[index_current_], &idx_data);
+
+    sg_pass pass = {};
+    pass.action.colors[0].load_action = SG_LOADACTION_DONTCARE;
+    pass.attachments.colors[0] = target_attachment_;
+    pass.label = "nes-palette-pass";
+    sg_begin_pass(&pass);
+    sg_apply_pipeline(pipeline_);
+    sg_bindings bind = {};
+    bind.vertex_buffers[0] = vertices_;
+    bind.views[0] = index_views_[index_current_];
+    bind.views[1] = palette_view_;
+    bind.samplers[0] = sampler_;
+    sg_apply_bindings(&bind);
+    sg_draw(0, 3, 1);
+    sg_end_pass();
+}
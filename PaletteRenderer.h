@@ -0,0 +1,57 @@
+#pragma once
+
+#include "sokol_gfx.h"
+#include <cstdint>
+
+// Resolves an indexed-color framebuffer on the GPU: the 8-bit palette index
+// buffer is uploaded as an R8 stream texture and a small shader looks each
+// pixel up in a 64x1 RGBA palette texture, rendering into an RGBA target
+// that ImGui can draw. Palettes can be swapped without touching emulation.
+class PaletteRenderer {
+public:
+    static constexpr int PALETTE_SIZE = 64;
+
+    PaletteRenderer() = default;
+    ~PaletteRenderer() = default;
+
+    // Returns false if the active backend has no palette shader (the caller
+    // then keeps converting on the CPU)
+    bool init(int width, int height);
+    void shutdown();
+    bool isValid() const { return valid_; }
+
+    // 64 entries in RGBA8 byte order; uploaded on the next render()
+    void setPalette(const uint32_t* rgba);
+
+    // Upload width*height indices and resolve them into the target.
+    // Runs its own offscreen pass, so call outside the swapchain pass.
+    void render(const uint8_t* indices);
+
+    // Result texture (RGBA8) for simgui_imtextureid_with_sampler
+    sg_view targetView() const { return target_tex_view_; }
+    sg_sampler sampler() const { return sampler_; }
+
+private:
+    bool valid_ = false;
+    int width_ = 0;
+    int height_ = 0;
+
+    // Index uploads rotate through these, so a new frame never overwrites
+    // the image an earlier, still queued pass reads
+    static constexpr int INDEX_IMAGES = 3;
+    sg_image index_images_[INDEX_IMAGES] = {};
+    sg_view index_views_[INDEX_IMAGES] = {};
+    int index_current_ = 0;
+    sg_image palette_image_ = {};
+    sg_view palette_view_ = {};
+    sg_image target_image_ = {};
+    sg_view target_attachment_ = {};
+    sg_view target_tex_view_ = {};
+    sg_sampler sampler_ = {};
+    sg_buffer vertices_ = {};
+    sg_shader shader_ = {};
+    sg_pipeline pipeline_ = {};
+
+    uint32_t palette_[PALETTE_SIZE] = {};
+    bool palette_dirty_ = false;
+};
@@ -1,7 +1,12 @@
 #include "PianoVisualizer.h"
+#include "GpuMemory.h"
 #include "gme/gme.h"
-#include "gme/Nes_Apu.h"
-#include "gme/Nes_Vrc6_Apu.h"
+#include "gme/Nsf_Emu.h"
+#include "ApuTap.h"
+#include "PitchTable.h"
+#include "Profiler.h"
+#include "sokol_app.h"
+#include "util/sokol_imgui.h"
 #include <algorithm>
 #include <cstring>
 
@@ -10,29 +15,32 @@
 #endif
 
 PianoVisualizer::PianoVisualizer() {
+    setChannelLayout(ChannelLayout::build(0));
     reset();
 }
 
 void PianoVisualizer::reset() {
     std::lock_guard<std::mutex> lock(mutex_);
     
-    for (int i = 0; i < PIANO_NUM_CHANNELS_MAX; ++i) {
-        current_notes_[i] = {i, 0, 0.0f, false};
-        preprocess_prev_notes_[i] = -1;
-        preprocess_note_start_[i] = 0.0f;
-        preprocess_note_velocity_[i] = 0.0f;
+    for (int i = 0; i < layout_.size(); ++i) {
+        current_notes_[i] = {i, 0, 0.0f, false, 0};
     }
     
-    preprocessed_notes_.clear();
-    has_preprocessed_data_ = false;
-    track_duration_ = 0.0f;
+    timeline_.clear();
+    density_.clear();
+    ++timeline_version_;
+    has_preprocessed_data_.store(false, std::memory_order_release);
+    preprocess_complete_.store(false, std::memory_order_release);
+    track_duration_.store(0.0f, std::memory_order_release);
+    live_notes_.clear();
 }
 
-int PianoVisualizer::frequencyToMidi(float frequency) {
+int PianoVisualizer::frequencyToMidi(float frequency, int* cents) {
     if (frequency <= 0) return -1;
     float midi = 69.0f + 12.0f * std::log2(frequency / 440.0f);
     int note = static_cast<int>(std::round(midi));
     if (note < 0 || note > 127) return -1;
+    if (cents) *cents = static_cast<int>(std::lround((midi - note) * 100.0f));
     return note;
 }
 
@@ -60,119 +68,110 @@ int PianoVisualizer::getNoteInOctave(int midi_note) {
     return midi_note % 12;
 }
 
-int PianoVisualizer::periodToMidi(int channel, int period) {
-    if (period < 8) return -1;  // Too high frequency / silent
-    
-    float freq = 0;
-    
-    if (channel == 3) {
-        // Noise channel - map to low notes
-        int noise_idx = period & 0x0F;
-        return 36 + (15 - noise_idx);  // C2 to C3 range
-    } else if (channel == 4) {
-        // DMC - fixed low note
-        return 28;  // E1
-    } else {
-        // Square1, Square2, Triangle
-        freq = NES_CPU_CLOCK / (16.0f * (period + 1));
+void PianoVisualizer::setChannelLayout(const ChannelLayout& layout) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (layout == layout_) return;
+    layout_ = layout;
+    ++timeline_version_;  // note colors follow the layout
+    live_notes_.clear();
+    current_notes_.resize(layout_.size());
+    indexed_notes_.resize(layout_.size());
+    for (int i = 0; i < layout_.size(); ++i) {
+        current_notes_[i] = {i, 0, 0.0f, false, 0};
     }
-    
-    return frequencyToMidi(freq);
 }
 
-void PianoVisualizer::processApuFrame(const int* periods, const int* lengths, const int* amplitudes, float current_time) {
-    for (int ch = 0; ch < PIANO_NUM_CHANNELS_BASE; ++ch) {
-        int period = periods[ch];
-        int length = lengths[ch];
-        int amp = std::abs(amplitudes[ch]);
-        
-        int midi_note = -1;
-        float velocity = 0;
-        
-        if (ch == 3) {
-            // Noise
-            if (length > 0 && amp > 0) {
-                midi_note = 36 + (15 - (period & 0x0F));
-                velocity = std::min(1.0f, amp / 15.0f);
+bool PianoVisualizer::channelNote(const ChannelLayout& layout, const ApuFrameSnapshot& snapshot, int channel,
+                                  int* midi_note, float* velocity, int* cents) {
+    int period = snapshot.periods[channel];
+    bool on = snapshot.lengths[channel] > 0;
+    int amp = std::abs(snapshot.amplitudes[channel]);
+    int volume = snapshot.volumes[channel];
+    
+    int note = -1;
+    float vel = 0;
+    int detune = 0;
+    PitchTable::Pitch pitch = {-1, 0};
+    
+    switch (layout[channel].kind) {
+        case ChannelKind::Noise:
+            // Map the noise period index to low notes (C2 to C3 range)
+            if (on && amp > 0) {
+                note = 36 + (15 - (period & 0x0F));
+                vel = std::min(1.0f, amp / 15.0f);
             }
-        } else if (ch == 4) {
-            // DMC - check if actively playing (length > 0 means bytes remaining)
-            if (length > 0) {
-                midi_note = 28;
-                velocity = 0.8f;  // Fixed velocity when DMC is playing
+            break;
+        case ChannelKind::DMC:
+            // Actively playing while bytes remain; fixed low note
+            if (on) {
+                note = 28;  // E1
+                vel = 0.8f;
             }
-        } else if (ch == 2) {
-            // Triangle - doesn't have volume control, just on/off
-            // last_amp is the waveform position (0-15), not volume
-            if (length > 0 && period >= 8) {
-                float freq = NES_CPU_CLOCK / (16.0f * (period + 1));
-                midi_note = frequencyToMidi(freq);
-                velocity = 0.8f;  // Fixed velocity for Triangle
+            break;
+        case ChannelKind::Triangle:
+            // No volume control, just on/off; last_amp is the waveform position, not volume
+            if (on && period >= 8) {
+                pitch = PitchTable::apuTriangle(period);
+                vel = 0.8f;
             }
-        } else {
-            // Square1, Square2
-            if (length > 0 && amp > 0 && period >= 8) {
-                float freq = NES_CPU_CLOCK / (16.0f * (period + 1));
-                midi_note = frequencyToMidi(freq);
-                velocity = std::min(1.0f, amp / 15.0f);
+            break;
+        case ChannelKind::Square:
+            if (on && amp > 0 && period >= 8) {
+                pitch = PitchTable::apuPulse(period);
+                vel = std::min(1.0f, amp / 15.0f);
             }
-        }
-        
-        int prev_note = preprocess_prev_notes_[ch];
-        
-        // Note changed or ended
-        if (midi_note != prev_note || velocity < 0.01f) {
-            // End previous note
-            if (prev_note >= 0 && prev_note <= 127) {
-                PianoRollNote note;
-                note.channel = ch;
-                note.midi_note = prev_note;
-                note.velocity = preprocess_note_velocity_[ch];
-                note.start_time = preprocess_note_start_[ch];
-                note.end_time = current_time;
-                
-                // Only add if note has meaningful duration
-                if (note.end_time - note.start_time > 0.01f) {
-                    preprocessed_notes_.push_back(note);
-                }
+            break;
+        case ChannelKind::Vrc6Pulse:
+        case ChannelKind::Vrc6Saw:
+            // Pulse: CPU_CLOCK / (16 * (period + 1)); the saw's accumulator takes 14 steps
+            if (on && volume > 0 && period >= 1) {
+                pitch = layout[channel].kind == ChannelKind::Vrc6Pulse ? PitchTable::vrc6Pulse(period)
+                                                                       : PitchTable::vrc6Saw(period);
+                // Pulse: 4-bit volume (0-15); saw: accumulator rate (0-63, typical max around 42)
+                vel = std::min(1.0f, volume / (layout[channel].kind == ChannelKind::Vrc6Pulse ? 15.0f : 42.0f));
             }
-            
-            // Start new note
-            if (midi_note >= 0 && midi_note <= 127 && velocity > 0.01f) {
-                preprocess_prev_notes_[ch] = midi_note;
-                preprocess_note_start_[ch] = current_time;
-                preprocess_note_velocity_[ch] = velocity;
-            } else {
-                preprocess_prev_notes_[ch] = -1;
+            break;
+        case ChannelKind::Fme7Square:
+            // 5B tone: freq = CPU_CLOCK / (32 * period)
+            if (on && volume > 0 && period >= 1) {
+                pitch = PitchTable::fme7Tone(period);
+                vel = std::min(1.0f, volume / 15.0f);
             }
-        }
+            break;
+        case ChannelKind::NamcoWave:
+            // The snapshot already holds clocks per waveform cycle
+            if (on && volume > 0 && period > 0) {
+                note = frequencyToMidi(NES_CPU_CLOCK / period, &detune);
+                vel = std::min(1.0f, volume / 15.0f);
+            }
+            break;
+        case ChannelKind::Voice:
+            // gme's own pitch; unpitched voices (noise, samples) sit on a fixed low note like the DMC
+            if (on && volume > 0) {
+                float frequency = snapshot.frequencies[channel];
+                note = frequency > 0.0f ? frequencyToMidi(frequency, &detune) : 28;
+                vel = std::min(1.0f, volume / 15.0f);
+            }
+            break;
+    }
+    if (pitch.note >= 0) {
+        note = pitch.note;
+        detune = pitch.cents;
     }
+    
+    *midi_note = note;
+    *velocity = vel;
+    if (cents) *cents = detune;
+    return note >= 0 && note <= 127 && vel > 0.01f;
 }
 
-void PianoVisualizer::processVrc6Frame(const int* periods, const int* volumes, const bool* enabled, float current_time) {
-    // VRC6 channels: Pulse1 (ch 5), Pulse2 (ch 6), Saw (ch 7)
-    for (int i = 0; i < PIANO_NUM_CHANNELS_VRC6; ++i) {
-        int ch = PIANO_NUM_CHANNELS_BASE + i;  // 5, 6, 7
-        int period = periods[i];
-        int volume = volumes[i];
-        bool is_enabled = enabled[i];
-        
+bool PianoVisualizer::processSnapshot(const ApuFrameSnapshot& snapshot, float current_time) {
+    bool any_sounding = false;
+    int count = std::min(preprocess_layout_.size(), snapshot.channel_count);
+    for (int ch = 0; ch < count; ++ch) {
         int midi_note = -1;
         float velocity = 0;
-        
-        if (is_enabled && volume > 0 && period >= 1) {
-            // VRC6 period formula: freq = CPU_CLOCK / (16 * (period + 1))
-            float freq = NES_CPU_CLOCK / (16.0f * (period + 1));
-            midi_note = frequencyToMidi(freq);
-            
-            if (i < 2) {
-                // Pulse waves - 4-bit volume (0-15)
-                velocity = std::min(1.0f, volume / 15.0f);
-            } else {
-                // Saw wave - accumulator rate (0-63)
-                velocity = std::min(1.0f, volume / 42.0f);
-            }
-        }
+        any_sounding |= channelNote(preprocess_layout_, snapshot, ch, &midi_note, &velocity);
         
         int prev_note = preprocess_prev_notes_[ch];
         
@@ -180,16 +179,7 @@ void PianoVisualizer::processVrc6Frame(const int* periods, const int* volumes, c
         if (midi_note != prev_note || velocity < 0.01f) {
             // End previous note
             if (prev_note >= 0 && prev_note <= 127) {
-                PianoRollNote note;
-                note.channel = ch;
-                note.midi_note = prev_note;
-                note.velocity = preprocess_note_velocity_[ch];
-                note.start_time = preprocess_note_start_[ch];
-                note.end_time = current_time;
-                
-                if (note.end_time - note.start_time > 0.01f) {
-                    preprocessed_notes_.push_back(note);
-                }
+                endNote(ch, current_time);
             }
             
             // Start new note
@@ -197,75 +187,108 @@ void PianoVisualizer::processVrc6Frame(const int* periods, const int* volumes, c
                 preprocess_prev_notes_[ch] = midi_note;
                 preprocess_note_start_[ch] = current_time;
                 preprocess_note_velocity_[ch] = velocity;
+                preprocess_envelope_[ch].clear();
+                preprocess_envelope_samples_[ch] = 0;
+                preprocess_envelope_level_[ch] = NoteTimeline::envelopeLevel(velocity);
             } else {
                 preprocess_prev_notes_[ch] = -1;
             }
+        } else {
+            // Same note: the level seen at the last snapshot lasted until now
+            sampleEnvelope(ch, current_time);
+            preprocess_envelope_level_[ch] = NoteTimeline::envelopeLevel(velocity);
         }
     }
+    return any_sounding;
+}
+
+void PianoVisualizer::sampleEnvelope(int ch, float time) {
+    // Samples at whole envelope periods from the note's start
+    const float period = NoteTimeline::ENVELOPE_TICKS / NoteTimeline::TICKS_PER_SECOND;
+    float elapsed = std::max(0.0f, time - preprocess_note_start_[ch]);
+    uint32_t samples = static_cast<uint32_t>(std::ceil(elapsed / period));
+    if (samples > preprocess_envelope_samples_[ch]) {
+        NoteTimeline::appendEnvelope(preprocess_envelope_[ch], preprocess_envelope_level_[ch],
+                                     samples - preprocess_envelope_samples_[ch]);
+        preprocess_envelope_samples_[ch] = samples;
+    }
+}
+
+void PianoVisualizer::endNote(int ch, float end_time) {
+    PianoRollNote note;
+    note.channel = ch;
+    note.midi_note = preprocess_prev_notes_[ch];
+    note.velocity = preprocess_note_velocity_[ch];
+    note.start_time = preprocess_note_start_[ch];
+    note.end_time = end_time;
+    
+    // Only add if note has meaningful duration
+    if (note.end_time - note.start_time > 0.01f) {
+        sampleEnvelope(ch, end_time);
+        emitNote(note, preprocess_envelope_[ch]);
+    }
+}
+
+void PianoVisualizer::emitNote(const PianoRollNote& note, const std::vector<uint8_t>& envelope) {
+    if (note_sink_) {
+        note_sink_(note);
+        return;
+    }
+    pending_notes_.push_back(note);
+    if (!envelope.empty()) {
+        pending_notes_.back().envelope = static_cast<uint32_t>(pending_envelopes_.size());
+        pending_envelopes_.insert(pending_envelopes_.end(), envelope.begin(), envelope.end());
+        pending_envelopes_.push_back(0);
+    }
+}
+
+void PianoVisualizer::publishPendingNotes(float analyzed_time) {
+    // Each channel emits its notes in time order, so the batch appends
+    // straight onto the per-channel arrays
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const PianoRollNote& note : pending_notes_) {
+        bool has_envelope = note.envelope != PianoRollNote::NO_ENVELOPE;
+        timeline_.append(note, has_envelope ? pending_envelopes_.data() + note.envelope : nullptr);
+        density_.add(note);
+    }
+    if (!pending_notes_.empty()) ++timeline_version_;
+    pending_notes_.clear();
+    pending_envelopes_.clear();
+    track_duration_.store(analyzed_time, std::memory_order_release);
+    has_preprocessed_data_.store(true, std::memory_order_release);
 }
 
 void PianoVisualizer::finalizePreprocessing(float end_time) {
     // End any notes still playing
-    for (int ch = 0; ch < PIANO_NUM_CHANNELS_MAX; ++ch) {
+    for (int ch = 0; ch < preprocess_layout_.size(); ++ch) {
         int prev_note = preprocess_prev_notes_[ch];
         if (prev_note >= 0 && prev_note <= 127) {
-            PianoRollNote note;
-            note.channel = ch;
-            note.midi_note = prev_note;
-            note.velocity = preprocess_note_velocity_[ch];
-            note.start_time = preprocess_note_start_[ch];
-            note.end_time = end_time;
-            
-            if (note.end_time - note.start_time > 0.01f) {
-                preprocessed_notes_.push_back(note);
-            }
+            endNote(ch, end_time);
         }
         preprocess_prev_notes_[ch] = -1;
     }
     
-    // Sort notes by start time
-    std::sort(preprocessed_notes_.begin(), preprocessed_notes_.end(),
-              [](const PianoRollNote& a, const PianoRollNote& b) {
-                  return a.start_time < b.start_time;
-              });
+    // Publish the remainder
+    publishPendingNotes(end_time);
     
-    track_duration_ = end_time;
-    has_preprocessed_data_ = true;
+    std::lock_guard<std::mutex> lock(mutex_);
+    timeline_.setLoop(trace_loop_);
+    preprocess_complete_.store(true, std::memory_order_release);
 }
 
 bool PianoVisualizer::preprocessTrack(Music_Emu* emu, int track, long sample_rate,
-                                       ApuDataCallback apu_callback,
+                                       const ApuTap& tap,
                                        std::function<void(float)> progress_callback,
-                                       Vrc6DataCallback vrc6_callback) {
-    if (!emu || !apu_callback) return false;
-    
-    std::lock_guard<std::mutex> lock(mutex_);
-    
-    // Reset state
-    preprocessed_notes_.clear();
-    has_preprocessed_data_ = false;
-    track_duration_ = 0.0f;
-    
-    // Check if VRC6 is available
-    has_vrc6_ = (vrc6_callback != nullptr) && (vrc6_callback(emu) != nullptr);
+                                       std::function<bool()> cancel_callback) {
+    if (!emu || !tap.valid()) return false;
     
-    for (int i = 0; i < PIANO_NUM_CHANNELS_MAX; ++i) {
-        preprocess_prev_notes_[i] = -1;
-        preprocess_note_start_[i] = 0.0f;
-        preprocess_note_velocity_[i] = 0.0f;
-    }
+    beginPreprocessing(tap);
     
-    // Get track info for duration estimate
-    track_info_t info;
-    if (gme_track_info(emu, &info, track) != nullptr) {
+    float estimated_duration = 0.0f;
+    if (!estimatePreprocessDuration(emu, track, &estimated_duration)) {
         return false;
     }
     
-    // Estimate duration (use length if available, otherwise default to 3 minutes)
-    float estimated_duration = info.length > 0 ? info.length / 1000.0f : 180.0f;
-    // Cap at 5 minutes for preprocessing
-    estimated_duration = std::min(estimated_duration, 300.0f);
-    
     // Start the track
     if (gme_start_track(emu, track) != nullptr) {
         return false;
@@ -281,39 +304,26 @@ bool PianoVisualizer::preprocessTrack(Music_Emu* emu, int track, long sample_rat
     int total_chunks = static_cast<int>(estimated_duration / time_per_chunk);
     
     while (current_time < estimated_duration && !gme_track_ended(emu)) {
+        if (cancel_callback && cancel_callback()) {
+            pending_notes_.clear();
+            pending_envelopes_.clear();
+            return false;
+        }
+        
         // Generate audio (we need this to advance the emulator state)
         gme_play(emu, chunk_samples * 2, buffer.data());
         
-        // Get APU state
-        Nes_Apu* apu = apu_callback(emu);
-        if (apu) {
-            int periods[5], lengths[5], amplitudes[5];
-            for (int i = 0; i < 5; ++i) {
-                periods[i] = apu->osc_period(i);
-                lengths[i] = apu->osc_length(i);
-                amplitudes[i] = apu->osc_amplitude(i);
-            }
-            processApuFrame(periods, lengths, amplitudes, current_time);
-        }
-        
-        // Get VRC6 state if available
-        if (has_vrc6_ && vrc6_callback) {
-            Nes_Vrc6_Apu* vrc6 = vrc6_callback(emu);
-            if (vrc6) {
-                int vrc6_periods[3], vrc6_volumes[3];
-                bool vrc6_enabled[3];
-                for (int i = 0; i < 3; ++i) {
-                    vrc6_periods[i] = vrc6->osc_period(i);
-                    vrc6_volumes[i] = vrc6->osc_volume(i);
-                    vrc6_enabled[i] = vrc6->osc_enabled(i);
-                }
-                processVrc6Frame(vrc6_periods, vrc6_volumes, vrc6_enabled, current_time);
-            }
-        }
+        // Get the state of every chip
+        processSnapshot(tap.capture(current_time), current_time);
         
         current_time += time_per_chunk;
         chunks_processed++;
         
+        // Partial results
+        if (incremental_preprocess_ && chunks_processed % PREPROCESS_PUBLISH_CHUNKS == 0) {
+            publishPendingNotes(current_time);
+        }
+        
         // Progress callback
         if (progress_callback && chunks_processed % 100 == 0) {
             float progress = std::min(1.0f, current_time / estimated_duration);
@@ -331,123 +341,300 @@ bool PianoVisualizer::preprocessTrack(Music_Emu* emu, int track, long sample_rat
     return true;
 }
 
-void PianoVisualizer::updatePlaybackTime(float current_time) {
-    std::lock_guard<std::mutex> lock(mutex_);
+bool PianoVisualizer::preprocessNsfTrace(Nsf_Emu* emu, int track,
+                                          std::function<void(float)> progress_callback,
+                                          std::function<bool()> cancel_callback) {
+    if (!emu) return false;
+    
+    beginPreprocessing(ApuTap::resolve(emu));
     
-    // Update current notes based on preprocessed data
-    for (int ch = 0; ch < PIANO_NUM_CHANNELS_MAX; ++ch) {
-        current_notes_[ch].active = false;
+    float estimated_duration = 0.0f;
+    if (!estimatePreprocessDuration(emu, track, &estimated_duration)) {
+        return false;
     }
     
-    // Find notes that are active at current_time
-    for (const auto& note : preprocessed_notes_) {
-        if (note.start_time <= current_time && note.end_time > current_time) {
-            int ch = note.channel;
-            if (ch >= 0 && ch < PIANO_NUM_CHANNELS_MAX) {
-                current_notes_[ch].midi_note = note.midi_note;
-                current_notes_[ch].velocity = note.velocity;
-                current_notes_[ch].active = true;
-            }
-        }
+    // Start the track with all sound outputs detached
+    if (emu->start_trace(track) != nullptr) {
+        return false;
     }
-}
-
-void PianoVisualizer::updateFromAPU(const int* periods, const int* lengths, const int* amplitudes, float current_time) {
-    std::lock_guard<std::mutex> lock(mutex_);
     
-    // Update current notes for live keyboard display (base APU channels only)
-    for (int ch = 0; ch < PIANO_NUM_CHANNELS_BASE; ++ch) {
-        int period = periods[ch];
-        int length = lengths[ch];
-        int amp = std::abs(amplitudes[ch]);
+    // Notes are sampled at every play routine call (the NSF's own update
+    // rate), so timing is frame-accurate and identical on every run
+    float current_time = static_cast<float>(emu->trace_time());
+    trace_silent_since_ = current_time;
+    int steps_processed = 0;
+    
+    while (current_time < estimated_duration) {
+        if (cancel_callback && cancel_callback()) {
+            emu->end_trace();
+            pending_notes_.clear();
+            pending_envelopes_.clear();
+            return false;
+        }
         
-        int midi_note = -1;
-        float velocity = 0;
+        if (emu->run_trace(TRACE_STEP_MSEC, &PianoVisualizer::traceFrameCallback, this) != nullptr) {
+            break;
+        }
+        current_time = static_cast<float>(emu->trace_time());
         
-        if (ch == 3) {
-            if (length > 0 && amp > 0) {
-                midi_note = 36 + (15 - (period & 0x0F));
-                velocity = std::min(1.0f, amp / 15.0f);
-            }
-        } else if (ch == 4) {
-            // DMC - check if actively playing
-            if (length > 0) {
-                midi_note = 28;
-                velocity = 0.8f;  // Fixed velocity when DMC is playing
-            }
-        } else if (ch == 2) {
-            // Triangle - no volume control, just on/off
-            if (length > 0 && period >= 8) {
-                float freq = NES_CPU_CLOCK / (16.0f * (period + 1));
-                midi_note = frequencyToMidi(freq);
-                velocity = 0.8f;  // Fixed velocity for Triangle
-            }
-        } else {
-            // Square1, Square2
-            if (length > 0 && amp > 0 && period >= 8) {
-                float freq = NES_CPU_CLOCK / (16.0f * (period + 1));
-                midi_note = frequencyToMidi(freq);
-                velocity = std::min(1.0f, amp / 15.0f);
-            }
+        // The track cycles: one pass of the loop is enough, the roll repeats it.
+        // A "loop" with nothing sounding since it began is just the end.
+        if (trace_loop_found_) {
+            current_time = trace_loop_.start + trace_loop_.length;
+            if (trace_silent_since_ <= trace_loop_.start) trace_loop_ = NoteLoop();
+            break;
         }
         
-        if (midi_note >= 0 && midi_note <= 127 && velocity > 0.01f) {
-            current_notes_[ch].midi_note = midi_note;
-            current_notes_[ch].velocity = velocity;
-            current_notes_[ch].active = true;
-        } else {
-            current_notes_[ch].active = false;
+        // No audio to watch for silence, so end the track the way gme does:
+        // after several seconds with every channel quiet
+        if (current_time - trace_silent_since_ > TRACE_SILENCE_END_SEC) {
+            break;
+        }
+        
+        steps_processed++;
+        
+        // Partial results
+        if (incremental_preprocess_) {
+            publishPendingNotes(current_time);
+        }
+        
+        // Progress callback
+        if (progress_callback && steps_processed % 8 == 0) {
+            progress_callback(std::min(1.0f, current_time / estimated_duration));
         }
     }
+    
+    emu->end_trace();
+    finalizePreprocessing(current_time);
+    
+    if (progress_callback) {
+        progress_callback(1.0f);
+    }
+    
+    return true;
 }
 
-void PianoVisualizer::updateFromVRC6(const int* periods, const int* volumes, const bool* enabled, float current_time) {
-    if (!has_vrc6_) return;
+void PianoVisualizer::traceFrameCallback(void* user_data, double time, Nsf_Emu& emu) {
+    PianoVisualizer* self = static_cast<PianoVisualizer*>(user_data);
+    float current_time = static_cast<float>(time);
+    if (self->trace_loop_found_) return;  // the rest of this run_trace step is a repeat
     
+    // Register state; base amplitudes come from envelope volume since
+    // oscillators don't update last_amp without an output buffer
+    Nes_Apu* apu = emu.apu_();
+    ApuFrameSnapshot snapshot = ApuFrameSnapshot::capture(*apu, emu.vrc6_(), emu.fme7_(), emu.namco_(), time);
+    for (int i = 0; i < ApuFrameSnapshot::BASE_CHANNELS; ++i) {
+        snapshot.amplitudes[i] = apu->osc_volume(i);
+    }
+    
+    // Same memory, CPU and sound registers as an earlier play call: everything
+    // from that call on repeats
+    uint64_t hash = emu.trace_state_hash();
+    for (int ch = 0; ch < snapshot.channel_count; ++ch) {
+        hash = (hash ^ static_cast<uint32_t>(snapshot.periods[ch])) * 0x100000001b3ull;
+        hash = (hash ^ static_cast<uint32_t>(snapshot.amplitudes[ch])) * 0x100000001b3ull;
+        hash = (hash ^ static_cast<uint32_t>(snapshot.volumes[ch])) * 0x100000001b3ull;
+    }
+    auto [seen, inserted] = self->trace_states_.emplace(hash, current_time);
+    if (!inserted && current_time - seen->second >= TRACE_MIN_LOOP_SEC) {
+        self->trace_loop_ = {std::max(0.0f, seen->second), current_time - seen->second};
+        self->trace_loop_found_ = true;
+        return;
+    }
+    
+    if (self->processSnapshot(snapshot, current_time)) {
+        self->trace_silent_since_ = current_time;
+    }
+}
+
+void PianoVisualizer::beginPreprocessing(const ApuTap& tap) {
+    // Reset published state; the run itself works on pending_notes_ without the lock
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        timeline_.clear();
+        ++timeline_version_;
+        has_preprocessed_data_.store(false, std::memory_order_release);
+        preprocess_complete_.store(false, std::memory_order_release);
+        track_duration_.store(0.0f, std::memory_order_release);
+    }
+    pending_notes_.clear();
+    pending_envelopes_.clear();
+    trace_states_.clear();
+    trace_loop_ = NoteLoop();
+    trace_loop_found_ = false;
+    
+    preprocess_layout_ = tap.layout();
+    preprocess_prev_notes_.assign(preprocess_layout_.size(), -1);
+    preprocess_note_start_.assign(preprocess_layout_.size(), 0.0f);
+    preprocess_note_velocity_.assign(preprocess_layout_.size(), 0.0f);
+    preprocess_envelope_.resize(preprocess_layout_.size());
+    preprocess_envelope_samples_.assign(preprocess_layout_.size(), 0);
+    preprocess_envelope_level_.assign(preprocess_layout_.size(), 0);
+}
+
+bool PianoVisualizer::estimatePreprocessDuration(Music_Emu* emu, int track, float* out_seconds) {
+    // Get track info for duration estimate
+    track_info_t info;
+    if (gme_track_info(emu, &info, track) != nullptr) {
+        return false;
+    }
+    
+    // Use the length if available; otherwise run until the trace finds the
+    // loop or the track falls silent
+    float estimated_duration = info.length > 0 ? info.length / 1000.0f : MAX_PREPROCESS_SECONDS;
+    // Notes pack into 12 bytes each plus a few envelope bytes, so even
+    // hour-long tracks stay small
+    *out_seconds = std::min(estimated_duration, MAX_PREPROCESS_SECONDS);
+    return true;
+}
+
+void PianoVisualizer::setPreprocessedNotes(std::vector<PianoRollNote> notes, const std::vector<uint8_t>& envelopes,
+                                           float duration, NoteLoop loop) {
+    NoteTimeline timeline;
+    timeline.assign(std::move(notes), envelopes);
+    timeline.setLoop(loop);
+    setPreprocessedNotes(std::move(timeline), duration);
+}
+
+void PianoVisualizer::setPreprocessedNotes(NoteTimeline timeline, float duration) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    MemoryScope memory(MemoryTag::Notes);
+    timeline_ = std::move(timeline);
+    density_.clear();
+    timeline_.forEach([this](const PianoRollNote& note) { density_.add(note); });
+    ++timeline_version_;
+    track_duration_.store(duration, std::memory_order_release);
+    has_preprocessed_data_.store(true, std::memory_order_release);
+    preprocess_complete_.store(true, std::memory_order_release);
+}
+
+bool PianoVisualizer::getPreprocessedNotes(std::vector<PianoRollNote>& out_notes, std::vector<uint8_t>& out_envelopes,
+                                           float& out_duration, NoteLoop* out_loop) {
     std::lock_guard<std::mutex> lock(mutex_);
+    if (!preprocess_complete_.load(std::memory_order_acquire)) return false;
+    out_notes = timeline_.toNotes(&out_envelopes);
+    out_duration = track_duration_.load(std::memory_order_acquire);
+    if (out_loop) *out_loop = timeline_.loop();
+    return true;
+}
+
+// The keys the preprocessed notes press at current_time, or null if they
+// don't reach it yet (or the roll is live). The detune is only known live,
+// so it is taken over where the APU source plays the same note. Must hold
+// mutex_.
+const std::vector<NesNoteInfo>* PianoVisualizer::indexedNotesAt(float current_time) {
+    if (!has_preprocessed_data_.load(std::memory_order_acquire) || live_roll_) return nullptr;
+    if (current_time >= track_duration_.load(std::memory_order_acquire) && timeline_.loop().length <= 0.0f) return nullptr;
     
-    // VRC6 channels: Pulse1 (5), Pulse2 (6), Saw (7)
-    for (int i = 0; i < PIANO_NUM_CHANNELS_VRC6; ++i) {
-        int ch = PIANO_NUM_CHANNELS_BASE + i;  // 5, 6, 7
-        int period = periods[i];
-        int volume = volumes[i];
-        bool is_enabled = enabled[i];
-        
+    for (int ch = 0; ch < layout_.size(); ++ch) {
+        indexed_notes_[ch] = {ch, 0, 0.0f, false, 0};
+    }
+    timeline_.forEachInRange(current_time, current_time, [&](const PianoRollNote& note) {
+        int ch = note.channel;
+        if (note.start_time > current_time || note.end_time <= current_time || ch < 0 || ch >= layout_.size()) {
+            return;
+        }
+        const NesNoteInfo& live = current_notes_[ch];
+        int cents = live.active && live.midi_note == note.midi_note ? live.cents : 0;
+        indexed_notes_[ch] = {ch, note.midi_note, note.velocity, true, cents};
+    });
+    return &indexed_notes_;
+}
+
+void PianoVisualizer::setApuSource(const ApuSnapshotLock* source) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (source == apu_source_) return;
+    apu_source_ = source;
+    apu_version_seen_ = 0;
+}
+
+void PianoVisualizer::pollApuSource() {
+    if (!apu_source_ || apu_source_->version() == apu_version_seen_) return;
+    
+    ApuFrameSnapshot snapshot;
+    apu_version_seen_ = apu_source_->load(snapshot);
+    
+    // Update current notes for live keyboard display, and the live roll's history
+    int count = snapshot.active ? std::min(layout_.size(), snapshot.channel_count) : 0;
+    for (int ch = 0; ch < layout_.size(); ++ch) {
         int midi_note = -1;
         float velocity = 0;
-        
-        if (is_enabled && volume > 0 && period >= 1) {
-            // VRC6 period formula: freq = CPU_CLOCK / (16 * (period + 1))
-            // Same as NES square waves
-            float freq = NES_CPU_CLOCK / (16.0f * (period + 1));
-            midi_note = frequencyToMidi(freq);
-            
-            if (i < 2) {
-                // Pulse waves - 4-bit volume (0-15)
-                velocity = std::min(1.0f, volume / 15.0f);
-            } else {
-                // Saw wave - accumulator rate (0-63)
-                velocity = std::min(1.0f, volume / 42.0f);  // Typical max is around 42
-            }
-        }
-        
-        if (midi_note >= 0 && midi_note <= 127 && velocity > 0.01f) {
+        int cents = 0;
+        if (ch < count && channelNote(layout_, snapshot, ch, &midi_note, &velocity, &cents)) {
             current_notes_[ch].midi_note = midi_note;
             current_notes_[ch].velocity = velocity;
             current_notes_[ch].active = true;
+            current_notes_[ch].cents = cents;
         } else {
             current_notes_[ch].active = false;
+            midi_note = -1;
+        }
+        if (snapshot.active) {
+            live_notes_.update(ch, midi_note, velocity, static_cast<float>(snapshot.time));
+        }
+    }
+}
+
+void PianoVisualizer::setLiveRoll(bool enabled) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (enabled == live_roll_) return;
+    live_roll_ = enabled;
+    ++timeline_version_;  // the roll switches between timelines
+}
+
+void PianoVisualizer::setLookahead(const std::vector<ApuFrameSnapshot>& frames) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    MemoryScope memory(MemoryTag::Notes);
+    lookahead_timeline_.clear();
+    ++timeline_version_;
+    if (frames.empty()) return;
+    
+    // Each channel's note runs from the frame it starts sounding to the one it changes
+    std::vector<PianoRollNote> notes;
+    std::vector<PianoRollNote> open(layout_.size(), PianoRollNote{0, -1, 0.0f, 0.0f, 0.0f});
+    for (const ApuFrameSnapshot& snapshot : frames) {
+        float time = static_cast<float>(snapshot.time);
+        int count = snapshot.active ? std::min(layout_.size(), snapshot.channel_count) : 0;
+        for (int ch = 0; ch < layout_.size(); ++ch) {
+            int midi_note = -1;
+            float velocity = 0.0f;
+            if (ch < count) channelNote(layout_, snapshot, ch, &midi_note, &velocity);
+            PianoRollNote& note = open[ch];
+            if (note.midi_note == midi_note) continue;
+            if (note.midi_note >= 0) {
+                note.end_time = time;
+                notes.push_back(note);
+            }
+            note = {ch, midi_note, velocity, time, time};
         }
     }
+    float end = static_cast<float>(frames.back().time);
+    for (PianoRollNote& note : open) {
+        if (note.midi_note < 0 || note.start_time >= end) continue;
+        note.end_time = end;
+        notes.push_back(note);
+    }
+    lookahead_timeline_.assign(std::move(notes));
 }
 
+void PianoVisualizer::recordLiveNotes() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    MemoryScope memory(MemoryTag::Notes);
+    pollApuSource();
+}
+
+// Key colors and outlines of the idle keyboard
+static constexpr ImU32 KEY_WHITE = IM_COL32(250, 250, 250, 255);
+static constexpr ImU32 KEY_BLACK = IM_COL32(30, 30, 35, 255);
+static constexpr ImU32 KEY_BORDER = IM_COL32(40, 40, 40, 255);
+
 void PianoVisualizer::drawKey(ImDrawList* draw_list, ImVec2 pos, float width, float height,
                                int midi_note, bool is_black, int pressed_channel, float velocity) {
     ImU32 key_color;
-    ImU32 border_color = IM_COL32(40, 40, 40, 255);
+    ImU32 border_color = KEY_BORDER;
     
-    if (pressed_channel >= 0 && velocity > 0.05f) {
-        key_color = PianoChannelColors[pressed_channel];
+    if (pressed_channel >= 0 && pressed_channel < layout_.size() && velocity > 0.05f) {
+        key_color = PianoChannelColor(layout_[pressed_channel]);
         int r = (key_color & 0xFF);
         int g = (key_color >> 8) & 0xFF;
         int b = (key_color >> 16) & 0xFF;
@@ -459,30 +646,134 @@ void PianoVisualizer::drawKey(ImDrawList* draw_list, ImVec2 pos, float width, fl
             220
         );
     } else {
-        key_color = is_black ? IM_COL32(30, 30, 35, 255) : IM_COL32(250, 250, 250, 255);
+        key_color = is_black ? KEY_BLACK : KEY_WHITE;
     }
     
     draw_list->AddRectFilled(pos, ImVec2(pos.x + width, pos.y + height), key_color, 2.0f);
     draw_list->AddRect(pos, ImVec2(pos.x + width, pos.y + height), border_color, 2.0f);
 }
 
-void PianoVisualizer::drawPianoKeyboard(const char* label, float width, float height) {
-    std::lock_guard<std::mutex> lock(mutex_);
-    
-    ImDrawList* draw_list = ImGui::GetWindowDrawList();
-    ImVec2 canvas_pos = ImGui::GetCursorScreenPos();
+const PianoVisualizer::KeyLayout& PianoVisualizer::keyLayout(float width) {
+    KeyLayout& layout = key_layout_;
+    if (layout.width == width && layout.octave_low == octave_low_ && layout.octave_high == octave_high_) {
+        return layout;
+    }
     
-    int start_note = octave_low_ * 12 + 12;
-    int end_note = octave_high_ * 12 + 12;
+    layout.width = width;
+    layout.octave_low = octave_low_;
+    layout.octave_high = octave_high_;
+    layout.start_note = std::clamp(octave_low_ * 12 + 12, 0, 127);
+    layout.end_note = std::clamp(octave_high_ * 12 + 12, layout.start_note, 127);
     
     int white_key_count = 0;
-    for (int note = start_note; note <= end_note; ++note) {
+    for (int note = layout.start_note; note <= layout.end_note; ++note) {
         if (!isBlackKey(note)) white_key_count++;
     }
     
-    float white_key_width = width / white_key_count;
+    layout.white_key_width = width / std::max(white_key_count, 1);
+    layout.black_key_width = layout.white_key_width * 0.65f;
+    layout.key_x.fill(-1.0f);
+    layout.key_w.fill(0.0f);
+    
+    // Black keys sit centered on the boundary after the preceding white key
+    int white_idx = 0;
+    for (int note = layout.start_note; note <= layout.end_note; ++note) {
+        if (isBlackKey(note)) {
+            layout.key_x[note] = white_idx * layout.white_key_width - layout.black_key_width / 2;
+            layout.key_w[note] = layout.black_key_width;
+        } else {
+            layout.key_x[note] = white_idx * layout.white_key_width;
+            layout.key_w[note] = layout.white_key_width - 1;
+            white_idx++;
+        }
+    }
+    return layout;
+}
+
+void PianoVisualizer::updateKeyboardImage(const KeyLayout& layout, float height) {
+    KeyboardImage& kb = keyboard_image_;
+    float scale = std::max(ImGui::GetIO().DisplayFramebufferScale.x, 1.0f);
+    if (kb.image.id != SG_INVALID_ID && kb.width == layout.width && kb.height == height &&
+        kb.octave_low == layout.octave_low && kb.octave_high == layout.octave_high && kb.scale == scale) {
+        return;
+    }
+    destroyKeyboardImage();
+    kb.width = layout.width;
+    kb.height = height;
+    kb.octave_low = layout.octave_low;
+    kb.octave_high = layout.octave_high;
+    kb.scale = scale;
+    kb.pixel_width = std::max(1, static_cast<int>(std::ceil(layout.width * scale)));
+    kb.pixel_height = std::max(1, static_cast<int>(std::ceil(height * scale)));
+    keyboard_pixels_.assign(static_cast<size_t>(kb.pixel_width) * kb.pixel_height, 0);
+    
+    // A key: filled, a one-point outline, and the corners cut for the rounding
+    auto key = [&](float x, float w, float h, ImU32 fill) {
+        int x0 = std::clamp(static_cast<int>(std::lround(x * scale)), 0, kb.pixel_width);
+        int x1 = std::clamp(static_cast<int>(std::lround((x + w) * scale)), x0, kb.pixel_width);
+        int y1 = std::clamp(static_cast<int>(std::lround(h * scale)), 0, kb.pixel_height);
+        int border = std::max(1, static_cast<int>(scale));
+        for (int y = 0; y < y1; ++y) {
+            uint32_t* row = &keyboard_pixels_[static_cast<size_t>(y) * kb.pixel_width];
+            bool edge_y = y < border || y >= y1 - border;
+            for (int px = x0; px < x1; ++px) {
+                bool edge_x = px < x0 + border || px >= x1 - border;
+                bool corner = (y == 0 || y == y1 - 1) && (px == x0 || px == x1 - 1);
+                row[px] = corner ? 0 : (edge_x || edge_y) ? KEY_BORDER : fill;
+            }
+        }
+    };
+    for (int note = layout.start_note; note <= layout.end_note; ++note) {
+        if (!isBlackKey(note)) key(layout.key_x[note], layout.key_w[note], height, KEY_WHITE);
+    }
+    for (int note = layout.start_note; note <= layout.end_note; ++note) {
+        if (isBlackKey(note)) key(layout.key_x[note], layout.key_w[note], height * 0.6f, KEY_BLACK);
+    }
+    
+    sg_image_desc img_desc = {};
+    img_desc.width = kb.pixel_width;
+    img_desc.height = kb.pixel_height;
+    img_desc.pixel_format = SG_PIXELFORMAT_RGBA8;
+    img_desc.data.mip_levels[0].ptr = keyboard_pixels_.data();
+    img_desc.data.mip_levels[0].size = keyboard_pixels_.size() * sizeof(uint32_t);
+    img_desc.label = "piano-keyboard";
+    kb.image = MakeGpuImage(&img_desc);
+    
+    sg_view_desc view_desc = {};
+    view_desc.texture.image = kb.image;
+    kb.view = sg_make_view(&view_desc);
+    
+    sg_sampler_desc smp_desc = {};
+    smp_desc.min_filter = SG_FILTER_NEAREST;
+    smp_desc.mag_filter = SG_FILTER_NEAREST;
+    smp_desc.wrap_u = SG_WRAP_CLAMP_TO_EDGE;
+    smp_desc.wrap_v = SG_WRAP_CLAMP_TO_EDGE;
+    kb.sampler = sg_make_sampler(&smp_desc);
+}
+
+void PianoVisualizer::destroyKeyboardImage() {
+    KeyboardImage& kb = keyboard_image_;
+    if (kb.image.id == SG_INVALID_ID) return;
+    sg_destroy_sampler(kb.sampler);
+    sg_destroy_view(kb.view);
+    DestroyGpuImage(kb.image);
+    kb = KeyboardImage();
+}
+
+void PianoVisualizer::drawPianoKeyboard(const char* label, float width, float height, float current_time) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    pollApuSource();
+    const std::vector<NesNoteInfo>* indexed = indexedNotesAt(current_time);
+    const std::vector<NesNoteInfo>& notes = indexed ? *indexed : current_notes_;
+    
+    ImDrawList* draw_list = ImGui::GetWindowDrawList();
+    ImVec2 canvas_pos = ImGui::GetCursorScreenPos();
+    
+    const KeyLayout& layout = keyLayout(width);
+    int start_note = layout.start_note;
+    int end_note = layout.end_note;
+    
     float white_key_height = height;
-    float black_key_width = white_key_width * 0.65f;
     float black_key_height = height * 0.6f;
     
     // Build map of pressed keys
@@ -492,59 +783,71 @@ void PianoVisualizer::drawPianoKeyboard(const char* label, float width, float he
     note_velocity.fill(0.0f);
     
     for (int ch = 0; ch < getActiveChannelCount(); ++ch) {
-        if (current_notes_[ch].active && current_notes_[ch].midi_note >= 0 && 
-            current_notes_[ch].midi_note < 128) {
-            int note = current_notes_[ch].midi_note;
-            if (note_channel[note] < 0 || current_notes_[ch].velocity > note_velocity[note]) {
+        if (notes[ch].active && notes[ch].midi_note >= 0 && 
+            notes[ch].midi_note < 128) {
+            int note = notes[ch].midi_note;
+            if (note_channel[note] < 0 || notes[ch].velocity > note_velocity[note]) {
                 note_channel[note] = ch;
-                note_velocity[note] = current_notes_[ch].velocity;
+                note_velocity[note] = notes[ch].velocity;
             }
         }
     }
     
-    // Draw white keys
-    int white_key_idx = 0;
+    // Idle keyboard in one quad
+    updateKeyboardImage(layout, height);
+    const KeyboardImage& kb = keyboard_image_;
+    draw_list->AddImage(simgui_imtextureid_with_sampler(kb.view, kb.sampler), canvas_pos,
+                        ImVec2(canvas_pos.x + kb.pixel_width / kb.scale, canvas_pos.y + kb.pixel_height / kb.scale));
+    
+    // Pressed white keys, then the black keys pressed or overlapping one
+    auto pressed = [&](int note) {
+        return note >= start_note && note <= end_note && note_channel[note] >= 0 && note_velocity[note] > 0.05f;
+    };
     for (int note = start_note; note <= end_note; ++note) {
-        if (!isBlackKey(note)) {
-            ImVec2 key_pos(canvas_pos.x + white_key_idx * white_key_width, canvas_pos.y);
-            drawKey(draw_list, key_pos, white_key_width - 1, white_key_height,
+        if (!isBlackKey(note) && pressed(note)) {
+            ImVec2 key_pos(canvas_pos.x + layout.key_x[note], canvas_pos.y);
+            drawKey(draw_list, key_pos, layout.key_w[note], white_key_height,
                    note, false, note_channel[note], note_velocity[note]);
-            white_key_idx++;
         }
     }
-    
-    // Draw black keys
-    white_key_idx = 0;
     for (int note = start_note; note <= end_note; ++note) {
-        if (!isBlackKey(note)) {
-            if (note + 1 <= end_note && isBlackKey(note + 1)) {
-                float black_x = canvas_pos.x + white_key_idx * white_key_width + 
-                               white_key_width - black_key_width / 2;
-                ImVec2 key_pos(black_x, canvas_pos.y);
-                drawKey(draw_list, key_pos, black_key_width, black_key_height,
-                       note + 1, true, note_channel[note + 1], note_velocity[note + 1]);
-            }
-            white_key_idx++;
+        if (isBlackKey(note) && (pressed(note) || pressed(note - 1) || pressed(note + 1))) {
+            ImVec2 key_pos(canvas_pos.x + layout.key_x[note], canvas_pos.y);
+            drawKey(draw_list, key_pos, layout.key_w[note], black_key_height,
+                   note, true, note_channel[note], note_velocity[note]);
         }
     }
     
+    // Bend markers: a tick across each sounding key, off center by the
+    // channel's detune (half a key width per 50 cents)
+    for (int ch = 0; ch < getActiveChannelCount(); ++ch) {
+        const NesNoteInfo& info = notes[ch];
+        int note = info.midi_note;
+        if (!info.active || note < start_note || note > end_note || note_channel[note] != ch) continue;
+        if (std::abs(info.cents) < 5) continue;
+        bool black = isBlackKey(note);
+        float key_height = black ? black_key_height : white_key_height;
+        float x = canvas_pos.x + layout.key_x[note] + layout.key_w[note] * (0.5f + info.cents / 100.0f);
+        float y = canvas_pos.y + key_height * 0.7f;
+        draw_list->AddLine(ImVec2(x, y), ImVec2(x, y + key_height * 0.2f), IM_COL32(255, 255, 255, 220), 2.0f);
+    }
+    
     // Draw octave labels
-    white_key_idx = 0;
     for (int note = start_note; note <= end_note; ++note) {
-        if (!isBlackKey(note) && getNoteInOctave(note) == 0) {
-            float label_x = canvas_pos.x + white_key_idx * white_key_width + 2;
+        if (getNoteInOctave(note) == 0) {
+            float label_x = canvas_pos.x + layout.key_x[note] + 2;
             float label_y = canvas_pos.y + white_key_height - 14;
             char octave_label[8];
             snprintf(octave_label, sizeof(octave_label), "C%d", getOctave(note));
             draw_list->AddText(ImVec2(label_x, label_y), IM_COL32(100, 100, 100, 255), octave_label);
         }
-        if (!isBlackKey(note)) white_key_idx++;
     }
     
     ImGui::Dummy(ImVec2(width, height));
 }
 
 void PianoVisualizer::drawPianoRoll(const char* label, float width, float height, float current_time) {
+    PROFILE_STAGE(PianoRoll);
     std::lock_guard<std::mutex> lock(mutex_);
     
     ImDrawList* draw_list = ImGui::GetWindowDrawList();
@@ -555,32 +858,89 @@ void PianoVisualizer::drawPianoRoll(const char* label, float width, float height
                             ImVec2(canvas_pos.x + width, canvas_pos.y + height),
                             IM_COL32(20, 20, 28, 255));
     
-    int start_note = octave_low_ * 12 + 12;
-    int end_note = octave_high_ * 12 + 12;
+    // The CPU-drawn rolls are built on a job worker when there is one, with
+    // mutex_ held there once this call has let go of it
+    const KeyLayout& layout = keyLayout(width);
+    bool worker = canvas_jobs_ != nullptr;
+    if (live_roll_) {
+        pollApuSource();
+        if (!lookahead_) {
+            BuildCanvas(canvas_jobs_, [this, worker, layout, canvas_pos, width, height, current_time](ImDrawList& draw_list) {
+                std::unique_lock<std::mutex> lock(mutex_, std::defer_lock);
+                if (worker) lock.lock();
+                drawLiveNotes(&draw_list, layout, canvas_pos, width, height, current_time);
+            });
+            ImGui::Dummy(ImVec2(width, height));
+            return;
+        }
+    }
     
-    // Count white keys
-    int white_key_count = 0;
-    for (int note = start_note; note <= end_note; ++note) {
-        if (!isBlackKey(note)) white_key_count++;
+    if (!gpu_roll_tried_) {
+        gpu_roll_tried_ = true;
+        gpu_roll_.init();
+        gpu_roll_version_ = timeline_version_ - 1;
     }
     
-    float white_key_width = width / white_key_count;
-    float black_key_width = white_key_width * 0.65f;
+    // The live roll's look-ahead draws its predicted notes the same way
+    bool lookahead = live_roll_;
+    const NoteTimeline& timeline = lookahead ? lookahead_timeline_ : timeline_;
+    bool has_notes = lookahead ? !lookahead_timeline_.empty() : has_preprocessed_data_.load(std::memory_order_acquire);
     
+    // Draw notes from preprocessed data: one instanced draw of the uploaded
+    // track, or a rectangle list rebuilt every frame
+    if (has_notes && gpu_roll_.isValid()) {
+        if (gpu_roll_version_ != timeline_version_) {
+            std::vector<ImU32> colors(layout_.size());
+            for (int ch = 0; ch < layout_.size(); ++ch) colors[ch] = PianoChannelColor(layout_[ch]);
+            gpu_roll_.upload(timeline, colors.data(), layout_.size());
+            gpu_roll_version_ = timeline_version_;
+        }
+        drawRollGrid(draw_list, layout, canvas_pos, width, height, current_time);
+        
+        NoteRollRenderer::View view;
+        view.pos = canvas_pos;
+        view.size = ImVec2(width, height);
+        view.current_time = current_time;
+        view.seconds_visible = piano_roll_seconds_;
+        view.white_key_width = layout.white_key_width;
+        view.start_note = layout.start_note;
+        view.end_note = layout.end_note;
+        view.loop = timeline.loop();
+        gpu_roll_.draw(draw_list, view);
+        drawRollEdges(draw_list, canvas_pos, width, height);
+    } else {
+        BuildCanvas(canvas_jobs_, [this, worker, layout, lookahead, has_notes, canvas_pos, width, height,
+                                   current_time](ImDrawList& draw_list) {
+            std::unique_lock<std::mutex> lock(mutex_, std::defer_lock);
+            if (worker) lock.lock();
+            drawRollGrid(&draw_list, layout, canvas_pos, width, height, current_time);
+            if (has_notes) {
+                drawTimelineNotes(&draw_list, lookahead ? lookahead_timeline_ : timeline_, layout,
+                                  canvas_pos, height, current_time);
+            }
+            drawRollEdges(&draw_list, canvas_pos, width, height);
+        });
+    }
+    
+    ImGui::Dummy(ImVec2(width, height));
+}
+
+// Lanes of the white keys and the half-second grid of the preprocessed roll
+void PianoVisualizer::drawRollGrid(ImDrawList* draw_list, const KeyLayout& layout, ImVec2 canvas_pos,
+                                   float width, float height, float current_time) {
     // Time range: show FUTURE notes (current_time at bottom, future at top)
     float time_end = current_time + piano_roll_seconds_;
     float pixels_per_second = height / piano_roll_seconds_;
     
     // Draw lane backgrounds
-    int white_key_idx = 0;
-    for (int note = start_note; note <= end_note; ++note) {
+    for (int note = layout.start_note; note <= layout.end_note; ++note) {
         if (!isBlackKey(note)) {
-            float x = canvas_pos.x + white_key_idx * white_key_width;
+            float x = canvas_pos.x + layout.key_x[note];
             ImU32 lane_color = (getNoteInOctave(note) == 0) ? 
                 IM_COL32(35, 35, 45, 255) : IM_COL32(28, 28, 36, 255);
             draw_list->AddRectFilled(
                 ImVec2(x, canvas_pos.y),
-                ImVec2(x + white_key_width, canvas_pos.y + height),
+                ImVec2(x + layout.white_key_width, canvas_pos.y + height),
                 lane_color
             );
             draw_list->AddLine(
@@ -588,7 +948,6 @@ void PianoVisualizer::drawPianoRoll(const char* label, float width, float height
                 ImVec2(x, canvas_pos.y + height),
                 IM_COL32(50, 50, 60, 255)
             );
-            white_key_idx++;
         }
     }
     
@@ -607,77 +966,82 @@ void PianoVisualizer::drawPianoRoll(const char* label, float width, float height
             );
         }
     }
+}
+
+// The CPU path of the preprocessed roll: a rectangle per envelope run
+void PianoVisualizer::drawTimelineNotes(ImDrawList* draw_list, const NoteTimeline& timeline, const KeyLayout& layout,
+                                        ImVec2 canvas_pos, float height, float current_time) {
+    int start_note = layout.start_note;
+    int end_note = layout.end_note;
+    float time_end = current_time + piano_roll_seconds_;
+    float pixels_per_second = height / piano_roll_seconds_;
     
     // Helper to get X position for a note
     auto getNoteX = [&](int midi_note) -> std::pair<float, float> {
         if (midi_note < start_note || midi_note > end_note) 
             return {-1, -1};
-        
-        int white_idx = 0;
-        for (int n = start_note; n < midi_note; ++n) {
-            if (!isBlackKey(n)) white_idx++;
-        }
-        
-        if (isBlackKey(midi_note)) {
-            float x = canvas_pos.x + white_idx * white_key_width - black_key_width / 2;
-            return {x, black_key_width};
-        } else {
-            float x = canvas_pos.x + white_idx * white_key_width;
-            return {x, white_key_width - 1};
-        }
+        return {canvas_pos.x + layout.key_x[midi_note], layout.key_w[midi_note]};
     };
     
-    // Draw notes from preprocessed data
-    if (has_preprocessed_data_) {
-        for (const auto& note : preprocessed_notes_) {
-            // Only show notes in the visible time window
-            if (note.end_time < current_time || note.start_time > time_end) continue;
-            if (note.midi_note < start_note || note.midi_note > end_note) continue;
-            
-            // Y positions: bottom = current_time, top = future
-            // note.start_time -> y2 (note starts, appears from top)
-            // note.end_time -> y1 (note ends, reaches bottom and disappears)
-            float y_start = canvas_pos.y + height - (note.start_time - current_time) * pixels_per_second;
-            float y_end = canvas_pos.y + height - (note.end_time - current_time) * pixels_per_second;
-            
-            // y1 is top (smaller Y, earlier/end), y2 is bottom (larger Y, later/start)
-            float y1 = std::max(y_end, canvas_pos.y);
-            float y2 = std::min(y_start, canvas_pos.y + height);
-            
-            if (y2 <= y1) continue;
-            
-            auto [note_x, note_width] = getNoteX(note.midi_note);
-            if (note_x < 0) continue;
-            
-            ImU32 note_color = PianoChannelColors[note.channel];
-            
-            // Glow effect for notes about to be played
-            bool about_to_play = (note.start_time <= current_time + 0.1f && note.start_time >= current_time);
-            if (about_to_play) {
-                ImU32 glow_color = note_color & 0x00FFFFFF;
-                glow_color |= 0x60000000;
-                draw_list->AddRectFilled(
-                    ImVec2(note_x - 3, y1 - 3),
-                    ImVec2(note_x + note_width + 3, y2 + 3),
-                    glow_color, 5.0f
-                );
-            }
-            
-            // Draw note
+    timeline.forEachInRange(current_time, time_end, [&](const PianoRollNote& note) {
+        // Only show notes in the visible time window
+        if (note.end_time < current_time || note.start_time > time_end) return;
+        if (note.midi_note < start_note || note.midi_note > end_note) return;
+        
+        // Y positions: bottom = current_time, top = future
+        // note.start_time -> y2 (note starts, appears from top)
+        // note.end_time -> y1 (note ends, reaches bottom and disappears)
+        float y_start = canvas_pos.y + height - (note.start_time - current_time) * pixels_per_second;
+        float y_end = canvas_pos.y + height - (note.end_time - current_time) * pixels_per_second;
+        
+        // y1 is top (smaller Y, earlier/end), y2 is bottom (larger Y, later/start)
+        float y1 = std::max(y_end, canvas_pos.y);
+        float y2 = std::min(y_start, canvas_pos.y + height);
+        
+        if (y2 <= y1) return;
+        
+        auto [note_x, note_width] = getNoteX(note.midi_note);
+        if (note_x < 0 || note.channel >= layout_.size()) return;
+        
+        ImU32 note_color = PianoChannelColor(layout_[note.channel]);
+        
+        // Glow effect for notes about to be played
+        bool about_to_play = (note.start_time <= current_time + 0.1f && note.start_time >= current_time);
+        if (about_to_play) {
+            ImU32 glow_color = note_color & 0x00FFFFFF;
+            glow_color |= 0x60000000;
             draw_list->AddRectFilled(
-                ImVec2(note_x + 1, y1),
-                ImVec2(note_x + note_width - 1, y2),
-                note_color, 3.0f
-            );
-            
-            draw_list->AddRect(
-                ImVec2(note_x + 1, y1),
-                ImVec2(note_x + note_width - 1, y2),
-                IM_COL32(255, 255, 255, 80), 3.0f
+                ImVec2(note_x - 3, y1 - 3),
+                ImVec2(note_x + note_width + 3, y2 + 3),
+                glow_color, 5.0f
             );
         }
-    }
-    
+        
+        // Draw note, each stretch of its envelope as bright as it is loud;
+        // only the ends are rounded
+        timeline.forEachEnvelopeRun(note, [&](float run_start, float run_end, int level) {
+            float run_y2 = std::min(canvas_pos.y + height - (run_start - current_time) * pixels_per_second, y2);
+            float run_y1 = std::max(canvas_pos.y + height - (run_end - current_time) * pixels_per_second, y1);
+            if (run_y2 <= run_y1) return;
+            ImDrawFlags corners = (run_y1 <= y1 ? ImDrawFlags_RoundCornersTop : 0) |
+                                  (run_y2 >= y2 ? ImDrawFlags_RoundCornersBottom : 0);
+            draw_list->AddRectFilled(
+                ImVec2(note_x + 1, run_y1),
+                ImVec2(note_x + note_width - 1, run_y2),
+                NoteRollRenderer::envelopeColor(note_color, level), 3.0f,
+                corners ? corners : ImDrawFlags_RoundCornersNone
+            );
+        });
+        
+        draw_list->AddRect(
+            ImVec2(note_x + 1, y1),
+            ImVec2(note_x + note_width - 1, y2),
+            IM_COL32(255, 255, 255, 80), 3.0f
+        );
+    });
+}
+
+void PianoVisualizer::drawRollEdges(ImDrawList* draw_list, ImVec2 canvas_pos, float width, float height) {
     // Draw hit line at bottom
     draw_list->AddLine(
         ImVec2(canvas_pos.x, canvas_pos.y + height - 2),
@@ -689,8 +1053,129 @@ void PianoVisualizer::drawPianoRoll(const char* label, float width, float height
     draw_list->AddRect(canvas_pos, 
                       ImVec2(canvas_pos.x + width, canvas_pos.y + height),
                       IM_COL32(60, 60, 80, 255));
+}
+
+// Live roll: the hit line is now and the notes just heard rise from it, so a
+// note's start is its bottom edge. Drawn with the CPU path, the history
+// being short and capped per frame.
+void PianoVisualizer::drawLiveNotes(ImDrawList* draw_list, const KeyLayout& layout, ImVec2 canvas_pos,
+                                    float width, float height, float current_time) {
+    float time_begin = current_time - piano_roll_seconds_;
+    float pixels_per_second = height / piano_roll_seconds_;
+    float bottom = canvas_pos.y + height;
     
-    ImGui::Dummy(ImVec2(width, height));
+    for (int note = layout.start_note; note <= layout.end_note; ++note) {
+        if (isBlackKey(note)) continue;
+        float x = canvas_pos.x + layout.key_x[note];
+        ImU32 lane_color = (getNoteInOctave(note) == 0) ?
+            IM_COL32(35, 35, 45, 255) : IM_COL32(28, 28, 36, 255);
+        draw_list->AddRectFilled(ImVec2(x, canvas_pos.y), ImVec2(x + layout.white_key_width, bottom), lane_color);
+        draw_list->AddLine(ImVec2(x, canvas_pos.y), ImVec2(x, bottom), IM_COL32(50, 50, 60, 255));
+    }
+    
+    float time_grid = 0.5f;
+    for (float t = std::floor(current_time / time_grid) * time_grid; t >= time_begin; t -= time_grid) {
+        float y = bottom - (current_time - t) * pixels_per_second;
+        if (y >= canvas_pos.y && y <= bottom) {
+            draw_list->AddLine(ImVec2(canvas_pos.x, y), ImVec2(canvas_pos.x + width, y), IM_COL32(45, 45, 55, 255));
+        }
+    }
+    
+    live_notes_.forEachInRange(time_begin, current_time, MAX_LIVE_NOTES_DRAWN, [&](const PianoRollNote& note) {
+        if (note.midi_note < layout.start_note || note.midi_note > layout.end_note) return;
+        if (note.channel >= layout_.size()) return;
+        float y1 = std::max(bottom - (current_time - note.end_time) * pixels_per_second, canvas_pos.y);
+        float y2 = std::min(bottom - (current_time - note.start_time) * pixels_per_second, bottom);
+        if (y2 <= y1) return;
+        
+        float note_x = canvas_pos.x + layout.key_x[note.midi_note];
+        float note_width = layout.key_w[note.midi_note];
+        ImU32 note_color = PianoChannelColor(layout_[note.channel]);
+        draw_list->AddRectFilled(ImVec2(note_x + 1, y1), ImVec2(note_x + note_width - 1, y2),
+                                 NoteRollRenderer::envelopeColor(note_color, NoteTimeline::envelopeLevel(note.velocity)),
+                                 3.0f);
+        draw_list->AddRect(ImVec2(note_x + 1, y1), ImVec2(note_x + note_width - 1, y2),
+                           IM_COL32(255, 255, 255, 80), 3.0f);
+    });
+    
+    // Hit line and border, as for the preprocessed roll
+    draw_list->AddLine(ImVec2(canvas_pos.x, bottom - 2), ImVec2(canvas_pos.x + width, bottom - 2),
+                       IM_COL32(255, 255, 255, 180), 3.0f);
+    draw_list->AddRect(canvas_pos, ImVec2(canvas_pos.x + width, bottom), IM_COL32(60, 60, 80, 255));
+}
+
+bool PianoVisualizer::drawTrackOverview(const char* id, float width, float height, float track_seconds,
+                                        float current_time, float* seek_time) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (density_.empty() || layout_.size() == 0 || track_seconds <= 0.0f || width < 1.0f) return false;
+    
+    ImDrawList* draw_list = ImGui::GetWindowDrawList();
+    ImVec2 pos = ImGui::GetCursorScreenPos();
+    draw_list->AddRectFilled(pos, ImVec2(pos.x + width, pos.y + height), IM_COL32(20, 20, 28, 255), 3.0f);
+    
+    // One column per pixel, each read from about one bucket of the matching
+    // level. Past the stored notes a loop plays its section again; a column
+    // there reads the part of the loop it stands for.
+    int columns = static_cast<int>(width);
+    float column_seconds = track_seconds / columns;
+    int level = NoteDensity::levelFor(track_seconds, columns);
+    const NoteLoop& loop = timeline_.loop();
+    float loop_end = loop.start + loop.length;
+    auto fold = [&](float t) {
+        return loop.length > 0.0f && t >= loop_end ? loop.start + std::fmod(t - loop.start, loop.length) : t;
+    };
+    
+    // Row per channel; runs of columns at the same (quantized) level are one rectangle
+    constexpr int SHADES = 8;
+    float row_height = height / layout_.size();
+    for (int ch = 0; ch < layout_.size(); ++ch) {
+        ImU32 color = PianoChannelColor(layout_[ch], 255) & 0x00FFFFFF;
+        float y0 = pos.y + ch * row_height;
+        float y1 = y0 + std::max(row_height - 1.0f, 1.0f);
+        int run_start = 0;
+        int run_shade = 0;
+        for (int x = 0; x <= columns; ++x) {
+            int shade = 0;
+            if (x < columns) {
+                float begin = fold(x * column_seconds);
+                float occupancy = density_.occupancy(level, ch, begin, begin + column_seconds);
+                shade = occupancy > 0.0f ? std::max(1, static_cast<int>(std::ceil(occupancy * SHADES))) : 0;
+            }
+            if (shade == run_shade && x < columns) continue;
+            if (run_shade > 0) {
+                int alpha = 60 + 195 * run_shade / SHADES;
+                draw_list->AddRectFilled(ImVec2(pos.x + run_start, y0), ImVec2(pos.x + x, y1),
+                                         color | static_cast<ImU32>(alpha) << IM_COL32_A_SHIFT);
+            }
+            run_start = x;
+            run_shade = shade;
+        }
+    }
+    
+    // Not yet analyzed part of a track still preprocessing
+    float analyzed = track_duration_.load(std::memory_order_acquire);
+    if (!preprocess_complete_.load(std::memory_order_acquire) && analyzed < track_seconds) {
+        float x = pos.x + width * std::max(analyzed, 0.0f) / track_seconds;
+        draw_list->AddRectFilled(ImVec2(x, pos.y), ImVec2(pos.x + width, pos.y + height), IM_COL32(0, 0, 0, 120));
+    }
+    
+    float cursor = pos.x + width * std::clamp(current_time / track_seconds, 0.0f, 1.0f);
+    draw_list->AddLine(ImVec2(cursor, pos.y), ImVec2(cursor, pos.y + height), IM_COL32(255, 255, 255, 220), 2.0f);
+    draw_list->AddRect(pos, ImVec2(pos.x + width, pos.y + height), IM_COL32(60, 60, 80, 255), 3.0f);
+    
+    ImGui::InvisibleButton(id, ImVec2(width, height));
+    if (ImGui::IsItemActive() && seek_time) {
+        float fraction = (ImGui::GetIO().MousePos.x - pos.x) / width;
+        *seek_time = std::clamp(fraction, 0.0f, 1.0f) * track_seconds;
+        return true;
+    }
+    return false;
+}
+
+void PianoVisualizer::destroyRenderResources() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (gpu_roll_.isValid()) gpu_roll_.shutdown();
+    destroyKeyboardImage();
 }
 
 void PianoVisualizer::drawPianoWindow(bool* p_open, float current_time) {
@@ -705,26 +1190,57 @@ void PianoVisualizer::drawPianoWindow(bool* p_open, float current_time) {
     float available_height = ImGui::GetContentRegionAvail().y;
     
     // Status and legend
-    if (has_preprocessed_data_) {
+    bool has_data = has_preprocessed_data_.load(std::memory_order_acquire);
+    bool complete = preprocess_complete_.load(std::memory_order_acquire);
+    float duration = track_duration_.load(std::memory_order_acquire);
+    if (live_roll_ && lookahead_) {
+        ImGui::TextColored(ImVec4(0.3f, 1.0f, 0.3f, 1.0f), "Predicted");
+        ImGui::SameLine();
+        ImGui::Text("(%zu notes)", lookahead_timeline_.size());
+    } else if (live_roll_) {
+        ImGui::TextColored(ImVec4(0.3f, 1.0f, 0.3f, 1.0f), "Live");
+        ImGui::SameLine();
+        ImGui::Text("(%zu notes)", live_notes_.size());
+    } else if (has_data && !complete) {
+        ImGui::TextColored(ImVec4(1.0f, 0.8f, 0.3f, 1.0f), "Analyzing");
+        ImGui::SameLine();
+        ImGui::Text("(%.1fs)", duration);
+    } else if (has_data) {
         ImGui::TextColored(ImVec4(0.3f, 1.0f, 0.3f, 1.0f), "Ready");
         ImGui::SameLine();
-        ImGui::Text("(%.1fs)", track_duration_);
+        const NoteLoop& loop = timeline_.loop();
+        if (loop.length > 0.0f) {
+            ImGui::Text("(loops %.1fs from %.1fs)", loop.length, loop.start);
+        } else {
+            ImGui::Text("(%.1fs)", duration);
+        }
     } else {
         ImGui::TextColored(ImVec4(1.0f, 1.0f, 0.3f, 1.0f), "No data - load a track to preprocess");
     }
     
     ImGui::SameLine(150);
     for (int i = 0; i < getActiveChannelCount(); ++i) {
-        ImVec4 color = ImGui::ColorConvertU32ToFloat4(PianoChannelColors[i]);
-        ImGui::ColorButton(PianoChannelNames[i], color, ImGuiColorEditFlags_NoTooltip, ImVec2(16, 14));
+        ImVec4 color = ImGui::ColorConvertU32ToFloat4(PianoChannelColor(layout_[i]));
+        ImGui::ColorButton(layout_[i].short_name, color, ImGuiColorEditFlags_NoTooltip, ImVec2(16, 14));
         ImGui::SameLine();
-        ImGui::Text("%s", PianoChannelNames[i]);
+        ImGui::Text("%s", layout_[i].short_name);
         ImGui::SameLine();
     }
     
+    if (live_roll_) {
+        ImGui::SameLine(available_width - 370);
+        if (ImGui::Checkbox("Predict", &lookahead_)) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            lookahead_timeline_.clear();
+            ++timeline_version_;
+        }
+        if (ImGui::IsItemHovered(ImGuiHoveredFlags_DelayNormal)) {
+            ImGui::SetTooltip("Run a copy of the game ahead with the pads held\nand show the notes it plays next");
+        }
+    }
     ImGui::SameLine(available_width - 280);
     ImGui::SetNextItemWidth(80);
-    ImGui::SliderFloat("Ahead", &piano_roll_seconds_, 1.0f, 6.0f, "%.1fs");
+    ImGui::SliderFloat(live_roll_ && !lookahead_ ? "Behind" : "Ahead", &piano_roll_seconds_, 1.0f, 6.0f, "%.1fs");
     ImGui::SameLine();
     ImGui::SetNextItemWidth(60);
     ImGui::SliderInt("##oct1", &octave_low_, 1, 5);
@@ -740,11 +1256,11 @@ void PianoVisualizer::drawPianoWindow(bool* p_open, float current_time) {
     float keyboard_height = 90;
     float roll_height = available_height - keyboard_height - 30;
     
-    // Piano roll (future notes falling down)
+    // Piano roll (future notes falling down, or past ones rising)
     drawPianoRoll("##roll", available_width, roll_height, current_time);
     
     // Keyboard (at bottom)
-    drawPianoKeyboard("##keyboard", available_width, keyboard_height);
+    drawPianoKeyboard("##keyboard", available_width, keyboard_height, current_time);
     
     ImGui::End();
 }
@@ -1,59 +1,40 @@
 #pragma once
 
 #include "imgui.h"
+#include "ApuSnapshot.h"
+#include "ChannelLayout.h"
+#include "NoteTimeline.h"
+#include "LiveNoteHistory.h"
+#include "NoteDensity.h"
+#include "NoteRollRenderer.h"
+#include "CanvasJobs.h"
 #include <vector>
 #include <array>
+#include <atomic>
 #include <deque>
 #include <mutex>
 #include <cmath>
 #include <functional>
+#include <unordered_map>
 
 // Forward declarations
 struct Music_Emu;
-class Nes_Apu;
-class Nes_Vrc6_Apu;
+class Nsf_Emu;
+struct ApuTap;
 
 // NES APU channel info for piano visualization
 struct NesNoteInfo {
-    int channel;        // 0-7: Square1, Square2, Triangle, Noise, DMC, VRC6_Pulse1, VRC6_Pulse2, VRC6_Saw
+    int channel;        // ChannelLayout index
     int midi_note;      // MIDI note number (0-127)
     float velocity;     // 0.0 - 1.0
     bool active;        // Is the note currently playing
+    int cents;          // Detune from midi_note (vibrato, pitch bends), live notes only
 };
 
-// Piano roll note event (preprocessed)
-struct PianoRollNote {
-    int channel;
-    int midi_note;
-    float velocity;
-    float start_time;   // In seconds
-    float end_time;     // In seconds (when note ends)
-};
-
-// Maximum channel count (base APU + VRC6)
-constexpr int PIANO_NUM_CHANNELS_BASE = 5;
-constexpr int PIANO_NUM_CHANNELS_VRC6 = 3;
-constexpr int PIANO_NUM_CHANNELS_MAX = 8;
-
-// Channel colors for piano visualization
-inline const ImU32 PianoChannelColors[] = {
-    IM_COL32(255, 80, 80, 220),   // Square 1 - Red
-    IM_COL32(255, 160, 60, 220),  // Square 2 - Orange
-    IM_COL32(80, 180, 255, 220),  // Triangle - Blue
-    IM_COL32(230, 80, 230, 220),  // Noise - Magenta
-    IM_COL32(230, 230, 80, 220),  // DMC - Yellow
-    IM_COL32(60, 230, 130, 220),  // VRC6 Pulse1 - Green
-    IM_COL32(100, 230, 180, 220), // VRC6 Pulse2 - Light Green
-    IM_COL32(150, 100, 230, 220)  // VRC6 Saw - Purple
-};
-
-inline const char* PianoChannelNames[] = {
-    "Sq1", "Sq2", "Tri", "Noi", "DMC", "V-P1", "V-P2", "V-Saw"
-};
-
-// Callback type for getting APU data during preprocessing
-using ApuDataCallback = std::function<Nes_Apu*(Music_Emu*)>;
-using Vrc6DataCallback = std::function<Nes_Vrc6_Apu*(Music_Emu*)>;
+// Channel color for piano visualization
+inline ImU32 PianoChannelColor(const ChannelLayout::Channel& channel, int alpha = 220) {
+    return IM_COL32((channel.rgb >> 16) & 0xFF, (channel.rgb >> 8) & 0xFF, channel.rgb & 0xFF, alpha);
+}
 
 class PianoVisualizer {
 public:
@@ -65,38 +46,112 @@ public:
 
     // Preprocess a track to generate all note data ahead of time
     // Returns true if successful, false if preprocessing failed
+    // tap: chip handles for emu, resolved once by the caller (ApuTap::resolve)
     // progress_callback: optional callback for progress updates (0.0-1.0)
+    // cancel_callback: polled once per chunk; returning true abandons the run
+    // Safe to call from a worker thread - results are published under the lock at the end
     bool preprocessTrack(Music_Emu* emu, int track, long sample_rate,
-                        ApuDataCallback apu_callback,
+                        const ApuTap& tap,
                         std::function<void(float)> progress_callback = nullptr,
-                        Vrc6DataCallback vrc6_callback = nullptr);
+                        std::function<bool()> cancel_callback = nullptr);
+    
+    // Fast path for NSF files: runs the 6502 and APU registers through
+    // Nsf_Emu's register trace without synthesizing any audio, sampling
+    // note state once per play routine call
+    bool preprocessNsfTrace(Nsf_Emu* emu, int track,
+                           std::function<void(float)> progress_callback = nullptr,
+                           std::function<bool()> cancel_callback = nullptr);
     
-    // Check if we have preprocessed data
-    bool hasPreprocessedData() const { return has_preprocessed_data_; }
+    // Check if we have preprocessed data (may be partial while a run is in progress)
+    bool hasPreprocessedData() const { return has_preprocessed_data_.load(std::memory_order_acquire); }
+    bool isPreprocessingComplete() const { return preprocess_complete_.load(std::memory_order_acquire); }
+    
+    // Incremental mode publishes finished notes every few chunks so the roll
+    // can start drawing before the whole track has been analyzed
+    void setIncrementalPreprocessing(bool enabled) { incremental_preprocess_ = enabled; }
+    
+    // Hand every note to sink as soon as it ends instead of collecting them
+    // for the roll (exporters). Per channel, notes arrive in time order and
+    // never overlap. Set before preprocessing; called on the worker thread.
+    using NoteSink = std::function<void(const PianoRollNote&)>;
+    void setNoteSink(NoteSink sink) { note_sink_ = std::move(sink); }
     
     // Get preprocessed track duration
-    float getTrackDuration() const { return track_duration_; }
+    float getTrackDuration() const { return track_duration_.load(std::memory_order_acquire); }
+    
+    // Publish notes loaded from elsewhere (e.g. the on-disk note cache). Their
+    // channels must be in the loaded file's layout; their envelope offsets
+    // point into 'envelopes'.
+    void setPreprocessedNotes(std::vector<PianoRollNote> notes, const std::vector<uint8_t>& envelopes,
+                              float duration, NoteLoop loop = NoteLoop());
+    void setPreprocessedNotes(NoteTimeline timeline, float duration);
+    
+    // Copy out the completed preprocessing result; a looping track's notes
+    // cover one pass of the loop, which the roll then repeats
+    bool getPreprocessedNotes(std::vector<PianoRollNote>& out_notes, std::vector<uint8_t>& out_envelopes,
+                              float& out_duration, NoteLoop* out_loop = nullptr);
 
-    // Update current playback time (for live keyboard display)
-    void updatePlaybackTime(float current_time);
+    // Live keyboard highlighting follows the APU snapshot of the active player,
+    // read when the keyboard is drawn. UI thread.
+    void setApuSource(const ApuSnapshotLock* source);
+    
+    // Channels of the loaded file's sound chips, which the live keyboard and
+    // the legend are sized from. UI thread, when a file is loaded.
+    void setChannelLayout(const ChannelLayout& layout);
+    int getActiveChannelCount() const { return layout_.size(); }
+
+    // Note a channel of the snapshot is sounding; false if it is silent.
+    // Tone periods go through PitchTable, which also gives the detune.
+    static bool channelNote(const ChannelLayout& layout, const ApuFrameSnapshot& snapshot, int channel,
+                            int* midi_note, float* velocity, int* cents = nullptr);
+    
+    // Live roll: notes heard from the APU source scroll up from the keyboard
+    // instead of preprocessed ones falling towards it (the emulator has
+    // nothing to preprocess). UI thread.
+    void setLiveRoll(bool enabled);
+    bool isLiveRoll() const { return live_roll_; }
     
-    // Update with NES APU register data for live keyboard highlighting
-    void updateFromAPU(const int* periods, const int* lengths, const int* amplitudes, float current_time);
+    // Live roll look-ahead (toggled in the window): predicted notes fall
+    // towards the keyboard instead of heard ones rising. The caller runs
+    // the prediction while it is enabled and hands each new one (or an
+    // empty one when it is dropped) to setLookahead. UI thread.
+    bool isLookaheadEnabled() const { return live_roll_ && lookahead_; }
+    void setLookahead(const std::vector<ApuFrameSnapshot>& frames);
     
-    // VRC6 support
-    void setVRC6Enabled(bool enabled) { has_vrc6_ = enabled; }
-    bool hasVRC6() const { return has_vrc6_; }
-    void updateFromVRC6(const int* periods, const int* volumes, const bool* enabled, float current_time);
-    int getActiveChannelCount() const { return has_vrc6_ ? PIANO_NUM_CHANNELS_MAX : PIANO_NUM_CHANNELS_BASE; }
+    // Main thread, once per frame whether or not the window is open: record
+    // the APU source's notes so the live roll has its history when it opens
+    void recordLiveNotes();
 
-    // Draw the piano keyboard
-    void drawPianoKeyboard(const char* label, float width, float height);
+    // Draw the piano keyboard. Where preprocessed notes cover current_time
+    // the pressed keys are looked up in them; otherwise (the emulator, or
+    // past what a running preprocess has reached) they follow the APU source.
+    void drawPianoKeyboard(const char* label, float width, float height, float current_time);
 
-    // Draw the piano roll (scrolling notes - shows FUTURE notes falling down)
+    // Draw the piano roll (scrolling notes - shows FUTURE notes falling down,
+    // or past ones rising in the live roll)
     void drawPianoRoll(const char* label, float width, float height, float current_time);
 
     // Draw complete piano visualizer window
     void drawPianoWindow(bool* p_open, float current_time);
+    
+    // Whole-track strip of how much each channel plays, with the playback
+    // position marked; a loop repeats as the notes do. Returns true with
+    // *seek_time set when it was clicked or dragged. Draws nothing (and
+    // returns false) before any notes are preprocessed.
+    bool drawTrackOverview(const char* id, float width, float height, float track_seconds,
+                           float current_time, float* seek_time);
+
+    // Release the GPU note renderer; call before sg_shutdown
+    void destroyRenderResources();
+    bool usesGpuRoll() const { return gpu_roll_.isValid(); }
+
+    // Keep to the ImDrawList rectangles, for drawing without a sokol context
+    // (offline video rendering); before the first roll draw
+    void disableGpuRoll() { gpu_roll_tried_ = true; }
+    
+    // Build the CPU-drawn roll on job workers (they lock the visualizer, so
+    // the keyboard drawn after it waits for them); null builds it in place
+    void setCanvasJobs(CanvasJobs* jobs) { canvas_jobs_ = jobs; }
 
     // Settings
     void setPianoRollSpeed(float seconds_visible) { piano_roll_seconds_ = seconds_visible; }
@@ -108,22 +163,103 @@ private:
     static constexpr int MIDI_NOTE_MAX = 108;  // C8
     static constexpr float NES_CPU_CLOCK = 1789773.0f;  // NTSC
 
-    // Current note state per channel (for live keyboard display)
-    std::array<NesNoteInfo, PIANO_NUM_CHANNELS_MAX> current_notes_;
+    // Current note state per layout channel (for live keyboard display)
+    ChannelLayout layout_;
+    std::vector<NesNoteInfo> current_notes_;
+    std::vector<NesNoteInfo> indexed_notes_;    // from timeline_ at the presentation time
+    
+    // Preprocessed note data; the version counts changes for the GPU upload
+    NoteTimeline timeline_;
+    uint64_t timeline_version_ = 0;
+    NoteDensity density_;           // timeline_'s notes, for the overview
+    // Stored by the preprocessing job, read by the UI without mutex_
+    std::atomic<bool> has_preprocessed_data_{false};
+    std::atomic<bool> preprocess_complete_{false};
+    bool incremental_preprocess_ = true;
+    std::atomic<float> track_duration_{0.0f};
+    
+    // Live roll history, fed from the APU source (UI thread)
+    static constexpr int MAX_LIVE_NOTES_DRAWN = 1024;  // per frame
+    LiveNoteHistory live_notes_;
+    bool live_roll_ = false;
+    bool lookahead_ = false;
+    NoteTimeline lookahead_timeline_;   // predicted notes, drawn like preprocessed ones
+    
+    // For preprocessing: notes collected by the worker before they are
+    // published, and the envelope bytes their offsets point into
+    std::vector<PianoRollNote> pending_notes_;
+    std::vector<uint8_t> pending_envelopes_;
+    NoteSink note_sink_;
+    static constexpr int PREPROCESS_PUBLISH_CHUNKS = 8;  // ~186ms of audio per publish
+    static constexpr float TRACE_SILENCE_END_SEC = 6.0f; // matches gme's silence detection
+    static constexpr long TRACE_STEP_MSEC = 250;         // emulated time per run_trace call
+    static constexpr float MAX_PREPROCESS_SECONDS = 3600.0f;
+    static constexpr float TRACE_MIN_LOOP_SEC = 1.0f;
+    float trace_silent_since_ = 0.0f;
     
-    // Preprocessed note data (sorted by start_time)
-    std::vector<PianoRollNote> preprocessed_notes_;
-    bool has_preprocessed_data_ = false;
-    float track_duration_ = 0.0f;
-    bool has_vrc6_ = false;
+    // Loop detection for the trace: state hash at each play call -> first time
+    // seen. A repeat means the track cycles from that time on.
+    std::unordered_map<uint64_t, float> trace_states_;
+    NoteLoop trace_loop_;
+    bool trace_loop_found_ = false;
     
-    // For preprocessing: track note state
-    std::array<int, PIANO_NUM_CHANNELS_MAX> preprocess_prev_notes_;
-    std::array<float, PIANO_NUM_CHANNELS_MAX> preprocess_note_start_;
-    std::array<float, PIANO_NUM_CHANNELS_MAX> preprocess_note_velocity_;
+    // For preprocessing: track note state per channel of the preprocessed file's
+    // layout (worker thread; independent of the UI's layout_)
+    ChannelLayout preprocess_layout_;
+    std::vector<int> preprocess_prev_notes_;
+    std::vector<float> preprocess_note_start_;
+    std::vector<float> preprocess_note_velocity_;
+    // Envelope of each channel's sounding note so far: its runs, the samples
+    // they hold and the level seen last, which holds until the next snapshot.
+    // The buffers are reused note after note.
+    std::vector<std::vector<uint8_t>> preprocess_envelope_;
+    std::vector<uint32_t> preprocess_envelope_samples_;
+    std::vector<int> preprocess_envelope_level_;
+    
+    // Key geometry for the current width/octave range, shared by keyboard and roll.
+    // x offsets are relative to the left edge; width 0 means the note is off-screen.
+    struct KeyLayout {
+        float width = -1.0f;
+        int octave_low = -1;
+        int octave_high = -1;
+        int start_note = 0;
+        int end_note = 0;
+        float white_key_width = 0.0f;
+        float black_key_width = 0.0f;
+        std::array<float, 128> key_x{};
+        std::array<float, 128> key_w{};
+    };
+    KeyLayout key_layout_;
+    const KeyLayout& keyLayout(float width);
+    
+    // The keyboard with no key pressed, rasterized into an image whenever
+    // its geometry or the framebuffer scale changes and drawn as one quad;
+    // only pressed keys (and the black keys over them) are drawn on top
+    struct KeyboardImage {
+        sg_image image = {};
+        sg_view view = {};
+        sg_sampler sampler = {};
+        int pixel_width = 0;
+        int pixel_height = 0;
+        float width = -1.0f;        // layout width and height, points
+        float height = -1.0f;
+        int octave_low = -1;
+        int octave_high = -1;
+        float scale = 0.0f;         // pixels per point
+    };
+    KeyboardImage keyboard_image_;
+    std::vector<uint32_t> keyboard_pixels_;
+    void updateKeyboardImage(const KeyLayout& layout, float height);
+    void destroyKeyboardImage();
+    
+    // Instanced note drawing; set up on the first roll draw, ImDrawList
+    // rectangles when the backend has no shader for it
+    NoteRollRenderer gpu_roll_;
+    bool gpu_roll_tried_ = false;
+    uint64_t gpu_roll_version_ = 0;
     
     // Settings
-    float piano_roll_seconds_ = 3.0f;  // How many seconds of future notes to show
+    float piano_roll_seconds_ = 3.0f;  // How many seconds of future (live: past) notes to show
     int octave_low_ = 2;   // C2
     int octave_high_ = 7;  // C7
     
@@ -131,7 +267,7 @@ private:
     std::mutex mutex_;
     
     // Helper functions
-    static int frequencyToMidi(float frequency);
+    static int frequencyToMidi(float frequency, int* cents = nullptr);
     static float midiToFrequency(int midi_note);
     static bool isBlackKey(int midi_note);
     static int getWhiteKeyIndex(int midi_note);
@@ -141,11 +277,31 @@ private:
     void drawKey(ImDrawList* draw_list, ImVec2 pos, float width, float height, 
                  int midi_note, bool is_black, int pressed_channel, float velocity);
     
-    // Process APU data during preprocessing
-    void processApuFrame(const int* periods, const int* lengths, const int* amplitudes, float current_time);
-    void processVrc6Frame(const int* periods, const int* volumes, const bool* enabled, float current_time);
-    void finalizePreprocessing(float end_time);
+    // Live notes from the APU snapshot (UI thread; applied with mutex_ held)
+    const ApuSnapshotLock* apu_source_ = nullptr;
+    uint32_t apu_version_seen_ = 0;
+    void pollApuSource();
+    const std::vector<NesNoteInfo>* indexedNotesAt(float current_time);
+    void drawLiveNotes(ImDrawList* draw_list, const KeyLayout& layout, ImVec2 canvas_pos,
+                       float width, float height, float current_time);
+    
+    // Pieces of the preprocessed roll; the CPU-drawn ones are canvas builds
+    // (with mutex_ held, no ImGui:: calls)
+    void drawRollGrid(ImDrawList* draw_list, const KeyLayout& layout, ImVec2 canvas_pos,
+                      float width, float height, float current_time);
+    void drawTimelineNotes(ImDrawList* draw_list, const NoteTimeline& timeline, const KeyLayout& layout,
+                           ImVec2 canvas_pos, float height, float current_time);
+    static void drawRollEdges(ImDrawList* draw_list, ImVec2 canvas_pos, float width, float height);
+    CanvasJobs* canvas_jobs_ = nullptr;
     
-    // Convert APU period to MIDI note
-    int periodToMidi(int channel, int period);
+    // Process chip state during preprocessing; true if any channel is sounding
+    bool processSnapshot(const ApuFrameSnapshot& snapshot, float current_time);
+    static void traceFrameCallback(void* user_data, double time, Nsf_Emu& emu);
+    void beginPreprocessing(const ApuTap& tap);
+    static bool estimatePreprocessDuration(Music_Emu* emu, int track, float* out_seconds);
+    void sampleEnvelope(int ch, float time);
+    void endNote(int ch, float end_time);
+    void emitNote(const PianoRollNote& note, const std::vector<uint8_t>& envelope);
+    void publishPendingNotes(float analyzed_time);
+    void finalizePreprocessing(float end_time);
 };
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+// MIDI note and detune for every period register value of the NES sound
+// channels, built at compile time. A tone channel plays
+// CPU clock / (steps * (period + offset)), so each channel type has its
+// own table: a lookup replaces the frequency divide and log2 per channel
+// per update, and keeps the cents a vibrato or pitch bend moves by.
+// Namco 163 pitch depends on three registers at once and stays computed.
+namespace PitchTable {
+
+struct Pitch {
+    int8_t note;    // MIDI note, -1 outside 0-127
+    int8_t cents;   // -50 to +50 from 'note'
+};
+
+constexpr double CPU_CLOCK = 1789773.0;    // NTSC
+
+namespace detail {
+
+constexpr double LN2 = 0.69314718055994530942;
+
+// ln(x) for x > 0: scale into [1, 2), then 2 atanh((x - 1) / (x + 1))
+constexpr double ln(double x) {
+    int exponent = 0;
+    while (x >= 2.0) { x *= 0.5; ++exponent; }
+    while (x < 1.0) { x *= 2.0; --exponent; }
+    double y = (x - 1.0) / (x + 1.0);
+    double sum = 0.0;
+    double term = y;
+    for (int k = 1; term > 1e-18; k += 2) {
+        sum += term / k;
+        term *= y * y;
+    }
+    return 2.0 * sum + exponent * LN2;
+}
+
+// log2(n) for n = 1-4096, each from the one before: ln(n / (n - 1)) is
+// 2 atanh(1 / (2n - 1)), which takes a few series terms, so the whole table
+// stays cheap to evaluate at compile time
+constexpr int MAX_PERIOD = 4096;
+
+constexpr std::array<double, MAX_PERIOD + 1> buildLog2() {
+    std::array<double, MAX_PERIOD + 1> table{};
+    for (int n = 2; n <= MAX_PERIOD; ++n) {
+        double y = 1.0 / (2.0 * n - 1.0);
+        double sum = 0.0;
+        double term = y;
+        for (int k = 1; term > 1e-18; k += 2) {
+            sum += term / k;
+            term *= y * y;
+        }
+        table[n] = table[n - 1] + 2.0 * sum / LN2;
+    }
+    return table;
+}
+
+inline constexpr std::array<double, MAX_PERIOD + 1> LOG2 = buildLog2();
+
+template <int N>
+constexpr std::array<Pitch, N> build(double steps, int offset) {
+    std::array<Pitch, N> table{};
+    // Cents above MIDI note 0 of the period for which steps * divider = 1
+    double base = 6900.0 + 1200.0 * ln(CPU_CLOCK / (440.0 * steps)) / LN2;
+    for (int period = 0; period < N; ++period) {
+        int divider = period + offset > 0 ? period + offset : 1;
+        double cents = base - 1200.0 * LOG2[divider];
+        int note = static_cast<int>(cents / 100.0 + 0.5);
+        if (cents < 0.0 || note > 127) {
+            table[period] = {-1, 0};
+            continue;
+        }
+        double detune = cents - note * 100.0;
+        table[period] = {static_cast<int8_t>(note),
+                         static_cast<int8_t>(detune < 0.0 ? detune - 0.5 : detune + 0.5)};
+    }
+    return table;
+}
+
+}  // namespace detail
+
+inline constexpr std::array<Pitch, 2048> APU_PULSE = detail::build<2048>(16.0, 1);
+inline constexpr std::array<Pitch, 2048> APU_TRIANGLE = detail::build<2048>(32.0, 1);
+inline constexpr std::array<Pitch, 4096> VRC6_PULSE = detail::build<4096>(16.0, 1);
+inline constexpr std::array<Pitch, 4096> VRC6_SAW = detail::build<4096>(14.0, 1);
+inline constexpr std::array<Pitch, 4096> FME7_TONE = detail::build<4096>(32.0, 0);    // period 0 plays as 1
+
+inline Pitch apuPulse(int period) { return APU_PULSE[period & 0x7FF]; }
+inline Pitch apuTriangle(int period) { return APU_TRIANGLE[period & 0x7FF]; }
+inline Pitch vrc6Pulse(int period) { return VRC6_PULSE[period & 0xFFF]; }
+inline Pitch vrc6Saw(int period) { return VRC6_SAW[period & 0xFFF]; }
+inline Pitch fme7Tone(int period) { return FME7_TONE[period & 0xFFF]; }
+
+}  // namespace PitchTable
@@ -0,0 +1,163 @@
+#include "PitchTracker.h"
+#include <algorithm>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define PITCH_USE_SSE2 1
+#elif defined(__aarch64__) && (defined(__ARM_NEON) || defined(__ARM_NEON__))
+#include <arm_neon.h>
+#define PITCH_USE_NEON 1
+#endif
+
+namespace {
+
+constexpr int MIN_WINDOW = 64;      // shortest window a residual is searched in
+
+// Sum of (a[i] - b[i])^2
+float difference(const float* a, const float* b, int n) {
+    int i = 0;
+    float sum = 0.0f;
+#if defined(PITCH_USE_SSE2)
+    __m128 acc0 = _mm_setzero_ps();
+    __m128 acc1 = _mm_setzero_ps();
+    for (; i + 8 <= n; i += 8) {
+        __m128 d0 = _mm_sub_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i));
+        __m128 d1 = _mm_sub_ps(_mm_loadu_ps(a + i + 4), _mm_loadu_ps(b + i + 4));
+        acc0 = _mm_add_ps(acc0, _mm_mul_ps(d0, d0));
+        acc1 = _mm_add_ps(acc1, _mm_mul_ps(d1, d1));
+    }
+    alignas(16) float lanes[4];
+    _mm_store_ps(lanes, _mm_add_ps(acc0, acc1));
+    sum = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+#elif defined(PITCH_USE_NEON)
+    float32x4_t acc0 = vdupq_n_f32(0.0f);
+    float32x4_t acc1 = vdupq_n_f32(0.0f);
+    for (; i + 8 <= n; i += 8) {
+        float32x4_t d0 = vsubq_f32(vld1q_f32(a + i), vld1q_f32(b + i));
+        float32x4_t d1 = vsubq_f32(vld1q_f32(a + i + 4), vld1q_f32(b + i + 4));
+        acc0 = vmlaq_f32(acc0, d0, d0);
+        acc1 = vmlaq_f32(acc1, d1, d1);
+    }
+    sum = vaddvq_f32(vaddq_f32(acc0, acc1));
+#endif
+    for (; i < n; ++i) {
+        float d = a[i] - b[i];
+        sum += d * d;
+    }
+    return sum;
+}
+
+}  // namespace
+
+PitchTracker::Estimate PitchTracker::detect(const float* x, int size, long sample_rate, float threshold,
+                                            float* scratch) {
+    Estimate estimate;
+    float energy = 0.0f;
+    for (int i = 0; i < size; ++i) energy += x[i] * x[i];
+    estimate.level = std::sqrt(energy / std::max(size, 1));
+    if (estimate.level < MIN_LEVEL || sample_rate <= 0) return estimate;
+
+    // d(lag) over the first half of the window, lags up to the other half
+    const int window = size / 2;
+    const int max_lag = size - window;
+    const int min_lag = std::max(2, static_cast<int>(sample_rate / MAX_HZ));
+    float* cmnd = scratch;          // cumulative mean normalized difference, by lag
+    cmnd[0] = 1.0f;
+    float running = 0.0f;
+    int best = 0;
+    int lag = 1;
+    for (; lag <= max_lag; ++lag) {
+        float d = difference(x, x + lag, window);
+        running += d;
+        cmnd[lag] = running > 0.0f ? d * lag / running : 1.0f;
+        if (best > 0) {
+            if (cmnd[lag] >= cmnd[best]) break;     // past the dip, with its right neighbour
+            best = lag;
+        } else if (lag >= min_lag && cmnd[lag] < threshold) {
+            best = lag;
+        }
+    }
+    if (best == 0) return estimate;
+
+    // Parabola through the dip and its neighbours
+    float period = static_cast<float>(best);
+    if (lag <= max_lag) {
+        float a = cmnd[best - 1];
+        float b = cmnd[best];
+        float c = cmnd[best + 1];
+        float curve = a - 2.0f * b + c;
+        if (curve > 0.0f) period += std::clamp(0.5f * (a - c) / curve, -0.5f, 0.5f);
+    }
+    estimate.hz = static_cast<float>(sample_rate) / period;
+    estimate.clarity = std::clamp(1.0f - cmnd[best], 0.0f, 1.0f);
+    return estimate;
+}
+
+int PitchTracker::update(const float* window, int size, long sample_rate, int count, Estimate* out) {
+    count = std::clamp(count, 0, MAX_PITCHES);
+    scratch_.resize(static_cast<size_t>(size / 2) + 2);
+    residual_.reserve(size);
+
+    std::array<Estimate, MAX_PITCHES> found{};
+    int pitches = 0;
+    const float* x = window;
+    int length = size;
+    float gain = 1.0f;
+    float level = 0.0f;
+    while (pitches < count && length >= MIN_WINDOW) {
+        Estimate estimate = detect(x, length, sample_rate, x == window ? THRESHOLD : RESIDUAL_THRESHOLD,
+                                   scratch_.data());
+        if (pitches == 0) level = estimate.level;
+        if (estimate.hz <= 0.0f) break;
+        // What the comb left of a pitch already found is not another voice
+        bool repeat = false;
+        for (int i = 0; i < pitches; ++i) repeat |= std::abs(std::log2(estimate.hz / found[i].hz)) < 1.0f / 24.0f;
+        if (repeat) break;
+        estimate.level *= gain;
+        found[pitches++] = estimate;
+        if (pitches == count) break;
+
+        // x[i + period] - x[i] nulls the pitch and its harmonics, the
+        // fraction of the period interpolated (a whole-sample delay leaves
+        // a square's edges behind); in place from the front, each sample
+        // read before it is overwritten
+        float period = static_cast<float>(sample_rate) / estimate.hz;
+        int whole = static_cast<int>(period);
+        float fraction = period - whole;
+        int remaining = length - whole - 1;
+        if (remaining < MIN_WINDOW) break;
+        residual_.resize(static_cast<size_t>(remaining));
+        float* r = residual_.data();
+        for (int i = 0; i < remaining; ++i) {
+            r[i] = x[i + whole] + fraction * (x[i + whole + 1] - x[i + whole]) - x[i];
+        }
+        x = r;
+        length = remaining;
+        gain *= 0.70710678f;    // the comb doubles the power of the rest on average
+    }
+    std::sort(found.begin(), found.begin() + pitches,
+              [](const Estimate& a, const Estimate& b) { return a.hz > b.hz; });
+
+    // Median of each slot's last three, by pitch
+    int pitched = 0;
+    for (int slot = 0; slot < count; ++slot) {
+        if (slot >= pitches) found[slot] = Estimate{0.0f, 0.0f, level};
+        std::array<Estimate, HISTORY>& history = history_[slot];
+        history[history_pos_] = found[slot];
+        std::array<Estimate, HISTORY> sorted = history;
+        std::sort(sorted.begin(), sorted.end(), [](const Estimate& a, const Estimate& b) { return a.hz < b.hz; });
+        out[slot] = sorted[HISTORY / 2];
+        if (out[slot].hz > 0.0f) {
+            out[slot].level = found[slot].level;   // as loud as it is now
+            ++pitched;
+        }
+    }
+    history_pos_ = (history_pos_ + 1) % HISTORY;
+    return pitched;
+}
+
+void PitchTracker::reset() {
+    for (auto& slot : history_) slot.fill(Estimate());
+    history_pos_ = 0;
+}
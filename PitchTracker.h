@@ -0,0 +1,51 @@
+#pragma once
+
+#include <array>
+#include <vector>
+
+// YIN pitch detection (de Cheveigne and Kawahara, 2002) for audio with no
+// register tap to read notes from. The difference function - the squared
+// distance between the window and itself shifted by each lag - is summed
+// four samples at a time (SSE2 or NEON) and evaluated one lag after
+// another, stopping at the first dip of its cumulative mean normalized
+// form below THRESHOLD, so a high note costs a fraction of a low one.
+//
+// A few pitches of a mix are found one after another: each one found is
+// cancelled from the window with a comb of its period and the rest is
+// searched again. That finds a lead and what accompanies it, but it is no
+// transcriber; gme's per-voice taps give each voice a tracker of its own.
+// Each slot's pitch is the median of its last three, which drops a single
+// misjudged window without delaying a note change by more than one.
+class PitchTracker {
+public:
+    static constexpr int MAX_PITCHES = 4;
+    static constexpr float THRESHOLD = 0.15f;       // YIN's dip for a pitched window
+    static constexpr float RESIDUAL_THRESHOLD = 0.3f;   // what a comb leaves is never as clean
+    static constexpr float MIN_LEVEL = 0.001f;      // RMS, -60 dBFS; quieter windows are not searched
+    static constexpr float MAX_HZ = 4200.0f;        // just above C8
+
+    struct Estimate {
+        float hz = 0.0f;            // 0 when unpitched
+        float clarity = 0.0f;       // 1 - the dip's depth, 0-1
+        float level = 0.0f;         // RMS of the window, full scale 1
+    };
+
+    // Up to 'count' (at most MAX_PITCHES) pitches of 'window', 'size'
+    // samples oldest first, highest first; the rest of 'out' is unpitched.
+    // Lags reach half the window, so the lowest pitch found is
+    // sample_rate / (size / 2). Returns how many were found.
+    int update(const float* window, int size, long sample_rate, int count, Estimate* out);
+    void reset();
+
+private:
+    static constexpr int HISTORY = 3;
+
+    // One pitch of x, unsmoothed: the first dip below 'threshold'. scratch
+    // holds size / 2 + 2 floats.
+    static Estimate detect(const float* x, int size, long sample_rate, float threshold, float* scratch);
+
+    std::vector<float> scratch_;
+    std::vector<float> residual_;
+    std::array<std::array<Estimate, HISTORY>, MAX_PITCHES> history_{};   // per slot, oldest overwritten
+    int history_pos_ = 0;
+};
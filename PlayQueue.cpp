@@ -0,0 +1,213 @@
+#include "PlayQueue.h"
+#include "ZipArchive.h"
+#include <algorithm>
+#include <filesystem>
+#include <system_error>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+// The NSF/NSFe members of a zip archive, sorted like a folder's files
+void findArchiveFiles(const std::string& path, std::vector<std::string>& out) {
+    ZipArchive archive;
+    if (!archive.open(path.c_str())) return;
+    std::vector<std::string> found;
+    for (const ZipArchive::Member& member : archive.members()) {
+        bool nsfe = false;
+        if (NsfLibrary::isLibraryFile(fs::path(member.name), nsfe)) {
+            found.push_back(ZipArchive::memberPath(path, member.name));
+        }
+    }
+    std::sort(found.begin(), found.end());
+    out.insert(out.end(), std::make_move_iterator(found.begin()), std::make_move_iterator(found.end()));
+}
+
+// The NSF/NSFe files under 'dir', sorted so a soundtrack folder plays in
+// order; an archive inside is listed in its place
+void findMusicFiles(const std::string& dir, const Job& job, std::vector<std::string>& out) {
+    std::vector<std::string> found;
+    std::vector<std::string> archives;
+    std::error_code ec;
+    fs::recursive_directory_iterator it(dir, fs::directory_options::skip_permission_denied, ec);
+    for (; !ec && it != fs::recursive_directory_iterator(); it.increment(ec)) {
+        if (job.isCancelled()) return;
+        bool nsfe = false;
+        if (!it->is_regular_file(ec)) continue;
+        if (NsfLibrary::isLibraryFile(it->path(), nsfe)) {
+            found.push_back(it->path().string());
+        } else if (ZipArchive::isArchive(it->path().string())) {
+            archives.push_back(it->path().string());
+        }
+    }
+    for (const std::string& archive : archives) {
+        if (job.isCancelled()) return;
+        findArchiveFiles(archive, found);
+    }
+    std::sort(found.begin(), found.end());
+    out.insert(out.end(), std::make_move_iterator(found.begin()), std::make_move_iterator(found.end()));
+}
+
+}  // namespace
+
+void PlayQueue::add(std::vector<std::string> paths, JobSystem& jobs, bool start) {
+    if (paths.empty()) return;
+    std::lock_guard<std::mutex> lock(mutex_);
+    uint32_t batch = next_batch_++;
+    if (start) start_batch_ = batch;
+    jobs_.erase(std::remove_if(jobs_.begin(), jobs_.end(), [](const JobHandle& job) { return job->isDone(); }),
+                jobs_.end());
+
+    // Even a plain file list is stat'ed on the worker: a path on a sleeping
+    // network drive can take seconds
+    CancelToken cancel = cancel_;
+    pending_.fetch_add(1);
+    jobs_.push_back(jobs.submit([this, paths = std::move(paths), batch, cancel, &jobs](const Job& job) {
+        std::vector<std::string> files;
+        for (const std::string& path : paths) {
+            std::error_code ec;
+            if (fs::is_directory(path, ec)) {
+                findMusicFiles(path, job, files);
+            } else if (ZipArchive::isArchive(path)) {
+                findArchiveFiles(path, files);
+            } else {
+                files.push_back(path);
+            }
+            if (job.isCancelled()) break;
+        }
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!job.isCancelled()) {
+            // Listed right away as READING, then read a few per job
+            size_t first = items_.size();
+            for (std::string& file : files) {
+                Item item;
+                item.id = next_id_++;
+                item.batch = batch;
+                item.info.path = std::move(file);
+                items_.push_back(std::move(item));
+            }
+            for (size_t begin = first; begin < items_.size(); begin += FILES_PER_JOB) {
+                std::vector<uint32_t> ids;
+                for (size_t i = begin; i < std::min(begin + FILES_PER_JOB, items_.size()); ++i) {
+                    ids.push_back(items_[i].id);
+                }
+                pending_.fetch_add(1);
+                jobs_.push_back(jobs.submit([this, ids = std::move(ids)](const Job& read_job) {
+                    for (uint32_t id : ids) {
+                        if (read_job.isCancelled()) break;
+                        NsfLibraryEntry entry;
+                        {
+                            std::lock_guard<std::mutex> item_lock(mutex_);
+                            int index = indexOf(id);
+                            if (index < 0) continue;    // removed meanwhile
+                            entry.path = items_[index].info.path;
+                        }
+                        bool ok = NsfLibrary::readEntry(entry);
+                        std::lock_guard<std::mutex> item_lock(mutex_);
+                        int index = indexOf(id);
+                        if (index < 0) continue;
+                        items_[index].status = ok ? Status::READY : Status::FAILED;
+                        if (ok) items_[index].info = std::move(entry);
+                        changed();
+                    }
+                    pending_.fetch_sub(1);
+                }, JobPriority::INTERACTIVE, "Queue files", &cancel));
+            }
+        }
+        changed();
+        pending_.fetch_sub(1);
+    }, JobPriority::INTERACTIVE, "Queue files", &cancel));
+}
+
+void PlayQueue::remove(uint32_t id) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    int index = indexOf(id);
+    if (index < 0) return;
+    items_.erase(items_.begin() + index);
+    changed();
+}
+
+void PlayQueue::clear() {
+    shutdown();
+    std::lock_guard<std::mutex> lock(mutex_);
+    items_.clear();
+    start_batch_ = 0;
+    cancel_ = CancelToken();
+    changed();
+}
+
+void PlayQueue::shutdown() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        cancel_.cancel();
+    }
+    // Walk jobs may still be queueing reads while the first ones are waited on
+    for (;;) {
+        std::vector<JobHandle> jobs;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            jobs.swap(jobs_);
+        }
+        if (jobs.empty()) break;
+        for (JobHandle& job : jobs) job->cancel();
+        for (JobHandle& job : jobs) job->wait();
+    }
+    pending_.store(0);
+}
+
+PlayQueue::Snapshot PlayQueue::snapshot() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    uint32_t version = version_.load();
+    if (!snapshot_ || snapshot_version_ != version) {
+        snapshot_ = std::make_shared<const std::vector<Item>>(items_);
+        snapshot_version_ = version;
+    }
+    return snapshot_;
+}
+
+bool PlayQueue::startCandidate(std::string& path) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (start_batch_ == 0) return false;
+    // The first of the batch that didn't fail; one still being read is waited for
+    for (const Item& item : items_) {
+        if (item.batch != start_batch_ || item.status == Status::FAILED) continue;
+        if (item.status == Status::READING) return false;
+        path = item.info.path;
+        return true;
+    }
+    return false;
+}
+
+void PlayQueue::startTaken() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    start_batch_ = 0;
+}
+
+bool PlayQueue::nextAfter(const std::string& path, std::string& next, bool& waiting) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    waiting = false;
+    auto current = std::find_if(items_.begin(), items_.end(), [&](const Item& item) { return item.info.path == path; });
+    if (current == items_.end()) return false;
+    for (auto it = current + 1; it != items_.end(); ++it) {
+        if (it->status == Status::FAILED) continue;
+        if (it->status == Status::READING) {
+            waiting = true;
+            return false;
+        }
+        next = it->info.path;
+        return true;
+    }
+    return false;
+}
+
+int PlayQueue::indexOf(uint32_t id) const {
+    // Ids only grow along the queue, so the items stay sorted by them
+    auto it = std::lower_bound(items_.begin(), items_.end(), id,
+                               [](const Item& item, uint32_t value) { return item.id < value; });
+    return it != items_.end() && it->id == id ? static_cast<int>(it - items_.begin()) : -1;
+}
+
+void PlayQueue::changed() {
+    version_.fetch_add(1);
+}
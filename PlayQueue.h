@@ -0,0 +1,84 @@
+#pragma once
+
+#include "JobSystem.h"
+#include "NsfLibrary.h"
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Music files queued to play one after another, e.g. everything dropped on
+// the window at once. Folders are searched for NSF/NSFe files, and each
+// file's header and track info is read on the job workers, so adding a few
+// hundred files never stalls playback or the UI. Readers take a snapshot,
+// rebuilt only when the queue changed.
+class PlayQueue {
+public:
+    static constexpr int MAX_DROPPED_FILES = 256;     // paths per drop sokol_app keeps
+    static constexpr int FILES_PER_JOB = 16;
+
+    enum class Status : uint8_t {
+        READING,
+        READY,
+        FAILED,         // not an NSF/NSFe file, or unreadable
+    };
+
+    struct Item {
+        uint32_t id = 0;
+        uint32_t batch = 0;     // the add() it came from
+        Status status = Status::READING;
+        NsfLibraryEntry info;   // path, and the rest once READY
+    };
+    using Snapshot = std::shared_ptr<const std::vector<Item>>;
+
+    PlayQueue() = default;
+    ~PlayQueue() { shutdown(); }
+    PlayQueue(const PlayQueue&) = delete;
+    PlayQueue& operator=(const PlayQueue&) = delete;
+
+    // Append 'paths' in order: files, or folders and zip archives whose
+    // NSF/NSFe files are added sorted by path. With 'start', the first of them that turns out
+    // playable becomes startCandidate() as soon as it is read, replacing an
+    // earlier candidate.
+    void add(std::vector<std::string> paths, JobSystem& jobs, bool start);
+    void remove(uint32_t id);
+    // Empty the queue and stop reading
+    void clear();
+
+    Snapshot snapshot() const;
+    // Bumped whenever the snapshot changes
+    uint32_t version() const { return version_.load(); }
+    bool isReading() const { return pending_.load() > 0; }
+
+    // The item to start now, if a start was asked for and it has been read;
+    // the caller clears it with startTaken() once the load is under way
+    bool startCandidate(std::string& path) const;
+    void startTaken();
+
+    // The first playable item after the one at 'path', for moving on when
+    // its last track ends. False if there is none: then 'waiting' tells
+    // whether a later item is still being read.
+    bool nextAfter(const std::string& path, std::string& next, bool& waiting) const;
+
+    // Cancel the reads and wait for them
+    void shutdown();
+
+private:
+    int indexOf(uint32_t id) const;
+    void changed();
+
+    mutable std::mutex mutex_;
+    std::vector<Item> items_;
+    uint32_t next_id_ = 1;
+    uint32_t next_batch_ = 1;
+    uint32_t start_batch_ = 0;                  // add() whose first playable item starts; 0: none
+    CancelToken cancel_;                        // replaced by clear()
+    std::vector<JobHandle> jobs_;
+    mutable Snapshot snapshot_;
+    mutable uint32_t snapshot_version_ = ~0u;
+
+    std::atomic<uint32_t> version_{0};
+    std::atomic<int> pending_{0};               // walks and reads not finished
+};
@@ -0,0 +1,471 @@
+#include "PluginHost.h"
+#include "CanvasJobs.h"
+#include "GpuMemory.h"
+#include "PianoVisualizer.h"
+#include "ThreadPlacement.h"
+#include "sokol_app.h"
+#include "util/sokol_imgui.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <filesystem>
+#include <system_error>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#elif !defined(__EMSCRIPTEN__)
+#include <dlfcn.h>
+#endif
+
+namespace {
+
+// A loaded library and its entry point; null and 'error' set if it has none
+void* openLibrary(const std::filesystem::path& path, std::string& error) {
+#if defined(_WIN32)
+    HMODULE module = LoadLibraryW(path.wstring().c_str());
+    if (!module) error = "cannot load (error " + std::to_string(GetLastError()) + ")";
+    return module;
+#elif defined(__EMSCRIPTEN__)
+    (void)path;
+    error = "plugins need a desktop build";
+    return nullptr;
+#else
+    void* library = dlopen(path.string().c_str(), RTLD_NOW | RTLD_LOCAL);
+    if (!library) error = dlerror();
+    return library;
+#endif
+}
+
+void* findSymbol(void* library, const char* name) {
+#if defined(_WIN32)
+    return reinterpret_cast<void*>(GetProcAddress(static_cast<HMODULE>(library), name));
+#elif defined(__EMSCRIPTEN__)
+    (void)library;
+    (void)name;
+    return nullptr;
+#else
+    return dlsym(library, name);
+#endif
+}
+
+void closeLibrary(void* library) {
+#if defined(_WIN32)
+    FreeLibrary(static_cast<HMODULE>(library));
+#elif !defined(__EMSCRIPTEN__)
+    dlclose(library);
+#else
+    (void)library;
+#endif
+}
+
+bool isLibrary(const std::filesystem::path& path) {
+    std::string ext = path.extension().string();
+    return ext == ".so" || ext == ".dylib" || ext == ".dll";
+}
+
+// fcviz_draw over a canvas's list, keeping the plugin's clip pushes and
+// pops paired
+struct DrawContext {
+    ImDrawList* list = nullptr;
+    int clips = 0;
+};
+
+ImDrawList& listOf(void* context) {
+    return *static_cast<DrawContext*>(context)->list;
+}
+
+const fcviz_draw DRAW_FUNCTIONS = {
+    nullptr,
+    [](void* context, float x0, float y0, float x1, float y1, uint32_t color, float thickness) {
+        listOf(context).AddLine(ImVec2(x0, y0), ImVec2(x1, y1), color, thickness);
+    },
+    [](void* context, const float* xy, uint32_t points, uint32_t color, float thickness) {
+        if (!xy || points < 2) return;
+        listOf(context).AddPolyline(reinterpret_cast<const ImVec2*>(xy), static_cast<int>(points), color,
+                                    ImDrawFlags_None, thickness);
+    },
+    [](void* context, float x0, float y0, float x1, float y1, uint32_t color, float thickness) {
+        listOf(context).AddRect(ImVec2(x0, y0), ImVec2(x1, y1), color, 0.0f, ImDrawFlags_None, thickness);
+    },
+    [](void* context, float x0, float y0, float x1, float y1, uint32_t color) {
+        listOf(context).AddRectFilled(ImVec2(x0, y0), ImVec2(x1, y1), color);
+    },
+    [](void* context, float x0, float y0, float x1, float y1, float x2, float y2, uint32_t color) {
+        listOf(context).AddTriangleFilled(ImVec2(x0, y0), ImVec2(x1, y1), ImVec2(x2, y2), color);
+    },
+    [](void* context, float x, float y, float radius, uint32_t color, float thickness) {
+        listOf(context).AddCircle(ImVec2(x, y), radius, color, 0, thickness);
+    },
+    [](void* context, float x, float y, float radius, uint32_t color) {
+        listOf(context).AddCircleFilled(ImVec2(x, y), radius, color);
+    },
+    [](void* context, float x0, float y0, float x1, float y1) {
+        listOf(context).PushClipRect(ImVec2(x0, y0), ImVec2(x1, y1), true);
+        ++static_cast<DrawContext*>(context)->clips;
+    },
+    [](void* context) {
+        DrawContext& draw = *static_cast<DrawContext*>(context);
+        if (draw.clips == 0) return;    // the canvas's own clip rect stays
+        draw.list->PopClipRect();
+        --draw.clips;
+    },
+};
+
+}  // namespace
+
+const std::string& PluginHost::directory() {
+    static const std::string dir = []() -> std::string {
+        namespace fs = std::filesystem;
+        fs::path base;
+#if defined(_WIN32)
+        if (const char* app_data = std::getenv("APPDATA")) base = app_data;
+#elif defined(__APPLE__)
+        if (const char* home = std::getenv("HOME")) base = fs::path(home) / "Library" / "Application Support";
+#else
+        if (const char* xdg = std::getenv("XDG_DATA_HOME")) base = xdg;
+        else if (const char* home = std::getenv("HOME")) base = fs::path(home) / ".local" / "share";
+#endif
+        if (base.empty()) return std::string();
+
+        fs::path path = base / "imgui_fc_visualizer" / "plugins";
+        std::error_code ec;
+        fs::create_directories(path, ec);
+        if (ec) return std::string();
+        return path.string();
+    }();
+    return dir;
+}
+
+void PluginHost::loadDirectory() {
+    namespace fs = std::filesystem;
+    unloadAll();
+    const std::string& dir = directory();
+    if (dir.empty()) return;
+
+    std::vector<fs::path> paths;
+    std::error_code ec;
+    for (const auto& entry : fs::directory_iterator(dir, ec)) {
+        if (entry.is_regular_file(ec) && isLibrary(entry.path())) paths.push_back(entry.path());
+    }
+    std::sort(paths.begin(), paths.end());
+    for (const fs::path& path : paths) load(path.string());
+}
+
+void PluginHost::load(const std::string& path) {
+    auto plugin = std::make_unique<Plugin>();
+    plugin->path = path;
+    plugin->library = openLibrary(path, plugin->error);
+    if (plugin->library) {
+        auto entry = reinterpret_cast<fcviz_plugin_entry_t>(findSymbol(plugin->library, FCVIZ_PLUGIN_ENTRY));
+        const fcviz_plugin* desc = entry ? entry(FCVIZ_PLUGIN_API_VERSION) : nullptr;
+        if (!entry) {
+            plugin->error = "no " FCVIZ_PLUGIN_ENTRY " function";
+        } else if (!desc || desc->api_version != FCVIZ_PLUGIN_API_VERSION) {
+            plugin->error = "built for another plugin API version";
+        } else if (!desc->name || !desc->render || desc->target > FCVIZ_TARGET_PIXELS) {
+            plugin->error = "incomplete descriptor";
+        } else {
+            plugin->desc = desc;
+        }
+    }
+    if (!plugin->desc) {
+        if (plugin->library) closeLibrary(plugin->library);
+        plugin->library = nullptr;
+        plugins_.push_back(std::move(plugin));
+        return;
+    }
+
+    // The graph runs each node once however many plugins read it
+    if (plugin->desc->inputs & FCVIZ_INPUT_SAMPLES) plugin->nodes |= AnalysisGraph::NODE_SCOPE | AnalysisGraph::NODE_LEVELS;
+    if (plugin->desc->inputs & FCVIZ_INPUT_SPECTRUM) plugin->nodes |= AnalysisGraph::NODE_SPECTRUM;
+    if (plugin->nodes) plugin->subscription = analysis_.subscribe(plugin->nodes, true);
+
+    plugin->running.store(true);
+    Plugin* running = plugin.get();
+    plugin->thread = std::thread([running]() { run(running); });
+    plugins_.push_back(std::move(plugin));
+}
+
+void PluginHost::unload(Plugin& plugin) {
+    plugin.running.store(false);
+    if (plugin.thread.joinable()) plugin.thread.join();
+    if (plugin.subscription) analysis_.unsubscribe(plugin.subscription);
+    plugin.subscription.reset();
+    if (plugin.image_width > 0) {
+        sg_destroy_view(plugin.view);
+        sg_destroy_sampler(plugin.sampler);
+        DestroyGpuImage(plugin.image);
+        plugin.image_width = plugin.image_height = 0;
+    }
+    if (plugin.library) closeLibrary(plugin.library);
+    plugin.library = nullptr;
+}
+
+void PluginHost::unloadAll() {
+    for (auto& plugin : plugins_) unload(*plugin);
+    plugins_.clear();
+}
+
+void PluginHost::run(Plugin* plugin) {
+    using clock = std::chrono::steady_clock;
+    const fcviz_plugin& desc = *plugin->desc;
+    float rate = desc.max_rate > 0.0f ? std::clamp(desc.max_rate, MIN_RATE, MAX_RATE) : DEFAULT_RATE;
+    auto interval = std::chrono::duration_cast<clock::duration>(std::chrono::duration<double>(1.0 / rate));
+    void* instance = desc.create ? desc.create() : nullptr;
+    DrawContext context;
+    fcviz_draw draw = DRAW_FUNCTIONS;
+    draw.context = &context;
+
+    auto next = clock::now();
+    while (plugin->running.load(std::memory_order_acquire)) {
+        ThreadPlacement::update(ThreadRole::BATCH);
+        std::this_thread::sleep_until(next);
+        next = std::max(next + interval, clock::now());
+
+        plugin->input.acquire();
+        const Input& input = plugin->input.front();
+        const State& state = input.state;
+        if (state.width < 1.0f || state.height < 1.0f) continue;   // window hidden
+
+        // The subscription is held for the call, so a resize that detached
+        // it leaves these frames alone
+        std::shared_ptr<AnalysisGraph::Subscription> subscription;
+        {
+            std::lock_guard<std::mutex> lock(plugin->subscription_mutex);
+            subscription = plugin->subscription;
+        }
+        fcviz_frame frame = {};
+        frame.playing = state.playing ? 1 : 0;
+        frame.time = state.time;
+        frame.width = state.width;
+        frame.height = state.height;
+        if (subscription) {
+            subscription->acquire();
+            const AnalysisGraph::Frame& analysis = subscription->frame();
+            frame.tick = analysis.tick;
+            if ((desc.inputs & FCVIZ_INPUT_SAMPLES) && (analysis.nodes & AnalysisGraph::NODE_SCOPE)) {
+                frame.inputs |= FCVIZ_INPUT_SAMPLES;
+                frame.waveform_left = analysis.waveform_left.data();
+                frame.waveform_right = analysis.waveform_right.data();
+                frame.waveform_size = static_cast<uint32_t>(analysis.waveform_left.size());
+                frame.rms_left = analysis.rms_left;
+                frame.rms_right = analysis.rms_right;
+                frame.peak = analysis.peak;
+            }
+            if ((desc.inputs & FCVIZ_INPUT_SPECTRUM) && (analysis.nodes & AnalysisGraph::NODE_SPECTRUM)) {
+                frame.inputs |= FCVIZ_INPUT_SPECTRUM;
+                frame.spectrum = analysis.spectrum.data();
+                frame.spectrum_bins = static_cast<uint32_t>(analysis.spectrum.size());
+                frame.history = analysis.history.data();
+                frame.history_size = static_cast<uint32_t>(analysis.history_size);
+                frame.history_rows = analysis.history_rows;
+            }
+        }
+        if ((desc.inputs & FCVIZ_INPUT_APU) && state.channel_count > 0) {
+            frame.inputs |= FCVIZ_INPUT_APU;
+            frame.channels = state.channels;
+            frame.channel_count = state.channel_count;
+        }
+        if (desc.inputs & FCVIZ_INPUT_NOTES) {
+            frame.inputs |= FCVIZ_INPUT_NOTES;
+            frame.note_event_capacity = NOTE_EVENTS;
+            frame.note_events = state.events;
+            frame.note_on_count = state.note_on_count;
+        }
+
+        Canvas& canvas = plugin->canvases.back();
+        auto started = clock::now();
+        if (desc.target == FCVIZ_TARGET_PIXELS) {
+            canvas.pixel_width = static_cast<int>(state.width);
+            canvas.pixel_height = static_cast<int>(state.height);
+            canvas.pixels.resize(static_cast<size_t>(canvas.pixel_width) * canvas.pixel_height);
+            frame.pixels = canvas.pixels.data();
+            frame.pixel_width = static_cast<uint32_t>(canvas.pixel_width);
+            frame.pixel_height = static_cast<uint32_t>(canvas.pixel_height);
+            desc.render(instance, &frame, nullptr);
+        } else {
+            CanvasJobs::copySharedData(input.shared, canvas.shared, canvas.tex_uv_lines);
+            ImDrawList& list = canvas.list;
+            list._ResetForNewFrame();
+            list.PushClipRect(ImVec2(0.0f, 0.0f), ImVec2(state.width, state.height));
+            list.PushTexture(input.texture);
+            context.list = &list;
+            context.clips = 0;
+            desc.render(instance, &frame, &draw);
+            while (context.clips > 0) draw.pop_clip(&context);
+        }
+        plugin->render_ms.store(std::chrono::duration<float, std::milli>(clock::now() - started).count(),
+                                std::memory_order_relaxed);
+        plugin->canvases.publish();
+    }
+    if (desc.destroy) desc.destroy(instance);
+}
+
+void PluginHost::publish(const ApuFrameSnapshot& snapshot, const ChannelLayout& layout, double time, bool playing) {
+    if (plugins_.empty()) return;
+    State& out = state_;
+    out.time = time;
+    out.playing = playing;
+
+    // As OverlayFeed::publish: a note starting, or the channel moving to
+    // another one, is a note-on
+    int count = snapshot.active ? std::min(snapshot.channel_count, layout.size()) : 0;
+    out.channel_count = static_cast<uint32_t>(count);
+    for (int ch = 0; ch < ChannelLayout::MAX_CHANNELS; ++ch) {
+        fcviz_channel& channel = out.channels[ch];
+        bool valid = ch < count;
+        int note = -1;
+        float velocity = 0.0f;
+        if (valid && !PianoVisualizer::channelNote(layout, snapshot, ch, &note, &velocity)) note = -1;
+        uint8_t velocity7 = static_cast<uint8_t>(std::clamp(std::lround(velocity * 127.0f), 0L, 127L));
+
+        if (note >= 0 && note != channel.note) {
+            fcviz_note_event& event = out.events[out.note_on_count % NOTE_EVENTS];
+            event.time = time;
+            event.channel = static_cast<uint8_t>(ch);
+            event.note = static_cast<uint8_t>(note);
+            event.velocity = std::max<uint8_t>(velocity7, 1);
+            event.kind = valid ? static_cast<uint8_t>(layout[ch].kind) : 0;
+            ++out.note_on_count;
+        }
+        channel.name = valid ? layout[ch].name : "";
+        channel.rgb = valid ? layout[ch].rgb : 0;
+        channel.kind = valid ? static_cast<uint8_t>(layout[ch].kind) : 0;
+        channel.note = static_cast<int8_t>(note);
+        channel.velocity = note >= 0 ? velocity7 : 0;
+        channel.period = valid ? snapshot.periods[ch] : 0;
+        channel.length = valid ? snapshot.lengths[ch] : 0;
+        channel.amplitude = valid ? snapshot.amplitudes[ch] : 0;
+        channel.volume = valid ? snapshot.volumes[ch] : 0;
+    }
+
+    const ImDrawListSharedData& shared = *ImGui::GetDrawListSharedData();
+    for (auto& plugin : plugins_) {
+        if (!plugin->running.load(std::memory_order_relaxed)) continue;
+
+        // A resolution or voice change dropped the subscription; the plugin
+        // keeps reading the old one until it picks this one up
+        if (plugin->subscription && plugin->subscription->detached()) {
+            auto subscription = analysis_.subscribe(plugin->nodes, true);
+            std::lock_guard<std::mutex> lock(plugin->subscription_mutex);
+            plugin->subscription = std::move(subscription);
+        }
+
+        Input& input = plugin->input.back();
+        input.state = out;
+        input.state.width = plugin->shown ? plugin->width : 0.0f;
+        input.state.height = plugin->shown ? plugin->height : 0.0f;
+        CanvasJobs::copySharedData(shared, input.shared, input.tex_uv_lines);
+        input.texture = ImGui::GetIO().Fonts->TexRef;
+        plugin->input.publish();
+    }
+}
+
+void PluginHost::drawPixels(Plugin& plugin, bool fresh) {
+    const Canvas& canvas = plugin.canvases.front();
+    if (canvas.pixel_width <= 0 || canvas.pixel_height <= 0) return;
+    if (canvas.pixel_width != plugin.image_width || canvas.pixel_height != plugin.image_height) {
+        if (plugin.image_width > 0) {
+            sg_destroy_view(plugin.view);
+            sg_destroy_sampler(plugin.sampler);
+            DestroyGpuImage(plugin.image);
+        }
+        sg_image_desc img_desc = {};
+        img_desc.width = canvas.pixel_width;
+        img_desc.height = canvas.pixel_height;
+        img_desc.pixel_format = SG_PIXELFORMAT_RGBA8;
+        img_desc.usage.stream_update = true;
+        plugin.image = MakeGpuImage(&img_desc);
+
+        sg_sampler_desc smp_desc = {};
+        smp_desc.min_filter = SG_FILTER_LINEAR;
+        smp_desc.mag_filter = SG_FILTER_LINEAR;
+        smp_desc.wrap_u = SG_WRAP_CLAMP_TO_EDGE;
+        smp_desc.wrap_v = SG_WRAP_CLAMP_TO_EDGE;
+        plugin.sampler = sg_make_sampler(&smp_desc);
+
+        sg_view_desc view_desc = {};
+        view_desc.texture.image = plugin.image;
+        plugin.view = sg_make_view(&view_desc);
+        plugin.image_width = canvas.pixel_width;
+        plugin.image_height = canvas.pixel_height;
+        fresh = true;
+    }
+    // Stream updates are limited to one per frame, and each plugin has its own image
+    if (fresh) {
+        sg_image_data data = {};
+        data.mip_levels[0].ptr = canvas.pixels.data();
+        data.mip_levels[0].size = canvas.pixels.size() * sizeof(uint32_t);
+        sg_update_image(plugin.image, &data);
+    }
+    ImGui::GetWindowDrawList()->AddImage(simgui_imtextureid_with_sampler(plugin.view, plugin.sampler), plugin.origin,
+                                         ImVec2(plugin.origin.x + plugin.width, plugin.origin.y + plugin.height));
+}
+
+void PluginHost::drawWindows() {
+    for (auto& p : plugins_) {
+        Plugin& plugin = *p;
+        plugin.target = nullptr;
+        if (!plugin.running.load(std::memory_order_relaxed) || !plugin.shown) continue;
+
+        ImGui::SetNextWindowSize(ImVec2(480, 270), ImGuiCond_FirstUseEver);
+        std::string title = std::string(plugin.desc->name) + "##" + plugin.path;
+        if (!ImGui::Begin(title.c_str(), &plugin.shown)) {
+            plugin.width = plugin.height = 0.0f;
+            ImGui::End();
+            continue;
+        }
+        ImVec2 size = ImGui::GetContentRegionAvail();
+        plugin.origin = ImGui::GetCursorScreenPos();
+        plugin.width = std::max(std::floor(size.x), 0.0f);
+        plugin.height = std::max(std::floor(size.y), 0.0f);
+
+        // The canvas picked up stays on screen until a newer one is done
+        bool fresh = plugin.canvases.acquire();
+        plugin.drawn = plugin.drawn || fresh;
+        if (plugin.drawn && plugin.desc->target == FCVIZ_TARGET_PIXELS) {
+            drawPixels(plugin, fresh);
+        } else if (plugin.drawn) {
+            plugin.target = ImGui::GetWindowDrawList();
+            CanvasJobs::addMarker(*plugin.target, &plugin);
+        }
+        if (plugin.width > 0.0f && plugin.height > 0.0f) ImGui::Dummy(ImVec2(plugin.width, plugin.height));
+        ImGui::End();
+    }
+}
+
+void PluginHost::splice() {
+    for (auto& plugin : plugins_) {
+        if (!plugin->target) continue;
+        // The front canvas is the UI thread's until its next acquire()
+        Canvas& canvas = const_cast<Canvas&>(plugin->canvases.front());
+        CanvasJobs::spliceAt(*plugin->target, canvas.list, plugin.get(), plugin->origin);
+        plugin->target = nullptr;
+    }
+}
+
+void PluginHost::drawMenu() {
+    if (!ImGui::BeginMenu("Plugins")) return;
+    if (plugins_.empty()) ImGui::TextDisabled("No plugins loaded");
+    for (auto& plugin : plugins_) {
+        std::string file = std::filesystem::path(plugin->path).filename().string();
+        if (!plugin->desc) {
+            ImGui::TextDisabled("%s: %s", file.c_str(), plugin->error.c_str());
+            continue;
+        }
+        char shortcut[32];
+        snprintf(shortcut, sizeof(shortcut), "%.2f ms", plugin->render_ms.load(std::memory_order_relaxed));
+        std::string label = std::string(plugin->desc->name) + "##" + plugin->path;
+        ImGui::MenuItem(label.c_str(), shortcut, &plugin->shown);
+        if (ImGui::IsItemHovered(ImGuiHoveredFlags_DelayNormal)) ImGui::SetTooltip("%s", plugin->path.c_str());
+    }
+    ImGui::Separator();
+    if (ImGui::MenuItem("Reload Plugins")) loadDirectory();
+    if (ImGui::IsItemHovered(ImGuiHoveredFlags_DelayNormal)) {
+        ImGui::SetTooltip("Load every shared library in\n%s\n(VisualizerPlugin.h has the interface)",
+                          directory().empty() ? "(no per-user directory)" : directory().c_str());
+    }
+    ImGui::EndMenu();
+}
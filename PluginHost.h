@@ -0,0 +1,130 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "AnalysisGraph.h"
+#include "ApuSnapshot.h"
+#include "ChannelLayout.h"
+#include "TripleBuffer.h"
+#include "VisualizerPlugin.h"
+#include "imgui.h"
+#include "imgui_internal.h"
+#include "sokol_gfx.h"
+
+// Visualizer plugins (VisualizerPlugin.h has the C interface) loaded from
+// directory(), each in a window of its own. A plugin runs on a thread of
+// its own at its max_rate, placed like batch work (ThreadPlacement), so
+// however slow it is the audio and UI threads never wait on it: it reads
+// its own analysis graph subscription and a triple buffer of the channel
+// state the UI thread publishes once a frame, and hands its canvases back
+// through another. The UI thread shows the newest finished one, spliced
+// into the window like CanvasJobs' canvases or uploaded as a texture.
+//
+// UI thread, apart from what the plugin threads do with their buffers.
+class PluginHost {
+public:
+    static constexpr int NOTE_EVENTS = 64;
+    static constexpr float DEFAULT_RATE = 60.0f;
+    static constexpr float MAX_RATE = 240.0f;
+
+    explicit PluginHost(AnalysisGraph& analysis) : analysis_(analysis) {}
+    ~PluginHost() { unloadAll(); }
+
+    PluginHost(const PluginHost&) = delete;
+    PluginHost& operator=(const PluginHost&) = delete;
+
+    // Per-user directory (created on demand), empty if unavailable
+    static const std::string& directory();
+
+    // (Re)load every shared library in directory(); the ones that fail are
+    // listed by the menu with why
+    void loadDirectory();
+    void unloadAll();
+
+    // Once a frame: the channel state being heard
+    void publish(const ApuFrameSnapshot& snapshot, const ChannelLayout& layout, double time, bool playing);
+    // The windows of the shown plugins, with their newest canvases
+    void drawWindows();
+    // After the last window and before rendering, with CanvasJobs::splice()
+    void splice();
+
+    // View > Plugins: a toggle per plugin with its render time, and reloading
+    void drawMenu();
+
+private:
+    static constexpr float MIN_RATE = 1.0f;     // keeps unloading under a second
+
+    // What the UI thread has for every plugin, once a frame
+    struct State {
+        float width = 0.0f;             // canvas; 0 while the window is hidden
+        float height = 0.0f;
+        double time = 0.0;
+        bool playing = false;
+        uint32_t channel_count = 0;
+        fcviz_channel channels[ChannelLayout::MAX_CHANNELS] = {};
+        uint64_t note_on_count = 0;
+        fcviz_note_event events[NOTE_EVENTS] = {};
+    };
+
+    // UI thread -> plugin thread: the state and this frame's drawing setup
+    struct Input {
+        ImDrawListSharedData shared;
+        ImVec4 tex_uv_lines[IM_DRAWLIST_TEX_LINES_WIDTH_MAX + 1];
+        ImTextureRef texture;
+        State state;
+    };
+
+    // Plugin thread -> UI thread
+    struct Canvas {
+        ImDrawListSharedData shared;    // before 'list', which registers with it
+        ImVec4 tex_uv_lines[IM_DRAWLIST_TEX_LINES_WIDTH_MAX + 1];
+        ImDrawList list{&shared};
+        std::vector<uint32_t> pixels;
+        int pixel_width = 0;
+        int pixel_height = 0;
+    };
+
+    struct Plugin {
+        std::string path;
+        std::string error;              // why it isn't running
+        void* library = nullptr;
+        const fcviz_plugin* desc = nullptr;
+        bool shown = true;
+
+        std::mutex subscription_mutex;  // held for swapping the pointer only
+        std::shared_ptr<AnalysisGraph::Subscription> subscription;
+        uint32_t nodes = 0;
+        TripleBuffer<Input> input;
+        TripleBuffer<Canvas> canvases;
+        std::thread thread;
+        std::atomic<bool> running{false};
+        std::atomic<float> render_ms{0.0f};     // last render() call
+
+        // UI thread
+        bool drawn = false;             // a canvas was picked up since loading
+        ImDrawList* target = nullptr;   // marker left this frame
+        ImVec2 origin;
+        float width = 0.0f;
+        float height = 0.0f;
+        sg_image image = {};
+        sg_view view = {};
+        sg_sampler sampler = {};
+        int image_width = 0;
+        int image_height = 0;
+    };
+
+    static void run(Plugin* plugin);
+    static void drawPixels(Plugin& plugin, bool fresh);
+    void load(const std::string& path);
+    void unload(Plugin& plugin);
+
+    AnalysisGraph& analysis_;
+    std::vector<std::unique_ptr<Plugin>> plugins_;
+
+    State state_;                   // the last one published, updated in place
+};
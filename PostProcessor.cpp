@@ -0,0 +1,865 @@
+#include "PostProcessor.h"
+#include "GpuMemory.h"
+#include <algorithm>
+#include <cstring>
+
+/*
+    Vulkan shaders (SPIR-V 1.4, set/binding layout as sokol-shdc emits it).
+    The vertex shader is PaletteRenderer's full-screen triangle:
+
+    layout(location = 0) in vec2 position;
+    layout(location = 0) out vec2 uv;
+    void main() {
+        gl_Position = vec4(position, 0.5, 1.0);
+        uv = position * vec2(0.5, -0.5) + 0.5;
+    }
+
+    Every fragment shader starts with
+
+    layout(set = 0, binding = 0) uniform fs_params {
+        vec4 src_size;      // width, height, 1 / width, 1 / height
+        vec4 out_size;
+        vec4 params;
+    };
+    layout(set = 1, binding = 0) uniform texture2D src_tex;
+    layout(set = 1, binding = 32) uniform sampler smp;
+    layout(location = 0) in vec2 uv;
+    layout(location = 0) out vec4 frag_color;
+    #define SRC(p) texture(sampler2D(src_tex, smp), p).rgb
+
+    Scanlines, darkest halfway between two source rows:
+
+    void main() {
+        float d = fract(uv.y * src_size.y) * 2.0 - 1.0;
+        frag_color = vec4(SRC(uv) * (1.0 - params.x * d * d), 1.0);
+    }
+
+    CRT: barrel curvature, scanlines, an RGB phosphor mask that repeats
+    every three output pixels and a vignette:
+
+    void main() {
+        vec2 cc = uv * 2.0 - 1.0;
+        cc *= 1.0 + cc.yx * cc.yx * params.y;
+        vec2 st = cc * 0.5 + 0.5;
+        vec2 inside = step(vec2(0.0), st) * step(st, vec2(1.0));
+        float d = fract(st.y * src_size.y) * 2.0 - 1.0;
+        vec3 c = SRC(st) * (1.0 - params.x * d * d);
+        float g = fract(uv.x * out_size.x / 3.0) * 3.0;
+        vec3 tri = clamp(1.0 - abs(vec3(g) - vec3(0.5, 1.5, 2.5)), 0.0, 1.0);
+        c *= vec3(1.0 - params.z) + tri * (params.z * 3.0);
+        float v = 16.0 * st.x * st.y * (1.0 - st.x) * (1.0 - st.y);
+        c *= pow(clamp(v, 0.0001, 1.0), params.w) * inside.x * inside.y;
+        frag_color = vec4(c, 1.0);
+    }
+
+    Scale2x (EPX): each source pixel becomes four; a quarter takes its two
+    near neighbours' color where they match and the far ones don't:
+
+    float same(vec3 a, vec3 b) { return step(dot(abs(a - b), vec3(1.0)), params.x); }
+    void main() {
+        vec2 p = uv * src_size.xy;
+        vec2 q = step(vec2(0.5), fract(p));
+        vec2 base = (floor(p) + 0.5) * src_size.zw;
+        vec2 d = q * 2.0 - 1.0;
+        float dx = d.x * src_size.z;
+        float dy = d.y * src_size.w;
+        vec3 e = SRC(base);
+        vec3 h = SRC(base + vec2(dx, 0.0));
+        vec3 v = SRC(base + vec2(0.0, dy));
+        vec3 ho = SRC(base + vec2(-dx, 0.0));
+        vec3 vo = SRC(base + vec2(0.0, -dy));
+        float sel = same(h, v) * ((1.0 - same(v, ho)) * (1.0 - same(h, vo)));
+        frag_color = vec4(mix(e, h, vec3(sel)), 1.0);
+    }
+*/
+static const uint8_t _post_vs_bytecode_spirv[792] = {
+    0x03,0x02,0x23,0x07,0x00,0x04,0x01,0x00,0x0b,0x00,0x08,0x00,0x22,0x00,0x00,0x00,
+    0x00,0x00,0x00,0x00,0x11,0x00,0x02,0x00,0x01,0x00,0x00,0x00,0x0b,0x00,0x06,0x00,
+    0x01,0x00,0x00,0x00,0x47,0x4c,0x53,0x4c,0x2e,0x73,0x74,0x64,0x2e,0x34,0x35,0x30,
+    0x00,0x00,0x00,0x00,0x0e,0x00,0x03,0x00,0x00,0x00,0x00,0x00,0x01,0x00,0x00,0x00,
+    0x0f,0x00,0x08,0x00,0x00,0x00,0x00,0x00,0x02,0x00,0x00,0x00,0x6d,0x61,0x69,0x6e,
+    0x00,0x00,0x00,0x00,0x03,0x00,0x00,0x00,0x04,0x00,0x00,0x00,0x05,0x00,0x00,0x00,
+    0x47,0x00,0x03,0x00,0x0d,0x00,0x00,0x00,0x02,0x00,0x00,0x00,0x48,0x00,0x05,0x00,
+    0x0d,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x0b,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+    0x48,0x00,0x05,0x00,0x0d,0x00,0x00,0x00,0x01,0x00,0x00,0x00,0x0b,0x00,0x00,0x00,
+    0x01,0x00,0x00,0x00,0x48,0x00,0x05,0x00,0x0d,0x00,0x00,0x00,0x02,0x00,0x00,0x00,
+    0x0b,0x00,0x00,0x00,0x03,0x00,0x00,0x00,0x48,0x00,0x05,0x00,0x0d,0x00,0x00,0x00,
+    0x03,0x00,0x00,0x00,0x0b,0x00,0x00,0x00,0x04,0x00,0x00,0x00,0x47,0x00,0x04,0x00,
+    0x04,0x00,0x00,0x00,0x1e,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x47,0x00,0x04,0x00,
+    0x05,0x00,0x00,0x00,0x1e,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x13,0x00,0x02,0x00,
+    0x06,0x00,0x00,0x00,0x21,0x00,0x03,0x00,0x07,0x00,0x00,0x00,0x06,0x00,0x00,0x00,
+    0x16,0x00,0x03,0x00,0x08,0x00,0x00,0x00,0x20,0x00,0x00,0x00,0x17,0x00,0x04,0x00,
+    0x09,0x00,0x00,0x00,0x08,0x00,0x00,0x00,0x04,0x00,0x00,0x00,0x15,0x00,0x04,0x00,
+    0x0a,0x00,0x00,0x00,0x20,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x2b,0x00,0x04,0x00,
+    0x0a,0x00,0x00,0x00,0x0b,0x00,0x00,0x00,0x01,0x00,0x00,0x00,0x1c,0x00,0x04,0x00,
+    0x0c,0x00,0x00,0x00,0x08,0x00,0x00,0x00,0x0b,0x00,0x00,0x00,0x1e,0x00,0x06,0x00,
+    0x0d,0x00,0x00,0x00,0x09,0x00,0x00,0x00,0x08,0x00,0x00,0x00,0x0c,0x00,0x00,0x00,
+    0x0c,0x00,0x00,0x00,0x20,0x00,0x04,0x00,0x0e,0x00,0x00,0x00,0x03,0x00,0x00,0x00,
+    0x0d,0x00,0x00,0x00,0x3b,0x00,0x04,0x00,0x0e,0x00,0x00,0x00,0x03,0x00,0x00,0x00,
+    0x03,0x00,0x00,0x00,0x15,0x00,0x04,0x00,0x0f,0x00,0x00,0x00,0x20,0x00,0x00,0x00,
+    0x01,0x00,0x00,0x00,0x2b,0x00,0x04,0x00,0x0f,0x00,0x00,0x00,0x10,0x00,0x00,0x00,
+    0x00,0x00,0x00,0x00,0x17,0x00,0x04,0x00,0x11,0x00,0x00,0x00,0x08,0x00,0x00,0x00,
+    0x02,0x00,0x00,0x00,0x20,0x00,0x04,0x00,0x12,0x00,0x00,0x00,0x01,0x00,0x00,0x00,
+    0x11,0x00,0x00,0x00,0x3b,0x00,0x04,0x00,0x12,0x00,0x00,0x00,0x04,0x00,0x00,0x00,
+    0x01,0x00,0x00,0x00,0x20,0x00,0x04,0x00,0x13,0x00,0x00,0x00,0x03,0x00,0x00,0x00,
+    0x11,0x00,0x00,0x00,0x3b,0x00,0x04,0x00,0x13,0x00,0x00,0x00,0x05,0x00,0x00,0x00,
+    0x03,0x00,0x00,0x00,0x20,0x00,0x04,0x00,0x14,0x00,0x00,0x00,0x03,0x00,0x00,0x00,
+    0x09,0x00,0x00,0x00,0x2b,0x00,0x04,0x00,0x08,0x00,0x00,0x00,0x15,0x00,0x00,0x00,
+    0x00,0x00,0x00,0x3f,0x2b,0x00,0x04,0x00,0x08,0x00,0x00,0x00,0x16,0x00,0x00,0x00,
+    0x00,0x00,0x80,0x3f,0x2b,0x00,0x04,0x00,0x08,0x00,0x00,0x00,0x17,0x00,0x00,0x00,
+    0x00,0x00,0x00,0xbf,0x2c,0x00,0x05,0x00,0x11,0x00,0x00,0x00,0x18,0x00,0x00,0x00,
+    0x15,0x00,0x00,0x00,0x17,0x00,0x00,0x00,0x2c,0x00,0x05,0x00,0x11,0x00,0x00,0x00,
+    0x19,0x00,0x00,0x00,0x15,0x00,0x00,0x00,0x15,0x00,0x00,0x00,0x36,0x00,0x05,0x00,
+    0x06,0x00,0x00,0x00,0x02,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x07,0x00,0x00,0x00,
+    0xf8,0x00,0x02,0x00,0x1a,0x00,0x00,0x00,0x3d,0x00,0x04,0x00,0x11,0x00,0x00,0x00,
+    0x1b,0x00,0x00,0x00,0x04,0x00,0x00,0x00,0x51,0x00,0x05,0x00,0x08,0x00,0x00,0x00,
+    0x1c,0x00,0x00,0x00,0x1b,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x51,0x00,0x05,0x00,
+    0x08,0x00,0x00,0x00,0x1d,0x00,0x00,0x00,0x1b,0x00,0x00,0x00,0x01,0x00,0x00,0x00,
+    0x50,0x00,0x07,0x00,0x09,0x00,0x00,0x00,0x1e,0x00,0x00,0x00,0x1c,0x00,0x00,0x00,
+    0x1d,0x00,0x00,0x00,0x15,0x00,0x00,0x00,0x16,0x00,0x00,0x00,0x41,0x00,0x05,0x00,
+    0x14,0x00,0x00,0x00,0x1f,0x00,0x00,0x00,0x03,0x00,0x00,0x00,0x10,0x00,0x00,0x00,
+    0x3e,0x00,0x03,0x00,0x1f,0x00,0x00,0x00,0x1e,0x00,0x00,0x00,0x85,0x00,0x05,0x00,
+    0x11,0x00,0x00,0x00,0x20,0x00,0x00,0x00,0x1b,0x00,0x00,0x00,0x18,0x00,0x00,0x00,
+    0x81,0x00,0x05,0x00,0x11,0x00,0x00,0x00,0x21,0x00,0x00,0x00,0x20,0x00,0x00,0x00,
+    0x19,0x00,0x00,0x00,0x3e,0x00,0x03,0x00,0x05,0x00,0x00,0x00,0x21,0x00,0x00,0x00,
+    0xfd,0x00,0x01,0x00,0x38,0x00,0x01,0x00,
+};
+
+static const uint8_t _scanlines_fs_bytecode_spirv[1280] = {
+    0x03,0x02,0x23,0x07,0x00,0x04,0x01,0x00,0x0b,0x00,0x08,0x00,0x37,0x00,0x00,0x00,
+    0x00,0x00,0x00,0x00,0x11,0x00,0x02,0x00,0x01,0x00,0x00,0x00,0x0b,0x00,0x06,0x00,
+    0x01,0x00,0x00,0x00,0x47,0x4c,0x53,0x4c,0x2e,0x73,0x74,0x64,0x2e,0x34,0x35,0x30,
+    0x00,0x00,0x00,0x00,0x0e,0x00,0x03,0x00,0x00,0x00,0x00,0x00,0x01,0x00,0x00,0x00,
+    0x0f,0x00,0x0a,0x00,0x04,0x00,0x00,0x00,0x02,0x00,0x00,0x00,0x6d,0x61,0x69,0x6e,
+    0x00,0x00,0x00,0x00,0x09,0x00,0x00,0x00,0x0b,0x00,0x00,0x00,0x10,0x00,0x00,0x00,
+    0x12,0x00,0x00,0x00,0x15,0x00,0x00,0x00,0x10,0x00,0x03,0x00,0x02,0x00,0x00,0x00,
+    0x07,0x00,0x00,0x00,0x47,0x00,0x04,0x00,0x09,0x00,0x00,0x00,0x1e,0x00,0x00,0x00,
+    0x00,0x00,0x00,0x00,0x47,0x00,0x04,0x00,0x0b,0x00,0x00,0x00,0x1e,0x00,0x00,0x00,
+    0x00,0x00,0x00,0x00,0x47,0x00,0x04,0x00,0x10,0x00,0x00,0x00,0x22,0x00,0x00,0x00,
+    0x01,0x00,0x00,0x00,0x47,0x00,0x04,0x00,0x10,0x00,0x00,0x00,0x21,0x00,0x00,0x00,
+    0x00,0x00,0x00,0x00,0x47,0x00,0x04,0x00,0x12,0x00,0x00,0x00,0x22,0x00,0x00,0x00,
+    0x01,0x00,0x00,0x00,0x47,0x00,0x04,0x00,0x12,0x00,0x00,0x00,0x21,0x00,0x00,0x00,
+    0x20,0x00,0x00,0x00,0x47,0x00,0x03,0x00,0x14,0x00,0x00,0x00,0x02,0x00,0x00,0x00,
+    0x48,0x00,0x05,0x00,0x14,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x23,0x00,0x00,0x00,
+    0x00,0x00,0x00,0x00,0x48,0x00,0x05,0x00,0x14,0x00,0x00,0x00,0x01,0x00,0x00,0x00,
+    0x23,0x00,0x00,0x00,0x10,0x00,0x00,0x00,0x48,0x00,0x05,0x00,0x14,0x00,0x00,0x00,
+    0x02,0x00,0x00,0x00,0x23,0x00,0x00,0x00,0x20,0x00,0x00,0x00,0x47,0x00,0x04,0x00,
+    0x15,0x00,0x00,0x00,0x22,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x47,0x00,0x04,0x00,
+    0x15,0x00,0x00,0x00,0x21,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x16,0x00,0x03,0x00,
+    0x03,0x00,0x00,0x00,0x20,0x00,0x00,0x00,0x17,0x00,0x04,0x00,0x04,0x00,0x00,0x00,
+    0x03,0x00,0x00,0x00,0x02,0x00,0x00,0x00,0x17,0x00,0x04,0x00,0x05,0x00,0x00,0x00,
+    0x03,0x00,0x00,0x00,0x03,0x00,0x00,0x00,0x17,0x00,0x04,0x00,0x06,0x00,0x00,0x00,
+    0x03,0x00,0x00,0x00,0x04,0x00,0x00,0x00,0x13,0x00,0x02,0x00,0x07,0x00,0x00,0x00,
+    0x21,0x00,0x03,0x00,0x08,0x00,0x00,0x00,0x07,0x00,0x00,0x00,0x20,0x00,0x04,0x00,
+    0x0a,0x00,0x00,0x00,0x03,0x00,0x00,0x00,0x06,0x00,0x00,0x00,0x3b,0x00,0x04,0x00,
+    0x0a,0x00,0x00,0x00,0x09,0x00,0x00,0x00,0x03,0x00,0x00,0x00,0x20,0x00,0x04,0x00,
+    0x0c,0x00,0x00,0x00,0x01,0x00,0x00,0x00,0x04,0x00,0x00,0x00,0x3b,0x00,0x04,0x00,
+    0x0c,0x00,0x00,0x00,0x0b,0x00,0x00,0x00,0x01,0x00,0x00,0x00,0x19,0x00,0x09,0x00,
+    0x0d,0x00,0x00,0x00,0x03,0x00,0x00,0x00,0x01,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x01,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+    0x1a,0x00,0x02,0x00,0x0e,0x00,0x00,0x00,0x1b,0x00,0x03,0x00,0x0f,0x00,0x00,0x00,
+    0x0d,0x00,0x00,0x00,0x20,0x00,0x04,0x00,0x11,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+    0x0d,0x00,0x00,0x00,0x3b,0x00,0x04,0x00,0x11,0x00,0x00,0x00,0x10,0x00,0x00,0x00,
+    0x00,0x00,0x00,0x00,0x20,0x00,0x04,0x00,0x13,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+    0x0e,0x00,0x00,0x00,0x3b,0x00,0x04,0x00,0x13,0x00,0x00,0x00,0x12,0x00,0x00,0x00,
+    0x00,0x00,0x00,0x00,0x1e,0x00,0x05,0x00,0x14,0x00,0x00,0x00,0x06,0x00,0x00,0x00,
+    0x06,0x00,0x00,0x00,0x06,0x00,0x00,0x00,0x20,0x00,0x04,0x00,0x16,0x00,0x00,0x00,
+    0x02,0x00,0x00,0x00,0x14,0x00,0x00,0x00,0x3b,0x00,0x04,0x00,0x16,0x00,0x00,0x00,
+    0x15,0x00,0x00,0x00,0x02,0x00,0x00,0x00,0x15,0x00,0x04,0x00,0x17,0x00,0x00,0x00,
+    0x20,0x00,0x00,0x00,0x01,0x00,0x00,0x00,0x20,0x00,0x04,0x00,0x1c,0x00,0x00,0x00,
+    0x02,0x00,0x00,0x00,0x06,0x00,0x00,0x00,0x2b,0x00,0x04,0x00,0x17,0x00,0x00,0x00,
+    0x1d,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x2b,0x00,0x04,0x00,0x17,0x00,0x00,0x00,
+    0x20,0x00,0x00,0x00,0x02,0x00,0x00,0x00,0x2b,0x00,0x04,0x00,0x03,0x00,0x00,0x00,
+    0x2a,0x00,0x00,0x00,0x00,0x00,0x00,0x40,0x2b,0x00,0x04,0x00,0x03,0x00,0x00,0x00,
+    0x2c,0x00,0x00,0x00,0x00,0x00,0x80,0x3f,0x36,0x00,0x05,0x00,0x07,0x00,0x00,0x00,
+    0x02,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x08,0x00,0x00,0x00,0xf8,0x00,0x02,0x00,
+    0x36,0x00,0x00,0x00,0x3d,0x00,0x04,0x00,0x0d,0x00,0x00,0x00,0x18,0x00,0x00,0x00,
+    0x10,0x00,0x00,0x00,0x3d,0x00,0x04,0x00,0x0e,0x00,0x00,0x00,0x19,0x00,0x00,0x00,
+    0x12,0x00,0x00,0x00,0x56,0x00,0x05,0x00,0x0f,0x00,0x00,0x00,0x1a,0x00,0x00,0x00,
+    0x18,0x00,0x00,0x00,0x19,0x00,0x00,0x00,0x3d,0x00,0x04,0x00,0x04,0x00,0x00,0x00,
+    0x1b,0x00,0x00,0x00,0x0b,0x00,0x00,0x00,0x41,0x00,0x05,0x00,0x1c,0x00,0x00,0x00,
+    0x1e,0x00,0x00,0x00,0x15,0x00,0x00,0x00,0x1d,0x00,0x00,0x00,0x3d,0x00,0x04,0x00,
+    0x06,0x00,0x00,0x00,0x1f,0x00,0x00,0x00,0x1e,0x00,0x00,0x00,0x41,0x00,0x05,0x00,
+    0x1c,0x00,0x00,0x00,0x21,0x00,0x00,0x00,0x15,0x00,0x00,0x00,0x20,0x00,0x00,0x00,
+    0x3d,0x00,0x04,0x00,0x06,0x00,0x00,0x00,0x22,0x00,0x00,0x00,0x21,0x00,0x00,0x00,
+    0x57,0x00,0x05,0x00,0x06,0x00,0x00,0x00,0x23,0x00,0x00,0x00,0x1a,0x00,0x00,0x00,
+    0x1b,0x00,0x00,0x00,0x4f,0x00,0x08,0x00,0x05,0x00,0x00,0x00,0x24,0x00,0x00,0x00,
+    0x23,0x00,0x00,0x00,0x23,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x01,0x00,0x00,0x00,
+    0x02,0x00,0x00,0x00,0x51,0x00,0x05,0x00,0x03,0x00,0x00,0x00,0x25,0x00,0x00,0x00,
+    0x1b,0x00,0x00,0x00,0x01,0x00,0x00,0x00,0x51,0x00,0x05,0x00,0x03,0x00,0x00,0x00,
+    0x26,0x00,0x00,0x00,0x1f,0x00,0x00,0x00,0x01,0x00,0x00,0x00,0x85,0x00,0x05,0x00,
+    0x03,0x00,0x00,0x00,0x27,0x00,0x00,0x00,0x25,0x00,0x00,0x00,0x26,0x00,0x00,0x00,
+    0x51,0x00,0x05,0x00,0x03,0x00,0x00,0x00,0x28,0x00,0x00,0x00,0x22,0x00,0x00,0x00,
+    0x00,0x00,0x00,0x00,0x0c,0x00,0x06,0x00,0x03,0x00,0x00,0x00,0x29,0x00,0x00,0x00,
+    0x01,0x00,0x00,0x00,0x0a,0x00,0x00,0x00,0x27,0x00,0x00,0x00,0x85,0x00,0x05,0x00,
+    0x03,0x00,0x00,0x00,0x2b,0x00,0x00,0x00,0x29,0x00,0x00,0x00,0x2a,0x00,0x00,0x00,
+    0x83,0x00,0x05,0x00,0x03,0x00,0x00,0x00,0x2d,0x00,0x00,0x00,0x2b,0x00,0x00,0x00,
+    0x2c,0x00,0x00,0x00,0x85,0x00,0x05,0x00,0x03,0x00,0x00,0x00,0x2e,0x00,0x00,0x00,
+    0x2d,0x00,0x00,0x00,0x2d,0x00,0x00,0x00,0x85,0x00,0x05,0x00,0x03,0x00,0x00,0x00,
+    0x2f,0x00,0x00,0x00,0x28,0x00,0x00,0x00,0x2e,0x00,0x00,0x00,0x83,0x00,0x05,0x00,
+    0x03,0x00,0x00,0x00,0x30,0x00,0x00,0x00,0x2c,0x00,0x00,0x00,0x2f,0x00,0x00,0x00,
+    0x8e,0x00,0x05,0x00,0x05,0x00,0x00,0x00,0x31,0x00,0x00,0x00,0x24,0x00,0x00,0x00,
+    0x30,0x00,0x00,0x00,0x51,0x00,0x05,0x00,0x03,0x00,0x00,0x00,0x32,0x00,0x00,0x00,
+    0x31,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x51,0x00,0x05,0x00,0x03,0x00,0x00,0x00,
+    0x33,0x00,0x00,0x00,0x31,0x00,0x00,0x00,0x01,0x00,0x00,0x00,0x51,0x00,0x05,0x00,
+    0x03,0x00,0x00,0x00,0x34,0x00,0x00,0x00,0x31,0x00,0x00,0x00,0x02,0x00,0x00,0x00,
+    0x50,0x00,0x07,0x00,0x06,0x00,0x00,0x00,0x35,0x00,0x00,0x00,0x32,0x00,0x00,0x00,
+    0x33,0x00,0x00,0x00,0x34,0x00,0x00,0x00,0x2c,0x00,0x00,0x00,0x3e,0x00,0x03,0x00,
+    0x09,0x00,0x00,0x00,0x35,0x00,0x00,0x00,0xfd,0x00,0x01,0x00,0x38,0x00,0x01,0x00,
+};
+
+static const uint8_t _crt_fs_bytecode_spirv[2568] = {
+    0x03,0x02,0x23,0x07,0x00,0x04,0x01,0x00,0x0b,0x00,0x08,0x00,0x75,0x00,0x00,0x00,
+    0x00,0x00,0x00,0x00,0x11,0x00,0x02,0x00,0x01,0x00,0x00,0x00,0x0b,0x00,0x06,0x00,
+    0x01,0x00,0x00,0x00,0x47,0x4c,0x53,0x4c,0x2e,0x73,0x74,0x64,0x2e,0x34,0x35,0x30,
+    0x00,0x00,0x00,0x00,0x0e,0x00,0x03,0x00,0x00,0x00,0x00,0x00,0x01,0x00,0x00,0x00,
+    0x0f,0x00,0x0a,0x00,0x04,0x00,0x00,0x00,0x02,0x00,0x00,0x00,0x6d,0x61,0x69,0x6e,
+    0x00,0x00,0x00,0x00,0x09,0x00,0x00,0x00,0x0b,0x00,0x00,0x00,0x10,0x00,0x00,0x00,
+    0x12,0x00,0x00,0x00,0x15,0x00,0x00,0x00,0x10,0x00,0x03,0x00,0x02,0x00,0x00,0x00,
+    0x07,0x00,0x00,0x00,0x47,0x00,0x04,0x00,0x09,0x00,0x00,0x00,0x1e,0x00,0x00,0x00,
+    0x00,0x00,0x00,0x00,0x47,0x00,0x04,0x00,0x0b,0x00,0x00,0x00,0x1e,0x00,0x00,0x00,
+    0x00,0x00,0x00,0x00,0x47,0x00,0x04,0x00,0x10,0x00,0x00,0x00,0x22,0x00,0x00,0x00,
+    0x01,0x00,0x00,0x00,0x47,0x00,0x04,0x00,0x10,0x00,0x00,0x00,0x21,0x00,0x00,0x00,
+    0x00,0x00,0x00,0x00,0x47,0x00,0x04,0x00,0x12,0x00,0x00,0x00,0x22,0x00,0x00,0x00,
+    0x01,0x00,0x00,0x00,0x47,0x00,0x04,0x00,0x12,0x00,0x00,0x00,0x21,0x00,0x00,0x00,
+    0x20,0x00,0x00,0x00,0x47,0x00,0x03,0x00,0x14,0x00,0x00,0x00,0x02,0x00,0x00,0x00,
+    0x48,0x00,0x05,0x00,0x14,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x23,0x00,0x00,0x00,
+    0x00,0x00,0x00,0x00,0x48,0x00,0x05,0x00,0x14,0x00,0x00,0x00,0x01,0x00,0x00,0x00,
+    0x23,0x00,0x00,0x00,0x10,0x00,0x00,0x00,0x48,0x00,0x05,0x00,0x14,0x00,0x00,0x00,
+    0x02,0x00,0x00,0x00,0x23,0x00,0x00,0x00,0x20,0x00,0x00,0x00,0x47,0x00,0x04,0x00,
+    0x15,0x00,0x00,0x00,0x22,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x47,0x00,0x04,0x00,
+    0x15,0x00,0x00,0x00,0x21,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x16,0x00,0x03,0x00,
+    0x03,0x00,0x00,0x00,0x20,0x00,0x00,0x00,0x17,0x00,0x04,0x00,0x04,0x00,0x00,0x00,
+    0x03,0x00,0x00,0x00,0x02,0x00,0x00,0x00,0x17,0x00,0x04,0x00,0x05,0x00,0x00,0x00,
+    0x03,0x00,0x00,0x00,0x03,0x00,0x00,0x00,0x17,0x00,0x04,0x00,0x06,0x00,0x00,0x00,
+    0x03,0x00,0x00,0x00,0x04,0x00,0x00,0x00,0x13,0x00,0x02,0x00,0x07,0x00,0x00,0x00,
+    0x21,0x00,0x03,0x00,0x08,0x00,0x00,0x00,0x07,0x00,0x00,0x00,0x20,0x00,0x04,0x00,
+    0x0a,0x00,0x00,0x00,0x03,0x00,0x00,0x00,0x06,0x00,0x00,0x00,0x3b,0x00,0x04,0x00,
+    0x0a,0x00,0x00,0x00,0x09,0x00,0x00,0x00,0x03,0x00,0x00,0x00,0x20,0x00,0x04,0x00,
+    0x0c,0x00,0x00,0x00,0x01,0x00,0x00,0x00,0x04,0x00,0x00,0x00,0x3b,0x00,0x04,0x00,
+    0x0c,0x00,0x00,0x00,0x0b,0x00,0x00,0x00,0x01,0x00,0x00,0x00,0x19,0x00,0x09,0x00,
+    0x0d,0x00,0x00,0x00,0x03,0x00,0x00,0x00,0x01,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x01,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+    0x1a,0x00,0x02,0x00,0x0e,0x00,0x00,0x00,0x1b,0x00,0x03,0x00,0x0f,0x00,0x00,0x00,
+    0x0d,0x00,0x00,0x00,0x20,0x00,0x04,0x00,0x11,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+    0x0d,0x00,0x00,0x00,0x3b,0x00,0x04,0x00,0x11,0x00,0x00,0x00,0x10,0x00,0x00,0x00,
+    0x00,0x00,0x00,0x00,0x20,0x00,0x04,0x00,0x13,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+    0x0e,0x00,0x00,0x00,0x3b,0x00,0x04,0x00,0x13,0x00,0x00,0x00,0x12,0x00,0x00,0x00,
+    0x00,0x00,0x00,0x00,0x1e,0x00,0x05,0x00,0x14,0x00,0x00,0x00,0x06,0x00,0x00,0x00,
+    0x06,0x00,0x00,0x00,0x06,0x00,0x00,0x00,0x20,0x00,0x04,0x00,0x16,0x00,0x00,0x00,
+    0x02,0x00,0x00,0x00,0x14,0x00,0x00,0x00,0x3b,0x00,0x04,0x00,0x16,0x00,0x00,0x00,
+    0x15,0x00,0x00,0x00,0x02,0x00,0x00,0x00,0x15,0x00,0x04,0x00,0x17,0x00,0x00,0x00,
+    0x20,0x00,0x00,0x00,0x01,0x00,0x00,0x00,0x20,0x00,0x04,0x00,0x1c,0x00,0x00,0x00,
+    0x02,0x00,0x00,0x00,0x06,0x00,0x00,0x00,0x2b,0x00,0x04,0x00,0x17,0x00,0x00,0x00,
+    0x1d,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x2b,0x00,0x04,0x00,0x17,0x00,0x00,0x00,
+    0x20,0x00,0x00,0x00,0x01,0x00,0x00,0x00,0x2b,0x00,0x04,0x00,0x17,0x00,0x00,0x00,
+    0x23,0x00,0x00,0x00,0x02,0x00,0x00,0x00,0x2b,0x00,0x04,0x00,0x03,0x00,0x00,0x00,
+    0x26,0x00,0x00,0x00,0x00,0x00,0x00,0x40,0x2b,0x00,0x04,0x00,0x03,0x00,0x00,0x00,
+    0x28,0x00,0x00,0x00,0x00,0x00,0x80,0x3f,0x2c,0x00,0x05,0x00,0x04,0x00,0x00,0x00,
+    0x29,0x00,0x00,0x00,0x28,0x00,0x00,0x00,0x28,0x00,0x00,0x00,0x2b,0x00,0x04,0x00,
+    0x03,0x00,0x00,0x00,0x31,0x00,0x00,0x00,0x00,0x00,0x00,0x3f,0x2c,0x00,0x05,0x00,
+    0x04,0x00,0x00,0x00,0x33,0x00,0x00,0x00,0x31,0x00,0x00,0x00,0x31,0x00,0x00,0x00,
+    0x2b,0x00,0x04,0x00,0x03,0x00,0x00,0x00,0x35,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+    0x2c,0x00,0x05,0x00,0x04,0x00,0x00,0x00,0x36,0x00,0x00,0x00,0x35,0x00,0x00,0x00,
+    0x35,0x00,0x00,0x00,0x2b,0x00,0x04,0x00,0x03,0x00,0x00,0x00,0x4b,0x00,0x00,0x00,
+    0x00,0x00,0x40,0x40,0x2c,0x00,0x06,0x00,0x05,0x00,0x00,0x00,0x50,0x00,0x00,0x00,
+    0x28,0x00,0x00,0x00,0x28,0x00,0x00,0x00,0x28,0x00,0x00,0x00,0x2b,0x00,0x04,0x00,
+    0x03,0x00,0x00,0x00,0x51,0x00,0x00,0x00,0x00,0x00,0xc0,0x3f,0x2b,0x00,0x04,0x00,
+    0x03,0x00,0x00,0x00,0x52,0x00,0x00,0x00,0x00,0x00,0x20,0x40,0x2c,0x00,0x06,0x00,
+    0x05,0x00,0x00,0x00,0x53,0x00,0x00,0x00,0x31,0x00,0x00,0x00,0x51,0x00,0x00,0x00,
+    0x52,0x00,0x00,0x00,0x2c,0x00,0x06,0x00,0x05,0x00,0x00,0x00,0x57,0x00,0x00,0x00,
+    0x35,0x00,0x00,0x00,0x35,0x00,0x00,0x00,0x35,0x00,0x00,0x00,0x2b,0x00,0x04,0x00,
+    0x03,0x00,0x00,0x00,0x60,0x00,0x00,0x00,0x00,0x00,0x80,0x41,0x2b,0x00,0x04,0x00,
+    0x03,0x00,0x00,0x00,0x67,0x00,0x00,0x00,0x17,0xb7,0xd1,0x38,0x36,0x00,0x05,0x00,
+    0x07,0x00,0x00,0x00,0x02,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x08,0x00,0x00,0x00,
+    0xf8,0x00,0x02,0x00,0x74,0x00,0x00,0x00,0x3d,0x00,0x04,0x00,0x0d,0x00,0x00,0x00,
+    0x18,0x00,0x00,0x00,0x10,0x00,0x00,0x00,0x3d,0x00,0x04,0x00,0x0e,0x00,0x00,0x00,
+    0x19,0x00,0x00,0x00,0x12,0x00,0x00,0x00,0x56,0x00,0x05,0x00,0x0f,0x00,0x00,0x00,
+    0x1a,0x00,0x00,0x00,0x18,0x00,0x00,0x00,0x19,0x00,0x00,0x00,0x3d,0x00,0x04,0x00,
+    0x04,0x00,0x00,0x00,0x1b,0x00,0x00,0x00,0x0b,0x00,0x00,0x00,0x41,0x00,0x05,0x00,
+    0x1c,0x00,0x00,0x00,0x1e,0x00,0x00,0x00,0x15,0x00,0x00,0x00,0x1d,0x00,0x00,0x00,
+    0x3d,0x00,0x04,0x00,0x06,0x00,0x00,0x00,0x1f,0x00,0x00,0x00,0x1e,0x00,0x00,0x00,
+    0x41,0x00,0x05,0x00,0x1c,0x00,0x00,0x00,0x21,0x00,0x00,0x00,0x15,0x00,0x00,0x00,
+    0x20,0x00,0x00,0x00,0x3d,0x00,0x04,0x00,0x06,0x00,0x00,0x00,0x22,0x00,0x00,0x00,
+    0x21,0x00,0x00,0x00,0x41,0x00,0x05,0x00,0x1c,0x00,0x00,0x00,0x24,0x00,0x00,0x00,
+    0x15,0x00,0x00,0x00,0x23,0x00,0x00,0x00,0x3d,0x00,0x04,0x00,0x06,0x00,0x00,0x00,
+    0x25,0x00,0x00,0x00,0x24,0x00,0x00,0x00,0x8e,0x00,0x05,0x00,0x04,0x00,0x00,0x00,
+    0x27,0x00,0x00,0x00,0x1b,0x00,0x00,0x00,0x26,0x00,0x00,0x00,0x83,0x00,0x05,0x00,
+    0x04,0x00,0x00,0x00,0x2a,0x00,0x00,0x00,0x27,0x00,0x00,0x00,0x29,0x00,0x00,0x00,
+    0x4f,0x00,0x07,0x00,0x04,0x00,0x00,0x00,0x2b,0x00,0x00,0x00,0x2a,0x00,0x00,0x00,
+    0x2a,0x00,0x00,0x00,0x01,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x51,0x00,0x05,0x00,
+    0x03,0x00,0x00,0x00,0x2c,0x00,0x00,0x00,0x25,0x00,0x00,0x00,0x01,0x00,0x00,0x00,
+    0x85,0x00,0x05,0x00,0x04,0x00,0x00,0x00,0x2d,0x00,0x00,0x00,0x2b,0x00,0x00,0x00,
+    0x2b,0x00,0x00,0x00,0x8e,0x00,0x05,0x00,0x04,0x00,0x00,0x00,0x2e,0x00,0x00,0x00,
+    0x2d,0x00,0x00,0x00,0x2c,0x00,0x00,0x00,0x81,0x00,0x05,0x00,0x04,0x00,0x00,0x00,
+    0x2f,0x00,0x00,0x00,0x29,0x00,0x00,0x00,0x2e,0x00,0x00,0x00,0x85,0x00,0x05,0x00,
+    0x04,0x00,0x00,0x00,0x30,0x00,0x00,0x00,0x2a,0x00,0x00,0x00,0x2f,0x00,0x00,0x00,
+    0x8e,0x00,0x05,0x00,0x04,0x00,0x00,0x00,0x32,0x00,0x00,0x00,0x30,0x00,0x00,0x00,
+    0x31,0x00,0x00,0x00,0x81,0x00,0x05,0x00,0x04,0x00,0x00,0x00,0x34,0x00,0x00,0x00,
+    0x32,0x00,0x00,0x00,0x33,0x00,0x00,0x00,0x0c,0x00,0x07,0x00,0x04,0x00,0x00,0x00,
+    0x37,0x00,0x00,0x00,0x01,0x00,0x00,0x00,0x30,0x00,0x00,0x00,0x36,0x00,0x00,0x00,
+    0x34,0x00,0x00,0x00,0x0c,0x00,0x07,0x00,0x04,0x00,0x00,0x00,0x38,0x00,0x00,0x00,
+    0x01,0x00,0x00,0x00,0x30,0x00,0x00,0x00,0x34,0x00,0x00,0x00,0x29,0x00,0x00,0x00,
+    0x85,0x00,0x05,0x00,0x04,0x00,0x00,0x00,0x39,0x00,0x00,0x00,0x37,0x00,0x00,0x00,
+    0x38,0x00,0x00,0x00,0x57,0x00,0x05,0x00,0x06,0x00,0x00,0x00,0x3a,0x00,0x00,0x00,
+    0x1a,0x00,0x00,0x00,0x34,0x00,0x00,0x00,0x4f,0x00,0x08,0x00,0x05,0x00,0x00,0x00,
+    0x3b,0x00,0x00,0x00,0x3a,0x00,0x00,0x00,0x3a,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+    0x01,0x00,0x00,0x00,0x02,0x00,0x00,0x00,0x51,0x00,0x05,0x00,0x03,0x00,0x00,0x00,
+    0x3c,0x00,0x00,0x00,0x34,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x51,0x00,0x05,0x00,
+    0x03,0x00,0x00,0x00,0x3d,0x00,0x00,0x00,0x34,0x00,0x00,0x00,0x01,0x00,0x00,0x00,
+    0x51,0x00,0x05,0x00,0x03,0x00,0x00,0x00,0x3e,0x00,0x00,0x00,0x1f,0x00,0x00,0x00,
+    0x01,0x00,0x00,0x00,0x85,0x00,0x05,0x00,0x03,0x00,0x00,0x00,0x3f,0x00,0x00,0x00,
+    0x3d,0x00,0x00,0x00,0x3e,0x00,0x00,0x00,0x51,0x00,0x05,0x00,0x03,0x00,0x00,0x00,
+    0x40,0x00,0x00,0x00,0x25,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x0c,0x00,0x06,0x00,
+    0x03,0x00,0x00,0x00,0x41,0x00,0x00,0x00,0x01,0x00,0x00,0x00,0x0a,0x00,0x00,0x00,
+    0x3f,0x00,0x00,0x00,0x85,0x00,0x05,0x00,0x03,0x00,0x00,0x00,0x42,0x00,0x00,0x00,
+    0x41,0x00,0x00,0x00,0x26,0x00,0x00,0x00,0x83,0x00,0x05,0x00,0x03,0x00,0x00,0x00,
+    0x43,0x00,0x00,0x00,0x42,0x00,0x00,0x00,0x28,0x00,0x00,0x00,0x85,0x00,0x05,0x00,
+    0x03,0x00,0x00,0x00,0x44,0x00,0x00,0x00,0x43,0x00,0x00,0x00,0x43,0x00,0x00,0x00,
+    0x85,0x00,0x05,0x00,0x03,0x00,0x00,0x00,0x45,0x00,0x00,0x00,0x40,0x00,0x00,0x00,
+    0x44,0x00,0x00,0x00,0x83,0x00,0x05,0x00,0x03,0x00,0x00,0x00,0x46,0x00,0x00,0x00,
+    0x28,0x00,0x00,0x00,0x45,0x00,0x00,0x00,0x8e,0x00,0x05,0x00,0x05,0x00,0x00,0x00,
+    0x47,0x00,0x00,0x00,0x3b,0x00,0x00,0x00,0x46,0x00,0x00,0x00,0x51,0x00,0x05,0x00,
+    0x03,0x00,0x00,0x00,0x48,0x00,0x00,0x00,0x1b,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+    0x51,0x00,0x05,0x00,0x03,0x00,0x00,0x00,0x49,0x00,0x00,0x00,0x22,0x00,0x00,0x00,
+    0x00,0x00,0x00,0x00,0x85,0x00,0x05,0x00,0x03,0x00,0x00,0x00,0x4a,0x00,0x00,0x00,
+    0x48,0x00,0x00,0x00,0x49,0x00,0x00,0x00,0x88,0x00,0x05,0x00,0x03,0x00,0x00,0x00,
+    0x4c,0x00,0x00,0x00,0x4a,0x00,0x00,0x00,0x4b,0x00,0x00,0x00,0x0c,0x00,0x06,0x00,
+    0x03,0x00,0x00,0x00,0x4d,0x00,0x00,0x00,0x01,0x00,0x00,0x00,0x0a,0x00,0x00,0x00,
+    0x4c,0x00,0x00,0x00,0x85,0x00,0x05,0x00,0x03,0x00,0x00,0x00,0x4e,0x00,0x00,0x00,
+    0x4d,0x00,0x00,0x00,0x4b,0x00,0x00,0x00,0x50,0x00,0x06,0x00,0x05,0x00,0x00,0x00,
+    0x4f,0x00,0x00,0x00,0x4e,0x00,0x00,0x00,0x4e,0x00,0x00,0x00,0x4e,0x00,0x00,0x00,
+    0x83,0x00,0x05,0x00,0x05,0x00,0x00,0x00,0x54,0x00,0x00,0x00,0x4f,0x00,0x00,0x00,
+    0x53,0x00,0x00,0x00,0x0c,0x00,0x06,0x00,0x05,0x00,0x00,0x00,0x55,0x00,0x00,0x00,
+    0x01,0x00,0x00,0x00,0x04,0x00,0x00,0x00,0x54,0x00,0x00,0x00,0x83,0x00,0x05,0x00,
+    0x05,0x00,0x00,0x00,0x56,0x00,0x00,0x00,0x50,0x00,0x00,0x00,0x55,0x00,0x00,0x00,
+    0x0c,0x00,0x08,0x00,0x05,0x00,0x00,0x00,0x58,0x00,0x00,0x00,0x01,0x00,0x00,0x00,
+    0x2b,0x00,0x00,0x00,0x56,0x00,0x00,0x00,0x57,0x00,0x00,0x00,0x50,0x00,0x00,0x00,
+    0x51,0x00,0x05,0x00,0x03,0x00,0x00,0x00,0x59,0x00,0x00,0x00,0x25,0x00,0x00,0x00,
+    0x02,0x00,0x00,0x00,0x83,0x00,0x05,0x00,0x03,0x00,0x00,0x00,0x5a,0x00,0x00,0x00,
+    0x28,0x00,0x00,0x00,0x59,0x00,0x00,0x00,0x50,0x00,0x06,0x00,0x05,0x00,0x00,0x00,
+    0x5b,0x00,0x00,0x00,0x5a,0x00,0x00,0x00,0x5a,0x00,0x00,0x00,0x5a,0x00,0x00,0x00,
+    0x85,0x00,0x05,0x00,0x03,0x00,0x00,0x00,0x5c,0x00,0x00,0x00,0x59,0x00,0x00,0x00,
+    0x4b,0x00,0x00,0x00,0x8e,0x00,0x05,0x00,0x05,0x00,0x00,0x00,0x5d,0x00,0x00,0x00,
+    0x58,0x00,0x00,0x00,0x5c,0x00,0x00,0x00,0x81,0x00,0x05,0x00,0x05,0x00,0x00,0x00,
+    0x5e,0x00,0x00,0x00,0x5b,0x00,0x00,0x00,0x5d,0x00,0x00,0x00,0x85,0x00,0x05,0x00,
+    0x05,0x00,0x00,0x00,0x5f,0x00,0x00,0x00,0x47,0x00,0x00,0x00,0x5e,0x00,0x00,0x00,
+    0x85,0x00,0x05,0x00,0x03,0x00,0x00,0x00,0x61,0x00,0x00,0x00,0x60,0x00,0x00,0x00,
+    0x3c,0x00,0x00,0x00,0x85,0x00,0x05,0x00,0x03,0x00,0x00,0x00,0x62,0x00,0x00,0x00,
+    0x61,0x00,0x00,0x00,0x3d,0x00,0x00,0x00,0x83,0x00,0x05,0x00,0x03,0x00,0x00,0x00,
+    0x63,0x00,0x00,0x00,0x28,0x00,0x00,0x00,0x3c,0x00,0x00,0x00,0x85,0x00,0x05,0x00,
+    0x03,0x00,0x00,0x00,0x64,0x00,0x00,0x00,0x62,0x00,0x00,0x00,0x63,0x00,0x00,0x00,
+    0x83,0x00,0x05,0x00,0x03,0x00,0x00,0x00,0x65,0x00,0x00,0x00,0x28,0x00,0x00,0x00,
+    0x3d,0x00,0x00,0x00,0x85,0x00,0x05,0x00,0x03,0x00,0x00,0x00,0x66,0x00,0x00,0x00,
+    0x64,0x00,0x00,0x00,0x65,0x00,0x00,0x00,0x0c,0x00,0x08,0x00,0x03,0x00,0x00,0x00,
+    0x68,0x00,0x00,0x00,0x01,0x00,0x00,0x00,0x2b,0x00,0x00,0x00,0x66,0x00,0x00,0x00,
+    0x67,0x00,0x00,0x00,0x28,0x00,0x00,0x00,0x51,0x00,0x05,0x00,0x03,0x00,0x00,0x00,
+    0x69,0x00,0x00,0x00,0x25,0x00,0x00,0x00,0x03,0x00,0x00,0x00,0x0c,0x00,0x07,0x00,
+    0x03,0x00,0x00,0x00,0x6a,0x00,0x00,0x00,0x01,0x00,0x00,0x00,0x1a,0x00,0x00,0x00,
+    0x68,0x00,0x00,0x00,0x69,0x00,0x00,0x00,0x51,0x00,0x05,0x00,0x03,0x00,0x00,0x00,
+    0x6b,0x00,0x00,0x00,0x39,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x51,0x00,0x05,0x00,
+    0x03,0x00,0x00,0x00,0x6c,0x00,0x00,0x00,0x39,0x00,0x00,0x00,0x01,0x00,0x00,0x00,
+    0x85,0x00,0x05,0x00,0x03,0x00,0x00,0x00,0x6d,0x00,0x00,0x00,0x6b,0x00,0x00,0x00,
+    0x6c,0x00,0x00,0x00,0x85,0x00,0x05,0x00,0x03,0x00,0x00,0x00,0x6e,0x00,0x00,0x00,
+    0x6a,0x00,0x00,0x00,0x6d,0x00,0x00,0x00,0x8e,0x00,0x05,0x00,0x05,0x00,0x00,0x00,
+    0x6f,0x00,0x00,0x00,0x5f,0x00,0x00,0x00,0x6e,0x00,0x00,0x00,0x51,0x00,0x05,0x00,
+    0x03,0x00,0x00,0x00,0x70,0x00,0x00,0x00,0x6f,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+    0x51,0x00,0x05,0x00,0x03,0x00,0x00,0x00,0x71,0x00,0x00,0x00,0x6f,0x00,0x00,0x00,
+    0x01,0x00,0x00,0x00,0x51,0x00,0x05,0x00,0x03,0x00,0x00,0x00,0x72,0x00,0x00,0x00,
+    0x6f,0x00,0x00,0x00,0x02,0x00,0x00,0x00,0x50,0x00,0x07,0x00,0x06,0x00,0x00,0x00,
+    0x73,0x00,0x00,0x00,0x70,0x00,0x00,0x00,0x71,0x00,0x00,0x00,0x72,0x00,0x00,0x00,
+    0x28,0x00,0x00,0x00,0x3e,0x00,0x03,0x00,0x09,0x00,0x00,0x00,0x73,0x00,0x00,0x00,
+    0xfd,0x00,0x01,0x00,0x38,0x00,0x01,0x00,
+};
+
+static const uint8_t _scale2x_fs_bytecode_spirv[2336] = {
+    0x03,0x02,0x23,0x07,0x00,0x04,0x01,0x00,0x0b,0x00,0x08,0x00,0x66,0x00,0x00,0x00,
+    0x00,0x00,0x00,0x00,0x11,0x00,0x02,0x00,0x01,0x00,0x00,0x00,0x0b,0x00,0x06,0x00,
+    0x01,0x00,0x00,0x00,0x47,0x4c,0x53,0x4c,0x2e,0x73,0x74,0x64,0x2e,0x34,0x35,0x30,
+    0x00,0x00,0x00,0x00,0x0e,0x00,0x03,0x00,0x00,0x00,0x00,0x00,0x01,0x00,0x00,0x00,
+    0x0f,0x00,0x0a,0x00,0x04,0x00,0x00,0x00,0x02,0x00,0x00,0x00,0x6d,0x61,0x69,0x6e,
+    0x00,0x00,0x00,0x00,0x09,0x00,0x00,0x00,0x0b,0x00,0x00,0x00,0x10,0x00,0x00,0x00,
+    0x12,0x00,0x00,0x00,0x15,0x00,0x00,0x00,0x10,0x00,0x03,0x00,0x02,0x00,0x00,0x00,
+    0x07,0x00,0x00,0x00,0x47,0x00,0x04,0x00,0x09,0x00,0x00,0x00,0x1e,0x00,0x00,0x00,
+    0x00,0x00,0x00,0x00,0x47,0x00,0x04,0x00,0x0b,0x00,0x00,0x00,0x1e,0x00,0x00,0x00,
+    0x00,0x00,0x00,0x00,0x47,0x00,0x04,0x00,0x10,0x00,0x00,0x00,0x22,0x00,0x00,0x00,
+    0x01,0x00,0x00,0x00,0x47,0x00,0x04,0x00,0x10,0x00,0x00,0x00,0x21,0x00,0x00,0x00,
+    0x00,0x00,0x00,0x00,0x47,0x00,0x04,0x00,0x12,0x00,0x00,0x00,0x22,0x00,0x00,0x00,
+    0x01,0x00,0x00,0x00,0x47,0x00,0x04,0x00,0x12,0x00,0x00,0x00,0x21,0x00,0x00,0x00,
+    0x20,0x00,0x00,0x00,0x47,0x00,0x03,0x00,0x14,0x00,0x00,0x00,0x02,0x00,0x00,0x00,
+    0x48,0x00,0x05,0x00,0x14,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x23,0x00,0x00,0x00,
+    0x00,0x00,0x00,0x00,0x48,0x00,0x05,0x00,0x14,0x00,0x00,0x00,0x01,0x00,0x00,0x00,
+    0x23,0x00,0x00,0x00,0x10,0x00,0x00,0x00,0x48,0x00,0x05,0x00,0x14,0x00,0x00,0x00,
+    0x02,0x00,0x00,0x00,0x23,0x00,0x00,0x00,0x20,0x00,0x00,0x00,0x47,0x00,0x04,0x00,
+    0x15,0x00,0x00,0x00,0x22,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x47,0x00,0x04,0x00,
+    0x15,0x00,0x00,0x00,0x21,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x16,0x00,0x03,0x00,
+    0x03,0x00,0x00,0x00,0x20,0x00,0x00,0x00,0x17,0x00,0x04,0x00,0x04,0x00,0x00,0x00,
+    0x03,0x00,0x00,0x00,0x02,0x00,0x00,0x00,0x17,0x00,0x04,0x00,0x05,0x00,0x00,0x00,
+    0x03,0x00,0x00,0x00,0x03,0x00,0x00,0x00,0x17,0x00,0x04,0x00,0x06,0x00,0x00,0x00,
+    0x03,0x00,0x00,0x00,0x04,0x00,0x00,0x00,0x13,0x00,0x02,0x00,0x07,0x00,0x00,0x00,
+    0x21,0x00,0x03,0x00,0x08,0x00,0x00,0x00,0x07,0x00,0x00,0x00,0x20,0x00,0x04,0x00,
+    0x0a,0x00,0x00,0x00,0x03,0x00,0x00,0x00,0x06,0x00,0x00,0x00,0x3b,0x00,0x04,0x00,
+    0x0a,0x00,0x00,0x00,0x09,0x00,0x00,0x00,0x03,0x00,0x00,0x00,0x20,0x00,0x04,0x00,
+    0x0c,0x00,0x00,0x00,0x01,0x00,0x00,0x00,0x04,0x00,0x00,0x00,0x3b,0x00,0x04,0x00,
+    0x0c,0x00,0x00,0x00,0x0b,0x00,0x00,0x00,0x01,0x00,0x00,0x00,0x19,0x00,0x09,0x00,
+    0x0d,0x00,0x00,0x00,0x03,0x00,0x00,0x00,0x01,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x01,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+    0x1a,0x00,0x02,0x00,0x0e,0x00,0x00,0x00,0x1b,0x00,0x03,0x00,0x0f,0x00,0x00,0x00,
+    0x0d,0x00,0x00,0x00,0x20,0x00,0x04,0x00,0x11,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+    0x0d,0x00,0x00,0x00,0x3b,0x00,0x04,0x00,0x11,0x00,0x00,0x00,0x10,0x00,0x00,0x00,
+    0x00,0x00,0x00,0x00,0x20,0x00,0x04,0x00,0x13,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+    0x0e,0x00,0x00,0x00,0x3b,0x00,0x04,0x00,0x13,0x00,0x00,0x00,0x12,0x00,0x00,0x00,
+    0x00,0x00,0x00,0x00,0x1e,0x00,0x05,0x00,0x14,0x00,0x00,0x00,0x06,0x00,0x00,0x00,
+    0x06,0x00,0x00,0x00,0x06,0x00,0x00,0x00,0x20,0x00,0x04,0x00,0x16,0x00,0x00,0x00,
+    0x02,0x00,0x00,0x00,0x14,0x00,0x00,0x00,0x3b,0x00,0x04,0x00,0x16,0x00,0x00,0x00,
+    0x15,0x00,0x00,0x00,0x02,0x00,0x00,0x00,0x15,0x00,0x04,0x00,0x17,0x00,0x00,0x00,
+    0x20,0x00,0x00,0x00,0x01,0x00,0x00,0x00,0x20,0x00,0x04,0x00,0x1c,0x00,0x00,0x00,
+    0x02,0x00,0x00,0x00,0x06,0x00,0x00,0x00,0x2b,0x00,0x04,0x00,0x17,0x00,0x00,0x00,
+    0x1d,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x2b,0x00,0x04,0x00,0x17,0x00,0x00,0x00,
+    0x20,0x00,0x00,0x00,0x02,0x00,0x00,0x00,0x2b,0x00,0x04,0x00,0x03,0x00,0x00,0x00,
+    0x26,0x00,0x00,0x00,0x00,0x00,0x00,0x3f,0x2c,0x00,0x05,0x00,0x04,0x00,0x00,0x00,
+    0x27,0x00,0x00,0x00,0x26,0x00,0x00,0x00,0x26,0x00,0x00,0x00,0x2b,0x00,0x04,0x00,
+    0x03,0x00,0x00,0x00,0x2d,0x00,0x00,0x00,0x00,0x00,0x00,0x40,0x2b,0x00,0x04,0x00,
+    0x03,0x00,0x00,0x00,0x2f,0x00,0x00,0x00,0x00,0x00,0x80,0x3f,0x2c,0x00,0x05,0x00,
+    0x04,0x00,0x00,0x00,0x30,0x00,0x00,0x00,0x2f,0x00,0x00,0x00,0x2f,0x00,0x00,0x00,
+    0x2b,0x00,0x04,0x00,0x03,0x00,0x00,0x00,0x38,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+    0x2c,0x00,0x06,0x00,0x05,0x00,0x00,0x00,0x4d,0x00,0x00,0x00,0x2f,0x00,0x00,0x00,
+    0x2f,0x00,0x00,0x00,0x2f,0x00,0x00,0x00,0x36,0x00,0x05,0x00,0x07,0x00,0x00,0x00,
+    0x02,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x08,0x00,0x00,0x00,0xf8,0x00,0x02,0x00,
+    0x65,0x00,0x00,0x00,0x3d,0x00,0x04,0x00,0x0d,0x00,0x00,0x00,0x18,0x00,0x00,0x00,
+    0x10,0x00,0x00,0x00,0x3d,0x00,0x04,0x00,0x0e,0x00,0x00,0x00,0x19,0x00,0x00,0x00,
+    0x12,0x00,0x00,0x00,0x56,0x00,0x05,0x00,0x0f,0x00,0x00,0x00,0x1a,0x00,0x00,0x00,
+    0x18,0x00,0x00,0x00,0x19,0x00,0x00,0x00,0x3d,0x00,0x04,0x00,0x04,0x00,0x00,0x00,
+    0x1b,0x00,0x00,0x00,0x0b,0x00,0x00,0x00,0x41,0x00,0x05,0x00,0x1c,0x00,0x00,0x00,
+    0x1e,0x00,0x00,0x00,0x15,0x00,0x00,0x00,0x1d,0x00,0x00,0x00,0x3d,0x00,0x04,0x00,
+    0x06,0x00,0x00,0x00,0x1f,0x00,0x00,0x00,0x1e,0x00,0x00,0x00,0x41,0x00,0x05,0x00,
+    0x1c,0x00,0x00,0x00,0x21,0x00,0x00,0x00,0x15,0x00,0x00,0x00,0x20,0x00,0x00,0x00,
+    0x3d,0x00,0x04,0x00,0x06,0x00,0x00,0x00,0x22,0x00,0x00,0x00,0x21,0x00,0x00,0x00,
+    0x4f,0x00,0x07,0x00,0x04,0x00,0x00,0x00,0x23,0x00,0x00,0x00,0x1f,0x00,0x00,0x00,
+    0x1f,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x01,0x00,0x00,0x00,0x4f,0x00,0x07,0x00,
+    0x04,0x00,0x00,0x00,0x24,0x00,0x00,0x00,0x1f,0x00,0x00,0x00,0x1f,0x00,0x00,0x00,
+    0x02,0x00,0x00,0x00,0x03,0x00,0x00,0x00,0x85,0x00,0x05,0x00,0x04,0x00,0x00,0x00,
+    0x25,0x00,0x00,0x00,0x1b,0x00,0x00,0x00,0x23,0x00,0x00,0x00,0x0c,0x00,0x06,0x00,
+    0x04,0x00,0x00,0x00,0x28,0x00,0x00,0x00,0x01,0x00,0x00,0x00,0x0a,0x00,0x00,0x00,
+    0x25,0x00,0x00,0x00,0x0c,0x00,0x07,0x00,0x04,0x00,0x00,0x00,0x29,0x00,0x00,0x00,
+    0x01,0x00,0x00,0x00,0x30,0x00,0x00,0x00,0x27,0x00,0x00,0x00,0x28,0x00,0x00,0x00,
+    0x0c,0x00,0x06,0x00,0x04,0x00,0x00,0x00,0x2a,0x00,0x00,0x00,0x01,0x00,0x00,0x00,
+    0x08,0x00,0x00,0x00,0x25,0x00,0x00,0x00,0x81,0x00,0x05,0x00,0x04,0x00,0x00,0x00,
+    0x2b,0x00,0x00,0x00,0x2a,0x00,0x00,0x00,0x27,0x00,0x00,0x00,0x85,0x00,0x05,0x00,
+    0x04,0x00,0x00,0x00,0x2c,0x00,0x00,0x00,0x2b,0x00,0x00,0x00,0x24,0x00,0x00,0x00,
+    0x8e,0x00,0x05,0x00,0x04,0x00,0x00,0x00,0x2e,0x00,0x00,0x00,0x29,0x00,0x00,0x00,
+    0x2d,0x00,0x00,0x00,0x83,0x00,0x05,0x00,0x04,0x00,0x00,0x00,0x31,0x00,0x00,0x00,
+    0x2e,0x00,0x00,0x00,0x30,0x00,0x00,0x00,0x51,0x00,0x05,0x00,0x03,0x00,0x00,0x00,
+    0x32,0x00,0x00,0x00,0x31,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x51,0x00,0x05,0x00,
+    0x03,0x00,0x00,0x00,0x33,0x00,0x00,0x00,0x24,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+    0x85,0x00,0x05,0x00,0x03,0x00,0x00,0x00,0x34,0x00,0x00,0x00,0x32,0x00,0x00,0x00,
+    0x33,0x00,0x00,0x00,0x51,0x00,0x05,0x00,0x03,0x00,0x00,0x00,0x35,0x00,0x00,0x00,
+    0x31,0x00,0x00,0x00,0x01,0x00,0x00,0x00,0x51,0x00,0x05,0x00,0x03,0x00,0x00,0x00,
+    0x36,0x00,0x00,0x00,0x24,0x00,0x00,0x00,0x01,0x00,0x00,0x00,0x85,0x00,0x05,0x00,
+    0x03,0x00,0x00,0x00,0x37,0x00,0x00,0x00,0x35,0x00,0x00,0x00,0x36,0x00,0x00,0x00,
+    0x57,0x00,0x05,0x00,0x06,0x00,0x00,0x00,0x39,0x00,0x00,0x00,0x1a,0x00,0x00,0x00,
+    0x2c,0x00,0x00,0x00,0x4f,0x00,0x08,0x00,0x05,0x00,0x00,0x00,0x3a,0x00,0x00,0x00,
+    0x39,0x00,0x00,0x00,0x39,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x01,0x00,0x00,0x00,
+    0x02,0x00,0x00,0x00,0x50,0x00,0x05,0x00,0x04,0x00,0x00,0x00,0x3b,0x00,0x00,0x00,
+    0x34,0x00,0x00,0x00,0x38,0x00,0x00,0x00,0x81,0x00,0x05,0x00,0x04,0x00,0x00,0x00,
+    0x3c,0x00,0x00,0x00,0x2c,0x00,0x00,0x00,0x3b,0x00,0x00,0x00,0x57,0x00,0x05,0x00,
+    0x06,0x00,0x00,0x00,0x3d,0x00,0x00,0x00,0x1a,0x00,0x00,0x00,0x3c,0x00,0x00,0x00,
+    0x4f,0x00,0x08,0x00,0x05,0x00,0x00,0x00,0x3e,0x00,0x00,0x00,0x3d,0x00,0x00,0x00,
+    0x3d,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x01,0x00,0x00,0x00,0x02,0x00,0x00,0x00,
+    0x50,0x00,0x05,0x00,0x04,0x00,0x00,0x00,0x3f,0x00,0x00,0x00,0x38,0x00,0x00,0x00,
+    0x37,0x00,0x00,0x00,0x81,0x00,0x05,0x00,0x04,0x00,0x00,0x00,0x40,0x00,0x00,0x00,
+    0x2c,0x00,0x00,0x00,0x3f,0x00,0x00,0x00,0x57,0x00,0x05,0x00,0x06,0x00,0x00,0x00,
+    0x41,0x00,0x00,0x00,0x1a,0x00,0x00,0x00,0x40,0x00,0x00,0x00,0x4f,0x00,0x08,0x00,
+    0x05,0x00,0x00,0x00,0x42,0x00,0x00,0x00,0x41,0x00,0x00,0x00,0x41,0x00,0x00,0x00,
+    0x00,0x00,0x00,0x00,0x01,0x00,0x00,0x00,0x02,0x00,0x00,0x00,0x7f,0x00,0x04,0x00,
+    0x03,0x00,0x00,0x00,0x43,0x00,0x00,0x00,0x34,0x00,0x00,0x00,0x50,0x00,0x05,0x00,
+    0x04,0x00,0x00,0x00,0x44,0x00,0x00,0x00,0x43,0x00,0x00,0x00,0x38,0x00,0x00,0x00,
+    0x81,0x00,0x05,0x00,0x04,0x00,0x00,0x00,0x45,0x00,0x00,0x00,0x2c,0x00,0x00,0x00,
+    0x44,0x00,0x00,0x00,0x57,0x00,0x05,0x00,0x06,0x00,0x00,0x00,0x46,0x00,0x00,0x00,
+    0x1a,0x00,0x00,0x00,0x45,0x00,0x00,0x00,0x4f,0x00,0x08,0x00,0x05,0x00,0x00,0x00,
+    0x47,0x00,0x00,0x00,0x46,0x00,0x00,0x00,0x46,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+    0x01,0x00,0x00,0x00,0x02,0x00,0x00,0x00,0x7f,0x00,0x04,0x00,0x03,0x00,0x00,0x00,
+    0x48,0x00,0x00,0x00,0x37,0x00,0x00,0x00,0x50,0x00,0x05,0x00,0x04,0x00,0x00,0x00,
+    0x49,0x00,0x00,0x00,0x38,0x00,0x00,0x00,0x48,0x00,0x00,0x00,0x81,0x00,0x05,0x00,
+    0x04,0x00,0x00,0x00,0x4a,0x00,0x00,0x00,0x2c,0x00,0x00,0x00,0x49,0x00,0x00,0x00,
+    0x57,0x00,0x05,0x00,0x06,0x00,0x00,0x00,0x4b,0x00,0x00,0x00,0x1a,0x00,0x00,0x00,
+    0x4a,0x00,0x00,0x00,0x4f,0x00,0x08,0x00,0x05,0x00,0x00,0x00,0x4c,0x00,0x00,0x00,
+    0x4b,0x00,0x00,0x00,0x4b,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x01,0x00,0x00,0x00,
+    0x02,0x00,0x00,0x00,0x51,0x00,0x05,0x00,0x03,0x00,0x00,0x00,0x4e,0x00,0x00,0x00,
+    0x22,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x83,0x00,0x05,0x00,0x05,0x00,0x00,0x00,
+    0x4f,0x00,0x00,0x00,0x3e,0x00,0x00,0x00,0x42,0x00,0x00,0x00,0x0c,0x00,0x06,0x00,
+    0x05,0x00,0x00,0x00,0x50,0x00,0x00,0x00,0x01,0x00,0x00,0x00,0x04,0x00,0x00,0x00,
+    0x4f,0x00,0x00,0x00,0x94,0x00,0x05,0x00,0x03,0x00,0x00,0x00,0x51,0x00,0x00,0x00,
+    0x50,0x00,0x00,0x00,0x4d,0x00,0x00,0x00,0x0c,0x00,0x07,0x00,0x03,0x00,0x00,0x00,
+    0x52,0x00,0x00,0x00,0x01,0x00,0x00,0x00,0x30,0x00,0x00,0x00,0x51,0x00,0x00,0x00,
+    0x4e,0x00,0x00,0x00,0x83,0x00,0x05,0x00,0x05,0x00,0x00,0x00,0x53,0x00,0x00,0x00,
+    0x42,0x00,0x00,0x00,0x47,0x00,0x00,0x00,0x0c,0x00,0x06,0x00,0x05,0x00,0x00,0x00,
+    0x54,0x00,0x00,0x00,0x01,0x00,0x00,0x00,0x04,0x00,0x00,0x00,0x53,0x00,0x00,0x00,
+    0x94,0x00,0x05,0x00,0x03,0x00,0x00,0x00,0x55,0x00,0x00,0x00,0x54,0x00,0x00,0x00,
+    0x4d,0x00,0x00,0x00,0x0c,0x00,0x07,0x00,0x03,0x00,0x00,0x00,0x56,0x00,0x00,0x00,
+    0x01,0x00,0x00,0x00,0x30,0x00,0x00,0x00,0x55,0x00,0x00,0x00,0x4e,0x00,0x00,0x00,
+    0x83,0x00,0x05,0x00,0x03,0x00,0x00,0x00,0x57,0x00,0x00,0x00,0x2f,0x00,0x00,0x00,
+    0x56,0x00,0x00,0x00,0x83,0x00,0x05,0x00,0x05,0x00,0x00,0x00,0x58,0x00,0x00,0x00,
+    0x3e,0x00,0x00,0x00,0x4c,0x00,0x00,0x00,0x0c,0x00,0x06,0x00,0x05,0x00,0x00,0x00,
+    0x59,0x00,0x00,0x00,0x01,0x00,0x00,0x00,0x04,0x00,0x00,0x00,0x58,0x00,0x00,0x00,
+    0x94,0x00,0x05,0x00,0x03,0x00,0x00,0x00,0x5a,0x00,0x00,0x00,0x59,0x00,0x00,0x00,
+    0x4d,0x00,0x00,0x00,0x0c,0x00,0x07,0x00,0x03,0x00,0x00,0x00,0x5b,0x00,0x00,0x00,
+    0x01,0x00,0x00,0x00,0x30,0x00,0x00,0x00,0x5a,0x00,0x00,0x00,0x4e,0x00,0x00,0x00,
+    0x83,0x00,0x05,0x00,0x03,0x00,0x00,0x00,0x5c,0x00,0x00,0x00,0x2f,0x00,0x00,0x00,
+    0x5b,0x00,0x00,0x00,0x85,0x00,0x05,0x00,0x03,0x00,0x00,0x00,0x5d,0x00,0x00,0x00,
+    0x57,0x00,0x00,0x00,0x5c,0x00,0x00,0x00,0x85,0x00,0x05,0x00,0x03,0x00,0x00,0x00,
+    0x5e,0x00,0x00,0x00,0x52,0x00,0x00,0x00,0x5d,0x00,0x00,0x00,0x50,0x00,0x06,0x00,
+    0x05,0x00,0x00,0x00,0x5f,0x00,0x00,0x00,0x5e,0x00,0x00,0x00,0x5e,0x00,0x00,0x00,
+    0x5e,0x00,0x00,0x00,0x0c,0x00,0x08,0x00,0x05,0x00,0x00,0x00,0x60,0x00,0x00,0x00,
+    0x01,0x00,0x00,0x00,0x2e,0x00,0x00,0x00,0x3a,0x00,0x00,0x00,0x3e,0x00,0x00,0x00,
+    0x5f,0x00,0x00,0x00,0x51,0x00,0x05,0x00,0x03,0x00,0x00,0x00,0x61,0x00,0x00,0x00,
+    0x60,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x51,0x00,0x05,0x00,0x03,0x00,0x00,0x00,
+    0x62,0x00,0x00,0x00,0x60,0x00,0x00,0x00,0x01,0x00,0x00,0x00,0x51,0x00,0x05,0x00,
+    0x03,0x00,0x00,0x00,0x63,0x00,0x00,0x00,0x60,0x00,0x00,0x00,0x02,0x00,0x00,0x00,
+    0x50,0x00,0x07,0x00,0x06,0x00,0x00,0x00,0x64,0x00,0x00,0x00,0x61,0x00,0x00,0x00,
+    0x62,0x00,0x00,0x00,0x63,0x00,0x00,0x00,0x2f,0x00,0x00,0x00,0x3e,0x00,0x03,0x00,
+    0x09,0x00,0x00,0x00,0x64,0x00,0x00,0x00,0xfd,0x00,0x01,0x00,0x38,0x00,0x01,0x00,
+};
+
+
+static const char _post_vs_source_metal[] =
+    "#include <metal_stdlib>\n"
+    "using namespace metal;\n"
+    "struct vs_in { float2 position [[attribute(0)]]; };\n"
+    "struct vs_out { float4 pos [[position]]; float2 uv [[user(locn0)]]; };\n"
+    "vertex vs_out main0(vs_in in [[stage_in]]) {\n"
+    "    vs_out out;\n"
+    "    out.pos = float4(in.position, 0.5, 1.0);\n"
+    "    out.uv = in.position * float2(0.5, -0.5) + 0.5;\n"
+    "    return out;\n"
+    "}\n";
+
+#define POST_FS_METAL_HEADER \
+    "#include <metal_stdlib>\n" \
+    "using namespace metal;\n" \
+    "struct fs_params { float4 src_size; float4 out_size; float4 params; };\n" \
+    "struct fs_in { float2 uv [[user(locn0)]]; };\n" \
+    "#define SRC(p) src_tex.sample(smp, p).rgb\n"
+
+#define POST_FS_METAL_MAIN \
+    "fragment float4 main0(fs_in in [[stage_in]],\n" \
+    "                      constant fs_params& u [[buffer(0)]],\n" \
+    "                      texture2d<float> src_tex [[texture(0)]],\n" \
+    "                      sampler smp [[sampler(0)]]) {\n"
+
+static const char _scanlines_fs_source_metal[] =
+    POST_FS_METAL_HEADER
+    POST_FS_METAL_MAIN
+    "    float d = fract(in.uv.y * u.src_size.y) * 2.0 - 1.0;\n"
+    "    return float4(SRC(in.uv) * (1.0 - u.params.x * d * d), 1.0);\n"
+    "}\n";
+
+static const char _crt_fs_source_metal[] =
+    POST_FS_METAL_HEADER
+    POST_FS_METAL_MAIN
+    "    float2 cc = in.uv * 2.0 - 1.0;\n"
+    "    cc *= 1.0 + cc.yx * cc.yx * u.params.y;\n"
+    "    float2 st = cc * 0.5 + 0.5;\n"
+    "    float2 inside = step(float2(0.0), st) * step(st, float2(1.0));\n"
+    "    float d = fract(st.y * u.src_size.y) * 2.0 - 1.0;\n"
+    "    float3 c = SRC(st) * (1.0 - u.params.x * d * d);\n"
+    "    float g = fract(in.uv.x * u.out_size.x / 3.0) * 3.0;\n"
+    "    float3 tri = clamp(1.0 - abs(float3(g) - float3(0.5, 1.5, 2.5)), 0.0, 1.0);\n"
+    "    c *= float3(1.0 - u.params.z) + tri * (u.params.z * 3.0);\n"
+    "    float v = 16.0 * st.x * st.y * (1.0 - st.x) * (1.0 - st.y);\n"
+    "    c *= pow(clamp(v, 0.0001, 1.0), u.params.w) * inside.x * inside.y;\n"
+    "    return float4(c, 1.0);\n"
+    "}\n";
+
+static const char _scale2x_fs_source_metal[] =
+    POST_FS_METAL_HEADER
+    POST_FS_METAL_MAIN
+    "    float tol = u.params.x;\n"
+    "    float2 p = in.uv * u.src_size.xy;\n"
+    "    float2 q = step(float2(0.5), fract(p));\n"
+    "    float2 base = (floor(p) + 0.5) * u.src_size.zw;\n"
+    "    float2 d = q * 2.0 - 1.0;\n"
+    "    float dx = d.x * u.src_size.z;\n"
+    "    float dy = d.y * u.src_size.w;\n"
+    "    float3 e = SRC(base);\n"
+    "    float3 h = SRC(base + float2(dx, 0.0));\n"
+    "    float3 v = SRC(base + float2(0.0, dy));\n"
+    "    float3 ho = SRC(base + float2(-dx, 0.0));\n"
+    "    float3 vo = SRC(base + float2(0.0, -dy));\n"
+    "    float hv = step(dot(abs(h - v), float3(1.0)), tol);\n"
+    "    float vho = step(dot(abs(v - ho), float3(1.0)), tol);\n"
+    "    float hvo = step(dot(abs(h - vo), float3(1.0)), tol);\n"
+    "    float sel = hv * ((1.0 - vho) * (1.0 - hvo));\n"
+    "    return float4(mix(e, h, float3(sel)), 1.0);\n"
+    "}\n";
+
+struct PostShaderSource {
+    sg_range fs_bytecode;
+    const char* fs_metal;
+    const char* label;
+};
+
+static PostShaderSource postShaderSource(PostProcessor::Effect effect) {
+    switch (effect) {
+        case PostProcessor::Effect::CRT:
+            return { SG_RANGE(_crt_fs_bytecode_spirv), _crt_fs_source_metal, "nes-post-crt-shader" };
+        case PostProcessor::Effect::SCALE2X:
+            return { SG_RANGE(_scale2x_fs_bytecode_spirv), _scale2x_fs_source_metal, "nes-post-scale2x-shader" };
+        default:
+            return { SG_RANGE(_scanlines_fs_bytecode_spirv), _scanlines_fs_source_metal, "nes-post-scanlines-shader" };
+    }
+}
+
+static bool postShaderDesc(sg_shader_desc& desc, PostProcessor::Effect effect) {
+    desc = {};
+    PostShaderSource source = postShaderSource(effect);
+    switch (sg_query_backend()) {
+        case SG_BACKEND_VULKAN:
+            desc.vertex_func.bytecode = SG_RANGE(_post_vs_bytecode_spirv);
+            desc.vertex_func.entry = "main";
+            desc.fragment_func.bytecode = source.fs_bytecode;
+            desc.fragment_func.entry = "main";
+            break;
+        case SG_BACKEND_METAL_MACOS:
+        case SG_BACKEND_METAL_IOS:
+        case SG_BACKEND_METAL_SIMULATOR:
+            desc.vertex_func.source = _post_vs_source_metal;
+            desc.vertex_func.entry = "main0";
+            desc.fragment_func.source = source.fs_metal;
+            desc.fragment_func.entry = "main0";
+            break;
+        default:
+            return false;
+    }
+
+    desc.attrs[0].base_type = SG_SHADERATTRBASETYPE_FLOAT;
+    desc.uniform_blocks[0].stage = SG_SHADERSTAGE_FRAGMENT;
+    desc.uniform_blocks[0].size = 48;
+    desc.uniform_blocks[0].msl_buffer_n = 0;
+    desc.uniform_blocks[0].spirv_set0_binding_n = 0;
+    desc.views[0].texture.stage = SG_SHADERSTAGE_FRAGMENT;
+    desc.views[0].texture.image_type = SG_IMAGETYPE_2D;
+    desc.views[0].texture.sample_type = SG_IMAGESAMPLETYPE_FLOAT;
+    desc.views[0].texture.msl_texture_n = 0;
+    desc.views[0].texture.spirv_set1_binding_n = 0;
+    desc.samplers[0].stage = SG_SHADERSTAGE_FRAGMENT;
+    desc.samplers[0].sampler_type = SG_SAMPLERTYPE_FILTERING;
+    desc.samplers[0].msl_sampler_n = 0;
+    desc.samplers[0].spirv_set1_binding_n = 32;
+    desc.texture_sampler_pairs[0].stage = SG_SHADERSTAGE_FRAGMENT;
+    desc.texture_sampler_pairs[0].view_slot = 0;
+    desc.texture_sampler_pairs[0].sampler_slot = 0;
+    desc.label = source.label;
+    return true;
+}
+
+PostProcessor::Pass PostProcessor::defaultPass(Effect effect) {
+    Pass pass;
+    pass.effect = effect;
+    switch (effect) {
+        case Effect::SCANLINES:
+            pass.scale = 3;
+            pass.params[0] = 0.5f;
+            break;
+        case Effect::CRT:
+            pass.scale = 3;
+            pass.params[0] = 0.4f;   // scanlines
+            pass.params[1] = 0.04f;  // curvature
+            pass.params[2] = 0.3f;   // phosphor mask
+            pass.params[3] = 0.25f;  // vignette
+            break;
+        case Effect::SCALE2X:
+        case Effect::COUNT:
+            pass.scale = 2;
+            pass.params[0] = 0.0f;   // exact color match
+            break;
+    }
+    return pass;
+}
+
+const char* PostProcessor::effectName(Effect effect) {
+    switch (effect) {
+        case Effect::SCANLINES: return "Scanlines";
+        case Effect::CRT:       return "CRT";
+        case Effect::SCALE2X:   return "Scale2x";
+        case Effect::COUNT:     break;
+    }
+    return "?";
+}
+
+bool PostProcessor::init() {
+    if (valid_) return true;
+
+    valid_ = true;
+    for (int i = 0; i < static_cast<int>(Effect::COUNT); ++i) {
+        sg_shader_desc shd_desc;
+        if (!postShaderDesc(shd_desc, static_cast<Effect>(i))) {
+            valid_ = false;
+            break;
+        }
+        shaders_[i] = sg_make_shader(&shd_desc);
+
+        sg_pipeline_desc pip_desc = {};
+        pip_desc.shader = shaders_[i];
+        pip_desc.layout.attrs[0].format = SG_VERTEXFORMAT_FLOAT2;
+        pip_desc.depth.pixel_format = SG_PIXELFORMAT_NONE;
+        pip_desc.colors[0].pixel_format = SG_PIXELFORMAT_RGBA8;
+        pip_desc.sample_count = 1;
+        pip_desc.label = "nes-post-pipeline";
+        pipelines_[i] = sg_make_pipeline(&pip_desc);
+        valid_ = valid_ && sg_query_pipeline_state(pipelines_[i]) == SG_RESOURCESTATE_VALID;
+    }
+    if (!valid_) {
+        shutdown();
+        return false;
+    }
+
+    // Same oversized triangle as PaletteRenderer
+    const float tri[] = { -1.0f, 1.0f,  3.0f, 1.0f,  -1.0f, -3.0f };
+    sg_buffer_desc buf_desc = {};
+    buf_desc.data = SG_RANGE(tri);
+    buf_desc.label = "nes-post-triangle";
+    vertices_ = sg_make_buffer(&buf_desc);
+
+    sg_sampler_desc smp_desc = {};
+    smp_desc.min_filter = SG_FILTER_NEAREST;
+    smp_desc.mag_filter = SG_FILTER_NEAREST;
+    smp_desc.wrap_u = SG_WRAP_CLAMP_TO_EDGE;
+    smp_desc.wrap_v = SG_WRAP_CLAMP_TO_EDGE;
+    nearest_sampler_ = sg_make_sampler(&smp_desc);
+    smp_desc.min_filter = SG_FILTER_LINEAR;
+    smp_desc.mag_filter = SG_FILTER_LINEAR;
+    linear_sampler_ = sg_make_sampler(&smp_desc);
+    return true;
+}
+
+void PostProcessor::shutdown() {
+    for (Target& target : targets_) {
+        destroyTarget(target);
+    }
+    for (int i = 0; i < static_cast<int>(Effect::COUNT); ++i) {
+        sg_destroy_pipeline(pipelines_[i]);
+        sg_destroy_shader(shaders_[i]);
+        pipelines_[i] = {};
+        shaders_[i] = {};
+    }
+    sg_destroy_sampler(linear_sampler_);
+    sg_destroy_sampler(nearest_sampler_);
+    sg_destroy_buffer(vertices_);
+    linear_sampler_ = {};
+    nearest_sampler_ = {};
+    vertices_ = {};
+    valid_ = false;
+}
+
+void PostProcessor::setChain(const Pass* passes, int count) {
+    pass_count_ = std::clamp(count, 0, MAX_PASSES);
+    for (int i = 0; i < pass_count_; ++i) {
+        passes_[i] = passes[i];
+        passes_[i].scale = passes[i].effect == Effect::SCALE2X ? 2 : std::clamp(passes[i].scale, 1, MAX_SCALE);
+    }
+}
+
+bool PostProcessor::ensureTarget(Target& target, int width, int height) {
+    if (target.width == width && target.height == height) return true;
+    destroyTarget(target);
+
+    sg_image_desc desc = {};
+    desc.width = width;
+    desc.height = height;
+    desc.pixel_format = SG_PIXELFORMAT_RGBA8;
+    desc.sample_count = 1;
+    desc.usage.color_attachment = true;
+    desc.label = "nes-post-target";
+    target.image = MakeGpuImage(&desc);
+    if (sg_query_image_state(target.image) != SG_RESOURCESTATE_VALID) {
+        destroyTarget(target);
+        return false;
+    }
+
+    sg_view_desc view_desc = {};
+    view_desc.color_attachment.image = target.image;
+    target.attachment = sg_make_view(&view_desc);
+    view_desc = {};
+    view_desc.texture.image = target.image;
+    target.texture = sg_make_view(&view_desc);
+    target.width = width;
+    target.height = height;
+    return true;
+}
+
+void PostProcessor::destroyTarget(Target& target) {
+    sg_destroy_view(target.texture);
+    sg_destroy_view(target.attachment);
+    DestroyGpuImage(target.image);
+    target = Target();
+}
+
+void PostProcessor::render(sg_view source, int width, int height) {
+    if (!isActive()) return;
+
+    for (int i = 0; i < pass_count_; ++i) {
+        const Pass& pass = passes_[i];
+        int out_width = width * pass.scale;
+        int out_height = height * pass.scale;
+        Target& target = targets_[i];
+        if (!ensureTarget(target, out_width, out_height)) return;
+
+        Params params;
+        params.src_size[0] = static_cast<float>(width);
+        params.src_size[1] = static_cast<float>(height);
+        params.src_size[2] = 1.0f / width;
+        params.src_size[3] = 1.0f / height;
+        params.out_size[0] = static_cast<float>(out_width);
+        params.out_size[1] = static_cast<float>(out_height);
+        params.out_size[2] = 1.0f / out_width;
+        params.out_size[3] = 1.0f / out_height;
+        memcpy(params.params, pass.params, sizeof(params.params));
+
+        sg_pass gfx_pass = {};
+        gfx_pass.action.colors[0].load_action = SG_LOADACTION_DONTCARE;
+        gfx_pass.attachments.colors[0] = target.attachment;
+        gfx_pass.label = "nes-post-pass";
+        sg_begin_pass(&gfx_pass);
+        sg_apply_pipeline(pipelines_[static_cast<int>(pass.effect)]);
+        sg_bindings bind = {};
+        bind.vertex_buffers[0] = vertices_;
+        bind.views[0] = source;
+        // The CRT pass resamples through its curvature; the others read texel centers
+        bind.samplers[0] = pass.effect == Effect::CRT ? linear_sampler_ : nearest_sampler_;
+        sg_apply_bindings(&bind);
+        sg_apply_uniforms(0, SG_RANGE(params));
+        sg_draw(0, 3, 1);
+        sg_end_pass();
+
+        source = target.texture;
+        width = out_width;
+        height = out_height;
+    }
+}
+
+void PostProcessor::copy(sg_view source, int width, int height, sg_view attachment) {
+    if (!valid_) return;
+
+    // Scanlines with no darkening, read at texel centers, is an exact copy
+    Params params = {};
+    params.src_size[0] = params.out_size[0] = static_cast<float>(width);
+    params.src_size[1] = params.out_size[1] = static_cast<float>(height);
+    params.src_size[2] = params.out_size[2] = 1.0f / width;
+    params.src_size[3] = params.out_size[3] = 1.0f / height;
+
+    sg_pass gfx_pass = {};
+    gfx_pass.action.colors[0].load_action = SG_LOADACTION_DONTCARE;
+    gfx_pass.attachments.colors[0] = attachment;
+    gfx_pass.label = "nes-post-copy";
+    sg_begin_pass(&gfx_pass);
+    sg_apply_pipeline(pipelines_[static_cast<int>(Effect::SCANLINES)]);
+    sg_bindings bind = {};
+    bind.vertex_buffers[0] = vertices_;
+    bind.views[0] = source;
+    bind.samplers[0] = nearest_sampler_;
+    sg_apply_bindings(&bind);
+    sg_apply_uniforms(0, SG_RANGE(params));
+    sg_draw(0, 3, 1);
+    sg_end_pass();
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+#include "sokol_gfx.h"
+#include <cstdint>
+
+// Post-processing chain for the emulator picture. The screen texture goes
+// through up to MAX_PASSES fragment-shader passes (scanlines, a CRT look,
+// Scale2x edge upscaling), each drawing one triangle into its own offscreen
+// RGBA target at a multiple of its input size; ImGui shows the last target.
+// All per-pixel work is on the GPU, and the caller only re-runs the chain
+// when a new frame or new settings arrive.
+class PostProcessor {
+public:
+    enum class Effect : uint8_t {
+        SCANLINES,  // params: darkening between lines
+        CRT,        // params: scanlines, curvature, phosphor mask, vignette
+        SCALE2X,    // params: color match tolerance; always doubles
+        COUNT
+    };
+
+    static constexpr int MAX_PASSES = 4;
+    static constexpr int MAX_SCALE = 4;
+
+    struct Pass {
+        Effect effect = Effect::SCANLINES;
+        int scale = 3;          // output size in multiples of the pass input
+        float params[4] = {};
+    };
+
+    static Pass defaultPass(Effect effect);
+    static const char* effectName(Effect effect);
+
+    PostProcessor() = default;
+    ~PostProcessor() = default;
+
+    // Returns false if the active backend has no post shaders (the screen
+    // is then shown unfiltered)
+    bool init();
+    void shutdown();
+    bool isValid() const { return valid_; }
+
+    // Replace the chain; none turns filtering off. Targets follow on the
+    // next render().
+    void setChain(const Pass* passes, int count);
+    int passCount() const { return pass_count_; }
+    const Pass& pass(int index) const { return passes_[index]; }
+    bool isActive() const { return valid_ && pass_count_ > 0; }
+
+    // Run the chain over 'source' (width x height texels). Runs its own
+    // offscreen passes, so call outside the swapchain pass.
+    void render(sg_view source, int width, int height);
+
+    // Draw 'source' unfiltered into 'attachment', an RGBA8 color attachment
+    // of the same width x height. Also its own offscreen pass.
+    void copy(sg_view source, int width, int height, sg_view attachment);
+
+    // Last pass' target for simgui_imtextureid_with_sampler
+    sg_view outputView() const { return targets_[pass_count_ > 0 ? pass_count_ - 1 : 0].texture; }
+    sg_sampler sampler() const { return linear_sampler_; }
+
+private:
+    // std140 layout of the fragment shaders' uniform block
+    struct Params {
+        float src_size[4];  // width, height, 1 / width, 1 / height
+        float out_size[4];
+        float params[4];
+    };
+
+    struct Target {
+        sg_image image = {};
+        sg_view attachment = {};
+        sg_view texture = {};
+        int width = 0;
+        int height = 0;
+    };
+
+    bool ensureTarget(Target& target, int width, int height);
+    static void destroyTarget(Target& target);
+
+    bool valid_ = false;
+
+    sg_shader shaders_[static_cast<int>(Effect::COUNT)] = {};
+    sg_pipeline pipelines_[static_cast<int>(Effect::COUNT)] = {};
+    sg_buffer vertices_ = {};
+    sg_sampler nearest_sampler_ = {};
+    sg_sampler linear_sampler_ = {};
+
+    Pass passes_[MAX_PASSES];
+    int pass_count_ = 0;
+    Target targets_[MAX_PASSES];
+};
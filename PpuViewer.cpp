@@ -0,0 +1,330 @@
+#include "PpuViewer.h"
+#include "GpuMemory.h"
+#include "sokol_app.h"
+#include "imgui.h"
+#include "util/sokol_imgui.h"
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+// Top-left pixel of tile 0-511 in the pattern image
+inline int tileX(int tile) { return (tile >> 8) * 128 + (tile & 15) * 8; }
+inline int tileY(int tile) { return ((tile >> 4) & 15) * 8; }
+
+}  // namespace
+
+void PpuViewer::createTexture(Texture& texture, int width, int height, const char* label) {
+    sg_image_desc img_desc = {};
+    img_desc.width = width;
+    img_desc.height = height;
+    img_desc.pixel_format = SG_PIXELFORMAT_RGBA8;
+    img_desc.usage.dynamic_update = true;
+    img_desc.label = label;
+    texture.image = MakeGpuImage(&img_desc);
+
+    sg_view_desc view_desc = {};
+    view_desc.texture.image = texture.image;
+    texture.view = sg_make_view(&view_desc);
+    texture.width = width;
+    texture.height = height;
+    texture.dirty = true;
+}
+
+void PpuViewer::createTextures() {
+    if (created_) return;
+    createTexture(pattern_tex_, PATTERN_WIDTH, PATTERN_HEIGHT, "ppu-patterns");
+    createTexture(nametable_tex_, NAMETABLE_WIDTH, NAMETABLE_HEIGHT, "ppu-nametables");
+    createTexture(oam_tex_, OAM_WIDTH, OAM_HEIGHT, "ppu-oam");
+    createTexture(palette_tex_, PALETTE_WIDTH, PALETTE_HEIGHT, "ppu-palette");
+
+    sg_sampler_desc smp_desc = {};
+    smp_desc.min_filter = SG_FILTER_NEAREST;
+    smp_desc.mag_filter = SG_FILTER_NEAREST;
+    smp_desc.wrap_u = SG_WRAP_CLAMP_TO_EDGE;
+    smp_desc.wrap_v = SG_WRAP_CLAMP_TO_EDGE;
+    sampler_ = sg_make_sampler(&smp_desc);
+
+    created_ = true;
+    first_ = true;
+}
+
+void PpuViewer::destroyTextures() {
+    if (!created_) return;
+    for (Texture* texture : {&pattern_tex_, &nametable_tex_, &oam_tex_, &palette_tex_}) {
+        sg_destroy_view(texture->view);
+        DestroyGpuImage(texture->image);
+        *texture = Texture();
+    }
+    sg_destroy_sampler(sampler_);
+    created_ = false;
+}
+
+void PpuViewer::upload(Texture& texture, const uint32_t* pixels) {
+    // Dynamic images take one update per frame; each has a single writer here
+    if (!texture.dirty) return;
+    sg_image_data data = {};
+    data.mip_levels[0].ptr = pixels;
+    data.mip_levels[0].size = static_cast<size_t>(texture.width) * texture.height * sizeof(uint32_t);
+    sg_update_image(texture.image, &data);
+    texture.dirty = false;
+}
+
+uint32_t PpuViewer::color(int palette_entry) const {
+    return rgba_[ppu_.palette[palette_entry & 31] & 0x3f];
+}
+
+void PpuViewer::copyTile(int tile) {
+    // Already decoded by the emulator's tile cache
+    uint8_t* out = pattern_index_ + tileY(tile) * PATTERN_WIDTH + tileX(tile);
+    for (int y = 0; y < 8; ++y) {
+        memcpy(out + y * PATTERN_WIDTH, ppu_.tiles[tile] + y * 8, 8);
+    }
+}
+
+void PpuViewer::drawPatterns(bool all) {
+    uint32_t colors[4];
+    for (int v = 0; v < 4; ++v) {
+        colors[v] = color(v ? pattern_palette_ * 4 + v : 0);
+    }
+    for (int tile = 0; tile < 512; ++tile) {
+        if (!all && !(ppu_.dirty.tiles[tile >> 6] & (uint64_t(1) << (tile & 63)))) continue;
+        int origin = tileY(tile) * PATTERN_WIDTH + tileX(tile);
+        for (int y = 0; y < 8; ++y) {
+            const uint8_t* in = pattern_index_ + origin + y * PATTERN_WIDTH;
+            uint32_t* out = pattern_pixels_ + origin + y * PATTERN_WIDTH;
+            for (int x = 0; x < 8; ++x) {
+                out[x] = colors[in[x]];
+            }
+        }
+    }
+    pattern_tex_.dirty = true;
+}
+
+void PpuViewer::drawNametableCell(int nametable, int cx, int cy) {
+    const uint8_t* nt = ppu_.nametables + nametable * 0x400;
+    int tile = (ppu_.info.bg_table >> 4) + nt[cy * 32 + cx];
+    int attr = nt[0x3C0 + (cy >> 2) * 8 + (cx >> 2)];
+    int group = (attr >> (((cy & 2) << 1) | (cx & 2))) & 3;
+    uint32_t colors[4];
+    for (int v = 0; v < 4; ++v) {
+        colors[v] = color(v ? group * 4 + v : 0);
+    }
+
+    const uint8_t* in = pattern_index_ + tileY(tile) * PATTERN_WIDTH + tileX(tile);
+    uint32_t* out = nametable_pixels_ + ((nametable >> 1) * 240 + cy * 8) * NAMETABLE_WIDTH
+                    + (nametable & 1) * 256 + cx * 8;
+    for (int y = 0; y < 8; ++y) {
+        for (int x = 0; x < 8; ++x) {
+            out[y * NAMETABLE_WIDTH + x] = colors[in[y * PATTERN_WIDTH + x]];
+        }
+    }
+}
+
+void PpuViewer::drawNametables(bool all, const bool* tile_changed) {
+    uint64_t cells = 0;
+    for (int n = 0; n < 4; ++n) {
+        bool nt_changed = all || (ppu_.dirty.nametables & (1 << n));
+        const uint8_t* nt = ppu_.nametables + n * 0x400;
+        const uint8_t* drawn = drawn_nametables_ + n * 0x400;
+        for (int cy = 0; cy < 30; ++cy) {
+            for (int cx = 0; cx < 32; ++cx) {
+                int tile = (ppu_.info.bg_table >> 4) + nt[cy * 32 + cx];
+                bool redraw = all || tile_changed[tile];
+                if (!redraw && nt_changed) {
+                    int attr_ix = 0x3C0 + (cy >> 2) * 8 + (cx >> 2);
+                    redraw = nt[cy * 32 + cx] != drawn[cy * 32 + cx] || nt[attr_ix] != drawn[attr_ix];
+                }
+                if (redraw) {
+                    drawNametableCell(n, cx, cy);
+                    cells++;
+                }
+            }
+        }
+    }
+    if (cells) nametable_tex_.dirty = true;
+    memcpy(drawn_nametables_, ppu_.nametables, sizeof(drawn_nametables_));
+    updated_cells_ = cells;
+}
+
+void PpuViewer::drawSprites() {
+    std::fill(std::begin(oam_pixels_), std::end(oam_pixels_), 0u);
+    for (int i = 0; i < 64; ++i) {
+        const uint8_t* sprite = ppu_.oam + i * 4;
+        int attr = sprite[2];
+        int tiles[2];
+        int rows = ppu_.info.sprites_8x16 ? 2 : 1;
+        if (ppu_.info.sprites_8x16) {
+            tiles[0] = (sprite[1] & 1) * 256 + (sprite[1] & 0xFE);
+            tiles[1] = tiles[0] + 1;
+        } else {
+            tiles[0] = (ppu_.info.sprite_table >> 4) + sprite[1];
+        }
+        uint32_t colors[4] = {0, color(16 + (attr & 3) * 4 + 1), color(16 + (attr & 3) * 4 + 2),
+                              color(16 + (attr & 3) * 4 + 3)};
+
+        uint32_t* out = oam_pixels_ + (i >> 3) * 16 * OAM_WIDTH + (i & 7) * 8;
+        int height = rows * 8;
+        for (int y = 0; y < height; ++y) {
+            int sy = (attr & 0x80) ? height - 1 - y : y;  // vertical flip swaps the halves too
+            const uint8_t* in = pattern_index_ + (tileY(tiles[sy >> 3]) + (sy & 7)) * PATTERN_WIDTH
+                                + tileX(tiles[sy >> 3]);
+            for (int x = 0; x < 8; ++x) {
+                out[y * OAM_WIDTH + x] = colors[in[(attr & 0x40) ? 7 - x : x]];
+            }
+        }
+    }
+    memcpy(drawn_oam_, ppu_.oam, sizeof(drawn_oam_));
+    drawn_info_ = ppu_.info;
+    oam_tex_.dirty = true;
+}
+
+void PpuViewer::drawPalette() {
+    for (int i = 0; i < 32; ++i) {
+        // Entries 0 of each group mirror the backdrop when rendered; show what's stored
+        palette_pixels_[i] = color(i);
+    }
+    palette_tex_.dirty = true;
+}
+
+void PpuViewer::update(NesEmulator& emu) {
+    if (!emu.readPpuDebug(ppu_)) return;
+    rgba_ = emu.paletteRgba();
+
+    agnes_ppu_dirty_t& dirty = ppu_.dirty;
+    // A new screen palette recolors everything, like a PPU palette write
+    if (memcmp(rgba_, drawn_rgba_, sizeof(drawn_rgba_)) != 0) {
+        memcpy(drawn_rgba_, rgba_, sizeof(drawn_rgba_));
+        dirty.palette = true;
+    }
+    bool all = first_;
+    bool tile_changed[512] = {};
+    bool any_tile = false;
+    for (int tile = 0; tile < 512; ++tile) {
+        if (dirty.tiles[tile >> 6] & (uint64_t(1) << (tile & 63))) {
+            copyTile(tile);
+            tile_changed[tile] = any_tile = true;
+        }
+    }
+
+    if (all || dirty.palette) drawPalette();
+    if (all || dirty.palette || any_tile) drawPatterns(all || dirty.palette);
+
+    bool nt_all = all || dirty.palette || ppu_.info.bg_table != drawn_bg_table_;
+    if (nt_all || any_tile || dirty.nametables) {
+        drawNametables(nt_all, tile_changed);
+        drawn_bg_table_ = ppu_.info.bg_table;
+    } else {
+        updated_cells_ = 0;
+    }
+
+    bool sprites_changed = memcmp(ppu_.oam, drawn_oam_, sizeof(drawn_oam_)) != 0 ||
+                           ppu_.info.sprites_8x16 != drawn_info_.sprites_8x16 ||
+                           ppu_.info.sprite_table != drawn_info_.sprite_table;
+    if (all || dirty.palette || any_tile || sprites_changed) drawSprites();
+
+    dirty = agnes_ppu_dirty_t();
+    first_ = false;
+}
+
+void PpuViewer::image(const Texture& texture, float scale) {
+    ImGui::Image(simgui_imtextureid_with_sampler(texture.view, sampler_),
+                 ImVec2(texture.width * scale, texture.height * scale));
+}
+
+void PpuViewer::drawWindow(NesEmulator& emu, bool* p_open) {
+    ImGui::SetNextWindowSize(ImVec2(560, 600), ImGuiCond_FirstUseEver);
+    if (!ImGui::Begin("PPU Viewer", p_open)) {
+        ImGui::End();
+        return;
+    }
+    if (!emu.isLoaded()) {
+        ImGui::TextDisabled("No ROM loaded");
+        ImGui::End();
+        return;
+    }
+
+    createTextures();
+    update(emu);
+    upload(pattern_tex_, pattern_pixels_);
+    upload(nametable_tex_, nametable_pixels_);
+    upload(oam_tex_, oam_pixels_);
+    upload(palette_tex_, palette_pixels_);
+
+    ImGui::SetNextItemWidth(120);
+    ImGui::SliderFloat("Zoom", &zoom_, 1.0f, 3.0f, "%.1fx");
+
+    if (ImGui::BeginTabBar("ppu_tabs")) {
+        if (ImGui::BeginTabItem("Nametables")) {
+            ImGui::Checkbox("Scroll window", &show_scroll_);
+            ImGui::SameLine();
+            ImGui::TextDisabled("scroll %d,%d  bg $%04X  %llu cells redrawn", ppu_.info.scroll_x,
+                                ppu_.info.scroll_y, ppu_.info.bg_table,
+                                static_cast<unsigned long long>(updated_cells_));
+            float scale = zoom_;
+            ImVec2 origin = ImGui::GetCursorScreenPos();
+            image(nametable_tex_, scale);
+            if (show_scroll_) {
+                // The 256x240 viewport, wrapping around the 512x480 map
+                ImDrawList* draw_list = ImGui::GetWindowDrawList();
+                draw_list->PushClipRect(origin, ImVec2(origin.x + NAMETABLE_WIDTH * scale,
+                                                       origin.y + NAMETABLE_HEIGHT * scale), true);
+                for (int wx = 0; wx < 2; ++wx) {
+                    for (int wy = 0; wy < 2; ++wy) {
+                        float x = origin.x + (ppu_.info.scroll_x - wx * NAMETABLE_WIDTH) * scale;
+                        float y = origin.y + (ppu_.info.scroll_y - wy * NAMETABLE_HEIGHT) * scale;
+                        draw_list->AddRect(ImVec2(x, y), ImVec2(x + 256 * scale, y + 240 * scale),
+                                           IM_COL32(255, 60, 60, 255), 0.0f, 0, 2.0f);
+                    }
+                }
+                draw_list->PopClipRect();
+            }
+            ImGui::EndTabItem();
+        }
+        if (ImGui::BeginTabItem("Patterns")) {
+            ImGui::SetNextItemWidth(120);
+            if (ImGui::SliderInt("Palette", &pattern_palette_, 0, 7)) {
+                drawPatterns(true);  // uploaded next frame
+            }
+            image(pattern_tex_, zoom_ * 2.0f);
+            if (ImGui::IsItemHovered()) {
+                ImVec2 min = ImGui::GetItemRectMin();
+                ImVec2 mouse = ImGui::GetMousePos();
+                int px = static_cast<int>((mouse.x - min.x) / (zoom_ * 2.0f));
+                int py = static_cast<int>((mouse.y - min.y) / (zoom_ * 2.0f));
+                int tile = (px / 128) * 256 + (py / 8) * 16 + (px % 128) / 8;
+                ImGui::SetTooltip("$%04X  tile $%02X", tile * 16, tile & 255);
+            }
+            ImGui::EndTabItem();
+        }
+        if (ImGui::BeginTabItem("Sprites")) {
+            ImGui::TextDisabled("%s, table $%04X", ppu_.info.sprites_8x16 ? "8x16" : "8x8",
+                                ppu_.info.sprite_table);
+            float scale = zoom_ * 3.0f;
+            image(oam_tex_, scale);
+            if (ImGui::IsItemHovered()) {
+                ImVec2 min = ImGui::GetItemRectMin();
+                ImVec2 mouse = ImGui::GetMousePos();
+                int i = std::clamp(static_cast<int>((mouse.y - min.y) / (16 * scale)), 0, 7) * 8 +
+                        std::clamp(static_cast<int>((mouse.x - min.x) / (8 * scale)), 0, 7);
+                const uint8_t* sprite = ppu_.oam + i * 4;
+                ImGui::SetTooltip("#%d  x %d  y %d\ntile $%02X  attr $%02X", i, sprite[3], sprite[0],
+                                  sprite[1], sprite[2]);
+            }
+            ImGui::EndTabItem();
+        }
+        if (ImGui::BeginTabItem("Palette")) {
+            image(palette_tex_, zoom_ * 24.0f);
+            if (ImGui::IsItemHovered()) {
+                ImVec2 min = ImGui::GetItemRectMin();
+                ImVec2 mouse = ImGui::GetMousePos();
+                int i = std::clamp(static_cast<int>((mouse.y - min.y) / (zoom_ * 24.0f)), 0, 1) * 16 +
+                        std::clamp(static_cast<int>((mouse.x - min.x) / (zoom_ * 24.0f)), 0, 15);
+                ImGui::SetTooltip("$%04X = $%02X", 0x3F00 + i, ppu_.palette[i]);
+            }
+            ImGui::EndTabItem();
+        }
+        ImGui::EndTabBar();
+    }
+    ImGui::End();
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+#include "NesEmulator.h"
+#include "sokol_gfx.h"
+#include <cstdint>
+
+// Debug window for the NES PPU: the four nametables with the scroll window,
+// both pattern tables, the sprites in OAM and the palette, each drawn into
+// a small RGBA texture. The emulator reports which tiles, nametables and
+// palette entries changed (agnes_take_ppu_dirty), so an update copies the
+// decoded rows of just those tiles, redraws just the cells using them and
+// only uploads an image when something in it moved.
+class PpuViewer {
+public:
+    PpuViewer() = default;
+    ~PpuViewer() = default;
+
+    // Main thread, once per frame while the window is open
+    void drawWindow(NesEmulator& emu, bool* p_open);
+    void destroyTextures();
+
+private:
+    static constexpr int PATTERN_WIDTH = 256;   // both 128x128 tables side by side
+    static constexpr int PATTERN_HEIGHT = 128;
+    static constexpr int NAMETABLE_WIDTH = 512; // 2x2 nametables
+    static constexpr int NAMETABLE_HEIGHT = 480;
+    static constexpr int OAM_WIDTH = 64;        // 8x8 grid of 8x16 cells
+    static constexpr int OAM_HEIGHT = 128;
+    static constexpr int PALETTE_WIDTH = 16;    // background row, sprite row
+    static constexpr int PALETTE_HEIGHT = 2;
+
+    struct Texture {
+        sg_image image = {};
+        sg_view view = {};
+        int width = 0;
+        int height = 0;
+        bool dirty = true;          // pixels changed since the last upload
+    };
+
+    void createTextures();
+    static void createTexture(Texture& texture, int width, int height, const char* label);
+    static void upload(Texture& texture, const uint32_t* pixels);
+    void image(const Texture& texture, float scale);
+
+    void update(NesEmulator& emu);
+    uint32_t color(int palette_entry) const;
+    void copyTile(int tile);
+    void drawPatterns(bool all);
+    void drawNametableCell(int nametable, int cx, int cy);
+    void drawNametables(bool all, const bool* tile_changed);
+    void drawSprites();
+    void drawPalette();
+
+    bool created_ = false;
+    bool first_ = true;             // nothing drawn yet
+    Texture pattern_tex_;
+    Texture nametable_tex_;
+    Texture oam_tex_;
+    Texture palette_tex_;
+    sg_sampler sampler_ = {};
+
+    NesEmulator::PpuDebug ppu_ = {};
+    const uint32_t* rgba_ = nullptr;    // NES colors, from the emulator
+
+    // 2-bit pixels of all 512 tiles, laid out as in pattern_pixels_
+    uint8_t pattern_index_[PATTERN_WIDTH * PATTERN_HEIGHT] = {};
+    // What the nametable and sprite images were drawn from
+    uint8_t drawn_nametables_[0x1000] = {};
+    uint8_t drawn_oam_[256] = {};
+    uint32_t drawn_rgba_[64] = {};
+    uint16_t drawn_bg_table_ = 0;
+    agnes_ppu_info_t drawn_info_ = {};
+
+    uint32_t pattern_pixels_[PATTERN_WIDTH * PATTERN_HEIGHT] = {};
+    uint32_t nametable_pixels_[NAMETABLE_WIDTH * NAMETABLE_HEIGHT] = {};
+    uint32_t oam_pixels_[OAM_WIDTH * OAM_HEIGHT] = {};
+    uint32_t palette_pixels_[PALETTE_WIDTH * PALETTE_HEIGHT] = {};
+
+    int pattern_palette_ = 0;       // 0-7, which palette colors the pattern tables
+    bool show_scroll_ = true;
+    float zoom_ = 1.0f;
+    uint64_t updated_cells_ = 0;    // nametable cells redrawn by the last update
+};
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+
+// Decides on which display refresh each emulated frame goes on screen, so
+// every frame is held for about the same time whatever the display rate.
+// Frames carry their emulated time; a clock locked to it (a slow PLL that
+// absorbs the emulation thread's bursts and the audio clock's drift) gives
+// each one a due time. A fixed-rate display takes the newest frame on the
+// refresh nearest that time and repeats the one before until then, so 60 Hz
+// content on a 144 Hz screen gets an even 2-3-2-3 cadence instead of
+// whatever the publishing order happens to produce. With variable refresh
+// (G-Sync/FreeSync) the frame loop is held until the due time instead, and
+// the display refreshes once per emulated frame.
+//
+// Main thread only. A jump in emulated time (turbo, rewind, a loaded state,
+// a pause) drops the lock and the next frame is shown as soon as it arrives.
+class PresentScheduler {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    void setVariableRefresh(bool enabled) { variable_refresh_ = enabled; }
+    bool variableRefresh() const { return variable_refresh_; }
+
+    // Content frame period in seconds, for the first frames after a jump
+    void setFramePeriod(double seconds) { period_ = seconds; }
+
+    // At each rendered frame: whether a newer frame may replace the one on
+    // screen. 'ready' tells whether one is waiting, which dates its arrival.
+    bool due(Clock::time_point now, bool ready) {
+        if (last_refresh_ != Clock::time_point()) {
+            double interval = seconds(now - last_refresh_);
+            if (interval > 0.0 && interval < 0.1) refresh_ += 0.05 * (interval - refresh_);
+        }
+        last_refresh_ = now;
+        if (ready && ready_at_ == Clock::time_point()) ready_at_ = now;
+        if (!locked_) return true;
+        return seconds(now - anchor_) + refresh_ * 0.5 >= next_ - anchor_seconds_;
+    }
+
+    // A new frame with emulated time 'emulated' went on screen at 'now'.
+    // Returns its pacing error in seconds (display time minus due time), 0
+    // when it starts a new lock.
+    double shown(Clock::time_point now, double emulated) {
+        double step = emulated - last_emulated_;
+        last_emulated_ = emulated;
+        Clock::time_point arrived = ready_at_ == Clock::time_point() ? now : ready_at_;
+        ready_at_ = Clock::time_point();
+        double error = seconds(now - anchor_) - (emulated - anchor_seconds_);
+        if (!locked_ || step <= 0.0 || step > period_ * MAX_STEP || std::fabs(error) > period_ * MAX_STEP) {
+            anchor_ = now;
+            anchor_seconds_ = emulated;
+            next_ = emulated + period_;
+            locked_ = true;
+            return 0.0;
+        }
+        // The clock follows the frames' arrival, half a refresh behind so the
+        // thread's jitter rarely makes one late. A late one moves it at once,
+        // and so does a skipped one (the thread got ahead of it).
+        double lateness = seconds(arrived - anchor_) - (emulated - anchor_seconds_) + refresh_ * 0.5;
+        double shift = lateness * GAIN;
+        if (error > refresh_ * 0.5) shift = lateness;
+        if (error < -refresh_ * 0.5) shift = error;
+        anchor_ += std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(shift));
+        next_ = emulated + period_;
+        return error;
+    }
+
+    // When the next frame is due, for holding the frame loop with variable
+    // refresh; the past when nothing is locked
+    Clock::time_point nextDue() const {
+        if (!locked_) return Clock::time_point();
+        return anchor_ + std::chrono::duration_cast<Clock::duration>(
+            std::chrono::duration<double>(next_ - anchor_seconds_));
+    }
+
+    double refreshSeconds() const { return refresh_; }
+
+private:
+    static constexpr double MAX_STEP = 4.0;   // frame periods before the lock is dropped
+    static constexpr double GAIN = 0.02;
+
+    static double seconds(Clock::duration d) { return std::chrono::duration<double>(d).count(); }
+
+    bool variable_refresh_ = false;
+    bool locked_ = false;
+    double period_ = 1.0 / 60.0;
+    double refresh_ = 1.0 / 60.0;
+    Clock::time_point last_refresh_;
+    Clock::time_point anchor_;        // display time of emulated time anchor_seconds_
+    double anchor_seconds_ = 0.0;
+    double last_emulated_ = 0.0;
+    double next_ = 0.0;               // emulated time of the next frame expected
+    Clock::time_point ready_at_;      // when a newer frame was first seen waiting
+};
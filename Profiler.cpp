@@ -0,0 +1,604 @@
+#include "Profiler.h"
+#include <algorithm>
+#include <cfloat>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#ifndef NES_HEADLESS
+#include "FrameArena.h"
+#include "imgui.h"
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#endif
+
+#if defined(FC_TRACE_CHROME)
+#include <cstdio>
+#include <cstdlib>
+#endif
+
+std::atomic<bool> Profiler::enabled_{false};
+
+namespace {
+
+// One writer (the owning thread), one reader (the UI thread). The writer
+// never waits: if the reader falls a whole ring behind, the oldest samples
+// are lost.
+struct ThreadRing {
+    static constexpr uint64_t SIZE = 4096;  // power of two
+    static constexpr int STAGE_SHIFT = 56;
+    std::atomic<uint64_t> head{0};
+    std::atomic<uint64_t> samples[SIZE] = {};  // stage << STAGE_SHIFT | nanoseconds
+    std::atomic<uint32_t> allocations[SIZE] = {};  // heap allocations during the same sample
+    uint64_t read_pos = 0;                     // reader only
+};
+
+std::mutex rings_mutex;
+std::vector<std::unique_ptr<ThreadRing>> rings;  // kept for the process lifetime
+thread_local ThreadRing* thread_ring = nullptr;
+
+std::atomic<int64_t> budgets[Profiler::STAGE_COUNT] = {};
+
+struct StartupPhase {
+    const char* name;
+    int64_t nanoseconds;
+};
+
+constexpr int MAX_STARTUP_PHASES = 32;
+std::mutex startup_mutex;
+StartupPhase startup_phases[MAX_STARTUP_PHASES];
+int startup_count = 0;
+const int64_t process_start = Profiler::now();
+
+// Bumped by the replacement operator new below; constant-initialized, so it
+// is safe to touch from allocations made during static initialization
+thread_local uint64_t thread_allocations = 0;
+
+// Memory accounting, constant-initialized for the same reason. Relaxed
+// atomics throughout: the window only needs figures that settle.
+struct MemoryCounter {
+    std::atomic<int64_t> current{0};
+    std::atomic<int64_t> peak{0};
+    std::atomic<uint64_t> allocations{0};
+};
+constexpr int MEMORY_TAG_COUNT = static_cast<int>(MemoryTag::COUNT);
+MemoryCounter memory_counters[MEMORY_TAG_COUNT];
+thread_local MemoryTag memory_tag = MemoryTag::Other;
+
+thread_local const char* realtime_thread = nullptr;
+std::atomic<uint64_t> realtime_allocations{0};
+std::atomic<uint64_t> realtime_last_bytes{0};
+std::atomic<const char*> realtime_last_name{nullptr};
+
+void charge(MemoryTag tag, int64_t bytes, uint64_t allocations) {
+    MemoryCounter& counter = memory_counters[static_cast<int>(tag)];
+    if (allocations) counter.allocations.fetch_add(allocations, std::memory_order_relaxed);
+    int64_t current = counter.current.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+    int64_t peak = counter.peak.load(std::memory_order_relaxed);
+    while (current > peak && !counter.peak.compare_exchange_weak(peak, current, std::memory_order_relaxed)) {}
+}
+
+ThreadRing* threadRing() {
+    if (!thread_ring) {
+        std::lock_guard<std::mutex> lock(rings_mutex);
+        rings.push_back(std::make_unique<ThreadRing>());
+        thread_ring = rings.back().get();
+    }
+    return thread_ring;
+}
+
+} // namespace
+
+const char* Profiler::stageName(ProfileStage stage) {
+    switch (stage) {
+        case ProfileStage::GmePlay:       return "gme_play";
+        case ProfileStage::ProcessFFT:    return "processFFT";
+        case ProfileStage::NesFrame:      return "agnes_next_frame";
+        case ProfileStage::ScreenUpload:  return "updateScreenTexture";
+        case ProfileStage::PianoRoll:     return "drawPianoRoll";
+        case ProfileStage::CanvasSplice:  return "canvas splice";
+        case ProfileStage::ImGuiRender:   return "simgui_render";
+        case ProfileStage::AudioCallback: return "audio callback";
+        case ProfileStage::UiFrame:       return "frame";
+        case ProfileStage::FramePacing:   return "NES frame pacing error";
+        case ProfileStage::COUNT:         break;
+    }
+    return "?";
+}
+
+void Profiler::record(ProfileStage stage, int64_t nanoseconds, uint32_t allocations) {
+    ThreadRing* ring = threadRing();
+    uint64_t value = std::clamp<int64_t>(nanoseconds, 0, (int64_t(1) << ThreadRing::STAGE_SHIFT) - 1);
+    value |= static_cast<uint64_t>(stage) << ThreadRing::STAGE_SHIFT;
+    uint64_t head = ring->head.load(std::memory_order_relaxed);
+    ring->samples[head & (ThreadRing::SIZE - 1)].store(value, std::memory_order_relaxed);
+    ring->allocations[head & (ThreadRing::SIZE - 1)].store(allocations, std::memory_order_relaxed);
+    ring->head.store(head + 1, std::memory_order_release);
+}
+
+uint64_t Profiler::threadAllocations() {
+    return thread_allocations;
+}
+
+const char* Profiler::memoryTagName(MemoryTag tag) {
+    switch (tag) {
+        case MemoryTag::Other:       return "Other";
+        case MemoryTag::Analysis:    return "Analysis and histories";
+        case MemoryTag::Notes:       return "Piano-roll notes";
+        case MemoryTag::Emulation:   return "Emulators";
+        case MemoryTag::Savestates:  return "Rewind and save states";
+        case MemoryTag::Caches:      return "Caches";
+        case MemoryTag::ImGui:       return "ImGui";
+        case MemoryTag::GpuTextures: return "GPU images";
+        case MemoryTag::COUNT:       break;
+    }
+    return "?";
+}
+
+Profiler::MemoryUsage Profiler::memoryUsage(MemoryTag tag) {
+    const MemoryCounter& counter = memory_counters[static_cast<int>(tag)];
+    MemoryUsage usage;
+    usage.current = counter.current.load(std::memory_order_relaxed);
+    usage.peak = counter.peak.load(std::memory_order_relaxed);
+    usage.allocations = counter.allocations.load(std::memory_order_relaxed);
+    return usage;
+}
+
+void Profiler::trackMemory(MemoryTag tag, int64_t bytes, uint64_t allocations) {
+    charge(tag, bytes, allocations);
+}
+
+MemoryTag Profiler::setMemoryTag(MemoryTag tag) {
+    MemoryTag previous = memory_tag;
+    memory_tag = tag;
+    return previous;
+}
+
+uint64_t Profiler::realtimeAllocations() {
+    return realtime_allocations.load(std::memory_order_relaxed);
+}
+
+const char* Profiler::lastRealtimeAllocation(uint64_t* bytes) {
+    if (bytes) *bytes = realtime_last_bytes.load(std::memory_order_relaxed);
+    return realtime_last_name.load(std::memory_order_relaxed);
+}
+
+const char* Profiler::setRealtimeThread(const char* name) {
+    const char* previous = realtime_thread;
+    realtime_thread = name;
+    return previous;
+}
+
+void Profiler::setBudget(ProfileStage stage, int64_t nanoseconds) {
+    budgets[static_cast<int>(stage)].store(nanoseconds, std::memory_order_relaxed);
+}
+
+void Profiler::recordStartup(const char* name, int64_t nanoseconds) {
+    std::lock_guard<std::mutex> lock(startup_mutex);
+    if (startup_count < MAX_STARTUP_PHASES) startup_phases[startup_count++] = {name, nanoseconds};
+}
+
+int64_t Profiler::sinceStart() {
+    return now() - process_start;
+}
+
+#if defined(FC_TRACE_CHROME)
+
+namespace {
+
+struct TraceEvent {
+    const char* name;
+    int64_t start;      // steady_clock nanoseconds
+    int64_t duration;
+};
+
+// One per recording thread. The mutex is only contended by the writer at
+// exit, so a zone costs an uncontended lock and a push_back.
+struct TraceThread {
+    static constexpr size_t MAX_EVENTS = size_t(1) << 22;  // ~100 MB per thread, then drop
+    std::mutex mutex;
+    std::vector<TraceEvent> events;
+    const char* name = nullptr;
+    int id = 0;
+};
+
+struct TraceLog {
+    std::mutex mutex;
+    std::vector<std::unique_ptr<TraceThread>> threads;
+
+    ~TraceLog() { write(); }
+
+    void write() {
+        const char* path = std::getenv("FC_TRACE_FILE");
+        if (!path || !*path) path = "fc_trace.json";
+        FILE* file = std::fopen(path, "w");
+        if (!file) return;
+
+        std::lock_guard<std::mutex> lock(mutex);
+        int64_t origin = INT64_MAX;
+        for (const std::unique_ptr<TraceThread>& thread : threads) {
+            std::lock_guard<std::mutex> thread_lock(thread->mutex);
+            if (!thread->events.empty()) origin = std::min(origin, thread->events.front().start);
+        }
+
+        std::fputs("{\"traceEvents\":[\n", file);
+        bool first = true;
+        for (const std::unique_ptr<TraceThread>& thread : threads) {
+            std::lock_guard<std::mutex> thread_lock(thread->mutex);
+            if (thread->name) {
+                std::fprintf(file, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"%s\"}}",
+                             first ? "" : ",\n", thread->id, thread->name);
+                first = false;
+            }
+            for (const TraceEvent& event : thread->events) {
+                std::fprintf(file, "%s{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",
+                             first ? "" : ",\n", event.name, thread->id,
+                             (event.start - origin) / 1e3, event.duration / 1e3);
+                first = false;
+            }
+        }
+        std::fputs("\n],\"displayTimeUnit\":\"ms\"}\n", file);
+        std::fclose(file);
+    }
+};
+
+TraceLog trace_log;
+thread_local TraceThread* trace_thread = nullptr;
+
+TraceThread* traceThread() {
+    if (!trace_thread) {
+        std::lock_guard<std::mutex> lock(trace_log.mutex);
+        trace_log.threads.push_back(std::make_unique<TraceThread>());
+        trace_thread = trace_log.threads.back().get();
+        trace_thread->id = static_cast<int>(trace_log.threads.size());
+        trace_thread->events.reserve(1 << 16);
+    }
+    return trace_thread;
+}
+
+} // namespace
+
+void TraceZone::setThreadName(const char* name) {
+    TraceThread* thread = traceThread();
+    std::lock_guard<std::mutex> lock(thread->mutex);
+    thread->name = name;
+}
+
+void TraceZone::record(const char* name, int64_t start, int64_t duration) {
+    TraceThread* thread = traceThread();
+    std::lock_guard<std::mutex> lock(thread->mutex);
+    if (thread->events.size() < TraceThread::MAX_EVENTS) thread->events.push_back({name, start, duration});
+}
+
+#endif
+
+#ifndef NES_HEADLESS
+
+namespace {
+
+// UI-side history of the most recent samples per stage
+struct StageHistory {
+    static constexpr int SIZE = 512;
+    float ms[SIZE] = {};
+    uint32_t allocations[SIZE] = {};
+    int pos = 0;
+    int count = 0;
+    int calls_this_second = 0;
+    float calls_per_second = 0.0f;
+
+    void push(float value, uint32_t allocs) {
+        ms[pos] = value;
+        allocations[pos] = allocs;
+        pos = (pos + 1) % SIZE;
+        count = std::min(count + 1, SIZE);
+        ++calls_this_second;
+    }
+};
+
+StageHistory histories[Profiler::STAGE_COUNT];
+int64_t rate_window_start = 0;
+
+void drainRings() {
+    std::lock_guard<std::mutex> lock(rings_mutex);
+    for (const std::unique_ptr<ThreadRing>& ring : rings) {
+        uint64_t head = ring->head.load(std::memory_order_acquire);
+        if (head - ring->read_pos > ThreadRing::SIZE) ring->read_pos = head - ThreadRing::SIZE;
+        for (; ring->read_pos < head; ++ring->read_pos) {
+            uint64_t value = ring->samples[ring->read_pos & (ThreadRing::SIZE - 1)].load(std::memory_order_relaxed);
+            int stage = static_cast<int>(value >> ThreadRing::STAGE_SHIFT);
+            if (stage >= Profiler::STAGE_COUNT) continue;
+            uint64_t ns = value & ((uint64_t(1) << ThreadRing::STAGE_SHIFT) - 1);
+            uint32_t allocations = ring->allocations[ring->read_pos & (ThreadRing::SIZE - 1)].load(std::memory_order_relaxed);
+            histories[stage].push(static_cast<float>(ns / 1e6), allocations);
+        }
+    }
+
+    int64_t now = Profiler::now();
+    if (now - rate_window_start >= 1000000000) {
+        float seconds = rate_window_start ? (now - rate_window_start) / 1e9f : 1.0f;
+        for (StageHistory& history : histories) {
+            history.calls_per_second = history.calls_this_second / seconds;
+            history.calls_this_second = 0;
+        }
+        rate_window_start = now;
+    }
+}
+
+} // namespace
+
+void Profiler::drawWindow(bool* p_open) {
+    drainRings();
+
+    ImGui::SetNextWindowSize(ImVec2(720, 300), ImGuiCond_FirstUseEver);
+    if (!ImGui::Begin("Profiler", p_open)) {
+        ImGui::End();
+        return;
+    }
+
+    // Any heap use on a real-time thread could wait on the allocator's lock
+    uint64_t realtime_bytes = 0;
+    const char* realtime_where = lastRealtimeAllocation(&realtime_bytes);
+    if (uint64_t count = realtimeAllocations()) {
+        ImGui::TextColored(ImVec4(1.0f, 0.35f, 0.35f, 1.0f), "%llu heap allocations on real-time threads (last: %llu bytes in %s)",
+                           static_cast<unsigned long long>(count), static_cast<unsigned long long>(realtime_bytes),
+                           realtime_where ? realtime_where : "?");
+    } else {
+        ImGui::TextDisabled("No heap allocations on real-time threads");
+    }
+
+    ImGui::TextDisabled("Last %d calls per stage, milliseconds; heap allocations per call", StageHistory::SIZE);
+    ImGuiTableFlags flags = ImGuiTableFlags_RowBg | ImGuiTableFlags_BordersInnerV | ImGuiTableFlags_SizingFixedFit;
+    if (ImGui::BeginTable("stages", 8, flags)) {
+        ImGui::TableSetupColumn("Stage");
+        ImGui::TableSetupColumn("Calls/s");
+        ImGui::TableSetupColumn("p50");
+        ImGui::TableSetupColumn("p99");
+        ImGui::TableSetupColumn("Max");
+        ImGui::TableSetupColumn("Budget");
+        ImGui::TableSetupColumn("Allocs");
+        ImGui::TableSetupColumn("Distribution", ImGuiTableColumnFlags_WidthStretch);
+        ImGui::TableHeadersRow();
+
+        float* sorted = FrameArena::local().allocate<float>(StageHistory::SIZE);
+        for (int s = 0; s < STAGE_COUNT; ++s) {
+            const StageHistory& history = histories[s];
+            ImGui::TableNextRow();
+            ImGui::TableNextColumn();
+            ImGui::TextUnformatted(stageName(static_cast<ProfileStage>(s)));
+            ImGui::TableNextColumn();
+            ImGui::Text("%.0f", history.calls_per_second);
+            if (history.count == 0) continue;
+
+            int count = history.count;
+            std::copy(history.ms, history.ms + count, sorted);
+            std::sort(sorted, sorted + count);
+            float p50 = sorted[count / 2];
+            float p99 = sorted[std::min(count - 1, count * 99 / 100)];
+            float max = sorted[count - 1];
+            ImGui::TableNextColumn();
+            ImGui::Text("%.3f", p50);
+            ImGui::TableNextColumn();
+            ImGui::Text("%.3f", p99);
+            ImGui::TableNextColumn();
+            ImGui::Text("%.3f", max);
+
+            // p99 against the deadline; red once the worst calls miss it
+            ImGui::TableNextColumn();
+            float budget = budgets[s].load(std::memory_order_relaxed) / 1e6f;
+            if (budget > 0.0f) {
+                float share = p99 / budget;
+                ImVec4 color = share < 0.5f ? ImVec4(0.4f, 0.9f, 0.4f, 1.0f) :
+                               share < 1.0f ? ImVec4(1.0f, 0.8f, 0.3f, 1.0f) : ImVec4(1.0f, 0.35f, 0.35f, 1.0f);
+                ImGui::TextColored(color, "%.0f%% of %.1f", share * 100.0f, budget);
+            } else {
+                ImGui::TextDisabled("-");
+            }
+
+            // Most made by one call; a steady-state frame or callback should make none
+            uint32_t max_allocations = *std::max_element(history.allocations, history.allocations + count);
+            uint32_t last_allocations = history.allocations[(history.pos + StageHistory::SIZE - 1) % StageHistory::SIZE];
+            ImGui::TableNextColumn();
+            if (max_allocations == 0) {
+                ImGui::TextDisabled("0");
+            } else {
+                ImGui::Text("%u (max %u)", last_allocations, max_allocations);
+            }
+
+            // Duration histogram from 0 to max
+            constexpr int BINS = 32;
+            float bins[BINS] = {};
+            float scale = max > 0.0f ? BINS / max : 0.0f;
+            for (int i = 0; i < count; ++i) {
+                bins[std::min(BINS - 1, static_cast<int>(sorted[i] * scale))] += 1.0f;
+            }
+            ImGui::TableNextColumn();
+            char overlay[32];
+            snprintf(overlay, sizeof(overlay), "0 - %.2f ms", max);
+            ImGui::PushID(s);
+            ImGui::PlotHistogram("##hist", bins, BINS, 0, overlay, 0.0f, FLT_MAX, ImVec2(-1, 28));
+            ImGui::PopID();
+        }
+        ImGui::EndTable();
+    }
+
+    if (ImGui::CollapsingHeader("Memory", ImGuiTreeNodeFlags_DefaultOpen)) {
+        auto megabytes = [](int64_t bytes) { return bytes / (1024.0 * 1024.0); };
+        if (ImGui::BeginTable("memory", 4, flags)) {
+            ImGui::TableSetupColumn("Subsystem");
+            ImGui::TableSetupColumn("Current MB");
+            ImGui::TableSetupColumn("Peak MB");
+            ImGui::TableSetupColumn("Allocations");
+            ImGui::TableHeadersRow();
+            int64_t total = 0;
+            for (int t = 0; t < MEMORY_TAG_COUNT; ++t) {
+                MemoryUsage usage = memoryUsage(static_cast<MemoryTag>(t));
+                total += usage.current;
+                ImGui::TableNextRow();
+                ImGui::TableNextColumn();
+                ImGui::TextUnformatted(memoryTagName(static_cast<MemoryTag>(t)));
+                ImGui::TableNextColumn();
+                ImGui::Text("%.2f", megabytes(usage.current));
+                ImGui::TableNextColumn();
+                ImGui::Text("%.2f", megabytes(usage.peak));
+                ImGui::TableNextColumn();
+                ImGui::Text("%llu", static_cast<unsigned long long>(usage.allocations));
+            }
+            ImGui::TableNextRow();
+            ImGui::TableNextColumn();
+            ImGui::TextDisabled("Total");
+            ImGui::TableNextColumn();
+            ImGui::TextDisabled("%.2f", megabytes(total));
+            ImGui::EndTable();
+        }
+    }
+
+    // In the order they finished; the deferred ones arrive after the first frame
+    std::lock_guard<std::mutex> lock(startup_mutex);
+    if (startup_count > 0 && ImGui::CollapsingHeader("Startup")) {
+        if (ImGui::BeginTable("startup", 2, flags)) {
+            ImGui::TableSetupColumn("Phase");
+            ImGui::TableSetupColumn("ms");
+            ImGui::TableHeadersRow();
+            for (int i = 0; i < startup_count; ++i) {
+                ImGui::TableNextRow();
+                ImGui::TableNextColumn();
+                ImGui::TextUnformatted(startup_phases[i].name);
+                ImGui::TableNextColumn();
+                ImGui::Text("%.1f", startup_phases[i].nanoseconds / 1e6);
+            }
+            ImGui::EndTable();
+        }
+    }
+    ImGui::End();
+}
+
+namespace {
+void* countedAlloc(size_t size, size_t alignment, MemoryTag tag);
+void countedFree(void* ptr);
+} // namespace
+
+void Profiler::countImGuiAllocations() {
+    ImGui::SetAllocatorFunctions(
+        [](size_t size, void*) -> void* { return countedAlloc(size, 0, MemoryTag::ImGui); },
+        [](void* ptr, void*) { countedFree(ptr); });
+}
+
+#endif
+
+#ifndef NES_HEADLESS
+
+// Counting replacements for the global allocation functions. The nothrow and
+// sized forms are replaced too, since not every standard library forwards
+// them to the plain ones. Every block starts with a header naming its size
+// and tag, so a free is credited to the subsystem that allocated it.
+namespace {
+
+struct alignas(16) BlockHeader {
+    uint64_t size;
+    uint32_t offset;    // from the start of the block to the caller's pointer
+    MemoryTag tag;
+    bool aligned;       // from the aligned allocator, which Windows frees apart
+};
+static_assert(sizeof(BlockHeader) == 16, "the header keeps malloc's alignment");
+
+void alignedFree(void* ptr) {
+#ifdef _WIN32
+    _aligned_free(ptr);
+#else
+    std::free(ptr);
+#endif
+}
+
+// 'alignment' 0 for malloc's own
+void* countedAlloc(size_t size, size_t alignment, MemoryTag tag) {
+    ++thread_allocations;
+    if (realtime_thread) {
+        realtime_allocations.fetch_add(1, std::memory_order_relaxed);
+        realtime_last_bytes.store(size, std::memory_order_relaxed);
+        realtime_last_name.store(realtime_thread, std::memory_order_relaxed);
+    }
+    size_t offset = std::max(alignment, sizeof(BlockHeader));
+    void* block = nullptr;
+    if (alignment == 0) {
+        block = std::malloc(size + offset);
+    } else {
+        alignment = std::max(alignment, sizeof(void*));
+#ifdef _WIN32
+        block = _aligned_malloc(size + offset, alignment);
+#else
+        if (posix_memalign(&block, alignment, size + offset) != 0) block = nullptr;
+#endif
+    }
+    if (!block) return nullptr;
+    char* ptr = static_cast<char*>(block) + offset;
+    BlockHeader* header = reinterpret_cast<BlockHeader*>(ptr) - 1;
+    header->size = size;
+    header->offset = static_cast<uint32_t>(offset);
+    header->tag = tag;
+    header->aligned = alignment != 0;
+    charge(tag, static_cast<int64_t>(size), 1);
+    return ptr;
+}
+
+void* countedAlloc(size_t size) {
+    return countedAlloc(size, 0, memory_tag);
+}
+
+void* countedAlignedAlloc(size_t size, std::align_val_t align) {
+    return countedAlloc(size, static_cast<size_t>(align), memory_tag);
+}
+
+void countedFree(void* ptr) {
+    if (!ptr) return;
+    const BlockHeader* header = static_cast<const BlockHeader*>(ptr) - 1;
+    charge(header->tag, -static_cast<int64_t>(header->size), 0);
+    void* block = static_cast<char*>(ptr) - header->offset;
+    if (header->aligned) {
+        alignedFree(block);
+    } else {
+        std::free(block);
+    }
+}
+
+} // namespace
+
+void* operator new(size_t size) {
+    if (void* ptr = countedAlloc(size)) return ptr;
+    throw std::bad_alloc();
+}
+void* operator new[](size_t size) {
+    if (void* ptr = countedAlloc(size)) return ptr;
+    throw std::bad_alloc();
+}
+void* operator new(size_t size, const std::nothrow_t&) noexcept { return countedAlloc(size); }
+void* operator new[](size_t size, const std::nothrow_t&) noexcept { return countedAlloc(size); }
+void operator delete(void* ptr) noexcept { countedFree(ptr); }
+void operator delete[](void* ptr) noexcept { countedFree(ptr); }
+void operator delete(void* ptr, size_t) noexcept { countedFree(ptr); }
+void operator delete[](void* ptr, size_t) noexcept { countedFree(ptr); }
+void operator delete(void* ptr, const std::nothrow_t&) noexcept { countedFree(ptr); }
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept { countedFree(ptr); }
+
+void* operator new(size_t size, std::align_val_t align) {
+    if (void* ptr = countedAlignedAlloc(size, align)) return ptr;
+    throw std::bad_alloc();
+}
+void* operator new[](size_t size, std::align_val_t align) {
+    if (void* ptr = countedAlignedAlloc(size, align)) return ptr;
+    throw std::bad_alloc();
+}
+void* operator new(size_t size, std::align_val_t align, const std::nothrow_t&) noexcept {
+    return countedAlignedAlloc(size, align);
+}
+void* operator new[](size_t size, std::align_val_t align, const std::nothrow_t&) noexcept {
+    return countedAlignedAlloc(size, align);
+}
+void operator delete(void* ptr, std::align_val_t) noexcept { countedFree(ptr); }
+void operator delete[](void* ptr, std::align_val_t) noexcept { countedFree(ptr); }
+void operator delete(void* ptr, size_t, std::align_val_t) noexcept { countedFree(ptr); }
+void operator delete[](void* ptr, size_t, std::align_val_t) noexcept { countedFree(ptr); }
+void operator delete(void* ptr, std::align_val_t, const std::nothrow_t&) noexcept { countedFree(ptr); }
+void operator delete[](void* ptr, std::align_val_t, const std::nothrow_t&) noexcept { countedFree(ptr); }
+
+#endif
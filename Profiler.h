@@ -0,0 +1,228 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+#if defined(FC_TRACE_TRACY)
+#include <tracy/Tracy.hpp>
+#endif
+
+// Stages timed for the profiler window
+enum class ProfileStage : uint8_t {
+    GmePlay,        // synthesis thread: gme_play_float per chunk
+    ProcessFFT,     // analysis worker: spectrum per hop
+    NesFrame,       // emulation thread: agnes_next_frame
+    ScreenUpload,   // UI thread: NES screen texture update
+    PianoRoll,      // UI thread: drawPianoRoll
+    CanvasSplice,   // UI thread: waiting for and splicing the worker-built canvases
+    ImGuiRender,    // UI thread: simgui_render
+    AudioCallback,  // audio thread: the whole stream callback
+    UiFrame,        // UI thread: all of frame() after the pacer lets it run
+    FramePacing,    // UI thread: how far each NES frame went on screen from its due time
+    COUNT
+};
+
+// Subsystems whose memory the profiler window accounts for. Heap blocks are
+// charged to the tag of the MemoryScope they were allocated in and credited
+// back to it when freed; GPU images are charged explicitly (GpuMemory.h).
+enum class MemoryTag : uint8_t {
+    Other,          // anything allocated outside a scope
+    Analysis,       // analysis graph, visualizer histories and spectrogram rows
+    Notes,          // preprocessed and live piano-roll notes
+    Emulation,      // loaded emulators: gme's Blip_Buffers and chips, the NES core
+    Savestates,     // rewind ring and save states
+    Caches,         // note, waveform and spectrogram caches, library index
+    ImGui,          // ImGui's own allocator
+    GpuTextures,    // sokol images
+    COUNT
+};
+
+// Lightweight stage timing. Every recording thread gets its own ring of packed
+// (stage, nanoseconds) samples and the heap allocations made during each, so a
+// sample costs two steady_clock reads and a few relaxed/release stores, no locks. The UI thread drains all rings when
+// it draws the window. Recording is off until setEnabled(true), and a
+// ProfileScope then costs one relaxed load.
+class Profiler {
+public:
+    static constexpr int STAGE_COUNT = static_cast<int>(ProfileStage::COUNT);
+
+    static const char* stageName(ProfileStage stage);
+
+    static void setEnabled(bool enabled) { enabled_.store(enabled, std::memory_order_relaxed); }
+    static bool enabled() { return enabled_.load(std::memory_order_relaxed); }
+
+    static int64_t now() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    // Calling thread only; the first call registers the thread's ring
+    static void record(ProfileStage stage, int64_t nanoseconds, uint32_t allocations = 0);
+
+    // Heap allocations the calling thread has made so far: operator new, and
+    // ImGui's allocator once countImGuiAllocations() has installed it. Always
+    // 0 in headless builds, which keep the standard operator new.
+    static uint64_t threadAllocations();
+
+    // Time allowed per call, for stages with a deadline (the audio callback); 0 if none
+    static void setBudget(ProfileStage stage, int64_t nanoseconds);
+
+    // One-off startup phases, kept whether or not recording is enabled and
+    // listed in the window; any thread. 'name' must outlive the process (a
+    // string literal).
+    static void recordStartup(const char* name, int64_t nanoseconds);
+    // Since the profiler's static initialization, about when the process started
+    static int64_t sinceStart();
+
+    // Memory accounting. Heap figures need the counting operator new, so
+    // headless builds only have the explicitly charged ones.
+    struct MemoryUsage {
+        int64_t current = 0;        // bytes
+        int64_t peak = 0;
+        uint64_t allocations = 0;   // since startup
+    };
+    static const char* memoryTagName(MemoryTag tag);
+    static MemoryUsage memoryUsage(MemoryTag tag);
+    // Charge (or with negative bytes, credit) memory the heap counters can't
+    // see; 'allocations' is how many blocks that adds, 0 for a release
+    static void trackMemory(MemoryTag tag, int64_t bytes, uint64_t allocations = 1);
+    // The calling thread's tag for new heap blocks; returns the one before
+    static MemoryTag setMemoryTag(MemoryTag tag);
+
+    // Real-time alarm: heap allocations made while the calling thread is
+    // marked real-time (RealtimeScope) are counted here, whatever the
+    // profiler's enabled state. 'name' is where the last one happened.
+    static uint64_t realtimeAllocations();
+    static const char* lastRealtimeAllocation(uint64_t* bytes);
+    static const char* setRealtimeThread(const char* name);   // null to unmark
+
+#ifndef NES_HEADLESS
+    // Per-stage p50/p99/max, allocations and a duration histogram over the recent samples
+    static void drawWindow(bool* p_open);
+
+    // Route ImGui's allocations through the counter; before ImGui::CreateContext
+    static void countImGuiAllocations();
+#endif
+
+private:
+    static std::atomic<bool> enabled_;
+};
+
+// Times the enclosing scope into a stage while the profiler is enabled
+class ProfileScope {
+public:
+    explicit ProfileScope(ProfileStage stage)
+        : stage_(stage), start_(Profiler::enabled() ? Profiler::now() : -1),
+          allocations_(start_ >= 0 ? Profiler::threadAllocations() : 0) {}
+    ~ProfileScope() {
+        if (start_ >= 0) {
+            uint64_t allocations = Profiler::threadAllocations() - allocations_;
+            Profiler::record(stage_, Profiler::now() - start_, static_cast<uint32_t>(std::min<uint64_t>(allocations, UINT32_MAX)));
+        }
+    }
+
+    ProfileScope(const ProfileScope&) = delete;
+    ProfileScope& operator=(const ProfileScope&) = delete;
+
+private:
+    ProfileStage stage_;
+    int64_t start_;
+    uint64_t allocations_;
+};
+
+// Charges the heap blocks allocated in the enclosing scope (on this thread)
+// to a subsystem
+class MemoryScope {
+public:
+    explicit MemoryScope(MemoryTag tag) : previous_(Profiler::setMemoryTag(tag)) {}
+    ~MemoryScope() { Profiler::setMemoryTag(previous_); }
+
+    MemoryScope(const MemoryScope&) = delete;
+    MemoryScope& operator=(const MemoryScope&) = delete;
+
+private:
+    MemoryTag previous_;
+};
+
+// Marks the enclosing scope of a real-time thread, so any heap use in it
+// raises the profiler's alarm; 'name' must be a string literal
+class RealtimeScope {
+public:
+    explicit RealtimeScope(const char* name) : previous_(Profiler::setRealtimeThread(name)) {}
+    ~RealtimeScope() { Profiler::setRealtimeThread(previous_); }
+
+    RealtimeScope(const RealtimeScope&) = delete;
+    RealtimeScope& operator=(const RealtimeScope&) = delete;
+
+private:
+    const char* previous_;
+};
+
+// Times the enclosing scope as a startup phase
+class StartupScope {
+public:
+    explicit StartupScope(const char* name) : name_(name), start_(Profiler::now()) {}
+    ~StartupScope() { Profiler::recordStartup(name_, Profiler::now() - start_); }
+
+    StartupScope(const StartupScope&) = delete;
+    StartupScope& operator=(const StartupScope&) = delete;
+
+private:
+    const char* name_;
+    int64_t start_;
+};
+
+// Offline zone export, chosen at configure time with -DFC_TRACE=TRACY or
+// -DFC_TRACE=CHROME. TRACY streams zones to a connected Tracy server; CHROME
+// collects them per thread and writes a trace_event JSON file at exit (path
+// from FC_TRACE_FILE, default fc_trace.json) for chrome://tracing or
+// Perfetto. Without either the macros expand to nothing.
+#if defined(FC_TRACE_CHROME)
+class TraceZone {
+public:
+    explicit TraceZone(const char* name) : name_(name), start_(Profiler::now()) {}
+    ~TraceZone() { record(name_, start_, Profiler::now() - start_); }
+
+    TraceZone(const TraceZone&) = delete;
+    TraceZone& operator=(const TraceZone&) = delete;
+
+    // name must outlive the process (a string literal)
+    static void setThreadName(const char* name);
+
+private:
+    static void record(const char* name, int64_t start, int64_t duration);
+
+    const char* name_;
+    int64_t start_;
+};
+#endif
+
+#define FC_TRACE_CONCAT_(a, b) a##b
+#define FC_TRACE_CONCAT(a, b) FC_TRACE_CONCAT_(a, b)
+
+#if defined(FC_TRACE_TRACY)
+#define FC_TRACE_ZONE(name) ZoneScopedN(name)
+#define FC_TRACE_THREAD(name) tracy::SetThreadName(name)
+#define FC_TRACE_FRAME() FrameMark
+#elif defined(FC_TRACE_CHROME)
+#define FC_TRACE_ZONE(name) TraceZone FC_TRACE_CONCAT(trace_zone_, __LINE__)(name)
+#define FC_TRACE_THREAD(name) TraceZone::setThreadName(name)
+#define FC_TRACE_FRAME() ((void)0)
+#else
+#define FC_TRACE_ZONE(name) ((void)0)
+#define FC_TRACE_THREAD(name) ((void)0)
+#define FC_TRACE_FRAME() ((void)0)
+#endif
+
+// Time the rest of the enclosing scope as ProfileStage::stage, for the
+// profiler window and any trace export
+#define PROFILE_STAGE(stage) \
+    ProfileScope FC_TRACE_CONCAT(profile_scope_, __LINE__)(ProfileStage::stage); \
+    FC_TRACE_ZONE(#stage)
+
+// Time the rest of the enclosing scope as a startup phase (a string literal)
+#define PROFILE_STARTUP(name) \
+    StartupScope FC_TRACE_CONCAT(startup_scope_, __LINE__)(name); \
+    FC_TRACE_ZONE(name)
@@ -0,0 +1,262 @@
+#include "RamSearch.h"
+#include <algorithm>
+#include <bit>
+#include <cstring>
+
+#ifndef NES_HEADLESS
+#include "imgui.h"
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define RAM_SEARCH_USE_SSE2 1
+#elif defined(__aarch64__) && (defined(__ARM_NEON) || defined(__ARM_NEON__))
+#include <arm_neon.h>
+#define RAM_SEARCH_USE_NEON 1
+#endif
+
+namespace {
+
+#if defined(RAM_SEARCH_USE_NEON)
+// One bit per byte lane, like _mm_movemask_epi8
+uint64_t moveMask(uint8x16_t mask) {
+    static const uint8_t WEIGHTS[16] = { 1, 2, 4, 8, 16, 32, 64, 128, 1, 2, 4, 8, 16, 32, 64, 128 };
+    uint8x16_t bits = vandq_u8(mask, vld1q_u8(WEIGHTS));
+    return vaddv_u8(vget_low_u8(bits)) | (static_cast<uint64_t>(vaddv_u8(vget_high_u8(bits))) << 8);
+}
+#endif
+
+// Bit i set where a[i] compares to b[i] as asked, over 64 bytes (unsigned)
+uint64_t compare64(const uint8_t* a, const uint8_t* b, RamSearch::Compare compare) {
+    uint64_t equal = 0;
+    uint64_t at_least = 0;  // a >= b
+    uint64_t at_most = 0;   // a <= b
+    for (int i = 0; i < 64; i += 16) {
+#if defined(RAM_SEARCH_USE_SSE2)
+        // SSE2 has no unsigned byte compare: a >= b where max(a, b) == a
+        __m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i));
+        __m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i));
+        __m128i top = _mm_max_epu8(va, vb);
+        equal |= static_cast<uint64_t>(static_cast<uint16_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(va, vb)))) << i;
+        at_least |= static_cast<uint64_t>(static_cast<uint16_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(top, va)))) << i;
+        at_most |= static_cast<uint64_t>(static_cast<uint16_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(top, vb)))) << i;
+#elif defined(RAM_SEARCH_USE_NEON)
+        uint8x16_t va = vld1q_u8(a + i);
+        uint8x16_t vb = vld1q_u8(b + i);
+        equal |= moveMask(vceqq_u8(va, vb)) << i;
+        at_least |= moveMask(vcgeq_u8(va, vb)) << i;
+        at_most |= moveMask(vcleq_u8(va, vb)) << i;
+#else
+        for (int j = i; j < i + 16; ++j) {
+            equal |= static_cast<uint64_t>(a[j] == b[j]) << j;
+            at_least |= static_cast<uint64_t>(a[j] >= b[j]) << j;
+            at_most |= static_cast<uint64_t>(a[j] <= b[j]) << j;
+        }
+#endif
+    }
+    switch (compare) {
+        case RamSearch::Compare::EQUAL: return equal;
+        case RamSearch::Compare::NOT_EQUAL: return ~equal;
+        case RamSearch::Compare::GREATER: return ~at_most;
+        case RamSearch::Compare::LESS: return ~at_least;
+        case RamSearch::Compare::GREATER_EQUAL: return at_least;
+        case RamSearch::Compare::LESS_EQUAL: return at_most;
+        default: return 0;
+    }
+}
+
+} // namespace
+
+void RamSearch::start(const uint8_t* bytes, int count) {
+    count_ = std::clamp(count, 0, MAX_BYTES) & ~63;
+    memcpy(previous_, bytes, count_);
+    std::fill(candidates_, candidates_ + WORDS, 0);
+    std::fill(candidates_, candidates_ + count_ / 64, ~0ull);
+    candidate_count_ = count_;
+}
+
+void RamSearch::narrow(const uint8_t* bytes, Compare compare, const int* value) {
+    alignas(16) uint8_t splat[64];
+    if (value) memset(splat, *value & 0xff, sizeof(splat));
+    int remaining = 0;
+    for (int word = 0; word < count_ / 64; ++word) {
+        if (!candidates_[word]) continue;  // later steps only touch what is left
+        const uint8_t* operand = value ? splat : previous_ + word * 64;
+        candidates_[word] &= compare64(bytes + word * 64, operand, compare);
+        remaining += std::popcount(candidates_[word]);
+    }
+    memcpy(previous_, bytes, count_);
+    candidate_count_ = remaining;
+}
+
+uint16_t RamSearch::address(int index) {
+    return static_cast<uint16_t>(index < AGNES_RAM_SIZE ? index : 0x6000 + index - AGNES_RAM_SIZE);
+}
+
+#ifndef NES_HEADLESS
+
+namespace {
+
+const char* const COMPARE_NAMES[] = { "Equal to", "Not equal to", "Greater than", "Less than", "At least", "At most" };
+static_assert(sizeof(COMPARE_NAMES) / sizeof(COMPARE_NAMES[0]) == static_cast<int>(RamSearch::Compare::COUNT));
+
+} // namespace
+
+// This frame's RAM; a new game ends the search and its cheats
+void RamSearch::refresh(NesEmulator& emu) {
+    uint64_t rom = 0;
+    live_count_ = emu.readRam(live_, rom);
+    if (rom != rom_ || (searching_ && live_count_ != count_)) {
+        rom_ = rom;
+        searching_ = false;
+        listed_.clear();
+        freezes_.clear();
+    }
+}
+
+void RamSearch::listCandidates() {
+    listed_.clear();
+    listed_.reserve(candidate_count_);
+    for (int word = 0; word < count_ / 64; ++word) {
+        for (uint64_t bits = candidates_[word]; bits; bits &= bits - 1) {
+            listed_.push_back(static_cast<uint16_t>(word * 64 + std::countr_zero(bits)));
+        }
+    }
+}
+
+void RamSearch::freeze(NesEmulator& emu, uint16_t address, uint8_t value, bool frozen) {
+    auto it = std::find_if(freezes_.begin(), freezes_.end(),
+                           [address](const NesEmulator::RamFreeze& f) { return f.address == address; });
+    if (frozen && it == freezes_.end()) {
+        freezes_.push_back({address, value});
+    } else if (!frozen && it != freezes_.end()) {
+        freezes_.erase(it);
+    }
+    emu.setRamFreezes(freezes_);
+}
+
+void RamSearch::drawWindow(NesEmulator& emu, bool* p_open) {
+    ImGui::SetNextWindowSize(ImVec2(400, 520), ImGuiCond_FirstUseEver);
+    if (!ImGui::Begin("RAM Search", p_open)) {
+        ImGui::End();
+        return;
+    }
+    refresh(emu);
+    if (live_count_ == 0) {
+        ImGui::TextDisabled("No ROM loaded");
+        ImGui::End();
+        return;
+    }
+
+    if (ImGui::Button("New Search")) {
+        start(live_, live_count_);
+        listCandidates();
+        searching_ = true;
+    }
+    ImGui::SameLine();
+    if (searching_) {
+        ImGui::TextDisabled("%d of %d bytes left", candidate_count_, count_);
+    } else {
+        ImGui::TextDisabled("RAM%s", live_count_ > AGNES_RAM_SIZE ? " and work RAM" : "");
+    }
+
+    if (searching_) {
+        // Against the previous snapshot unless a value is given
+        bool step = false;
+        Compare compare = Compare::EQUAL;
+        bool with_value = false;
+        ImGui::SetNextItemWidth(120);
+        ImGui::Combo("##compare", &compare_, COMPARE_NAMES, static_cast<int>(Compare::COUNT));
+        ImGui::SameLine();
+        ImGui::Checkbox("Value", &against_value_);
+        if (against_value_) {
+            ImGui::SameLine();
+            ImGui::SetNextItemWidth(90);
+            if (ImGui::InputInt("##value", &value_)) value_ = std::clamp(value_, 0, 255);
+        } else if (ImGui::IsItemHovered(ImGuiHoveredFlags_DelayNormal)) {
+            ImGui::SetTooltip("Off: compare each byte with its value at the previous step");
+        }
+        ImGui::SameLine();
+        if (ImGui::Button("Search")) {
+            step = true;
+            compare = static_cast<Compare>(compare_);
+            with_value = against_value_;
+        }
+        static const struct { const char* name; Compare compare; } QUICK[] = {
+            { "Changed", Compare::NOT_EQUAL }, { "Unchanged", Compare::EQUAL },
+            { "Increased", Compare::GREATER }, { "Decreased", Compare::LESS },
+        };
+        for (const auto& quick : QUICK) {
+            if (&quick != QUICK) ImGui::SameLine();
+            if (ImGui::SmallButton(quick.name)) {
+                step = true;
+                compare = quick.compare;
+                with_value = false;
+            }
+        }
+        if (step) {
+            narrow(live_, compare, with_value ? &value_ : nullptr);
+            listCandidates();
+        }
+
+        ImGuiTableFlags flags = ImGuiTableFlags_RowBg | ImGuiTableFlags_BordersInnerV | ImGuiTableFlags_ScrollY;
+        float table_height = std::max(ImGui::GetContentRegionAvail().y * (freezes_.empty() ? 1.0f : 0.6f), 80.0f);
+        if (ImGui::BeginTable("candidates", 4, flags, ImVec2(0, table_height))) {
+            ImGui::TableSetupScrollFreeze(0, 1);
+            ImGui::TableSetupColumn("Address");
+            ImGui::TableSetupColumn("Value");
+            ImGui::TableSetupColumn("Previous");
+            ImGui::TableSetupColumn("Freeze", ImGuiTableColumnFlags_WidthFixed);
+            ImGui::TableHeadersRow();
+            ImGuiListClipper clipper;
+            clipper.Begin(static_cast<int>(listed_.size()));
+            while (clipper.Step()) {
+                for (int row = clipper.DisplayStart; row < clipper.DisplayEnd; ++row) {
+                    int index = listed_[row];
+                    uint16_t addr = address(index);
+                    ImGui::PushID(index);
+                    ImGui::TableNextRow();
+                    ImGui::TableNextColumn();
+                    ImGui::Text("$%04X", addr);
+                    ImGui::TableNextColumn();
+                    ImGui::Text("%02X (%d)", live_[index], live_[index]);
+                    ImGui::TableNextColumn();
+                    ImGui::TextDisabled("%02X (%d)", previous_[index], previous_[index]);
+                    ImGui::TableNextColumn();
+                    bool frozen = std::any_of(freezes_.begin(), freezes_.end(),
+                                              [addr](const NesEmulator::RamFreeze& f) { return f.address == addr; });
+                    if (ImGui::Checkbox("##freeze", &frozen)) freeze(emu, addr, live_[index], frozen);
+                    ImGui::PopID();
+                }
+            }
+            ImGui::EndTable();
+        }
+    }
+
+    // Cheats, rewritten before every frame
+    if (!freezes_.empty()) {
+        ImGui::SeparatorText("Frozen");
+        bool changed = false;
+        int remove = -1;
+        for (int i = 0; i < static_cast<int>(freezes_.size()); ++i) {
+            NesEmulator::RamFreeze& f = freezes_[i];
+            ImGui::PushID(i);
+            ImGui::Text("$%04X", f.address);
+            ImGui::SameLine();
+            ImGui::SetNextItemWidth(60);
+            changed |= ImGui::InputScalar("##value", ImGuiDataType_U8, &f.value, nullptr, nullptr, "%02X",
+                                          ImGuiInputTextFlags_CharsHexadecimal);
+            ImGui::SameLine();
+            if (ImGui::SmallButton("Remove")) remove = i;
+            ImGui::PopID();
+        }
+        if (remove >= 0) {
+            freezes_.erase(freezes_.begin() + remove);
+            changed = true;
+        }
+        if (changed) emu.setRamFreezes(freezes_);
+    }
+    ImGui::End();
+}
+
+#endif
@@ -0,0 +1,60 @@
+#pragma once
+
+#include "NesEmulator.h"
+#include <cstdint>
+#include <vector>
+
+// RAM search and cheat finder for the NES emulator. A search starts from a
+// snapshot of CPU RAM and work RAM; each step takes a new snapshot and
+// keeps the bytes that compare as asked, against a value or their value in
+// the previous snapshot ("changed", "increased", "equal to 5"...).
+// Candidates are a bitset over the snapshot, narrowed 16 bytes per
+// compare instruction, so a step over all 10 KB costs microseconds.
+// Frozen addresses go to the emulator, which rewrites them before each
+// frame: a loop over the frozen bytes, nothing when there are none.
+class RamSearch {
+public:
+    static constexpr int MAX_BYTES = NesEmulator::RAM_SEARCH_BYTES;
+
+    enum class Compare : uint8_t { EQUAL, NOT_EQUAL, GREATER, LESS, GREATER_EQUAL, LESS_EQUAL, COUNT };
+
+    // Search core, UI-free. 'count' is a multiple of 64 up to MAX_BYTES.
+    void start(const uint8_t* bytes, int count);
+    // Keep the candidates whose byte in 'bytes' compares to 'value', or to
+    // the previous snapshot without one; 'bytes' becomes that snapshot
+    void narrow(const uint8_t* bytes, Compare compare, const int* value);
+    int candidateCount() const { return candidate_count_; }
+    bool isCandidate(int index) const { return (candidates_[index >> 6] >> (index & 63)) & 1; }
+    int byteCount() const { return count_; }
+
+    // CPU address of a snapshot byte
+    static uint16_t address(int index);
+
+#ifndef NES_HEADLESS
+    // Main thread, once per frame while the window is open
+    void drawWindow(NesEmulator& emu, bool* p_open);
+#endif
+
+private:
+    static constexpr int WORDS = MAX_BYTES / 64;
+
+    void refresh(NesEmulator& emu);
+    void listCandidates();
+    void freeze(NesEmulator& emu, uint16_t address, uint8_t value, bool frozen);
+
+    uint8_t previous_[MAX_BYTES] = {};
+    uint64_t candidates_[WORDS] = {};
+    int count_ = 0;
+    int candidate_count_ = 0;
+
+    // UI state
+    uint8_t live_[MAX_BYTES] = {};
+    int live_count_ = 0;
+    uint64_t rom_ = 0;
+    bool searching_ = false;
+    std::vector<uint16_t> listed_;      // candidate indices, for the clipped table
+    std::vector<NesEmulator::RamFreeze> freezes_;
+    int compare_ = 0;                   // Compare
+    bool against_value_ = false;
+    int value_ = 0;
+};
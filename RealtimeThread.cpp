@@ -0,0 +1,140 @@
+#include "RealtimeThread.h"
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#include <avrt.h>
+#else
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+#if defined(__APPLE__)
+#include <pthread/qos.h>
+#endif
+#if (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)) && !defined(__EMSCRIPTEN__)
+#include <xmmintrin.h>
+#define REALTIME_MXCSR 1
+#endif
+
+namespace {
+
+constexpr size_t PAGE_BYTES = 4096;     // the smallest page any target uses
+
+#if defined(REALTIME_MXCSR)
+constexpr uint64_t DENORMALS_TO_ZERO = 0x8040;  // MXCSR FTZ | DAZ
+uint64_t readFloatMode() { return _mm_getcsr(); }
+void writeFloatMode(uint64_t mode) { _mm_setcsr(static_cast<unsigned int>(mode)); }
+#elif defined(__aarch64__)
+constexpr uint64_t DENORMALS_TO_ZERO = 1ull << 24;  // FPCR.FZ, which covers inputs too
+uint64_t readFloatMode() {
+    uint64_t mode;
+    __asm__ volatile("mrs %0, fpcr" : "=r"(mode));
+    return mode;
+}
+void writeFloatMode(uint64_t mode) { __asm__ volatile("msr fpcr, %0" : : "r"(mode)); }
+#else
+constexpr uint64_t DENORMALS_TO_ZERO = 0;
+uint64_t readFloatMode() { return 0; }
+void writeFloatMode(uint64_t) {}
+#endif
+
+}  // namespace
+
+bool RealtimeThread::enter() {
+    if (active_) return true;
+    active_ = true;
+    float_mode_ = readFloatMode();
+    writeFloatMode(float_mode_ | DENORMALS_TO_ZERO);
+    prefaultStack();
+
+#if defined(__EMSCRIPTEN__)
+    // The browser schedules its workers and the audio worklet itself
+    return false;
+#elif defined(_WIN32)
+    mmcss_index_ = 0;
+    mmcss_ = AvSetMmThreadCharacteristicsW(L"Pro Audio", &mmcss_index_);
+    return mmcss_ != nullptr;
+#elif defined(__APPLE__)
+    qos_ = qos_class_self();
+    return pthread_set_qos_class_self_np(QOS_CLASS_USER_INTERACTIVE, 0) == 0;
+#else
+    sched_param param{};
+    pthread_getschedparam(pthread_self(), &policy_, &param);
+    priority_ = param.sched_priority;
+    param.sched_priority = FIFO_PRIORITY;
+    fifo_ = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param) == 0;
+    return fifo_;
+#endif
+}
+
+void RealtimeThread::leave() {
+    if (!active_) return;
+    active_ = false;
+    writeFloatMode(float_mode_);
+
+#if defined(__EMSCRIPTEN__)
+    // nothing was raised
+#elif defined(_WIN32)
+    if (mmcss_) AvRevertMmThreadCharacteristics(mmcss_);
+    mmcss_ = nullptr;
+#elif defined(__APPLE__)
+    pthread_set_qos_class_self_np(static_cast<qos_class_t>(qos_), 0);
+#else
+    if (fifo_) {
+        sched_param param{};
+        param.sched_priority = priority_;
+        pthread_setschedparam(pthread_self(), policy_, &param);
+    }
+    fifo_ = false;
+#endif
+}
+
+// Pages below the current frame the callback will grow into; committing
+// them now moves those faults out of the deadline
+#if defined(_MSC_VER)
+__declspec(noinline)
+#else
+__attribute__((noinline))
+#endif
+void RealtimeThread::prefaultStack() {
+#if !defined(__EMSCRIPTEN__)  // the wasm stack is linear memory, and the worklet's is small
+    [[maybe_unused]] volatile unsigned char stack[STACK_PREFAULT];
+    for (size_t i = STACK_PREFAULT; i > 0; i -= PAGE_BYTES) {
+        stack[i - 1] = 0;   // top down, the way the stack grows past guard pages
+    }
+    stack[0] = 0;
+#endif
+}
+
+bool RealtimeThread::lockMemory(const void* data, size_t bytes) {
+    if (!data || bytes == 0) return true;
+    const volatile unsigned char* p = static_cast<const volatile unsigned char*>(data);
+    for (size_t i = 0; i < bytes; i += PAGE_BYTES) (void)p[i];
+    (void)p[bytes - 1];
+
+#if defined(_WIN32)
+    void* address = const_cast<void*>(data);
+    if (VirtualLock(address, bytes)) return true;
+    // The default working set minimum only leaves room for a few pages
+    SIZE_T min_size = 0;
+    SIZE_T max_size = 0;
+    HANDLE process = GetCurrentProcess();
+    if (!GetProcessWorkingSetSize(process, &min_size, &max_size)) return false;
+    SIZE_T grown = min_size + bytes + PAGE_BYTES * 2;
+    if (!SetProcessWorkingSetSize(process, grown, grown > max_size ? grown : max_size)) return false;
+    return VirtualLock(address, bytes) != 0;
+#else
+    return mlock(data, bytes) == 0;
+#endif
+}
+
+void RealtimeThread::unlockMemory(const void* data, size_t bytes) {
+    if (!data || bytes == 0) return;
+#if defined(_WIN32)
+    VirtualUnlock(const_cast<void*>(data), bytes);
+#else
+    munlock(data, bytes);
+#endif
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Real-time scheduling for one audio thread, so playback keeps going under
+// heavy system load: MMCSS "Pro Audio" on Windows, SCHED_FIFO on Linux
+// (needs an rtprio limit, e.g. the one the audio group gets), the
+// user-interactive QoS class on macOS. enter() also flushes denormals to
+// zero and faults in the top of the stack. Owned and used by that thread.
+class RealtimeThread {
+public:
+    RealtimeThread() = default;
+    ~RealtimeThread() { leave(); }
+
+    RealtimeThread(const RealtimeThread&) = delete;
+    RealtimeThread& operator=(const RealtimeThread&) = delete;
+
+    // Raise the calling thread. False if the OS refused the priority; the
+    // thread is still entered, with FTZ/DAZ on, and leave() undoes that.
+    bool enter();
+    // Back to the scheduling and float mode it had before enter()
+    void leave();
+    bool active() const { return active_; }
+
+    // Fault in and pin memory the audio path touches, so it never waits on
+    // a page fault; false if pinning failed (the pages are still touched)
+    static bool lockMemory(const void* data, size_t bytes);
+    static void unlockMemory(const void* data, size_t bytes);
+
+private:
+    static constexpr size_t STACK_PREFAULT = 64 * 1024;
+    static constexpr int FIFO_PRIORITY = 20;    // under JACK and PipeWire's own threads
+
+    static void prefaultStack();
+
+    bool active_ = false;
+    uint64_t float_mode_ = 0;   // MXCSR or FPCR before enter()
+#if defined(_WIN32)
+    void* mmcss_ = nullptr;
+    unsigned long mmcss_index_ = 0;
+#elif defined(__APPLE__)
+    unsigned int qos_ = 0;
+#else
+    bool fifo_ = false;
+    int policy_ = 0;
+    int priority_ = 0;
+#endif
+};
@@ -0,0 +1,183 @@
+#include "RewindBuffer.h"
+#include <cstring>
+
+// Encoded stream: repeated [zero run][literal count][literal bytes], with both
+// counts as LEB128 varints, until state_size bytes are covered
+static constexpr size_t MIN_ZERO_RUN = 4;
+
+static uint8_t* putVarint(uint8_t* out, size_t value) {
+    while (value >= 0x80) {
+        *out++ = static_cast<uint8_t>(value | 0x80);
+        value >>= 7;
+    }
+    *out++ = static_cast<uint8_t>(value);
+    return out;
+}
+
+static const uint8_t* getVarint(const uint8_t* in, size_t* value) {
+    size_t result = 0;
+    int shift = 0;
+    uint8_t byte;
+    do {
+        byte = *in++;
+        result |= static_cast<size_t>(byte & 0x7F) << shift;
+        shift += 7;
+    } while (byte & 0x80);
+    *value = result;
+    return in;
+}
+
+void RewindBuffer::init(size_t state_size, size_t budget_bytes, int keyframe_interval) {
+    state_size_ = state_size;
+    keyframe_interval_ = keyframe_interval > 0 ? keyframe_interval : 1;
+    storage_.assign(budget_bytes, 0);
+    key_.assign(state_size, 0);
+    scratch_.assign(state_size, 0);
+    // Worst case: every byte literal, plus the varint headers of one token
+    encoded_.assign(state_size + 32, 0);
+    clear();
+}
+
+void RewindBuffer::clear() {
+    entries_.clear();
+    head_ = 0;
+    since_key_ = 0;
+}
+
+size_t RewindBuffer::bytesUsed() const {
+    size_t used = 0;
+    for (const Entry& e : entries_) used += e.size;
+    return used;
+}
+
+size_t RewindBuffer::encode(const uint8_t* data, uint8_t* out) const {
+    uint8_t* p = out;
+    size_t i = 0;
+    while (i < state_size_) {
+        size_t zero_start = i;
+        while (i < state_size_ && data[i] == 0) ++i;
+        size_t zeros = i - zero_start;
+
+        // Literals run until the next zero run long enough to be worth a token
+        size_t lit_start = i;
+        while (i < state_size_) {
+            if (data[i] == 0) {
+                size_t run = 1;
+                while (run < MIN_ZERO_RUN && i + run < state_size_ && data[i + run] == 0) ++run;
+                if (run >= MIN_ZERO_RUN || i + run == state_size_) break;
+                i += run;
+            } else {
+                ++i;
+            }
+        }
+        size_t literals = i - lit_start;
+
+        p = putVarint(p, zeros);
+        p = putVarint(p, literals);
+        memcpy(p, data + lit_start, literals);
+        p += literals;
+    }
+    return static_cast<size_t>(p - out);
+}
+
+void RewindBuffer::decode(const uint8_t* in, size_t in_size, uint8_t* out) const {
+    const uint8_t* end = in + in_size;
+    size_t pos = 0;
+    while (in < end && pos < state_size_) {
+        size_t zeros, literals;
+        in = getVarint(in, &zeros);
+        in = getVarint(in, &literals);
+        memset(out + pos, 0, zeros);
+        pos += zeros;
+        memcpy(out + pos, in, literals);
+        pos += literals;
+        in += literals;
+    }
+}
+
+void RewindBuffer::dropOrphanedDeltas() {
+    while (!entries_.empty() && !entries_.front().keyframe) {
+        entries_.pop_front();
+    }
+}
+
+bool RewindBuffer::store(const uint8_t* encoded, size_t size, bool keyframe) {
+    if (size > storage_.size()) return false;
+
+    if (entries_.empty()) head_ = 0;
+
+    // Doesn't fit before the end: everything stored past head_ is older, drop it and wrap
+    if (head_ + size > storage_.size()) {
+        while (!entries_.empty() && entries_.front().offset >= head_) {
+            entries_.pop_front();
+            dropOrphanedDeltas();
+        }
+        head_ = 0;
+    }
+
+    // Evict the oldest entries that overlap [head_, head_ + size)
+    while (!entries_.empty()) {
+        const Entry& front = entries_.front();
+        bool overlaps = front.offset < head_ + size && head_ < front.offset + front.size;
+        if (!overlaps) break;
+        entries_.pop_front();
+        dropOrphanedDeltas();
+    }
+
+    // A delta whose keyframe was just evicted can't be decoded
+    if (!keyframe && entries_.empty()) return false;
+
+    memcpy(storage_.data() + head_, encoded, size);
+    entries_.push_back({ head_, size, keyframe });
+    head_ += size;
+    return true;
+}
+
+void RewindBuffer::push(const uint8_t* state) {
+    if (storage_.empty()) return;
+
+    bool keyframe = entries_.empty() || since_key_ >= keyframe_interval_ - 1;
+    if (!keyframe) {
+        for (size_t i = 0; i < state_size_; ++i) scratch_[i] = state[i] ^ key_[i];
+        size_t size = encode(scratch_.data(), encoded_.data());
+        if (store(encoded_.data(), size, false)) {
+            ++since_key_;
+            return;
+        }
+        // Ran out of room and lost our own keyframe: start over with a new one
+    }
+
+    size_t size = encode(state, encoded_.data());
+    if (store(encoded_.data(), size, true)) {
+        memcpy(key_.data(), state, state_size_);
+        since_key_ = 0;
+    }
+}
+
+bool RewindBuffer::pop(uint8_t* out_state) {
+    if (entries_.empty()) return false;
+
+    Entry newest = entries_.back();
+    entries_.pop_back();
+    head_ = newest.offset;
+
+    if (!newest.keyframe) {
+        decode(storage_.data() + newest.offset, newest.size, scratch_.data());
+        for (size_t i = 0; i < state_size_; ++i) out_state[i] = scratch_[i] ^ key_[i];
+        --since_key_;
+        return true;
+    }
+
+    decode(storage_.data() + newest.offset, newest.size, out_state);
+
+    // The remaining newest deltas refer to the keyframe before this one
+    since_key_ = 0;
+    for (auto it = entries_.rbegin(); it != entries_.rend(); ++it) {
+        if (it->keyframe) {
+            decode(storage_.data() + it->offset, it->size, key_.data());
+            break;
+        }
+        ++since_key_;
+    }
+    return true;
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+// Fixed-budget history of emulator state snapshots for rewinding.
+// Every keyframe_interval-th snapshot is a keyframe; the ones in between are
+// stored as an XOR delta against the keyframe before them. Both are run-length
+// coded (deltas are mostly zero), and the encoded entries live in one
+// preallocated byte ring. When the budget is used up the oldest entries go
+// first, together with any deltas whose keyframe was dropped.
+class RewindBuffer {
+public:
+    void init(size_t state_size, size_t budget_bytes, int keyframe_interval = 60);
+    void clear();
+
+    // Append the newest snapshot
+    void push(const uint8_t* state);
+
+    // Remove the newest snapshot and decode it into out_state (state_size bytes)
+    bool pop(uint8_t* out_state);
+
+    bool empty() const { return entries_.empty(); }
+    int count() const { return static_cast<int>(entries_.size()); }
+    size_t bytesUsed() const;
+    size_t budget() const { return storage_.size(); }
+
+private:
+    struct Entry {
+        size_t offset;
+        size_t size;
+        bool keyframe;
+    };
+
+    size_t encode(const uint8_t* data, uint8_t* out) const;
+    void decode(const uint8_t* in, size_t in_size, uint8_t* out) const;
+    bool store(const uint8_t* encoded, size_t size, bool keyframe);
+    void dropOrphanedDeltas();
+
+    size_t state_size_ = 0;
+    int keyframe_interval_ = 60;
+    std::vector<uint8_t> storage_;   // ring of encoded entries
+    std::deque<Entry> entries_;      // oldest first
+    size_t head_ = 0;                // next write offset in storage_
+    std::vector<uint8_t> key_;       // decoded keyframe the newest deltas refer to
+    std::vector<uint8_t> scratch_;   // XOR delta / decode scratch
+    std::vector<uint8_t> encoded_;   // worst-case sized encode buffer
+    int since_key_ = 0;              // snapshots pushed since key_
+};
@@ -0,0 +1,50 @@
+#include "RomCache.h"
+#include <algorithm>
+
+bool RomCache::take(const std::string& path, Entry& out) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto found = std::find_if(entries_.begin(), entries_.end(),
+                              [&](const Entry& entry) { return entry.path == path; });
+    if (found == entries_.end()) return false;
+    bytes_ -= found->bytes();
+    out = std::move(*found);
+    entries_.erase(found);
+    return true;
+}
+
+void RomCache::put(Entry entry) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto same = std::find_if(entries_.begin(), entries_.end(),
+                             [&](const Entry& other) { return other.path == entry.path; });
+    if (same != entries_.end()) {
+        bytes_ -= same->bytes();
+        entries_.erase(same);
+    }
+    bytes_ += entry.bytes();
+    entries_.push_back(std::move(entry));
+
+    // The newest stays even alone over budget; it is the one asked for
+    while (bytes_ > budget_ && entries_.size() > 1) {
+        bytes_ -= entries_.front().bytes();
+        entries_.erase(entries_.begin());
+    }
+}
+
+void RomCache::clear() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    entries_.clear();
+    bytes_ = 0;
+}
+
+std::vector<std::string> RomCache::paths() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::vector<std::string> out;
+    out.reserve(entries_.size());
+    for (auto entry = entries_.rbegin(); entry != entries_.rend(); ++entry) out.push_back(entry->path);
+    return out;
+}
+
+size_t RomCache::bytes() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return bytes_;
+}
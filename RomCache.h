@@ -0,0 +1,49 @@
+#pragma once
+
+#include "MappedFile.h"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Recently played ROMs kept in memory so switching back to one is instant:
+// each entry holds the ROM image (its MappedFile, which agnes reads from
+// directly) and the suspend state the emulator left it in. The entries'
+// bytes are held within a budget, the least recently used going first.
+// Thread-safe; NesEmulator::loadROM takes and puts entries on the loader
+// thread while the UI lists them.
+class RomCache {
+public:
+    struct Entry {
+        std::string path;
+        std::unique_ptr<MappedFile> rom;
+        std::vector<uint8_t> state;     // NesEmulator::saveState()
+        std::vector<uint8_t> screen;    // palette indices of the last frame
+        bool running = false;
+
+        size_t bytes() const { return (rom ? rom->size() : 0) + state.size() + screen.size(); }
+    };
+
+    explicit RomCache(size_t budget_bytes) : budget_(budget_bytes) {}
+
+    // Move the entry for 'path' out, as its ROM is in use again; false if
+    // there is none
+    bool take(const std::string& path, Entry& out);
+
+    // Keep 'entry' as the most recent, replacing one for the same path
+    void put(Entry entry);
+
+    void clear();
+
+    // Paths, most recent first
+    std::vector<std::string> paths() const;
+    size_t bytes() const;
+
+private:
+    size_t budget_;
+    mutable std::mutex mutex_;
+    std::vector<Entry> entries_;    // least recent first
+    size_t bytes_ = 0;
+};
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <vector>
+#include <algorithm>
+
+// Sliding window over the most recent size() samples.
+// Storage is a power-of-two ring written twice (at i and i + size), so the
+// window is always available as one contiguous, oldest-first span and
+// pushing a sample never shifts the existing data.
+class SampleWindow {
+public:
+    // size is rounded up to a power of two
+    void init(int size) {
+        int n = 1;
+        while (n < size) n <<= 1;
+        size_ = n;
+        mask_ = n - 1;
+        cursor_ = 0;
+        data_.assign(static_cast<size_t>(n) * 2, 0.0f);
+    }
+
+    int size() const { return size_; }
+
+    void push(float sample) {
+        data_[cursor_] = sample;
+        data_[cursor_ + size_] = sample;
+        cursor_ = (cursor_ + 1) & mask_;
+    }
+
+    // Oldest-first view of the last size() samples, valid until the next push
+    const float* window() const { return data_.data() + cursor_; }
+
+    void clear() {
+        std::fill(data_.begin(), data_.end(), 0.0f);
+        cursor_ = 0;
+    }
+
+private:
+    std::vector<float> data_;
+    int size_ = 0;
+    int mask_ = 0;
+    int cursor_ = 0;
+};
@@ -0,0 +1,197 @@
+#include "SaveSlots.h"
+#include "JobSystem.h"
+#include "Lz4.h"
+#include "MappedFile.h"
+#include "NesEmulator.h"
+#include "Profiler.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <filesystem>
+#include <memory>
+#include <system_error>
+
+const std::string& SaveSlots::directory() {
+    static const std::string dir = []() -> std::string {
+        namespace fs = std::filesystem;
+        fs::path base;
+#if defined(_WIN32)
+        if (const char* app_data = std::getenv("APPDATA")) base = app_data;
+#elif defined(__APPLE__)
+        if (const char* home = std::getenv("HOME")) base = fs::path(home) / "Library" / "Application Support";
+#else
+        if (const char* xdg = std::getenv("XDG_DATA_HOME")) base = xdg;
+        else if (const char* home = std::getenv("HOME")) base = fs::path(home) / ".local" / "share";
+#endif
+        if (base.empty()) return std::string();
+
+        fs::path path = base / "imgui_fc_visualizer" / "states";
+        std::error_code ec;
+        fs::create_directories(path, ec);
+        if (ec) return std::string();
+        return path.string();
+    }();
+    return dir;
+}
+
+std::string SaveSlots::slotPath(uint64_t rom_hash, int slot) {
+    const std::string& dir = directory();
+    if (dir.empty()) return std::string();
+
+    char name[48];
+    snprintf(name, sizeof(name), "%016llx_%d.fcsz", static_cast<unsigned long long>(rom_hash), slot);
+    return (std::filesystem::path(dir) / name).string();
+}
+
+SaveSlots::Entry SaveSlots::readSlot(uint64_t rom_hash, int slot) {
+    Entry entry;
+    entry.known = true;
+    std::string path = slotPath(rom_hash, slot);
+    MappedFile file;
+    if (path.empty() || !file.open(path.c_str())) return entry;
+
+    FileHeader header;
+    if (file.size() < sizeof(header)) return entry;
+    memcpy(&header, file.data(), sizeof(header));
+    if (memcmp(header.magic, "FCSZ", 4) != 0 || header.version != VERSION || header.rom_hash != rom_hash ||
+        file.size() != sizeof(header) + header.packed_size) {
+        return entry;
+    }
+    // Sized before decompressing, so an LZ4 block can't claim more than it
+    // could expand to (255 bytes a byte at most)
+    if (header.state_size > MAX_STATE_SIZE ||
+        header.state_size > static_cast<uint64_t>(header.packed_size) * 255 + 16) {
+        return entry;
+    }
+    MemoryScope memory(MemoryTag::Savestates);
+    entry.state.resize(header.state_size);
+    if (!Lz4::decompress(file.data() + sizeof(header), header.packed_size, entry.state.data(), header.state_size)) {
+        entry.state.clear();
+        return entry;
+    }
+    entry.used = true;
+    entry.saved_time = header.saved_time;
+    return entry;
+}
+
+bool SaveSlots::writeSlot(uint64_t rom_hash, int slot, int64_t saved_time, const std::vector<uint8_t>& state,
+                          uint64_t generation) {
+    std::string path = slotPath(rom_hash, slot);
+    if (path.empty()) return false;
+
+    std::vector<uint8_t> packed(Lz4::bound(state.size()));
+    FileHeader header;
+    memcpy(header.magic, "FCSZ", 4);
+    header.version = VERSION;
+    header.rom_hash = rom_hash;
+    header.saved_time = saved_time;
+    header.state_size = static_cast<uint32_t>(state.size());
+    header.packed_size = static_cast<uint32_t>(Lz4::compress(state.data(), state.size(), packed.data()));
+
+    // Write to a temp file and rename so a prefetch never reads a partial slot
+    std::string temp_path = path + "." + std::to_string(generation) + ".tmp";
+    FILE* f = fopen(temp_path.c_str(), "wb");
+    if (!f) return false;
+    bool ok = fwrite(&header, sizeof(header), 1, f) == 1 &&
+              fwrite(packed.data(), 1, header.packed_size, f) == header.packed_size;
+    ok = (fclose(f) == 0) && ok;
+
+    std::error_code ec;
+    if (ok) {
+        std::filesystem::rename(temp_path, path, ec);
+        ok = !ec;
+    }
+    if (!ok) {
+        std::filesystem::remove(temp_path, ec);
+    }
+    return ok;
+}
+
+void SaveSlots::selectRom(uint64_t rom_hash) {
+    if (rom_hash == rom_hash_) return;
+    rom_hash_ = rom_hash;
+    for (Entry& entry : slots_) entry = Entry();
+    prefetching_ = false;  // a job still reading the old ROM's slots drops them
+}
+
+void SaveSlots::save(NesEmulator& emu, int slot) {
+    if (!emu.isLoaded() || slot < 0 || slot >= SLOT_COUNT) return;
+    uint64_t rom_hash = emu.romHash();
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        selectRom(rom_hash);
+    }
+    emu.saveStateAsync([this, rom_hash, slot](std::vector<uint8_t> state) {
+        // On the emulation thread: keep the state for loading and leave the
+        // compression and the file to a job
+        int64_t saved_time = static_cast<int64_t>(std::time(nullptr));
+        auto saved = std::make_shared<std::vector<uint8_t>>(std::move(state));
+        uint64_t generation;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (rom_hash_ == rom_hash) slots_[slot] = Entry{true, true, saved_time, *saved};
+            generation = ++write_generation_;
+            latest_write_[{rom_hash, slot}] = generation;
+        }
+        jobs_.submit([this, rom_hash, slot, saved_time, saved, generation](const Job&) {
+            std::lock_guard<std::mutex> write_lock(write_mutex_);
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                if (latest_write_[{rom_hash, slot}] != generation) return;  // a newer save writes the slot
+            }
+            writeSlot(rom_hash, slot, saved_time, *saved, generation);
+            std::lock_guard<std::mutex> lock(mutex_);
+            auto latest = latest_write_.find({rom_hash, slot});
+            if (latest != latest_write_.end() && latest->second == generation) latest_write_.erase(latest);
+        }, JobPriority::INTERACTIVE, "save state");
+    });
+}
+
+bool SaveSlots::load(NesEmulator& emu, int slot) {
+    if (!emu.isLoaded() || slot < 0 || slot >= SLOT_COUNT) return false;
+    std::vector<uint8_t> state;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        selectRom(emu.romHash());
+        if (!slots_[slot].known) slots_[slot] = readSlot(rom_hash_, slot);  // not prefetched yet
+        if (!slots_[slot].used) return false;
+        state = slots_[slot].state;
+    }
+    emu.loadStateAsync(std::move(state));
+    return true;
+}
+
+void SaveSlots::prefetch(const NesEmulator& emu) {
+    if (!emu.isLoaded()) return;
+    std::lock_guard<std::mutex> lock(mutex_);
+    selectRom(emu.romHash());
+    if (prefetching_) return;
+    bool wanted = false;
+    for (const Entry& entry : slots_) wanted = wanted || !entry.known;
+    if (!wanted) return;
+
+    prefetching_ = true;
+    uint64_t rom_hash = rom_hash_;
+    jobs_.submit([this, rom_hash](const Job&) {
+        for (int i = 0; i < SLOT_COUNT; ++i) {
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                if (rom_hash_ != rom_hash) return;
+                if (slots_[i].known) continue;
+            }
+            Entry entry = readSlot(rom_hash, i);
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (rom_hash_ == rom_hash && !slots_[i].known) slots_[i] = std::move(entry);
+        }
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (rom_hash_ == rom_hash) prefetching_ = false;
+    }, JobPriority::INTERACTIVE, "read save states");
+}
+
+SaveSlots::Slot SaveSlots::slot(const NesEmulator& emu, int index) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    selectRom(emu.romHash());
+    const Entry& entry = slots_[index];
+    return {entry.used, entry.known, entry.saved_time};
+}
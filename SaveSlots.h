@@ -0,0 +1,85 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+class JobSystem;
+class NesEmulator;
+
+// Numbered savestate slots on disk, per ROM (NES Emulator > File > Save
+// State / Load State; F2 quick-saves to slot 0 and F4 loads it). Nothing
+// here waits on the emulation thread or the disk: the state is taken
+// between frames (NesEmulator::saveStateAsync) and a job compresses it with
+// LZ4 and writes the file, while a saved state is also kept in memory. When
+// a slot menu opens, prefetch() has a job map and decompress every slot not
+// yet in memory, so loading one only hands the state over.
+//
+// Main thread, except for what the jobs do under the lock.
+class SaveSlots {
+public:
+    static constexpr int SLOT_COUNT = 10;   // 0 is the quick-save slot
+
+    struct Slot {
+        bool used = false;
+        bool ready = false;             // read (or saved) into memory
+        int64_t saved_time = 0;         // seconds since the epoch
+    };
+
+    explicit SaveSlots(JobSystem& jobs) : jobs_(jobs) {}
+
+    void save(NesEmulator& emu, int slot);
+    // False if the slot is empty. One prefetch() hasn't read yet is read
+    // on the spot.
+    bool load(NesEmulator& emu, int slot);
+
+    // Read the slots of the loaded ROM not yet in memory, on a job; cheap
+    // to call every frame the menu is open
+    void prefetch(const NesEmulator& emu);
+    Slot slot(const NesEmulator& emu, int index);
+
+    // Per-user directory (created on demand), empty if unavailable
+    static const std::string& directory();
+
+private:
+    static constexpr uint32_t VERSION = 1;
+    static constexpr uint32_t MAX_STATE_SIZE = 16u << 20;  // far above any mapper's savestate
+
+    struct FileHeader {
+        char magic[4];          // "FCSZ"
+        uint32_t version;
+        uint64_t rom_hash;
+        int64_t saved_time;
+        uint32_t state_size;    // NesEmulator::saveState() bytes
+        uint32_t packed_size;   // LZ4 block that follows
+    };
+
+    struct Entry {
+        bool known = false;     // read, or known to be empty
+        bool used = false;
+        int64_t saved_time = 0;
+        std::vector<uint8_t> state;
+    };
+
+    static std::string slotPath(uint64_t rom_hash, int slot);
+    static Entry readSlot(uint64_t rom_hash, int slot);
+    static bool writeSlot(uint64_t rom_hash, int slot, int64_t saved_time, const std::vector<uint8_t>& state,
+                          uint64_t generation);
+    // Must hold mutex_: forget the slots of a ROM no longer loaded
+    void selectRom(uint64_t rom_hash);
+
+    JobSystem& jobs_;
+    std::mutex mutex_;
+    uint64_t rom_hash_ = 0;
+    Entry slots_[SLOT_COUNT];
+    bool prefetching_ = false;
+    
+    // Each save of a slot has a job of its own; they write one at a time
+    // under write_mutex_, and one finding a newer save of its slot queued
+    // leaves the file to that
+    std::mutex write_mutex_;
+    std::map<std::pair<uint64_t, int>, uint64_t> latest_write_;   // by ROM and slot; mutex_
+    uint64_t write_generation_ = 0;                                 // mutex_
+};
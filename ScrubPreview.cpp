@@ -0,0 +1,127 @@
+#include "ScrubPreview.h"
+#include "gme/gme.h"
+#include <algorithm>
+
+ScrubPreview::Session::~Session() {
+    if (emu) gme_set_fast_synth(emu.get(), 1);  // as the pool hands them out
+}
+
+Music_Emu* ScrubPreview::Session::emulator() {
+    if (!emu && !failed) {
+        emu = pool->acquire();
+        failed = !emu || gme_start_track(emu.get(), track) != nullptr;
+    }
+    return failed ? nullptr : emu.get();
+}
+
+ScrubPreview::ScrubPreview(JobSystem& jobs) : jobs_(jobs) {
+    ring_.init(RING_FRAMES, 2);
+}
+
+ScrubPreview::~ScrubPreview() {
+    clear();
+}
+
+void ScrubPreview::prepare(std::shared_ptr<MusicEmuPool> pool, int track, long length_ms) {
+    clear();
+    if (!pool) return;
+
+    auto session = std::make_shared<Session>();
+    session->pool = std::move(pool);
+    session->track = track;
+    session->length_ms = length_ms;
+    session_ = session;
+
+    index_job_ = jobs_.submit([session](const Job& job) {
+        // From where the last step stopped, each seek just plays on; after a
+        // grain moved the emulator it restores the snapshot before the step
+        for (long msec = INDEX_STEP_MS; msec < session->length_ms; msec += INDEX_STEP_MS) {
+            if (job.isCancelled() || session->cancelled.load(std::memory_order_relaxed)) return;
+            std::lock_guard<std::mutex> lock(session->mutex);
+            Music_Emu* emu = session->emulator();
+            if (!emu) return;
+            gme_seek(emu, msec);
+            if (gme_track_ended(emu)) return;
+            job.setProgress(msec / static_cast<float>(session->length_ms));
+        }
+    }, JobPriority::BATCH, "Scrub index");
+}
+
+void ScrubPreview::clear() {
+    active_.store(false, std::memory_order_relaxed);
+    if (session_) session_->cancelled.store(true, std::memory_order_relaxed);
+    if (index_job_) index_job_->cancel();
+    session_.reset();
+    index_job_.reset();
+}
+
+int ScrubPreview::grainFrames() const {
+    return static_cast<int>(session_->pool->sampleRate() * GRAIN_MS / 1000);
+}
+
+void ScrubPreview::move(long msec) {
+    if (!session_) return;
+    cursor_ = std::clamp(msec, 0L, session_->length_ms);
+    if (!active_.load(std::memory_order_relaxed)) {
+        last_grain_ = -1;
+        active_.store(true, std::memory_order_release);
+    }
+    if (cursor_ == last_grain_ || grain_busy_.load(std::memory_order_acquire)) return;
+    if (ring_.available() > grainFrames() / 2) return;  // the last grain is still playing
+    startGrain(cursor_);
+}
+
+long ScrubPreview::end() {
+    active_.store(false, std::memory_order_relaxed);
+    return cursor_;
+}
+
+void ScrubPreview::startGrain(long msec) {
+    last_grain_ = msec;
+    grain_busy_.store(true, std::memory_order_relaxed);
+    std::shared_ptr<Session> session = session_;
+    jobs_.submit([this, session, msec](const Job&) {
+        renderGrain(*session, msec);
+        grain_busy_.store(false, std::memory_order_release);
+    }, JobPriority::INTERACTIVE);
+}
+
+void ScrubPreview::renderGrain(Session& session, long msec) {
+    int frames = static_cast<int>(session.pool->sampleRate() * GRAIN_MS / 1000);
+    int fade = static_cast<int>(session.pool->sampleRate() * FADE_MS / 1000);
+    std::lock_guard<std::mutex> lock(session.mutex);
+    Music_Emu* emu = session.emulator();
+    if (!emu || session.cancelled.load(std::memory_order_relaxed)) return;
+
+    // The seek may run a snapshot interval ahead and only records state; the
+    // grain itself is heard, so it gets full-quality synthesis
+    gme_seek(emu, msec);
+    session.grain.resize(frames * 2);
+    gme_set_fast_synth(emu, 0);
+    gme_err_t err = gme_play_float(emu, frames * 2, session.grain.data(), 1.0f);
+    gme_set_fast_synth(emu, 1);
+    if (err) return;
+
+    // Grains are cut out of the track, so they fade in and out rather than click
+    float* grain = session.grain.data();
+    for (int i = 0; i < fade && i < frames / 2; ++i) {
+        float gain = i / static_cast<float>(fade);
+        grain[i * 2] *= gain;
+        grain[i * 2 + 1] *= gain;
+        grain[(frames - 1 - i) * 2] *= gain;
+        grain[(frames - 1 - i) * 2 + 1] *= gain;
+    }
+    if (active_.load(std::memory_order_acquire) && !session.cancelled.load(std::memory_order_relaxed)) {
+        ring_.write(grain, frames);
+    }
+}
+
+bool ScrubPreview::read(float* out, int frames) {
+    if (!active_.load(std::memory_order_acquire)) {
+        ring_.discardUntil(ring_.writePosition());  // what the last scrub left unheard
+        return false;
+    }
+    int n = ring_.read(out, frames);
+    std::fill(out + n * 2, out + frames * 2, 0.0f);
+    return true;
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "AudioRing.h"
+#include "JobSystem.h"
+#include "MusicEmuPool.h"
+
+// Audio while the seek bar (or a track overview) is dragged: short grains
+// played from the cursor, where playback itself only seeks once the button
+// is let go. The grains come from an emulator of their own, which a batch
+// job first plays through the track in steps short enough for gme to keep
+// a seek snapshot every Music_Emu::snapshot_interval seconds. A grain then
+// restores the snapshot before the cursor and plays at most one interval
+// to reach it, however far the cursor jumped. One grain job is in flight
+// at a time, and only once the cursor has moved, so holding still is quiet.
+//
+// Main thread, except read(), which is the audio callback's.
+class ScrubPreview {
+public:
+    explicit ScrubPreview(JobSystem& jobs);
+    ~ScrubPreview();
+
+    ScrubPreview(const ScrubPreview&) = delete;
+    ScrubPreview& operator=(const ScrubPreview&) = delete;
+
+    // Index a newly started track on a job; ends a scrub of the old one
+    void prepare(std::shared_ptr<MusicEmuPool> pool, int track, long length_ms);
+    void clear();
+
+    // Every frame the control is held: move the cursor, and play a grain
+    // there once the last one has nearly been heard
+    void move(long msec);
+    // The control was let go: stops the grains, returns where to seek to
+    long end();
+
+    bool active() const { return active_.load(std::memory_order_relaxed); }
+    long cursor() const { return cursor_; }
+
+    // Audio callback: the grains (silence between them) in place of
+    // playback; false, and 'out' untouched, when not scrubbing
+    bool read(float* out, int frames);
+
+private:
+    static constexpr int GRAIN_MS = 70;
+    static constexpr int FADE_MS = 10;
+    static constexpr long INDEX_STEP_MS = 100;   // skips this short aren't muted, so they record snapshots
+    static constexpr int RING_FRAMES = 16384;
+
+    // One track's emulator, shared by the index and grain jobs
+    struct Session {
+        std::shared_ptr<MusicEmuPool> pool;
+        int track = 0;
+        long length_ms = 0;
+        std::atomic<bool> cancelled{false};
+
+        std::mutex mutex;
+        MusicEmuPool::Lease emu;    // opened by whichever job runs first
+        bool failed = false;
+        std::vector<float> grain;
+
+        ~Session();
+        // Must hold mutex; nullptr if the file doesn't load
+        Music_Emu* emulator();
+    };
+
+    int grainFrames() const;
+    void startGrain(long msec);
+    void renderGrain(Session& session, long msec);
+
+    JobSystem& jobs_;
+    std::shared_ptr<Session> session_;
+    JobHandle index_job_;
+
+    std::atomic<bool> active_{false};
+    std::atomic<bool> grain_busy_{false};
+    long cursor_ = 0;
+    long last_grain_ = -1;
+
+    AudioRing ring_;    // grain job -> audio callback
+};
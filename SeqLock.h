@@ -0,0 +1,61 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+// Sequence lock for a small trivially-copyable value.
+// One writer at a time stores whole values; any number of readers copy the
+// latest one without locking, retrying only if a store raced the copy. The
+// payload lives in relaxed atomic words so the racing copy is well defined.
+template <typename T>
+class SeqLock {
+    static_assert(std::is_trivially_copyable<T>::value, "SeqLock payload must be trivially copyable");
+
+public:
+    SeqLock() = default;
+    SeqLock(const SeqLock&) = delete;
+    SeqLock& operator=(const SeqLock&) = delete;
+
+    // Writer side (callers serialize writers themselves)
+    void store(const T& value) {
+        uint32_t words[WORD_COUNT] = {};
+        memcpy(words, &value, sizeof(T));
+
+        uint32_t seq = seq_.load(std::memory_order_relaxed);
+        seq_.store(seq + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        for (size_t i = 0; i < WORD_COUNT; ++i) {
+            words_[i].store(words[i], std::memory_order_relaxed);
+        }
+        seq_.store(seq + 2, std::memory_order_release);
+    }
+
+    // Reader side: copies the latest value and returns its version, which
+    // changes with every store (0 until the first one)
+    uint32_t load(T& out) const {
+        uint32_t words[WORD_COUNT];
+        for (;;) {
+            uint32_t before = seq_.load(std::memory_order_acquire);
+            if (before & 1) continue;
+            for (size_t i = 0; i < WORD_COUNT; ++i) {
+                words[i] = words_[i].load(std::memory_order_relaxed);
+            }
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (seq_.load(std::memory_order_relaxed) == before) {
+                memcpy(&out, words, sizeof(T));
+                return before / 2;
+            }
+        }
+    }
+
+    // Version of the latest value without copying it
+    uint32_t version() const { return seq_.load(std::memory_order_acquire) / 2; }
+
+private:
+    static constexpr size_t WORD_COUNT = (sizeof(T) + sizeof(uint32_t) - 1) / sizeof(uint32_t);
+
+    alignas(64) std::atomic<uint32_t> seq_{0};
+    std::atomic<uint32_t> words_[WORD_COUNT] = {};
+};
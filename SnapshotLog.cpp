@@ -0,0 +1,312 @@
+#include "SnapshotLog.h"
+#include "MappedFile.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <system_error>
+
+namespace {
+
+constexpr int CHANNELS = ApuFrameSnapshot::CHANNELS;
+
+// Entry head byte
+constexpr uint8_t HEAD_ACTIVE = 0x01;
+constexpr uint8_t HEAD_CHIPS = 0x02;  // chips and channel_count follow
+
+// A changed channel's field bits: the integer fields in this order, then frequencies
+int (ApuFrameSnapshot::*const INT_FIELDS[])[CHANNELS] = {
+    &ApuFrameSnapshot::periods, &ApuFrameSnapshot::lengths, &ApuFrameSnapshot::amplitudes, &ApuFrameSnapshot::volumes
+};
+constexpr int INT_FIELD_COUNT = 4;
+constexpr uint8_t FREQUENCY_FIELD = 1 << INT_FIELD_COUNT;
+
+void putVarint(std::vector<uint8_t>& out, uint64_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<uint8_t>(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<uint8_t>(value));
+}
+
+// Zigzag, so small deltas either way fit a byte
+void putSigned(std::vector<uint8_t>& out, int64_t value) {
+    putVarint(out, (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63));
+}
+
+bool getVarint(const uint8_t*& p, const uint8_t* end, uint64_t& value) {
+    value = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        if (p == end) return false;
+        uint8_t byte = *p++;
+        value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) return true;
+    }
+    return false;
+}
+
+bool getSigned(const uint8_t*& p, const uint8_t* end, int64_t& value) {
+    uint64_t bits;
+    if (!getVarint(p, end, bits)) return false;
+    value = static_cast<int64_t>(bits >> 1) ^ -static_cast<int64_t>(bits & 1);
+    return true;
+}
+
+uint32_t floatBits(float value) {
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+} // namespace
+
+void SnapshotLog::clear() {
+    setLayout(0, 0, 0);
+    names_.clear();
+    sample_rate_ = 0;
+    data_.clear();
+    keys_.clear();
+    count_ = 0;
+    session_ = 0;
+    prev_ = ApuFrameSnapshot();
+    prev_ticks_ = 0;
+    prev_session_ = 0;
+    last_frame_ = 0;
+}
+
+void SnapshotLog::setLayout(uint8_t chips, uint8_t unemulated, int voice_count) {
+    if (voice_count > 0) {
+        name_table_.clear();
+        for (const std::string& name : names_) name_table_.push_back(name.c_str());
+        layout_ = ChannelLayout::buildVoices(name_table_.data(), voice_count);
+    } else {
+        layout_ = ChannelLayout::build(chips, unemulated);
+    }
+}
+
+void SnapshotLog::begin(const ChannelLayout& layout, long sample_rate) {
+    clear();
+    sample_rate_ = sample_rate;
+    if (layout.size() > 0 && layout[0].kind == ChannelKind::Voice) {
+        // The names belong to the emulator, which may be gone by replay
+        for (int i = 0; i < layout.size(); ++i) names_.emplace_back(layout[i].name);
+        setLayout(0, 0, layout.size());
+    } else {
+        setLayout(layout.chips, layout.unemulated, 0);
+    }
+}
+
+void SnapshotLog::append(const ApuFrameSnapshot& snapshot, uint64_t frame) {
+    // Output frames since the last entry; a jump either way (seek, track
+    // change, flushed queue) takes no session time
+    if (count_ > 0 && frame >= last_frame_ && frame - last_frame_ <= static_cast<uint64_t>(sample_rate_)) {
+        session_ += frame - last_frame_;
+    }
+    last_frame_ = frame;
+    if (count_ % KEY_INTERVAL == 0) {
+        keys_.push_back({data_.size(), prev_session_, session_});
+        prev_ = ApuFrameSnapshot();
+        prev_ticks_ = 0;
+    }
+
+    int64_t ticks = std::llround(snapshot.time * 1e6);
+    putVarint(data_, session_ - prev_session_);
+    putSigned(data_, ticks - prev_ticks_);
+    bool chips_changed = snapshot.chips != prev_.chips || snapshot.channel_count != prev_.channel_count;
+    data_.push_back((snapshot.active ? HEAD_ACTIVE : 0) | (chips_changed ? HEAD_CHIPS : 0));
+    if (chips_changed) {
+        data_.push_back(snapshot.chips);
+        data_.push_back(static_cast<uint8_t>(snapshot.channel_count));
+    }
+
+    uint8_t fields[CHANNELS];
+    uint32_t changed = 0;
+    for (int ch = 0; ch < CHANNELS; ++ch) {
+        fields[ch] = 0;
+        for (int f = 0; f < INT_FIELD_COUNT; ++f) {
+            if ((snapshot.*INT_FIELDS[f])[ch] != (prev_.*INT_FIELDS[f])[ch]) fields[ch] |= 1 << f;
+        }
+        if (floatBits(snapshot.frequencies[ch]) != floatBits(prev_.frequencies[ch])) fields[ch] |= FREQUENCY_FIELD;
+        if (fields[ch]) changed |= 1u << ch;
+    }
+    putVarint(data_, changed);
+    for (int ch = 0; ch < CHANNELS; ++ch) {
+        if (!fields[ch]) continue;
+        data_.push_back(fields[ch]);
+        for (int f = 0; f < INT_FIELD_COUNT; ++f) {
+            if (fields[ch] & (1 << f)) {
+                putSigned(data_, static_cast<int64_t>((snapshot.*INT_FIELDS[f])[ch]) - (prev_.*INT_FIELDS[f])[ch]);
+            }
+        }
+        if (fields[ch] & FREQUENCY_FIELD) {
+            putVarint(data_, floatBits(snapshot.frequencies[ch]) ^ floatBits(prev_.frequencies[ch]));
+        }
+    }
+
+    prev_ = snapshot;
+    prev_ticks_ = ticks;
+    prev_session_ = session_;
+    count_++;
+}
+
+// Apply the entry at cursor.offset; false if the stream ends or is malformed
+bool SnapshotLog::decode(const uint8_t* end, Cursor& cursor) const {
+    if (cursor.index % KEY_INTERVAL == 0) {
+        cursor.snapshot = ApuFrameSnapshot();
+        cursor.ticks = 0;
+    }
+    const uint8_t* p = data_.data() + cursor.offset;
+    ApuFrameSnapshot& s = cursor.snapshot;
+    uint64_t step, changed;
+    int64_t dt;
+    if (!getVarint(p, end, step) || !getSigned(p, end, dt) || p == end) return false;
+    uint8_t head = *p++;
+    if (head & HEAD_CHIPS) {
+        if (end - p < 2 || p[1] > CHANNELS) return false;
+        s.chips = p[0];
+        s.channel_count = p[1];
+        p += 2;
+    }
+    s.active = (head & HEAD_ACTIVE) != 0;
+    if (!getVarint(p, end, changed) || (changed >> CHANNELS) != 0) return false;
+    for (int ch = 0; ch < CHANNELS; ++ch) {
+        if (!(changed & (1u << ch))) continue;
+        if (p == end) return false;
+        uint8_t fields = *p++;
+        for (int f = 0; f < INT_FIELD_COUNT; ++f) {
+            int64_t delta;
+            if (!(fields & (1 << f))) continue;
+            if (!getSigned(p, end, delta)) return false;
+            int& value = (s.*INT_FIELDS[f])[ch];
+            value = static_cast<int>(value + delta);
+        }
+        if (fields & FREQUENCY_FIELD) {
+            uint64_t bits;
+            if (!getVarint(p, end, bits)) return false;
+            uint32_t freq = floatBits(s.frequencies[ch]) ^ static_cast<uint32_t>(bits);
+            memcpy(&s.frequencies[ch], &freq, sizeof(freq));
+        }
+    }
+    cursor.session += step;
+    cursor.ticks += dt;
+    s.time = static_cast<double>(cursor.ticks) / 1e6;
+    cursor.offset = static_cast<size_t>(p - data_.data());
+    cursor.index++;
+    return true;
+}
+
+bool SnapshotLog::seek(uint64_t frame, Cursor& cursor) const {
+    if (count_ == 0) return false;
+    const uint8_t* end = data_.data() + data_.size();
+
+    // Restart from the last key at or before 'frame' when going back or when
+    // that key is ahead of the cursor
+    auto next_key = std::upper_bound(keys_.begin(), keys_.end(), frame,
+                                     [](uint64_t f, const Key& key) { return f < key.session; });
+    size_t key = next_key == keys_.begin() ? 0 : static_cast<size_t>(next_key - keys_.begin()) - 1;
+    uint32_t key_index = static_cast<uint32_t>(key) * KEY_INTERVAL;
+    if (cursor.index == 0 || frame < cursor.session || key_index >= cursor.index) {
+        cursor = Cursor();
+        cursor.index = key_index;
+        cursor.offset = keys_[key].offset;
+        cursor.session = keys_[key].base;
+        decode(end, cursor);
+    }
+    while (cursor.index < count_) {
+        Cursor next = cursor;
+        if (!decode(end, next) || next.session > frame) break;
+        cursor = next;
+    }
+    return true;
+}
+
+bool SnapshotLog::save(const char* path) const {
+    Header header;
+    memcpy(header.magic, "FCSS", 4);
+    header.version = VERSION;
+    header.sample_rate = static_cast<uint32_t>(sample_rate_);
+    header.count = count_;
+    header.data_size = static_cast<uint32_t>(data_.size());
+    header.names_size = 0;
+    for (const std::string& name : names_) header.names_size += static_cast<uint32_t>(name.size() + 1);
+    header.chips = layout_.chips;
+    header.unemulated = layout_.unemulated;
+    header.voice_count = static_cast<uint8_t>(names_.size());
+    header.reserved = 0;
+    header.length_frames = session_;
+
+    // Write to a temp file and rename so a half-written log never replaces a good one
+    std::string temp_path = std::string(path) + ".tmp";
+    FILE* f = fopen(temp_path.c_str(), "wb");
+    if (!f) return false;
+
+    auto write = [f](const void* data, size_t size) { return size == 0 || fwrite(data, size, 1, f) == 1; };
+    bool ok = write(&header, sizeof(header));
+    for (size_t i = 0; ok && i < names_.size(); ++i) {
+        ok = write(names_[i].c_str(), names_[i].size() + 1);
+    }
+    ok = ok && write(data_.data(), data_.size());
+    ok = (fclose(f) == 0) && ok;
+
+    std::error_code ec;
+    if (ok) {
+        std::filesystem::rename(temp_path, path, ec);
+        ok = !ec;
+    }
+    if (!ok) {
+        std::filesystem::remove(temp_path, ec);
+    }
+    return ok;
+}
+
+bool SnapshotLog::load(const char* path) {
+    clear();
+    MappedFile file;
+    if (!file.open(path) || file.size() < sizeof(Header)) return false;
+
+    Header header;
+    memcpy(&header, file.data(), sizeof(header));
+    if (memcmp(header.magic, "FCSS", 4) != 0 || header.version != VERSION || header.sample_rate == 0 ||
+        header.voice_count > CHANNELS) {
+        return false;
+    }
+    size_t expected = sizeof(Header) + static_cast<size_t>(header.names_size) + header.data_size;
+    if (file.size() != expected) return false;
+
+    const char* names = reinterpret_cast<const char*>(file.data() + sizeof(Header));
+    const char* names_end = names + header.names_size;
+    for (int i = 0; i < header.voice_count; ++i) {
+        const char* nul = static_cast<const char*>(memchr(names, 0, static_cast<size_t>(names_end - names)));
+        if (!nul) {
+            clear();
+            return false;
+        }
+        names_.emplace_back(names, nul);
+        names = nul + 1;
+    }
+    const uint8_t* data = file.data() + sizeof(Header) + header.names_size;
+    data_.assign(data, data + header.data_size);
+
+    // Decode it all once: rebuilds the keys and rejects a damaged stream
+    const uint8_t* end = data_.data() + data_.size();
+    Cursor cursor;
+    for (uint32_t i = 0; i < header.count; ++i) {
+        bool key = i % KEY_INTERVAL == 0;
+        if (key) keys_.push_back({cursor.offset, cursor.session, 0});
+        if (!decode(end, cursor)) {
+            clear();
+            return false;
+        }
+        if (key) keys_.back().session = cursor.session;
+    }
+    if (cursor.offset != data_.size() || cursor.session != header.length_frames) {
+        clear();
+        return false;
+    }
+    sample_rate_ = header.sample_rate;
+    count_ = header.count;
+    session_ = header.length_frames;
+    setLayout(header.chips, header.unemulated, header.voice_count);
+    return true;
+}
@@ -0,0 +1,99 @@
+#pragma once
+
+#include "ApuSnapshot.h"
+#include "ChannelLayout.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// A session's channel states, every ApuFrameSnapshot its player pushed, for
+// driving the channel meters, keyboard and piano roll again later without
+// running an emulator. Each snapshot is stored as varint deltas from the one
+// before (a few bytes per play call while little changes), with a full one
+// every KEY_INTERVAL entries so replay can seek.
+//
+// Entries sit on a session clock of output frames heard. A track change,
+// seek or rewind moves snapshot times but not the session clock, so replay
+// runs in recording order at recording speed. Times keep 1 us resolution.
+//
+// File layout: Header, then the voice names (NUL-terminated, only for
+// buildVoices layouts), then the encoded stream. Key positions are rebuilt by
+// decoding it once on load, which also validates it.
+class SnapshotLog {
+public:
+    static constexpr uint32_t VERSION = 1;
+    static constexpr uint32_t KEY_INTERVAL = 256;
+
+    SnapshotLog() = default;
+    SnapshotLog(const SnapshotLog&) = delete;  // layout_ points into names_
+    SnapshotLog& operator=(const SnapshotLog&) = delete;
+
+    void clear();
+    // Start recording a player whose channels are 'layout', heard at 'sample_rate'
+    void begin(const ChannelLayout& layout, long sample_rate);
+    // 'frame' is the output frame ApuSnapshotQueue stamped the snapshot with
+    void append(const ApuFrameSnapshot& snapshot, uint64_t frame);
+
+    bool empty() const { return count_ == 0; }
+    uint32_t count() const { return count_; }
+    size_t byteSize() const { return data_.size(); }
+    long sampleRate() const { return sample_rate_; }
+    uint64_t lengthFrames() const { return session_; }
+    double duration() const { return sample_rate_ > 0 ? static_cast<double>(session_) / sample_rate_ : 0.0; }
+    const ChannelLayout& layout() const { return layout_; }
+
+    // Position of a sequential reader: forward steps decode one entry each
+    struct Cursor {
+        uint32_t index = 0;      // entries decoded, 0 before the first
+        size_t offset = 0;       // of the next entry in the stream
+        uint64_t session = 0;    // session frame of 'snapshot'
+        int64_t ticks = 0;       // its time in us
+        ApuFrameSnapshot snapshot;
+    };
+    // Move to the last snapshot at or before session frame 'frame' (the first
+    // one when 'frame' is before it). Going back or far ahead restarts from a
+    // key. False if the log is empty.
+    bool seek(uint64_t frame, Cursor& cursor) const;
+
+    bool save(const char* path) const;
+    bool load(const char* path);
+
+private:
+    struct Header {
+        char magic[4];          // "FCSS"
+        uint32_t version;
+        uint32_t sample_rate;
+        uint32_t count;
+        uint32_t data_size;
+        uint32_t names_size;
+        uint8_t chips;          // build() layouts
+        uint8_t unemulated;
+        uint8_t voice_count;    // buildVoices() layouts, 0 otherwise
+        uint8_t reserved;
+        uint64_t length_frames;
+    };
+
+    struct Key {
+        size_t offset;
+        uint64_t base;      // session frame before the entry, which it steps from
+        uint64_t session;   // of the entry
+    };
+
+    void setLayout(uint8_t chips, uint8_t unemulated, int voice_count);
+    bool decode(const uint8_t* end, Cursor& cursor) const;
+
+    ChannelLayout layout_ = ChannelLayout::build(0);
+    std::vector<std::string> names_;          // buildVoices layouts: the voice names
+    std::vector<const char*> name_table_;     // layout_.voice_names
+    long sample_rate_ = 0;
+    std::vector<uint8_t> data_;
+    std::vector<Key> keys_;
+    uint32_t count_ = 0;
+    uint64_t session_ = 0;   // session frame of the last entry
+
+    // Recording state
+    ApuFrameSnapshot prev_;
+    int64_t prev_ticks_ = 0;
+    uint64_t prev_session_ = 0;
+    uint64_t last_frame_ = 0;
+};
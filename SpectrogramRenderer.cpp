@@ -0,0 +1,482 @@
+#include "SpectrogramRenderer.h"
+#include "GpuMemory.h"
+#include <algorithm>
+#include <cstring>
+
+/*
+    Vulkan shaders (SPIR-V 1.4, set/binding layout as sokol-shdc emits it):
+
+    layout(set = 0, binding = 0) uniform vs_params {
+        vec4 rect;
+        vec4 view;      // display width, display height, first and last V
+    };
+    layout(location = 0) in vec2 corner;    // 0-1, y 0 at the top
+    layout(location = 0) out vec2 uv;       // bin, then row within the tile
+    void main() {
+        vec2 p = rect.xy + corner * rect.zw;
+        gl_Position = vec4(((p / view.xy) - 0.5) * vec2(2.0, -2.0), 0.5, 1.0);
+        uv = vec2(1.0 - corner.y, mix(view.z, view.w, corner.x));
+    }
+
+    layout(set = 1, binding = 0) uniform texture2D tile;
+    layout(set = 1, binding = 1) uniform texture2D lut;
+    layout(set = 1, binding = 32) uniform sampler smp;
+    layout(location = 0) in vec2 uv;
+    layout(location = 0) out vec4 frag_color;
+    void main() {
+        float level = texture(sampler2D(tile, smp), uv).x;
+        frag_color = texture(sampler2D(lut, smp),
+                             vec2(level * (255.0 / 256.0) + (0.5 / 256.0), 0.25 + 0.5 * uv.x));
+    }
+
+    A tile is TILE_ROWS high and a bin wide per texel, so U runs up the
+    frequency axis and V along time. The gradient is laid out as
+    SpectrumBarRenderer's, 256 levels by the lowest and highest frequency.
+*/
+
+static const uint8_t _spectrogram_vs_bytecode_spirv[1344] = {
+    0x03,0x02,0x23,0x07,0x00,0x04,0x01,0x00,0x0b,0x00,0x08,0x00,0x39,0x00,0x00,0x00,
+    0x00,0x00,0x00,0x00,0x11,0x00,0x02,0x00,0x01,0x00,0x00,0x00,0x0b,0x00,0x06,0x00,
+    0x01,0x00,0x00,0x00,0x47,0x4c,0x53,0x4c,0x2e,0x73,0x74,0x64,0x2e,0x34,0x35,0x30,
+    0x00,0x00,0x00,0x00,0x0e,0x00,0x03,0x00,0x00,0x00,0x00,0x00,0x01,0x00,0x00,0x00,
+    0x0f,0x00,0x09,0x00,0x00,0x00,0x00,0x00,0x02,0x00,0x00,0x00,0x6d,0x61,0x69,0x6e,
+    0x00,0x00,0x00,0x00,0x0c,0x00,0x00,0x00,0x0e,0x00,0x00,0x00,0x12,0x00,0x00,0x00,
+    0x14,0x00,0x00,0x00,0x47,0x00,0x03,0x00,0x0b,0x00,0x00,0x00,0x02,0x00,0x00,0x00,
+    0x48,0x00,0x05,0x00,0x0b,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x0b,0x00,0x00,0x00,
+    0x00,0x00,0x00,0x00,0x48,0x00,0x05,0x00,0x0b,0x00,0x00,0x00,0x01,0x00,0x00,0x00,
+    0x0b,0x00,0x00,0x00,0x01,0x00,0x00,0x00,0x48,0x00,0x05,0x00,0x0b,0x00,0x00,0x00,
+    0x02,0x00,0x00,0x00,0x0b,0x00,0x00,0x00,0x03,0x00,0x00,0x00,0x48,0x00,0x05,0x00,
+    0x0b,0x00,0x00,0x00,0x03,0x00,0x00,0x00,0x0b,0x00,0x00,0x00,0x04,0x00,0x00,0x00,
+    0x47,0x00,0x04,0x00,0x0e,0x00,0x00,0x00,0x1e,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+    0x47,0x00,0x03,0x00,0x11,0x00,0x00,0x00,0x02,0x00,0x00,0x00,0x48,0x00,0x05,0x00,
+    0x11,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x23,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+    0x48,0x00,0x05,0x00,0x11,0x00,0x00,0x00,0x01,0x00,0x00,0x00,0x23,0x00,0x00,0x00,
+    0x10,0x00,0x00,0x00,0x47,0x00,0x04,0x00,0x12,0x00,0x00,0x00,0x22,0x00,0x00,0x00,
+    0x00,0x00,0x00,0x00,0x47,0x00,0x04,0x00,0x12,0x00,0x00,0x00,0x21,0x00,0x00,0x00,
+    0x00,0x00,0x00,0x00,0x47,0x00,0x04,0x00,0x14,0x00,0x00,0x00,0x1e,0x00,0x00,0x00,
+    0x00,0x00,0x00,0x00,0x16,0x00,0x03,0x00,0x03,0x00,0x00,0x00,0x20,0x00,0x00,0x00,
+    0x17,0x00,0x04,0x00,0x04,0x00,0x00,0x00,0x03,0x00,0x00,0x00,0x02,0x00,0x00,0x00,
+    0x17,0x00,0x04,0x00,0x05,0x00,0x00,0x00,0x03,0x00,0x00,0x00,0x04,0x00,0x00,0x00,
+    0x13,0x00,0x02,0x00,0x06,0x00,0x00,0x00,0x21,0x00,0x03,0x00,0x07,0x00,0x00,0x00,
+    0x06,0x00,0x00,0x00,0x15,0x00,0x04,0x00,0x08,0x00,0x00,0x00,0x20,0x00,0x00,0x00,
+    0x00,0x00,0x00,0x00,0x2b,0x00,0x04,0x00,0x08,0x00,0x00,0x00,0x09,0x00,0x00,0x00,
+    0x01,0x00,0x00,0x00,0x1c,0x00,0x04,0x00,0x0a,0x00,0x00,0x00,0x03,0x00,0x00,0x00,
+    0x09,0x00,0x00,0x00,0x1e,0x00,0x06,0x00,0x0b,0x00,0x00,0x00,0x05,0x00,0x00,0x00,
+    0x03,0x00,0x00,0x00,0x0a,0x00,0x00,0x00,0x0a,0x00,0x00,0x00,0x20,0x00,0x04,0x00,
+    0x0d,0x00,0x00,0x00,0x03,0x00,0x00,0x00,0x0b,0x00,0x00,0x00,0x3b,0x00,0x04,0x00,
+    0x0d,0x00,0x00,0x00,0x0c,0x00,0x00,0x00,0x03,0x00,0x00,0x00,0x20,0x00,0x04,0x00,
+    0x0f,0x00,0x00,0x00,0x01,0x00,0x00,0x00,0x04,0x00,0x00,0x00,0x3b,0x00,0x04,0x00,
+    0x0f,0x00,0x00,0x00,0x0e,0x00,0x00,0x00,0x01,0x00,0x00,0x00,0x15,0x00,0x04,0x00,
+    0x10,0x00,0x00,0x00,0x20,0x00,0x00,0x00,0x01,0x00,0x00,0x00,0x1e,0x00,0x04,0x00,
+    0x11,0x00,0x00,0x00,0x05,0x00,0x00,0x00,0x05,0x00,0x00,0x00,0x20,0x00,0x04,0x00,
+    0x13,0x00,0x00,0x00,0x02,0x00,0x00,0x00,0x11,0x00,0x00,0x00,0x3b,0x00,0x04,0x00,
+    0x13,0x00,0x00,0x00,0x12,0x00,0x00,0x00,0x02,0x00,0x00,0x00,0x20,0x00,0x04,0x00,
+    0x15,0x00,0x00,0x00,0x03,0x00,0x00,0x00,0x04,0x00,0x00,0x00,0x3b,0x00,0x04,0x00,
+    0x15,0x00,0x00,0x00,0x14,0x00,0x00,0x00,0x03,0x00,0x00,0x00,0x20,0x00,0x04,0x00,
+    0x16,0x00,0x00,0x00,0x02,0x00,0x00,0x00,0x05,0x00,0x00,0x00,0x2b,0x00,0x04,0x00,
+    0x10,0x00,0x00,0x00,0x17,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x2b,0x00,0x04,0x00,
+    0x10,0x00,0x00,0x00,0x1a,0x00,0x00,0x00,0x01,0x00,0x00,0x00,0x2b,0x00,0x04,0x00,
+    0x03,0x00,0x00,0x00,0x26,0x00,0x00,0x00,0x00,0x00,0x00,0x3f,0x2c,0x00,0x05,0x00,
+    0x04,0x00,0x00,0x00,0x27,0x00,0x00,0x00,0x26,0x00,0x00,0x00,0x26,0x00,0x00,0x00,
+    0x2b,0x00,0x04,0x00,0x03,0x00,0x00,0x00,0x29,0x00,0x00,0x00,0x00,0x00,0x00,0x40,
+    0x2b,0x00,0x04,0x00,0x03,0x00,0x00,0x00,0x2a,0x00,0x00,0x00,0x00,0x00,0x00,0xc0,
+    0x2c,0x00,0x05,0x00,0x04,0x00,0x00,0x00,0x2b,0x00,0x00,0x00,0x29,0x00,0x00,0x00,
+    0x2a,0x00,0x00,0x00,0x2b,0x00,0x04,0x00,0x03,0x00,0x00,0x00,0x2f,0x00,0x00,0x00,
+    0x00,0x00,0x80,0x3f,0x20,0x00,0x04,0x00,0x31,0x00,0x00,0x00,0x03,0x00,0x00,0x00,
+    0x05,0x00,0x00,0x00,0x36,0x00,0x05,0x00,0x06,0x00,0x00,0x00,0x02,0x00,0x00,0x00,
+    0x00,0x00,0x00,0x00,0x07,0x00,0x00,0x00,0xf8,0x00,0x02,0x00,0x38,0x00,0x00,0x00,
+    0x41,0x00,0x05,0x00,0x16,0x00,0x00,0x00,0x18,0x00,0x00,0x00,0x12,0x00,0x00,0x00,
+    0x17,0x00,0x00,0x00,0x3d,0x00,0x04,0x00,0x05,0x00,0x00,0x00,0x19,0x00,0x00,0x00,
+    0x18,0x00,0x00,0x00,0x41,0x00,0x05,0x00,0x16,0x00,0x00,0x00,0x1b,0x00,0x00,0x00,
+    0x12,0x00,0x00,0x00,0x1a,0x00,0x00,0x00,0x3d,0x00,0x04,0x00,0x05,0x00,0x00,0x00,
+    0x1c,0x00,0x00,0x00,0x1b,0x00,0x00,0x00,0x3d,0x00,0x04,0x00,0x04,0x00,0x00,0x00,
+    0x1d,0x00,0x00,0x00,0x0e,0x00,0x00,0x00,0x51,0x00,0x05,0x00,0x03,0x00,0x00,0x00,
+    0x1e,0x00,0x00,0x00,0x1d,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x51,0x00,0x05,0x00,
+    0x03,0x00,0x00,0x00,0x1f,0x00,0x00,0x00,0x1d,0x00,0x00,0x00,0x01,0x00,0x00,0x00,
+    0x4f,0x00,0x07,0x00,0x04,0x00,0x00,0x00,0x20,0x00,0x00,0x00,0x19,0x00,0x00,0x00,
+    0x19,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x01,0x00,0x00,0x00,0x4f,0x00,0x07,0x00,
+    0x04,0x00,0x00,0x00,0x21,0x00,0x00,0x00,0x19,0x00,0x00,0x00,0x19,0x00,0x00,0x00,
+    0x02,0x00,0x00,0x00,0x03,0x00,0x00,0x00,0x85,0x00,0x05,0x00,0x04,0x00,0x00,0x00,
+    0x22,0x00,0x00,0x00,0x1d,0x00,0x00,0x00,0x21,0x00,0x00,0x00,0x81,0x00,0x05,0x00,
+    0x04,0x00,0x00,0x00,0x23,0x00,0x00,0x00,0x20,0x00,0x00,0x00,0x22,0x00,0x00,0x00,
+    0x4f,0x00,0x07,0x00,0x04,0x00,0x00,0x00,0x24,0x00,0x00,0x00,0x1c,0x00,0x00,0x00,
+    0x1c,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x01,0x00,0x00,0x00,0x88,0x00,0x05,0x00,
+    0x04,0x00,0x00,0x00,0x25,0x00,0x00,0x00,0x23,0x00,0x00,0x00,0x24,0x00,0x00,0x00,
+    0x83,0x00,0x05,0x00,0x04,0x00,0x00,0x00,0x28,0x00,0x00,0x00,0x25,0x00,0x00,0x00,
+    0x27,0x00,0x00,0x00,0x85,0x00,0x05,0x00,0x04,0x00,0x00,0x00,0x2c,0x00,0x00,0x00,
+    0x28,0x00,0x00,0x00,0x2b,0x00,0x00,0x00,0x51,0x00,0x05,0x00,0x03,0x00,0x00,0x00,
+    0x2d,0x00,0x00,0x00,0x2c,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x51,0x00,0x05,0x00,
+    0x03,0x00,0x00,0x00,0x2e,0x00,0x00,0x00,0x2c,0x00,0x00,0x00,0x01,0x00,0x00,0x00,
+    0x50,0x00,0x07,0x00,0x05,0x00,0x00,0x00,0x30,0x00,0x00,0x00,0x2d,0x00,0x00,0x00,
+    0x2e,0x00,0x00,0x00,0x26,0x00,0x00,0x00,0x2f,0x00,0x00,0x00,0x41,0x00,0x05,0x00,
+    0x31,0x00,0x00,0x00,0x32,0x00,0x00,0x00,0x0c,0x00,0x00,0x00,0x17,0x00,0x00,0x00,
+    0x3e,0x00,0x03,0x00,0x32,0x00,0x00,0x00,0x30,0x00,0x00,0x00,0x83,0x00,0x05,0x00,
+    0x03,0x00,0x00,0x00,0x33,0x00,0x00,0x00,0x2f,0x00,0x00,0x00,0x1f,0x00,0x00,0x00,
+    0x51,0x00,0x05,0x00,0x03,0x00,0x00,0x00,0x34,0x00,0x00,0x00,0x1c,0x00,0x00,0x00,
+    0x02,0x00,0x00,0x00,0x51,0x00,0x05,0x00,0x03,0x00,0x00,0x00,0x35,0x00,0x00,0x00,
+    0x1c,0x00,0x00,0x00,0x03,0x00,0x00,0x00,0x0c,0x00,0x08,0x00,0x03,0x00,0x00,0x00,
+    0x36,0x00,0x00,0x00,0x01,0x00,0x00,0x00,0x2e,0x00,0x00,0x00,0x34,0x00,0x00,0x00,
+    0x35,0x00,0x00,0x00,0x1e,0x00,0x00,0x00,0x50,0x00,0x05,0x00,0x04,0x00,0x00,0x00,
+    0x37,0x00,0x00,0x00,0x33,0x00,0x00,0x00,0x36,0x00,0x00,0x00,0x3e,0x00,0x03,0x00,
+    0x14,0x00,0x00,0x00,0x37,0x00,0x00,0x00,0xfd,0x00,0x01,0x00,0x38,0x00,0x01,0x00,
+};
+
+static const uint8_t _spectrogram_fs_bytecode_spirv[904] = {
+    0x03,0x02,0x23,0x07,0x00,0x04,0x01,0x00,0x0b,0x00,0x08,0x00,0x28,0x00,0x00,0x00,
+    0x00,0x00,0x00,0x00,0x11,0x00,0x02,0x00,0x01,0x00,0x00,0x00,0x0b,0x00,0x06,0x00,
+    0x01,0x00,0x00,0x00,0x47,0x4c,0x53,0x4c,0x2e,0x73,0x74,0x64,0x2e,0x34,0x35,0x30,
+    0x00,0x00,0x00,0x00,0x0e,0x00,0x03,0x00,0x00,0x00,0x00,0x00,0x01,0x00,0x00,0x00,
+    0x0f,0x00,0x0a,0x00,0x04,0x00,0x00,0x00,0x02,0x00,0x00,0x00,0x6d,0x61,0x69,0x6e,
+    0x00,0x00,0x00,0x00,0x0b,0x00,0x00,0x00,0x0d,0x00,0x00,0x00,0x0f,0x00,0x00,0x00,
+    0x11,0x00,0x00,0x00,0x12,0x00,0x00,0x00,0x10,0x00,0x03,0x00,0x02,0x00,0x00,0x00,
+    0x07,0x00,0x00,0x00,0x47,0x00,0x04,0x00,0x0b,0x00,0x00,0x00,0x1e,0x00,0x00,0x00,
+    0x00,0x00,0x00,0x00,0x47,0x00,0x04,0x00,0x0d,0x00,0x00,0x00,0x1e,0x00,0x00,0x00,
+    0x00,0x00,0x00,0x00,0x47,0x00,0x04,0x00,0x0f,0x00,0x00,0x00,0x22,0x00,0x00,0x00,
+    0x01,0x00,0x00,0x00,0x47,0x00,0x04,0x00,0x0f,0x00,0x00,0x00,0x21,0x00,0x00,0x00,
+    0x00,0x00,0x00,0x00,0x47,0x00,0x04,0x00,0x11,0x00,0x00,0x00,0x22,0x00,0x00,0x00,
+    0x01,0x00,0x00,0x00,0x47,0x00,0x04,0x00,0x11,0x00,0x00,0x00,0x21,0x00,0x00,0x00,
+    0x01,0x00,0x00,0x00,0x47,0x00,0x04,0x00,0x12,0x00,0x00,0x00,0x22,0x00,0x00,0x00,
+    0x01,0x00,0x00,0x00,0x47,0x00,0x04,0x00,0x12,0x00,0x00,0x00,0x21,0x00,0x00,0x00,
+    0x20,0x00,0x00,0x00,0x16,0x00,0x03,0x00,0x03,0x00,0x00,0x00,0x20,0x00,0x00,0x00,
+    0x17,0x00,0x04,0x00,0x04,0x00,0x00,0x00,0x03,0x00,0x00,0x00,0x02,0x00,0x00,0x00,
+    0x17,0x00,0x04,0x00,0x05,0x00,0x00,0x00,0x03,0x00,0x00,0x00,0x04,0x00,0x00,0x00,
+    0x13,0x00,0x02,0x00,0x06,0x00,0x00,0x00,0x21,0x00,0x03,0x00,0x07,0x00,0x00,0x00,
+    0x06,0x00,0x00,0x00,0x19,0x00,0x09,0x00,0x08,0x00,0x00,0x00,0x03,0x00,0x00,0x00,
+    0x01,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+    0x01,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x1a,0x00,0x02,0x00,0x09,0x00,0x00,0x00,
+    0x1b,0x00,0x03,0x00,0x0a,0x00,0x00,0x00,0x08,0x00,0x00,0x00,0x20,0x00,0x04,0x00,
+    0x0c,0x00,0x00,0x00,0x03,0x00,0x00,0x00,0x05,0x00,0x00,0x00,0x3b,0x00,0x04,0x00,
+    0x0c,0x00,0x00,0x00,0x0b,0x00,0x00,0x00,0x03,0x00,0x00,0x00,0x20,0x00,0x04,0x00,
+    0x0e,0x00,0x00,0x00,0x01,0x00,0x00,0x00,0x04,0x00,0x00,0x00,0x3b,0x00,0x04,0x00,
+    0x0e,0x00,0x00,0x00,0x0d,0x00,0x00,0x00,0x01,0x00,0x00,0x00,0x20,0x00,0x04,0x00,
+    0x10,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x08,0x00,0x00,0x00,0x3b,0x00,0x04,0x00,
+    0x10,0x00,0x00,0x00,0x0f,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x3b,0x00,0x04,0x00,
+    0x10,0x00,0x00,0x00,0x11,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x20,0x00,0x04,0x00,
+    0x13,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x09,0x00,0x00,0x00,0x3b,0x00,0x04,0x00,
+    0x13,0x00,0x00,0x00,0x12,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x2b,0x00,0x04,0x00,
+    0x03,0x00,0x00,0x00,0x1a,0x00,0x00,0x00,0x00,0x00,0x7f,0x3f,0x2b,0x00,0x04,0x00,
+    0x03,0x00,0x00,0x00,0x1c,0x00,0x00,0x00,0x00,0x00,0x00,0x3b,0x2b,0x00,0x04,0x00,
+    0x03,0x00,0x00,0x00,0x1e,0x00,0x00,0x00,0x00,0x00,0x80,0x3e,0x2b,0x00,0x04,0x00,
+    0x03,0x00,0x00,0x00,0x1f,0x00,0x00,0x00,0x00,0x00,0x00,0x3f,0x36,0x00,0x05,0x00,
+    0x06,0x00,0x00,0x00,0x02,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x07,0x00,0x00,0x00,
+    0xf8,0x00,0x02,0x00,0x27,0x00,0x00,0x00,0x3d,0x00,0x04,0x00,0x04,0x00,0x00,0x00,
+    0x14,0x00,0x00,0x00,0x0d,0x00,0x00,0x00,0x3d,0x00,0x04,0x00,0x09,0x00,0x00,0x00,
+    0x15,0x00,0x00,0x00,0x12,0x00,0x00,0x00,0x3d,0x00,0x04,0x00,0x08,0x00,0x00,0x00,
+    0x16,0x00,0x00,0x00,0x0f,0x00,0x00,0x00,0x56,0x00,0x05,0x00,0x0a,0x00,0x00,0x00,
+    0x17,0x00,0x00,0x00,0x16,0x00,0x00,0x00,0x15,0x00,0x00,0x00,0x57,0x00,0x05,0x00,
+    0x05,0x00,0x00,0x00,0x18,0x00,0x00,0x00,0x17,0x00,0x00,0x00,0x14,0x00,0x00,0x00,
+    0x51,0x00,0x05,0x00,0x03,0x00,0x00,0x00,0x19,0x00,0x00,0x00,0x18,0x00,0x00,0x00,
+    0x00,0x00,0x00,0x00,0x85,0x00,0x05,0x00,0x03,0x00,0x00,0x00,0x1b,0x00,0x00,0x00,
+    0x19,0x00,0x00,0x00,0x1a,0x00,0x00,0x00,0x81,0x00,0x05,0x00,0x03,0x00,0x00,0x00,
+    0x1d,0x00,0x00,0x00,0x1b,0x00,0x00,0x00,0x1c,0x00,0x00,0x00,0x51,0x00,0x05,0x00,
+    0x03,0x00,0x00,0x00,0x20,0x00,0x00,0x00,0x14,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+    0x85,0x00,0x05,0x00,0x03,0x00,0x00,0x00,0x21,0x00,0x00,0x00,0x1f,0x00,0x00,0x00,
+    0x20,0x00,0x00,0x00,0x81,0x00,0x05,0x00,0x03,0x00,0x00,0x00,0x22,0x00,0x00,0x00,
+    0x1e,0x00,0x00,0x00,0x21,0x00,0x00,0x00,0x3d,0x00,0x04,0x00,0x08,0x00,0x00,0x00,
+    0x23,0x00,0x00,0x00,0x11,0x00,0x00,0x00,0x56,0x00,0x05,0x00,0x0a,0x00,0x00,0x00,
+    0x24,0x00,0x00,0x00,0x23,0x00,0x00,0x00,0x15,0x00,0x00,0x00,0x50,0x00,0x05,0x00,
+    0x04,0x00,0x00,0x00,0x25,0x00,0x00,0x00,0x1d,0x00,0x00,0x00,0x22,0x00,0x00,0x00,
+    0x57,0x00,0x05,0x00,0x05,0x00,0x00,0x00,0x26,0x00,0x00,0x00,0x24,0x00,0x00,0x00,
+    0x25,0x00,0x00,0x00,0x3e,0x00,0x03,0x00,0x0b,0x00,0x00,0x00,0x26,0x00,0x00,0x00,
+    0xfd,0x00,0x01,0x00,0x38,0x00,0x01,0x00,
+};
+
+static const char _spectrogram_vs_source_metal[] =
+    "#include <metal_stdlib>\n"
+    "using namespace metal;\n"
+    "struct vs_params { float4 rect; float4 view; };\n"
+    "struct vs_in { float2 corner [[attribute(0)]]; };\n"
+    "struct vs_out {\n"
+    "    float4 pos [[position]];\n"
+    "    float2 uv [[user(locn0)]];\n"
+    "};\n"
+    "vertex vs_out main0(vs_in in [[stage_in]], constant vs_params& u [[buffer(0)]]) {\n"
+    "    vs_out out;\n"
+    "    float2 p = u.rect.xy + in.corner * u.rect.zw;\n"
+    "    out.pos = float4(((p / u.view.xy) - 0.5) * float2(2.0, -2.0), 0.5, 1.0);\n"
+    "    out.uv = float2(1.0 - in.corner.y, mix(u.view.z, u.view.w, in.corner.x));\n"
+    "    return out;\n"
+    "}\n";
+
+static const char _spectrogram_fs_source_metal[] =
+    "#include <metal_stdlib>\n"
+    "using namespace metal;\n"
+    "struct fs_in { float2 uv [[user(locn0)]]; };\n"
+    "fragment float4 main0(fs_in in [[stage_in]], texture2d<float> tile [[texture(0)]],\n"
+    "                      texture2d<float> lut [[texture(1)]], sampler smp [[sampler(0)]]) {\n"
+    "    float level = tile.sample(smp, in.uv).x;\n"
+    "    return lut.sample(smp, float2(level * (255.0 / 256.0) + (0.5 / 256.0), 0.25 + 0.5 * in.uv.x));\n"
+    "}\n";
+
+static bool spectrogramShaderDesc(sg_shader_desc& desc) {
+    desc = {};
+    switch (sg_query_backend()) {
+        case SG_BACKEND_VULKAN:
+            desc.vertex_func.bytecode = SG_RANGE(_spectrogram_vs_bytecode_spirv);
+            desc.vertex_func.entry = "main";
+            desc.fragment_func.bytecode = SG_RANGE(_spectrogram_fs_bytecode_spirv);
+            desc.fragment_func.entry = "main";
+            break;
+        case SG_BACKEND_METAL_MACOS:
+        case SG_BACKEND_METAL_IOS:
+        case SG_BACKEND_METAL_SIMULATOR:
+            desc.vertex_func.source = _spectrogram_vs_source_metal;
+            desc.vertex_func.entry = "main0";
+            desc.fragment_func.source = _spectrogram_fs_source_metal;
+            desc.fragment_func.entry = "main0";
+            break;
+        default:
+            return false;
+    }
+
+    desc.attrs[0].base_type = SG_SHADERATTRBASETYPE_FLOAT;
+    desc.uniform_blocks[0].stage = SG_SHADERSTAGE_VERTEX;
+    desc.uniform_blocks[0].size = 32;
+    desc.uniform_blocks[0].msl_buffer_n = 0;
+    desc.uniform_blocks[0].spirv_set0_binding_n = 0;
+    for (int i = 0; i < 2; ++i) {
+        desc.views[i].texture.stage = SG_SHADERSTAGE_FRAGMENT;
+        desc.views[i].texture.image_type = SG_IMAGETYPE_2D;
+        desc.views[i].texture.sample_type = SG_IMAGESAMPLETYPE_FLOAT;
+        desc.views[i].texture.msl_texture_n = static_cast<uint8_t>(i);
+        desc.views[i].texture.spirv_set1_binding_n = static_cast<uint8_t>(i);
+        desc.texture_sampler_pairs[i].stage = SG_SHADERSTAGE_FRAGMENT;
+        desc.texture_sampler_pairs[i].view_slot = static_cast<uint8_t>(i);
+        desc.texture_sampler_pairs[i].sampler_slot = 0;
+    }
+    desc.samplers[0].stage = SG_SHADERSTAGE_FRAGMENT;
+    desc.samplers[0].sampler_type = SG_SAMPLERTYPE_FILTERING;
+    desc.samplers[0].msl_sampler_n = 0;
+    desc.samplers[0].spirv_set1_binding_n = 32;
+    desc.label = "spectrogram-shader";
+    return true;
+}
+
+bool SpectrogramRenderer::init(Gradient gradient) {
+    if (valid_) return true;
+
+    sg_shader_desc shd_desc;
+    if (!spectrogramShaderDesc(shd_desc)) return false;
+
+    shader_ = sg_make_shader(&shd_desc);
+    if (sg_query_shader_state(shader_) != SG_RESOURCESTATE_VALID) {
+        sg_destroy_shader(shader_);
+        shader_ = {};
+        return false;
+    }
+
+    // The gradient at every level for the lowest and the highest frequency;
+    // level 0 stays black, as in the waterfall
+    ImU32 pixels[2][GRADIENT_LEVELS];
+    for (int row = 0; row < 2; ++row) {
+        pixels[row][0] = IM_COL32(0, 0, 0, 255);
+        for (int level = 1; level < GRADIENT_LEVELS; ++level) {
+            pixels[row][level] = gradient(level / static_cast<float>(GRADIENT_LEVELS - 1), static_cast<float>(row));
+        }
+    }
+    sg_image_desc img_desc = {};
+    img_desc.width = GRADIENT_LEVELS;
+    img_desc.height = 2;
+    img_desc.pixel_format = SG_PIXELFORMAT_RGBA8;
+    img_desc.data.mip_levels[0] = SG_RANGE(pixels);
+    img_desc.label = "spectrogram-gradient";
+    gradient_ = MakeGpuImage(&img_desc);
+
+    sg_view_desc view_desc = {};
+    view_desc.texture.image = gradient_;
+    gradient_view_ = sg_make_view(&view_desc);
+
+    // Linear in both directions: levels blend between bins and rows, and
+    // the gradient between its two frequency rows
+    sg_sampler_desc smp_desc = {};
+    smp_desc.min_filter = SG_FILTER_LINEAR;
+    smp_desc.mag_filter = SG_FILTER_LINEAR;
+    smp_desc.wrap_u = SG_WRAP_CLAMP_TO_EDGE;
+    smp_desc.wrap_v = SG_WRAP_CLAMP_TO_EDGE;
+    sampler_ = sg_make_sampler(&smp_desc);
+
+    const float corners[] = {
+        0.0f, 0.0f,  1.0f, 0.0f,  0.0f, 1.0f,
+        1.0f, 0.0f,  1.0f, 1.0f,  0.0f, 1.0f,
+    };
+    sg_buffer_desc buf_desc = {};
+    buf_desc.data = SG_RANGE(corners);
+    buf_desc.label = "spectrogram-corners";
+    corners_ = sg_make_buffer(&buf_desc);
+
+    // Drawn inside sokol_imgui's pass, so color and depth formats are the swapchain defaults
+    sg_pipeline_desc pip_desc = {};
+    pip_desc.shader = shader_;
+    pip_desc.layout.attrs[0].format = SG_VERTEXFORMAT_FLOAT2;
+    pip_desc.label = "spectrogram-pipeline";
+    pipeline_ = sg_make_pipeline(&pip_desc);
+
+    valid_ = sg_query_pipeline_state(pipeline_) == SG_RESOURCESTATE_VALID &&
+             sg_query_image_state(gradient_) == SG_RESOURCESTATE_VALID &&
+             sg_query_buffer_state(corners_) == SG_RESOURCESTATE_VALID;
+    if (!valid_) {
+        shutdown();
+        return false;
+    }
+    return true;
+}
+
+void SpectrogramRenderer::shutdown() {
+    destroyTiles();
+    sg_destroy_pipeline(pipeline_);
+    sg_destroy_shader(shader_);
+    sg_destroy_sampler(sampler_);
+    sg_destroy_view(gradient_view_);
+    DestroyGpuImage(gradient_);
+    sg_destroy_buffer(corners_);
+    pipeline_ = {};
+    shader_ = {};
+    sampler_ = {};
+    gradient_view_ = {};
+    gradient_ = {};
+    corners_ = {};
+    valid_ = false;
+}
+
+void SpectrogramRenderer::createTiles(int bins) {
+    destroyTiles();
+    bins_ = bins;
+    levels_.assign(static_cast<size_t>(CAPACITY) * bins_, 0);
+    for (int i = 0; i < TILES; ++i) {
+        sg_image_desc img_desc = {};
+        img_desc.width = bins_;
+        img_desc.height = TILE_ROWS;
+        img_desc.pixel_format = SG_PIXELFORMAT_R8;
+        img_desc.usage.stream_update = true;
+        img_desc.label = "spectrogram-tile";
+        tiles_[i] = MakeGpuImage(&img_desc);
+        sg_view_desc view_desc = {};
+        view_desc.texture.image = tiles_[i];
+        tile_views_[i] = sg_make_view(&view_desc);
+    }
+}
+
+void SpectrogramRenderer::destroyTiles() {
+    for (int i = 0; i < TILES; ++i) {
+        sg_destroy_view(tile_views_[i]);
+        DestroyGpuImage(tiles_[i]);
+        tile_views_[i] = {};
+        tiles_[i] = {};
+    }
+    levels_.clear();
+    bins_ = 0;
+    dirty_ = 0;
+}
+
+void SpectrogramRenderer::clear() {
+    first_row_ = rows_;
+}
+
+void SpectrogramRenderer::append(const uint8_t* ring, int ring_rows, int bins, uint64_t rows) {
+    if (!valid_ || bins <= 0 || ring_rows <= 0) return;
+    if (bins != bins_) {
+        createTiles(bins);
+        rows_ = rows;
+        first_row_ = rows;
+        return;
+    }
+    if (rows < rows_) {
+        rows_ = rows;
+        first_row_ = rows;
+        return;
+    }
+
+    // Rows the ring no longer holds are left blank
+    uint64_t available = rows > static_cast<uint64_t>(ring_rows) ? rows - ring_rows : 0;
+    for (uint64_t r = rows_; r < rows; ++r) {
+        int slot = static_cast<int>(r % CAPACITY);
+        uint8_t* dest = &levels_[static_cast<size_t>(slot) * bins_];
+        if (r >= available) {
+            memcpy(dest, ring + (r % ring_rows) * bins_, bins_);
+        } else {
+            memset(dest, 0, bins_);
+        }
+        dirty_ |= 1u << (slot / TILE_ROWS);
+    }
+    rows_ = rows;
+}
+
+uint64_t SpectrogramRenderer::oldestRow() const {
+    // Starting the tile being written dropped the oldest tile's rows
+    uint64_t tiles_started = (rows_ + TILE_ROWS - 1) / TILE_ROWS;
+    uint64_t kept = tiles_started > TILES ? (tiles_started - TILES) * TILE_ROWS : 0;
+    return std::max(kept, first_row_);
+}
+
+int SpectrogramRenderer::keptRows() const {
+    return static_cast<int>(rows_ - oldestRow());
+}
+
+void SpectrogramRenderer::draw(ImDrawList* draw_list, ImVec2 pos, ImVec2 size, int span) {
+    if (!valid_ || bins_ == 0) return;
+
+    // Stream images take one update per frame; the tile being written is
+    // usually the only one
+    for (int i = 0; i < TILES; ++i) {
+        if (!(dirty_ & (1u << i))) continue;
+        sg_image_data data = {};
+        data.mip_levels[0].ptr = &levels_[static_cast<size_t>(i) * TILE_ROWS * bins_];
+        data.mip_levels[0].size = static_cast<size_t>(TILE_ROWS) * bins_;
+        sg_update_image(tiles_[i], &data);
+    }
+    dirty_ = 0;
+
+    if (span <= 0 || rows_ == oldestRow()) return;
+    DrawData data = { this, pos, size, span };
+    draw_list->PushClipRect(pos, ImVec2(pos.x + size.x, pos.y + size.y), true);
+    draw_list->AddCallback(drawCallback, &data, sizeof(data));
+    draw_list->PopClipRect();
+}
+
+void SpectrogramRenderer::drawCallback(const ImDrawList* list, const ImDrawCmd* cmd) {
+    (void)list;
+    const DrawData* data = static_cast<const DrawData*>(cmd->UserCallbackData);
+    data->self->render(*data, cmd->ClipRect);
+}
+
+void SpectrogramRenderer::render(const DrawData& data, const ImVec4& clip_rect) {
+    if (!valid_ || bins_ == 0) return;
+    if (clip_rect.z <= clip_rect.x || clip_rect.w <= clip_rect.y) return;
+
+    const ImGuiIO& io = ImGui::GetIO();
+    ImVec2 scale = io.DisplayFramebufferScale;
+    sg_apply_viewport(0, 0, static_cast<int>(io.DisplaySize.x * scale.x),
+                      static_cast<int>(io.DisplaySize.y * scale.y), true);
+    sg_apply_scissor_rect(static_cast<int>(clip_rect.x * scale.x), static_cast<int>(clip_rect.y * scale.y),
+                          static_cast<int>((clip_rect.z - clip_rect.x) * scale.x),
+                          static_cast<int>((clip_rect.w - clip_rect.y) * scale.y), true);
+    sg_apply_pipeline(pipeline_);
+
+    // One quad per tile holding some of the span, placed by row
+    uint64_t span = static_cast<uint64_t>(data.span);
+    uint64_t first = std::max(oldestRow(), rows_ > span ? rows_ - span : 0);
+    float row_width = data.size.x / static_cast<float>(data.span);
+    float right = data.pos.x + data.size.x;
+    for (uint64_t begin = first; begin < rows_;) {
+        uint64_t tile_first = begin / TILE_ROWS * TILE_ROWS;
+        uint64_t end = std::min(rows_, tile_first + TILE_ROWS);
+        int tile = static_cast<int>((tile_first / TILE_ROWS) % TILES);
+
+        sg_bindings bind = {};
+        bind.vertex_buffers[0] = corners_;
+        bind.views[0] = tile_views_[tile];
+        bind.views[1] = gradient_view_;
+        bind.samplers[0] = sampler_;
+        sg_apply_bindings(&bind);
+
+        float left = right - static_cast<float>(rows_ - begin) * row_width;
+        Params params = {
+            { left, data.pos.y, static_cast<float>(end - begin) * row_width, data.size.y },
+            { io.DisplaySize.x, io.DisplaySize.y,
+              static_cast<float>(begin - tile_first) / TILE_ROWS, static_cast<float>(end - tile_first) / TILE_ROWS }
+        };
+        sg_apply_uniforms(0, SG_RANGE(params));
+        sg_draw(0, 6, 1);
+        begin = end;
+    }
+}
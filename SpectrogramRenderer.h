@@ -0,0 +1,85 @@
+#pragma once
+
+#include "sokol_gfx.h"
+#include "imgui.h"
+#include <cstdint>
+#include <vector>
+
+// Minutes of spectrogram: every history row the analysis graph produces,
+// kept on the GPU as 8-bit levels rather than colors and turned into color
+// by the fragment shader from a gradient texture, so a row costs one byte
+// per bin. sokol can only replace a whole image, so the ring is cut into
+// TILES images of TILE_ROWS rows; a frame uploads just the tiles that got
+// rows (usually one), and the ring wraps by tile. Drawn like
+// SpectrumBarRenderer, from an ImDrawList callback inside sokol_imgui's
+// pass: one quad per tile in view, time running left to right.
+class SpectrogramRenderer {
+public:
+    static constexpr int TILE_ROWS = 512;
+    static constexpr int TILES = 32;
+    static constexpr int CAPACITY = TILE_ROWS * TILES;   // rows kept, 2+ min at 120 rows/s
+    static constexpr int GRADIENT_LEVELS = 256;
+
+    // Color for a level and a frequency position, both 0-1; sampled at
+    // freq 0 and 1, so it has to be linear in freq
+    using Gradient = ImU32 (*)(float level, float freq);
+
+    SpectrogramRenderer() = default;
+    ~SpectrogramRenderer() = default;
+
+    // Returns false if the active backend has no spectrogram shader
+    bool init(Gradient gradient);
+    void shutdown();
+    bool isValid() const { return valid_; }
+
+    // Take the rows of a history ring ('ring_rows' rows of 'bins' levels,
+    // row r at r % ring_rows) written since the last call, 'rows' being how
+    // many it has had. Rows that already left the ring are kept blank. A
+    // lower count (the graph was reset) or a new bin count starts over.
+    void append(const uint8_t* ring, int ring_rows, int bins, uint64_t rows);
+    void clear();
+    int keptRows() const;
+
+    // Upload the tiles that changed, then queue the newest 'span' rows into
+    // draw_list across the rectangle, newest at the right and the lowest
+    // bin at the bottom. Once per frame, as the tiles are stream images.
+    void draw(ImDrawList* draw_list, ImVec2 pos, ImVec2 size, int span);
+
+private:
+    static_assert(TILES <= 32, "dirty tiles are a 32-bit mask");
+
+    // std140 layout of the vertex shader's uniform block
+    struct Params {
+        float rect[4];      // x, y, width, height of the tile's quad
+        float view[4];      // display width, display height, first and last V
+    };
+
+    struct DrawData {
+        SpectrogramRenderer* self;
+        ImVec2 pos;
+        ImVec2 size;
+        int span;
+    };
+
+    static void drawCallback(const ImDrawList* list, const ImDrawCmd* cmd);
+    void render(const DrawData& data, const ImVec4& clip_rect);
+    void createTiles(int bins);
+    void destroyTiles();
+    uint64_t oldestRow() const;
+
+    bool valid_ = false;
+    int bins_ = 0;
+    std::vector<uint8_t> levels_;   // CPU copy of every tile, TILES x TILE_ROWS x bins_
+    uint64_t rows_ = 0;             // rows of the source seen
+    uint64_t first_row_ = 0;        // first one since the last start over
+    uint32_t dirty_ = 0;            // tiles to upload
+
+    sg_image tiles_[TILES] = {};
+    sg_view tile_views_[TILES] = {};
+    sg_buffer corners_ = {};
+    sg_image gradient_ = {};
+    sg_view gradient_view_ = {};
+    sg_sampler sampler_ = {};
+    sg_shader shader_ = {};
+    sg_pipeline pipeline_ = {};
+};
@@ -0,0 +1,526 @@
+#include "SpectrumBarRenderer.h"
+#include "GpuMemory.h"
+#include <algorithm>
+
+/*
+    Vulkan shaders (SPIR-V 1.4, set/binding layout as sokol-shdc emits it):
+
+    layout(set = 0, binding = 0) uniform vs_params {
+        vec4 rect;
+        vec4 view;      // display width, display height, bar count, gap
+    };
+    layout(location = 0) in vec3 corner;    // x, y (0 at the top), 0 bar / 1 peak marker
+    layout(location = 1) in float level;
+    layout(location = 2) in float peak;
+    layout(location = 0) out vec4 uv;       // gradient coordinates of the top and bottom colors
+    layout(location = 1) out vec2 blend;    // 1 at the top, 0 at the bottom; peak marker
+    void main() {
+        float index = float(gl_InstanceIndex);
+        float bar_w = rect.z / view.z;
+        float left = rect.x + index * bar_w + view.w;
+        float right = rect.x + (index + 1.0) * bar_w - view.w;
+        float bottom = rect.y + rect.w;
+        float peak_h = peak * rect.w;
+        float bar_top = bottom - level * rect.w;
+        float peak_top = bottom - peak_h;
+        float top = mix(bar_top, peak_top, corner.z);
+        float base = mix(bottom, peak_top + 2.0, corner.z);
+        float visible = mix(1.0, step(2.0, peak_h), corner.z);
+        vec2 p = vec2(mix(left, right, corner.x), mix(top, base, corner.y));
+        gl_Position = vec4(((p / view.xy) - 0.5) * vec2(2.0, -2.0) * visible, 0.5, 1.0);
+        float row = 0.25 + 0.5 * (index / view.z);
+        uv = vec4(clamp(level, 0.0, 1.0) * (255.0 / 256.0) + (0.5 / 256.0), row,
+                  clamp(level * 0.3, 0.0, 1.0) * (255.0 / 256.0) + (0.5 / 256.0), row);
+        blend = vec2(1.0 - corner.y, corner.z);
+    }
+
+    layout(set = 1, binding = 0) uniform texture2D lut;
+    layout(set = 1, binding = 32) uniform sampler smp;
+    layout(location = 0) in vec4 uv;
+    layout(location = 1) in vec2 blend;
+    layout(location = 0) out vec4 frag_color;
+    void main() {
+        vec4 top = texture(sampler2D(lut, smp), uv.xy);
+        vec4 bottom = texture(sampler2D(lut, smp), uv.zw);
+        frag_color = mix(mix(bottom, top, blend.x), vec4(1.0, 1.0, 1.0, 200.0 / 255.0), blend.y);
+    }
+
+    Each instance is one bar and its peak marker, two quads told apart by
+    corner.z; a marker at most 2 pixels high collapses to a point. The
+    gradient is 256 levels wide and two rows high, the colors at the lowest
+    and highest frequency, so the linear sampler blends between the rows
+    exactly as the gradient does and the bars match what ImDrawList drew.
+*/
+
+static const uint8_t _bars_vs_bytecode_spirv[2424] = {
+    0x03,0x02,0x23,0x07,0x00,0x04,0x01,0x00,0x0b,0x00,0x08,0x00,0x6a,0x00,0x00,0x00,
+    0x00,0x00,0x00,0x00,0x11,0x00,0x02,0x00,0x01,0x00,0x00,0x00,0x0b,0x00,0x06,0x00,
+    0x01,0x00,0x00,0x00,0x47,0x4c,0x53,0x4c,0x2e,0x73,0x74,0x64,0x2e,0x34,0x35,0x30,
+    0x00,0x00,0x00,0x00,0x0e,0x00,0x03,0x00,0x00,0x00,0x00,0x00,0x01,0x00,0x00,0x00,
+    0x0f,0x00,0x0d,0x00,0x00,0x00,0x00,0x00,0x02,0x00,0x00,0x00,0x6d,0x61,0x69,0x6e,
+    0x00,0x00,0x00,0x00,0x0d,0x00,0x00,0x00,0x0f,0x00,0x00,0x00,0x11,0x00,0x00,0x00,
+    0x13,0x00,0x00,0x00,0x15,0x00,0x00,0x00,0x18,0x00,0x00,0x00,0x1a,0x00,0x00,0x00,
+    0x1c,0x00,0x00,0x00,0x47,0x00,0x03,0x00,0x0c,0x00,0x00,0x00,0x02,0x00,0x00,0x00,
+    0x48,0x00,0x05,0x00,0x0c,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x0b,0x00,0x00,0x00,
+    0x00,0x00,0x00,0x00,0x48,0x00,0x05,0x00,0x0c,0x00,0x00,0x00,0x01,0x00,0x00,0x00,
+    0x0b,0x00,0x00,0x00,0x01,0x00,0x00,0x00,0x48,0x00,0x05,0x00,0x0c,0x00,0x00,0x00,
+    0x02,0x00,0x00,0x00,0x0b,0x00,0x00,0x00,0x03,0x00,0x00,0x00,0x48,0x00,0x05,0x00,
+    0x0c,0x00,0x00,0x00,0x03,0x00,0x00,0x00,0x0b,0x00,0x00,0x00,0x04,0x00,0x00,0x00,
+    0x47,0x00,0x04,0x00,0x0f,0x00,0x00,0x00,0x1e,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+    0x47,0x00,0x04,0x00,0x11,0x00,0x00,0x00,0x1e,0x00,0x00,0x00,0x01,0x00,0x00,0x00,
+    0x47,0x00,0x04,0x00,0x13,0x00,0x00,0x00,0x1e,0x00,0x00,0x00,0x02,0x00,0x00,0x00,
+    0x47,0x00,0x04,0x00,0x15,0x00,0x00,0x00,0x0b,0x00,0x00,0x00,0x2b,0x00,0x00,0x00,
+    0x47,0x00,0x03,0x00,0x17,0x00,0x00,0x00,0x02,0x00,0x00,0x00,0x48,0x00,0x05,0x00,
+    0x17,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x23,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+    0x48,0x00,0x05,0x00,0x17,0x00,0x00,0x00,0x01,0x00,0x00,0x00,0x23,0x00,0x00,0x00,
+    0x10,0x00,0x00,0x00,0x47,0x00,0x04,0x00,0x18,0x00,0x00,0x00,0x22,0x00,0x00,0x00,
+    0x00,0x00,0x00,0x00,0x47,0x00,0x04,0x00,0x18,0x00,0x00,0x00,0x21,0x00,0x00,0x00,
+    0x00,0x00,0x00,0x00,0x47,0x00,0x04,0x00,0x1a,0x00,0x00,0x00,0x1e,0x00,0x00,0x00,
+    0x00,0x00,0x00,0x00,0x47,0x00,0x04,0x00,0x1c,0x00,0x00,0x00,0x1e,0x00,0x00,0x00,
+    0x01,0x00,0x00,0x00,0x16,0x00,0x03,0x00,0x03,0x00,0x00,0x00,0x20,0x00,0x00,0x00,
+    0x17,0x00,0x04,0x00,0x04,0x00,0x00,0x00,0x03,0x00,0x00,0x00,0x02,0x00,0x00,0x00,
+    0x17,0x00,0x04,0x00,0x05,0x00,0x00,0x00,0x03,0x00,0x00,0x00,0x03,0x00,0x00,0x00,
+    0x17,0x00,0x04,0x00,0x06,0x00,0x00,0x00,0x03,0x00,0x00,0x00,0x04,0x00,0x00,0x00,
+    0x13,0x00,0x02,0x00,0x07,0x00,0x00,0x00,0x21,0x00,0x03,0x00,0x08,0x00,0x00,0x00,
+    0x07,0x00,0x00,0x00,0x15,0x00,0x04,0x00,0x09,0x00,0x00,0x00,0x20,0x00,0x00,0x00,
+    0x00,0x00,0x00,0x00,0x2b,0x00,0x04,0x00,0x09,0x00,0x00,0x00,0x0a,0x00,0x00,0x00,
+    0x01,0x00,0x00,0x00,0x1c,0x00,0x04,0x00,0x0b,0x00,0x00,0x00,0x03,0x00,0x00,0x00,
+    0x0a,0x00,0x00,0x00,0x1e,0x00,0x06,0x00,0x0c,0x00,0x00,0x00,0x06,0x00,0x00,0x00,
+    0x03,0x00,0x00,0x00,0x0b,0x00,0x00,0x00,0x0b,0x00,0x00,0x00,0x20,0x00,0x04,0x00,
+    0x0e,0x00,0x00,0x00,0x03,0x00,0x00,0x00,0x0c,0x00,0x00,0x00,0x3b,0x00,0x04,0x00,
+    0x0e,0x00,0x00,0x00,0x0d,0x00,0x00,0x00,0x03,0x00,0x00,0x00,0x20,0x00,0x04,0x00,
+    0x10,0x00,0x00,0x00,0x01,0x00,0x00,0x00,0x05,0x00,0x00,0x00,0x3b,0x00,0x04,0x00,
+    0x10,0x00,0x00,0x00,0x0f,0x00,0x00,0x00,0x01,0x00,0x00,0x00,0x20,0x00,0x04,0x00,
+    0x12,0x00,0x00,0x00,0x01,0x00,0x00,0x00,0x03,0x00,0x00,0x00,0x3b,0x00,0x04,0x00,
+    0x12,0x00,0x00,0x00,0x11,0x00,0x00,0x00,0x01,0x00,0x00,0x00,0x3b,0x00,0x04,0x00,
+    0x12,0x00,0x00,0x00,0x13,0x00,0x00,0x00,0x01,0x00,0x00,0x00,0x15,0x00,0x04,0x00,
+    0x14,0x00,0x00,0x00,0x20,0x00,0x00,0x00,0x01,0x00,0x00,0x00,0x20,0x00,0x04,0x00,
+    0x16,0x00,0x00,0x00,0x01,0x00,0x00,0x00,0x14,0x00,0x00,0x00,0x3b,0x00,0x04,0x00,
+    0x16,0x00,0x00,0x00,0x15,0x00,0x00,0x00,0x01,0x00,0x00,0x00,0x1e,0x00,0x04,0x00,
+    0x17,0x00,0x00,0x00,0x06,0x00,0x00,0x00,0x06,0x00,0x00,0x00,0x20,0x00,0x04,0x00,
+    0x19,0x00,0x00,0x00,0x02,0x00,0x00,0x00,0x17,0x00,0x00,0x00,0x3b,0x00,0x04,0x00,
+    0x19,0x00,0x00,0x00,0x18,0x00,0x00,0x00,0x02,0x00,0x00,0x00,0x20,0x00,0x04,0x00,
+    0x1b,0x00,0x00,0x00,0x03,0x00,0x00,0x00,0x06,0x00,0x00,0x00,0x3b,0x00,0x04,0x00,
+    0x1b,0x00,0x00,0x00,0x1a,0x00,0x00,0x00,0x03,0x00,0x00,0x00,0x20,0x00,0x04,0x00,
+    0x1d,0x00,0x00,0x00,0x03,0x00,0x00,0x00,0x04,0x00,0x00,0x00,0x3b,0x00,0x04,0x00,
+    0x1d,0x00,0x00,0x00,0x1c,0x00,0x00,0x00,0x03,0x00,0x00,0x00,0x20,0x00,0x04,0x00,
+    0x1e,0x00,0x00,0x00,0x02,0x00,0x00,0x00,0x06,0x00,0x00,0x00,0x2b,0x00,0x04,0x00,
+    0x14,0x00,0x00,0x00,0x1f,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x2b,0x00,0x04,0x00,
+    0x14,0x00,0x00,0x00,0x22,0x00,0x00,0x00,0x01,0x00,0x00,0x00,0x2b,0x00,0x04,0x00,
+    0x03,0x00,0x00,0x00,0x37,0x00,0x00,0x00,0x00,0x00,0x80,0x3f,0x2b,0x00,0x04,0x00,
+    0x03,0x00,0x00,0x00,0x42,0x00,0x00,0x00,0x00,0x00,0x00,0x40,0x2b,0x00,0x04,0x00,
+    0x03,0x00,0x00,0x00,0x4c,0x00,0x00,0x00,0x00,0x00,0x00,0x3f,0x2c,0x00,0x05,0x00,
+    0x04,0x00,0x00,0x00,0x4d,0x00,0x00,0x00,0x4c,0x00,0x00,0x00,0x4c,0x00,0x00,0x00,
+    0x2b,0x00,0x04,0x00,0x03,0x00,0x00,0x00,0x4f,0x00,0x00,0x00,0x00,0x00,0x00,0xc0,
+    0x2c,0x00,0x05,0x00,0x04,0x00,0x00,0x00,0x50,0x00,0x00,0x00,0x42,0x00,0x00,0x00,
+    0x4f,0x00,0x00,0x00,0x2b,0x00,0x04,0x00,0x03,0x00,0x00,0x00,0x57,0x00,0x00,0x00,
+    0x00,0x00,0x80,0x3e,0x2b,0x00,0x04,0x00,0x03,0x00,0x00,0x00,0x5b,0x00,0x00,0x00,
+    0x00,0x00,0x00,0x00,0x2b,0x00,0x04,0x00,0x03,0x00,0x00,0x00,0x5d,0x00,0x00,0x00,
+    0x00,0x00,0x7f,0x3f,0x2b,0x00,0x04,0x00,0x03,0x00,0x00,0x00,0x5f,0x00,0x00,0x00,
+    0x00,0x00,0x00,0x3b,0x2b,0x00,0x04,0x00,0x03,0x00,0x00,0x00,0x61,0x00,0x00,0x00,
+    0x9a,0x99,0x99,0x3e,0x36,0x00,0x05,0x00,0x07,0x00,0x00,0x00,0x02,0x00,0x00,0x00,
+    0x00,0x00,0x00,0x00,0x08,0x00,0x00,0x00,0xf8,0x00,0x02,0x00,0x69,0x00,0x00,0x00,
+    0x41,0x00,0x05,0x00,0x1e,0x00,0x00,0x00,0x20,0x00,0x00,0x00,0x18,0x00,0x00,0x00,
+    0x1f,0x00,0x00,0x00,0x3d,0x00,0x04,0x00,0x06,0x00,0x00,0x00,0x21,0x00,0x00,0x00,
+    0x20,0x00,0x00,0x00,0x41,0x00,0x05,0x00,0x1e,0x00,0x00,0x00,0x23,0x00,0x00,0x00,
+    0x18,0x00,0x00,0x00,0x22,0x00,0x00,0x00,0x3d,0x00,0x04,0x00,0x06,0x00,0x00,0x00,
+    0x24,0x00,0x00,0x00,0x23,0x00,0x00,0x00,0x51,0x00,0x05,0x00,0x03,0x00,0x00,0x00,
+    0x25,0x00,0x00,0x00,0x21,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x51,0x00,0x05,0x00,
+    0x03,0x00,0x00,0x00,0x26,0x00,0x00,0x00,0x21,0x00,0x00,0x00,0x01,0x00,0x00,0x00,
+    0x51,0x00,0x05,0x00,0x03,0x00,0x00,0x00,0x27,0x00,0x00,0x00,0x21,0x00,0x00,0x00,
+    0x02,0x00,0x00,0x00,0x51,0x00,0x05,0x00,0x03,0x00,0x00,0x00,0x28,0x00,0x00,0x00,
+    0x21,0x00,0x00,0x00,0x03,0x00,0x00,0x00,0x51,0x00,0x05,0x00,0x03,0x00,0x00,0x00,
+    0x29,0x00,0x00,0x00,0x24,0x00,0x00,0x00,0x02,0x00,0x00,0x00,0x51,0x00,0x05,0x00,
+    0x03,0x00,0x00,0x00,0x2a,0x00,0x00,0x00,0x24,0x00,0x00,0x00,0x03,0x00,0x00,0x00,
+    0x3d,0x00,0x04,0x00,0x05,0x00,0x00,0x00,0x2b,0x00,0x00,0x00,0x0f,0x00,0x00,0x00,
+    0x51,0x00,0x05,0x00,0x03,0x00,0x00,0x00,0x2c,0x00,0x00,0x00,0x2b,0x00,0x00,0x00,
+    0x00,0x00,0x00,0x00,0x51,0x00,0x05,0x00,0x03,0x00,0x00,0x00,0x2d,0x00,0x00,0x00,
+    0x2b,0x00,0x00,0x00,0x01,0x00,0x00,0x00,0x51,0x00,0x05,0x00,0x03,0x00,0x00,0x00,
+    0x2e,0x00,0x00,0x00,0x2b,0x00,0x00,0x00,0x02,0x00,0x00,0x00,0x3d,0x00,0x04,0x00,
+    0x03,0x00,0x00,0x00,0x2f,0x00,0x00,0x00,0x11,0x00,0x00,0x00,0x3d,0x00,0x04,0x00,
+    0x03,0x00,0x00,0x00,0x30,0x00,0x00,0x00,0x13,0x00,0x00,0x00,0x3d,0x00,0x04,0x00,
+    0x14,0x00,0x00,0x00,0x31,0x00,0x00,0x00,0x15,0x00,0x00,0x00,0x6f,0x00,0x04,0x00,
+    0x03,0x00,0x00,0x00,0x32,0x00,0x00,0x00,0x31,0x00,0x00,0x00,0x88,0x00,0x05,0x00,
+    0x03,0x00,0x00,0x00,0x33,0x00,0x00,0x00,0x27,0x00,0x00,0x00,0x29,0x00,0x00,0x00,
+    0x85,0x00,0x05,0x00,0x03,0x00,0x00,0x00,0x34,0x00,0x00,0x00,0x32,0x00,0x00,0x00,
+    0x33,0x00,0x00,0x00,0x81,0x00,0x05,0x00,0x03,0x00,0x00,0x00,0x35,0x00,0x00,0x00,
+    0x25,0x00,0x00,0x00,0x34,0x00,0x00,0x00,0x81,0x00,0x05,0x00,0x03,0x00,0x00,0x00,
+    0x36,0x00,0x00,0x00,0x35,0x00,0x00,0x00,0x2a,0x00,0x00,0x00,0x81,0x00,0x05,0x00,
+    0x03,0x00,0x00,0x00,0x38,0x00,0x00,0x00,0x32,0x00,0x00,0x00,0x37,0x00,0x00,0x00,
+    0x85,0x00,0x05,0x00,0x03,0x00,0x00,0x00,0x39,0x00,0x00,0x00,0x38,0x00,0x00,0x00,
+    0x33,0x00,0x00,0x00,0x81,0x00,0x05,0x00,0x03,0x00,0x00,0x00,0x3a,0x00,0x00,0x00,
+    0x25,0x00,0x00,0x00,0x39,0x00,0x00,0x00,0x83,0x00,0x05,0x00,0x03,0x00,0x00,0x00,
+    0x3b,0x00,0x00,0x00,0x3a,0x00,0x00,0x00,0x2a,0x00,0x00,0x00,0x81,0x00,0x05,0x00,
+    0x03,0x00,0x00,0x00,0x3c,0x00,0x00,0x00,0x26,0x00,0x00,0x00,0x28,0x00,0x00,0x00,
+    0x85,0x00,0x05,0x00,0x03,0x00,0x00,0x00,0x3d,0x00,0x00,0x00,0x30,0x00,0x00,0x00,
+    0x28,0x00,0x00,0x00,0x85,0x00,0x05,0x00,0x03,0x00,0x00,0x00,0x3e,0x00,0x00,0x00,
+    0x2f,0x00,0x00,0x00,0x28,0x00,0x00,0x00,0x83,0x00,0x05,0x00,0x03,0x00,0x00,0x00,
+    0x3f,0x00,0x00,0x00,0x3c,0x00,0x00,0x00,0x3e,0x00,0x00,0x00,0x83,0x00,0x05,0x00,
+    0x03,0x00,0x00,0x00,0x40,0x00,0x00,0x00,0x3c,0x00,0x00,0x00,0x3d,0x00,0x00,0x00,
+    0x0c,0x00,0x08,0x00,0x03,0x00,0x00,0x00,0x41,0x00,0x00,0x00,0x01,0x00,0x00,0x00,
+    0x2e,0x00,0x00,0x00,0x3f,0x00,0x00,0x00,0x40,0x00,0x00,0x00,0x2e,0x00,0x00,0x00,
+    0x81,0x00,0x05,0x00,0x03,0x00,0x00,0x00,0x43,0x00,0x00,0x00,0x40,0x00,0x00,0x00,
+    0x42,0x00,0x00,0x00,0x0c,0x00,0x08,0x00,0x03,0x00,0x00,0x00,0x44,0x00,0x00,0x00,
+    0x01,0x00,0x00,0x00,0x2e,0x00,0x00,0x00,0x3c,0x00,0x00,0x00,0x43,0x00,0x00,0x00,
+    0x2e,0x00,0x00,0x00,0x0c,0x00,0x07,0x00,0x03,0x00,0x00,0x00,0x45,0x00,0x00,0x00,
+    0x01,0x00,0x00,0x00,0x30,0x00,0x00,0x00,0x42,0x00,0x00,0x00,0x3d,0x00,0x00,0x00,
+    0x0c,0x00,0x08,0x00,0x03,0x00,0x00,0x00,0x46,0x00,0x00,0x00,0x01,0x00,0x00,0x00,
+    0x2e,0x00,0x00,0x00,0x37,0x00,0x00,0x00,0x45,0x00,0x00,0x00,0x2e,0x00,0x00,0x00,
+    0x0c,0x00,0x08,0x00,0x03,0x00,0x00,0x00,0x47,0x00,0x00,0x00,0x01,0x00,0x00,0x00,
+    0x2e,0x00,0x00,0x00,0x36,0x00,0x00,0x00,0x3b,0x00,0x00,0x00,0x2c,0x00,0x00,0x00,
+    0x0c,0x00,0x08,0x00,0x03,0x00,0x00,0x00,0x48,0x00,0x00,0x00,0x01,0x00,0x00,0x00,
+    0x2e,0x00,0x00,0x00,0x41,0x00,0x00,0x00,0x44,0x00,0x00,0x00,0x2d,0x00,0x00,0x00,
+    0x50,0x00,0x05,0x00,0x04,0x00,0x00,0x00,0x49,0x00,0x00,0x00,0x47,0x00,0x00,0x00,
+    0x48,0x00,0x00,0x00,0x4f,0x00,0x07,0x00,0x04,0x00,0x00,0x00,0x4a,0x00,0x00,0x00,
+    0x24,0x00,0x00,0x00,0x24,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x01,0x00,0x00,0x00,
+    0x88,0x00,0x05,0x00,0x04,0x00,0x00,0x00,0x4b,0x00,0x00,0x00,0x49,0x00,0x00,0x00,
+    0x4a,0x00,0x00,0x00,0x83,0x00,0x05,0x00,0x04,0x00,0x00,0x00,0x4e,0x00,0x00,0x00,
+    0x4b,0x00,0x00,0x00,0x4d,0x00,0x00,0x00,0x85,0x00,0x05,0x00,0x04,0x00,0x00,0x00,
+    0x51,0x00,0x00,0x00,0x4e,0x00,0x00,0x00,0x50,0x00,0x00,0x00,0x8e,0x00,0x05,0x00,
+    0x04,0x00,0x00,0x00,0x52,0x00,0x00,0x00,0x51,0x00,0x00,0x00,0x46,0x00,0x00,0x00,
+    0x51,0x00,0x05,0x00,0x03,0x00,0x00,0x00,0x53,0x00,0x00,0x00,0x52,0x00,0x00,0x00,
+    0x00,0x00,0x00,0x00,0x51,0x00,0x05,0x00,0x03,0x00,0x00,0x00,0x54,0x00,0x00,0x00,
+    0x52,0x00,0x00,0x00,0x01,0x00,0x00,0x00,0x50,0x00,0x07,0x00,0x06,0x00,0x00,0x00,
+    0x55,0x00,0x00,0x00,0x53,0x00,0x00,0x00,0x54,0x00,0x00,0x00,0x4c,0x00,0x00,0x00,
+    0x37,0x00,0x00,0x00,0x41,0x00,0x05,0x00,0x1b,0x00,0x00,0x00,0x56,0x00,0x00,0x00,
+    0x0d,0x00,0x00,0x00,0x1f,0x00,0x00,0x00,0x3e,0x00,0x03,0x00,0x56,0x00,0x00,0x00,
+    0x55,0x00,0x00,0x00,0x88,0x00,0x05,0x00,0x03,0x00,0x00,0x00,0x58,0x00,0x00,0x00,
+    0x32,0x00,0x00,0x00,0x29,0x00,0x00,0x00,0x85,0x00,0x05,0x00,0x03,0x00,0x00,0x00,
+    0x59,0x00,0x00,0x00,0x4c,0x00,0x00,0x00,0x58,0x00,0x00,0x00,0x81,0x00,0x05,0x00,
+    0x03,0x00,0x00,0x00,0x5a,0x00,0x00,0x00,0x57,0x00,0x00,0x00,0x59,0x00,0x00,0x00,
+    0x0c,0x00,0x08,0x00,0x03,0x00,0x00,0x00,0x5c,0x00,0x00,0x00,0x01,0x00,0x00,0x00,
+    0x2b,0x00,0x00,0x00,0x2f,0x00,0x00,0x00,0x5b,0x00,0x00,0x00,0x37,0x00,0x00,0x00,
+    0x85,0x00,0x05,0x00,0x03,0x00,0x00,0x00,0x5e,0x00,0x00,0x00,0x5c,0x00,0x00,0x00,
+    0x5d,0x00,0x00,0x00,0x81,0x00,0x05,0x00,0x03,0x00,0x00,0x00,0x60,0x00,0x00,0x00,
+    0x5e,0x00,0x00,0x00,0x5f,0x00,0x00,0x00,0x85,0x00,0x05,0x00,0x03,0x00,0x00,0x00,
+    0x62,0x00,0x00,0x00,0x2f,0x00,0x00,0x00,0x61,0x00,0x00,0x00,0x0c,0x00,0x08,0x00,
+    0x03,0x00,0x00,0x00,0x63,0x00,0x00,0x00,0x01,0x00,0x00,0x00,0x2b,0x00,0x00,0x00,
+    0x62,0x00,0x00,0x00,0x5b,0x00,0x00,0x00,0x37,0x00,0x00,0x00,0x85,0x00,0x05,0x00,
+    0x03,0x00,0x00,0x00,0x64,0x00,0x00,0x00,0x63,0x00,0x00,0x00,0x5d,0x00,0x00,0x00,
+    0x81,0x00,0x05,0x00,0x03,0x00,0x00,0x00,0x65,0x00,0x00,0x00,0x64,0x00,0x00,0x00,
+    0x5f,0x00,0x00,0x00,0x50,0x00,0x07,0x00,0x06,0x00,0x00,0x00,0x66,0x00,0x00,0x00,
+    0x60,0x00,0x00,0x00,0x5a,0x00,0x00,0x00,0x65,0x00,0x00,0x00,0x5a,0x00,0x00,0x00,
+    0x3e,0x00,0x03,0x00,0x1a,0x00,0x00,0x00,0x66,0x00,0x00,0x00,0x83,0x00,0x05,0x00,
+    0x03,0x00,0x00,0x00,0x67,0x00,0x00,0x00,0x37,0x00,0x00,0x00,0x2d,0x00,0x00,0x00,
+    0x50,0x00,0x05,0x00,0x04,0x00,0x00,0x00,0x68,0x00,0x00,0x00,0x67,0x00,0x00,0x00,
+    0x2e,0x00,0x00,0x00,0x3e,0x00,0x03,0x00,0x1c,0x00,0x00,0x00,0x68,0x00,0x00,0x00,
+    0xfd,0x00,0x01,0x00,0x38,0x00,0x01,0x00,
+};
+
+static const uint8_t _bars_fs_bytecode_spirv[956] = {
+    0x03,0x02,0x23,0x07,0x00,0x04,0x01,0x00,0x0b,0x00,0x08,0x00,0x28,0x00,0x00,0x00,
+    0x00,0x00,0x00,0x00,0x11,0x00,0x02,0x00,0x01,0x00,0x00,0x00,0x0b,0x00,0x06,0x00,
+    0x01,0x00,0x00,0x00,0x47,0x4c,0x53,0x4c,0x2e,0x73,0x74,0x64,0x2e,0x34,0x35,0x30,
+    0x00,0x00,0x00,0x00,0x0e,0x00,0x03,0x00,0x00,0x00,0x00,0x00,0x01,0x00,0x00,0x00,
+    0x0f,0x00,0x0a,0x00,0x04,0x00,0x00,0x00,0x02,0x00,0x00,0x00,0x6d,0x61,0x69,0x6e,
+    0x00,0x00,0x00,0x00,0x0b,0x00,0x00,0x00,0x0d,0x00,0x00,0x00,0x0f,0x00,0x00,0x00,
+    0x11,0x00,0x00,0x00,0x13,0x00,0x00,0x00,0x10,0x00,0x03,0x00,0x02,0x00,0x00,0x00,
+    0x07,0x00,0x00,0x00,0x47,0x00,0x04,0x00,0x0b,0x00,0x00,0x00,0x1e,0x00,0x00,0x00,
+    0x00,0x00,0x00,0x00,0x47,0x00,0x04,0x00,0x0d,0x00,0x00,0x00,0x1e,0x00,0x00,0x00,
+    0x00,0x00,0x00,0x00,0x47,0x00,0x04,0x00,0x0f,0x00,0x00,0x00,0x1e,0x00,0x00,0x00,
+    0x01,0x00,0x00,0x00,0x47,0x00,0x04,0x00,0x11,0x00,0x00,0x00,0x22,0x00,0x00,0x00,
+    0x01,0x00,0x00,0x00,0x47,0x00,0x04,0x00,0x11,0x00,0x00,0x00,0x21,0x00,0x00,0x00,
+    0x00,0x00,0x00,0x00,0x47,0x00,0x04,0x00,0x13,0x00,0x00,0x00,0x22,0x00,0x00,0x00,
+    0x01,0x00,0x00,0x00,0x47,0x00,0x04,0x00,0x13,0x00,0x00,0x00,0x21,0x00,0x00,0x00,
+    0x20,0x00,0x00,0x00,0x16,0x00,0x03,0x00,0x03,0x00,0x00,0x00,0x20,0x00,0x00,0x00,
+    0x17,0x00,0x04,0x00,0x04,0x00,0x00,0x00,0x03,0x00,0x00,0x00,0x02,0x00,0x00,0x00,
+    0x17,0x00,0x04,0x00,0x05,0x00,0x00,0x00,0x03,0x00,0x00,0x00,0x04,0x00,0x00,0x00,
+    0x13,0x00,0x02,0x00,0x06,0x00,0x00,0x00,0x21,0x00,0x03,0x00,0x07,0x00,0x00,0x00,
+    0x06,0x00,0x00,0x00,0x19,0x00,0x09,0x00,0x08,0x00,0x00,0x00,0x03,0x00,0x00,0x00,
+    0x01,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+    0x01,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x1a,0x00,0x02,0x00,0x09,0x00,0x00,0x00,
+    0x1b,0x00,0x03,0x00,0x0a,0x00,0x00,0x00,0x08,0x00,0x00,0x00,0x20,0x00,0x04,0x00,
+    0x0c,0x00,0x00,0x00,0x03,0x00,0x00,0x00,0x05,0x00,0x00,0x00,0x3b,0x00,0x04,0x00,
+    0x0c,0x00,0x00,0x00,0x0b,0x00,0x00,0x00,0x03,0x00,0x00,0x00,0x20,0x00,0x04,0x00,
+    0x0e,0x00,0x00,0x00,0x01,0x00,0x00,0x00,0x05,0x00,0x00,0x00,0x3b,0x00,0x04,0x00,
+    0x0e,0x00,0x00,0x00,0x0d,0x00,0x00,0x00,0x01,0x00,0x00,0x00,0x20,0x00,0x04,0x00,
+    0x10,0x00,0x00,0x00,0x01,0x00,0x00,0x00,0x04,0x00,0x00,0x00,0x3b,0x00,0x04,0x00,
+    0x10,0x00,0x00,0x00,0x0f,0x00,0x00,0x00,0x01,0x00,0x00,0x00,0x20,0x00,0x04,0x00,
+    0x12,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x08,0x00,0x00,0x00,0x3b,0x00,0x04,0x00,
+    0x12,0x00,0x00,0x00,0x11,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x20,0x00,0x04,0x00,
+    0x14,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x09,0x00,0x00,0x00,0x3b,0x00,0x04,0x00,
+    0x14,0x00,0x00,0x00,0x13,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x2b,0x00,0x04,0x00,
+    0x03,0x00,0x00,0x00,0x22,0x00,0x00,0x00,0x00,0x00,0x80,0x3f,0x2b,0x00,0x04,0x00,
+    0x03,0x00,0x00,0x00,0x23,0x00,0x00,0x00,0xc9,0xc8,0x48,0x3f,0x2c,0x00,0x07,0x00,
+    0x05,0x00,0x00,0x00,0x24,0x00,0x00,0x00,0x22,0x00,0x00,0x00,0x22,0x00,0x00,0x00,
+    0x22,0x00,0x00,0x00,0x23,0x00,0x00,0x00,0x36,0x00,0x05,0x00,0x06,0x00,0x00,0x00,
+    0x02,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x07,0x00,0x00,0x00,0xf8,0x00,0x02,0x00,
+    0x27,0x00,0x00,0x00,0x3d,0x00,0x04,0x00,0x05,0x00,0x00,0x00,0x15,0x00,0x00,0x00,
+    0x0d,0x00,0x00,0x00,0x3d,0x00,0x04,0x00,0x04,0x00,0x00,0x00,0x16,0x00,0x00,0x00,
+    0x0f,0x00,0x00,0x00,0x3d,0x00,0x04,0x00,0x08,0x00,0x00,0x00,0x17,0x00,0x00,0x00,
+    0x11,0x00,0x00,0x00,0x3d,0x00,0x04,0x00,0x09,0x00,0x00,0x00,0x18,0x00,0x00,0x00,
+    0x13,0x00,0x00,0x00,0x56,0x00,0x05,0x00,0x0a,0x00,0x00,0x00,0x19,0x00,0x00,0x00,
+    0x17,0x00,0x00,0x00,0x18,0x00,0x00,0x00,0x4f,0x00,0x07,0x00,0x04,0x00,0x00,0x00,
+    0x1a,0x00,0x00,0x00,0x15,0x00,0x00,0x00,0x15,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+    0x01,0x00,0x00,0x00,0x57,0x00,0x05,0x00,0x05,0x00,0x00,0x00,0x1b,0x00,0x00,0x00,
+    0x19,0x00,0x00,0x00,0x1a,0x00,0x00,0x00,0x4f,0x00,0x07,0x00,0x04,0x00,0x00,0x00,
+    0x1c,0x00,0x00,0x00,0x15,0x00,0x00,0x00,0x15,0x00,0x00,0x00,0x02,0x00,0x00,0x00,
+    0x03,0x00,0x00,0x00,0x57,0x00,0x05,0x00,0x05,0x00,0x00,0x00,0x1d,0x00,0x00,0x00,
+    0x19,0x00,0x00,0x00,0x1c,0x00,0x00,0x00,0x51,0x00,0x05,0x00,0x03,0x00,0x00,0x00,
+    0x1e,0x00,0x00,0x00,0x16,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x51,0x00,0x05,0x00,
+    0x03,0x00,0x00,0x00,0x1f,0x00,0x00,0x00,0x16,0x00,0x00,0x00,0x01,0x00,0x00,0x00,
+    0x50,0x00,0x07,0x00,0x05,0x00,0x00,0x00,0x20,0x00,0x00,0x00,0x1e,0x00,0x00,0x00,
+    0x1e,0x00,0x00,0x00,0x1e,0x00,0x00,0x00,0x1e,0x00,0x00,0x00,0x0c,0x00,0x08,0x00,
+    0x05,0x00,0x00,0x00,0x21,0x00,0x00,0x00,0x01,0x00,0x00,0x00,0x2e,0x00,0x00,0x00,
+    0x1d,0x00,0x00,0x00,0x1b,0x00,0x00,0x00,0x20,0x00,0x00,0x00,0x50,0x00,0x07,0x00,
+    0x05,0x00,0x00,0x00,0x25,0x00,0x00,0x00,0x1f,0x00,0x00,0x00,0x1f,0x00,0x00,0x00,
+    0x1f,0x00,0x00,0x00,0x1f,0x00,0x00,0x00,0x0c,0x00,0x08,0x00,0x05,0x00,0x00,0x00,
+    0x26,0x00,0x00,0x00,0x01,0x00,0x00,0x00,0x2e,0x00,0x00,0x00,0x21,0x00,0x00,0x00,
+    0x24,0x00,0x00,0x00,0x25,0x00,0x00,0x00,0x3e,0x00,0x03,0x00,0x0b,0x00,0x00,0x00,
+    0x26,0x00,0x00,0x00,0xfd,0x00,0x01,0x00,0x38,0x00,0x01,0x00,
+};
+
+static const char _bars_vs_source_metal[] =
+    "#include <metal_stdlib>\n"
+    "using namespace metal;\n"
+    "struct vs_params { float4 rect; float4 view; };\n"
+    "struct vs_in {\n"
+    "    float3 corner [[attribute(0)]];\n"
+    "    float level [[attribute(1)]];\n"
+    "    float peak [[attribute(2)]];\n"
+    "};\n"
+    "struct vs_out {\n"
+    "    float4 pos [[position]];\n"
+    "    float4 uv [[user(locn0)]];\n"
+    "    float2 blend [[user(locn1)]];\n"
+    "};\n"
+    "vertex vs_out main0(vs_in in [[stage_in]], constant vs_params& u [[buffer(0)]],\n"
+    "                    uint instance [[instance_id]]) {\n"
+    "    vs_out out;\n"
+    "    float index = float(instance);\n"
+    "    float bar_w = u.rect.z / u.view.z;\n"
+    "    float left = u.rect.x + index * bar_w + u.view.w;\n"
+    "    float right = u.rect.x + (index + 1.0) * bar_w - u.view.w;\n"
+    "    float bottom = u.rect.y + u.rect.w;\n"
+    "    float peak_h = in.peak * u.rect.w;\n"
+    "    float bar_top = bottom - in.level * u.rect.w;\n"
+    "    float peak_top = bottom - peak_h;\n"
+    "    float top = mix(bar_top, peak_top, in.corner.z);\n"
+    "    float base = mix(bottom, peak_top + 2.0, in.corner.z);\n"
+    "    float visible = mix(1.0, step(2.0, peak_h), in.corner.z);\n"
+    "    float2 p = float2(mix(left, right, in.corner.x), mix(top, base, in.corner.y));\n"
+    "    out.pos = float4(((p / u.view.xy) - 0.5) * float2(2.0, -2.0) * visible, 0.5, 1.0);\n"
+    "    float row = 0.25 + 0.5 * (index / u.view.z);\n"
+    "    out.uv = float4(clamp(in.level, 0.0, 1.0) * (255.0 / 256.0) + (0.5 / 256.0), row,\n"
+    "                    clamp(in.level * 0.3, 0.0, 1.0) * (255.0 / 256.0) + (0.5 / 256.0), row);\n"
+    "    out.blend = float2(1.0 - in.corner.y, in.corner.z);\n"
+    "    return out;\n"
+    "}\n";
+
+static const char _bars_fs_source_metal[] =
+    "#include <metal_stdlib>\n"
+    "using namespace metal;\n"
+    "struct fs_in {\n"
+    "    float4 uv [[user(locn0)]];\n"
+    "    float2 blend [[user(locn1)]];\n"
+    "};\n"
+    "fragment float4 main0(fs_in in [[stage_in]], texture2d<float> lut [[texture(0)]],\n"
+    "                      sampler smp [[sampler(0)]]) {\n"
+    "    float4 top = lut.sample(smp, in.uv.xy);\n"
+    "    float4 bottom = lut.sample(smp, in.uv.zw);\n"
+    "    return mix(mix(bottom, top, in.blend.x), float4(1.0, 1.0, 1.0, 200.0 / 255.0), in.blend.y);\n"
+    "}\n";
+
+static bool barsShaderDesc(sg_shader_desc& desc) {
+    desc = {};
+    switch (sg_query_backend()) {
+        case SG_BACKEND_VULKAN:
+            desc.vertex_func.bytecode = SG_RANGE(_bars_vs_bytecode_spirv);
+            desc.vertex_func.entry = "main";
+            desc.fragment_func.bytecode = SG_RANGE(_bars_fs_bytecode_spirv);
+            desc.fragment_func.entry = "main";
+            break;
+        case SG_BACKEND_METAL_MACOS:
+        case SG_BACKEND_METAL_IOS:
+        case SG_BACKEND_METAL_SIMULATOR:
+            desc.vertex_func.source = _bars_vs_source_metal;
+            desc.vertex_func.entry = "main0";
+            desc.fragment_func.source = _bars_fs_source_metal;
+            desc.fragment_func.entry = "main0";
+            break;
+        default:
+            return false;
+    }
+
+    for (int i = 0; i < 3; ++i) {
+        desc.attrs[i].base_type = SG_SHADERATTRBASETYPE_FLOAT;
+    }
+    desc.uniform_blocks[0].stage = SG_SHADERSTAGE_VERTEX;
+    desc.uniform_blocks[0].size = 32;
+    desc.uniform_blocks[0].msl_buffer_n = 0;
+    desc.uniform_blocks[0].spirv_set0_binding_n = 0;
+    desc.views[0].texture.stage = SG_SHADERSTAGE_FRAGMENT;
+    desc.views[0].texture.image_type = SG_IMAGETYPE_2D;
+    desc.views[0].texture.sample_type = SG_IMAGESAMPLETYPE_FLOAT;
+    desc.views[0].texture.msl_texture_n = 0;
+    desc.views[0].texture.spirv_set1_binding_n = 0;
+    desc.samplers[0].stage = SG_SHADERSTAGE_FRAGMENT;
+    desc.samplers[0].sampler_type = SG_SAMPLERTYPE_FILTERING;
+    desc.samplers[0].msl_sampler_n = 0;
+    desc.samplers[0].spirv_set1_binding_n = 32;
+    desc.texture_sampler_pairs[0].stage = SG_SHADERSTAGE_FRAGMENT;
+    desc.texture_sampler_pairs[0].view_slot = 0;
+    desc.texture_sampler_pairs[0].sampler_slot = 0;
+    desc.label = "spectrum-bars-shader";
+    return true;
+}
+
+bool SpectrumBarRenderer::init(Gradient gradient) {
+    if (valid_) return true;
+
+    sg_shader_desc shd_desc;
+    if (!barsShaderDesc(shd_desc)) return false;
+
+    shader_ = sg_make_shader(&shd_desc);
+    if (sg_query_shader_state(shader_) != SG_RESOURCESTATE_VALID) {
+        sg_destroy_shader(shader_);
+        shader_ = {};
+        return false;
+    }
+
+    // The gradient at every level, for the lowest and the highest frequency
+    ImU32 pixels[2][GRADIENT_LEVELS];
+    for (int row = 0; row < 2; ++row) {
+        for (int level = 0; level < GRADIENT_LEVELS; ++level) {
+            pixels[row][level] = gradient(level / static_cast<float>(GRADIENT_LEVELS - 1), static_cast<float>(row));
+        }
+    }
+    sg_image_desc img_desc = {};
+    img_desc.width = GRADIENT_LEVELS;
+    img_desc.height = 2;
+    img_desc.pixel_format = SG_PIXELFORMAT_RGBA8;
+    img_desc.data.mip_levels[0] = SG_RANGE(pixels);
+    img_desc.label = "spectrum-bars-gradient";
+    gradient_ = MakeGpuImage(&img_desc);
+
+    sg_view_desc view_desc = {};
+    view_desc.texture.image = gradient_;
+    gradient_view_ = sg_make_view(&view_desc);
+
+    sg_sampler_desc smp_desc = {};
+    smp_desc.min_filter = SG_FILTER_LINEAR;
+    smp_desc.mag_filter = SG_FILTER_LINEAR;
+    smp_desc.wrap_u = SG_WRAP_CLAMP_TO_EDGE;
+    smp_desc.wrap_v = SG_WRAP_CLAMP_TO_EDGE;
+    sampler_ = sg_make_sampler(&smp_desc);
+
+    // Two quads as a triangle list: the bar, then its peak marker
+    const float corners[] = {
+        0.0f, 0.0f, 0.0f,  1.0f, 0.0f, 0.0f,  0.0f, 1.0f, 0.0f,
+        1.0f, 0.0f, 0.0f,  1.0f, 1.0f, 0.0f,  0.0f, 1.0f, 0.0f,
+        0.0f, 0.0f, 1.0f,  1.0f, 0.0f, 1.0f,  0.0f, 1.0f, 1.0f,
+        1.0f, 0.0f, 1.0f,  1.0f, 1.0f, 1.0f,  0.0f, 1.0f, 1.0f,
+    };
+    sg_buffer_desc buf_desc = {};
+    buf_desc.data = SG_RANGE(corners);
+    buf_desc.label = "spectrum-bars-corners";
+    corners_ = sg_make_buffer(&buf_desc);
+
+    // Rewritten every frame from the analysis arrays
+    buf_desc = {};
+    buf_desc.size = MAX_BARS * sizeof(float);
+    buf_desc.usage.stream_update = true;
+    buf_desc.label = "spectrum-bars-levels";
+    levels_ = sg_make_buffer(&buf_desc);
+    buf_desc.label = "spectrum-bars-peaks";
+    peaks_ = sg_make_buffer(&buf_desc);
+
+    // Drawn inside sokol_imgui's pass, so color and depth formats are the swapchain defaults
+    sg_pipeline_desc pip_desc = {};
+    pip_desc.shader = shader_;
+    pip_desc.layout.attrs[0].format = SG_VERTEXFORMAT_FLOAT3;
+    for (int i = 1; i <= 2; ++i) {
+        pip_desc.layout.buffers[i].step_func = SG_VERTEXSTEP_PER_INSTANCE;
+        pip_desc.layout.buffers[i].stride = sizeof(float);
+        pip_desc.layout.attrs[i].buffer_index = i;
+        pip_desc.layout.attrs[i].format = SG_VERTEXFORMAT_FLOAT;
+    }
+    pip_desc.colors[0].blend.enabled = true;
+    pip_desc.colors[0].blend.src_factor_rgb = SG_BLENDFACTOR_SRC_ALPHA;
+    pip_desc.colors[0].blend.dst_factor_rgb = SG_BLENDFACTOR_ONE_MINUS_SRC_ALPHA;
+    pip_desc.label = "spectrum-bars-pipeline";
+    pipeline_ = sg_make_pipeline(&pip_desc);
+
+    valid_ = sg_query_pipeline_state(pipeline_) == SG_RESOURCESTATE_VALID &&
+             sg_query_image_state(gradient_) == SG_RESOURCESTATE_VALID &&
+             sg_query_buffer_state(corners_) == SG_RESOURCESTATE_VALID &&
+             sg_query_buffer_state(levels_) == SG_RESOURCESTATE_VALID &&
+             sg_query_buffer_state(peaks_) == SG_RESOURCESTATE_VALID;
+    if (!valid_) {
+        shutdown();
+        return false;
+    }
+    return true;
+}
+
+void SpectrumBarRenderer::shutdown() {
+    sg_destroy_pipeline(pipeline_);
+    sg_destroy_shader(shader_);
+    sg_destroy_sampler(sampler_);
+    sg_destroy_view(gradient_view_);
+    DestroyGpuImage(gradient_);
+    sg_destroy_buffer(peaks_);
+    sg_destroy_buffer(levels_);
+    sg_destroy_buffer(corners_);
+    pipeline_ = {};
+    shader_ = {};
+    sampler_ = {};
+    gradient_view_ = {};
+    gradient_ = {};
+    peaks_ = {};
+    levels_ = {};
+    corners_ = {};
+    bar_count_ = 0;
+    valid_ = false;
+}
+
+void SpectrumBarRenderer::update(const float* levels, const float* peaks, int count) {
+    if (!valid_) return;
+    bar_count_ = std::clamp(count, 0, MAX_BARS);
+    if (bar_count_ == 0) return;
+    size_t bytes = bar_count_ * sizeof(float);
+    sg_update_buffer(levels_, { levels, bytes });
+    sg_update_buffer(peaks_, { peaks, bytes });
+}
+
+void SpectrumBarRenderer::draw(ImDrawList* draw_list, ImVec2 pos, ImVec2 size, float gap) {
+    if (!valid_ || bar_count_ == 0) return;
+    DrawData data = { this, pos, size, gap };
+    draw_list->PushClipRect(pos, ImVec2(pos.x + size.x, pos.y + size.y), true);
+    draw_list->AddCallback(drawCallback, &data, sizeof(data));
+    draw_list->PopClipRect();
+}
+
+void SpectrumBarRenderer::drawCallback(const ImDrawList* list, const ImDrawCmd* cmd) {
+    (void)list;
+    const DrawData* data = static_cast<const DrawData*>(cmd->UserCallbackData);
+    data->self->render(*data, cmd->ClipRect);
+}
+
+void SpectrumBarRenderer::render(const DrawData& data, const ImVec4& clip_rect) {
+    if (!valid_ || bar_count_ == 0) return;
+    if (clip_rect.z <= clip_rect.x || clip_rect.w <= clip_rect.y) return;
+
+    const ImGuiIO& io = ImGui::GetIO();
+    ImVec2 scale = io.DisplayFramebufferScale;
+    sg_apply_viewport(0, 0, static_cast<int>(io.DisplaySize.x * scale.x),
+                      static_cast<int>(io.DisplaySize.y * scale.y), true);
+    sg_apply_scissor_rect(static_cast<int>(clip_rect.x * scale.x), static_cast<int>(clip_rect.y * scale.y),
+                          static_cast<int>((clip_rect.z - clip_rect.x) * scale.x),
+                          static_cast<int>((clip_rect.w - clip_rect.y) * scale.y), true);
+    sg_apply_pipeline(pipeline_);
+    sg_bindings bind = {};
+    bind.vertex_buffers[0] = corners_;
+    bind.vertex_buffers[1] = levels_;
+    bind.vertex_buffers[2] = peaks_;
+    bind.views[0] = gradient_view_;
+    bind.samplers[0] = sampler_;
+    sg_apply_bindings(&bind);
+
+    Params params = {
+        { data.pos.x, data.pos.y, data.size.x, data.size.y },
+        { io.DisplaySize.x, io.DisplaySize.y, static_cast<float>(bar_count_), data.gap }
+    };
+    sg_apply_uniforms(0, SG_RANGE(params));
+    sg_draw(0, 12, bar_count_);
+}
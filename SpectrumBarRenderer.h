@@ -0,0 +1,71 @@
+#pragma once
+
+#include "sokol_gfx.h"
+#include "imgui.h"
+#include <cstdint>
+
+// Draws the spectrum analyzer's bars and peak markers with one instanced
+// draw call. Each bar is an instance whose level and peak come straight
+// from two stream buffers filled from the analysis arrays, and colors are
+// looked up in a small gradient texture built once in init(), so the CPU
+// does no per-bar work however many bins there are. Like NoteRollRenderer
+// the draw is queued as an ImDrawList callback and runs inside
+// sokol_imgui's pass, in order with the background and border around it.
+class SpectrumBarRenderer {
+public:
+    static constexpr int MAX_BARS = 512;
+    static constexpr int GRADIENT_LEVELS = 256;
+
+    // Bar color for a level and a frequency position, both 0-1; the
+    // gradient texture samples it at freq 0 and 1, so it has to be linear
+    // in freq
+    using Gradient = ImU32 (*)(float level, float freq);
+
+    SpectrumBarRenderer() = default;
+    ~SpectrumBarRenderer() = default;
+
+    // Returns false if the active backend has no bar shader (the caller then
+    // keeps drawing bars through ImDrawList)
+    bool init(Gradient gradient);
+    void shutdown();
+    bool isValid() const { return valid_; }
+
+    // Bar levels and peak holds for this frame (count <= MAX_BARS); at most
+    // once per frame, as the buffers are stream buffers
+    void update(const float* levels, const float* peaks, int count);
+
+    // Queue the bars into draw_list, spread across the rectangle with 'gap'
+    // pixels trimmed from each side of a bar. Each shades from its level's
+    // color at the top to that of 0.3 of its level at the bottom, and a
+    // white marker shows its peak once that is over 2 pixels high.
+    void draw(ImDrawList* draw_list, ImVec2 pos, ImVec2 size, float gap);
+
+private:
+    // std140 layout of the vertex shader's uniform block
+    struct Params {
+        float rect[4];      // x, y, width, height
+        float view[4];      // display width, display height, bar count, gap
+    };
+
+    struct DrawData {
+        SpectrumBarRenderer* self;
+        ImVec2 pos;
+        ImVec2 size;
+        float gap;
+    };
+
+    static void drawCallback(const ImDrawList* list, const ImDrawCmd* cmd);
+    void render(const DrawData& data, const ImVec4& clip_rect);
+
+    bool valid_ = false;
+    int bar_count_ = 0;
+
+    sg_buffer corners_ = {};
+    sg_buffer levels_ = {};
+    sg_buffer peaks_ = {};
+    sg_image gradient_ = {};
+    sg_view gradient_view_ = {};
+    sg_sampler sampler_ = {};
+    sg_shader shader_ = {};
+    sg_pipeline pipeline_ = {};
+};
@@ -0,0 +1,312 @@
+#include "ThreadPlacement.h"
+#include <algorithm>
+#include <atomic>
+#include <climits>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#elif defined(__APPLE__)
+#include <pthread.h>
+#include <pthread/qos.h>
+#include <sys/sysctl.h>
+#elif !defined(__EMSCRIPTEN__)
+#include <sched.h>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#define PLACEMENT_AFFINITY 1
+#endif
+
+namespace {
+
+struct Cpu {
+    int rank = 0;               // core class, higher is faster; 0 unknown
+    bool performance = false;
+#if defined(_WIN32)
+    ULONG id = 0;               // CPU set
+    WORD group = 0;
+    BYTE index = 0;             // logical processor within the group
+#endif
+};
+
+struct System {
+    ThreadPlacement::Topology topology;
+    std::vector<Cpu> cpus;      // Linux: by CPU number; Windows: in CPU set order
+#if defined(_WIN32)
+    std::vector<ULONG> performance_ids;
+#elif defined(PLACEMENT_AFFINITY)
+    cpu_set_t original;         // the process's mask at startup
+    cpu_set_t performance;
+#endif
+};
+
+struct RoleStats {
+    std::atomic<int> last_cpu{-1};
+    std::atomic<bool> last_performance{false};
+    std::atomic<uint64_t> samples{0};
+    std::atomic<uint64_t> performance_samples{0};
+    std::atomic<bool> refused{false};
+};
+
+std::atomic<bool> g_enabled{true};
+RoleStats g_stats[static_cast<int>(ThreadRole::COUNT)];
+
+// The placement the calling thread is in
+thread_local int tls_role = -1;
+thread_local bool tls_placed = false;
+#if defined(__APPLE__)
+thread_local qos_class_t tls_qos = QOS_CLASS_DEFAULT;     // before it was placed
+#endif
+
+bool performanceRole(ThreadRole role) {
+    return role == ThreadRole::AUDIO || role == ThreadRole::SYNTHESIS || role == ThreadRole::EMULATION;
+}
+
+// Everything above the lowest class counts as performance, so a prime core
+// alone doesn't have to carry every deadline thread
+void classify(std::vector<Cpu>& cpus) {
+    int lowest = INT_MAX;
+    int highest = 0;
+    for (const Cpu& cpu : cpus) {
+        if (cpu.rank <= 0) continue;
+        lowest = std::min(lowest, cpu.rank);
+        highest = std::max(highest, cpu.rank);
+    }
+    if (highest <= lowest) return;  // one class
+    for (Cpu& cpu : cpus) cpu.performance = cpu.rank > lowest;
+}
+
+#if defined(PLACEMENT_AFFINITY)
+// "0-3,8,10-11", the kernel's CPU list format
+std::vector<int> parseCpuList(const std::string& list) {
+    std::vector<int> cpus;
+    size_t pos = 0;
+    while (pos < list.size()) {
+        size_t end = list.find(',', pos);
+        if (end == std::string::npos) end = list.size();
+        int first = 0;
+        int last = 0;
+        int fields = sscanf(list.c_str() + pos, "%d-%d", &first, &last);
+        if (fields == 1) last = first;
+        if (fields >= 1) {
+            for (int cpu = first; cpu <= last && cpu < CPU_SETSIZE; ++cpu) cpus.push_back(cpu);
+        }
+        pos = end + 1;
+    }
+    return cpus;
+}
+
+bool readLine(const char* path, std::string& out) {
+    std::ifstream file(path);
+    return static_cast<bool>(std::getline(file, out));
+}
+#endif
+
+System detect() {
+    System system;
+#if defined(_WIN32)
+    ULONG length = 0;
+    GetSystemCpuSetInformation(nullptr, 0, &length, GetCurrentProcess(), 0);
+    std::vector<uint8_t> buffer(length);
+    if (length > 0 && GetSystemCpuSetInformation(reinterpret_cast<PSYSTEM_CPU_SET_INFORMATION>(buffer.data()),
+                                                 length, &length, GetCurrentProcess(), 0)) {
+        for (ULONG offset = 0; offset < length;) {
+            auto* info = reinterpret_cast<const SYSTEM_CPU_SET_INFORMATION*>(buffer.data() + offset);
+            if (info->Size == 0) break;
+            if (info->Type == CpuSetInformation) {
+                Cpu cpu;
+                cpu.rank = info->CpuSet.EfficiencyClass + 1;
+                cpu.id = info->CpuSet.Id;
+                cpu.group = info->CpuSet.Group;
+                cpu.index = info->CpuSet.LogicalProcessorIndex;
+                system.cpus.push_back(cpu);
+            }
+            offset += info->Size;
+        }
+    }
+    classify(system.cpus);
+    for (const Cpu& cpu : system.cpus) {
+        if (cpu.performance) system.performance_ids.push_back(cpu.id);
+    }
+    system.topology.cpus = static_cast<int>(system.cpus.size());
+    system.topology.performance = static_cast<int>(system.performance_ids.size());
+#elif defined(__APPLE__)
+    // perflevel0 is the fastest class; Intel Macs have just the one
+    int levels = 0;
+    int cpus = 0;
+    int performance = 0;
+    size_t size = sizeof(int);
+    sysctlbyname("hw.nperflevels", &levels, &size, nullptr, 0);
+    size = sizeof(int);
+    sysctlbyname("hw.logicalcpu", &cpus, &size, nullptr, 0);
+    size = sizeof(int);
+    if (levels > 1) sysctlbyname("hw.perflevel0.logicalcpu", &performance, &size, nullptr, 0);
+    system.topology.cpus = cpus;
+    system.topology.performance = performance;
+#elif defined(PLACEMENT_AFFINITY)
+    CPU_ZERO(&system.original);
+    CPU_ZERO(&system.performance);
+    if (sched_getaffinity(0, sizeof(system.original), &system.original) != 0) return system;
+    int count = 0;
+    for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+        if (CPU_ISSET(cpu, &system.original)) count = cpu + 1;
+    }
+    system.cpus.resize(count);
+
+    // Intel hybrid parts list their P cores under the cpu_core PMU; Arm
+    // (and newer kernels on x86) give each core's relative capacity
+    std::string line;
+    if (readLine("/sys/devices/cpu_core/cpus", line)) {
+        for (Cpu& cpu : system.cpus) cpu.rank = 1;
+        for (int cpu : parseCpuList(line)) {
+            if (cpu < count) system.cpus[cpu].rank = 2;
+        }
+    } else {
+        for (int cpu = 0; cpu < count; ++cpu) {
+            char path[96];
+            snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/cpu_capacity", cpu);
+            if (readLine(path, line)) system.cpus[cpu].rank = atoi(line.c_str());
+        }
+    }
+    classify(system.cpus);
+    for (int cpu = 0; cpu < count; ++cpu) {
+        if (!system.cpus[cpu].performance || !CPU_ISSET(cpu, &system.original)) continue;
+        CPU_SET(cpu, &system.performance);
+        ++system.topology.performance;
+    }
+    system.topology.cpus = CPU_COUNT(&system.original);
+#else
+    // The browser places its workers itself
+    system.topology.cpus = static_cast<int>(std::thread::hardware_concurrency());
+#endif
+    return system;
+}
+
+const System& detected() {
+    static const System system = detect();
+    return system;
+}
+
+// Move the calling thread into (or out of) the placement of 'role'; false
+// if the OS refused
+bool apply(const System& system, ThreadRole role, bool placed) {
+#if defined(_WIN32)
+    HANDLE thread = GetCurrentThread();
+    bool ok = placed && performanceRole(role)
+                  ? SetThreadSelectedCpuSets(thread, system.performance_ids.data(),
+                                             static_cast<ULONG>(system.performance_ids.size()))
+                  : SetThreadSelectedCpuSets(thread, nullptr, 0);
+    // EcoQoS marks batch work as fine to run slowly, on efficiency cores;
+    // the other roles opt out of throttling, and unplaced threads leave it
+    // to the OS
+    THREAD_POWER_THROTTLING_STATE throttling{};
+    throttling.Version = THREAD_POWER_THROTTLING_CURRENT_VERSION;
+    throttling.ControlMask = placed ? THREAD_POWER_THROTTLING_EXECUTION_SPEED : 0;
+    throttling.StateMask = placed && role == ThreadRole::BATCH ? THREAD_POWER_THROTTLING_EXECUTION_SPEED : 0;
+    SetThreadInformation(thread, ThreadPowerThrottling, &throttling, sizeof(throttling));
+    return ok;
+#elif defined(__APPLE__)
+    (void)system;
+    qos_class_t qos = tls_qos;
+    if (placed && performanceRole(role)) qos = QOS_CLASS_USER_INTERACTIVE;
+    if (placed && role == ThreadRole::BATCH) qos = QOS_CLASS_UTILITY;
+    return pthread_set_qos_class_self_np(qos, 0) == 0;
+#elif defined(PLACEMENT_AFFINITY)
+    // Batch work keeps the whole mask: it may run anywhere, efficiency cores too
+    const cpu_set_t& mask = placed && performanceRole(role) ? system.performance : system.original;
+    return sched_setaffinity(0, sizeof(mask), &mask) == 0;
+#else
+    (void)system;
+    (void)role;
+    (void)placed;
+    return false;
+#endif
+}
+
+// The CPU the calling thread is on and whether it is a performance core;
+// -1 where the OS doesn't say
+int currentCpu(const System& system, bool& performance) {
+    performance = false;
+#if defined(_WIN32)
+    PROCESSOR_NUMBER number;
+    GetCurrentProcessorNumberEx(&number);
+    for (const Cpu& cpu : system.cpus) {
+        if (cpu.group == number.Group && cpu.index == number.Number) {
+            performance = cpu.performance;
+            break;
+        }
+    }
+    return number.Group * 64 + number.Number;
+#elif defined(PLACEMENT_AFFINITY)
+    int cpu = sched_getcpu();
+    if (cpu >= 0 && cpu < static_cast<int>(system.cpus.size())) performance = system.cpus[cpu].performance;
+    return cpu;
+#else
+    (void)system;
+    return -1;
+#endif
+}
+
+}  // namespace
+
+const ThreadPlacement::Topology& ThreadPlacement::topology() {
+    return detected().topology;
+}
+
+void ThreadPlacement::setEnabled(bool enabled) {
+    for (RoleStats& stats : g_stats) stats.refused.store(false, std::memory_order_relaxed);
+    g_enabled.store(enabled, std::memory_order_relaxed);
+}
+
+bool ThreadPlacement::enabled() {
+    return g_enabled.load(std::memory_order_relaxed);
+}
+
+void ThreadPlacement::update(ThreadRole role) {
+    const System& system = detected();
+    int index = static_cast<int>(role);
+    RoleStats& stats = g_stats[index];
+    bool placed = g_enabled.load(std::memory_order_relaxed) && system.topology.hybrid();
+    if (placed != tls_placed || (placed && index != tls_role)) {
+#if defined(__APPLE__)
+        if (placed && !tls_placed) tls_qos = qos_class_self();
+#endif
+        if (!apply(system, role, placed) && placed) stats.refused.store(true, std::memory_order_relaxed);
+        tls_placed = placed;
+    }
+    tls_role = index;
+
+    bool performance = false;
+    int cpu = currentCpu(system, performance);
+    if (cpu < 0) return;
+    stats.last_cpu.store(cpu, std::memory_order_relaxed);
+    stats.last_performance.store(performance, std::memory_order_relaxed);
+    stats.samples.fetch_add(1, std::memory_order_relaxed);
+    if (performance) stats.performance_samples.fetch_add(1, std::memory_order_relaxed);
+}
+
+ThreadPlacement::Report ThreadPlacement::report(ThreadRole role) {
+    const RoleStats& stats = g_stats[static_cast<int>(role)];
+    Report report;
+    report.last_cpu = stats.last_cpu.load(std::memory_order_relaxed);
+    report.last_performance = stats.last_performance.load(std::memory_order_relaxed);
+    report.samples = stats.samples.load(std::memory_order_relaxed);
+    report.performance_samples = stats.performance_samples.load(std::memory_order_relaxed);
+    report.refused = stats.refused.load(std::memory_order_relaxed);
+    return report;
+}
+
+const char* ThreadPlacement::roleName(ThreadRole role) {
+    switch (role) {
+        case ThreadRole::AUDIO: return "Audio callback";
+        case ThreadRole::SYNTHESIS: return "Synthesis";
+        case ThreadRole::EMULATION: return "Emulation";
+        case ThreadRole::WORKER: return "Job workers";
+        case ThreadRole::BATCH: return "Batch jobs";
+        default: return "?";
+    }
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstdint>
+
+// What a thread does, for ThreadPlacement
+enum class ThreadRole {
+    AUDIO,          // the audio callback
+    SYNTHESIS,      // keeps the audio ring filled
+    EMULATION,      // NesEmulator's frame loop
+    WORKER,         // job workers running interactive jobs
+    BATCH,          // job workers running batch jobs
+    COUNT
+};
+
+// Core placement on hybrid CPUs (big.LITTLE, Intel P/E cores), where a
+// deadline thread the scheduler parks on an efficiency core glitches: the
+// audio, synthesis and emulation threads are kept off the efficiency cores,
+// interactive jobs go anywhere, and batch jobs are marked as background
+// work the OS may run on efficiency cores. Linux sets affinity masks
+// (sched_setaffinity), Windows selects CPU sets (SetThreadSelectedCpuSets,
+// EcoQoS for batch work), macOS only has QoS classes. Nothing changes on a
+// CPU with a single core class. Each thread also samples the core it runs
+// on, for the report.
+class ThreadPlacement {
+public:
+    struct Topology {
+        int cpus = 0;           // logical processors
+        int performance = 0;    // of those, not in the lowest (efficiency) class
+        bool hybrid() const { return performance > 0 && performance < cpus; }
+    };
+    struct Report {
+        int last_cpu = -1;              // -1 where the OS can't tell
+        bool last_performance = false;
+        uint64_t samples = 0;
+        uint64_t performance_samples = 0;
+        bool refused = false;           // the OS rejected the placement
+    };
+
+    // Detected once, on first use
+    static const Topology& topology();
+
+    // UI thread; the threads pick the change up at their next update()
+    static void setEnabled(bool enabled);
+    static bool enabled();
+
+    // Calling thread, at the top of each loop, callback or job: moves it
+    // into the placement of 'role' (or back out when disabled) if it isn't
+    // there yet, then samples the core it is on. Cheap when nothing changes.
+    static void update(ThreadRole role);
+
+    static Report report(ThreadRole role);
+    static const char* roleName(ThreadRole role);
+};
@@ -0,0 +1,456 @@
+#include "TraceDiff.h"
+#include "AudioExport.h"
+#include "JobSystem.h"
+#include "MappedFile.h"
+#include "gme/gme.h"
+#include "gme/Nsf_Emu.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+
+namespace {
+
+constexpr int BASE = ChannelLayout::BASE_CHANNELS;
+constexpr int VRC6_FIRST = BASE;
+constexpr int FME7_FIRST = VRC6_FIRST + 3;
+constexpr int NAMCO_FIRST = FME7_FIRST + 3;
+constexpr uint64_t HASH_BASIS = 0xcbf29ce484222325ull;
+
+// The bytes behind one channel's sound, hashed for every frame; with a
+// text, also printed for the report
+class ChannelBytes {
+public:
+    explicit ChannelBytes(std::string* text = nullptr) : text_(text) {}
+
+    void add(const char* label, const uint8_t* bytes, int count) {
+        for (int i = 0; i < count && count_ < CAPACITY; ++i) bytes_[count_++] = bytes[i];
+        if (!text_) return;
+        append(label);
+        char hex[4];
+        for (int i = 0; i < count; ++i) {
+            snprintf(hex, sizeof(hex), " %02X", bytes[i]);
+            *text_ += hex;
+        }
+    }
+
+    // Hashed as a byte; printed as its label when set
+    void flag(const char* label, bool set) {
+        if (count_ < CAPACITY) bytes_[count_++] = set ? 1 : 0;
+        if (text_ && set) append(label);
+    }
+
+    // Hashed as a byte; printed with its label when not 0
+    void count(const char* label, uint8_t value) {
+        if (count_ < CAPACITY) bytes_[count_++] = value;
+        if (!text_ || value == 0) return;
+        append(label);
+        *text_ += ' ' + std::to_string(value);
+    }
+
+    uint64_t hash(uint64_t chain) const {
+        for (int i = 0; i < count_; ++i) chain = (chain ^ bytes_[i]) * 0x100000001b3ull;
+        return chain;
+    }
+
+private:
+    static constexpr int CAPACITY = 160;    // a Namco channel's registers and its longest wave
+
+    void append(const char* label) {
+        if (!text_->empty()) *text_ += ' ';
+        *text_ += label;
+    }
+
+    uint8_t bytes_[CAPACITY];
+    int count_ = 0;
+    std::string* text_;
+};
+
+void gatherChannel(const TraceDiff::Registers& regs, int channel, ChannelBytes& out) {
+    if (channel < BASE) {
+        static const char* const labels[] = {"$4000-3", "$4004-7", "$4008-B", "$400C-F", "$4010-3"};
+        out.add(labels[channel], regs.apu + channel * 4, 4);
+        out.flag("on", (regs.apu[0x15] >> channel & 1) != 0);
+        if (channel < 4) out.flag("5-step", (regs.apu[0x17] & 0x80) != 0);  // clocks envelopes and lengths
+        out.count("restarted", regs.restarts[channel]);
+        return;
+    }
+    if (channel < FME7_FIRST) {
+        static const char* const labels[] = {"$9000-2", "$A000-2", "$B000-2"};
+        int osc = channel - VRC6_FIRST;
+        out.add(labels[osc], regs.vrc6[osc], 3);
+        return;
+    }
+    if (channel < NAMCO_FIRST) {
+        static const char* const tone_labels[] = {"R0-1", "R2-3", "R4-5"};
+        static const char* const volume_labels[] = {"R8", "R9", "RA"};
+        int osc = channel - FME7_FIRST;
+        out.add(tone_labels[osc], regs.fme7 + osc * 2, 2);
+        out.add(volume_labels[osc], regs.fme7 + 8 + osc, 1);
+        bool tone = !(regs.fme7[7] >> osc & 1);
+        bool noise = !(regs.fme7[7] >> (osc + 3) & 1);
+        out.flag("tone", tone);
+        out.flag("noise", noise);
+        if (noise) out.add("R6", regs.fme7 + 6, 1);
+        if (regs.fme7[8 + osc] & 0x10) out.add("RB-D", regs.fme7 + 11, 3);
+        return;
+    }
+
+    static const char* const labels[] = {"$40-7", "$48-F", "$50-7", "$58-F", "$60-7", "$68-F", "$70-7", "$78-F"};
+    int osc = channel - NAMCO_FIRST;
+    const uint8_t* osc_regs = regs.namco + 0x40 + osc * 8;
+    out.add(labels[osc], osc_regs, 8);
+    bool on = osc >= 7 - (regs.namco[0x7F] >> 4 & 7);
+    out.flag("on", on);
+    if (!on) return;
+
+    // The wave RAM the channel plays: 256 - (reg 4 & FC) nibbles from reg 6
+    int start = osc_regs[6];
+    int length = 256 - (osc_regs[4] & 0xFC);
+    int count = std::min(((start & 1) + length + 1) / 2, 0x80);
+    uint8_t wave[0x80];
+    for (int i = 0; i < count; ++i) wave[i] = regs.namco[(start / 2 + i) & 0x7F];
+    out.add("wave", wave, count);
+}
+
+// Shadows the sound registers from the write hook and hashes them at every
+// play call
+struct Recorder {
+    TraceDiff::Trace* trace = nullptr;
+    TraceDiff::Registers regs;
+    uint8_t fme7_latch = 0;
+    uint8_t namco_addr = 0;
+    uint64_t chains[TraceDiff::CHANNELS];
+
+    static void onWrite(void* user_data, unsigned long long, nes_addr_t addr, int data) {
+        Recorder& self = *static_cast<Recorder*>(user_data);
+        TraceDiff::Registers& regs = self.regs;
+        uint8_t value = static_cast<uint8_t>(data);
+        auto restart = [&regs](int channel) {
+            if (regs.restarts[channel] < 255) ++regs.restarts[channel];
+        };
+
+        // The emulator only hooks the addresses of the chips it has, so
+        // these never overlap
+        if (addr >= 0x4000 && addr < 0x4018) {
+            int reg = addr - 0x4000;
+            regs.apu[reg] = value;
+            if (reg < 0x10 && (reg & 3) == 3) restart(reg >> 2);
+            if (reg == 0x15 && (value & 0x10)) restart(4);
+        } else if (addr == 0xF800) {
+            self.namco_addr = value;
+        } else if (addr == 0x4800) {
+            int index = self.namco_addr & 0x7F;
+            regs.namco[index] = value;
+            if (self.namco_addr & 0x80) self.namco_addr = static_cast<uint8_t>(((index + 1) & 0x7F) | 0x80);
+        } else if (addr >= 0xC000) {
+            if ((addr & 0xE000) == 0xC000) self.fme7_latch = value & 0x0F;
+            else regs.fme7[self.fme7_latch] = value;
+        } else if (addr >= 0x9000 && (addr & 0xFFF) < 3) {
+            regs.vrc6[(addr - 0x9000) >> 12][addr & 0xFFF] = value;
+        }
+    }
+
+    static void onFrame(void* user_data, double time, Nsf_Emu&) {
+        Recorder& self = *static_cast<Recorder*>(user_data);
+        TraceDiff::Trace& trace = *self.trace;
+        trace.times.push_back(time);
+        trace.frames.push_back(self.regs);
+        for (int ch = 0; ch < TraceDiff::CHANNELS; ++ch) {
+            if (trace.hasChannel(ch)) {
+                ChannelBytes bytes;
+                gatherChannel(self.regs, ch, bytes);
+                self.chains[ch] = bytes.hash(self.chains[ch]);
+            }
+            trace.hashes.push_back(self.chains[ch]);
+        }
+        std::fill(std::begin(self.regs.restarts), std::end(self.regs.restarts), 0);
+    }
+};
+
+}  // namespace
+
+bool TraceDiff::Trace::hasChannel(int channel) const {
+    if (channel < VRC6_FIRST) return true;
+    if (channel < FME7_FIRST) return (chips & ChannelLayout::VRC6) != 0;
+    if (channel < NAMCO_FIRST) return (chips & ChannelLayout::FME7) != 0;
+    return (chips & ChannelLayout::NAMCO) != 0;
+}
+
+bool TraceDiff::record(Nsf_Emu& emu, int track, long msec, Trace& out) {
+    out = Trace();
+    out.chips = (emu.vrc6_() ? ChannelLayout::VRC6 : 0) | (emu.fme7_() ? ChannelLayout::FME7 : 0) |
+                (emu.namco_() ? ChannelLayout::NAMCO : 0);
+
+    Recorder recorder;
+    recorder.trace = &out;
+    std::fill(std::begin(recorder.chains), std::end(recorder.chains), HASH_BASIS);
+
+    // Skipping initial silence would line the traces up by where their
+    // first notes sound, not by frame
+    emu.ignore_silence(true);
+    emu.set_write_hook(&Recorder::onWrite, &recorder);
+    bool ok = emu.start_trace(track) == nullptr;
+    if (ok) {
+        out.play_period = emu.play_period_sec();
+        size_t frames = static_cast<size_t>(msec / 1000.0 / out.play_period) + 1;
+        out.times.reserve(frames);
+        out.frames.reserve(frames);
+        out.hashes.reserve(frames * CHANNELS);
+        ok = emu.run_trace(msec, &Recorder::onFrame, &recorder) == nullptr;
+        emu.end_trace();
+    }
+    emu.set_write_hook(nullptr, nullptr);
+    return ok;
+}
+
+TraceDiff::Result TraceDiff::compare(const Trace& a, const Trace& b) {
+    Result result;
+    result.frames = std::min(a.frameCount(), b.frameCount());
+    for (int ch = 0; ch < CHANNELS; ++ch) {
+        // Chained hashes agree up to the first differing frame and not after it
+        int low = 0, high = result.frames;
+        while (low < high) {
+            int mid = low + (high - low) / 2;
+            if (a.hash(mid, ch) == b.hash(mid, ch)) low = mid + 1;
+            else high = mid;
+        }
+        result.channel_first[ch] = low < result.frames ? low : -1;
+        if (low < result.frames && (result.first < 0 || low < result.first)) result.first = low;
+    }
+    return result;
+}
+
+std::string TraceDiff::describeChannel(const Trace& trace, int frame, int channel) {
+    std::string text;
+    if (!trace.hasChannel(channel)) return "not present";
+    ChannelBytes bytes(&text);
+    gatherChannel(trace.frames[frame], channel, bytes);
+    return text;
+}
+
+const char* TraceDiff::channelName(int channel) {
+    static const ChannelLayout all = ChannelLayout::build(ChannelLayout::VRC6 | ChannelLayout::FME7 | ChannelLayout::NAMCO);
+    return all[channel].name;
+}
+
+namespace {
+
+void usage() {
+    fprintf(stderr,
+            "usage: imgui_fc_visualizer --trace-diff A.nsf B.nsf [options]\n"
+            "  --tracks LIST        tracks of A, e.g. 1-3,7 (default: all that B also has)\n"
+            "  --against N          compare them all with track N of B (default: the same track)\n"
+            "  --seconds S          how long to trace (default: the longer track's export length)\n"
+            "  --threads N          worker threads (default: cores - 1)\n");
+}
+
+struct Side {
+    std::string path;
+    std::shared_ptr<MappedFile> file = std::make_shared<MappedFile>();
+    int track_count = 0;
+    std::vector<track_info_t> info;
+};
+
+bool openSide(const char* path, Side& side) {
+    side.path = path;
+    if (!side.file->open(path)) {
+        fprintf(stderr, "trace-diff: cannot open %s\n", path);
+        return false;
+    }
+    Music_Emu* emu = nullptr;
+    if (gme_open_data(side.file->data(), static_cast<long>(side.file->size()), &emu, 44100) || !emu) {
+        fprintf(stderr, "trace-diff: cannot load %s\n", path);
+        return false;
+    }
+    bool nsf = dynamic_cast<Nsf_Emu*>(emu) != nullptr;
+    if (nsf) {
+        side.track_count = gme_track_count(emu);
+        side.info.resize(side.track_count);
+        for (int track = 0; track < side.track_count; ++track) {
+            if (gme_track_info(emu, &side.info[track], track)) {
+                side.info[track] = track_info_t();
+                side.info[track].length = side.info[track].intro_length = side.info[track].loop_length = -1;
+            }
+        }
+    } else {
+        fprintf(stderr, "trace-diff: %s is not an NSF\n", path);
+    }
+    gme_delete(emu);
+    return nsf;
+}
+
+long traceLength(const track_info_t& info) {
+    return AlbumExporter::playLength(info.length, info.intro_length, info.loop_length);
+}
+
+struct Pair {
+    int track_a = 0;
+    int track_b = 0;
+    long msec = 0;
+    TraceDiff::Trace a, b;
+    bool ok_a = false, ok_b = false;
+};
+
+void traceSide(const Side& side, int track, long msec, TraceDiff::Trace& out, bool& ok) {
+    Music_Emu* emu = nullptr;
+    if (gme_open_data(side.file->data(), static_cast<long>(side.file->size()), &emu, 44100) || !emu) return;
+    Nsf_Emu* nsf = dynamic_cast<Nsf_Emu*>(emu);
+    ok = nsf && TraceDiff::record(*nsf, track, msec, out);
+    gme_delete(emu);
+}
+
+void printTime(const TraceDiff::Trace& a, const TraceDiff::Trace& b, int frame) {
+    double time_a = a.times[frame], time_b = b.times[frame];
+    if (time_a == time_b) printf("%.2f s", time_a);
+    else printf("%.2f s / %.2f s", time_a, time_b);
+}
+
+void report(const Pair& pair, const TraceDiff::Result& result, const char* title) {
+    const TraceDiff::Trace& a = pair.a;
+    const TraceDiff::Trace& b = pair.b;
+    printf("Track %d", pair.track_a + 1);
+    if (pair.track_b != pair.track_a) printf(" vs %d", pair.track_b + 1);
+    if (title && *title) printf(" \"%s\"", title);
+
+    if (result.first < 0) {
+        printf(": %d frames agree", result.frames);
+        if (result.frames > 0) printf(" (%.2f s)", a.times[result.frames - 1]);
+        printf("\n");
+    } else {
+        printf(": differs from frame %d (", result.first);
+        printTime(a, b, result.first);
+        printf(")\n");
+    }
+    if (a.play_period != b.play_period) {
+        printf("  play period %.3f ms / %.3f ms: frames are compared by number\n", a.play_period * 1000.0,
+               b.play_period * 1000.0);
+    }
+    if (a.frameCount() != b.frameCount()) printf("  %d / %d frames traced\n", a.frameCount(), b.frameCount());
+    if (result.first < 0) return;
+
+    for (int ch = 0; ch < TraceDiff::CHANNELS; ++ch) {
+        if (!a.hasChannel(ch) && !b.hasChannel(ch)) continue;
+        int frame = result.channel_first[ch];
+        printf("  %-12s ", TraceDiff::channelName(ch));
+        if (frame < 0) {
+            printf("agrees\n");
+            continue;
+        }
+        printf("frame %d (", frame);
+        printTime(a, b, frame);
+        printf(")\n    A: %s\n    B: %s\n", TraceDiff::describeChannel(a, frame, ch).c_str(),
+               TraceDiff::describeChannel(b, frame, ch).c_str());
+    }
+}
+
+}  // namespace
+
+bool TraceDiff::isCommandLine(int argc, char* argv[]) {
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--trace-diff") == 0) return true;
+    }
+    return false;
+}
+
+int TraceDiff::runCommandLine(int argc, char* argv[]) {
+    std::vector<const char*> paths;
+    const char* track_list = nullptr;
+    int against = -1;
+    double seconds = 0.0;
+    int threads = 0;
+    bool ok = true;
+
+    for (int i = 1; i < argc && ok; ++i) {
+        const char* arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if (std::strcmp(arg, "--trace-diff") == 0) {
+            continue;
+        } else if (std::strncmp(arg, "--", 2) != 0) {
+            paths.push_back(arg);
+        } else if (std::strcmp(arg, "--tracks") == 0 && has_value) {
+            track_list = argv[++i];
+        } else if (std::strcmp(arg, "--against") == 0 && has_value) {
+            against = std::atoi(argv[++i]) - 1;
+            ok = against >= 0;
+        } else if (std::strcmp(arg, "--seconds") == 0 && has_value) {
+            seconds = std::atof(argv[++i]);
+            ok = seconds > 0.0;
+        } else if (std::strcmp(arg, "--threads") == 0 && has_value) {
+            threads = std::atoi(argv[++i]);
+        } else {
+            ok = false;
+        }
+    }
+    if (!ok || paths.size() != 2) {
+        usage();
+        return 2;
+    }
+
+    Side sides[2];
+    if (!openSide(paths[0], sides[0]) || !openSide(paths[1], sides[1])) return 2;
+    if (against >= sides[1].track_count) {
+        fprintf(stderr, "trace-diff: %s has %d tracks\n", paths[1], sides[1].track_count);
+        return 2;
+    }
+    std::vector<int> tracks;
+    if (track_list) {
+        if (!AlbumExporter::parseTrackList(track_list, sides[0].track_count, tracks)) {
+            fprintf(stderr, "trace-diff: bad track list '%s' (%s has %d tracks)\n", track_list, paths[0],
+                    sides[0].track_count);
+            return 2;
+        }
+    } else {
+        int count = against >= 0 ? sides[0].track_count : std::min(sides[0].track_count, sides[1].track_count);
+        for (int track = 0; track < count; ++track) tracks.push_back(track);
+    }
+
+    // Every trace is its own job, all queued at once
+    JobSystem jobs;
+    jobs.init(threads);
+    auto started = std::chrono::steady_clock::now();
+    std::vector<std::unique_ptr<Pair>> pairs;
+    std::vector<JobHandle> handles;
+    for (int track : tracks) {
+        auto pair = std::make_unique<Pair>();
+        pair->track_a = track;
+        pair->track_b = against >= 0 ? against : track;
+        if (pair->track_b >= sides[1].track_count) {
+            fprintf(stderr, "trace-diff: %s has no track %d\n", paths[1], pair->track_b + 1);
+            return 2;
+        }
+        pair->msec = seconds > 0.0 ? static_cast<long>(seconds * 1000.0)
+                                   : std::max(traceLength(sides[0].info[pair->track_a]),
+                                              traceLength(sides[1].info[pair->track_b]));
+        Pair* p = pair.get();
+        handles.push_back(jobs.submit([p, &sides](const Job&) {
+            traceSide(sides[0], p->track_a, p->msec, p->a, p->ok_a);
+        }, JobPriority::BATCH, "Trace A"));
+        handles.push_back(jobs.submit([p, &sides](const Job&) {
+            traceSide(sides[1], p->track_b, p->msec, p->b, p->ok_b);
+        }, JobPriority::BATCH, "Trace B"));
+        pairs.push_back(std::move(pair));
+    }
+    for (auto& handle : handles) handle->wait();
+
+    if (std::strcmp(paths[0], paths[1]) != 0) printf("A: %s\nB: %s\n", paths[0], paths[1]);
+    int differing = 0, failed = 0;
+    for (const auto& pair : pairs) {
+        if (!pair->ok_a || !pair->ok_b) {
+            printf("Track %d: cannot trace %s\n", (pair->ok_a ? pair->track_b : pair->track_a) + 1,
+                   pair->ok_a ? "B" : "A");
+            ++failed;
+            continue;
+        }
+        Result result = compare(pair->a, pair->b);
+        report(*pair, result, sides[0].info[pair->track_a].song);
+        if (result.first >= 0 || pair->a.frameCount() != pair->b.frameCount()) ++differing;
+    }
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+    fprintf(stderr, "trace-diff: %d tracks, %d differ, in %.3f s\n", static_cast<int>(pairs.size()), differing,
+            elapsed);
+    if (failed > 0) return 2;
+    return differing > 0 ? 1 : 0;
+}
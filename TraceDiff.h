@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "ChannelLayout.h"
+
+class Nsf_Emu;
+
+// Where two NSF tracks stop sounding alike (two builds of a sound driver,
+// or two tracks of one file), from Nsf_Emu's register trace, so no audio is
+// synthesized: a track takes a few milliseconds. The writes to the sound
+// registers are shadowed as TrackerView decodes them, and at every play
+// routine call each channel's registers (and whether a note was restarted
+// since the last call) are hashed, chained over the calls before it. Two
+// traces agree on a channel up to the last frame whose hashes match, so its
+// first difference is a binary search, and the report then prints the
+// channel's registers on both sides at that frame.
+//
+// Channels are slots in ChannelLayout::build(VRC6 | FME7 | NAMCO) order,
+// whichever chips a file has; frames are play calls from the track's start,
+// without initial silence skipping.
+class TraceDiff {
+public:
+    static constexpr int CHANNELS = ChannelLayout::MAX_CHANNELS;
+
+    // The sound registers as the writes so far left them
+    struct Registers {
+        uint8_t apu[0x18] = {};
+        uint8_t vrc6[3][3] = {};
+        uint8_t fme7[16] = {};
+        uint8_t namco[0x80] = {};
+        uint8_t restarts[ChannelLayout::BASE_CHANNELS] = {};  // since the last play call: $4003/7/B/F, DMC starts
+    };
+
+    struct Trace {
+        uint8_t chips = 0;              // ChannelLayout::Chip flags of the emulated chips
+        double play_period = 0.0;       // seconds
+        std::vector<double> times;      // of each play call
+        std::vector<Registers> frames;  // about 200 bytes a frame
+        std::vector<uint64_t> hashes;   // CHANNELS per frame, each chained over that channel's earlier frames
+
+        int frameCount() const { return static_cast<int>(times.size()); }
+        uint64_t hash(int frame, int channel) const { return hashes[static_cast<size_t>(frame) * CHANNELS + channel]; }
+        bool hasChannel(int channel) const;
+    };
+
+    // Trace 'track' for 'msec' from its start; false if the track doesn't
+    // start. Leaves the emulator stopped, without write hook.
+    static bool record(Nsf_Emu& emu, int track, long msec, Trace& out);
+
+    struct Result {
+        int frames = 0;                 // compared: the frames both traces have
+        int first = -1;                 // first frame any channel differs, -1 if none
+        int channel_first[CHANNELS];    // per channel, -1 if it agrees throughout
+    };
+    static Result compare(const Trace& a, const Trace& b);
+
+    // A channel's registers at a frame, e.g. "$4000-3 3F 08 A9 08 on"
+    static std::string describeChannel(const Trace& trace, int frame, int channel);
+    static const char* channelName(int channel);
+
+    // "--trace-diff A.nsf B.nsf [options]": the report on stdout. Returns the
+    // process exit code as diff(1) does: 0 if every track agrees, 1 if any
+    // differs, 2 on errors.
+    static bool isCommandLine(int argc, char* argv[]);
+    static int runCommandLine(int argc, char* argv[]);
+};
@@ -0,0 +1,78 @@
+#include "TrackLengthDetector.h"
+#include "ApuSnapshot.h"
+#include "gme/Nsf_Emu.h"
+
+#include <algorithm>
+#include <cmath>
+
+bool TrackLengthDetector::detect(Nsf_Emu& emu, int track, Result& out, const std::function<bool()>& cancelled) {
+    states_.clear();
+    loop_found_ = false;
+    out = Result();
+    if (emu.start_trace(track) != nullptr) return false;
+
+    float time = static_cast<float>(emu.trace_time());
+    silent_since_ = time;
+    while (time < MAX_SECONDS) {
+        if (cancelled && cancelled()) {
+            emu.end_trace();
+            return false;
+        }
+        if (emu.run_trace(TRACE_STEP_MSEC, &TrackLengthDetector::traceFrame, this) != nullptr) break;
+        time = static_cast<float>(emu.trace_time());
+
+        // A "loop" with nothing sounding since it began is just the end
+        if (loop_found_ && silent_since_ > loop_start_) {
+            out.looped = true;
+            out.loop_start = loop_start_;
+            out.loop_length = loop_length_;
+            // A loop that only closes when some counter wraps plays once
+            int passes = loop_start_ + LOOP_PASSES * loop_length_ <= MAX_SECONDS ? LOOP_PASSES : 1;
+            out.length_ms = static_cast<int32_t>(std::lround((loop_start_ + passes * loop_length_) * 1000.0f));
+            out.fade_ms = LOOP_FADE_MS;
+            break;
+        }
+        if (loop_found_ || time - silent_since_ > SILENCE_SECONDS) {
+            out.length_ms = static_cast<int32_t>(std::lround(silent_since_ * 1000.0f));
+            out.fade_ms = SILENCE_FADE_MS;
+            break;
+        }
+    }
+    emu.end_trace();
+    return true;
+}
+
+void TrackLengthDetector::traceFrame(void* user_data, double time, Nsf_Emu& emu) {
+    TrackLengthDetector* self = static_cast<TrackLengthDetector*>(user_data);
+    if (self->loop_found_) return;  // the rest of this run_trace step is a repeat
+    float current_time = static_cast<float>(time);
+
+    // Envelope volumes stand in for amplitudes, which stay put without an
+    // output buffer; the triangle and DMC only have their length counters
+    Nes_Apu* apu = emu.apu_();
+    ApuFrameSnapshot snapshot = ApuFrameSnapshot::capture(*apu, emu.vrc6_(), emu.fme7_(), emu.namco_(), time);
+    bool sounding = false;
+    for (int ch = 0; ch < snapshot.channel_count; ++ch) {
+        if (snapshot.lengths[ch] <= 0) continue;
+        if (ch < ApuFrameSnapshot::BASE_CHANNELS) {
+            sounding |= ch == 2 || ch == 4 || apu->osc_volume(ch) > 0;
+        } else {
+            sounding |= snapshot.volumes[ch] > 0;
+        }
+    }
+    if (sounding) self->silent_since_ = current_time;
+
+    // Same memory, CPU and sound registers as an earlier play call: everything
+    // from that call on repeats
+    uint64_t hash = emu.trace_state_hash();
+    for (int ch = 0; ch < snapshot.channel_count; ++ch) {
+        hash = (hash ^ static_cast<uint32_t>(snapshot.periods[ch])) * 0x100000001b3ull;
+        hash = (hash ^ static_cast<uint32_t>(snapshot.volumes[ch])) * 0x100000001b3ull;
+    }
+    auto [seen, inserted] = self->states_.emplace(hash, current_time);
+    if (!inserted && current_time - seen->second >= MIN_LOOP_SECONDS) {
+        self->loop_start_ = std::max(0.0f, seen->second);
+        self->loop_length_ = current_time - seen->second;
+        self->loop_found_ = true;
+    }
+}
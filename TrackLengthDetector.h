@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <unordered_map>
+
+class Nsf_Emu;
+
+// Where an NSF track without length info ends, found from Nsf_Emu's
+// register trace (no audio is synthesized, so a whole track takes a few
+// milliseconds). At every play routine call the CPU, memory and sound
+// register state is hashed; the first repeat means the track cycles from
+// that point, and it is given LOOP_PASSES passes of the loop (one, if they
+// would run past MAX_SECONDS) and a fade.
+// A track that falls quiet for SILENCE_SECONDS instead ends where the
+// last channel stopped. One thread per detector.
+class TrackLengthDetector {
+public:
+    static constexpr float MAX_SECONDS = 1200.0f;       // give up past this
+    static constexpr float SILENCE_SECONDS = 6.0f;      // matches gme's silence detection
+    static constexpr float MIN_LOOP_SECONDS = 1.0f;
+    static constexpr int LOOP_PASSES = 2;
+    static constexpr int32_t LOOP_FADE_MS = 8000;
+    static constexpr int32_t SILENCE_FADE_MS = 500;     // covers release the trace cannot see
+
+    struct Result {
+        int32_t length_ms = -1;     // fade start; -1 if no end was found
+        int32_t fade_ms = 0;
+        bool looped = false;
+        float loop_start = 0.0f;    // seconds, when looped
+        float loop_length = 0.0f;
+    };
+
+    // Trace 'track' from its start; false if the trace fails or 'cancelled'
+    // returns true (polled every TRACE_STEP_MSEC of emulated time). Leaves
+    // the emulator stopped, ready for start_track().
+    bool detect(Nsf_Emu& emu, int track, Result& out, const std::function<bool()>& cancelled = nullptr);
+
+private:
+    static constexpr long TRACE_STEP_MSEC = 1000;
+
+    static void traceFrame(void* user_data, double time, Nsf_Emu& emu);
+
+    std::unordered_map<uint64_t, float> states_;    // state hash -> first time seen
+    float silent_since_ = 0.0f;
+    bool loop_found_ = false;
+    float loop_start_ = 0.0f;
+    float loop_length_ = 0.0f;
+};
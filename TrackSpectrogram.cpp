@@ -0,0 +1,58 @@
+#include "TrackSpectrogram.h"
+#include <algorithm>
+#include <cmath>
+
+void TrackSpectrogram::begin(long sample_rate) {
+    levels_.clear();
+    if (plan_.size() != FFT_SIZE) plan_.init(FFT_SIZE);
+    ring_.assign(FFT_SIZE, 0.0f);
+    frame_.resize(FFT_SIZE);
+    ring_pos_ = 0;
+    column_frames_ = std::max(1L, std::lround(sample_rate * COLUMN_SECONDS));
+    frames_ = 0;
+
+    // Log-spaced bands, each at least one FFT bin wide
+    float top = std::min(MAX_HZ, sample_rate * 0.5f);
+    float bin_hz = static_cast<float>(std::max(1L, sample_rate)) / FFT_SIZE;
+    band_edges_.resize(BINS + 1);
+    for (int b = 0; b <= BINS; ++b) {
+        float hz = MIN_HZ * std::pow(top / MIN_HZ, static_cast<float>(b) / BINS);
+        band_edges_[b] = std::clamp(static_cast<int>(std::lround(hz / bin_hz)), 1, FFT_SIZE / 2);
+    }
+    for (int b = 1; b <= BINS; ++b) {
+        band_edges_[b] = std::max(band_edges_[b], band_edges_[b - 1] + 1);
+    }
+}
+
+void TrackSpectrogram::add(const short* stereo, int frames) {
+    for (int i = 0; i < frames; ++i) {
+        ring_[ring_pos_] = (stereo[i * 2] + stereo[i * 2 + 1]) * (0.5f / 32768.0f);
+        ring_pos_ = (ring_pos_ + 1) % FFT_SIZE;
+        if (++frames_ == column_frames_) flush();
+    }
+}
+
+void TrackSpectrogram::finish() {
+    if (frames_ > 0) flush();
+}
+
+void TrackSpectrogram::flush() {
+    // The FFT_SIZE samples ending at the column's end, oldest first
+    std::copy(ring_.begin() + ring_pos_, ring_.end(), frame_.begin());
+    std::copy(ring_.begin(), ring_.begin() + ring_pos_, frame_.begin() + (FFT_SIZE - ring_pos_));
+    const std::vector<std::complex<float>>& spectrum = plan_.forward(frame_.data());
+
+    // A full-scale sine reads |X| = N/4 through the Hann window
+    const float full_scale = (FFT_SIZE / 4.0f) * (FFT_SIZE / 4.0f);
+    const float levels_per_db = 255.0f / -FLOOR_DB;
+    size_t column = levels_.size();
+    levels_.resize(column + BINS);
+    for (int b = 0; b < BINS; ++b) {
+        int end = std::min(band_edges_[b + 1], static_cast<int>(spectrum.size()));
+        float power = 0.0f;
+        for (int k = band_edges_[b]; k < end; ++k) power = std::max(power, std::norm(spectrum[k]));
+        float db = 10.0f * std::log10(power / full_scale + 1e-12f);
+        levels_[column + b] = static_cast<uint8_t>(std::clamp((db - FLOOR_DB) * levels_per_db, 0.0f, 255.0f));
+    }
+    frames_ = 0;
+}
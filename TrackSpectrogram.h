@@ -0,0 +1,47 @@
+#pragma once
+
+#include "FftPlan.h"
+#include <cstdint>
+#include <vector>
+
+// Whole-track spectrogram: BINS log-spaced band levels per COLUMN_SECONDS of
+// the mixed output, one byte each, the spectral counterpart of
+// WaveformPeaks. It is computed from the same playback that makes the peaks
+// and cached beside them, so the seek bar shows the whole track's spectrum
+// as soon as it is opened again, with no analysis while playing.
+class TrackSpectrogram {
+public:
+    static constexpr float COLUMN_SECONDS = 0.05f;
+    static constexpr int BINS = 64;
+    static constexpr int FFT_SIZE = 2048;
+    static constexpr float MIN_HZ = 40.0f;
+    static constexpr float MAX_HZ = 16000.0f;   // or Nyquist, if lower
+    static constexpr float FLOOR_DB = -90.0f;   // level 0; full scale is 255
+
+    void begin(long sample_rate);
+
+    // Interleaved stereo, mixed down to mono
+    void add(const short* stereo, int frames);
+
+    // Close the partial last column
+    void finish();
+
+    void assign(std::vector<uint8_t> levels) { levels_ = std::move(levels); }
+    // Column-major, lowest band first
+    const std::vector<uint8_t>& levels() const { return levels_; }
+    int columns() const { return static_cast<int>(levels_.size() / BINS); }
+    bool empty() const { return levels_.empty(); }
+    float duration() const { return columns() * COLUMN_SECONDS; }
+
+private:
+    void flush();
+
+    std::vector<uint8_t> levels_;
+    FftPlan plan_;
+    std::vector<float> ring_;           // FFT_SIZE newest mono samples
+    std::vector<float> frame_;          // ring_ in order, for the FFT
+    std::vector<int> band_edges_;       // FFT bins, BINS + 1
+    long column_frames_ = 1;
+    long frames_ = 0;                   // in the column being filled
+    int ring_pos_ = 0;
+};
@@ -0,0 +1,107 @@
+#include "TrackSpectrogramView.h"
+#include "GpuMemory.h"
+#include "imgui.h"
+#include "sokol_app.h"
+#include "util/sokol_imgui.h"
+#include <algorithm>
+#include <vector>
+
+// Black through blue and magenta to orange and pale yellow
+static ImU32 heatColor(int level) {
+    static const float stops[][3] = {
+        {0.0f, 0.0f, 0.0f}, {0.10f, 0.05f, 0.45f}, {0.65f, 0.10f, 0.55f},
+        {0.98f, 0.55f, 0.10f}, {1.0f, 0.97f, 0.70f},
+    };
+    constexpr int segments = sizeof(stops) / sizeof(stops[0]) - 1;
+    float t = level / 255.0f * segments;
+    int i = std::min(static_cast<int>(t), segments - 1);
+    float f = t - i;
+    auto channel = [&](int c) { return static_cast<int>((stops[i][c] + (stops[i + 1][c] - stops[i][c]) * f) * 255.0f); };
+    return IM_COL32(channel(0), channel(1), channel(2), 255);
+}
+
+void TrackSpectrogramView::build(const TrackSpectrogram& spectrogram) {
+    destroy();
+    int columns = spectrogram.columns();
+    int width = std::min(columns, MAX_COLUMNS);
+    const int bins = TrackSpectrogram::BINS;
+    const std::vector<uint8_t>& levels = spectrogram.levels();
+
+    ImU32 colors[256];
+    for (int level = 0; level < 256; ++level) colors[level] = heatColor(level);
+
+    // Highest band in the top row
+    std::vector<ImU32> pixels(static_cast<size_t>(width) * bins);
+    for (int x = 0; x < width; ++x) {
+        int first = static_cast<int>(static_cast<int64_t>(x) * columns / width);
+        int last = std::max(first + 1, static_cast<int>(static_cast<int64_t>(x + 1) * columns / width));
+        for (int b = 0; b < bins; ++b) {
+            uint8_t level = 0;
+            for (int c = first; c < last; ++c) level = std::max(level, levels[static_cast<size_t>(c) * bins + b]);
+            pixels[static_cast<size_t>(bins - 1 - b) * width + x] = colors[level];
+        }
+    }
+
+    sg_image_desc img_desc = {};
+    img_desc.width = width;
+    img_desc.height = bins;
+    img_desc.pixel_format = SG_PIXELFORMAT_RGBA8;
+    img_desc.data.mip_levels[0] = { pixels.data(), pixels.size() * sizeof(ImU32) };
+    img_desc.label = "track-spectrogram";
+    image_ = MakeGpuImage(&img_desc);
+
+    sg_view_desc view_desc = {};
+    view_desc.texture.image = image_;
+    view_ = sg_make_view(&view_desc);
+
+    sg_sampler_desc smp_desc = {};
+    smp_desc.min_filter = SG_FILTER_LINEAR;
+    smp_desc.mag_filter = SG_FILTER_LINEAR;
+    smp_desc.wrap_u = SG_WRAP_CLAMP_TO_EDGE;
+    smp_desc.wrap_v = SG_WRAP_CLAMP_TO_EDGE;
+    sampler_ = sg_make_sampler(&smp_desc);
+    created_ = true;
+}
+
+void TrackSpectrogramView::destroy() {
+    if (!created_) return;
+    sg_destroy_sampler(sampler_);
+    sg_destroy_view(view_);
+    DestroyGpuImage(image_);
+    created_ = false;
+}
+
+bool TrackSpectrogramView::draw(const char* id, const std::shared_ptr<const TrackSpectrogram>& spectrogram,
+                                float width, float height, float track_seconds, float current_time,
+                                float* seek_time) {
+    if (spectrogram != shown_) {
+        shown_ = spectrogram;
+        destroy();
+        if (shown_ && !shown_->empty()) build(*shown_);
+    }
+    if (!created_ || track_seconds <= 0.0f || width < 1.0f) return false;
+
+    ImDrawList* draw_list = ImGui::GetWindowDrawList();
+    ImVec2 pos = ImGui::GetCursorScreenPos();
+    draw_list->AddRectFilled(pos, ImVec2(pos.x + width, pos.y + height), IM_COL32(0, 0, 0, 255), 3.0f);
+
+    // The analysed audio spans its own duration, which may stop short of or
+    // run past the seek bar's length
+    float shown_fraction = std::min(shown_->duration() / track_seconds, 1.0f);
+    float u_end = std::min(track_seconds / shown_->duration(), 1.0f);
+    uint64_t texture = simgui_imtextureid_with_sampler(view_, sampler_);
+    draw_list->AddImage(texture, pos, ImVec2(pos.x + width * shown_fraction, pos.y + height),
+                        ImVec2(0.0f, 0.0f), ImVec2(u_end, 1.0f));
+
+    float cursor = pos.x + width * std::clamp(current_time / track_seconds, 0.0f, 1.0f);
+    draw_list->AddLine(ImVec2(cursor, pos.y), ImVec2(cursor, pos.y + height), IM_COL32(255, 255, 255, 220), 2.0f);
+    draw_list->AddRect(pos, ImVec2(pos.x + width, pos.y + height), IM_COL32(60, 60, 80, 255), 3.0f);
+
+    ImGui::InvisibleButton(id, ImVec2(width, height));
+    if (ImGui::IsItemActive() && seek_time) {
+        float fraction = (ImGui::GetIO().MousePos.x - pos.x) / width;
+        *seek_time = std::clamp(fraction, 0.0f, 1.0f) * track_seconds;
+        return true;
+    }
+    return false;
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include "TrackSpectrogram.h"
+#include "sokol_gfx.h"
+#include <memory>
+
+// Draws a TrackSpectrogram as a strip across the whole track, with the
+// playback position marked. The image is built once per spectrogram, one
+// texel per column up to MAX_COLUMNS (the loudest of neighbouring columns
+// beyond that), so each frame draws one textured quad however long the
+// track is. UI thread.
+class TrackSpectrogramView {
+public:
+    static constexpr int MAX_COLUMNS = 4096;
+
+    // Returns true with *seek_time set when it was clicked or dragged;
+    // draws nothing (and returns false) while 'spectrogram' is null or empty
+    bool draw(const char* id, const std::shared_ptr<const TrackSpectrogram>& spectrogram, float width,
+              float height, float track_seconds, float current_time, float* seek_time);
+
+    // Release the image; call before sg_shutdown
+    void destroy();
+
+private:
+    void build(const TrackSpectrogram& spectrogram);
+
+    std::shared_ptr<const TrackSpectrogram> shown_;
+    bool created_ = false;
+    sg_image image_ = {};
+    sg_view view_ = {};
+    sg_sampler sampler_ = {};
+};
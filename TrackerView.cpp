@@ -0,0 +1,406 @@
+#include "TrackerView.h"
+#include "PitchTable.h"
+#include "imgui.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+namespace {
+
+constexpr double CPU_CLOCK = PitchTable::CPU_CLOCK;
+
+// Note and detune of a tone with 'clocks' CPU clocks per waveform cycle, for
+// the Namco channels PitchTable has no table for
+bool pitchOf(double clocks, int* note, float* cents) {
+    if (clocks <= 0.0) return false;
+    double midi = 69.0 + 12.0 * std::log2(CPU_CLOCK / clocks / 440.0);
+    int rounded = static_cast<int>(std::lround(midi));
+    if (rounded < 0 || rounded > 127) return false;
+    *note = rounded;
+    *cents = static_cast<float>((midi - rounded) * 100.0);
+    return true;
+}
+
+ImVec4 rgbColor(uint32_t rgb) {
+    return ImVec4(((rgb >> 16) & 0xFF) / 255.0f, ((rgb >> 8) & 0xFF) / 255.0f, (rgb & 0xFF) / 255.0f, 1.0f);
+}
+
+}  // namespace
+
+void TrackerView::update(const ApuWriteLog& log, const ChannelLayout& layout, double row_clocks, uint64_t origin) {
+    rows_added_ = 0;
+    if (&log != log_ || layout != layout_ || row_clocks != row_clocks_ || origin != origin_) {
+        log_ = &log;
+        cursor_ = log.head();
+        layout_ = layout;
+        row_clocks_ = row_clocks;
+        origin_ = origin;
+        vrc6_base_ = fme7_base_ = namco_base_ = -1;
+        for (int i = layout_.size(); i--;) {
+            switch (layout_[i].kind) {
+                case ChannelKind::Vrc6Pulse:
+                case ChannelKind::Vrc6Saw: vrc6_base_ = i; break;
+                case ChannelKind::Fme7Square: fme7_base_ = i; break;
+                case ChannelKind::NamcoWave: namco_base_ = i; break;
+                default: break;
+            }
+        }
+        clear();
+    }
+    if (row_clocks_ <= 0.0 || layout_.size() == 0) return;
+
+    ApuWrite writes[READ_CHUNK];
+    int count;
+    while ((count = log.read(cursor_, writes, READ_CHUNK, &lost_)) > 0) {
+        for (int i = 0; i < count; ++i) {
+            int64_t row = rowOf(writes[i].cycle);
+            if (row < base_row_ || row - row_ > MAX_GAP_ROWS) {
+                reset();
+                base_row_ = row_ = row;
+            } else if (row < row_) {
+                // Back in time: drop the rows from there on, and show the
+                // channels written next in full
+                cells_.resize(static_cast<size_t>(row - base_row_) * layout_.size());
+                rows_added_ = 0;
+                row_ = row;
+                touched_ = triggered_ = swept_ = 0;
+                dac_written_ = false;
+                std::fill(std::begin(voices_), std::end(voices_), Voice());
+            }
+            while (row_ < row) closeRow();
+            apply(writes[i]);
+        }
+    }
+
+    // Keep the newest rows once the history gets long
+    if (rowCount() > MAX_ROWS) {
+        int drop = MAX_ROWS / 4;
+        cells_.erase(cells_.begin(), cells_.begin() + static_cast<size_t>(drop) * layout_.size());
+        base_row_ += drop;
+    }
+}
+
+void TrackerView::clear() {
+    reset();
+    lost_ = 0;
+}
+
+void TrackerView::reset() {
+    std::fill(std::begin(apu_), std::end(apu_), 0);
+    for (auto& regs : vrc6_) std::fill(std::begin(regs), std::end(regs), 0);
+    std::fill(std::begin(fme7_), std::end(fme7_), 0);
+    std::fill(std::begin(namco_), std::end(namco_), 0);
+    fme7_latch_ = 0;
+    namco_addr_ = 0;
+    base_row_ = row_ = 0;
+    touched_ = triggered_ = swept_ = 0;
+    dac_written_ = false;
+    std::fill(std::begin(voices_), std::end(voices_), Voice());
+    cells_.clear();
+    rows_added_ = 0;
+}
+
+int64_t TrackerView::rowOf(uint64_t cycle) const {
+    if (cycle <= origin_) return 0;
+    return static_cast<int64_t>(static_cast<double>(cycle - origin_) / row_clocks_);
+}
+
+void TrackerView::apply(const ApuWrite& write) {
+    uint16_t addr = write.addr;
+    uint8_t value = write.value;
+
+    if (addr >= 0x4000 && addr <= 0x4017) {
+        int reg = addr - 0x4000;
+        apu_[reg] = value;
+        if (reg < 0x10) {
+            int channel = reg >> 2;
+            if ((reg & 3) == 3) {
+                trigger(channel);   // length counter load restarts the note
+            } else {
+                touch(channel);
+            }
+            if (reg == 0x01 || reg == 0x05) swept_ |= 1u << channel;
+        } else if (reg < 0x14) {
+            touch(4);
+            if (reg == 0x11) dac_written_ = true;
+        } else if (reg == 0x15) {
+            touched_ |= 0x1F;
+            if (value & 0x10) trigger(4);
+        }
+        return;
+    }
+
+    if (namco_base_ >= 0 && addr == 0xF800) {
+        namco_addr_ = value;
+        return;
+    }
+    if (namco_base_ >= 0 && addr == 0x4800) {
+        int index = namco_addr_ & 0x7F;
+        namco_[index] = value;
+        if (namco_addr_ & 0x80) namco_addr_ = ((index + 1) & 0x7F) | 0x80;
+        if (index == 0x7F) {
+            touched_ |= 0xFFu << namco_base_;   // channel count
+        } else if (index >= 0x40) {
+            touch(namco_base_ + (index - 0x40) / 8);
+        }
+        return;
+    }
+
+    if (fme7_base_ >= 0 && addr >= 0xC000) {
+        if ((addr & 0xE000) == 0xC000) {
+            fme7_latch_ = value & 0x0F;
+        } else if ((addr & 0xE000) == 0xE000) {
+            fme7_[fme7_latch_] = value;
+            if (fme7_latch_ < 6) {
+                touch(fme7_base_ + fme7_latch_ / 2);
+            } else if (fme7_latch_ == 7) {
+                touched_ |= 7u << fme7_base_;
+            } else if (fme7_latch_ >= 8 && fme7_latch_ <= 10) {
+                touch(fme7_base_ + fme7_latch_ - 8);
+            }
+        }
+        return;
+    }
+
+    if (vrc6_base_ >= 0 && addr >= 0x9000 && addr < 0xC000 && (addr & 0xFFF) < 3) {
+        int osc = (addr - 0x9000) >> 12;
+        vrc6_[osc][addr & 0xFFF] = value;
+        touch(vrc6_base_ + osc);
+    }
+}
+
+void TrackerView::closeRow() {
+    int channels = layout_.size();
+    size_t at = cells_.size();
+    cells_.resize(at + channels);
+    for (int ch = 0; ch < channels; ++ch) {
+        if (touched_ & (1u << ch)) cells_[at + ch] = diff(ch);
+    }
+    touched_ = triggered_ = swept_ = 0;
+    dac_written_ = false;
+    ++row_;
+    ++rows_added_;
+}
+
+TrackerView::Cell TrackerView::diff(int channel) {
+    Voice now = decode(channel);
+    Voice& was = voices_[channel];
+    uint32_t bit = 1u << channel;
+    Cell cell;
+
+    // Settings made while silent show with the note they lead up to
+    if (now.note < 0 && was.note < 0) return cell;
+
+    if (now.note < 0) {
+        if (was.note >= 0) cell.note = NOTE_CUT;
+    } else if (was.note < 0 || now.note != was.note || (triggered_ & bit)) {
+        cell.note = static_cast<uint8_t>(now.note);
+    }
+    if (now.volume >= 0 && now.volume != was.volume) {
+        cell.volume = static_cast<uint8_t>(now.volume);
+    }
+
+    // One effect column: sweep, DAC write, timbre, then detune
+    const ChannelLayout::Channel& info = layout_[channel];
+    if (info.kind == ChannelKind::Square && (swept_ & bit) && (apu_[info.osc * 4 + 1] & 0x80)) {
+        uint8_t sweep = apu_[info.osc * 4 + 1];
+        cell.effect = (sweep & 0x08) ? 'H' : 'I';   // negate raises the pitch
+        cell.param = static_cast<uint8_t>(((sweep >> 4) & 7) << 4 | (sweep & 7));
+    } else if (info.kind == ChannelKind::DMC && dac_written_) {
+        cell.effect = 'Z';
+        cell.param = apu_[0x11] & 0x7F;
+    } else if (now.timbre >= 0 && now.timbre != was.timbre) {
+        cell.effect = 'V';
+        cell.param = static_cast<uint8_t>(now.timbre);
+    } else if (now.note >= 0 && cell.note == NO_NOTE && std::fabs(now.cents - was.cents) >= 1.0f) {
+        cell.effect = 'P';      // 80 is in tune, one step per cent
+        cell.param = static_cast<uint8_t>(std::clamp(0x80 + static_cast<int>(std::lround(now.cents)), 0, 0xFF));
+    }
+
+    was = now;
+    return cell;
+}
+
+TrackerView::Voice TrackerView::decode(int channel) const {
+    const ChannelLayout::Channel& info = layout_[channel];
+    Voice voice;
+    auto play = [&voice](PitchTable::Pitch pitch) {
+        if (pitch.note < 0) return;
+        voice.note = pitch.note;
+        voice.cents = pitch.cents;
+    };
+    switch (info.kind) {
+        case ChannelKind::Square: {
+            const uint8_t* r = &apu_[info.osc * 4];
+            int period = r[2] | (r[3] & 7) << 8;
+            if (((apu_[0x15] >> info.osc) & 1) && period >= 8) {
+                play(PitchTable::apuPulse(period));
+            }
+            voice.volume = r[0] & 0x0F;
+            voice.timbre = r[0] >> 6;
+            break;
+        }
+        case ChannelKind::Triangle: {
+            const uint8_t* r = &apu_[0x08];
+            int period = r[2] | (r[3] & 7) << 8;
+            if ((apu_[0x15] & 0x04) && (r[0] & 0x7F) && period >= 2) {
+                play(PitchTable::apuTriangle(period));
+            }
+            break;
+        }
+        case ChannelKind::Noise: {
+            const uint8_t* r = &apu_[0x0C];
+            if (apu_[0x15] & 0x08) voice.note = 15 - (r[2] & 0x0F);
+            voice.volume = r[0] & 0x0F;
+            voice.timbre = r[2] >> 7;
+            break;
+        }
+        case ChannelKind::DMC:
+            if (apu_[0x15] & 0x10) voice.note = apu_[0x10] & 0x0F;
+            break;
+        case ChannelKind::Vrc6Pulse: {
+            const uint8_t* r = vrc6_[info.osc];
+            int period = r[1] | (r[2] & 0x0F) << 8;
+            if (r[2] & 0x80) play(PitchTable::vrc6Pulse(period));
+            voice.volume = r[0] & 0x0F;
+            voice.timbre = (r[0] & 0x80) ? 8 : (r[0] >> 4) & 7;    // 8: digitized mode
+            break;
+        }
+        case ChannelKind::Vrc6Saw: {
+            const uint8_t* r = vrc6_[2];
+            int period = r[1] | (r[2] & 0x0F) << 8;
+            if (r[2] & 0x80) play(PitchTable::vrc6Saw(period));
+            voice.volume = (r[0] & 0x3F) >> 2;
+            break;
+        }
+        case ChannelKind::Fme7Square: {
+            int period = fme7_[info.osc * 2] | (fme7_[info.osc * 2 + 1] & 0x0F) << 8;
+            if (!((fme7_[7] >> info.osc) & 1) && period > 0) {
+                play(PitchTable::fme7Tone(period));
+            }
+            voice.volume = fme7_[8 + info.osc] & 0x0F;
+            break;
+        }
+        case ChannelKind::NamcoWave: {
+            // Same terms as Nes_Namco_Apu::osc_period
+            const uint8_t* r = &namco_[0x40 + info.osc * 8];
+            int active = ((namco_[0x7F] >> 4) & 7) + 1;
+            long freq = (r[4] & 3) * 0x10000L + r[2] * 0x100L + r[0];
+            int wave_size = 32 - ((r[4] >> 2) & 7) * 4;
+            if (info.osc >= 8 - active && (r[4] & 0xE0) && freq >= 64L * active) {
+                pitchOf(983040.0 * active * wave_size / freq, &voice.note, &voice.cents);
+            }
+            voice.volume = r[7] & 0x0F;
+            break;
+        }
+        case ChannelKind::Voice:
+            break;  // no register log outside NSF files
+    }
+    return voice;
+}
+
+void TrackerView::drawWindow(bool* p_open) {
+    ImGui::SetNextWindowSize(ImVec2(640, 480), ImGuiCond_FirstUseEver);
+    if (!ImGui::Begin("Tracker", p_open)) {
+        ImGui::End();
+        return;
+    }
+
+    int rows = rowCount();
+    int channels = layout_.size();
+    ImGui::Checkbox("Follow", &follow_);
+    ImGui::SameLine();
+    if (ImGui::Button("Clear")) {
+        clear();
+        rows = 0;
+    }
+    ImGui::SameLine();
+    ImGui::TextDisabled("%d rows, %.2f rows/s", rows, row_clocks_ > 0.0 ? CPU_CLOCK / row_clocks_ : 0.0);
+    if (lost_) {
+        ImGui::SameLine();
+        ImGui::TextDisabled("(%llu writes dropped while the UI was stalled)", static_cast<unsigned long long>(lost_));
+    }
+
+    if (channels == 0) {
+        ImGui::TextDisabled("Nothing playing");
+        ImGui::End();
+        return;
+    }
+
+    ImGuiTableFlags flags = ImGuiTableFlags_ScrollX | ImGuiTableFlags_ScrollY | ImGuiTableFlags_RowBg |
+                            ImGuiTableFlags_BordersInnerV | ImGuiTableFlags_SizingFixedFit;
+    if (ImGui::BeginTable("##pattern", channels + 1, flags)) {
+        ImGui::TableSetupScrollFreeze(1, 1);
+        ImGui::TableSetupColumn("Row");
+        for (int ch = 0; ch < channels; ++ch) {
+            ImGui::TableSetupColumn(layout_[ch].short_name);
+        }
+        ImGui::TableNextRow(ImGuiTableRowFlags_Headers);
+        ImGui::TableSetColumnIndex(0);
+        ImGui::TableHeader("Row");
+        for (int ch = 0; ch < channels; ++ch) {
+            ImGui::TableSetColumnIndex(ch + 1);
+            ImGui::PushStyleColor(ImGuiCol_Text, rgbColor(layout_[ch].rgb));
+            ImGui::TableHeader(layout_[ch].short_name);
+            ImGui::PopStyleColor();
+        }
+
+        ImVec4 empty_color = ImGui::GetStyleColorVec4(ImGuiCol_TextDisabled);
+        ImVec4 volume_color(0.55f, 0.8f, 0.55f, 1.0f);
+        ImVec4 effect_color(0.9f, 0.75f, 0.45f, 1.0f);
+        ImU32 beat_color = ImGui::GetColorU32(ImGuiCol_TableHeaderBg, 0.6f);
+        static const char* const names[12] = {"C-", "C#", "D-", "D#", "E-", "F-", "F#", "G-", "G#", "A-", "A#", "B-"};
+
+        ImGuiListClipper clipper;
+        clipper.Begin(rows);
+        while (clipper.Step()) {
+            for (int i = clipper.DisplayStart; i < clipper.DisplayEnd; ++i) {
+                int64_t number = base_row_ + i;
+                int in_pattern = static_cast<int>(number % ROWS_PER_PATTERN);
+                ImGui::TableNextRow();
+                if (in_pattern % 16 == 0) ImGui::TableSetBgColor(ImGuiTableBgTarget_RowBg1, beat_color);
+                ImGui::TableSetColumnIndex(0);
+                ImGui::TextDisabled("%02X:%02X", static_cast<unsigned>(number / ROWS_PER_PATTERN & 0xFF),
+                                    static_cast<unsigned>(in_pattern));
+
+                const Cell* cells = row(i);
+                for (int ch = 0; ch < channels; ++ch) {
+                    ImGui::TableSetColumnIndex(ch + 1);
+                    const Cell& cell = cells[ch];
+                    ChannelKind kind = layout_[ch].kind;
+                    char text[8];
+                    if (cell.note == NO_NOTE) {
+                        ImGui::TextColored(empty_color, "...");
+                    } else if (cell.note == NOTE_CUT) {
+                        ImGui::TextUnformatted("---");
+                    } else {
+                        if (kind == ChannelKind::Noise || kind == ChannelKind::DMC) {
+                            std::snprintf(text, sizeof(text), "%X-#", cell.note & 0x0F);
+                        } else {
+                            std::snprintf(text, sizeof(text), "%s%d", names[cell.note % 12], cell.note / 12 - 1);
+                        }
+                        ImGui::TextColored(rgbColor(layout_[ch].rgb), "%s", text);
+                    }
+                    ImGui::SameLine();
+                    if (cell.volume == NO_VOLUME) {
+                        ImGui::TextColored(empty_color, ".");
+                    } else {
+                        ImGui::TextColored(volume_color, "%X", cell.volume);
+                    }
+                    ImGui::SameLine();
+                    if (cell.effect) {
+                        ImGui::TextColored(effect_color, "%c%02X", cell.effect, cell.param);
+                    } else {
+                        ImGui::TextColored(empty_color, "...");
+                    }
+                }
+            }
+        }
+
+        if (follow_ && rows_added_ > 0) {
+            ImGui::SetScrollY(ImGui::GetScrollMaxY() + ImGui::GetTextLineHeightWithSpacing() * rows_added_);
+        }
+        ImGui::EndTable();
+    }
+    ImGui::End();
+}
@@ -0,0 +1,103 @@
+#pragma once
+
+#include "ApuWriteLog.h"
+#include "ChannelLayout.h"
+#include <cstdint>
+#include <vector>
+
+// FamiTracker-style pattern view of the sound register trace. Writes are
+// quantized to rows of one play routine call (one video frame for a game),
+// the register state each row leaves behind is decoded per channel into a
+// note, a volume and one effect, and a cell only shows what changed since
+// the row before. update() folds in just the writes that arrived since the
+// last frame and appends the rows they complete; the table only lays out
+// its visible rows, so a long song costs no more per frame than a short one.
+//
+// Everything is decoded from the writes alone: notes ended by a length
+// counter or a decaying envelope are not cut.
+class TrackerView {
+public:
+    static constexpr double NES_ROW_CLOCKS = 29780.5;       // one NTSC frame
+    static constexpr uint64_t NES_ROW_ORIGIN = 27394;       // first vblank NMI after power-on
+
+    static constexpr uint8_t NO_NOTE = 0xFF;
+    static constexpr uint8_t NOTE_CUT = 0xFE;
+    static constexpr uint8_t NO_VOLUME = 0xFF;
+
+    struct Cell {
+        uint8_t note = NO_NOTE;     // MIDI note; noise: pitch 0-15, DMC: rate index
+        uint8_t volume = NO_VOLUME; // 0-15
+        char effect = 0;            // FamiTracker effect letter, 0 for none
+        uint8_t param = 0;
+    };
+
+    TrackerView() = default;
+
+    // Main thread, once per frame whether or not the window is open, so the
+    // history is there when it opens. row_clocks: CPU clocks per row; origin:
+    // the clock the first row starts at. A different log, layout or row
+    // length starts over; a write from before the rows already built (new
+    // track, rewind, state load) drops the rows from there on.
+    void update(const ApuWriteLog& log, const ChannelLayout& layout, double row_clocks, uint64_t origin);
+    void clear();
+
+    int rowCount() const { return layout_.size() > 0 ? static_cast<int>(cells_.size() / layout_.size()) : 0; }
+    const Cell* row(int index) const { return &cells_[static_cast<size_t>(index) * layout_.size()]; }
+
+    void drawWindow(bool* p_open);
+
+private:
+    static constexpr int ROWS_PER_PATTERN = 64;
+    static constexpr int MAX_ROWS = 1 << 18;        // over an hour at 60 rows a second
+    static constexpr int MAX_GAP_ROWS = 60 * 60;    // a jump further ahead than this starts over
+    static constexpr int READ_CHUNK = 1024;
+
+    // What a channel plays after a row
+    struct Voice {
+        int note = -1;          // -1 while disabled or keyed off; volume 0 still holds the note
+        int volume = -1;        // -1 if the channel has no volume
+        int timbre = -1;        // duty or noise mode, -1 if the channel has none
+        float cents = 0.0f;     // detune from 'note'
+    };
+
+    void reset();
+    void apply(const ApuWrite& write);
+    void closeRow();
+    Cell diff(int channel);
+    Voice decode(int channel) const;
+    int64_t rowOf(uint64_t cycle) const;
+    void touch(int channel) { if (channel >= 0) touched_ |= 1u << channel; }
+    void trigger(int channel) { if (channel >= 0) { touched_ |= 1u << channel; triggered_ |= 1u << channel; } }
+
+    const ApuWriteLog* log_ = nullptr;
+    uint64_t cursor_ = 0;
+    uint64_t lost_ = 0;
+    ChannelLayout layout_;
+    double row_clocks_ = 0.0;
+    uint64_t origin_ = 0;
+    int vrc6_base_ = -1;        // layout index of each expansion chip's first channel
+    int fme7_base_ = -1;
+    int namco_base_ = -1;
+
+    // Register shadows
+    uint8_t apu_[0x18] = {};
+    uint8_t vrc6_[3][3] = {};
+    uint8_t fme7_[16] = {};
+    uint8_t fme7_latch_ = 0;
+    uint8_t namco_[128] = {};
+    uint8_t namco_addr_ = 0;
+
+    // Row being built; rows before it are in cells_
+    int64_t base_row_ = 0;      // row number of the first row kept
+    int64_t row_ = 0;
+    uint32_t touched_ = 0;      // channels written during the row
+    uint32_t triggered_ = 0;    // channels whose note was restarted (length load, DMC start)
+    uint32_t swept_ = 0;        // pulse channels whose sweep unit was written
+    bool dac_written_ = false;  // $4011 written
+    Voice voices_[ChannelLayout::MAX_CHANNELS];    // as of the last closed row
+
+    std::vector<Cell> cells_;   // rowCount() x layout_.size()
+
+    bool follow_ = true;
+    int rows_added_ = 0;        // by the last update
+};
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+// Lock-free single-producer / single-consumer triple buffer.
+// The writer fills back(), then publish() swaps it with the shared middle slot;
+// the reader's acquire() picks up the newest published value. Neither side
+// ever waits, and the reader always sees a complete value (intermediate ones
+// may be skipped).
+template <typename T>
+class TripleBuffer {
+public:
+    TripleBuffer() = default;
+    TripleBuffer(const TripleBuffer&) = delete;
+    TripleBuffer& operator=(const TripleBuffer&) = delete;
+
+    // Writer side
+    T& back() { return slots_[back_]; }
+    void publish() {
+        uint32_t prev = middle_.exchange(back_ | DIRTY, std::memory_order_acq_rel);
+        back_ = prev & INDEX_MASK;
+    }
+
+    // Reader side: returns true if a new value was picked up
+    bool acquire() {
+        if (!(middle_.load(std::memory_order_relaxed) & DIRTY)) return false;
+        uint32_t prev = middle_.exchange(front_, std::memory_order_acq_rel);
+        front_ = prev & INDEX_MASK;
+        return true;
+    }
+    // Whether acquire() would pick up a new value
+    bool ready() const { return (middle_.load(std::memory_order_relaxed) & DIRTY) != 0; }
+    const T& front() const { return slots_[front_]; }
+
+    // Set every slot, e.g. to size their contents. Only while neither side
+    // is using the buffer.
+    void assign(const T& value) {
+        for (T& slot : slots_) slot = value;
+    }
+
+private:
+    static constexpr uint32_t DIRTY = 4;
+    static constexpr uint32_t INDEX_MASK = 3;
+
+    T slots_[3] = {};
+    uint32_t back_ = 0;                     // owned by the writer
+    uint32_t front_ = 1;                    // owned by the reader
+    alignas(64) std::atomic<uint32_t> middle_{2};
+};
@@ -0,0 +1,343 @@
+#include "Vectorscope.h"
+#include "GpuMemory.h"
+#include <algorithm>
+#include <cmath>
+
+/*
+    Vulkan shaders (SPIR-V 1.4, set/binding layout as sokol-shdc emits it).
+    One shader serves both pipelines: the fade draws a full-target triangle
+    with the identity transform, the points draw the sample pairs.
+
+    layout(set = 0, binding = 0) uniform vs_params {
+        vec4 transform;     // rows of the 2x2 matrix
+        vec4 color;
+    };
+    layout(location = 0) in vec2 position;
+    layout(location = 0) out vec4 tint;
+    void main() {
+        gl_Position = vec4(dot(transform.xy, position), dot(transform.zw, position), 0.5, 1.0);
+        gl_PointSize = 1.0;
+        tint = color;
+    }
+
+    layout(location = 0) in vec4 tint;
+    layout(location = 0) out vec4 frag_color;
+    void main() {
+        frag_color = tint;
+    }
+
+    The blend state does the rest: the fade keeps SRC_ALPHA (the decay) of
+    the color already there, the points add theirs, and neither touches
+    the target's alpha, which stays opaque.
+*/
+static const uint8_t _scope_vs_bytecode_spirv[1024] = {
+    0x03,0x02,0x23,0x07,0x00,0x04,0x01,0x00,0x0b,0x00,0x08,0x00,0x29,0x00,0x00,0x00,
+    0x00,0x00,0x00,0x00,0x11,0x00,0x02,0x00,0x01,0x00,0x00,0x00,0x0b,0x00,0x06,0x00,
+    0x01,0x00,0x00,0x00,0x47,0x4c,0x53,0x4c,0x2e,0x73,0x74,0x64,0x2e,0x34,0x35,0x30,
+    0x00,0x00,0x00,0x00,0x0e,0x00,0x03,0x00,0x00,0x00,0x00,0x00,0x01,0x00,0x00,0x00,
+    0x0f,0x00,0x09,0x00,0x00,0x00,0x00,0x00,0x02,0x00,0x00,0x00,0x6d,0x61,0x69,0x6e,
+    0x00,0x00,0x00,0x00,0x0c,0x00,0x00,0x00,0x0e,0x00,0x00,0x00,0x11,0x00,0x00,0x00,
+    0x13,0x00,0x00,0x00,0x47,0x00,0x03,0x00,0x0b,0x00,0x00,0x00,0x02,0x00,0x00,0x00,
+    0x48,0x00,0x05,0x00,0x0b,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x0b,0x00,0x00,0x00,
+    0x00,0x00,0x00,0x00,0x48,0x00,0x05,0x00,0x0b,0x00,0x00,0x00,0x01,0x00,0x00,0x00,
+    0x0b,0x00,0x00,0x00,0x01,0x00,0x00,0x00,0x48,0x00,0x05,0x00,0x0b,0x00,0x00,0x00,
+    0x02,0x00,0x00,0x00,0x0b,0x00,0x00,0x00,0x03,0x00,0x00,0x00,0x48,0x00,0x05,0x00,
+    0x0b,0x00,0x00,0x00,0x03,0x00,0x00,0x00,0x0b,0x00,0x00,0x00,0x04,0x00,0x00,0x00,
+    0x47,0x00,0x04,0x00,0x0e,0x00,0x00,0x00,0x1e,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+    0x47,0x00,0x03,0x00,0x10,0x00,0x00,0x00,0x02,0x00,0x00,0x00,0x48,0x00,0x05,0x00,
+    0x10,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x23,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+    0x48,0x00,0x05,0x00,0x10,0x00,0x00,0x00,0x01,0x00,0x00,0x00,0x23,0x00,0x00,0x00,
+    0x10,0x00,0x00,0x00,0x47,0x00,0x04,0x00,0x11,0x00,0x00,0x00,0x22,0x00,0x00,0x00,
+    0x00,0x00,0x00,0x00,0x47,0x00,0x04,0x00,0x11,0x00,0x00,0x00,0x21,0x00,0x00,0x00,
+    0x00,0x00,0x00,0x00,0x47,0x00,0x04,0x00,0x13,0x00,0x00,0x00,0x1e,0x00,0x00,0x00,
+    0x00,0x00,0x00,0x00,0x16,0x00,0x03,0x00,0x03,0x00,0x00,0x00,0x20,0x00,0x00,0x00,
+    0x17,0x00,0x04,0x00,0x04,0x00,0x00,0x00,0x03,0x00,0x00,0x00,0x02,0x00,0x00,0x00,
+    0x17,0x00,0x04,0x00,0x05,0x00,0x00,0x00,0x03,0x00,0x00,0x00,0x04,0x00,0x00,0x00,
+    0x13,0x00,0x02,0x00,0x06,0x00,0x00,0x00,0x21,0x00,0x03,0x00,0x07,0x00,0x00,0x00,
+    0x06,0x00,0x00,0x00,0x15,0x00,0x04,0x00,0x08,0x00,0x00,0x00,0x20,0x00,0x00,0x00,
+    0x00,0x00,0x00,0x00,0x2b,0x00,0x04,0x00,0x08,0x00,0x00,0x00,0x09,0x00,0x00,0x00,
+    0x01,0x00,0x00,0x00,0x1c,0x00,0x04,0x00,0x0a,0x00,0x00,0x00,0x03,0x00,0x00,0x00,
+    0x09,0x00,0x00,0x00,0x1e,0x00,0x06,0x00,0x0b,0x00,0x00,0x00,0x05,0x00,0x00,0x00,
+    0x03,0x00,0x00,0x00,0x0a,0x00,0x00,0x00,0x0a,0x00,0x00,0x00,0x20,0x00,0x04,0x00,
+    0x0d,0x00,0x00,0x00,0x03,0x00,0x00,0x00,0x0b,0x00,0x00,0x00,0x3b,0x00,0x04,0x00,
+    0x0d,0x00,0x00,0x00,0x0c,0x00,0x00,0x00,0x03,0x00,0x00,0x00,0x20,0x00,0x04,0x00,
+    0x0f,0x00,0x00,0x00,0x01,0x00,0x00,0x00,0x04,0x00,0x00,0x00,0x3b,0x00,0x04,0x00,
+    0x0f,0x00,0x00,0x00,0x0e,0x00,0x00,0x00,0x01,0x00,0x00,0x00,0x1e,0x00,0x04,0x00,
+    0x10,0x00,0x00,0x00,0x05,0x00,0x00,0x00,0x05,0x00,0x00,0x00,0x20,0x00,0x04,0x00,
+    0x12,0x00,0x00,0x00,0x02,0x00,0x00,0x00,0x10,0x00,0x00,0x00,0x3b,0x00,0x04,0x00,
+    0x12,0x00,0x00,0x00,0x11,0x00,0x00,0x00,0x02,0x00,0x00,0x00,0x20,0x00,0x04,0x00,
+    0x14,0x00,0x00,0x00,0x03,0x00,0x00,0x00,0x05,0x00,0x00,0x00,0x3b,0x00,0x04,0x00,
+    0x14,0x00,0x00,0x00,0x13,0x00,0x00,0x00,0x03,0x00,0x00,0x00,0x15,0x00,0x04,0x00,
+    0x15,0x00,0x00,0x00,0x20,0x00,0x00,0x00,0x01,0x00,0x00,0x00,0x20,0x00,0x04,0x00,
+    0x16,0x00,0x00,0x00,0x02,0x00,0x00,0x00,0x05,0x00,0x00,0x00,0x2b,0x00,0x04,0x00,
+    0x15,0x00,0x00,0x00,0x17,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x2b,0x00,0x04,0x00,
+    0x15,0x00,0x00,0x00,0x1a,0x00,0x00,0x00,0x01,0x00,0x00,0x00,0x2b,0x00,0x04,0x00,
+    0x03,0x00,0x00,0x00,0x22,0x00,0x00,0x00,0x00,0x00,0x00,0x3f,0x2b,0x00,0x04,0x00,
+    0x03,0x00,0x00,0x00,0x23,0x00,0x00,0x00,0x00,0x00,0x80,0x3f,0x20,0x00,0x04,0x00,
+    0x26,0x00,0x00,0x00,0x03,0x00,0x00,0x00,0x03,0x00,0x00,0x00,0x36,0x00,0x05,0x00,
+    0x06,0x00,0x00,0x00,0x02,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x07,0x00,0x00,0x00,
+    0xf8,0x00,0x02,0x00,0x28,0x00,0x00,0x00,0x41,0x00,0x05,0x00,0x16,0x00,0x00,0x00,
+    0x18,0x00,0x00,0x00,0x11,0x00,0x00,0x00,0x17,0x00,0x00,0x00,0x3d,0x00,0x04,0x00,
+    0x05,0x00,0x00,0x00,0x19,0x00,0x00,0x00,0x18,0x00,0x00,0x00,0x41,0x00,0x05,0x00,
+    0x16,0x00,0x00,0x00,0x1b,0x00,0x00,0x00,0x11,0x00,0x00,0x00,0x1a,0x00,0x00,0x00,
+    0x3d,0x00,0x04,0x00,0x05,0x00,0x00,0x00,0x1c,0x00,0x00,0x00,0x1b,0x00,0x00,0x00,
+    0x3d,0x00,0x04,0x00,0x04,0x00,0x00,0x00,0x1d,0x00,0x00,0x00,0x0e,0x00,0x00,0x00,
+    0x4f,0x00,0x07,0x00,0x04,0x00,0x00,0x00,0x1e,0x00,0x00,0x00,0x19,0x00,0x00,0x00,
+    0x19,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x01,0x00,0x00,0x00,0x4f,0x00,0x07,0x00,
+    0x04,0x00,0x00,0x00,0x1f,0x00,0x00,0x00,0x19,0x00,0x00,0x00,0x19,0x00,0x00,0x00,
+    0x02,0x00,0x00,0x00,0x03,0x00,0x00,0x00,0x94,0x00,0x05,0x00,0x03,0x00,0x00,0x00,
+    0x20,0x00,0x00,0x00,0x1e,0x00,0x00,0x00,0x1d,0x00,0x00,0x00,0x94,0x00,0x05,0x00,
+    0x03,0x00,0x00,0x00,0x21,0x00,0x00,0x00,0x1f,0x00,0x00,0x00,0x1d,0x00,0x00,0x00,
+    0x50,0x00,0x07,0x00,0x05,0x00,0x00,0x00,0x24,0x00,0x00,0x00,0x20,0x00,0x00,0x00,
+    0x21,0x00,0x00,0x00,0x22,0x00,0x00,0x00,0x23,0x00,0x00,0x00,0x41,0x00,0x05,0x00,
+    0x14,0x00,0x00,0x00,0x25,0x00,0x00,0x00,0x0c,0x00,0x00,0x00,0x17,0x00,0x00,0x00,
+    0x3e,0x00,0x03,0x00,0x25,0x00,0x00,0x00,0x24,0x00,0x00,0x00,0x41,0x00,0x05,0x00,
+    0x26,0x00,0x00,0x00,0x27,0x00,0x00,0x00,0x0c,0x00,0x00,0x00,0x1a,0x00,0x00,0x00,
+    0x3e,0x00,0x03,0x00,0x27,0x00,0x00,0x00,0x23,0x00,0x00,0x00,0x3e,0x00,0x03,0x00,
+    0x13,0x00,0x00,0x00,0x1c,0x00,0x00,0x00,0xfd,0x00,0x01,0x00,0x38,0x00,0x01,0x00,
+};
+
+static const uint8_t _scope_fs_bytecode_spirv[312] = {
+    0x03,0x02,0x23,0x07,0x00,0x04,0x01,0x00,0x0b,0x00,0x08,0x00,0x0d,0x00,0x00,0x00,
+    0x00,0x00,0x00,0x00,0x11,0x00,0x02,0x00,0x01,0x00,0x00,0x00,0x0b,0x00,0x06,0x00,
+    0x01,0x00,0x00,0x00,0x47,0x4c,0x53,0x4c,0x2e,0x73,0x74,0x64,0x2e,0x34,0x35,0x30,
+    0x00,0x00,0x00,0x00,0x0e,0x00,0x03,0x00,0x00,0x00,0x00,0x00,0x01,0x00,0x00,0x00,
+    0x0f,0x00,0x07,0x00,0x04,0x00,0x00,0x00,0x02,0x00,0x00,0x00,0x6d,0x61,0x69,0x6e,
+    0x00,0x00,0x00,0x00,0x07,0x00,0x00,0x00,0x09,0x00,0x00,0x00,0x10,0x00,0x03,0x00,
+    0x02,0x00,0x00,0x00,0x07,0x00,0x00,0x00,0x47,0x00,0x04,0x00,0x07,0x00,0x00,0x00,
+    0x1e,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x47,0x00,0x04,0x00,0x09,0x00,0x00,0x00,
+    0x1e,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x16,0x00,0x03,0x00,0x03,0x00,0x00,0x00,
+    0x20,0x00,0x00,0x00,0x17,0x00,0x04,0x00,0x04,0x00,0x00,0x00,0x03,0x00,0x00,0x00,
+    0x04,0x00,0x00,0x00,0x13,0x00,0x02,0x00,0x05,0x00,0x00,0x00,0x21,0x00,0x03,0x00,
+    0x06,0x00,0x00,0x00,0x05,0x00,0x00,0x00,0x20,0x00,0x04,0x00,0x08,0x00,0x00,0x00,
+    0x03,0x00,0x00,0x00,0x04,0x00,0x00,0x00,0x3b,0x00,0x04,0x00,0x08,0x00,0x00,0x00,
+    0x07,0x00,0x00,0x00,0x03,0x00,0x00,0x00,0x20,0x00,0x04,0x00,0x0a,0x00,0x00,0x00,
+    0x01,0x00,0x00,0x00,0x04,0x00,0x00,0x00,0x3b,0x00,0x04,0x00,0x0a,0x00,0x00,0x00,
+    0x09,0x00,0x00,0x00,0x01,0x00,0x00,0x00,0x36,0x00,0x05,0x00,0x05,0x00,0x00,0x00,
+    0x02,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x06,0x00,0x00,0x00,0xf8,0x00,0x02,0x00,
+    0x0c,0x00,0x00,0x00,0x3d,0x00,0x04,0x00,0x04,0x00,0x00,0x00,0x0b,0x00,0x00,0x00,
+    0x09,0x00,0x00,0x00,0x3e,0x00,0x03,0x00,0x07,0x00,0x00,0x00,0x0b,0x00,0x00,0x00,
+    0xfd,0x00,0x01,0x00,0x38,0x00,0x01,0x00,
+};
+
+static const char _scope_vs_source_metal[] =
+    "#include <metal_stdlib>\n"
+    "using namespace metal;\n"
+    "struct vs_params { float4 transform; float4 color; };\n"
+    "struct vs_in {\n"
+    "    float2 position [[attribute(0)]];\n"
+    "};\n"
+    "struct vs_out {\n"
+    "    float4 pos [[position]];\n"
+    "    float point_size [[point_size]];\n"
+    "    float4 tint [[user(locn0)]];\n"
+    "};\n"
+    "vertex vs_out main0(vs_in in [[stage_in]], constant vs_params& u [[buffer(0)]]) {\n"
+    "    vs_out out;\n"
+    "    out.pos = float4(dot(u.transform.xy, in.position), dot(u.transform.zw, in.position), 0.5, 1.0);\n"
+    "    out.point_size = 1.0;\n"
+    "    out.tint = u.color;\n"
+    "    return out;\n"
+    "}\n";
+
+static const char _scope_fs_source_metal[] =
+    "#include <metal_stdlib>\n"
+    "using namespace metal;\n"
+    "struct fs_in {\n"
+    "    float4 tint [[user(locn0)]];\n"
+    "};\n"
+    "fragment float4 main0(fs_in in [[stage_in]]) {\n"
+    "    return in.tint;\n"
+    "}\n";
+
+static bool scopeShaderDesc(sg_shader_desc& desc) {
+    desc = {};
+    switch (sg_query_backend()) {
+        case SG_BACKEND_VULKAN:
+            desc.vertex_func.bytecode = SG_RANGE(_scope_vs_bytecode_spirv);
+            desc.vertex_func.entry = "main";
+            desc.fragment_func.bytecode = SG_RANGE(_scope_fs_bytecode_spirv);
+            desc.fragment_func.entry = "main";
+            break;
+        case SG_BACKEND_METAL_MACOS:
+        case SG_BACKEND_METAL_IOS:
+        case SG_BACKEND_METAL_SIMULATOR:
+            desc.vertex_func.source = _scope_vs_source_metal;
+            desc.vertex_func.entry = "main0";
+            desc.fragment_func.source = _scope_fs_source_metal;
+            desc.fragment_func.entry = "main0";
+            break;
+        default:
+            return false;
+    }
+
+    desc.attrs[0].base_type = SG_SHADERATTRBASETYPE_FLOAT;
+    desc.uniform_blocks[0].stage = SG_SHADERSTAGE_VERTEX;
+    desc.uniform_blocks[0].size = 32;
+    desc.uniform_blocks[0].msl_buffer_n = 0;
+    desc.uniform_blocks[0].spirv_set0_binding_n = 0;
+    desc.label = "vectorscope-shader";
+    return true;
+}
+
+const char* Vectorscope::modeName(Mode mode) {
+    switch (mode) {
+        case Mode::GONIOMETER: return "Goniometer";
+        case Mode::LISSAJOUS:  return "Lissajous";
+        case Mode::COUNT:      break;
+    }
+    return "?";
+}
+
+bool Vectorscope::init() {
+    if (valid_) return true;
+
+    sg_shader_desc shd_desc;
+    if (!scopeShaderDesc(shd_desc)) return false;
+    shader_ = sg_make_shader(&shd_desc);
+
+    // Both pipelines leave alpha alone; the fade scales the color by its
+    // source alpha, the points add theirs
+    sg_pipeline_desc pip_desc = {};
+    pip_desc.shader = shader_;
+    pip_desc.layout.attrs[0].format = SG_VERTEXFORMAT_FLOAT2;
+    pip_desc.depth.pixel_format = SG_PIXELFORMAT_NONE;
+    pip_desc.colors[0].pixel_format = SG_PIXELFORMAT_RGBA8;
+    pip_desc.colors[0].blend.enabled = true;
+    pip_desc.colors[0].blend.src_factor_rgb = SG_BLENDFACTOR_ZERO;
+    pip_desc.colors[0].blend.dst_factor_rgb = SG_BLENDFACTOR_SRC_ALPHA;
+    pip_desc.colors[0].blend.src_factor_alpha = SG_BLENDFACTOR_ZERO;
+    pip_desc.colors[0].blend.dst_factor_alpha = SG_BLENDFACTOR_ONE;
+    pip_desc.sample_count = 1;
+    pip_desc.label = "vectorscope-fade-pipeline";
+    fade_pipeline_ = sg_make_pipeline(&pip_desc);
+
+    pip_desc.primitive_type = SG_PRIMITIVETYPE_POINTS;
+    pip_desc.colors[0].blend.src_factor_rgb = SG_BLENDFACTOR_ONE;
+    pip_desc.colors[0].blend.dst_factor_rgb = SG_BLENDFACTOR_ONE;
+    pip_desc.label = "vectorscope-point-pipeline";
+    point_pipeline_ = sg_make_pipeline(&pip_desc);
+
+    // Same oversized triangle as PaletteRenderer
+    const float tri[] = { -1.0f, 1.0f,  3.0f, 1.0f,  -1.0f, -3.0f };
+    sg_buffer_desc buf_desc = {};
+    buf_desc.data = SG_RANGE(tri);
+    buf_desc.label = "vectorscope-triangle";
+    triangle_ = sg_make_buffer(&buf_desc);
+
+    buf_desc = {};
+    buf_desc.size = sizeof(points_);
+    buf_desc.usage.stream_update = true;
+    buf_desc.label = "vectorscope-points";
+    vertices_ = sg_make_buffer(&buf_desc);
+
+    sg_image_desc img_desc = {};
+    img_desc.width = SIZE;
+    img_desc.height = SIZE;
+    img_desc.pixel_format = SG_PIXELFORMAT_RGBA8;
+    img_desc.sample_count = 1;
+    img_desc.usage.color_attachment = true;
+    img_desc.label = "vectorscope-target";
+    image_ = MakeGpuImage(&img_desc);
+
+    valid_ = sg_query_shader_state(shader_) == SG_RESOURCESTATE_VALID &&
+             sg_query_pipeline_state(fade_pipeline_) == SG_RESOURCESTATE_VALID &&
+             sg_query_pipeline_state(point_pipeline_) == SG_RESOURCESTATE_VALID &&
+             sg_query_buffer_state(vertices_) == SG_RESOURCESTATE_VALID &&
+             sg_query_image_state(image_) == SG_RESOURCESTATE_VALID;
+    if (!valid_) {
+        shutdown();
+        return false;
+    }
+
+    sg_view_desc view_desc = {};
+    view_desc.color_attachment.image = image_;
+    attachment_ = sg_make_view(&view_desc);
+    view_desc = {};
+    view_desc.texture.image = image_;
+    texture_ = sg_make_view(&view_desc);
+
+    sg_sampler_desc smp_desc = {};
+    smp_desc.min_filter = SG_FILTER_LINEAR;
+    smp_desc.mag_filter = SG_FILTER_LINEAR;
+    smp_desc.wrap_u = SG_WRAP_CLAMP_TO_EDGE;
+    smp_desc.wrap_v = SG_WRAP_CLAMP_TO_EDGE;
+    sampler_ = sg_make_sampler(&smp_desc);
+    cleared_ = false;
+    return true;
+}
+
+void Vectorscope::shutdown() {
+    sg_destroy_sampler(sampler_);
+    sg_destroy_view(texture_);
+    sg_destroy_view(attachment_);
+    DestroyGpuImage(image_);
+    sg_destroy_buffer(vertices_);
+    sg_destroy_buffer(triangle_);
+    sg_destroy_pipeline(point_pipeline_);
+    sg_destroy_pipeline(fade_pipeline_);
+    sg_destroy_shader(shader_);
+    sampler_ = {};
+    texture_ = {};
+    attachment_ = {};
+    image_ = {};
+    vertices_ = {};
+    triangle_ = {};
+    point_pipeline_ = {};
+    fade_pipeline_ = {};
+    shader_ = {};
+    valid_ = false;
+}
+
+void Vectorscope::clear() {
+    cleared_ = false;
+}
+
+void Vectorscope::render(const float* left, const float* right, int count, Mode mode, float gain,
+                         float decay, uint32_t rgb, float intensity) {
+    if (!valid_) return;
+
+    count = std::clamp(count, 0, MAX_POINTS);
+    if (count > 0) {
+        for (int i = 0; i < count; ++i) {
+            points_[i * 2] = left[i];
+            points_[i * 2 + 1] = right[i];
+        }
+        sg_range range = { points_, count * 2 * sizeof(float) };
+        sg_update_buffer(vertices_, &range);
+    }
+
+    sg_pass pass = {};
+    pass.action.colors[0].load_action = cleared_ ? SG_LOADACTION_LOAD : SG_LOADACTION_CLEAR;
+    pass.action.colors[0].clear_value = { 0.0f, 0.0f, 0.0f, 1.0f };
+    pass.attachments.colors[0] = attachment_;
+    pass.label = "vectorscope-pass";
+    sg_begin_pass(&pass);
+    cleared_ = true;
+
+    sg_bindings bind = {};
+    bind.vertex_buffers[0] = triangle_;
+    Params params = { { 1.0f, 0.0f, 0.0f, 1.0f }, { 0.0f, 0.0f, 0.0f, std::clamp(decay, 0.0f, 1.0f) } };
+    sg_apply_pipeline(fade_pipeline_);
+    sg_apply_bindings(&bind);
+    sg_apply_uniforms(0, SG_RANGE(params));
+    sg_draw(0, 3, 1);
+
+    if (count > 0) {
+        // Goniometer: side (R - L) across, mid (L + R) up, both over sqrt(2)
+        // so a full-scale mono signal reaches the top edge
+        float k = mode == Mode::GONIOMETER ? gain * 0.70710678f : gain;
+        params = mode == Mode::GONIOMETER
+            ? Params{ { -k, k, k, k }, {} }
+            : Params{ { k, 0.0f, 0.0f, k }, {} };
+        params.color[0] = ((rgb >> 16) & 0xFF) / 255.0f * intensity;
+        params.color[1] = ((rgb >> 8) & 0xFF) / 255.0f * intensity;
+        params.color[2] = (rgb & 0xFF) / 255.0f * intensity;
+        bind.vertex_buffers[0] = vertices_;
+        sg_apply_pipeline(point_pipeline_);
+        sg_apply_bindings(&bind);
+        sg_apply_uniforms(0, SG_RANGE(params));
+        sg_draw(0, count, 1);
+    }
+    sg_end_pass();
+}
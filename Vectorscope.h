@@ -0,0 +1,66 @@
+#pragma once
+
+#include "sokol_gfx.h"
+#include <cstdint>
+
+// Stereo vectorscope accumulated on the GPU. The picture lives in a
+// persistent offscreen RGBA target: every render() first fades it by the
+// decay factor with one full-target triangle, then adds each (left, right)
+// sample pair as a point with additive blending, so dense passages glow and
+// old traces die away like phosphor. A whole window of samples is one
+// vertex upload and one draw call; ImGui only shows the target.
+class Vectorscope {
+public:
+    enum class Mode : uint8_t {
+        GONIOMETER,     // mid up, side across: mono is a vertical line
+        LISSAJOUS,      // left across, right up: mono is the diagonal
+        COUNT
+    };
+
+    static constexpr int SIZE = 384;            // target width and height in texels
+    static constexpr int MAX_POINTS = 4096;     // sample pairs per render()
+
+    static const char* modeName(Mode mode);
+
+    Vectorscope() = default;
+    ~Vectorscope() = default;
+
+    // Returns false if the active backend has no vectorscope shader
+    bool init();
+    void shutdown();
+    bool isValid() const { return valid_; }
+
+    // Fade the picture to 'decay' of its brightness, then add 'count' sample
+    // pairs (none only fades) scaled by 'gain', each point adding 'intensity'
+    // of 'rgb' (0xRRGGBB). Runs its own offscreen pass, so call outside the
+    // swapchain pass, at most once per frame (the points are a stream buffer).
+    void render(const float* left, const float* right, int count, Mode mode, float gain,
+                float decay, uint32_t rgb, float intensity);
+    void clear();
+
+    // Target for simgui_imtextureid_with_sampler
+    sg_view view() const { return texture_; }
+    sg_sampler sampler() const { return sampler_; }
+
+private:
+    // std140 layout of the vertex shader's uniform block
+    struct Params {
+        float transform[4];     // rows of the 2x2 matrix taking (left, right) to clip space
+        float color[4];
+    };
+
+    bool valid_ = false;
+    bool cleared_ = false;
+
+    float points_[MAX_POINTS * 2];
+
+    sg_shader shader_ = {};
+    sg_pipeline fade_pipeline_ = {};
+    sg_pipeline point_pipeline_ = {};
+    sg_buffer triangle_ = {};
+    sg_buffer vertices_ = {};
+    sg_image image_ = {};
+    sg_view attachment_ = {};
+    sg_view texture_ = {};
+    sg_sampler sampler_ = {};
+};
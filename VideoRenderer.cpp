@@ -0,0 +1,846 @@
+#include "VideoRenderer.h"
+#include "AnalysisGraph.h"
+#include "ApuTap.h"
+#include "AudioExport.h"
+#include "AudioVisualizer.h"
+#include "DrawDataRaster.h"
+#include "NoteCache.h"
+#include "PianoVisualizer.h"
+#include "Profiler.h"
+#include "VoiceScopeBuffer.h"
+#include "gme/Classic_Emu.h"
+#include "gme/gme.h"
+#include "imgui.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <filesystem>
+#include <functional>
+#include <system_error>
+#include <thread>
+
+namespace {
+
+constexpr long AUDIO_CHUNK_FRAMES = 4096;
+constexpr float AUDIO_SHARE = 0.05f;   // of a track's progress; notes take as much, frames the rest
+constexpr float ROLL_SHARE = 0.7f;     // of the height, with the scope below
+const ImU32 CLEAR_COLOR = IM_COL32(10, 10, 16, 255);
+constexpr int CHANNEL_BATCH_FRAMES = 8;           // drawn by one job per voice
+constexpr float CHANNEL_WINDOW_SECONDS = 0.03f;   // of a voice in its cell
+constexpr int CHANNEL_GAP = 2;
+constexpr int MIN_CHANNEL_PEAK = 256;             // quieter voices aren't scaled up further                    // pixels between cells
+constexpr int TRIGGER_CANDIDATES = 32;            // crossings nearest the nominal one that are tried
+constexpr float TRIGGER_DRIFT = 0.25f;            // of the template's energy per half window off
+
+FILE* openPipe(const std::string& command) {
+#ifdef _WIN32
+    return _popen(command.c_str(), "wb");
+#else
+    return popen(command.c_str(), "w");
+#endif
+}
+
+int closePipe(FILE* pipe) {
+#ifdef _WIN32
+    return _pclose(pipe);
+#else
+    return pclose(pipe);
+#endif
+}
+
+// Frames on their way to the encoder. The job draws into a free buffer
+// while the writer thread pipes the ones before it, so drawing only waits on
+// the encoder once every buffer is queued - the CPU side of an asynchronous
+// readback ring.
+class FramePipe {
+public:
+    ~FramePipe() { close(); }
+
+    bool open(const std::string& command, size_t frame_pixels, int buffers) {
+        pipe_ = openPipe(command);
+        if (!pipe_) return false;
+        frame_bytes_ = frame_pixels * sizeof(uint32_t);
+        for (int i = 0; i < buffers; ++i) {
+            buffers_.push_back(std::make_unique<uint32_t[]>(frame_pixels));
+            free_.push_back(buffers_.back().get());
+        }
+        writer_ = std::thread(&FramePipe::writerLoop, this);
+        return true;
+    }
+
+    // A buffer for the next frame; nullptr once the encoder stopped taking them
+    uint32_t* acquire() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        cv_.wait(lock, [this] { return !free_.empty() || failed_; });
+        if (failed_) return nullptr;
+        uint32_t* frame = free_.back();
+        free_.pop_back();
+        return frame;
+    }
+
+    void submit(uint32_t* frame) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            queued_.push_back(frame);
+        }
+        cv_.notify_all();
+    }
+
+    // Pipe what is queued, close the encoder's input and wait for it to
+    // finish; true if it took every frame and exited cleanly
+    bool close() {
+        if (!pipe_) return false;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            closing_ = true;
+        }
+        cv_.notify_all();
+        writer_.join();
+        int status = closePipe(pipe_);
+        pipe_ = nullptr;
+        return !failed_ && status == 0;
+    }
+
+private:
+    void writerLoop() {
+        FC_TRACE_THREAD("video encoder pipe");
+        for (;;) {
+            uint32_t* frame = nullptr;
+            bool failed = false;
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                cv_.wait(lock, [this] { return !queued_.empty() || closing_; });
+                if (queued_.empty()) return;
+                frame = queued_.front();
+                queued_.pop_front();
+                failed = failed_;
+            }
+            bool ok = failed || std::fwrite(frame, 1, frame_bytes_, pipe_) == frame_bytes_;
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                free_.push_back(frame);
+                if (!ok) failed_ = true;
+            }
+            cv_.notify_all();
+        }
+    }
+
+    FILE* pipe_ = nullptr;
+    size_t frame_bytes_ = 0;
+    std::vector<std::unique_ptr<uint32_t[]>> buffers_;
+    std::thread writer_;
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::vector<uint32_t*> free_;
+    std::deque<uint32_t*> queued_;
+    bool closing_ = false;
+    bool failed_ = false;
+};
+
+// A job's own ImGui context. The current context is per thread (see
+// imconfig.h), so whoever draws with it makes it current for the while with
+// a Use; a job run inline by a waiter gets the waiter's context back
+// afterwards, and a channel's context can move from worker to worker.
+class UiContext {
+public:
+    UiContext(int width, int height, int fps) {
+        ImGuiContext* previous = ImGui::GetCurrentContext();
+        context_ = ImGui::CreateContext();
+        ImGui::SetCurrentContext(context_);
+        ImGuiIO& io = ImGui::GetIO();
+        io.IniFilename = nullptr;
+        io.LogFilename = nullptr;
+        io.BackendRendererName = "fc_video_raster";
+        io.BackendFlags |= ImGuiBackendFlags_RendererHasTextures;
+        io.DisplaySize = ImVec2(static_cast<float>(width), static_cast<float>(height));
+        io.DeltaTime = 1.0f / fps;
+
+        ImGui::StyleColorsDark();
+        ImGuiStyle& style = ImGui::GetStyle();
+        style.WindowPadding = ImVec2(0, 0);
+        style.ItemSpacing = ImVec2(0, 0);
+        style.WindowBorderSize = 0.0f;
+        style.WindowRounding = 0.0f;
+        // Textured lines need a bilinear sampler for their AA; the raster
+        // samples nearest and draws the geometry fringes instead
+        style.AntiAliasedLinesUseTex = false;
+        ImGui::SetCurrentContext(previous);
+    }
+
+    ~UiContext() {
+        ImGuiContext* previous = ImGui::GetCurrentContext();
+        ImGui::SetCurrentContext(context_);
+        raster.shutdown();
+        ImGui::DestroyContext(context_);
+        ImGui::SetCurrentContext(previous == context_ ? nullptr : previous);
+    }
+
+    UiContext(const UiContext&) = delete;
+    UiContext& operator=(const UiContext&) = delete;
+
+    class Use {
+    public:
+        explicit Use(UiContext& ui) : previous_(ImGui::GetCurrentContext()) { ImGui::SetCurrentContext(ui.context_); }
+        ~Use() { ImGui::SetCurrentContext(previous_); }
+        Use(const Use&) = delete;
+        Use& operator=(const Use&) = delete;
+
+    private:
+        ImGuiContext* previous_;
+    };
+
+    DrawDataRaster raster;
+
+private:
+    ImGuiContext* context_;
+};
+
+// One voice's cell of the channel grid: the voice's whole track, its trigger
+// state and its own ImGui context, so batches of its frames can be drawn on
+// whichever worker is free, one batch at a time
+struct ChannelScope {
+    std::vector<blip_sample_t> samples;
+    float gain = 1.0f;                  // the voice's peak fills the cell
+    std::string name;
+    ImU32 color = IM_COL32(180, 180, 180, 255);
+
+    int x = 0, y = 0, width = 0, height = 0;   // cell in the frame
+    std::unique_ptr<UiContext> ui;
+    std::vector<uint32_t> pixels;       // the cell, rasterized
+    std::vector<float> window;          // shown last frame, the trigger's template
+    std::vector<ImVec2> points;
+};
+
+// Start of the window whose centre is the trigger nearest 'nominal'. Of the
+// rising zero crossings around it, the one whose window best matches the
+// last frame's wins, so a held note stands still rather than jumping between
+// cycles; a small penalty for drifting keeps it at the frame's time, and
+// decides alone when the template is silent (a new note).
+long triggerStart(const ChannelScope& scope, long nominal) {
+    const long count = static_cast<long>(scope.samples.size());
+    const int size = static_cast<int>(scope.window.size());
+    const int half = size / 2;
+    auto at = [&](long i) { return i >= 0 && i < count ? scope.samples[i] * scope.gain : 0.0f; };
+
+    float energy = 0.0f;
+    for (float sample : scope.window) energy += sample * sample;
+    long best = nominal - half;
+    float best_score = -1e30f;
+    int candidates = 0;
+    for (int distance = 0; distance <= half && candidates < TRIGGER_CANDIDATES; ++distance) {
+        const long tries[2] = {nominal - distance, nominal + distance};
+        for (int j = 0; j < (distance ? 2 : 1); ++j) {
+            const long t = tries[j];
+            if (!(at(t - 1) < 0.0f && at(t) >= 0.0f)) continue;
+            ++candidates;
+            float score = -energy * TRIGGER_DRIFT * distance / half;
+            for (int i = 0; i < size; ++i) score += scope.window[i] * at(t - half + i);
+            if (score > best_score) {
+                best_score = score;
+                best = t - half;
+            }
+        }
+    }
+    return best;
+}
+
+// Frames [first, first + count) of one voice into its cell of each frame
+// buffer. The cells don't overlap, so every voice's job writes the same
+// buffers at once.
+void drawChannelFrames(ChannelScope& scope, long first, int count, uint32_t* const* frames, int frame_width,
+                       long sample_rate, int fps) {
+    UiContext::Use use(*scope.ui);
+    const int size = static_cast<int>(scope.window.size());
+    const long samples = static_cast<long>(scope.samples.size());
+    const float width = static_cast<float>(scope.width);
+    const float height = static_cast<float>(scope.height);
+    for (int k = 0; k < count; ++k) {
+        // The window ends at the frame's time, with the trigger at its centre
+        long now = static_cast<long>(static_cast<long long>(first + k) * sample_rate / fps);
+        long start = triggerStart(scope, now - size / 2);
+        for (int i = 0; i < size; ++i) {
+            long at = start + i;
+            scope.window[i] = at >= 0 && at < samples ? scope.samples[at] * scope.gain : 0.0f;
+        }
+
+        ImGui::NewFrame();
+        ImGui::SetNextWindowPos(ImVec2(0, 0));
+        ImGui::SetNextWindowSize(ImVec2(width, height));
+        ImGui::Begin("##channel", nullptr, ImGuiWindowFlags_NoDecoration | ImGuiWindowFlags_NoInputs |
+                                           ImGuiWindowFlags_NoSavedSettings | ImGuiWindowFlags_NoBackground);
+        ImDrawList& draw_list = *ImGui::GetWindowDrawList();
+        draw_list.AddRectFilled(ImVec2(0, 0), ImVec2(width, height), IM_COL32(15, 15, 25, 255));
+        draw_list.AddLine(ImVec2(0, height * 0.5f), ImVec2(width, height * 0.5f), IM_COL32(40, 40, 60, 255), 1.0f);
+        AudioVisualizer::drawWaveformGraph(draw_list, scope.points, scope.window.data(), size, ImVec2(0, 0),
+                                           ImVec2(width, height), 1.0f, scope.color);
+        draw_list.AddText(ImVec2(6, 4), IM_COL32(150, 150, 170, 255), scope.name.c_str());
+        ImGui::End();
+        ImGui::Render();
+
+        scope.ui->raster.render(ImGui::GetDrawData(), scope.pixels.data(), scope.width, scope.height, CLEAR_COLOR);
+        uint32_t* cell = frames[k] + static_cast<size_t>(scope.y) * frame_width + scope.x;
+        for (int row = 0; row < scope.height; ++row) {
+            std::copy_n(scope.pixels.data() + static_cast<size_t>(row) * scope.width, scope.width,
+                        cell + static_cast<size_t>(row) * frame_width);
+        }
+    }
+}
+
+// The channel grid into 'pipe': a batch of frames at a time, drawn by one
+// job per voice while the writer thread pipes the batch before
+bool pipeChannelFrames(JobSystem& jobs, const Job& job, std::vector<ChannelScope>& scopes, FramePipe& pipe,
+                       const VideoRenderer::Settings& settings, long sample_rate, long frame_count,
+                       const std::function<void(float)>& on_progress) {
+    const int voices = static_cast<int>(scopes.size());
+    const int columns = static_cast<int>(std::ceil(std::sqrt(static_cast<float>(voices))));
+    const int rows = (voices + columns - 1) / columns;
+    const int cell_width = (settings.width - CHANNEL_GAP * (columns - 1)) / columns;
+    const int cell_height = (settings.height - CHANNEL_GAP * (rows - 1)) / rows;
+    if (cell_width <= 0 || cell_height <= 0) return false;
+    const int window = std::max(2, static_cast<int>(sample_rate * CHANNEL_WINDOW_SECONDS));
+    for (int v = 0; v < voices; ++v) {
+        ChannelScope& scope = scopes[v];
+        int peak = 0;
+        for (blip_sample_t sample : scope.samples) peak = std::max(peak, std::abs(static_cast<int>(sample)));
+        scope.gain = 1.0f / std::max(peak, MIN_CHANNEL_PEAK);
+        scope.x = (v % columns) * (cell_width + CHANNEL_GAP);
+        scope.y = (v / columns) * (cell_height + CHANNEL_GAP);
+        scope.width = cell_width;
+        scope.height = cell_height;
+        scope.ui = std::make_unique<UiContext>(cell_width, cell_height, settings.fps);
+        scope.pixels.assign(static_cast<size_t>(cell_width) * cell_height, CLEAR_COLOR);
+        scope.window.assign(window, 0.0f);
+    }
+
+    const size_t frame_pixels = static_cast<size_t>(settings.width) * settings.height;
+    std::vector<JobHandle> handles;
+    for (long first = 0; first < frame_count; first += CHANNEL_BATCH_FRAMES) {
+        if (job.isCancelled()) return false;
+        const int count = static_cast<int>(std::min<long>(CHANNEL_BATCH_FRAMES, frame_count - first));
+        uint32_t* frames[CHANNEL_BATCH_FRAMES];
+        for (int k = 0; k < count; ++k) {
+            frames[k] = pipe.acquire();
+            if (!frames[k]) return false;
+            std::fill(frames[k], frames[k] + frame_pixels, CLEAR_COLOR);   // the gaps
+        }
+
+        // Each voice's trigger follows on from its last batch, so a voice is
+        // one job; the waits run any a worker hasn't taken on this thread
+        handles.clear();
+        for (ChannelScope& scope : scopes) {
+            ChannelScope* voice = &scope;
+            handles.push_back(jobs.submit([voice, first, count, &frames, &settings, sample_rate](const Job&) {
+                drawChannelFrames(*voice, first, count, frames, settings.width, sample_rate, settings.fps);
+            }, JobPriority::BATCH));
+        }
+        for (const JobHandle& handle : handles) jobs.wait(handle);
+
+        for (int k = 0; k < count; ++k) pipe.submit(frames[k]);
+        on_progress(static_cast<float>(first + count) / frame_count);
+    }
+    return true;
+}
+
+void replaceAll(std::string& text, const char* key, const std::string& value) {
+    size_t length = std::strlen(key);
+    for (size_t at = text.find(key); at != std::string::npos; at = text.find(key, at + value.size())) {
+        text.replace(at, length, value);
+    }
+}
+
+std::string encoderCommand(const VideoRenderer::Settings& settings, const std::string& audio_path,
+                           const std::string& video_path) {
+    std::string command = settings.encoder.empty() ? VideoRenderer::DEFAULT_ENCODER : settings.encoder;
+    replaceAll(command, "{width}", std::to_string(settings.width));
+    replaceAll(command, "{height}", std::to_string(settings.height));
+    replaceAll(command, "{fps}", std::to_string(settings.fps));
+    replaceAll(command, "{audio}", audio_path);
+    replaceAll(command, "{output}", video_path);
+    return command;
+}
+
+// The roll and scope layouts into 'pipe': everything heard up to a frame's
+// time is analysed on this thread, then the frame drawn as the windows draw
+// it and rasterized into the next free buffer
+bool pipeMixFrames(const Job& job, const std::vector<short>& audio, long sample_rate, PianoVisualizer& piano,
+                   FramePipe& pipe, const VideoRenderer::Settings& settings, long frame_count,
+                   const std::function<void(float)>& on_progress) {
+    using Layout = VideoRenderer::Layout;
+    const bool draw_roll = settings.layout != Layout::SCOPE;
+    const bool draw_scope = settings.layout != Layout::PIANO_ROLL;
+    AnalysisGraph analysis;
+    analysis.setSampleRate(sample_rate);
+    AudioVisualizer scope(analysis);
+    UiContext ui(settings.width, settings.height, settings.fps);
+    UiContext::Use use(ui);
+
+    const long audio_frames = static_cast<long>(audio.size() / 2);
+    const float width = static_cast<float>(settings.width);
+    const float height = static_cast<float>(settings.height);
+    const float roll_height = draw_scope && draw_roll ? std::floor(height * ROLL_SHARE) : height;
+    const float scope_height = draw_roll ? height - roll_height : height;
+    std::vector<float> samples;
+    long written = 0;
+    for (long frame = 0; frame < frame_count; ++frame) {
+        if (job.isCancelled()) return false;
+
+        long until = std::min(audio_frames, static_cast<long>(static_cast<long long>(frame) * sample_rate / settings.fps));
+        if (until > written) {
+            samples.resize(static_cast<size_t>(until - written) * 2);
+            for (size_t i = 0; i < samples.size(); ++i) samples[i] = audio[written * 2 + i] / 32768.0f;
+            analysis.write(samples.data(), static_cast<int>(samples.size()));
+            written = until;
+            while (analysis.tick()) {}
+        }
+
+        float now = static_cast<float>(frame) / settings.fps;
+        ImGui::NewFrame();
+        ImGui::SetNextWindowPos(ImVec2(0, 0));
+        ImGui::SetNextWindowSize(ImVec2(width, height));
+        ImGui::Begin("##video", nullptr, ImGuiWindowFlags_NoDecoration | ImGuiWindowFlags_NoInputs |
+                                         ImGuiWindowFlags_NoSavedSettings | ImGuiWindowFlags_NoBackground);
+        if (draw_roll) piano.drawPianoRoll("##roll", width, roll_height, now);
+        if (draw_scope) scope.drawWaveformScope("##scope", width, scope_height);
+        ImGui::End();
+        ImGui::Render();
+
+        uint32_t* pixels = pipe.acquire();
+        if (!pixels) return false;
+        ui.raster.render(ImGui::GetDrawData(), pixels, settings.width, settings.height, CLEAR_COLOR);
+        pipe.submit(pixels);
+        on_progress(static_cast<float>(frame + 1) / frame_count);
+    }
+    return true;
+}
+
+long videoFrameCount(long audio_frames, long sample_rate, int fps) {
+    return static_cast<long>((static_cast<long long>(audio_frames) * fps + sample_rate - 1) / sample_rate);
+}
+
+// "1-3,7" (1-based, as the player lists them) -> 0-based track numbers
+void usage() {
+    fprintf(stderr,
+            "usage: imgui_fc_visualizer --render-video FILE [options]\n"
+            "  --tracks LIST        tracks to render, e.g. 1-3,7 (default: all)\n"
+            "  --out DIR            output directory (default: .)\n"
+            "  --size WxH           frame size in pixels (default: 1920x1080)\n"
+            "  --fps N              frames per second (default: 60)\n"
+            "  --layout L           both, roll, scope or channels (a scope per voice)\n"
+            "                       (default: both)\n"
+            "  --roll-seconds S     seconds of notes on screen (default: 3)\n"
+            "  --rate HZ            sample rate (default: 44100)\n"
+            "  --threads N          worker threads (default: cores - 1)\n"
+            "  --encoder CMD        encoder command reading raw RGBA frames on stdin;\n"
+            "                       {width} {height} {fps} {audio} {output} are substituted\n"
+            "                       (default: ffmpeg to H.264/AAC)\n"
+            "  --ext EXT            output file extension (default: mp4)\n");
+}
+
+}  // namespace
+
+bool VideoRenderer::start(JobSystem& jobs, std::shared_ptr<MusicEmuPool> pool, std::vector<int> tracks,
+                          const std::string& out_dir, const Settings& settings) {
+    cancel();
+    if (!pool || tracks.empty() || settings.width <= 0 || settings.height <= 0 || settings.fps <= 0) return false;
+
+    job_system_ = &jobs;
+    track_count_ = static_cast<int>(tracks.size());
+    track_progress_ = std::make_unique<std::atomic<float>[]>(track_count_);
+    for (int i = 0; i < track_count_; ++i) track_progress_[i].store(0.0f);
+    done_count_.store(0);
+    failed_count_.store(0);
+    out_dir_ = out_dir;
+    settings_ = settings;
+    if (settings_.encoder.empty()) settings_.encoder = DEFAULT_ENCODER;
+    {
+        std::lock_guard<std::mutex> lock(error_mutex_);
+        first_error_.clear();
+    }
+
+    for (int slot = 0; slot < track_count_; ++slot) {
+        int track = tracks[slot];
+        jobs_.push_back(jobs.submit([this, pool, slot, track](const Job& job) {
+            renderTrack(*pool, slot, track, job);
+        }, JobPriority::BATCH, "Video render"));
+    }
+    return true;
+}
+
+void VideoRenderer::cancel() {
+    for (auto& job : jobs_) {
+        job->cancel();
+    }
+    for (auto& job : jobs_) {
+        job->wait();
+    }
+    jobs_.clear();
+}
+
+bool VideoRenderer::isRunning() const {
+    for (const auto& job : jobs_) {
+        if (!job->isDone()) return true;
+    }
+    return false;
+}
+
+float VideoRenderer::progress() const {
+    if (track_count_ <= 0) return 0.0f;
+    float sum = 0.0f;
+    for (int i = 0; i < track_count_; ++i) sum += track_progress_[i].load();
+    return sum / track_count_;
+}
+
+std::string VideoRenderer::firstError() const {
+    std::lock_guard<std::mutex> lock(error_mutex_);
+    return first_error_;
+}
+
+void VideoRenderer::setProgress(const Job& job, int slot, float progress) {
+    track_progress_[slot].store(progress);
+    job.setProgress(progress);
+}
+
+void VideoRenderer::fail(const std::string& message) {
+    failed_count_.fetch_add(1);
+    std::lock_guard<std::mutex> lock(error_mutex_);
+    if (first_error_.empty()) first_error_ = message;
+}
+
+// Render worker: the track's audio first (the encoder reads it as a WAV
+// beside the frames), then its notes, then one UI frame per 1/fps of it
+void VideoRenderer::renderTrack(MusicEmuPool& pool, int slot, int track, const Job& job) {
+    const MappedFile& file = *pool.data();
+    const long sample_rate = pool.sampleRate();
+    const bool channel_scopes = settings_.layout == Layout::CHANNEL_SCOPES;
+    Music_Emu* emu = nullptr;
+    VoiceScopeBuffer voice_buffer;   // outlives emu
+    if (channel_scopes) {
+        // Every voice on its own Blip_Buffer, as for AlbumExporter's stems;
+        // the buffer has to be in place before the sample rate is set
+        gme_type_t type = file.size() >= 4 ? gme_identify_extension(gme_identify_header(file.data())) : nullptr;
+        emu = type ? type->new_emu() : nullptr;
+        Classic_Emu* classic = dynamic_cast<Classic_Emu*>(emu);
+        if (!classic) {
+            if (emu) gme_delete(emu);
+            fail("Channel scopes are not supported for this file type");
+            return;
+        }
+        classic->set_buffer(&voice_buffer);
+        if (emu->set_sample_rate(sample_rate) || gme_load_data(emu, file.data(), static_cast<long>(file.size()))) {
+            gme_delete(emu);
+            fail("Failed to open file for video rendering");
+            return;
+        }
+    } else if (gme_open_data(file.data(), static_cast<long>(file.size()), &emu, sample_rate) || !emu) {
+        fail("Failed to open file for video rendering");
+        return;
+    }
+
+    track_info_t info;
+    long length = 150000;
+    const char* song = "";
+    if (gme_track_info(emu, &info, track) == nullptr) {
+        length = AlbumExporter::playLength(info.length, info.intro_length, info.loop_length);
+        song = info.song;
+    }
+    std::string base = AlbumExporter::trackFileBase(track, song);
+    std::string audio_path = (std::filesystem::path(out_dir_) / (base + ".video.wav")).string();
+    std::string video_path = (std::filesystem::path(out_dir_) / (base + "." + settings_.extension)).string();
+
+    // --- Audio: the whole track, as the export renders it ---
+    std::vector<short> audio;
+    std::vector<ChannelScope> scopes;
+    if (channel_scopes) {
+        scopes.resize(std::min(gme_voice_count(emu), VoiceScopeBuffer::MAX_VOICES));
+        ChannelLayout layout = ApuTap::resolve(emu).layout();
+        const char* const* voice_names = gme_voice_names(emu);
+        for (int v = 0; v < static_cast<int>(scopes.size()); ++v) {
+            int channel = layout.channelForVoice(v);
+            scopes[v].name = channel >= 0 ? layout[channel].name : voice_names[v];
+            if (channel >= 0) {
+                uint32_t rgb = layout[channel].rgb;
+                scopes[v].color = IM_COL32((rgb >> 16) & 0xFF, (rgb >> 8) & 0xFF, rgb & 0xFF, 255);
+            }
+        }
+        // Silence detection renders ahead and skips, which would put the
+        // voices out of step with the mix; the fade still ends the track
+        gme_ignore_silence(emu, 1);
+        voice_buffer.setVoiceTap([&scopes](int voice, const blip_sample_t* samples, long count) {
+            if (voice >= static_cast<int>(scopes.size())) return;
+            std::vector<blip_sample_t>& kept = scopes[voice].samples;
+            kept.insert(kept.end(), samples, samples + count);
+        });
+    }
+    bool ok = gme_start_track(emu, track) == nullptr;
+    if (ok) {
+        gme_set_fade(emu, length);
+        const long total_frames = (length + AlbumExporter::FADE_MSEC) * sample_rate / 1000;
+        audio.reserve(static_cast<size_t>(total_frames) * 2);
+        std::vector<short> chunk(AUDIO_CHUNK_FRAMES * 2);
+        long rendered = 0;
+        while (ok && rendered < total_frames && !gme_track_ended(emu) && !job.isCancelled()) {
+            long frames = std::min(AUDIO_CHUNK_FRAMES, total_frames - rendered);
+            ok = gme_play(emu, frames * 2, chunk.data()) == nullptr;
+            audio.insert(audio.end(), chunk.begin(), chunk.begin() + frames * 2);
+            rendered += frames;
+            setProgress(job, slot, AUDIO_SHARE * rendered / total_frames);
+        }
+    }
+    gme_delete(emu);
+    if (job.isCancelled()) return;
+    if (!ok || audio.empty()) {
+        fail("Failed to play track " + std::to_string(track + 1));
+        return;
+    }
+
+    std::unique_ptr<AudioFileWriter> writer = AudioFileWriter::create(ExportFormat::WAV);
+    ok = writer->open(audio_path, sample_rate, 2) &&
+         writer->write(audio.data(), static_cast<long>(audio.size() / 2));
+    ok = writer->close() && ok;
+    std::error_code ec;
+    if (!ok) {
+        std::filesystem::remove(audio_path, ec);
+        fail("Failed to write " + audio_path);
+        return;
+    }
+
+    // --- Notes: from the note cache, or the piano roll's own preprocessing ---
+    const Settings& settings = settings_;
+    const bool draw_roll = settings.layout == Layout::ROLL_AND_SCOPE || settings.layout == Layout::PIANO_ROLL;
+    PianoVisualizer piano;
+    piano.disableGpuRoll();
+    piano.setIncrementalPreprocessing(false);
+    piano.setPianoRollSpeed(settings.roll_seconds);
+    if (draw_roll) {
+        MusicEmuPool::Lease notes_emu = pool.acquire();
+        ApuTap tap = ApuTap::resolve(notes_emu.get());
+        piano.setChannelLayout(tap.layout());
+
+        NoteCache::Key cache_key;
+        cache_key.content_hash = pool.contentHash();
+        cache_key.track = track;
+        cache_key.sample_rate = sample_rate;
+        NoteTimeline cached;
+        float duration = 0.0f;
+        if (NoteCache::load(cache_key, cached, duration)) {
+            piano.setPreprocessedNotes(std::move(cached), duration);
+        } else if (notes_emu) {
+            std::vector<PianoRollNote> notes;
+            std::vector<uint8_t> envelopes;
+            NoteLoop loop;
+            auto on_progress = [&](float progress) {
+                setProgress(job, slot, AUDIO_SHARE * (1.0f + progress));
+            };
+            auto is_cancelled = [&job]() { return job.isCancelled(); };
+            bool preprocessed = tap.nsf ? piano.preprocessNsfTrace(tap.nsf, track, on_progress, is_cancelled)
+                                        : piano.preprocessTrack(notes_emu.get(), track, sample_rate, tap,
+                                                                on_progress, is_cancelled);
+            if (preprocessed && piano.getPreprocessedNotes(notes, envelopes, duration, &loop)) {
+                NoteCache::store(cache_key, notes, envelopes, duration, loop);
+            }
+        }
+    }
+    if (job.isCancelled()) {
+        std::filesystem::remove(audio_path, ec);
+        return;
+    }
+
+    // --- Frames ---
+    std::string command = encoderCommand(settings, audio_path, video_path);
+    FramePipe pipe;
+    const int buffers = channel_scopes ? 2 * CHANNEL_BATCH_FRAMES : FRAMES_IN_FLIGHT;
+    if (!pipe.open(command, static_cast<size_t>(settings.width) * settings.height, buffers)) {
+        std::filesystem::remove(audio_path, ec);
+        fail("Failed to start the encoder: " + command);
+        return;
+    }
+
+    const long frame_count = videoFrameCount(static_cast<long>(audio.size() / 2), sample_rate, settings.fps);
+    auto on_frames = [&](float done) { setProgress(job, slot, 2.0f * AUDIO_SHARE + (1.0f - 2.0f * AUDIO_SHARE) * done); };
+    bool encoded = true;
+    if (channel_scopes) {
+        audio = {};
+        encoded = pipeChannelFrames(*job_system_, job, scopes, pipe, settings, sample_rate, frame_count, on_frames);
+    } else {
+        encoded = pipeMixFrames(job, audio, sample_rate, piano, pipe, settings, frame_count, on_frames);
+    }
+    encoded = pipe.close() && encoded;
+    std::filesystem::remove(audio_path, ec);
+
+    if (!encoded) {
+        std::filesystem::remove(video_path, ec);
+        if (!job.isCancelled()) fail("Encoder failed for " + video_path);
+        return;
+    }
+    setProgress(job, slot, 1.0f);
+    done_count_.fetch_add(1);
+}
+
+bool VideoRenderer::renderClip(const std::vector<short>& audio, long sample_rate, const ChannelLayout& layout,
+                               std::vector<PianoRollNote> notes, const Settings& settings,
+                               const std::string& video_path, const Job& job, std::string& error) {
+    namespace fs = std::filesystem;
+    if (audio.empty() || settings.width <= 0 || settings.height <= 0 || settings.fps <= 0) {
+        error = "Nothing to render";
+        return false;
+    }
+    std::string audio_path = fs::path(video_path).replace_extension(".video.wav").string();
+    std::unique_ptr<AudioFileWriter> writer = AudioFileWriter::create(ExportFormat::WAV);
+    bool ok = writer->open(audio_path, sample_rate, 2) &&
+              writer->write(audio.data(), static_cast<long>(audio.size() / 2));
+    ok = writer->close() && ok;
+    std::error_code ec;
+    if (!ok) {
+        fs::remove(audio_path, ec);
+        error = "Failed to write " + audio_path;
+        return false;
+    }
+
+    const float duration = static_cast<float>(audio.size() / 2) / sample_rate;
+    PianoVisualizer piano;
+    piano.disableGpuRoll();
+    piano.setIncrementalPreprocessing(false);
+    piano.setPianoRollSpeed(settings.roll_seconds);
+    piano.setChannelLayout(layout);
+    piano.setPreprocessedNotes(std::move(notes), {}, duration);
+
+    std::string command = encoderCommand(settings, audio_path, video_path);
+    FramePipe pipe;
+    if (!pipe.open(command, static_cast<size_t>(settings.width) * settings.height, FRAMES_IN_FLIGHT)) {
+        fs::remove(audio_path, ec);
+        error = "Failed to start the encoder: " + command;
+        return false;
+    }
+    const long frame_count = videoFrameCount(static_cast<long>(audio.size() / 2), sample_rate, settings.fps);
+    bool encoded = pipeMixFrames(job, audio, sample_rate, piano, pipe, settings, frame_count, [](float) {});
+    encoded = pipe.close() && encoded;
+    fs::remove(audio_path, ec);
+    if (!encoded) {
+        fs::remove(video_path, ec);
+        error = job.isCancelled() ? "Cancelled" : "Encoder failed for " + video_path;
+        return false;
+    }
+    return true;
+}
+
+bool VideoRenderer::parseOption(int argc, char* argv[], int& i, Settings& settings, bool& ok) {
+    const char* arg = argv[i];
+    if (i + 1 >= argc) return false;
+    const char* value = argv[i + 1];
+    if (std::strcmp(arg, "--size") == 0) {
+        ok = std::sscanf(value, "%dx%d", &settings.width, &settings.height) == 2;
+    } else if (std::strcmp(arg, "--fps") == 0) {
+        settings.fps = std::atoi(value);
+    } else if (std::strcmp(arg, "--layout") == 0) {
+        if (std::strcmp(value, "both") == 0) settings.layout = Layout::ROLL_AND_SCOPE;
+        else if (std::strcmp(value, "roll") == 0) settings.layout = Layout::PIANO_ROLL;
+        else if (std::strcmp(value, "scope") == 0) settings.layout = Layout::SCOPE;
+        else if (std::strcmp(value, "channels") == 0) settings.layout = Layout::CHANNEL_SCOPES;
+        else ok = false;
+    } else if (std::strcmp(arg, "--roll-seconds") == 0) {
+        settings.roll_seconds = std::max(0.25f, static_cast<float>(std::atof(value)));
+    } else if (std::strcmp(arg, "--encoder") == 0) {
+        settings.encoder = value;
+    } else if (std::strcmp(arg, "--ext") == 0) {
+        settings.extension = value;
+    } else {
+        return false;
+    }
+    ++i;
+    return true;
+}
+
+bool VideoRenderer::isCommandLine(int argc, char* argv[]) {
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--render-video") == 0) return true;
+    }
+    return false;
+}
+
+int VideoRenderer::runCommandLine(int argc, char* argv[]) {
+    const char* path = nullptr;
+    const char* track_list = nullptr;
+    std::string out_dir = ".";
+    Settings settings;
+    long sample_rate = 44100;
+    int threads = 0;
+    bool ok = true;
+
+    for (int i = 1; i < argc && ok; ++i) {
+        const char* arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if (std::strcmp(arg, "--render-video") == 0 && has_value) {
+            path = argv[++i];
+        } else if (std::strcmp(arg, "--tracks") == 0 && has_value) {
+            track_list = argv[++i];
+        } else if (std::strcmp(arg, "--out") == 0 && has_value) {
+            out_dir = argv[++i];
+        } else if (std::strcmp(arg, "--rate") == 0 && has_value) {
+            sample_rate = std::atol(argv[++i]);
+        } else if (std::strcmp(arg, "--threads") == 0 && has_value) {
+            threads = std::atoi(argv[++i]);
+        } else if (!parseOption(argc, argv, i, settings, ok)) {
+            usage();
+            return 1;
+        }
+    }
+    if (!ok || !path || settings.width <= 0 || settings.height <= 0 || settings.fps <= 0 || sample_rate <= 0) {
+        usage();
+        return 1;
+    }
+
+    std::shared_ptr<MusicEmuPool> pool = MusicEmuPool::open(path, sample_rate);
+    int track_count = 0;
+    if (pool) {
+        MusicEmuPool::Lease emu = pool->acquire();
+        if (emu) track_count = gme_track_count(emu.get());
+    }
+    if (track_count <= 0) {
+        fprintf(stderr, "render-video: cannot open %s\n", path);
+        return 1;
+    }
+    std::vector<int> tracks;
+    if (track_list) {
+        if (!AlbumExporter::parseTrackList(track_list, track_count, tracks)) {
+            fprintf(stderr, "render-video: bad track list '%s' (the file has %d tracks)\n", track_list, track_count);
+            return 1;
+        }
+    } else {
+        for (int track = 0; track < track_count; ++track) tracks.push_back(track);
+    }
+
+    std::error_code ec;
+    std::filesystem::create_directories(out_dir, ec);
+#ifndef _WIN32
+    // An encoder that exits early fails the track, not the whole process
+    std::signal(SIGPIPE, SIG_IGN);
+#endif
+
+    JobSystem jobs;
+    jobs.init(threads);
+    VideoRenderer renderer;
+    auto started = std::chrono::steady_clock::now();
+    if (!renderer.start(jobs, pool, std::move(tracks), out_dir, settings)) {
+        usage();
+        return 1;
+    }
+    while (renderer.isRunning()) {
+        fprintf(stderr, "\rrender-video: %d/%d tracks, %3.0f%%", renderer.tracksDone(), renderer.trackCount(),
+                renderer.progress() * 100.0f);
+        std::this_thread::sleep_for(std::chrono::milliseconds(250));
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+    fprintf(stderr, "\rrender-video: %d/%d tracks in %.1f s\n", renderer.tracksDone(), renderer.trackCount(), seconds);
+
+    if (renderer.tracksFailed() > 0) {
+        fprintf(stderr, "render-video: %d failed: %s\n", renderer.tracksFailed(), renderer.firstError().c_str());
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,108 @@
+#pragma once
+
+#include "ChannelLayout.h"
+#include "JobSystem.h"
+#include "MusicEmuPool.h"
+#include "NoteTimeline.h"
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Renders tracks of a music file to video files of the visualizer: the
+// piano roll over the oscilloscope, drawn by the same drawPianoRoll and
+// drawWaveformScope as the windows. Time advances a fixed 1/fps per frame
+// with that much audio fed to an AnalysisGraph ticked on the job, so frames
+// come out as fast as they can be drawn; each track is one job with its own
+// emulator, ImGui context and CPU rasterizer, so an album renders on every
+// worker at once. Finished frames go to a writer thread piping them into the
+// encoder process while the next one is drawn. Owned and polled like
+// AlbumExporter; the jobs only touch their own progress slot.
+//
+// CHANNEL_SCOPES is the chip-scope grid instead: one triggered scope per
+// emulator voice, from a single pass with every voice on its own
+// Blip_Buffer (VoiceScopeBuffer). Each voice keeps its trigger state and
+// ImGui context across the track, and a batch of frames is drawn with one
+// job per voice, each into its own cell of the same frame buffers, so the
+// grid is composited as it is drawn.
+class VideoRenderer {
+public:
+    enum class Layout {
+        ROLL_AND_SCOPE,
+        PIANO_ROLL,
+        SCOPE,
+        CHANNEL_SCOPES
+    };
+
+    struct Settings {
+        int width = 1920;
+        int height = 1080;
+        int fps = 60;
+        Layout layout = Layout::ROLL_AND_SCOPE;
+        float roll_seconds = 3.0f;   // of notes visible above the hit line
+        // Raw RGBA frames arrive on its stdin. {width}, {height}, {fps},
+        // {audio} (the track's WAV) and {output} are substituted; empty
+        // means DEFAULT_ENCODER.
+        std::string encoder;
+        std::string extension = "mp4";
+    };
+
+    static constexpr const char* DEFAULT_ENCODER =
+        "ffmpeg -hide_banner -loglevel error -y -f rawvideo -pix_fmt rgba -s {width}x{height} -r {fps} -i - "
+        "-i \"{audio}\" -c:v libx264 -preset veryfast -crf 18 -pix_fmt yuv420p -c:a aac -b:a 192k "
+        "-shortest \"{output}\"";
+
+    ~VideoRenderer() { cancel(); }
+
+    // Queue the given tracks into out_dir; false if nothing could be queued
+    bool start(JobSystem& jobs, std::shared_ptr<MusicEmuPool> pool, std::vector<int> tracks,
+               const std::string& out_dir, const Settings& settings);
+
+    // Stop all jobs and wait for them; partly written files are removed
+    void cancel();
+
+    bool isRunning() const;
+    float progress() const;  // 0-1 over all tracks
+    int trackCount() const { return track_count_; }
+    int tracksDone() const { return done_count_.load(); }
+    int tracksFailed() const { return failed_count_.load(); }
+    std::string firstError() const;
+
+    // A clip already played (ClipRecorder): its audio, interleaved 16-bit
+    // stereo, and 'notes' on the roll, in clip seconds, drawn as the
+    // layout does and encoded into video_path. Blocks, so it is for a job.
+    // CHANNEL_SCOPES needs the voices apart and draws the roll and scope.
+    static bool renderClip(const std::vector<short>& audio, long sample_rate, const ChannelLayout& layout,
+                           std::vector<PianoRollNote> notes, const Settings& settings,
+                           const std::string& video_path, const Job& job, std::string& error);
+
+    // "--render-video FILE [options]": render without opening a window.
+    // Returns the process exit code.
+    static bool isCommandLine(int argc, char* argv[]);
+    static int runCommandLine(int argc, char* argv[]);
+
+    // Take the settings option at argv[i] (--size, --fps, --layout,
+    // --roll-seconds, --encoder, --ext) and its value, leaving i on the
+    // value; false if it is none of them. ok turns false on a bad value.
+    static bool parseOption(int argc, char* argv[], int& i, Settings& settings, bool& ok);
+
+private:
+    static constexpr int FRAMES_IN_FLIGHT = 3;   // drawn, queued or being piped
+
+    void renderTrack(MusicEmuPool& pool, int slot, int track, const Job& job);
+    void setProgress(const Job& job, int slot, float progress);
+    void fail(const std::string& message);
+
+    JobSystem* job_system_ = nullptr;   // for the channel jobs a track splits off
+    std::vector<JobHandle> jobs_;
+    std::unique_ptr<std::atomic<float>[]> track_progress_;
+    int track_count_ = 0;
+    std::atomic<int> done_count_{0};
+    std::atomic<int> failed_count_{0};
+    std::string out_dir_;
+    Settings settings_;
+
+    mutable std::mutex error_mutex_;
+    std::string first_error_;
+};
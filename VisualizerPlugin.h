@@ -0,0 +1,155 @@
+#pragma once
+
+/* Visualizer plugins: shared libraries (.so, .dylib, .dll) in
+ * PluginHost::directory() that draw a window of their own from the
+ * analysis the visualizer already runs. Plain C, so a plugin can be built
+ * with any compiler or language that can export a C function; nothing here
+ * depends on the host's ImGui or sokol build.
+ *
+ * A plugin exports FCVIZ_PLUGIN_ENTRY, which returns its descriptor (or
+ * NULL if it can't run against 'host_api_version'). The host gives every
+ * plugin a thread of its own, so its create(), render() and destroy() are
+ * called on that thread only, one at a time, and a slow render() makes that
+ * plugin's window update less often rather than holding up audio or the
+ * UI. Everything a render() is passed is read-only and only valid during
+ * the call: the sample and spectrum arrays point into the analysis graph's
+ * buffers without a copy.
+ *
+ *   static void render(void* self, const fcviz_frame* frame, const fcviz_draw* draw) {
+ *       for (uint32_t i = 0; i + 1 < frame->waveform_size; ++i) ...
+ *           draw->line(draw->context, x0, y0, x1, y1, 0xFF80FF80u, 1.0f);
+ *   }
+ *   static const fcviz_plugin plugin = {
+ *       FCVIZ_PLUGIN_API_VERSION, "My Scope", FCVIZ_INPUT_SAMPLES, FCVIZ_TARGET_DRAW_LIST, 60.0f,
+ *       NULL, NULL, render
+ *   };
+ *   FCVIZ_EXPORT const fcviz_plugin* fcviz_plugin_entry(uint32_t host_api_version) { return &plugin; }
+ */
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define FCVIZ_PLUGIN_API_VERSION 1u
+#define FCVIZ_PLUGIN_ENTRY "fcviz_plugin_entry"
+
+#if defined(_WIN32)
+#define FCVIZ_EXPORT __declspec(dllexport)
+#else
+#define FCVIZ_EXPORT __attribute__((visibility("default")))
+#endif
+
+/* What a plugin reads, as fcviz_plugin::inputs; only these are filled in */
+enum {
+    FCVIZ_INPUT_SAMPLES = 1u << 0,   /* triggered stereo waveform and levels */
+    FCVIZ_INPUT_SPECTRUM = 1u << 1,  /* display bars and waterfall history */
+    FCVIZ_INPUT_APU = 1u << 2,       /* per-channel sound chip state */
+    FCVIZ_INPUT_NOTES = 1u << 3      /* note-on events */
+};
+
+/* Where it draws, as fcviz_plugin::target */
+enum {
+    FCVIZ_TARGET_DRAW_LIST = 0,      /* fcviz_draw calls, drawn with the UI */
+    FCVIZ_TARGET_PIXELS = 1          /* fcviz_frame::pixels, shown as a texture */
+};
+
+typedef struct fcviz_channel {
+    const char* name;                /* e.g. "Square 1" */
+    uint32_t rgb;                    /* 0xRRGGBB, the visualizer's colour for it */
+    uint8_t kind;                    /* 0 square, 1 triangle, 2 noise, 3 DMC, 4 VRC6 pulse, 5 VRC6 saw,
+                                        6 5B square, 7 N163 wave, 8 other format's voice */
+    int8_t note;                     /* MIDI note playing, -1 if silent */
+    uint8_t velocity;                /* 0-127 */
+    uint8_t reserved;
+    int32_t period;                  /* timer period in chip clocks */
+    int32_t length;                  /* length counter; expansion channels 1 while enabled */
+    int32_t amplitude;
+    int32_t volume;                  /* expansion channels; 0 for the APU's */
+} fcviz_channel;
+
+typedef struct fcviz_note_event {
+    double time;                     /* playback seconds the note started at */
+    uint8_t channel;                 /* into fcviz_frame::channels */
+    uint8_t note;                    /* MIDI note */
+    uint8_t velocity;                /* 1-127 */
+    uint8_t kind;                    /* fcviz_channel::kind */
+    uint32_t reserved;
+} fcviz_note_event;
+
+typedef struct fcviz_frame {
+    uint32_t inputs;                 /* of the plugin's inputs, those with current data */
+    uint32_t playing;
+    double time;                     /* playback seconds being heard */
+    float width;                     /* canvas size in pixels */
+    float height;
+
+    /* FCVIZ_INPUT_SAMPLES; full scale is +/-1 */
+    uint64_t tick;                   /* analysis ticks since the track started */
+    const float* waveform_left;
+    const float* waveform_right;
+    uint32_t waveform_size;
+    float rms_left;
+    float rms_right;
+    float peak;
+
+    /* FCVIZ_INPUT_SPECTRUM; levels 0-1 */
+    const float* spectrum;
+    uint32_t spectrum_bins;
+    uint32_t history_size;           /* waterfall rows */
+    const uint8_t* history;          /* history_size x spectrum_bins, rows in a ring */
+    uint64_t history_rows;           /* newest row is (history_rows - 1) % history_size */
+
+    /* FCVIZ_INPUT_APU */
+    const fcviz_channel* channels;
+    uint32_t channel_count;
+
+    /* FCVIZ_INPUT_NOTES: note n is note_events[n % note_event_capacity], so a
+       plugin that last saw count m has min(note_on_count - m, capacity) new */
+    uint32_t note_event_capacity;
+    const fcviz_note_event* note_events;
+    uint64_t note_on_count;
+
+    /* FCVIZ_TARGET_PIXELS: RGBA8, top row first, written by render() */
+    uint32_t* pixels;
+    uint32_t pixel_width;
+    uint32_t pixel_height;
+} fcviz_frame;
+
+/* FCVIZ_TARGET_DRAW_LIST: primitives in canvas pixels, (0, 0) at the top
+   left, clipped to the canvas. Colours are 0xAABBGGRR. */
+typedef struct fcviz_draw {
+    void* context;
+    void (*line)(void* context, float x0, float y0, float x1, float y1, uint32_t color, float thickness);
+    void (*polyline)(void* context, const float* xy, uint32_t points, uint32_t color, float thickness);
+    void (*rect)(void* context, float x0, float y0, float x1, float y1, uint32_t color, float thickness);
+    void (*rect_filled)(void* context, float x0, float y0, float x1, float y1, uint32_t color);
+    void (*triangle_filled)(void* context, float x0, float y0, float x1, float y1, float x2, float y2,
+                            uint32_t color);
+    void (*circle)(void* context, float x, float y, float radius, uint32_t color, float thickness);
+    void (*circle_filled)(void* context, float x, float y, float radius, uint32_t color);
+    void (*push_clip)(void* context, float x0, float y0, float x1, float y1);
+    void (*pop_clip)(void* context);
+} fcviz_draw;
+
+typedef struct fcviz_plugin {
+    uint32_t api_version;            /* FCVIZ_PLUGIN_API_VERSION it was built against */
+    const char* name;                /* window title */
+    uint32_t inputs;                 /* FCVIZ_INPUT_* */
+    uint32_t target;                 /* FCVIZ_TARGET_* */
+    float max_rate;                  /* renders per second at most; 0 for 60 */
+
+    /* On the plugin's thread; create and destroy may be NULL. What create()
+       returns is passed to render() and destroy(); render()'s 'draw' is
+       NULL for FCVIZ_TARGET_PIXELS. */
+    void* (*create)(void);
+    void (*destroy)(void* instance);
+    void (*render)(void* instance, const fcviz_frame* frame, const fcviz_draw* draw);
+} fcviz_plugin;
+
+typedef const fcviz_plugin* (*fcviz_plugin_entry_t)(uint32_t host_api_version);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,73 @@
+#include "VoiceScopeBuffer.h"
+#include <algorithm>
+
+VoiceScopeBuffer::VoiceScopeBuffer() : Multi_Buffer(2) {}
+
+blargg_err_t VoiceScopeBuffer::set_channel_count(int count) {
+    voice_count_ = std::clamp(count, 1, MAX_VOICES);
+    channels_changed();
+    return 0;
+}
+
+Multi_Buffer::channel_t VoiceScopeBuffer::channel(int index, int) {
+    // Voices past MAX_VOICES share the last buffer rather than going silent
+    Blip_Buffer* buf = &bufs_[std::min(index, MAX_VOICES - 1)];
+    channel_t ch;
+    ch.center = buf;
+    ch.left = buf;
+    ch.right = buf;
+    return ch;
+}
+
+blargg_err_t VoiceScopeBuffer::set_sample_rate(long rate, int msec) {
+    // Every slot is configured up front since set_channel_count() comes later
+    for (int i = 0; i < MAX_VOICES; ++i) {
+        if (blargg_err_t err = bufs_[i].set_sample_rate(rate, msec)) return err;
+    }
+    // Same capacity Blip_Buffer allocates for this rate/length
+    long capacity = (rate * (msec + 1) + 999) / 1000;
+    voice_scratch_.assign(capacity, 0);
+    mix_.assign(capacity, 0);
+    return Multi_Buffer::set_sample_rate(bufs_[0].sample_rate(), bufs_[0].length());
+}
+
+void VoiceScopeBuffer::clock_rate(long rate) {
+    for (int i = 0; i < MAX_VOICES; ++i) {
+        bufs_[i].clock_rate(rate);
+    }
+}
+
+void VoiceScopeBuffer::bass_freq(int freq) {
+    for (int i = 0; i < MAX_VOICES; ++i) {
+        bufs_[i].bass_freq(freq);
+    }
+}
+
+void VoiceScopeBuffer::clear() {
+    for (int i = 0; i < MAX_VOICES; ++i) {
+        bufs_[i].clear();
+    }
+}
+
+void VoiceScopeBuffer::end_frame(blip_time_t time) {
+    for (int i = 0; i < voice_count_; ++i) {
+        bufs_[i].end_frame(time);
+    }
+}
+
+long VoiceScopeBuffer::read_samples(blip_sample_t* out, long count) {
+    long frames = std::min({count / 2, bufs_[0].samples_avail(), static_cast<long>(mix_.size())});
+    if (frames <= 0) return 0;
+    
+    std::fill(mix_.begin(), mix_.begin() + frames, 0);
+    for (int v = 0; v < voice_count_; ++v) {
+        bufs_[v].read_samples(voice_scratch_.data(), frames);
+        if (tap_) tap_(v, voice_scratch_.data(), frames);
+        for (long i = 0; i < frames; ++i) {
+            mix_[i] += voice_scratch_[i];
+        }
+    }
+    
+    blip_pack_stereo(out, mix_.data(), mix_.data(), frames);
+    return frames * 2;
+}
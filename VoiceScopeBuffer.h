@@ -0,0 +1,43 @@
+#pragma once
+
+#include "gme/Multi_Buffer.h"
+#include <vector>
+#include <functional>
+#include <cstdint>
+
+// Multi_Buffer that gives every emulator voice its own Blip_Buffer and mixes
+// them on read. Used in place of the emulator's default Stereo_Buffer so each
+// oscillator's real output can be tapped for a per-voice scope in the same
+// emulation pass. Output is mono duplicated to stereo, like Stereo_Buffer's
+// center-only path. Must be installed with Classic_Emu::set_buffer() before
+// the emulator's sample rate is set, and must outlive the emulator.
+class VoiceScopeBuffer : public Multi_Buffer {
+public:
+    static constexpr int MAX_VOICES = 32;
+    
+    // Called from read_samples() (i.e. inside gme_play) for each voice
+    using VoiceTap = std::function<void(int voice, const blip_sample_t* samples, long count)>;
+    
+    VoiceScopeBuffer();
+    
+    void setVoiceTap(VoiceTap tap) { tap_ = std::move(tap); }
+    int voiceCount() const { return voice_count_; }
+    
+    // Multi_Buffer
+    blargg_err_t set_channel_count(int count) override;
+    channel_t channel(int index, int type) override;
+    blargg_err_t set_sample_rate(long rate, int msec = blip_default_length) override;
+    void clock_rate(long rate) override;
+    void bass_freq(int freq) override;
+    void clear() override;
+    void end_frame(blip_time_t time) override;
+    long read_samples(blip_sample_t* out, long count) override;
+    long samples_avail() const override { return bufs_[0].samples_avail() * 2; }
+    
+private:
+    Blip_Buffer bufs_[MAX_VOICES];
+    int voice_count_ = 1;
+    VoiceTap tap_;
+    std::vector<blip_sample_t> voice_scratch_;
+    std::vector<blip_long> mix_;
+};
@@ -0,0 +1,22 @@
+#include "WaveformPeaks.h"
+#include "gme/gme.h"
+
+bool WaveformPeaks::render(Music_Emu* emu, int track, long sample_rate, float seconds,
+                           const std::function<bool()>& cancelled,
+                           const std::function<void(const short* stereo, int frames)>& tap) {
+    begin(sample_rate);
+    if (!emu || gme_start_track(emu, track) != nullptr) return false;
+    
+    const int chunk_frames = 1024;
+    std::vector<short> buffer(chunk_frames * 2);
+    long total_frames = static_cast<long>(seconds * sample_rate);
+    for (long done = 0; done < total_frames && !gme_track_ended(emu); done += chunk_frames) {
+        if (cancelled && cancelled()) return false;
+        int frames = static_cast<int>(std::min<long>(chunk_frames, total_frames - done));
+        if (gme_play(emu, frames * 2, buffer.data()) != nullptr) break;
+        add(buffer.data(), frames);
+        if (tap) tap(buffer.data(), frames);
+    }
+    finish();
+    return true;
+}
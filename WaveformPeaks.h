@@ -0,0 +1,78 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+struct Music_Emu;
+
+// Min, max and RMS of the mixed output per BLOCK_SECONDS, the way a DAW's
+// peak file summarises a recording, drawn behind the seek bar. A few bytes
+// per block, so a whole track is tens of kilobytes and is cached next to its
+// notes; once stored, re-opening the track draws it with no synthesis.
+class WaveformPeaks {
+public:
+    static constexpr float BLOCK_SECONDS = 0.02f;
+
+    struct Block {
+        int16_t min = 0;
+        int16_t max = 0;
+        int16_t rms = 0;
+    };
+
+    void begin(long sample_rate) {
+        blocks_.clear();
+        block_frames_ = std::max(1L, std::lround(sample_rate * BLOCK_SECONDS));
+        frames_ = 0;
+        current_ = Block();
+        sum_squares_ = 0.0;
+        current_.min = INT16_MAX;
+        current_.max = INT16_MIN;
+    }
+
+    // Interleaved stereo, mixed down to mono
+    void add(const short* stereo, int frames) {
+        for (int i = 0; i < frames; ++i) {
+            int sample = (stereo[i * 2] + stereo[i * 2 + 1]) / 2;
+            current_.min = static_cast<int16_t>(std::min<int>(current_.min, sample));
+            current_.max = static_cast<int16_t>(std::max<int>(current_.max, sample));
+            sum_squares_ += static_cast<double>(sample) * sample;
+            if (++frames_ == block_frames_) flush();
+        }
+    }
+
+    // Close the partial last block
+    void finish() {
+        if (frames_ > 0) flush();
+    }
+
+    void assign(std::vector<Block> blocks) { blocks_ = std::move(blocks); }
+    const std::vector<Block>& blocks() const { return blocks_; }
+    bool empty() const { return blocks_.empty(); }
+    float duration() const { return blocks_.size() * BLOCK_SECONDS; }
+
+    // Play 'seconds' of the track in 'emu' and summarise it; false if
+    // cancelled or the track fails to start. Each chunk also goes to 'tap',
+    // if set, so other whole-track summaries share the one playback.
+    bool render(Music_Emu* emu, int track, long sample_rate, float seconds,
+                const std::function<bool()>& cancelled,
+                const std::function<void(const short* stereo, int frames)>& tap = nullptr);
+
+private:
+    void flush() {
+        current_.rms = static_cast<int16_t>(std::min(32767.0, std::sqrt(sum_squares_ / frames_)));
+        blocks_.push_back(current_);
+        frames_ = 0;
+        sum_squares_ = 0.0;
+        current_.min = INT16_MAX;
+        current_.max = INT16_MIN;
+    }
+
+    std::vector<Block> blocks_;
+    long block_frames_ = 1;
+    long frames_ = 0;           // in the block being summed
+    Block current_;
+    double sum_squares_ = 0.0;
+};
@@ -0,0 +1,130 @@
+#include "WebFiles.h"
+#include "sokol_app.h"
+#include <emscripten.h>
+#include <cstdio>
+#include <cstdlib>
+#include <sys/stat.h>
+#include <unordered_map>
+
+namespace {
+
+constexpr const char* DOWNLOAD_DIR = "/downloads";
+
+// Pickers still open, by the id handed to JavaScript
+std::unordered_map<int, WebFiles::Opened> pickers;
+int next_picker = 0;
+
+// One drop's files, fetched concurrently
+struct DropFetch {
+    WebFiles::Dropped dropped;
+    std::vector<std::string> paths;
+    int remaining = 0;
+};
+
+// The picker's file arrives as a promise; 'path' is null when cancelled
+EM_JS(void, webfiles_js_pick, (const char* accept, const char* dir, int id), {
+    const input = document.createElement('input');
+    const folder = UTF8ToString(dir);
+    input.type = 'file';
+    input.accept = UTF8ToString(accept);
+    input.addEventListener('cancel', () => { _webfiles_picked(id, 0); });
+    input.addEventListener('change', () => {
+        const file = input.files[0];
+        if (!file) {
+            _webfiles_picked(id, 0);
+            return;
+        }
+        file.arrayBuffer().then((data) => {
+            const path = folder + '/' + file.name;
+            FS.writeFile(path, new Uint8Array(data));
+            _webfiles_picked(id, stringToNewUTF8(path));
+        }, () => { _webfiles_picked(id, 0); });
+    });
+    input.click();
+});
+
+EM_JS(void, webfiles_js_download, (const char* path), {
+    const name = UTF8ToString(path);
+    const url = URL.createObjectURL(new Blob([FS.readFile(name)]));
+    const link = document.createElement('a');
+    link.href = url;
+    link.download = name.substring(name.lastIndexOf('/') + 1);
+    link.click();
+    setTimeout(() => { URL.revokeObjectURL(url); }, 0);
+});
+
+std::string inDirectory(const char* dir, const char* name) {
+    mkdir(dir, 0777);
+    std::string base = name;
+    size_t slash = base.find_last_of("/\\");
+    if (slash != std::string::npos) base.erase(0, slash + 1);
+    return std::string(dir) + "/" + (base.empty() ? "file" : base);
+}
+
+void droppedFetched(const sapp_html5_fetch_response* response) {
+    auto* fetch = static_cast<DropFetch*>(response->user_data);
+    if (response->succeeded) {
+        fetch->paths[response->file_index] =
+            WebFiles::store(sapp_get_dropped_file_path(response->file_index), response->data.ptr, response->data.size);
+    }
+    free(const_cast<void*>(response->buffer.ptr));
+    if (--fetch->remaining > 0) return;
+    std::vector<std::string> paths;
+    for (std::string& path : fetch->paths) {
+        if (!path.empty()) paths.push_back(std::move(path));
+    }
+    if (!paths.empty()) fetch->dropped(std::move(paths));
+    delete fetch;
+}
+
+} // namespace
+
+extern "C" EMSCRIPTEN_KEEPALIVE void webfiles_picked(int id, char* path) {
+    auto it = pickers.find(id);
+    if (it == pickers.end()) return;
+    WebFiles::Opened opened = std::move(it->second);
+    pickers.erase(it);
+    if (path) {
+        opened(path);
+        free(path);
+    }
+}
+
+void WebFiles::pick(const char* accept, Opened opened) {
+    mkdir(UPLOAD_DIR, 0777);
+    int id = next_picker++;
+    pickers[id] = std::move(opened);
+    webfiles_js_pick(accept, UPLOAD_DIR, id);
+}
+
+void WebFiles::fetchDropped(Dropped dropped) {
+    int count = sapp_get_num_dropped_files();
+    if (count <= 0) return;
+    auto* fetch = new DropFetch{std::move(dropped), std::vector<std::string>(count), count};
+    for (int i = 0; i < count; ++i) {
+        uint32_t size = sapp_html5_get_dropped_file_size(i);
+        sapp_html5_fetch_request request = {};
+        request.dropped_file_index = i;
+        request.callback = droppedFetched;
+        request.buffer = {malloc(size ? size : 1), size};
+        request.user_data = fetch;
+        sapp_html5_fetch_dropped_file(&request);
+    }
+}
+
+void WebFiles::download(const std::string& path) {
+    webfiles_js_download(path.c_str());
+}
+
+std::string WebFiles::savePath(const char* name) {
+    return inDirectory(DOWNLOAD_DIR, name);
+}
+
+std::string WebFiles::store(const char* name, const void* data, size_t size) {
+    std::string path = inDirectory(UPLOAD_DIR, name);
+    FILE* file = fopen(path.c_str(), "wb");
+    if (!file) return {};
+    bool ok = fwrite(data, 1, size, file) == size;
+    ok &= fclose(file) == 0;
+    return ok ? path : std::string();
+}
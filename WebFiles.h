@@ -0,0 +1,33 @@
+#pragma once
+
+#include <functional>
+#include <string>
+#include <vector>
+
+// Files in the browser build, which has no file system to browse. Picked
+// and dropped files are copied into Emscripten's in-memory file system
+// under UPLOAD_DIR and then opened by path like any other file; files the
+// app writes (movies, profiles) are offered back as downloads. Main thread
+// only: the callbacks run there too, from the browser's event loop.
+class WebFiles {
+public:
+    static constexpr const char* UPLOAD_DIR = "/uploads";
+
+    using Opened = std::function<void(const std::string& path)>;
+    using Dropped = std::function<void(std::vector<std::string> paths)>;
+
+    // Show the browser's file picker; 'accept' as for <input accept>
+    // (".nsf,.nsfe,.zip"). 'opened' runs once the chosen file is copied in,
+    // never if the picker is cancelled.
+    static void pick(const char* accept, Opened opened);
+    // On SAPP_EVENTTYPE_FILES_DROPPED: copy every dropped file in; 'dropped'
+    // gets the paths of those that arrived, in drop order, after the last
+    static void fetchDropped(Dropped dropped);
+    // Offer a file of the in-memory file system as a download
+    static void download(const std::string& path);
+
+    // Where to write a file that is then downloaded as 'name'
+    static std::string savePath(const char* name);
+    // Copy data into UPLOAD_DIR; its path, empty on failure
+    static std::string store(const char* name, const void* data, size_t size);
+};
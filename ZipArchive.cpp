@@ -0,0 +1,406 @@
+#include "ZipArchive.h"
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <cstring>
+#include <filesystem>
+#include <system_error>
+
+namespace {
+
+constexpr uint32_t LOCAL_HEADER = 0x04034b50;
+constexpr uint32_t CENTRAL_HEADER = 0x02014b50;
+constexpr uint32_t END_OF_DIRECTORY = 0x06054b50;
+constexpr uint32_t ZIP64_END_OF_DIRECTORY = 0x06064b50;
+constexpr uint32_t ZIP64_LOCATOR = 0x07064b50;
+constexpr uint16_t ZIP64_EXTRA = 0x0001;
+
+constexpr size_t LOCAL_HEADER_SIZE = 30;
+constexpr size_t CENTRAL_HEADER_SIZE = 46;
+constexpr size_t END_OF_DIRECTORY_SIZE = 22;
+constexpr size_t ZIP64_LOCATOR_SIZE = 20;
+constexpr size_t ZIP64_END_OF_DIRECTORY_SIZE = 56;
+
+uint16_t le16(const uint8_t* p) { return static_cast<uint16_t>(p[0] | p[1] << 8); }
+uint32_t le32(const uint8_t* p) { return le16(p) | static_cast<uint32_t>(le16(p + 2)) << 16; }
+uint64_t le64(const uint8_t* p) { return le32(p) | static_cast<uint64_t>(le32(p + 4)) << 32; }
+
+uint32_t crc32(const uint8_t* data, size_t size) {
+    static const std::array<uint32_t, 256> table = [] {
+        std::array<uint32_t, 256> t{};
+        for (uint32_t i = 0; i < 256; ++i) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; ++k) c = c & 1 ? 0xedb88320u ^ (c >> 1) : c >> 1;
+            t[i] = c;
+        }
+        return t;
+    }();
+    uint32_t crc = 0xffffffffu;
+    for (size_t i = 0; i < size; ++i) crc = table[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+    return crc ^ 0xffffffffu;
+}
+
+// RFC 1951 decoder over a complete input buffer, decoding canonical Huffman
+// codes a bit at a time. Members of NSF sets are tens of kilobytes, so table
+// lookups wouldn't pay for their setup; 'limit' stops a member that inflates
+// past its recorded size.
+class Inflater {
+public:
+    Inflater(const uint8_t* in, size_t in_size, std::vector<uint8_t>& out, size_t limit)
+        : in_(in), in_size_(in_size), out_(out), limit_(limit) {}
+
+    bool run() {
+        int last;
+        do {
+            last = bits(1);
+            int type = bits(2);
+            bool ok = type == 0 ? stored() : type == 1 ? fixed() : type == 2 ? dynamic() : false;
+            if (!ok || error_) return false;
+        } while (!last);
+        return true;
+    }
+
+private:
+    static constexpr int MAX_BITS = 15;
+    static constexpr int MAX_LENGTH_CODES = 286;
+    static constexpr int MAX_DISTANCE_CODES = 30;
+
+    struct Huffman {
+        int16_t count[MAX_BITS + 1];    // codes of each length
+        int16_t symbol[288];            // symbols ordered by code
+    };
+
+    int bits(int need) {
+        uint32_t value = bit_buffer_;
+        while (bit_count_ < need) {
+            if (pos_ == in_size_) {
+                error_ = true;
+                return 0;
+            }
+            value |= static_cast<uint32_t>(in_[pos_++]) << bit_count_;
+            bit_count_ += 8;
+        }
+        bit_buffer_ = value >> need;
+        bit_count_ -= need;
+        return static_cast<int>(value & ((1u << need) - 1));
+    }
+
+    bool put(uint8_t byte) {
+        if (out_.size() == limit_) return false;
+        out_.push_back(byte);
+        return true;
+    }
+
+    bool stored() {
+        bit_buffer_ = 0;
+        bit_count_ = 0;
+        if (in_size_ - pos_ < 4) return false;
+        unsigned length = le16(in_ + pos_);
+        if ((~length & 0xffff) != le16(in_ + pos_ + 2)) return false;
+        pos_ += 4;
+        if (in_size_ - pos_ < length || limit_ - out_.size() < length) return false;
+        out_.insert(out_.end(), in_ + pos_, in_ + pos_ + length);
+        pos_ += length;
+        return true;
+    }
+
+    int decode(const Huffman& h) {
+        int code = 0, first = 0, index = 0;
+        for (int len = 1; len <= MAX_BITS; ++len) {
+            code |= bits(1);
+            int count = h.count[len];
+            if (code - count < first) return h.symbol[index + (code - first)];
+            index += count;
+            first = (first + count) << 1;
+            code <<= 1;
+        }
+        return -1;  // ran out of input, or a code the table doesn't have
+    }
+
+    // False if the lengths describe more codes than fit; incomplete sets
+    // are allowed (a single distance code is common)
+    static bool build(Huffman& h, const int16_t* lengths, int n) {
+        std::fill(std::begin(h.count), std::end(h.count), 0);
+        for (int s = 0; s < n; ++s) h.count[lengths[s]]++;
+        if (h.count[0] == n) return true;
+        int left = 1;
+        for (int len = 1; len <= MAX_BITS; ++len) {
+            left = (left << 1) - h.count[len];
+            if (left < 0) return false;
+        }
+        int16_t offsets[MAX_BITS + 1];
+        offsets[1] = 0;
+        for (int len = 1; len < MAX_BITS; ++len) offsets[len + 1] = offsets[len] + h.count[len];
+        for (int s = 0; s < n; ++s) {
+            if (lengths[s] != 0) h.symbol[offsets[lengths[s]]++] = static_cast<int16_t>(s);
+        }
+        return true;
+    }
+
+    bool codes(const Huffman& lengthcode, const Huffman& distcode) {
+        static const int16_t length_base[29] = {
+            3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+            35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+        static const int16_t length_extra[29] = {
+            0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+        static const int16_t dist_base[30] = {
+            1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+            257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577};
+        static const int16_t dist_extra[30] = {
+            0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+
+        for (;;) {
+            int symbol = decode(lengthcode);
+            if (symbol < 0 || error_) return false;
+            if (symbol < 256) {
+                if (!put(static_cast<uint8_t>(symbol))) return false;
+                continue;
+            }
+            if (symbol == 256) return true;
+
+            symbol -= 257;
+            if (symbol >= 29) return false;
+            size_t length = static_cast<size_t>(length_base[symbol] + bits(length_extra[symbol]));
+            symbol = decode(distcode);
+            if (symbol < 0 || symbol >= 30) return false;
+            size_t dist = static_cast<size_t>(dist_base[symbol] + bits(dist_extra[symbol]));
+            if (error_ || dist > out_.size() || limit_ - out_.size() < length) return false;
+            // Byte by byte: the match may overlap what it copies
+            size_t from = out_.size() - dist;
+            for (size_t i = 0; i < length; ++i) out_.push_back(out_[from + i]);
+        }
+    }
+
+    bool fixed() {
+        static Huffman lengthcode, distcode;
+        static const bool built = [] {
+            int16_t lengths[288];
+            int s = 0;
+            for (; s < 144; ++s) lengths[s] = 8;
+            for (; s < 256; ++s) lengths[s] = 9;
+            for (; s < 280; ++s) lengths[s] = 7;
+            for (; s < 288; ++s) lengths[s] = 8;
+            build(lengthcode, lengths, 288);
+            for (s = 0; s < MAX_DISTANCE_CODES; ++s) lengths[s] = 5;
+            build(distcode, lengths, MAX_DISTANCE_CODES);
+            return true;
+        }();
+        (void)built;
+        return codes(lengthcode, distcode);
+    }
+
+    bool dynamic() {
+        static const uint8_t order[19] = {16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15};
+        int nlen = bits(5) + 257;
+        int ndist = bits(5) + 1;
+        int ncode = bits(4) + 4;
+        if (error_ || nlen > MAX_LENGTH_CODES || ndist > MAX_DISTANCE_CODES) return false;
+
+        int16_t lengths[MAX_LENGTH_CODES + MAX_DISTANCE_CODES] = {};
+        for (int i = 0; i < ncode; ++i) lengths[order[i]] = static_cast<int16_t>(bits(3));
+        Huffman lencode, distcode;
+        if (!build(lencode, lengths, 19)) return false;
+
+        // Code lengths of both tables, with runs
+        int index = 0;
+        while (index < nlen + ndist) {
+            int symbol = decode(lencode);
+            if (symbol < 0 || error_) return false;
+            if (symbol < 16) {
+                lengths[index++] = static_cast<int16_t>(symbol);
+                continue;
+            }
+            int16_t repeat_length = 0;
+            int repeat;
+            if (symbol == 16) {
+                if (index == 0) return false;
+                repeat_length = lengths[index - 1];
+                repeat = 3 + bits(2);
+            } else if (symbol == 17) {
+                repeat = 3 + bits(3);
+            } else {
+                repeat = 11 + bits(7);
+            }
+            if (index + repeat > nlen + ndist) return false;
+            while (repeat--) lengths[index++] = repeat_length;
+        }
+        if (lengths[256] == 0) return false;    // no end-of-block code
+
+        if (!build(lencode, lengths, nlen)) return false;
+        if (!build(distcode, lengths + nlen, ndist)) return false;
+        return codes(lencode, distcode);
+    }
+
+    const uint8_t* in_;
+    size_t in_size_;
+    size_t pos_ = 0;
+    uint32_t bit_buffer_ = 0;
+    int bit_count_ = 0;
+    bool error_ = false;
+    std::vector<uint8_t>& out_;
+    size_t limit_;
+};
+
+bool endsWithZip(std::string_view path) {
+    if (path.size() < 4) return false;
+    std::string_view ext = path.substr(path.size() - 4);
+    return ext[0] == '.' && std::tolower(static_cast<unsigned char>(ext[1])) == 'z' &&
+           std::tolower(static_cast<unsigned char>(ext[2])) == 'i' &&
+           std::tolower(static_cast<unsigned char>(ext[3])) == 'p';
+}
+
+}  // namespace
+
+bool ZipArchive::open(const char* path) {
+    close();
+    if (!file_.open(path)) return false;
+    if (!readDirectory()) {
+        close();
+        return false;
+    }
+    return true;
+}
+
+void ZipArchive::close() {
+    file_.close();
+    members_.clear();
+}
+
+bool ZipArchive::readDirectory() {
+    const uint8_t* data = file_.data();
+    size_t size = file_.size();
+    if (size < END_OF_DIRECTORY_SIZE) return false;
+
+    // The end record sits behind a comment of up to 64 KB
+    size_t end = size - END_OF_DIRECTORY_SIZE;
+    size_t lowest = end > 0xffff ? end - 0xffff : 0;
+    for (;; --end) {
+        if (le32(data + end) == END_OF_DIRECTORY) break;
+        if (end == lowest) return false;
+    }
+    uint64_t count = le16(data + end + 10);
+    uint64_t directory_size = le32(data + end + 12);
+    uint64_t directory_offset = le32(data + end + 16);
+
+    // ZIP64: the real values are in a second record the locator points at
+    if (end >= ZIP64_LOCATOR_SIZE && le32(data + end - ZIP64_LOCATOR_SIZE) == ZIP64_LOCATOR) {
+        uint64_t record = le64(data + end - ZIP64_LOCATOR_SIZE + 8);
+        if (size < ZIP64_END_OF_DIRECTORY_SIZE || record > size - ZIP64_END_OF_DIRECTORY_SIZE ||
+            le32(data + record) != ZIP64_END_OF_DIRECTORY) {
+            return false;
+        }
+        count = le64(data + record + 32);
+        directory_size = le64(data + record + 40);
+        directory_offset = le64(data + record + 48);
+    }
+    if (directory_offset > size || directory_size > size - directory_offset) return false;
+
+    const uint8_t* p = data + directory_offset;
+    const uint8_t* directory_end = p + directory_size;
+    members_.reserve(static_cast<size_t>(std::min<uint64_t>(count, directory_size / CENTRAL_HEADER_SIZE)));
+    for (uint64_t i = 0; i < count; ++i) {
+        if (directory_end - p < static_cast<ptrdiff_t>(CENTRAL_HEADER_SIZE) || le32(p) != CENTRAL_HEADER) return false;
+        uint16_t flags = le16(p + 8);
+        size_t name_size = le16(p + 28);
+        size_t extra_size = le16(p + 30);
+        size_t comment_size = le16(p + 32);
+        if (static_cast<size_t>(directory_end - p) < CENTRAL_HEADER_SIZE + name_size + extra_size + comment_size) {
+            return false;
+        }
+
+        Member member;
+        member.method = le16(p + 10);
+        member.crc = le32(p + 16);
+        member.compressed_size = le32(p + 20);
+        member.size = le32(p + 24);
+        member.header_offset = le32(p + 42);
+        member.encrypted = (flags & 1) != 0;
+        member.name.assign(reinterpret_cast<const char*>(p + CENTRAL_HEADER_SIZE), name_size);
+
+        // Fields saturated at 0xffffffff continue in the ZIP64 extra, in this order
+        const uint8_t* extra = p + CENTRAL_HEADER_SIZE + name_size;
+        const uint8_t* extra_end = extra + extra_size;
+        while (extra_end - extra >= 4) {
+            uint16_t id = le16(extra);
+            size_t field_size = le16(extra + 2);
+            const uint8_t* field = extra + 4;
+            if (static_cast<size_t>(extra_end - field) < field_size) break;
+            if (id == ZIP64_EXTRA) {
+                const uint8_t* field_end = field + field_size;
+                for (uint64_t* value : {&member.size, &member.compressed_size, &member.header_offset}) {
+                    if (*value != 0xffffffffu || field_end - field < 8) continue;
+                    *value = le64(field);
+                    field += 8;
+                }
+                break;
+            }
+            extra = field + field_size;
+        }
+
+        bool directory = !member.name.empty() && (member.name.back() == '/' || member.name.back() == '\\');
+        if (!directory) members_.push_back(std::move(member));
+        p += CENTRAL_HEADER_SIZE + name_size + extra_size + comment_size;
+    }
+    return true;
+}
+
+const ZipArchive::Member* ZipArchive::find(std::string_view name) const {
+    for (const Member& member : members_) {
+        if (member.name == name) return &member;
+    }
+    return nullptr;
+}
+
+bool ZipArchive::extract(const Member& member, std::vector<uint8_t>& out) const {
+    out.clear();
+    if (member.encrypted || (member.method != 0 && member.method != 8)) return false;
+
+    // The local header repeats the name but may carry a different extra field
+    const uint8_t* data = file_.data();
+    size_t size = file_.size();
+    if (member.header_offset > size || size - member.header_offset < LOCAL_HEADER_SIZE) return false;
+    const uint8_t* header = data + member.header_offset;
+    if (le32(header) != LOCAL_HEADER) return false;
+    uint64_t start = member.header_offset + LOCAL_HEADER_SIZE + le16(header + 26) + le16(header + 28);
+    if (start > size || member.compressed_size > size - start) return false;
+    const uint8_t* in = data + start;
+    size_t in_size = static_cast<size_t>(member.compressed_size);
+
+    if (member.method == 0) {
+        if (member.compressed_size != member.size) return false;
+        out.assign(in, in + in_size);
+    } else {
+        out.reserve(static_cast<size_t>(member.size));
+        Inflater inflater(in, in_size, out, static_cast<size_t>(member.size));
+        if (!inflater.run() || out.size() != member.size) return false;
+    }
+    return crc32(out.data(), out.size()) == member.crc;
+}
+
+bool ZipArchive::isArchive(std::string_view path) {
+    return endsWithZip(path);
+}
+
+bool ZipArchive::splitPath(std::string_view path, std::string& archive, std::string& member) {
+    // The first "*.zip" component that is an existing file is the archive
+    for (size_t i = 0; i < path.size(); ++i) {
+        if (path[i] != '/' && path[i] != '\\') continue;
+        std::string_view head = path.substr(0, i);
+        if (!endsWithZip(head) || i + 1 == path.size()) continue;
+        std::error_code ec;
+        if (!std::filesystem::is_regular_file(std::filesystem::path(head), ec)) continue;
+        archive.assign(head);
+        member.assign(path.substr(i + 1));
+        // Member names always use forward slashes
+        std::replace(member.begin(), member.end(), '\\', '/');
+        return true;
+    }
+    return false;
+}
+
+std::string ZipArchive::memberPath(std::string_view archive, std::string_view member) {
+    std::string path(archive);
+    path += '/';
+    path += member;
+    return path;
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include "MappedFile.h"
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// The members of a zip archive, listed from its central directory (ZIP64
+// included), and decompression of one of them at a time into memory, stored
+// or deflated. The archive stays mapped and a member is inflated straight
+// from its pages, so opening one track of a set costs that member alone.
+//
+// A member is addressed by the archive's path followed by the member's name,
+// as if the archive were a folder: "sets/Mega Man 2.zip/01 Title.nsf".
+// MappedFile::open takes such paths, so everything that reads music files
+// reads archive members the same way.
+class ZipArchive {
+public:
+    struct Member {
+        std::string name;           // path inside the archive, '/' separated
+        uint64_t size = 0;          // uncompressed
+        uint64_t compressed_size = 0;
+        uint64_t header_offset = 0; // of its local header
+        uint32_t crc = 0;
+        uint16_t method = 0;        // 0 stored, 8 deflate
+        bool encrypted = false;
+    };
+
+    ZipArchive() = default;
+    ZipArchive(const ZipArchive&) = delete;
+    ZipArchive& operator=(const ZipArchive&) = delete;
+
+    // False if the file isn't a zip archive or its directory is damaged
+    bool open(const char* path);
+    void close();
+    bool isOpen() const { return file_.isOpen(); }
+
+    // Files only, in directory order
+    const std::vector<Member>& members() const { return members_; }
+    const Member* find(std::string_view name) const;
+
+    // Decompress a member into 'out'; false if it is encrypted, compressed
+    // some other way, or corrupt (its CRC is checked)
+    bool extract(const Member& member, std::vector<uint8_t>& out) const;
+
+    // ".zip", going by the extension
+    static bool isArchive(std::string_view path);
+    // "<archive>.zip/<member>" where the archive is an existing file; false
+    // for any other path
+    static bool splitPath(std::string_view path, std::string& archive, std::string& member);
+    static std::string memberPath(std::string_view archive, std::string_view member);
+
+private:
+    bool readDirectory();
+
+    MappedFile file_;
+    std::vector<Member> members_;
+};
@@ -0,0 +1,621 @@
+// Headless microbenchmarks for the visualizer and synthesis kernels.
+//
+//   kernel_bench [--filter substr] [--min-time sec] [--json file] [--nsf file] [--rom file]
+//
+// Each case is timed in repeated batches sized to run at least --min-time
+// (default 0.2 s); the median batch is reported as ns per operation, plus
+// items per second where an operation covers several items (samples, frames,
+// emulated seconds). --json writes the results in Google Benchmark's JSON
+// layout, so the usual compare tools work on two runs.
+//
+// The NSF cases default to the bundled 3rd_party/Game_Music_Emu/test.nsf
+// (relative to the working directory); the agnes frame loop runs only with
+// --rom. Visualizer kernels are timed on the building blocks the visualizers
+// use (FftPlan, the display-bin power sum, LoudnessMeter, AudioRing, PitchTracker) since the visualizer
+// classes themselves need a GPU context. The AudioState cases time one
+// callback pass over main.cpp's shared atomics while a synthesis and a UI
+// thread keep storing to theirs, on shared cache lines and on their own.
+
+#include "FftPlan.h"
+#include "LoudnessMeter.h"
+#include "PitchTracker.h"
+#include "AudioRing.h"
+#include "ApuSnapshot.h"
+#include "agnes/agnes.h"
+#include "gme/Blip_Buffer.h"
+#include "gme/Fir_Resampler.h"
+#include "gme/Nes_Apu.h"
+#include "gme/Nes_Namco_Apu.h"
+#include "gme/Nsf_Emu.h"
+#include "gme/Spc_Dsp.h"
+#include "gme/Ym2612_Emu.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+struct Result {
+    std::string name;
+    long iterations;        // per batch
+    double ns_per_op;       // median batch
+    double items_per_op;
+};
+
+struct Options {
+    const char* filter = nullptr;
+    double min_time = 0.2;
+    const char* json_path = nullptr;
+    const char* nsf_path = "3rd_party/Game_Music_Emu/test.nsf";
+    const char* rom_path = nullptr;
+};
+
+Options options;
+std::vector<Result> results;
+volatile double sink;  // keeps results of the timed work alive
+
+bool selected(const std::string& name) {
+    return !options.filter || name.find(options.filter) != std::string::npos;
+}
+
+// Time op() in batches: grow the batch until it runs min_time, then report
+// the median of five batches of that size
+void run(const std::string& name, double items_per_op, const std::function<void()>& op) {
+    if (!selected(name)) return;
+    using clock = std::chrono::steady_clock;
+    auto batch = [&op](long n) {
+        auto start = clock::now();
+        for (long i = 0; i < n; ++i) op();
+        return std::chrono::duration<double>(clock::now() - start).count();
+    };
+
+    long n = 1;
+    double seconds = batch(n);
+    while (seconds < options.min_time && n < (1L << 30)) {
+        double scale = seconds > 0.0 ? options.min_time / seconds * 1.2 : 10.0;
+        n = std::max(n + 1, static_cast<long>(n * std::min(scale, 10.0)));
+        seconds = batch(n);
+    }
+
+    double samples[5];
+    for (double& s : samples) s = batch(n) * 1e9 / n;
+    std::sort(samples, samples + 5);
+
+    Result result = {name, n, samples[2], items_per_op};
+    printf("%-36s %12.1f ns", name.c_str(), result.ns_per_op);
+    if (items_per_op != 1.0) printf("  %12.4g items/s", items_per_op / result.ns_per_op * 1e9);
+    printf("\n");
+    results.push_back(result);
+}
+
+bool writeJson(const char* path) {
+    FILE* file = fopen(path, "w");
+    if (!file) return false;
+    fprintf(file, "{\n  \"context\": {\"executable\": \"kernel_bench\"},\n  \"benchmarks\": [\n");
+    for (size_t i = 0; i < results.size(); ++i) {
+        const Result& r = results[i];
+        fprintf(file, "    {\"name\": \"%s\", \"run_type\": \"iteration\", \"iterations\": %ld, "
+                      "\"real_time\": %.3f, \"cpu_time\": %.3f, \"time_unit\": \"ns\", \"items_per_second\": %.1f}%s\n",
+                r.name.c_str(), r.iterations, r.ns_per_op, r.ns_per_op,
+                r.items_per_op / r.ns_per_op * 1e9, i + 1 < results.size() ? "," : "");
+    }
+    fprintf(file, "  ]\n}\n");
+    fclose(file);
+    return true;
+}
+
+// Deterministic noise plus a couple of tones, so transforms see realistic data
+std::vector<float> testSignal(size_t count) {
+    std::vector<float> signal(count);
+    uint32_t seed = 12345;
+    for (size_t i = 0; i < count; ++i) {
+        seed = seed * 1664525u + 1013904223u;
+        float noise = (static_cast<int>(seed >> 9) - (1 << 22)) / static_cast<float>(1 << 22);
+        signal[i] = 0.4f * std::sin(i * 0.0627f) + 0.2f * std::sin(i * 0.3141f) + 0.05f * noise;
+    }
+    return signal;
+}
+
+void benchFft() {
+    for (int size = 512; size <= 8192; size *= 2) {
+        FftPlan plan(size);
+        std::vector<float> input = testSignal(size);
+        run("FftPlan::forward/" + std::to_string(size), size, [&] {
+            sink = plan.forward(input.data())[1].real();
+        });
+    }
+}
+
+// Per-voice spectra: eight voice windows as one batched transform, against
+// eight separate ones reduced to power the same way
+void benchFftBatch() {
+    constexpr int SIZE = 1024;
+    constexpr int VOICES = 8;
+    FftPlan plan(SIZE);
+    std::vector<float> input = testSignal(SIZE * VOICES);
+    const float* inputs[VOICES];
+    for (int v = 0; v < VOICES; ++v) inputs[v] = input.data() + v * SIZE;
+    std::vector<float> power(VOICES * (SIZE / 2 + 1));
+    
+    run("FftPlan::powerBatch/1024x8", SIZE * VOICES, [&] {
+        plan.powerBatch(inputs, VOICES, power.data());
+        sink = power[1];
+    });
+    run("FftPlan::forward/1024x8", SIZE * VOICES, [&] {
+        for (int v = 0; v < VOICES; ++v) {
+            const std::vector<std::complex<float>>& bins = plan.forward(inputs[v]);
+            for (int k = 0; k <= SIZE / 2; ++k) power[v * (SIZE / 2 + 1) + k] = std::norm(bins[k]);
+        }
+        sink = power[1];
+    });
+}
+
+// The loudness meter as the analysis thread feeds it: K-weighting, block
+// gating and the 4x true-peak interpolator over one hop of stereo frames
+void benchLoudness() {
+    constexpr int HOP = 368;
+    std::vector<float> mono = testSignal(HOP);
+    std::vector<float> frames(HOP * 2);
+    for (int i = 0; i < HOP; ++i) frames[i * 2] = frames[i * 2 + 1] = mono[i];
+    LoudnessMeter meter;
+    meter.setSampleRate(44100);
+    
+    run("LoudnessMeter::process/368", HOP, [&] {
+        meter.process(frames.data(), HOP);
+        sink = meter.truePeak();
+    });
+}
+
+// AnalysisGraph's pitch node per tick: a voice window at full rate, the
+// decimated mix with two pitches, and noise, where no lag dips and every
+// one is summed
+void benchPitch() {
+    constexpr int SIZE = 1024;
+    std::vector<float> tone(SIZE);
+    for (int i = 0; i < SIZE; ++i) tone[i] = std::fmod(i * 220.0f / 44100.0f, 1.0f) < 0.5f ? 0.3f : -0.3f;
+    std::vector<float> mix = testSignal(SIZE);
+    std::vector<float> noise(SIZE);
+    uint32_t seed = 1;
+    for (float& sample : noise) {
+        seed = seed * 1664525u + 1013904223u;
+        sample = (static_cast<int>(seed >> 9) - (1 << 22)) / static_cast<float>(1 << 23);
+    }
+    PitchTracker tracker;
+    PitchTracker::Estimate estimates[2];
+    run("PitchTracker::update/voice_1024", SIZE, [&] {
+        sink = tracker.update(tone.data(), SIZE, 44100, 1, estimates);
+    });
+    run("PitchTracker::update/mix_1024_x2", SIZE, [&] {
+        sink = tracker.update(mix.data(), SIZE, 22050, 2, estimates);
+    });
+    run("PitchTracker::update/noise_1024", SIZE, [&] {
+        sink = tracker.update(noise.data(), SIZE, 44100, 1, estimates);
+    });
+}
+
+// The spectrum display's reduction: mean power per log-spaced display bin,
+// then one log10 per bin, as AnalysisGraph::processFFT does
+void benchMagnitude() {
+    constexpr int DISPLAY_BINS = 64;
+    for (int size = 512; size <= 8192; size *= 2) {
+        FftPlan plan(size);
+        std::vector<float> input = testSignal(size);
+        const std::vector<std::complex<float>>& bins = plan.forward(input.data());
+
+        int edges[DISPLAY_BINS + 1];
+        for (int i = 0; i <= DISPLAY_BINS; ++i) {
+            float edge = std::pow(size / 2.0f, i / static_cast<float>(DISPLAY_BINS));
+            edges[i] = std::clamp(static_cast<int>(edge), 1, size / 2);
+        }
+        std::vector<float> spectrum(DISPLAY_BINS);
+        run("spectrum_magnitude/" + std::to_string(size), size / 2, [&] {
+            for (int i = 0; i < DISPLAY_BINS; ++i) {
+                int end = std::max(edges[i + 1], edges[i] + 1);
+                float sum = 0.0f;
+                for (int j = edges[i]; j < end; ++j) sum += std::norm(bins[j]);
+                spectrum[i] = 10.0f * std::log10(sum / (end - edges[i]) + 1e-20f);
+            }
+            sink = spectrum[DISPLAY_BINS / 2];
+        });
+    }
+}
+
+// updateAudioData's queueing: one callback's stereo frames into the analysis
+// ring and back out, as the callback and analysis thread do
+void benchAudioRing() {
+    for (int frames : {256, 512, 1024, 2048}) {
+        AudioRing ring;
+        ring.init(16384, 2);
+        std::vector<float> block = testSignal(frames * 2);
+        std::vector<float> out(frames * 2);
+        run("AudioRing::write+read/" + std::to_string(frames), frames, [&] {
+            ring.write(block.data(), frames);
+            ring.read(out.data(), frames);
+        });
+        sink = out[0];
+    }
+}
+
+// One audio callback pass over the state it shares with the other threads
+// (read the settings, the ring flush and the track end, store the queue
+// depth) while a synthesis thread runs its per-chunk pattern (check the
+// seek and loop requests, store the playback time) and a UI thread stores
+// a field of its own, both as fast as they can. "packed" is the state
+// struct before it was split: everything on shared lines, the requests
+// cleared by an unconditional exchange. "apart" is main.cpp now: a line
+// per writer, and a request loaded before it is cleared. A worst case,
+// since the real threads store once a chunk or frame, not continuously.
+template <bool APART>
+struct AudioStateLayout {
+    static constexpr size_t LINE = APART ? 64 : alignof(std::atomic<uint64_t>);
+
+    alignas(64) std::atomic<float> playback_time{0.0f};            // synthesis
+    std::atomic<uint32_t> audio_overruns{0};
+    alignas(LINE) std::atomic<float> queued_frames_avg{0.0f};      // callback
+    alignas(LINE) std::atomic<uint64_t> ring_flush_pos{0};         // synthesis, on a flush
+    std::atomic<uint64_t> ring_fade_pos{0};
+    std::atomic<bool> synth_track_ended{false};
+    alignas(LINE) std::atomic<bool> is_playing{true};              // UI
+    std::atomic<float> volume_gain{1.0f};
+    std::atomic<float> track_gain{1.0f};
+    std::atomic<long> seek_request{-1};
+    std::atomic<bool> loop_request{false};
+    alignas(LINE) std::atomic<double> presentation_time{0.0};      // UI-only
+};
+
+template <bool APART>
+void benchAudioState(const char* name) {
+    AudioStateLayout<APART> layout;
+    std::atomic<bool> stop{false};
+    std::thread synthesis([&] {
+        float time = 0.0f;
+        while (!stop.load(std::memory_order_relaxed)) {
+            long seek = -1;
+            bool loop = false;
+            if (APART) {
+                if (layout.seek_request.load(std::memory_order_relaxed) >= 0) seek = layout.seek_request.exchange(-1);
+                loop = layout.loop_request.load(std::memory_order_relaxed) && layout.loop_request.exchange(false);
+            } else {
+                seek = layout.seek_request.exchange(-1);
+                loop = layout.loop_request.exchange(false);
+            }
+            if (seek >= 0 || loop) layout.ring_flush_pos.fetch_add(1, std::memory_order_release);
+            layout.playback_time.store(time += 0.01f, std::memory_order_relaxed);
+        }
+    });
+    std::thread ui([&] {
+        double t = 0.0;
+        while (!stop.load(std::memory_order_relaxed)) layout.presentation_time.store(t += 1.0, std::memory_order_relaxed);
+    });
+    float depth = 0.0f;
+    run(std::string("AudioState/") + name, 1.0, [&] {
+        if (!layout.is_playing.load(std::memory_order_acquire)) return;
+        float gain = layout.volume_gain.load(std::memory_order_relaxed) * layout.track_gain.load(std::memory_order_relaxed);
+        uint64_t flush = layout.ring_flush_pos.load(std::memory_order_acquire);
+        bool fade = flush == layout.ring_fade_pos.load(std::memory_order_relaxed);
+        bool ended = layout.synth_track_ended.load(std::memory_order_relaxed);
+        depth += 0.1f * (gain + fade + ended - depth);
+        layout.queued_frames_avg.store(depth, std::memory_order_relaxed);
+    });
+    stop = true;
+    synthesis.join();
+    ui.join();
+    sink = layout.queued_frames_avg.load() + layout.playback_time.load();
+}
+
+constexpr long SAMPLE_RATE = 44100;
+constexpr int FRAME_CLOCKS = 29781;  // NTSC CPU cycles per video frame
+
+void benchBlipBuffer(bool fast) {
+    Blip_Buffer buffer;
+    if (buffer.set_sample_rate(SAMPLE_RATE, 100)) return;
+    buffer.clock_rate(1789773);
+    buffer.set_fast_synth(fast);
+    Blip_Synth<blip_good_quality, 30> synth;
+    synth.volume(0.5);
+    std::vector<blip_sample_t> out(4096);
+
+    // One frame of square-wave edges per op; the period drifts so the load isn't periodic
+    int frame = 0;
+    int amp = 10;
+    run(fast ? "Blip_Buffer::read_samples/frame (fast synth)" : "Blip_Buffer::read_samples/frame",
+        SAMPLE_RATE / 60.0, [&] {
+        int period = 200 + (frame++ * 37) % 400;
+        for (int t = 0; t < FRAME_CLOCKS; t += period) {
+            amp = -amp;
+            synth.offset(t, amp * 2, &buffer);
+        }
+        buffer.end_frame(FRAME_CLOCKS);
+        sink = buffer.read_samples(out.data(), static_cast<long>(out.size()));
+    });
+}
+
+// solo: Pulse 1 only, the others muted (no output) as NesEmulator::setMuteMask does
+void benchNesApu(bool fast, bool solo = false) {
+    Blip_Buffer buffer;
+    if (buffer.set_sample_rate(SAMPLE_RATE, 100)) return;
+    buffer.clock_rate(1789773);
+    buffer.set_fast_synth(fast);
+    Nes_Apu apu;
+    apu.output(&buffer);
+    apu.reset();
+    if (solo) {
+        for (int i = 1; i < Nes_Apu::osc_count; ++i) apu.osc_output(i, nullptr);
+    }
+
+    // All channels on, pulse periods swept each frame
+    apu.write_register(0, 0x4015, 0x0F);
+    apu.write_register(0, 0x4000, 0xBF);
+    apu.write_register(0, 0x4004, 0x7F);
+    apu.write_register(0, 0x4008, 0xFF);
+    apu.write_register(0, 0x400C, 0x3F);
+    apu.write_register(0, 0x400E, 0x05);
+    std::vector<blip_sample_t> out(4096);
+    int frame = 0;
+    run(solo ? "Nes_Apu::end_frame/frame (pulse 1 solo)"
+             : fast ? "Nes_Apu::end_frame/frame (fast synth)" : "Nes_Apu::end_frame/frame", 1.0, [&] {
+        int period = 0x100 + (frame++ * 7) % 0x300;
+        apu.write_register(100, 0x4002, period & 0xFF);
+        apu.write_register(100, 0x4003, 0x08 | (period >> 8));
+        apu.write_register(5000, 0x4006, (period >> 1) & 0xFF);
+        apu.write_register(5000, 0x4007, 0x08 | (period >> 9));
+        apu.write_register(9000, 0x400A, (period >> 2) & 0xFF);
+        apu.write_register(9000, 0x400B, 0x08 | (period >> 10));
+        apu.end_frame(FRAME_CLOCKS);
+        buffer.end_frame(FRAME_CLOCKS);
+        sink = buffer.read_samples(out.data(), static_cast<long>(out.size()));
+    });
+}
+
+// Namco 163 with all eight channels on (each clocked at 1/8 rate), one
+// channel's frequency and a wave RAM byte rewritten each frame
+void benchNamcoApu(bool fast) {
+    Blip_Buffer buffer;
+    if (buffer.set_sample_rate(SAMPLE_RATE, 100)) return;
+    buffer.clock_rate(1789773);
+    buffer.set_fast_synth(fast);
+    Nes_Namco_Apu apu;
+    apu.output(&buffer);
+    auto write = [&apu](blip_time_t time, int addr, int data) {
+        apu.write_addr(addr);
+        apu.write_data(time, data);
+    };
+    for (int i = 0; i < 0x40; ++i) write(0, i, (i * 0x9D + 0x31) & 0xFF);
+    for (int ch = 0; ch < Nes_Namco_Apu::osc_count; ++ch) {
+        int base = 0x40 + ch * 8;
+        int freq = 0x8000 + ch * 0x1800;
+        write(0, base + 0, freq & 0xFF);
+        write(0, base + 2, freq >> 8 & 0xFF);
+        write(0, base + 4, 0xE0 | (ch & 3) << 3 | freq >> 16);  // 32, 24, 16 or 8 steps
+        write(0, base + 6, ch * 16);
+        write(0, base + 7, ch == 7 ? 0x7F : 0x08 + ch);  // channel 7's high bits: 8 active
+    }
+    std::vector<blip_sample_t> out(4096);
+    int frame = 0;
+    run(fast ? "Nes_Namco_Apu::end_frame/frame (fast synth)" : "Nes_Namco_Apu::end_frame/frame", 1.0, [&] {
+        int ch = frame % Nes_Namco_Apu::osc_count;
+        write(FRAME_CLOCKS / 3, 0x40 + ch * 8 + 2, 0x80 + (frame * 13) % 0x70);
+        write(FRAME_CLOCKS / 2, frame % 0x40, frame * 0x35);
+        ++frame;
+        apu.end_frame(FRAME_CLOCKS);
+        buffer.end_frame(FRAME_CLOCKS);
+        sink = buffer.read_samples(out.data(), static_cast<long>(out.size()));
+    });
+}
+
+// Spc_Emu's 32 kHz -> 44.1 kHz resampler and Dual_Resampler's width, one
+// 1/60 s block per op
+template<int width>
+void benchFirResampler(double ratio) {
+    static Fir_Resampler<width> resampler;
+    if (resampler.buffer_size(8192)) return;
+    resampler.time_ratio(ratio, 0.9965);
+    std::vector<float> signal = testSignal(8192);
+    std::vector<short> input(signal.size());
+    for (size_t i = 0; i < signal.size(); ++i) input[i] = static_cast<short>(signal[i] * 16000.0f);
+    std::vector<short> out(4096);
+    int frames = static_cast<int>(SAMPLE_RATE / 60);
+    char name[64];
+    snprintf(name, sizeof name, "Fir_Resampler<%d>::read/ratio %.2f", width, ratio);
+    run(name, frames, [&] {
+        int count = std::min(static_cast<int>(frames * resampler.ratio()) * 2 + 2, resampler.max_write());
+        std::copy_n(input.data(), count, resampler.buffer());
+        resampler.write(count);
+        sink = resampler.read(out.data(), frames * 2);
+    });
+}
+
+// The piano preprocessing pass on an NSF: register trace with the per-play-call
+// snapshot and state hash PianoVisualizer::traceFrameCallback takes
+void benchNsf() {
+    Nsf_Emu emu;
+    if (emu.set_sample_rate(SAMPLE_RATE) || emu.load_file(options.nsf_path)) {
+        fprintf(stderr, "kernel_bench: cannot load %s, skipping NSF cases\n", options.nsf_path);
+        return;
+    }
+
+    constexpr long TRACE_MSEC = 60000;
+    auto callback = [](void*, double time, Nsf_Emu& e) {
+        ApuFrameSnapshot snapshot = ApuFrameSnapshot::capture(*e.apu_(), e.vrc6_(), e.fme7_(), e.namco_(), time);
+        sink = static_cast<double>(e.trace_state_hash() ^ static_cast<uint32_t>(snapshot.periods[0]));
+    };
+    run("Nsf_Emu::run_trace/60s", TRACE_MSEC / 1000.0, [&] {
+        if (emu.start_trace(0) || emu.run_trace(TRACE_MSEC, callback, nullptr)) return;
+        emu.end_trace();
+    });
+
+    // Synthesis: what the playback thread asks of gme per chunk
+    constexpr int CHUNK = 2048;  // stereo samples
+    std::vector<Music_Emu::sample_t> out(CHUNK);
+    emu.ignore_silence(true);
+    if (emu.start_track(0)) return;
+    run("Nsf_Emu::play/1024_frames", CHUNK / 2, [&] {
+        if (emu.track_ended()) emu.start_track(0);
+        emu.play(CHUNK, out.data());
+        sink = out[0];
+    });
+}
+
+// Vgm_Emu's YM2612 at its native rate, one op a chunk of the preprocessing
+// pass: all six channels keyed on, one algorithm each, optionally with the
+// LFO modulating pitch and level
+void benchYm2612(bool lfo) {
+    Ym2612_Emu ym;
+    if (ym.set_rate(7670453 / 144.0, 7670453)) return;
+    ym.reset();
+    if (lfo) ym.write0(0x22, 0x08 | 3);
+    for (int ch = 0; ch < Ym2612_Emu::channel_count; ++ch) {
+        int reg = ch % 3;
+        auto write = [&ym, ch](int addr, int data) { ch < 3 ? ym.write0(addr, data) : ym.write1(addr, data); };
+        for (int op = 0; op < 4; ++op) {
+            int slot = reg + op * 4;
+            write(0x30 + slot, 0x01 + op);          // multiplier
+            write(0x40 + slot, op == 3 ? 0x08 : 0x18 + ch);
+            write(0x50 + slot, 0x1A);               // attack
+            write(0x60 + slot, 0x85 + op);          // AM on, decay
+            write(0x80 + slot, 0x3F);
+        }
+        write(0xB0 + reg, (ch % 4) << 3 | (ch + 2) % 8);
+        write(0xB4 + reg, 0xC0 | (lfo ? 0x32 : 0));
+        int fnum = 0x280 + ch * 0x43;
+        write(0xA4 + reg, 4 << 3 | fnum >> 8);
+        write(0xA0 + reg, fnum & 0xFF);
+        ym.write0(0x28, 0xF0 | (ch / 3 * 4 + reg));
+    }
+
+    constexpr int FRAMES = 1024;
+    std::vector<Ym2612_Emu::sample_t> out(FRAMES * 2);
+    run(lfo ? "Ym2612_Emu::run/1024_frames (LFO)" : "Ym2612_Emu::run/1024_frames", FRAMES, [&] {
+        std::fill(out.begin(), out.end(), 0);
+        ym.run(FRAMES, out.data());
+        sink = out[0];
+    });
+}
+
+// Eight voices looping BRR samples, two of them pitch-modulated
+void benchSpcDsp() {
+    std::vector<uint8_t> ram(0x10000);
+    Spc_Dsp dsp(ram.data());
+    dsp.reset();
+    uint32_t seed = 1;
+    for (int v = 0; v < Spc_Dsp::voice_count; ++v) {
+        int start = 0x1000 * (v + 1);
+        int blocks = 8 + v * 3;
+        int loop = start + 9 * (v % 4);
+        ram[0x200 + v * 4] = start & 0xFF;
+        ram[0x201 + v * 4] = start >> 8;
+        ram[0x202 + v * 4] = loop & 0xFF;
+        ram[0x203 + v * 4] = loop >> 8;
+        for (int b = 0; b < blocks; ++b) {
+            uint8_t* block = &ram[start + b * 9];
+            block[0] = (6 + b % 6) << 4 | (b % 4) << 2 | (b == blocks - 1 ? 3 : 0);
+            for (int i = 1; i < 9; ++i) {
+                seed = seed * 1103515245 + 12345;
+                block[i] = seed >> 16;
+            }
+        }
+        int reg = v * 0x10;
+        int pitch = 0x0400 + v * 0x0333;
+        dsp.write(reg + 0, 0x40);
+        dsp.write(reg + 1, 0x30);
+        dsp.write(reg + 2, pitch & 0xFF);
+        dsp.write(reg + 3, pitch >> 8);
+        dsp.write(reg + 4, v);
+        dsp.write(reg + 7, 0x7F);  // direct gain
+    }
+    dsp.write(0x5D, 0x02);  // source directory
+    dsp.write(0x0C, 0x7F);
+    dsp.write(0x1C, 0x7F);
+    dsp.write(0x6C, 0x20);  // unmute, echo writes off
+    dsp.write(0x2D, 0x24);
+    dsp.write(0x4C, 0xFF);
+
+    constexpr int FRAMES = 1024;
+    std::vector<short> out(FRAMES * 2);
+    run("Spc_Dsp::run/1024_frames", FRAMES, [&] {
+        dsp.run(FRAMES, out.data());
+        sink = out[0];
+    });
+}
+
+void benchAgnes() {
+    if (!options.rom_path) return;
+    std::ifstream file(options.rom_path, std::ios::binary | std::ios::ate);
+    std::vector<uint8_t> rom(file ? static_cast<size_t>(file.tellg()) : 0);
+    file.seekg(0, std::ios::beg);
+    agnes_t* agnes = agnes_make();
+    if (!file.read(reinterpret_cast<char*>(rom.data()), rom.size()) ||
+        !agnes_load_ines_data(agnes, rom.data(), rom.size())) {
+        fprintf(stderr, "kernel_bench: cannot load ROM %s\n", options.rom_path);
+        agnes_destroy(agnes);
+        return;
+    }
+    run("agnes_next_frame", 1.0, [&] { agnes_next_frame(agnes); });
+    agnes_destroy(agnes);
+}
+
+void usage() {
+    fprintf(stderr, "usage: kernel_bench [--filter substr] [--min-time sec] [--json file] [--nsf file] [--rom file]\n");
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    for (int i = 1; i < argc; ++i) {
+        bool has_value = i + 1 < argc;
+        if (!strcmp(argv[i], "--filter") && has_value) {
+            options.filter = argv[++i];
+        } else if (!strcmp(argv[i], "--min-time") && has_value) {
+            options.min_time = std::max(0.001, atof(argv[++i]));
+        } else if (!strcmp(argv[i], "--json") && has_value) {
+            options.json_path = argv[++i];
+        } else if (!strcmp(argv[i], "--nsf") && has_value) {
+            options.nsf_path = argv[++i];
+        } else if (!strcmp(argv[i], "--rom") && has_value) {
+            options.rom_path = argv[++i];
+        } else {
+            usage();
+            return 1;
+        }
+    }
+
+    benchFft();
+    benchFftBatch();
+    benchLoudness();
+    benchPitch();
+    benchMagnitude();
+    benchAudioRing();
+    benchAudioState<false>("packed");
+    benchAudioState<true>("apart");
+    benchBlipBuffer(false);
+    benchBlipBuffer(true);
+    benchNesApu(false);
+    benchNesApu(true);
+    benchNesApu(false, true);
+    benchNamcoApu(false);
+    benchNamcoApu(true);
+    benchFirResampler<24>(32000.0 / SAMPLE_RATE);
+    benchFirResampler<24>(1.1);
+    benchFirResampler<12>(1.37);
+    benchNsf();
+    benchYm2612(false);
+    benchYm2612(true);
+    benchSpcDsp();
+    benchAgnes();
+
+    if (options.json_path && !writeJson(options.json_path)) {
+        fprintf(stderr, "kernel_bench: cannot write %s\n", options.json_path);
+        return 1;
+    }
+    return 0;
+}
@@ -1,5 +1,7 @@
 #if defined(__APPLE__)
 #define SOKOL_METAL
+#elif defined(__EMSCRIPTEN__)
+#define SOKOL_GLES3
 #else
 #define SOKOL_VULKAN
 #endif
@@ -12,7 +14,13 @@
 #include <cstring>
 #include <algorithm>
 #include <mutex>
+#include <condition_variable>
 #include <atomic>
+#include <thread>
+#include <chrono>
+#include <string>
+#include <memory>
+#include <ctime>
 
 #include "imgui.h"
 #include "util/sokol_imgui.h"
@@ -23,8 +31,13 @@
 #include "gme/Nes_Apu.h"
 #include "gme/Nes_Vrc6_Apu.h"
 
-// Native File Dialog for file selection
+// Native File Dialog for file selection; the browser build picks, drops
+// and downloads files through the page instead
+#ifdef __EMSCRIPTEN__
+#include "WebFiles.h"
+#else
 #include "nfd.h"
+#endif
 
 // Audio Visualizer
 #include "AudioVisualizer.h"
@@ -34,8 +47,91 @@
 
 // NES Emulator
 #include "NesEmulator.h"
+#include "NoteLookahead.h"
+
+// Lock-free sample ring between synthesis thread and audio callback
+#include "AudioRing.h"
+#include "RealtimeThread.h"
+#include "ThreadPlacement.h"
+#include "SaveSlots.h"
+
+// Background workers for preprocessing
+#include "JobSystem.h"
+#include "CanvasJobs.h"
+
+// On-disk cache of preprocessed piano-roll notes
+#include "NoteCache.h"
+#include "WaveformPeaks.h"
+#include "TrackSpectrogram.h"
+#include "TrackSpectrogramView.h"
+#include "MappedFile.h"
+#include "MusicEmuPool.h"
+#include "ScrubPreview.h"
+#include "AudioExport.h"
+
+// Per-voice Blip_Buffers for the voice scopes
+#include "VoiceScopeBuffer.h"
+
+// Sound chip handles resolved at load time, the per-frame state read from them
+// and a trace of their register writes
+#include "ApuTap.h"
+#include "ApuSnapshot.h"
+#include "ApuSnapshotQueue.h"
+#include "ApuWriteLog.h"
+#include "SnapshotLog.h"
+
+// Idle frame skipping and the redraw cap
+#include "FramePacer.h"
+
+// Per-stage timings for the profiler window, 6502 hotspots for the CPU profiler
+#include "Profiler.h"
+#include "CpuProfiler.h"
+#include "FrameArena.h"
+
+// Underrun, jitter and queue level telemetry for the audio output
+#include "AudioTelemetry.h"
+#include "LatencyProbe.h"
+
+// Indexed NSF collections for the library window
+#include "NsfLibrary.h"
+// Files dropped on the window, played in turn
+#include "PlayQueue.h"
+#include "ZipArchive.h"
+#include "LoudnessMeter.h"
+
+// Nametable, pattern, sprite and palette viewers for the emulator
+#include "PpuViewer.h"
+#include "InputLatencyTest.h"
+
+// RAM search and address freezing for the emulator
+#include "RamSearch.h"
+
+// Breakpoints and stepping for the emulator's 6502
+#include "NesDebugger.h"
+
+// Pattern view of the sound register trace
+#include "TrackerView.h"
+
+// Shared-memory feed of the analysis for stream overlays
+#include "OverlayFeed.h"
+#include "FrameShare.h"
+
+// Visualizers loaded from shared libraries
+#include "PluginHost.h"
+
+// Offline rendering of tracks to video files, batches of exports and register trace diffs
+#include "VideoRenderer.h"
+#include "BatchRunner.h"
+#include "TraceDiff.h"
+
+// Headless NES sessions stepped by an external agent through shared memory
+#include "AgentEnv.h"
+
+// The last seconds played, kept for saving as a clip
+#include "ClipRecorder.h"
 
 #include <cctype>
+#include <cstdlib>
 #include <cstring>
 
 // Helper function to check file extension (case-insensitive)
@@ -56,10 +152,51 @@ static bool has_extension(const char* path, const char* ext) {
     return true;
 }
 
+// gme_identify_file over an already mapped image: extension first, then header
+static gme_type_t identify_mapped(const char* path, const MappedFile& file) {
+    gme_type_t type = gme_identify_extension(path);
+    if (!type && file.size() >= 4) {
+        type = gme_identify_extension(gme_identify_header(file.data()));
+    }
+    return type;
+}
+
+// gme_open_file equivalent that loads from the mapped pages instead of reading
+// the file through a Data_Reader
+static gme_err_t open_mapped(const char* path, const MappedFile& file, Music_Emu** out, long sample_rate) {
+    *out = nullptr;
+    gme_type_t type = identify_mapped(path, file);
+    if (!type) return gme_wrong_file_type;
+    
+    Music_Emu* emu = gme_new_emu(type, sample_rate);
+    if (!emu) return "Out of memory";
+    
+    gme_err_t err = gme_load_data(emu, file.data(), static_cast<long>(file.size()));
+    if (err) {
+        gme_delete(emu);
+        return err;
+    }
+    *out = emu;
+    return nullptr;
+}
+
 static bool show_demo_window = false;
 static bool show_visualizer = true;
 static bool show_piano = true;
 static bool show_emulator = false;
+static bool show_profiler = false;
+static bool show_cpu_profiler = false;
+static bool show_audio_telemetry = false;
+static bool show_ppu_viewer = false;
+static bool show_ram_search = false;
+static bool show_input_latency = false;
+static bool show_nes_debugger = false;
+static bool show_tracker = false;
+static bool show_library = false;
+static bool show_play_queue = false;
+static bool show_track_spectrogram = true;
+static bool show_jobs = false;
+static bool show_latency_calibration = false;
 
 // Application mode: NSF Player or NES Emulator
 enum class AppMode {
@@ -74,336 +211,2160 @@ static bool key_states[512] = {};  // Track key press states
 // Mutex for protecting audio operations
 static std::mutex audio_mutex;
 
+// Preprocessed notes for one track of the album
+struct AlbumTrackNotes {
+    NoteTimeline notes;
+    float duration = 0.0f;
+    bool ready = false;
+};
+
+// Chip state at one play routine call, held until the chunk it falls in is
+// known to the ring
+struct PlayCallSnapshot {
+    unsigned long long clock;   // Nsf_Emu clocks since the track started
+    ApuFrameSnapshot snapshot;
+};
+
+// Where the audio callback was in a player's output when it last ran
+struct AudioClock {
+    uint64_t frame = 0;     // output position of the first frame it handed the device
+    int frames = 0;         // frames it handed over
+    int64_t time_ns = 0;    // steady clock
+};
+
+// Snapshot session: either player's channel states recorded to a SnapshotLog,
+// or a log driving the visualizers in place of the players
+enum class SessionMode {
+    OFF,
+    RECORDING,
+    REPLAYING
+};
+
+// What the loader thread is opening
+enum class LoadKind {
+    MUSIC,
+    NES_ROM
+};
+
+// A file opened by the loader thread, waiting for frame() to switch it in
+struct LoadedFile {
+    LoadKind kind = LoadKind::MUSIC;
+    std::string path;
+    std::string error;                               // empty on success
+    Music_Emu* emu = nullptr;                        // MUSIC: ready to play, owned until installed
+    std::unique_ptr<VoiceScopeBuffer> voice_buffer;  // MUSIC with voice scopes; must outlive emu
+    std::shared_ptr<MusicEmuPool> pool;              // MUSIC: the file's bytes, for the background jobs
+    int start_track = -1;                            // MUSIC: play this track once installed
+    
+    ~LoadedFile() {
+        if (emu) gme_delete(emu);
+    }
+};
+
 // application state
 static struct {
-    sg_pass_action pass_action;
+    // What the synthesis thread, the audio callback and the UI share, in
+    // blocks on cache lines of their own, each stored to by one side: the
+    // audio threads' telemetry, stored every chunk or callback and read by
+    // frame() once per frame; the ring flush the callback reads every pass,
+    // stored only when stale audio is dropped; and the UI's settings and
+    // requests, stored on a user action and read by the audio threads every
+    // pass (synthesis checks a request before clearing it). Kept apart, a
+    // store on one side never takes a line another thread is reading, nor
+    // the UI-only fields after them.
+    
+    // Synthesis thread -> UI
+    alignas(64) std::atomic<float> playback_time{0.0f};  // seconds, as rendered
+    std::atomic<uint32_t> audio_overruns{0};    // synthesis found the ring full
+    std::atomic<int> gapless_track{-1};         // swapped in by synthesis, not yet seen by frame()
+    std::atomic<float> seek_latency_ms{0.0f};   // UI request until synthesis renders from the new position
+    std::atomic<float> seek_latency_max_ms{0.0f};
+    std::atomic<bool> realtime_refused{false};  // the OS kept a thread at normal priority
+    
+    // Audio callback -> UI
+    alignas(64) std::atomic<float> queued_frames_avg{0.0f};  // smoothed queue depth seen by the callback
+    std::atomic<uint32_t> audio_underruns{0};   // callback found the ring short
+    
+    // Synthesis thread (or the UI, under audio_mutex) -> callback
+    alignas(64) std::atomic<uint64_t> ring_flush_pos{0};   // callback drops frames written before this
+    std::atomic<uint64_t> ring_fade_pos{0};     // a flush at this position crossfades instead of cutting
+    std::atomic<bool> synth_track_ended{false}; // synthesis reached the end of the track
+    
+    // UI -> audio threads
+    alignas(64) std::atomic<bool> is_playing{false};
+    std::atomic<bool> synth_running{false};
+    std::atomic<bool> synth_batching{false};
+    std::atomic<bool> realtime_audio{false};    // each audio thread picks a change up on its next pass
+    std::atomic<float> volume_gain{1.0f};  // volume_db as a linear factor, applied by the callback
+    std::atomic<float> track_gain{1.0f};   // the library's ReplayGain for the playing track, NSF only
+    std::atomic<int> synth_target_frames{1536};
+    std::atomic<long> seek_request{-1};  // -1 means no seek requested
+    std::atomic<int64_t> seek_requested_ns{0};  // steady_clock time of the pending request, 0 if untimed
+    std::atomic<long> loop_a_ms{-1};     // A-B loop, handed to gme by synthesis; -1 unset
+    std::atomic<long> loop_b_ms{-1};     // looping while > loop_a_ms
+    std::atomic<bool> loop_request{false};
+    
+    alignas(64) sg_pass_action pass_action;
     
     // Game_Music_Emu state
     Music_Emu* emu = nullptr;
-    std::atomic<bool> is_playing{false};
+    ApuTap apu_tap;  // chip handles for emu, resolved in install_music
+    ApuSnapshotLock apu_snapshot;  // the active player's channel state as heard, updated by frame()
+    ApuSnapshotQueue apu_snapshots;  // apu_tap's channel state at each play call, by ring frame heard at
+    std::vector<PlayCallSnapshot> play_calls;  // this chunk's play calls so far; audio_mutex
+    uint64_t apu_snapshot_seen = 0;  // last taken from the active player's queue; main thread
+    uint64_t apu_snapshot_frame = 0; // output frame it is heard from
+    double apu_snapshot_time = 0.0;  // and its playback time
+    ApuWriteLog apu_writes;  // apu_tap's register writes, pushed by the synthesis thread
+    CpuProfiler nsf_cpu_profiler;  // apu_tap's 6502, fed at each play call
+    ChannelLayout channel_layout = ChannelLayout::build(0);  // apu_tap's channels, for the visualizers
+    ChannelLayout nes_channel_layout = ChannelLayout::build(0);  // the loaded ROM's channels
+    
+    // A player with no register tap (or Pitch From Audio) shows the pitches
+    // the analysis tracks in its audio as its channels instead
+    bool audio_pitch = false;                // Pitch From Audio, for files with a tap too
+    std::shared_ptr<AnalysisGraph::Subscription> pitch_feed;
+    ApuSnapshotLock pitch_snapshot;
+    ChannelLayout pitch_layout = ChannelLayout::buildPitches(AnalysisGraph::MIX_PITCHES);
+    
+    // Snapshot session; main thread
+    SessionMode session_mode = SessionMode::OFF;
+    SnapshotLog session_log;
+    bool session_nes = false;                // recording: the emulator's queue, not the player's
+    ChannelLayout session_layout;            // recording: the channels taken; a change ends it
+    bool session_ended = false;              // recording: the channels changed, nothing more is taken
+    uint64_t session_seq = 0;                // recording: next queue entry to take
+    SnapshotLog::Cursor session_cursor;      // replay
+    std::chrono::steady_clock::time_point session_start;  // replay: when session frame 0 was shown
     int current_track = 0;
     int track_count = 0;
     char loaded_file[512] = "";
+    std::shared_ptr<MusicEmuPool> emu_pool;  // loaded_file's bytes and idle emulators; main thread
     char error_msg[512] = "";
     
     // Audio state
     bool audio_initialized = false;
-    const long sample_rate = 44100;
+    long sample_rate = 44100;  // the device's own rate once apply_latency_profile() has opened it
+    std::thread audio_device_thread;    // opens (and closes) the device; see apply_latency_profile
+    bool audio_opening = false;         // audio_device_thread not joined yet
+    bool audio_setup_called = false;    // saudio_setup ran, maybe failing; saudio_shutdown is owed
+    std::atomic<bool> audio_opened{false};
     
     // Playback info
     float tempo = 1.0f;
     float volume_db = 0.0f;
+    bool normalize_loudness = true;
     
-    // Seek request (set by UI thread, processed by audio thread)
-    std::atomic<long> seek_request{-1};  // -1 means no seek requested
+    // Analysis of what is playing, shared by every view that reads it
+    AnalysisGraph analysis;
     
     // Audio visualizer
-    AudioVisualizer visualizer;
+    AudioVisualizer visualizer{analysis};
+    
+    // Spectrum, levels and notes in shared memory for stream overlays, while enabled
+    OverlayFeed overlay_feed;
+    
+    // Visualizer plugins, each on a thread of its own
+    PluginHost plugins{analysis};
+    
+    // GPU images of the NES screen for capture tools, while enabled
+    FrameShare frame_share;
     
     // Piano visualizer
     PianoVisualizer piano;
     
-    // Playback time in seconds
-    std::atomic<float> playback_time{0.0f};
-    
-    // Piano preprocessing state
+    // Piano preprocessing state (runs as a background job)
+    JobSystem jobs;
+    JobHandle preprocess_job;
     std::atomic<bool> preprocessing{false};
     std::atomic<float> preprocess_progress{0.0f};
     
+    // Scope, roll and spectrum canvases built on the workers, spliced into
+    // the windows' draw lists before the render
+    CanvasJobs canvas_jobs{jobs};
+    
+    // The last ClipRecorder::SECONDS of the NSF player, for File > Save Clip
+    ClipRecorder clip_recorder{jobs};
+    bool clip_video = false;    // with a video of the roll and scope
+    
+    // Waveform behind the seek bar and the spectrogram strip above it, from
+    // the cache or a job that plays the track once; null until ready
+    JobHandle waveform_job;
+    std::mutex waveform_mutex;
+    std::shared_ptr<const WaveformPeaks> waveform;
+    std::shared_ptr<const TrackSpectrogram> spectrogram;
+    TrackSpectrogramView spectrogram_view;
+    
+    // Optional whole-album preprocessing: one job per track across all workers
+    bool album_preprocess = false;
+    std::vector<JobHandle> album_jobs;
+    std::mutex album_mutex;
+    std::vector<AlbumTrackNotes> album_notes;  // indexed by track
+    std::atomic<int> album_ready_count{0};
+    
+    // Gapless playback: the next track is opened and started (initial silence
+    // skipped) on a worker in its own emulator, then swapped in for the current
+    // one when it ends instead of stalling in gme_start_track
+    bool gapless = true;
+    JobHandle prestart_job;
+    std::string prestart_path;        // what prestart_job was submitted for
+    int prestart_track = -1;
+    std::mutex prestart_mutex;
+    uint32_t prestart_generation = 0; // prestart_mutex; a job only publishes for its own
+    std::unique_ptr<LoadedFile> prestart_result;  // start_track is the track it is started at
+    int synth_track = 0;              // track state.emu is playing; audio_mutex
+    std::unique_ptr<LoadedFile> retired_track;    // swapped-out emulator; audio_mutex, freed by frame()
+    
+    // Album/stem export: the folder dialog runs on export_thread, frame()
+    // starts the render jobs once a folder has been picked
+    AlbumExporter album_export;
+    std::thread export_thread;
+    std::atomic<bool> export_dialog_busy{false};
+    std::mutex export_mutex;
+    ExportFormat export_format = ExportFormat::FLAC;
+    ExportContent export_content = ExportContent::MIX;
+    bool export_whole_album = true;  // false: only the current track
+    std::string export_pending_dir;  // picked folder, not yet started
+    
+    // Library of scanned folders; the add-folder dialog runs on library_thread
+    NsfLibrary library;
+    std::thread library_thread;
+    std::atomic<bool> library_dialog_busy{false};
+    std::mutex library_mutex;
+    std::string library_pending_dir;
+    
+    // Dropped files and folders, played one after another
+    PlayQueue play_queue;
+    
+    // Skips frames while nothing on screen changes
+    FramePacer frame_pacer;
+    
     // Audio buffer for visualization (double buffered)
     std::vector<short> viz_buffer;
     int viz_buffer_pos = 0;
     
+    // Synthesis thread renders NSF audio ahead of the callback into audio_ring
+    AudioRing audio_ring;
+    std::thread synth_thread;
+    std::mutex synth_wake_mutex;
+    std::condition_variable synth_wake;        // cuts a power-saver sleep short
+    bool synth_wake_pending = false;           // under synth_wake_mutex
+    
+    // Power saver: with the window hidden or no visualizer open, synthesis
+    // renders seconds ahead in bursts and sleeps in between, and the UI ticks
+    bool power_saver = false;
+    bool window_hidden = false;                // iconified or suspended
+    SeqLock<AudioClock> audio_clock;           // stored by every NSF callback that plays
+    SeqLock<AudioClock> nes_audio_clock;       // same for the emulator's sample queue
+    float output_offset_ms = 0.0f;             // manual latency beyond the device buffer (Bluetooth, TVs)
+    LatencyProbe latency_probe;                // chirps from the callback, heard back through capture
+    double presentation_time = 0.0;            // playback time at the speakers; main thread
+    AudioTelemetry audio_telemetry;
+    PpuViewer ppu_viewer;
+    RamSearch ram_search;
+    InputLatencyTest input_latency;
+    NesDebugger nes_debugger;
+    TrackerView tracker;
+    
+    // Grains heard while a seek control is dragged; playback seeks on release
+    ScrubPreview scrub{jobs};
+    bool scrub_held = false;    // a control was dragged this frame
+    
+    // Latency profile (index into LATENCY_PROFILES) and what the callback measures
+    int latency_profile = 1;
+    bool audio_exclusive = false;   // WASAPI exclusive mode, bypassing the system mixer
+    bool audio_ring_locked = false;
+    
+    // Per-voice scope mode: the player emulator mixes through voice_buffer
+    bool voice_scopes = false;
+    std::unique_ptr<VoiceScopeBuffer> voice_buffer;  // must outlive emu
+    
+    // File loader: dialog and parsing run on loader_thread, frame() installs the result
+    std::thread loader_thread;
+    std::atomic<bool> loader_busy{false};  // a load is in flight or not yet installed
+    std::mutex loader_mutex;
+    std::unique_ptr<LoadedFile> loader_result;
+    
     // NES Emulator
     NesEmulator nes_emu;
+    SaveSlots save_slots{jobs};
+    NoteLookahead nes_lookahead;  // piano roll predictions; needs jobs
     bool nes_rom_loaded = false;
     agnes_input_t nes_input = {};  // Current controller input
     float nes_screen_scale = 2.0f;
+    bool nes_turbo = false;
+    char nes_netplay_address[64] = "127.0.0.1";
+    int nes_netplay_port = Netplay::DEFAULT_PORT;
+    int nes_filter = 0;  // index into NES_FILTERS
+    PostProcessor::Pass nes_filter_passes[PostProcessor::MAX_PASSES];
+    int nes_filter_pass_count = 0;
 } state;
 
+// Screen filter presets for the NES window: passes run left to right
+struct NesFilterPreset {
+    const char* name;
+    PostProcessor::Effect passes[2];
+    int count;
+};
+static constexpr NesFilterPreset NES_FILTERS[] = {
+    {"Off",            {}, 0},
+    {"Scanlines",      {PostProcessor::Effect::SCANLINES}, 1},
+    {"CRT",            {PostProcessor::Effect::CRT}, 1},
+    {"Scale2x",        {PostProcessor::Effect::SCALE2X}, 1},
+    {"Scale2x + CRT",  {PostProcessor::Effect::SCALE2X, PostProcessor::Effect::CRT}, 2},
+};
+static constexpr int NES_FILTER_COUNT = static_cast<int>(sizeof(NES_FILTERS) / sizeof(NES_FILTERS[0]));
+
+static void apply_nes_filter(int index) {
+    const NesFilterPreset& preset = NES_FILTERS[index];
+    state.nes_filter = index;
+    state.nes_filter_pass_count = preset.count;
+    for (int i = 0; i < preset.count; ++i) {
+        state.nes_filter_passes[i] = PostProcessor::defaultPass(preset.passes[i]);
+    }
+    // A CRT after Scale2x already has twice the rows to work with
+    if (preset.count == 2) state.nes_filter_passes[1].scale = 2;
+    state.nes_emu.setScreenFilter(state.nes_filter_passes, state.nes_filter_pass_count);
+}
+
+// Sliders for the active chain's parameters; true if any changed
+static bool draw_nes_filter_params() {
+    bool changed = false;
+    for (int i = 0; i < state.nes_filter_pass_count; ++i) {
+        PostProcessor::Pass& pass = state.nes_filter_passes[i];
+        float* p = pass.params;
+        ImGui::PushID(i);
+        ImGui::TextDisabled("%s", PostProcessor::effectName(pass.effect));
+        switch (pass.effect) {
+            case PostProcessor::Effect::SCANLINES:
+                changed |= ImGui::SliderFloat("Scanlines", &p[0], 0.0f, 1.0f);
+                break;
+            case PostProcessor::Effect::CRT:
+                changed |= ImGui::SliderFloat("Scanlines", &p[0], 0.0f, 1.0f);
+                changed |= ImGui::SliderFloat("Curvature", &p[1], 0.0f, 0.15f);
+                changed |= ImGui::SliderFloat("Mask", &p[2], 0.0f, 1.0f);
+                changed |= ImGui::SliderFloat("Vignette", &p[3], 0.0f, 1.0f);
+                break;
+            case PostProcessor::Effect::SCALE2X:
+                changed |= ImGui::SliderFloat("Tolerance", &p[0], 0.0f, 0.3f);
+                break;
+            case PostProcessor::Effect::COUNT:
+                break;
+        }
+        ImGui::PopID();
+    }
+    return changed;
+}
+
+// Synthesis thread tuning
+static constexpr int AUDIO_RING_FRAMES = 1 << 18; // ~5.5 s at 48 kHz, for power-saver batches
+static constexpr int SYNTH_CHUNK_FRAMES = 512;
+
+// Power-saver batches: refill to BATCH_AHEAD once the queue is down to
+// BATCH_REFILL, sleeping at most BATCH_MAX_SLEEP at a time in between
+static constexpr float BATCH_AHEAD_SECONDS = 4.0f;
+static constexpr float BATCH_REFILL_SECONDS = 1.0f;
+static constexpr std::chrono::milliseconds BATCH_MAX_SLEEP{250};
+
+// Latency profiles size the device buffer, the synthesis queue and the
+// emulator's Blip_Buffer together
+struct LatencyProfile {
+    const char* name;
+    int buffer_frames;  // sokol_audio device buffer
+    int queue_frames;   // synthesis thread keeps this much queued ahead of the callback
+    int blip_msec;      // emulator Blip_Buffer length
+};
+static const LatencyProfile LATENCY_PROFILES[] = {
+    { "Ultra (5 ms)",  256,  768,  80 },
+    { "Low (12 ms)",   512,  1536, 100 },
+    { "Safe (46 ms)",  2048, 4096, 200 },
+};
+static constexpr int LATENCY_PROFILE_COUNT = sizeof(LATENCY_PROFILES) / sizeof(LATENCY_PROFILES[0]);
+
+// Output latency measured per profile (Audio Latency > Measure Latency);
+// the offset it calls for is applied whenever the profile is opened again
+struct LatencyCalibration {
+    bool measured = false;
+    bool exclusive = false;     // WASAPI exclusive mode at the time
+    const char* failure = nullptr;
+    float device_ms = 0.0f;     // the device buffer heard_output_frame() assumes
+    float latency_ms = 0.0f;    // emitting callback to recorded, the probes' median
+    float spread_ms = 0.0f;
+    float offset_ms = 0.0f;     // latency_ms - device_ms
+};
+static LatencyCalibration latency_calibration[LATENCY_PROFILE_COUNT];
+
+// A measurement reopens the device with capture for each queued profile in
+// turn, then reopens the profile it started from without it
+static struct {
+    std::vector<int> queue;     // front is being measured
+    int restore = -1;
+    bool capture = false;       // open the device with the probe's capture callback
+} latency_measure;
+
+// Wake the synthesis thread if it is sleeping through a power-saver batch
+static void wake_synthesis() {
+    {
+        std::lock_guard<std::mutex> lock(state.synth_wake_mutex);
+        state.synth_wake_pending = true;
+    }
+    state.synth_wake.notify_one();
+}
+
+// Mark everything currently in the ring as stale (call after seek/track change).
+// With crossfade the callback fades the stale audio out under the new instead of cutting.
+static void flush_audio_ring(bool crossfade = false) {
+    uint64_t position = state.audio_ring.writePosition();
+    if (crossfade) {
+        state.ring_fade_pos.store(position, std::memory_order_relaxed);
+    }
+    state.ring_flush_pos.store(position, std::memory_order_release);
+    wake_synthesis();
+}
+
+static int64_t steady_now_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// UI thread: ask the synthesis thread to seek, timing it for the stats line
+static void request_seek(long msec) {
+    state.seek_requested_ns.store(steady_now_ns(), std::memory_order_relaxed);
+    state.seek_request.store(msec);
+    wake_synthesis();
+}
+
+// UI thread: loop a_msec to b_msec (b_msec <= a_msec stops looping, keeping
+// a_msec as a mark); starting a loop jumps back to a_msec
+static void set_ab_loop(long a_msec, long b_msec) {
+    state.loop_a_ms.store(a_msec);
+    state.loop_b_ms.store(b_msec);
+    state.loop_request.store(true);
+    wake_synthesis();
+}
+
+// UI thread: a seek control is being dragged to msec
+static void scrub_to(long msec) {
+    state.scrub.move(msec);
+    state.scrub_held = true;
+}
+
+// UI thread, after the player window: once the control is let go, playback
+// seeks to where the scrub stopped
+static void finish_scrub() {
+    if (state.scrub.active() && !state.scrub_held) {
+        request_seek(state.scrub.end());
+    }
+    state.scrub_held = false;
+}
+
+// Render one chunk of NSF audio into the ring. Must hold audio_mutex.
+static void synthesize_chunk() {
+    constexpr int num_samples = SYNTH_CHUNK_FRAMES * 2;
+    
+    // Process seek request if any. The callback keeps playing what is already
+    // queued while gme seeks, then crossfades from it into the new position.
+    // Loaded before it is cleared, so a chunk with none pending leaves the
+    // UI's line shared with the callback.
+    long seek_pos = -1;
+    if (state.seek_request.load(std::memory_order_relaxed) >= 0) seek_pos = state.seek_request.exchange(-1);
+    if (seek_pos >= 0) {
+        gme_seek(state.emu, seek_pos);
+        state.play_calls.clear();  // the seek's own play calls are never heard
+        flush_audio_ring(true);
+        state.synth_track_ended.store(false);
+        
+        int64_t requested = state.seek_requested_ns.exchange(0, std::memory_order_relaxed);
+        if (requested) {
+            float ms = (steady_now_ns() - requested) / 1e6f;
+            state.seek_latency_ms.store(ms, std::memory_order_relaxed);
+            if (ms > state.seek_latency_max_ms.load(std::memory_order_relaxed)) {
+                state.seek_latency_max_ms.store(ms, std::memory_order_relaxed);
+            }
+        }
+    }
+    
+    // gme repeats an A-B loop itself, from its state saved at A, so the ring
+    // always holds the next pass and the jump costs nothing. Setting one goes
+    // to A, dropping what was queued like a seek.
+    if (state.loop_request.load(std::memory_order_relaxed) && state.loop_request.exchange(false)) {
+        long a = state.loop_a_ms.load();
+        long b = state.loop_b_ms.load();
+        if (a >= 0 && b > a) {
+            if (!gme_set_loop(state.emu, a, b)) {
+                state.play_calls.clear();
+                flush_audio_ring(true);
+                state.synth_track_ended.store(false);
+            }
+        } else {
+            gme_clear_loop(state.emu);
+        }
+    }
+    
+    // Stereo float straight from gme. Volume is applied in the callback so
+    // slider changes are heard immediately.
+    float chunk[num_samples];
+    gme_err_t err;
+    {
+        PROFILE_STAGE(GmePlay);
+        err = gme_play_float(state.emu, num_samples, chunk, 1.0f);
+    }
+    if (err) {
+        std::fill(chunk, chunk + num_samples, 0.0f);
+    }
+    
+    // Update visualizer with audio data; a power-saver batch has no one watching
+    if (!state.synth_batching.load(std::memory_order_relaxed)) {
+        state.analysis.write(chunk, num_samples);
+    }
+    
+    // Playback time as the callback reads it, i.e. behind the synthesis position
+    // by whatever is still queued in the ring (frame() takes off the device
+    // buffer when no play call has been heard yet)
+    int queued = state.audio_ring.available();
+    float current_time = gme_tell(state.emu) / 1000.0f - queued / static_cast<float>(state.sample_rate);
+    state.playback_time.store(std::max(current_time, 0.0f));
+    
+    // Stamp the chip state at each play call with the ring frame it is heard
+    // at: the chunk ends where play() stopped, and gme has rendered ahead of
+    // that by what it buffers
+    const ApuTap& tap = state.apu_tap;
+    if (tap.nsf) {
+        uint64_t chunk_end = state.audio_ring.writePosition() + SYNTH_CHUNK_FRAMES;
+        float chunk_end_time = gme_tell(state.emu) / 1000.0f;
+        for (PlayCallSnapshot& call : state.play_calls) {
+            double lead = tap.nsf->clock_lead(call.clock);
+            int64_t frame = static_cast<int64_t>(chunk_end) + std::llround(lead);
+            call.snapshot.time = chunk_end_time + lead / state.sample_rate;
+            state.apu_snapshots.push(call.snapshot, static_cast<uint64_t>(std::max<int64_t>(frame, 0)));
+            state.clip_recorder.writeSnapshot(call.snapshot, static_cast<uint64_t>(std::max<int64_t>(frame, 0)));
+        }
+        state.play_calls.clear();
+    } else if (tap.voices) {
+        // No play calls to stamp: other formats are read once a chunk
+        ApuFrameSnapshot snapshot = tap.capture(gme_tell(state.emu) / 1000.0);
+        state.apu_snapshots.push(snapshot, state.audio_ring.writePosition() + SYNTH_CHUNK_FRAMES);
+        state.clip_recorder.writeSnapshot(snapshot, state.audio_ring.writePosition() + SYNTH_CHUNK_FRAMES);
+    }
+    
+    state.clip_recorder.writeAudio(chunk, SYNTH_CHUNK_FRAMES, state.audio_ring.writePosition());
+    int written = state.audio_ring.write(chunk, SYNTH_CHUNK_FRAMES);
+    if (written < SYNTH_CHUNK_FRAMES) {
+        state.audio_overruns.fetch_add(1, std::memory_order_relaxed);
+    }
+    
+    // Stop rendering once the track is over so the ring can drain
+    if (gme_track_ended(state.emu)) {
+        state.synth_track_ended.store(true);
+    }
+}
+
+// Output position the speakers have reached, by a player's audio clock.
+// The callback's block starts playing about one device buffer after it runs
+// and then plays out in real time; a stalled callback freezes the estimate at
+// the end of its block. The manual offset covers latency past the device
+// (Bluetooth, a TV's processing) that sokol cannot see.
+static int64_t heard_output_frame(const AudioClock& clock) {
+    int64_t device_frames = state.audio_initialized ? saudio_buffer_frames() : 0;
+    int64_t elapsed = (steady_now_ns() - clock.time_ns) * state.sample_rate / 1000000000ll;
+    int64_t offset = std::llround(state.output_offset_ms * state.sample_rate / 1000.0);
+    return static_cast<int64_t>(clock.frame) - device_frames - offset +
+           std::clamp<int64_t>(elapsed, 0, device_frames + clock.frames);
+}
+
+// Main thread: publish the latest play call (or emulated frame) state the
+// speakers have reached, derive the presentation clock from it and hold the
+// scopes back by what is queued but not yet heard. Returns false while the
+// player has produced nothing to go by.
+static bool present_heard_audio(bool nes_mode) {
+    const SeqLock<AudioClock>& audio_clock = nes_mode ? state.nes_audio_clock : state.audio_clock;
+    const ApuSnapshotQueue& queue = nes_mode ? state.nes_emu.apuSnapshots() : state.apu_snapshots;
+    AudioClock clock;
+    if (audio_clock.load(clock) == 0) return false;
+    int64_t heard = heard_output_frame(clock);
+    
+    // The NES player feeds the visualizer from the callback, the NSF player as it synthesizes
+    int64_t fed = nes_mode ? static_cast<int64_t>(clock.frame) + clock.frames
+                           : static_cast<int64_t>(state.audio_ring.writePosition());
+    state.analysis.setOutputDelay(static_cast<int>(std::clamp<int64_t>(fed - heard, 0, INT32_MAX)));
+    if (heard < 0) return false;
+    
+    ApuFrameSnapshot snapshot;
+    uint64_t frame = 0;
+    uint64_t seq = queue.heardBy(static_cast<uint64_t>(heard), snapshot, state.apu_snapshot_seen, &frame);
+    if (seq == 0) return false;
+    if (seq != state.apu_snapshot_seen) {
+        state.apu_snapshot.store(snapshot);
+        state.apu_snapshot_seen = seq;
+        state.apu_snapshot_frame = frame;
+        state.apu_snapshot_time = snapshot.time;
+    }
+    
+    // Play calls are a frame or so apart; run on from the last one in real
+    // time, but not across a gap (silence skipped, a stalled emulator)
+    constexpr double MAX_EXTRAPOLATION = 0.25;
+    double since = static_cast<double>(heard - static_cast<int64_t>(state.apu_snapshot_frame)) / state.sample_rate;
+    state.presentation_time = state.apu_snapshot_time + std::min(since, MAX_EXTRAPOLATION);
+    return true;
+}
+
+// Recording: take every state the active player queued since the last frame,
+// heard or not yet. Ends (keeping what it has) when the channels change.
+// The player's channels from the pitches heard: one per gme voice while
+// per-voice scopes tap them, else the leading pitches of the mix
+static void track_audio_pitch(bool enabled) {
+    state.pitch_feed->setNodes(enabled ? AnalysisGraph::NODE_PITCH : 0);
+    if (!enabled || !state.pitch_feed->acquire()) return;
+    const AnalysisGraph::Frame& frame = state.pitch_feed->frame();
+    if (!(frame.nodes & AnalysisGraph::NODE_PITCH)) return;
+    if (frame.voice_count > 0) {
+        state.pitch_layout = ChannelLayout::buildVoices(gme_voice_names(state.emu), frame.voice_count);
+        state.pitch_snapshot.store(ApuFrameSnapshot::capturePitches(frame.voice_pitches.data(), state.pitch_layout.size(),
+                                                                    state.presentation_time));
+    } else {
+        state.pitch_layout = ChannelLayout::buildPitches(AnalysisGraph::MIX_PITCHES);
+        state.pitch_snapshot.store(ApuFrameSnapshot::capturePitches(frame.mix_pitches.data(), AnalysisGraph::MIX_PITCHES,
+                                                                    state.presentation_time));
+    }
+}
+
+static void record_session(bool nes_mode, const ChannelLayout& layout) {
+    if (state.session_mode != SessionMode::RECORDING || state.session_ended) return;
+    if (nes_mode != state.session_nes || layout != state.session_layout) {
+        state.session_ended = true;
+        return;
+    }
+    const ApuSnapshotQueue& queue = nes_mode ? state.nes_emu.apuSnapshots() : state.apu_snapshots;
+    uint64_t head = queue.head();
+    if (head - state.session_seq > static_cast<uint64_t>(ApuSnapshotQueue::CAPACITY)) {
+        state.session_seq = head - ApuSnapshotQueue::CAPACITY;  // lapped: the oldest are gone
+    }
+    for (; state.session_seq < head; ++state.session_seq) {
+        ApuFrameSnapshot snapshot;
+        uint64_t frame = 0;
+        if (queue.read(state.session_seq, snapshot, &frame)) state.session_log.append(snapshot, frame);
+    }
+}
+
+static void start_session_recording() {
+    bool nes_mode = current_mode == AppMode::NES_EMULATOR;
+    state.session_nes = nes_mode;
+    state.session_layout = nes_mode ? state.nes_channel_layout : state.channel_layout;
+    state.session_log.begin(state.session_layout, state.sample_rate);
+    state.session_ended = false;
+    state.session_seq = (nes_mode ? state.nes_emu.apuSnapshots() : state.apu_snapshots).head();
+    state.session_mode = SessionMode::RECORDING;
+}
+
+static void start_session_replay() {
+    state.session_cursor = SnapshotLog::Cursor();
+    state.session_start = std::chrono::steady_clock::now();
+    state.session_mode = SessionMode::REPLAYING;
+}
+
+static void stop_session_replay() {
+    state.session_mode = SessionMode::OFF;
+    state.session_log.clear();
+    state.apu_snapshot_seen = 0;  // take the player's state again
+    state.apu_snapshot.store(ApuFrameSnapshot());
+}
+
+// Replay: the log's state at the session clock, run on in real time from it
+// like present_heard_audio. Stops after the last entry.
+static void present_session_replay() {
+    const SnapshotLog& log = state.session_log;
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - state.session_start).count();
+    uint64_t frame = static_cast<uint64_t>(elapsed * log.sampleRate());
+    if (frame > log.lengthFrames() + static_cast<uint64_t>(log.sampleRate()) || !log.seek(frame, state.session_cursor)) {
+        stop_session_replay();
+        return;
+    }
+    const SnapshotLog::Cursor& cursor = state.session_cursor;
+    if (cursor.index != state.apu_snapshot_seen) {
+        state.apu_snapshot.store(cursor.snapshot);
+        state.apu_snapshot_seen = cursor.index;
+    }
+    constexpr double MAX_EXTRAPOLATION = 0.25;
+    double since = static_cast<double>(frame - std::min(frame, cursor.session)) / log.sampleRate();
+    state.presentation_time = cursor.snapshot.time + std::min(since, MAX_EXTRAPOLATION);
+}
+
+// Log the playing NSF's sound register writes and keep its chip state at
+// every play call; clocks restart with each track
+static void hook_sound_chips(const ApuTap& tap) {
+    if (!tap.nsf) return;
+    tap.nsf->set_write_hook([](void*, unsigned long long clock, nes_addr_t addr, int data) {
+        state.apu_writes.push(clock, static_cast<uint16_t>(addr), static_cast<uint8_t>(data));
+    }, nullptr);
+    tap.nsf->set_play_hook([](void*, unsigned long long clock, Nsf_Emu&) {
+        // Bounded: gme seldom runs more than a few play calls ahead of a chunk
+        const ApuTap& tap = state.apu_tap;
+        state.nsf_cpu_profiler.frame(tap.nsf, tap.nsf->play_period_clocks());
+        if (state.play_calls.size() >= static_cast<size_t>(ApuSnapshotQueue::CAPACITY)) return;
+        state.play_calls.push_back({clock, ApuFrameSnapshot::capture(*tap.apu, tap.vrc6, tap.fme7, tap.namco, 0.0)});
+    }, nullptr);
+}
+
+// Make the pre-started emulator for 'track' the playing one without touching
+// the ring, so it continues straight after what is queued. The old emulator is
+// parked in retired_track for frame() to free once the visualizer has moved to
+// the new one. False if there is none for that track. Must hold audio_mutex.
+static bool install_prestarted(int track) {
+    if (state.retired_track) return false;
+    std::unique_ptr<LoadedFile> next;
+    {
+        std::lock_guard<std::mutex> lock(state.prestart_mutex);
+        if (!state.prestart_result || state.prestart_result->start_track != track) return false;
+        next = std::move(state.prestart_result);
+    }
+    
+    auto retired = std::make_unique<LoadedFile>();
+    retired->emu = state.emu;
+    retired->voice_buffer = std::move(state.voice_buffer);
+    state.emu = next->emu;
+    state.voice_buffer = std::move(next->voice_buffer);
+    next->emu = nullptr;
+    if (state.voice_buffer) {
+        state.voice_buffer->setVoiceTap([](int voice, const blip_sample_t* samples, long count) {
+            state.analysis.writeVoice(voice, samples, count);
+        });
+    }
+    state.apu_tap = ApuTap::resolve(state.emu);
+    hook_sound_chips(state.apu_tap);
+    state.retired_track = std::move(retired);
+    state.synth_track = track;
+    state.synth_track_ended.store(false);
+    state.gapless_track.store(track);
+    return true;
+}
+
+// Synthesis thread - keeps the ring topped up so the audio callback never runs gme_play
+// Audio threads: follow the real-time setting; 'realtime' belongs to the caller
+static void update_realtime(RealtimeThread& realtime) {
+    bool wanted = state.realtime_audio.load(std::memory_order_relaxed);
+    if (wanted == realtime.active()) return;
+    if (!wanted) {
+        realtime.leave();
+    } else if (!realtime.enter()) {
+        state.realtime_refused.store(true, std::memory_order_relaxed);
+    }
+}
+
+// UI thread: switch real-time audio and pin the ring the callback reads
+static void set_realtime_audio(bool enabled) {
+    state.realtime_refused.store(false, std::memory_order_relaxed);
+    state.realtime_audio.store(enabled, std::memory_order_relaxed);
+    const AudioRing& ring = state.audio_ring;
+    if (enabled && !state.audio_ring_locked) {
+        state.audio_ring_locked = RealtimeThread::lockMemory(ring.storage(), ring.storageBytes());
+    } else if (!enabled && state.audio_ring_locked) {
+        RealtimeThread::unlockMemory(ring.storage(), ring.storageBytes());
+        state.audio_ring_locked = false;
+    }
+}
+
+static void synthesis_thread_func() {
+    FC_TRACE_THREAD("synthesis");
+    RealtimeThread realtime;
+    bool batch_filling = false;
+    while (state.synth_running.load()) {
+        update_realtime(realtime);
+        ThreadPlacement::update(ThreadRole::SYNTHESIS);
+        bool produced = false;
+        // Roll over into the pre-started next track as soon as this one ends
+        if (state.is_playing.load() && state.synth_track_ended.load()) {
+            std::lock_guard<std::mutex> lock(audio_mutex);
+            if (state.emu && state.is_playing.load() && state.synth_track_ended.load()) {
+                install_prestarted(state.synth_track + 1);
+            }
+        }
+        
+        // Frames still to be heard; a flush the callback has not applied yet
+        // already counts as gone
+        uint64_t write_pos = state.audio_ring.writePosition();
+        uint64_t live_from = std::max(state.audio_ring.readPosition(), state.ring_flush_pos.load(std::memory_order_acquire));
+        int queued = write_pos > live_from ? static_cast<int>(write_pos - live_from) : 0;
+        int target = state.synth_target_frames.load();
+        bool batching = state.synth_batching.load(std::memory_order_relaxed);
+        int refill = static_cast<int>(BATCH_REFILL_SECONDS * state.sample_rate);
+        if (batching) {
+            int ahead = std::min(static_cast<int>(BATCH_AHEAD_SECONDS * state.sample_rate),
+                                 AUDIO_RING_FRAMES - 2 * SYNTH_CHUNK_FRAMES);
+            if (queued < refill) batch_filling = true;
+            if (queued >= ahead) batch_filling = false;
+            if (batch_filling) target = std::max(target, ahead);
+        } else {
+            batch_filling = false;
+        }
+        
+        bool wanted = queued < target || state.seek_request.load() >= 0 || state.loop_request.load();
+        if (state.is_playing.load() && !state.synth_track_ended.load() && wanted &&
+            state.audio_ring.space() >= SYNTH_CHUNK_FRAMES) {
+            std::lock_guard<std::mutex> lock(audio_mutex);
+            if (state.emu && state.is_playing.load()) {
+                RealtimeScope realtime_scope("synthesis");
+                synthesize_chunk();
+                produced = true;
+            }
+        }
+        if (!produced) {
+            // Between batches sleep until the queue is down to the refill mark
+            std::chrono::microseconds sleep = std::chrono::milliseconds(2);
+            if (batching && state.is_playing.load() && queued > refill) {
+                sleep = std::max(sleep, std::min<std::chrono::microseconds>(
+                    std::chrono::microseconds(static_cast<int64_t>(queued - refill) * 1000000 / state.sample_rate),
+                    BATCH_MAX_SLEEP));
+            }
+            std::unique_lock<std::mutex> lock(state.synth_wake_mutex);
+            state.synth_wake.wait_for(lock, sleep, [] { return state.synth_wake_pending; });
+            state.synth_wake_pending = false;
+        }
+    }
+}
+
+// Smoothed queue depth at the start of each callback; queue + device buffer is the output latency
+static void record_queue_depth(int queued_frames) {
+    float avg = state.queued_frames_avg.load(std::memory_order_relaxed);
+    state.queued_frames_avg.store(avg + 0.1f * (queued_frames - avg), std::memory_order_relaxed);
+}
+
+// Audio thread only: fades the frames that were queued when a seek flushed the
+// ring out while the new position fades in, so seeking doesn't click
+struct SeekCrossfade {
+    static constexpr int FRAMES = 256;  // ~6 ms
+    float stale[FRAMES * 2];
+    int stale_frames = 0;
+    int pos = FRAMES;  // FRAMES when no fade is running
+    
+    // Take up to FRAMES of the stale audio before it is discarded
+    void begin(AudioRing& ring, uint64_t flush_pos) {
+        uint64_t read_pos = ring.readPosition();
+        int pending = flush_pos > read_pos ? static_cast<int>(flush_pos - read_pos) : 0;
+        stale_frames = ring.read(stale, std::min(pending, FRAMES));
+        pos = 0;
+    }
+    
+    void apply(float* buffer, int num_frames) {
+        for (int i = 0; i < num_frames && pos < FRAMES; ++i, ++pos) {
+            float gain_in = pos / static_cast<float>(FRAMES);
+            float gain_out = pos < stale_frames ? 1.0f - pos / static_cast<float>(stale_frames) : 0.0f;
+            buffer[i * 2] = buffer[i * 2] * gain_in + stale[pos * 2] * gain_out;
+            buffer[i * 2 + 1] = buffer[i * 2 + 1] * gain_in + stale[pos * 2 + 1] * gain_out;
+        }
+    }
+};
+
 // Audio stream callback - called from audio thread
 void audio_stream_callback(float* buffer, int num_frames, int num_channels, void* user_data) {
     const int num_samples = num_frames * num_channels;
+    [[maybe_unused]] static thread_local bool trace_named = (FC_TRACE_THREAD("audio"), true);
+    static thread_local RealtimeThread realtime;
+    update_realtime(realtime);
+    ThreadPlacement::update(ThreadRole::AUDIO);
+    PROFILE_STAGE(AudioCallback);
+    RealtimeScope realtime_scope("audio callback");  // within the stage, whose first sample registers a ring
+    if (Profiler::enabled()) {
+        Profiler::setBudget(ProfileStage::AudioCallback, num_frames * 1000000000ll / state.sample_rate);
+    }
     
     // Handle NES Emulator mode
     if (current_mode == AppMode::NES_EMULATOR && state.nes_emu.isRunning()) {
-        static std::vector<short> nes_temp_buffer;
+        int queued = static_cast<int>(state.nes_emu.samplesAvailable());
+        record_queue_depth(queued);
         
-        // NES APU outputs mono, we need num_frames mono samples
-        nes_temp_buffer.resize(num_frames);
-        
-        // Read audio samples from emulator (mono)
-        int samples_read = state.nes_emu.readAudioSamples(nes_temp_buffer.data(), num_frames);
+        // NES APU outputs mono; expand it to stereo float in place a block at a time
+        constexpr int BLOCK = 512;
+        short mono[BLOCK];
+        int frames_read = 0;
+        uint64_t read_pos = 0;
+        while (frames_read < num_frames) {
+            int wanted = std::min(BLOCK, num_frames - frames_read);
+            int n = state.nes_emu.readAudioSamples(mono, wanted, frames_read == 0 ? &read_pos : nullptr);
+            float* out = buffer + frames_read * 2;
+            for (int i = 0; i < n; ++i) {
+                float sample = mono[i] * (1.0f / 32768.0f);
+                out[i * 2] = sample;      // Left channel
+                out[i * 2 + 1] = sample;  // Right channel
+            }
+            frames_read += n;
+            if (n < wanted) break;
+        }
         
         // If we got fewer samples than needed, fill the rest with silence
-        for (int i = samples_read; i < num_frames; ++i) {
-            nes_temp_buffer[i] = 0;
+        std::fill(buffer + frames_read * 2, buffer + num_samples, 0.0f);
+        state.nes_audio_clock.store({read_pos, frames_read, steady_now_ns()});
+        state.audio_telemetry.record(num_frames, frames_read, queued, state.sample_rate);
+        
+        // The visualizer sees the signal before volume
+        state.analysis.write(buffer, num_samples);
+        
+        float gain = state.volume_gain.load(std::memory_order_relaxed);
+        for (int i = 0; i < num_samples; ++i) {
+            buffer[i] *= gain;
+        }
+        state.latency_probe.emit(buffer, num_frames, num_channels);
+        return;
+    }
+    
+    // Handle NSF Player mode - only copy out of the ring filled by the synthesis thread
+    static SeekCrossfade crossfade;
+    static uint64_t last_flush_pos = 0;
+    uint64_t flush_pos = state.ring_flush_pos.load(std::memory_order_acquire);
+    if (flush_pos != last_flush_pos) {
+        last_flush_pos = flush_pos;
+        if (flush_pos == state.ring_fade_pos.load(std::memory_order_relaxed)) {
+            crossfade.begin(state.audio_ring, flush_pos);
+        }
+    }
+    state.audio_ring.discardUntil(flush_pos);
+    
+    // Scrubbing is heard even while paused; the ring waits for the release's seek
+    if (state.scrub.read(buffer, num_frames)) {
+        state.audio_telemetry.markIdle();
+        float gain = state.volume_gain.load(std::memory_order_relaxed) * state.track_gain.load(std::memory_order_relaxed);
+        for (int i = 0; i < num_samples; i++) {
+            buffer[i] *= gain;
+        }
+        state.latency_probe.emit(buffer, num_frames, num_channels);
+        return;
+    }
+    
+    if (!state.is_playing.load()) {
+        // Fill with silence
+        std::fill(buffer, buffer + num_samples, 0.0f);
+        state.audio_telemetry.markIdle();
+        state.latency_probe.emit(buffer, num_frames, num_channels);
+        return;
+    }
+    
+    int queued = state.audio_ring.available();
+    record_queue_depth(queued);
+    uint64_t read_pos = state.audio_ring.readPosition();
+    int frames_read = state.audio_ring.read(buffer, num_frames);
+    state.audio_clock.store({read_pos, frames_read, steady_now_ns()});
+    // Running dry after the end of the track is expected, not a glitch
+    bool track_ended = state.synth_track_ended.load();
+    if (frames_read < num_frames) {
+        if (!track_ended) {
+            state.audio_underruns.fetch_add(1, std::memory_order_relaxed);
+        }
+        std::fill(buffer + frames_read * num_channels, buffer + num_samples, 0.0f);
+    }
+    if (track_ended) {
+        state.audio_telemetry.markIdle();
+    } else {
+        state.audio_telemetry.record(num_frames, frames_read, queued, state.sample_rate);
+    }
+    crossfade.apply(buffer, num_frames);
+    
+    // Apply volume control, with the track's loudness normalization folded in
+    float gain = state.volume_gain.load(std::memory_order_relaxed) * state.track_gain.load(std::memory_order_relaxed);
+    for (int i = 0; i < num_samples; i++) {
+        buffer[i] *= gain;
+    }
+    // A latency probe's chirp goes out after volume, so it is heard even muted
+    state.latency_probe.emit(buffer, num_frames, num_channels);
+}
+
+// Capture callback, only while a latency measurement has the device open
+static void latency_capture_callback(const float* buffer, int num_frames, int num_channels, void* user_data) {
+    state.latency_probe.capture(buffer, num_frames, num_channels);
+}
+
+// Cancel any running piano preprocessing and wait for the worker to let go of the piano
+void cancel_preprocessing() {
+    if (state.preprocess_job) {
+        state.preprocess_job->cancel();
+        state.preprocess_job->wait();
+        state.preprocess_job.reset();
+    }
+    state.preprocessing.store(false);
+    
+    if (state.waveform_job) {
+        state.waveform_job->cancel();
+        state.waveform_job->wait();
+        state.waveform_job.reset();
+    }
+    std::lock_guard<std::mutex> lock(state.waveform_mutex);
+    state.waveform.reset();
+    state.spectrogram.reset();
+}
+
+// The library's record of a track, false if the file is not indexed
+static bool library_track(std::string_view path, int track, NsfLibrary::Track& out) {
+    NsfLibrary::Snapshot catalog = state.library.snapshot();
+    const NsfLibrary::Entry* entry = NsfLibrary::find(*catalog, path);
+    if (!entry || track < 0 || track >= static_cast<int>(entry->tracks.size())) return false;
+    out = entry->tracks[track];
+    return true;
+}
+
+// Fade a just-started track out where the library found its end, so it ends
+// on time instead of when gme's silence detection gives up
+static void apply_track_end(Music_Emu* emu, const std::string& path, int track) {
+    NsfLibrary::Track info;
+    if (library_track(path, track, info) && info.length_ms > 0 && info.fade_ms > 0) {
+        emu->set_fade(info.length_ms, info.fade_ms);
+    }
+}
+
+// Length the seek bar spans, in ms
+static long track_length_msec(Music_Emu* emu, int track) {
+    track_info_t info;
+    long length = 0;
+    if (gme_track_info(emu, &info, track) == nullptr) length = info.length;
+    NsfLibrary::Track indexed;
+    if (library_track(state.loaded_file, track, indexed) && indexed.length_ms > 0) {
+        length = indexed.length_ms + std::max(indexed.fade_ms, 0);
+    }
+    if (length <= 0) length = 150000; // Default 2:30 if unknown
+    return length;
+}
+
+// Load the current track's waveform peaks and spectrogram from the cache, or
+// play the track once in an emulator of its own to compute and cache them
+void load_track_waveform() {
+    std::shared_ptr<MusicEmuPool> pool = state.emu_pool;
+    if (!pool) return;
+    int track = state.current_track;
+    long length = track_length_msec(state.emu, track);
+    
+    state.waveform_job = state.jobs.submit([pool, track, length](const Job& job) {
+        MemoryScope memory(MemoryTag::Caches);
+        NoteCache::Key cache_key;
+        cache_key.content_hash = pool->contentHash();
+        cache_key.track = track;
+        cache_key.sample_rate = pool->sampleRate();
+        
+        auto peaks = std::make_shared<WaveformPeaks>();
+        auto spectrogram = std::make_shared<TrackSpectrogram>();
+        bool have_peaks = NoteCache::loadPeaks(cache_key, *peaks);
+        bool have_spectrogram = NoteCache::loadSpectrogram(cache_key, *spectrogram);
+        if (!have_peaks || !have_spectrogram) {
+            // One playback for both; the spectrogram reads every chunk the peaks do
+            MusicEmuPool::Lease emu = pool->acquire();
+            if (!emu) return;
+            spectrogram->begin(pool->sampleRate());
+            bool ok = peaks->render(emu.get(), track, pool->sampleRate(), length / 1000.0f,
+                                    [&job]() { return job.isCancelled(); },
+                                    [&spectrogram](const short* stereo, int frames) { spectrogram->add(stereo, frames); });
+            if (!ok) return;
+            spectrogram->finish();
+            if (!have_peaks) NoteCache::storePeaks(cache_key, *peaks);
+            if (!have_spectrogram) NoteCache::storeSpectrogram(cache_key, *spectrogram);
         }
         
-        // Update visualizer with audio data (convert mono to stereo for visualizer)
-        static std::vector<short> stereo_buffer;
-        stereo_buffer.resize(num_samples);
-        for (int i = 0; i < num_frames; ++i) {
-            stereo_buffer[i * 2] = nes_temp_buffer[i];
-            stereo_buffer[i * 2 + 1] = nes_temp_buffer[i];
-        }
-        state.visualizer.updateAudioData(stereo_buffer.data(), num_samples);
+        std::lock_guard<std::mutex> lock(state.waveform_mutex);
+        state.waveform = std::move(peaks);
+        state.spectrogram = std::move(spectrogram);
+    }, JobPriority::INTERACTIVE, "Waveform");
+}
+
+// Hand a track finished by the album preprocessor to the piano, if there is one
+bool take_album_notes(int track) {
+    std::lock_guard<std::mutex> lock(state.album_mutex);
+    if (track < 0 || track >= static_cast<int>(state.album_notes.size())) return false;
+    
+    const AlbumTrackNotes& entry = state.album_notes[track];
+    if (!entry.ready) return false;
+    
+    MemoryScope memory(MemoryTag::Notes);
+    state.piano.setPreprocessedNotes(entry.notes, entry.duration);
+    state.preprocess_progress.store(1.0f);
+    return true;
+}
+
+// Preprocess current track for piano visualization on a worker thread.
+// Playback does not wait for this; the roll appears once the job publishes.
+void preprocess_piano_track() {
+    if (!state.emu || !state.emu_pool) return;
+    
+    cancel_preprocessing();
+    load_track_waveform();
+    set_ab_loop(-1, -1);
+    state.scrub.prepare(state.emu_pool, state.current_track, track_length_msec(state.emu, state.current_track));
+    
+    // Already done by the album preprocessor - switching is instant
+    if (take_album_notes(state.current_track)) return;
+    
+    state.preprocessing.store(true);
+    state.preprocess_progress.store(0.0f);
+    
+    std::shared_ptr<MusicEmuPool> pool = state.emu_pool;
+    int track = state.current_track;
+    
+    state.preprocess_job = state.jobs.submit([pool, track](const Job& job) {
+        MemoryScope memory(MemoryTag::Notes);
+        // Revisited tracks come straight from the on-disk note cache
+        NoteCache::Key cache_key;
+        cache_key.content_hash = pool->contentHash();
+        cache_key.track = track;
+        cache_key.sample_rate = pool->sampleRate();
         
-        // Update piano visualizer and channel levels with APU data
-        int periods[5], lengths[5], amplitudes[5];
-        state.nes_emu.getApuState(periods, lengths, amplitudes);
-        state.visualizer.updateChannelAmplitudesFromAPU(amplitudes, lengths);
-        float current_time = static_cast<float>(state.nes_emu.getCpuCycles()) / 1789773.0f;
-        state.piano.updateFromAPU(periods, lengths, amplitudes, current_time);
+        NoteTimeline cached;
+        float cached_duration = 0.0f;
+        if (NoteCache::load(cache_key, cached, cached_duration)) {
+            state.piano.setPreprocessedNotes(std::move(cached), cached_duration);
+            state.preprocessing.store(false);
+            state.preprocess_progress.store(1.0f);
+            return;
+        }
         
-        // VRC6 expansion support for NES emulator
-        if (state.nes_emu.hasVRC6()) {
-            state.visualizer.setVRC6Enabled(true);
-            state.piano.setVRC6Enabled(true);
-            
-            int vrc6_periods[3], vrc6_volumes[3];
-            bool vrc6_enabled[3];
-            state.nes_emu.getVRC6State(vrc6_periods, vrc6_volumes, vrc6_enabled);
-            
-            int vrc6_amplitudes[3];
-            for (int i = 0; i < 3; ++i) {
-                vrc6_amplitudes[i] = vrc6_enabled[i] ? vrc6_volumes[i] : 0;
-            }
-            state.visualizer.updateVRC6ChannelAmplitudes(vrc6_amplitudes);
-            state.piano.updateFromVRC6(vrc6_periods, vrc6_volumes, vrc6_enabled, current_time);
+        // An emulator of the job's own, left in the pool for the next track
+        MusicEmuPool::Lease preprocess_emu = pool->acquire();
+        if (!preprocess_emu) {
+            state.preprocessing.store(false);
+            return;
+        }
+        
+        // NSF files take the synthesis-free register trace path
+        auto on_progress = [&job](float progress) {
+            state.preprocess_progress.store(progress);
+            job.setProgress(progress);
+        };
+        auto is_cancelled = [&job]() { return job.isCancelled(); };
+        
+        bool ok = false;
+        ApuTap tap = ApuTap::resolve(preprocess_emu.get());
+        if (tap.nsf) {
+            ok = state.piano.preprocessNsfTrace(tap.nsf, track, on_progress, is_cancelled);
         } else {
-            state.visualizer.setVRC6Enabled(false);
-            state.piano.setVRC6Enabled(false);
+            ok = state.piano.preprocessTrack(preprocess_emu.get(), track, pool->sampleRate(),
+                                             tap, on_progress, is_cancelled);
+        }
+        preprocess_emu.reset();
+        
+        if (ok) {
+            std::vector<PianoRollNote> notes;
+            std::vector<uint8_t> envelopes;
+            float duration = 0.0f;
+            NoteLoop loop;
+            if (state.piano.getPreprocessedNotes(notes, envelopes, duration, &loop)) {
+                NoteCache::store(cache_key, notes, envelopes, duration, loop);
+            }
+        }
+        
+        state.preprocessing.store(false);
+        if (ok) {
+            state.preprocess_progress.store(1.0f);
+        }
+    }, JobPriority::INTERACTIVE, "Piano roll");
+}
+
+// Cancel all album preprocessing jobs and drop their results
+void cancel_album_preprocess() {
+    for (auto& job : state.album_jobs) {
+        job->cancel();
+    }
+    for (auto& job : state.album_jobs) {
+        job->wait();
+    }
+    state.album_jobs.clear();
+    
+    std::lock_guard<std::mutex> lock(state.album_mutex);
+    state.album_notes.clear();
+    state.album_ready_count.store(0);
+}
+
+// Album worker: one emulator from the pool per running job
+static void album_preprocess_track(MusicEmuPool& pool, int track, const Job& job) {
+    MemoryScope memory(MemoryTag::Notes);
+    NoteCache::Key cache_key;
+    cache_key.content_hash = pool.contentHash();
+    cache_key.track = track;
+    cache_key.sample_rate = pool.sampleRate();
+    
+    // Kept packed until the track is played, so a whole album stays small
+    NoteTimeline timeline;
+    float duration = 0.0f;
+    bool ok = NoteCache::load(cache_key, timeline, duration);
+    
+    if (!ok) {
+        MusicEmuPool::Lease emu = pool.acquire();
+        if (!emu) return;
+        
+        // Scratch visualizer: only used for its note extraction
+        PianoVisualizer extractor;
+        extractor.setIncrementalPreprocessing(false);
+        if (Nsf_Emu* nsf = dynamic_cast<Nsf_Emu*>(emu.get())) {
+            ok = extractor.preprocessNsfTrace(nsf, track, nullptr, [&job]() { return job.isCancelled(); });
         }
+        emu.reset();
         
-        // Convert mono to stereo float output
-        float volume_linear = std::pow(10.0f, state.volume_db / 20.0f);
-        for (int i = 0; i < num_frames; ++i) {
-            float sample = (nes_temp_buffer[i] / 32768.0f) * volume_linear;
-            buffer[i * 2] = sample;      // Left channel
-            buffer[i * 2 + 1] = sample;  // Right channel
+        std::vector<PianoRollNote> notes;
+        std::vector<uint8_t> envelopes;
+        NoteLoop loop;
+        if (ok) ok = extractor.getPreprocessedNotes(notes, envelopes, duration, &loop);
+        if (ok) {
+            NoteCache::store(cache_key, notes, envelopes, duration, loop);
+            timeline.assign(std::move(notes), envelopes);
+            timeline.setLoop(loop);
         }
+    }
+    
+    if (!ok || job.isCancelled()) return;
+    
+    std::lock_guard<std::mutex> lock(state.album_mutex);
+    if (track < static_cast<int>(state.album_notes.size())) {
+        AlbumTrackNotes& entry = state.album_notes[track];
+        entry.notes = std::move(timeline);
+        entry.duration = duration;
+        entry.ready = true;
+        state.album_ready_count.fetch_add(1);
+    }
+}
+
+// Preprocess every other track of the loaded file in the background,
+// nearest upcoming tracks first (the current track has its own job)
+void start_album_preprocess() {
+    cancel_album_preprocess();
+    if (!state.album_preprocess || !state.emu || !state.emu_pool || state.track_count <= 1) return;
+    std::shared_ptr<MusicEmuPool> pool = state.emu_pool;
+    
+    {
+        std::lock_guard<std::mutex> lock(state.album_mutex);
+        state.album_notes.assign(state.track_count, AlbumTrackNotes());
+    }
+    
+    for (int i = 1; i < state.track_count; ++i) {
+        int track = (state.current_track + i) % state.track_count;
+        state.album_jobs.push_back(state.jobs.submit([pool, track](const Job& job) {
+            album_preprocess_track(*pool, track, job);
+        }, JobPriority::BATCH, "Album notes"));
+    }
+}
+
+void finish_gapless_switch(bool follow = true);
+
+// Safe track start - can be called from UI thread. A track that has been
+// pre-started is swapped in rather than started here.
+void safe_start_track(int track) {
+    if (!state.emu) return;
+    finish_gapless_switch(false);  // frees retired_track for this swap
+    
+    // Request the audio thread to start the track
+    state.is_playing.store(false);  // Pause playback
+    
+    std::lock_guard<std::mutex> lock(audio_mutex);
+    state.seek_request.store(-1);  // Clear any pending seek
+    if (!install_prestarted(track)) {
+        gme_start_track(state.emu, track);
+        apply_track_end(state.emu, state.loaded_file, track);
+        state.synth_track = track;
+    }
+    state.play_calls.clear();  // skipped initial silence
+    flush_audio_ring();
+    state.synth_track_ended.store(false);
+    state.is_playing.store(true);  // Resume playback
+}
+
+// Open a music file off the UI thread. With voice scopes a VoiceScopeBuffer is
+// installed first, so every voice renders to its own Blip_Buffer and feeds the
+// visualizer's voice scopes.
+static void open_music_file(LoadedFile& out, bool voice_scopes, std::shared_ptr<MusicEmuPool> pool = nullptr) {
+    MemoryScope memory(MemoryTag::Emulation);
+    if (!pool) pool = MusicEmuPool::open(out.path.c_str(), state.sample_rate);
+    if (!pool) {
+        out.error = "Couldn't open file";
         return;
     }
+    out.pool = pool;
+    const MappedFile& file = *pool->data();
     
-    // Handle NSF Player mode
-    if (!state.emu || !state.is_playing.load()) {
-        // Fill with silence
-        std::fill(buffer, buffer + num_samples, 0.0f);
+    if (!voice_scopes) {
+        gme_err_t err = open_mapped(out.path.c_str(), file, &out.emu, state.sample_rate);
+        if (err) out.error = err;
         return;
     }
     
-    std::lock_guard<std::mutex> lock(audio_mutex);
+    gme_type_t type = identify_mapped(out.path.c_str(), file);
+    if (!type) {
+        out.error = gme_wrong_file_type;
+        return;
+    }
     
-    // Process seek request if any
-    long seek_pos = state.seek_request.exchange(-1);
-    if (seek_pos >= 0 && state.emu) {
-        gme_seek(state.emu, seek_pos);
+    Music_Emu* emu = type->new_emu();
+    if (!emu) {
+        out.error = "Out of memory";
+        return;
     }
     
-    // Game_Music_Emu generates 16-bit signed samples (stereo)
-    static std::vector<short> temp_buffer;
-    temp_buffer.resize(num_samples);
+    // The buffer has to be in place before the sample rate is set
+    if (Classic_Emu* classic = dynamic_cast<Classic_Emu*>(emu)) {
+        out.voice_buffer = std::make_unique<VoiceScopeBuffer>();
+        out.voice_buffer->setVoiceTap([](int voice, const blip_sample_t* samples, long count) {
+            state.analysis.writeVoice(voice, samples, count);
+        });
+        classic->set_buffer(out.voice_buffer.get());
+    }
     
-    // Generate samples from Game_Music_Emu
-    gme_err_t err = gme_play(state.emu, num_samples, temp_buffer.data());
+    gme_err_t err = emu->set_sample_rate(state.sample_rate);
+    if (!err) err = gme_load_data(emu, file.data(), static_cast<long>(file.size()));
     if (err) {
-        std::fill(buffer, buffer + num_samples, 0.0f);
+        gme_delete(emu);
+        out.voice_buffer.reset();
+        out.error = err;
         return;
     }
+    out.emu = emu;
+}
+
+// Drop the pre-started track. Without wait a job that is still starting its
+// track runs on and throws the result away, so skipping tracks never blocks.
+void cancel_prestart(bool wait = true) {
+    if (state.prestart_job) {
+        state.prestart_job->cancel();
+        if (wait) state.prestart_job->wait();
+        state.prestart_job.reset();
+    }
+    state.prestart_path.clear();
+    state.prestart_track = -1;
+    std::lock_guard<std::mutex> lock(state.prestart_mutex);
+    state.prestart_generation++;
+    state.prestart_result.reset();
+}
+
+// Open the loaded file again on a worker and start the track after the current
+// one, so install_prestarted() can swap it in when the current one ends
+void prestart_next_track() {
+    int track = state.current_track + 1;
+    if (!state.gapless || !state.emu || track >= state.track_count) {
+        cancel_prestart(false);
+        return;
+    }
+    if (state.prestart_track == track && state.prestart_path == state.loaded_file) return;
+    cancel_prestart(false);
+    
+    uint32_t generation;
+    {
+        std::lock_guard<std::mutex> lock(state.prestart_mutex);
+        generation = state.prestart_generation;
+    }
+    state.prestart_path = state.loaded_file;
+    state.prestart_track = track;
+    bool voice_scopes = state.voice_scopes;
+    float tempo = state.tempo;
+    int mute_mask = state.visualizer.getMuteMask();
+    std::string path = state.loaded_file;
+    std::shared_ptr<MusicEmuPool> pool = state.emu_pool;  // parsed from memory, not read again
+    state.prestart_job = state.jobs.submit([path, track, voice_scopes, tempo, mute_mask, generation, pool](const Job& job) {
+        auto file = std::make_unique<LoadedFile>();
+        file->path = path;
+        file->start_track = track;
+        open_music_file(*file, voice_scopes, pool);
+        if (!file->emu || job.isCancelled()) return;
+        
+        // Voice scopes stay quiet until it is the playing emulator
+        if (file->voice_buffer) file->voice_buffer->setVoiceTap(nullptr);
+        gme_set_tempo(file->emu, tempo);
+        gme_mute_voices(file->emu, mute_mask);
+        if (gme_start_track(file->emu, track) || job.isCancelled()) return;
+        apply_track_end(file->emu, path, track);
+        
+        std::lock_guard<std::mutex> lock(state.prestart_mutex);
+        if (state.prestart_generation == generation) {
+            state.prestart_result = std::move(file);
+        }
+    }, JobPriority::INTERACTIVE, "Gapless pre-start");
+}
+
+// Catch the UI up with a track install_prestarted() swapped in, free the old
+// emulator and pre-start the one after it. Without follow only the emulator
+// side is settled, for a caller that is about to pick the track itself.
+void finish_gapless_switch(bool follow) {
+    int track = state.gapless_track.exchange(-1);
+    if (track < 0) return;
+    
+    std::unique_ptr<LoadedFile> retired;
+    {
+        std::lock_guard<std::mutex> lock(audio_mutex);
+        retired = std::move(state.retired_track);
+        state.analysis.setSampleRate(state.sample_rate);
+        state.analysis.reset();
+        state.visualizer.init(state.emu);
+        state.channel_layout = state.apu_tap.layout();
+        gme_set_tempo(state.emu, state.tempo);
+        gme_mute_voices(state.emu, state.visualizer.getMuteMask());
+    }
+    retired.reset();
+    if (!follow) return;
+    
+    // A switch made by safe_start_track() already has its track set up
+    if (state.current_track != track) {
+        state.current_track = track;
+        preprocess_piano_track();
+    }
+    prestart_next_track();
+}
+
+// Start track and preprocess for piano
+void start_track_with_preprocess(int track) {
+    state.current_track = track;
+    
+    // Kick off preprocessing in the background (uses a separate emulator)
+    preprocess_piano_track();
+    
+    // Start playback right away, then get the following track ready
+    safe_start_track(track);
+    prestart_next_track();
+}
+
+// NesEmulator swaps the ROM in under its own mutex, between two emulated frames
+static void open_nes_rom(LoadedFile& out) {
+    if (!state.nes_emu.loadROM(out.path.c_str())) {
+        out.error = "Failed to load NES ROM";
+    }
+}
+
+#ifndef __EMSCRIPTEN__
+// NFD is set up by the first dialog rather than at startup, as it loads GTK
+// or COM. The main thread's setup is kept until cleanup; the portal backend
+// has one D-Bus connection for every thread, so it is that one there too.
+static std::once_flag nfd_once;
+static std::atomic<bool> nfd_initialized{false};
+
+static void init_main_nfd() {
+    std::call_once(nfd_once, [] {
+        PROFILE_STARTUP("Native File Dialog");
+        nfd_initialized.store(NFD_Init() == NFD_OKAY);
+    });
+}
+
+static void quit_main_nfd() {
+    if (nfd_initialized.exchange(false)) NFD_Quit();
+}
+
+// Dialog threads set NFD up for themselves (a COM apartment each on Windows)
+struct DialogThreadNfd {
+#ifndef NFD_PORTAL
+    DialogThreadNfd() { NFD_Init(); }
+    ~DialogThreadNfd() { NFD_Quit(); }
+#else
+    DialogThreadNfd() { init_main_nfd(); }
+#endif
+    DialogThreadNfd(const DialogThreadNfd&) = delete;
+    DialogThreadNfd& operator=(const DialogThreadNfd&) = delete;
+};
+
+// Blocking native open dialog; false if the user cancelled
+static bool show_open_dialog(LoadKind kind, std::string& out_path) {
+    nfdu8filteritem_t filterItem[2];
+    if (kind == LoadKind::MUSIC) {
+        filterItem[0].name = "NES Sound Files";
+        filterItem[0].spec = "nsf,nsfe,zip";
+    } else {
+        filterItem[0].name = "NES ROM Files";
+        filterItem[0].spec = "nes";
+    }
+    filterItem[1].name = "All Files";
+    filterItem[1].spec = "*";
     
-    // Update visualizer with audio data
-    state.visualizer.updateAudioData(temp_buffer.data(), num_samples);
-    
-    // Update playback time
-    float current_time = gme_tell(state.emu) / 1000.0f;
-    state.playback_time.store(current_time);
-    
-    // Update piano visualizer and channel levels with APU data
-    // Try to get APU data directly from Nsf_Emu
-    Nsf_Emu* nsf = dynamic_cast<Nsf_Emu*>(state.emu);
-    if (nsf) {
-        Nes_Apu* apu = nsf->apu_();
-        if (apu) {
-            int periods[5], lengths[5], amplitudes[5];
-            for (int i = 0; i < 5; ++i) {
-                periods[i] = apu->osc_period(i);
-                lengths[i] = apu->osc_length(i);
-                amplitudes[i] = apu->osc_amplitude(i);
+    nfdu8char_t* outPath = nullptr;
+    if (NFD_OpenDialogU8(&outPath, filterItem, 2, nullptr) != NFD_OKAY) {
+        return false;
+    }
+    out_path = outPath;
+    NFD_FreePathU8(outPath);
+    return true;
+}
+#endif
+
+// Open a file without stalling frame(): the dialog (when no path is given),
+// file parsing and emulator construction all run on the loader thread, and
+// install_loaded_file() swaps the result in at the start of a later frame.
+// Ignored (false) while another load is in flight. start_track >= 0 plays
+// that track of a music file as soon as it is installed.
+bool request_load(LoadKind kind, const char* path = nullptr, int start_track = -1) {
+    if (state.loader_busy.exchange(true)) return false;
+    if (state.loader_thread.joinable()) {
+        state.loader_thread.join();
+    }
+    
+    std::string chosen = path ? path : "";
+#ifdef __APPLE__
+    // AppKit panels can only run on the main thread
+    if (chosen.empty()) init_main_nfd();
+    if (chosen.empty() && !show_open_dialog(kind, chosen)) {
+        state.loader_busy.store(false);
+        return true;
+    }
+#elif defined(__EMSCRIPTEN__)
+    // The page's picker answers later, from the browser's event loop
+    if (chosen.empty()) {
+        state.loader_busy.store(false);
+        WebFiles::pick(kind == LoadKind::MUSIC ? ".nsf,.nsfe,.zip" : ".nes",
+                       [kind, start_track](const std::string& picked) {
+                           request_load(kind, picked.c_str(), start_track);
+                       });
+        return true;
+    }
+#endif
+    
+    bool voice_scopes = state.voice_scopes;
+    state.loader_thread = std::thread([kind, chosen, voice_scopes, start_track]() mutable {
+#ifndef __EMSCRIPTEN__
+        if (chosen.empty()) {
+            bool ok;
+            {
+                DialogThreadNfd nfd;
+                ok = show_open_dialog(kind, chosen);
+            }
+            if (!ok) {
+                state.loader_busy.store(false);
+                return;
             }
-            state.visualizer.updateChannelAmplitudesFromAPU(amplitudes, lengths);
-            state.piano.updateFromAPU(periods, lengths, amplitudes, current_time);
         }
+#endif
         
-        // VRC6 expansion chip support
-        Nes_Vrc6_Apu* vrc6 = nsf->vrc6_();
-        if (vrc6) {
-            // Enable VRC6 mode in visualizers
-            state.visualizer.setVRC6Enabled(true);
-            state.piano.setVRC6Enabled(true);
-            
-            // Get VRC6 channel data
-            int vrc6_amplitudes[3];
-            int vrc6_periods[3];
-            int vrc6_volumes[3];
-            bool vrc6_enabled[3];
-            for (int i = 0; i < 3; ++i) {
-                vrc6_periods[i] = vrc6->osc_period(i);
-                vrc6_amplitudes[i] = vrc6->osc_amplitude(i);
-                vrc6_volumes[i] = vrc6->osc_volume(i);
-                vrc6_enabled[i] = vrc6->osc_enabled(i);
-            }
-            state.visualizer.updateVRC6ChannelAmplitudes(vrc6_amplitudes);
-            state.piano.updateFromVRC6(vrc6_periods, vrc6_volumes, vrc6_enabled, current_time);
+        if (kind == LoadKind::MUSIC && ZipArchive::isArchive(chosen)) {
+            // A whole set: queue its members, the first of them starts
+            state.play_queue.add({chosen}, state.jobs, true);
+            state.loader_busy.store(false);
+            return;
+        }
+
+        auto file = std::make_unique<LoadedFile>();
+        file->kind = kind;
+        file->path = chosen;
+        file->start_track = start_track;
+        if (kind == LoadKind::MUSIC) {
+            open_music_file(*file, voice_scopes);
         } else {
-            state.visualizer.setVRC6Enabled(false);
-            state.piano.setVRC6Enabled(false);
+            open_nes_rom(*file);
+        }
+        
+        std::lock_guard<std::mutex> lock(state.loader_mutex);
+        state.loader_result = std::move(file);
+    });
+    return true;
+}
+
+// Play the first playable file of a drop once its header has been read; a
+// load still in flight is waited out
+void start_queued_file() {
+    std::string path;
+    if (state.play_queue.startCandidate(path) && request_load(LoadKind::MUSIC, path.c_str(), 0)) {
+        state.play_queue.startTaken();
+    }
+}
+
+#ifndef __EMSCRIPTEN__
+// Blocking native folder dialog; false if the user cancelled
+static bool show_folder_dialog(std::string& out_path) {
+    nfdu8char_t* outPath = nullptr;
+    if (NFD_PickFolderU8(&outPath, nullptr) != NFD_OKAY) {
+        return false;
+    }
+    out_path = outPath;
+    NFD_FreePathU8(outPath);
+    return true;
+}
+#endif
+
+// Ask for an output folder without stalling frame(); start_pending_export()
+// queues the render jobs once one is picked
+void request_export(ExportContent content, bool whole_album) {
+    if (!state.emu || state.album_export.isRunning()) return;
+    if (state.export_dialog_busy.exchange(true)) return;
+    if (state.export_thread.joinable()) {
+        state.export_thread.join();
+    }
+    state.export_content = content;
+    state.export_whole_album = whole_album;
+    
+#ifdef __APPLE__
+    // AppKit panels can only run on the main thread
+    init_main_nfd();
+    std::string dir;
+    if (show_folder_dialog(dir)) {
+        std::lock_guard<std::mutex> lock(state.export_mutex);
+        state.export_pending_dir = dir;
+    }
+    state.export_dialog_busy.store(false);
+#elif defined(__EMSCRIPTEN__)
+    // The page has no folders to pick
+    state.export_dialog_busy.store(false);
+#else
+    state.export_thread = std::thread([]() {
+        std::string dir;
+        bool ok;
+        {
+            DialogThreadNfd nfd;
+            ok = show_folder_dialog(dir);
         }
+        if (ok) {
+            std::lock_guard<std::mutex> lock(state.export_mutex);
+            state.export_pending_dir = dir;
+        }
+        state.export_dialog_busy.store(false);
+    });
+#endif
+}
+
+// Save what the speakers played last as a clip, named for the track and the time
+static void save_clip() {
+    AudioClock clock;
+    if (!state.emu || state.audio_clock.load(clock) == 0) return;
+    int64_t heard = std::max<int64_t>(heard_output_frame(clock), 0);
+    
+    track_info_t info;
+    const char* song = gme_track_info(state.emu, &info, state.current_track) == nullptr ? info.song : "";
+    char when[32];
+    time_t now = time(nullptr);
+    strftime(when, sizeof(when), " %Y-%m-%d %H-%M-%S", localtime(&now));
+    std::string name = AlbumExporter::trackFileBase(state.current_track, song) + when;
+    state.clip_recorder.save(static_cast<uint64_t>(heard), state.channel_layout, name, state.clip_video,
+                             VideoRenderer::Settings());
+}
+
+// Runs at the top of frame(): render the album (or the current track) into the
+// picked folder, one job per track on the shared workers
+static void start_pending_export() {
+    std::string dir;
+    {
+        std::lock_guard<std::mutex> lock(state.export_mutex);
+        dir.swap(state.export_pending_dir);
+    }
+    if (dir.empty() || !state.emu) return;
+    
+    std::vector<int> tracks;
+    if (state.export_whole_album) {
+        for (int i = 0; i < state.track_count; ++i) tracks.push_back(i);
+    } else {
+        tracks.push_back(state.current_track);
+    }
+    
+    if (!state.emu_pool ||
+        !state.album_export.start(state.jobs, state.emu_pool->data(), std::move(tracks), dir, state.export_format,
+                                  state.export_content, state.sample_rate)) {
+        snprintf(state.error_msg, sizeof(state.error_msg), "Failed to start export to %s", dir.c_str());
+    }
+}
+
+// Called after load to preprocess piano data (call without holding audio_mutex)
+void postload_preprocess() {
+    preprocess_piano_track();
+    start_album_preprocess();
+}
+
+// Make a music emulator opened by the loader thread the current one
+static void install_music(LoadedFile& file) {
+    // Stop playback and any preprocessing of the previous file first
+    state.is_playing.store(false);
+    cancel_preprocessing();
+    cancel_album_preprocess();
+    cancel_prestart();
+    
+    std::unique_ptr<VoiceScopeBuffer> old_buffer;  // must outlive old_emu
+    std::unique_ptr<LoadedFile> old_retired;
+    Music_Emu* old_emu = nullptr;
+    {
+        // Wait for audio thread to stop using the emulator; only pointer swaps
+        // and cheap setup happen under the lock
+        std::lock_guard<std::mutex> lock(audio_mutex);
+        old_emu = state.emu;
+        old_buffer = std::move(state.voice_buffer);
+        old_retired = std::move(state.retired_track);
+        state.gapless_track.store(-1);
+        state.emu = file.emu;
+        state.voice_buffer = std::move(file.voice_buffer);
+        file.emu = nullptr;
+        state.emu_pool = std::move(file.pool);  // the old file's idle emulators go with it
+        
+        // Reset seek request and drop audio rendered from the old file
+        state.seek_request.store(-1);
+        state.seek_requested_ns.store(0);
+        state.seek_latency_max_ms.store(0.0f);
+        flush_audio_ring();
+        state.synth_track_ended.store(false);
+        
+        // Get track info
+        state.track_count = gme_track_count(state.emu);
+        state.current_track = file.start_track >= 0 && file.start_track < state.track_count ? file.start_track : 0;
+        state.synth_track = 0;  // gme_load_data starts track 0
+        state.error_msg[0] = '\0';
+        strncpy(state.loaded_file, file.path.c_str(), sizeof(state.loaded_file) - 1);
+        state.loaded_file[sizeof(state.loaded_file) - 1] = '\0';
+        
+        // Initialize visualizer with new emulator; voice scope storage is sized to its voices
+        state.analysis.setVoiceCount(state.voice_buffer ? gme_voice_count(state.emu) : 0);
+        state.analysis.setSampleRate(state.sample_rate);
+        state.analysis.reset();
+        state.visualizer.init(state.emu);
+        
+        // Reset piano visualizer and preprocess
+        state.piano.reset();
+        state.playback_time.store(0.0f);
+        
+        // Resolve the sound chips once; the synthesis thread reads them every chunk
+        state.apu_tap = ApuTap::resolve(state.emu);
+        hook_sound_chips(state.apu_tap);
+        state.play_calls.clear();
+        state.apu_snapshot.store(ApuFrameSnapshot());
+        state.channel_layout = state.apu_tap.layout();
+        
+        // Apply current settings
+        gme_set_tempo(state.emu, state.tempo);
+        gme_mute_voices(state.emu, state.visualizer.getMuteMask());
+    }
+    if (old_emu) {
+        gme_delete(old_emu);
+    }
+    
+    postload_preprocess();
+    if (file.start_track >= 0) {
+        safe_start_track(state.current_track);
+    }
+    prestart_next_track();
+}
+
+// Switch the UI over to the ROM just put into nes_emu
+static void enter_nes_mode() {
+    cancel_preprocessing();
+    state.nes_rom_loaded = true;
+    current_mode = AppMode::NES_EMULATOR;
+    show_emulator = true;
+    
+    // Reset visualizers for emulator mode
+    state.nes_channel_layout = ChannelLayout::build(state.nes_emu.hasVRC6() ? ChannelLayout::VRC6 : 0);
+    state.analysis.reset();
+    state.visualizer.reset();
+    state.piano.reset();
+    state.save_slots.prefetch(state.nes_emu);   // quick load without a wait
+}
+
+// ...by the loader thread
+static void install_nes_rom(const LoadedFile& file) {
+    state.nes_lookahead.loadROM(file.path.c_str());
+    enter_nes_mode();
+}
+
+// The input latency test's ROM, built in; it starts running at once
+static void load_latency_test_rom() {
+    const std::vector<uint8_t>& rom = InputLatencyTest::testRom();
+    if (!state.nes_emu.loadROMData(rom.data(), rom.size())) {
+        snprintf(state.error_msg, sizeof(state.error_msg), "Failed to load the latency test ROM");
+        return;
+    }
+    state.nes_lookahead.loadROMData(rom.data(), rom.size());
+    enter_nes_mode();
+    state.nes_emu.resume();
+}
+
+// Runs at the top of frame(), so a finished load is switched in between frames
+void install_loaded_file() {
+    std::unique_ptr<LoadedFile> file;
+    {
+        std::lock_guard<std::mutex> lock(state.loader_mutex);
+        file = std::move(state.loader_result);
+    }
+    if (!file) return;
+    state.loader_busy.store(false);
+    
+    if (!file->error.empty()) {
+        strncpy(state.error_msg, file->error.c_str(), sizeof(state.error_msg) - 1);
+        state.error_msg[sizeof(state.error_msg) - 1] = '\0';
+        return;
+    }
+    
+    if (file->kind == LoadKind::MUSIC) {
+        install_music(*file);
+    } else {
+        install_nes_rom(*file);
+    }
+}
+
+// Ask for a folder to add to the library without stalling frame();
+// start_pending_library_scan() adds it once one is picked
+void request_library_folder() {
+    if (state.library_dialog_busy.exchange(true)) return;
+    if (state.library_thread.joinable()) {
+        state.library_thread.join();
     }
     
-    // Convert 16-bit signed integer to 32-bit float (-1.0 to 1.0)
-    // Apply volume control
-    float volume_linear = std::pow(10.0f, state.volume_db / 20.0f);
-    for (int i = 0; i < num_samples; i++) {
-        buffer[i] = (temp_buffer[i] / 32768.0f) * volume_linear;
+#ifdef __APPLE__
+    // AppKit panels can only run on the main thread
+    init_main_nfd();
+    std::string dir;
+    if (show_folder_dialog(dir)) {
+        std::lock_guard<std::mutex> lock(state.library_mutex);
+        state.library_pending_dir = dir;
     }
+    state.library_dialog_busy.store(false);
+#elif defined(__EMSCRIPTEN__)
+    // The page has no folders to pick
+    state.library_dialog_busy.store(false);
+#else
+    state.library_thread = std::thread([]() {
+        std::string dir;
+        bool ok;
+        {
+            DialogThreadNfd nfd;
+            ok = show_folder_dialog(dir);
+        }
+        if (ok) {
+            std::lock_guard<std::mutex> lock(state.library_mutex);
+            state.library_pending_dir = dir;
+        }
+        state.library_dialog_busy.store(false);
+    });
+#endif
 }
 
-// Helper to get APU from emulator
-Nes_Apu* getApuFromEmu(Music_Emu* emu) {
-    Nsf_Emu* nsf = dynamic_cast<Nsf_Emu*>(emu);
-    if (nsf) {
-        return nsf->apu_();
+// Runs at the top of frame()
+static void start_pending_library_scan() {
+    std::string dir;
+    {
+        std::lock_guard<std::mutex> lock(state.library_mutex);
+        dir.swap(state.library_pending_dir);
     }
-    return nullptr;
+    if (dir.empty()) return;
+    state.library.addRoot(dir);
+    state.library.scan(state.jobs);
 }
 
-// Preprocess current track for piano visualization
-void preprocess_piano_track() {
-    if (!state.emu || state.preprocessing.load()) return;
-    
-    state.preprocessing.store(true);
-    state.preprocess_progress.store(0.0f);
-    
-    // Create a separate emulator instance for preprocessing
-    Music_Emu* preprocess_emu = nullptr;
-    gme_err_t err = gme_open_file(state.loaded_file, &preprocess_emu, state.sample_rate);
-    
-    if (err || !preprocess_emu) {
-        state.preprocessing.store(false);
+// Once a file scan is done, measure the tracks it found that have no end or loudness yet
+static void start_library_measure() {
+    static bool was_scanning = false;
+    bool scanning = state.library.isScanning();
+    if (was_scanning && !scanning) state.library.measureTracks(state.jobs);
+    was_scanning = scanning;
+}
+
+// The playing track's gain from the library, looked up again when the track,
+// the setting or the index changes
+static void update_track_gain() {
+    static std::string path;
+    static int track = -1;
+    static uint32_t version = ~0u;
+    static bool normalize = false;
+    if (path == state.loaded_file && track == state.current_track && version == state.library.version() &&
+        normalize == state.normalize_loudness) {
         return;
     }
-    
-    // Preprocess the track
-    state.piano.preprocessTrack(
-        preprocess_emu, 
-        state.current_track, 
-        state.sample_rate,
-        [](Music_Emu* emu) -> Nes_Apu* {
-            Nsf_Emu* nsf = dynamic_cast<Nsf_Emu*>(emu);
-            return nsf ? nsf->apu_() : nullptr;
-        },
-        [](float progress) {
-            state.preprocess_progress.store(progress);
-        },
-        [](Music_Emu* emu) -> Nes_Vrc6_Apu* {
-            Nsf_Emu* nsf = dynamic_cast<Nsf_Emu*>(emu);
-            return nsf ? nsf->vrc6_() : nullptr;
-        }
-    );
-    
-    // Cleanup preprocessing emulator
-    gme_delete(preprocess_emu);
-    
-    state.preprocessing.store(false);
-    state.preprocess_progress.store(1.0f);
+    path = state.loaded_file;
+    track = state.current_track;
+    version = state.library.version();
+    normalize = state.normalize_loudness;
+
+    float gain_db = 0.0f;
+    NsfLibrary::Snapshot catalog = state.library.snapshot();
+    const NsfLibrary::Entry* entry = normalize ? NsfLibrary::find(*catalog, path) : nullptr;
+    if (entry && track >= 0 && track < static_cast<int>(entry->tracks.size())) {
+        gain_db = NsfLibrary::trackGainDb(entry->tracks[track]);
+    }
+    state.track_gain.store(std::pow(10.0f, gain_db / 20.0f), std::memory_order_relaxed);
 }
 
-// Safe track start - can be called from UI thread
-void safe_start_track(int track) {
-    if (!state.emu) return;
-    
-    // Request the audio thread to start the track
-    state.is_playing.store(false);  // Pause playback
-    
-    std::lock_guard<std::mutex> lock(audio_mutex);
-    state.seek_request.store(-1);  // Clear any pending seek
-    gme_start_track(state.emu, track);
-    state.is_playing.store(true);  // Resume playback
+static std::string format_track_length(int32_t length_ms) {
+    if (length_ms < 0) return "-";
+    char text[16];
+    snprintf(text, sizeof(text), "%d:%02d", length_ms / 60000, (length_ms / 1000) % 60);
+    return text;
 }
 
-// Start track and preprocess for piano
-void start_track_with_preprocess(int track) {
-    state.current_track = track;
+// Background jobs window: what the workers are running and what is queued,
+// with progress for the jobs that report it
+void draw_jobs_window(bool* p_open) {
+    ImGui::SetNextWindowSize(ImVec2(420, 260), ImGuiCond_FirstUseEver);
+    if (!ImGui::Begin("Background Jobs", p_open)) {
+        ImGui::End();
+        return;
+    }
     
-    // Preprocess first (this will use a separate emulator)
-    preprocess_piano_track();
+    static std::vector<JobSystem::Status> jobs;  // keeps its capacity between frames
+    state.jobs.status(jobs);
+    ImGui::Text("%d workers, %d queued", state.jobs.workerCount(), state.jobs.pendingCount());
+    ImGui::Separator();
     
-    // Then start playback
-    safe_start_track(track);
+    if (jobs.empty()) {
+        ImGui::TextDisabled("Idle");
+    } else if (ImGui::BeginTable("##jobs", 3, ImGuiTableFlags_RowBg | ImGuiTableFlags_ScrollY)) {
+        ImGui::TableSetupColumn("Job", ImGuiTableColumnFlags_WidthFixed, 130.0f);
+        ImGui::TableSetupColumn("Priority", ImGuiTableColumnFlags_WidthFixed, 80.0f);
+        ImGui::TableSetupColumn("Progress", ImGuiTableColumnFlags_WidthStretch);
+        ImGui::TableSetupScrollFreeze(0, 1);
+        ImGui::TableHeadersRow();
+        for (const JobSystem::Status& job : jobs) {
+            ImGui::TableNextRow();
+            ImGui::TableNextColumn();
+            ImGui::TextUnformatted(job.name);
+            ImGui::TableNextColumn();
+            ImGui::TextUnformatted(job.priority == JobPriority::INTERACTIVE ? "interactive" : "batch");
+            ImGui::TableNextColumn();
+            if (!job.running) {
+                ImGui::TextDisabled("queued");
+            } else if (job.progress >= 0.0f) {
+                ImGui::ProgressBar(job.progress, ImVec2(-1, 0));
+            } else {
+                ImGui::TextUnformatted("running");
+            }
+        }
+        ImGui::EndTable();
+    }
+    
+    ImGui::End();
 }
 
-void load_nsf_file(const char* path) {
-    // Stop playback first
-    state.is_playing.store(false);
-    
-    // Wait for audio thread to stop using the emulator
-    std::lock_guard<std::mutex> lock(audio_mutex);
+// Play queue window: the queued files in order, the playing one marked.
+// Double-click a file to play it.
+void draw_play_queue_window(bool* p_open) {
+    ImGui::SetNextWindowSize(ImVec2(560, 360), ImGuiCond_FirstUseEver);
+    if (!ImGui::Begin("Play Queue", p_open)) {
+        ImGui::End();
+        return;
+    }
     
-    // Clean up previous emulator
-    if (state.emu) {
-        gme_delete(state.emu);
-        state.emu = nullptr;
+    PlayQueue::Snapshot items = state.play_queue.snapshot();
+    if (ImGui::Button("Clear")) {
+        state.play_queue.clear();
+    }
+    ImGui::SameLine();
+    if (state.play_queue.isReading()) {
+        ImGui::TextDisabled("Reading files...");
+    } else {
+        ImGui::TextDisabled("%zu files", items->size());
     }
+    ImGui::SameLine();
+    ImGui::TextDisabled("(drop files or folders on the window; Shift queues without playing)");
     
-    // Reset seek request
-    state.seek_request.store(-1);
+    ImGuiTableFlags flags = ImGuiTableFlags_RowBg | ImGuiTableFlags_BordersInnerV | ImGuiTableFlags_Resizable |
+                            ImGuiTableFlags_ScrollY;
+    uint32_t remove_id = 0;
+    if (ImGui::BeginTable("queue", 4, flags)) {
+        ImGui::TableSetupScrollFreeze(0, 1);
+        ImGui::TableSetupColumn("Game", ImGuiTableColumnFlags_WidthStretch, 2.0f);
+        ImGui::TableSetupColumn("Author", ImGuiTableColumnFlags_WidthStretch, 1.5f);
+        ImGui::TableSetupColumn("Tracks", ImGuiTableColumnFlags_WidthFixed, 50.0f);
+        ImGui::TableSetupColumn("##remove", ImGuiTableColumnFlags_WidthFixed, 20.0f);
+        ImGui::TableHeadersRow();
+        
+        ImGuiListClipper clipper;
+        clipper.Begin(static_cast<int>(items->size()));
+        while (clipper.Step()) {
+            for (int row = clipper.DisplayStart; row < clipper.DisplayEnd; ++row) {
+                const PlayQueue::Item& item = (*items)[row];
+                ImGui::TableNextRow();
+                ImGui::TableNextColumn();
+                ImGui::PushID(static_cast<int>(item.id));
+                bool playing = item.info.path == state.loaded_file;
+                std::string_view file = item.info.path;
+                file = file.substr(file.find_last_of("/\\") + 1);
+                char name[256];
+                snprintf(name, sizeof(name), "%.*s", static_cast<int>(file.size()), file.data());
+                const char* label = item.info.game.empty() ? name : item.info.game.c_str();
+                ImGui::BeginDisabled(item.status != PlayQueue::Status::READY);
+                if (ImGui::Selectable(label, playing, ImGuiSelectableFlags_SpanAllColumns |
+                                                      ImGuiSelectableFlags_AllowDoubleClick |
+                                                      ImGuiSelectableFlags_AllowOverlap) &&
+                    ImGui::IsMouseDoubleClicked(ImGuiMouseButton_Left)) {
+                    request_load(LoadKind::MUSIC, item.info.path.c_str(), 0);
+                }
+                ImGui::EndDisabled();
+                if (ImGui::IsItemHovered(ImGuiHoveredFlags_DelayNormal | ImGuiHoveredFlags_AllowWhenDisabled)) {
+                    ImGui::SetTooltip("%s%s", item.info.path.c_str(),
+                                      item.status == PlayQueue::Status::FAILED ? "\n(not an NSF/NSFe file)" : "");
+                }
+                ImGui::TableNextColumn();
+                ImGui::TextUnformatted(item.info.author.c_str());
+                ImGui::TableNextColumn();
+                switch (item.status) {
+                    case PlayQueue::Status::READING: ImGui::TextDisabled("..."); break;
+                    case PlayQueue::Status::READY:   ImGui::Text("%zu", item.info.tracks.size()); break;
+                    case PlayQueue::Status::FAILED:  ImGui::TextDisabled("-"); break;
+                }
+                ImGui::TableNextColumn();
+                if (ImGui::SmallButton("x")) remove_id = item.id;
+                ImGui::PopID();
+            }
+        }
+        ImGui::EndTable();
+    }
+    if (remove_id) state.play_queue.remove(remove_id);
     
-    // Load new file
-    gme_err_t err = gme_open_file(path, &state.emu, state.sample_rate);
-    if (err) {
-        strncpy(state.error_msg, err, sizeof(state.error_msg) - 1);
-        state.error_msg[sizeof(state.error_msg) - 1] = '\0';
+    ImGui::End();
+}
+
+// Library window: every indexed file with its tracks. Double-click a file to
+// open it or a track to play it.
+void draw_library_window(bool* p_open) {
+    ImGui::SetNextWindowSize(ImVec2(760, 520), ImGuiCond_FirstUseEver);
+    if (!ImGui::Begin("Library", p_open)) {
+        ImGui::End();
         return;
     }
     
-    // Get track info
-    state.track_count = gme_track_count(state.emu);
-    state.current_track = 0;
-    state.error_msg[0] = '\0';
-    strncpy(state.loaded_file, path, sizeof(state.loaded_file) - 1);
-    state.loaded_file[sizeof(state.loaded_file) - 1] = '\0';
+    // Rows shown for the current query, re-run on every keystroke and
+    // whenever the index changes
+    static char filter[128] = "";
+    static std::vector<int> rows;
+    static uint32_t rows_version = ~0u;
+    static std::string rows_filter;
+    static std::string selected_path;
+    NsfLibrary::Snapshot catalog = state.library.snapshot();
+    const std::vector<NsfLibrary::Entry>& entries = catalog->entries;
+    static std::vector<std::string> roots;  // copied over the last frame's strings
+    state.library.roots(roots);
     
-    // Initialize visualizer with new emulator
-    state.visualizer.init(state.emu, state.sample_rate);
+    if (ImGui::Button("Add Folder...")) {
+        request_library_folder();
+    }
+    ImGui::SameLine();
+    ImGui::BeginDisabled(roots.empty());
+    if (ImGui::Button("Rescan")) {
+        state.library.scan(state.jobs);
+    }
+    ImGui::EndDisabled();
+    ImGui::SameLine();
+    ImGui::SetNextItemWidth(280);
+    ImGui::InputTextWithHint("##filter", "Search (game: author: track: chip: file:)", filter, sizeof(filter));
+    if (ImGui::IsItemHovered(ImGuiHoveredFlags_DelayNormal)) {
+        ImGui::SetTooltip("All words must match, e.g. \"chip:vrc6 composer:kinuyo\"");
+    }
+    if (rows_version != state.library.version() || rows_filter != filter) {
+        rows_version = state.library.version();
+        rows_filter = filter;
+        catalog->search.query(entries, rows_filter, rows);
+    }
+    ImGui::SameLine();
+    if (state.library.isScanning()) {
+        ImGui::TextDisabled("Scanning %d/%d", state.library.scanDone(), state.library.scanTotal());
+    } else if (state.library.isMeasuring()) {
+        ImGui::TextDisabled("Measuring tracks %d/%d", state.library.measureDone(), state.library.measureTotal());
+    } else {
+        ImGui::TextDisabled("%zu of %zu files", rows.size(), entries.size());
+    }
     
-    // Reset piano visualizer and preprocess
-    state.piano.reset();
-    state.playback_time.store(0.0f);
+    // Folders in the library, removable
+    if (!roots.empty() && ImGui::TreeNode("Folders", "Folders (%zu)", roots.size())) {
+        for (const std::string& root : roots) {
+            ImGui::PushID(root.c_str());
+            if (ImGui::SmallButton("Remove")) {
+                state.library.removeRoot(root);
+                state.library.scan(state.jobs);
+            }
+            ImGui::SameLine();
+            ImGui::TextUnformatted(root.c_str());
+            ImGui::PopID();
+        }
+        ImGui::TreePop();
+    }
     
-    // Apply current settings
-    gme_set_tempo(state.emu, state.tempo);
-    gme_mute_voices(state.emu, state.visualizer.getMuteMask());
-}
-
-// Called after load to preprocess piano data (call without holding audio_mutex)
-void postload_preprocess() {
-    preprocess_piano_track();
+    const NsfLibrary::Entry* selected = nullptr;
+    float tracks_height = 160.0f;
+    ImGuiTableFlags flags = ImGuiTableFlags_RowBg | ImGuiTableFlags_BordersInnerV | ImGuiTableFlags_Resizable |
+                            ImGuiTableFlags_ScrollY;
+    if (ImGui::BeginTable("files", 4, flags, ImVec2(0, -tracks_height))) {
+        ImGui::TableSetupScrollFreeze(0, 1);
+        ImGui::TableSetupColumn("Game", ImGuiTableColumnFlags_WidthStretch, 2.0f);
+        ImGui::TableSetupColumn("Author", ImGuiTableColumnFlags_WidthStretch, 1.5f);
+        ImGui::TableSetupColumn("Tracks", ImGuiTableColumnFlags_WidthFixed, 50.0f);
+        ImGui::TableSetupColumn("Chips", ImGuiTableColumnFlags_WidthFixed, 80.0f);
+        ImGui::TableHeadersRow();
+        
+        // 100k rows: only the visible ones are submitted
+        ImGuiListClipper clipper;
+        clipper.Begin(static_cast<int>(rows.size()));
+        while (clipper.Step()) {
+            for (int row = clipper.DisplayStart; row < clipper.DisplayEnd; ++row) {
+                const NsfLibrary::Entry& entry = entries[rows[row]];
+                ImGui::TableNextRow();
+                ImGui::TableNextColumn();
+                ImGui::PushID(rows[row]);
+                bool is_selected = entry.path == selected_path;
+                const char* name = entry.game.empty() ? entry.path.c_str() : entry.game.c_str();
+                if (ImGui::Selectable(name, is_selected, ImGuiSelectableFlags_SpanAllColumns |
+                                                         ImGuiSelectableFlags_AllowDoubleClick)) {
+                    selected_path = entry.path;
+                    if (ImGui::IsMouseDoubleClicked(ImGuiMouseButton_Left)) {
+                        request_load(LoadKind::MUSIC, entry.path.c_str());
+                    }
+                }
+                if (ImGui::IsItemHovered(ImGuiHoveredFlags_DelayNormal)) {
+                    ImGui::SetTooltip("%s", entry.path.c_str());
+                }
+                ImGui::PopID();
+                ImGui::TableNextColumn();
+                ImGui::TextUnformatted(entry.author.c_str());
+                ImGui::TableNextColumn();
+                ImGui::Text("%zu", entry.tracks.size());
+                ImGui::TableNextColumn();
+                ImGui::TextUnformatted(LibrarySearch::chipNames(entry.chips).c_str());
+            }
+        }
+        ImGui::EndTable();
+    }
+    
+    // Tracks of the selected file; entries are sorted by path
+    auto found = std::lower_bound(entries.begin(), entries.end(), selected_path,
+                                  [](const NsfLibrary::Entry& entry, const std::string& path) { return entry.path < path; });
+    if (found != entries.end() && found->path == selected_path) {
+        selected = &*found;
+    }
+    if (selected && ImGui::BeginTable("tracks", 4, flags)) {
+        ImGui::TableSetupScrollFreeze(0, 1);
+        ImGui::TableSetupColumn("#", ImGuiTableColumnFlags_WidthFixed, 30.0f);
+        ImGui::TableSetupColumn("Track", ImGuiTableColumnFlags_WidthStretch);
+        ImGui::TableSetupColumn("Length", ImGuiTableColumnFlags_WidthFixed, 60.0f);
+        ImGui::TableSetupColumn("Loudness", ImGuiTableColumnFlags_WidthFixed, 80.0f);
+        ImGui::TableHeadersRow();
+        for (int t = 0; t < static_cast<int>(selected->tracks.size()); ++t) {
+            const NsfLibrary::Track& track = selected->tracks[t];
+            ImGui::TableNextRow();
+            ImGui::TableNextColumn();
+            char label[16];
+            snprintf(label, sizeof(label), "%d##track", t + 1);
+            if (ImGui::Selectable(label, false, ImGuiSelectableFlags_SpanAllColumns |
+                                                ImGuiSelectableFlags_AllowDoubleClick) &&
+                ImGui::IsMouseDoubleClicked(ImGuiMouseButton_Left)) {
+                if (selected->path == state.loaded_file) {
+                    start_track_with_preprocess(t);
+                } else {
+                    request_load(LoadKind::MUSIC, selected->path.c_str(), t);
+                }
+            }
+            ImGui::TableNextColumn();
+            ImGui::TextUnformatted(track.name.empty() ? "(untitled)" : track.name.c_str());
+            ImGui::TableNextColumn();
+            ImGui::TextUnformatted(format_track_length(track.length_ms).c_str());
+            ImGui::TableNextColumn();
+            if (std::isnan(track.lufs)) {
+                ImGui::TextDisabled("-");
+            } else if (!LoudnessMeter::hasSignal(track.lufs)) {
+                ImGui::TextDisabled("silent");
+            } else {
+                ImGui::Text("%.1f LUFS", track.lufs);
+                if (ImGui::IsItemHovered(ImGuiHoveredFlags_DelayNormal)) {
+                    ImGui::SetTooltip("Peak %.1f dBTP, gain %+.1f dB", track.peak_db, NsfLibrary::trackGainDb(track));
+                }
+            }
+        }
+        ImGui::EndTable();
+    }
+    
+    ImGui::End();
 }
 
-// Load NES ROM file
-void load_nes_rom(const char* path) {
-    if (state.nes_emu.loadROM(path)) {
-        state.nes_rom_loaded = true;
-        current_mode = AppMode::NES_EMULATOR;
-        show_emulator = true;
-        
-        // Reset visualizers for emulator mode
-        state.visualizer.reset();
-        state.piano.reset();
+// "Slot 3 (Mar 02 14:05)"; false if the slot is empty
+static bool save_slot_label(char* out, size_t size, int slot) {
+    SaveSlots::Slot info = state.save_slots.slot(state.nes_emu, slot);
+    const char* name = slot == 0 ? "Quick Save" : nullptr;
+    char slot_name[16];
+    if (!name) {
+        snprintf(slot_name, sizeof(slot_name), "Slot %d", slot);
+        name = slot_name;
+    }
+    if (!info.ready) {
+        snprintf(out, size, "%s (...)", name);
+    } else if (!info.used) {
+        snprintf(out, size, "%s (empty)", name);
     } else {
-        strncpy(state.error_msg, "Failed to load NES ROM", sizeof(state.error_msg) - 1);
+        time_t saved = static_cast<time_t>(info.saved_time);
+        char when[32];
+        strftime(when, sizeof(when), "%b %d %H:%M", localtime(&saved));
+        snprintf(out, size, "%s (%s)", name, when);
     }
+    return info.used;
 }
 
 // Draw NES Emulator window
@@ -415,20 +2376,96 @@ void draw_emulator_window(bool* p_open) {
         if (ImGui::BeginMenuBar()) {
             if (ImGui::BeginMenu("File")) {
                 if (ImGui::MenuItem("Open ROM...", "Ctrl+R")) {
-                    nfdu8filteritem_t filterItem[2];
-                    filterItem[0].name = "NES ROM Files";
-                    filterItem[0].spec = "nes";
-                    filterItem[1].name = "All Files";
-                    filterItem[1].spec = "*";
-                    
+                    request_load(LoadKind::NES_ROM);
+                }
+                std::vector<std::string> suspended = state.nes_emu.suspendedRoms();
+                if (ImGui::BeginMenu("Resume ROM", !suspended.empty())) {
+                    for (const std::string& path : suspended) {
+                        std::string name = path.substr(path.find_last_of("/\\") + 1);
+                        if (ImGui::MenuItem(name.c_str())) {
+                            request_load(LoadKind::NES_ROM, path.c_str());
+                        }
+                    }
+                    ImGui::EndMenu();
+                }
+                ImGui::Separator();
+                if (ImGui::BeginMenu("Save State", state.nes_rom_loaded)) {
+                    state.save_slots.prefetch(state.nes_emu);
+                    for (int i = 0; i < SaveSlots::SLOT_COUNT; ++i) {
+                        char label[64];
+                        save_slot_label(label, sizeof(label), i);
+                        if (ImGui::MenuItem(label, i == 0 ? "F2" : nullptr)) state.save_slots.save(state.nes_emu, i);
+                    }
+                    ImGui::EndMenu();
+                }
+                if (ImGui::BeginMenu("Load State", state.nes_rom_loaded)) {
+                    state.save_slots.prefetch(state.nes_emu);
+                    for (int i = 0; i < SaveSlots::SLOT_COUNT; ++i) {
+                        char label[64];
+                        bool used = save_slot_label(label, sizeof(label), i);
+                        if (ImGui::MenuItem(label, i == 0 ? "F4" : nullptr, false, used)) {
+                            state.save_slots.load(state.nes_emu, i);
+                        }
+                    }
+                    ImGui::EndMenu();
+                }
+                ImGui::Separator();
+#ifdef __EMSCRIPTEN__
+                if (!state.nes_emu.isRecording()) {
+                    if (ImGui::MenuItem("Record Movie", nullptr, false, state.nes_rom_loaded)) {
+                        state.nes_emu.startRecording();
+                    }
+                } else if (ImGui::MenuItem("Stop Recording...")) {
+                    InputMovie movie;
+                    std::string path = WebFiles::savePath("movie.fcm");
+                    if (state.nes_emu.stopRecording(movie) && movie.save(path.c_str())) WebFiles::download(path);
+                }
+                if (state.nes_emu.isReplaying()) {
+                    if (ImGui::MenuItem("Stop Movie")) {
+                        state.nes_emu.stopReplay();
+                    }
+                    ImGui::TextDisabled("Movie: %u / %u", state.nes_emu.movieFrame(), state.nes_emu.movieLength());
+                } else if (ImGui::MenuItem("Play Movie...", nullptr, false, state.nes_rom_loaded)) {
+                    WebFiles::pick(".fcm", [](const std::string& path) {
+                        InputMovie movie;
+                        if (movie.load(path.c_str())) state.nes_emu.startReplay(movie);
+                    });
+                }
+#else
+                nfdu8filteritem_t movieFilter[2];
+                movieFilter[0].name = "Input Movies";
+                movieFilter[0].spec = "fcm";
+                movieFilter[1].name = "All Files";
+                movieFilter[1].spec = "*";
+                if (!state.nes_emu.isRecording()) {
+                    if (ImGui::MenuItem("Record Movie", nullptr, false, state.nes_rom_loaded)) {
+                        state.nes_emu.startRecording();
+                    }
+                } else if (ImGui::MenuItem("Stop Recording...")) {
+                    InputMovie movie;
                     nfdu8char_t* outPath = nullptr;
-                    nfdresult_t result = NFD_OpenDialogU8(&outPath, filterItem, 2, nullptr);
-                    
-                    if (result == NFD_OKAY) {
-                        load_nes_rom(outPath);
+                    init_main_nfd();
+                    if (state.nes_emu.stopRecording(movie) &&
+                        NFD_SaveDialogU8(&outPath, movieFilter, 2, nullptr, "movie.fcm") == NFD_OKAY) {
+                        movie.save(outPath);
+                        NFD_FreePathU8(outPath);
+                    }
+                }
+                if (state.nes_emu.isReplaying()) {
+                    if (ImGui::MenuItem("Stop Movie")) {
+                        state.nes_emu.stopReplay();
+                    }
+                    ImGui::TextDisabled("Movie: %u / %u", state.nes_emu.movieFrame(), state.nes_emu.movieLength());
+                } else if (ImGui::MenuItem("Play Movie...", nullptr, false, state.nes_rom_loaded)) {
+                    nfdu8char_t* outPath = nullptr;
+                    init_main_nfd();
+                    if (NFD_OpenDialogU8(&outPath, movieFilter, 2, nullptr) == NFD_OKAY) {
+                        InputMovie movie;
+                        if (movie.load(outPath)) state.nes_emu.startReplay(movie);
                         NFD_FreePathU8(outPath);
                     }
                 }
+#endif
                 ImGui::Separator();
                 if (ImGui::MenuItem("Close ROM")) {
                     state.nes_emu.pause();
@@ -446,10 +2483,125 @@ void draw_emulator_window(bool* p_open) {
                 if (ImGui::MenuItem("Reset", "F5")) {
                     state.nes_emu.reset();
                 }
+                ImGui::Separator();
+                bool drc = state.nes_emu.getDynamicRateControl();
+                if (ImGui::MenuItem("Dynamic Rate Control", nullptr, &drc)) {
+                    state.nes_emu.setDynamicRateControl(drc);
+                }
+                if (drc) {
+                    ImGui::TextDisabled("Audio clock %+.3f%%", state.nes_emu.getRateAdjust() * 100.0f);
+                }
+                ImGui::Separator();
+                bool rewind = state.nes_emu.isRewindEnabled();
+                if (ImGui::MenuItem("Rewind (hold R)", nullptr, &rewind)) {
+                    state.nes_emu.setRewindEnabled(rewind);
+                }
+                if (rewind) {
+                    ImGui::TextDisabled("History: %.1f s", state.nes_emu.rewindSeconds());
+                }
+                ImGui::MenuItem("Turbo (hold Tab)", nullptr, &state.nes_turbo);
+                ImGui::TextDisabled("%.0f fps", state.nes_emu.getEmulationFps());
+                bool frame_skip = state.nes_emu.getFrameSkip();
+                if (ImGui::MenuItem("Adaptive Frame Skip", nullptr, &frame_skip)) {
+                    state.nes_emu.setFrameSkip(frame_skip);
+                }
+                if (ImGui::IsItemHovered(ImGuiHoveredFlags_DelayNormal)) {
+                    ImGui::SetTooltip("When a frame costs more than 1/60 s, keep emulation and sound\n"
+                                      "at full speed and show only the frames there is time for");
+                }
+                int run_ahead = state.nes_emu.getRunAhead();
+                if (ImGui::SliderInt("Run-Ahead", &run_ahead, 0, 3, run_ahead ? "%d frames" : "Off")) {
+                    state.nes_emu.setRunAhead(run_ahead);
+                }
+                bool late_latching = state.nes_emu.getLateLatching();
+                if (ImGui::MenuItem("Late Input Latching", nullptr, &late_latching)) {
+                    state.nes_emu.setLateLatching(late_latching);
+                }
+                if (ImGui::IsItemHovered(ImGuiHoveredFlags_DelayNormal)) {
+                    ImGui::SetTooltip("Hand the game the newest pads when it first reads them in a\n"
+                                      "frame, rather than as the frame starts");
+                }
+                ImGui::EndMenu();
+            }
+            if (ImGui::BeginMenu("Netplay")) {
+                static const char* const status_names[] = {
+                    "Idle", "Waiting for peer...", "Connected", "Peer lost", "Failed"};
+                Netplay::Status status = state.nes_emu.netplayStatus();
+                if (state.nes_emu.isNetplayActive()) {
+                    ImGui::TextDisabled("%s", status_names[static_cast<int>(status)]);
+                    if (status == Netplay::Status::CONNECTED) {
+                        ImGui::TextDisabled("Round trip %d ms, last rollback %d frames",
+                                            state.nes_emu.netplayRoundTripMs(), state.nes_emu.netplayRollback());
+                    }
+                    if (ImGui::MenuItem("Disconnect")) {
+                        state.nes_emu.stopNetplay();
+                    }
+                } else {
+                    ImGui::InputText("Address", state.nes_netplay_address, sizeof(state.nes_netplay_address));
+                    ImGui::InputInt("Port", &state.nes_netplay_port);
+                    state.nes_netplay_port = std::clamp(state.nes_netplay_port, 1, 65535);
+                    uint16_t port = static_cast<uint16_t>(state.nes_netplay_port);
+                    if (ImGui::MenuItem("Host (player 1)", nullptr, false, state.nes_rom_loaded)) {
+                        state.nes_emu.hostNetplay(port);
+                    }
+                    if (ImGui::MenuItem("Join (player 2)", nullptr, false, state.nes_rom_loaded)) {
+                        state.nes_emu.joinNetplay(state.nes_netplay_address, port);
+                    }
+                    if (status != Netplay::Status::IDLE) {
+                        ImGui::TextDisabled("%s", status_names[static_cast<int>(status)]);
+                    }
+                }
                 ImGui::EndMenu();
             }
             if (ImGui::BeginMenu("View")) {
                 ImGui::SliderFloat("Scale", &state.nes_screen_scale, 1.0f, 4.0f, "%.1fx");
+                ImGui::Separator();
+                if (ImGui::MenuItem("Load Palette...")) {
+#ifdef __EMSCRIPTEN__
+                    WebFiles::pick(".pal", [](const std::string& path) {
+                        state.nes_emu.loadPaletteFile(path.c_str());
+                    });
+#else
+                    nfdu8filteritem_t filterItem[2];
+                    filterItem[0].name = "NES Palette Files";
+                    filterItem[0].spec = "pal";
+                    filterItem[1].name = "All Files";
+                    filterItem[1].spec = "*";
+                    
+                    nfdu8char_t* outPath = nullptr;
+                    init_main_nfd();
+                    nfdresult_t result = NFD_OpenDialogU8(&outPath, filterItem, 2, nullptr);
+                    
+                    if (result == NFD_OKAY) {
+                        state.nes_emu.loadPaletteFile(outPath);
+                        NFD_FreePathU8(outPath);
+                    }
+#endif
+                }
+                if (ImGui::MenuItem("Default Palette")) {
+                    state.nes_emu.resetPalette();
+                }
+                ImGui::TextDisabled(state.nes_emu.usesGpuPalette() ? "Palette: GPU" : "Palette: CPU");
+                ImGui::Separator();
+                if (ImGui::BeginMenu("Screen Filter", state.nes_emu.supportsScreenFilter())) {
+                    for (int i = 0; i < NES_FILTER_COUNT; ++i) {
+                        if (ImGui::MenuItem(NES_FILTERS[i].name, nullptr, state.nes_filter == i)) {
+                            apply_nes_filter(i);
+                        }
+                    }
+                    if (state.nes_filter_pass_count > 0) {
+                        ImGui::Separator();
+                        if (draw_nes_filter_params()) {
+                            state.nes_emu.setScreenFilter(state.nes_filter_passes, state.nes_filter_pass_count);
+                        }
+                    }
+                    ImGui::EndMenu();
+                }
+                ImGui::Separator();
+                ImGui::MenuItem("PPU Viewer", nullptr, &show_ppu_viewer);
+                ImGui::MenuItem("RAM Search", nullptr, &show_ram_search);
+                ImGui::MenuItem("6502 Debugger", nullptr, &show_nes_debugger);
+                ImGui::MenuItem("Input Latency Test", nullptr, &show_input_latency);
                 ImGui::EndMenu();
             }
             ImGui::EndMenuBar();
@@ -477,6 +2629,14 @@ void draw_emulator_window(bool* p_open) {
                 } else {
                     ImGui::TextColored(ImVec4(0.9f, 0.9f, 0.3f, 1.0f), "Paused");
                 }
+                
+                // Frames the adaptive frame skip didn't show
+                float skip_ratio = state.nes_emu.getFrameSkipRatio();
+                if (running && skip_ratio >= 0.01f) {
+                    ImGui::SameLine();
+                    ImGui::TextDisabled("%.0f fps, %.0f%% of frames skipped", state.nes_emu.getEmulationFps(),
+                                        skip_ratio * 100.0f);
+                }
             }
             ImGui::EndGroup();
             
@@ -516,6 +2676,8 @@ void draw_emulator_window(bool* p_open) {
 
 // Update NES controller input from keyboard
 void update_nes_input() {
+    uint16_t before = InputMovie::pack(state.nes_input, agnes_input_t{});
+    
     // Reset input
     memset(&state.nes_input, 0, sizeof(state.nes_input));
     
@@ -531,42 +2693,424 @@ void update_nes_input() {
     state.nes_input.start = key_states[SAPP_KEYCODE_ENTER];
     state.nes_input.select = key_states[SAPP_KEYCODE_BACKSPACE];
     
-    // Set input to emulator
+    // Set input to emulator, timing the press if the latency test runs
+    state.input_latency.padsChanged(state.nes_emu, before, InputMovie::pack(state.nes_input, agnes_input_t{}));
     state.nes_emu.setInput(0, state.nes_input);
 }
 
+// Follow the audio device to a new output rate. gme fixes its rate when a
+// file is opened, so a loaded file is opened again at the playing track.
+static void set_output_rate(long rate) {
+    if (rate <= 0 || rate == state.sample_rate) return;
+    {
+        std::lock_guard<std::mutex> lock(audio_mutex);
+        state.sample_rate = rate;
+        flush_audio_ring();
+        state.clip_recorder.setSampleRate(rate);
+        state.analysis.setSampleRate(rate);
+    }
+    if (state.emu && state.loaded_file[0] != '\0') {
+        state.is_playing.store(false);  // the old emulator would play at the wrong pitch
+        request_load(LoadKind::MUSIC, state.loaded_file, state.current_track);
+    }
+}
+
+// (Re)open the audio device for a latency profile. Opening one can take a
+// few hundred milliseconds (WASAPI, PulseAudio, a Bluetooth sink), so it
+// runs on audio_device_thread and neither startup nor the menu waits for
+// it; finish_audio_open() then resizes every queue on the main thread.
+// saudio_shutdown waits for the callback to finish.
+static void apply_latency_profile(int index) {
+    index = std::clamp(index, 0, LATENCY_PROFILE_COUNT - 1);
+    const LatencyProfile& profile = LATENCY_PROFILES[index];
+    state.latency_profile = index;
+    const LatencyCalibration& calibration = latency_calibration[index];
+    if (calibration.measured && calibration.exclusive == state.audio_exclusive) {
+        state.output_offset_ms = calibration.offset_ms;
+    }
+    
+    // A reopen still under way finishes first
+    if (state.audio_device_thread.joinable()) {
+        state.audio_device_thread.join();
+    }
+    state.audio_initialized = false;
+    
+    // Initialize sokol_audio with callback model
+    saudio_desc audio_desc = {};
+    audio_desc.sample_rate = state.sample_rate;
+    audio_desc.device_sample_rate = true;  // synthesize at the mixer's rate, so nothing resamples after us
+    audio_desc.exclusive = state.audio_exclusive;
+    audio_desc.num_channels = 2; // Stereo
+    audio_desc.buffer_frames = profile.buffer_frames;
+    audio_desc.stream_userdata_cb = audio_stream_callback;
+    audio_desc.capture_userdata_cb = latency_measure.capture ? latency_capture_callback : nullptr;
+    audio_desc.user_data = nullptr;
+    audio_desc.logger.func = slog_func;
+    
+    bool reopen = state.audio_setup_called;
+    state.audio_setup_called = true;
+    state.audio_opening = true;
+    state.audio_opened.store(false);
+#ifdef __EMSCRIPTEN__
+    // The AudioContext belongs to the page's main thread; opening it only
+    // schedules the worklet, which starts without blocking anything
+    if (reopen) saudio_shutdown();
+    saudio_setup(&audio_desc);
+    state.audio_opened.store(true, std::memory_order_release);
+#else
+    state.audio_device_thread = std::thread([audio_desc, reopen]() {
+        FC_TRACE_THREAD("audio device");
+        if (reopen) {
+            saudio_shutdown();
+            saudio_setup(&audio_desc);
+        } else {
+            PROFILE_STARTUP("Audio device");
+            saudio_setup(&audio_desc);
+        }
+        state.audio_opened.store(true, std::memory_order_release);
+    });
+#endif
+}
+
+static void begin_latency_probe();
+static void next_latency_measurement();
+
+// Main thread, once apply_latency_profile's device is open (or failed)
+static void finish_audio_open() {
+    if (!state.audio_opening || !state.audio_opened.load(std::memory_order_acquire)) return;
+    if (state.audio_device_thread.joinable()) state.audio_device_thread.join();
+    state.audio_opening = false;
+    const LatencyProfile& profile = LATENCY_PROFILES[state.latency_profile];
+    
+    state.audio_initialized = saudio_isvalid();
+    if (state.audio_initialized) set_output_rate(saudio_sample_rate());
+    
+    int device_frames = state.audio_initialized ? saudio_buffer_frames() : profile.buffer_frames;
+    state.synth_target_frames.store(std::min(std::max(profile.queue_frames, device_frames + SYNTH_CHUNK_FRAMES),
+                                             AUDIO_RING_FRAMES - SYNTH_CHUNK_FRAMES));
+    state.queued_frames_avg.store(0.0f);
+    
+    // The emulator needs at least a frame's worth of samples (~735) beyond the device buffer
+    state.nes_emu.setAudioFormat(state.sample_rate, profile.blip_msec);
+    state.nes_emu.setAudioQueueTarget(device_frames + 1024);
+    
+    // The emulator thread is paced by the audio queue when there is a device;
+    // started with the first device, later reopens keep it
+    state.nes_emu.startThread(state.audio_initialized);
+    
+    if (latency_measure.capture) begin_latency_probe();
+}
+
+// Measure the output latency of 'profiles' in turn, then go back to the
+// profile in use with the offset measured for it
+static void measure_latency(std::vector<int> profiles) {
+    if (!latency_measure.queue.empty() || profiles.empty()) return;
+    latency_measure.queue = std::move(profiles);
+    latency_measure.restore = state.latency_profile;
+    next_latency_measurement();
+}
+
+// Open the device for the next profile queued, or the one to go back to
+static void next_latency_measurement() {
+    state.latency_probe.cancel();
+    latency_measure.capture = !latency_measure.queue.empty();
+    apply_latency_profile(latency_measure.capture ? latency_measure.queue.front() : latency_measure.restore);
+}
+
+static void cancel_latency_measurement() {
+    if (latency_measure.queue.empty()) return;
+    latency_measure.queue.clear();
+    next_latency_measurement();
+}
+
+// Main thread, once the measuring device is open
+static void begin_latency_probe() {
+    if (state.audio_initialized && saudio_capturing()) {
+        state.latency_probe.begin(state.sample_rate);
+        return;
+    }
+    // Nothing to record with; the other profiles won't do better
+    for (int index : latency_measure.queue) {
+        latency_calibration[index].measured = false;
+        latency_calibration[index].failure = "no input device";
+    }
+    latency_measure.queue.clear();
+    next_latency_measurement();
+}
+
+// Every frame: run the probe and take its result once it is done
+static void update_latency_measurement() {
+    if (latency_measure.queue.empty() || state.audio_opening || !state.latency_probe.running()) return;
+    state.latency_probe.update();
+    if (state.latency_probe.running()) return;
+    
+    LatencyCalibration& calibration = latency_calibration[latency_measure.queue.front()];
+    calibration.measured = state.latency_probe.status() == LatencyProbe::Status::DONE;
+    calibration.failure = nullptr;
+    if (calibration.measured) {
+        calibration.exclusive = saudio_exclusive();
+        calibration.device_ms = saudio_buffer_frames() * 1000.0f / state.sample_rate;
+        calibration.latency_ms = static_cast<float>(state.latency_probe.latencySeconds() * 1000.0);
+        calibration.spread_ms = static_cast<float>(state.latency_probe.spreadSeconds() * 1000.0);
+        calibration.offset_ms = std::clamp(calibration.latency_ms - calibration.device_ms, -50.0f, 250.0f);
+    } else if (state.latency_probe.status() == LatencyProbe::Status::NO_INPUT) {
+        calibration.failure = "nothing recorded";
+    } else {
+        calibration.failure = "no echo heard";
+    }
+    latency_measure.queue.erase(latency_measure.queue.begin());
+    next_latency_measurement();
+}
+
+// Audio Latency > Measure Latency: each profile's output latency as heard
+// back through an input device
+static void draw_latency_calibration_window(bool* p_open) {
+    ImGui::SetNextWindowSize(ImVec2(480, 260), ImGuiCond_FirstUseEver);
+    if (!ImGui::Begin("Latency Calibration", p_open)) {
+        ImGui::End();
+        return;
+    }
+    
+    ImGui::TextWrapped("Plays a short chirp through a latency profile and records it back from the default "
+                       "input device: pick a loopback or monitor input, or put a microphone by the speakers. "
+                       "The measured latency sets the output offset for that profile.");
+    bool measuring = !latency_measure.queue.empty();
+    ImGui::BeginDisabled(measuring);
+    if (ImGui::Button("Measure Current")) {
+        measure_latency({state.latency_profile});
+    }
+    ImGui::SameLine();
+    if (ImGui::Button("Measure All")) {
+        std::vector<int> profiles;
+        for (int i = 0; i < LATENCY_PROFILE_COUNT; ++i) profiles.push_back(i);
+        measure_latency(std::move(profiles));
+    }
+    ImGui::EndDisabled();
+    if (measuring) {
+        ImGui::SameLine();
+        if (ImGui::Button("Cancel")) {
+            cancel_latency_measurement();
+        } else {
+            ImGui::SameLine();
+            ImGui::Text("%s: probe %d of %d", LATENCY_PROFILES[latency_measure.queue.front()].name,
+                        std::min(state.latency_probe.sent() + 1, LatencyProbe::PROBES), LatencyProbe::PROBES);
+        }
+    }
+    ImGui::Separator();
+    
+    if (ImGui::BeginTable("##latency", 4, ImGuiTableFlags_RowBg)) {
+        ImGui::TableSetupColumn("Profile", ImGuiTableColumnFlags_WidthStretch);
+        ImGui::TableSetupColumn("Device", ImGuiTableColumnFlags_WidthFixed, 70.0f);
+        ImGui::TableSetupColumn("Measured", ImGuiTableColumnFlags_WidthFixed, 120.0f);
+        ImGui::TableSetupColumn("Offset", ImGuiTableColumnFlags_WidthFixed, 70.0f);
+        ImGui::TableHeadersRow();
+        for (int i = 0; i < LATENCY_PROFILE_COUNT; ++i) {
+            const LatencyCalibration& calibration = latency_calibration[i];
+            ImGui::TableNextRow();
+            ImGui::TableNextColumn();
+            ImGui::Text("%s%s", LATENCY_PROFILES[i].name, state.latency_profile == i ? " (in use)" : "");
+            if (calibration.measured) {
+                ImGui::TableNextColumn();
+                ImGui::Text("%.1f ms", calibration.device_ms);
+                ImGui::TableNextColumn();
+                ImGui::Text("%.1f ms (+-%.1f)", calibration.latency_ms, calibration.spread_ms * 0.5f);
+                ImGui::TableNextColumn();
+                ImGui::Text("%+.0f ms", calibration.offset_ms);
+            } else {
+                ImGui::TableNextColumn();
+                ImGui::TableNextColumn();
+                ImGui::TextDisabled("%s", calibration.failure ? calibration.failure : "-");
+            }
+        }
+        ImGui::EndTable();
+    }
+    ImGui::End();
+}
+
+// Startup does only what the first frame needs. NFD is set up by the first
+// dialog (see init_main_nfd), the NES screen texture by the first emulated
+// frame and the audio device on its own thread; each phase is timed for the
+// profiler window's Startup list.
 void init(void) {
-    sg_desc _sg_desc{};
-    _sg_desc.environment = sglue_environment();
-    _sg_desc.logger.func = slog_func;
-    sg_setup(_sg_desc);
+    FC_TRACE_THREAD("main");
+    Profiler::recordStartup("Process start to init", Profiler::sinceStart());
+    PROFILE_STARTUP("init");
+    {
+        PROFILE_STARTUP("sokol_gfx");
+        sg_desc _sg_desc{};
+        _sg_desc.environment = sglue_environment();
+        _sg_desc.logger.func = slog_func;
+        sg_setup(_sg_desc);
+    }
 
-    simgui_desc_t simgui_desc = { };
-    simgui_desc.logger.func = slog_func;
-    simgui_setup(&simgui_desc);
+    {
+        PROFILE_STARTUP("ImGui");
+        simgui_desc_t simgui_desc = { };
+        simgui_desc.logger.func = slog_func;
+        Profiler::countImGuiAllocations();
+        simgui_setup(&simgui_desc);
+    }
 
     // Use ImGui default dark theme (blue style)
     ImGui::StyleColorsDark();
 
     state.pass_action.colors[0] = { .load_action=SG_LOADACTION_CLEAR, .clear_value={0.1f, 0.1f, 0.1f, 1.0f } };
     
-    // Initialize sokol_audio with callback model
-    saudio_desc audio_desc = {};
-    audio_desc.sample_rate = state.sample_rate;
-    audio_desc.num_channels = 2; // Stereo
-    audio_desc.buffer_frames = 2048;  // ~46ms latency
-    audio_desc.stream_userdata_cb = audio_stream_callback;
-    audio_desc.user_data = nullptr;
-    audio_desc.logger.func = slog_func;
+    // Open the audio device first, so it opens while the rest starts; the
+    // ring has to exist before the first callback
+    state.audio_ring.init(AUDIO_RING_FRAMES, 2);
+    state.clip_recorder.setSampleRate(state.sample_rate);
+    state.play_calls.reserve(ApuSnapshotQueue::CAPACITY);  // the play hook never allocates
+    apply_latency_profile(state.latency_profile);
     
-    saudio_setup(&audio_desc);
-    state.audio_initialized = saudio_isvalid();
+    // Initialize NES Emulator (its audio is sized once the device is open;
+    // its thread starts then too)
+    {
+        PROFILE_STARTUP("NES emulator");
+        state.nes_emu.init(state.sample_rate);
+    }
+    
+    // Start spectrum analysis worker
+    state.analysis.start();
+    state.pitch_feed = state.analysis.subscribe(0);     // pitch tracking runs while the player needs it
+    
+    // Start NSF synthesis thread
+    state.synth_running.store(true);
+    state.synth_thread = std::thread(synthesis_thread_func);
+    
+    // Start background workers
+    state.jobs.init();
+    state.visualizer.setCanvasJobs(&state.canvas_jobs);
+    state.piano.setCanvasJobs(&state.canvas_jobs);
+    state.plugins.loadDirectory();
+    
+    // The saved library index shows at once; a rescan only re-reads changed files
+    PROFILE_STARTUP("Library index");
+    if (state.library.loadIndex() && !state.library.roots().empty()) {
+        state.library.scan(state.jobs);
+    }
+}
+
+// Peaks of 'length' seconds across 'size', one column per pixel: the min/max
+// envelope with the RMS inside it, brighter up to 'progress'
+static void draw_waveform(const WaveformPeaks& peaks, ImVec2 pos, ImVec2 size, float length, float progress) {
+    ImDrawList* draw_list = ImGui::GetWindowDrawList();
+    draw_list->AddRectFilled(pos, ImVec2(pos.x + size.x, pos.y + size.y), IM_COL32(20, 20, 36, 255), 4.0f);
+    
+    const std::vector<WaveformPeaks::Block>& blocks = peaks.blocks();
+    int columns = static_cast<int>(size.x);
+    if (columns <= 0 || length <= 0.0f) return;
+    float mid = pos.y + size.y * 0.5f;
+    float scale = size.y * 0.5f / 32768.0f;
+    double blocks_per_column = length / WaveformPeaks::BLOCK_SECONDS / columns;
+    
+    for (int x = 0; x < columns; ++x) {
+        size_t first = static_cast<size_t>(x * blocks_per_column);
+        size_t last = std::max(first + 1, static_cast<size_t>((x + 1) * blocks_per_column));
+        if (first >= blocks.size()) break;
+        last = std::min(last, blocks.size());
+        
+        int lo = INT16_MAX, hi = INT16_MIN, rms = 0;
+        for (size_t b = first; b < last; ++b) {
+            lo = std::min<int>(lo, blocks[b].min);
+            hi = std::max<int>(hi, blocks[b].max);
+            rms = std::max<int>(rms, blocks[b].rms);
+        }
+        
+        bool played = x < progress * columns;
+        float px = pos.x + x + 0.5f;
+        draw_list->AddLine(ImVec2(px, mid - hi * scale), ImVec2(px, mid - lo * scale + 1.0f),
+                           played ? IM_COL32(90, 130, 200, 255) : IM_COL32(60, 70, 110, 255));
+        draw_list->AddLine(ImVec2(px, mid - rms * scale), ImVec2(px, mid + rms * scale + 1.0f),
+                           played ? IM_COL32(150, 200, 255, 255) : IM_COL32(90, 105, 150, 255));
+    }
+}
+
+// Record the playing player's channel states, or replay a recording through
+// the visualizers without either player
+static void draw_session_menu() {
+    if (state.session_mode == SessionMode::RECORDING) {
+        if (ImGui::MenuItem("Stop Recording...")) {
+            state.session_mode = SessionMode::OFF;
+#ifdef __EMSCRIPTEN__
+            std::string path = WebFiles::savePath("session.fcss");
+            if (state.session_log.save(path.c_str())) WebFiles::download(path);
+#else
+            nfdu8filteritem_t filter[1] = {{"Snapshot Sessions", "fcss"}};
+            nfdu8char_t* outPath = nullptr;
+            init_main_nfd();
+            if (!state.session_log.empty() &&
+                NFD_SaveDialogU8(&outPath, filter, 1, nullptr, "session.fcss") == NFD_OKAY) {
+                state.session_log.save(outPath);
+                NFD_FreePathU8(outPath);
+            }
+#endif
+            state.session_log.clear();
+        }
+        ImGui::TextDisabled("%s: %u states, %.1f KB%s", state.session_nes ? "Game" : "Track",
+                            state.session_log.count(), state.session_log.byteSize() / 1024.0,
+                            state.session_ended ? " (channels changed, stopped)" : "");
+        return;
+    }
+    if (state.session_mode == SessionMode::REPLAYING) {
+        if (ImGui::MenuItem("Stop Replay")) stop_session_replay();
+        double shown = static_cast<double>(state.session_cursor.session) / state.session_log.sampleRate();
+        ImGui::TextDisabled("Replay: %.0f / %.0f s", shown, state.session_log.duration());
+        return;
+    }
+    bool nes_mode = current_mode == AppMode::NES_EMULATOR;
+    if (ImGui::MenuItem("Record Session", nullptr, false, nes_mode ? state.nes_rom_loaded : state.emu != nullptr)) {
+        start_session_recording();
+    }
+    if (ImGui::MenuItem("Replay Session...")) {
+#ifdef __EMSCRIPTEN__
+        WebFiles::pick(".fcss", [](const std::string& path) {
+            if (state.session_mode == SessionMode::OFF && state.session_log.load(path.c_str())) start_session_replay();
+        });
+#else
+        nfdu8filteritem_t filter[2] = {{"Snapshot Sessions", "fcss"}, {"All Files", "*"}};
+        nfdu8char_t* outPath = nullptr;
+        init_main_nfd();
+        if (NFD_OpenDialogU8(&outPath, filter, 2, nullptr) == NFD_OKAY) {
+            if (state.session_log.load(outPath)) start_session_replay();
+            NFD_FreePathU8(outPath);
+        }
+#endif
+    }
+}
+
+// A-B loop for practising a phrase: A marks the start at what is being
+// heard, B the end, which starts looping back to A
+static void draw_ab_loop_controls() {
+    long a = state.loop_a_ms.load();
+    long b = state.loop_b_ms.load();
+    long heard = static_cast<long>(state.presentation_time * 1000.0);
+    char label[32];
     
-    // Initialize Native File Dialog
-    NFD_Init();
+    if (a >= 0) snprintf(label, sizeof(label), "A %ld:%02ld.%ld###loop_a", a / 60000, a / 1000 % 60, a / 100 % 10);
+    else snprintf(label, sizeof(label), "A###loop_a");
+    if (ImGui::Button(label, ImVec2(0, 30))) {
+        set_ab_loop(heard, -1);
+    }
+    if (ImGui::IsItemHovered(ImGuiHoveredFlags_DelayNormal)) {
+        ImGui::SetTooltip("Mark the start of a loop at what is playing now");
+    }
+    ImGui::SameLine();
     
-    // Initialize NES Emulator
-    state.nes_emu.init(state.sample_rate);
+    ImGui::BeginDisabled(a < 0);
+    if (b > a) snprintf(label, sizeof(label), "B %ld:%02ld.%ld###loop_b", b / 60000, b / 1000 % 60, b / 100 % 10);
+    else snprintf(label, sizeof(label), "B###loop_b");
+    if (ImGui::Button(label, ImVec2(0, 30)) && heard > a) {
+        set_ab_loop(a, heard);
+    }
+    if (ImGui::IsItemHovered(ImGuiHoveredFlags_DelayNormal | ImGuiHoveredFlags_AllowWhenDisabled)) {
+        ImGui::SetTooltip("Mark the end and loop back to A, gaplessly, until cleared");
+    }
+    ImGui::SameLine();
+    if (ImGui::Button("Clear loop", ImVec2(0, 30))) {
+        set_ab_loop(-1, -1);
+    }
+    ImGui::EndDisabled();
 }
 
 void draw_player_window() {
@@ -577,20 +3121,42 @@ void draw_player_window() {
     if (ImGui::BeginMenuBar()) {
         if (ImGui::BeginMenu("File")) {
             if (ImGui::MenuItem("Open NSF...", "Ctrl+O")) {
-                nfdu8filteritem_t filterItem[2];
-                filterItem[0].name = "NES Sound Files";
-                filterItem[0].spec = "nsf,nsfe";
-                filterItem[1].name = "All Files";
-                filterItem[1].spec = "*";
-                
-                nfdu8char_t* outPath = nullptr;
-                nfdresult_t result = NFD_OpenDialogU8(&outPath, filterItem, 2, nullptr);
-                
-                if (result == NFD_OKAY) {
-                    load_nsf_file(outPath);
-                    postload_preprocess();
-                    NFD_FreePathU8(outPath);
+                request_load(LoadKind::MUSIC);
+            }
+            if (ImGui::MenuItem("Preprocess Whole Album", nullptr, &state.album_preprocess)) {
+                if (state.album_preprocess) start_album_preprocess();
+                else cancel_album_preprocess();
+            }
+            if (ImGui::MenuItem("Gapless Playback", nullptr, &state.gapless)) {
+                prestart_next_track();
+            }
+            if (ImGui::BeginMenu("Export", state.emu && !state.album_export.isRunning())) {
+                if (ImGui::MenuItem("Album...")) request_export(ExportContent::MIX, true);
+                if (ImGui::MenuItem("Track Stems...")) request_export(ExportContent::STEMS, false);
+                if (ImGui::MenuItem("Album Stems...")) request_export(ExportContent::STEMS, true);
+                if (ImGui::MenuItem("Track MIDI...")) request_export(ExportContent::MIDI, false);
+                if (ImGui::MenuItem("Album MIDI...")) request_export(ExportContent::MIDI, true);
+                ImGui::Separator();
+                if (ImGui::MenuItem("WAV", nullptr, state.export_format == ExportFormat::WAV)) {
+                    state.export_format = ExportFormat::WAV;
+                }
+                if (ImGui::MenuItem("FLAC", nullptr, state.export_format == ExportFormat::FLAC)) {
+                    state.export_format = ExportFormat::FLAC;
                 }
+                ImGui::EndMenu();
+            }
+            if (ImGui::MenuItem("Save Clip", "F9", false, state.emu && !state.clip_recorder.isSaving())) {
+                save_clip();
+            }
+            if (ImGui::IsItemHovered(ImGuiHoveredFlags_DelayNormal | ImGuiHoveredFlags_AllowWhenDisabled)) {
+                ImGui::SetTooltip("Save the last %d seconds heard as WAV and MIDI%s into\n%s",
+                                  ClipRecorder::SECONDS, state.clip_video ? " and video" : "",
+                                  ClipRecorder::directory().c_str());
+            }
+            ImGui::MenuItem("Clip Video", nullptr, &state.clip_video);
+            if (ImGui::BeginMenu("Session")) {
+                draw_session_menu();
+                ImGui::EndMenu();
             }
             ImGui::Separator();
             if (ImGui::MenuItem("Exit")) {
@@ -600,19 +3166,7 @@ void draw_player_window() {
         }
         if (ImGui::BeginMenu("Emulator")) {
             if (ImGui::MenuItem("Open NES ROM...", "Ctrl+R")) {
-                nfdu8filteritem_t filterItem[2];
-                filterItem[0].name = "NES ROM Files";
-                filterItem[0].spec = "nes";
-                filterItem[1].name = "All Files";
-                filterItem[1].spec = "*";
-                
-                nfdu8char_t* outPath = nullptr;
-                nfdresult_t result = NFD_OpenDialogU8(&outPath, filterItem, 2, nullptr);
-                
-                if (result == NFD_OKAY) {
-                    load_nes_rom(outPath);
-                    NFD_FreePathU8(outPath);
-                }
+                request_load(LoadKind::NES_ROM);
             }
             ImGui::MenuItem("Show Emulator Window", nullptr, &show_emulator);
             ImGui::EndMenu();
@@ -620,7 +3174,170 @@ void draw_player_window() {
         if (ImGui::BeginMenu("View")) {
             ImGui::MenuItem("Audio Visualizer", nullptr, &show_visualizer);
             ImGui::MenuItem("Piano Visualizer", nullptr, &show_piano);
+            ImGui::MenuItem("Profiler", nullptr, &show_profiler);
+            ImGui::MenuItem("6502 Profiler", nullptr, &show_cpu_profiler);
+            ImGui::MenuItem("Audio Telemetry", nullptr, &show_audio_telemetry);
+            ImGui::MenuItem("Background Jobs", nullptr, &show_jobs);
+            ImGui::MenuItem("Tracker", nullptr, &show_tracker);
+            ImGui::MenuItem("Library", "Ctrl+L", &show_library);
+            ImGui::MenuItem("Play Queue", nullptr, &show_play_queue);
+            ImGui::MenuItem("Track Spectrogram", nullptr, &show_track_spectrogram);
+            if (ImGui::MenuItem("Per-Voice Scopes", nullptr, &state.voice_scopes) &&
+                state.loaded_file[0] != '\0') {
+                // The mixing buffer is fixed at load time, so reopen the file
+                request_load(LoadKind::MUSIC, state.loaded_file);
+            }
+            ImGui::MenuItem("Pitch From Audio", nullptr, &state.audio_pitch);
+            if (ImGui::IsItemHovered(ImGuiHoveredFlags_DelayNormal)) {
+                ImGui::SetTooltip("Play the piano from pitches tracked in the audio instead of the\n"
+                                  "sound chip's registers (always, for files without them); with\n"
+                                  "Per-Voice Scopes each voice is tracked on its own");
+            }
+            bool overlay_feed = state.overlay_feed.isOpen();
+            if (ImGui::MenuItem("Overlay Feed", nullptr, &overlay_feed)) {
+                if (!overlay_feed) state.overlay_feed.close();
+                else if (!state.overlay_feed.open(state.analysis)) {
+                    snprintf(state.error_msg, sizeof(state.error_msg), "Could not create the overlay feed");
+                }
+            }
+            if (ImGui::IsItemHovered(ImGuiHoveredFlags_DelayNormal)) {
+                ImGui::SetTooltip("Publish the spectrum, levels, channel state and note-ons in the\n"
+                                  "shared memory segment %s for stream overlays\n"
+                                  "(OverlayFeed.h has the layout)", OverlayFeed::SEGMENT_NAME);
+            }
+            bool frame_share = state.frame_share.isOpen();
+            if (ImGui::MenuItem("Frame Share", nullptr, &frame_share, FrameShare::isSupported())) {
+                if (!frame_share) state.frame_share.close();
+                else if (!state.frame_share.open()) {
+                    snprintf(state.error_msg, sizeof(state.error_msg),
+                             "Could not share frames (needs a GPU that exports DMA-BUFs)");
+                }
+            }
+            if (ImGui::IsItemHovered(ImGuiHoveredFlags_DelayNormal | ImGuiHoveredFlags_AllowWhenDisabled)) {
+                if (!FrameShare::isSupported()) {
+                    ImGui::SetTooltip("GPU frame sharing isn't available on this platform yet");
+                } else if (state.frame_share.isOpen()) {
+                    ImGui::SetTooltip("Sharing the NES screen as a DMA-BUF on\n%s\n%d client(s) connected",
+                                      state.frame_share.socketPath(), state.frame_share.clientCount());
+                } else {
+                    ImGui::SetTooltip("Share the NES screen with capture tools as a GPU image\n"
+                                      "(no readback; FrameShare.h has the protocol)");
+                }
+            }
+            state.plugins.drawMenu();
             ImGui::Separator();
+            if (ImGui::BeginMenu("Audio Latency")) {
+                for (int i = 0; i < LATENCY_PROFILE_COUNT; ++i) {
+                    if (ImGui::MenuItem(LATENCY_PROFILES[i].name, nullptr, state.latency_profile == i,
+                                        latency_measure.queue.empty()) &&
+                        state.latency_profile != i) {
+                        apply_latency_profile(i);
+                    }
+                }
+                ImGui::Separator();
+#ifdef _WIN32
+                if (ImGui::MenuItem("Exclusive Mode", nullptr, &state.audio_exclusive, latency_measure.queue.empty())) {
+                    apply_latency_profile(state.latency_profile);  // reopens the device
+                }
+                if (ImGui::IsItemHovered(ImGuiHoveredFlags_DelayNormal)) {
+                    ImGui::SetTooltip("Take the device from the Windows mixer: no mixing or resampling\n"
+                                      "delay, and the period follows the latency profile. Other\n"
+                                      "programs go silent while it is held.%s",
+                                      state.audio_exclusive && state.audio_initialized && !saudio_exclusive()
+                                          ? "\n\nThe device refused; playing in shared mode" : "");
+                }
+#endif
+                bool realtime = state.realtime_audio.load(std::memory_order_relaxed);
+                if (ImGui::MenuItem("Real-time Priority", nullptr, &realtime)) {
+                    set_realtime_audio(realtime);
+                }
+                if (ImGui::IsItemHovered(ImGuiHoveredFlags_DelayNormal)) {
+                    ImGui::SetTooltip("Run synthesis and the audio callback at real-time priority\n"
+                                      "with the sample ring pinned in memory, so playback holds\n"
+                                      "up under heavy system load%s",
+                                      state.realtime_refused.load(std::memory_order_relaxed)
+                                          ? "\n\nThe OS refused real-time priority (on Linux this\n"
+                                            "needs an rtprio limit, e.g. the audio group's)"
+                                          : "");
+                }
+                ImGui::SetNextItemWidth(160.0f);
+                ImGui::SliderFloat("Output Offset", &state.output_offset_ms, -50.0f, 250.0f, "%.0f ms");
+                if (ImGui::IsItemHovered(ImGuiHoveredFlags_DelayNormal)) {
+                    ImGui::SetTooltip("Latency after the audio device (Bluetooth, TV processing);\n"
+                                      "positive values delay the visualizers further");
+                }
+                ImGui::MenuItem("Measure Latency...", nullptr, &show_latency_calibration);
+                if (ImGui::IsItemHovered(ImGuiHoveredFlags_DelayNormal)) {
+                    ImGui::SetTooltip("Set the output offset from a chirp recorded back through\n"
+                                      "an input device (capture needs ALSA or WASAPI)");
+                }
+                ImGui::EndMenu();
+            }
+            if (ImGui::BeginMenu("Frame Rate")) {
+                bool idle = state.frame_pacer.idleEnabled();
+                if (ImGui::MenuItem("Sleep When Unchanged", nullptr, &idle)) {
+                    state.frame_pacer.setIdleEnabled(idle);
+                }
+                ImGui::MenuItem("Power Saver", nullptr, &state.power_saver);
+                if (ImGui::IsItemHovered(ImGuiHoveredFlags_DelayNormal)) {
+                    ImGui::SetTooltip("With the window minimized or no visualizer open, render music\n"
+                                      "seconds ahead in bursts and let the CPU sleep in between.\n"
+                                      "Mute and tempo changes are heard after the queued audio.");
+                }
+                ImGui::Separator();
+                static const int FPS_CAPS[] = { 0, 60, 30, 15 };
+                for (int fps : FPS_CAPS) {
+                    char label[32];
+                    if (fps) snprintf(label, sizeof(label), "%d fps", fps);
+                    else snprintf(label, sizeof(label), "Display Rate");
+                    if (ImGui::MenuItem(label, nullptr, state.frame_pacer.maxFps() == fps)) {
+                        state.frame_pacer.setMaxFps(fps);
+                    }
+                }
+                ImGui::Separator();
+                bool variable_refresh = state.nes_emu.variableRefresh();
+                if (ImGui::MenuItem("Variable Refresh Display", nullptr, &variable_refresh)) {
+                    state.nes_emu.setVariableRefresh(variable_refresh);
+                }
+                if (ImGui::IsItemHovered(ImGuiHoveredFlags_DelayNormal)) {
+                    ImGui::SetTooltip("G-Sync/FreeSync: in the emulator, refresh once per NES frame\n"
+                                      "instead of repeating frames on an even cadence.\n"
+                                      "Needs vsync and the display's variable refresh enabled.");
+                }
+                ImGui::EndMenu();
+            }
+            if (ImGui::BeginMenu("Thread Placement")) {
+                const ThreadPlacement::Topology& topology = ThreadPlacement::topology();
+                bool placement = ThreadPlacement::enabled();
+                if (ImGui::MenuItem("Keep Deadline Threads on Performance Cores", nullptr, &placement,
+                                    topology.hybrid())) {
+                    ThreadPlacement::setEnabled(placement);
+                }
+                if (ImGui::IsItemHovered(ImGuiHoveredFlags_DelayNormal | ImGuiHoveredFlags_AllowWhenDisabled)) {
+                    ImGui::SetTooltip("Audio, synthesis and emulation stay off the efficiency cores;\n"
+                                      "batch jobs may run there. Only hybrid CPUs have a choice.");
+                }
+                if (topology.hybrid()) {
+                    ImGui::TextDisabled("%d of %d CPUs are performance cores", topology.performance, topology.cpus);
+                } else {
+                    ImGui::TextDisabled("%d CPUs, one core class", topology.cpus);
+                }
+                ImGui::Separator();
+                // Where each thread has actually been running
+                for (int r = 0; r < static_cast<int>(ThreadRole::COUNT); ++r) {
+                    ThreadRole role = static_cast<ThreadRole>(r);
+                    ThreadPlacement::Report report = ThreadPlacement::report(role);
+                    if (report.samples == 0) {
+                        ImGui::TextDisabled("%s: -", ThreadPlacement::roleName(role));
+                        continue;
+                    }
+                    ImGui::Text("%s: CPU %d%s, %.0f%% on performance cores%s", ThreadPlacement::roleName(role),
+                                report.last_cpu, report.last_performance ? " (P)" : " (E)",
+                                100.0 * report.performance_samples / report.samples,
+                                report.refused ? ", placement refused" : "");
+                }
+                ImGui::EndMenu();
+            }
             ImGui::MenuItem("ImGui Demo", nullptr, &show_demo_window);
             ImGui::EndMenu();
         }
@@ -651,20 +3368,7 @@ void draw_player_window() {
     
     ImGui::SameLine(ImGui::GetWindowWidth() - 100);
     if (ImGui::Button("Open...", ImVec2(90, 0))) {
-        nfdu8filteritem_t filterItem[2];
-        filterItem[0].name = "NES Sound Files";
-        filterItem[0].spec = "nsf,nsfe";
-        filterItem[1].name = "All Files";
-        filterItem[1].spec = "*";
-        
-        nfdu8char_t* outPath = nullptr;
-        nfdresult_t result = NFD_OpenDialogU8(&outPath, filterItem, 2, nullptr);
-        
-        if (result == NFD_OKAY) {
-            load_nsf_file(outPath);
-            postload_preprocess();
-            NFD_FreePathU8(outPath);
-        }
+        request_load(LoadKind::MUSIC);
     }
     
     // Error display
@@ -709,16 +3413,51 @@ void draw_player_window() {
         ImGui::SameLine();
         ImGui::Text("/ %d", state.track_count);
         
+        // Background preprocessing progress
+        if (state.preprocessing.load()) {
+            ImGui::SameLine();
+            ImGui::SetNextItemWidth(-1);
+            ImGui::ProgressBar(state.preprocess_progress.load(), ImVec2(-1, 0), "Analyzing notes...");
+        }
+        if (state.album_preprocess && state.track_count > 1) {
+            ImGui::TextColored(ImVec4(0.6f, 0.6f, 0.7f, 1.0f), "Album: %d / %d tracks ready",
+                               state.album_ready_count.load(), state.track_count - 1);
+        }
+        
+        // Album export progress, then the outcome of the last export
+        AlbumExporter& exporter = state.album_export;
+        if (exporter.isRunning()) {
+            char label[64];
+            snprintf(label, sizeof(label), "Exporting %d / %d tracks", exporter.tracksDone(), exporter.trackCount());
+            ImGui::ProgressBar(exporter.progress(), ImVec2(-70, 0), label);
+            ImGui::SameLine();
+            if (ImGui::Button("Cancel", ImVec2(-1, 0))) {
+                exporter.cancel();
+            }
+        } else if (exporter.trackCount() > 0) {
+            if (exporter.tracksFailed() > 0) {
+                ImGui::TextColored(ImVec4(1.0f, 0.6f, 0.3f, 1.0f), "Export: %d tracks written, %d failed (%s)",
+                                   exporter.tracksDone(), exporter.tracksFailed(), exporter.firstError().c_str());
+            } else {
+                ImGui::TextColored(ImVec4(0.6f, 0.6f, 0.7f, 1.0f), "Export: %d / %d tracks written to %s",
+                                   exporter.tracksDone(), exporter.trackCount(), exporter.outputDirectory().c_str());
+            }
+        }
+        
+        // The last clip saved, or being saved
+        if (state.clip_recorder.isSaving()) {
+            ImGui::TextColored(ImVec4(0.6f, 0.6f, 0.7f, 1.0f), "Saving clip...");
+        } else if (std::string clip = state.clip_recorder.status(); !clip.empty()) {
+            ImGui::TextColored(ImVec4(0.6f, 0.6f, 0.7f, 1.0f), "Clip: %s", clip.c_str());
+        }
+        
         ImGui::Separator();
         
         // Playback position and seek bar
         {
-            long pos = gme_tell(state.emu);
-            long length = 0;
-            if (gme_track_info(state.emu, &info, state.current_track) == nullptr) {
-                length = info.length > 0 ? info.length : 150000; // Default 2:30 if unknown
-            }
-            if (length <= 0) length = 150000; // Fallback
+            // While scrubbing, the cursor rather than what is still playing
+            long pos = state.scrub.active() ? state.scrub.cursor() : gme_tell(state.emu);
+            long length = track_length_msec(state.emu, state.current_track);
             
             // Format time strings
             int pos_sec = (pos / 1000) % 60;
@@ -740,19 +3479,49 @@ void draw_player_window() {
             float progress = static_cast<float>(pos) / static_cast<float>(length);
             progress = std::clamp(progress, 0.0f, 1.0f);
             
+            // Where in the track each channel plays; drag to scrub
+            float overview_seek = 0.0f;
+            if (state.piano.drawTrackOverview("##overview", slider_width, 24.0f, length / 1000.0f,
+                                              pos / 1000.0f, &overview_seek)) {
+                scrub_to(static_cast<long>(overview_seek * 1000.0f));
+            }
+            
+            // The waveform shows through the slider's frame
+            std::shared_ptr<const WaveformPeaks> waveform;
+            std::shared_ptr<const TrackSpectrogram> spectrogram;
+            {
+                std::lock_guard<std::mutex> lock(state.waveform_mutex);
+                waveform = state.waveform;
+                spectrogram = state.spectrogram;
+            }
+            
+            // The whole track's spectrum, from preprocessing; drag to scrub
+            if (show_track_spectrogram &&
+                state.spectrogram_view.draw("##track_spectrogram", spectrogram, slider_width, 32.0f,
+                                            length / 1000.0f, pos / 1000.0f, &overview_seek)) {
+                scrub_to(static_cast<long>(overview_seek * 1000.0f));
+            }
+            float frame_alpha = 1.0f;
+            if (waveform && !waveform->empty()) {
+                draw_waveform(*waveform, ImGui::GetCursorScreenPos(), ImVec2(slider_width, ImGui::GetFrameHeight()),
+                              length / 1000.0f, progress);
+                frame_alpha = 0.35f;
+            }
+            
             ImGui::SetNextItemWidth(slider_width);
-            ImGui::PushStyleColor(ImGuiCol_FrameBg, ImVec4(0.15f, 0.15f, 0.25f, 1.0f));
-            ImGui::PushStyleColor(ImGuiCol_FrameBgHovered, ImVec4(0.20f, 0.20f, 0.35f, 1.0f));
-            ImGui::PushStyleColor(ImGuiCol_FrameBgActive, ImVec4(0.25f, 0.25f, 0.40f, 1.0f));
+            ImGui::PushStyleColor(ImGuiCol_FrameBg, ImVec4(0.15f, 0.15f, 0.25f, frame_alpha));
+            ImGui::PushStyleColor(ImGuiCol_FrameBgHovered, ImVec4(0.20f, 0.20f, 0.35f, frame_alpha));
+            ImGui::PushStyleColor(ImGuiCol_FrameBgActive, ImVec4(0.25f, 0.25f, 0.40f, frame_alpha));
             ImGui::PushStyleColor(ImGuiCol_SliderGrab, ImVec4(0.50f, 0.70f, 1.0f, 1.0f));
             ImGui::PushStyleColor(ImGuiCol_SliderGrabActive, ImVec4(0.60f, 0.80f, 1.0f, 1.0f));
             ImGui::PushStyleVar(ImGuiStyleVar_GrabMinSize, 12.0f);
             ImGui::PushStyleVar(ImGuiStyleVar_FrameRounding, 4.0f);
             
-            if (ImGui::SliderFloat("##seek", &progress, 0.0f, 1.0f, "")) {
-                // User is seeking - send request to audio thread
-                long new_pos = static_cast<long>(progress * length);
-                state.seek_request.store(new_pos);
+            // Scrubbed while held, even when the value hasn't changed; the
+            // release seeks (finish_scrub)
+            ImGui::SliderFloat("##seek", &progress, 0.0f, 1.0f, "");
+            if (ImGui::IsItemActive()) {
+                scrub_to(static_cast<long>(progress * length));
             }
             
             ImGui::PopStyleVar(2);
@@ -777,13 +3546,39 @@ void draw_player_window() {
                 color_left, color_right, color_right, color_left
             );
             
-            // Check if track ended
-            if (state.is_playing.load() && gme_track_ended(state.emu)) {
-                // Auto-advance to next track
+            // A-B loop marks, with the looped stretch shaded
+            long loop_a = state.loop_a_ms.load();
+            long loop_b = state.loop_b_ms.load();
+            auto loop_x = [&](long msec) {
+                return bar_pos.x + slider_width * std::clamp(msec / static_cast<float>(length), 0.0f, 1.0f);
+            };
+            if (loop_a >= 0 && loop_b > loop_a) {
+                draw_list->AddRectFilled(ImVec2(loop_x(loop_a), bar_pos.y), ImVec2(loop_x(loop_b), bar_pos.y + 20),
+                                         IM_COL32(255, 200, 80, 40));
+                draw_list->AddLine(ImVec2(loop_x(loop_b), bar_pos.y), ImVec2(loop_x(loop_b), bar_pos.y + 20),
+                                   IM_COL32(255, 200, 80, 255), 2.0f);
+            }
+            if (loop_a >= 0) {
+                draw_list->AddLine(ImVec2(loop_x(loop_a), bar_pos.y), ImVec2(loop_x(loop_a), bar_pos.y + 20),
+                                   IM_COL32(255, 200, 80, 255), 2.0f);
+            }
+            
+            // Check if track ended (and the queued tail has been heard)
+            // A pre-start still running for the next track is waited for: the
+            // synthesis thread swaps it in once ready
+            bool prestart_pending = state.prestart_job && !state.prestart_job->isDone() &&
+                                    state.prestart_track == state.current_track + 1;
+            if (state.is_playing.load() && state.synth_track_ended.load() && state.audio_ring.available() == 0 &&
+                !prestart_pending) {
+                // Auto-advance to next track, then to the next queued file
+                std::string next_file;
+                bool waiting = false;
                 if (state.current_track < state.track_count - 1) {
                     state.current_track++;
                     start_track_with_preprocess(state.current_track);
-                } else {
+                } else if (state.play_queue.nextAfter(state.loaded_file, next_file, waiting)) {
+                    if (request_load(LoadKind::MUSIC, next_file.c_str(), 0)) state.is_playing.store(false);
+                } else if (!waiting) {
                     state.is_playing.store(false);
                 }
             }
@@ -817,7 +3612,8 @@ void draw_player_window() {
             // Stop
             if (ImGui::Button("[]", ImVec2(40, 30))) {
                 state.is_playing.store(false);
-                // Reset to beginning of track
+                // Reset to beginning of track (untimed, it runs when playback resumes)
+                state.seek_requested_ns.store(0);
                 state.seek_request.store(0);
             }
             ImGui::SameLine();
@@ -829,6 +3625,11 @@ void draw_player_window() {
                     start_track_with_preprocess(state.current_track);
                 }
             }
+            // Only gme's NSF emulator can save the loop start
+            if (state.apu_tap.nsf) {
+                ImGui::SameLine(0.0f, 20.0f);
+                draw_ab_loop_controls();
+            }
         }
         ImGui::EndGroup();
         
@@ -841,40 +3642,49 @@ void draw_player_window() {
         ImGui::SetNextItemWidth(200);
         if (ImGui::SliderFloat("Volume", &state.volume_db, -40.0f, 6.0f, "%.1f dB")) {
             // Volume is applied in audio callback
+            state.volume_gain.store(std::pow(10.0f, state.volume_db / 20.0f), std::memory_order_relaxed);
         }
         ImGui::SameLine();
         if (ImGui::Button("0 dB")) {
             state.volume_db = 0.0f;
+            state.volume_gain.store(1.0f, std::memory_order_relaxed);
+        }
+        ImGui::SameLine();
+        ImGui::Checkbox("Normalize loudness", &state.normalize_loudness);
+        if (ImGui::IsItemHovered(ImGuiHoveredFlags_DelayNormal)) {
+            ImGui::SetTooltip("Play library tracks at %.0f LUFS, from their measured loudness", NsfLibrary::REFERENCE_LUFS);
         }
         
         // Tempo
         ImGui::SetNextItemWidth(200);
+        // A tempo change drops gme's saved loop start, so the loop is set again
         if (ImGui::SliderFloat("Tempo", &state.tempo, 0.25f, 2.0f, "%.2fx")) {
             gme_set_tempo(state.emu, state.tempo);
+            set_ab_loop(state.loop_a_ms.load(), state.loop_b_ms.load());
         }
         ImGui::SameLine();
         if (ImGui::Button("1.0x")) {
             state.tempo = 1.0f;
             gme_set_tempo(state.emu, state.tempo);
+            set_ab_loop(state.loop_a_ms.load(), state.loop_b_ms.load());
         }
         
         // Voice info
         ImGui::Separator();
         ImGui::Text("NES APU Channels:");
         
-        int voice_count = gme_voice_count(state.emu);
-        const char** voice_names = gme_voice_names(state.emu);
+        const ChannelLayout& layout = state.visualizer.channelLayout();
+        int channel_count = layout.size();
         
-        ImGui::Columns(voice_count, "voices", false);
-        for (int i = 0; i < voice_count && i < 5; ++i) {
-            NesChannel channel = static_cast<NesChannel>(i);
-            bool muted = state.visualizer.isChannelMuted(channel);
+        ImGui::Columns(std::min(channel_count, 8), "voices", false);
+        for (int i = 0; i < channel_count; ++i) {
+            bool muted = state.visualizer.isChannelMuted(i);
             
-            ImGui::PushStyleColor(ImGuiCol_CheckMark, ChannelColors[i]);
+            ImGui::PushStyleColor(ImGuiCol_CheckMark, ChannelColor(layout[i]));
             char label[64];
-            snprintf(label, sizeof(label), "%s##ch%d", voice_names[i], i);
+            snprintf(label, sizeof(label), "%s##ch%d", layout[i].name, i);
             if (ImGui::Checkbox(label, &muted)) {
-                state.visualizer.setChannelMute(channel, muted);
+                state.visualizer.setChannelMute(i, muted);
             }
             ImGui::PopStyleColor();
             
@@ -893,7 +3703,23 @@ void draw_player_window() {
     
     // Status bar
     if (state.audio_initialized) {
-        ImGui::TextColored(ImVec4(0.3f, 0.8f, 0.3f, 1.0f), "Audio: Ready (%ld Hz)", state.sample_rate);
+        ImGui::TextColored(ImVec4(0.3f, 0.8f, 0.3f, 1.0f), "Audio: Ready (%ld Hz%s)", state.sample_rate,
+                           saudio_exclusive() ? ", exclusive" : "");
+        ImGui::SameLine();
+        ImGui::TextColored(ImVec4(0.6f, 0.6f, 0.7f, 1.0f), "Buffer: %d/%d  Underruns: %u  Overruns: %u",
+                           state.audio_ring.available(), state.audio_ring.capacity(),
+                           state.audio_underruns.load(), state.audio_overruns.load());
+        
+        // Measured output latency: what the callback finds queued plus the device buffer
+        float ms_per_frame = 1000.0f / state.sample_rate;
+        float device_ms = saudio_buffer_frames() * ms_per_frame;
+        float queue_ms = state.queued_frames_avg.load(std::memory_order_relaxed) * ms_per_frame;
+        ImGui::TextColored(ImVec4(0.6f, 0.6f, 0.7f, 1.0f), "Latency: %.1f ms (device %.1f + queue %.1f)",
+                           device_ms + queue_ms, device_ms, queue_ms);
+        ImGui::SameLine();
+        ImGui::TextColored(ImVec4(0.6f, 0.6f, 0.7f, 1.0f), "Seek: %.1f ms (max %.1f)",
+                           state.seek_latency_ms.load(std::memory_order_relaxed),
+                           state.seek_latency_max_ms.load(std::memory_order_relaxed));
     } else {
         ImGui::TextColored(ImVec4(0.8f, 0.3f, 0.3f, 1.0f), "Audio: Not initialized");
     }
@@ -901,29 +3727,208 @@ void draw_player_window() {
     ImGui::End();
 }
 
+// Batch synthesis while nothing shows what is playing. Leaving a batch, the
+// queued seconds were never analysed, so synthesis picks up again from what
+// the speakers have reached and the visualizers have audio to follow.
+static void update_power_saver() {
+    bool watched = show_visualizer || show_piano || show_tracker || show_audio_telemetry || show_profiler;
+    bool batching = state.power_saver && current_mode != AppMode::NES_EMULATOR && state.emu &&
+                    (state.window_hidden || !watched);
+    state.frame_pacer.setPowerSaving(batching);
+    if (batching) {
+        // The play time still ticks over in the player window
+        static auto last_tick = std::chrono::steady_clock::now();
+        auto now = std::chrono::steady_clock::now();
+        if (!state.window_hidden && state.is_playing.load() && now - last_tick >= std::chrono::milliseconds(500)) {
+            last_tick = now;
+            state.frame_pacer.requestFrame();
+        }
+    }
+    if (batching == state.synth_batching.load()) return;
+    state.synth_batching.store(batching);
+    wake_synthesis();
+    if (batching || !state.is_playing.load()) return;
+    
+    std::lock_guard<std::mutex> lock(audio_mutex);
+    int queued = state.audio_ring.available();
+    if (state.emu && queued > state.synth_target_frames.load() + SYNTH_CHUNK_FRAMES) {
+        long heard = gme_tell(state.emu) - static_cast<long>(static_cast<int64_t>(queued) * 1000 / state.sample_rate);
+        request_seek(std::max(heard, 0L));
+    }
+}
+
+// gme's blocks (the emulators, their Blip_Buffers) bypass operator new and
+// are counted by the library; fold what changed into the profiler's figures
+static void update_library_memory() {
+    static long reported_bytes = 0;
+    static long reported_blocks = 0;
+    long bytes = 0;
+    long blocks = 0;
+    gme_memory_usage(&bytes, &blocks);
+    Profiler::trackMemory(MemoryTag::Emulation, bytes - reported_bytes, static_cast<uint64_t>(blocks - reported_blocks));
+    reported_bytes = bytes;
+    reported_blocks = blocks;
+}
+
+// Whether anything on screen is moving without input: playback, emulation,
+// or background work with a progress display
+static bool ui_is_animating() {
+    if (state.is_playing.load() && !state.synth_batching.load()) return true;
+    if (current_mode == AppMode::NES_EMULATOR && state.nes_rom_loaded && state.nes_emu.isRunning()) return true;
+    if (state.loader_busy.load() || state.export_dialog_busy.load()) return true;
+    if (state.preprocessing.load() || state.album_export.isRunning()) return true;
+    if (state.library.isScanning() || state.library.isMeasuring() || state.library_dialog_busy.load()) return true;
+    if (show_profiler) return true;  // live timings
+    if (show_jobs && state.jobs.isBusy()) return true;
+    if (!latency_measure.queue.empty()) return true;  // the probe runs from the frame loop
+    for (const JobHandle& job : state.album_jobs) {
+        if (!job->isDone()) return true;
+    }
+    return false;
+}
+
 void frame(void) {
+    state.input_latency.update(state.nes_emu);  // the swap of the last frame has returned
+    update_power_saver();
+    
+    // A skipped frame builds no UI and presents nothing
+    if (ui_is_animating()) state.frame_pacer.notifyActivity();
+    if (current_mode == AppMode::NES_EMULATOR && state.nes_emu.variableRefresh()) {
+        state.frame_pacer.holdUntil(state.nes_emu.nextPresentTime());
+    }
+    if (!state.frame_pacer.beginFrame()) return;
+    PROFILE_STAGE(UiFrame);
+    auto frame_start = std::chrono::steady_clock::now();
+    FrameArena::local().reset();  // last frame's scratch
+    state.frame_share.newFrame();
+    
     const int width = sapp_width();
     const int height = sapp_height();
-    simgui_new_frame({ width, height, sapp_frame_duration(), sapp_dpi_scale() });
+    double delta_time = state.frame_pacer.frameSeconds() > 0.0 ? state.frame_pacer.frameSeconds() : sapp_frame_duration();
+    simgui_new_frame({ width, height, delta_time, sapp_dpi_scale() });
 
-    // Run NES emulator frame if active
-    if (current_mode == AppMode::NES_EMULATOR && state.nes_emu.isRunning()) {
-        // Update input from keyboard (only if ImGui doesn't want keyboard)
-        if (!ImGui::GetIO().WantCaptureKeyboard) {
-            update_nes_input();
-        }
+    if (static bool first_frame = true; first_frame) {
+        first_frame = false;
+        Profiler::recordStartup("Process start to first frame", Profiler::sinceStart());
+    }
+    finish_audio_open();
+    update_latency_measurement();
+    
+    // Switch in a file the loader thread has finished opening
+    install_loaded_file();
+    finish_gapless_switch();
+    start_pending_export();
+    start_pending_library_scan();
+    start_library_measure();
+    start_queued_file();
+    if (current_mode != AppMode::NES_EMULATOR) update_track_gain();
+    
+    // Channel meters, the live keyboard, the scopes and the piano roll all
+    // follow what the active player's audio has reached at the speakers
+    bool nes_mode = current_mode == AppMode::NES_EMULATOR;
+    static bool presented_nes_mode = false;
+    if (nes_mode != presented_nes_mode) {
+        presented_nes_mode = nes_mode;
+        state.apu_snapshot_seen = 0;  // sequence numbers are per queue
+        state.apu_snapshot.store(ApuFrameSnapshot());
+    }
+    bool replaying = state.session_mode == SessionMode::REPLAYING;
+    if (replaying) {
+        present_session_replay();
+    } else if (!present_heard_audio(nes_mode)) {
+        // Nothing stamped yet: the player's own clock, less the device buffer
+        double device_s = (state.audio_initialized ? saudio_buffer_frames() : 0) / static_cast<double>(state.sample_rate);
+        double synth_time = nes_mode ? static_cast<double>(state.nes_emu.getCpuCycles()) / 1789773.0
+                                     : state.playback_time.load();
+        state.presentation_time = std::max(synth_time - device_s - state.output_offset_ms / 1000.0, 0.0);
+    }
+    const ChannelLayout& player_layout = nes_mode ? state.nes_channel_layout : state.channel_layout;
+    record_session(nes_mode, player_layout);
+    bool audio_pitch = !nes_mode && !replaying && state.emu && (state.audio_pitch || !state.apu_tap.valid());
+    track_audio_pitch(audio_pitch);
+    const ApuSnapshotLock* apu_source = audio_pitch ? &state.pitch_snapshot : &state.apu_snapshot;
+    const ChannelLayout& layout = replaying ? state.session_log.layout() : audio_pitch ? state.pitch_layout : player_layout;
+    state.visualizer.setApuSource(apu_source);
+    state.visualizer.setChannelLayout(layout);
+    if (nes_mode) state.nes_emu.setMuteMask(state.visualizer.getMuteMask());  // the channel toggles mute gme voices
+    state.piano.setApuSource(apu_source);
+    state.piano.setChannelLayout(layout);
+    state.piano.setLiveRoll(nes_mode || replaying || audio_pitch);  // a game, a replay or what is heard: no preprocessed notes
+    state.piano.recordLiveNotes();
+    {
+        ApuFrameSnapshot heard;
+        apu_source->load(heard);
+        bool playing = nes_mode ? state.nes_emu.isRunning() : state.is_playing.load();
+        if (state.overlay_feed.isOpen()) state.overlay_feed.publish(heard, layout, state.presentation_time, playing);
+        state.plugins.publish(heard, layout, state.presentation_time, playing);
+    }
+    if (state.piano.isLookaheadEnabled() && state.nes_rom_loaded &&
+        state.nes_lookahead.update(state.nes_emu, state.jobs)) {
+        state.piano.setLookahead(state.nes_lookahead.frames());
+    }
+    
+    // Rows are one play routine call: a video frame for a game, the NSF's play rate for a track
+    if (nes_mode) {
+        state.tracker.update(state.nes_emu.apuWriteLog(), player_layout, TrackerView::NES_ROW_CLOCKS,
+                             TrackerView::NES_ROW_ORIGIN);
+    } else if (state.apu_tap.nsf) {
+        state.tracker.update(state.apu_writes, player_layout, state.apu_tap.nsf->play_period_clocks(), 0);
+    }
+
+    // The emulator runs on its own thread; pads go to it from input() as
+    // keys change, here just the hotkeys and its newest frame
+    if (current_mode == AppMode::NES_EMULATOR) {
+        bool keyboard_free = !ImGui::GetIO().WantCaptureKeyboard;
+        
+        // Hold R to rewind
+        bool ctrl = key_states[SAPP_KEYCODE_LEFT_CONTROL] || key_states[SAPP_KEYCODE_RIGHT_CONTROL];
+        state.nes_emu.setRewinding(keyboard_free && !ctrl && key_states[SAPP_KEYCODE_R]);
         
-        // Run one frame of emulation
-        state.nes_emu.runFrame();
+        // Hold Tab (or toggle from the menu) for turbo
+        state.nes_emu.setTurbo(state.nes_turbo || (keyboard_free && key_states[SAPP_KEYCODE_TAB]));
+        
+        bool screen_changed = state.nes_emu.presentFrame();
+        if (state.frame_share.isOpen()) {
+            int screen_width, screen_height;
+            state.nes_emu.screenSize(screen_width, screen_height);
+            state.frame_share.publish(FrameShare::Source::NES_SCREEN, state.nes_emu.screenView(),
+                                      screen_width, screen_height, screen_changed);
+        }
     }
 
     // Main player window
     draw_player_window();
+    finish_scrub();
     
     // NES Emulator window
     if (show_emulator) {
         draw_emulator_window(&show_emulator);
     }
+    if (show_ppu_viewer) {
+        state.ppu_viewer.drawWindow(state.nes_emu, &show_ppu_viewer);
+    }
+    if (show_ram_search) {
+        state.ram_search.drawWindow(state.nes_emu, &show_ram_search);
+    }
+    if (show_input_latency && state.input_latency.drawWindow(&show_input_latency, state.nes_emu)) {
+        load_latency_test_rom();
+    }
+    // The instrumented frame loop only runs while the window is open
+    state.nes_emu.setDebuggerAttached(show_nes_debugger);
+    if (show_nes_debugger) {
+        state.nes_debugger.drawWindow(state.nes_emu, &show_nes_debugger);
+    }
+    if (show_tracker) {
+        state.tracker.drawWindow(&show_tracker);
+    }
+    
+    // Library window
+    if (show_play_queue) {
+        draw_play_queue_window(&show_play_queue);
+    }
+    if (show_library) {
+        draw_library_window(&show_library);
+    }
     
     // Visualizer window
     if (show_visualizer) {
@@ -932,30 +3937,131 @@ void frame(void) {
     
     // Piano visualizer window
     if (show_piano) {
-        float current_time = (current_mode == AppMode::NES_EMULATOR) 
-            ? static_cast<float>(state.nes_emu.getCpuCycles()) / 1789773.0f
-            : state.playback_time.load();
-        state.piano.drawPianoWindow(&show_piano, current_time);
+        // A scrub shows its cursor at once, from the preprocessed notes
+        double piano_time = state.scrub.active() ? state.scrub.cursor() / 1000.0 : state.presentation_time;
+        state.piano.drawPianoWindow(&show_piano, static_cast<float>(piano_time));
+    }
+    
+    // Audio callback telemetry is drained every frame so CSV recording keeps up
+    state.audio_telemetry.update();
+    if (show_jobs) {
+        draw_jobs_window(&show_jobs);
+    }
+    if (show_audio_telemetry) {
+        state.audio_telemetry.drawWindow(&show_audio_telemetry);
+    }
+    if (show_latency_calibration) {
+        draw_latency_calibration_window(&show_latency_calibration);
+    }
+    
+    // Stage timings; recording only runs while the window is open
+    update_library_memory();
+    Profiler::setEnabled(show_profiler);
+    if (show_profiler) {
+        Profiler::drawWindow(&show_profiler);
+    }
+    
+    // 6502 hotspots of whichever CPU makes the sound; counting only runs while the window is open
+    bool nes_cpu = current_mode == AppMode::NES_EMULATOR;
+    CpuProfiler& cpu_profiler = nes_cpu ? state.nes_emu.cpuProfiler() : state.nsf_cpu_profiler;
+    state.nsf_cpu_profiler.setEnabled(show_cpu_profiler && !nes_cpu);
+    state.nes_emu.cpuProfiler().setEnabled(show_cpu_profiler && nes_cpu);
+    if (show_cpu_profiler &&
+        cpu_profiler.drawWindow(nes_cpu ? "6502 Profiler (game)###cpu_profiler" : "6502 Profiler (NSF)###cpu_profiler",
+                                &show_cpu_profiler)) {
+#ifdef __EMSCRIPTEN__
+        std::string path = WebFiles::savePath("cpu_profile.json");
+        CpuProfiler::Snapshot report = cpu_profiler.snapshot();
+        if (report && CpuProfiler::exportJson(*report, path.c_str())) WebFiles::download(path);
+#else
+        nfdu8filteritem_t jsonFilter[1];
+        jsonFilter[0].name = "JSON";
+        jsonFilter[0].spec = "json";
+        nfdu8char_t* outPath = nullptr;
+        init_main_nfd();
+        if (NFD_SaveDialogU8(&outPath, jsonFilter, 1, nullptr, "cpu_profile.json") == NFD_OKAY) {
+            CpuProfiler::Snapshot report = cpu_profiler.snapshot();
+            if (report && !CpuProfiler::exportJson(*report, outPath)) {
+                snprintf(state.error_msg, sizeof(state.error_msg), "Could not write %s", outPath);
+            }
+            NFD_FreePathU8(outPath);
+        }
+#endif
     }
     
     // ImGui demo window
     if (show_demo_window) {
         ImGui::ShowDemoWindow(&show_demo_window);
     }
+    
+    state.plugins.drawWindows();
+    
+    // Every window is laid out: put the canvases built meanwhile in place
+    {
+        PROFILE_STAGE(CanvasSplice);
+        state.canvas_jobs.splice();
+        state.plugins.splice();
+    }
+
+    // The frame's cost for the NES frame skip, without waiting for a swapchain image
+    std::chrono::steady_clock::duration frame_cost = std::chrono::steady_clock::now() - frame_start;
 
     sg_pass _sg_pass{};
     _sg_pass = { .action = state.pass_action, .swapchain = sglue_swapchain() };
 
     sg_begin_pass(&_sg_pass);
-    simgui_render();
+    {
+        PROFILE_STAGE(ImGuiRender);
+        auto render_start = std::chrono::steady_clock::now();
+        simgui_render();
+        frame_cost += std::chrono::steady_clock::now() - render_start;
+    }
     sg_end_pass();
+    state.nes_emu.reportRenderCost(std::chrono::duration<double>(frame_cost).count());
     sg_commit();
+    FC_TRACE_FRAME();
 }
 
 void cleanup(void) {
     // Stop audio playback
     state.is_playing.store(false);
     
+    // Let an in-flight load finish (an open dialog has to be closed first)
+    if (state.loader_thread.joinable()) {
+        state.loader_thread.join();
+    }
+    state.loader_result.reset();
+    if (state.export_thread.joinable()) {
+        state.export_thread.join();
+    }
+    if (state.library_thread.joinable()) {
+        state.library_thread.join();
+    }
+    
+    // Stop background jobs
+    state.library.shutdown();
+    state.play_queue.shutdown();
+    cancel_preprocessing();
+    cancel_album_preprocess();
+    cancel_prestart();
+    state.album_export.cancel();
+    state.clip_recorder.cancel();
+    state.jobs.shutdown();
+    
+    // Stop synthesis thread
+    state.synth_running.store(false);
+    wake_synthesis();
+    if (state.synth_thread.joinable()) {
+        state.synth_thread.join();
+    }
+    
+    // Stop spectrum analysis worker and the emulation thread
+    state.overlay_feed.close();
+    state.plugins.unloadAll();
+    state.analysis.unsubscribe(state.pitch_feed);
+    state.analysis.stop();
+    state.nes_emu.stopThread();
+    
     // Wait for audio thread to finish
     {
         std::lock_guard<std::mutex> lock(audio_mutex);
@@ -964,38 +4070,83 @@ void cleanup(void) {
             gme_delete(state.emu);
             state.emu = nullptr;
         }
+        state.retired_track.reset();
+        state.apu_tap = ApuTap();
+        state.voice_buffer.reset();
     }
+    state.scrub.clear();
+    state.emu_pool.reset();
     
-    // Cleanup sokol_audio
-    if (state.audio_initialized) {
+    // Cleanup sokol_audio off the main thread, like the open: WASAPI's
+    // shutdown uninitializes COM on the calling thread
+    if (state.audio_device_thread.joinable()) {
+        state.audio_device_thread.join();
+    }
+    if (state.audio_setup_called) {
+#ifdef __EMSCRIPTEN__
         saudio_shutdown();
+#else
+        std::thread([] { saudio_shutdown(); }).join();
+#endif
     }
     
-    // Cleanup Native File Dialog
-    NFD_Quit();
+#ifndef __EMSCRIPTEN__
+    // Cleanup Native File Dialog, if a dialog ever set it up
+    quit_main_nfd();
+#endif
     
+    state.visualizer.destroyTextures();
+    state.piano.destroyRenderResources();
+    state.spectrogram_view.destroy();
+    state.ppu_viewer.destroyTextures();
+    state.frame_share.shutdown();
     simgui_shutdown();
     sg_shutdown();
 }
 
+// Route dropped files: ROMs to the emulator, the rest to the play queue
+static void open_dropped_files(const std::vector<std::string>& paths, bool start) {
+    std::vector<std::string> queued;
+    for (const std::string& path : paths) {
+        if (has_extension(path.c_str(), "nes")) {
+            request_load(LoadKind::NES_ROM, path.c_str());
+        } else {
+            queued.push_back(path);
+        }
+    }
+    if (!queued.empty()) {
+        state.play_queue.add(std::move(queued), state.jobs, start);
+        show_play_queue = true;
+    }
+}
+
 void input(const sapp_event* ev) {
+    state.frame_pacer.notifyInput();
     simgui_handle_event(ev);
     
-    // Handle file drag and drop
+    if (ev->type == SAPP_EVENTTYPE_ICONIFIED || ev->type == SAPP_EVENTTYPE_SUSPENDED) {
+        state.window_hidden = true;
+    } else if (ev->type == SAPP_EVENTTYPE_RESTORED || ev->type == SAPP_EVENTTYPE_RESUMED) {
+        state.window_hidden = false;
+    }
+    
+    // Handle file drag and drop: a ROM opens in the emulator, everything else
+    // (music files, folders) goes to the play queue, whose first playable
+    // file starts once read - or, with Shift held, just joins the queue
     if (ev->type == SAPP_EVENTTYPE_FILES_DROPPED) {
+        bool start = !(ev->modifiers & SAPP_MODIFIER_SHIFT);
+#ifdef __EMSCRIPTEN__
+        // The page only names the files; their data is fetched first
+        WebFiles::fetchDropped([start](std::vector<std::string> paths) { open_dropped_files(paths, start); });
+#else
         const int num_files = sapp_get_num_dropped_files();
-        if (num_files > 0) {
-            const char* path = sapp_get_dropped_file_path(0);
-            if (path && path[0] != '\0') {
-                // Check file extension and load appropriately
-                if (has_extension(path, "nsf") || has_extension(path, "nsfe")) {
-                    load_nsf_file(path);
-                    postload_preprocess();
-                } else if (has_extension(path, "nes")) {
-                    load_nes_rom(path);
-                }
-            }
+        std::vector<std::string> paths;
+        for (int i = 0; i < num_files; ++i) {
+            const char* path = sapp_get_dropped_file_path(i);
+            if (path && path[0] != '\0') paths.push_back(path);
         }
+        open_dropped_files(paths, start);
+#endif
     }
     
     // Track key states for NES controller input
@@ -1005,6 +4156,13 @@ void input(const sapp_event* ev) {
         if (ev->key_code < 512) key_states[ev->key_code] = false;
     }
     
+    // Hand the pads over right away; the emulation thread latches them when
+    // the game next reads the controller (only if ImGui doesn't want keyboard)
+    if ((ev->type == SAPP_EVENTTYPE_KEY_DOWN || ev->type == SAPP_EVENTTYPE_KEY_UP) &&
+        current_mode == AppMode::NES_EMULATOR && !ImGui::GetIO().WantCaptureKeyboard) {
+        update_nes_input();
+    }
+    
     // Keyboard shortcuts
     if (ev->type == SAPP_EVENTTYPE_KEY_DOWN && !ImGui::GetIO().WantCaptureKeyboard) {
         switch (ev->key_code) {
@@ -1041,37 +4199,17 @@ void input(const sapp_event* ev) {
         
         // Ctrl+O: Open NSF file
         if (ev->key_code == SAPP_KEYCODE_O && (ev->modifiers & SAPP_MODIFIER_CTRL)) {
-            nfdu8filteritem_t filterItem[2];
-            filterItem[0].name = "NES Sound Files";
-            filterItem[0].spec = "nsf,nsfe";
-            filterItem[1].name = "All Files";
-            filterItem[1].spec = "*";
-            
-            nfdu8char_t* outPath = nullptr;
-            nfdresult_t result = NFD_OpenDialogU8(&outPath, filterItem, 2, nullptr);
-            
-            if (result == NFD_OKAY) {
-                load_nsf_file(outPath);
-                postload_preprocess();
-                NFD_FreePathU8(outPath);
-            }
+            request_load(LoadKind::MUSIC);
+        }
+        
+        // Ctrl+L: Toggle the library window
+        if (ev->key_code == SAPP_KEYCODE_L && (ev->modifiers & SAPP_MODIFIER_CTRL)) {
+            show_library = !show_library;
         }
         
         // Ctrl+R: Open NES ROM
         if (ev->key_code == SAPP_KEYCODE_R && (ev->modifiers & SAPP_MODIFIER_CTRL)) {
-            nfdu8filteritem_t filterItem[2];
-            filterItem[0].name = "NES ROM Files";
-            filterItem[0].spec = "nes";
-            filterItem[1].name = "All Files";
-            filterItem[1].spec = "*";
-            
-            nfdu8char_t* outPath = nullptr;
-            nfdresult_t result = NFD_OpenDialogU8(&outPath, filterItem, 2, nullptr);
-            
-            if (result == NFD_OKAY) {
-                load_nes_rom(outPath);
-                NFD_FreePathU8(outPath);
-            }
+            request_load(LoadKind::NES_ROM);
         }
         
         // P: Toggle emulator pause (when in emulator mode)
@@ -1083,14 +4221,33 @@ void input(const sapp_event* ev) {
             }
         }
         
+        // F9: Save the last seconds of the player as a clip
+        if (ev->key_code == SAPP_KEYCODE_F9 && current_mode == AppMode::NSF_PLAYER && !ev->key_repeat) {
+            save_clip();
+        }
+        
         // F5: Reset emulator
         if (ev->key_code == SAPP_KEYCODE_F5 && current_mode == AppMode::NES_EMULATOR) {
             state.nes_emu.reset();
         }
+        
+        // F2/F4: Quick save and load
+        if (ev->key_code == SAPP_KEYCODE_F2 && current_mode == AppMode::NES_EMULATOR && !ev->key_repeat) {
+            state.save_slots.save(state.nes_emu, 0);
+        }
+        if (ev->key_code == SAPP_KEYCODE_F4 && current_mode == AppMode::NES_EMULATOR && !ev->key_repeat) {
+            state.save_slots.load(state.nes_emu, 0);
+        }
     }
 }
 
 sapp_desc sokol_main(int argc, char* argv[]) {
+    // Offline rendering, batch exports, trace diffs and agent environments run without a window or audio device
+    if (BatchRunner::isCommandLine(argc, argv)) std::exit(BatchRunner::runCommandLine(argc, argv));
+    if (TraceDiff::isCommandLine(argc, argv)) std::exit(TraceDiff::runCommandLine(argc, argv));
+    if (AgentEnv::isCommandLine(argc, argv)) std::exit(AgentEnv::runCommandLine(argc, argv));
+    if (VideoRenderer::isCommandLine(argc, argv)) std::exit(VideoRenderer::runCommandLine(argc, argv));
+
     sapp_desc _sapp_desc{};
     _sapp_desc.init_cb = init;
     _sapp_desc.frame_cb = frame;
@@ -1104,7 +4261,7 @@ sapp_desc sokol_main(int argc, char* argv[]) {
     
     // Enable drag and drop support
     _sapp_desc.enable_dragndrop = true;
-    _sapp_desc.max_dropped_files = 1;
+    _sapp_desc.max_dropped_files = PlayQueue::MAX_DROPPED_FILES;
     _sapp_desc.max_dropped_file_path_length = 4096;
     
     return _sapp_desc;
@@ -0,0 +1,700 @@
+// Headless NES throughput benchmark.
+//
+//   nes_bench <rom.nes> [frames] [--movie file] [--record file] [--mute mask] [--core-only] [--eager-ppu] [--dot-renderer] [--check]
+//   nes_bench --mix [frames]
+//   nes_bench <rom.nes> [frames] --batch sessions [--threads n] [--movie file]
+//   nes_bench --golden manifest [--update]
+//
+// Runs the ROM for a fixed number of frames as fast as possible and reports
+// frames/sec, ns per CPU instruction and ns per PPU dot. By default the full
+// NesEmulator path is measured (agnes + Nes_Apu + Blip_Buffer + palette
+// conversion); --core-only times bare agnes_next_frame, and --eager-ppu
+// disables catch-up PPU scheduling and --dot-renderer the scanline renderer.
+// --mute mutes the full path's channels in a NesEmulator::setMuteMask mask
+// (0x1E: Pulse 1 solo), to time what a soloed channel costs.
+// --check instead runs catch-up + scanline rendering side by side with the
+// eager per-dot reference and fails on the first frame that differs.
+// --mix needs no ROM: it times Blip_Buffer::read_samples (the emulator's mono
+// output) and Stereo_Buffer::read_samples (the NSF player's mix) on a
+// synthetic square-wave load and reports ns per output frame.
+// --batch steps that many NesBatch sessions (all fed the same input) across
+// n job workers plus the main thread and reports the combined frames/sec;
+// the sessions must end up identical.
+// --golden replays every case of a manifest (NSF tracks through gme_play,
+// ROMs with their movies through the full NesEmulator path) and compares a
+// hash of each audio block and each frame's picture against the case's
+// stored golden file, reporting the first frame or sample that diverges;
+// --update rewrites the golden files instead. See golden/manifest.txt.
+//
+// Movie files are either InputMovie recordings (exact start state, both pads)
+// or plain text, one "<frame> <buttons>" line per input change for player 1,
+// where buttons is any of A B s(elect) S(tart) U D L R, or '.' for none.
+// Lines starting with '#' are ignored. Input holds until the next line.
+// --record writes the full-path run (and its start state) as an InputMovie;
+// the full path also prints a hash of the final picture, so a replay can be
+// compared against the run that recorded it.
+
+#include "NesEmulator.h"
+#include "NesBatch.h"
+#include "JobSystem.h"
+#include "agnes/agnes.h"
+#include "gme/Multi_Buffer.h"
+#include "gme/gme.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+struct MovieEvent {
+    int frame;
+    agnes_input_t input;
+};
+
+// Text movie as an InputMovie without a start state; the last line's input
+// holds through 'frames'
+bool loadTextMovie(const char* path, int frames, InputMovie& movie) {
+    std::ifstream file(path);
+    if (!file) return false;
+
+    std::vector<MovieEvent> events;
+    std::string line;
+    while (std::getline(file, line)) {
+        if (line.empty() || line[0] == '#') continue;
+        std::istringstream in(line);
+        MovieEvent ev = {};
+        std::string buttons;
+        if (!(in >> ev.frame)) continue;
+        in >> buttons;
+        for (char c : buttons) {
+            switch (c) {
+                case 'A': ev.input.a = true; break;
+                case 'B': ev.input.b = true; break;
+                case 's': ev.input.select = true; break;
+                case 'S': ev.input.start = true; break;
+                case 'U': ev.input.up = true; break;
+                case 'D': ev.input.down = true; break;
+                case 'L': ev.input.left = true; break;
+                case 'R': ev.input.right = true; break;
+                default: break;
+            }
+        }
+        events.push_back(ev);
+    }
+
+    const agnes_input_t no_input = {};
+    movie.clear();
+    size_t cursor = 0;
+    for (int f = 0; f < frames; ++f) {
+        while (cursor < events.size() && events[cursor].frame <= f) ++cursor;
+        movie.append(InputMovie::pack(cursor ? events[cursor - 1].input : no_input, no_input));
+    }
+    return true;
+}
+
+// Binary movies (InputMovie files) are recognised by their magic
+bool loadMovie(const char* path, int frames, InputMovie& movie) {
+    char magic[4] = {};
+    std::ifstream file(path, std::ios::binary);
+    if (!file) return false;
+    file.read(magic, sizeof(magic));
+    if (memcmp(magic, "FCMV", 4) == 0) return movie.load(path);
+    return loadTextMovie(path, frames, movie);
+}
+
+// This frame's pads; no input past the end of the movie
+void moviePads(const InputMovie& movie, InputMovie::Cursor& cursor, int frame, agnes_input_t pads[2]) {
+    uint16_t buttons = movie.buttonsAt(static_cast<uint32_t>(frame), cursor);
+    pads[0] = InputMovie::unpack(buttons, 0);
+    pads[1] = InputMovie::unpack(buttons, 1);
+}
+
+// Start a bare agnes instance where a recorded movie starts; it stays silent
+bool applyMovieStart(agnes_t* agnes, const InputMovie& movie) {
+    const std::vector<uint8_t>& state = movie.startState().agnes;
+    if (state.empty()) return true;
+    if (state.size() != agnes_compact_state_size(agnes)) return false;
+    agnes_restore_compact_state(agnes, state.data());
+    return true;
+}
+
+bool readFile(const char* path, std::vector<uint8_t>& out) {
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file) return false;
+    out.resize(static_cast<size_t>(file.tellg()));
+    file.seekg(0, std::ios::beg);
+    return static_cast<bool>(file.read(reinterpret_cast<char*>(out.data()), out.size()));
+}
+
+void usage() {
+    fprintf(stderr, "usage: nes_bench <rom.nes> [frames] [--movie file] [--record file] [--mute mask] [--core-only] [--eager-ppu] [--dot-renderer] [--check]\n"
+                    "       nes_bench --mix [frames]\n"
+                    "       nes_bench <rom.nes> [frames] --batch sessions [--threads n] [--movie file]\n"
+                    "       nes_bench --golden manifest [--update]\n");
+}
+
+// Per-frame square-wave edges into 'buf'; its period drifts so the load isn't periodic
+void addSquareEdges(Blip_Synth<blip_good_quality, 30>& synth, Blip_Buffer* buf,
+                    int frame, int frame_clocks, int& amp) {
+    int period = 200 + (frame * 37) % 400;
+    for (int t = (frame * 13) % period; t < frame_clocks; t += period) {
+        amp = -amp;
+        synth.offset(t, amp * 2, buf);
+    }
+    buf->set_modified();
+}
+
+// Time the Blip_Buffer read/mix paths alone; synthesis happens outside the clock
+int benchMix(int frames) {
+    const long sample_rate = 44100;
+    const long clock_rate = 1789773;
+    const int frame_clocks = 29781;
+
+    using clock = std::chrono::steady_clock;
+    std::vector<blip_sample_t> out(4096);
+    long samples = 0;
+
+    Blip_Buffer mono;
+    if (mono.set_sample_rate(sample_rate, 100)) return 1;
+    mono.clock_rate(clock_rate);
+    Blip_Synth<blip_good_quality, 30> synth;
+    synth.volume(0.5);
+    int amp = 10;
+    clock::duration mono_time{};
+    for (int f = 0; f < frames; ++f) {
+        addSquareEdges(synth, &mono, f, frame_clocks, amp);
+        mono.end_frame(frame_clocks);
+        auto start = clock::now();
+        samples += mono.read_samples(out.data(), static_cast<long>(out.size()));
+        mono_time += clock::now() - start;
+    }
+    double mono_ns = std::chrono::duration<double>(mono_time).count() * 1e9 / samples;
+
+    Stereo_Buffer stereo;
+    if (stereo.set_sample_rate(sample_rate, 100)) return 1;
+    stereo.clock_rate(clock_rate);
+    int amps[3] = { 10, 10, 10 };
+    Blip_Buffer* bufs[3] = { stereo.center(), stereo.left(), stereo.right() };
+    clock::duration stereo_time{};
+    long frames_out = 0;
+    for (int f = 0; f < frames; ++f) {
+        for (int b = 0; b < 3; ++b) {
+            addSquareEdges(synth, bufs[b], f + b * 101, frame_clocks, amps[b]);
+        }
+        stereo.end_frame(frame_clocks);
+        auto start = clock::now();
+        frames_out += stereo.read_samples(out.data(), static_cast<long>(out.size())) / 2;
+        stereo_time += clock::now() - start;
+    }
+    double stereo_ns = std::chrono::duration<double>(stereo_time).count() * 1e9 / frames_out;
+
+    printf("mix:           %d frames\n", frames);
+    printf("mono read:     %ld samples (%.2f ns each)\n", samples, mono_ns);
+    printf("stereo mix:    %ld frames (%.2f ns each)\n", frames_out, stereo_ns);
+    return 0;
+}
+
+// Catch-up/scanline vs. eager/per-dot PPU must produce identical frames and timing
+int checkSchedulers(std::vector<uint8_t>& rom, int frames, const InputMovie& movie) {
+    agnes_t* lazy = agnes_make();
+    agnes_t* eager = agnes_make();
+    if (!lazy || !eager ||
+        !agnes_load_ines_data(lazy, rom.data(), rom.size()) ||
+        !agnes_load_ines_data(eager, rom.data(), rom.size()) ||
+        !applyMovieStart(lazy, movie) || !applyMovieStart(eager, movie)) {
+        fprintf(stderr, "nes_bench: cannot load ROM\n");
+        return 1;
+    }
+    agnes_set_ppu_catch_up(eager, false);
+
+    const size_t screen_size = AGNES_SCREEN_WIDTH * AGNES_SCREEN_HEIGHT;
+    InputMovie::Cursor cursor;
+    int result = 0;
+    for (int f = 0; f < frames; ++f) {
+        agnes_input_t pads[2];
+        moviePads(movie, cursor, f, pads);
+        agnes_set_input(lazy, &pads[0], &pads[1]);
+        agnes_set_input(eager, &pads[0], &pads[1]);
+        agnes_next_frame(lazy);
+        agnes_next_frame(eager);
+        if (agnes_get_cpu_cycles(lazy) != agnes_get_cpu_cycles(eager) ||
+            memcmp(agnes_get_screen_buffer(lazy), agnes_get_screen_buffer(eager), screen_size) != 0) {
+            fprintf(stderr, "check: frame %d differs (cycles %llu vs %llu)\n", f,
+                    static_cast<unsigned long long>(agnes_get_cpu_cycles(lazy)),
+                    static_cast<unsigned long long>(agnes_get_cpu_cycles(eager)));
+            result = 2;
+            break;
+        }
+    }
+    if (result == 0) printf("check: %d frames identical\n", frames);
+    agnes_destroy(lazy);
+    agnes_destroy(eager);
+    return result;
+}
+
+// Step 'sessions' copies of the ROM together; identical input must give identical sessions
+int benchBatch(const std::vector<uint8_t>& rom, int frames, int sessions, int threads,
+               const InputMovie& movie) {
+    NesBatch batch;
+    if (!batch.loadROMData(rom.data(), rom.size()) || !batch.create(sessions)) {
+        fprintf(stderr, "nes_bench: cannot load ROM\n");
+        return 1;
+    }
+    if (!movie.startState().agnes.empty()) {
+        for (int i = 0; i < sessions; ++i) {
+            if (!batch.restore(i, movie.startState())) {
+                fprintf(stderr, "nes_bench: movie was recorded by another build\n");
+                return 1;
+            }
+        }
+    }
+    JobSystem jobs;
+    if (threads > 0) jobs.init(threads);
+
+    InputMovie::Cursor cursor;
+    using clock = std::chrono::steady_clock;
+    auto start = clock::now();
+    for (int f = 0; f < frames; ++f) {
+        agnes_input_t pads[2];
+        moviePads(movie, cursor, f, pads);
+        std::fill(batch.input(0), batch.input(0) + sessions, pads[0]);
+        std::fill(batch.input(1), batch.input(1) + sessions, pads[1]);
+        batch.step(jobs);
+    }
+    double seconds = std::chrono::duration<double>(clock::now() - start).count();
+    jobs.shutdown();
+
+    int result = 0;
+    for (int i = 1; i < sessions; ++i) {
+        if (batch.cpuCycles(i) != batch.cpuCycles(0) ||
+            memcmp(batch.screen(i), batch.screen(0), NesBatch::SCREEN_SIZE) != 0) {
+            fprintf(stderr, "batch: session %d differs from session 0\n", i);
+            result = 2;
+            break;
+        }
+    }
+
+    double total = static_cast<double>(frames) * sessions;
+    printf("batch:         %d sessions x %d frames on %d worker(s) + main\n", sessions, frames, threads);
+    printf("frames/sec:    %.1f total, %.1f per thread (%.1fx realtime total)\n", total / seconds,
+           total / seconds / (threads + 1), total / seconds / 60.0988);
+    if (result == 0) printf("sessions:      identical\n");
+    return result;
+}
+
+// --- Golden-output regression check ---
+
+constexpr long GOLDEN_SAMPLE_RATE = 44100;
+constexpr int GOLDEN_BLOCK = 1024;                  // NSF stereo frames per hashed block
+constexpr uint64_t HASH_SEED = 0xcbf29ce484222325ull;
+
+// FNV-1a like InputMovie::hashRom, continued from 'hash' so a frame's audio
+// can arrive in several reads
+uint64_t hashBytes(uint64_t hash, const void* data, size_t size) {
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= bytes[i];
+        hash *= 0x100000001b3ull;
+    }
+    return hash;
+}
+
+// One manifest line: "<nsf|nes> <source> <track|movie|-> <seconds|frames> <golden>"
+struct GoldenCase {
+    int line = 0;
+    bool nsf = false;
+    std::filesystem::path source;
+    std::string input;
+    int length = 0;
+    std::filesystem::path golden;
+};
+
+// What one NSF block or NES frame produced
+struct GoldenStep {
+    uint64_t screen = 0;            // NES only
+    uint64_t audio = HASH_SEED;
+    long samples = 0;               // output samples (shorts) in the step
+};
+
+// "test.nsf #0", "game.nes game.fm2" or "game.nes" for reports
+std::string caseName(const GoldenCase& c) {
+    std::string name = c.source.filename().string();
+    if (c.nsf) return name + " #" + c.input;
+    if (c.input != "-") name += " " + std::filesystem::path(c.input).filename().string();
+    return name;
+}
+
+bool loadManifest(const char* path, std::vector<GoldenCase>& cases) {
+    std::ifstream file(path);
+    if (!file) return false;
+    std::filesystem::path dir = std::filesystem::path(path).parent_path();
+    std::string line;
+    for (int number = 1; std::getline(file, line); ++number) {
+        if (line.empty() || line[0] == '#') continue;
+        std::istringstream in(line);
+        std::string kind, source, golden;
+        GoldenCase c;
+        if (!(in >> kind)) continue;
+        if (!(in >> source >> c.input >> c.length >> golden) || (kind != "nsf" && kind != "nes") || c.length <= 0) {
+            fprintf(stderr, "golden: %s:%d: expected \"<nsf|nes> <source> <track|movie|-> <length> <golden>\"\n",
+                    path, number);
+            return false;
+        }
+        c.line = number;
+        c.nsf = kind == "nsf";
+        c.source = dir / source;
+        c.golden = dir / golden;
+        if (!c.nsf && c.input != "-") c.input = (dir / c.input).string();
+        cases.push_back(std::move(c));
+    }
+    return true;
+}
+
+// The track through gme_play in fixed blocks, for 'length' seconds
+bool runNsfCase(const GoldenCase& c, std::vector<GoldenStep>& steps) {
+    Music_Emu* emu = nullptr;
+    gme_err_t err = gme_open_file(c.source.string().c_str(), &emu, GOLDEN_SAMPLE_RATE);
+    if (!err) {
+        gme_ignore_silence(emu, true);
+        err = gme_start_track(emu, atoi(c.input.c_str()));
+    }
+    std::vector<short> block(GOLDEN_BLOCK * 2);
+    long blocks = (c.length * GOLDEN_SAMPLE_RATE + GOLDEN_BLOCK - 1) / GOLDEN_BLOCK;
+    for (long b = 0; !err && b < blocks; ++b) {
+        err = gme_play(emu, static_cast<long>(block.size()), block.data());
+        GoldenStep step;
+        step.audio = hashBytes(HASH_SEED, block.data(), block.size() * sizeof(short));
+        step.samples = static_cast<long>(block.size());
+        steps.push_back(step);
+    }
+    gme_delete(emu);
+    if (err) fprintf(stderr, "golden: %s: %s\n", c.source.string().c_str(), err);
+    return !err;
+}
+
+// The ROM through the full NesEmulator path, fed its movie (or no input)
+bool runNesCase(const GoldenCase& c, std::vector<GoldenStep>& steps) {
+    std::string source = c.source.string();
+    std::vector<uint8_t> rom;
+    InputMovie movie;
+    NesEmulator emu;
+    if (!readFile(source.c_str(), rom) || !emu.init(GOLDEN_SAMPLE_RATE) || !emu.loadROMData(rom.data(), rom.size())) {
+        fprintf(stderr, "golden: cannot load %s\n", source.c_str());
+        return false;
+    }
+    if (c.input != "-" && !loadMovie(c.input.c_str(), c.length, movie)) {
+        fprintf(stderr, "golden: cannot read movie %s\n", c.input.c_str());
+        return false;
+    }
+    emu.resume();
+    bool replay = !movie.startState().agnes.empty();
+    if (replay && !emu.startReplay(movie)) {
+        fprintf(stderr, "golden: %s was recorded from another ROM or build\n", c.input.c_str());
+        return false;
+    }
+
+    InputMovie::Cursor cursor;
+    std::vector<short> audio(4096);
+    for (int f = 0; f < c.length; ++f) {
+        if (!replay) {
+            agnes_input_t pads[2];
+            moviePads(movie, cursor, f, pads);
+            emu.setInput(0, pads[0]);
+            emu.setInput(1, pads[1]);
+        }
+        emu.runFrame();
+        emu.presentFrame();
+        GoldenStep step;
+        step.screen = InputMovie::hashRom(emu.getScreenPixels(),
+                                          sizeof(uint32_t) * AGNES_SCREEN_WIDTH * AGNES_SCREEN_HEIGHT);
+        while (int read = emu.readAudioSamples(audio.data(), static_cast<int>(audio.size()))) {
+            step.audio = hashBytes(step.audio, audio.data(), read * sizeof(short));
+            step.samples += read;
+        }
+        steps.push_back(step);
+    }
+    return true;
+}
+
+// Golden files: a comment header, then "<step> [<screen>] <audio>" in hex per line
+bool readGolden(const GoldenCase& c, std::vector<GoldenStep>& steps) {
+    std::ifstream file(c.golden);
+    if (!file) return false;
+    std::string line;
+    while (std::getline(file, line)) {
+        if (line.empty() || line[0] == '#') continue;
+        std::istringstream in(line);
+        GoldenStep step;
+        long index = 0;
+        in >> index >> std::hex;
+        if (!c.nsf) in >> step.screen;
+        in >> step.audio;
+        if (!in) return false;
+        steps.push_back(step);
+    }
+    return true;
+}
+
+bool writeGolden(const GoldenCase& c, const std::vector<GoldenStep>& steps) {
+    FILE* file = fopen(c.golden.string().c_str(), "w");
+    if (!file) return false;
+    fprintf(file, "# nes_bench --golden: %s, %s\n", caseName(c).c_str(),
+            c.nsf ? "block audio (1024 stereo frames at 44100 Hz)" : "frame screen audio");
+    for (size_t i = 0; i < steps.size(); ++i) {
+        if (c.nsf) {
+            fprintf(file, "%zu %016llx\n", i, static_cast<unsigned long long>(steps[i].audio));
+        } else {
+            fprintf(file, "%zu %016llx %016llx\n", i, static_cast<unsigned long long>(steps[i].screen),
+                    static_cast<unsigned long long>(steps[i].audio));
+        }
+    }
+    return fclose(file) == 0;
+}
+
+// Points at the first step that differs from the golden run; true if none does
+bool compareGolden(const GoldenCase& c, const std::vector<GoldenStep>& run, const std::vector<GoldenStep>& golden) {
+    const char* unit = c.nsf ? "block" : "frame";
+    long sample = 0;
+    for (size_t i = 0; i < run.size() && i < golden.size(); ++i) {
+        if (!c.nsf && run[i].screen != golden[i].screen) {
+            printf("FAIL  %s: %s %zu: picture differs\n", caseName(c).c_str(), unit, i);
+            return false;
+        }
+        if (run[i].audio != golden[i].audio) {
+            printf("FAIL  %s: %s %zu: audio differs in samples %ld-%ld\n", caseName(c).c_str(),
+                   unit, i, sample, sample + run[i].samples - 1);
+            return false;
+        }
+        sample += run[i].samples;
+    }
+    if (run.size() != golden.size()) {
+        printf("FAIL  %s: ran %zu %ss, the golden file has %zu\n", caseName(c).c_str(),
+               run.size(), unit, golden.size());
+        return false;
+    }
+    return true;
+}
+
+// 0 if every case matches (or was rewritten), 2 if one diverges, 1 on errors
+int runGolden(const char* manifest, bool update) {
+    std::vector<GoldenCase> cases;
+    if (!loadManifest(manifest, cases)) {
+        fprintf(stderr, "golden: cannot read manifest %s\n", manifest);
+        return 1;
+    }
+    using clock = std::chrono::steady_clock;
+    auto start = clock::now();
+    int errors = 0;
+    int diverged = 0;
+    for (const GoldenCase& c : cases) {
+        std::vector<GoldenStep> run;
+        if (!(c.nsf ? runNsfCase(c, run) : runNesCase(c, run))) {
+            ++errors;
+            continue;
+        }
+        std::string name = caseName(c);
+        const char* unit = c.nsf ? "block" : "frame";
+        if (update) {
+            if (!writeGolden(c, run)) {
+                fprintf(stderr, "golden: cannot write %s\n", c.golden.string().c_str());
+                ++errors;
+            } else {
+                printf("wrote %s: %zu %ss\n", name.c_str(), run.size(), unit);
+            }
+            continue;
+        }
+        std::vector<GoldenStep> golden;
+        if (!readGolden(c, golden)) {
+            fprintf(stderr, "golden: cannot read %s (record it with --update)\n", c.golden.string().c_str());
+            ++errors;
+        } else if (!compareGolden(c, run, golden)) {
+            ++diverged;
+        } else {
+            printf("ok    %s: %zu %ss\n", name.c_str(), run.size(), unit);
+        }
+    }
+    double seconds = std::chrono::duration<double>(clock::now() - start).count();
+    printf("golden:        %zu cases, %d diverged, %d errors, %.2f s\n", cases.size(), diverged, errors, seconds);
+    return diverged ? 2 : errors ? 1 : 0;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    const char* rom_path = nullptr;
+    const char* movie_path = nullptr;
+    const char* record_path = nullptr;
+    int mute_mask = 0;
+    int frames = 3600;
+    bool core_only = false;
+    bool eager_ppu = false;
+    bool dot_renderer = false;
+    bool check = false;
+    bool mix = false;
+    int batch_sessions = 0;
+    int batch_threads = -1;
+    const char* golden_manifest = nullptr;
+    bool golden_update = false;
+
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--movie") == 0 && i + 1 < argc) {
+            movie_path = argv[++i];
+        } else if (strcmp(argv[i], "--record") == 0 && i + 1 < argc) {
+            record_path = argv[++i];
+        } else if (strcmp(argv[i], "--mute") == 0 && i + 1 < argc) {
+            mute_mask = static_cast<int>(strtol(argv[++i], nullptr, 0));
+        } else if (strcmp(argv[i], "--core-only") == 0) {
+            core_only = true;
+        } else if (strcmp(argv[i], "--eager-ppu") == 0) {
+            eager_ppu = true;
+        } else if (strcmp(argv[i], "--dot-renderer") == 0) {
+            dot_renderer = true;
+        } else if (strcmp(argv[i], "--check") == 0) {
+            check = true;
+        } else if (strcmp(argv[i], "--batch") == 0 && i + 1 < argc) {
+            batch_sessions = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            batch_threads = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--golden") == 0 && i + 1 < argc) {
+            golden_manifest = argv[++i];
+        } else if (strcmp(argv[i], "--update") == 0) {
+            golden_update = true;
+        } else if (strcmp(argv[i], "--mix") == 0) {
+            mix = true;
+        } else if (mix && !rom_path) {
+            frames = atoi(argv[i]);
+        } else if (!rom_path) {
+            rom_path = argv[i];
+        } else {
+            frames = atoi(argv[i]);
+        }
+    }
+    if (golden_manifest) {
+        return runGolden(golden_manifest, golden_update);
+    }
+    if (mix && frames > 0) {
+        return benchMix(frames);
+    }
+    if (!rom_path || frames <= 0) {
+        usage();
+        return 1;
+    }
+
+    std::vector<uint8_t> rom;
+    if (!readFile(rom_path, rom)) {
+        fprintf(stderr, "nes_bench: cannot read %s\n", rom_path);
+        return 1;
+    }
+
+    InputMovie movie;
+    if (movie_path && !loadMovie(movie_path, frames, movie)) {
+        fprintf(stderr, "nes_bench: cannot read movie %s\n", movie_path);
+        return 1;
+    }
+
+    if (check) {
+        return checkSchedulers(rom, frames, movie);
+    }
+    if (batch_sessions > 0) {
+        if (batch_threads < 0) {
+            batch_threads = std::max(0, static_cast<int>(std::thread::hardware_concurrency()) - 1);
+        }
+        return benchBatch(rom, frames, batch_sessions, batch_threads, movie);
+    }
+
+    InputMovie::Cursor cursor;
+    uint64_t cycles = 0;
+    uint64_t instructions = 0;
+
+    using clock = std::chrono::steady_clock;
+    clock::duration elapsed{};
+
+    if (core_only) {
+        agnes_t* agnes = agnes_make();
+        if (!agnes || !agnes_load_ines_data(agnes, rom.data(), rom.size()) || !applyMovieStart(agnes, movie)) {
+            fprintf(stderr, "nes_bench: cannot load %s\n", rom_path);
+            return 1;
+        }
+        agnes_set_ppu_catch_up(agnes, !eager_ppu);
+        agnes_set_scanline_renderer(agnes, !dot_renderer);
+        auto start = clock::now();
+        for (int f = 0; f < frames; ++f) {
+            agnes_input_t pads[2];
+            moviePads(movie, cursor, f, pads);
+            agnes_set_input(agnes, &pads[0], &pads[1]);
+            agnes_next_frame(agnes);
+        }
+        elapsed = clock::now() - start;
+        cycles = agnes_get_cpu_cycles(agnes);
+        instructions = agnes_get_cpu_instructions(agnes);
+        agnes_destroy(agnes);
+    } else {
+        NesEmulator emu;
+        if (!emu.init(44100) || !emu.loadROMData(rom.data(), rom.size())) {
+            fprintf(stderr, "nes_bench: cannot load %s\n", rom_path);
+            return 1;
+        }
+        emu.setMuteMask(mute_mask);
+        emu.resume();
+        // A recorded movie replays exactly, APU included, from its own start state
+        bool replay = !movie.startState().agnes.empty();
+        if (replay && !emu.startReplay(movie)) {
+            fprintf(stderr, "nes_bench: movie was recorded from another ROM or build\n");
+            return 1;
+        }
+        if (record_path) emu.startRecording();
+        std::vector<short> audio(4096);
+        auto start = clock::now();
+        for (int f = 0; f < frames; ++f) {
+            if (!replay) {
+                agnes_input_t pads[2];
+                moviePads(movie, cursor, f, pads);
+                emu.setInput(0, pads[0]);
+                emu.setInput(1, pads[1]);
+            }
+            emu.runFrame();
+            emu.presentFrame();
+            // Drain audio like the device would so the buffer never fills
+            while (emu.readAudioSamples(audio.data(), static_cast<int>(audio.size())) > 0) {}
+        }
+        elapsed = clock::now() - start;
+        cycles = emu.getCpuCycles();
+        instructions = emu.getCpuInstructions();
+        
+        InputMovie recorded;
+        if (record_path && (!emu.stopRecording(recorded) || !recorded.save(record_path))) {
+            fprintf(stderr, "nes_bench: cannot write movie %s\n", record_path);
+            return 1;
+        }
+        if (record_path) {
+            printf("recorded:      %s (%u frames, %zu runs)\n", record_path, recorded.frameCount(),
+                   recorded.runCount());
+        }
+        printf("screen hash:   %016llx\n", static_cast<unsigned long long>(InputMovie::hashRom(
+            emu.getScreenPixels(), sizeof(uint32_t) * AGNES_SCREEN_WIDTH * AGNES_SCREEN_HEIGHT)));
+    }
+
+    double seconds = std::chrono::duration<double>(elapsed).count();
+    double ns = seconds * 1e9;
+    uint64_t dots = cycles * 3;
+    printf("rom:           %s%s%s%s\n", rom_path, core_only ? " (core only)" : "",
+           eager_ppu ? " (eager PPU)" : "", dot_renderer ? " (dot renderer)" : "");
+    printf("frames:        %d in %.3f s\n", frames, seconds);
+    printf("frames/sec:    %.1f (%.1fx realtime)\n", frames / seconds, frames / seconds / 60.0988);
+    printf("instructions:  %llu (%.2f ns each)\n", static_cast<unsigned long long>(instructions),
+           instructions ? ns / instructions : 0.0);
+    printf("cpu cycles:    %llu (%.2f ns each)\n", static_cast<unsigned long long>(cycles),
+           cycles ? ns / cycles : 0.0);
+    printf("ppu dots:      %llu (%.2f ns each)\n", static_cast<unsigned long long>(dots),
+           dots ? ns / dots : 0.0);
+    return 0;
+}